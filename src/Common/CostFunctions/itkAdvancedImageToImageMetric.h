@@ -26,6 +26,7 @@
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
 #include "itkAdvancedLinearInterpolateImageFunction.h"
 #include "itkLimiterFunctionBase.h"
+#include "itkMultiCandidateCostFunction.h"
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
 #include "vnl/vnl_sparse_matrix.h"
@@ -35,6 +36,16 @@
 #include "itkAdvancedCombinationTransform.h"
 
 #include "itkMultiThreader.h"
+#include "itkPersistentThreadPool.h"
+#include "itkDistributedComputation.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkAtomicInt.h"
+#include "itkFixedImagePreprocessingCache.h"
+#include "itkPhaseTimer.h"
+#include "itkMemoryAccounting.h"
+#include "itkAlignedBufferArena.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkInternalBufferRealType.h"
 
 namespace itk
 {
@@ -64,6 +75,12 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li It is a MultiCandidateCostFunction: GetValues() computes the value for
+ *   several parameter vectors. By default GetValue() is called for each of them;
+ *   inheriting metrics can override it to sweep over the samples only once.
+ * \li Implicit sampling: metrics that support it generate the samples of a grid
+ *   or full sampler on the fly, see ImageSamplerBase::GetImplicitSampleGrid(),
+ *   so that the sampler output is never materialized.
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -77,7 +94,8 @@ namespace itk
 
 template< class TFixedImage, class TMovingImage >
 class AdvancedImageToImageMetric :
-  public ImageToImageMetric< TFixedImage, TMovingImage >
+  public ImageToImageMetric< TFixedImage, TMovingImage >,
+  public MultiCandidateCostFunction
 {
 public:
 
@@ -139,6 +157,9 @@ public:
   typedef typename ImageSamplerType::Pointer                      ImageSamplerPointer;
   typedef typename ImageSamplerType::OutputVectorContainerType    ImageSampleContainerType;
   typedef typename ImageSamplerType::OutputVectorContainerPointer ImageSampleContainerPointer;
+  typedef typename ImageSamplerType::ImageSampleSoAContainerType  ImageSampleSoAContainerType;
+  typedef typename ImageSamplerType::ImageSampleType              ImageSampleType;
+  typedef typename ImageSamplerType::ImplicitSampleGridType       ImplicitSampleGridType;
 
   /** Typedefs for Limiter support. */
   typedef LimiterFunctionBase< RealType, FixedImageDimension >  FixedImageLimiterType;
@@ -264,6 +285,23 @@ public:
    */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Compute only the diagonal of the SelfHessian, with GetNumberOfParameters()
+   * elements. This base class takes the diagonal of GetSelfHessian(); metrics
+   * that use AssembleSelfHessian() compute it without the off-diagonal entries.
+   */
+  virtual void GetSelfHessianDiagonal( const TransformParametersType & parameters,
+    DerivativeType & diagonal ) const;
+
+  /** Typedefs for evaluating several parameter vectors at once. */
+  typedef MultiCandidateCostFunction::ParametersArrayType ParametersArrayType;
+  typedef MultiCandidateCostFunction::MeasureArrayType    MeasureArrayType;
+
+  /** Compute the value for all parameter vectors in parametersArray.
+   * This base class calls GetValue() for each of them.
+   */
+  virtual void GetValues( const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const;
+
   /** Set number of threads to use for computations. */
   virtual void SetNumberOfThreads( ThreadIdType numberOfThreads );
 
@@ -278,6 +316,136 @@ public:
   itkGetConstReferenceMacro( UseMultiThread, bool );
   itkBooleanMacro( UseMultiThread );
 
+  /** Store the fixed sample features of the transform (e.g. the B-spline
+   * weights) and the nonzero Jacobian indices of all samples, and reuse them
+   * in every iteration. This is only done when the image sampler does not
+   * select new samples (the grid and full samplers) and the transform supports
+   * it. It trades memory for computation time. Default: false.
+   */
+  itkSetMacro( UseFixedSampleFeatureCache, bool );
+  itkGetConstReferenceMacro( UseFixedSampleFeatureCache, bool );
+  itkBooleanMacro( UseFixedSampleFeatureCache );
+
+  /** Use the fixed sample features stored by another metric, instead of
+   * computing and storing them again. The source metric must use the same
+   * image sampler and transform as this metric, and must stay alive as long
+   * as it is set. Used by the CombinationImageToImageMetric for sub metrics
+   * that share their sampler and transform. Set to 0 (default) to use the
+   * own features.
+   */
+  virtual void SetFixedSampleFeatureCacheSource( const Self * source )
+  {
+    this->m_FixedSampleFeatureCacheSource = ( source == this ) ? 0 : source;
+  }
+
+
+  const Self * GetFixedSampleFeatureCacheSource( void ) const
+  {
+    return this->m_FixedSampleFeatureCacheSource;
+  }
+
+
+  /** Precompute the moving image gradient at the start of each resolution, and
+   * store it together with the moving image values in a float image with
+   * MovingImageDimension + 1 components per pixel. The value and gradient are
+   * then linearly interpolated from this image in a single pass, instead of
+   * being computed by the interpolator for every sample. The gradient is a
+   * central difference, in physical space. Not used for the B-spline
+   * interpolators, which provide exact derivatives. The interpolated value
+   * is only used with the linear interpolator, and only if the moving pixel
+   * type is exactly represented by a float; otherwise the value still comes
+   * from the interpolator, so that GetValue() gives the same value.
+   * Default: false.
+   */
+  itkSetMacro( UsePrecomputedMovingImageGradient, bool );
+  itkGetConstReferenceMacro( UsePrecomputedMovingImageGradient, bool );
+  itkBooleanMacro( UsePrecomputedMovingImageGradient );
+
+  /** Accumulate the derivative of the multi-threaded GetValueAndDerivative()
+   * sparsely, in a single derivative that is shared by the threads, instead
+   * of in a dense derivative per thread that is summed afterwards. It saves
+   * (NumberOfThreads - 1) derivatives of memory and the bandwidth to reduce
+   * them, and pays off for transforms with many parameters and a small support,
+   * like the B-spline transforms. Only used by metrics that support it
+   * (AdvancedMeanSquares, AdvancedNormalizedCorrelation). Default: false.
+   */
+  itkSetMacro( UseSparseDerivativeAccumulation, bool );
+  itkGetConstReferenceMacro( UseSparseDerivativeAccumulation, bool );
+  itkBooleanMacro( UseSparseDerivativeAccumulation );
+
+  /** Make the multi-threaded value and derivative independent of the number
+   * of threads, so that they are bitwise reproducible between machines.
+   * The work is divided in NumberOfDeterministicBlocks blocks of samples,
+   * instead of one part per thread. The blocks are executed by the threads
+   * of the PersistentThreadPool, and their partial results are reduced in a
+   * fixed order. Every block holds a derivative of the full length, so more
+   * blocks than threads cost memory and accumulation time. The sparse
+   * derivative accumulation, whose order depends on the timing of the
+   * threads, is not used in this mode. The samples themselves are only
+   * reproducible with a deterministic sampler, e.g. a RandomCoordinate
+   * sampler with the counter-based generator. Default: false.
+   */
+  virtual void SetUseDeterministicReduction( bool _arg );
+  itkGetConstReferenceMacro( UseDeterministicReduction, bool );
+  itkBooleanMacro( UseDeterministicReduction );
+
+  /** The number of blocks of the deterministic reduction; it is limited to
+   * the maximum number of threads of ITK. Default: 16.
+   */
+  virtual void SetNumberOfDeterministicBlocks( ThreadIdType _arg );
+  itkGetConstMacro( NumberOfDeterministicBlocks, ThreadIdType );
+
+  /** Divide the fixed image samples over the ranks of the DistributedComputation,
+   * when elastix runs as several MPI processes. Every rank evaluates its part
+   * of the sample slots with its threads, and the partial sums are added over
+   * the ranks, so that all ranks obtain the same value and derivative. The
+   * transform parameters are broadcast from rank 0 before each evaluation.
+   * All ranks must use the same samples, so a random sampler needs the same
+   * seed on every rank; this is checked once per resolution, see
+   * CheckDistributedSamples(). Only the multi-threaded GetValueAndDerivative() of
+   * the metrics that support it is distributed, currently AdvancedMeanSquares;
+   * the others evaluate all samples on every rank. Default: false.
+   */
+  itkSetMacro( UseDistributedComputation, bool );
+  itkGetConstReferenceMacro( UseDistributedComputation, bool );
+  itkBooleanMacro( UseDistributedComputation );
+
+  /** Reject the samples that are certainly mapped outside the moving image
+   * buffer, or outside the bounding box of a moving image mask, before the
+   * transform is evaluated. The displacement of a B-spline transform is at
+   * most its largest coefficient, per dimension, since the B-spline weights
+   * are nonnegative and sum to one. The mapped point therefore lies within
+   * that distance of the point mapped by the initial transform, which is
+   * cheap to evaluate for the usual affine initial transforms. The check is
+   * conservative: it only rejects samples that would be rejected later on.
+   * It is only used for B-spline transforms, by TransformPoint(), so only
+   * metrics that check its return value should use it. Default: false.
+   */
+  itkSetMacro( UseMovingImageBoundsCheck, bool );
+  itkGetConstReferenceMacro( UseMovingImageBoundsCheck, bool );
+  itkBooleanMacro( UseMovingImageBoundsCheck );
+
+  /** Returns the number of samples that were rejected by the moving image
+   * bounds check since the last Initialize().
+   */
+  SizeValueType GetNumberOfBoundsCheckRejections( void ) const
+  {
+    return static_cast< SizeValueType >( this->m_NumberOfBoundsCheckRejections.load() );
+  }
+
+
+  /** Set the transform parameters, and update the bound on the displacement
+   * of the moving image bounds check. This hides the non-virtual method of
+   * the superclass, which the inheriting metrics call.
+   */
+  void SetTransformParameters( const ParametersType & parameters ) const;
+
+  /** Returns the number of bytes held by the work memory of the metric, such
+   * as the per thread derivatives and the packed moving image. It is reported
+   * by the memory accounting of elastix. Subclasses add their own buffers.
+   */
+  virtual SizeValueType GetWorkMemorySize( void ) const;
+
   /** Contains calls from GetValueAndDerivative that are thread-unsafe,
    * together with preparation for multi-threading.
    * Note that the only reason why this function is not protected, is
@@ -308,14 +476,14 @@ protected:
   typedef typename InterpolatorType::ContinuousIndexType MovingImageContinuousIndexType;
 
   /** Typedefs used for computing image derivatives. */
-  typedef BSplineInterpolateImageFunction<
-    MovingImageType, CoordinateRepresentationType, double >      BSplineInterpolatorType;
+  typedef BSplineInterpolateImageFunction< MovingImageType,
+    CoordinateRepresentationType, InternalBufferRealType >       BSplineInterpolatorType;
   typedef typename BSplineInterpolatorType::Pointer BSplineInterpolatorPointer;
   typedef BSplineInterpolateImageFunction<
     MovingImageType, CoordinateRepresentationType, float >       BSplineInterpolatorFloatType;
   typedef typename BSplineInterpolatorFloatType::Pointer BSplineInterpolatorFloatPointer;
-  typedef ReducedDimensionBSplineInterpolateImageFunction<
-    MovingImageType, CoordinateRepresentationType, double >      ReducedBSplineInterpolatorType;
+  typedef ReducedDimensionBSplineInterpolateImageFunction< MovingImageType,
+    CoordinateRepresentationType, InternalBufferRealType >       ReducedBSplineInterpolatorType;
   typedef typename ReducedBSplineInterpolatorType::Pointer ReducedBSplineInterpolatorPointer;
   typedef AdvancedLinearInterpolateImageFunction<
     MovingImageType, CoordinateRepresentationType >              LinearInterpolatorType;
@@ -325,6 +493,13 @@ protected:
     MovingImageType, RealType, RealType >                        CentralDifferenceGradientFilterType;
   typedef typename CentralDifferenceGradientFilterType::Pointer CentralDifferenceGradientFilterPointer;
 
+  /** Typedefs for the packed moving image values and gradients. */
+  typedef Vector< float,
+    itkGetStaticConstMacro( MovingImageDimension ) + 1 >         PackedMovingImagePixelType;
+  typedef Image< PackedMovingImagePixelType,
+    itkGetStaticConstMacro( MovingImageDimension ) >             PackedMovingImageType;
+  typedef typename PackedMovingImageType::Pointer               PackedMovingImagePointer;
+
   /** Typedefs for support of sparse Jacobians and compact support of transformations. */
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
@@ -341,6 +516,7 @@ protected:
   bool                                   m_InterpolatorIsBSpline;
   bool                                   m_InterpolatorIsBSplineFloat;
   bool                                   m_InterpolatorIsReducedBSpline;
+  bool                                   m_BindBSplineInterpolatorStatically;
   LinearInterpolatorPointer              m_LinearInterpolator;
   BSplineInterpolatorPointer             m_BSplineInterpolator;
   BSplineInterpolatorFloatPointer        m_BSplineInterpolatorFloat;
@@ -348,6 +524,20 @@ protected:
 
   CentralDifferenceGradientFilterPointer m_CentralDifferenceGradientFilter;
 
+  /** The packed moving image values and gradients, if precomputed, and
+   * whether its values replace those of the interpolator.
+   */
+  bool                     m_UsePrecomputedMovingImageGradient;
+  PackedMovingImagePointer m_PackedMovingImage;
+  bool                     m_UsePackedMovingImageValue;
+
+  /** The diagonal of the physical-point-to-index matrix of the moving image,
+   * if its direction cosines do not rotate, and its origin.
+   */
+  bool                                  m_MovingImageDirectionIsDiagonal;
+  typename MovingImageType::SpacingType m_MovingImagePointToIndexDiagonal;
+  typename MovingImageType::PointType   m_MovingImageOrigin;
+
   /** Variables to store the AdvancedTransform. */
   bool m_TransformIsAdvanced;
   typename AdvancedTransformType::Pointer m_AdvancedTransform;
@@ -442,6 +632,14 @@ protected:
     SizeValueType  st_NumberOfPixelsCounted;
     MeasureType    st_Value;
     DerivativeType st_Derivative;
+    // The memory of st_Derivative, from the aligned buffer arena
+    AlignedArenaBuffer st_DerivativeBuffer;
+    // Used for the sparse derivative accumulation
+    std::vector< std::pair< unsigned long, DerivativeValueType > > st_SparseDerivative;
+    // Scratch buffers of the per-sample computations, sized once per resolution
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    DerivativeType             st_ImageJacobian;
+    TransformJacobianType      st_TransformJacobian;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GetValueAndDerivativePerThreadStruct,
     PaddedGetValueAndDerivativePerThreadStruct );
@@ -453,6 +651,159 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
+  /** Initialize the per thread variables of one thread; called by that thread
+   * itself when multi-threaded, for a first-touch placement of its buffers.
+   */
+  void InitializePerThreadVariables( ThreadIdType threadId ) const;
+
+  /** InitializeThreadingParameters threader callback function. */
+  static ITK_THREAD_RETURN_TYPE InitializeThreadingParametersThreaderCallback( void * arg );
+
+  /** Methods and variables for the sparse derivative accumulation. ***************/
+
+  /** Returns whether the threads accumulate the derivative sparsely. This is
+   * decided in InitializeThreadingParameters(). If true, the per thread
+   * st_Derivative is empty, and the threads should call
+   * AddSparseDerivativeContributions() and, at their end,
+   * FlushSparseDerivativeContributions() instead.
+   */
+  bool GetSparseDerivativeAccumulationIsActive( void ) const
+  {
+    return this->m_SparseDerivativeAccumulationIsActive;
+  }
+
+
+  /** Add factor * imageJacobian[ i ] to the derivative of parameter nzji[ i ].
+   * The contributions are buffered per thread and added to the shared
+   * derivative once the buffer is full.
+   */
+  void AddSparseDerivativeContributions( ThreadIdType threadId,
+    const NonZeroJacobianIndicesType & nzji,
+    const DerivativeType & imageJacobian,
+    const DerivativeValueType factor ) const;
+
+  /** As above, for metrics that accumulate m_NumberOfSparseDerivativeComponents
+   * derivative-like vectors at once. Adds factors[ c ] * imageJacobian[ i ] to
+   * component c of parameter nzji[ i ]. The components of a parameter are stored
+   * next to each other in the shared derivative, see GetSparseDerivative().
+   */
+  void AddSparseDerivativeContributions( ThreadIdType threadId,
+    const NonZeroJacobianIndicesType & nzji,
+    const DerivativeType & imageJacobian,
+    const DerivativeValueType * factors ) const;
+
+  /** Add the buffered contributions of a thread to the shared derivative.
+   * The contributions are sorted, so that each stripe of the shared derivative
+   * is locked once; threads only wait when they update the same stripe.
+   */
+  void FlushSparseDerivativeContributions( ThreadIdType threadId ) const;
+
+  /** Copy the shared derivative multiplied by the normalization into the
+   * derivative, and reset the shared derivative for the next iteration.
+   */
+  void AccumulateSparseDerivatives( DerivativeType & derivative,
+    const DerivativeValueType normalization ) const;
+
+  /** Static range function used by AccumulateSparseDerivatives(). */
+  static void AccumulateSparseDerivativesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Get the shared derivative, for metrics that do not use
+   * AccumulateSparseDerivatives() to read it. It has
+   * m_NumberOfSparseDerivativeComponents entries per parameter,
+   * and should be reset to zero after use.
+   */
+  DerivativeType & GetSparseDerivative( void ) const
+  {
+    return this->m_SparseDerivative;
+  }
+
+
+  /** Metrics that implement the sparse accumulation set this to true. */
+  bool m_SparseDerivativeAccumulationIsSupported;
+
+  /** The number of derivative-like vectors that a metric accumulates sparsely; default 1. */
+  unsigned int m_NumberOfSparseDerivativeComponents;
+
+  /** Methods for metrics that accumulate per participant of ParallelFor(). ***/
+
+  /** The number of partial results of ParallelForBlocks(): one per thread of
+   * the PersistentThreadPool, or one per block in deterministic mode.
+   */
+  ThreadIdType GetNumberOfParallelForBlocks( void ) const;
+
+  /** Calls the range function for [0, numberOfItems) on the thread pool. The
+   * participantId, smaller than GetNumberOfParallelForBlocks(), selects the
+   * partial result to accumulate in. Normally this is the ParallelFor() of the
+   * thread pool. In deterministic mode the items are divided in fixed blocks,
+   * the function is called once per block, with the block as participantId.
+   */
+  void ParallelForBlocks( SizeValueType numberOfItems,
+    PersistentThreadPool::RangeFunctionType function, void * userData ) const;
+
+  /** The blocks of a deterministic ParallelForBlocks() call. */
+  struct ParallelForBlocksParameterType
+  {
+    PersistentThreadPool::RangeFunctionType st_Function;
+    void *                                  st_UserData;
+    SizeValueType                           st_NumberOfItems;
+    SizeValueType                           st_NumberOfBlocks;
+  };
+
+  /** Static range function used by ParallelForBlocks(). */
+  static void ParallelForBlocksRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Methods for the SelfHessian. ***/
+
+  /** Compute the contribution of sample sampleIndex to the SelfHessian: it
+   * adds V V^T to the entries ( nzji, nzji ), with V the nzji.size() x
+   * numberOfColumns matrix stored row by row in terms. There is room for
+   * GetNumberOfNonZeroJacobianIndices() rows. Returns false if the sample is
+   * not valid. Called in parallel by AssembleSelfHessian(), so it must be
+   * thread-safe. This base class has no valid samples.
+   */
+  virtual bool EvaluateSelfHessianTerms( const ImageSampleContainerType * samples,
+    SizeValueType sampleIndex, NonZeroJacobianIndicesType & nzji, double * terms ) const;
+
+  /** Add the contributions of the samples to the upper triangle of H, or, if
+   * diagonalOnly, only to the diagonal; H or diagonal must be sized and zero.
+   * Returns the number of valid samples. The samples are processed in chunks:
+   * the terms of a chunk are evaluated in parallel, and then every thread adds
+   * them to its own range of rows. No row is shared by threads, and the sums
+   * do not depend on the number of threads.
+   */
+  SizeValueType AssembleSelfHessian( const ImageSampleContainerType * samples,
+    unsigned int numberOfColumns, bool diagonalOnly,
+    HessianType & H, DerivativeType & diagonal ) const;
+
+  /** The data of the range functions of AssembleSelfHessian(). */
+  struct SelfHessianAssemblyParameterType
+  {
+    const Self *                              st_Metric;
+    const ImageSampleContainerType *          st_Samples;
+    SizeValueType                             st_ChunkBegin;
+    SizeValueType                             st_ChunkEnd;
+    SizeValueType                             st_NumberOfRows;
+    SizeValueType                             st_NumberOfRowBlocks;
+    unsigned int                              st_NumberOfColumns;
+    SizeValueType                             st_TermsPerSample;
+    bool                                      st_DiagonalOnly;
+    std::vector< NonZeroJacobianIndicesType > st_NonZeroJacobianIndices;
+    std::vector< double >                     st_Terms;
+    std::vector< unsigned char >              st_Valid;
+    HessianType *                             st_Hessian;
+    DerivativeType *                          st_Diagonal;
+  };
+
+  /** Range function evaluating the terms of the samples [begin, end) of a chunk. */
+  static void EvaluateSelfHessianTermsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Range function adding the terms of a chunk to the row blocks [begin, end). */
+  static void AddSelfHessianTermsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -475,6 +826,34 @@ protected:
    * method is called by Initialize. */
   virtual void CheckForBSplineInterpolator( void );
 
+  /** Check if the direction cosines of the moving image rotate; this method
+   * is called by Initialize.
+   */
+  virtual void CheckForDiagonalMovingImageDirection( void );
+
+  /** Convert a mapped point to a continuous index of the moving image, like
+   * the interpolator does, but with a per-axis scale and offset if the
+   * direction cosines of the moving image do not rotate.
+   */
+  void ConvertMovingPointToContinuousIndex(
+    const MovingImagePointType & mappedPoint,
+    MovingImageContinuousIndexType & cindex ) const;
+
+  /** Compute the packed moving image values and gradients, if
+   * UsePrecomputedMovingImageGradient is on; this method is called by
+   * Initialize, after CheckForBSplineInterpolator.
+   */
+  virtual void ComputePackedMovingImage( void );
+
+  /** Linearly interpolate the value and gradient from the packed moving image.
+   * The continuous index is assumed to lie inside the buffer; beyond the
+   * centre of the edge pixels the values are extrapolated as constant.
+   */
+  void EvaluatePackedMovingImage(
+    const MovingImageContinuousIndexType & cindex,
+    RealType & movingImageValue,
+    MovingImageDerivativeType & gradient ) const;
+
   /** Compute the image value (and possibly derivative) at a transformed point.
    * Checks if the point lies within the moving image buffer (bool return).
    * If no gradient is wanted, set the gradient argument to 0.
@@ -488,6 +867,23 @@ protected:
     RealType & movingImageValue,
     MovingImageDerivativeType * gradient ) const;
 
+  /** Compute the image values and derivatives at a batch of transformed points.
+   * Only the points for which sampleOk is true are evaluated; on return sampleOk
+   * is false for the points outside the moving image buffer. The results are
+   * identical to calling EvaluateMovingImageValueAndDerivative() per point, but
+   * with an AdvancedLinearInterpolateImageFunction the batch interface of the
+   * interpolator is used, unless the gradient is precomputed.
+   */
+  void EvaluateMovingImageValuesAndDerivatives(
+    const unsigned int numberOfPoints,
+    const MovingImagePointType * mappedPoints,
+    bool * sampleOk,
+    RealType * movingImageValues,
+    MovingImageDerivativeType * gradients ) const;
+
+  /** Multiply the moving image gradient with the MovingImageDerivativeScales, if used. */
+  void ApplyMovingImageDerivativeScales( MovingImageDerivativeType & gradient ) const;
+
   /** Computes the inner product of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
    * to have the right size (same length as Jacobian's number of columns).
@@ -497,6 +893,10 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian ) const;
 
+  /** Computes the packed moving image pixels of the lines [begin, end). */
+  static void ComputePackedMovingImageRange( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
   /** Methods to support transforms with sparse Jacobians, like the BSplineTransform **********/
 
   /** Check if the transform is an AdvancedTransform. Called by Initialize.
@@ -508,6 +908,27 @@ protected:
   /** Check if the transform is a B-spline. Called by Initialize. */
   virtual void CheckForBSplineTransform( void ) const;
 
+  /** Tell a B-spline transform that it is evaluated at the voxels of the
+   * fixed image, so that it can take the weights from its periodic weight
+   * tables. Called by Initialize().
+   */
+  virtual void InitializeTransformSampleGrid( void );
+
+  /** Compute the bounding box of the moving image bounds check, from the
+   * moving image buffer and the moving image mask. Called by Initialize().
+   */
+  virtual void InitializeMovingImageBoundsCheck( void );
+
+  /** Compute the bound on the displacement of the B-spline transform from its
+   * current parameters. Called by SetTransformParameters().
+   */
+  virtual void UpdateMovingImageBoundsCheck( void ) const;
+
+  /** Returns false if the fixed image point is certainly mapped outside the
+   * bounding box of the moving image bounds check.
+   */
+  bool IsInsideMovingImageBounds( const FixedImagePointType & fixedImagePoint ) const;
+
   /** Transform a point from FixedImage domain to MovingImage domain.
    * This function also checks if mapped point is within support region of
    * the transform. It returns true if so, and false otherwise.
@@ -516,6 +937,149 @@ protected:
     const FixedImagePointType & fixedImagePoint,
     MovingImagePointType & mappedPoint ) const;
 
+  /** Transform a point from FixedImage domain to MovingImage domain, and cache
+   * the per-sample data of the transform (e.g. the B-spline weights) for a
+   * subsequent call to EvaluateJacobianWithImageGradientProductUsingCache()
+   * of the advanced transform at the same fixed image point.
+   */
+  typedef typename AdvancedTransformType::TransformPointCacheType TransformPointCacheType;
+  virtual bool TransformPoint(
+    const FixedImagePointType & fixedImagePoint,
+    MovingImagePointType & mappedPoint,
+    TransformPointCacheType & cache ) const;
+
+  /** Methods and variables for implicit sampling. ***************/
+
+  /** Returns whether the metric can generate the samples on the fly. The
+   * default is false: the sampler output is used. */
+  virtual bool GetSupportsImplicitSampling( void ) const
+  {
+    return false;
+  }
+
+
+  /** The number of sample slots to visit: the grid points of the implicit
+   * grid, or the size of the sampler output. */
+  SizeValueType GetNumberOfFixedImageSampleSlots( void ) const
+  {
+    return this->m_UseImplicitSampleGrid
+           ? this->m_ImplicitSampleGrid.GetNumberOfGridPoints()
+           : this->GetImageSampler()->GetOutput()->Size();
+  }
+
+
+  /** The number of samples, for CheckNumberOfSamples(). */
+  SizeValueType GetNumberOfFixedImageSamples( void ) const
+  {
+    return this->m_UseImplicitSampleGrid
+           ? this->m_ImplicitSampleGrid.GetNumberOfSamples()
+           : this->GetImageSampler()->GetOutput()->Size();
+  }
+
+
+  /** Get the sample in slot i. Returns false if the slot is a grid point
+   * outside the fixed image mask. The sampler output is passed in, to avoid
+   * getting it for every sample. */
+  bool GetFixedImageSample( const ImageSampleContainerType * sampleContainer,
+    SizeValueType i, ImageSampleType & sample ) const
+  {
+    if( this->m_UseImplicitSampleGrid )
+    {
+      return this->m_ImplicitSampleGrid.GetSample( i, sample );
+    }
+    sample = sampleContainer->ElementAt( i );
+    return true;
+  }
+
+
+  /** Methods for the distributed computation. ***************/
+
+  /** Check if the samples are divided over more than one rank. */
+  bool GetDistributedComputationIsActive( void ) const
+  {
+    return this->m_UseDistributedComputation
+           && DistributedComputation::GetInstance()->GetIsDistributed();
+  }
+
+
+  /** Get the sample slots [begin, end) of a thread. The slots are divided
+   * over the ranks first, if the computation is distributed, and the part
+   * of this rank is divided over the m_NumberOfThreads threads.
+   */
+  void GetThreadSampleRange( ThreadIdType threadId,
+    SizeValueType & begin, SizeValueType & end ) const;
+
+  /** Add the value and the number of counted samples of this rank to those
+   * of the other ranks. Does nothing if the computation is not distributed.
+   * Call it from a single thread, on all ranks.
+   */
+  void DistributedSumOfValue( MeasureType & value,
+    SizeValueType & numberOfPixelsCounted ) const;
+
+  /** Add the derivative of this rank to those of the other ranks. */
+  void DistributedSumOfDerivative( DerivativeType & derivative ) const;
+
+  /** Check that all ranks use the same samples, by comparing the number of
+   * sample slots and a checksum of the sample coordinates with those of
+   * rank 0. Throws an exception on all ranks if one of them differs. Called
+   * once per resolution, at the first evaluation after Initialize().
+   */
+  void CheckDistributedSamples( void ) const;
+
+  /** Whether the samples of the current iteration are implicit, and the grid. */
+  mutable bool                   m_UseImplicitSampleGrid;
+  mutable ImplicitSampleGridType m_ImplicitSampleGrid;
+
+  /** Methods and variables for the fixed sample feature cache. ***************/
+
+  /** (Re)compute the fixed sample features if they are used and the samples
+   * have changed. Call it after updating the image sampler, from a single thread.
+   */
+  virtual void UpdateFixedSampleFeatureCache( void ) const;
+
+  /** Static range function that computes the features of a range of samples. */
+  static void ComputeFixedSampleFeaturesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Returns whether the features of the current samples have been stored. */
+  bool GetFixedSampleFeatureCacheIsValid( void ) const
+  {
+    return this->m_FixedSampleFeatureCacheIsValid;
+  }
+
+
+  /** Get the metric that owns the stored features: the source, if set. */
+  const Self * GetFixedSampleFeatureCacheOwner( void ) const
+  {
+    return this->m_FixedSampleFeatureCacheSource != 0
+           ? this->m_FixedSampleFeatureCacheSource : this;
+  }
+
+
+  /** Get the stored features of sample i. */
+  const double * GetFixedSampleFeatures( SizeValueType i ) const
+  {
+    const Self * owner = this->GetFixedSampleFeatureCacheOwner();
+    return &( owner->m_FixedSampleFeatures[ i * owner->m_NumberOfFixedSampleFeatures ] );
+  }
+
+
+  /** Get the stored nonzero Jacobian indices of sample i. */
+  NonZeroJacobianIndicesType & GetFixedSampleNonZeroJacobianIndices( SizeValueType i ) const
+  {
+    return this->GetFixedSampleFeatureCacheOwner()->m_FixedSampleNonZeroJacobianIndices[ i ];
+  }
+
+
+  bool                                             m_UseFixedSampleFeatureCache;
+  mutable bool                                     m_FixedSampleFeatureCacheIsValid;
+  mutable const ImageSampleContainerType *         m_FixedSampleFeatureCacheContainer;
+  mutable ModifiedTimeType                         m_FixedSampleFeatureCacheMTime;
+  mutable unsigned int                             m_NumberOfFixedSampleFeatures;
+  mutable std::vector< double >                    m_FixedSampleFeatures;
+  mutable std::vector< NonZeroJacobianIndicesType > m_FixedSampleNonZeroJacobianIndices;
+  const Self *                                     m_FixedSampleFeatureCacheSource;
+
   /** This function returns a reference to the transform Jacobians.
    * This is either a reference to the full TransformJacobian or
    * a reference to a sparse Jacobians.
@@ -539,6 +1103,11 @@ protected:
     const FixedImageType * image,
     const FixedImageRegionType & region );
 
+  /** Sets the m_Fixed[True]{Max,Min}[Limit] from the true extrema. */
+  void SetFixedImageExtrema(
+    const FixedImagePixelType trueMin,
+    const FixedImagePixelType trueMax );
+
   /** Compute the extrema of the moving image over a region
    * Initializes the m_Moving[True]{Max,Min}[Limit]
    * This method is called by InitializeLimiters() and uses the MovingLimitRangeRatio; */
@@ -570,6 +1139,37 @@ private:
   bool   m_UseMovingImageDerivativeScales;
   bool   m_ScaleGradientWithRespectToMovingImageOrientation;
 
+  /** Variables for the deterministic reduction. The number of threads that
+   * was set is kept, since m_NumberOfThreads holds the number of blocks.
+   */
+  bool         m_UseDeterministicReduction;
+  ThreadIdType m_NumberOfDeterministicBlocks;
+  ThreadIdType m_RequestedNumberOfThreads;
+
+  /** Variables for the distributed computation. */
+  bool         m_UseDistributedComputation;
+  mutable bool m_DistributedSamplesChecked;
+
+  /** Variables for the moving image bounds check. The bounding box of the
+   * moving image is expanded by the bound on the B-spline displacement.
+   */
+  bool                                  m_UseMovingImageBoundsCheck;
+  bool                                  m_MovingImageBoundsCheckIsActive;
+  const AdvancedTransformType *         m_MovingImageBoundsCheckTransform;
+  const AdvancedTransformType *         m_MovingImageBoundsCheckInitialTransform;
+  MovingImagePointType                  m_MovingImageBoundsMinimum;
+  MovingImagePointType                  m_MovingImageBoundsMaximum;
+  mutable MovingImagePointType          m_ExpandedMovingImageBoundsMinimum;
+  mutable MovingImagePointType          m_ExpandedMovingImageBoundsMaximum;
+  mutable AtomicInt< OffsetValueType >  m_NumberOfBoundsCheckRejections;
+
+  /** Variables for the sparse derivative accumulation. */
+  bool                          m_UseSparseDerivativeAccumulation;
+  mutable bool                  m_SparseDerivativeAccumulationIsActive;
+  mutable DerivativeType        m_SparseDerivative;
+  mutable SimpleFastMutexLock * m_SparseDerivativeStripeLocks;
+  mutable SizeValueType         m_NumberOfSparseDerivativeStripes;
+
   MovingImageDerivativeScalesType m_MovingImageDerivativeScales;
 
 };
@@ -28,6 +28,10 @@
 #include <omp.h>
 #endif
 
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
 namespace itk
 {
 
@@ -51,15 +55,16 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_UseImageSampler             = false;
   this->m_RequiredRatioOfValidSamples = 0.25;
 
-  this->m_LinearInterpolator              = 0;
-  this->m_BSplineInterpolator             = 0;
-  this->m_BSplineInterpolatorFloat        = 0;
-  this->m_ReducedBSplineInterpolator      = 0;
-  this->m_InterpolatorIsLinear            = false;
-  this->m_InterpolatorIsBSpline           = false;
-  this->m_InterpolatorIsBSplineFloat      = false;
-  this->m_InterpolatorIsReducedBSpline    = false;
-  this->m_CentralDifferenceGradientFilter = 0;
+  this->m_LinearInterpolator                = 0;
+  this->m_BSplineInterpolator               = 0;
+  this->m_BSplineInterpolatorFloat          = 0;
+  this->m_ReducedBSplineInterpolator        = 0;
+  this->m_InterpolatorIsLinear              = false;
+  this->m_InterpolatorIsBSpline             = false;
+  this->m_InterpolatorIsBSplineFloat        = false;
+  this->m_InterpolatorIsReducedBSpline      = false;
+  this->m_BindBSplineInterpolatorStatically = false;
+  this->m_CentralDifferenceGradientFilter   = 0;
 
   this->m_AdvancedTransform                                = 0;
   this->m_TransformIsAdvanced                              = false;
@@ -107,6 +112,48 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValueAndDerivativePerThreadVariables     = NULL;
   this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
 
+  /** Implicit sampling. */
+  this->m_UseImplicitSampleGrid = false;
+
+  /** Fixed sample feature cache. */
+  this->m_UseFixedSampleFeatureCache       = false;
+  this->m_FixedSampleFeatureCacheIsValid   = false;
+  this->m_FixedSampleFeatureCacheContainer = 0;
+  this->m_FixedSampleFeatureCacheMTime     = 0;
+  this->m_NumberOfFixedSampleFeatures      = 0;
+  this->m_FixedSampleFeatureCacheSource    = 0;
+
+  /** Precomputed moving image gradient. */
+  this->m_UsePrecomputedMovingImageGradient = false;
+  this->m_UsePackedMovingImageValue         = false;
+
+  /** Per-axis point to index conversion. */
+  this->m_MovingImageDirectionIsDiagonal = false;
+
+  /** Sparse derivative accumulation. */
+  this->m_SparseDerivativeAccumulationIsSupported = false;
+  this->m_NumberOfSparseDerivativeComponents      = 1;
+  this->m_UseSparseDerivativeAccumulation         = false;
+  this->m_SparseDerivativeAccumulationIsActive    = false;
+  this->m_SparseDerivativeStripeLocks             = NULL;
+  this->m_NumberOfSparseDerivativeStripes         = 0;
+
+  /** Deterministic reduction. */
+  this->m_UseDeterministicReduction   = false;
+  this->m_NumberOfDeterministicBlocks = 16;
+  this->m_RequestedNumberOfThreads    = this->m_NumberOfThreads;
+
+  /** Distributed computation. */
+  this->m_UseDistributedComputation = false;
+  this->m_DistributedSamplesChecked = false;
+
+  /** Moving image bounds check. */
+  this->m_UseMovingImageBoundsCheck              = false;
+  this->m_MovingImageBoundsCheckIsActive         = false;
+  this->m_MovingImageBoundsCheckTransform        = 0;
+  this->m_MovingImageBoundsCheckInitialTransform = 0;
+  this->m_NumberOfBoundsCheckRejections          = 0;
+
 } // end Constructor
 
 
@@ -120,6 +167,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 {
   delete[] this->m_GetValuePerThreadVariables;
   delete[] this->m_GetValueAndDerivativePerThreadVariables;
+  delete[] this->m_SparseDerivativeStripeLocks;
 } // end Destructor
 
 
@@ -132,15 +180,59 @@ void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::SetNumberOfThreads( ThreadIdType numberOfThreads )
 {
-  Superclass::SetNumberOfThreads( numberOfThreads );
+  /** In deterministic mode the work is divided in a fixed number of blocks,
+   * which the metrics see as their threads.
+   */
+  this->m_RequestedNumberOfThreads = numberOfThreads;
+  Superclass::SetNumberOfThreads( this->m_UseDeterministicReduction
+    ? this->m_NumberOfDeterministicBlocks : numberOfThreads );
 
 #ifdef ELASTIX_USE_OPENMP
-  const int nthreads = static_cast< int >( this->m_NumberOfThreads );
+  const int nthreads = static_cast< int >( numberOfThreads );
   omp_set_num_threads( nthreads );
 #endif
 } // end SetNumberOfThreads()
 
 
+/**
+ * ********************* SetUseDeterministicReduction ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetUseDeterministicReduction( bool _arg )
+{
+  if( this->m_UseDeterministicReduction != _arg )
+  {
+    this->m_UseDeterministicReduction = _arg;
+    this->SetNumberOfThreads( this->m_RequestedNumberOfThreads );
+    this->Modified();
+  }
+
+} // end SetUseDeterministicReduction()
+
+
+/**
+ * ********************* SetNumberOfDeterministicBlocks ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetNumberOfDeterministicBlocks( ThreadIdType _arg )
+{
+  _arg = std::max( _arg, NumericTraits< ThreadIdType >::OneValue() );
+  if( this->m_NumberOfDeterministicBlocks != _arg )
+  {
+    this->m_NumberOfDeterministicBlocks = _arg;
+    this->SetNumberOfThreads( this->m_RequestedNumberOfThreads );
+    this->Modified();
+  }
+
+} // end SetNumberOfDeterministicBlocks()
+
+
 /**
  * ********************* Initialize ****************************
  */
@@ -162,18 +254,39 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Check if the interpolator is a B-spline interpolator. */
   this->CheckForBSplineInterpolator();
 
+  /** Check if the moving image direction cosines rotate. */
+  this->CheckForDiagonalMovingImageDirection();
+
+  /** Precompute the moving image gradient, if requested. */
+  this->ComputePackedMovingImage();
+
   /** Check if the transform is an advanced transform. */
   this->CheckForAdvancedTransform();
 
   /** Check if the transform is a B-spline transform. */
   this->CheckForBSplineTransform();
 
+  /** Give a B-spline transform the grid of the fixed image voxels. */
+  this->InitializeTransformSampleGrid();
+
+  /** Compute the bounding box of the moving image bounds check. */
+  this->InitializeMovingImageBoundsCheck();
+
+  /** The grid of the transform may have changed, so the stored features are invalid. */
+  this->m_FixedSampleFeatureCacheIsValid   = false;
+  this->m_FixedSampleFeatureCacheContainer = 0;
+  this->m_FixedSampleFeatures.clear();
+  this->m_FixedSampleNonZeroJacobianIndices.clear();
+
   /** Initialize some threading related parameters. */
   if( this->m_UseMultiThread )
   {
     this->InitializeThreadingParameters();
   }
 
+  /** The samples of the new resolution are checked at the first evaluation. */
+  this->m_DistributedSamplesChecked = false;
+
 } // end Initialize()
 
 
@@ -212,21 +325,363 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     this->m_GetValueAndDerivativePerThreadVariablesSize = this->m_NumberOfThreads;
   }
 
-  /** Some initialization. */
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  /** The sparse accumulation only pays off when the transform Jacobian is sparse. */
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  this->m_SparseDerivativeAccumulationIsActive
+    = this->m_UseSparseDerivativeAccumulation
+    && !this->m_UseDeterministicReduction
+    && this->m_SparseDerivativeAccumulationIsSupported
+    && this->m_TransformIsAdvanced
+    && this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() < numberOfParameters;
+
+  /** Some initialization. When multi-threaded, every thread initializes its
+   * own variables, so that on a NUMA machine the pages of its derivative
+   * buffer are first touched, and thus placed, on the node it runs on.
+   */
+  if( this->m_UseMultiThread )
   {
-    this->m_GetValuePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
-    this->m_GetValuePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, this->InitializeThreadingParametersThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  }
+  else
+  {
+    for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+    {
+      this->InitializePerThreadVariables( i );
+    }
+  }
 
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( this->GetNumberOfParameters() );
-    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  /** Allocate the shared derivative and one lock per stripe of it. */
+  const SizeValueType sharedDerivativeSize
+    = numberOfParameters * this->m_NumberOfSparseDerivativeComponents;
+  const SizeValueType numberOfStripes = this->m_SparseDerivativeAccumulationIsActive
+    ? ( sharedDerivativeSize + 1023 ) / 1024 : 0;
+  if( this->m_NumberOfSparseDerivativeStripes != numberOfStripes )
+  {
+    delete[] this->m_SparseDerivativeStripeLocks;
+    this->m_SparseDerivativeStripeLocks = numberOfStripes > 0
+      ? new SimpleFastMutexLock[ numberOfStripes ] : NULL;
+    this->m_NumberOfSparseDerivativeStripes = numberOfStripes;
   }
+  this->m_SparseDerivative.SetSize( numberOfStripes > 0 ? sharedDerivativeSize : 0 );
+  this->m_SparseDerivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ********************* InitializePerThreadVariables ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializePerThreadVariables( ThreadIdType threadId ) const
+{
+  this->m_GetValuePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
+  this->m_GetValuePerThreadVariables[ threadId ].st_Value                 = NumericTraits< MeasureType >::Zero;
+
+  GetValueAndDerivativePerThreadStruct & variables = this->m_GetValueAndDerivativePerThreadVariables[ threadId ];
+  variables.st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
+  variables.st_Value                 = NumericTraits< MeasureType >::Zero;
+  variables.st_SparseDerivative.clear();
+  if( this->m_SparseDerivativeAccumulationIsActive )
+  {
+    variables.st_Derivative.SetSize( 0 );
+    variables.st_DerivativeBuffer.Release();
+  }
+  else
+  {
+    /** The derivative points into an aligned block of the arena, which is
+     * kept over the resolutions and reused by the next registration.
+     */
+    const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+    DerivativeValueType * buffer = static_cast< DerivativeValueType * >(
+      variables.st_DerivativeBuffer.Resize( numberOfParameters * sizeof( DerivativeValueType ) ) );
+    if( variables.st_Derivative.data_block() != buffer
+      || variables.st_Derivative.Size() != numberOfParameters )
+    {
+      variables.st_Derivative.SetData( buffer, numberOfParameters, false );
+    }
+    variables.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  }
+
+  /** Size the scratch buffers of the per-sample computations, so that the
+   * threads do not allocate memory per sample or per iteration. The transform
+   * Jacobian buffer gets its size in its first use, and keeps it.
+   */
+  const NumberOfParametersType nnzji = this->m_TransformIsAdvanced
+    ? this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices()
+    : this->GetNumberOfParameters();
+  variables.st_NonZeroJacobianIndices.resize( nnzji );
+  variables.st_ImageJacobian.SetSize( nnzji );
+
+} // end InitializePerThreadVariables()
+
+
+/**
+ * **************** InitializeThreadingParametersThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParametersThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->InitializePerThreadVariables( infoStruct->ThreadID );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end InitializeThreadingParametersThreaderCallback()
+
+
+/**
+ * ********************* GetWorkMemorySize ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetWorkMemorySize( void ) const
+{
+  SizeValueType bytes
+    = this->m_GetValuePerThreadVariablesSize * sizeof( AlignedGetValuePerThreadStruct )
+    + this->m_GetValueAndDerivativePerThreadVariablesSize
+    * sizeof( AlignedGetValueAndDerivativePerThreadStruct );
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    bytes += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Size()
+      * sizeof( DerivativeValueType );
+    bytes += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_SparseDerivative.capacity()
+      * sizeof( std::pair< unsigned long, DerivativeValueType > );
+  }
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_PackedMovingImage.GetPointer() );
+
+  return bytes;
+
+} // end GetWorkMemorySize()
+
+
+/**
+ * ********************* AddSparseDerivativeContributions ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AddSparseDerivativeContributions( ThreadIdType threadId,
+  const NonZeroJacobianIndicesType & nzji,
+  const DerivativeType & imageJacobian,
+  const DerivativeValueType factor ) const
+{
+  std::vector< std::pair< unsigned long, DerivativeValueType > > & buffer
+    = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_SparseDerivative;
+  for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+  {
+    buffer.push_back( std::make_pair( nzji[ i ], factor * imageJacobian[ i ] ) );
+  }
+
+  /** Keep the buffer small enough to stay in cache. */
+  if( buffer.size() >= 16384 )
+  {
+    this->FlushSparseDerivativeContributions( threadId );
+  }
+
+} // end AddSparseDerivativeContributions()
+
+
+/**
+ * ********************* AddSparseDerivativeContributions ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AddSparseDerivativeContributions( ThreadIdType threadId,
+  const NonZeroJacobianIndicesType & nzji,
+  const DerivativeType & imageJacobian,
+  const DerivativeValueType * factors ) const
+{
+  std::vector< std::pair< unsigned long, DerivativeValueType > > & buffer
+    = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_SparseDerivative;
+  const unsigned int numberOfComponents = this->m_NumberOfSparseDerivativeComponents;
+  for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+  {
+    const unsigned long index = nzji[ i ] * numberOfComponents;
+    for( unsigned int c = 0; c < numberOfComponents; ++c )
+    {
+      buffer.push_back( std::make_pair( index + c, factors[ c ] * imageJacobian[ i ] ) );
+    }
+  }
+
+  /** Keep the buffer small enough to stay in cache. */
+  if( buffer.size() >= 16384 )
+  {
+    this->FlushSparseDerivativeContributions( threadId );
+  }
+
+} // end AddSparseDerivativeContributions()
+
+
+/**
+ * ********************* FlushSparseDerivativeContributions ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::FlushSparseDerivativeContributions( ThreadIdType threadId ) const
+{
+  std::vector< std::pair< unsigned long, DerivativeValueType > > & buffer
+    = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_SparseDerivative;
+  if( buffer.empty() ) { return; }
+
+  /** Sort on parameter index, so that each stripe is visited once. */
+  std::sort( buffer.begin(), buffer.end() );
+
+  DerivativeValueType * derivative = this->m_SparseDerivative.data_block();
+  const std::size_t     size       = buffer.size();
+  std::size_t           i          = 0;
+  while( i < size )
+  {
+    const unsigned long stripe = buffer[ i ].first / 1024;
+    this->m_SparseDerivativeStripeLocks[ stripe ].Lock();
+    for( ; i < size && buffer[ i ].first / 1024 == stripe; ++i )
+    {
+      derivative[ buffer[ i ].first ] += buffer[ i ].second;
+    }
+    this->m_SparseDerivativeStripeLocks[ stripe ].Unlock();
+  }
+
+  buffer.clear();
+
+} // end FlushSparseDerivativeContributions()
+
+
+/**
+ * ********************* AccumulateSparseDerivatives ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateSparseDerivatives( DerivativeType & derivative,
+  const DerivativeValueType normalization ) const
+{
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = normalization;
+
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_SparseDerivative.GetSize(), 0, AccumulateSparseDerivativesRangeFunction,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+
+} // end AccumulateSparseDerivatives()
+
+
+/**
+ * ********************* AccumulateSparseDerivativesRangeFunction ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateSparseDerivativesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MultiThreaderParameterType & pass
+    = *static_cast< const MultiThreaderParameterType * >( userData );
+  DerivativeValueType *     sharedDerivative = pass.st_Metric->m_SparseDerivative.data_block();
+  DerivativeValueType *     derivative       = pass.st_DerivativePointer;
+  const DerivativeValueType normalization    = pass.st_NormalizationFactor;
+  const DerivativeValueType zero             = NumericTraits< DerivativeValueType >::Zero;
+
+  /** Copy and reset the shared derivative for the next iteration. */
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    derivative[ j ]       = sharedDerivative[ j ] * normalization;
+    sharedDerivative[ j ] = zero;
+  }
+
+} // end AccumulateSparseDerivativesRangeFunction()
+
+
+/**
+ * ****************** GetNumberOfParallelForBlocks ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ThreadIdType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfParallelForBlocks( void ) const
+{
+  return this->m_UseDeterministicReduction
+         ? this->m_NumberOfThreads
+         : PersistentThreadPool::GetInstance()->GetNumberOfThreads();
+
+} // end GetNumberOfParallelForBlocks()
+
+
+/**
+ * ****************** ParallelForBlocks ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ParallelForBlocks( SizeValueType numberOfItems,
+  PersistentThreadPool::RangeFunctionType function, void * userData ) const
+{
+  if( !this->m_UseDeterministicReduction )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor( numberOfItems, 0, function, userData );
+    return;
+  }
+
+  /** Distribute the blocks, not the items, so that every block is processed
+   * as a whole, by whichever thread claims it.
+   */
+  ParallelForBlocksParameterType pass;
+  pass.st_Function       = function;
+  pass.st_UserData       = userData;
+  pass.st_NumberOfItems  = numberOfItems;
+  pass.st_NumberOfBlocks = this->m_NumberOfThreads;
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    pass.st_NumberOfBlocks, 1, ParallelForBlocksRangeFunction, &pass );
+
+} // end ParallelForBlocks()
+
+
+/**
+ * ****************** ParallelForBlocksRangeFunction ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ParallelForBlocksRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const ParallelForBlocksParameterType & pass
+    = *static_cast< const ParallelForBlocksParameterType * >( userData );
+
+  for( SizeValueType block = begin; block < end; ++block )
+  {
+    const SizeValueType blockBegin = pass.st_NumberOfItems * block / pass.st_NumberOfBlocks;
+    const SizeValueType blockEnd   = pass.st_NumberOfItems * ( block + 1 ) / pass.st_NumberOfBlocks;
+    if( blockEnd > blockBegin )
+    {
+      pass.st_Function( pass.st_UserData, static_cast< ThreadIdType >( block ), blockBegin, blockEnd );
+    }
+  }
+
+} // end ParallelForBlocksRangeFunction()
+
+
 /**
  * ****************** ComputeFixedImageExtrema ***************************
  */
@@ -245,6 +700,36 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   FixedImagePixelType trueMinTemp = NumericTraits< FixedImagePixelType >::max();
   FixedImagePixelType trueMaxTemp = NumericTraits< FixedImagePixelType >::NonpositiveMin();
 
+  /** Take the extrema from the fixed image preprocessing cache, if they were
+   * computed before for the same pixels, region and mask. The pixel container
+   * identifies the pixels, since the fixed image pyramids of consecutive
+   * registrations share it. Masks are only supported if they are images.
+   */
+  typedef ImageMaskSpatialObject2< FixedImageDimension > ImageMaskType;
+  FixedImagePreprocessingCache::Pointer cache = FixedImagePreprocessingCache::GetInstance();
+  const ImageMaskType * imageMask = dynamic_cast< const ImageMaskType * >( this->m_FixedImageMask.GetPointer() );
+  const bool useCache = cache->GetEnabled() && ( this->m_FixedImageMask.IsNull()
+    || ( imageMask != 0 && imageMask->GetImage() != 0 ) );
+  std::ostringstream cacheKey( "" );
+  if( useCache )
+  {
+    cacheKey << "FixedImageExtrema region " << region.GetIndex() << region.GetSize();
+    if( imageMask != 0 )
+    {
+      cacheKey << " mask " << imageMask->GetImage()->GetPixelContainer();
+    }
+    Object::Pointer cachedObject = cache->Find( image->GetPixelContainer(), cacheKey.str() );
+    const FixedImagePreprocessingValues * cached
+      = dynamic_cast< const FixedImagePreprocessingValues * >( cachedObject.GetPointer() );
+    if( cached != 0 && cached->Values.size() == 2 )
+    {
+      this->SetFixedImageExtrema(
+        static_cast< FixedImagePixelType >( cached->Values[ 0 ] ),
+        static_cast< FixedImagePixelType >( cached->Values[ 1 ] ) );
+      return;
+    }
+  }
+
   /** If no mask. */
   if( this->m_FixedImageMask.IsNull() )
   {
@@ -280,15 +765,44 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   }
 
   /** Update member variables. */
-  this->m_FixedImageTrueMin = trueMinTemp;
-  this->m_FixedImageTrueMax = trueMaxTemp;
+  this->SetFixedImageExtrema( trueMinTemp, trueMaxTemp );
+
+  /** Store the extrema, keeping the mask pixels alive with them. */
+  if( useCache )
+  {
+    FixedImagePreprocessingValues::Pointer values = FixedImagePreprocessingValues::New();
+    values->Values.push_back( static_cast< double >( trueMinTemp ) );
+    values->Values.push_back( static_cast< double >( trueMaxTemp ) );
+    if( imageMask != 0 )
+    {
+      values->AddDependency( imageMask->GetImage()->GetPixelContainer() );
+    }
+    cache->Store( image->GetPixelContainer(), cacheKey.str(), values );
+  }
+
+} // end ComputeFixedImageExtrema()
+
+
+/**
+ * ****************** SetFixedImageExtrema ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetFixedImageExtrema(
+  const FixedImagePixelType trueMin,
+  const FixedImagePixelType trueMax )
+{
+  this->m_FixedImageTrueMin = trueMin;
+  this->m_FixedImageTrueMax = trueMax;
 
   this->m_FixedImageMinLimit = static_cast< FixedImageLimiterOutputType >(
-    trueMinTemp - this->m_FixedLimitRangeRatio * ( trueMaxTemp - trueMinTemp ) );
+    trueMin - this->m_FixedLimitRangeRatio * ( trueMax - trueMin ) );
   this->m_FixedImageMaxLimit = static_cast< FixedImageLimiterOutputType >(
-    trueMaxTemp + this->m_FixedLimitRangeRatio * ( trueMaxTemp - trueMinTemp ) );
+    trueMax + this->m_FixedLimitRangeRatio * ( trueMax - trueMin ) );
 
-} // end ComputeFixedImageExtrema()
+} // end SetFixedImageExtrema()
 
 
 /**
@@ -466,6 +980,16 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     itkDebugMacro( "Interpolator is not B-spline" );
   }
 
+  /** In a specialized build its calls are bound statically, and may thus be
+   * inlined, see the ELASTIX_SPECIALIZED_BUILD CMake option. In elastix the
+   * interpolator is an elastix::BSplineInterpolator, a subclass that does not
+   * override EvaluateAtContinuousIndex() and
+   * EvaluateValueAndDerivativeAtContinuousIndex(), so that the statically
+   * bound calls give the same results. Subclasses that do override them must
+   * not be used with a specialized build.
+   */
+  this->m_BindBSplineInterpolatorStatically = this->m_InterpolatorIsBSpline;
+
   this->m_InterpolatorIsBSplineFloat = false;
   BSplineInterpolatorFloatType * testPtr2
     = dynamic_cast< BSplineInterpolatorFloatType * >( this->m_Interpolator.GetPointer() );
@@ -556,47 +1080,315 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ****************** CheckForAdvancedTransform **********************
+ * ****************** CheckForDiagonalMovingImageDirection **********************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
-::CheckForAdvancedTransform( void )
+::CheckForDiagonalMovingImageDirection( void )
 {
-  /** Check if the transform is of type AdvancedTransform. */
-  this->m_TransformIsAdvanced = false;
-  AdvancedTransformType * testPtr
-    = dynamic_cast< AdvancedTransformType * >(
-    this->m_Transform.GetPointer() );
-  if( !testPtr )
-  {
-    this->m_AdvancedTransform = 0;
-    itkDebugMacro( "Transform is not Advanced" );
-    itkExceptionMacro( << "The AdvancedImageToImageMetric requires an AdvancedTransform" );
-  }
-  else
+  /** The interpolator converts points with the geometry of its input image. */
+  this->m_MovingImageDirectionIsDiagonal = false;
+  const MovingImageType * movingImage = this->m_Interpolator.IsNotNull()
+    ? this->m_Interpolator->GetInputImage() : 0;
+  if( !movingImage ) { return; }
+
+  const typename MovingImageType::DirectionType & pointToIndex
+    = movingImage->GetPhysicalPointToIndex();
+  this->m_MovingImageDirectionIsDiagonal = true;
+  for( unsigned int i = 0; i < MovingImageDimension; ++i )
   {
-    this->m_TransformIsAdvanced = true;
-    this->m_AdvancedTransform   = testPtr;
-    itkDebugMacro( "Transform is Advanced" );
+    for( unsigned int j = 0; j < MovingImageDimension; ++j )
+    {
+      if( i != j && pointToIndex[ i ][ j ] != 0.0 )
+      {
+        this->m_MovingImageDirectionIsDiagonal = false;
+      }
+    }
+    this->m_MovingImagePointToIndexDiagonal[ i ] = pointToIndex[ i ][ i ];
   }
+  this->m_MovingImageOrigin = movingImage->GetOrigin();
 
-} // end CheckForAdvancedTransform()
+} // end CheckForDiagonalMovingImageDirection()
 
 
 /**
- * ****************** CheckForBSplineTransform **********************
+ * ****************** ConvertMovingPointToContinuousIndex **********************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
-::CheckForBSplineTransform( void ) const
+::ConvertMovingPointToContinuousIndex(
+  const MovingImagePointType & mappedPoint,
+  MovingImageContinuousIndexType & cindex ) const
 {
-  /** Check if this transform is a combo transform. */
-  CombinationTransformType * testPtr_combo
-    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  /** The zero terms of the matrix product are skipped, which gives the same
+   * continuous index as the image itself computes.
+   */
+  if( this->m_MovingImageDirectionIsDiagonal )
+  {
+    for( unsigned int i = 0; i < MovingImageDimension; ++i )
+    {
+      cindex[ i ] = this->m_MovingImagePointToIndexDiagonal[ i ]
+        * ( mappedPoint[ i ] - this->m_MovingImageOrigin[ i ] );
+    }
+  }
+  else
+  {
+    this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
+  }
+
+} // end ConvertMovingPointToContinuousIndex()
+
+
+/**
+ * ****************** ComputePackedMovingImage **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePackedMovingImage( void )
+{
+  this->m_PackedMovingImage         = 0;
+  this->m_UsePackedMovingImageValue = false;
+
+  /** The B-spline interpolators compute exact derivatives. */
+  if( !this->m_UsePrecomputedMovingImageGradient
+    || this->m_InterpolatorIsBSpline || this->m_InterpolatorIsBSplineFloat
+    || this->m_InterpolatorIsReducedBSpline )
+  {
+    return;
+  }
+
+  /** Allocate an image on the buffered region of the moving image. */
+  const MovingImageType * movingImage = this->m_MovingImage;
+  this->m_PackedMovingImage = PackedMovingImageType::New();
+  this->m_PackedMovingImage->CopyInformation( movingImage );
+  this->m_PackedMovingImage->SetRegions( movingImage->GetBufferedRegion() );
+  this->m_PackedMovingImage->Allocate();
+
+  /** The interpolated value equals that of the interpolator, up to rounding,
+   * only for linear interpolation of pixels that a float represents exactly.
+   */
+  this->m_UsePackedMovingImageValue = this->m_InterpolatorIsLinear
+    && std::numeric_limits< MovingImagePixelType >::digits
+    <= std::numeric_limits< float >::digits;
+
+  /** Compute the pixels, line by line. */
+  const SizeValueType lineLength    = movingImage->GetBufferedRegion().GetSize( 0 );
+  const SizeValueType numberOfLines = lineLength > 0
+    ? movingImage->GetBufferedRegion().GetNumberOfPixels() / lineLength : 0;
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    numberOfLines, 0, ComputePackedMovingImageRange, this );
+
+  /** The central difference gradient image is not needed anymore. */
+  if( !this->GetComputeGradient() )
+  {
+    this->m_CentralDifferenceGradientFilter = 0;
+    this->m_GradientImage                   = 0;
+  }
+
+} // end ComputePackedMovingImage()
+
+
+/**
+ * ****************** ComputePackedMovingImageRange **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePackedMovingImageRange( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  typedef typename MovingImageType::RegionType    RegionType;
+  typedef typename MovingImageType::SpacingType   SpacingType;
+  typedef typename MovingImageType::DirectionType DirectionType;
+
+  const Self *                 self        = static_cast< const Self * >( userData );
+  const MovingImageType *      movingImage = self->m_MovingImage;
+  const RegionType &           region      = movingImage->GetBufferedRegion();
+  const SpacingType &          spacing     = movingImage->GetSpacing();
+  const DirectionType &        direction   = movingImage->GetDirection();
+  const OffsetValueType *      offsetTable = movingImage->GetOffsetTable();
+  const MovingImagePixelType * in          = movingImage->GetBufferPointer();
+  PackedMovingImagePixelType * out         = self->m_PackedMovingImage->GetBufferPointer();
+  const SizeValueType          lineLength  = region.GetSize( 0 );
+
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    /** The position of the first pixel of the line, relative to the region. */
+    OffsetValueType position[ MovingImageDimension ];
+    SizeValueType   remainder = line;
+    position[ 0 ] = 0;
+    for( unsigned int d = 1; d < MovingImageDimension; ++d )
+    {
+      position[ d ] = static_cast< OffsetValueType >( remainder % region.GetSize( d ) );
+      remainder    /= region.GetSize( d );
+    }
+
+    const OffsetValueType lineOffset = static_cast< OffsetValueType >( line * lineLength );
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      position[ 0 ] = static_cast< OffsetValueType >( i );
+      const OffsetValueType offset = lineOffset + position[ 0 ];
+
+      /** Central differences, with a zero flux Neumann boundary condition. */
+      MovingImageDerivativeType localGradient;
+      for( unsigned int d = 0; d < MovingImageDimension; ++d )
+      {
+        const OffsetValueType last     = static_cast< OffsetValueType >( region.GetSize( d ) ) - 1;
+        const OffsetValueType previous = position[ d ] > 0 ? offsetTable[ d ] : 0;
+        const OffsetValueType next     = position[ d ] < last ? offsetTable[ d ] : 0;
+        const double          difference
+          = static_cast< double >( in[ offset + next ] )
+          - static_cast< double >( in[ offset - previous ] );
+        localGradient[ d ] = difference / ( 2.0 * spacing[ d ] );
+      }
+
+      /** Take the direction cosines into account, and store. */
+      PackedMovingImagePixelType & pixel = out[ offset ];
+      pixel[ 0 ] = static_cast< float >( in[ offset ] );
+      for( unsigned int row = 0; row < MovingImageDimension; ++row )
+      {
+        double sum = 0.0;
+        for( unsigned int column = 0; column < MovingImageDimension; ++column )
+        {
+          sum += direction[ row ][ column ] * localGradient[ column ];
+        }
+        pixel[ row + 1 ] = static_cast< float >( sum );
+      }
+    }
+  }
+
+} // end ComputePackedMovingImageRange()
+
+
+/**
+ * ****************** EvaluatePackedMovingImage **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluatePackedMovingImage(
+  const MovingImageContinuousIndexType & cindex,
+  RealType & movingImageValue,
+  MovingImageDerivativeType & gradient ) const
+{
+  const PackedMovingImageType *                    packed      = this->m_PackedMovingImage;
+  const typename PackedMovingImageType::RegionType & region      = packed->GetBufferedRegion();
+  const OffsetValueType *                          offsetTable = packed->GetOffsetTable();
+
+  /** Compute the offset of the base index, the distances, and the steps to
+   * the next pixel. Single pixel dimensions have no next pixel.
+   */
+  OffsetValueType baseOffset = 0;
+  OffsetValueType steps[ MovingImageDimension ];
+  double          dist[ MovingImageDimension ];
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    const OffsetValueType size  = static_cast< OffsetValueType >( region.GetSize( d ) );
+    const double          start = static_cast< double >( region.GetIndex( d ) );
+    const double          x     = std::min( std::max( static_cast< double >( cindex[ d ] ), start ),
+      start + static_cast< double >( size - 1 ) );
+
+    OffsetValueType base = Math::Floor< OffsetValueType >( x - start );
+    if( size == 1 )
+    {
+      steps[ d ] = 0;
+    }
+    else
+    {
+      base       = std::min( base, size - 2 );
+      steps[ d ] = offsetTable[ d ];
+    }
+    dist[ d ]   = x - start - static_cast< double >( base );
+    baseOffset += base * offsetTable[ d ];
+  }
+
+  /** Interpolate all components at once from the 2^D corners. */
+  const PackedMovingImagePixelType * p = packed->GetBufferPointer() + baseOffset;
+  double                             accumulator[ MovingImageDimension + 1 ];
+  std::fill( accumulator, accumulator + MovingImageDimension + 1, 0.0 );
+  for( unsigned int corner = 0; corner < ( 1u << MovingImageDimension ); ++corner )
+  {
+    double          weight = 1.0;
+    OffsetValueType offset = 0;
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      if( corner & ( 1u << d ) )
+      {
+        weight *= dist[ d ];
+        offset += steps[ d ];
+      }
+      else
+      {
+        weight *= 1.0 - dist[ d ];
+      }
+    }
+
+    const PackedMovingImagePixelType & pixel = p[ offset ];
+    for( unsigned int k = 0; k < MovingImageDimension + 1; ++k )
+    {
+      accumulator[ k ] += weight * pixel[ k ];
+    }
+  }
+
+  movingImageValue = static_cast< RealType >( accumulator[ 0 ] );
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    gradient[ d ] = accumulator[ d + 1 ];
+  }
+
+} // end EvaluatePackedMovingImage()
+
+
+/**
+ * ****************** CheckForAdvancedTransform **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckForAdvancedTransform( void )
+{
+  /** Check if the transform is of type AdvancedTransform. */
+  this->m_TransformIsAdvanced = false;
+  AdvancedTransformType * testPtr
+    = dynamic_cast< AdvancedTransformType * >(
+    this->m_Transform.GetPointer() );
+  if( !testPtr )
+  {
+    this->m_AdvancedTransform = 0;
+    itkDebugMacro( "Transform is not Advanced" );
+    itkExceptionMacro( << "The AdvancedImageToImageMetric requires an AdvancedTransform" );
+  }
+  else
+  {
+    this->m_TransformIsAdvanced = true;
+    this->m_AdvancedTransform   = testPtr;
+    itkDebugMacro( "Transform is Advanced" );
+  }
+
+} // end CheckForAdvancedTransform()
+
+
+/**
+ * ****************** CheckForBSplineTransform **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckForBSplineTransform( void ) const
+{
+  /** Check if this transform is a combo transform. */
+  CombinationTransformType * testPtr_combo
+    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
 
   /** Check if this transform is a B-spline transform. */
   BSplineOrder1TransformType * testPtr_1
@@ -632,6 +1424,254 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckForBSplineTransform()
 
 
+/**
+ * ****************** InitializeTransformSampleGrid **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeTransformSampleGrid( void )
+{
+  typedef AdvancedBSplineDeformableTransformBase<
+    ScalarType, FixedImageDimension >               BSplineBaseTransformType;
+
+  /** The B-spline transform sees the fixed image points, unless it is
+   * composed with an initial transform.
+   */
+  AdvancedTransformType *    transform = this->m_AdvancedTransform.GetPointer();
+  CombinationTransformType * combo     = dynamic_cast< CombinationTransformType * >( transform );
+
+  bool seesFixedImagePoints = true;
+  if( combo )
+  {
+    transform            = combo->GetCurrentTransform();
+    seesFixedImagePoints = !combo->GetUseComposition()
+      || combo->GetInitialTransform() == 0;
+  }
+
+  BSplineBaseTransformType * bsplineTransform
+    = dynamic_cast< BSplineBaseTransformType * >( transform );
+  if( bsplineTransform == 0 )
+  {
+    return;
+  }
+
+  /** Samples in between the voxels would never be found in the tables. */
+  if( !seesFixedImagePoints || this->m_FixedImage.IsNull()
+    || this->GetImageSampler() == 0
+    || !this->GetImageSampler()->GetSamplesAreOnVoxelGrid() )
+  {
+    bsplineTransform->RemoveSampleGrid();
+    return;
+  }
+
+  bsplineTransform->SetSampleGrid( this->m_FixedImage->GetOrigin(),
+    this->m_FixedImage->GetSpacing(), this->m_FixedImage->GetDirection() );
+
+} // end InitializeTransformSampleGrid()
+
+
+/**
+ * ****************** InitializeMovingImageBoundsCheck **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeMovingImageBoundsCheck( void )
+{
+  this->m_MovingImageBoundsCheckIsActive         = false;
+  this->m_MovingImageBoundsCheckTransform        = 0;
+  this->m_MovingImageBoundsCheckInitialTransform = 0;
+  this->m_NumberOfBoundsCheckRejections          = 0;
+  if( !this->m_UseMovingImageBoundsCheck || !this->m_TransformIsBSpline )
+  {
+    return;
+  }
+
+  /** Get the B-spline transform, and the initial transform that precedes it. */
+  const CombinationTransformType * combo
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( combo != 0 )
+  {
+    this->m_MovingImageBoundsCheckTransform        = combo->GetCurrentTransform();
+    this->m_MovingImageBoundsCheckInitialTransform = combo->GetInitialTransform();
+  }
+  else
+  {
+    this->m_MovingImageBoundsCheckTransform = this->m_AdvancedTransform.GetPointer();
+  }
+
+  /** The bounding box of the moving image buffer, in which the interpolator
+   * accepts points: half a voxel around the centers of the border voxels.
+   */
+  const MovingImageRegionType & region = this->m_MovingImage->GetBufferedRegion();
+  this->m_MovingImageBoundsMinimum.Fill( NumericTraits< ScalarType >::max() );
+  this->m_MovingImageBoundsMaximum.Fill( NumericTraits< ScalarType >::NonpositiveMin() );
+  const unsigned int numberOfCorners = 1u << MovingImageDimension;
+  for( unsigned int corner = 0; corner < numberOfCorners; ++corner )
+  {
+    MovingImageContinuousIndexType cindex;
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      cindex[ d ] = static_cast< double >( region.GetIndex()[ d ] ) - 0.5;
+      if( corner & ( 1u << d ) )
+      {
+        cindex[ d ] += static_cast< double >( region.GetSize()[ d ] );
+      }
+    }
+    MovingImagePointType point;
+    this->m_MovingImage->TransformContinuousIndexToPhysicalPoint( cindex, point );
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      this->m_MovingImageBoundsMinimum[ d ] = std::min( this->m_MovingImageBoundsMinimum[ d ], point[ d ] );
+      this->m_MovingImageBoundsMaximum[ d ] = std::max( this->m_MovingImageBoundsMaximum[ d ], point[ d ] );
+    }
+  }
+
+  /** Intersect it with the bounding box of the nonzero voxels of a moving
+   * image mask, if the mask is an image.
+   */
+  typedef ImageMaskSpatialObject2< MovingImageDimension > ImageMaskType;
+  const ImageMaskType * imageMask
+    = dynamic_cast< const ImageMaskType * >( this->m_MovingImageMask.GetPointer() );
+  if( imageMask != 0 && imageMask->GetImage() != 0 )
+  {
+    typename ImageMaskType::IndexType maskIndex;
+    typename ImageMaskType::SizeType  maskSize;
+    imageMask->ComputeLocalBoundingBoxIndexAndSize( maskIndex, maskSize );
+
+    MovingImagePointType maskMinimum;
+    MovingImagePointType maskMaximum;
+    maskMinimum.Fill( NumericTraits< ScalarType >::max() );
+    maskMaximum.Fill( NumericTraits< ScalarType >::NonpositiveMin() );
+    for( unsigned int corner = 0; corner < numberOfCorners; ++corner )
+    {
+      typename ImageMaskType::PointType cindex;
+      for( unsigned int d = 0; d < MovingImageDimension; ++d )
+      {
+        cindex[ d ] = static_cast< double >( maskIndex[ d ] ) - 0.5;
+        if( corner & ( 1u << d ) )
+        {
+          cindex[ d ] += static_cast< double >( maskSize[ d ] );
+        }
+      }
+      const typename ImageMaskType::PointType point
+        = imageMask->GetIndexToWorldTransform()->TransformPoint( cindex );
+      for( unsigned int d = 0; d < MovingImageDimension; ++d )
+      {
+        maskMinimum[ d ] = std::min( maskMinimum[ d ], static_cast< ScalarType >( point[ d ] ) );
+        maskMaximum[ d ] = std::max( maskMaximum[ d ], static_cast< ScalarType >( point[ d ] ) );
+      }
+    }
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      this->m_MovingImageBoundsMinimum[ d ] = std::max( this->m_MovingImageBoundsMinimum[ d ], maskMinimum[ d ] );
+      this->m_MovingImageBoundsMaximum[ d ] = std::min( this->m_MovingImageBoundsMaximum[ d ], maskMaximum[ d ] );
+    }
+  }
+
+  /** Widen the box by a small margin for the rounding errors. */
+  const typename MovingImageType::SpacingType & spacing = this->m_MovingImage->GetSpacing();
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    this->m_MovingImageBoundsMinimum[ d ] -= 1e-3 * spacing[ d ];
+    this->m_MovingImageBoundsMaximum[ d ] += 1e-3 * spacing[ d ];
+  }
+
+  this->m_MovingImageBoundsCheckIsActive = true;
+  this->UpdateMovingImageBoundsCheck();
+
+} // end InitializeMovingImageBoundsCheck()
+
+
+/**
+ * ****************** UpdateMovingImageBoundsCheck **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateMovingImageBoundsCheck( void ) const
+{
+  if( !this->m_MovingImageBoundsCheckIsActive )
+  {
+    return;
+  }
+
+  /** The coefficients of the B-spline transform are stored per dimension. */
+  const ParametersType & parameters           = this->m_MovingImageBoundsCheckTransform->GetParameters();
+  const SizeValueType    numberOfPerDimension = parameters.GetSize() / MovingImageDimension;
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    ScalarType maximumDisplacement = NumericTraits< ScalarType >::Zero;
+    const SizeValueType offset = d * numberOfPerDimension;
+    for( SizeValueType i = 0; i < numberOfPerDimension; ++i )
+    {
+      maximumDisplacement = std::max( maximumDisplacement,
+        static_cast< ScalarType >( vnl_math_abs( parameters[ offset + i ] ) ) );
+    }
+    this->m_ExpandedMovingImageBoundsMinimum[ d ]
+      = this->m_MovingImageBoundsMinimum[ d ] - maximumDisplacement;
+    this->m_ExpandedMovingImageBoundsMaximum[ d ]
+      = this->m_MovingImageBoundsMaximum[ d ] + maximumDisplacement;
+  }
+
+} // end UpdateMovingImageBoundsCheck()
+
+
+/**
+ * ****************** IsInsideMovingImageBounds **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::IsInsideMovingImageBounds( const FixedImagePointType & fixedImagePoint ) const
+{
+  /** The point mapped by the initial transform only. */
+  MovingImagePointType point;
+  if( this->m_MovingImageBoundsCheckInitialTransform != 0 )
+  {
+    point = this->m_MovingImageBoundsCheckInitialTransform->TransformPoint( fixedImagePoint );
+  }
+  else
+  {
+    for( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      point[ d ] = fixedImagePoint[ d ];
+    }
+  }
+
+  for( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    if( point[ d ] < this->m_ExpandedMovingImageBoundsMinimum[ d ]
+      || point[ d ] > this->m_ExpandedMovingImageBoundsMaximum[ d ] )
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end IsInsideMovingImageBounds()
+
+
+/**
+ * ****************** SetTransformParameters **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetTransformParameters( const ParametersType & parameters ) const
+{
+  this->Superclass::SetTransformParameters( parameters );
+  this->UpdateMovingImageBoundsCheck();
+
+} // end SetTransformParameters()
+
+
 /**
  * ******************* EvaluateMovingImageValueAndDerivative ******************
  */
@@ -646,18 +1686,38 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 {
   /** Check if mapped point inside image buffer. */
   MovingImageContinuousIndexType cindex;
-  this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
+  this->ConvertMovingPointToContinuousIndex( mappedPoint, cindex );
   bool sampleOk = this->m_Interpolator->IsInsideBuffer( cindex );
   if( sampleOk )
   {
     /** Compute value and possibly derivative. */
     if( gradient )
     {
-      if( this->m_InterpolatorIsBSpline && !this->GetComputeGradient() )
+      if( this->m_PackedMovingImage.IsNotNull() )
+      {
+        /** Interpolate the moving image value and the precomputed gradient.
+         * The value of other interpolators than the linear is kept. */
+        this->EvaluatePackedMovingImage( cindex, movingImageValue, *gradient );
+        if( !this->m_UsePackedMovingImageValue )
+        {
+          movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex( cindex );
+        }
+      }
+      else if( this->m_InterpolatorIsBSpline && !this->GetComputeGradient() )
       {
         /** Compute moving image value and gradient using the B-spline kernel. */
-        this->m_BSplineInterpolator->EvaluateValueAndDerivativeAtContinuousIndex(
-          cindex, movingImageValue, *gradient );
+#ifdef ELASTIX_SPECIALIZED_BUILD
+        if( this->m_BindBSplineInterpolatorStatically )
+        {
+          this->m_BSplineInterpolator->BSplineInterpolatorType::EvaluateValueAndDerivativeAtContinuousIndex(
+            cindex, movingImageValue, *gradient );
+        }
+        else
+#endif
+        {
+          this->m_BSplineInterpolator->EvaluateValueAndDerivativeAtContinuousIndex(
+            cindex, movingImageValue, *gradient );
+        }
       }
       else if( this->m_InterpolatorIsBSplineFloat && !this->GetComputeGradient() )
       {
@@ -694,45 +1754,14 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** The moving image gradient is multiplied with its scales, when requested. */
-      if( this->m_UseMovingImageDerivativeScales )
-      {
-        if( !this->m_ScaleGradientWithRespectToMovingImageOrientation )
-        {
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            ( *gradient )[ i ] *= this->m_MovingImageDerivativeScales[ i ];
-          }
-        }
-        else
-        {
-          /** Optionally, the scales are applied with respect to the moving image orientation.
-           * The above default option implicitly applies the scales with respect to the
-           * orientation of the transformation axis. In some cases you may want to restrict
-           * moving image motion with respect to its own axes. This is achieved below by pre
-           * and post rotation by the direction cosines of the moving image.
-           * First the gradient is rotated backwards to a standardized axis.
-           */
-          typedef typename MovingImageType::DirectionType::InternalMatrixType InternalMatrixType;
-          const InternalMatrixType M                    = this->GetMovingImage()->GetDirection().GetVnlMatrix();
-          vnl_vector< double >     rotated_gradient_vnl = M.transpose() * gradient->GetVnlVector();
-
-          /** Then scales are applied. */
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            rotated_gradient_vnl[ i ] *= this->m_MovingImageDerivativeScales[ i ];
-          }
-
-          /** The scaled gradient is then rotated forwards again. */
-          rotated_gradient_vnl = M * rotated_gradient_vnl;
-
-          /** Copy the vnl version back to the original. */
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            ( *gradient )[ i ] = rotated_gradient_vnl[ i ];
-          }
-        }
-      } // end if m_UseMovingImageDerivativeScales
+      this->ApplyMovingImageDerivativeScales( *gradient );
     } // end if gradient
+#ifdef ELASTIX_SPECIALIZED_BUILD
+    else if( this->m_BindBSplineInterpolatorStatically )
+    {
+      movingImageValue = this->m_BSplineInterpolator->BSplineInterpolatorType::EvaluateAtContinuousIndex( cindex );
+    }
+#endif
     else
     {
       movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex( cindex );
@@ -744,6 +1773,126 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateMovingImageValueAndDerivative()
 
 
+/**
+ * ******************* ApplyMovingImageDerivativeScales ******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ApplyMovingImageDerivativeScales( MovingImageDerivativeType & gradient ) const
+{
+  if( this->m_UseMovingImageDerivativeScales )
+  {
+    if( !this->m_ScaleGradientWithRespectToMovingImageOrientation )
+    {
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        gradient[ i ] *= this->m_MovingImageDerivativeScales[ i ];
+      }
+    }
+    else
+    {
+      /** Optionally, the scales are applied with respect to the moving image orientation.
+       * The above default option implicitly applies the scales with respect to the
+       * orientation of the transformation axis. In some cases you may want to restrict
+       * moving image motion with respect to its own axes. This is achieved below by pre
+       * and post rotation by the direction cosines of the moving image.
+       * First the gradient is rotated backwards to a standardized axis.
+       */
+      typedef typename MovingImageType::DirectionType::InternalMatrixType InternalMatrixType;
+      const InternalMatrixType M                    = this->GetMovingImage()->GetDirection().GetVnlMatrix();
+      vnl_vector< double >     rotated_gradient_vnl = M.transpose() * gradient.GetVnlVector();
+
+      /** Then scales are applied. */
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        rotated_gradient_vnl[ i ] *= this->m_MovingImageDerivativeScales[ i ];
+      }
+
+      /** The scaled gradient is then rotated forwards again. */
+      rotated_gradient_vnl = M * rotated_gradient_vnl;
+
+      /** Copy the vnl version back to the original. */
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        gradient[ i ] = rotated_gradient_vnl[ i ];
+      }
+    }
+  }
+
+} // end ApplyMovingImageDerivativeScales()
+
+
+/**
+ * ******************* EvaluateMovingImageValuesAndDerivatives ******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateMovingImageValuesAndDerivatives(
+  const unsigned int numberOfPoints,
+  const MovingImagePointType * mappedPoints,
+  bool * sampleOk,
+  RealType * movingImageValues,
+  MovingImageDerivativeType * gradients ) const
+{
+  /** Only the linear interpolator has a batch interface. */
+  if( !this->m_InterpolatorIsLinear || this->GetComputeGradient()
+    || this->m_PackedMovingImage.IsNotNull() )
+  {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      if( sampleOk[ i ] )
+      {
+        sampleOk[ i ] = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoints[ i ], movingImageValues[ i ], &gradients[ i ] );
+      }
+    }
+    return;
+  }
+
+  /** Gather the points that are inside the moving image buffer. */
+  typedef typename LinearInterpolatorType::OutputType          LinearOutputType;
+  typedef typename LinearInterpolatorType::CovariantVectorType LinearDerivativeType;
+  const unsigned int             chunkSize = 64;
+  MovingImageContinuousIndexType cindices[ chunkSize ];
+  LinearOutputType               values[ chunkSize ];
+  LinearDerivativeType           derivatives[ chunkSize ];
+  unsigned int                   positions[ chunkSize ];
+
+  for( unsigned int chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += chunkSize )
+  {
+    const unsigned int chunkEnd = std::min( chunkBegin + chunkSize, numberOfPoints );
+    unsigned int       count    = 0;
+    for( unsigned int i = chunkBegin; i < chunkEnd; ++i )
+    {
+      if( !sampleOk[ i ] ) { continue; }
+
+      this->ConvertMovingPointToContinuousIndex( mappedPoints[ i ], cindices[ count ] );
+      sampleOk[ i ] = this->m_Interpolator->IsInsideBuffer( cindices[ count ] );
+      if( sampleOk[ i ] )
+      {
+        positions[ count ] = i;
+        ++count;
+      }
+    }
+
+    /** Compute the values and gradients at once, and scatter them. */
+    this->m_LinearInterpolator->EvaluateValueAndDerivativeAtContinuousIndices(
+      count, cindices, values, derivatives );
+    for( unsigned int k = 0; k < count; ++k )
+    {
+      movingImageValues[ positions[ k ] ] = values[ k ];
+      gradients[ positions[ k ] ]         = derivatives[ k ];
+      this->ApplyMovingImageDerivativeScales( gradients[ positions[ k ] ] );
+    }
+  }
+
+} // end EvaluateMovingImageValuesAndDerivatives()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -804,11 +1953,39 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
-} // end EvaluateTransformJacobianInnerProduct()
+} // end EvaluateTransformJacobianInnerProduct()
+
+
+/**
+ * ********************** TransformPoint ************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::TransformPoint(
+  const FixedImagePointType & fixedImagePoint,
+  MovingImagePointType & mappedPoint ) const
+{
+  /** Reject the points that are certainly mapped outside the moving image. */
+  if( this->m_MovingImageBoundsCheckIsActive
+    && !this->IsInsideMovingImageBounds( fixedImagePoint ) )
+  {
+    ++this->m_NumberOfBoundsCheckRejections;
+    return false;
+  }
+
+  mappedPoint = this->m_Transform->TransformPoint( fixedImagePoint );
+
+  /** For future use: return whether the sample is valid */
+  const bool valid = true;
+  return valid;
+
+} // end TransformPoint()
 
 
 /**
- * ********************** TransformPoint ************************
+ * *************** TransformPoint ***************************
  */
 
 template< class TFixedImage, class TMovingImage >
@@ -816,9 +1993,18 @@ bool
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::TransformPoint(
   const FixedImagePointType & fixedImagePoint,
-  MovingImagePointType & mappedPoint ) const
+  MovingImagePointType & mappedPoint,
+  TransformPointCacheType & cache ) const
 {
-  mappedPoint = this->m_Transform->TransformPoint( fixedImagePoint );
+  /** Reject the points that are certainly mapped outside the moving image. */
+  if( this->m_MovingImageBoundsCheckIsActive
+    && !this->IsInsideMovingImageBounds( fixedImagePoint ) )
+  {
+    ++this->m_NumberOfBoundsCheckRejections;
+    return false;
+  }
+
+  mappedPoint = this->m_AdvancedTransform->TransformPointAndCacheWeights( fixedImagePoint, cache );
 
   /** For future use: return whether the sample is valid */
   const bool valid = true;
@@ -871,6 +2057,25 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end IsInsideMovingMask()
 
 
+/**
+ * *********************** GetValues ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValues( const ParametersArrayType & parametersArray,
+  MeasureArrayType & values ) const
+{
+  values.resize( parametersArray.size() );
+  for( std::size_t k = 0; k < parametersArray.size(); ++k )
+  {
+    values[ k ] = this->GetValue( parametersArray[ k ] );
+  }
+
+} // end GetValues()
+
+
 /**
  * *********************** GetSelfHessian ***********************
  */
@@ -897,6 +2102,237 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetSelfHessian()
 
 
+/**
+ * *********************** GetSelfHessianDiagonal ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianDiagonal( const TransformParametersType & parameters,
+  DerivativeType & diagonal ) const
+{
+  HessianType H;
+  this->GetSelfHessian( parameters, H );
+
+  diagonal.SetSize( this->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+  {
+    diagonal[ i ] = H( i, i );
+  }
+
+} // end GetSelfHessianDiagonal()
+
+
+/**
+ * *********************** EvaluateSelfHessianTerms ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateSelfHessianTerms( const ImageSampleContainerType * itkNotUsed( samples ),
+  SizeValueType itkNotUsed( sampleIndex ), NonZeroJacobianIndicesType & itkNotUsed( nzji ),
+  double * itkNotUsed( terms ) ) const
+{
+  return false;
+
+} // end EvaluateSelfHessianTerms()
+
+
+/**
+ * *********************** AssembleSelfHessian ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AssembleSelfHessian( const ImageSampleContainerType * samples,
+  unsigned int numberOfColumns, bool diagonalOnly,
+  HessianType & H, DerivativeType & diagonal ) const
+{
+  const SizeValueType numberOfSamples = samples->Size();
+  const SizeValueType numberOfRows
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+
+  SelfHessianAssemblyParameterType parameters;
+  parameters.st_Metric          = this;
+  parameters.st_Samples         = samples;
+  parameters.st_NumberOfRows    = this->GetNumberOfParameters();
+  parameters.st_NumberOfColumns = numberOfColumns;
+  parameters.st_TermsPerSample  = numberOfRows * numberOfColumns;
+  parameters.st_DiagonalOnly    = diagonalOnly;
+  parameters.st_Hessian         = &H;
+  parameters.st_Diagonal        = &diagonal;
+
+  /** Several row blocks per thread balance the load, as the nonzero
+   * Jacobian indices are not spread evenly over the parameters.
+   */
+  const SizeValueType numberOfThreads
+    = this->m_UseMultiThread ? PersistentThreadPool::GetInstance()->GetNumberOfThreads() : 1;
+  parameters.st_NumberOfRowBlocks = std::min< SizeValueType >(
+    4 * numberOfThreads, std::max< SizeValueType >( 1, parameters.st_NumberOfRows ) );
+
+  /** The chunks hold at most 4M terms. */
+  const SizeValueType chunkSize = std::min( numberOfSamples, std::max< SizeValueType >(
+    1, ( 1 << 22 ) / std::max< SizeValueType >( 1, parameters.st_TermsPerSample ) ) );
+  parameters.st_NonZeroJacobianIndices.resize( chunkSize );
+  parameters.st_Terms.resize( chunkSize * parameters.st_TermsPerSample );
+  parameters.st_Valid.resize( chunkSize );
+
+  SizeValueType numberOfValidSamples = 0;
+  for( SizeValueType chunkBegin = 0; chunkBegin < numberOfSamples; chunkBegin += chunkSize )
+  {
+    parameters.st_ChunkBegin = chunkBegin;
+    parameters.st_ChunkEnd   = std::min( chunkBegin + chunkSize, numberOfSamples );
+    const SizeValueType chunkLength = parameters.st_ChunkEnd - chunkBegin;
+    if( this->m_UseMultiThread )
+    {
+      PersistentThreadPool::GetInstance()->ParallelFor( chunkLength, 0,
+        Self::EvaluateSelfHessianTermsRangeFunction, &parameters );
+      PersistentThreadPool::GetInstance()->ParallelFor( parameters.st_NumberOfRowBlocks, 1,
+        Self::AddSelfHessianTermsRangeFunction, &parameters );
+    }
+    else
+    {
+      Self::EvaluateSelfHessianTermsRangeFunction( &parameters, 0, 0, chunkLength );
+      Self::AddSelfHessianTermsRangeFunction( &parameters, 0, 0, parameters.st_NumberOfRowBlocks );
+    }
+
+    for( SizeValueType s = 0; s < chunkLength; ++s )
+    {
+      numberOfValidSamples += parameters.st_Valid[ s ];
+    }
+  }
+
+  return numberOfValidSamples;
+
+} // end AssembleSelfHessian()
+
+
+/**
+ * *********************** EvaluateSelfHessianTermsRangeFunction ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateSelfHessianTermsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  SelfHessianAssemblyParameterType * parameters
+    = static_cast< SelfHessianAssemblyParameterType * >( userData );
+
+  for( SizeValueType s = begin; s < end; ++s )
+  {
+    parameters->st_Valid[ s ] = parameters->st_Metric->EvaluateSelfHessianTerms(
+      parameters->st_Samples, parameters->st_ChunkBegin + s,
+      parameters->st_NonZeroJacobianIndices[ s ],
+      &parameters->st_Terms[ s * parameters->st_TermsPerSample ] ) ? 1 : 0;
+  }
+
+} // end EvaluateSelfHessianTermsRangeFunction()
+
+
+/**
+ * *********************** AddSelfHessianTermsRangeFunction ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AddSelfHessianTermsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  typedef typename HessianType::row    RowType;
+  typedef typename RowType::iterator   RowIteratorType;
+  typedef typename HessianType::pair_t ElementType;
+
+  const SelfHessianAssemblyParameterType * parameters
+    = static_cast< const SelfHessianAssemblyParameterType * >( userData );
+  const unsigned int  numberOfColumns = parameters->st_NumberOfColumns;
+  const SizeValueType rowBegin
+    = parameters->st_NumberOfRows * begin / parameters->st_NumberOfRowBlocks;
+  const SizeValueType rowEnd
+    = parameters->st_NumberOfRows * end / parameters->st_NumberOfRowBlocks;
+
+  /** Visit the samples in order, so that the sums do not depend on the threads. */
+  const SizeValueType chunkLength = parameters->st_ChunkEnd - parameters->st_ChunkBegin;
+  for( SizeValueType s = 0; s < chunkLength; ++s )
+  {
+    if( !parameters->st_Valid[ s ] )
+    {
+      continue;
+    }
+
+    const NonZeroJacobianIndicesType & nzji  = parameters->st_NonZeroJacobianIndices[ s ];
+    const double *                     terms = &parameters->st_Terms[ s * parameters->st_TermsPerSample ];
+    const unsigned int                 size  = nzji.size();
+    for( unsigned int i = 0; i < size; ++i )
+    {
+      const SizeValueType row = nzji[ i ];
+      if( row < rowBegin || row >= rowEnd )
+      {
+        continue;
+      }
+      const double * termsRow = terms + i * numberOfColumns;
+
+      if( parameters->st_DiagonalOnly )
+      {
+        double val = 0.0;
+        for( unsigned int c = 0; c < numberOfColumns; ++c )
+        {
+          val += termsRow[ c ] * termsRow[ c ];
+        }
+        ( *parameters->st_Diagonal )[ row ] += val;
+        continue;
+      }
+
+      /** Save only the upper triangular part of the matrix. The nonzero
+       * Jacobian indices are ascending, so the row is walked once.
+       */
+      RowType &       rowVector = parameters->st_Hessian->get_row( row );
+      RowIteratorType rowIt     = rowVector.begin();
+      for( unsigned int j = i; j < size; ++j )
+      {
+        const unsigned int col      = nzji[ j ];
+        const double *     termsCol = terms + j * numberOfColumns;
+        double             val      = 0.0;
+        for( unsigned int c = 0; c < numberOfColumns; ++c )
+        {
+          val += termsRow[ c ] * termsCol[ c ];
+        }
+        if( ( val < 1e-14 ) && ( val > -1e-14 ) )
+        {
+          continue;
+        }
+
+        /** The following implements:
+         * H(row,col) += val;
+         * But more efficient.
+         */
+
+        /** Go to next element */
+        for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
+        {}
+
+        if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
+        {
+          /** Add new column to the row and set iterator to that column. */
+          rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
+        }
+        else
+        {
+          /** Add to existing value */
+          ( *rowIt ).second += val;
+        }
+      }
+    }
+  }
+
+} // end AddSelfHessianTermsRangeFunction()
+
+
 /**
  * *********************** BeforeThreadedGetValueAndDerivative ***********************
  */
@@ -909,16 +2345,271 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** In this function do all stuff that cannot be multi-threaded. */
   if( this->m_UseMetricSingleThreaded )
   {
-    this->SetTransformParameters( parameters );
+    /** All ranks evaluate the parameters of rank 0. */
+    if( this->GetDistributedComputationIsActive() )
+    {
+      TransformParametersType rootParameters( parameters );
+      DistributedComputation::GetInstance()->Broadcast(
+        rootParameters.data_block(), rootParameters.GetSize(), 0 );
+      this->SetTransformParameters( rootParameters );
+    }
+    else
+    {
+      this->SetTransformParameters( parameters );
+    }
     if( this->m_UseImageSampler )
     {
-      this->GetImageSampler()->Update();
+      itkPhaseTimerMacro( "ImageSamplerUpdate" );
+
+      /** With an implicit grid the samples are generated on the fly, and the
+       * sampler is not updated. */
+      this->m_UseImplicitSampleGrid = this->GetSupportsImplicitSampling()
+        && this->GetImageSampler()->GetImplicitSampleGrid( this->m_ImplicitSampleGrid );
+      if( this->m_UseImplicitSampleGrid )
+      {
+        this->m_FixedSampleFeatureCacheIsValid = false;
+      }
+      else
+      {
+        this->GetImageSampler()->Update();
+        this->UpdateFixedSampleFeatureCache();
+      }
+
+      if( this->GetDistributedComputationIsActive() && !this->m_DistributedSamplesChecked )
+      {
+        this->CheckDistributedSamples();
+      }
     }
   }
 
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * *********************** GetThreadSampleRange ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetThreadSampleRange( ThreadIdType threadId,
+  SizeValueType & begin, SizeValueType & end ) const
+{
+  /** The part of this rank. */
+  const SizeValueType numberOfSlots = this->GetNumberOfFixedImageSampleSlots();
+  SizeValueType       rankBegin     = 0;
+  SizeValueType       rankEnd       = numberOfSlots;
+  if( this->GetDistributedComputationIsActive() )
+  {
+    const DistributedComputation * distributed = DistributedComputation::GetInstance();
+    const SizeValueType            rank          = distributed->GetRank();
+    const SizeValueType            numberOfRanks = distributed->GetNumberOfRanks();
+    rankBegin = ( numberOfSlots * rank ) / numberOfRanks;
+    rankEnd   = ( numberOfSlots * ( rank + 1 ) ) / numberOfRanks;
+  }
+
+  /** The part of this thread. */
+  const SizeValueType numberOfSlotsPerThread = static_cast< SizeValueType >( vcl_ceil(
+    static_cast< double >( rankEnd - rankBegin ) / static_cast< double >( this->m_NumberOfThreads ) ) );
+  begin = vnl_math_min( rankBegin + numberOfSlotsPerThread * threadId, rankEnd );
+  end   = vnl_math_min( rankBegin + numberOfSlotsPerThread * ( threadId + 1 ), rankEnd );
+
+} // end GetThreadSampleRange()
+
+
+/**
+ * *********************** DistributedSumOfValue ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::DistributedSumOfValue( MeasureType & value,
+  SizeValueType & numberOfPixelsCounted ) const
+{
+  if( !this->GetDistributedComputationIsActive() )
+  {
+    return;
+  }
+
+  double sums[ 2 ];
+  sums[ 0 ] = static_cast< double >( value );
+  sums[ 1 ] = static_cast< double >( numberOfPixelsCounted );
+  DistributedComputation::GetInstance()->AllReduceSum( sums, 2 );
+  value                 = static_cast< MeasureType >( sums[ 0 ] );
+  numberOfPixelsCounted = static_cast< SizeValueType >( sums[ 1 ] + 0.5 );
+
+} // end DistributedSumOfValue()
+
+
+/**
+ * *********************** DistributedSumOfDerivative ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::DistributedSumOfDerivative( DerivativeType & derivative ) const
+{
+  if( !this->GetDistributedComputationIsActive() )
+  {
+    return;
+  }
+
+  itkPhaseTimerMacro( "DistributedSumOfDerivative" );
+  DistributedComputation::GetInstance()->AllReduceSum(
+    derivative.data_block(), derivative.GetSize() );
+
+} // end DistributedSumOfDerivative()
+
+
+/**
+ * *********************** CheckDistributedSamples ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckDistributedSamples( void ) const
+{
+  /** The checksum weighs every sample differently, so that also a different
+   * order of the same samples is detected. Equal samples give bitwise equal
+   * checksums, since every rank sums them in the same order.
+   */
+  const ImageSampleContainerType * sampleContainer = this->m_UseImplicitSampleGrid
+    ? 0 : this->GetImageSampler()->GetOutput();
+  const SizeValueType numberOfSlots = this->GetNumberOfFixedImageSampleSlots();
+  double              checksum      = 0.0;
+  ImageSampleType     sample;
+  for( SizeValueType i = 0; i < numberOfSlots; ++i )
+  {
+    if( this->GetFixedImageSample( sampleContainer, i, sample ) )
+    {
+      double weightedSum = 0.0;
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        weightedSum += ( d + 1.0 ) * sample.m_ImageCoordinates[ d ];
+      }
+      checksum += static_cast< double >( i % 1021 + 1 ) * weightedSum;
+    }
+  }
+
+  /** Compare with rank 0, and count the ranks that differ. Every rank learns
+   * the count, so that they all throw, instead of waiting for each other.
+   */
+  const DistributedComputation * distributed = DistributedComputation::GetInstance();
+  double                         rootValues[ 2 ];
+  rootValues[ 0 ] = static_cast< double >( numberOfSlots );
+  rootValues[ 1 ] = checksum;
+  distributed->Broadcast( rootValues, 2, 0 );
+  double numberOfDifferentRanks
+    = ( rootValues[ 0 ] != static_cast< double >( numberOfSlots ) || rootValues[ 1 ] != checksum ) ? 1.0 : 0.0;
+  distributed->AllReduceSum( &numberOfDifferentRanks, 1 );
+  this->m_DistributedSamplesChecked = true;
+
+  if( numberOfDifferentRanks > 0.0 )
+  {
+    itkExceptionMacro( << "ERROR: the samples of " << numberOfDifferentRanks
+                       << " rank(s) differ from those of rank 0. Rank " << distributed->GetRank()
+                       << " has " << numberOfSlots << " sample slots with checksum " << checksum
+                       << ", rank 0 has " << rootValues[ 0 ] << " with checksum " << rootValues[ 1 ]
+                       << ". All ranks should use the same sampler settings and RandomSeed." );
+  }
+
+} // end CheckDistributedSamples()
+
+
+/**
+ * *********************** UpdateFixedSampleFeatureCache ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateFixedSampleFeatureCache( void ) const
+{
+  /** The features can only be stored if the samples stay the same during
+   * a resolution, and the transform supports it.
+   */
+  if( !this->m_UseFixedSampleFeatureCache || !this->m_UseImageSampler
+    || !this->m_TransformIsAdvanced
+    || this->GetImageSampler()->SelectingNewSamplesOnUpdateSupported()
+    || this->m_AdvancedTransform->GetNumberOfFixedSampleFeatures() == 0 )
+  {
+    this->m_FixedSampleFeatureCacheIsValid = false;
+    return;
+  }
+
+  /** Let the source metric update its features, and use them. */
+  if( this->m_FixedSampleFeatureCacheSource != 0 )
+  {
+    const Self * source = this->m_FixedSampleFeatureCacheSource;
+    source->UpdateFixedSampleFeatureCache();
+    this->m_FixedSampleFeatureCacheIsValid = source->m_FixedSampleFeatureCacheIsValid;
+    return;
+  }
+
+  /** Nothing to do if the samples have not changed. */
+  const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
+  if( this->m_FixedSampleFeatureCacheIsValid
+    && this->m_FixedSampleFeatureCacheContainer == sampleContainer
+    && this->m_FixedSampleFeatureCacheMTime == sampleContainer->GetMTime()
+    && this->m_FixedSampleNonZeroJacobianIndices.size() == sampleContainer->Size() )
+  {
+    return;
+  }
+
+  /** Allocate memory. */
+  const SizeValueType numberOfSamples = sampleContainer->Size();
+  this->m_NumberOfFixedSampleFeatures = this->m_AdvancedTransform->GetNumberOfFixedSampleFeatures();
+  this->m_FixedSampleFeatures.resize( numberOfSamples * this->m_NumberOfFixedSampleFeatures );
+  this->m_FixedSampleNonZeroJacobianIndices.resize( numberOfSamples );
+
+  /** Compute the features of all samples. */
+  const SizeValueType grainSize = 1024;
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor( numberOfSamples, grainSize,
+      Self::ComputeFixedSampleFeaturesRangeFunction, const_cast< Self * >( this ) );
+  }
+  else
+  {
+    Self::ComputeFixedSampleFeaturesRangeFunction(
+      const_cast< Self * >( this ), 0, 0, numberOfSamples );
+  }
+
+  this->m_FixedSampleFeatureCacheIsValid   = true;
+  this->m_FixedSampleFeatureCacheContainer = sampleContainer;
+  this->m_FixedSampleFeatureCacheMTime     = sampleContainer->GetMTime();
+
+} // end UpdateFixedSampleFeatureCache()
+
+
+/**
+ * *********************** ComputeFixedSampleFeaturesRangeFunction ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedSampleFeaturesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const Self * metric = static_cast< const Self * >( userData );
+  const ImageSampleContainerType * sampleContainer = metric->GetImageSampler()->GetOutput();
+  const unsigned int numberOfFeatures = metric->m_NumberOfFixedSampleFeatures;
+
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    metric->m_AdvancedTransform->ComputeFixedSampleFeatures(
+      sampleContainer->ElementAt( i ).m_ImageCoordinates,
+      &( metric->m_FixedSampleFeatures[ i * numberOfFeatures ] ),
+      metric->m_FixedSampleNonZeroJacobianIndices[ i ] );
+  }
+
+} // end ComputeFixedSampleFeaturesRangeFunction()
+
+
 /**
  * **************** GetValueThreaderCallback *******
  */
@@ -931,6 +2622,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
   ThreadIdType     threadID   = infoStruct->ThreadID;
 
+  itkPhaseTimerThreadMacro( "ThreadedGetValue", threadID );
+
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
@@ -950,12 +2643,14 @@ void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchGetValueThreaderCallback( void ) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->GetValueThreaderCallback,
-    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  itkPhaseTimerMacro( "MetricThreadedGetValue" );
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  /** Launch on the persistent thread pool, which avoids spawning new threads
+   * in every iteration.
+   */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->GetValueThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
 
 } // end LaunchGetValueThreaderCallback()
 
@@ -972,6 +2667,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
   ThreadIdType     threadID   = infoStruct->ThreadID;
 
+  itkPhaseTimerThreadMacro( "ThreadedGetValueAndDerivative", threadID );
+
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
@@ -991,12 +2688,14 @@ void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchGetValueAndDerivativeThreaderCallback( void ) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->GetValueAndDerivativeThreaderCallback,
-    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  itkPhaseTimerMacro( "MetricThreadedGetValueAndDerivative" );
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  /** Launch on the persistent thread pool, which avoids spawning new threads
+   * in every iteration.
+   */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->GetValueAndDerivativeThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
 
 } // end LaunchGetValueAndDerivativeThreaderCallback()
 
@@ -1014,6 +2713,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   ThreadIdType     threadID    = infoStruct->ThreadID;
   ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
+  itkPhaseTimerThreadMacro( "AccumulateDerivatives", threadID );
+
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
@@ -1121,6 +2822,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   os << indent << "Variables related to image derivative computation: " << std::endl;
   os << indent.GetNextIndent() << "InterpolatorIsBSpline: "
      << this->m_InterpolatorIsBSpline << std::endl;
+  os << indent.GetNextIndent() << "BindBSplineInterpolatorStatically: "
+     << this->m_BindBSplineInterpolatorStatically << std::endl;
   os << indent.GetNextIndent() << "BSplineInterpolator: "
      << this->m_BSplineInterpolator.GetPointer() << std::endl;
   os << indent.GetNextIndent() << "InterpolatorIsBSplineFloat: "
@@ -1129,6 +2832,12 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_BSplineInterpolatorFloat.GetPointer() << std::endl;
   os << indent.GetNextIndent() << "CentralDifferenceGradientFilter: "
      << this->m_CentralDifferenceGradientFilter.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "UsePrecomputedMovingImageGradient: "
+     << this->m_UsePrecomputedMovingImageGradient << std::endl;
+  os << indent.GetNextIndent() << "PackedMovingImage: "
+     << this->m_PackedMovingImage.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "UsePackedMovingImageValue: "
+     << this->m_UsePackedMovingImageValue << std::endl;
 
   /** Variables used when the transform is a B-spline transform. */
   os << indent << "Variables store the transform as an AdvancedTransform: " << std::endl;
@@ -1136,6 +2845,20 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_TransformIsAdvanced << std::endl;
   os << indent.GetNextIndent() << "AdvancedTransform: "
      << this->m_AdvancedTransform.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "UseFixedSampleFeatureCache: "
+     << this->m_UseFixedSampleFeatureCache << std::endl;
+  os << indent.GetNextIndent() << "UseSparseDerivativeAccumulation: "
+     << this->m_UseSparseDerivativeAccumulation << std::endl;
+  os << indent.GetNextIndent() << "UseDeterministicReduction: "
+     << this->m_UseDeterministicReduction << std::endl;
+  os << indent.GetNextIndent() << "NumberOfDeterministicBlocks: "
+     << this->m_NumberOfDeterministicBlocks << std::endl;
+  os << indent.GetNextIndent() << "UseDistributedComputation: "
+     << this->m_UseDistributedComputation << std::endl;
+  os << indent.GetNextIndent() << "UseMovingImageBoundsCheck: "
+     << this->m_UseMovingImageBoundsCheck << std::endl;
+  os << indent.GetNextIndent() << "NumberOfBoundsCheckRejections: "
+     << this->GetNumberOfBoundsCheckRejections() << std::endl;
 
   /** Other variables. */
   os << indent << "Other variables of the AdvancedImageToImageMetric: " << std::endl;
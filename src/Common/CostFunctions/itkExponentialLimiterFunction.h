@@ -20,6 +20,9 @@
 #define __itkExponentialLimiterFunction_h
 
 #include "itkLimiterFunctionBase.h"
+#include "vnl/vnl_math.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +38,9 @@ namespace itk
  * \f[ L(f(x)) = (T-B) e^{(f-T)/(T-B)} + B, \f]
  * where \f$B\f$ is the upper/lower bound and \f$T\f$ the upper/lower threshold
  *
+ * Optionally, the exponential is interpolated in a precomputed table, see
+ * SetUseLookupTable().
+ *
  * \ingroup Functions
  * \sa LimiterFunctionBase, HardLimiterFunction
  *
@@ -72,9 +78,27 @@ public:
   /** Limit the input value and change the input function derivative accordingly */
   virtual OutputType Evaluate( const InputType & input, DerivativeType & derivative ) const;
 
+  /** Limit \a n input values, without a virtual call per value. */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output ) const;
+
+  /** Limit \a n input values and their derivatives, without a virtual call per value. */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output, DerivativeType * derivatives ) const;
+
   /** Initialize the limiter; calls the ComputeLimiterSettings() function */
   virtual void Initialize( void ) throw ( ExceptionObject );
 
+  /** Option to evaluate the exponential by linear interpolation in a table,
+   * instead of calling exp() for every limited value. The table covers the
+   * exponents in [-16, 0], with 256 entries per unit; outside it exp() is
+   * called. The relative interpolation error is below 2e-6. Default: false.
+   * This option should be set before calling Initialize().
+   */
+  itkSetMacro( UseLookupTable, bool );
+  itkGetConstMacro( UseLookupTable, bool );
+  itkBooleanMacro( UseLookupTable );
+
 protected:
 
   ExponentialLimiterFunction();
@@ -82,11 +106,31 @@ protected:
 
   virtual void ComputeLimiterSettings( void );
 
+  /** Returns exp( x ) for x <= 0, from the table if it is used. */
+  double Exponential( const double x ) const
+  {
+    const double t = -x * ExponentialTableEntriesPerUnit;
+    if( this->m_UseLookupTable && t < ExponentialTableRange * ExponentialTableEntriesPerUnit )
+    {
+      const unsigned int i = static_cast< unsigned int >( t );
+      const double       w = t - static_cast< double >( i );
+      return ( 1.0 - w ) * this->m_ExponentialTable[ i ] + w * this->m_ExponentialTable[ i + 1 ];
+    }
+    return vcl_exp( x );
+  }
+
+
   double m_UTminUB;
   double m_UTminUBinv;
   double m_LTminLB;
   double m_LTminLBinv;
 
+  /** The table of exp( -i / ExponentialTableEntriesPerUnit ). */
+  itkStaticConstMacro( ExponentialTableRange, unsigned int, 16 );
+  itkStaticConstMacro( ExponentialTableEntriesPerUnit, unsigned int, 256 );
+  bool                  m_UseLookupTable;
+  std::vector< double > m_ExponentialTable;
+
 private:
 
   ExponentialLimiterFunction( const Self & ); // purposely not implemented
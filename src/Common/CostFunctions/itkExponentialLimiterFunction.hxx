@@ -32,6 +32,7 @@ template< class TInput, unsigned int NDimension >
 ExponentialLimiterFunction< TInput, NDimension >
 ::ExponentialLimiterFunction()
 {
+  this->m_UseLookupTable = false;
   this->ComputeLimiterSettings();
 }   // end Constructor
 
@@ -46,6 +47,19 @@ ExponentialLimiterFunction< TInput, NDimension >
 ::Initialize( void ) throw ( ExceptionObject )
 {
   this->ComputeLimiterSettings();
+
+  /** Fill the table of the exponential, if it is used. */
+  const unsigned int tableSize
+    = ExponentialTableRange * ExponentialTableEntriesPerUnit + 1;
+  if( this->m_UseLookupTable && this->m_ExponentialTable.size() != tableSize )
+  {
+    this->m_ExponentialTable.resize( tableSize );
+    for( unsigned int i = 0; i < tableSize; ++i )
+    {
+      this->m_ExponentialTable[ i ] = vcl_exp(
+        -static_cast< double >( i ) / static_cast< double >( ExponentialTableEntriesPerUnit ) );
+    }
+  }
 }   // end Initialize()
 
 
@@ -63,7 +77,7 @@ ExponentialLimiterFunction< TInput, NDimension >
   if( diffU > 1e-10 )
   {
     return static_cast< OutputType >(
-      this->m_UTminUB * vcl_exp( this->m_UTminUBinv * diffU ) + this->m_UpperBound );
+      this->m_UTminUB * this->Exponential( this->m_UTminUBinv * diffU ) + this->m_UpperBound );
   }
 
   /** Apply a soft limit if the input is smaller than the LowerThreshold */
@@ -71,7 +85,7 @@ ExponentialLimiterFunction< TInput, NDimension >
   if( diffL < -1e-10 )
   {
     return static_cast< OutputType >(
-      this->m_LTminLB * vcl_exp( this->m_LTminLBinv * diffL ) + this->m_LowerBound );
+      this->m_LTminLB * this->Exponential( this->m_LTminLBinv * diffL ) + this->m_LowerBound );
   }
 
   /** Leave the value as it is */
@@ -92,7 +106,7 @@ ExponentialLimiterFunction< TInput, NDimension >
   const double diffU = static_cast< double >( input - this->m_UpperThreshold );
   if( diffU > 1e-10 )
   {
-    const double temp           = this->m_UTminUB * vcl_exp( this->m_UTminUBinv * diffU );
+    const double temp           = this->m_UTminUB * this->Exponential( this->m_UTminUBinv * diffU );
     const double gradientfactor = this->m_UTminUBinv * temp;
     for( unsigned int i = 0; i < Dimension; ++i )
     {
@@ -105,7 +119,7 @@ ExponentialLimiterFunction< TInput, NDimension >
   const double diffL = static_cast< double >( input - this->m_LowerThreshold );
   if( diffL < -1e-10 )
   {
-    const double temp           = this->m_LTminLB * vcl_exp( this->m_LTminLBinv * diffL );
+    const double temp           = this->m_LTminLB * this->Exponential( this->m_LTminLBinv * diffL );
     const double gradientfactor = this->m_LTminLBinv * temp;
     for( unsigned int i = 0; i < Dimension; ++i )
     {
@@ -119,6 +133,40 @@ ExponentialLimiterFunction< TInput, NDimension >
 }   // end Evaluate()
 
 
+/**
+ * ******************** EvaluateBatch ***********************
+ */
+
+template< class TInput, unsigned int NDimension >
+void
+ExponentialLimiterFunction< TInput, NDimension >
+::EvaluateBatch( const SizeValueType n,
+  const InputType * input, OutputType * output ) const
+{
+  for( SizeValueType i = 0; i < n; ++i )
+  {
+    output[ i ] = this->Self::Evaluate( input[ i ] );
+  }
+}   // end EvaluateBatch()
+
+
+/**
+ * ******************** EvaluateBatch ***********************
+ */
+
+template< class TInput, unsigned int NDimension >
+void
+ExponentialLimiterFunction< TInput, NDimension >
+::EvaluateBatch( const SizeValueType n,
+  const InputType * input, OutputType * output, DerivativeType * derivatives ) const
+{
+  for( SizeValueType i = 0; i < n; ++i )
+  {
+    output[ i ] = this->Self::Evaluate( input[ i ], derivatives[ i ] );
+  }
+}   // end EvaluateBatch()
+
+
 /**
  * ******************** ComputeLimiterSettings ********************
  */
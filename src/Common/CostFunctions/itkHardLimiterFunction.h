@@ -68,6 +68,14 @@ public:
   /** Limit the input value and change the input function derivative accordingly */
   virtual OutputType Evaluate( const InputType & input, DerivativeType & derivative ) const;
 
+  /** Limit \a n input values, without a virtual call per value. */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output ) const;
+
+  /** Limit \a n input values and their derivatives, without a virtual call per value. */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output, DerivativeType * derivatives ) const;
+
 protected:
 
   HardLimiterFunction(){}
@@ -53,6 +53,32 @@ HardLimiterFunction< TInput, NDimension >
 }   // end Evaluate()
 
 
+template< class TInput, unsigned int NDimension >
+void
+HardLimiterFunction< TInput, NDimension >
+::EvaluateBatch( const SizeValueType n,
+  const InputType * input, OutputType * output ) const
+{
+  for( SizeValueType i = 0; i < n; ++i )
+  {
+    output[ i ] = this->Self::Evaluate( input[ i ] );
+  }
+}   // end EvaluateBatch()
+
+
+template< class TInput, unsigned int NDimension >
+void
+HardLimiterFunction< TInput, NDimension >
+::EvaluateBatch( const SizeValueType n,
+  const InputType * input, OutputType * output, DerivativeType * derivatives ) const
+{
+  for( SizeValueType i = 0; i < n; ++i )
+  {
+    output[ i ] = this->Self::Evaluate( input[ i ], derivatives[ i ] );
+  }
+}   // end EvaluateBatch()
+
+
 } // end namespace itk
 
 #endif
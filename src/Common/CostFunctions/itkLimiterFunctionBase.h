@@ -40,6 +40,8 @@ namespace itk
  * \f[ dL/dx = \frac{dL}{df} \cdot \frac{df}{dx} \f]
  *
  * Subclasses must override Evaluate(value) and Evaluate(value, derivative) .
+ * They may override EvaluateBatch() too, to limit an array of values without
+ * a virtual call per value.
  *
  * This class is template over the input type and the dimension of \f$x\f$.
  *
@@ -78,6 +80,33 @@ public:
   /** Limit the input value and change the input function derivative accordingly */
   virtual OutputType Evaluate( const InputType & input, DerivativeType & derivative ) const = 0;
 
+  /** Limit \a n input values. The output may be the same array as the input.
+   * The default implementation calls Evaluate() for each value.
+   */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output ) const
+  {
+    for( SizeValueType i = 0; i < n; ++i )
+    {
+      output[ i ] = this->Evaluate( input[ i ] );
+    }
+  }
+
+
+  /** Limit \a n input values and change their derivatives accordingly. The
+   * output may be the same array as the input. The default implementation
+   * calls Evaluate() for each value.
+   */
+  virtual void EvaluateBatch( const SizeValueType n,
+    const InputType * input, OutputType * output, DerivativeType * derivatives ) const
+  {
+    for( SizeValueType i = 0; i < n; ++i )
+    {
+      output[ i ] = this->Evaluate( input[ i ], derivatives[ i ] );
+    }
+  }
+
+
   /** Set/Get the upper bound that the output should respect. Make sure it is higher
    * than the lower bound. */
   itkSetMacro( UpperBound, OutputType );
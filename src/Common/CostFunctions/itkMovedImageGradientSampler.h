@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMovedImageGradientSampler_h
+#define __itkMovedImageGradientSampler_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkFixedArray.h"
+#include "itkInterpolateImageFunction.h"
+#include "itkTransform.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
+#include <utility>
+
+namespace itk
+{
+
+/** \class MovedImageGradientSampler
+ * \brief Computes the Sobel gradients of the resampled moving image at
+ * a set of fixed image pixels only.
+ *
+ * The gradient based 2D-3D metrics compare the Sobel gradients of the fixed
+ * image with those of the moving image resampled on the fixed image grid
+ * (the DRR). Instead of resampling the moving image on the whole grid and
+ * filtering it, this class resamples the moving image only at the pixels in
+ * the 3x3(x3) neighbourhoods of the sample pixels, and evaluates the Sobel
+ * operators at the sample pixels. The resampling is done in the same way
+ * as by the ResampleImageFilter, with a default value of zero, and borders
+ * are treated with a zero flux Neumann boundary condition, so the results
+ * equal those of the full image pipeline at the sample pixels.
+ *
+ * The set of needed pixels is determined once by SetSampleIndices(), and
+ * reused by every call to Compute(). The resampling is multi-threaded.
+ *
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class MovedImageGradientSampler : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MovedImageGradientSampler  Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MovedImageGradientSampler, Object );
+
+  /** The image dimension. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TFixedImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TFixedImage                                FixedImageType;
+  typedef typename FixedImageType::PixelType         FixedImagePixelType;
+  typedef typename FixedImageType::IndexType         IndexType;
+  typedef typename FixedImageType::OffsetType        OffsetType;
+  typedef typename FixedImageType::RegionType        RegionType;
+  typedef typename FixedImageType::PointType         PointType;
+  typedef TMovingImage                               MovingImageType;
+  typedef typename MovingImageType::PointType        MovingPointType;
+  typedef InterpolateImageFunction<
+    MovingImageType, double >                        InterpolatorType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+  typedef Transform< double,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >       TransformType;
+  typedef double                                     RealType;
+  typedef FixedArray< RealType,
+    itkGetStaticConstMacro( ImageDimension ) >       GradientType;
+  typedef std::vector< IndexType >                   IndexContainerType;
+  typedef std::vector< GradientType >                GradientContainerType;
+
+  /** Set the fixed image, which defines the grid of the resampled image. */
+  itkSetConstObjectMacro( FixedImage, FixedImageType );
+  itkGetConstObjectMacro( FixedImage, FixedImageType );
+
+  /** Set the interpolator, for example a ray cast interpolator. Its input
+   * image is the moving image.
+   */
+  itkSetConstObjectMacro( Interpolator, InterpolatorType );
+  itkGetConstObjectMacro( Interpolator, InterpolatorType );
+
+  /** Set the transform that maps the fixed grid to the moving image. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set the fixed image indices at which the gradients are computed,
+   * and determine the pixels that have to be resampled for them.
+   */
+  void SetSampleIndices( const IndexContainerType & indices );
+
+  /** Get the sample indices. */
+  const IndexContainerType & GetSampleIndices( void ) const
+  {
+    return this->m_SampleIndices;
+  }
+
+
+  /** Get the number of resampled pixels per call of Compute(). */
+  SizeValueType GetNumberOfResampledPixels( void ) const
+  {
+    return this->m_ResampledPixels.size();
+  }
+
+
+  /** Resample the moving image at the needed pixels, and compute the
+   * gradients at the sample indices, in the order of the sample indices.
+   */
+  void Compute( void );
+
+  /** Get the gradients computed by Compute(). */
+  const GradientContainerType & GetGradients( void ) const
+  {
+    return this->m_Gradients;
+  }
+
+
+protected:
+
+  MovedImageGradientSampler();
+  virtual ~MovedImageGradientSampler() {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  MovedImageGradientSampler( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  /** Return the buffer offset of index + offset, clamped to the fixed image region. */
+  OffsetValueType ComputeClampedOffset( const IndexType & index, const OffsetType & offset ) const;
+
+  /** Range functions for the thread pool. */
+  static void ResampleRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void GradientRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  typedef std::vector< std::pair< OffsetType, RealType > > SobelStencilType;
+
+  typename FixedImageType::ConstPointer   m_FixedImage;
+  typename InterpolatorType::ConstPointer m_Interpolator;
+  typename TransformType::ConstPointer    m_Transform;
+
+  /** The non-zero coefficients of the Sobel operator in each direction. */
+  SobelStencilType m_SobelStencils[ ImageDimension ];
+
+  IndexContainerType             m_SampleIndices;
+  std::vector< OffsetValueType > m_ResampledPixels;
+  std::vector< RealType >        m_ResampledValues;
+  GradientContainerType          m_Gradients;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMovedImageGradientSampler.hxx"
+#endif
+
+#endif // end #ifndef __itkMovedImageGradientSampler_h
@@ -0,0 +1,240 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMovedImageGradientSampler_hxx
+#define __itkMovedImageGradientSampler_hxx
+
+#include "itkMovedImageGradientSampler.h"
+#include "itkSobelOperator.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::MovedImageGradientSampler()
+{
+  /** Store the non-zero coefficients of the Sobel operators. */
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    SobelOperator< RealType, ImageDimension > sobelOperator;
+    sobelOperator.SetDirection( d );
+    sobelOperator.CreateDirectional();
+    for( unsigned int k = 0; k < sobelOperator.Size(); ++k )
+    {
+      if( sobelOperator[ k ] != NumericTraits< RealType >::Zero )
+      {
+        this->m_SobelStencils[ d ].push_back(
+          std::make_pair( sobelOperator.GetOffset( k ), sobelOperator[ k ] ) );
+      }
+    }
+  }
+
+} // end Constructor
+
+
+/**
+ * ******************* ComputeClampedOffset *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+OffsetValueType
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::ComputeClampedOffset( const IndexType & index, const OffsetType & offset ) const
+{
+  /** Zero flux Neumann boundary condition: repeat the border pixels. */
+  const RegionType & region = this->m_FixedImage->GetBufferedRegion();
+  IndexType          neighbour;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    const OffsetValueType first = region.GetIndex()[ d ];
+    const OffsetValueType last  = first + static_cast< OffsetValueType >( region.GetSize()[ d ] ) - 1;
+    neighbour[ d ] = std::min( std::max( index[ d ] + offset[ d ], first ), last );
+  }
+  return this->m_FixedImage->ComputeOffset( neighbour );
+
+} // end ComputeClampedOffset()
+
+
+/**
+ * ******************* SetSampleIndices *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::SetSampleIndices( const IndexContainerType & indices )
+{
+  if( this->m_FixedImage.IsNull() )
+  {
+    itkExceptionMacro( << "The fixed image should be set before the sample indices." );
+  }
+
+  this->m_SampleIndices = indices;
+  this->m_Gradients.resize( indices.size() );
+
+  /** Collect the pixels in the support of the Sobel operators, once each. */
+  this->m_ResampledPixels.clear();
+  for( std::size_t s = 0; s < indices.size(); ++s )
+  {
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      for( std::size_t k = 0; k < this->m_SobelStencils[ d ].size(); ++k )
+      {
+        this->m_ResampledPixels.push_back(
+          this->ComputeClampedOffset( indices[ s ], this->m_SobelStencils[ d ][ k ].first ) );
+      }
+    }
+  }
+  std::sort( this->m_ResampledPixels.begin(), this->m_ResampledPixels.end() );
+  this->m_ResampledPixels.erase( std::unique(
+      this->m_ResampledPixels.begin(), this->m_ResampledPixels.end() ),
+    this->m_ResampledPixels.end() );
+
+  /** The resampled values are stored on the full grid, so that they can be
+   * looked up by offset; only the needed pixels are ever written.
+   */
+  this->m_ResampledValues.resize(
+    this->m_FixedImage->GetBufferedRegion().GetNumberOfPixels() );
+
+  this->Modified();
+
+} // end SetSampleIndices()
+
+
+/**
+ * ******************* Compute *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::Compute( void )
+{
+  if( this->m_Interpolator.IsNull() || this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "The interpolator and the transform should be set." );
+  }
+
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_ResampledPixels.size(), 0, Self::ResampleRangeFunction, this );
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_SampleIndices.size(), 0, Self::GradientRangeFunction, this );
+
+} // end Compute()
+
+
+/**
+ * ******************* ResampleRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::ResampleRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  Self *                   self         = static_cast< Self * >( userData );
+  const FixedImageType *   fixedImage   = self->m_FixedImage.GetPointer();
+  const InterpolatorType * interpolator = self->m_Interpolator.GetPointer();
+  const MovingImageType *  movingImage  = interpolator->GetInputImage();
+
+  /** The ResampleImageFilter casts to the fixed pixel type with bounds checking. */
+  const RealType minValue = static_cast< RealType >( NumericTraits< FixedImagePixelType >::NonpositiveMin() );
+  const RealType maxValue = static_cast< RealType >( NumericTraits< FixedImagePixelType >::max() );
+
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    const OffsetValueType offset = self->m_ResampledPixels[ j ];
+    PointType             point;
+    fixedImage->TransformIndexToPhysicalPoint( fixedImage->ComputeIndex( offset ), point );
+    const MovingPointType mappedPoint = self->m_Transform->TransformPoint( point );
+
+    ContinuousIndexType cindex;
+    movingImage->TransformPhysicalPointToContinuousIndex( mappedPoint, cindex );
+
+    RealType value = NumericTraits< RealType >::Zero;
+    if( interpolator->IsInsideBuffer( cindex ) )
+    {
+      value = interpolator->EvaluateAtContinuousIndex( cindex );
+      value = std::min( std::max( value, minValue ), maxValue );
+    }
+    self->m_ResampledValues[ offset ]
+      = static_cast< RealType >( static_cast< FixedImagePixelType >( value ) );
+  }
+
+} // end ResampleRangeFunction()
+
+
+/**
+ * ******************* GradientRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::GradientRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  Self *           self   = static_cast< Self * >( userData );
+  const RealType * values = &self->m_ResampledValues[ 0 ];
+
+  for( SizeValueType s = begin; s < end; ++s )
+  {
+    const IndexType & index = self->m_SampleIndices[ s ];
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      const SobelStencilType & stencil  = self->m_SobelStencils[ d ];
+      RealType                 gradient = NumericTraits< RealType >::Zero;
+      for( std::size_t k = 0; k < stencil.size(); ++k )
+      {
+        gradient += stencil[ k ].second
+          * values[ self->ComputeClampedOffset( index, stencil[ k ].first ) ];
+      }
+      self->m_Gradients[ s ][ d ] = gradient;
+    }
+  }
+
+} // end GradientRangeFunction()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+MovedImageGradientSampler< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "NumberOfSamples: " << this->m_SampleIndices.size() << std::endl;
+  os << indent << "NumberOfResampledPixels: " << this->m_ResampledPixels.size() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMovedImageGradientSampler_hxx
@@ -0,0 +1,94 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkMultiCandidateCostFunction_h
+#define __itkMultiCandidateCostFunction_h
+
+#include "itkSingleValuedCostFunction.h"
+
+#include <vector>
+
+namespace itk
+{
+/**
+ * \class MultiCandidateCostFunction
+ * \brief An interface for cost functions that can evaluate several
+ * parameter vectors at once.
+ *
+ * Population based and perturbation based optimizers, such as CMA-ES and
+ * finite difference gradient descent, need the value of the cost function
+ * for a number of candidate parameter vectors in every iteration. Evaluating
+ * them one at a time means that the data of the cost function (e.g. the fixed
+ * image samples of an image metric) is read once per candidate. Cost functions
+ * that implement this interface get all candidates in a single call to
+ * GetValues(), so that they can sweep over their data only once.
+ *
+ * This is a pure interface, meant to be inherited in addition to a
+ * SingleValuedCostFunction. Use the static function GetValues( costFunction, ... )
+ * to call it on any cost function; cost functions that do not implement
+ * the interface are evaluated one candidate at a time.
+ *
+ * \ingroup Numerics
+ */
+
+class MultiCandidateCostFunction
+{
+public:
+
+  /** Typedefs. */
+  typedef SingleValuedCostFunction::MeasureType    MeasureType;
+  typedef SingleValuedCostFunction::ParametersType ParametersType;
+  typedef std::vector< ParametersType >            ParametersArrayType;
+  typedef std::vector< MeasureType >               MeasureArrayType;
+
+  /** Compute the values for all parameter vectors in parametersArray. */
+  virtual void GetValues( const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const = 0;
+
+  /** Compute the values of a cost function for all parameter vectors, using
+   * the interface above if the cost function implements it.
+   */
+  static void GetValues( const SingleValuedCostFunction * costFunction,
+    const ParametersArrayType & parametersArray, MeasureArrayType & values )
+  {
+    const MultiCandidateCostFunction * multiCandidateCostFunction
+      = dynamic_cast< const MultiCandidateCostFunction * >( costFunction );
+    if( multiCandidateCostFunction != 0 )
+    {
+      multiCandidateCostFunction->GetValues( parametersArray, values );
+      return;
+    }
+
+    values.resize( parametersArray.size() );
+    for( std::size_t k = 0; k < parametersArray.size(); ++k )
+    {
+      values[ k ] = costFunction->GetValue( parametersArray[ k ] );
+    }
+  }
+
+
+protected:
+
+  MultiCandidateCostFunction() {}
+  virtual ~MultiCandidateCostFunction() {}
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMultiCandidateCostFunction_h
@@ -21,6 +21,8 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkKernelFunctionBase2.h"
 
+#include <vector>
+
 
 namespace itk
 {
@@ -196,6 +198,44 @@ public:
   itkGetConstReferenceMacro( UseExplicitPDFDerivatives, bool );
   itkBooleanMacro( UseExplicitPDFDerivatives );
 
+  /** Option to store the explicit PDF derivatives sparsely. Only the blocks
+   * of SparsePDFDerivativesBlockSize parameters that are touched by a joint
+   * histogram bin are allocated, instead of the full number of parameters
+   * per bin. For transforms with a local support, such as the B-spline
+   * transform, this needs much less memory, while the computed derivatives
+   * are equal. Only used when UseExplicitPDFDerivatives is true; default: false.
+   * This option should be set before calling Initialize().
+   */
+  itkSetMacro( UseSparseExplicitPDFDerivatives, bool );
+  itkGetConstReferenceMacro( UseSparseExplicitPDFDerivatives, bool );
+  itkBooleanMacro( UseSparseExplicitPDFDerivatives );
+
+  /** Option to evaluate the Parzen kernels of B-spline order two and three
+   * by interpolation in a precomputed table of their weights, instead of
+   * evaluating the B-spline polynomials for every sample. The interpolation
+   * error of the weights is in the order of 1e-7. Default: false.
+   * This option should be set before calling Initialize().
+   */
+  itkSetMacro( UseParzenKernelLookupTable, bool );
+  itkGetConstMacro( UseParzenKernelLookupTable, bool );
+  itkBooleanMacro( UseParzenKernelLookupTable );
+
+  /** Option to compute the fixed image side of the Parzen window, the lowest
+   * affected fixed histogram bin and the fixed kernel values, once per sample
+   * when the samples change, instead of for every sample in every iteration.
+   * With a grid or full sampler this happens once per resolution. The cache
+   * takes one index and FixedKernelBSplineOrder + 1 doubles per sample.
+   * Default: true.
+   */
+  itkSetMacro( UseFixedParzenValueCache, bool );
+  itkGetConstMacro( UseFixedParzenValueCache, bool );
+  itkBooleanMacro( UseFixedParzenValueCache );
+
+  /** The number of consecutive parameters stored in one block of the sparse
+   * PDF derivatives; 16 floats fill one cache line.
+   */
+  itkStaticConstMacro( SparsePDFDerivativesBlockSize, unsigned int, 16 );
+
   /** Whether you plan to call the GetDerivative/GetValueAndDerivative method or not.
    * This option should be set before calling Initialize(); Default: false.
    */
@@ -215,6 +255,11 @@ public:
   itkSetMacro( FiniteDifferencePerturbation, double );
   itkGetConstMacro( FiniteDifferencePerturbation, double );
 
+  /** Adds the histograms, the joint PDF derivatives and the per thread joint
+   * PDFs to the work memory of the superclass.
+   */
+  SizeValueType GetWorkMemorySize( void ) const ITK_OVERRIDE;
+
 protected:
 
   /** The constructor. */
@@ -262,6 +307,13 @@ protected:
   typedef IncrementalMarginalPDFType::SizeType         IncrementalMarginalPDFSizeType;
   typedef Array< PDFValueType >                        ParzenValueContainerType;
 
+  /** Typedefs for the sparse PDF derivatives. The block index container has an
+   * entry for every (joint histogram bin, parameter block) pair, storing the
+   * block number + 1 in the value container, or zero when not allocated.
+   */
+  typedef std::vector< PDFDerivativeValueType >        SparsePDFDerivativesValueContainerType;
+  typedef std::vector< unsigned int >                  SparsePDFDerivativesBlockIndexContainerType;
+
   /** Typedefs for Parzen kernel. */
   typedef KernelFunctionBase2< PDFValueType >  KernelFunctionType;
   typedef typename KernelFunctionType::Pointer KernelFunctionPointer;
@@ -278,6 +330,9 @@ protected:
   mutable MarginalPDFType       m_MovingImageMarginalPDF;
   JointPDFPointer               m_JointPDF;
   JointPDFDerivativesPointer    m_JointPDFDerivatives;
+  mutable SparsePDFDerivativesValueContainerType      m_SparseJointPDFDerivativesValues;
+  mutable SparsePDFDerivativesBlockIndexContainerType m_SparseJointPDFDerivativesBlockIndex;
+  SizeValueType                                       m_NumberOfSparsePDFDerivativesBlocks;
   JointPDFDerivativesPointer    m_IncrementalJointPDFRight;
   JointPDFDerivativesPointer    m_IncrementalJointPDFLeft;
   IncrementalMarginalPDFPointer m_FixedIncrementalMarginalPDFRight;
@@ -336,6 +391,25 @@ protected:
   /** Helper function to launch the threads. */
   void LaunchComputePDFsThreaderCallback( void ) const;
 
+  /** Reduce the thread-private joint histograms for the bins [begin, end). */
+  static void ReduceJointPDFsRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Helper struct for the multi-threaded computation of the incremental marginal pdfs. */
+  struct IncrementalMarginalPDFsThreaderParameterType
+  {
+    const PDFDerivativeValueType * st_IncrementalPDF;
+    PDFValueType *                 st_FixedIncrementalMarginalPDF;
+    PDFValueType *                 st_MovingIncrementalMarginalPDF;
+    SizeValueType                  st_NumberOfFixedBins;
+    SizeValueType                  st_NumberOfMovingBins;
+    SizeValueType                  st_NumberOfParameters;
+  };
+
+  /** Compute the incremental marginal pdfs for the parameters [begin, end). */
+  static void ComputeIncrementalMarginalPDFsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
   /** Compute the Parzen values given an image value and a starting histogram index
    * Compute the values at (parzenWindowIndex - parzenWindowTerm + k) for
    * k = 0 ... kernelsize-1
@@ -347,16 +421,74 @@ protected:
     const KernelFunctionType * kernel,
     ParzenValueContainerType & parzenValues ) const;
 
-  /** Update the joint PDF with a pixel pair; on demand also updates the
-   * pdf derivatives (if the Jacobian pointers are nonzero).
+  /** Compute the lowest affected fixed histogram bin and the fixed Parzen
+   * values of a limited fixed image value. The values array should have
+   * room for FixedKernelBSplineOrder + 1 values.
+   */
+  void ComputeFixedParzenValues( const RealType & fixedImageValue,
+    OffsetValueType & fixedParzenWindowIndex, PDFValueType * fixedParzenValues ) const;
+
+  /** Get the lowest affected fixed histogram bin and the fixed Parzen values
+   * of sample \a sampleIndex: from the cache if it is valid, and otherwise
+   * computed into \a buffer from the unlimited fixed image value.
+   */
+  const PDFValueType * GetFixedParzenValues( const SizeValueType sampleIndex,
+    const RealType & fixedImageValue, OffsetValueType & fixedParzenWindowIndex,
+    ParzenValueContainerType & buffer ) const
+  {
+    if( this->m_FixedParzenValueCacheIsValid )
+    {
+      fixedParzenWindowIndex = this->m_FixedParzenWindowIndices[ sampleIndex ];
+      return &( this->m_FixedParzenValues[ sampleIndex * this->m_JointPDFWindow.GetSize()[ 1 ] ] );
+    }
+    this->ComputeFixedParzenValues( this->GetFixedImageLimiter()->Evaluate( fixedImageValue ),
+      fixedParzenWindowIndex, buffer.data_block() );
+    return buffer.data_block();
+  }
+
+
+  /** (Re)compute the cached fixed Parzen values if the samples changed,
+   * after the superclass updated its fixed sample features.
+   */
+  virtual void UpdateFixedSampleFeatureCache( void ) const;
+
+  /** Static range function that computes the fixed Parzen values of a range of samples. */
+  static void ComputeFixedParzenValuesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The cache of the fixed Parzen values of the samples. */
+  mutable bool                             m_FixedParzenValueCacheIsValid;
+  mutable const ImageSampleContainerType * m_FixedParzenValueCacheContainer;
+  mutable ModifiedTimeType                 m_FixedParzenValueCacheMTime;
+  mutable std::vector< OffsetValueType >   m_FixedParzenWindowIndices;
+  mutable std::vector< PDFValueType >      m_FixedParzenValues;
+
+  /** Update the joint PDF with a pixel pair, given by the fixed Parzen window
+   * and the moving image value; on demand also updates the pdf derivatives
+   * (if the Jacobian pointers are nonzero).
    */
   virtual void UpdateJointPDFAndDerivatives(
-    const RealType & fixedImageValue,
+    const OffsetValueType fixedParzenWindowIndex,
+    const PDFValueType * fixedParzenValues,
     const RealType & movingImageValue,
     const DerivativeType * imageJacobian,
     const NonZeroJacobianIndicesType * nzji,
     JointPDFType * jointPDF ) const;
 
+  /** The number of pixel pairs that ComputePDFs() collects before it limits
+   * them with one call to each limiter.
+   */
+  itkStaticConstMacro( LimiterBlockSize, unsigned int, 64 );
+
+  /** Limit a block of \a n pixel pairs, with one call to each limiter, and
+   * update the joint PDF with them. The values are overwritten by their
+   * limited versions. The fixed image values are not used when the fixed
+   * Parzen values of the samples with the given indices are cached.
+   */
+  void UpdateJointPDFWithBlock( const unsigned int n, const SizeValueType * sampleIndices,
+    RealType * fixedImageValues, RealType * movingImageValues,
+    JointPDFType * jointPDF ) const;
+
   /** Update the joint PDF and the incremental pdfs.
    * The input is a pixel pair (fixed, moving, moving mask) and
    * a set of moving image/mask values when using mu+delta*e_k, for
@@ -385,6 +517,17 @@ protected:
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji ) const;
 
+  /** Update the sparse pdf derivatives, the counterpart of UpdateJointPDFDerivatives
+   * when UseSparseExplicitPDFDerivatives is true. Blocks are allocated on first use.
+   */
+  void UpdateSparseJointPDFDerivatives(
+    const JointPDFIndexType & pdfIndex, double factor,
+    const DerivativeType & imageJacobian,
+    const NonZeroJacobianIndicesType & nzji ) const;
+
+  /** Set all sparse pdf derivatives to zero, by releasing all blocks. */
+  void ResetSparseJointPDFDerivatives( void ) const;
+
   /** Multiply the pdf entries by the given normalization factor. */
   virtual void NormalizeJointPDF(
     JointPDFType * pdf, const double & factor ) const;
@@ -495,6 +638,9 @@ private:
   unsigned int  m_MovingKernelBSplineOrder;
   bool          m_UseDerivative;
   bool          m_UseExplicitPDFDerivatives;
+  bool          m_UseSparseExplicitPDFDerivatives;
+  bool          m_UseParzenKernelLookupTable;
+  bool          m_UseFixedParzenValueCache;
   bool          m_UseFiniteDifferenceDerivative;
   double        m_FiniteDifferencePerturbation;
 
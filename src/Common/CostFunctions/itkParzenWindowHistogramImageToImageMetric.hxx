@@ -22,10 +22,13 @@
 
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkKernelLookupTableFunction.h"
 #include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageScanlineIterator.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -67,7 +70,15 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   this->SetUseFixedImageLimiter( true );
   this->SetUseMovingImageLimiter( true );
 
-  this->m_UseExplicitPDFDerivatives = true;
+  this->m_UseExplicitPDFDerivatives          = true;
+  this->m_UseSparseExplicitPDFDerivatives    = false;
+  this->m_UseParzenKernelLookupTable         = false;
+  this->m_UseFixedParzenValueCache           = true;
+  this->m_NumberOfSparsePDFDerivativesBlocks = 0;
+
+  this->m_FixedParzenValueCacheIsValid   = false;
+  this->m_FixedParzenValueCacheContainer = 0;
+  this->m_FixedParzenValueCacheMTime     = 0;
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters */
   this->m_ParzenWindowHistogramThreaderParameters.m_Metric = this;
@@ -112,6 +123,10 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_FixedKernelBSplineOrder << std::endl;
   os << indent << "MovingKernelBSplineOrder: "
      << this->m_MovingKernelBSplineOrder << std::endl;
+  os << indent << "UseParzenKernelLookupTable: "
+     << this->m_UseParzenKernelLookupTable << std::endl;
+  os << indent << "UseFixedParzenValueCache: "
+     << this->m_UseFixedParzenValueCache << std::endl;
 
   /*double m_MovingImageNormalizedMin;
   double m_FixedImageNormalizedMin;
@@ -147,6 +162,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Set up the Parzen windows. */
   this->InitializeKernels();
 
+  /** The bins and kernels may have changed, so the cached fixed Parzen values are invalid. */
+  this->m_FixedParzenValueCacheIsValid   = false;
+  this->m_FixedParzenValueCacheContainer = 0;
+  this->m_FixedParzenWindowIndices.clear();
+  this->m_FixedParzenValues.clear();
+
   /** If the user plans to use a finite difference derivative,
    * allocate some memory for the perturbed alpha variables.
    */
@@ -334,9 +355,25 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
         this->m_IncrementalJointPDFRight = 0;
         this->m_IncrementalJointPDFLeft  = 0;
 
-        this->m_JointPDFDerivatives = JointPDFDerivativesType::New();
-        this->m_JointPDFDerivatives->SetRegions( jointPDFDerivativesRegion );
-        this->m_JointPDFDerivatives->Allocate();
+        if( this->m_UseSparseExplicitPDFDerivatives )
+        {
+          /** Only allocate the block index; blocks are added on demand. */
+          this->m_JointPDFDerivatives = 0;
+
+          const unsigned int blockSize = SparsePDFDerivativesBlockSize;
+          this->m_NumberOfSparsePDFDerivativesBlocks
+            = ( this->GetNumberOfParameters() + blockSize - 1 ) / blockSize;
+          this->m_SparseJointPDFDerivativesBlockIndex.assign(
+            this->m_NumberOfSparsePDFDerivativesBlocks
+            * this->m_NumberOfMovingHistogramBins * this->m_NumberOfFixedHistogramBins, 0 );
+          this->m_SparseJointPDFDerivativesValues.clear();
+        }
+        else
+        {
+          this->m_JointPDFDerivatives = JointPDFDerivativesType::New();
+          this->m_JointPDFDerivatives->SetRegions( jointPDFDerivativesRegion );
+          this->m_JointPDFDerivatives->Allocate();
+        }
       }
       else
       {
@@ -438,6 +475,33 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   this->m_MovingParzenTermToIndexOffset
     = 0.5 - static_cast< double >( this->m_MovingKernelBSplineOrder ) / 2.0;
 
+  /** Replace the kernels by tabulated versions. The kernels are evaluated at
+   * u = ParzenIndex - ParzenTerm, which lies in ( offset - 1, offset ].
+   * Kernels of order lower than two are cheap or not continuous.
+   */
+  if( this->m_UseParzenKernelLookupTable )
+  {
+    if( this->m_FixedKernelBSplineOrder > 1 )
+    {
+      KernelLookupTableFunction::Pointer fixedTable = KernelLookupTableFunction::New();
+      fixedTable->SetKernel( this->m_FixedKernel, parzenWindowSize[ 1 ],
+        this->m_FixedParzenTermToIndexOffset - 1.0 );
+      this->m_FixedKernel = fixedTable;
+    }
+    if( this->m_MovingKernelBSplineOrder > 1 )
+    {
+      KernelLookupTableFunction::Pointer movingTable = KernelLookupTableFunction::New();
+      movingTable->SetKernel( this->m_MovingKernel, parzenWindowSize[ 0 ],
+        this->m_MovingParzenTermToIndexOffset - 1.0 );
+      this->m_MovingKernel = movingTable;
+
+      KernelLookupTableFunction::Pointer derivativeTable = KernelLookupTableFunction::New();
+      derivativeTable->SetKernel( this->m_DerivativeMovingKernel, parzenWindowSize[ 0 ],
+        this->m_MovingParzenTermToIndexOffset - 1.0 );
+      this->m_DerivativeMovingKernel = derivativeTable;
+    }
+  }
+
 } // end InitializeKernels()
 
 
@@ -498,6 +562,49 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ********************* GetWorkMemorySize ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::GetWorkMemorySize( void ) const
+{
+  SizeValueType bytes = Superclass::GetWorkMemorySize();
+
+  /** The histograms and their derivatives. */
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_JointPDF.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_JointPDFDerivatives.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_IncrementalJointPDFRight.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_IncrementalJointPDFLeft.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_FixedIncrementalMarginalPDFRight.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_MovingIncrementalMarginalPDFRight.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_FixedIncrementalMarginalPDFLeft.GetPointer() );
+  bytes += MemoryAccounting::GetImageBufferSize( this->m_MovingIncrementalMarginalPDFLeft.GetPointer() );
+  bytes += this->m_SparseJointPDFDerivativesValues.capacity() * sizeof( PDFDerivativeValueType );
+  bytes += this->m_SparseJointPDFDerivativesBlockIndex.capacity() * sizeof( unsigned int );
+  bytes += ( this->m_PerturbedAlphaRight.Size() + this->m_PerturbedAlphaLeft.Size() )
+    * sizeof( DerivativeValueType );
+  bytes += this->m_FixedParzenWindowIndices.capacity() * sizeof( OffsetValueType );
+  bytes += this->m_FixedParzenValues.capacity() * sizeof( PDFValueType );
+
+  /** The per thread joint PDFs. */
+  for( std::size_t i = 0; i < this->m_ThreaderJointPDFs.size(); ++i )
+  {
+    bytes += MemoryAccounting::GetImageBufferSize( this->m_ThreaderJointPDFs[ i ].GetPointer() );
+  }
+  for( ThreadIdType i = 0; i < this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    bytes += MemoryAccounting::GetImageBufferSize(
+      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF.GetPointer() );
+  }
+
+  return bytes;
+
+} // end GetWorkMemorySize()
+
+
 /**
  * ******************** GetDerivative ***************************
  */
@@ -552,6 +659,107 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateParzenValues()
 
 
+/**
+ * ********************** ComputeFixedParzenValues ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedParzenValues( const RealType & fixedImageValue,
+  OffsetValueType & fixedParzenWindowIndex, PDFValueType * fixedParzenValues ) const
+{
+  /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]),
+   * and the lowest bin number affected by this pixel.
+   */
+  const double fixedImageParzenWindowTerm
+    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  fixedParzenWindowIndex = static_cast< OffsetValueType >( vcl_floor(
+    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+
+  this->m_FixedKernel->Evaluate( static_cast< double >( fixedParzenWindowIndex )
+    - fixedImageParzenWindowTerm, fixedParzenValues );
+
+} // end ComputeFixedParzenValues()
+
+
+/**
+ * ********************** UpdateFixedSampleFeatureCache ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateFixedSampleFeatureCache( void ) const
+{
+  this->Superclass::UpdateFixedSampleFeatureCache();
+
+  if( !this->m_UseFixedParzenValueCache || !this->GetUseImageSampler() )
+  {
+    this->m_FixedParzenValueCacheIsValid = false;
+    return;
+  }
+
+  /** Nothing to do if the samples have not changed. */
+  const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
+  if( this->m_FixedParzenValueCacheIsValid
+    && this->m_FixedParzenValueCacheContainer == sampleContainer
+    && this->m_FixedParzenValueCacheMTime == sampleContainer->GetMTime()
+    && this->m_FixedParzenWindowIndices.size() == sampleContainer->Size() )
+  {
+    return;
+  }
+
+  /** Allocate memory. */
+  const SizeValueType numberOfSamples = sampleContainer->Size();
+  this->m_FixedParzenWindowIndices.resize( numberOfSamples );
+  this->m_FixedParzenValues.resize( numberOfSamples * this->m_JointPDFWindow.GetSize()[ 1 ] );
+
+  /** Compute the fixed Parzen values of all samples. */
+  const SizeValueType grainSize = 1024;
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor( numberOfSamples, grainSize,
+      Self::ComputeFixedParzenValuesRangeFunction, const_cast< Self * >( this ) );
+  }
+  else
+  {
+    Self::ComputeFixedParzenValuesRangeFunction(
+      const_cast< Self * >( this ), 0, 0, numberOfSamples );
+  }
+
+  this->m_FixedParzenValueCacheIsValid   = true;
+  this->m_FixedParzenValueCacheContainer = sampleContainer;
+  this->m_FixedParzenValueCacheMTime     = sampleContainer->GetMTime();
+
+} // end UpdateFixedSampleFeatureCache()
+
+
+/**
+ * ********************** ComputeFixedParzenValuesRangeFunction ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedParzenValuesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const Self * metric = static_cast< const Self * >( userData );
+  const ImageSampleContainerType * sampleContainer = metric->GetImageSampler()->GetOutput();
+  const SizeValueType windowSize = metric->m_JointPDFWindow.GetSize()[ 1 ];
+
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    const RealType fixedImageValue = metric->GetFixedImageLimiter()->Evaluate(
+      static_cast< RealType >( sampleContainer->ElementAt( i ).m_ImageValue ) );
+    metric->ComputeFixedParzenValues( fixedImageValue,
+      metric->m_FixedParzenWindowIndices[ i ], &( metric->m_FixedParzenValues[ i * windowSize ] ) );
+  }
+
+} // end ComputeFixedParzenValuesRangeFunction()
+
+
 /**
  * ********************** UpdateJointPDFAndDerivatives ***************
  */
@@ -560,7 +768,8 @@ template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateJointPDFAndDerivatives(
-  const RealType & fixedImageValue,
+  const OffsetValueType fixedImageParzenWindowIndex,
+  const PDFValueType * fixedParzenValues,
   const RealType & movingImageValue,
   const DerivativeType * imageJacobian,
   const NonZeroJacobianIndicesType * nzji,
@@ -568,26 +777,18 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 {
   typedef ImageScanlineIterator< JointPDFType > PDFIteratorType;
 
-  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
-  const double fixedImageParzenWindowTerm
-    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  /** Determine the moving Parzen window argument (see eq. 6 of Mattes paper [2]). */
   const double movingImageParzenWindowTerm
     = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
-  /** The lowest bin numbers affected by this pixel: */
-  const OffsetValueType fixedImageParzenWindowIndex
-    = static_cast< OffsetValueType >( vcl_floor(
-    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+  /** The lowest moving bin number affected by this pixel: */
   const OffsetValueType movingImageParzenWindowIndex
     = static_cast< OffsetValueType >( vcl_floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** The Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+  /** The moving Parzen values. */
+  const unsigned int       fixedWindowSize = this->m_JointPDFWindow.GetSize()[ 1 ];
   ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
-    this->m_FixedKernel, fixedParzenValues );
   this->EvaluateParzenValues(
     movingImageParzenWindowTerm, movingImageParzenWindowIndex,
     this->m_MovingKernel, movingParzenValues );
@@ -607,7 +808,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   if( !imageJacobian )
   {
     /** Loop over the Parzen window region and increment the values. */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+    for( unsigned int f = 0; f < fixedWindowSize; ++f )
     {
       const double fv = fixedParzenValues[ f ];
       for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
@@ -632,16 +833,25 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     /** Loop over the Parzen window region and increment the values
      * Also update the pdf derivatives.
      */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+    for( unsigned int f = 0; f < fixedWindowSize; ++f )
     {
       const double fv    = fixedParzenValues[ f ];
       const double fv_et = fv / et;
       for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
       {
         it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
-        this->UpdateJointPDFDerivatives(
-          it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
-          *imageJacobian, *nzji );
+        if( this->m_UseSparseExplicitPDFDerivatives )
+        {
+          this->UpdateSparseJointPDFDerivatives(
+            it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
+            *imageJacobian, *nzji );
+        }
+        else
+        {
+          this->UpdateJointPDFDerivatives(
+            it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
+            *imageJacobian, *nzji );
+        }
         ++it;
       }
       it.NextLine();
@@ -651,6 +861,49 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end UpdateJointPDFAndDerivatives()
 
 
+/**
+ * ******************* UpdateJointPDFWithBlock *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateJointPDFWithBlock( const unsigned int n, const SizeValueType * sampleIndices,
+  RealType * fixedImageValues, RealType * movingImageValues,
+  JointPDFType * jointPDF ) const
+{
+  /** Make sure the values fall within the histogram range. */
+  this->GetMovingImageLimiter()->EvaluateBatch( n, movingImageValues, movingImageValues );
+
+  /** Compute the contribution of each pair to the joint distributions. */
+  OffsetValueType fixedParzenWindowIndex;
+  if( this->m_FixedParzenValueCacheIsValid )
+  {
+    const SizeValueType fixedWindowSize = this->m_JointPDFWindow.GetSize()[ 1 ];
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      fixedParzenWindowIndex = this->m_FixedParzenWindowIndices[ sampleIndices[ i ] ];
+      this->UpdateJointPDFAndDerivatives( fixedParzenWindowIndex,
+        &( this->m_FixedParzenValues[ sampleIndices[ i ] * fixedWindowSize ] ),
+        movingImageValues[ i ], 0, 0, jointPDF );
+    }
+  }
+  else
+  {
+    this->GetFixedImageLimiter()->EvaluateBatch( n, fixedImageValues, fixedImageValues );
+    ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      this->ComputeFixedParzenValues( fixedImageValues[ i ],
+        fixedParzenWindowIndex, fixedParzenValues.data_block() );
+      this->UpdateJointPDFAndDerivatives( fixedParzenWindowIndex,
+        fixedParzenValues.data_block(), movingImageValues[ i ], 0, 0, jointPDF );
+    }
+  }
+
+} // end UpdateJointPDFWithBlock()
+
+
 /**
  * *************** UpdateJointPDFDerivatives ***************************
  */
@@ -693,6 +946,77 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end UpdateJointPDFDerivatives()
 
 
+/**
+ * *************** UpdateSparseJointPDFDerivatives ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateSparseJointPDFDerivatives(
+  const JointPDFIndexType & pdfIndex, double factor,
+  const DerivativeType & imageJacobian,
+  const NonZeroJacobianIndicesType & nzji ) const
+{
+  const unsigned int blockSize = SparsePDFDerivativesBlockSize;
+
+  /** Get the block index entries of the bin [pdfIndex[0], pdfIndex[1]].
+   * The bins are ordered as in the dense m_JointPDFDerivatives.
+   */
+  const SizeValueType bin = pdfIndex[ 0 ]
+    + pdfIndex[ 1 ] * this->m_NumberOfMovingHistogramBins;
+  unsigned int * blockIndex = &( this->m_SparseJointPDFDerivativesBlockIndex[ 0 ] )
+    + bin * this->m_NumberOfSparsePDFDerivativesBlocks;
+
+  /** Loop over the non-zero Jacobians. The indices are mostly increasing, so
+   * the block pointer is only looked up when the block changes.
+   */
+  const bool               allParameters = nzji.size() == this->GetNumberOfParameters();
+  unsigned int             currentBlock  = NumericTraits< unsigned int >::max();
+  PDFDerivativeValueType * blockPtr      = 0;
+  for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+  {
+    const unsigned int mu    = allParameters ? i : nzji[ i ];
+    const unsigned int block = mu / blockSize;
+    if( block != currentBlock )
+    {
+      /** Allocate a zero-filled block on first use. */
+      if( blockIndex[ block ] == 0 )
+      {
+        const SizeValueType numberOfBlocks
+          = this->m_SparseJointPDFDerivativesValues.size() / blockSize;
+        this->m_SparseJointPDFDerivativesValues.resize(
+          ( numberOfBlocks + 1 ) * blockSize, NumericTraits< PDFDerivativeValueType >::ZeroValue() );
+        blockIndex[ block ] = static_cast< unsigned int >( numberOfBlocks + 1 );
+      }
+      currentBlock = block;
+      blockPtr     = &( this->m_SparseJointPDFDerivativesValues[ 0 ] )
+        + ( blockIndex[ block ] - 1 ) * blockSize;
+    }
+    blockPtr[ mu - block * blockSize ]
+      -= static_cast< PDFDerivativeValueType >( imageJacobian[ i ] * factor );
+  }
+
+} // end UpdateSparseJointPDFDerivatives()
+
+
+/**
+ * *************** ResetSparseJointPDFDerivatives ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ResetSparseJointPDFDerivatives( void ) const
+{
+  /** Keep the capacity of the value container, to avoid reallocations. */
+  std::fill( this->m_SparseJointPDFDerivativesBlockIndex.begin(),
+    this->m_SparseJointPDFDerivativesBlockIndex.end(), 0 );
+  this->m_SparseJointPDFDerivativesValues.clear();
+
+} // end ResetSparseJointPDFDerivatives()
+
+
 /**
  * *********************** NormalizeJointPDF ***********************
  */
@@ -788,43 +1112,76 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   IncrementalMarginalPDFType * fixedIncrementalMarginalPDF,
   IncrementalMarginalPDFType * movingIncrementalMarginalPDF ) const
 {
-  typedef itk::ImageRegionConstIterator< JointPDFDerivativesType >        IncIteratorType;
-  typedef itk::ImageLinearIteratorWithIndex< IncrementalMarginalPDFType > IncMargIteratorType;
+  /** Every thread computes the incremental marginal pdfs for a range of
+   * parameters, so that no synchronization is needed between the threads.
+   */
+  IncrementalMarginalPDFsThreaderParameterType temp;
+  temp.st_IncrementalPDF               = incrementalPDF->GetBufferPointer();
+  temp.st_FixedIncrementalMarginalPDF  = fixedIncrementalMarginalPDF->GetBufferPointer();
+  temp.st_MovingIncrementalMarginalPDF = movingIncrementalMarginalPDF->GetBufferPointer();
+  temp.st_NumberOfFixedBins            = this->m_NumberOfFixedHistogramBins;
+  temp.st_NumberOfMovingBins           = this->m_NumberOfMovingHistogramBins;
+  temp.st_NumberOfParameters           = this->GetNumberOfParameters();
+
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor( temp.st_NumberOfParameters, 0,
+      this->ComputeIncrementalMarginalPDFsRangeFunction, &temp );
+  }
+  else
+  {
+    this->ComputeIncrementalMarginalPDFsRangeFunction( &temp, 0, 0, temp.st_NumberOfParameters );
+  }
+
+} // end ComputeIncrementalMarginalPDFs()
+
 
-  fixedIncrementalMarginalPDF->FillBuffer( itk::NumericTraits< PDFValueType >::ZeroValue() );
-  movingIncrementalMarginalPDF->FillBuffer( itk::NumericTraits< PDFValueType >::ZeroValue() );
+/**
+ * ******************** ComputeIncrementalMarginalPDFsRangeFunction *******************
+ */
 
-  IncIteratorType     incit( incrementalPDF, incrementalPDF->GetLargestPossibleRegion() );
-  IncMargIteratorType fixincit( fixedIncrementalMarginalPDF,
-  fixedIncrementalMarginalPDF->GetLargestPossibleRegion() );
-  IncMargIteratorType movincit( movingIncrementalMarginalPDF,
-  movingIncrementalMarginalPDF->GetLargestPossibleRegion() );
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeIncrementalMarginalPDFsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  IncrementalMarginalPDFsThreaderParameterType * temp
+    = static_cast< IncrementalMarginalPDFsThreaderParameterType * >( userData );
+  const SizeValueType numberOfParameters = temp->st_NumberOfParameters;
 
-  incit.GoToBegin();
-  fixincit.GoToBegin();
-  movincit.GoToBegin();
+  /** Reset the parameter range [begin, end) of the incremental marginal pdfs. */
+  for( SizeValueType f = 0; f < temp->st_NumberOfFixedBins; ++f )
+  {
+    PDFValueType * fixinc = temp->st_FixedIncrementalMarginalPDF + f * numberOfParameters;
+    std::fill( fixinc + begin, fixinc + end, NumericTraits< PDFValueType >::ZeroValue() );
+  }
+  for( SizeValueType m = 0; m < temp->st_NumberOfMovingBins; ++m )
+  {
+    PDFValueType * movinc = temp->st_MovingIncrementalMarginalPDF + m * numberOfParameters;
+    std::fill( movinc + begin, movinc + end, NumericTraits< PDFValueType >::ZeroValue() );
+  }
 
-  /** Loop over the incremental pdf and update the incremental marginal pdfs. */
-  for( unsigned int f = 0; f < this->m_NumberOfFixedHistogramBins; ++f )
+  /** Loop over the incremental pdf and update the incremental marginal pdfs.
+   * The incremental pdf has size [ parameters, moving bins, fixed bins ].
+   */
+  const PDFDerivativeValueType * inc = temp->st_IncrementalPDF;
+  for( SizeValueType f = 0; f < temp->st_NumberOfFixedBins; ++f )
   {
-    for( unsigned int m = 0; m < this->m_NumberOfMovingHistogramBins; ++m )
+    PDFValueType * fixinc = temp->st_FixedIncrementalMarginalPDF + f * numberOfParameters;
+    for( SizeValueType m = 0; m < temp->st_NumberOfMovingBins; ++m )
     {
-      for( unsigned int p = 0; p < this->GetNumberOfParameters(); ++p )
+      PDFValueType * movinc = temp->st_MovingIncrementalMarginalPDF + m * numberOfParameters;
+      for( SizeValueType p = begin; p < end; ++p )
       {
-        fixincit.Value() += incit.Get();
-        movincit.Value() += incit.Get();
-        ++incit;
-        ++fixincit;
-        ++movincit;
+        fixinc[ p ] += inc[ p ];
+        movinc[ p ] += inc[ p ];
       }
-      fixincit.GoToBeginOfLine();
-      movincit.NextLine();
+      inc += numberOfParameters;
     }
-    fixincit.NextLine();
-    movincit.GoToBegin();
   }
 
-} // end ComputeIncrementalMarginalPDFs()
+} // end ComputeIncrementalMarginalPDFsRangeFunction()
 
 
 /**
@@ -1053,6 +1410,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
+  /** The pixel pairs are collected in blocks, which are limited at once. */
+  SizeValueType sampleIndices[ LimiterBlockSize ];
+  RealType      fixedImageValues[ LimiterBlockSize ];
+  RealType      movingImageValues[ LimiterBlockSize ];
+  unsigned int  numberOfBlockValues = 0;
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -1083,20 +1446,28 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
-
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
+      /** Store the sample index and the fixed and moving image value. */
+      sampleIndices[ numberOfBlockValues ]    = fiter.Index();
+      fixedImageValues[ numberOfBlockValues ]
+        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      movingImageValues[ numberOfBlockValues ] = movingImageValue;
+      ++numberOfBlockValues;
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, 0, 0, this->m_JointPDF.GetPointer() );
+      /** Compute the contribution of a full block to the joint distributions. */
+      if( numberOfBlockValues == LimiterBlockSize )
+      {
+        this->UpdateJointPDFWithBlock( numberOfBlockValues, sampleIndices,
+          fixedImageValues, movingImageValues, this->m_JointPDF.GetPointer() );
+        numberOfBlockValues = 0;
+      }
     }
 
   } // end iterating over fixed image spatial sample container for loop
 
+  /** Compute the contribution of the last block. */
+  this->UpdateJointPDFWithBlock( numberOfBlockValues, sampleIndices,
+    fixedImageValues, movingImageValues, this->m_JointPDF.GetPointer() );
+
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
@@ -1115,6 +1486,8 @@ void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputePDFs( const ParametersType & parameters ) const
 {
+  itkPhaseTimerMacro( "ComputePDFs" );
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -1185,6 +1558,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
 
+  /** The pixel pairs are collected in blocks, which are limited at once. */
+  SizeValueType sampleIndices[ LimiterBlockSize ];
+  RealType      fixedImageValues[ LimiterBlockSize ];
+  RealType      movingImageValues[ LimiterBlockSize ];
+  unsigned int  numberOfBlockValues = 0;
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -1215,20 +1594,27 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
-
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
+      /** Store the sample index and the fixed and moving image value. */
+      sampleIndices[ numberOfBlockValues ]    = fiter.Index();
+      fixedImageValues[ numberOfBlockValues ]
+        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      movingImageValues[ numberOfBlockValues ] = movingImageValue;
+      ++numberOfBlockValues;
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, 0, 0,
-        jointPDF.GetPointer() );
+      /** Compute the contribution of a full block to the joint distributions. */
+      if( numberOfBlockValues == LimiterBlockSize )
+      {
+        this->UpdateJointPDFWithBlock( numberOfBlockValues, sampleIndices,
+          fixedImageValues, movingImageValues, jointPDF.GetPointer() );
+        numberOfBlockValues = 0;
+      }
     }
   } // end iterating over fixed image spatial sample container for loop
 
+  /** Compute the contribution of the last block. */
+  this->UpdateJointPDFWithBlock( numberOfBlockValues, sampleIndices,
+    fixedImageValues, movingImageValues, jointPDF.GetPointer() );
+
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
 
@@ -1264,40 +1650,75 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Compute alpha. */
   this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
 
-  /** Accumulate joint histogram. */
-  // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  typedef ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
-  JointPDFIteratorType                it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
-  std::vector< JointPDFIteratorType > itT( this->m_NumberOfThreads );
-  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  /** Accumulate the joint histograms of all threads into m_JointPDF.
+   * This is done multi-threadedly: every thread reduces a block of bins,
+   * using a pairwise (tree) summation over the thread-private histograms.
+   */
+  const SizeValueType numberOfBins = this->m_JointPDF->GetBufferedRegion().GetNumberOfPixels();
+  if( this->m_UseMultiThread )
   {
-    itT[ i ] = JointPDFIteratorType(
-      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF,
-      this->m_JointPDF->GetBufferedRegion() );
+    /** Use blocks that are a multiple of a cache line, to avoid false sharing. */
+    const SizeValueType valuesPerCacheLine = ITK_CACHE_LINE_ALIGNMENT / sizeof( PDFValueType );
+    SizeValueType       blockSize          = numberOfBins / ( 4 * this->m_NumberOfThreads ) + 1;
+    blockSize = ( ( blockSize + valuesPerCacheLine - 1 ) / valuesPerCacheLine ) * valuesPerCacheLine;
+
+    PersistentThreadPool::GetInstance()->ParallelFor( numberOfBins, blockSize,
+      this->ReduceJointPDFsRangeFunction,
+      const_cast< void * >( static_cast< const void * >(
+        &this->m_ParzenWindowHistogramThreaderParameters ) ) );
+  }
+  else
+  {
+    this->ReduceJointPDFsRangeFunction(
+      const_cast< void * >( static_cast< const void * >(
+        &this->m_ParzenWindowHistogramThreaderParameters ) ), 0, 0, numberOfBins );
   }
 
-  PDFValueType sum;
-  while( !it.IsAtEnd() )
+} // end AfterThreadedComputePDFs()
+
+
+/**
+ * ******************* ReduceJointPDFsRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ReduceJointPDFsRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  ParzenWindowHistogramMultiThreaderParameterType * temp
+    = static_cast< ParzenWindowHistogramMultiThreaderParameterType * >( userData );
+  Self *             metric          = temp->m_Metric;
+  const ThreadIdType numberOfThreads = metric->m_NumberOfThreads;
+
+  /** Pairwise reduction over the threads: in pass 'stride' the histogram of
+   * thread i + stride is added to that of thread i, for i a multiple of 2 * stride.
+   * After the last pass the result is in the histogram of thread 0.
+   * The thread-private histograms are reset at the start of ThreadedComputePDFs(),
+   * so they may be overwritten here.
+   */
+  for( ThreadIdType stride = 1; stride < numberOfThreads; stride *= 2 )
   {
-    while( !it.IsAtEndOfLine() )
+    for( ThreadIdType i = 0; i + stride < numberOfThreads; i += 2 * stride )
     {
-      sum = NumericTraits< PDFValueType >::Zero;
-      for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+      PDFValueType * dst = metric->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ]
+        .st_JointPDF->GetBufferPointer();
+      const PDFValueType * src = metric->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i + stride ]
+        .st_JointPDF->GetBufferPointer();
+      for( SizeValueType k = begin; k < end; ++k )
       {
-        sum += itT[ i ].Value();
-        ++itT[ i ];
+        dst[ k ] += src[ k ];
       }
-      it.Set( sum );
-      ++it;
-    }
-    it.NextLine();
-    for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
-    {
-      itT[ i ].NextLine();
     }
   }
 
-} // end AfterThreadedComputePDFs()
+  /** Copy the result to the joint histogram. */
+  const PDFValueType * result = metric->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ 0 ]
+    .st_JointPDF->GetBufferPointer();
+  std::copy( result + begin, result + end, metric->m_JointPDF->GetBufferPointer() + begin );
+
+} // end ReduceJointPDFsRangeFunction()
 
 
 /**
@@ -1312,6 +1733,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
   ThreadIdType     threadId   = infoStruct->ThreadID;
 
+  itkPhaseTimerThreadMacro( "ThreadedComputePDFs", threadId );
+
   ParzenWindowHistogramMultiThreaderParameterType * temp
     = static_cast< ParzenWindowHistogramMultiThreaderParameterType * >( infoStruct->UserData );
 
@@ -1331,14 +1754,12 @@ void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchComputePDFsThreaderCallback( void ) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->ComputePDFsThreaderCallback,
+  /** Launch on the persistent thread pool. */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->ComputePDFsThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
       &this->m_ParzenWindowHistogramThreaderParameters ) ) );
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
-
 } // end LaunchComputePDFsThreaderCallback()
 
 
@@ -1351,9 +1772,18 @@ void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputePDFsAndPDFDerivatives( const ParametersType & parameters ) const
 {
+  itkPhaseTimerMacro( "ComputePDFsAndPDFDerivatives" );
+
   /** Initialize some variables. */
   this->m_JointPDF->FillBuffer( 0.0 );
-  this->m_JointPDFDerivatives->FillBuffer( 0.0 );
+  if( this->m_UseSparseExplicitPDFDerivatives )
+  {
+    this->ResetSparseJointPDFDerivatives();
+  }
+  else
+  {
+    this->m_JointPDFDerivatives->FillBuffer( 0.0 );
+  }
   this->m_Alpha                 = 0.0;
   this->m_NumberOfPixelsCounted = 0;
 
@@ -1361,6 +1791,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
   DerivativeType             imageJacobian( nzji.size() );
   TransformJacobianType      jacobian;
+  ParzenValueContainerType   fixedParzenValueBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -1416,11 +1847,13 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of the sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValueBuffer );
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+      /** Make sure the moving value falls within the histogram range. */
       movingImageValue = this->GetMovingImageLimiter()->Evaluate(
         movingImageValue, movingImageDerivative );
 
@@ -1432,8 +1865,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
         jacobian, movingImageDerivative, imageJacobian );
 
       /** Update the joint pdf and the joint pdf derivatives. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, &imageJacobian, &nzji, this->m_JointPDF.GetPointer() );
+      this->UpdateJointPDFAndDerivatives( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, &imageJacobian, &nzji, this->m_JointPDF.GetPointer() );
 
     } //end if-block check sampleOk
   }   // end iterating over fixed image spatial sample container for loop
@@ -1461,6 +1894,8 @@ void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputePDFsAndIncrementalPDFs( const ParametersType & parameters ) const
 {
+  itkPhaseTimerMacro( "ComputePDFsAndIncrementalPDFs" );
+
   /** Initialize some variables. */
   this->m_JointPDF->FillBuffer( 0.0 );
   this->m_IncrementalJointPDFRight->FillBuffer( 0.0 );
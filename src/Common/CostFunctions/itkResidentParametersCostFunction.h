@@ -0,0 +1,100 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkResidentParametersCostFunction_h
+#define __itkResidentParametersCostFunction_h
+
+#include "itkSingleValuedCostFunction.h"
+
+namespace itk
+{
+/**
+ * \class ResidentParametersCostFunction
+ * \brief An interface for cost functions that can keep the parameters and
+ * the derivative in their own storage, e.g. in the memory of a GPU.
+ *
+ * When the derivative of a cost function is computed on a GPU, copying the
+ * derivative to the host and the new parameters back in every iteration of
+ * a gradient descent optimizer may cost more than the computation itself.
+ * Cost functions that implement this interface let the optimizer take its
+ * steps in their storage: the optimizer sets the initial parameters once,
+ * and per iteration only gets the value, and a few inner products for its
+ * step size adaptation. The parameters are copied back when the optimizer
+ * stops.
+ *
+ * This is a pure interface, meant to be inherited in addition to a
+ * SingleValuedCostFunction. Use the static function Get( costFunction )
+ * to check whether a cost function implements it.
+ *
+ * \ingroup Numerics
+ */
+
+class ResidentParametersCostFunction
+{
+public:
+
+  /** Typedefs. */
+  typedef SingleValuedCostFunction::MeasureType    MeasureType;
+  typedef SingleValuedCostFunction::ParametersType ParametersType;
+
+  /** Whether the parameters can be kept resident in the current
+   * configuration. The other methods should only be called if true. */
+  virtual bool CanKeepParametersResident( void ) const = 0;
+
+  /** Copy the parameters to the resident storage, and clear the resident
+   * derivative of the previous step. */
+  virtual void SetResidentParameters( const ParametersType & parameters ) = 0;
+
+  /** Compute the value and the derivative at the resident parameters,
+   * keeping the derivative resident. */
+  virtual void GetValueAndResidentDerivative( MeasureType & value ) = 0;
+
+  /** Take the step parameters -= stepSize * derivative on the resident
+   * parameters. Returns the squared magnitude of the derivative, and its
+   * inner product with the derivative of the previous step. */
+  virtual void AdvanceResidentParameters( const double stepSize,
+    double & squaredMagnitude, double & innerProductWithPrevious ) = 0;
+
+  /** Copy the resident parameters to the host. */
+  virtual void GetResidentParameters( ParametersType & parameters ) const = 0;
+
+  /** Returns the interface of the cost function, if it implements it and
+   * can keep the parameters resident, and 0 otherwise.
+   */
+  static ResidentParametersCostFunction * Get( SingleValuedCostFunction * costFunction )
+  {
+    ResidentParametersCostFunction * residentCostFunction
+      = dynamic_cast< ResidentParametersCostFunction * >( costFunction );
+    if( residentCostFunction != 0 && residentCostFunction->CanKeepParametersResident() )
+    {
+      return residentCostFunction;
+    }
+    return 0;
+  }
+
+
+protected:
+
+  ResidentParametersCostFunction() {}
+  virtual ~ResidentParametersCostFunction() {}
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkResidentParametersCostFunction_h
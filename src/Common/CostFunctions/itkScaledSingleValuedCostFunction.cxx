@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedCostFunction.h"
 #include "vnl/vnl_math.h"
+#include "itkPhaseTimer.h"
 
 namespace itk
 {
@@ -36,6 +37,14 @@ ScaledSingleValuedCostFunction
   this->m_UseScales            = false;
   this->m_NegateCostFunction   = false;
 
+  this->m_ScalesAreIdentity               = true;
+  this->m_UseCache                        = false;
+  this->m_CachedValueValid                = false;
+  this->m_CachedDerivativeValid           = false;
+  this->m_CachedValue                     = NumericTraits< MeasureType >::Zero;
+  this->m_CachedMTime                     = 0;
+  this->m_CachedUnscaledCostFunctionMTime = 0;
+
 } // end Constructor
 
 
@@ -47,6 +56,8 @@ ScaledSingleValuedCostFunction::MeasureType
 ScaledSingleValuedCostFunction
 ::GetValue( const ParametersType & parameters ) const
 {
+  itkPhaseTimerMacro( "MetricGetValue" );
+
   /** F(y)= f(y/s) */
 
   /** This function also checks if the UnscaledCostFunction has been set */
@@ -56,22 +67,22 @@ ScaledSingleValuedCostFunction
     itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
   }
 
-  MeasureType returnvalue = NumericTraits< MeasureType >::Zero;
-
-  if( this->m_UseScales )
+  if( this->m_UseCache && this->m_CachedValueValid && this->IsCached( parameters ) )
   {
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters( scaledParameters );
-    returnvalue = this->m_UnscaledCostFunction->GetValue( scaledParameters );
+    return this->m_CachedValue;
   }
-  else
+
+  MeasureType returnvalue = this->m_UnscaledCostFunction->GetValue(
+    this->GetUnscaledParameters( parameters ) );
+
+  if( this->GetNegateCostFunction() )
   {
-    returnvalue = this->m_UnscaledCostFunction->GetValue( parameters );
+    returnvalue = -returnvalue;
   }
 
-  if( this->GetNegateCostFunction() )
+  if( this->m_UseCache )
   {
-    return -returnvalue;
+    this->StoreInCache( parameters, &returnvalue, 0 );
   }
   return returnvalue;
 
@@ -79,45 +90,93 @@ ScaledSingleValuedCostFunction
 
 
 /**
- * ******************** GetDerivative **************************
+ * *********************** GetValues ******************************
  */
 
 void
 ScaledSingleValuedCostFunction
-::GetDerivative( const ParametersType & parameters,
-  DerivativeType & derivative ) const
+::GetValues( const ParametersArrayType & parametersArray,
+  MeasureArrayType & values ) const
 {
-  /** dF/dy(y)= 1/s * df/dx(y/s) */
+  /** F(y_k)= f(y_k/s) */
 
   /** This function also checks if the UnscaledCostFunction has been set */
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  if( parameters.GetSize() != numberOfParameters )
+  for( std::size_t k = 0; k < parametersArray.size(); ++k )
   {
-    itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+    if( parametersArray[ k ].GetSize() != numberOfParameters )
+    {
+      itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+    }
   }
 
-  if( this->m_UseScales )
+  if( this->m_UseScales && !this->m_ScalesAreIdentity )
   {
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters( scaledParameters );
-    this->m_UnscaledCostFunction->GetDerivative( scaledParameters, derivative );
-
+    /** Reuse the scratch buffers of the previous call. */
     const ScalesType & scales = this->GetScales();
-    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    this->m_UnscaledParametersArray.resize( parametersArray.size() );
+    for( std::size_t k = 0; k < parametersArray.size(); ++k )
     {
-      derivative[ i ] /= scales[ i ];
+      ParametersType & unscaledParameters = this->m_UnscaledParametersArray[ k ];
+      unscaledParameters.SetSize( numberOfParameters );
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        unscaledParameters[ i ] = parametersArray[ k ][ i ] / scales[ i ];
+      }
     }
+    MultiCandidateCostFunction::GetValues(
+      this->m_UnscaledCostFunction, this->m_UnscaledParametersArray, values );
   }
   else
   {
-    m_UnscaledCostFunction->GetDerivative( parameters, derivative );
+    MultiCandidateCostFunction::GetValues(
+      this->m_UnscaledCostFunction, parametersArray, values );
   }
 
   if( this->GetNegateCostFunction() )
   {
-    derivative = -derivative;
+    for( std::size_t k = 0; k < values.size(); ++k )
+    {
+      values[ k ] = -values[ k ];
+    }
+  }
+
+} // end GetValues()
+
+
+/**
+ * ******************** GetDerivative **************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::GetDerivative( const ParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  itkPhaseTimerMacro( "MetricGetDerivative" );
+
+  /** dF/dy(y)= 1/s * df/dx(y/s) */
+
+  /** This function also checks if the UnscaledCostFunction has been set */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if( parameters.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+  }
+
+  /** With the cache, the value is computed along, so that a subsequent
+   * GetValue() at the same parameters comes for free. */
+  if( this->m_UseCache )
+  {
+    MeasureType value;
+    this->GetValueAndDerivative( parameters, value, derivative );
+    return;
   }
 
+  this->m_UnscaledCostFunction->GetDerivative(
+    this->GetUnscaledParameters( parameters ), derivative );
+  this->ScaleDerivative( derivative );
+
 } // end GetDerivative()
 
 
@@ -131,6 +190,8 @@ ScaledSingleValuedCostFunction
   MeasureType & value,
   DerivativeType & derivative ) const
 {
+  itkPhaseTimerMacro( "MetricGetValueAndDerivative" );
+
   /** F(y)= f(y/s) */
   /** dF/dy(y)= 1/s * df/dx(y/s) */
 
@@ -141,31 +202,190 @@ ScaledSingleValuedCostFunction
     itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
   }
 
-  if( this->m_UseScales )
+  if( this->m_UseCache && this->m_CachedValueValid
+    && this->m_CachedDerivativeValid && this->IsCached( parameters ) )
+  {
+    value      = this->m_CachedValue;
+    derivative = this->m_CachedDerivative;
+    return;
+  }
+
+  this->m_UnscaledCostFunction->GetValueAndDerivative(
+    this->GetUnscaledParameters( parameters ), value, derivative );
+  this->ScaleDerivative( derivative );
+
+  if( this->GetNegateCostFunction() )
+  {
+    value = -value;
+  }
+
+  if( this->m_UseCache )
   {
+    this->StoreInCache( parameters, &value, &derivative );
+  }
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * **************** GetUnscaledParameters ************************
+ */
+
+const ScaledSingleValuedCostFunction::ParametersType &
+ScaledSingleValuedCostFunction
+::GetUnscaledParameters( const ParametersType & parameters ) const
+{
+  /** x = y/s; no copy at all without (or with identity) scales. */
+  if( !this->m_UseScales || this->m_ScalesAreIdentity )
+  {
+    return parameters;
+  }
+
+  const unsigned int numberOfParameters = parameters.GetSize();
+  const ScalesType & scales             = this->GetScales();
+  if( scales.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "Number of scales is not correct." );
+  }
+
+  /** SetSize() does not reallocate if the size is unchanged. */
+  this->m_UnscaledParameters.SetSize( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    this->m_UnscaledParameters[ i ] = parameters[ i ] / scales[ i ];
+  }
+  return this->m_UnscaledParameters;
+
+} // end GetUnscaledParameters()
 
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters( scaledParameters );
-    this->m_UnscaledCostFunction->GetValueAndDerivative( scaledParameters, value, derivative );
 
+/**
+ * **************** ScaleDerivative ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::ScaleDerivative( DerivativeType & derivative ) const
+{
+  /** dF/dy = 1/s * df/dx, possibly negated; in place, in a single pass. */
+  const bool         useScales          = this->m_UseScales && !this->m_ScalesAreIdentity;
+  const bool         negate             = this->GetNegateCostFunction();
+  const unsigned int numberOfParameters = derivative.GetSize();
+  if( useScales )
+  {
     const ScalesType & scales = this->GetScales();
+    const double       sign   = negate ? -1.0 : 1.0;
     for( unsigned int i = 0; i < numberOfParameters; ++i )
     {
-      derivative[ i ] /= scales[ i ];
+      derivative[ i ] *= sign / scales[ i ];
     }
   }
-  else
+  else if( negate )
   {
-    this->m_UnscaledCostFunction->GetValueAndDerivative( parameters, value, derivative );
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      derivative[ i ] = -derivative[ i ];
+    }
   }
 
-  if( this->GetNegateCostFunction() )
+} // end ScaleDerivative()
+
+
+/**
+ * **************** SetUseCache ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::SetUseCache( bool arg )
+{
+  if( this->m_UseCache != arg )
   {
-    value      = -value;
-    derivative = -derivative;
+    this->m_UseCache = arg;
+    this->InvalidateCache();
+    this->Modified();
   }
 
-} // end GetValueAndDerivative()
+} // end SetUseCache()
+
+
+/**
+ * **************** InvalidateCache ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::InvalidateCache( void ) const
+{
+  this->m_CachedValueValid      = false;
+  this->m_CachedDerivativeValid = false;
+
+} // end InvalidateCache()
+
+
+/**
+ * **************** IsCached ************************
+ */
+
+bool
+ScaledSingleValuedCostFunction
+::IsCached( const ParametersType & parameters ) const
+{
+  if( this->GetMTime() != this->m_CachedMTime
+    || this->m_UnscaledCostFunction->GetMTime() != this->m_CachedUnscaledCostFunctionMTime )
+  {
+    this->InvalidateCache();
+    return false;
+  }
+
+  /** Exact comparison: the cache is meant for repeated evaluations at
+   * exactly the same parameters. */
+  const unsigned int numberOfParameters = parameters.GetSize();
+  if( this->m_CachedParameters.GetSize() != numberOfParameters )
+  {
+    return false;
+  }
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    if( this->m_CachedParameters[ i ] != parameters[ i ] )
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end IsCached()
+
+
+/**
+ * **************** StoreInCache ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::StoreInCache( const ParametersType & parameters,
+  const MeasureType * value, const DerivativeType * derivative ) const
+{
+  /** Keep what is already cached for the same parameters. */
+  if( !this->IsCached( parameters ) )
+  {
+    this->InvalidateCache();
+    this->m_CachedParameters                = parameters;
+    this->m_CachedMTime                     = this->GetMTime();
+    this->m_CachedUnscaledCostFunctionMTime = this->m_UnscaledCostFunction->GetMTime();
+  }
+  if( value != 0 )
+  {
+    this->m_CachedValue      = *value;
+    this->m_CachedValueValid = true;
+  }
+  if( derivative != 0 )
+  {
+    this->m_CachedDerivative      = *derivative;
+    this->m_CachedDerivativeValid = true;
+  }
+
+} // end StoreInCache()
 
 
 /**
@@ -200,6 +420,7 @@ ScaledSingleValuedCostFunction
   {
     this->m_SquaredScales[ i ] = vnl_math_sqr( scales[ i ] );
   }
+  this->UpdateScalesAreIdentity();
   this->Modified();
 
 } // end SetScales()
@@ -220,11 +441,33 @@ ScaledSingleValuedCostFunction
   {
     this->m_Scales[ i ] = vcl_sqrt( squaredScales[ i ] );
   }
+  this->UpdateScalesAreIdentity();
   this->Modified();
 
 } // end SetSquaredScales()
 
 
+/**
+ * **************** UpdateScalesAreIdentity *****************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::UpdateScalesAreIdentity( void )
+{
+  this->m_ScalesAreIdentity = true;
+  for( unsigned int i = 0; i < this->m_Scales.Size(); ++i )
+  {
+    if( this->m_Scales[ i ] != 1.0 )
+    {
+      this->m_ScalesAreIdentity = false;
+      break;
+    }
+  }
+
+} // end UpdateScalesAreIdentity()
+
+
 /**
  * *************** ConvertScaledToUnscaledParameters ********************
  */
@@ -296,6 +539,8 @@ ScaledSingleValuedCostFunction
   os << indent << "SquaredScales: " << this->m_SquaredScales << std::endl;
   os << indent << "NegateCostFunction: "
      << ( this->m_NegateCostFunction ? "true" : "false" ) << std::endl;
+  os << indent << "UseCache: "
+     << ( this->m_UseCache ? "true" : "false" ) << std::endl;
   os << indent << "UnscaledCostFunction: "
      << this->m_UnscaledCostFunction.GetPointer() << std::endl;
 
@@ -20,6 +20,7 @@
 #define __itkScaledSingleValuedCostFunction_h
 
 #include "itkSingleValuedCostFunction.h"
+#include "itkMultiCandidateCostFunction.h"
 #include "itkIntTypes.h" //temp, needed for IdentifierType
 
 namespace itk
@@ -33,10 +34,32 @@ namespace itk
  * By default it does not apply any scaling. Use the method SetUseScales(true)
  * to enable the use of scales.
  *
+ * Several parameter vectors can be evaluated at once with GetValues(), which
+ * is passed on to the unscaled cost function if it is a MultiCandidateCostFunction.
+ *
+ * Optionally (SetUseCache(true)) the value and derivative at the last
+ * evaluated parameters are remembered, so that asking for them again at the
+ * same parameters, as line search optimizers tend to do, does not evaluate
+ * the unscaled cost function again. With the cache enabled, GetDerivative()
+ * computes the value as well, through GetValueAndDerivative(). The cache is
+ * invalidated when the parameters differ, when this object or the unscaled
+ * cost function is modified, and by InvalidateCache(). The latter should
+ * be called when the cost function changes in a way that does not change
+ * its modification time, e.g. when a new set of image samples is selected.
+ * The cache is not thread safe; do not enable it if GetValue() etc. are
+ * called concurrently.
+ *
+ * The unscaled parameters are computed in scratch buffers owned by this
+ * object and reused across calls, and the derivative is scaled (and negated)
+ * in place. With identity scales the parameters are passed on without any
+ * copy. As a consequence, GetValue() etc. should not be called concurrently
+ * on the same object when scales are used.
+ *
  * \ingroup Numerics
  */
 
-class ScaledSingleValuedCostFunction : public SingleValuedCostFunction
+class ScaledSingleValuedCostFunction :
+  public SingleValuedCostFunction, public MultiCandidateCostFunction
 {
 public:
 
@@ -68,6 +91,16 @@ public:
    */
   virtual MeasureType GetValue( const ParametersType & parameters ) const;
 
+  /** Typedefs for evaluating several parameter vectors at once. */
+  typedef MultiCandidateCostFunction::ParametersArrayType ParametersArrayType;
+  typedef MultiCandidateCostFunction::MeasureArrayType    MeasureArrayType;
+
+  /** Divide all parameter vectors by the scales and call the GetValues routine
+   * of the unscaled cost function.
+   */
+  virtual void GetValues( const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const;
+
   /** Divide the parameters by the scales, call the GetDerivative routine
    * of the unscaled cost function and divide the resulting derivative by
    * the scales.
@@ -120,6 +153,13 @@ public:
   /** Get the flag to negate the cost function or not. */
   itkGetConstMacro( NegateCostFunction, bool );
 
+  /** Set/Get whether the last value and derivative are cached. Default: false. */
+  virtual void SetUseCache( bool arg );
+  itkGetConstMacro( UseCache, bool );
+
+  /** Forget the cached value and derivative. */
+  void InvalidateCache( void ) const;
+
   /** Convert the parameters from scaled to unscaled: x = y/s. */
   virtual void ConvertScaledToUnscaledParameters( ParametersType & parameters ) const;
 
@@ -136,6 +176,24 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /** Return the unscaled parameters x = y/s: the input itself if no
+   * scaling is needed, otherwise a reused scratch buffer. */
+  const ParametersType & GetUnscaledParameters( const ParametersType & parameters ) const;
+
+  /** Apply the chain rule for the scales (dF/dy = 1/s * df/dx) and the
+   * negation to the derivative, in place. */
+  void ScaleDerivative( DerivativeType & derivative ) const;
+
+  /** Set m_ScalesAreIdentity. */
+  void UpdateScalesAreIdentity( void );
+
+  /** Check whether the cache holds values for these parameters. */
+  bool IsCached( const ParametersType & parameters ) const;
+
+  /** Store the parameters, and optionally the value and derivative, in the cache. */
+  void StoreInCache( const ParametersType & parameters,
+    const MeasureType * value, const DerivativeType * derivative ) const;
+
 private:
 
   /** The private constructor. */
@@ -149,6 +207,21 @@ private:
   SingleValuedCostFunctionPointer m_UnscaledCostFunction;
   bool                            m_UseScales;
   bool                            m_NegateCostFunction;
+  bool                            m_ScalesAreIdentity;
+
+  /** Scratch buffers for the unscaled parameters. */
+  mutable ParametersType      m_UnscaledParameters;
+  mutable ParametersArrayType m_UnscaledParametersArray;
+
+  /** The cache of the last evaluation. */
+  bool                     m_UseCache;
+  mutable bool             m_CachedValueValid;
+  mutable bool             m_CachedDerivativeValid;
+  mutable ParametersType   m_CachedParameters;
+  mutable MeasureType      m_CachedValue;
+  mutable DerivativeType   m_CachedDerivative;
+  mutable ModifiedTimeType m_CachedMTime;
+  mutable ModifiedTimeType m_CachedUnscaledCostFunctionMTime;
 
 };
 
@@ -40,6 +40,9 @@
 #include "itkExceptionObject.h"
 #include "itkSpatialObject.h"
 #include "itkPointSet.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -54,6 +57,11 @@ namespace itk
  * This class computes a value that measures the similarity between the fixed point-set
  * and the transformed moving point-set.
  *
+ * Inheriting classes can evaluate their points with TransformPointsThreaded()
+ * and AccumulateDerivativeThreaded(), which use the batched functions of the
+ * AdvancedTransform and distribute the points over the threads of the
+ * PersistentThreadPool. This pays off for large point sets and meshes.
+ *
  * \ingroup RegistrationMetrics
  *
  */
@@ -98,9 +106,11 @@ public:
     itkGetStaticConstMacro( MovingPointSetDimension ) > TransformType;
   typedef typename TransformType::Pointer         TransformPointer;
   typedef typename TransformType::InputPointType  InputPointType;
-  typedef typename TransformType::OutputPointType OutputPointType;
-  typedef typename TransformType::ParametersType  TransformParametersType;
-  typedef typename TransformType::JacobianType    TransformJacobianType;
+  typedef typename TransformType::OutputPointType  OutputPointType;
+  typedef typename TransformType::OutputVectorType OutputVectorType;
+  typedef typename TransformType::ParametersType   TransformParametersType;
+  typedef typename TransformType::JacobianType     TransformJacobianType;
+  typedef typename TransformType::CompressedJacobianType CompressedJacobianType;
 
   typedef SpatialObject<
     itkGetStaticConstMacro( FixedPointSetDimension ) > FixedImageMaskType;
@@ -191,11 +201,71 @@ protected:
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded;
 
+  /** Methods for the multi-threaded evaluation of the points. ***************/
+
+  /** Transform the numberOfPoints points in the array inputPoints, and store
+   * them in the array outputPoints. The points are transformed in blocks by the
+   * batched TransformPoints() of the transform, and the blocks are distributed
+   * over the threads of the PersistentThreadPool.
+   */
+  void TransformPointsThreaded( const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints, OutputPointType * outputPoints ) const;
+
+  /** Add SUM_p pointGradients[ p ]^T * dT/dmu( points[ p ] ) to the derivative,
+   * i.e. apply the chain rule to a value of which the derivative with respect to
+   * each mapped point is given. The Jacobians are computed in blocks by the
+   * batched GetJacobians() of the transform, skipping the points with a zero
+   * gradient. Each thread adds the nonzero Jacobian columns to its own
+   * derivative, and these are summed in parallel over the parameters at the end.
+   */
+  void AccumulateDerivativeThreaded( const SizeValueType numberOfPoints,
+    const InputPointType * points, const OutputVectorType * pointGradients,
+    DerivativeType & derivative ) const;
+
 private:
 
   SingleValuedPointSetToPointSetMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                       // purposely not implemented
 
+  /** The number of points of a block, i.e. of one call to the batched
+   * functions of the transform.
+   */
+  itkStaticConstMacro( PointsBlockSize, unsigned int, 256 );
+
+  /** The data of the range functions. */
+  struct PointsJobType
+  {
+    const Self *             st_Metric;
+    SizeValueType            st_NumberOfPoints;
+    const InputPointType *   st_InputPoints;
+    OutputPointType *        st_OutputPoints;
+    const OutputVectorType * st_PointGradients;
+    DerivativeValueType *    st_Derivative;
+  };
+
+  /** The derivative and the scratch buffers of a thread. */
+  struct PerThreadStruct
+  {
+    DerivativeType                            st_Derivative;
+    bool                                      st_DerivativeIsUsed;
+    std::vector< InputPointType >             st_Points;
+    std::vector< OutputVectorType >           st_PointGradients;
+    std::vector< TransformJacobianType >      st_Jacobians;
+    std::vector< NonZeroJacobianIndicesType > st_NonZeroJacobianIndices;
+    CompressedJacobianType                    st_CompressedJacobian;
+  };
+  mutable std::vector< PerThreadStruct > m_PerThreadVariables;
+
+  /** Static range functions, over blocks of points and over parameters. */
+  static void TransformPointsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void AccumulateDerivativeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void ReduceDerivativeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
 };
 
 } // end namespace itk
@@ -36,6 +36,8 @@
 
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -135,6 +137,238 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* TransformPointsThreaded ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::TransformPointsThreaded( const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints, OutputPointType * outputPoints ) const
+{
+  PointsJobType job;
+  job.st_Metric         = this;
+  job.st_NumberOfPoints = numberOfPoints;
+  job.st_InputPoints    = inputPoints;
+  job.st_OutputPoints   = outputPoints;
+  job.st_PointGradients = 0;
+  job.st_Derivative     = 0;
+
+  const SizeValueType numberOfBlocks
+    = ( numberOfPoints + Self::PointsBlockSize - 1 ) / Self::PointsBlockSize;
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    numberOfBlocks, 1, TransformPointsRangeFunction, &job );
+
+} // end TransformPointsThreaded()
+
+
+/**
+ * ******************* TransformPointsRangeFunction ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::TransformPointsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const PointsJobType & job = *static_cast< const PointsJobType * >( userData );
+
+  const SizeValueType firstPoint = begin * Self::PointsBlockSize;
+  const SizeValueType lastPoint  = std::min(
+    end * Self::PointsBlockSize, job.st_NumberOfPoints );
+  job.st_Metric->m_Transform->TransformPoints( lastPoint - firstPoint,
+    job.st_InputPoints + firstPoint, job.st_OutputPoints + firstPoint );
+
+} // end TransformPointsRangeFunction()
+
+
+/**
+ * ******************* AccumulateDerivativeThreaded ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::AccumulateDerivativeThreaded( const SizeValueType numberOfPoints,
+  const InputPointType * points, const OutputVectorType * pointGradients,
+  DerivativeType & derivative ) const
+{
+  /** Setup the scratch buffers of the threads. Their derivatives are
+   * allocated by the threads themselves, when they are first used.
+   */
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+  const ThreadIdType            numberOfThreads
+    = std::max( threadPool->GetNumberOfThreads(), static_cast< ThreadIdType >( 1 ) );
+  const SizeValueType numberOfNonZeroJacobianIndices
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  if( this->m_PerThreadVariables.size() != numberOfThreads )
+  {
+    this->m_PerThreadVariables.resize( numberOfThreads );
+  }
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    PerThreadStruct & perThread = this->m_PerThreadVariables[ t ];
+    perThread.st_DerivativeIsUsed = false;
+    perThread.st_Points.resize( Self::PointsBlockSize );
+    perThread.st_PointGradients.resize( Self::PointsBlockSize );
+    perThread.st_Jacobians.resize( Self::PointsBlockSize );
+    perThread.st_NonZeroJacobianIndices.resize( Self::PointsBlockSize );
+    for( unsigned int i = 0; i < Self::PointsBlockSize; ++i )
+    {
+      perThread.st_NonZeroJacobianIndices[ i ].resize( numberOfNonZeroJacobianIndices );
+    }
+  }
+
+  PointsJobType job;
+  job.st_Metric         = this;
+  job.st_NumberOfPoints = numberOfPoints;
+  job.st_InputPoints    = points;
+  job.st_OutputPoints   = 0;
+  job.st_PointGradients = pointGradients;
+  job.st_Derivative     = derivative.data_block();
+
+  /** Compute the contributions of the points. */
+  const SizeValueType numberOfBlocks
+    = ( numberOfPoints + Self::PointsBlockSize - 1 ) / Self::PointsBlockSize;
+  threadPool->ParallelFor( numberOfBlocks, 1, AccumulateDerivativeRangeFunction, &job );
+
+  /** Add the derivatives of the threads to the derivative. */
+  threadPool->ParallelFor( derivative.GetSize(), 0, ReduceDerivativeRangeFunction, &job );
+
+} // end AccumulateDerivativeThreaded()
+
+
+/**
+ * ******************* AccumulateDerivativeRangeFunction ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::AccumulateDerivativeRangeFunction( void * userData,
+  ThreadIdType participantId, SizeValueType begin, SizeValueType end )
+{
+  const PointsJobType & job       = *static_cast< const PointsJobType * >( userData );
+  const Self &          metric    = *job.st_Metric;
+  PerThreadStruct &     perThread = metric.m_PerThreadVariables[ participantId ];
+
+  /** The derivative of the thread is reset to zero by the reduction. */
+  if( !perThread.st_DerivativeIsUsed )
+  {
+    const unsigned int numberOfParameters = metric.GetNumberOfParameters();
+    if( perThread.st_Derivative.GetSize() != numberOfParameters )
+    {
+      perThread.st_Derivative.SetSize( numberOfParameters );
+      perThread.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+    perThread.st_DerivativeIsUsed = true;
+  }
+  DerivativeValueType * derivative = perThread.st_Derivative.data_block();
+
+  for( SizeValueType block = begin; block < end; ++block )
+  {
+    const SizeValueType firstPoint = block * Self::PointsBlockSize;
+    const SizeValueType lastPoint  = std::min(
+      firstPoint + Self::PointsBlockSize, job.st_NumberOfPoints );
+
+    /** Gather the points that contribute to the derivative. */
+    SizeValueType numberOfPoints = 0;
+    for( SizeValueType p = firstPoint; p < lastPoint; ++p )
+    {
+      if( job.st_PointGradients[ p ].GetSquaredNorm() > 0.0 )
+      {
+        perThread.st_Points[ numberOfPoints ]         = job.st_InputPoints[ p ];
+        perThread.st_PointGradients[ numberOfPoints ] = job.st_PointGradients[ p ];
+        ++numberOfPoints;
+      }
+    }
+    if( numberOfPoints == 0 )
+    {
+      continue;
+    }
+
+    /** With a compressed Jacobian, gradient^T * dT/dmu is the gradient
+     * component of each dimension times the weights.
+     */
+    if( metric.m_Transform->GetSupportsCompressedJacobian() )
+    {
+      CompressedJacobianType & compressedJacobian = perThread.st_CompressedJacobian;
+      for( SizeValueType k = 0; k < numberOfPoints; ++k )
+      {
+        metric.m_Transform->GetCompressedJacobian( perThread.st_Points[ k ], compressedJacobian );
+        const OutputVectorType & gradient = perThread.st_PointGradients[ k ];
+        for( unsigned int d = 0; d < MovingPointSetDimension; ++d )
+        {
+          DerivativeValueType * derivativeOfDimension
+            = derivative + d * compressedJacobian.m_ParametersPerDimension;
+          for( unsigned int i = 0; i < compressedJacobian.m_Indices.size(); ++i )
+          {
+            derivativeOfDimension[ compressedJacobian.m_Indices[ i ] ]
+              += gradient[ d ] * compressedJacobian.m_Weights[ i ];
+          }
+        }
+      }
+      continue;
+    }
+
+    /** Get the TransformJacobians dT/dmu of the block. */
+    metric.m_Transform->GetJacobians( numberOfPoints, &perThread.st_Points[ 0 ],
+      &perThread.st_Jacobians[ 0 ], &perThread.st_NonZeroJacobianIndices[ 0 ] );
+
+    /** Add gradient^T * dT/dmu to the nonzero Jacobian indices. */
+    for( SizeValueType k = 0; k < numberOfPoints; ++k )
+    {
+      const TransformJacobianType &      jacobian = perThread.st_Jacobians[ k ];
+      const NonZeroJacobianIndicesType & nzji     = perThread.st_NonZeroJacobianIndices[ k ];
+      const OutputVectorType &           gradient = perThread.st_PointGradients[ k ];
+      for( unsigned int i = 0; i < nzji.size(); ++i )
+      {
+        DerivativeValueType sum = NumericTraits< DerivativeValueType >::ZeroValue();
+        for( unsigned int d = 0; d < MovingPointSetDimension; ++d )
+        {
+          sum += gradient[ d ] * jacobian( d, i );
+        }
+        derivative[ nzji[ i ] ] += sum;
+      }
+    }
+  }
+
+} // end AccumulateDerivativeRangeFunction()
+
+
+/**
+ * ******************* ReduceDerivativeRangeFunction ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::ReduceDerivativeRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const PointsJobType & job = *static_cast< const PointsJobType * >( userData );
+  std::vector< PerThreadStruct > & perThreadVariables = job.st_Metric->m_PerThreadVariables;
+
+  /** Add the used derivatives, and reset them to zero for the next call. */
+  for( std::size_t t = 0; t < perThreadVariables.size(); ++t )
+  {
+    if( !perThreadVariables[ t ].st_DerivativeIsUsed )
+    {
+      continue;
+    }
+    DerivativeValueType * threadDerivative = perThreadVariables[ t ].st_Derivative.data_block();
+    for( SizeValueType j = begin; j < end; ++j )
+    {
+      job.st_Derivative[ j ] += threadDerivative[ j ];
+      threadDerivative[ j ]   = NumericTraits< DerivativeValueType >::ZeroValue();
+    }
+  }
+
+} // end ReduceDerivativeRangeFunction()
+
+
 /**
  * ******************* PrintSelf ***********************
  */
@@ -38,6 +38,12 @@ namespace itk
  * Therefore, the transformation is required to be of itk::AdvancedTransform
  * type.
  *
+ * The penalty is normally evaluated on the samples of the image sampler.
+ * For a B-spline transform it can instead be evaluated on a fixed quadrature
+ * of points per cell of the B-spline grid, see SetUseControlPointDomain().
+ * Inheriting classes get the samples via GetPenaltySamples(), and update
+ * them via UpdatePenaltySamples() or BeforeThreadedGetValueAndDerivative().
+ *
  * \ingroup Metrics
  */
 
@@ -119,6 +125,29 @@ public:
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
 
+  /** Evaluate the penalty on the 2-point Gauss-Legendre quadrature of each cell
+   * of the B-spline grid, i.e. 2^d points per cell, instead of on the samples
+   * of the image sampler. The quadrature points are computed once per
+   * resolution, so that the cost is proportional to the number of control
+   * points, and the penalty is deterministic. Points outside the fixed image
+   * region or the fixed image mask are left out. The quadrature weights are
+   * equal, so that the mean over the points approximates the mean of the
+   * penalty over the fixed image domain. Only used if the (current) transform
+   * is a B-spline. Default: false.
+   */
+  itkSetMacro( UseControlPointDomain, bool );
+  itkGetConstMacro( UseControlPointDomain, bool );
+  itkBooleanMacro( UseControlPointDomain );
+
+  /** Initialize the penalty term; invalidates the quadrature points. */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
+  /** Sets the transform parameters and updates the samples, instead of the
+   * image sampler in the control point domain.
+   */
+  virtual void BeforeThreadedGetValueAndDerivative(
+    const TransformParametersType & parameters ) const;
+
 protected:
 
   /** Typedefs for indices and points. */
@@ -130,8 +159,12 @@ protected:
   typedef typename Superclass::MovingImageContinuousIndexType MovingImageContinuousIndexType;
   typedef typename Superclass::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
 
+  /** Typedefs for the quadrature of the B-spline grid. */
+  typedef typename BSplineOrder3TransformType::Superclass BSplineTransformBaseType;
+  typedef typename ImageSampleContainerType::Element      ImageSampleType;
+
   /** The constructor. */
-  TransformPenaltyTerm(){}
+  TransformPenaltyTerm();
 
   /** The destructor. */
   virtual ~TransformPenaltyTerm() {}
@@ -139,6 +172,21 @@ protected:
   /** A function to check if the transform is B-spline, for speedup. */
   virtual bool CheckForBSplineTransform2( BSplineOrder3TransformPointer & bspline ) const;
 
+  /** Updates the image sampler, or, in the control point domain, computes the
+   * quadrature points if they are not yet computed in this resolution.
+   * Not thread-safe.
+   */
+  void UpdatePenaltySamples( void ) const;
+
+  /** Returns the samples on which the penalty is evaluated: the quadrature
+   * points in the control point domain, or otherwise the output of the
+   * image sampler.
+   */
+  ImageSampleContainerType * GetPenaltySamples( void ) const;
+
+  /** Returns the (current) B-spline transform of any order, or 0. */
+  BSplineTransformBaseType * GetBSplineTransformBase( void ) const;
+
 private:
 
   /** The private constructor. */
@@ -146,6 +194,14 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );        // purposely not implemented
 
+  /** Computes the quadrature points of the cells of the B-spline grid. */
+  void ComputeQuadraturePoints( const BSplineTransformBaseType * bspline ) const;
+
+  bool                                m_UseControlPointDomain;
+  mutable bool                        m_QuadraturePointsAreValid;
+  mutable bool                        m_QuadraturePointsAreUsed;
+  mutable ImageSampleContainerPointer m_QuadraturePoints;
+
 };
 
 } // end namespace itk
@@ -19,10 +19,249 @@
 #define __itkTransformPenaltyTerm_hxx
 
 #include "itkTransformPenaltyTerm.h"
+#include "itkContinuousIndex.h"
+
+#include <algorithm>
 
 namespace itk
 {
 
+/**
+ * ****************** Constructor *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::TransformPenaltyTerm()
+{
+  this->m_UseControlPointDomain    = false;
+  this->m_QuadraturePointsAreValid = false;
+  this->m_QuadraturePointsAreUsed  = false;
+
+} // end Constructor
+
+
+/**
+ * ****************** Initialize *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Call the superclass' implementation. */
+  this->Superclass::Initialize();
+
+  /** The B-spline grid may have changed, e.g. in a new resolution. */
+  this->m_QuadraturePointsAreValid = false;
+  this->m_QuadraturePointsAreUsed  = false;
+  this->m_QuadraturePoints         = 0;
+
+} // end Initialize()
+
+
+/**
+ * *********************** BeforeThreadedGetValueAndDerivative ***********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::BeforeThreadedGetValueAndDerivative( const TransformParametersType & parameters ) const
+{
+  if( !this->m_UseControlPointDomain )
+  {
+    this->Superclass::BeforeThreadedGetValueAndDerivative( parameters );
+    return;
+  }
+
+  /** In this function do all stuff that cannot be multi-threaded. */
+  if( this->m_UseMetricSingleThreaded )
+  {
+    this->SetTransformParameters( parameters );
+    this->UpdatePenaltySamples();
+  }
+
+} // end BeforeThreadedGetValueAndDerivative()
+
+
+/**
+ * ****************** UpdatePenaltySamples *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::UpdatePenaltySamples( void ) const
+{
+  /** Compute the quadrature points once per resolution. */
+  if( this->m_UseControlPointDomain && !this->m_QuadraturePointsAreValid )
+  {
+    const BSplineTransformBaseType * bspline = this->GetBSplineTransformBase();
+    this->m_QuadraturePointsAreUsed = bspline != 0;
+    if( bspline )
+    {
+      this->ComputeQuadraturePoints( bspline );
+    }
+    this->m_QuadraturePointsAreValid = true;
+  }
+
+  /** Otherwise use the image sampler. */
+  if( !( this->m_UseControlPointDomain && this->m_QuadraturePointsAreUsed ) )
+  {
+    this->GetImageSampler()->Update();
+  }
+
+} // end UpdatePenaltySamples()
+
+
+/**
+ * ****************** GetPenaltySamples *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformPenaltyTerm< TFixedImage, TScalarType >::ImageSampleContainerType *
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::GetPenaltySamples( void ) const
+{
+  if( this->m_UseControlPointDomain && this->m_QuadraturePointsAreUsed )
+  {
+    return this->m_QuadraturePoints.GetPointer();
+  }
+  return this->GetImageSampler()->GetOutput();
+
+} // end GetPenaltySamples()
+
+
+/**
+ * ****************** GetBSplineTransformBase *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformPenaltyTerm< TFixedImage, TScalarType >::BSplineTransformBaseType *
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::GetBSplineTransformBase( void ) const
+{
+  BSplineTransformBaseType * bspline
+    = dynamic_cast< BSplineTransformBaseType * >( this->m_AdvancedTransform.GetPointer() );
+  if( !bspline )
+  {
+    /** Check if the current transform of a combination is a B-spline. */
+    CombinationTransformType * combo
+      = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+    if( combo )
+    {
+      bspline = dynamic_cast< BSplineTransformBaseType * >( combo->GetCurrentTransform() );
+    }
+  }
+
+  return bspline;
+
+} // end GetBSplineTransformBase()
+
+
+/**
+ * ****************** ComputeQuadraturePoints *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformPenaltyTerm< TFixedImage, TScalarType >
+::ComputeQuadraturePoints( const BSplineTransformBaseType * bspline ) const
+{
+  typedef typename BSplineTransformBaseType::RegionType    GridRegionType;
+  typedef typename BSplineTransformBaseType::SpacingType   GridSpacingType;
+  typedef typename BSplineTransformBaseType::OriginType    GridOriginType;
+  typedef typename BSplineTransformBaseType::DirectionType GridDirectionType;
+  typedef ContinuousIndex< double, FixedImageDimension >   ContinuousIndexType;
+
+  const GridRegionType    gridRegion    = bspline->GetGridRegion();
+  const GridSpacingType   gridSpacing   = bspline->GetGridSpacing();
+  const GridOriginType    gridOrigin    = bspline->GetGridOrigin();
+  const GridDirectionType gridDirection = bspline->GetGridDirection();
+
+  const FixedImageRegionType fixedRegion = this->GetFixedImageRegion();
+  const FixedImageMaskType * fixedMask   = this->GetFixedImageMask();
+
+  /** The positions of the 2-point Gauss-Legendre quadrature in a cell, in
+   * units of the grid spacing. They are the same for all cells, and have
+   * equal weights.
+   */
+  const double nodeOffsets[ 2 ] = { 0.5 - 0.5 / vcl_sqrt( 3.0 ), 0.5 + 0.5 / vcl_sqrt( 3.0 ) };
+
+  /** The number of quadrature points per dimension: two per cell. */
+  SizeValueType numberOfNodes[ FixedImageDimension ];
+  SizeValueType totalNumberOfNodes = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    const SizeValueType gridSize = gridRegion.GetSize()[ d ];
+    numberOfNodes[ d ]  = gridSize > 1 ? 2 * ( gridSize - 1 ) : 0;
+    totalNumberOfNodes *= numberOfNodes[ d ];
+  }
+
+  this->m_QuadraturePoints = ImageSampleContainerType::New();
+  this->m_QuadraturePoints->Reserve( totalNumberOfNodes );
+
+  /** Loop over the quadrature points, with an odometer over the dimensions. */
+  SizeValueType node[ FixedImageDimension ];
+  std::fill( node, node + FixedImageDimension, 0 );
+  SizeValueType numberOfPoints = 0;
+  for( SizeValueType n = 0; n < totalNumberOfNodes; ++n )
+  {
+    /** The physical position of the point. */
+    FixedImagePointType point;
+    point.Fill( 0.0 );
+    for( unsigned int j = 0; j < FixedImageDimension; ++j )
+    {
+      const double gridIndex = gridRegion.GetIndex()[ j ]
+        + static_cast< double >( node[ j ] / 2 ) + nodeOffsets[ node[ j ] % 2 ];
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
+      {
+        point[ i ] += gridDirection[ i ][ j ] * gridSpacing[ j ] * gridIndex;
+      }
+    }
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      point[ i ] += gridOrigin[ i ];
+    }
+
+    /** Keep the point if it is inside the fixed image region and mask. */
+    ContinuousIndexType cindex;
+    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( point, cindex );
+    bool pointOk = true;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      const double lower = static_cast< double >( fixedRegion.GetIndex()[ d ] ) - 0.5;
+      const double upper = lower + static_cast< double >( fixedRegion.GetSize()[ d ] );
+      pointOk &= cindex[ d ] >= lower && cindex[ d ] < upper;
+    }
+    if( pointOk && fixedMask )
+    {
+      pointOk = fixedMask->IsInside( point );
+    }
+
+    if( pointOk )
+    {
+      ImageSampleType & sample = this->m_QuadraturePoints->ElementAt( numberOfPoints );
+      sample.m_ImageCoordinates = point;
+      sample.m_ImageValue       = NumericTraits< typename ImageSampleType::RealType >::Zero;
+      ++numberOfPoints;
+    }
+
+    /** Go to the next quadrature point. */
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      if( ++node[ d ] < numberOfNodes[ d ] ) { break; }
+      node[ d ] = 0;
+    }
+  }
+
+  this->m_QuadraturePoints->resize( numberOfPoints );
+
+} // end ComputeQuadraturePoints()
+
+
 /**
  * ****************** CheckForBSplineTransform *******************************
  */
@@ -64,6 +64,7 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::ImplicitSampleGridType       ImplicitSampleGridType;
 
   /** The input image dimension. */
   itkStaticConstMacro( InputImageDimension, unsigned int,
@@ -89,6 +90,10 @@ public:
   }
 
 
+  /** Describe all voxels implicitly, as a grid with spacing 1, see ImageSamplerBase. */
+  virtual bool GetImplicitSampleGrid( ImplicitSampleGridType & grid );
+
+
 protected:
 
   /** The constructor. */
@@ -21,6 +21,7 @@
 #include "itkImageFullSampler.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkRegistrationProgress.h"
 
 namespace itk
 {
@@ -52,6 +53,7 @@ ImageFullSampler< TInputImage >
   /** Set up a region iterator within the user specified image region. */
   typedef ImageRegionConstIteratorWithIndex< InputImageType > InputImageIterator;
   InputImageIterator iter( inputImage, this->GetCroppedInputImageRegion() );
+  const IndexValueType rowStart = this->GetCroppedInputImageRegion().GetIndex()[ 0 ];
 
   /** Fill the sample container. */
   if( mask.IsNull() )
@@ -85,6 +87,12 @@ ImageFullSampler< TInputImage >
       /** Get sampled index */
       InputImageIndexType index = iter.GetIndex();
 
+      /** Poll for a cancellation request at the start of each row. */
+      if( index[ 0 ] == rowStart )
+      {
+        RegistrationProgress::ThrowIfCurrentCancelRequested();
+      }
+
       /** Translate index to point */
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
@@ -111,6 +119,12 @@ ImageFullSampler< TInputImage >
       /** Get sampled index. */
       InputImageIndexType index = iter.GetIndex();
 
+      /** Poll for a cancellation request at the start of each row. */
+      if( index[ 0 ] == rowStart )
+      {
+        RegistrationProgress::ThrowIfCurrentCancelRequested();
+      }
+
       /** Translate index to point. */
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
@@ -150,6 +164,7 @@ ImageFullSampler< TInputImage >
   typedef ImageRegionConstIteratorWithIndex< InputImageType > InputImageIterator;
   //InputImageIterator iter( inputImage, this->GetCroppedInputImageRegion() );
   InputImageIterator iter( inputImage, inputRegionForThread );
+  const IndexValueType rowStart = inputRegionForThread.GetIndex()[ 0 ];
 
   /** Fill the sample container. */
   const unsigned long chunkSize = inputRegionForThread.GetNumberOfPixels();
@@ -183,6 +198,13 @@ ImageFullSampler< TInputImage >
       /** Get sampled index */
       InputImageIndexType index = iter.GetIndex();
 
+      /** Poll for a cancellation request at the start of each row; the
+       * exception is thrown in AfterThreadedGenerateData(). */
+      if( index[ 0 ] == rowStart && RegistrationProgress::GetCurrentCancelRequested() )
+      {
+        return;
+      }
+
       /** Translate index to point */
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
@@ -209,6 +231,13 @@ ImageFullSampler< TInputImage >
       /** Get sampled index. */
       InputImageIndexType index = iter.GetIndex();
 
+      /** Poll for a cancellation request at the start of each row; the
+       * exception is thrown in AfterThreadedGenerateData(). */
+      if( index[ 0 ] == rowStart && RegistrationProgress::GetCurrentCancelRequested() )
+      {
+        return;
+      }
+
       /** Translate index to point. */
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
@@ -228,6 +257,37 @@ ImageFullSampler< TInputImage >
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* GetImplicitSampleGrid *******************
+ */
+
+template< class TInputImage >
+bool
+ImageFullSampler< TInputImage >
+::GetImplicitSampleGrid( ImplicitSampleGridType & grid )
+{
+  if( !this->m_UseImplicitSampling || !this->GetInput() )
+  {
+    return false;
+  }
+
+  /** Do what Update() would do before GenerateData(): update the mask and
+   * crop the input image region to its bounding box. */
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask.IsNotNull() && mask->GetSource() )
+  {
+    mask->GetSource()->Update();
+  }
+  this->GenerateInputRequestedRegion();
+
+  typename InputImageType::OffsetType gridSpacing;
+  gridSpacing.Fill( 1 );
+  return this->InitializeImplicitSampleGrid( this->GetCroppedInputImageRegion().GetIndex(),
+    this->GetCroppedInputImageRegion().GetSize(), gridSpacing, grid );
+
+} // end GetImplicitSampleGrid()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -71,6 +71,7 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::ImplicitSampleGridType       ImplicitSampleGridType;
 
   /** The input image dimension. */
   itkStaticConstMacro( InputImageDimension, unsigned int,
@@ -131,6 +132,10 @@ public:
   }
 
 
+  /** Describe the grid implicitly, see ImageSamplerBase. */
+  virtual bool GetImplicitSampleGrid( ImplicitSampleGridType & grid );
+
+
 protected:
 
   /** The constructor. */
@@ -145,6 +150,11 @@ protected:
   /** Function that does the work. */
   virtual void GenerateData( void );
 
+  /** Compute the first index and the size of the grid, which is centered
+   * on the cropped input image region. */
+  void ComputeSampleGrid( SampleGridIndexType & sampleGridIndex,
+    SampleGridSizeType & sampleGridSize ) const;
+
   /** An array of integer spacing factors */
   SampleGridSpacingType m_SampleGridSpacing;
 
@@ -84,26 +84,8 @@ ImageGridSampler< TInputImage >
   /** Determine the grid. */
   SampleGridIndexType index;
   SampleGridSizeType  sampleGridSize;
-  SampleGridIndexType sampleGridIndex
-    = this->GetCroppedInputImageRegion().GetIndex();
-  const InputImageSizeType & inputImageSize
-    = this->GetCroppedInputImageRegion().GetSize();
-  unsigned long numberOfSamplesOnGrid = 1;
-  for( unsigned int dim = 0; dim < InputImageDimension; dim++ )
-  {
-    /** The number of sample point along one dimension. */
-    sampleGridSize[ dim ] = 1
-      + ( ( inputImageSize[ dim ] - 1 ) / this->GetSampleGridSpacing()[ dim ] );
-
-    /** The position of the first sample along this dimension is
-     * chosen to center the grid nicely on the input image region.
-     */
-    sampleGridIndex[ dim ] += ( inputImageSize[ dim ]
-      - ( ( sampleGridSize[ dim ] - 1 ) * this->GetSampleGridSpacing()[ dim ] + 1 ) ) / 2;
-
-    /** Update the number of samples on the grid. */
-    numberOfSamplesOnGrid *= sampleGridSize[ dim ];
-  }
+  SampleGridIndexType sampleGridIndex;
+  this->ComputeSampleGrid( sampleGridIndex, sampleGridSize );
 
   /** Prepare for looping over the grid. */
   unsigned int dim_z = 1;
@@ -218,6 +200,68 @@ ImageGridSampler< TInputImage >
 } // end GenerateData()
 
 
+/**
+ * ******************* ComputeSampleGrid *******************
+ */
+
+template< class TInputImage >
+void
+ImageGridSampler< TInputImage >
+::ComputeSampleGrid( SampleGridIndexType & sampleGridIndex,
+  SampleGridSizeType & sampleGridSize ) const
+{
+  sampleGridIndex = this->GetCroppedInputImageRegion().GetIndex();
+  const InputImageSizeType & inputImageSize
+    = this->GetCroppedInputImageRegion().GetSize();
+  for( unsigned int dim = 0; dim < InputImageDimension; dim++ )
+  {
+    /** The number of sample point along one dimension. */
+    sampleGridSize[ dim ] = 1
+      + ( ( inputImageSize[ dim ] - 1 ) / this->GetSampleGridSpacing()[ dim ] );
+
+    /** The position of the first sample along this dimension is
+     * chosen to center the grid nicely on the input image region.
+     */
+    sampleGridIndex[ dim ] += ( inputImageSize[ dim ]
+      - ( ( sampleGridSize[ dim ] - 1 ) * this->GetSampleGridSpacing()[ dim ] + 1 ) ) / 2;
+  }
+
+} // end ComputeSampleGrid()
+
+
+/**
+ * ******************* GetImplicitSampleGrid *******************
+ */
+
+template< class TInputImage >
+bool
+ImageGridSampler< TInputImage >
+::GetImplicitSampleGrid( ImplicitSampleGridType & grid )
+{
+  if( !this->m_UseImplicitSampling || !this->GetInput() )
+  {
+    return false;
+  }
+
+  /** Do what Update() would do before GenerateData(): update the mask and
+   * crop the input image region to its bounding box. */
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask.IsNotNull() && mask->GetSource() )
+  {
+    mask->GetSource()->Update();
+  }
+  this->GenerateInputRequestedRegion();
+  this->SetNumberOfSamples( this->m_RequestedNumberOfSamples );
+
+  SampleGridIndexType sampleGridIndex;
+  SampleGridSizeType  sampleGridSize;
+  this->ComputeSampleGrid( sampleGridIndex, sampleGridSize );
+  return this->InitializeImplicitSampleGrid( sampleGridIndex, sampleGridSize,
+    this->m_SampleGridSpacing, grid );
+
+} // end GetImplicitSampleGrid()
+
+
 /**
  * ******************* SetNumberOfSamples *******************
  */
@@ -0,0 +1,182 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __ImageImportanceSampler_h
+#define __ImageImportanceSampler_h
+
+#include "itkImageRandomSamplerBase.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+namespace itk
+{
+/** \class ImageImportanceSampler
+ *
+ * \brief Samples voxels of an image randomly, with a probability
+ * proportional to their importance.
+ *
+ * The importance of a voxel is the gradient magnitude of the input image,
+ * or, if a WeightImage is set, the value of the nearest voxel of that image.
+ * To keep every voxel within reach, a fraction UniformFraction of the
+ * probability is spread uniformly:
+ *
+ *   q_i = ( 1 - UniformFraction ) * r_i / mean( r ) + UniformFraction,
+ *
+ * with r_i the importance, and the mean over the voxels inside the mask.
+ * The mean of q is 1, so the weight 1 / q_i of a sample corrects for the
+ * non-uniform selection: the weighted mean of a function over the samples
+ * estimates its mean over the image without bias. The weights are stored
+ * in the samples; the metrics that support them multiply the contribution
+ * of each sample by its weight. The weights are at most 1 / UniformFraction.
+ *
+ * An alias table of the voxel probabilities is built when the input image,
+ * the mask, the weight image or the cropped input image region change, so
+ * in practice once per resolution. Drawing a sample then takes two random
+ * numbers and one table lookup.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template< class TInputImage >
+class ImageImportanceSampler :
+  public ImageRandomSamplerBase< TInputImage >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ImageImportanceSampler                Self;
+  typedef ImageRandomSamplerBase< TInputImage > Superclass;
+  typedef SmartPointer< Self >                  Pointer;
+  typedef SmartPointer< const Self >            ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageImportanceSampler, ImageRandomSamplerBase );
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass::DataObjectPointer            DataObjectPointer;
+  typedef typename Superclass::OutputVectorContainerType    OutputVectorContainerType;
+  typedef typename Superclass::OutputVectorContainerPointer OutputVectorContainerPointer;
+  typedef typename Superclass::InputImageType               InputImageType;
+  typedef typename Superclass::InputImagePointer            InputImagePointer;
+  typedef typename Superclass::InputImageConstPointer       InputImageConstPointer;
+  typedef typename Superclass::InputImageRegionType         InputImageRegionType;
+  typedef typename Superclass::InputImagePixelType          InputImagePixelType;
+  typedef typename Superclass::ImageSampleType              ImageSampleType;
+  typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
+  typedef typename Superclass::MaskType                     MaskType;
+
+  /** The input image dimension. */
+  itkStaticConstMacro( InputImageDimension, unsigned int,
+    Superclass::InputImageDimension );
+
+  /** Other typdefs. */
+  typedef typename InputImageType::IndexType InputImageIndexType;
+  typedef typename InputImageType::PointType InputImagePointType;
+
+  /** The image with the importance of the voxels. */
+  typedef Image< float, itkGetStaticConstMacro( InputImageDimension ) > WeightImageType;
+
+  /** The random number generator used to generate random indices. */
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
+
+  /** Set/Get the image with the importance of the voxels. If not set (the
+   * default), the gradient magnitude of the input image is used. The image
+   * is looked up by the nearest voxel, so it does not need to have the
+   * geometry of the input image.
+   */
+  itkSetConstObjectMacro( WeightImage, WeightImageType );
+  itkGetConstObjectMacro( WeightImage, WeightImageType );
+
+  /** Set/Get the fraction of the probability that is spread uniformly over
+   * the voxels. Default: 0.1. */
+  itkSetClampMacro( UniformFraction, double, 0.0, 1.0 );
+  itkGetConstMacro( UniformFraction, double );
+
+  /** The samples have weights. */
+  virtual bool GetUseSampleWeights( void ) const
+  {
+    return true;
+  }
+
+protected:
+
+  /** The constructor. */
+  ImageImportanceSampler();
+  /** The destructor. */
+  virtual ~ImageImportanceSampler() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Function that does the work. */
+  virtual void GenerateData( void );
+
+  /** Build the alias table, if the input image, the mask, the weight image,
+   * the uniform fraction or the cropped input image region changed since it
+   * was last built. */
+  virtual void UpdateAliasTable( void );
+
+  /** Compute the importance of all voxels of the cropped input image region
+   * that are inside the mask. */
+  virtual void ComputeImportance( void );
+
+  RandomGeneratorPointer m_RandomGenerator;
+
+  /** The valid voxels: their linear offsets in the cropped input image
+   * region, which are only stored when a mask is used, and their q_i.
+   */
+  std::vector< SizeValueType > m_VoxelOffsets;
+  std::vector< float >         m_VoxelImportance;
+
+  /** The alias table: voxel i is drawn with probability m_AliasProbability[ i ],
+   * and else voxel m_Alias[ i ]. */
+  std::vector< float >         m_AliasProbability;
+  std::vector< SizeValueType > m_Alias;
+
+  /** What the alias table was built for. */
+  InputImageConstPointer                   m_AliasTableInput;
+  typename MaskType::ConstPointer          m_AliasTableMask;
+  typename WeightImageType::ConstPointer   m_AliasTableWeightImage;
+  ModifiedTimeType                         m_AliasTableInputMTime;
+  ModifiedTimeType                         m_AliasTableMaskMTime;
+  ModifiedTimeType                         m_AliasTableWeightImageMTime;
+  double                                   m_AliasTableUniformFraction;
+  InputImageRegionType                     m_AliasTableRegion;
+
+private:
+
+  /** The private constructor. */
+  ImageImportanceSampler( const Self & );  // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );          // purposely not implemented
+
+  typename WeightImageType::ConstPointer m_WeightImage;
+  double                                 m_UniformFraction;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageImportanceSampler.hxx"
+#endif
+
+#endif // end #ifndef __ImageImportanceSampler_h
@@ -0,0 +1,324 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __ImageImportanceSampler_hxx
+#define __ImageImportanceSampler_hxx
+
+#include "itkImageImportanceSampler.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkRegistrationProgress.h"
+#include "vnl/vnl_math.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage >
+ImageImportanceSampler< TInputImage >
+::ImageImportanceSampler()
+{
+  /** Setup random generator. */
+  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+
+  this->m_UniformFraction = 0.1;
+
+  this->m_AliasTableInputMTime       = 0;
+  this->m_AliasTableMaskMTime        = 0;
+  this->m_AliasTableWeightImageMTime = 0;
+  this->m_AliasTableUniformFraction  = -1.0;
+
+} // end Constructor
+
+
+/**
+ * ******************* GenerateData *******************
+ */
+
+template< class TInputImage >
+void
+ImageImportanceSampler< TInputImage >
+::GenerateData( void )
+{
+  /** Make sure the alias table is up-to-date. */
+  this->UpdateAliasTable();
+  const SizeValueType numberOfVoxels = this->m_AliasProbability.size();
+  if( numberOfVoxels == 0 )
+  {
+    itkExceptionMacro( << "ERROR: the mask does not contain any voxel "
+                       << "of the input image region." );
+  }
+
+  /** Get handles to the input image and the output sample container. */
+  InputImageConstPointer       inputImage      = this->GetInput();
+  ImageSampleContainerPointer  sampleContainer = this->GetOutput();
+  const InputImageRegionType & region          = this->m_AliasTableRegion;
+  const bool                   useOffsets      = !this->m_VoxelOffsets.empty();
+
+  /** Draw the samples; drawing is cheap, so this is not multi-threaded. */
+  sampleContainer->resize( this->GetNumberOfSamples() );
+  InputImageIndexType index;
+  for( SizeValueType i = 0; i < this->GetNumberOfSamples(); ++i )
+  {
+    /** Pick a column of the alias table, and then the voxel or its alias. */
+    SizeValueType voxel = this->m_RandomGenerator->GetIntegerVariate(
+      static_cast< typename RandomGeneratorType::IntegerType >( numberOfVoxels - 1 ) );
+    if( this->m_RandomGenerator->GetVariateWithOpenUpperRange()
+      >= this->m_AliasProbability[ voxel ] )
+    {
+      voxel = this->m_Alias[ voxel ];
+    }
+
+    /** Convert the linear offset in the region to an index. */
+    SizeValueType offset = useOffsets ? this->m_VoxelOffsets[ voxel ] : voxel;
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      const SizeValueType size = region.GetSize()[ d ];
+      index[ d ] = region.GetIndex()[ d ] + static_cast< IndexValueType >( offset % size );
+      offset    /= size;
+    }
+
+    ImageSampleType & sample = sampleContainer->ElementAt( i );
+    inputImage->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+    sample.m_ImageValue = inputImage->GetPixel( index );
+    sample.m_Weight     = 1.0 / this->m_VoxelImportance[ voxel ];
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* UpdateAliasTable *******************
+ */
+
+template< class TInputImage >
+void
+ImageImportanceSampler< TInputImage >
+::UpdateAliasTable( void )
+{
+  /** Get handles to the input image, the mask and the weight image. */
+  InputImageConstPointer inputImage = this->GetInput();
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask.IsNotNull() && mask->GetSource() )
+  {
+    mask->GetSource()->Update();
+  }
+  const WeightImageType * weightImage = this->m_WeightImage.GetPointer();
+
+  /** Check if the table is still valid. */
+  const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+  if( this->m_AliasTableInput == inputImage
+    && this->m_AliasTableMask == mask
+    && this->m_AliasTableWeightImage == weightImage
+    && this->m_AliasTableInputMTime == inputImage->GetMTime()
+    && ( mask.IsNull() || this->m_AliasTableMaskMTime == mask->GetMTime() )
+    && ( !weightImage || this->m_AliasTableWeightImageMTime == weightImage->GetMTime() )
+    && this->m_AliasTableUniformFraction == this->m_UniformFraction
+    && this->m_AliasTableRegion == region )
+  {
+    return;
+  }
+
+  /** Compute q_i of the valid voxels. */
+  this->m_AliasTableRegion = region;
+  this->ComputeImportance();
+
+  /** Build the alias table with Vose's method. The probability of voxel i
+   * is q_i / n, so q_i is its probability scaled to a mean of 1.
+   */
+  const SizeValueType numberOfVoxels = this->m_VoxelImportance.size();
+  this->m_AliasProbability.assign( this->m_VoxelImportance.begin(), this->m_VoxelImportance.end() );
+  this->m_Alias.resize( numberOfVoxels );
+  std::vector< SizeValueType > small;
+  std::vector< SizeValueType > large;
+  for( SizeValueType i = 0; i < numberOfVoxels; ++i )
+  {
+    this->m_Alias[ i ] = i;
+    if( this->m_AliasProbability[ i ] < 1.0f )
+    {
+      small.push_back( i );
+    }
+    else
+    {
+      large.push_back( i );
+    }
+  }
+  while( !small.empty() && !large.empty() )
+  {
+    const SizeValueType s = small.back();
+    small.pop_back();
+    const SizeValueType l = large.back();
+    this->m_Alias[ s ] = l;
+    this->m_AliasProbability[ l ] -= 1.0f - this->m_AliasProbability[ s ];
+    if( this->m_AliasProbability[ l ] < 1.0f )
+    {
+      large.pop_back();
+      small.push_back( l );
+    }
+  }
+
+  /** The remaining columns are full, up to rounding errors. */
+  for( std::size_t i = 0; i < small.size(); ++i )
+  {
+    this->m_AliasProbability[ small[ i ] ] = 1.0f;
+  }
+  for( std::size_t i = 0; i < large.size(); ++i )
+  {
+    this->m_AliasProbability[ large[ i ] ] = 1.0f;
+  }
+
+  this->m_AliasTableInput            = inputImage;
+  this->m_AliasTableMask             = mask;
+  this->m_AliasTableWeightImage      = weightImage;
+  this->m_AliasTableInputMTime       = inputImage->GetMTime();
+  this->m_AliasTableMaskMTime        = mask.IsNotNull() ? mask->GetMTime() : 0;
+  this->m_AliasTableWeightImageMTime = weightImage ? weightImage->GetMTime() : 0;
+  this->m_AliasTableUniformFraction  = this->m_UniformFraction;
+
+} // end UpdateAliasTable()
+
+
+/**
+ * ******************* ComputeImportance *******************
+ */
+
+template< class TInputImage >
+void
+ImageImportanceSampler< TInputImage >
+::ComputeImportance( void )
+{
+  InputImageConstPointer inputImage = this->GetInput();
+  typename MaskType::ConstPointer mask = this->GetMask();
+  const WeightImageType *      weightImage = this->m_WeightImage.GetPointer();
+  const InputImageRegionType & region      = this->m_AliasTableRegion;
+  const InputImageRegionType & buffered    = inputImage->GetBufferedRegion();
+
+  this->m_VoxelOffsets.clear();
+  this->m_VoxelImportance.clear();
+  if( mask.IsNull() )
+  {
+    this->m_VoxelImportance.reserve( region.GetNumberOfPixels() );
+  }
+
+  /** Collect the importance r_i of the valid voxels, in raster order. */
+  typedef ImageRegionConstIteratorWithIndex< InputImageType > InputImageIterator;
+  InputImageIterator  iter( inputImage, region );
+  InputImagePointType point;
+  SizeValueType       offset = 0;
+  double              sum    = 0.0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter, ++offset )
+  {
+    const InputImageIndexType & index = iter.GetIndex();
+
+    /** Poll for a cancellation request at the start of each row. */
+    if( index[ 0 ] == region.GetIndex()[ 0 ] )
+    {
+      RegistrationProgress::ThrowIfCurrentCancelRequested();
+    }
+
+    if( mask.IsNotNull() || weightImage )
+    {
+      inputImage->TransformIndexToPhysicalPoint( index, point );
+    }
+    if( mask.IsNotNull() )
+    {
+      if( !mask->IsInside( point ) )
+      {
+        continue;
+      }
+      this->m_VoxelOffsets.push_back( offset );
+    }
+
+    double importance = 0.0;
+    if( weightImage )
+    {
+      typename WeightImageType::IndexType weightIndex;
+      if( weightImage->TransformPhysicalPointToIndex( point, weightIndex ) )
+      {
+        importance = vnl_math_max( 0.0, static_cast< double >( weightImage->GetPixel( weightIndex ) ) );
+      }
+    }
+    else
+    {
+      /** The gradient magnitude, by central differences within the buffer. */
+      double squaredMagnitude = 0.0;
+      for( unsigned int d = 0; d < InputImageDimension; ++d )
+      {
+        InputImageIndexType lower = index;
+        InputImageIndexType upper = index;
+        if( lower[ d ] > buffered.GetIndex()[ d ] ) { --lower[ d ]; }
+        if( upper[ d ] < buffered.GetIndex()[ d ]
+          + static_cast< IndexValueType >( buffered.GetSize()[ d ] ) - 1 ) { ++upper[ d ]; }
+        if( upper[ d ] == lower[ d ] ) { continue; }
+        const double derivative
+          = ( static_cast< double >( inputImage->GetPixel( upper ) )
+          - static_cast< double >( inputImage->GetPixel( lower ) ) )
+          / ( static_cast< double >( upper[ d ] - lower[ d ] ) * inputImage->GetSpacing()[ d ] );
+        squaredMagnitude += derivative * derivative;
+      }
+      importance = vcl_sqrt( squaredMagnitude );
+    }
+
+    this->m_VoxelImportance.push_back( static_cast< float >( importance ) );
+    sum += importance;
+  }
+
+  /** Convert to q_i, which has a mean of 1. The offsets are the identity
+   * without a mask, so they are not stored.
+   */
+  const SizeValueType numberOfVoxels = this->m_VoxelImportance.size();
+  if( numberOfVoxels == 0 )
+  {
+    return;
+  }
+  const double meanImportance  = sum / static_cast< double >( numberOfVoxels );
+  const double uniformFraction = meanImportance > 0.0 ? this->m_UniformFraction : 1.0;
+  const double scale           = meanImportance > 0.0
+    ? ( 1.0 - uniformFraction ) / meanImportance : 0.0;
+  for( SizeValueType i = 0; i < numberOfVoxels; ++i )
+  {
+    this->m_VoxelImportance[ i ] = static_cast< float >(
+      scale * this->m_VoxelImportance[ i ] + uniformFraction );
+  }
+
+} // end ComputeImportance()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage >
+void
+ImageImportanceSampler< TInputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "WeightImage: " << this->m_WeightImage.GetPointer() << std::endl;
+  os << indent << "UniformFraction: " << this->m_UniformFraction << std::endl;
+  os << indent << "NumberOfValidVoxels: " << this->m_VoxelImportance.size() << std::endl;
+  os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __ImageImportanceSampler_hxx
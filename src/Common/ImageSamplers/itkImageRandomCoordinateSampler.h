@@ -19,8 +19,11 @@
 #define __ImageRandomCoordinateSampler_h
 
 #include "itkImageRandomSamplerBase.h"
+#include "itkPhiloxRandomNumberGenerator.h"
+#include "itkMultiThreader.h"
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -33,6 +36,37 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * By default the coordinates are drawn from the global Mersenne Twister
+ * generator, which makes the samples depend on the order in which they are
+ * drawn. With UseCounterBasedRandomGenerator the coordinates of every sample
+ * are instead computed by a counter-based generator, keyed on the seed, the
+ * number of updates of this sampler, and the sample index. The samples are then
+ * generated fully in parallel (also when a mask is used), and the result does
+ * not depend on the number of threads.
+ *
+ * In addition, with UseBackgroundPrefetch the samples of the next update are
+ * generated on a background thread, right after the samples of the current
+ * update. This is possible because, with the counter-based generator, the
+ * samples do not depend on anything that changes during an iteration. When
+ * new samples are requested (e.g. NewSamplesEveryIteration), the next call
+ * of Update() then only swaps the buffers. If the setup of the sampler changed
+ * in the meantime, the prefetched samples are discarded and generated again,
+ * so the result is always the same as without prefetching.
+ *
+ * With UseStratifiedSampling the sample region is divided into a grid of
+ * about NumberOfSamples cells of equal size, and sample i is drawn uniformly
+ * within cell i (a jittered grid). The samples of one update then cover the
+ * region evenly, while the positions still change every update, which lowers
+ * the variance of the estimated metric derivative. The samples beyond the
+ * number of cells are drawn from the whole region. With a mask, a sample
+ * is drawn from its cell for a few attempts, and from the whole region after.
+ *
+ * With SortSamplesInMortonOrder the samples of every update are sorted along
+ * a Morton (Z-order) curve through their bounding box. The set of samples is
+ * the same; only the order changes, such that consecutive samples, and the
+ * chunks of samples of the threads of a metric, lie close together. They
+ * then touch the same B-spline coefficients and moving image cache lines.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -84,8 +118,8 @@ public:
   typedef InterpolateImageFunction<
     InputImageType, CoordRepType >                            InterpolatorType;
   typedef typename InterpolatorType::Pointer InterpolatorPointer;
-  typedef BSplineInterpolateImageFunction<
-    InputImageType, CoordRepType, double >                    DefaultInterpolatorType;
+  typedef BSplineInterpolateImageFunction< InputImageType,
+    CoordRepType, InternalBufferRealType >                    DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
@@ -105,6 +139,48 @@ public:
   itkGetConstMacro( UseRandomSampleRegion, bool );
   itkSetMacro( UseRandomSampleRegion, bool );
 
+  /** Set/Get whether to use a counter-based random generator, such that the
+   * samples do not depend on the number of threads. Default: false. */
+  itkSetMacro( UseCounterBasedRandomGenerator, bool );
+  itkGetConstMacro( UseCounterBasedRandomGenerator, bool );
+  itkBooleanMacro( UseCounterBasedRandomGenerator );
+
+  /** Set/Get the seed of the counter-based random generator. Only used
+   * when UseCounterBasedRandomGenerator==true. Default: 121212. */
+  itkSetMacro( Seed, unsigned int );
+  itkGetConstMacro( Seed, unsigned int );
+
+  /** Set/Get the number of updates done with the counter-based random
+   * generator; the samples of an update are keyed by its number. Setting it
+   * continues the sequence of samples, e.g. to resume a registration. */
+  itkSetMacro( NumberOfUpdates, PhiloxRandomNumberGenerator::WordType );
+  itkGetConstMacro( NumberOfUpdates, PhiloxRandomNumberGenerator::WordType );
+
+  /** Set/Get whether to generate the samples of the next update on a
+   * background thread. Only used when UseCounterBasedRandomGenerator==true.
+   * Default: false. */
+  itkSetMacro( UseBackgroundPrefetch, bool );
+  itkGetConstMacro( UseBackgroundPrefetch, bool );
+  itkBooleanMacro( UseBackgroundPrefetch );
+
+  /** Set/Get whether to draw the samples on a jittered grid. Default: false. */
+  itkSetMacro( UseStratifiedSampling, bool );
+  itkGetConstMacro( UseStratifiedSampling, bool );
+  itkBooleanMacro( UseStratifiedSampling );
+
+  /** Set/Get whether to sort the samples of every update along a Morton
+   * curve, for locality of the processing order. Default: false. */
+  itkSetMacro( SortSamplesInMortonOrder, bool );
+  itkGetConstMacro( SortSamplesInMortonOrder, bool );
+  itkBooleanMacro( SortSamplesInMortonOrder );
+
+  /** The samples are in between the voxels. */
+  virtual bool GetSamplesAreOnVoxelGrid( void ) const
+  {
+    return false;
+  }
+
+
 protected:
 
   typedef typename InterpolatorType::ContinuousIndexType InputImageContinuousIndexType;
@@ -112,7 +188,7 @@ protected:
   /** The constructor. */
   ImageRandomCoordinateSampler();
   /** The destructor. */
-  virtual ~ImageRandomCoordinateSampler() {}
+  virtual ~ImageRandomCoordinateSampler();
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const;
@@ -127,6 +203,8 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId );
 
+  virtual void AfterThreadedGenerateData( void );
+
   /** Generate a point randomly in a bounding box. */
   virtual void GenerateRandomCoordinate(
     const InputImageContinuousIndexType & smallestContIndex,
@@ -137,6 +215,89 @@ protected:
   RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
 
+  /** The jittered grid of the stratified sampling. No cells means that the
+   * samples are not stratified. */
+  struct StratificationType
+  {
+    SizeValueType m_NumberOfCells;
+    SizeValueType m_CellsPerDimension[ InputImageDimension ];
+  };
+
+  /** The number of attempts to find a sample inside the mask in its own cell. */
+  itkStaticConstMacro( NumberOfStratifiedAttempts, unsigned int, 4 );
+
+  /** Compute the jittered grid for a sample region, if UseStratifiedSampling. */
+  void ComputeStratification(
+    const InputImageContinuousIndexType & smallestContIndex,
+    const InputImageContinuousIndexType & largestContIndex,
+    StratificationType & stratification ) const;
+
+  /** Map the uniform random numbers in [0,1) of an attempt of a sample into its cell. */
+  static void StratifyRandomNumbers( const StratificationType & stratification,
+    SizeValueType sampleIndex, SizeValueType attempt, double * randomNumbers );
+
+  /** Move a coordinate, drawn uniformly in the sample region, into the cell of the sample. */
+  static void StratifyCoordinate( const StratificationType & stratification,
+    SizeValueType sampleIndex, SizeValueType attempt,
+    const InputImageContinuousIndexType & smallestContIndex,
+    const InputImageContinuousIndexType & largestContIndex,
+    InputImageContinuousIndexType & contIndex );
+
+  /** The counter-based random generator. */
+  typedef PhiloxRandomNumberGenerator              CounterBasedRandomGeneratorType;
+  typedef CounterBasedRandomGeneratorType::WordType CounterType;
+
+  /** Everything that is needed to generate the samples of one update with
+   * the counter-based generator. The samples are a function of this struct only.
+   */
+  struct CounterBasedSamplingType
+  {
+    CounterBasedRandomGeneratorType m_Generator;
+    InputImageContinuousIndexType   m_SmallestContIndex;
+    InputImageContinuousIndexType   m_LargestContIndex;
+    InputImageConstPointer          m_Input;
+    InterpolatorPointer             m_Interpolator;
+    typename MaskType::ConstPointer m_Mask;
+    SizeValueType                   m_NumberOfSamples;
+    SizeValueType                   m_MaximumNumberOfTries;
+    bool                            m_SortSamplesInMortonOrder;
+    StratificationType              m_Stratification;
+  };
+
+  /** Set up the counter-based sampling of an update: the key of the generator
+   * and the sample region. */
+  virtual void SetupCounterBasedSampling( CounterType update,
+    CounterBasedSamplingType & sampling );
+
+  /** Check whether two setups give the same samples. */
+  static bool IsSameCounterBasedSampling(
+    const CounterBasedSamplingType & sampling1,
+    const CounterBasedSamplingType & sampling2 );
+
+  /** Generate sample sampleIndex using the counter-based random generator.
+   * Candidate coordinates are drawn until a point inside the mask is found,
+   * which only depends on the sample index. Returns false when the total
+   * numberOfTries exceeds the maximum number of tries.
+   */
+  static bool GenerateCounterBasedSample(
+    const CounterBasedSamplingType & sampling,
+    SizeValueType sampleIndex,
+    SizeValueType & numberOfTries,
+    ImageSampleType & sample );
+
+  /** Sort the samples along a Morton curve through their bounding box.
+   * Samples with the same code keep their order. */
+  static void SortSamplesAlongMortonCurve( ImageSampleContainerType & samples );
+
+  /** Start generating the samples of the next update on a background thread. */
+  virtual void StartBackgroundPrefetch( void );
+
+  /** Wait until the background thread is finished. */
+  virtual void WaitForBackgroundPrefetch( void );
+
+  /** The function that is executed by the background thread. */
+  static ITK_THREAD_RETURN_TYPE BackgroundPrefetchThreaderCallback( void * arg );
+
   /** Generate the two corners of a sampling region, given the two corners
   * of an image. If UseRandomSampleRegion=false, the smallesPoint and largestPoint
   * are just copies of the smallestImagePoint and largestImagePoint
@@ -156,6 +317,28 @@ private:
   void operator=( const Self & );                 // purposely not implemented
 
   bool m_UseRandomSampleRegion;
+  bool m_SortSamplesInMortonOrder;
+  bool m_UseStratifiedSampling;
+
+  /** The jittered grid of the Mersenne Twister path. */
+  StratificationType m_Stratification;
+
+  /** Variables for the counter-based random generator. */
+  bool                            m_UseCounterBasedRandomGenerator;
+  unsigned int                    m_Seed;
+  CounterType                     m_NumberOfUpdates;
+  CounterBasedRandomGeneratorType m_CounterBasedRandomGenerator;
+  CounterBasedSamplingType        m_CurrentSampling;
+  std::vector< SizeValueType >    m_ThreaderNumberOfTries;
+
+  /** Variables for the background prefetch. */
+  bool                        m_UseBackgroundPrefetch;
+  MultiThreader::Pointer      m_PrefetchThreader;
+  ThreadIdType                m_PrefetchThreadId;
+  bool                        m_PrefetchRunning;
+  bool                        m_PrefetchSucceeded;
+  CounterBasedSamplingType    m_PrefetchSampling;
+  ImageSampleContainerPointer m_PrefetchSampleContainer;
 
 };
 
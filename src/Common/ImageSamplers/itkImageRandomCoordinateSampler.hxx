@@ -19,8 +19,12 @@
 #define __ImageRandomCoordinateSampler_hxx
 
 #include "itkImageRandomCoordinateSampler.h"
+#include "itkRegistrationProgress.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace itk
 {
 
@@ -44,9 +48,35 @@ ImageRandomCoordinateSampler< TInputImage >
   this->m_UseRandomSampleRegion = false;
   this->m_SampleRegionSize.Fill( 1.0 );
 
+  this->m_SortSamplesInMortonOrder = false;
+  this->m_UseStratifiedSampling    = false;
+  this->m_Stratification.m_NumberOfCells = 0;
+
+  this->m_UseCounterBasedRandomGenerator = false;
+  this->m_Seed                           = 121212;
+  this->m_NumberOfUpdates                = 0;
+
+  this->m_UseBackgroundPrefetch = false;
+  this->m_PrefetchThreadId      = 0;
+  this->m_PrefetchRunning       = false;
+  this->m_PrefetchSucceeded     = false;
+
 } // end Constructor
 
 
+/**
+ * ******************* Destructor ********************
+ */
+
+template< class TInputImage >
+ImageRandomCoordinateSampler< TInputImage >
+::~ImageRandomCoordinateSampler()
+{
+  this->WaitForBackgroundPrefetch();
+
+} // end Destructor
+
+
 /**
  * ******************* GenerateData *******************
  */
@@ -56,12 +86,89 @@ void
 ImageRandomCoordinateSampler< TInputImage >
 ::GenerateData( void )
 {
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. */
   typename MaskType::ConstPointer mask = this->GetMask();
+
+  /** The counter-based generator supports the multi-threaded version also
+   * when a mask is supplied, and gives the same samples in both versions. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    /** The background thread uses the interpolator and the mask, so wait for it first. */
+    this->WaitForBackgroundPrefetch();
+
+    /** Set up the interpolator and the mask. */
+    this->m_Interpolator->SetInputImage( this->GetInput() );
+    if( mask.IsNotNull() && mask->GetSource() )
+    {
+      mask->GetSource()->Update();
+    }
+
+    /** Every update gets its own key, such that new samples are selected. */
+    ++this->m_NumberOfUpdates;
+    this->SetupCounterBasedSampling( this->m_NumberOfUpdates, this->m_CurrentSampling );
+
+    typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
+    if( this->m_PrefetchSucceeded
+      && IsSameCounterBasedSampling( this->m_PrefetchSampling, this->m_CurrentSampling ) )
+    {
+      /** The prefetched samples are exactly the samples of this update,
+       * already sorted if requested. */
+      sampleContainer->swap( *this->m_PrefetchSampleContainer );
+      this->m_PrefetchSucceeded = false;
+    }
+    else
+    {
+      if( this->m_UseMultiThread )
+      {
+        /** Calls ThreadedGenerateData(). */
+        Superclass::GenerateData();
+      }
+      else
+      {
+        sampleContainer->resize( this->GetNumberOfSamples() );
+
+        SizeValueType numberOfTries = 0;
+        for( SizeValueType i = 0; i < this->GetNumberOfSamples(); ++i )
+        {
+          if( ( i & 0xfff ) == 0 )
+          {
+            RegistrationProgress::ThrowIfCurrentCancelRequested();
+          }
+          if( !GenerateCounterBasedSample( this->m_CurrentSampling, i,
+            numberOfTries, sampleContainer->ElementAt( i ) ) )
+          {
+            /** Squeeze the sample container to the size that is still valid. */
+            sampleContainer->resize( i );
+            itkExceptionMacro( << "Could not find enough image samples within "
+                               << "reasonable time. Probably the mask is too small" );
+          }
+        }
+      }
+
+      if( this->m_SortSamplesInMortonOrder )
+      {
+        SortSamplesAlongMortonCurve( *sampleContainer );
+      }
+    }
+
+    /** Already generate the samples of the next update. */
+    if( this->m_UseBackgroundPrefetch )
+    {
+      this->StartBackgroundPrefetch();
+    }
+    return;
+  }
+
+  /** If there was no mask supplied we exercise a multi-threaded version. */
   if( mask.IsNull() && this->m_UseMultiThread )
   {
     /** Calls ThreadedGenerateData(). */
-    return Superclass::GenerateData();
+    Superclass::GenerateData();
+    if( this->m_SortSamplesInMortonOrder )
+    {
+      SortSamplesAlongMortonCurve( *this->GetOutput() );
+    }
+    return;
   }
 
   /** Get handles to the input image, output sample container, and interpolator. */
@@ -85,9 +192,11 @@ ImageRandomCoordinateSampler< TInputImage >
   InputImageContinuousIndexType largestContIndex;
   this->GenerateSampleRegion( smallestImageContIndex, largestImageContIndex,
     smallestContIndex, largestContIndex );
+  this->ComputeStratification( smallestContIndex, largestContIndex, this->m_Stratification );
 
   /** Reserve memory for the output. */
   sampleContainer->Reserve( this->GetNumberOfSamples() );
+  SizeValueType sampleIndex = 0;
 
   /** Setup an iterator over the output, which is of ImageSampleContainerType. */
   typename ImageSampleContainerType::Iterator iter;
@@ -98,7 +207,7 @@ ImageRandomCoordinateSampler< TInputImage >
   if( mask.IsNull() )
   {
     /** Start looping over the sample container. */
-    for( iter = sampleContainer->Begin(); iter != end; ++iter )
+    for( iter = sampleContainer->Begin(); iter != end; ++iter, ++sampleIndex )
     {
       /** Make a reference to the current sample in the container. */
       InputImagePointType &  samplePoint = ( *iter ).Value().m_ImageCoordinates;
@@ -106,6 +215,8 @@ ImageRandomCoordinateSampler< TInputImage >
 
       /** Walk over the image until we find a valid point. */
       this->GenerateRandomCoordinate( smallestContIndex, largestContIndex, sampleContIndex );
+      StratifyCoordinate( this->m_Stratification, sampleIndex, 0,
+        smallestContIndex, largestContIndex, sampleContIndex );
 
       /** Convert to point */
       inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, samplePoint );
@@ -129,13 +240,14 @@ ImageRandomCoordinateSampler< TInputImage >
     unsigned long maximumNumberOfSamplesToTry = 10 * this->GetNumberOfSamples();
 
     /** Start looping over the sample container */
-    for( iter = sampleContainer->Begin(); iter != end; ++iter )
+    for( iter = sampleContainer->Begin(); iter != end; ++iter, ++sampleIndex )
     {
       /** Make a reference to the current sample in the container. */
       InputImagePointType &  samplePoint = ( *iter ).Value().m_ImageCoordinates;
       ImageSampleValueType & sampleValue = ( *iter ).Value().m_ImageValue;
 
       /** Walk over the image until we find a valid point */
+      SizeValueType attempt = 0;
       do
       {
         /** Check if we are not trying eternally to find a valid point. */
@@ -153,6 +265,8 @@ ImageRandomCoordinateSampler< TInputImage >
 
         /** Generate a point in the input image region. */
         this->GenerateRandomCoordinate( smallestContIndex, largestContIndex, sampleContIndex );
+        StratifyCoordinate( this->m_Stratification, sampleIndex, attempt++,
+          smallestContIndex, largestContIndex, sampleContIndex );
         inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, samplePoint );
 
       }
@@ -166,6 +280,11 @@ ImageRandomCoordinateSampler< TInputImage >
     } // end for loop
   }   // end if mask
 
+  if( this->m_SortSamplesInMortonOrder )
+  {
+    SortSamplesAlongMortonCurve( *sampleContainer );
+  }
+
 } // end GenerateData()
 
 
@@ -178,6 +297,14 @@ void
 ImageRandomCoordinateSampler< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
+  /** The counter-based generator needs no list of random numbers. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    this->m_ThreaderNumberOfTries.assign( this->GetNumberOfThreads(), 0 );
+    Superclass::Superclass::BeforeThreadedGenerateData();
+    return;
+  }
+
   /** Set up the interpolator. */
   typename InterpolatorType::Pointer interpolator = this->GetInterpolator();
   interpolator->SetInputImage( this->GetInput() ); // only once per resolution?
@@ -197,11 +324,13 @@ ImageRandomCoordinateSampler< TInputImage >
   InputImageContinuousIndexType smallestCIndex, largestCIndex, randomCIndex;
   this->GenerateSampleRegion( smallestImageCIndex, largestImageCIndex,
     smallestCIndex, largestCIndex );
+  this->ComputeStratification( smallestCIndex, largestCIndex, this->m_Stratification );
 
   /** Fill the list with random numbers. */
   for( unsigned long i = 0; i < this->m_NumberOfSamples; i++ )
   {
     this->GenerateRandomCoordinate( smallestCIndex, largestCIndex, randomCIndex );
+    StratifyCoordinate( this->m_Stratification, i, 0, smallestCIndex, largestCIndex, randomCIndex );
     for( unsigned int j = 0; j < InputImageDimension; ++j )
     {
       this->m_RandomNumberList.push_back( randomCIndex[ j ] );
@@ -230,7 +359,7 @@ ImageRandomCoordinateSampler< TInputImage >
 {
   /** Sanity check. */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if( mask.IsNotNull() )
+  if( mask.IsNotNull() && !this->m_UseCounterBasedRandomGenerator )
   {
     itkExceptionMacro( << "ERROR: do not call this function when a mask is supplied." );
   }
@@ -252,6 +381,33 @@ ImageRandomCoordinateSampler< TInputImage >
     = this->m_ThreaderSampleContainer[ threadId ];
   sampleContainerThisThread->Reserve( chunkSize );
 
+  /** Compute the samples directly from their index, using the counter-based generator.
+   * The budget of tries is checked per thread here, and in total in AfterThreadedGenerateData(),
+   * so that the outcome does not depend on the number of threads either.
+   */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    const SizeValueType firstSample   = sampleStart / InputImageDimension;
+    SizeValueType &     numberOfTries = this->m_ThreaderNumberOfTries[ threadId ];
+    for( SizeValueType i = 0; i < chunkSize; ++i )
+    {
+      /** Poll for a cancellation request; the exception is thrown in
+       * AfterThreadedGenerateData(). */
+      if( ( i & 0xfff ) == 0 && RegistrationProgress::GetCurrentCancelRequested() )
+      {
+        sampleContainerThisThread->resize( i );
+        return;
+      }
+      if( !GenerateCounterBasedSample( this->m_CurrentSampling, firstSample + i,
+        numberOfTries, sampleContainerThisThread->ElementAt( i ) ) )
+      {
+        sampleContainerThisThread->resize( i );
+        break;
+      }
+    }
+    return;
+  }
+
   /** Setup an iterator over the sampleContainerThisThread. */
   typename ImageSampleContainerType::Iterator iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
@@ -283,6 +439,458 @@ ImageRandomCoordinateSampler< TInputImage >
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* AfterThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::AfterThreadedGenerateData( void )
+{
+  /** Combine the results of all threads. */
+  Superclass::AfterThreadedGenerateData();
+
+  /** Check the total number of tries of the counter-based generator. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    SizeValueType numberOfTries = 0;
+    for( std::size_t i = 0; i < this->m_ThreaderNumberOfTries.size(); ++i )
+    {
+      numberOfTries += this->m_ThreaderNumberOfTries[ i ];
+    }
+    if( numberOfTries > this->m_CurrentSampling.m_MaximumNumberOfTries )
+    {
+      itkExceptionMacro( << "Could not find enough image samples within "
+                         << "reasonable time. Probably the mask is too small" );
+    }
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* SetupCounterBasedSampling *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::SetupCounterBasedSampling( CounterType update, CounterBasedSamplingType & sampling )
+{
+  /** The key of this update is also used by GenerateRandomCoordinate(),
+   * for the sample region. */
+  this->m_CounterBasedRandomGenerator.SetKey(
+    static_cast< CounterType >( this->m_Seed ), update );
+  sampling.m_Generator = this->m_CounterBasedRandomGenerator;
+
+  /** Convert inputImageRegion to bounding box in continuous index space. */
+  InputImageSizeType unitSize;
+  unitSize.Fill( 1 );
+  InputImageIndexType smallestIndex
+    = this->GetCroppedInputImageRegion().GetIndex();
+  InputImageIndexType largestIndex
+    = smallestIndex + this->GetCroppedInputImageRegion().GetSize() - unitSize;
+  InputImageContinuousIndexType smallestImageContIndex( smallestIndex );
+  InputImageContinuousIndexType largestImageContIndex( largestIndex );
+  this->GenerateSampleRegion( smallestImageContIndex, largestImageContIndex,
+    sampling.m_SmallestContIndex, sampling.m_LargestContIndex );
+
+  sampling.m_Input           = this->GetInput();
+  sampling.m_Interpolator    = this->m_Interpolator;
+  sampling.m_Mask            = this->GetMask();
+  sampling.m_NumberOfSamples = this->GetNumberOfSamples();
+
+  /** The same budget as in GenerateData(). */
+  sampling.m_MaximumNumberOfTries = 10 * this->GetNumberOfSamples();
+
+  sampling.m_SortSamplesInMortonOrder = this->m_SortSamplesInMortonOrder;
+  this->ComputeStratification( sampling.m_SmallestContIndex, sampling.m_LargestContIndex,
+    sampling.m_Stratification );
+
+} // end SetupCounterBasedSampling()
+
+
+/**
+ * ******************* IsSameCounterBasedSampling *******************
+ */
+
+template< class TInputImage >
+bool
+ImageRandomCoordinateSampler< TInputImage >
+::IsSameCounterBasedSampling(
+  const CounterBasedSamplingType & sampling1,
+  const CounterBasedSamplingType & sampling2 )
+{
+  const CounterType * key1 = sampling1.m_Generator.GetKey();
+  const CounterType * key2 = sampling2.m_Generator.GetKey();
+
+  return key1[ 0 ] == key2[ 0 ] && key1[ 1 ] == key2[ 1 ]
+         && sampling1.m_SmallestContIndex == sampling2.m_SmallestContIndex
+         && sampling1.m_LargestContIndex == sampling2.m_LargestContIndex
+         && sampling1.m_Input == sampling2.m_Input
+         && sampling1.m_Interpolator == sampling2.m_Interpolator
+         && sampling1.m_Mask == sampling2.m_Mask
+         && sampling1.m_NumberOfSamples == sampling2.m_NumberOfSamples
+         && sampling1.m_MaximumNumberOfTries == sampling2.m_MaximumNumberOfTries
+         && sampling1.m_SortSamplesInMortonOrder == sampling2.m_SortSamplesInMortonOrder
+         && sampling1.m_Stratification.m_NumberOfCells == sampling2.m_Stratification.m_NumberOfCells;
+
+} // end IsSameCounterBasedSampling()
+
+
+/**
+ * ******************* GenerateCounterBasedSample *******************
+ */
+
+template< class TInputImage >
+bool
+ImageRandomCoordinateSampler< TInputImage >
+::GenerateCounterBasedSample(
+  const CounterBasedSamplingType & sampling,
+  SizeValueType sampleIndex,
+  SizeValueType & numberOfTries,
+  ImageSampleType & sample )
+{
+  InputImageContinuousIndexType sampleContIndex;
+  double                        randomNumbers[ InputImageDimension ];
+
+  /** Walk over the image until we find a valid point. The attempt number
+   * is part of the counter, so every sample has its own sequence of candidates. */
+  for( CounterType attempt = 0;; ++attempt )
+  {
+    if( ++numberOfTries > sampling.m_MaximumNumberOfTries )
+    {
+      return false;
+    }
+
+    sampling.m_Generator.GetUniformVariates(
+      sampleIndex, attempt, randomNumbers, InputImageDimension );
+    StratifyRandomNumbers( sampling.m_Stratification, sampleIndex, attempt, randomNumbers );
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      sampleContIndex[ i ] = sampling.m_SmallestContIndex[ i ] + randomNumbers[ i ]
+        * ( sampling.m_LargestContIndex[ i ] - sampling.m_SmallestContIndex[ i ] );
+    }
+    sampling.m_Input->TransformContinuousIndexToPhysicalPoint(
+      sampleContIndex, sample.m_ImageCoordinates );
+
+    if( sampling.m_Mask.IsNull() )
+    {
+      break;
+    }
+    if( sampling.m_Interpolator->IsInsideBuffer( sampleContIndex )
+      && sampling.m_Mask->IsInside( sample.m_ImageCoordinates ) )
+    {
+      break;
+    }
+  }
+
+  /** Compute the value at the continuous index. */
+  sample.m_ImageValue = static_cast< ImageSampleValueType >(
+    sampling.m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+
+  return true;
+
+} // end GenerateCounterBasedSample()
+
+
+/**
+ * ******************* ComputeStratification *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::ComputeStratification(
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  StratificationType & stratification ) const
+{
+  stratification.m_NumberOfCells = 0;
+  if( !this->m_UseStratifiedSampling || this->GetNumberOfSamples() == 0 )
+  {
+    return;
+  }
+
+  /** The physical extent of the region, and the edge of a cubic cell such
+   * that the region contains NumberOfSamples cells.
+   */
+  double extent[ InputImageDimension ];
+  double volume            = 1.0;
+  unsigned int dimensions = 0;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    extent[ d ] = ( largestContIndex[ d ] - smallestContIndex[ d ] ) * this->GetInput()->GetSpacing()[ d ];
+    if( extent[ d ] > 0.0 )
+    {
+      volume *= extent[ d ];
+      ++dimensions;
+    }
+  }
+  if( dimensions == 0 )
+  {
+    return;
+  }
+  const double edge = vcl_pow( volume / static_cast< double >( this->GetNumberOfSamples() ),
+    1.0 / static_cast< double >( dimensions ) );
+
+  /** Round down, and make sure that there are not more cells than samples. */
+  SizeValueType numberOfCells = 1;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    stratification.m_CellsPerDimension[ d ] = vnl_math_max( static_cast< SizeValueType >( 1 ),
+      static_cast< SizeValueType >( extent[ d ] / edge ) );
+    numberOfCells *= stratification.m_CellsPerDimension[ d ];
+  }
+  while( numberOfCells > this->GetNumberOfSamples() )
+  {
+    unsigned int largest = 0;
+    for( unsigned int d = 1; d < InputImageDimension; ++d )
+    {
+      if( stratification.m_CellsPerDimension[ d ] > stratification.m_CellsPerDimension[ largest ] )
+      {
+        largest = d;
+      }
+    }
+    numberOfCells /= stratification.m_CellsPerDimension[ largest ];
+    --stratification.m_CellsPerDimension[ largest ];
+    numberOfCells *= stratification.m_CellsPerDimension[ largest ];
+  }
+  stratification.m_NumberOfCells = numberOfCells;
+
+} // end ComputeStratification()
+
+
+/**
+ * ******************* StratifyRandomNumbers *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::StratifyRandomNumbers( const StratificationType & stratification,
+  SizeValueType sampleIndex, SizeValueType attempt, double * randomNumbers )
+{
+  if( sampleIndex >= stratification.m_NumberOfCells || attempt >= NumberOfStratifiedAttempts )
+  {
+    return;
+  }
+
+  /** Cell sampleIndex, in raster order. */
+  SizeValueType cell = sampleIndex;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const SizeValueType cells = stratification.m_CellsPerDimension[ d ];
+    randomNumbers[ d ] = ( static_cast< double >( cell % cells ) + randomNumbers[ d ] )
+      / static_cast< double >( cells );
+    cell /= cells;
+  }
+
+} // end StratifyRandomNumbers()
+
+
+/**
+ * ******************* StratifyCoordinate *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::StratifyCoordinate( const StratificationType & stratification,
+  SizeValueType sampleIndex, SizeValueType attempt,
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType & contIndex )
+{
+  if( sampleIndex >= stratification.m_NumberOfCells || attempt >= NumberOfStratifiedAttempts )
+  {
+    return;
+  }
+
+  double randomNumbers[ InputImageDimension ];
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const double range = largestContIndex[ d ] - smallestContIndex[ d ];
+    randomNumbers[ d ] = range > 0.0 ? ( contIndex[ d ] - smallestContIndex[ d ] ) / range : 0.0;
+  }
+  StratifyRandomNumbers( stratification, sampleIndex, attempt, randomNumbers );
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    contIndex[ d ] = static_cast< InputImagePointValueType >( smallestContIndex[ d ]
+      + randomNumbers[ d ] * ( largestContIndex[ d ] - smallestContIndex[ d ] ) );
+  }
+
+} // end StratifyCoordinate()
+
+
+/**
+ * ******************* SortSamplesAlongMortonCurve *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::SortSamplesAlongMortonCurve( ImageSampleContainerType & samples )
+{
+  const SizeValueType numberOfSamples = samples.size();
+  if( numberOfSamples < 2 )
+  {
+    return;
+  }
+
+  /** The bounding box of the samples. */
+  InputImagePointType minimum = samples[ 0 ].m_ImageCoordinates;
+  InputImagePointType maximum = minimum;
+  for( SizeValueType i = 1; i < numberOfSamples; ++i )
+  {
+    const InputImagePointType & point = samples[ i ].m_ImageCoordinates;
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      minimum[ d ] = vnl_math_min( minimum[ d ], point[ d ] );
+      maximum[ d ] = vnl_math_max( maximum[ d ], point[ d ] );
+    }
+  }
+
+  /** Quantize the box to a grid of 2^bits cells per dimension, such that the
+   * interleaved bits of all dimensions fit in 63 bits.
+   */
+  const unsigned int bits     = 63 / InputImageDimension;
+  const double       numCells = static_cast< double >( static_cast< uint64_t >( 1 ) << bits );
+  double             scale[ InputImageDimension ];
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const double extent = static_cast< double >( maximum[ d ] - minimum[ d ] );
+    scale[ d ] = extent > 0.0 ? ( numCells - 1.0 ) / extent : 0.0;
+  }
+
+  /** Compute the codes; the sample index breaks the ties. */
+  typedef std::pair< uint64_t, SizeValueType > CodeAndIndexType;
+  std::vector< CodeAndIndexType > codes( numberOfSamples );
+  for( SizeValueType i = 0; i < numberOfSamples; ++i )
+  {
+    const InputImagePointType & point = samples[ i ].m_ImageCoordinates;
+    uint64_t                    cell[ InputImageDimension ];
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      cell[ d ] = static_cast< uint64_t >(
+        static_cast< double >( point[ d ] - minimum[ d ] ) * scale[ d ] );
+    }
+    uint64_t code = 0;
+    for( unsigned int b = 0; b < bits; ++b )
+    {
+      for( unsigned int d = 0; d < InputImageDimension; ++d )
+      {
+        code |= ( ( cell[ d ] >> b ) & 1 ) << ( b * InputImageDimension + d );
+      }
+    }
+    codes[ i ] = CodeAndIndexType( code, i );
+  }
+  std::sort( codes.begin(), codes.end() );
+
+  /** Reorder the samples. */
+  std::vector< ImageSampleType > sorted( numberOfSamples );
+  for( SizeValueType i = 0; i < numberOfSamples; ++i )
+  {
+    sorted[ i ] = samples[ codes[ i ].second ];
+  }
+  std::copy( sorted.begin(), sorted.end(), samples.begin() );
+
+} // end SortSamplesAlongMortonCurve()
+
+
+/**
+ * ******************* StartBackgroundPrefetch *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::StartBackgroundPrefetch( void )
+{
+  /** Set up the sampling of the next update on this thread. The background
+   * thread only reads the prefetch variables, which hold their own references
+   * to the input, the interpolator and the mask. */
+  this->SetupCounterBasedSampling( this->m_NumberOfUpdates + 1, this->m_PrefetchSampling );
+  if( this->m_PrefetchSampleContainer.IsNull() )
+  {
+    this->m_PrefetchSampleContainer = ImageSampleContainerType::New();
+  }
+  if( this->m_PrefetchThreader.IsNull() )
+  {
+    this->m_PrefetchThreader = MultiThreader::New();
+  }
+
+  this->m_PrefetchSucceeded = false;
+  this->m_PrefetchThreadId  = this->m_PrefetchThreader->SpawnThread(
+    this->BackgroundPrefetchThreaderCallback, this );
+  this->m_PrefetchRunning = true;
+
+} // end StartBackgroundPrefetch()
+
+
+/**
+ * ******************* WaitForBackgroundPrefetch *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::WaitForBackgroundPrefetch( void )
+{
+  /** TerminateThread() joins the thread. */
+  if( this->m_PrefetchRunning )
+  {
+    this->m_PrefetchThreader->TerminateThread( this->m_PrefetchThreadId );
+    this->m_PrefetchRunning = false;
+  }
+
+} // end WaitForBackgroundPrefetch()
+
+
+/**
+ * ******************* BackgroundPrefetchThreaderCallback *******************
+ */
+
+template< class TInputImage >
+ITK_THREAD_RETURN_TYPE
+ImageRandomCoordinateSampler< TInputImage >
+::BackgroundPrefetchThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  Self * self = static_cast< Self * >( infoStruct->UserData );
+
+  const CounterBasedSamplingType & sampling        = self->m_PrefetchSampling;
+  ImageSampleContainerType &       sampleContainer = *self->m_PrefetchSampleContainer;
+
+  /** Exceptions can not be passed to the main thread; on failure the samples
+   * are simply generated again in GenerateData(), which then reports the error. */
+  bool succeeded = true;
+  try
+  {
+    sampleContainer.resize( sampling.m_NumberOfSamples );
+    SizeValueType numberOfTries = 0;
+    for( SizeValueType i = 0; i < sampling.m_NumberOfSamples && succeeded; ++i )
+    {
+      succeeded = GenerateCounterBasedSample( sampling, i, numberOfTries, sampleContainer[ i ] );
+    }
+    if( succeeded && sampling.m_SortSamplesInMortonOrder )
+    {
+      SortSamplesAlongMortonCurve( sampleContainer );
+    }
+  }
+  catch( ... )
+  {
+    succeeded = false;
+  }
+  self->m_PrefetchSucceeded = succeeded;
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end BackgroundPrefetchThreaderCallback()
+
+
 /**
  * ******************* GenerateRandomCoordinate *******************
  */
@@ -295,6 +903,23 @@ ImageRandomCoordinateSampler< TInputImage >
   const InputImageContinuousIndexType & largestContIndex,
   InputImageContinuousIndexType &       randomContIndex )
 {
+  /** With the counter-based generator this function is only used for the
+   * sample region. It gets an index that is never used by a sample. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    double randomNumbers[ InputImageDimension ];
+    this->m_CounterBasedRandomGenerator.GetUniformVariates(
+      NumericTraits< CounterBasedRandomGeneratorType::IndexType >::max(), 0,
+      randomNumbers, InputImageDimension );
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      randomContIndex[ i ] = static_cast< InputImagePointValueType >(
+        smallestContIndex[ i ] + randomNumbers[ i ]
+        * ( largestContIndex[ i ] - smallestContIndex[ i ] ) );
+    }
+    return;
+  }
+
   for( unsigned int i = 0; i < InputImageDimension; ++i )
   {
     randomContIndex[ i ] = static_cast< InputImagePointValueType >(
@@ -361,6 +986,11 @@ ImageRandomCoordinateSampler< TInputImage >
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "UseCounterBasedRandomGenerator: " << this->m_UseCounterBasedRandomGenerator << std::endl;
+  os << indent << "Seed: " << this->m_Seed << std::endl;
+  os << indent << "UseBackgroundPrefetch: " << this->m_UseBackgroundPrefetch << std::endl;
+  os << indent << "SortSamplesInMortonOrder: " << this->m_SortSamplesInMortonOrder << std::endl;
+  os << indent << "UseStratifiedSampling: " << this->m_UseStratifiedSampling << std::endl;
 
 } // end PrintSelf()
 
@@ -20,7 +20,6 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageFullSampler.h"
 
 namespace itk
 {
@@ -31,6 +30,13 @@ namespace itk
  * This version takes into account that the mask may be very small.
  * Also, it may be more efficient when very many different sample sets
  * of the same input image are required, because it does some precomputation.
+ *
+ * The precomputation is a compact index of the voxels inside the mask: the
+ * runs of consecutive valid voxels (in raster order) of the cropped input image
+ * region. It is rebuilt only when the input image, the mask or the region
+ * change, i.e. once per resolution. Drawing a sample then costs a lookup
+ * in a table of runs, instead of storing an ImageSample for every mask voxel.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -80,9 +86,6 @@ public:
 
 protected:
 
-  typedef itk::ImageFullSampler< InputImageType >   InternalFullSamplerType;
-  typedef typename InternalFullSamplerType::Pointer InternalFullSamplerPointer;
-
   /** The constructor. */
   ImageRandomSamplerSparseMask();
   /** The destructor. */
@@ -101,8 +104,33 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId );
 
-  RandomGeneratorPointer     m_RandomGenerator;
-  InternalFullSamplerPointer m_InternalFullSampler;
+  /** Build the index of the valid voxels, if the input image, the mask or
+   * the cropped input image region changed since it was last built. */
+  virtual void UpdateMaskVoxelIndex( void );
+
+  /** Get the voxelNumber-th valid voxel, in raster order. Thread-safe. */
+  void GetMaskVoxel( SizeValueType voxelNumber, ImageSampleType & sample ) const;
+
+  RandomGeneratorPointer m_RandomGenerator;
+
+  /** The index of the valid voxels. Run i starts at the linear offset
+   * m_RunOffsets[ i ] in the cropped input image region and contains the
+   * valid voxels with numbers [ m_RunCumulativeSizes[ i ], m_RunCumulativeSizes[ i + 1 ] ).
+   * m_RunLookupTable[ j ] is the run that contains voxel number j * m_RunLookupBucketSize,
+   * so that the run of a voxel is found in a few steps.
+   */
+  std::vector< SizeValueType > m_RunOffsets;
+  std::vector< SizeValueType > m_RunCumulativeSizes;
+  std::vector< SizeValueType > m_RunLookupTable;
+  SizeValueType                m_RunLookupBucketSize;
+  SizeValueType                m_NumberOfValidVoxels;
+
+  /** What the index was built for. */
+  InputImageConstPointer          m_MaskVoxelIndexInput;
+  typename MaskType::ConstPointer m_MaskVoxelIndexMask;
+  ModifiedTimeType                m_MaskVoxelIndexInputMTime;
+  ModifiedTimeType                m_MaskVoxelIndexMaskMTime;
+  InputImageRegionType            m_MaskVoxelIndexRegion;
 
 private:
 
@@ -19,6 +19,7 @@
 #define __ImageRandomSamplerSparseMask_hxx
 
 #include "itkImageRandomSamplerSparseMask.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 
 namespace itk
 {
@@ -34,7 +35,10 @@ ImageRandomSamplerSparseMask< TInputImage >
   /** Setup random generator. */
   this->m_RandomGenerator = RandomGeneratorType::GetInstance();
 
-  this->m_InternalFullSampler = InternalFullSamplerType::New();
+  this->m_RunLookupBucketSize      = 1;
+  this->m_NumberOfValidVoxels      = 0;
+  this->m_MaskVoxelIndexInputMTime = 0;
+  this->m_MaskVoxelIndexMaskMTime  = 0;
 
 } // end Constructor
 
@@ -57,42 +61,18 @@ ImageRandomSamplerSparseMask< TInputImage >
     itkExceptionMacro( << "ERROR: do not call this function when no mask is supplied." );
   }
 
-  /** Get handles to the input image and output sample container. */
-  InputImageConstPointer      inputImage      = this->GetInput();
+  /** Get handle to the output sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetOutput();
 
   /** Clear the container. */
   sampleContainer->Initialize();
 
-  /** Make sure the internal full sampler is up-to-date. */
-  this->m_InternalFullSampler->SetInput( inputImage );
-  this->m_InternalFullSampler->SetMask( mask );
-  this->m_InternalFullSampler->SetInputImageRegion( this->GetCroppedInputImageRegion() );
-
-  /** Use try/catch, since the full sampler may crash, due to insufficient memory. */
-  try
+  /** Make sure the index of valid voxels is up-to-date. */
+  this->UpdateMaskVoxelIndex();
+  if( this->m_NumberOfValidVoxels == 0 )
   {
-    this->m_InternalFullSampler->Update();
-  }
-  catch( ExceptionObject & err )
-  {
-    std::string message = "ERROR: This ImageSampler internally uses the "
-      "ImageFullSampler. Updating of this internal sampler raised the "
-      "exception:\n";
-    message += err.GetDescription();
-
-    std::string            fullSamplerMessage = err.GetDescription();
-    std::string::size_type loc                = fullSamplerMessage.find(
-      "ERROR: failed to allocate memory for the sample container", 0 );
-    if( loc != std::string::npos && this->GetMask() == 0 )
-    {
-      message += "\nYou are using the ImageRandomSamplerSparseMask sampler, "
-        "but you did not set a mask. The internal ImageFullSampler therefore "
-        "requires a lot of memory. Consider using the ImageRandomSampler "
-        "instead.";
-    }
-    const char * message2 = message.c_str();
-    itkExceptionMacro( << message2 );
+    itkExceptionMacro( << "ERROR: the mask does not contain any voxel "
+                       << "of the input image region." );
   }
 
   /** If desired we exercise a multi-threaded version. */
@@ -102,17 +82,13 @@ ImageRandomSamplerSparseMask< TInputImage >
     return Superclass::GenerateData();
   }
 
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples
-    = this->m_InternalFullSampler->GetOutput();
-  unsigned long numberOfValidSamples = allValidSamples->Size();
-
-  /** Take random samples from the allValidSamples-container. */
+  /** Take random samples from the valid voxels. */
+  sampleContainer->resize( this->GetNumberOfSamples() );
   for( unsigned int i = 0; i < this->GetNumberOfSamples(); ++i )
   {
     unsigned long randomIndex
-      = this->m_RandomGenerator->GetIntegerVariate( numberOfValidSamples - 1 );
-    sampleContainer->push_back( allValidSamples->ElementAt( randomIndex ) );
+      = this->m_RandomGenerator->GetIntegerVariate( this->m_NumberOfValidVoxels - 1 );
+    this->GetMaskVoxel( randomIndex, sampleContainer->ElementAt( i ) );
   }
 
 } // end GenerateData()
@@ -131,15 +107,11 @@ ImageRandomSamplerSparseMask< TInputImage >
   this->m_RandomNumberList.resize( 0 );
   this->m_RandomNumberList.reserve( this->m_NumberOfSamples );
 
-  /** Get a handle to the full sampler output size. */
-  const unsigned long numberOfValidSamples
-    = this->m_InternalFullSampler->GetOutput()->Size();
-
   /** Fill the list with random numbers. */
   for( unsigned int i = 0; i < this->GetNumberOfSamples(); ++i )
   {
     unsigned long randomIndex
-      = this->m_RandomGenerator->GetIntegerVariate( numberOfValidSamples - 1 );
+      = this->m_RandomGenerator->GetIntegerVariate( this->m_NumberOfValidVoxels - 1 );
     this->m_RandomNumberList.push_back( randomIndex );
   }
 
@@ -163,10 +135,6 @@ void
 ImageRandomSamplerSparseMask< TInputImage >
 ::ThreadedGenerateData( const InputImageRegionType &, ThreadIdType threadId )
 {
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples
-    = this->m_InternalFullSampler->GetOutput();
-
   /** Figure out which samples to process. */
   unsigned long chunkSize   = this->GetNumberOfSamples() / this->GetNumberOfThreads();
   unsigned long sampleStart = threadId * chunkSize;
@@ -185,17 +153,137 @@ ImageRandomSamplerSparseMask< TInputImage >
   typename ImageSampleContainerType::Iterator iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
-  /** Take random samples from the allValidSamples-container. */
+  /** Take random samples from the valid voxels. */
   unsigned long sampleId = sampleStart;
   for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter, sampleId++ )
   {
     unsigned long randomIndex = static_cast< unsigned long >( this->m_RandomNumberList[ sampleId ] );
-    ( *iter ).Value() = allValidSamples->ElementAt( randomIndex );
+    this->GetMaskVoxel( randomIndex, ( *iter ).Value() );
   }
 
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* UpdateMaskVoxelIndex *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerSparseMask< TInputImage >
+::UpdateMaskVoxelIndex( void )
+{
+  /** Get handles to the input image and the mask. */
+  InputImageConstPointer inputImage = this->GetInput();
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask->GetSource() )
+  {
+    mask->GetSource()->Update();
+  }
+
+  /** Check if the index is still valid. */
+  const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+  if( this->m_MaskVoxelIndexInput == inputImage
+    && this->m_MaskVoxelIndexMask == mask
+    && this->m_MaskVoxelIndexInputMTime == inputImage->GetMTime()
+    && this->m_MaskVoxelIndexMaskMTime == mask->GetMTime()
+    && this->m_MaskVoxelIndexRegion == region )
+  {
+    return;
+  }
+
+  /** Loop over the region in raster order, which is the order in which the
+   * ImageFullSampler would store the valid voxels, and collect the runs. */
+  this->m_RunOffsets.clear();
+  this->m_RunCumulativeSizes.clear();
+  this->m_NumberOfValidVoxels = 0;
+
+  typedef ImageRegionConstIteratorWithIndex< InputImageType > InputImageIterator;
+  InputImageIterator  iter( inputImage, region );
+  InputImagePointType point;
+  SizeValueType       offset        = 0;
+  bool                previousValid = false;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter, ++offset )
+  {
+    inputImage->TransformIndexToPhysicalPoint( iter.GetIndex(), point );
+    const bool valid = mask->IsInside( point );
+    if( valid )
+    {
+      if( !previousValid )
+      {
+        this->m_RunOffsets.push_back( offset );
+        this->m_RunCumulativeSizes.push_back( this->m_NumberOfValidVoxels );
+      }
+      ++this->m_NumberOfValidVoxels;
+    }
+    previousValid = valid;
+  }
+  this->m_RunCumulativeSizes.push_back( this->m_NumberOfValidVoxels );
+
+  /** Build the lookup table, with about one bucket per run. */
+  const SizeValueType numberOfRuns = this->m_RunOffsets.size();
+  this->m_RunLookupTable.clear();
+  this->m_RunLookupBucketSize = 1;
+  if( numberOfRuns > 0 )
+  {
+    this->m_RunLookupBucketSize
+      = ( this->m_NumberOfValidVoxels + numberOfRuns - 1 ) / numberOfRuns;
+    SizeValueType run = 0;
+    for( SizeValueType voxelNumber = 0; voxelNumber < this->m_NumberOfValidVoxels;
+      voxelNumber += this->m_RunLookupBucketSize )
+    {
+      while( this->m_RunCumulativeSizes[ run + 1 ] <= voxelNumber )
+      {
+        ++run;
+      }
+      this->m_RunLookupTable.push_back( run );
+    }
+  }
+
+  this->m_MaskVoxelIndexInput      = inputImage;
+  this->m_MaskVoxelIndexMask       = mask;
+  this->m_MaskVoxelIndexInputMTime = inputImage->GetMTime();
+  this->m_MaskVoxelIndexMaskMTime  = mask->GetMTime();
+  this->m_MaskVoxelIndexRegion     = region;
+
+} // end UpdateMaskVoxelIndex()
+
+
+/**
+ * ******************* GetMaskVoxel *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerSparseMask< TInputImage >
+::GetMaskVoxel( SizeValueType voxelNumber, ImageSampleType & sample ) const
+{
+  /** Find the run that contains the voxel. */
+  SizeValueType run = this->m_RunLookupTable[ voxelNumber / this->m_RunLookupBucketSize ];
+  while( this->m_RunCumulativeSizes[ run + 1 ] <= voxelNumber )
+  {
+    ++run;
+  }
+  SizeValueType offset = this->m_RunOffsets[ run ]
+    + ( voxelNumber - this->m_RunCumulativeSizes[ run ] );
+
+  /** Convert the linear offset in the region to an index. */
+  const InputImageRegionType & region = this->m_MaskVoxelIndexRegion;
+  InputImageIndexType          index;
+  for( unsigned int i = 0; i < InputImageDimension; ++i )
+  {
+    const SizeValueType size = region.GetSize()[ i ];
+    index[ i ] = region.GetIndex()[ i ] + static_cast< IndexValueType >( offset % size );
+    offset    /= size;
+  }
+
+  /** Translate index to point and get the image value. */
+  this->m_MaskVoxelIndexInput->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+  sample.m_ImageValue = this->m_MaskVoxelIndexInput->GetPixel( index );
+
+} // end GetMaskVoxel()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -207,7 +295,8 @@ ImageRandomSamplerSparseMask< TInputImage >
 {
   Superclass::PrintSelf( os, indent );
 
-  os << indent << "InternalFullSampler: " << this->m_InternalFullSampler.GetPointer() << std::endl;
+  os << indent << "NumberOfValidVoxels: " << this->m_NumberOfValidVoxels << std::endl;
+  os << indent << "NumberOfRuns: " << this->m_RunOffsets.size() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
 
 } // end PrintSelf()
@@ -28,6 +28,8 @@ namespace itk
  * \brief A class that defines an image sample, which is
  * the coordinates of a point and its value.
  *
+ * The weight corrects for a non-uniform selection of the samples, see
+ * ImageImportanceSampler. It is 1 for all other samplers.
  */
 
 template< class TImage >
@@ -36,7 +38,7 @@ class ImageSample
 public:
 
   //ImageSample():m_ImageValue(0.0){};
-  ImageSample(){}
+  ImageSample() : m_Weight( 1.0 ) {}
   ~ImageSample() {}
 
   /** Typedef's. */
@@ -48,6 +50,7 @@ public:
   /** Member variables. */
   PointType m_ImageCoordinates;
   RealType  m_ImageValue;
+  RealType  m_Weight;
 };
 
 } // end namespace itk
@@ -0,0 +1,191 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageSampleSoAContainer_h
+#define __itkImageSampleSoAContainer_h
+
+#include "itkDataObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageSample.h"
+#include "itkAlignedBufferArena.h"
+
+namespace itk
+{
+
+/** \class ImageSampleSoAContainer
+ *
+ * \brief A container of image samples in structure-of-arrays layout.
+ *
+ * The image samplers produce a VectorDataContainer of ImageSample objects,
+ * i.e. an array of structs, with the point and the value of each sample next
+ * to each other. This class stores the same samples as one array per
+ * coordinate dimension plus one array of values. All arrays are aligned at
+ * a cache line, and their length is padded to a whole number of cache lines,
+ * so that a metric can process consecutive samples with vector loads and only
+ * touches the components it needs.
+ *
+ * The padding elements at the end of the arrays are zero.
+ *
+ * The arrays are allocated from the AlignedBufferArena, so that the
+ * containers of the next resolution or registration reuse them.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template< class TImage >
+class ImageSampleSoAContainer : public DataObject
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ImageSampleSoAContainer    Self;
+  typedef DataObject                 Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageSampleSoAContainer, DataObject );
+
+  /** Typedefs. */
+  typedef ImageSample< TImage >                   ImageSampleType;
+  typedef typename ImageSampleType::PointType     PointType;
+  typedef typename PointType::ValueType           CoordinateType;
+  typedef typename ImageSampleType::RealType      ValueType;
+  itkStaticConstMacro( ImageDimension, unsigned int, PointType::PointDimension );
+
+  /** The alignment of the arrays in bytes. */
+  itkStaticConstMacro( Alignment, unsigned int, AlignedBufferArena::Alignment );
+
+  /** Set the number of samples. The contents of the arrays is undefined
+   * afterwards, except for the padding elements, which are zero.
+   */
+  void SetSize( SizeValueType numberOfSamples );
+
+  /** Get the number of samples. */
+  SizeValueType Size( void ) const
+  {
+    return this->m_Size;
+  }
+
+
+  /** Get the length of the arrays, i.e. the number of samples rounded up to
+   * a whole number of cache lines.
+   */
+  SizeValueType GetStride( void ) const
+  {
+    return this->m_Stride;
+  }
+
+
+  /** Get the coordinates of dimension dim of all samples. */
+  CoordinateType * GetCoordinates( unsigned int dim )
+  {
+    return this->m_Coordinates + dim * this->m_Stride;
+  }
+
+
+  const CoordinateType * GetCoordinates( unsigned int dim ) const
+  {
+    return this->m_Coordinates + dim * this->m_Stride;
+  }
+
+
+  /** Get the values of all samples. */
+  ValueType * GetValues( void )
+  {
+    return this->m_Values;
+  }
+
+
+  const ValueType * GetValues( void ) const
+  {
+    return this->m_Values;
+  }
+
+
+  /** Get the point of sample i. */
+  PointType GetPoint( SizeValueType i ) const
+  {
+    PointType point;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      point[ d ] = this->m_Coordinates[ d * this->m_Stride + i ];
+    }
+    return point;
+  }
+
+
+  /** Set sample i. */
+  void SetSample( SizeValueType i, const ImageSampleType & sample )
+  {
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      this->m_Coordinates[ d * this->m_Stride + i ] = sample.m_ImageCoordinates[ d ];
+    }
+    this->m_Values[ i ] = sample.m_ImageValue;
+  }
+
+
+  /** Copy the samples of an array-of-structs container, for example the
+   * output of an image sampler.
+   */
+  template< class TContainer >
+  void CopyFrom( const TContainer & container )
+  {
+    this->SetSize( container.size() );
+    for( SizeValueType i = 0; i < this->m_Size; ++i )
+    {
+      this->SetSample( i, container[ i ] );
+    }
+  }
+
+
+  /** Restore the DataObject to its initial state, releasing the memory. */
+  virtual void Initialize( void ) ITK_OVERRIDE;
+
+protected:
+
+  ImageSampleSoAContainer();
+  virtual ~ImageSampleSoAContainer() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  ImageSampleSoAContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );          // purposely not implemented
+
+  SizeValueType      m_Size;
+  SizeValueType      m_Stride;
+  AlignedArenaBuffer m_CoordinateBuffer;
+  AlignedArenaBuffer m_ValueBuffer;
+  CoordinateType *   m_Coordinates;
+  ValueType *        m_Values;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageSampleSoAContainer.hxx"
+#endif
+
+#endif // end #ifndef __itkImageSampleSoAContainer_h
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageSampleSoAContainer_hxx
+#define __itkImageSampleSoAContainer_hxx
+
+#include "itkImageSampleSoAContainer.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TImage >
+ImageSampleSoAContainer< TImage >
+::ImageSampleSoAContainer()
+{
+  this->m_Size        = 0;
+  this->m_Stride      = 0;
+  this->m_Coordinates = 0;
+  this->m_Values      = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* SetSize *******************
+ */
+
+template< class TImage >
+void
+ImageSampleSoAContainer< TImage >
+::SetSize( SizeValueType numberOfSamples )
+{
+  /** Round the length of the arrays up to a whole number of cache lines.
+   * Both element types are assumed to divide the cache line size.
+   */
+  const SizeValueType elementsPerLine = Alignment / sizeof( CoordinateType );
+  const SizeValueType stride
+    = ( numberOfSamples + elementsPerLine - 1 ) / elementsPerLine * elementsPerLine;
+
+  /** The arena keeps the arrays if their length does not change. */
+  this->m_Coordinates = static_cast< CoordinateType * >(
+    this->m_CoordinateBuffer.Resize( ImageDimension * stride * sizeof( CoordinateType ) ) );
+  this->m_Values = static_cast< ValueType * >(
+    this->m_ValueBuffer.Resize( stride * sizeof( ValueType ) ) );
+  this->m_Stride = stride;
+
+  /** Zero the padding elements; memory from the arena is not zeroed. */
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    std::fill( this->GetCoordinates( d ) + numberOfSamples,
+      this->GetCoordinates( d ) + stride, CoordinateType( 0 ) );
+  }
+  std::fill( this->m_Values + numberOfSamples, this->m_Values + stride, ValueType( 0 ) );
+
+  this->m_Size = numberOfSamples;
+  this->Modified();
+
+} // end SetSize()
+
+
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TImage >
+void
+ImageSampleSoAContainer< TImage >
+::Initialize( void )
+{
+  Superclass::Initialize();
+
+  this->m_Size        = 0;
+  this->m_Stride      = 0;
+  this->m_CoordinateBuffer.Release();
+  this->m_ValueBuffer.Release();
+  this->m_Coordinates = 0;
+  this->m_Values      = 0;
+
+} // end Initialize()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TImage >
+void
+ImageSampleSoAContainer< TImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Size: " << this->m_Size << std::endl;
+  os << indent << "Stride: " << this->m_Stride << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageSampleSoAContainer_hxx
@@ -21,6 +21,8 @@
 #include "itkImageToVectorContainerFilter.h"
 #include "itkImageSample.h"
 #include "itkVectorDataContainer.h"
+#include "itkImageSampleSoAContainer.h"
+#include "itkImplicitImageSampleGrid.h"
 #include "itkSpatialObject.h"
 
 namespace itk
@@ -77,6 +79,9 @@ public:
   typedef ImageSample< InputImageType >                         ImageSampleType;
   typedef VectorDataContainer< unsigned long, ImageSampleType > ImageSampleContainerType;
   typedef typename ImageSampleContainerType::Pointer            ImageSampleContainerPointer;
+  typedef ImageSampleSoAContainer< InputImageType >             ImageSampleSoAContainerType;
+  typedef typename ImageSampleSoAContainerType::Pointer         ImageSampleSoAContainerPointer;
+  typedef ImplicitImageSampleGrid< InputImageType >             ImplicitSampleGridType;
   typedef typename InputImageType::SizeType                     InputImageSizeType;
   typedef typename InputImageType::IndexType                    InputImageIndexType;
   typedef typename InputImageType::PointType                    InputImagePointType;
@@ -160,6 +165,12 @@ public:
     return true;
   }
 
+  /** Returns whether the samples may have weights other than 1. */
+  virtual bool GetUseSampleWeights( void ) const
+  {
+    return false;
+  }
+
 
   /** Get a handle to the cropped InputImageregion. */
   itkGetConstReferenceMacro( CroppedInputImageRegion, InputImageRegionType );
@@ -167,9 +178,44 @@ public:
   /** Get the number of samples. */
   itkGetConstMacro( NumberOfSamples, unsigned long );
 
+  /** Get the output samples in structure-of-arrays layout, for metrics
+   * that process consecutive samples with vector instructions. The output
+   * is converted on the first call after the output has been updated, so
+   * call this function from a single thread, after Update().
+   */
+  virtual const ImageSampleSoAContainerType * GetOutputSoA( void );
+
   /** \todo: Temporary, should think about interface. */
   itkSetMacro( UseMultiThread, bool );
 
+  /** Set/Get whether metrics may generate the samples on the fly, with
+   * GetImplicitSampleGrid(), instead of reading them from the output.
+   * Default: false. */
+  itkSetMacro( UseImplicitSampling, bool );
+  itkGetConstMacro( UseImplicitSampling, bool );
+  itkBooleanMacro( UseImplicitSampling );
+
+  /** Describe the samples by an implicit grid, so that a metric can generate
+   * them on the fly, without calling Update(). The output is then not
+   * generated at all. Returns false if UseImplicitSampling is off, or the
+   * sampler does not support it; the metric should then use the output.
+   * Call this function from a single thread.
+   */
+  virtual bool GetImplicitSampleGrid( ImplicitSampleGridType & itkNotUsed( grid ) )
+  {
+    return false;
+  }
+
+
+  /** Get whether all samples are at voxel positions of the input image.
+   * Samplers that take samples in between the voxels return false.
+   */
+  virtual bool GetSamplesAreOnVoxelGrid( void ) const
+  {
+    return true;
+  }
+
+
 protected:
 
   /** The constructor. */
@@ -203,12 +249,31 @@ protected:
 
   virtual void AfterThreadedGenerateData( void );
 
+  /** Fill the implicit grid for the current input and mask. The number of
+   * samples inside the mask is cached, and recounted only when the grid, the
+   * input or the mask changed. Returns false if the input buffer does not
+   * contain the grid. */
+  bool InitializeImplicitSampleGrid( const InputImageIndexType & start,
+    const InputImageSizeType & gridSize,
+    const typename InputImageType::OffsetType & gridSpacing,
+    ImplicitSampleGridType & grid );
+
   /***/
   unsigned long                              m_NumberOfSamples;
   std::vector< ImageSampleContainerPointer > m_ThreaderSampleContainer;
 
   //tmp?
   bool m_UseMultiThread;
+  bool m_UseImplicitSampling;
+
+  /** The last implicit grid, for the cached number of samples. */
+  ImplicitSampleGridType m_ImplicitSampleGrid;
+  ModifiedTimeType       m_ImplicitSampleGridInputMTime;
+  ModifiedTimeType       m_ImplicitSampleGridMaskMTime;
+
+  /** The output in structure-of-arrays layout, see GetOutputSoA(). */
+  ImageSampleSoAContainerPointer m_OutputSoA;
+  ModifiedTimeType               m_OutputSoAUpdateTime;
 
 private:
 
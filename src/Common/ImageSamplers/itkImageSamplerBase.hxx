@@ -19,6 +19,7 @@
 #define __ImageSamplerBase_hxx
 
 #include "itkImageSamplerBase.h"
+#include "itkRegistrationProgress.h"
 
 namespace itk
 {
@@ -37,7 +38,14 @@ ImageSamplerBase< TInputImage >
   this->m_NumberOfSamples           = 0;
 
   //tmp?
-  this->m_UseMultiThread = false;
+  this->m_UseMultiThread      = false;
+  this->m_UseImplicitSampling = false;
+
+  this->m_ImplicitSampleGridInputMTime = 0;
+  this->m_ImplicitSampleGridMaskMTime  = 0;
+
+  this->m_OutputSoA           = ImageSampleSoAContainerType::New();
+  this->m_OutputSoAUpdateTime = 0;
 
 } // end Constructor()
 
@@ -426,6 +434,58 @@ ImageSamplerBase< TInputImage >
 } // end BeforeThreadedGenerateData()
 
 
+/**
+ * ******************* InitializeImplicitSampleGrid *******************
+ */
+
+template< class TInputImage >
+bool
+ImageSamplerBase< TInputImage >
+::InitializeImplicitSampleGrid( const InputImageIndexType & start,
+  const InputImageSizeType & gridSize,
+  const typename InputImageType::OffsetType & gridSpacing,
+  ImplicitSampleGridType & grid )
+{
+  InputImageConstPointer inputImage = this->GetInput();
+  MaskConstPointer       mask       = this->GetMask();
+
+  /** The grid reads the buffer directly, so it has to contain all grid points. */
+  InputImageIndexType last = start;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    if( gridSize[ d ] == 0 ) { return false; }
+    last[ d ] += static_cast< IndexValueType >( gridSize[ d ] - 1 ) * gridSpacing[ d ];
+  }
+  const InputImageRegionType & buffered = inputImage->GetBufferedRegion();
+  if( !buffered.IsInside( start ) || !buffered.IsInside( last ) )
+  {
+    return false;
+  }
+
+  /** Reuse the number of samples if nothing changed. */
+  const ModifiedTimeType maskMTime = mask.IsNotNull() ? mask->GetMTime() : 0;
+  if( this->m_ImplicitSampleGrid.GetImage() == inputImage.GetPointer()
+    && this->m_ImplicitSampleGrid.GetMask() == mask.GetPointer()
+    && this->m_ImplicitSampleGrid.GetStart() == start
+    && this->m_ImplicitSampleGrid.GetGridSize() == gridSize
+    && this->m_ImplicitSampleGrid.GetGridSpacing() == gridSpacing
+    && this->m_ImplicitSampleGridInputMTime == inputImage->GetMTime()
+    && this->m_ImplicitSampleGridMaskMTime == maskMTime )
+  {
+    grid = this->m_ImplicitSampleGrid;
+    return true;
+  }
+
+  this->m_ImplicitSampleGrid.Initialize( inputImage, mask, start, gridSize, gridSpacing );
+  this->m_ImplicitSampleGrid.CountSamples();
+  this->m_ImplicitSampleGridInputMTime = inputImage->GetMTime();
+  this->m_ImplicitSampleGridMaskMTime  = maskMTime;
+  grid                                 = this->m_ImplicitSampleGrid;
+  return true;
+
+} // end InitializeImplicitSampleGrid()
+
+
 /**
  * ******************* AfterThreadedGenerateData *******************
  */
@@ -435,6 +495,9 @@ void
 ImageSamplerBase< TInputImage >
 ::AfterThreadedGenerateData( void )
 {
+  /** The threads return early if the registration was cancelled. */
+  RegistrationProgress::ThrowIfCurrentCancelRequested();
+
   /** Get the combined number of samples. */
   this->m_NumberOfSamples = 0;
   for( std::size_t i = 0; i < this->GetNumberOfThreads(); i++ )
@@ -458,6 +521,29 @@ ImageSamplerBase< TInputImage >
 } // end AfterThreadedGenerateData()
 
 
+/**
+ * ******************* GetOutputSoA *******************
+ */
+
+template< class TInputImage >
+const typename ImageSamplerBase< TInputImage >::ImageSampleSoAContainerType *
+ImageSamplerBase< TInputImage >
+::GetOutputSoA( void )
+{
+  /** Convert the output if it has been regenerated since the last call. */
+  const ImageSampleContainerType * sampleContainer = this->GetOutput();
+  if( sampleContainer->GetUpdateMTime() != this->m_OutputSoAUpdateTime
+    || sampleContainer->Size() != this->m_OutputSoA->Size() )
+  {
+    this->m_OutputSoA->CopyFrom( sampleContainer->CastToSTLConstContainer() );
+    this->m_OutputSoAUpdateTime = sampleContainer->GetUpdateMTime();
+  }
+
+  return this->m_OutputSoA.GetPointer();
+
+} // end GetOutputSoA()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -485,6 +571,7 @@ ImageSamplerBase< TInputImage >
     os << indent.GetNextIndent() << this->m_InputImageRegionVector[ i ] << std::endl;
   }
   os << indent << "CroppedInputImageRegion" << this->m_CroppedInputImageRegion << std::endl;
+  os << indent << "UseImplicitSampling: " << this->m_UseImplicitSampling << std::endl;
 
 } // end PrintSelf()
 
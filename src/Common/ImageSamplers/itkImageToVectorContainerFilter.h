@@ -19,6 +19,8 @@
 #define __itkImageToVectorContainerFilter_h
 
 #include "itkVectorContainerSource.h"
+#include "itkPersistentThreadPool.h"
+#include "itkPhaseTimer.h"
 
 namespace itk
 {
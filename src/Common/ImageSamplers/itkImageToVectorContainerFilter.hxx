@@ -227,11 +227,10 @@ ImageToVectorContainerFilter< TInputImage, TOutputVectorContainer >
   ThreadStruct str;
   str.Filter = this;
 
-  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
-  this->GetMultiThreader()->SetSingleMethod( this->ThreaderCallback, &str );
-
-  // multithread the execution
-  this->GetMultiThreader()->SingleMethodExecute();
+  // multithread the execution, using the persistent thread pool instead of
+  // spawning new threads for every update of the sampler
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->GetNumberOfThreads(), this->ThreaderCallback, &str );
 
   // Call a method that can be overridden by a subclass to perform
   // some calculations after all the threads have completed
@@ -287,6 +286,7 @@ ImageToVectorContainerFilter< TInputImage, TOutputVectorContainer >
 
   if( threadId < total )
   {
+    itkPhaseTimerThreadMacro( "SamplerThreadedGenerateData", threadId );
     str->Filter->ThreadedGenerateData( splitRegion, threadId );
   }
   // else
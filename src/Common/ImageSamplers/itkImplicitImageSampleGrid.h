@@ -0,0 +1,173 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __ImplicitImageSampleGrid_h
+#define __ImplicitImageSampleGrid_h
+
+#include "itkImageSample.h"
+#include "itkSpatialObject.h"
+
+namespace itk
+{
+
+/** \class ImplicitImageSampleGrid
+ *
+ * \brief Generates the samples of a regular grid on the fly.
+ *
+ * The ImageGridSampler and the ImageFullSampler store a sample (a point and
+ * a value) for every grid point in their output container, which takes
+ * gigabytes for a full sampler on a large image. This class describes the
+ * same samples by the first grid index, the grid size, the grid spacing in
+ * voxels and the mask only. Sample i is computed from its index, so the
+ * samples can be generated by any number of threads, in any order.
+ *
+ * Grid points outside the mask are not samples; GetSample() then returns
+ * false. GetNumberOfSamples() is the number of grid points inside the mask,
+ * which equals the size of the container of the sampler.
+ *
+ * The grid does not own the input image: it is only valid as long as the
+ * sampler that filled it keeps its input.
+ *
+ * \sa ImageSamplerBase::GetImplicitSampleGrid()
+ * \ingroup ImageSamplers
+ */
+
+template< class TInputImage >
+class ImplicitImageSampleGrid
+{
+public:
+
+  /** Typedefs. */
+  typedef TInputImage                              InputImageType;
+  typedef typename InputImageType::IndexType       IndexType;
+  typedef typename InputImageType::SizeType        SizeType;
+  typedef typename InputImageType::OffsetType      OffsetType;
+  typedef ImageSample< InputImageType >            ImageSampleType;
+  typedef typename ImageSampleType::RealType       ImageSampleValueType;
+
+  /** The input image dimension. */
+  itkStaticConstMacro( InputImageDimension, unsigned int,
+    InputImageType::ImageDimension );
+
+  typedef SpatialObject< itkGetStaticConstMacro( InputImageDimension ) > MaskType;
+  typedef typename MaskType::ConstPointer                                 MaskConstPointer;
+
+  ImplicitImageSampleGrid()
+  {
+    this->m_Image              = 0;
+    this->m_NumberOfGridPoints = 0;
+    this->m_NumberOfSamples    = 0;
+    this->m_Start.Fill( 0 );
+    this->m_GridSize.Fill( 0 );
+    this->m_GridSpacing.Fill( 1 );
+  }
+
+
+  /** Set the grid. The number of samples is not computed here, see CountSamples(). */
+  void Initialize( const InputImageType * image, const MaskType * mask,
+    const IndexType & start, const SizeType & gridSize, const OffsetType & gridSpacing )
+  {
+    this->m_Image              = image;
+    this->m_Mask               = mask;
+    this->m_Start              = start;
+    this->m_GridSize           = gridSize;
+    this->m_GridSpacing        = gridSpacing;
+    this->m_NumberOfGridPoints = 1;
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      this->m_NumberOfGridPoints *= gridSize[ d ];
+    }
+    this->m_NumberOfSamples = this->m_Mask.IsNull() ? this->m_NumberOfGridPoints : 0;
+  }
+
+
+  /** Count the grid points inside the mask. This visits all grid points, so
+   * the sampler caches the result. */
+  void CountSamples( void )
+  {
+    if( this->m_Mask.IsNull() )
+    {
+      return;
+    }
+    ImageSampleType sample;
+    IndexType       index;
+    this->m_NumberOfSamples = 0;
+    for( SizeValueType i = 0; i < this->m_NumberOfGridPoints; ++i )
+    {
+      if( this->IsInside( i, index, sample ) )
+      {
+        ++this->m_NumberOfSamples;
+      }
+    }
+  }
+
+
+  /** The number of grid points, and the number of those inside the mask. */
+  SizeValueType GetNumberOfGridPoints( void ) const { return this->m_NumberOfGridPoints; }
+  SizeValueType GetNumberOfSamples( void ) const { return this->m_NumberOfSamples; }
+  void SetNumberOfSamples( SizeValueType n ) { this->m_NumberOfSamples = n; }
+
+  const InputImageType * GetImage( void ) const { return this->m_Image; }
+  const MaskType * GetMask( void ) const { return this->m_Mask.GetPointer(); }
+  const IndexType & GetStart( void ) const { return this->m_Start; }
+  const SizeType & GetGridSize( void ) const { return this->m_GridSize; }
+  const OffsetType & GetGridSpacing( void ) const { return this->m_GridSpacing; }
+
+  /** Compute grid point i, in raster order. Returns false if it is outside
+   * the mask; the value is then not read. */
+  bool GetSample( SizeValueType i, ImageSampleType & sample ) const
+  {
+    IndexType index;
+    if( !this->IsInside( i, index, sample ) )
+    {
+      return false;
+    }
+    sample.m_ImageValue = static_cast< ImageSampleValueType >( this->m_Image->GetPixel( index ) );
+    sample.m_Weight = 1.0;
+    return true;
+  }
+
+
+private:
+
+  /** Compute the point of grid point i, and check the mask. */
+  bool IsInside( SizeValueType i, IndexType & index, ImageSampleType & sample ) const
+  {
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      index[ d ] = this->m_Start[ d ] + static_cast< IndexValueType >( i % this->m_GridSize[ d ] )
+        * this->m_GridSpacing[ d ];
+      i /= this->m_GridSize[ d ];
+    }
+    this->m_Image->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+    return this->m_Mask.IsNull() || this->m_Mask->IsInside( sample.m_ImageCoordinates );
+  }
+
+
+  const InputImageType * m_Image;
+  MaskConstPointer       m_Mask;
+  IndexType              m_Start;
+  SizeType               m_GridSize;
+  OffsetType             m_GridSpacing;
+  SizeValueType          m_NumberOfGridPoints;
+  SizeValueType          m_NumberOfSamples;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __ImplicitImageSampleGrid_h
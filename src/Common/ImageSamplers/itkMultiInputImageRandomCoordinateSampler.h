@@ -19,8 +19,10 @@
 #define __MultiInputImageRandomCoordinateSampler_h
 
 #include "itkImageRandomSamplerBase.h"
+#include "itkPhiloxRandomNumberGenerator.h"
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -33,6 +35,13 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * Without masks the samples are generated multi-threaded, when UseMultiThread
+ * is set. With UseCounterBasedRandomGenerator the coordinates are computed
+ * by a counter-based random generator, as in the ImageRandomCoordinateSampler:
+ * sample i is a function of the Seed, the number of updates and i only, so
+ * the samples are generated multi-threaded also when masks are used, and do
+ * not depend on the number of threads.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -83,7 +92,8 @@ public:
   typedef double                                                                  CoordRepType;
   typedef InterpolateImageFunction< InputImageType, CoordRepType >                InterpolatorType;
   typedef typename InterpolatorType::Pointer                                      InterpolatorPointer;
-  typedef BSplineInterpolateImageFunction< InputImageType, CoordRepType, double > DefaultInterpolatorType;
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, CoordRepType, InternalBufferRealType >                      DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
@@ -104,6 +114,28 @@ public:
   itkGetConstMacro( UseRandomSampleRegion, bool );
   itkSetMacro( UseRandomSampleRegion, bool );
 
+  /** Set/Get whether to use the counter-based random generator. Default: false. */
+  itkSetMacro( UseCounterBasedRandomGenerator, bool );
+  itkGetConstMacro( UseCounterBasedRandomGenerator, bool );
+  itkBooleanMacro( UseCounterBasedRandomGenerator );
+
+  /** Set/Get the seed of the counter-based random generator. Default: 121212. */
+  itkSetMacro( Seed, unsigned int );
+  itkGetConstMacro( Seed, unsigned int );
+
+  /** Set/Get the number of updates done with the counter-based random
+   * generator; the samples of an update are keyed by its number. Setting it
+   * continues the sequence of samples, e.g. to resume a registration. */
+  itkSetMacro( NumberOfUpdates, PhiloxRandomNumberGenerator::WordType );
+  itkGetConstMacro( NumberOfUpdates, PhiloxRandomNumberGenerator::WordType );
+
+  /** The samples are in between the voxels. */
+  virtual bool GetSamplesAreOnVoxelGrid( void ) const
+  {
+    return false;
+  }
+
+
 protected:
 
   typedef typename InterpolatorType::ContinuousIndexType InputImageContinuousIndexType;
@@ -120,6 +152,15 @@ protected:
   /** Function that does the work. */
   virtual void GenerateData( void );
 
+  /** Multi-threaded functionality that does the work. */
+  virtual void BeforeThreadedGenerateData( void );
+
+  virtual void ThreadedGenerateData(
+    const InputImageRegionType & inputRegionForThread,
+    ThreadIdType threadId );
+
+  virtual void AfterThreadedGenerateData( void );
+
   /** Generate a point randomly in a bounding box.
    * This method can be overwritten in subclasses if a different distribution is desired. */
   virtual void GenerateRandomCoordinate(
@@ -136,6 +177,18 @@ protected:
     InputImageContinuousIndexType & smallestContIndex,
     InputImageContinuousIndexType & largestContIndex );
 
+  /** The counter-based random generator. */
+  typedef PhiloxRandomNumberGenerator               CounterBasedRandomGeneratorType;
+  typedef CounterBasedRandomGeneratorType::WordType CounterType;
+
+  /** Generate sample sampleIndex of the current update using the counter-based
+   * generator. Candidate coordinates are drawn until a point inside all masks
+   * is found. Returns false when the total numberOfTries exceeds the maximum
+   * number of tries.
+   */
+  bool GenerateCounterBasedSample( SizeValueType sampleIndex,
+    SizeValueType & numberOfTries, ImageSampleType & sample ) const;
+
 private:
 
   /** The private constructor. */
@@ -145,6 +198,18 @@ private:
 
   bool m_UseRandomSampleRegion;
 
+  /** The sample region of the current update, used by the threads. */
+  InputImageContinuousIndexType m_SmallestContIndex;
+  InputImageContinuousIndexType m_LargestContIndex;
+
+  /** Variables for the counter-based random generator. */
+  bool                            m_UseCounterBasedRandomGenerator;
+  unsigned int                    m_Seed;
+  CounterType                     m_NumberOfUpdates;
+  CounterBasedRandomGeneratorType m_CounterBasedRandomGenerator;
+  SizeValueType                   m_MaximumNumberOfTries;
+  std::vector< SizeValueType >    m_ThreaderNumberOfTries;
+
 };
 
 } // end namespace itk
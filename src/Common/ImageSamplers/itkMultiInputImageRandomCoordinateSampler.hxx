@@ -45,6 +45,11 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   this->m_UseRandomSampleRegion = false;
   this->m_SampleRegionSize.Fill( 1.0 );
 
+  this->m_UseCounterBasedRandomGenerator = false;
+  this->m_Seed                           = 121212;
+  this->m_NumberOfUpdates                = 0;
+  this->m_MaximumNumberOfTries           = 0;
+
 }   // end Constructor()
 
 
@@ -73,6 +78,55 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   /** Set up the interpolator. */
   interpolator->SetInputImage( inputImage );
 
+  /** The counter-based generator supports the multi-threaded version also
+   * when masks are supplied, and gives the same samples in both versions. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    if( mask.IsNotNull() )
+    {
+      this->UpdateAllMasks();
+    }
+
+    /** Every update gets its own key, such that new samples are selected.
+     * The key is also used by GenerateRandomCoordinate(), for the sample region. */
+    ++this->m_NumberOfUpdates;
+    this->m_CounterBasedRandomGenerator.SetKey(
+      static_cast< CounterType >( this->m_Seed ), this->m_NumberOfUpdates );
+    this->GenerateSampleRegion( this->m_SmallestContIndex, this->m_LargestContIndex );
+
+    /** The same budget as in the single-threaded version below. */
+    this->m_MaximumNumberOfTries = 10 * this->GetNumberOfSamples();
+
+    if( this->m_UseMultiThread )
+    {
+      /** Calls ThreadedGenerateData(). */
+      Superclass::GenerateData();
+      return;
+    }
+
+    sampleContainer->resize( this->GetNumberOfSamples() );
+    SizeValueType numberOfTries = 0;
+    for( SizeValueType i = 0; i < this->GetNumberOfSamples(); ++i )
+    {
+      if( !this->GenerateCounterBasedSample( i, numberOfTries, sampleContainer->ElementAt( i ) ) )
+      {
+        /** Squeeze the sample container to the size that is still valid. */
+        sampleContainer->resize( i );
+        itkExceptionMacro( << "Could not find enough image samples within "
+                           << "reasonable time. Probably the mask is too small" );
+      }
+    }
+    return;
+  }
+
+  /** If there was no mask supplied we exercise a multi-threaded version. */
+  if( mask.IsNull() && this->m_UseMultiThread )
+  {
+    /** Calls ThreadedGenerateData(). */
+    Superclass::GenerateData();
+    return;
+  }
+
   /** Get the intersection of all sample regions. */
   InputImageContinuousIndexType smallestContIndex;
   InputImageContinuousIndexType largestContIndex;
@@ -159,6 +213,196 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
 }   // end GenerateData()
 
 
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::BeforeThreadedGenerateData( void )
+{
+  /** The counter-based generator needs no list of random numbers. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    this->m_ThreaderNumberOfTries.assign( this->GetNumberOfThreads(), 0 );
+    Superclass::Superclass::BeforeThreadedGenerateData();
+    return;
+  }
+
+  /** Get the intersection of all sample regions. */
+  InputImageContinuousIndexType smallestContIndex;
+  InputImageContinuousIndexType largestContIndex;
+  InputImageContinuousIndexType randomContIndex;
+  this->GenerateSampleRegion( smallestContIndex, largestContIndex );
+
+  /** Fill the list with random numbers, on this thread, so that the
+   * samples equal those of the single-threaded version. */
+  this->m_RandomNumberList.resize( 0 );
+  this->m_RandomNumberList.reserve( this->m_NumberOfSamples * InputImageDimension );
+  for( unsigned long i = 0; i < this->m_NumberOfSamples; i++ )
+  {
+    this->GenerateRandomCoordinate( smallestContIndex, largestContIndex, randomContIndex );
+    for( unsigned int j = 0; j < InputImageDimension; ++j )
+    {
+      this->m_RandomNumberList.push_back( randomContIndex[ j ] );
+    }
+  }
+
+  /** Initialize variables needed for threads. */
+  Superclass::Superclass::BeforeThreadedGenerateData();
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::ThreadedGenerateData( const InputImageRegionType &, ThreadIdType threadId )
+{
+  /** Sanity check. */
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask.IsNotNull() && !this->m_UseCounterBasedRandomGenerator )
+  {
+    itkExceptionMacro( << "ERROR: do not call this function when a mask is supplied." );
+  }
+
+  /** Get handle to the input image. */
+  InputImageConstPointer inputImage = this->GetInput();
+
+  /** Figure out which samples to process. */
+  unsigned long chunkSize   = this->GetNumberOfSamples() / this->GetNumberOfThreads();
+  unsigned long firstSample = threadId * chunkSize;
+  if( threadId == this->GetNumberOfThreads() - 1 )
+  {
+    chunkSize = this->GetNumberOfSamples()
+      - ( ( this->GetNumberOfThreads() - 1 ) * chunkSize );
+  }
+
+  /** Get a reference to the output and reserve memory for it. */
+  ImageSampleContainerType & sampleContainerThisThread
+    = *this->m_ThreaderSampleContainer[ threadId ];
+  sampleContainerThisThread.Reserve( chunkSize );
+
+  /** Compute the samples directly from their index. The budget of tries is
+   * checked per thread here, and in total in AfterThreadedGenerateData(). */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    SizeValueType & numberOfTries = this->m_ThreaderNumberOfTries[ threadId ];
+    for( SizeValueType i = 0; i < chunkSize; ++i )
+    {
+      if( !this->GenerateCounterBasedSample( firstSample + i,
+        numberOfTries, sampleContainerThisThread.ElementAt( i ) ) )
+      {
+        sampleContainerThisThread.resize( i );
+        break;
+      }
+    }
+    return;
+  }
+
+  /** Fill the local sample container from the list of random numbers. */
+  InputImageContinuousIndexType sampleContIndex;
+  const double *                randomNumbers
+    = &this->m_RandomNumberList[ firstSample * InputImageDimension ];
+  for( SizeValueType i = 0; i < chunkSize; ++i )
+  {
+    for( unsigned int j = 0; j < InputImageDimension; ++j )
+    {
+      sampleContIndex[ j ] = *randomNumbers++;
+    }
+
+    ImageSampleType & sample = sampleContainerThisThread.ElementAt( i );
+    inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, sample.m_ImageCoordinates );
+    sample.m_ImageValue = static_cast< ImageSampleValueType >(
+      this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+  }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * ******************* AfterThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::AfterThreadedGenerateData( void )
+{
+  /** Combine the results of all threads. */
+  Superclass::AfterThreadedGenerateData();
+
+  /** Check the total number of tries of the counter-based generator. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    SizeValueType numberOfTries = 0;
+    for( std::size_t i = 0; i < this->m_ThreaderNumberOfTries.size(); ++i )
+    {
+      numberOfTries += this->m_ThreaderNumberOfTries[ i ];
+    }
+    if( numberOfTries > this->m_MaximumNumberOfTries )
+    {
+      itkExceptionMacro( << "Could not find enough image samples within "
+                         << "reasonable time. Probably the mask is too small" );
+    }
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* GenerateCounterBasedSample *******************
+ */
+
+template< class TInputImage >
+bool
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::GenerateCounterBasedSample( SizeValueType sampleIndex,
+  SizeValueType & numberOfTries, ImageSampleType & sample ) const
+{
+  InputImageContinuousIndexType sampleContIndex;
+  double                        randomNumbers[ InputImageDimension ];
+  const bool                    useMasks = this->GetMask().IsNotNull();
+
+  /** Walk over the image until we find a valid point. The attempt number
+   * is part of the counter, so every sample has its own sequence of candidates. */
+  for( CounterType attempt = 0;; ++attempt )
+  {
+    if( ++numberOfTries > this->m_MaximumNumberOfTries )
+    {
+      return false;
+    }
+
+    this->m_CounterBasedRandomGenerator.GetUniformVariates(
+      sampleIndex, attempt, randomNumbers, InputImageDimension );
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      sampleContIndex[ i ] = this->m_SmallestContIndex[ i ] + randomNumbers[ i ]
+        * ( this->m_LargestContIndex[ i ] - this->m_SmallestContIndex[ i ] );
+    }
+    this->GetInput()->TransformContinuousIndexToPhysicalPoint(
+      sampleContIndex, sample.m_ImageCoordinates );
+
+    if( !useMasks || this->IsInsideAllMasks( sample.m_ImageCoordinates ) )
+    {
+      break;
+    }
+  }
+
+  /** Compute the value at the continuous index. */
+  sample.m_ImageValue = static_cast< ImageSampleValueType >(
+    this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+
+  return true;
+
+} // end GenerateCounterBasedSample()
+
+
 /**
  * ******************* GenerateSampleRegion *******************
  */
@@ -274,6 +518,23 @@ MultiInputImageRandomCoordinateSampler< TInputImage >::GenerateRandomCoordinate(
   const InputImageContinuousIndexType & largestContIndex,
   InputImageContinuousIndexType &       randomContIndex )
 {
+  /** With the counter-based generator this function is only used for the
+   * sample region. It gets an index that is never used by a sample. */
+  if( this->m_UseCounterBasedRandomGenerator )
+  {
+    double randomNumbers[ InputImageDimension ];
+    this->m_CounterBasedRandomGenerator.GetUniformVariates(
+      NumericTraits< CounterBasedRandomGeneratorType::IndexType >::max(), 0,
+      randomNumbers, InputImageDimension );
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      randomContIndex[ i ] = static_cast< InputImagePointValueType >(
+        smallestContIndex[ i ] + randomNumbers[ i ]
+        * ( largestContIndex[ i ] - smallestContIndex[ i ] ) );
+    }
+    return;
+  }
+
   for( unsigned int i = 0; i < InputImageDimension; ++i )
   {
     randomContIndex[ i ] = static_cast< InputImagePointValueType >(
@@ -296,6 +557,8 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "UseCounterBasedRandomGenerator: " << this->m_UseCounterBasedRandomGenerator << std::endl;
+  os << indent << "Seed: " << this->m_Seed << std::endl;
 
 }   // end PrintSelf
 
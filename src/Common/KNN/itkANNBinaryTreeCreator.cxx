@@ -24,7 +24,9 @@
 namespace itk
 {
 
-unsigned int ANNBinaryTreeCreator::m_NumberOfANNBinaryTrees = 0;
+unsigned int        ANNBinaryTreeCreator::m_NumberOfANNBinaryTrees = 0;
+bool                ANNBinaryTreeCreator::m_TrivialLeafIsAllocated = false;
+SimpleFastMutexLock ANNBinaryTreeCreator::m_Mutex;
 
 /**
  * ************************ CreateANNkDTree *************************
@@ -35,8 +37,10 @@ ANNBinaryTreeCreator::CreateANNkDTree(
   ANNPointArrayType pa, int n, int d, int bs,
   ANNSplitRuleType split )
 {
-  IncreaseReferenceCount();
-  return new ANNkd_tree( pa, n, d, bs, split );
+  const bool serialized = BeginTreeCreation( true );
+  ANNkDTreeType * tree = new ANNkd_tree( pa, n, d, bs, split );
+  EndTreeCreation( serialized );
+  return tree;
 }   // end CreateANNkDTree
 
 
@@ -49,8 +53,10 @@ ANNBinaryTreeCreator::CreateANNbdTree(
   ANNPointArrayType pa, int n, int d, int bs,
   ANNSplitRuleType split, ANNShrinkRuleType shrink )
 {
-  IncreaseReferenceCount();
-  return new ANNbd_tree( pa, n, d, bs, split, shrink );
+  const bool serialized = BeginTreeCreation( true );
+  ANNbdTreeType * tree = new ANNbd_tree( pa, n, d, bs, split, shrink );
+  EndTreeCreation( serialized );
+  return tree;
 }   // end CreateANNbdTree
 
 
@@ -62,8 +68,10 @@ ANNBinaryTreeCreator::ANNBruteForceTreeType *
 ANNBinaryTreeCreator::CreateANNBruteForceTree(
   ANNPointArrayType pa, int n, int d )
 {
-  IncreaseReferenceCount();
-  return new ANNbruteForce( pa, n, d );
+  const bool serialized = BeginTreeCreation( false );
+  ANNBruteForceTreeType * tree = new ANNbruteForce( pa, n, d );
+  EndTreeCreation( serialized );
+  return tree;
 }   // end CreateANNBruteForceTree
 
 
@@ -106,7 +114,9 @@ ANNBinaryTreeCreator::DeleteANNBruteForceTree( ANNBruteForceTreeType * & tree )
 void
 ANNBinaryTreeCreator::IncreaseReferenceCount( void )
 {
+  m_Mutex.Lock();
   m_NumberOfANNBinaryTrees++;
+  m_Mutex.Unlock();
 }   // end IncreaseReferenceCount
 
 
@@ -117,14 +127,56 @@ ANNBinaryTreeCreator::IncreaseReferenceCount( void )
 void
 ANNBinaryTreeCreator::DecreaseReferenceCount( void )
 {
+  m_Mutex.Lock();
   m_NumberOfANNBinaryTrees--;
   if( m_NumberOfANNBinaryTrees == 0 )
   {
     annClose();
+    m_TrivialLeafIsAllocated = false;
   }
+  m_Mutex.Unlock();
 }   // end DecreaseReferenceCount
 
 
+/**
+ * ************************ BeginTreeCreation *************************
+ */
+
+bool
+ANNBinaryTreeCreator::BeginTreeCreation( const bool usesTrivialLeaf )
+{
+  /** The first kd- or bd-tree lazily allocates the trivial leaf node
+   * that ANN shares between all trees. That creation keeps the lock, so
+   * that the allocation does not race with other trees being created;
+   * all other trees can be created concurrently.
+   */
+  m_Mutex.Lock();
+  m_NumberOfANNBinaryTrees++;
+  if( usesTrivialLeaf && !m_TrivialLeafIsAllocated )
+  {
+    m_TrivialLeafIsAllocated = true;
+    return true;
+  }
+  m_Mutex.Unlock();
+  return false;
+
+}   // end BeginTreeCreation
+
+
+/**
+ * ************************ EndTreeCreation *************************
+ */
+
+void
+ANNBinaryTreeCreator::EndTreeCreation( const bool serialized )
+{
+  if( serialized )
+  {
+    m_Mutex.Unlock();
+  }
+}   // end EndTreeCreation
+
+
 } // end namespace itk
 
 #endif // end #ifndef __itkANNBinaryTreeCreator_cxx
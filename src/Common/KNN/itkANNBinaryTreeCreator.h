@@ -21,6 +21,7 @@
 
 #include "itkObject.h"
 #include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
 #include "ANN/ANN.h"
 
 namespace itk
@@ -65,6 +66,7 @@ public:
    * of any sort exist, we can call annClose(). This little
    * function is cause of going through the trouble of creating
    * this class with static creating functions.
+   * The functions may be called from several threads simultaneously.
    */
 
   /** Static function to create an ANN kDTree. */
@@ -100,8 +102,18 @@ private:
   ANNBinaryTreeCreator( const Self & );   // purposely not implemented
   void operator=( const Self & );         // purposely not implemented
 
+  /** Increase the reference count before creating a tree. Returns true
+   * if the creation must be serialized, in which case the lock is held
+   * until EndTreeCreation() is called.
+   */
+  static bool BeginTreeCreation( const bool usesTrivialLeaf );
+
+  static void EndTreeCreation( const bool serialized );
+
   /** Member variables. */
-  static unsigned int m_NumberOfANNBinaryTrees;
+  static unsigned int        m_NumberOfANNBinaryTrees;
+  static bool                m_TrivialLeafIsAllocated;
+  static SimpleFastMutexLock m_Mutex;
 
 };
 
@@ -141,6 +141,10 @@ private:
   InstanceIdentifier        m_InternalContainerSize;
   InstanceIdentifier        m_ActualSize;
 
+  /** The (unaligned) memory block holding the data, and its dimension. */
+  char *       m_AllocatedMemory;
+  unsigned int m_AllocatedDimension;
+
   /** Dummy needed for GetMeasurementVector(). */
   mutable MeasurementVectorType m_TemporaryMeasurementVector;
 
@@ -37,6 +37,8 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
   this->m_InternalContainer     = 0;
   this->m_InternalContainerSize = 0;
   this->m_ActualSize            = 0;
+  this->m_AllocatedMemory       = 0;
+  this->m_AllocatedDimension    = 0;
 }   // end Constructor
 
 
@@ -147,6 +149,19 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
    * this function. So the m_ActualSize is zero.
    */
   this->m_ActualSize = 0;
+
+  /** The metrics resize their list samples in every iteration, mostly to
+   * the same size, in which case the memory is reused.
+   */
+  const unsigned int dim = this->GetMeasurementVectorSize();
+  if( this->m_InternalContainer
+    && size == this->m_InternalContainerSize
+    && dim == this->m_AllocatedDimension )
+  {
+    this->Modified();
+    return;
+  }
+
   if( this->m_InternalContainer )
   {
     this->DeallocateInternalContainer();
@@ -155,7 +170,6 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
   }
   if( size > 0 )
   {
-    unsigned int dim = this->GetMeasurementVectorSize();
     this->AllocateInternalContainer( size, dim );
     this->m_InternalContainerSize = size;
     this->Modified();
@@ -216,12 +230,23 @@ void
 ListSampleCArray< TMeasurementVector, TInternalValue >
 ::AllocateInternalContainer( unsigned long size, unsigned int dim )
 {
+  /** All measurement vectors are stored in a single block, aligned to a
+   * cache line. The ANN trees address the data through the array of row
+   * pointers, so the components of a measurement vector are contiguous.
+   */
+  const std::size_t alignment = ITK_CACHE_LINE_ALIGNMENT;
+  this->m_AllocatedMemory = new char[ size * dim * sizeof( InternalValueType ) + alignment ];
+  const std::size_t misalignment
+    = reinterpret_cast< std::size_t >( this->m_AllocatedMemory ) % alignment;
+  const std::size_t offset = misalignment == 0 ? 0 : alignment - misalignment;
+  InternalDataType  p      = reinterpret_cast< InternalDataType >( this->m_AllocatedMemory + offset );
+
   this->m_InternalContainer = new InternalDataType[ size ];
-  InternalDataType p = new InternalValueType[ size * dim ];
   for( unsigned long i = 0; i < size; i++ )
   {
     this->m_InternalContainer[ i ] = &( p[ i * dim ] );
   }
+  this->m_AllocatedDimension = dim;
 }   // end AllocateInternalContainer()
 
 
@@ -236,9 +261,11 @@ ListSampleCArray< TMeasurementVector, TInternalValue >
 {
   if( this->m_InternalContainer )
   {
-    delete[] this->m_InternalContainer[ 0 ];
+    delete[] this->m_AllocatedMemory;
     delete[] this->m_InternalContainer;
-    this->m_InternalContainer = NULL;
+    this->m_InternalContainer  = NULL;
+    this->m_AllocatedMemory    = NULL;
+    this->m_AllocatedDimension = 0;
   }
 }   // end DeallocateInternalContainer()
 
@@ -0,0 +1,190 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkUniformGridHashTree_h
+#define __itkUniformGridHashTree_h
+
+#include "itkBinaryTreeBase.h"
+#include "itkIntTypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class UniformGridHashTree
+ *
+ * \brief A uniform grid over the points, stored in a hash table, as an
+ * alternative to the ANN kd- and bd-trees for low dimensional feature
+ * spaces.
+ *
+ * The bounding box of the points is divided in cubic cells of CellSize.
+ * The cells are hashed into a table with as many buckets as there are
+ * points (rounded up to a power of two), and the points are sorted by
+ * bucket with a counting sort. The points, their indices and their cells
+ * are stored in that order, in contiguous arrays, so that the points of a
+ * cell are scanned without following pointers. GenerateTree() takes O(N)
+ * time, and only allocates when the number of points or the dimension
+ * grows.
+ *
+ * If the CellSize is 0 (the default), it is chosen so that a cell holds
+ * PointsPerCell points on average, if the points were spread uniformly
+ * over their bounding box. For a search with a fixed radius a CellSize
+ * near that radius is efficient.
+ *
+ * The tree is searched with the UniformGridHashTreeSearch. The number of
+ * cells that a search visits grows exponentially with the dimension, so the
+ * grid is only efficient for a few dimensions.
+ *
+ * \ingroup ANNwrap
+ */
+
+template< class TListSample >
+class UniformGridHashTree : public BinaryTreeBase< TListSample >
+{
+public:
+
+  /** Standard itk. */
+  typedef UniformGridHashTree             Self;
+  typedef BinaryTreeBase< TListSample >   Superclass;
+  typedef SmartPointer< Self >            Pointer;
+  typedef SmartPointer< const Self >      ConstPointer;
+
+  /** New method for creating an object using a factory. */
+  itkNewMacro( Self );
+
+  /** ITK type info. */
+  itkTypeMacro( UniformGridHashTree, BinaryTreeBase );
+
+  /** Typedef's from Superclass. */
+  typedef typename Superclass::SampleType                 SampleType;
+  typedef typename Superclass::MeasurementVectorType      MeasurementVectorType;
+  typedef typename Superclass::MeasurementVectorSizeType  MeasurementVectorSizeType;
+  typedef typename Superclass::TotalAbsoluteFrequencyType TotalAbsoluteFrequencyType;
+
+  /** Typedef's. */
+  typedef uint64_t CellIndexType;
+
+  /** Set and get the size of the cells; 0 chooses it from PointsPerCell. */
+  itkSetClampMacro( CellSize, double, 0.0, NumericTraits< double >::max() );
+  itkGetConstMacro( CellSize, double );
+
+  /** Set and get the average number of points per cell, when the cell size
+   * is chosen automatically. Default: 10.
+   */
+  itkSetClampMacro( PointsPerCell, unsigned int, 1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( PointsPerCell, unsigned int );
+
+  /** Generate the tree. */
+  virtual void GenerateTree( void );
+
+  /** Get the size of the cells of the generated tree. */
+  double GetActualCellSize( void ) const { return this->m_ActualCellSize; }
+
+  /** Get the number of cells of the grid in dimension d. */
+  SizeValueType GetNumberOfCells( unsigned int d ) const { return this->m_GridSize[ d ]; }
+
+  /** Get the cell of a coordinate in dimension d. Coordinates outside the
+   * grid are clamped to the cells -1 and GetNumberOfCells( d ), which keeps
+   * the distance to the other cells a lower bound.
+   */
+  OffsetValueType ComputeCellCoordinate( double x, unsigned int d ) const
+  {
+    const double c = std::floor( ( x - this->m_Origin[ d ] ) / this->m_ActualCellSize );
+    const double n = static_cast< double >( this->m_GridSize[ d ] );
+    return static_cast< OffsetValueType >( c < -1.0 ? -1.0 : ( c > n ? n : c ) );
+  }
+
+
+  /** Get the stride of dimension d in the linear index of a cell. */
+  CellIndexType GetCellStride( unsigned int d ) const { return this->m_CellStrides[ d ]; }
+
+  /** Get the range [begin, end) of the sorted points that may lie in a cell.
+   * The range can also hold points of other cells, with the same hash.
+   */
+  void GetCellRange( CellIndexType cell, SizeValueType & begin, SizeValueType & end ) const
+  {
+    const SizeValueType bucket = this->ComputeBucket( cell );
+    begin = this->m_BucketStarts[ bucket ];
+    end   = this->m_BucketStarts[ bucket + 1 ];
+  }
+
+
+  /** Get the cell, the index in the sample, and the coordinates of the j-th
+   * sorted point.
+   */
+  CellIndexType GetSortedCell( SizeValueType j ) const { return this->m_SortedCells[ j ]; }
+  int GetSortedIndex( SizeValueType j ) const { return this->m_SortedIndices[ j ]; }
+  const double * GetSortedPoint( SizeValueType j ) const
+  {
+    return &this->m_SortedPoints[ j * this->m_Dimension ];
+  }
+
+
+protected:
+
+  UniformGridHashTree();
+  virtual ~UniformGridHashTree() {}
+
+  /** PrintSelf. */
+  virtual void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  UniformGridHashTree( const Self & ); // purposely not implemented
+  void operator=( const Self & );      // purposely not implemented
+
+  /** Hash a cell to a bucket, with Fibonacci hashing. */
+  SizeValueType ComputeBucket( CellIndexType cell ) const
+  {
+    if( this->m_HashBits == 0 ) { return 0; }
+    return static_cast< SizeValueType >(
+      ( cell * static_cast< CellIndexType >( 0x9E3779B97F4A7C15ULL ) ) >> ( 64 - this->m_HashBits ) );
+  }
+
+
+  /** Settings. */
+  double       m_CellSize;
+  unsigned int m_PointsPerCell;
+
+  /** The grid. */
+  unsigned int                 m_Dimension;
+  double                       m_ActualCellSize;
+  std::vector< double >        m_Origin;
+  std::vector< SizeValueType > m_GridSize;
+  std::vector< CellIndexType > m_CellStrides;
+  unsigned int                 m_HashBits;
+
+  /** The points sorted by bucket. */
+  std::vector< SizeValueType > m_BucketStarts;
+  std::vector< CellIndexType > m_UnsortedCells;
+  std::vector< CellIndexType > m_SortedCells;
+  std::vector< int >           m_SortedIndices;
+  std::vector< double >        m_SortedPoints;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkUniformGridHashTree.hxx"
+#endif
+
+#endif // end #ifndef __itkUniformGridHashTree_h
@@ -0,0 +1,192 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkUniformGridHashTree_hxx
+#define __itkUniformGridHashTree_hxx
+
+#include "itkUniformGridHashTree.h"
+
+namespace itk
+{
+
+/**
+ * ************************ Constructor *************************
+ */
+
+template< class TListSample >
+UniformGridHashTree< TListSample >
+::UniformGridHashTree()
+{
+  this->m_CellSize       = 0.0;
+  this->m_PointsPerCell  = 10;
+  this->m_Dimension      = 0;
+  this->m_ActualCellSize = 1.0;
+  this->m_HashBits       = 0;
+} // end Constructor
+
+
+/**
+ * ************************ GenerateTree *************************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTree< TListSample >
+::GenerateTree( void )
+{
+  const unsigned int  dim = static_cast< unsigned int >( this->GetDataDimension() );
+  const SizeValueType nop = static_cast< SizeValueType >( this->GetActualNumberOfDataPoints() );
+  const typename SampleType::InternalDataContainerType data
+    = this->GetSample()->GetInternalContainer();
+
+  /** Compute the bounding box of the points. */
+  this->m_Dimension = dim;
+  this->m_Origin.assign( dim, 0.0 );
+  std::vector< double > upper( dim, 0.0 );
+  for( SizeValueType i = 0; i < nop; ++i )
+  {
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      const double x = data[ i ][ d ];
+      if( i == 0 || x < this->m_Origin[ d ] ) { this->m_Origin[ d ] = x; }
+      if( i == 0 || x > upper[ d ] ) { upper[ d ] = x; }
+    }
+  }
+
+  /** Choose the cell size, so that a cell holds PointsPerCell points on
+   * average. Dimensions without extent do not count.
+   */
+  double cellSize = this->m_CellSize;
+  if( cellSize <= 0.0 )
+  {
+    double       volume   = 1.0;
+    unsigned int occupied = 0;
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      const double extent = upper[ d ] - this->m_Origin[ d ];
+      if( extent > 0.0 )
+      {
+        volume *= extent;
+        ++occupied;
+      }
+    }
+    if( occupied > 0 )
+    {
+      cellSize = std::pow( volume * this->m_PointsPerCell
+        / static_cast< double >( std::max< SizeValueType >( nop, 1 ) ), 1.0 / occupied );
+    }
+    if( !( cellSize > 0.0 ) ) { cellSize = 1.0; }
+  }
+
+  /** Compute the size of the grid. Enlarge the cells until the linear index
+   * of a cell fits in a CellIndexType.
+   */
+  const double maximumNumberOfCells = 4.0e18;
+  this->m_GridSize.resize( dim );
+  for( ;; )
+  {
+    double numberOfCells = 1.0;
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      numberOfCells *= std::floor( ( upper[ d ] - this->m_Origin[ d ] ) / cellSize ) + 1.0;
+    }
+    if( numberOfCells <= maximumNumberOfCells ) { break; }
+    cellSize *= 1.01 * std::pow( numberOfCells / maximumNumberOfCells, 1.0 / dim );
+  }
+  this->m_ActualCellSize = cellSize;
+
+  this->m_CellStrides.resize( dim );
+  CellIndexType stride = 1;
+  for( unsigned int d = 0; d < dim; ++d )
+  {
+    this->m_GridSize[ d ] = static_cast< SizeValueType >(
+      std::floor( ( upper[ d ] - this->m_Origin[ d ] ) / cellSize ) ) + 1;
+    this->m_CellStrides[ d ] = stride;
+    stride *= static_cast< CellIndexType >( this->m_GridSize[ d ] );
+  }
+
+  /** The hash table has at least as many buckets as points. */
+  this->m_HashBits = 0;
+  while( ( static_cast< SizeValueType >( 1 ) << this->m_HashBits ) < nop )
+  {
+    ++this->m_HashBits;
+  }
+  const SizeValueType numberOfBuckets = static_cast< SizeValueType >( 1 ) << this->m_HashBits;
+
+  /** Compute the cell of every point, and count the points per bucket. */
+  this->m_UnsortedCells.resize( nop );
+  this->m_BucketStarts.assign( numberOfBuckets + 1, 0 );
+  for( SizeValueType i = 0; i < nop; ++i )
+  {
+    CellIndexType cell = 0;
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      const SizeValueType c = static_cast< SizeValueType >(
+        ( data[ i ][ d ] - this->m_Origin[ d ] ) / cellSize );
+      cell += std::min( c, this->m_GridSize[ d ] - 1 ) * this->m_CellStrides[ d ];
+    }
+    this->m_UnsortedCells[ i ] = cell;
+    ++this->m_BucketStarts[ this->ComputeBucket( cell ) ];
+  }
+
+  /** Sort the points by bucket, with a counting sort. After the prefix sum
+   * a bucket start holds the end of the bucket, and it is moved back to its
+   * begin while the points are placed, from the last to the first.
+   */
+  for( SizeValueType b = 1; b < numberOfBuckets; ++b )
+  {
+    this->m_BucketStarts[ b ] += this->m_BucketStarts[ b - 1 ];
+  }
+  this->m_BucketStarts[ numberOfBuckets ] = nop;
+
+  this->m_SortedCells.resize( nop );
+  this->m_SortedIndices.resize( nop );
+  this->m_SortedPoints.resize( nop * dim );
+  for( SizeValueType i = nop; i-- > 0; )
+  {
+    const CellIndexType cell = this->m_UnsortedCells[ i ];
+    const SizeValueType j    = --this->m_BucketStarts[ this->ComputeBucket( cell ) ];
+    this->m_SortedCells[ j ]   = cell;
+    this->m_SortedIndices[ j ] = static_cast< int >( i );
+    std::copy( data[ i ], data[ i ] + dim, &this->m_SortedPoints[ j * dim ] );
+  }
+
+} // end GenerateTree()
+
+
+/*
+ * ****************** PrintSelf ******************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTree< TListSample >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "CellSize: " << this->m_CellSize << std::endl;
+  os << indent << "PointsPerCell: " << this->m_PointsPerCell << std::endl;
+  os << indent << "ActualCellSize: " << this->m_ActualCellSize << std::endl;
+  os << indent << "HashBits: " << this->m_HashBits << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkUniformGridHashTree_hxx
@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkUniformGridHashTreeSearch_h
+#define __itkUniformGridHashTreeSearch_h
+
+#include "itkBinaryTreeSearchBase.h"
+#include "itkUniformGridHashTree.h"
+
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class UniformGridHashTreeSearch
+ *
+ * \brief Searches the k nearest neighbours in a UniformGridHashTree.
+ *
+ * The cells around the cell of the query point are visited in shells of
+ * increasing distance, until the k-th neighbour found so far is closer than
+ * any cell of the next shell, or, if a SquaredRadius is given, the shells
+ * are outside the radius. Only the surface of a shell is visited.
+ *
+ * The search is exact, and returns the squared distances, sorted, as the
+ * ANN searchers do. Neighbours that are not found, because fewer than k
+ * points lie within the radius, get the index -1 and the largest double as
+ * distance. Search() does not change the searcher, so it can be called from
+ * several threads at once.
+ *
+ * \ingroup ANNwrap
+ */
+
+template< class TListSample >
+class UniformGridHashTreeSearch : public BinaryTreeSearchBase< TListSample >
+{
+public:
+
+  /** Standard itk. */
+  typedef UniformGridHashTreeSearch           Self;
+  typedef BinaryTreeSearchBase< TListSample > Superclass;
+  typedef SmartPointer< Self >                Pointer;
+  typedef SmartPointer< const Self >          ConstPointer;
+
+  /** New method for creating an object using a factory. */
+  itkNewMacro( Self );
+
+  /** ITK type info. */
+  itkTypeMacro( UniformGridHashTreeSearch, BinaryTreeSearchBase );
+
+  /** Typedef's from Superclass. */
+  typedef typename Superclass::ListSampleType        ListSampleType;
+  typedef typename Superclass::BinaryTreeType        BinaryTreeType;
+  typedef typename Superclass::MeasurementVectorType MeasurementVectorType;
+  typedef typename Superclass::IndexArrayType        IndexArrayType;
+  typedef typename Superclass::DistanceArrayType     DistanceArrayType;
+
+  /** The grid. */
+  typedef UniformGridHashTree< ListSampleType >           UniformGridHashTreeType;
+  typedef typename UniformGridHashTreeType::CellIndexType CellIndexType;
+
+  /** Set and get the squared radius search bound; 0 means no bound. */
+  itkSetMacro( SquaredRadius, double );
+  itkGetConstMacro( SquaredRadius, double );
+
+  /** Set the tree, which should be a UniformGridHashTree. */
+  virtual void SetBinaryTree( BinaryTreeType * tree );
+
+  /** Search the nearest neighbours of a query point qp. */
+  virtual void Search( const MeasurementVectorType & qp, IndexArrayType & ind,
+    DistanceArrayType & dists );
+
+  /** Search the nearest neighbours of a query point qp, within sqRad. */
+  virtual void Search( const MeasurementVectorType & qp, IndexArrayType & ind,
+    DistanceArrayType & dists, double sqRad );
+
+protected:
+
+  UniformGridHashTreeSearch();
+  virtual ~UniformGridHashTreeSearch() {}
+
+  /** A neighbour: the squared distance and the index. */
+  typedef std::pair< double, int > NeighbourType;
+
+  /** Add the points of a cell that are within the squared distance bound
+   * to the max-heap of the k nearest neighbours.
+   */
+  void SearchCell( CellIndexType cell, const MeasurementVectorType & qp,
+    double radiusBound, std::vector< NeighbourType > & heap ) const;
+
+  /** Member variables. */
+  typename UniformGridHashTreeType::Pointer m_BinaryTreeAsGridType;
+  double                                    m_SquaredRadius;
+
+private:
+
+  UniformGridHashTreeSearch( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkUniformGridHashTreeSearch.hxx"
+#endif
+
+#endif // end #ifndef __itkUniformGridHashTreeSearch_h
@@ -0,0 +1,252 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkUniformGridHashTreeSearch_hxx
+#define __itkUniformGridHashTreeSearch_hxx
+
+#include "itkUniformGridHashTreeSearch.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ************************ Constructor *************************
+ */
+
+template< class TListSample >
+UniformGridHashTreeSearch< TListSample >
+::UniformGridHashTreeSearch()
+{
+  this->m_BinaryTreeAsGridType = 0;
+  this->m_SquaredRadius        = 0.0;
+} // end Constructor
+
+
+/**
+ * ************************ SetBinaryTree *************************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTreeSearch< TListSample >
+::SetBinaryTree( BinaryTreeType * tree )
+{
+  this->Superclass::SetBinaryTree( tree );
+  if( tree )
+  {
+    UniformGridHashTreeType * testPtr = dynamic_cast< UniformGridHashTreeType * >( tree );
+    if( !testPtr )
+    {
+      itkExceptionMacro( << "ERROR: The tree is not of type UniformGridHashTree." );
+    }
+    if( testPtr != this->m_BinaryTreeAsGridType )
+    {
+      this->m_BinaryTreeAsGridType = testPtr;
+      this->Modified();
+    }
+  }
+  else if( this->m_BinaryTreeAsGridType.IsNotNull() )
+  {
+    this->m_BinaryTreeAsGridType = 0;
+    this->Modified();
+  }
+
+} // end SetBinaryTree()
+
+
+/**
+ * ************************ Search *************************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTreeSearch< TListSample >
+::Search( const MeasurementVectorType & qp, IndexArrayType & ind,
+  DistanceArrayType & dists )
+{
+  this->Search( qp, ind, dists, this->m_SquaredRadius );
+
+} // end Search()
+
+
+/**
+ * ************************ Search *************************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTreeSearch< TListSample >
+::Search( const MeasurementVectorType & qp, IndexArrayType & ind,
+  DistanceArrayType & dists, double sqRad )
+{
+  const UniformGridHashTreeType * grid        = this->m_BinaryTreeAsGridType.GetPointer();
+  const unsigned int              k           = this->m_KNearestNeighbors;
+  const unsigned int              dim         = this->m_DataDimension;
+  const double                    cellSize    = grid->GetActualCellSize();
+  const double                    radiusBound = sqRad > 0.0 ? sqRad : NumericTraits< double >::max();
+
+  /** The neighbours found so far, as a max-heap on the distance. */
+  std::vector< NeighbourType > heap;
+  heap.reserve( k + 1 );
+
+  /** The cell of the query point, and the number of shells that cover the
+   * grid from there.
+   */
+  std::vector< OffsetValueType > queryCell( dim ), lower( dim ), upper( dim ), cell( dim );
+  OffsetValueType                maximumShell = 0;
+  for( unsigned int d = 0; d < dim; ++d )
+  {
+    const OffsetValueType n = static_cast< OffsetValueType >( grid->GetNumberOfCells( d ) );
+    queryCell[ d ] = grid->ComputeCellCoordinate( qp[ d ], d );
+    maximumShell   = std::max( maximumShell, std::max( queryCell[ d ], n - 1 - queryCell[ d ] ) );
+  }
+
+  for( OffsetValueType m = 0; k > 0 && dim > 0 && m <= maximumShell; ++m )
+  {
+    /** The points of shell m are at least m - 1 cells away. Stop when they
+     * are outside the radius, or farther than the k-th neighbour.
+     */
+    if( m > 0 )
+    {
+      const double gap = ( m - 1 ) * cellSize;
+      if( gap * gap > radiusBound
+        || ( heap.size() == k && gap * gap >= heap.front().first ) )
+      {
+        break;
+      }
+    }
+
+    /** The box of the shell, clipped to the grid. */
+    bool empty = false;
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      const OffsetValueType n = static_cast< OffsetValueType >( grid->GetNumberOfCells( d ) );
+      lower[ d ] = std::max< OffsetValueType >( queryCell[ d ] - m, 0 );
+      upper[ d ] = std::min< OffsetValueType >( queryCell[ d ] + m, n - 1 );
+      empty     |= lower[ d ] > upper[ d ];
+    }
+    if( empty ) { continue; }
+
+    /** Visit the surface of the shell. The dimensions 1 to dim - 1 are run
+     * through completely; dimension 0 only if one of the others lies on the
+     * surface, and otherwise only at its two ends.
+     */
+    cell = lower;
+    for( ;; )
+    {
+      bool          onSurface = false;
+      CellIndexType base      = 0;
+      for( unsigned int d = 1; d < dim; ++d )
+      {
+        onSurface |= cell[ d ] == queryCell[ d ] - m || cell[ d ] == queryCell[ d ] + m;
+        base      += static_cast< CellIndexType >( cell[ d ] ) * grid->GetCellStride( d );
+      }
+
+      if( onSurface )
+      {
+        for( OffsetValueType c = lower[ 0 ]; c <= upper[ 0 ]; ++c )
+        {
+          this->SearchCell( base + static_cast< CellIndexType >( c ), qp, radiusBound, heap );
+        }
+      }
+      else
+      {
+        const OffsetValueType c0 = queryCell[ 0 ] - m;
+        const OffsetValueType c1 = queryCell[ 0 ] + m;
+        if( c0 >= lower[ 0 ] && c0 <= upper[ 0 ] )
+        {
+          this->SearchCell( base + static_cast< CellIndexType >( c0 ), qp, radiusBound, heap );
+        }
+        if( m > 0 && c1 >= lower[ 0 ] && c1 <= upper[ 0 ] )
+        {
+          this->SearchCell( base + static_cast< CellIndexType >( c1 ), qp, radiusBound, heap );
+        }
+      }
+
+      /** Go to the next cell. */
+      unsigned int d = 1;
+      for( ; d < dim; ++d )
+      {
+        if( ++cell[ d ] <= upper[ d ] ) { break; }
+        cell[ d ] = lower[ d ];
+      }
+      if( d >= dim ) { break; }
+    }
+  }
+
+  /** Copy the neighbours, the nearest first. */
+  std::sort_heap( heap.begin(), heap.end() );
+  ind.SetSize( k );
+  dists.SetSize( k );
+  for( unsigned int i = 0; i < k; ++i )
+  {
+    ind[ i ]   = i < heap.size() ? heap[ i ].second : -1;
+    dists[ i ] = i < heap.size() ? heap[ i ].first : NumericTraits< double >::max();
+  }
+
+} // end Search()
+
+
+/**
+ * ************************ SearchCell *************************
+ */
+
+template< class TListSample >
+void
+UniformGridHashTreeSearch< TListSample >
+::SearchCell( CellIndexType cell, const MeasurementVectorType & qp,
+  double radiusBound, std::vector< NeighbourType > & heap ) const
+{
+  const UniformGridHashTreeType * grid = this->m_BinaryTreeAsGridType.GetPointer();
+  const unsigned int              k    = this->m_KNearestNeighbors;
+  const unsigned int              dim  = this->m_DataDimension;
+
+  SizeValueType begin, end;
+  grid->GetCellRange( cell, begin, end );
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    /** Skip the points of other cells with the same hash. */
+    if( grid->GetSortedCell( j ) != cell ) { continue; }
+
+    /** Compute the squared distance, and stop early when it is too large. */
+    const double   bound = heap.size() == k ? std::min( heap.front().first, radiusBound ) : radiusBound;
+    const double * point = grid->GetSortedPoint( j );
+    double         dist  = 0.0;
+    for( unsigned int d = 0; d < dim && dist <= bound; ++d )
+    {
+      const double diff = qp[ d ] - point[ d ];
+      dist += diff * diff;
+    }
+    if( dist > bound ) { continue; }
+
+    heap.push_back( NeighbourType( dist, grid->GetSortedIndex( j ) ) );
+    std::push_heap( heap.begin(), heap.end() );
+    if( heap.size() > k )
+    {
+      std::pop_heap( heap.begin(), heap.end() );
+      heap.pop_back();
+    }
+  }
+
+} // end SearchCell()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkUniformGridHashTreeSearch_hxx
@@ -24,6 +24,7 @@
 #include "itkMetaDataObject.h"
 #include "itkVersion.h"
 #include "itkNumericTraits.h"
+#include "itkMultiThreader.h"
 
 // developed using gdcm 2.0 and libtiff 3.8.2
 #include "gdcmAttribute.h"
@@ -49,6 +50,7 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_cross.h>
@@ -827,7 +829,9 @@ MevisDicomTiffImageIO::Read( void * buffer )
   // note *buffer goes in scanline order!
   // very inconvenient if the tiff image is tiled, which damned
   // is the case for mevislab images!
-  // note buffer is already allocated, according to size!
+  // note buffer is already allocated, according to the io region!
+  // only the tiles that intersect the io region are read, and they
+  // are decompressed in parallel
 
   short int p;
   if( !TIFFGetField( m_TIFFImage, TIFFTAG_PLANARCONFIG, &p ) )
@@ -843,357 +847,157 @@ MevisDicomTiffImageIO::Read( void * buffer )
     }
   }
 
-  if( m_IsTiled )
+  if( !m_IsTiled )
   {
-    // only works for tile depth == 1 (used by mevislab),
-    // therefore in z-direction we do not need to do checking
-    // if the volume is multiple of tile.
-    if( m_TIFFDimension == 3 && m_TileDepth != 1 )
-    {
-      itkExceptionMacro( << "mevisIO:read(): unsupported tiledepth (should be one)! " );
-      return;
-    }
-
-    // buffer pointer is scanline based (one dimensional array)
-    // tile is positioned on x,y,z; we read each tile, and fill
-    // the corresponding positions in the onedimensional array
-    unsigned char * vol = reinterpret_cast< unsigned char * >( buffer );
+    // if not tiled then img is stripped
+    itkExceptionMacro( << "mevisIO:read(): non-tiled dcm/tiff reading not (yet) implemented" );
+    return;
+  }
 
-    const unsigned int tilesize       = TIFFTileSize( m_TIFFImage );
-    const unsigned int tilerowbytes   = TIFFTileRowSize( m_TIFFImage );
-    const unsigned int bytespersample = m_BitsPerSample / 8;
+  // only works for tile depth == 1 (used by mevislab),
+  // therefore in z-direction we do not need to do checking
+  // if the volume is multiple of tile.
+  if( m_TIFFDimension == 3 && m_TileDepth != 1 )
+  {
+    itkExceptionMacro( << "mevisIO:read(): unsupported tiledepth (should be one)! " );
+    return;
+  }
 
-    unsigned char * tilebuf = static_cast< unsigned char * >( _TIFFmalloc( tilesize ) );
+  // the buffer holds the io region only, in scanline order; the
+  // dimensions that the region lacks are read at index zero
+  const ImageIORegion & region = this->GetIORegion();
+  unsigned int          start[ 4 ] = { 0, 0, 0, 0 };
+  unsigned int          size[ 4 ]  = { 1, 1, 1, 1 };
+  for( unsigned int d = 0; d < region.GetImageDimension() && d < 4; ++d )
+  {
+    start[ d ] = static_cast< unsigned int >( region.GetIndex( d ) );
+    size[ d ]  = static_cast< unsigned int >( region.GetSize( d ) );
+  }
 
-    //
-    // special cases, if the tilexy is larger than or equal to the image
-    // size itself, treat as three separate cases, both are larger/equal,
-    // or only direction
-    //
-    bool tileoversized( false );
+  // collect the tiles that intersect the region; in 4d, the slices of
+  // all time points are stacked in the 3d tiff image
+  ReadTilesParameterType pass;
+  pass.st_Self   = this;
+  pass.st_Buffer = reinterpret_cast< unsigned char * >( buffer );
+  for( unsigned int d = 0; d < 2; ++d )
+  {
+    pass.st_RegionStart[ d ] = start[ d ];
+    pass.st_RegionSize[ d ]  = size[ d ];
+  }
 
-    if( m_TileLength >= m_Length || m_TileWidth >= m_Width )
+  const unsigned int depth = this->GetNumberOfDimensions() > 2 ? m_Dimensions[ 2 ] : 1;
+  for( unsigned int t = start[ 3 ]; t < start[ 3 ] + size[ 3 ]; ++t )
+  {
+    for( unsigned int z = start[ 2 ]; z < start[ 2 ] + size[ 2 ]; ++z )
     {
-      tileoversized = true;
-
-      // case one both x,y is larger
-      if( m_TileLength >= m_Length && m_TileWidth >= m_Width )
+      TileType tile;
+      tile.z0    = m_TIFFDimension == 3 ? z + t * depth : 0;
+      tile.slice = ( t - start[ 3 ] ) * size[ 2 ] + ( z - start[ 2 ] );
+      for( tile.y0 = start[ 1 ] - start[ 1 ] % m_TileLength;
+        tile.y0 < start[ 1 ] + size[ 1 ]; tile.y0 += m_TileLength )
       {
-        for( unsigned int z0 = 0; z0 < ( m_TIFFDimension == 3 ? m_Depth : 1 ); z0++ )
+        for( tile.x0 = start[ 0 ] - start[ 0 ] % m_TileWidth;
+          tile.x0 < start[ 0 ] + size[ 0 ]; tile.x0 += m_TileWidth )
         {
-          if( TIFFReadTile( m_TIFFImage, tilebuf, 0, 0, z0, 0 ) < 0 )
-          {
-            _TIFFfree( tilebuf );
-            itkExceptionMacro( << "mevisIO:read(): error reading tile (topleft)" );
-            return;
-          }
-          else
-          {
-            // do row based copy of tile into volume
-            const unsigned     lenx       = m_Width;
-            const unsigned     leny       = m_Length;
-            const unsigned int tilexbytes = lenx * bytespersample;
-
-            unsigned char *    pv = vol;
-            const unsigned int p  = z0 * m_Length * m_Width;
-            pv += p * bytespersample;
-
-            unsigned char * pb = tilebuf;
-            for( unsigned int r = 0; r < leny; ++r )
-            {
-              memcpy( pv, pb, tilexbytes );
-              pv += tilexbytes;
-              pb += tilerowbytes;
-            }
-          }
+          pass.st_Tiles.push_back( tile );
         }
-      } // end case one
+      }
+    }
+  }
 
-      // case two, larger x, smaller y
-      if( m_TileWidth >= m_Width && m_TileLength < m_Length )
-      {
+  // decompress the tiles in parallel, each thread with its own tiff handle
+  const ThreadIdType numberOfThreads = static_cast< ThreadIdType >( std::max< std::size_t >( 1,
+      std::min< std::size_t >( MultiThreader::GetGlobalDefaultNumberOfThreads(), pass.st_Tiles.size() ) ) );
+  pass.st_Errors.resize( numberOfThreads );
 
-        const unsigned     lenx       = m_Width;
-        const unsigned int tilexbytes = lenx * bytespersample;
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numberOfThreads );
+  threader->SetSingleMethod( ReadTilesThreaderCallback, &pass );
+  threader->SingleMethodExecute();
 
-        const bool my = ( m_Length % m_TileLength == 0 ) ? true : false;
-        for( unsigned int z0 = 0; z0 < ( m_TIFFDimension == 3 ? m_Depth : 1 ); z0++ )
-        {
-          for( unsigned int y0 = 0; y0 < ( my ? m_Length : m_Length - m_TileLength ); y0 += m_TileLength )
-          {
-            if( TIFFReadTile( m_TIFFImage, tilebuf, 0, y0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (top image)" );
-              return;
-            }
-            else
-            {
-
-              unsigned char *    pb = tilebuf;
-              unsigned char *    pv = vol;
-              const unsigned int p  = z0 * m_Length * m_Width + y0 * m_Width;
-              pv += p * bytespersample;
-
-              for( unsigned int r = 0; r < m_TileLength; ++r )
-              {
-                memcpy( pv, pb, tilerowbytes );
-                pv += tilexbytes;
-                pb += tilerowbytes;
-              }
-            }
-          }
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    if( !pass.st_Errors[ i ].empty() )
+    {
+      itkExceptionMacro( << "mevisIO:read(): " << pass.st_Errors[ i ] );
+    }
+  }
+  return;
+}
 
-          if( !my )
-          {
-            const unsigned     leny = m_Length % m_TileLength;
-            const unsigned int y0   = m_Length - leny;
-
-            if( TIFFReadTile( m_TIFFImage, tilebuf, 0, y0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (strip bottom)" );
-              return;
-            }
-            else
-            {
-              unsigned char *    pb = tilebuf;
-              unsigned char *    pv = vol;
-              const unsigned int p  = z0 * m_Length * m_Width + y0 * m_Width;
-              pv += p * bytespersample;
-
-              for( unsigned int r = 0; r < leny; ++r )
-              {
-                memcpy( pv, pb, tilexbytes );
-                pv += tilexbytes;
-                pb += tilerowbytes;
-              }
-            }
-          }
-        }
 
-      } // end case two
+// streamable read region
+ImageIORegion
+MevisDicomTiffImageIO::GenerateStreamableReadRegionFromRequestedRegion(
+  const ImageIORegion & requested ) const
+{
+  // any region can be read, the tiles that intersect it are decompressed
+  return requested;
+}
 
-      // case three, smaller x, larger y
-      if( m_TileWidth < m_Width && m_TileLength >= m_Length )
-      {
 
-        const unsigned leny = m_Length;
-        const bool     mx   = ( m_Width % m_TileWidth == 0 ) ? true : false;
+// read tiles
+ITK_THREAD_RETURN_TYPE
+MevisDicomTiffImageIO::ReadTilesThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  const ThreadIdType       threadId        = infoStruct->ThreadID;
+  const ThreadIdType       numberOfThreads = infoStruct->NumberOfThreads;
+  ReadTilesParameterType * pass
+    = static_cast< ReadTilesParameterType * >( infoStruct->UserData );
+  const Self * self = pass->st_Self;
 
-        for( unsigned int z0 = 0; z0 < ( m_TIFFDimension == 3 ? m_Depth : 1 ); z0++ )
-        {
-          for( unsigned int x0 = 0; x0 < ( mx ? m_Width : m_Width - m_TileWidth ); x0 += m_TileWidth )
-          {
-            // read tile
-            if( TIFFReadTile( m_TIFFImage, tilebuf, x0, 0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (top image)" );
-              return;
-            }
-            else
-            {
-              unsigned char *    pb = tilebuf;
-              unsigned char *    pv = vol;
-              const unsigned int p  = z0 * m_Length * m_Width + x0;
-              pv += p * bytespersample;
-
-              for( unsigned int r = 0; r < leny; ++r )
-              {
-                memcpy( pv, pb, tilerowbytes );
-                pv += m_Width * bytespersample;
-                pb += tilerowbytes;
-              }
-            }
-          }
-          // fill strip right
-          if( !mx )
-          {
-            const unsigned     lenx       = m_Width % m_TileWidth;
-            const unsigned int x0         = m_Width - lenx;
-            const unsigned int tilexbytes = lenx * bytespersample;
-
-            if( TIFFReadTile( m_TIFFImage, tilebuf, x0, 0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (strip right)" );
-              return;
-            }
-            else
-            {
-              unsigned char *    pb = tilebuf;
-              unsigned char *    pv = vol;
-              const unsigned int p  = z0 * m_Length * m_Width + x0;
-              pv += p * bytespersample;
-
-              for( unsigned int r = 0; r < leny; ++r )
-              {
-                memcpy( pv, pb, tilexbytes );
-                pv += m_Width * bytespersample;
-                pb += tilerowbytes;
-              }
-            }
-          }
-        }
+  // libtiff handles may not be shared between threads, so the other
+  // threads open the tiff file themselves
+  TIFF * tiff = threadId == 0
+    ? self->m_TIFFImage : TIFFOpen( self->m_TiffFileName.c_str(), "rc" );
+  if( tiff == NULL )
+  {
+    pass->st_Errors[ threadId ] = "error opening tif file " + self->m_TiffFileName;
+    return ITK_THREAD_RETURN_VALUE;
+  }
 
-      } // end case three
+  const unsigned int tilerowbytes   = TIFFTileRowSize( tiff );
+  const unsigned int bytespersample = self->m_BitsPerSample / 8;
+  unsigned char *    tilebuf        = static_cast< unsigned char * >( _TIFFmalloc( TIFFTileSize( tiff ) ) );
 
-    } // end oversized tile
+  const unsigned int x0 = pass->st_RegionStart[ 0 ];
+  const unsigned int x1 = x0 + pass->st_RegionSize[ 0 ];
+  const unsigned int y0 = pass->st_RegionStart[ 1 ];
+  const unsigned int y1 = y0 + pass->st_RegionSize[ 1 ];
 
-    //
-    // normal case, tile is smaller than image
-    //
-    if( !tileoversized )
+  for( std::size_t i = threadId; i < pass->st_Tiles.size(); i += numberOfThreads )
+  {
+    const TileType & tile = pass->st_Tiles[ i ];
+    if( TIFFReadTile( tiff, tilebuf, tile.x0, tile.y0, tile.z0, 0 ) < 0 )
     {
-      // is volume direction a multiple of tiledirection?
-      const bool mx = ( m_Width % m_TileWidth == 0 ) ? true : false;
-      const bool my = ( m_Length % m_TileLength == 0 ) ? true : false;
-
-      // fill everything inside ie from topleft
-      for( unsigned int z0 = 0; z0 < ( m_TIFFDimension == 3 ? m_Depth : 1 ); z0++ )
-      {
-        for( unsigned int y0 = 0; y0 < ( my ? m_Length : m_Length - m_TileLength ); y0 += m_TileLength )
-        {
-          for( unsigned int x0 = 0; x0 < ( mx ? m_Width : m_Width - m_TileWidth ); x0 += m_TileWidth )
-          {
-            // x0,y0,z0 is position of tile in volume, top left corner
-            // pointer to volume (at 0,0,0)
-            unsigned char * pv = vol;
-
-            // set pointer of volume to y0,x0,z0 position
-            const unsigned int p = z0 * m_Length * m_Width + y0 * m_Width + x0;
-            pv += p * bytespersample;
-
-            // read tile
-            if( TIFFReadTile( m_TIFFImage, tilebuf, x0, y0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (topleft image)" );
-              return;
-            }
-            else
-            {
-              // do row based copy of tile into volume
-              unsigned char * pb = tilebuf;
-              for( unsigned int r = 0; r < m_TileLength; ++r )
-              {
-                memcpy( pv, pb, tilerowbytes );
-                // move pointers
-                // x remain same, y is one complete vol line
-                // (ie width of image)
-                pv += m_Width * bytespersample;
-                pb += tilerowbytes;
-              }
-            }
-
-          }
-        }
-        // fill boundaries
-        if( !mx )
-        {
-          // x is fixed
-          const unsigned     lenx       = m_Width % m_TileWidth;
-          const unsigned int x0         = m_Width - lenx;
-          const unsigned int tilexbytes = lenx * bytespersample;
-
-          for( unsigned int y0 = 0; y0 < ( my ? m_Length : m_Length - m_TileLength ); y0 += m_TileLength )
-          {
-            unsigned char *    pv = vol;
-            const unsigned int p  = z0 * m_Length * m_Width + y0 * m_Width + x0;
-            pv += p * bytespersample;
-
-            if( TIFFReadTile( m_TIFFImage, tilebuf, x0, y0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (ydirection)" );
-              return;
-            }
-            else
-            {
-              unsigned char * pb = tilebuf;
-              for( unsigned int r = 0; r < m_TileLength; ++r )
-              {
-                memcpy( pv, pb, tilexbytes );
-                pv += m_Width * bytespersample;
-                pb += tilerowbytes;
-              }
-            }
-          }
-        }
-        if( !my )
-        {
-          // y is fixed
-          const unsigned     leny = m_Length % m_TileLength;
-          const unsigned int y0   = m_Length - leny;
-
-          for( unsigned int x0 = 0; x0 < ( mx ? m_Width : m_Width - m_TileWidth ); x0 += m_TileWidth )
-          {
-            unsigned char *    pv = vol;
-            const unsigned int p  = z0 * m_Length * m_Width + y0 * m_Width + x0;
-            pv += p * bytespersample;
-
-            if( TIFFReadTile( m_TIFFImage, tilebuf, x0, y0, z0, 0 ) < 0 )
-            {
-              _TIFFfree( tilebuf );
-              itkExceptionMacro( << "mevisIO:read(): error reading tile (x-direction)" );
-              return;
-            }
-            else
-            {
-              unsigned char * pb = tilebuf;
-              for( unsigned int r = 0; r < leny; ++r )
-              {
-                memcpy( pv, pb, tilerowbytes );
-                pv += m_Width * bytespersample;
-                pb += tilerowbytes;
-              }
-            }
-          }
-        }
-        // fill corner bottom
-        if( !mx && !my )
-        {
-          // x0,y0 is fixed
-          const unsigned     lenx       = m_Width % m_TileWidth;
-          const unsigned int x0         = m_Width - lenx;
-          const unsigned int tilexbytes = lenx * bytespersample;
-          const unsigned     leny       = m_Length % m_TileLength;
-          const unsigned int y0         = m_Length - leny;
-
-          unsigned char *    pv = vol;
-          const unsigned int p  = z0 * m_Length * m_Width + y0 * m_Width + x0;
-          pv += p * bytespersample;
-
-          if( TIFFReadTile( m_TIFFImage, tilebuf, x0, y0, z0, 0 ) < 0 )
-          {
-            _TIFFfree( tilebuf );
-            itkExceptionMacro( << "mevisIO:read(): error reading tile (corner bottom)" );
-            return;
-          }
-          else
-          {
-            unsigned char * pb = tilebuf;
-            for( unsigned int r = 0; r < leny; ++r )
-            {
-              memcpy( pv, pb, tilexbytes );
-              pv += m_Width * bytespersample;
-              pb += tilerowbytes;
-            }
-          }
-        }
-      }
+      pass->st_Errors[ threadId ] = "error reading tile";
+      break;
     }
 
-    _TIFFfree( tilebuf );
+    // copy the part of the tile that lies inside the region, row by row
+    const unsigned int cx0        = std::max( tile.x0, x0 );
+    const unsigned int cx1        = std::min( tile.x0 + self->m_TileWidth, x1 );
+    const unsigned int cy0        = std::max( tile.y0, y0 );
+    const unsigned int cy1        = std::min( tile.y0 + self->m_TileLength, y1 );
+    const unsigned int tilexbytes = ( cx1 - cx0 ) * bytespersample;
+    for( unsigned int y = cy0; y < cy1; ++y )
+    {
+      const unsigned char * pb = tilebuf
+        + ( y - tile.y0 ) * tilerowbytes + ( cx0 - tile.x0 ) * bytespersample;
+      const std::size_t p = ( static_cast< std::size_t >( tile.slice )
+        * pass->st_RegionSize[ 1 ] + ( y - y0 ) ) * pass->st_RegionSize[ 0 ] + ( cx0 - x0 );
+      memcpy( pass->st_Buffer + p * bytespersample, pb, tilexbytes );
+    }
   }
-  else
+
+  _TIFFfree( tilebuf );
+  if( threadId != 0 )
   {
-    // if not tiled then img is stripped
-    itkExceptionMacro( << "mevisIO:read(): non-tiled dcm/tiff reading not (yet) implemented" );
-    return;
+    TIFFClose( tiff );
   }
-  return;
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 
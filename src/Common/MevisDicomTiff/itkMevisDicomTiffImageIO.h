@@ -23,12 +23,14 @@
 #endif
 
 #include "itkImageIOBase.h"
+#include "itkMultiThreader.h"
 #include "itk_tiff.h"
 #include "gdcmTag.h"
 #include "gdcmAttribute.h"
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -63,6 +65,8 @@ namespace itk
  *  PROPERTIES:
  *  - 2D/3D/4D, scalar types supported
  *  - input/output tiff image expected to be tiled
+ *  - streamed reading: only the tiles that intersect the requested
+ *    region are read, and they are decompressed in parallel
  *  - types supported uchar, char, ushort, short, uint, int, and float
  *    (double is not accepted by MevisLab)
  *  - writing defaults is tiled tiff, tilesize is 128, 128,
@@ -134,10 +138,14 @@ public:
 
   virtual bool CanStreamRead()
   {
-    return false;
+    return true;
   }
 
 
+  virtual ImageIORegion GenerateStreamableReadRegionFromRequestedRegion(
+    const ImageIORegion & requested ) const;
+
+
   virtual bool CanStreamWrite()
   {
     return false;
@@ -158,6 +166,30 @@ private:
   bool FindElement( const gdcm::DataSet ds, const gdcm::Tag tag, gdcm::DataElement & de,
     const bool breadthfirstsearch );
 
+  // a tile that intersects the io region, and the slice of the
+  // io region it belongs to
+  struct TileType
+  {
+    unsigned int x0;
+    unsigned int y0;
+    unsigned int z0;
+    unsigned int slice;
+  };
+
+  // the data of the threads that read the tiles, each thread
+  // stores its error message (if any) in st_Errors
+  struct ReadTilesParameterType
+  {
+    const Self *               st_Self;
+    unsigned char *            st_Buffer;
+    unsigned int               st_RegionStart[ 2 ];
+    unsigned int               st_RegionSize[ 2 ];
+    std::vector< TileType >    st_Tiles;
+    std::vector< std::string > st_Errors;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ReadTilesThreaderCallback( void * arg );
+
   // the following may include the pathname
   std::string m_DcmFileName;
   std::string m_TiffFileName;
@@ -0,0 +1,127 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUGaussianSmoothAndShrinkImageFilterFactory_h
+#define __itkGPUGaussianSmoothAndShrinkImageFilterFactory_h
+
+#include "itkGPUObjectFactoryBase.h"
+#include "itkGPUGaussianSmoothAndShrinkImageFilter.h"
+
+namespace itk
+{
+/** \class GPUGaussianSmoothAndShrinkImageFilterFactory2
+ * \brief Object Factory implementation for GPUGaussianSmoothAndShrinkImageFilter
+ */
+template< typename TTypeListIn, typename TTypeListOut, typename NDimensions >
+class GPUGaussianSmoothAndShrinkImageFilterFactory2 :
+  public GPUObjectFactoryBase< NDimensions >
+{
+public:
+
+  typedef GPUGaussianSmoothAndShrinkImageFilterFactory2 Self;
+  typedef GPUObjectFactoryBase< NDimensions >           Superclass;
+  typedef SmartPointer< Self >                          Pointer;
+  typedef SmartPointer< const Self >                    ConstPointer;
+
+  /** Return a descriptive string describing the factory. */
+  const char * GetDescription() const { return "A Factory for GPUGaussianSmoothAndShrinkImageFilter"; }
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( GPUGaussianSmoothAndShrinkImageFilterFactory2, GPUObjectFactoryBase );
+
+  /** Register one factory of this type. */
+  static void RegisterOneFactory();
+
+  /** Operator() to register override. */
+  template< typename TTypeIn, typename TTypeOut, unsigned int VImageDimension >
+  void operator()( void )
+  {
+    // Image typedefs
+    typedef Image< TTypeIn, VImageDimension >     InputImageType;
+    typedef Image< TTypeOut, VImageDimension >    OutputImageType;
+    typedef GPUImage< TTypeIn, VImageDimension >  GPUInputImageType;
+    typedef GPUImage< TTypeOut, VImageDimension > GPUOutputImageType;
+
+    // Override default
+    this->RegisterOverride(
+      typeid( GaussianSmoothAndShrinkImageFilter< InputImageType, OutputImageType > ).name(),
+      typeid( GPUGaussianSmoothAndShrinkImageFilter< InputImageType, OutputImageType > ).name(),
+      "GPU GaussianSmoothAndShrinkImageFilter override default",
+      true,
+      CreateObjectFunction< GPUGaussianSmoothAndShrinkImageFilter< InputImageType, OutputImageType > >::New()
+      );
+
+    // Override when itkGPUImage is first template argument
+    this->RegisterOverride(
+      typeid( GaussianSmoothAndShrinkImageFilter< GPUInputImageType, OutputImageType > ).name(),
+      typeid( GPUGaussianSmoothAndShrinkImageFilter< GPUInputImageType, OutputImageType > ).name(),
+      "GPU GaussianSmoothAndShrinkImageFilter override GPUImage first",
+      true,
+      CreateObjectFunction< GPUGaussianSmoothAndShrinkImageFilter< GPUInputImageType, OutputImageType > >::New()
+      );
+
+    // Override when itkGPUImage is second template argument
+    this->RegisterOverride(
+      typeid( GaussianSmoothAndShrinkImageFilter< InputImageType, GPUOutputImageType > ).name(),
+      typeid( GPUGaussianSmoothAndShrinkImageFilter< InputImageType, GPUOutputImageType > ).name(),
+      "GPU GaussianSmoothAndShrinkImageFilter override GPUImage second",
+      true,
+      CreateObjectFunction< GPUGaussianSmoothAndShrinkImageFilter< InputImageType, GPUOutputImageType > >::New()
+      );
+
+    // Override when itkGPUImage is first and second template arguments
+    this->RegisterOverride(
+      typeid( GaussianSmoothAndShrinkImageFilter< GPUInputImageType, GPUOutputImageType > ).name(),
+      typeid( GPUGaussianSmoothAndShrinkImageFilter< GPUInputImageType, GPUOutputImageType > ).name(),
+      "GPU GaussianSmoothAndShrinkImageFilter override GPUImage first and second",
+      true,
+      CreateObjectFunction< GPUGaussianSmoothAndShrinkImageFilter< GPUInputImageType, GPUOutputImageType > >::New()
+      );
+  }
+
+
+protected:
+
+  GPUGaussianSmoothAndShrinkImageFilterFactory2();
+  virtual ~GPUGaussianSmoothAndShrinkImageFilterFactory2() {}
+
+  /** Register methods for 1D. */
+  virtual void Register1D();
+
+  /** Register methods for 2D. */
+  virtual void Register2D();
+
+  /** Register methods for 3D. */
+  virtual void Register3D();
+
+private:
+
+  GPUGaussianSmoothAndShrinkImageFilterFactory2( const Self & ); // purposely not implemented
+  void operator=( const Self & );                                // purposely not implemented
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkGPUGaussianSmoothAndShrinkImageFilterFactory.hxx"
+#endif
+
+#endif // end #ifndef __itkGPUGaussianSmoothAndShrinkImageFilterFactory_h
@@ -248,10 +248,22 @@ private:
   GPUAdvancedCombinationTransformCopier( const Self & ); // purposely not implemented
   void operator=( const Self & );                        // purposely not implemented
 
-  CPUComboTransformConstPointer m_InputTransform;
-  GPUComboTransformPointer      m_Output;
-  ModifiedTimeType              m_InternalTransformTime;
-  bool                          m_ExplicitMode;
+  /** The GPU copy of a sub-transform, with the modified time of the
+   * CPU sub-transform at the time it was copied. */
+  struct CachedTransformType
+  {
+    CachedTransformType() : m_Time( 0 ), m_ExplicitMode( true ) {}
+    CPUCurrentTransformConstPointer m_Input;
+    ModifiedTimeType                m_Time;
+    bool                            m_ExplicitMode;
+    GPUAdvancedTransformPointer     m_Output;
+  };
+
+  CPUComboTransformConstPointer      m_InputTransform;
+  GPUComboTransformPointer           m_Output;
+  ModifiedTimeType                   m_InternalTransformTime;
+  bool                               m_ExplicitMode;
+  std::vector< CachedTransformType > m_CachedTransforms;
 };
 
 } // end namespace itk
@@ -41,6 +41,8 @@
 // GPU factory include
 #include "itkGPUImageFactory.h"
 
+#include <algorithm> // For max.
+
 namespace itk
 {
 //------------------------------------------------------------------------------
@@ -67,9 +69,11 @@ GPUAdvancedCombinationTransformCopier< TTypeList, NDimensions, TAdvancedCombinat
     return;
   }
 
-  // Update only if the input AdvancedCombinationTransform has been modified
-  const ModifiedTimeType t = this->m_InputTransform->GetMTime();
-  if( t <= this->m_InternalTransformTime ) return; // No need to update
+  // Update only if the input AdvancedCombinationTransform or the copier
+  // has been modified. The modified time of the combination transform
+  // includes the modified times of its sub-transforms.
+  const ModifiedTimeType t = std::max< ModifiedTimeType >( this->m_InputTransform->GetMTime(), this->GetMTime() );
+  if( t <= this->m_InternalTransformTime && this->m_Output.IsNotNull() ) return; // No need to update
 
   // Cache the timestamp
   this->m_InternalTransformTime = t;
@@ -84,6 +88,7 @@ GPUAdvancedCombinationTransformCopier< TTypeList, NDimensions, TAdvancedCombinat
 
   // Loop over all sub-transforms
   const SizeValueType numberOfTransforms = this->m_InputTransform->GetNumberOfTransforms();
+  this->m_CachedTransforms.resize( numberOfTransforms );
   for( SizeValueType i = 0; i < numberOfTransforms; ++i )
   {
     // Get the current CPU transform of type itk::Transform
@@ -92,12 +97,31 @@ GPUAdvancedCombinationTransformCopier< TTypeList, NDimensions, TAdvancedCombinat
     // Cast to advanced transform type, no checking needed
     currentTransformCPU = dynamic_cast< const CPUCurrentTransformType * >( itkCurrentTransform.GetPointer() );
 
-    // Copy the current CPU transform to the current GPU transform
-    const bool copySucceeded = this->CopyToCurrentTransform( currentTransformCPU, currentTransformGPU );
-    if( !copySucceeded )
+    // Reuse the GPU copy of an unmodified sub-transform, which keeps for
+    // example the B-spline coefficient images resident on the device.
+    CachedTransformType & cached = this->m_CachedTransforms[ i ];
+    if( currentTransformCPU.IsNotNull()
+      && cached.m_Input == currentTransformCPU
+      && cached.m_ExplicitMode == this->m_ExplicitMode
+      && currentTransformCPU->GetMTime() <= cached.m_Time
+      && cached.m_Output.IsNotNull() )
+    {
+      currentTransformGPU->SetCurrentTransform( cached.m_Output );
+    }
+    else
     {
-      itkExceptionMacro( << "ERROR: GPUAdvancedCombinationTransformCopier was unable to copy transform from: "
-                         << this->m_InputTransform );
+      // Copy the current CPU transform to the current GPU transform
+      const bool copySucceeded = this->CopyToCurrentTransform( currentTransformCPU, currentTransformGPU );
+      if( !copySucceeded )
+      {
+        itkExceptionMacro( << "ERROR: GPUAdvancedCombinationTransformCopier was unable to copy transform from: "
+                           << this->m_InputTransform );
+      }
+
+      cached.m_Input        = currentTransformCPU;
+      cached.m_Time         = currentTransformCPU.IsNotNull() ? currentTransformCPU->GetMTime() : 0;
+      cached.m_ExplicitMode = this->m_ExplicitMode;
+      cached.m_Output       = currentTransformGPU->GetCurrentTransform();
     }
 
     // skip next step when last transform
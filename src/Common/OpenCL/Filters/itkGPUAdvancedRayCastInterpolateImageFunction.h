@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUAdvancedRayCastInterpolateImageFunction_h
+#define __itkGPUAdvancedRayCastInterpolateImageFunction_h
+
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkVersion.h"
+
+#include "itkGPUInterpolateImageFunction.h"
+#include "itkGPUImage.h"
+
+namespace itk
+{
+/** Create a helper GPU Kernel class for GPUAdvancedRayCastInterpolateImageFunction */
+itkGPUKernelClassMacro( GPUAdvancedRayCastInterpolateImageFunctionKernel );
+
+/** \class GPUAdvancedRayCastInterpolateImageFunction
+ * \brief GPU version of AdvancedRayCastInterpolateImageFunction.
+ *
+ * Used by the GPUResampleImageFilter to generate a digitally reconstructed
+ * radiograph: each work item of the resample kernel casts one ray through
+ * the input volume, which stays resident on the device between updates.
+ *
+ * The focal point is transformed on the host, with the Transform if one is
+ * set, every time the parameters are passed to the device, so that the
+ * current transform parameters are used. The integration is done in single
+ * precision. UseEmptySpaceSkipping only affects the CPU evaluation.
+ *
+ * \warning This interpolator works for 3-dimensional images only.
+ *
+ * \ingroup GPUCommon
+ */
+template< typename TInputImage, typename TCoordRep = float >
+class ITK_EXPORT GPUAdvancedRayCastInterpolateImageFunction :
+  public         GPUInterpolateImageFunction< TInputImage, TCoordRep,
+  AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep > >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef GPUAdvancedRayCastInterpolateImageFunction                           Self;
+  typedef AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >    CPUSuperclass;
+  typedef GPUInterpolateImageFunction< TInputImage, TCoordRep, CPUSuperclass > GPUSuperclass;
+  typedef SmartPointer< Self >                                                 Pointer;
+  typedef SmartPointer< const Self >                                           ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( GPUAdvancedRayCastInterpolateImageFunction, GPUSuperclass );
+
+  /** Superclass typedef support. */
+  typedef typename CPUSuperclass::InputPointType InputPointType;
+
+protected:
+
+  GPUAdvancedRayCastInterpolateImageFunction();
+  ~GPUAdvancedRayCastInterpolateImageFunction() {}
+  virtual void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+  /** Returns OpenCL \a source code for the transform.
+   * Returns true if source code was combined, false otherwise. */
+  virtual bool GetSourceCode( std::string & source ) const ITK_OVERRIDE;
+
+  /** Returns data manager that stores the focal point and threshold. */
+  virtual GPUDataManager::Pointer GetParametersDataManager( void ) const ITK_OVERRIDE;
+
+private:
+
+  GPUAdvancedRayCastInterpolateImageFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );                             // purposely not implemented
+
+  std::vector< std::string > m_Sources;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkGPUAdvancedRayCastInterpolateImageFunction.hxx"
+#endif
+
+#endif /* __itkGPUAdvancedRayCastInterpolateImageFunction_h */
@@ -0,0 +1,120 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUAdvancedRayCastInterpolateImageFunction_hxx
+#define __itkGPUAdvancedRayCastInterpolateImageFunction_hxx
+
+#include "itkGPUAdvancedRayCastInterpolateImageFunction.h"
+
+// begin of unnamed namespace
+namespace
+{
+typedef struct
+{
+  cl_float3 focal_point;
+  cl_float  threshold;
+} GPURayCastImageFunction3D;
+} // end of unnamed namespace
+
+namespace itk
+{
+template< typename TInputImage, typename TCoordRep >
+GPUAdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::GPUAdvancedRayCastInterpolateImageFunction()
+{
+  // The ray cast kernel takes the focal point and threshold
+  // instead of the start and end indices.
+  this->m_ParametersDataManager->Initialize();
+  this->m_ParametersDataManager->SetBufferFlag( CL_MEM_READ_ONLY );
+  this->m_ParametersDataManager->SetBufferSize( sizeof( GPURayCastImageFunction3D ) );
+  this->m_ParametersDataManager->Allocate();
+
+  // Add GPUAdvancedRayCastInterpolateImageFunction implementation
+  const std::string sourcePath0( GPUAdvancedRayCastInterpolateImageFunctionKernel::GetOpenCLSource() );
+  this->m_Sources.push_back( sourcePath0 );
+}
+
+
+//------------------------------------------------------------------------------
+template< typename TInputImage, typename TCoordRep >
+bool
+GPUAdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::GetSourceCode( std::string & source ) const
+{
+  if( this->m_Sources.size() == 0 )
+  {
+    return false;
+  }
+
+  // Create the source code
+  std::ostringstream sources;
+  for( std::size_t i = 0; i < this->m_Sources.size(); i++ )
+  {
+    sources << this->m_Sources[ i ] << std::endl;
+  }
+
+  source = sources.str();
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+template< typename TInputImage, typename TCoordRep >
+GPUDataManager::Pointer
+GPUAdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::GetParametersDataManager( void ) const
+{
+  // Transform the focal point with the current transform parameters
+  InputPointType focalPoint = this->m_FocalPoint;
+  if( this->m_Transform.IsNotNull() )
+  {
+    focalPoint = this->m_Transform->TransformPoint( focalPoint );
+  }
+
+  GPURayCastImageFunction3D imageFunction;
+  for( unsigned int i = 0; i < 4; i++ )
+  {
+    imageFunction.focal_point.s[ i ] = 0.0;
+  }
+  for( unsigned int i = 0; i < InputPointType::PointDimension && i < 3; i++ )
+  {
+    imageFunction.focal_point.s[ i ] = static_cast< cl_float >( focalPoint[ i ] );
+  }
+  imageFunction.threshold          = static_cast< cl_float >( this->m_Threshold );
+
+  this->m_ParametersDataManager->SetCPUBufferPointer( &imageFunction );
+  this->m_ParametersDataManager->SetGPUDirtyFlag( true );
+  this->m_ParametersDataManager->UpdateGPUBuffer();
+
+  return this->m_ParametersDataManager;
+}
+
+
+//------------------------------------------------------------------------------
+template< typename TInputImage, typename TCoordRep >
+void
+GPUAdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  CPUSuperclass::PrintSelf( os, indent );
+  GPUSuperclass::PrintSelf( os, indent );
+}
+
+
+} // end namespace itk
+
+#endif /* __itkGPUAdvancedRayCastInterpolateImageFunction_hxx */
@@ -90,7 +90,10 @@ private:
   void operator=( const Self & );                     // purposely not implemented
 
   std::size_t m_FilterGPUKernelHandle;
+  std::size_t m_TiledGPUKernelHandle;
   std::size_t m_DeviceLocalMemorySize;
+  std::size_t m_DeviceLocalMemoryBytes;
+  std::size_t m_DeviceMaximumWorkGroupSize;
 };
 
 } // end namespace itk
@@ -23,6 +23,8 @@
 #include "itkOpenCLUtil.h"
 #include "itkOpenCLDevice.h"
 
+#include <algorithm>
+
 namespace itk
 {
 /**
@@ -57,6 +59,11 @@ GPUBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 
   this->m_DeviceLocalMemorySize = ( localMemSize / sizeof( float ) ) - 3 * sizeof( float );
 
+  // The tiled kernel gets its local buffers at launch, sized by these.
+  this->m_DeviceLocalMemoryBytes = localMemSize;
+  this->m_DeviceMaximumWorkGroupSize
+    = this->m_GPUKernelManager->GetContext()->GetDefaultDevice().GetMaximumWorkItemsPerGroup();
+
   defines << "#define BUFFSIZE " << this->m_DeviceLocalMemorySize << "\n";
   defines << "#define BUFFPIXELTYPE float" << "\n";
   defines << "#define INPIXELTYPE ";
@@ -72,6 +79,8 @@ GPUBSplineDecompositionImageFilter< TInputImage, TOutputImage >
   {
     this->m_FilterGPUKernelHandle
       = this->m_GPUKernelManager->CreateKernel( program, "BSplineDecompositionImageFilter" );
+    this->m_TiledGPUKernelHandle
+      = this->m_GPUKernelManager->CreateKernel( program, "BSplineDecompositionImageFilterTiled" );
   }
   else
   {
@@ -209,10 +218,79 @@ GPUBSplineDecompositionImageFilter< TInputImage, TOutputImage >
   this->m_GPUKernelManager->SetKernelArg(
     this->m_FilterGPUKernelHandle, argidx++, sizeof( cl_int ), &this->m_NumberOfPoles );
 
+  // The tiled kernel applies the overall gain of all poles when it loads
+  // the lines, as the CPU filter does in DataToCoefficients1D().
+  float gain = 1.0f;
+  for( int k = 0; k < this->m_NumberOfPoles; k++ )
+  {
+    gain *= static_cast< float >( ( 1.0 - this->m_SplinePoles[ k ] )
+      * ( 1.0 - 1.0 / this->m_SplinePoles[ k ] ) );
+  }
+
+  // Arguments of the tiled kernel that are the same for all directions.
+  // The image size is always a uint4, with 1 for the missing dimensions.
+  cl_uint     imageSize4D[ 4 ] = { 1, 1, 1, 0 };
+  std::size_t numberOfPixels   = 1;
+  for( std::size_t i = 0; i < InputImageDimension; i++ )
+  {
+    imageSize4D[ i ] = static_cast< cl_uint >( outSize[ i ] );
+    numberOfPixels  *= outSize[ i ];
+  }
+  this->m_GPUKernelManager->SetKernelArgWithImage(
+    this->m_TiledGPUKernelHandle, 0, otPtr->GetGPUDataManager() );
+  this->m_GPUKernelManager->SetKernelArg(
+    this->m_TiledGPUKernelHandle, 1, sizeof( cl_uint4 ), &imageSize4D );
+  this->m_GPUKernelManager->SetKernelArg(
+    this->m_TiledGPUKernelHandle, 3, sizeof( cl_float2 ), &spline_poles );
+  this->m_GPUKernelManager->SetKernelArg(
+    this->m_TiledGPUKernelHandle, 4, sizeof( cl_int ), &this->m_NumberOfPoles );
+  this->m_GPUKernelManager->SetKernelArg(
+    this->m_TiledGPUKernelHandle, 5, sizeof( cl_float ), &gain );
+
   // Loop over directions
   OpenCLEventList eventList;
   for( std::size_t n = 0; n < InputImageDimension; n++ )
   {
+    // Lines of length 1 are left unchanged.
+    const std::size_t lineLength = outSize[ n ];
+    if( lineLength == 1 )
+    {
+      continue;
+    }
+
+    // Process a tile of neighbouring lines per work-group, with several
+    // work-items per line, as many lines as fit in the local memory.
+    const std::size_t threadsPerLine = 8;
+    std::size_t       linesPerGroup  = 32;
+    linesPerGroup = std::min( linesPerGroup, this->m_DeviceMaximumWorkGroupSize / threadsPerLine );
+    linesPerGroup = std::min( linesPerGroup, this->m_DeviceLocalMemoryBytes
+      / ( sizeof( float ) * ( lineLength + threadsPerLine ) ) );
+    if( linesPerGroup > 0 )
+    {
+      const cl_uint     direction     = static_cast< cl_uint >( n );
+      const cl_uint     linesArg      = static_cast< cl_uint >( linesPerGroup );
+      const std::size_t numberOfLines = numberOfPixels / lineLength;
+      const std::size_t numberOfGroups
+        = ( numberOfLines + linesPerGroup - 1 ) / linesPerGroup;
+
+      this->m_GPUKernelManager->SetKernelArg(
+        this->m_TiledGPUKernelHandle, 2, sizeof( cl_uint ), &direction );
+      this->m_GPUKernelManager->SetKernelArg(
+        this->m_TiledGPUKernelHandle, 6, sizeof( cl_uint ), &linesArg );
+      this->m_GPUKernelManager->SetKernelArg( this->m_TiledGPUKernelHandle, 7,
+        sizeof( float ) * linesPerGroup * lineLength, NULL );
+      this->m_GPUKernelManager->SetKernelArg( this->m_TiledGPUKernelHandle, 8,
+        sizeof( float ) * linesPerGroup * threadsPerLine, NULL );
+
+      OpenCLEvent event = this->m_GPUKernelManager->LaunchKernel(
+        this->m_TiledGPUKernelHandle,
+        OpenCLSize( numberOfGroups * linesPerGroup * threadsPerLine ),
+        OpenCLSize( linesPerGroup * threadsPerLine ) );
+      eventList.Append( event );
+      continue;
+    }
+
+    // Otherwise fall back to one work-item per line.
     this->m_GPUKernelManager->SetKernelArg(
       this->m_FilterGPUKernelHandle, argidx, sizeof( cl_uint ), &n );
 
@@ -144,7 +144,10 @@ private:
   GPUCompositeTransformPointer      m_Output;
   ModifiedTimeType                  m_InternalTransformTime;
   bool                              m_ExplicitMode;
-  GPUTransformCopierPointer         m_TransformCopier;
+
+  /** One copier per sub-transform, so that the GPU copies of the
+   * sub-transforms that did not change are reused. */
+  std::vector< GPUTransformCopierPointer > m_TransformCopiers;
 };
 
 } // end namespace itk
@@ -20,6 +20,8 @@
 
 #include "itkGPUCompositeTransformCopier.h"
 
+#include <algorithm> // For max.
+
 namespace itk
 {
 //------------------------------------------------------------------------------
@@ -31,7 +33,6 @@ GPUCompositeTransformCopier< TTypeList, NDimensions, TCompositeTransform, TOutpu
   this->m_Output                = NULL;
   this->m_InternalTransformTime = 0;
   this->m_ExplicitMode          = true;
-  this->m_TransformCopier       = GPUTransformCopierType::New();
 }
 
 
@@ -47,36 +48,49 @@ GPUCompositeTransformCopier< TTypeList, NDimensions, TCompositeTransform, TOutpu
     return;
   }
 
-  // Update only if the input AdvancedCombinationTransform has been modified
-  const ModifiedTimeType t = this->m_InputTransform->GetMTime();
-
-  if( t == this->m_InternalTransformTime )
+  // Update only if the input CompositeTransform or the copier has been modified
+  const ModifiedTimeType t = std::max< ModifiedTimeType >( this->m_InputTransform->GetMTime(), this->GetMTime() );
+  if( t <= this->m_InternalTransformTime && this->m_Output.IsNotNull() )
   {
     return; // No need to update
   }
-  else if( t > this->m_InternalTransformTime )
-  {
-    // Cache the timestamp
-    this->m_InternalTransformTime = t;
 
-    // Create the output
-    this->m_Output = GPUCompositeTransformType::New();
+  // Cache the timestamp
+  this->m_InternalTransformTime = t;
 
-    // Set the same explicit mode
-    this->m_TransformCopier->SetExplicitMode( this->m_ExplicitMode );
+  // Create the output
+  this->m_Output = GPUCompositeTransformType::New();
 
-    for( std::size_t i = 0; i < m_InputTransform->GetNumberOfTransforms(); ++i )
+  // Every sub-transform has its own copier, which only copies the
+  // sub-transform again when it has been modified.
+  const std::size_t numberOfTransforms = this->m_InputTransform->GetNumberOfTransforms();
+  if( this->m_TransformCopiers.size() < numberOfTransforms )
+  {
+    const std::size_t oldSize = this->m_TransformCopiers.size();
+    this->m_TransformCopiers.resize( numberOfTransforms );
+    for( std::size_t i = oldSize; i < numberOfTransforms; ++i )
     {
-      const CPUTransformPointer fromTransform = this->m_InputTransform->GetNthTransform( i );
+      this->m_TransformCopiers[ i ] = GPUTransformCopierType::New();
+    }
+  }
+  else
+  {
+    this->m_TransformCopiers.resize( numberOfTransforms );
+  }
 
-      // Perform copy
-      this->m_TransformCopier->SetInputTransform( fromTransform );
-      this->m_TransformCopier->Update();
-      GPUOutputTransformPointer toTransform = this->m_TransformCopier->GetModifiableOutput();
+  for( std::size_t i = 0; i < numberOfTransforms; ++i )
+  {
+    const CPUTransformPointer fromTransform = this->m_InputTransform->GetNthTransform( i );
 
-      // Add to output
-      this->m_Output->AddTransform( toTransform );
-    }
+    // Perform copy, with the same explicit mode
+    GPUTransformCopierPointer & copier = this->m_TransformCopiers[ i ];
+    copier->SetExplicitMode( this->m_ExplicitMode );
+    copier->SetInputTransform( fromTransform );
+    copier->Update();
+    GPUOutputTransformPointer toTransform = copier->GetModifiableOutput();
+
+    // Add to output
+    this->m_Output->AddTransform( toTransform );
   }
 }
 
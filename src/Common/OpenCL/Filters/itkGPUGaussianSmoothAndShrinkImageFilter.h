@@ -0,0 +1,108 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUGaussianSmoothAndShrinkImageFilter_h
+#define __itkGPUGaussianSmoothAndShrinkImageFilter_h
+
+#include "itkGaussianSmoothAndShrinkImageFilter.h"
+
+#include "itkGPUImageToImageFilter.h"
+#include "itkGPUImage.h"
+#include "itkGPUDataManager.h"
+
+namespace itk
+{
+/** Create a helper GPU Kernel class for GPUGaussianSmoothAndShrinkImageFilter */
+itkGPUKernelClassMacro( GPUGaussianSmoothAndShrinkImageFilterKernel );
+
+/** \class GPUGaussianSmoothAndShrinkImageFilter
+ * \brief GPU version of GaussianSmoothAndShrinkImageFilter.
+ *
+ * Replaces the chain of a GPUCastImageFilter, a GPURecursiveGaussianImageFilter
+ * per dimension and a GPUShrinkImageFilter by one pass per dimension, that
+ * only computes the values at the pixels that are kept by the shrinking.
+ * The first pass casts the input pixels to float when they are loaded into
+ * local memory, the last pass writes the output pixel type. Only the
+ * shrunken float intermediate results are stored in device memory.
+ *
+ * The results equal those of the CPU filter, up to the order of the
+ * floating point additions.
+ *
+ * \ingroup GPUCommon
+ */
+template< typename TInputImage, typename TOutputImage >
+class ITK_EXPORT GPUGaussianSmoothAndShrinkImageFilter :
+  public         GPUImageToImageFilter< TInputImage, TOutputImage,
+  GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage > >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef GPUGaussianSmoothAndShrinkImageFilter                             Self;
+  typedef GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >   CPUSuperclass;
+  typedef GPUImageToImageFilter< TInputImage, TOutputImage, CPUSuperclass > GPUSuperclass;
+  typedef SmartPointer< Self >                                              Pointer;
+  typedef SmartPointer< const Self >                                        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( GPUGaussianSmoothAndShrinkImageFilter, GPUSuperclass );
+
+  /** Some convenient typedefs. */
+  typedef typename CPUSuperclass::InputImageRegionType  InputImageRegionType;
+  typedef typename CPUSuperclass::OutputImageRegionType OutputImageRegionType;
+  typedef typename CPUSuperclass::ShrinkFactorsType     ShrinkFactorsType;
+  typedef typename CPUSuperclass::SigmaArrayType        SigmaArrayType;
+
+  /** ImageDimension constants */
+  itkStaticConstMacro( InputImageDimension, unsigned int,
+    TInputImage::ImageDimension );
+  itkStaticConstMacro( OutputImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+protected:
+
+  GPUGaussianSmoothAndShrinkImageFilter();
+  ~GPUGaussianSmoothAndShrinkImageFilter(){}
+  virtual void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+  virtual void GPUGenerateData();
+
+private:
+
+  GPUGaussianSmoothAndShrinkImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                        // purposely not implemented
+
+  /** Allocate a device buffer of a number of floats. */
+  static GPUDataManager::Pointer AllocateFloatBuffer( const std::size_t size );
+
+  std::size_t m_LinesKernelHandle;
+  std::size_t m_StripsKernelHandle;
+  std::size_t m_StripsToOutputKernelHandle;
+  std::size_t m_DeviceLocalMemorySize;
+  std::size_t m_DeviceMaximumWorkGroupSize;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkGPUGaussianSmoothAndShrinkImageFilter.hxx"
+#endif
+
+#endif /* __itkGPUGaussianSmoothAndShrinkImageFilter_h */
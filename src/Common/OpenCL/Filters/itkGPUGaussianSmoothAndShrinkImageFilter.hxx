@@ -0,0 +1,276 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUGaussianSmoothAndShrinkImageFilter_hxx
+#define __itkGPUGaussianSmoothAndShrinkImageFilter_hxx
+
+#include "itkGPUGaussianSmoothAndShrinkImageFilter.h"
+#include "itkOpenCLUtil.h"
+
+#include <algorithm>
+
+namespace itk
+{
+/**
+ * ****************** Constructor ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage >
+GPUGaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::GPUGaussianSmoothAndShrinkImageFilter()
+{
+  std::ostringstream defines;
+
+  if( TInputImage::ImageDimension > 3 || TInputImage::ImageDimension < 1 )
+  {
+    itkExceptionMacro( "GPUGaussianSmoothAndShrinkImageFilter supports 1/2/3D image." );
+  }
+  defines << "#define DIM_" << int(TInputImage::ImageDimension) << "\n";
+
+  // The first pass filters tiles of lines in local memory
+  const OpenCLDevice device = this->m_GPUKernelManager->GetContext()->GetDefaultDevice();
+  this->m_DeviceLocalMemorySize      = device.GetLocalMemorySize();
+  this->m_DeviceMaximumWorkGroupSize = device.GetMaximumWorkItemsPerGroup();
+
+  defines << "#define INPIXELTYPE ";
+  GetTypenameInString( typeid( typename TInputImage::PixelType ), defines );
+  defines << "#define OUTPIXELTYPE ";
+  GetTypenameInString( typeid( typename TOutputImage::PixelType ), defines );
+
+  // OpenCL kernel source
+  const char * GPUSource = GPUGaussianSmoothAndShrinkImageFilterKernel::GetOpenCLSource();
+  // Build and create kernels
+  OpenCLProgram program = this->m_GPUKernelManager->BuildProgramFromSourceCode( GPUSource, defines.str() );
+  if( !program.IsNull() )
+  {
+    this->m_LinesKernelHandle
+      = this->m_GPUKernelManager->CreateKernel( program, "GaussianSmoothAndShrinkLines" );
+    this->m_StripsKernelHandle
+      = this->m_GPUKernelManager->CreateKernel( program, "GaussianSmoothAndShrinkStrips" );
+    this->m_StripsToOutputKernelHandle
+      = this->m_GPUKernelManager->CreateKernel( program, "GaussianSmoothAndShrinkStripsToOutput" );
+  }
+  else
+  {
+    itkExceptionMacro( << "Kernel has not been loaded from:\n" << GPUSource );
+  }
+} // end Constructor()
+
+
+/**
+ * ****************** GPUGenerateData ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage >
+void
+GPUGaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::GPUGenerateData( void )
+{
+  itkDebugMacro( << "Calling GPUGaussianSmoothAndShrinkImageFilter::GPUGenerateData()" );
+
+  typedef typename GPUTraits< TInputImage >::Type  GPUInputImage;
+  typedef typename GPUTraits< TOutputImage >::Type GPUOutputImage;
+
+  typename GPUInputImage::Pointer inPtr
+    = dynamic_cast< GPUInputImage * >( this->ProcessObject::GetInput( 0 ) );
+  typename GPUOutputImage::Pointer otPtr
+    = dynamic_cast< GPUOutputImage * >( this->ProcessObject::GetOutput( 0 ) );
+
+  // Perform the safe check
+  if( inPtr.IsNull() )
+  {
+    itkExceptionMacro( << "The GPU InputImage is NULL. Filter unable to perform." );
+    return;
+  }
+  if( otPtr.IsNull() )
+  {
+    itkExceptionMacro( << "The GPU OutputImage is NULL. Filter unable to perform." );
+    return;
+  }
+
+  const InputImageRegionType &  inputRegion  = inPtr->GetBufferedRegion();
+  const OutputImageRegionType & outputRegion = otPtr->GetBufferedRegion();
+  if( outputRegion.GetNumberOfPixels() == 0 ) { return; }
+
+  // Compute the offset between the input index and the output index times
+  // the shrink factors, exactly like the CPU filter does
+  const ShrinkFactorsType                   factors     = this->GetShrinkFactors();
+  const typename TOutputImage::IndexType    outputIndex = otPtr->GetLargestPossibleRegion().GetIndex();
+  typename TOutputImage::PointType          point;
+  typename TInputImage::IndexType           inputIndex;
+  otPtr->TransformIndexToPhysicalPoint( outputIndex, point );
+  inPtr->TransformPhysicalPointToIndex( point, inputIndex );
+
+  OffsetValueType offsets[ InputImageDimension ];
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    offsets[ d ] = std::max( NumericTraits< OffsetValueType >::ZeroValue(),
+      static_cast< OffsetValueType >( inputIndex[ d ] - outputIndex[ d ] * factors[ d ] ) );
+  }
+
+  SizeValueType sizes[ InputImageDimension ];
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    sizes[ d ] = inputRegion.GetSize( d );
+  }
+
+  // Perform a pass per dimension. The first pass reads the input image and
+  // the last pass writes the output image, the others use float buffers.
+  GPUDataManager::Pointer source;
+  GPUDataManager::Pointer destination;
+  std::vector< float >    gaussian;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const bool      lastPass = ( d + 1 == InputImageDimension );
+    OffsetValueType radius   = 0;
+    CPUSuperclass::ComputeKernel( this->GetSigmaArray()[ d ] / inPtr->GetSpacing()[ d ], gaussian, radius );
+
+    GPUDataManager::Pointer gaussianBuffer = AllocateFloatBuffer( gaussian.size() );
+    gaussianBuffer->SetCPUBufferPointer( &gaussian[ 0 ] );
+    gaussianBuffer->SetGPUDirtyFlag( true );
+    gaussianBuffer->UpdateGPUBuffer();
+
+    SizeValueType innerSize = 1;
+    SizeValueType outerSize = 1;
+    for( unsigned int k = 0; k < d; ++k ) { innerSize *= sizes[ k ]; }
+    for( unsigned int k = d + 1; k < InputImageDimension; ++k ) { outerSize *= sizes[ k ]; }
+
+    const SizeValueType destinationSize = outputRegion.GetSize( d );
+    if( !lastPass )
+    {
+      destination = AllocateFloatBuffer( innerSize * destinationSize * outerSize );
+    }
+    GPUDataManager::Pointer output = lastPass ? otPtr->GetGPUDataManager() : destination;
+
+    // The kernel arguments that are shared by all passes
+    const cl_int  radiusArgument          = static_cast< cl_int >( radius );
+    const cl_uint innerSizeArgument       = static_cast< cl_uint >( innerSize );
+    const cl_uint sourceSizeArgument      = static_cast< cl_uint >( sizes[ d ] );
+    const cl_uint destinationSizeArgument = static_cast< cl_uint >( destinationSize );
+    const cl_int  firstCenterArgument     = static_cast< cl_int >(
+      outputRegion.GetIndex( d ) * static_cast< OffsetValueType >( factors[ d ] )
+      + offsets[ d ] - inputRegion.GetIndex( d ) );
+    const cl_uint factorArgument = static_cast< cl_uint >( factors[ d ] );
+
+    OpenCLEvent event;
+    if( d == 0 )
+    {
+      // The work group size along the lines is limited by the local memory
+      // that is needed for the tile of input pixels
+      std::size_t groupSize = 64;
+      std::size_t tileBytes = 0;
+      while( true )
+      {
+        tileBytes = ( ( groupSize - 1 ) * factors[ d ] + 2 * radius + 1 ) * sizeof( float );
+        if( groupSize == 1 || ( tileBytes <= this->m_DeviceLocalMemorySize
+          && groupSize <= this->m_DeviceMaximumWorkGroupSize ) )
+        {
+          break;
+        }
+        groupSize /= 2;
+      }
+      if( tileBytes > this->m_DeviceLocalMemorySize )
+      {
+        itkExceptionMacro( << "GPUGaussianSmoothAndShrinkImageFilter unable to perform." );
+        return;
+      }
+
+      const std::size_t handle = this->m_LinesKernelHandle;
+      int               argidx = 0;
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, inPtr->GetGPUDataManager() );
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, output );
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, gaussianBuffer );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_int ), &radiusArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &sourceSizeArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &destinationSizeArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_int ), &firstCenterArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &factorArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, tileBytes, NULL );
+
+      const std::size_t globalWidth = ( ( destinationSize + groupSize - 1 ) / groupSize ) * groupSize;
+      event = this->m_GPUKernelManager->LaunchKernel( handle,
+        OpenCLSize( globalWidth, outerSize ), OpenCLSize( groupSize, 1 ) );
+    }
+    else
+    {
+      const std::size_t handle = lastPass
+        ? this->m_StripsToOutputKernelHandle : this->m_StripsKernelHandle;
+      int argidx = 0;
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, source );
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, output );
+      this->m_GPUKernelManager->SetKernelArgWithImage( handle, argidx++, gaussianBuffer );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_int ), &radiusArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &innerSizeArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &sourceSizeArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &destinationSizeArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_int ), &firstCenterArgument );
+      this->m_GPUKernelManager->SetKernelArg( handle, argidx++, sizeof( cl_uint ), &factorArgument );
+
+      // Neighbouring work items process neighbouring pixels of the inner dimensions
+      const std::size_t groupSize   = std::min< std::size_t >( 32, this->m_DeviceMaximumWorkGroupSize );
+      const std::size_t globalWidth = ( ( innerSize + groupSize - 1 ) / groupSize ) * groupSize;
+      event = this->m_GPUKernelManager->LaunchKernel( handle,
+        OpenCLSize( globalWidth, destinationSize, outerSize ), OpenCLSize( groupSize, 1, 1 ) );
+    }
+
+    // The Gaussian and the source buffer have to live until the pass is done
+    event.WaitForFinished();
+
+    // The result of this pass is the source of the next one
+    sizes[ d ] = destinationSize;
+    source     = destination;
+  }
+
+  itkDebugMacro( << "GPUGaussianSmoothAndShrinkImageFilter::GPUGenerateData() finished" );
+} // end GPUGenerateData()
+
+
+/**
+ * ****************** AllocateFloatBuffer ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage >
+GPUDataManager::Pointer
+GPUGaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::AllocateFloatBuffer( const std::size_t size )
+{
+  GPUDataManager::Pointer buffer = GPUDataManager::New();
+  buffer->Initialize();
+  buffer->SetBufferFlag( CL_MEM_READ_WRITE );
+  buffer->SetBufferSize( static_cast< unsigned int >( size * sizeof( float ) ) );
+  buffer->Allocate();
+  return buffer;
+} // end AllocateFloatBuffer()
+
+
+/**
+ * ****************** PrintSelf ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage >
+void
+GPUGaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  CPUSuperclass::PrintSelf( os, indent );
+  GPUSuperclass::PrintSelf( os, indent );
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif /* __itkGPUGaussianSmoothAndShrinkImageFilter_hxx */
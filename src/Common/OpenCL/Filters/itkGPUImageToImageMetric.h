@@ -0,0 +1,42 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUImageToImageMetric_h
+#define __itkGPUImageToImageMetric_h
+
+#include "itkMacro.h"
+
+namespace itk
+{
+/** \class GPUImageToImageMetric
+ * \brief Functions and kernels shared by the GPU image to image metrics.
+ *
+ * Provides the atomic float additions, the local reduction, the B-spline
+ * mapping of the samples, the linear interpolation of the moving image value
+ * and gradient, and the scattering of the Jacobian gradient products to the
+ * derivative, for a B-spline transform and a 3D moving image. It also
+ * generates random coordinate samples of the fixed image on the device, like
+ * the counter-based ImageRandomCoordinateSampler. Used by the elastix OpenCL metrics, through elastix::OpenCLMetricBase.
+ *
+ * \ingroup GPUCommon
+ */
+
+/** Create a helper GPU Kernel class for itkGPUImageToImageMetric */
+itkGPUKernelClassMacro( GPUImageToImageMetricKernel );
+} // end namespace itk
+
+#endif /* __itkGPUImageToImageMetric_h */
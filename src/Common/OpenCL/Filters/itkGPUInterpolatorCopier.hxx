@@ -24,11 +24,13 @@
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkLinearInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
 
 // ITK GPU interpolators
 #include "itkGPUNearestNeighborInterpolateImageFunction.h"
 #include "itkGPULinearInterpolateImageFunction.h"
 #include "itkGPUBSplineInterpolateImageFunction.h"
+#include "itkGPUAdvancedRayCastInterpolateImageFunction.h"
 
 // GPU factory include
 #include "itkGPUImageFactory.h"
@@ -60,6 +62,62 @@ GPUInterpolatorCopier< TTypeList, NDimensions, TInterpolator, TOutputCoordRep >
     return;
   }
 
+  // The ray cast interpolator transforms its focal point with the current
+  // transform parameters, which do not change its modified time. Its
+  // transform can not be shared with a GPU interpolator of another precision,
+  // so the transformed focal point and threshold are copied on every update.
+  typedef AdvancedRayCastInterpolateImageFunction<
+    CPUInputImageType, CPUCoordRepType > RayCastInterpolatorType;
+  const typename RayCastInterpolatorType::ConstPointer raycast
+    = dynamic_cast< const RayCastInterpolatorType * >( m_InputInterpolator.GetPointer() );
+
+  if( raycast )
+  {
+    typename RayCastInterpolatorType::InputPointType focalPoint = raycast->GetFocalPoint();
+    if( raycast->GetTransform() )
+    {
+      focalPoint = raycast->GetTransform()->TransformPoint( focalPoint );
+    }
+
+    if( this->m_ExplicitMode )
+    {
+      // Create GPU ray cast interpolator in explicit mode
+      typedef GPUAdvancedRayCastInterpolateImageFunction<
+        GPUInputImageType, GPUCoordRepType > GPURayCastInterpolatorType;
+      typename GPURayCastInterpolatorType::Pointer rayCastInterpolator
+        = dynamic_cast< GPURayCastInterpolatorType * >( this->m_ExplicitOutput.GetPointer() );
+      if( rayCastInterpolator.IsNull() )
+      {
+        rayCastInterpolator = GPURayCastInterpolatorType::New();
+      }
+
+      typename GPURayCastInterpolatorType::InputPointType gpuFocalPoint;
+      gpuFocalPoint.CastFrom( focalPoint );
+      rayCastInterpolator->SetFocalPoint( gpuFocalPoint );
+      rayCastInterpolator->SetThreshold( raycast->GetThreshold() );
+      this->m_ExplicitOutput = rayCastInterpolator;
+    }
+    else
+    {
+      // Create GPU ray cast interpolator in implicit mode
+      typedef AdvancedRayCastInterpolateImageFunction<
+        CPUInputImageType, GPUCoordRepType > GPURayCastInterpolatorType;
+      typename GPURayCastInterpolatorType::Pointer rayCastInterpolator
+        = dynamic_cast< GPURayCastInterpolatorType * >( this->m_Output.GetPointer() );
+      if( rayCastInterpolator.IsNull() )
+      {
+        rayCastInterpolator = GPURayCastInterpolatorType::New();
+      }
+
+      typename GPURayCastInterpolatorType::InputPointType gpuFocalPoint;
+      gpuFocalPoint.CastFrom( focalPoint );
+      rayCastInterpolator->SetFocalPoint( gpuFocalPoint );
+      rayCastInterpolator->SetThreshold( raycast->GetThreshold() );
+      this->m_Output = rayCastInterpolator;
+    }
+    return;
+  }
+
   // Update only if the input AdvancedCombinationTransform has been modified
   const ModifiedTimeType t = this->m_InputInterpolator->GetMTime();
 
@@ -0,0 +1,41 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGPUParzenWindowMutualInformation_h
+#define __itkGPUParzenWindowMutualInformation_h
+
+#include "itkMacro.h"
+
+namespace itk
+{
+/** \class GPUParzenWindowMutualInformation
+ * \brief GPU kernels of the ParzenWindowMutualInformationImageToImageMetric.
+ *
+ * The kernels compute the joint histogram and the low memory derivative of
+ * the mutual information for a B-spline transform and a linearly
+ * interpolated 3D moving image. They are used by the elastix
+ * OpenCLMattesMutualInformation metric, together with the
+ * GPUImageToImageMetric kernels.
+ *
+ * \ingroup GPUCommon
+ */
+
+/** Create a helper GPU Kernel class for itkGPUParzenWindowMutualInformation */
+itkGPUKernelClassMacro( GPUParzenWindowMutualInformationKernel );
+} // end namespace itk
+
+#endif /* __itkGPUParzenWindowMutualInformation_h */
@@ -92,6 +92,7 @@ private:
 
   std::size_t m_FilterGPUKernelHandle;
   std::size_t m_DeviceLocalMemorySize;
+  std::size_t m_DeviceMaximumWorkGroupSize;
 };
 
 } // end namespace itk
@@ -36,23 +36,11 @@ GPURecursiveGaussianImageFilter< TInputImage, TOutputImage >
     itkExceptionMacro( "GPURecursiveGaussianImageFilter supports 1/2/3D image." );
   }
 
-  if( TInputImage::ImageDimension == 1 )
-  {
-    defines << "#define DIM_1\n";
-  }
-  else
-  {
-    defines << "#define DIM_" << int(TInputImage::ImageDimension - 1) << "\n";
-  }
-
-  // Define m_DeviceLocalMemorySize as:
-  // local memory: 16384 bytes / 3 buffers of float = 1365
-  const unsigned long localMemSize
-    = this->m_GPUKernelManager->GetContext()->GetDefaultDevice().GetLocalMemorySize();
-
-  this->m_DeviceLocalMemorySize = ( localMemSize / 3 ) / sizeof( float );
+  // The kernel filters tiles of lines in local memory
+  const OpenCLDevice device = this->m_GPUKernelManager->GetContext()->GetDefaultDevice();
+  this->m_DeviceLocalMemorySize      = device.GetLocalMemorySize();
+  this->m_DeviceMaximumWorkGroupSize = device.GetMaximumWorkItemsPerGroup();
 
-  defines << "#define BUFFSIZE " << this->m_DeviceLocalMemorySize << "\n";
   defines << "#define BUFFPIXELTYPE float" << "\n";
   defines << "#define INPIXELTYPE ";
   GetTypenameInString( typeid( typename TInputImage::PixelType ), defines );
@@ -104,55 +92,39 @@ GPURecursiveGaussianImageFilter< TInputImage, TOutputImage >
   const unsigned int ln       = outSize[ this->GetDirection() ];
   const unsigned int ImageDim = (unsigned int)( TInputImage::ImageDimension );
 
+  // Every line of a tile needs an input and an output buffer in local memory,
+  // with a pitch of ( ln | 1 ) pixels to avoid bank conflicts.
+  const std::size_t pitch     = ln | 1;
+  const std::size_t lineBytes = 2 * pitch * sizeof( float );
+
   // Check if GPU filter are able to perform for this image
-  if( ln > this->m_DeviceLocalMemorySize )
+  if( lineBytes > this->m_DeviceLocalMemorySize )
   {
     itkExceptionMacro( << "GPURecursiveGaussianImageFilter unable to perform." );
     return;
   }
 
-  int imgSize[ TInputImage::ImageDimension ];
-  for( unsigned int i = 0; i < ImageDim; i++ )
+  // The width of the tile is the number of lines filtered by a work group,
+  // at most 32 lines, and limited by the local memory.
+  std::size_t tileWidth = 32;
+  while( tileWidth > 1 && ( tileWidth * lineBytes > this->m_DeviceLocalMemorySize
+    || tileWidth > this->m_DeviceMaximumWorkGroupSize ) )
   {
-    imgSize[ i ] = outSize[ i ];
+    tileWidth /= 2;
   }
 
-  std::size_t globalSize1D = 0, globalSize2D[ 2 ];
-  for( unsigned int i = 0; i < 2; i++ )
+  // The image size, the missing dimensions have size 1
+  unsigned int imgSize[ 3 ] = { 1, 1, 1 };
+  std::size_t  numberOfPixels = 1;
+  for( unsigned int i = 0; i < ImageDim; i++ )
   {
-    globalSize2D[ i ] = 0;
+    imgSize[ i ]    = outSize[ i ];
+    numberOfPixels *= outSize[ i ];
   }
 
-  // Initialize globalSize, localSize here
-  if( ImageDim == 3 )
-  {
-    // 0 (direction x) : y/z
-    // 1 (direction y) : x/z
-    // 2 (direction z) : x/y
-    switch( this->GetDirection() )
-    {
-      case 0:
-        globalSize2D[ 0 ] = imgSize[ 1 ];
-        globalSize2D[ 1 ] = imgSize[ 2 ];
-        break;
-      case 1:
-        globalSize2D[ 0 ] = imgSize[ 0 ];
-        globalSize2D[ 1 ] = imgSize[ 2 ];
-        break;
-      case 2:
-        globalSize2D[ 0 ] = imgSize[ 0 ];
-        globalSize2D[ 1 ] = imgSize[ 1 ];
-        break;
-    }
-  }
-  else if( ImageDim == 2 )
-  {
-    globalSize1D = ln;
-  }
-  else if( ImageDim == 1 )
-  {
-    globalSize1D = 1;
-  }
+  // Every work item filters one line, the global size is rounded up to tiles
+  const std::size_t numberOfLines = numberOfPixels / ln;
+  const std::size_t globalSize    = ( ( numberOfLines + tileWidth - 1 ) / tileWidth ) * tileWidth;
 
   // Arguments set up
   int argidx = 0;
@@ -215,37 +187,23 @@ GPURecursiveGaussianImageFilter< TInputImage, TOutputImage >
     argidx++, sizeof( cl_float4 ), (void *)&BM );
 
   // Set image size
-  for( unsigned int i = 0; i < ImageDim; i++ )
+  for( unsigned int i = 0; i < 3; i++ )
   {
     this->m_GPUKernelManager->SetKernelArg( this->m_FilterGPUKernelHandle,
       argidx++, sizeof( cl_uint ), &( imgSize[ i ] ) );
   }
-  if( ImageDim == 1 )
-  {
-    const int height = 0;
-    this->m_GPUKernelManager->SetKernelArg( this->m_FilterGPUKernelHandle,
-      argidx++, sizeof( cl_uint ), &( height ) );
-  }
+
+  // Set the local input and output buffers of the tile
+  const std::size_t tileBytes = tileWidth * pitch * sizeof( float );
+  this->m_GPUKernelManager->SetKernelArg( this->m_FilterGPUKernelHandle,
+    argidx++, tileBytes, NULL );
+  this->m_GPUKernelManager->SetKernelArg( this->m_FilterGPUKernelHandle,
+    argidx++, tileBytes, NULL );
 
   // Launch kernel
-  switch( ImageDim )
-  {
-    case 1:
-    case 2:
-    {
-      OpenCLEvent event = this->m_GPUKernelManager->LaunchKernel( m_FilterGPUKernelHandle,
-        OpenCLSize( globalSize1D ) );
-      event.WaitForFinished();
-    }
-    break;
-    case 3:
-    {
-      OpenCLEvent event = this->m_GPUKernelManager->LaunchKernel( m_FilterGPUKernelHandle,
-        OpenCLSize( globalSize2D[ 0 ], globalSize2D[ 1 ] ) );
-      event.WaitForFinished();
-    }
-    break;
-  }
+  OpenCLEvent event = this->m_GPUKernelManager->LaunchKernel( m_FilterGPUKernelHandle,
+    OpenCLSize( globalSize ), OpenCLSize( tileWidth ) );
+  event.WaitForFinished();
 
   itkDebugMacro( << "GPURecursiveGaussianImageFilter::GPUGenerateData() finished" );
 }
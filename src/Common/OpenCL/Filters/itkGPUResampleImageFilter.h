@@ -22,7 +22,9 @@
 
 #include "itkGPUImageToImageFilter.h"
 #include "itkGPUInterpolateImageFunction.h"
+#include "itkGPULinearInterpolateImageFunction.h"
 #include "itkGPUBSplineInterpolateImageFunction.h"
+#include "itkGPUAdvancedRayCastInterpolateImageFunction.h"
 #include "itkGPUBSplineBaseTransform.h"
 #include "itkGPUTransformBase.h"
 #include "itkGPUCompositeTransformBase.h"
@@ -102,6 +104,14 @@ public:
   typedef typename GPUBSplineInterpolatorType::GPUCoefficientImagePointer GPUBSplineInterpolatorCoefficientImagePointer;
   typedef typename GPUBSplineInterpolatorType::GPUDataManagerPointer      GPUBSplineInterpolatorDataManagerPointer;
 
+  /** Typedefs for the linear interpolator. */
+  typedef GPULinearInterpolateImageFunction< InputImageType,
+    InterpolatorPrecisionType >                                           GPULinearInterpolatorType;
+
+  /** Typedefs for the ray cast interpolator. */
+  typedef GPUAdvancedRayCastInterpolateImageFunction< InputImageType,
+    InterpolatorPrecisionType >                                           GPURayCastInterpolatorType;
+
   /** Typedefs for the B-spline transform. */
   typedef GPUBSplineBaseTransform<
     InterpolatorPrecisionType, InputImageDimension > GPUBSplineBaseTransformType;
@@ -120,6 +130,53 @@ public:
   itkSetMacro( RequestedNumberOfSplits, unsigned int );
   itkGetConstMacro( RequestedNumberOfSplits, unsigned int );
 
+  /** Set/Get whether the output of every split is copied to the host while
+   * the next split is computed. The copies go through pinned host buffers on
+   * a second command queue. Only used when the output is processed in more
+   * than one split. Default is true. */
+  itkSetMacro( UseOverlappedTransfers, bool );
+  itkGetConstMacro( UseOverlappedTransfers, bool );
+  itkBooleanMacro( UseOverlappedTransfers );
+
+  /** Set/Get whether the output is computed in tiles, for images that do not
+   * fit in the device memory. The output is split in slabs, and for every slab
+   * only the part of the input that the transform maps it into is copied to
+   * the device. The slabs are copied to the host while the next slab is
+   * computed, and only the slabs are stored on the device. The number of slabs
+   * is at least the requested number of splits, and is increased until a slab
+   * fits in the device memory. Only works for 3D images, and not for the ray
+   * cast interpolator. Default is false. */
+  itkSetMacro( UseTiledExecution, bool );
+  itkGetConstMacro( UseTiledExecution, bool );
+  itkBooleanMacro( UseTiledExecution );
+
+  /** Returns true if tiled execution is requested and supported by the
+   * image dimension and the interpolator. */
+  bool IsTiledExecution( void ) const;
+
+  /** Set/Get whether the linear interpolator is evaluated by the texture
+   * sampler of the device. The input is then copied to an OpenCL image, and
+   * interpolated by the linear filtering of the sampler, which computes the
+   * interpolation weights with a reduced precision, typically 8 bits. Only
+   * works for the linear interpolator, 2D and 3D images, devices that support
+   * images, and not in tiled execution. Otherwise the input buffer is
+   * interpolated. Default is false. */
+  itkSetMacro( UseHardwareInterpolation, bool );
+  itkGetConstMacro( UseHardwareInterpolation, bool );
+  itkBooleanMacro( UseHardwareInterpolation );
+
+  /** Set/Get whether the texture of the hardware interpolation stores the
+   * input as half floats instead of floats. This halves the device memory and
+   * the bandwidth of the texture, but rounds the input to 11 significant bits.
+   * Default is false. */
+  itkSetMacro( UseHalfPrecisionTexture, bool );
+  itkGetConstMacro( UseHalfPrecisionTexture, bool );
+  itkBooleanMacro( UseHalfPrecisionTexture );
+
+  /** Returns true if hardware interpolation is requested and supported by
+   * the interpolator, the image dimension, the device and the execution mode. */
+  bool IsHardwareInterpolation( void ) const;
+
 protected:
 
   GPUResampleImageFilter();
@@ -128,6 +185,9 @@ protected:
 
   virtual void GPUGenerateData( void );
 
+  /** In tiled execution the output is allocated on the host only. */
+  virtual void AllocateOutputs( void ) ITK_OVERRIDE;
+
   // Supported GPU transform types
   typedef enum {
     IdentityTransform = 1,
@@ -176,6 +236,41 @@ protected:
   GPUBSplineBaseTransformType * GetGPUBSplineBaseTransform(
     const std::size_t transformIndex );
 
+  /** Create the transfer command queue and the pinned host buffers of
+   * \a size bytes. Returns false if they could not be created. */
+  bool InitializeOverlappedTransfers( const std::size_t size );
+
+  /** Enqueue the copy of \a chunkRegion of the output to a pinned host
+   * buffer, to start when \a event has finished. */
+  void EnqueueChunkTransfer( const typename GPUOutputImage::Pointer & output,
+    const OutputImageRegionType & chunkRegion, const OpenCLEvent & event );
+
+  /** Finish all copies, release the pinned host buffers, and mark the CPU
+   * buffer of the output as up-to-date. */
+  void FinishOverlappedTransfers( const typename GPUOutputImage::Pointer & output );
+
+  /** Get the number of slabs in tiled execution, such that the deformation
+   * field, the output and the input of a slab fit in the device memory. */
+  unsigned int GetNumberOfTiles( const typename GPUInputImage::Pointer & input,
+    const OutputImageRegionType & outputRegion ) const;
+
+  /** Copy the part of the input that is mapped to \a chunkRegion to the
+   * device, and launch the post kernel on it when \a eventList has finished.
+   * The slab is written to a device buffer, and the copy of that buffer to
+   * \a output is enqueued. Returns the event of the post kernel. */
+  OpenCLEvent LaunchPostKernelForTile( const typename GPUInputImage::Pointer & input,
+    const typename GPUOutputImage::Pointer & output,
+    const OutputImageRegionType & chunkRegion,
+    const OpenCLSize & globalWorkSize, const OpenCLEventList & eventList );
+
+  /** Get the format of the input texture of the hardware interpolation.
+   * Returns false if the format is not supported by the context. */
+  bool GetInputTextureFormat( OpenCLImageFormat & format ) const;
+
+  /** Copy the input to the texture of the hardware interpolation, converted
+   * to floats or half floats, and create its linear sampler. */
+  void CreateInputTexture( const typename GPUInputImage::Pointer & input );
+
 private:
 
   GPUResampleImageFilter( const Self & ); // purposely not implemented
@@ -189,6 +284,47 @@ private:
   GPUDataManagerPointer m_FilterParameters;
   GPUDataManagerPointer m_DeformationFieldBuffer;
   unsigned int          m_RequestedNumberOfSplits;
+  bool                  m_UseOverlappedTransfers;
+  bool                  m_UseTiledExecution;
+  bool                  m_UseHardwareInterpolation;
+  bool                  m_UseHalfPrecisionTexture;
+
+  /** Device data of the hardware interpolation. */
+  OpenCLImage   m_InputTexture;
+  OpenCLSampler m_InputTextureSampler;
+
+  /** Device data of the tiled execution. */
+  GPUDataManagerPointer                         m_BoundingBoxBuffer;
+  GPUDataManagerPointer                         m_TileGPUImageBase;
+  GPUDataManagerPointer                         m_TileImageFunction;
+  std::vector< GPUDataManagerPointer >          m_TileOutputBuffers;
+  typename GPUInputImage::Pointer               m_InputTile;
+  GPUBSplineInterpolatorCoefficientImagePointer m_CoefficientTile;
+
+  /** A copy of an output split, from the device to a pinned host buffer,
+   * and from there to the output buffer. */
+  struct ChunkTransfer
+  {
+    OpenCLBuffer m_PinnedBuffer;
+    void *       m_PinnedPointer;
+    OpenCLEvent  m_Event;
+    void *       m_Destination;
+    std::size_t  m_Size;
+  };
+
+  /** Wait for the copy to the pinned host buffer of \a transfer, and copy
+   * it to the output buffer. */
+  void FinishChunkTransfer( ChunkTransfer & transfer );
+
+  /** Enqueue the copy of \a size bytes at \a sourceOffset of \a source to
+   * a pinned host buffer, to start when \a event has finished, and to be
+   * copied to \a destination. */
+  void EnqueueBufferTransfer( const cl_mem source, const std::size_t sourceOffset,
+    void * destination, const std::size_t size, const OpenCLEvent & event );
+
+  OpenCLCommandQueue           m_TransferQueue;
+  std::vector< ChunkTransfer > m_ChunkTransfers;
+  std::size_t                  m_ChunkTransferIndex;
 
   typedef std::pair< int, bool >                            TransformHandle;
   typedef std::map< GPUTransformTypeEnum, TransformHandle > TransformsHandle;
@@ -221,11 +357,15 @@ private:
   std::size_t m_TransformSourceLoadedIndex;
 
   bool m_InterpolatorIsBSpline;
+  bool m_InterpolatorIsRayCast;
+  bool m_InterpolatorSupportsTexture;
   bool m_TransformIsCombo;
 
   std::size_t      m_FilterPreGPUKernelHandle;
   TransformsHandle m_FilterLoopGPUKernelHandle;
   std::size_t      m_FilterPostGPUKernelHandle;
+  std::size_t      m_FilterPostTextureGPUKernelHandle;
+  std::size_t      m_FilterBoundingBoxGPUKernelHandle;
 
   // GPU kernel managers
   GPUKernelManagerPointer m_PreKernelManager;
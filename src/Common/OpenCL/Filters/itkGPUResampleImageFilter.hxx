@@ -25,11 +25,19 @@
 #include "itkGPUImageBase.h"
 
 #include "itkImageLinearIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
 #include "itkTimeProbe.h"
 #include "itkImageRegionSplitterSlowDimension.h"
 
 #include "itkOpenCLUtil.h"
 #include "itkOpenCLKernelToImageBridge.h"
+#include "itkHalfFloat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
 namespace
 {
@@ -40,6 +48,42 @@ typedef struct
   cl_float  default_value;
   cl_float  dummy_for_alignment;
 } FilterParameters;
+
+// The number of work items of the bounding box kernel of the tiled execution
+const std::size_t NumberOfBoundingBoxWorkItems = 4096;
+
+// Copy region of image to a new GPU image, with its index at zero and its
+// origin at the start of region, and copy it to the device.
+template< typename TGPUImage, typename TImage >
+typename TGPUImage::Pointer
+CreateGPUImageTile( const TImage * image, const typename TImage::RegionType & region )
+{
+  typename TGPUImage::RegionType tileRegion;
+  tileRegion.SetSize( region.GetSize() );
+
+  typename TGPUImage::PointType origin;
+  image->TransformIndexToPhysicalPoint( region.GetIndex(), origin );
+
+  typename TGPUImage::Pointer tile = TGPUImage::New();
+  tile->SetRegions( tileRegion );
+  tile->SetOrigin( origin );
+  tile->SetSpacing( image->GetSpacing() );
+  tile->SetDirection( image->GetDirection() );
+  tile->Allocate();
+
+  itk::ImageRegionConstIterator< TImage > it( image, region );
+  itk::ImageRegionIterator< TGPUImage >   tileIt( tile, tileRegion );
+  for(; !it.IsAtEnd(); ++it, ++tileIt )
+  {
+    tileIt.Set( it.Get() );
+  }
+
+  tile->GetGPUDataManager()->SetGPUDirtyFlag( true );
+  tile->GetGPUDataManager()->UpdateGPUBuffer();
+  return tile;
+}
+
+
 } // end of unnamed namespace
 
 namespace itk
@@ -67,20 +111,39 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
 
   this->m_DeformationFieldBuffer = GPUDataManager::New();
 
+  this->m_BoundingBoxBuffer = GPUDataManager::New();
+  this->m_TileGPUImageBase  = GPUDataManager::New();
+
+  // GPUImageFunction3D is defined in itkGPUInterpolateImageFunction.hxx
+  this->m_TileImageFunction = GPUDataManager::New();
+  this->m_TileImageFunction->Initialize();
+  this->m_TileImageFunction->SetBufferFlag( CL_MEM_READ_ONLY );
+  this->m_TileImageFunction->SetBufferSize( sizeof( GPUImageFunction3D ) );
+  this->m_TileImageFunction->Allocate();
+
   this->m_InterpolatorSourceLoadedIndex = 0;
   this->m_TransformSourceLoadedIndex    = 0;
 
   this->m_InterpolatorIsBSpline = false; // make it protected in base class
+  this->m_InterpolatorIsRayCast = false;
+  this->m_InterpolatorSupportsTexture = false;
   this->m_TransformIsCombo      = false;
 
   // Set all handlers to -1;
   this->m_FilterPreGPUKernelHandle  = -1;
   this->m_FilterPostGPUKernelHandle = -1;
+  this->m_FilterPostTextureGPUKernelHandle = -1;
+  this->m_FilterBoundingBoxGPUKernelHandle = -1;
 
   this->m_InterpolatorBase = NULL;
   this->m_TransformBase    = NULL;
 
   this->m_RequestedNumberOfSplits = 5;
+  this->m_UseOverlappedTransfers  = true;
+  this->m_UseTiledExecution       = false;
+  this->m_UseHardwareInterpolation = false;
+  this->m_UseHalfPrecisionTexture  = false;
+  this->m_ChunkTransferIndex      = 0;
 
   std::ostringstream defines;
   if( TInputImage::ImageDimension > 3 || TInputImage::ImageDimension < 1 )
@@ -170,6 +233,40 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
     this->m_InterpolatorIsBSpline = true;
   }
 
+  // Test for a GPU ray cast interpolator, which casts the rays through the
+  // input image instead of interpolating it at the transformed points.
+  const GPURayCastInterpolatorType * GPURayCastInterpolator
+                                = dynamic_cast< const GPURayCastInterpolatorType * >( _arg );
+  this->m_InterpolatorIsRayCast = false;
+  if( GPURayCastInterpolator )
+  {
+    if( InputImageDimension != 3 )
+    {
+      itkExceptionMacro( "The GPU ray cast interpolator supports 3D images only." );
+    }
+    this->m_InterpolatorIsRayCast = true;
+  }
+
+  // Test for a GPU linear interpolator, which can also be evaluated by the
+  // texture sampler of the device, if all devices support images.
+  const GPULinearInterpolatorType * GPULinearInterpolator
+    = dynamic_cast< const GPULinearInterpolatorType * >( _arg );
+  this->m_InterpolatorSupportsTexture = false;
+  if( GPULinearInterpolator && InputImageDimension > 1 )
+  {
+    const std::list< OpenCLDevice > devices = this->m_PostKernelManager->GetContext()->GetDevices();
+    this->m_InterpolatorSupportsTexture = !devices.empty();
+    for( std::list< OpenCLDevice >::const_iterator it = devices.begin();
+      it != devices.end(); ++it )
+    {
+      if( ( InputImageDimension == 2 && !it->HasImage2D() )
+        || ( InputImageDimension == 3 && !it->HasImage3D() ) )
+      {
+        this->m_InterpolatorSupportsTexture = false;
+      }
+    }
+  }
+
   // Get interpolator source
   std::string interpolatorSource;
   if( !interpolatorBase->GetSourceCode( interpolatorSource ) )
@@ -186,6 +283,14 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
   {
     resamplePostSource << "#define BSPLINE_INTERPOLATOR\n";
   }
+  else if( this->m_InterpolatorIsRayCast )
+  {
+    resamplePostSource << "#define RAYCAST_INTERPOLATOR\n";
+  }
+  else if( this->m_InterpolatorSupportsTexture )
+  {
+    resamplePostSource << "#define TEXTURE_INTERPOLATOR\n";
+  }
 
   resamplePostSource << this->m_Sources[ 1 ]; // GPUMath source
   resamplePostSource << this->m_Sources[ 2 ]; // GPUImageBase source
@@ -206,12 +311,31 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
     this->m_FilterPostGPUKernelHandle = this->m_PostKernelManager->CreateKernel(
       program, "ResampleImageFilterPost_BSplineInterpolator" );
   }
+  else if( this->m_InterpolatorIsRayCast )
+  {
+    this->m_FilterPostGPUKernelHandle = this->m_PostKernelManager->CreateKernel(
+      program, "ResampleImageFilterPost_RayCastInterpolator" );
+  }
   else
   {
     this->m_FilterPostGPUKernelHandle = this->m_PostKernelManager->CreateKernel(
       program, "ResampleImageFilterPost" );
   }
 
+  // Create the post kernel of the hardware interpolation
+  if( this->m_InterpolatorSupportsTexture )
+  {
+    this->m_FilterPostTextureGPUKernelHandle = this->m_PostKernelManager->CreateKernel(
+      program, "ResampleImageFilterPost_TextureInterpolator" );
+  }
+
+  // Create the bounding box kernel of the tiled execution
+  if( InputImageDimension == 3 && !this->m_InterpolatorIsRayCast )
+  {
+    this->m_FilterBoundingBoxGPUKernelHandle = this->m_PostKernelManager->CreateKernel(
+      program, "ResampleImageFilterBoundingBox" );
+  }
+
   itkDebugMacro( << "GPUResampleImageFilter::SetInterpolator() finished" );
 } // end SetInterpolator()
 
@@ -396,6 +520,12 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
   gputimer.Start();
 #endif
 
+  // Launch all kernels on the device selected in GenerateData()
+  const OpenCLDevice device = this->m_GPUKernelManager->GetDevice();
+  this->m_PreKernelManager->SetDevice( device );
+  this->m_LoopKernelManager->SetDevice( device );
+  this->m_PostKernelManager->SetDevice( device );
+
   // Get handles to the input and output images
   const typename GPUInputImage::Pointer inPtr
     = dynamic_cast< GPUInputImage * >( this->ProcessObject::GetInput( 0 ) );
@@ -449,6 +579,35 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
     requestedNumberOfSplits = 1;
   }
 
+  // In tiled execution the number of splits is increased until a split fits
+  // in the device memory.
+  const bool tiled = this->IsTiledExecution();
+  if( this->m_UseTiledExecution && !tiled )
+  {
+    itkWarningMacro( << "Tiled execution is only supported for 3D images, "
+                     << "and not for the ray cast interpolator." );
+  }
+  if( tiled )
+  {
+    requestedNumberOfSplits = std::max( requestedNumberOfSplits,
+      this->GetNumberOfTiles( inPtr, outputLargestRegion ) );
+  }
+
+  // The hardware interpolation samples a copy of the input in a texture
+  const bool useTexture = this->IsHardwareInterpolation();
+  if( this->m_UseHardwareInterpolation && !useTexture )
+  {
+    itkWarningMacro( << "Hardware interpolation is only supported for the linear "
+                     << "interpolator, 2D and 3D images, devices and input texture formats "
+                     << "that support images, and not in tiled execution." );
+  }
+  if( useTexture )
+  {
+    this->CreateInputTexture( inPtr );
+  }
+  const std::size_t postKernelHandle = useTexture
+    ? this->m_FilterPostTextureGPUKernelHandle : this->m_FilterPostGPUKernelHandle;
+
   typedef ImageRegionSplitterSlowDimension RegionSplitterType;
   RegionSplitterType::Pointer splitter = RegionSplitterType::New();
   const unsigned int          numberOfChunks
@@ -501,6 +660,57 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
   this->m_DeformationFieldBuffer->SetBufferSize( mem_size_DF );
   this->m_DeformationFieldBuffer->Allocate();
 
+  // In tiled execution every chunk is computed in one of two device buffers,
+  // and the bounding box kernel computes the part of the input it needs.
+  if( tiled )
+  {
+    if( outPtr->GetBufferedRegion() != outputLargestRegion )
+    {
+      itkExceptionMacro( << "Tiled execution requires the largest possible output region." );
+    }
+
+    const std::size_t chunkBufferSize = totalDFSize * sizeof( OutputImagePixelType );
+    this->m_TileOutputBuffers.resize( 2 );
+    for( std::size_t i = 0; i < this->m_TileOutputBuffers.size(); ++i )
+    {
+      this->m_TileOutputBuffers[ i ] = GPUDataManager::New();
+      this->m_TileOutputBuffers[ i ]->Initialize();
+      this->m_TileOutputBuffers[ i ]->SetBufferFlag( CL_MEM_READ_WRITE );
+      this->m_TileOutputBuffers[ i ]->SetBufferSize( chunkBufferSize );
+      this->m_TileOutputBuffers[ i ]->Allocate();
+    }
+
+    this->m_BoundingBoxBuffer->Initialize();
+    this->m_BoundingBoxBuffer->SetBufferFlag( CL_MEM_WRITE_ONLY );
+    this->m_BoundingBoxBuffer->SetBufferSize( 6 * NumberOfBoundingBoxWorkItems * sizeof( cl_float ) );
+    this->m_BoundingBoxBuffer->Allocate();
+
+    // The deformation field size is set per chunk
+    cl_uint argidx = 0;
+    this->m_PostKernelManager->SetKernelArgWithImage(
+      this->m_FilterBoundingBoxGPUKernelHandle, argidx++, this->m_DeformationFieldBuffer );
+    argidx++;
+    SetKernelWithITKImage< GPUInputImage >( this->m_PostKernelManager,
+      this->m_FilterBoundingBoxGPUKernelHandle, argidx,
+      inPtr, this->m_InputGPUImageBase,
+      false, true );
+    this->m_PostKernelManager->SetKernelArgWithImage(
+      this->m_FilterBoundingBoxGPUKernelHandle, argidx++, this->m_BoundingBoxBuffer );
+
+    if( !this->InitializeOverlappedTransfers( chunkBufferSize ) )
+    {
+      itkExceptionMacro( << "Unable to create the pinned host buffers of the tiled execution." );
+    }
+  }
+
+  // Copy the output of every chunk to the host while the next chunk is
+  // computed. The chunks are slabs along the slowest dimension, and thus
+  // contiguous in the output buffer.
+  const bool overlapTransfers = tiled || ( this->m_UseOverlappedTransfers
+    && numberOfChunks > 1
+    && outPtr->GetBufferedRegion() == outputLargestRegion
+    && this->InitializeOverlappedTransfers( totalDFSize * sizeof( OutputImagePixelType ) ) );
+
   // Set arguments for pre kernel
   this->SetArgumentsForPreKernelManager( outPtr );
 
@@ -511,12 +721,15 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
     this->SetTransformParametersForLoopKernelManager( 0 );
   }
 
-  // Set arguments for post kernel
-  this->SetArgumentsForPostKernelManager( inPtr, outPtr );
+  // Set arguments for post kernel. In tiled execution they are set per chunk.
+  if( !tiled )
+  {
+    this->SetArgumentsForPostKernelManager( inPtr, outPtr );
+  }
 
   // Define global and local work size
   const OpenCLSize localWorkSize
-    = OpenCLSize::GetLocalWorkSize( this->m_PreKernelManager->GetContext()->GetDefaultDevice() );
+    = OpenCLSize::GetLocalWorkSize( this->m_PreKernelManager->GetDevice() );
   std::size_t local3D[ 3 ], local2D[ 2 ], local1D;
 
   local3D[ 0 ] = local2D[ 0 ] = local1D = localWorkSize[ 0 ];
@@ -674,18 +887,116 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
       eventList.Append( loopEvent );
     }
 
-    // Launch the post kernel
-    OpenCLEvent postEvent = this->m_PostKernelManager->LaunchKernel(
-      this->m_FilterPostGPUKernelHandle, eventList );
-    eventList.Append( postEvent );
+    // Launch the post kernel, and copy the output of this chunk to the host
+    if( tiled )
+    {
+      OpenCLEvent postEvent = this->LaunchPostKernelForTile(
+        inPtr, outPtr, currentChunkRegion, global_work_size, eventList );
+      eventList.Append( postEvent );
+    }
+    else
+    {
+      OpenCLEvent postEvent = this->m_PostKernelManager->LaunchKernel(
+        postKernelHandle, eventList );
+      eventList.Append( postEvent );
+
+      if( overlapTransfers )
+      {
+        this->EnqueueChunkTransfer( outPtr, currentChunkRegion, postEvent );
+      }
+    }
   }
 
   eventList.WaitForFinished();
 
+  if( overlapTransfers )
+  {
+    this->FinishOverlappedTransfers( outPtr );
+  }
+
+  // Release the device data of the tiled execution
+  if( tiled )
+  {
+    this->m_TileOutputBuffers.clear();
+    this->m_BoundingBoxBuffer->Initialize();
+    this->m_InputTile       = NULL;
+    this->m_CoefficientTile = NULL;
+    outPtr->GetGPUDataManager()->SetGPUBufferLock( false );
+  }
+
+  // Release the input texture
+  this->m_InputTexture        = OpenCLImage();
+  this->m_InputTextureSampler = OpenCLSampler();
+
   itkDebugMacro( << "GPUResampleImageFilter::GPUGenerateData() finished" );
 } // end GPUGenerateData()
 
 
+/**
+ * ***************** AllocateOutputs ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::AllocateOutputs( void )
+{
+  typename GPUOutputImage::Pointer outPtr
+    = dynamic_cast< GPUOutputImage * >( this->ProcessObject::GetOutput( 0 ) );
+  if( !this->IsTiledExecution() || outPtr.IsNull() )
+  {
+    // The lock of an interrupted tiled execution would prevent the allocation
+    if( outPtr.IsNotNull() )
+    {
+      outPtr->GetGPUDataManager()->SetGPUBufferLock( false );
+    }
+    GPUSuperclass::AllocateOutputs();
+    return;
+  }
+
+  // Release the GPU buffer of a previous update, and lock the GPU buffer
+  // during the allocation, so that only the CPU buffer is allocated. The lock
+  // is released by GPUGenerateData().
+  outPtr->SetBufferedRegion( outPtr->GetRequestedRegion() );
+  outPtr->GetGPUDataManager()->Initialize();
+  outPtr->GetGPUDataManager()->SetGPUBufferLock( true );
+  outPtr->Allocate();
+  outPtr->GetGPUDataManager()->SetCPUBufferPointer( outPtr->GetBufferPointer() );
+} // end AllocateOutputs()
+
+
+/**
+ * ***************** IsTiledExecution ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+bool
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::IsTiledExecution( void ) const
+{
+  return this->m_UseTiledExecution
+         && InputImageDimension == 3
+         && !this->m_InterpolatorIsRayCast;
+} // end IsTiledExecution()
+
+
+/**
+ * ***************** IsHardwareInterpolation ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+bool
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::IsHardwareInterpolation( void ) const
+{
+  OpenCLImageFormat format;
+  return this->m_UseHardwareInterpolation
+         && this->m_InterpolatorSupportsTexture
+         && !this->IsTiledExecution()
+         && this->GetInputTextureFormat( format );
+} // end IsHardwareInterpolation()
+
+
 /**
  * ***************** SetArgumentsForPreKernelManager ***********************
  */
@@ -896,25 +1207,39 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
   itkDebugMacro( << "GPUResampleImageFilter::SetArgumentsForPostKernelManager("
                  << input->GetNameOfClass() << ", " << output->GetNameOfClass() << ") called" );
 
-  // Get a handle to the post kernel
-  OpenCLKernel & postKernel
-    = this->m_PostKernelManager->GetKernel( this->m_FilterPostGPUKernelHandle );
+  // Get a handle to the post kernel, of the hardware interpolation if the
+  // input texture has been created
+  const bool        useTexture = !this->m_InputTexture.IsNull();
+  const std::size_t kernelId   = useTexture
+    ? this->m_FilterPostTextureGPUKernelHandle : this->m_FilterPostGPUKernelHandle;
+  OpenCLKernel & postKernel = this->m_PostKernelManager->GetKernel( kernelId );
 
   cl_uint argidx = 0;
 
   // Set deformation field buffer to the kernel
   this->m_PostKernelManager->SetKernelArgWithImage(
-    this->m_FilterPostGPUKernelHandle, argidx++, this->m_DeformationFieldBuffer );
+    kernelId, argidx++, this->m_DeformationFieldBuffer );
 
   argidx++; // skip deformation field size for now
 
-  // Most interpolators work on the input image.
-  // The B-spline interpolator however, works on the coefficients image,
-  // previously generated by the BSplineDecompositionImageFilter.
-  if( !this->m_InterpolatorIsBSpline )
+  // Most interpolators work on the input image, the ray cast interpolator
+  // casts its rays through it. The B-spline interpolator however, works on
+  // the coefficients image, previously generated by the
+  // BSplineDecompositionImageFilter.
+  if( useTexture )
   {
+    // The texture and its sampler replace the input buffer
+    postKernel.SetArg( argidx++, this->m_InputTexture );
+    postKernel.SetArg( argidx++, this->m_InputTextureSampler );
     SetKernelWithITKImage< GPUInputImage >( this->m_PostKernelManager,
-      this->m_FilterPostGPUKernelHandle, argidx,
+      kernelId, argidx,
+      input, this->m_InputGPUImageBase,
+      false, true );
+  }
+  else if( !this->m_InterpolatorIsBSpline )
+  {
+    SetKernelWithITKImage< GPUInputImage >( this->m_PostKernelManager,
+      kernelId, argidx,
       input, this->m_InputGPUImageBase,
       true, true );
   }
@@ -931,21 +1256,21 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
       = gpuBSplineInterpolator->GetGPUCoefficientsImageBase();
 
     SetKernelWithITKImage< GPUBSplineInterpolatorCoefficientImageType >( this->m_PostKernelManager,
-      this->m_FilterPostGPUKernelHandle, argidx,
+      kernelId, argidx,
       coefficient, coefficientbase,
       true, true );
 
     // Set the B-spline interpolator spline order
     const cl_uint splineOrder = gpuBSplineInterpolator->GetSplineOrder();
     this->m_PostKernelManager->SetKernelArg(
-      this->m_FilterPostGPUKernelHandle, argidx++, sizeof( cl_uint ),
+      kernelId, argidx++, sizeof( cl_uint ),
       (void *)&splineOrder );
   }
 
   // Set output image to the kernel
   GPUDataManager::Pointer dummy;
   SetKernelWithITKImage< GPUOutputImage >( this->m_PostKernelManager,
-    this->m_FilterPostGPUKernelHandle, argidx,
+    kernelId, argidx,
     output, dummy,
     true, false );
 
@@ -955,11 +1280,12 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
 
   // Set the parameters struct to the kernel
   this->m_PostKernelManager->SetKernelArgWithImage(
-    this->m_FilterPostGPUKernelHandle, argidx++, this->m_FilterParameters );
+    kernelId, argidx++, this->m_FilterParameters );
 
-  // Set the image function to the kernel
+  // Set the image function to the kernel. For the ray cast interpolator
+  // this contains the focal point, transformed with the current parameters.
   this->m_PostKernelManager->SetKernelArgWithImage(
-    this->m_FilterPostGPUKernelHandle, argidx++, this->m_InterpolatorBase->GetParametersDataManager() );
+    kernelId, argidx++, this->m_InterpolatorBase->GetParametersDataManager() );
 
   itkDebugMacro( << "GPUResampleImageFilter::SetArgumentsForPostKernelManager() finished" );
 } // end SetArgumentsForPostKernelManager()
@@ -1169,6 +1495,426 @@ typename GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
   return GPUBSplineTransformBase;
 }  // end GetGPUBSplineBaseTransform()
 
+/**
+ * ***************** InitializeOverlappedTransfers ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+bool
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::InitializeOverlappedTransfers( const std::size_t size )
+{
+  OpenCLContext * context = this->m_PostKernelManager->GetContext();
+
+  // The copies are enqueued on their own in-order queue, so that they run
+  // next to the kernels of the default queue.
+  this->m_TransferQueue = context->CreateCommandQueue( 0, this->m_PostKernelManager->GetDevice() );
+  if( this->m_TransferQueue.IsNull() )
+  {
+    return false;
+  }
+
+  // Two pinned buffers: one is filled by the device while the other is
+  // copied to the output on the host.
+  this->m_ChunkTransfers.resize( 2 );
+  this->m_ChunkTransferIndex = 0;
+  for( std::size_t i = 0; i < this->m_ChunkTransfers.size(); ++i )
+  {
+    ChunkTransfer & transfer = this->m_ChunkTransfers[ i ];
+    transfer.m_PinnedBuffer  = context->CreateBufferHost( NULL, OpenCLMemoryObject::ReadWrite, size );
+    transfer.m_PinnedPointer = transfer.m_PinnedBuffer.IsNull()
+      ? NULL : transfer.m_PinnedBuffer.Map( OpenCLMemoryObject::ReadWrite );
+    transfer.m_Event       = OpenCLEvent();
+    transfer.m_Destination = NULL;
+    transfer.m_Size        = 0;
+
+    if( transfer.m_PinnedPointer == NULL )
+    {
+      this->m_ChunkTransfers.clear();
+      this->m_TransferQueue = OpenCLCommandQueue();
+      return false;
+    }
+  }
+
+  return true;
+} // end InitializeOverlappedTransfers()
+
+
+/**
+ * ***************** EnqueueChunkTransfer ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::EnqueueChunkTransfer( const typename GPUOutputImage::Pointer & output,
+  const OutputImageRegionType & chunkRegion, const OpenCLEvent & event )
+{
+  // The chunk is contiguous in the output buffer. The CPU buffer is taken
+  // from the data manager, since GPUImage::GetBufferPointer() would copy
+  // the whole output.
+  GPUDataManager::Pointer dataManager = output->GetGPUDataManager();
+  const std::size_t       offset      = output->ComputeOffset( chunkRegion.GetIndex() ) * sizeof( OutputImagePixelType );
+  this->EnqueueBufferTransfer( *( dataManager->GetGPUBufferPointer() ), offset,
+    static_cast< char * >( dataManager->GetCPUBufferPointer() ) + offset,
+    chunkRegion.GetNumberOfPixels() * sizeof( OutputImagePixelType ), event );
+} // end EnqueueChunkTransfer()
+
+
+/**
+ * ***************** EnqueueBufferTransfer ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::EnqueueBufferTransfer( const cl_mem source, const std::size_t sourceOffset,
+  void * destination, const std::size_t size, const OpenCLEvent & event )
+{
+  ChunkTransfer & transfer = this->m_ChunkTransfers[ this->m_ChunkTransferIndex ];
+  this->m_ChunkTransferIndex = ( this->m_ChunkTransferIndex + 1 ) % this->m_ChunkTransfers.size();
+
+  // Free the pinned buffer from the chunk before last
+  this->FinishChunkTransfer( transfer );
+
+  transfer.m_Size        = size;
+  transfer.m_Destination = destination;
+
+  cl_event waitEvent = event.GetEventId();
+  cl_event readEvent = NULL;
+  OpenCLContext * context = this->m_PostKernelManager->GetContext();
+  const cl_int    error   = clEnqueueReadBuffer( this->m_TransferQueue.GetQueueId(),
+    source, CL_FALSE, sourceOffset, transfer.m_Size,
+    transfer.m_PinnedPointer, waitEvent ? 1 : 0, waitEvent ? &waitEvent : NULL, &readEvent );
+  context->ReportError( error, __FILE__, __LINE__, ITK_LOCATION );
+  transfer.m_Event = OpenCLEvent( readEvent );
+  context->GetProfiler().AddDeviceToHostTransfer( transfer.m_Size );
+
+  // Submit the kernels and the copy to the device
+  clFlush( this->m_PostKernelManager->GetCommandQueue().GetQueueId() );
+  clFlush( this->m_TransferQueue.GetQueueId() );
+} // end EnqueueBufferTransfer()
+
+
+/**
+ * ***************** FinishChunkTransfer ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::FinishChunkTransfer( ChunkTransfer & transfer )
+{
+  if( transfer.m_Event.IsNull() )
+  {
+    return;
+  }
+
+  transfer.m_Event.WaitForFinished();
+  std::memcpy( transfer.m_Destination, transfer.m_PinnedPointer, transfer.m_Size );
+  transfer.m_Event = OpenCLEvent();
+} // end FinishChunkTransfer()
+
+
+/**
+ * ***************** FinishOverlappedTransfers ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::FinishOverlappedTransfers( const typename GPUOutputImage::Pointer & output )
+{
+  for( std::size_t i = 0; i < this->m_ChunkTransfers.size(); ++i )
+  {
+    ChunkTransfer & transfer = this->m_ChunkTransfers[ i ];
+    this->FinishChunkTransfer( transfer );
+    transfer.m_PinnedBuffer.Unmap( transfer.m_PinnedPointer, true );
+  }
+  this->m_ChunkTransfers.clear();
+  this->m_TransferQueue = OpenCLCommandQueue();
+
+  // The output is on the host already, GenerateData() need not copy it
+  output->GetGPUDataManager()->SetCPUBufferUpdated();
+} // end FinishOverlappedTransfers()
+
+
+/**
+ * ***************** GetNumberOfTiles ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+unsigned int
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetNumberOfTiles( const typename GPUInputImage::Pointer & input,
+  const OutputImageRegionType & outputRegion ) const
+{
+  // Only half of the global memory is used, the rest is left for the
+  // transform and the other users of the device.
+  const OpenCLDevice device        = this->m_PostKernelManager->GetDevice();
+  const double       globalMemory  = 0.5 * static_cast< double >( device.GetGlobalMemorySize() );
+  const double       maxAllocation = static_cast< double >( device.GetMaximumAllocationSize() );
+
+  const double numberOfOutputPixels = static_cast< double >( outputRegion.GetNumberOfPixels() );
+  const double numberOfInputPixels  = static_cast< double >( input->GetBufferedRegion().GetNumberOfPixels() );
+  const double deformationFieldSize = numberOfOutputPixels * sizeof( cl_float3 );
+  const double outputSize           = numberOfOutputPixels * sizeof( OutputImagePixelType );
+  const double inputSize            = numberOfInputPixels * ( this->m_InterpolatorIsBSpline
+    ? sizeof( typename GPUBSplineInterpolatorCoefficientImageType::PixelType )
+    : sizeof( typename InputImageType::PixelType ) );
+
+  // A slab stores its deformation field, two output buffers and its part of
+  // the input, which is estimated as the same fraction of the input.
+  double numberOfTiles = std::ceil( ( deformationFieldSize + 2.0 * outputSize + inputSize ) / globalMemory );
+  numberOfTiles = std::max( numberOfTiles, std::ceil( deformationFieldSize / maxAllocation ) );
+  numberOfTiles = std::max( numberOfTiles, std::ceil( inputSize / maxAllocation ) );
+
+  return static_cast< unsigned int >( std::max( numberOfTiles, 1.0 ) );
+} // end GetNumberOfTiles()
+
+
+/**
+ * ***************** LaunchPostKernelForTile ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+OpenCLEvent
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::LaunchPostKernelForTile( const typename GPUInputImage::Pointer & input,
+  const typename GPUOutputImage::Pointer & output,
+  const OutputImageRegionType & chunkRegion,
+  const OpenCLSize & globalWorkSize, const OpenCLEventList & eventList )
+{
+  // Compute the bounding box of the transformed points of this chunk in
+  // input continuous indices, as the minimum and maximum of all work items.
+  std::vector< cl_float > boundingBoxes( 6 * NumberOfBoundingBoxWorkItems );
+  OpenCLEvent boundingBoxEvent = this->m_PostKernelManager->LaunchKernel(
+    this->m_FilterBoundingBoxGPUKernelHandle, eventList,
+    OpenCLSize( NumberOfBoundingBoxWorkItems ) );
+  boundingBoxEvent.WaitForFinished();
+  this->m_BoundingBoxBuffer->SetCPUBufferPointer( &boundingBoxes[ 0 ] );
+  this->m_BoundingBoxBuffer->SetCPUDirtyFlag( true );
+  this->m_BoundingBoxBuffer->UpdateCPUBuffer();
+
+  double minIndex[ InputImageDimension ];
+  double maxIndex[ InputImageDimension ];
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    minIndex[ d ] = std::numeric_limits< double >::max();
+    maxIndex[ d ] = -std::numeric_limits< double >::max();
+    for( std::size_t i = 0; i < NumberOfBoundingBoxWorkItems; ++i )
+    {
+      minIndex[ d ] = std::min( minIndex[ d ], static_cast< double >( boundingBoxes[ 6 * i + d ] ) );
+      maxIndex[ d ] = std::max( maxIndex[ d ], static_cast< double >( boundingBoxes[ 6 * i + 3 + d ] ) );
+    }
+  }
+
+  // Pad the bounding box by the support of the interpolator, and clip it to
+  // the input. If no point maps inside the input, a single pixel is copied,
+  // and the kernel returns the default value everywhere.
+  const GPUBSplineInterpolatorType * gpuBSplineInterpolator
+    = dynamic_cast< const GPUBSplineInterpolatorType * >( this->m_InterpolatorBase );
+  const double radius = this->m_InterpolatorIsBSpline
+    ? gpuBSplineInterpolator->GetSplineOrder() + 1.0 : 1.0;
+
+  const InputImageRegionType inputRegion = input->GetBufferedRegion();
+  InputImageRegionType       tileRegion;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const double regionStart = static_cast< double >( inputRegion.GetIndex( d ) );
+    const double regionEnd   = regionStart + static_cast< double >( inputRegion.GetSize( d ) ) - 1.0;
+    const double start       = std::max( std::floor( minIndex[ d ] ) - radius, regionStart );
+    const double end         = std::min( std::ceil( maxIndex[ d ] ) + radius, regionEnd );
+    if( start <= end )
+    {
+      tileRegion.SetIndex( d, static_cast< IndexValueType >( start ) );
+      tileRegion.SetSize( d, static_cast< SizeValueType >( end - start + 1.0 ) );
+    }
+    else
+    {
+      tileRegion.SetIndex( d, inputRegion.GetIndex( d ) );
+      tileRegion.SetSize( d, 1 );
+    }
+  }
+
+  const std::size_t tileSize = tileRegion.GetNumberOfPixels() * ( this->m_InterpolatorIsBSpline
+    ? sizeof( typename GPUBSplineInterpolatorCoefficientImageType::PixelType )
+    : sizeof( typename InputImageType::PixelType ) );
+  if( tileSize > this->m_PostKernelManager->GetDevice().GetMaximumAllocationSize() )
+  {
+    itkExceptionMacro( << "The input of the output region " << chunkRegion
+                       << " does not fit in the device memory. Increase the number of splits." );
+  }
+
+  // Copy the tile of the input, or of the B-spline coefficients, to the
+  // device, and set it to the post kernel.
+  const std::size_t kernelId = this->m_FilterPostGPUKernelHandle;
+  OpenCLKernel &    postKernel = this->m_PostKernelManager->GetKernel( kernelId );
+  cl_uint           argidx     = 0;
+
+  this->m_PostKernelManager->SetKernelArgWithImage( kernelId, argidx++, this->m_DeformationFieldBuffer );
+  argidx++; // the deformation field size is set by GPUGenerateData()
+
+  if( !this->m_InterpolatorIsBSpline )
+  {
+    this->m_InputTile = CreateGPUImageTile< GPUInputImage >( input.GetPointer(), tileRegion );
+    SetKernelWithITKImage< GPUInputImage >( this->m_PostKernelManager,
+      kernelId, argidx,
+      this->m_InputTile, this->m_TileGPUImageBase,
+      true, true );
+  }
+  else
+  {
+    this->m_CoefficientTile = CreateGPUImageTile< GPUBSplineInterpolatorCoefficientImageType >(
+      gpuBSplineInterpolator->GetGPUCoefficients().GetPointer(), tileRegion );
+    SetKernelWithITKImage< GPUBSplineInterpolatorCoefficientImageType >( this->m_PostKernelManager,
+      kernelId, argidx,
+      this->m_CoefficientTile, this->m_TileGPUImageBase,
+      true, true );
+
+    const cl_uint splineOrder = gpuBSplineInterpolator->GetSplineOrder();
+    this->m_PostKernelManager->SetKernelArg( kernelId, argidx++, sizeof( cl_uint ),
+      (void *)&splineOrder );
+  }
+
+  // The chunk is computed in a device buffer that starts at the chunk, so
+  // the kernel is launched without offset. Wait until the copy of the chunk
+  // before last, from the same buffer, has finished.
+  const std::size_t bufferIndex = this->m_ChunkTransferIndex;
+  this->FinishChunkTransfer( this->m_ChunkTransfers[ bufferIndex ] );
+  this->m_PostKernelManager->SetKernelArgWithImage( kernelId, argidx++,
+    this->m_TileOutputBuffers[ bufferIndex ] );
+  OpenCLKernelToImageBridge< OutputImageType >::SetSize(
+    postKernel, argidx++, chunkRegion.GetSize() );
+
+  this->m_PostKernelManager->SetKernelArgWithImage( kernelId, argidx++, this->m_FilterParameters );
+
+  // The image function of the tile: the interpolator's range of the input,
+  // relative to the tile.
+  const InterpolatorType * interpolator = this->GetInterpolator();
+  GPUImageFunction3D       imageFunction;
+  std::memset( &imageFunction, 0, sizeof( GPUImageFunction3D ) );
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    const double tileStart = static_cast< double >( tileRegion.GetIndex( d ) );
+    imageFunction.start_index.s[ d ]            = 0;
+    imageFunction.end_index.s[ d ]              = static_cast< cl_uint >( tileRegion.GetSize( d ) - 1 );
+    imageFunction.start_continuous_index.s[ d ] = static_cast< cl_float >(
+      interpolator->GetStartContinuousIndex()[ d ] - tileStart );
+    imageFunction.end_continuous_index.s[ d ] = static_cast< cl_float >(
+      interpolator->GetEndContinuousIndex()[ d ] - tileStart );
+  }
+  this->m_TileImageFunction->SetCPUBufferPointer( &imageFunction );
+  this->m_TileImageFunction->SetGPUDirtyFlag( true );
+  this->m_TileImageFunction->UpdateGPUBuffer();
+  this->m_PostKernelManager->SetKernelArgWithImage( kernelId, argidx++, this->m_TileImageFunction );
+
+  // Launch the post kernel and copy the chunk to the output
+  OpenCLEvent postEvent = this->m_PostKernelManager->LaunchKernel(
+    kernelId, eventList, globalWorkSize );
+
+  GPUDataManager::Pointer dataManager = output->GetGPUDataManager();
+  const std::size_t       offset      = output->ComputeOffset( chunkRegion.GetIndex() ) * sizeof( OutputImagePixelType );
+  this->EnqueueBufferTransfer( *( this->m_TileOutputBuffers[ bufferIndex ]->GetGPUBufferPointer() ), 0,
+    static_cast< char * >( dataManager->GetCPUBufferPointer() ) + offset,
+    chunkRegion.GetNumberOfPixels() * sizeof( OutputImagePixelType ), postEvent );
+
+  return postEvent;
+} // end LaunchPostKernelForTile()
+
+
+/**
+ * ***************** GetInputTextureFormat ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+bool
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetInputTextureFormat( OpenCLImageFormat & format ) const
+{
+  const OpenCLImageFormat::ImageType imageType = InputImageDimension == 2
+    ? OpenCLImageFormat::IMAGE2D : OpenCLImageFormat::IMAGE3D;
+  const OpenCLImageFormat::ChannelType channelType = this->m_UseHalfPrecisionTexture
+    ? OpenCLImageFormat::HALF_FLOAT : OpenCLImageFormat::FLOAT;
+  format = OpenCLImageFormat( imageType, OpenCLImageFormat::R, channelType );
+
+  // Single channel float formats are optional for the devices
+  const std::list< OpenCLImageFormat > formats
+    = this->m_PostKernelManager->GetContext()->GetSupportedImageFormats( imageType, CL_MEM_READ_ONLY );
+  for( std::list< OpenCLImageFormat >::const_iterator it = formats.begin();
+    it != formats.end(); ++it )
+  {
+    if( it->GetChannelOrder() == format.GetChannelOrder()
+      && it->GetChannelType() == format.GetChannelType() )
+    {
+      return true;
+    }
+  }
+  return false;
+} // end GetInputTextureFormat()
+
+
+/**
+ * ***************** CreateInputTexture ***********************
+ */
+
+template< typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType >
+void
+GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::CreateInputTexture( const typename GPUInputImage::Pointer & input )
+{
+  OpenCLImageFormat format;
+  this->GetInputTextureFormat( format );
+
+  // The texture has the size of the input buffer
+  const GPUInputImage *                       constInput     = input.GetPointer();
+  const typename GPUInputImage::PixelType *   buffer         = constInput->GetBufferPointer();
+  const InputImageRegionType                  bufferedRegion = constInput->GetBufferedRegion();
+  const std::size_t                           numberOfPixels = bufferedRegion.GetNumberOfPixels();
+  std::size_t                                 size[ 3 ]      = { 1, 1, 1 };
+  for( unsigned int i = 0; i < InputImageDimension; ++i )
+  {
+    size[ i ] = bufferedRegion.GetSize( i );
+  }
+  const OpenCLSize textureSize = InputImageDimension == 2
+    ? OpenCLSize( size[ 0 ], size[ 1 ] ) : OpenCLSize( size[ 0 ], size[ 1 ], size[ 2 ] );
+
+  // Convert the input on the host, and copy it to the texture
+  OpenCLContext * context = this->m_PostKernelManager->GetContext();
+  if( this->m_UseHalfPrecisionTexture )
+  {
+    std::vector< HalfFloat::StorageType > texels( numberOfPixels );
+    for( std::size_t i = 0; i < numberOfPixels; ++i )
+    {
+      texels[ i ] = HalfFloat::FromFloat( static_cast< float >( buffer[ i ] ) );
+    }
+    this->m_InputTexture = context->CreateImageCopy( format, &texels[ 0 ],
+      textureSize, OpenCLMemoryObject::ReadOnly );
+  }
+  else
+  {
+    std::vector< float > texels( numberOfPixels );
+    for( std::size_t i = 0; i < numberOfPixels; ++i )
+    {
+      texels[ i ] = static_cast< float >( buffer[ i ] );
+    }
+    this->m_InputTexture = context->CreateImageCopy( format, &texels[ 0 ],
+      textureSize, OpenCLMemoryObject::ReadOnly );
+  }
+  context->GetProfiler().AddHostToDeviceTransfer( numberOfPixels
+    * ( this->m_UseHalfPrecisionTexture ? sizeof( HalfFloat::StorageType ) : sizeof( float ) ) );
+
+  // The texels are addressed by unnormalized continuous indices
+  this->m_InputTextureSampler = context->CreateSampler(
+    false, OpenCLSampler::ClampToEdge, OpenCLSampler::Linear );
+
+  if( this->m_InputTexture.IsNull() || this->m_InputTextureSampler.IsNull() )
+  {
+    itkExceptionMacro( << "Unable to create the input texture of the hardware interpolation." );
+  }
+} // end CreateInputTexture()
+
+
 /**
  * ***************** PrintSelf ***********************
  */
@@ -1180,6 +1926,12 @@ GPUResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
 {
   CPUSuperclass::PrintSelf( os, indent );
   GPUSuperclass::PrintSelf( os, indent );
+
+  os << indent << "RequestedNumberOfSplits: " << this->m_RequestedNumberOfSplits << std::endl;
+  os << indent << "UseOverlappedTransfers: " << this->m_UseOverlappedTransfers << std::endl;
+  os << indent << "UseTiledExecution: " << this->m_UseTiledExecution << std::endl;
+  os << indent << "UseHardwareInterpolation: " << this->m_UseHardwareInterpolation << std::endl;
+  os << indent << "UseHalfPrecisionTexture: " << this->m_UseHalfPrecisionTexture << std::endl;
 } // end PrintSelf()
 
 
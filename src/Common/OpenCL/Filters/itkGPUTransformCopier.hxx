@@ -41,6 +41,8 @@
 // GPU factory include
 #include "itkGPUImageFactory.h"
 
+#include <algorithm> // For max.
+
 namespace itk
 {
 //------------------------------------------------------------------------------
@@ -67,24 +69,23 @@ GPUTransformCopier< TTypeList, NDimensions, TTransform, TOutputTransformPrecisio
     return;
   }
 
-  // Update only if the input AdvancedCombinationTransform has been modified
-  const ModifiedTimeType t = this->m_InputTransform->GetMTime();
-
-  if( t == this->m_InternalTransformTime )
+  // Update only if the input transform or the copier has been modified,
+  // otherwise the GPU transform and its device buffers are reused.
+  // Setting another input transform modifies the copier.
+  const ModifiedTimeType t = std::max< ModifiedTimeType >( this->m_InputTransform->GetMTime(), this->GetMTime() );
+  if( t <= this->m_InternalTransformTime && this->m_Output.IsNotNull() )
   {
     return; // No need to update
   }
-  else if( t > this->m_InternalTransformTime )
-  {
-    // Cache the timestamp
-    this->m_InternalTransformTime = t;
 
-    // Copy transform
-    const bool copyResult = this->CopyTransform( this->m_InputTransform, this->m_Output );
-    if( !copyResult || this->m_Output.IsNull() )
-    {
-      itkExceptionMacro( << "GPUTransformCopier was unable to copy transform from: " << this->m_InputTransform );
-    }
+  // Cache the timestamp
+  this->m_InternalTransformTime = t;
+
+  // Copy transform
+  const bool copyResult = this->CopyTransform( this->m_InputTransform, this->m_Output );
+  if( !copyResult || this->m_Output.IsNull() )
+  {
+    itkExceptionMacro( << "GPUTransformCopier was unable to copy transform from: " << this->m_InputTransform );
   }
 }
 
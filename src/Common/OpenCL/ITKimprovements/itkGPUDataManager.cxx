@@ -180,12 +180,24 @@ GPUDataManager::UpdateCPUBuffer()
 
     m_Context->ReportError( errid, __FILE__, __LINE__, ITK_LOCATION );
     //m_ContextManager->OpenCLProfile(clEvent, "clEnqueueReadBuffer GPU->CPU");
+    m_Context->GetProfiler().AddDeviceToHostTransfer( m_BufferSize );
 
     m_IsCPUBufferDirty = false;
   }
 }
 
 
+//------------------------------------------------------------------------------
+void
+GPUDataManager::SetCPUBufferUpdated()
+{
+  MutexHolderType holder( m_Mutex );
+
+  m_IsCPUBufferDirty = false;
+  m_IsGPUBufferDirty = false;
+}
+
+
 //------------------------------------------------------------------------------
 void
 GPUDataManager::UpdateGPUBuffer()
@@ -217,6 +229,7 @@ GPUDataManager::UpdateGPUBuffer()
 #endif
     m_Context->ReportError( errid, __FILE__, __LINE__, ITK_LOCATION );
     //m_ContextManager->OpenCLProfile(clEvent, "clEnqueueWriteBuffer CPU->GPU");
+    m_Context->GetProfiler().AddHostToDeviceTransfer( m_BufferSize );
 
     m_IsGPUBufferDirty = false;
   }
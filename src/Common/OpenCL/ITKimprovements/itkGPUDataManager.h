@@ -126,6 +126,10 @@ public:
   /** actual CPU->GPU memory copy takes place here */
   virtual void UpdateGPUBuffer();
 
+  /** Mark CPU and GPU as up-to-date.
+   * Call this function when you copied the GPU data to the CPU yourself */
+  virtual void SetCPUBufferUpdated();
+
   void Allocate();
 
   /** Synchronize CPU and GPU buffers (using dirty flags) */
@@ -88,6 +88,10 @@ public:
   /** actual CPU->GPU memory copy takes place here */
   virtual void UpdateGPUBuffer();
 
+  /** Mark CPU and GPU as up-to-date, and update the time stamps as
+   * UpdateCPUBuffer() does */
+  virtual void SetCPUBufferUpdated();
+
   /** Grafting GPU Image Data */
   virtual void Graft( const GPUImageDataManager * data );
 
@@ -91,6 +91,7 @@ GPUImageDataManager< ImageType >::UpdateCPUBuffer()
 
       m_Context->ReportError( errid, __FILE__, __LINE__, ITK_LOCATION );
       //m_ContextManager->OpenCLProfile(clEvent, "clEnqueueReadBuffer GPU->CPU");
+      m_Context->GetProfiler().AddDeviceToHostTransfer( m_BufferSize );
 
       m_Image->Modified();
       this->SetTimeStamp( m_Image->GetTimeStamp() );
@@ -104,6 +105,29 @@ GPUImageDataManager< ImageType >::UpdateCPUBuffer()
 }
 
 
+//------------------------------------------------------------------------------
+template< typename ImageType >
+void
+GPUImageDataManager< ImageType >::SetCPUBufferUpdated()
+{
+  if( m_Image.IsNull() )
+  {
+    Superclass::SetCPUBufferUpdated();
+    return;
+  }
+
+  m_Mutex.Lock();
+
+  m_Image->Modified();
+  this->SetTimeStamp( m_Image->GetTimeStamp() );
+
+  m_IsCPUBufferDirty = false;
+  m_IsGPUBufferDirty = false;
+
+  m_Mutex.Unlock();
+}
+
+
 //------------------------------------------------------------------------------
 template< typename ImageType >
 void
@@ -145,6 +169,7 @@ GPUImageDataManager< ImageType >::UpdateGPUBuffer()
 #endif
       m_Context->ReportError( errid, __FILE__, __LINE__, ITK_LOCATION );
       //m_ContextManager->OpenCLProfile(clEvent, "clEnqueueWriteBuffer CPU->GPU");
+      m_Context->GetProfiler().AddHostToDeviceTransfer( m_BufferSize );
 
       this->SetTimeStamp( cpu_time_stamp );
 
@@ -93,7 +93,28 @@ GPUImageToImageFilter< TInputImage, TOutputImage, TParentImageFilter >
     // separate threads
     this->BeforeThreadedGenerateData();
 
-    this->GPUGenerateData();
+    // Run on the device with the fewest jobs, so that concurrent filters
+    // are spread over the devices of a multi-device context
+    OpenCLContext::Pointer context = OpenCLContext::GetInstance();
+    const OpenCLDevice     device  = context->AcquireDevice();
+    this->m_GPUKernelManager->SetDevice( device );
+    try
+    {
+      this->GPUGenerateData();
+
+      // The outputs are read on the active queue of the context, which does
+      // not wait for the queue of another device
+      if( this->m_GPUKernelManager->GetDevice() != context->GetDefaultDevice() )
+      {
+        clFinish( this->m_GPUKernelManager->GetCommandQueue().GetQueueId() );
+      }
+    }
+    catch( ... )
+    {
+      context->ReleaseDevice( device );
+      throw;
+    }
+    context->ReleaseDevice( device );
 
     // Update CPU buffer for all outputs
     typedef GPUImage< OutputImagePixelType, OutputImageDimension > GPUOutputImageType;
@@ -21,10 +21,21 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdio>
+#include <iterator>
+#include <map>
 
+#include "itkSimpleFastMutexLock.h"
 #include "itksys/MD5.h"
+#include "itksys/SystemTools.hxx"
 #include "itkOpenCLMacro.h"
 
+// Defined in itkOpenCLProgram.cxx
+namespace OpenCLProgramSupport
+{
+bool GetOpenCLMathAndOptimizationOptions( std::string & options );
+}
+
 namespace itk
 {
 // static variable initialization
@@ -90,6 +101,7 @@ public:
     // Release the command queues for the context.
     command_queue         = OpenCLCommandQueue();
     default_command_queue = OpenCLCommandQueue();
+    device_command_queues.clear();
 
     // Release the context.
     if( is_created )
@@ -107,6 +119,14 @@ public:
   OpenCLCommandQueue default_command_queue;
   OpenCLDevice       default_device;
   cl_int             last_error;
+  std::string        program_cache_directory;
+  OpenCLProfiler     profiler;
+
+  // The default command queues of the other devices, and the number of
+  // jobs scheduled on every device, guarded by the scheduler lock.
+  std::map< cl_device_id, OpenCLCommandQueue > device_command_queues;
+  std::map< cl_device_id, std::size_t >        device_queue_depths;
+  mutable SimpleFastMutexLock                  scheduler_lock;
 };
 
 //------------------------------------------------------------------------------
@@ -579,8 +599,14 @@ OpenCLContext::Release()
   ITK_OPENCL_D( OpenCLContext );
   if( d->is_created )
   {
+    // The pending profiling events must complete before the context is gone
+    d->profiler.Flush();
     d->command_queue         = OpenCLCommandQueue();
     d->default_command_queue = OpenCLCommandQueue();
+    d->scheduler_lock.Lock();
+    d->device_command_queues.clear();
+    d->device_queue_depths.clear();
+    d->scheduler_lock.Unlock();
     clReleaseContext( d->id );
     d->id             = 0;
     d->default_device = OpenCLDevice();
@@ -822,12 +848,15 @@ OpenCLContext::GetDefaultCommandQueue()
     {
       return OpenCLCommandQueue();
     }
-    cl_command_queue queue;
+    cl_command_queue_properties properties = 0;
 #ifdef OPENCL_PROFILING
-    queue = clCreateCommandQueue( d->id, dev.GetDeviceId(), CL_QUEUE_PROFILING_ENABLE, &( d->last_error ) );
-#else
-    queue = clCreateCommandQueue( d->id, dev.GetDeviceId(), 0, &( d->last_error ) );
+    properties = CL_QUEUE_PROFILING_ENABLE;
 #endif
+    if( d->profiler.GetEnabled() )
+    {
+      properties = CL_QUEUE_PROFILING_ENABLE;
+    }
+    cl_command_queue queue = clCreateCommandQueue( d->id, dev.GetDeviceId(), properties, &( d->last_error ) );
 
     if( !queue )
     {
@@ -841,6 +870,99 @@ OpenCLContext::GetDefaultCommandQueue()
 }
 
 
+//------------------------------------------------------------------------------
+OpenCLCommandQueue
+OpenCLContext::GetDefaultCommandQueue( const OpenCLDevice & device )
+{
+  if( device.IsNull() || device == this->GetDefaultDevice() )
+  {
+    return this->GetDefaultCommandQueue();
+  }
+
+  ITK_OPENCL_D( OpenCLContext );
+  d->scheduler_lock.Lock();
+  OpenCLCommandQueue & queue = d->device_command_queues[ device.GetDeviceId() ];
+  if( queue.IsNull() && d->is_created )
+  {
+#ifdef OPENCL_PROFILING
+    queue = this->CreateCommandQueue( CL_QUEUE_PROFILING_ENABLE, device );
+#else
+    queue = this->CreateCommandQueue( d->profiler.GetEnabled() ? CL_QUEUE_PROFILING_ENABLE : 0, device );
+#endif
+  }
+  const OpenCLCommandQueue result = queue;
+  d->scheduler_lock.Unlock();
+
+  return result;
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLDevice
+OpenCLContext::AcquireDevice()
+{
+  ITK_OPENCL_D( OpenCLContext );
+  const std::list< OpenCLDevice > devices = this->GetDevices();
+  if( devices.empty() )
+  {
+    return OpenCLDevice();
+  }
+
+  // Select the first device with the smallest queue depth
+  d->scheduler_lock.Lock();
+  std::list< OpenCLDevice >::const_iterator selected = devices.begin();
+  std::size_t selectedDepth = d->device_queue_depths[ selected->GetDeviceId() ];
+  for( std::list< OpenCLDevice >::const_iterator it = devices.begin(); it != devices.end(); ++it )
+  {
+    const std::size_t depth = d->device_queue_depths[ it->GetDeviceId() ];
+    if( depth < selectedDepth )
+    {
+      selected      = it;
+      selectedDepth = depth;
+    }
+  }
+  ++d->device_queue_depths[ selected->GetDeviceId() ];
+  const OpenCLDevice device = *selected;
+  d->scheduler_lock.Unlock();
+
+  return device;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::ReleaseDevice( const OpenCLDevice & device )
+{
+  if( device.IsNull() )
+  {
+    return;
+  }
+
+  ITK_OPENCL_D( OpenCLContext );
+  d->scheduler_lock.Lock();
+  std::map< cl_device_id, std::size_t >::iterator it = d->device_queue_depths.find( device.GetDeviceId() );
+  if( it != d->device_queue_depths.end() && it->second > 0 )
+  {
+    --it->second;
+  }
+  d->scheduler_lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLContext::GetDeviceQueueDepth( const OpenCLDevice & device ) const
+{
+  ITK_OPENCL_D( const OpenCLContext );
+  d->scheduler_lock.Lock();
+  std::map< cl_device_id, std::size_t >::const_iterator it = d->device_queue_depths.find( device.GetDeviceId() );
+  const std::size_t depth = ( it != d->device_queue_depths.end() ) ? it->second : 0;
+  d->scheduler_lock.Unlock();
+
+  return depth;
+}
+
+
 //------------------------------------------------------------------------------
 // Returns the active queue handle without incurring retain/release overhead.
 cl_command_queue
@@ -1122,9 +1244,9 @@ OpenCLContext::CreateImageCopy( const OpenCLImageFormat & format,
   }
   else if( size.GetDimension() == 3 )
   {
-    clCreateImage3D
-      ( d->id, flags, &( format.m_Format ), size[ 0 ], size[ 1 ], size[ 2 ],
-      0, 0, const_cast< void * >( data ), &( d->last_error ) );
+    mem = clCreateImage3D
+        ( d->id, flags, &( format.m_Format ), size[ 0 ], size[ 1 ], size[ 2 ],
+        0, 0, const_cast< void * >( data ), &( d->last_error ) );
   }
 #endif
 
@@ -1140,6 +1262,44 @@ OpenCLContext::CreateImageCopy( const OpenCLImageFormat & format,
 }
 
 
+//------------------------------------------------------------------------------
+std::string
+GetOpenCLProgramCacheFileName( const std::string & directory,
+  const OpenCLDevice & device,
+  const std::string & sourceCode,
+  const std::string & prefixSourceCode,
+  const std::string & postfixSourceCode,
+  const std::string & extraBuildOptions )
+{
+  // The binary depends on the device, its driver, the source and the options
+  std::string options;
+  OpenCLProgramSupport::GetOpenCLMathAndOptimizationOptions( options );
+
+  std::string key;
+  key.append( device.GetName() ).append( 1, '\0' );
+  key.append( device.GetVendor() ).append( 1, '\0' );
+  key.append( device.GetVersion() ).append( 1, '\0' );
+  key.append( device.GetDriverVersion() ).append( 1, '\0' );
+  key.append( options ).append( 1, '\0' );
+  key.append( extraBuildOptions ).append( 1, '\0' );
+  key.append( prefixSourceCode ).append( 1, '\0' );
+  key.append( sourceCode ).append( 1, '\0' );
+  key.append( postfixSourceCode );
+
+  // Create unique filename based on the key
+  itksysMD5 * md5 = itksysMD5_New();
+  itksysMD5_Initialize( md5 );
+  itksysMD5_Append( md5, (unsigned char *)key.c_str(), key.size() );
+  const std::size_t DigestSize = 32u;
+  char              Digest[ DigestSize ];
+  itksysMD5_FinalizeHex( md5, Digest );
+  const std::string hex( Digest, DigestSize );
+  itksysMD5_Delete( md5 );
+
+  return directory + "/ocl-" + hex + ".bin";
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLProgram
 OpenCLContext::CreateProgramFromSourceCode( const std::string & sourceCode,
@@ -1379,17 +1539,154 @@ OpenCLContext::BuildProgramFromSourceCode( const std::list< OpenCLDevice > & dev
   const std::string & postfixSourceCode,
   const std::string & extraBuildOptions )
 {
+  ITK_OPENCL_D( OpenCLContext );
+
+  // The cached binaries are only used for programs of the default device,
+  // since CreateProgramFromBinaryCode() loads a binary for that device only.
+  const bool useCache = !d->program_cache_directory.empty()
+    && devices.size() == 1
+    && devices.front().GetDeviceId() == this->GetDefaultDevice().GetDeviceId();
+
+  std::string cacheFileName;
+  if( useCache )
+  {
+    cacheFileName = GetOpenCLProgramCacheFileName( d->program_cache_directory,
+      devices.front(), sourceCode, prefixSourceCode, postfixSourceCode,
+      extraBuildOptions );
+
+    OpenCLProgram cachedProgram = this->BuildProgramFromCacheFile( devices,
+      cacheFileName, extraBuildOptions );
+    if( !cachedProgram.IsNull() )
+    {
+      return cachedProgram;
+    }
+  }
+
   OpenCLProgram program = this->CreateProgramFromSourceCode( sourceCode,
     prefixSourceCode, postfixSourceCode );
 
-  if( program.IsNull() || program.Build( devices, extraBuildOptions ) )
+  if( program.IsNull() )
   {
     return program;
   }
+  if( program.Build( devices, extraBuildOptions ) )
+  {
+    if( useCache )
+    {
+      this->WriteProgramToCacheFile( program, cacheFileName );
+    }
+    return program;
+  }
   return OpenCLProgram();
 }
 
 
+//------------------------------------------------------------------------------
+void
+OpenCLContext::SetProgramCacheDirectory( const std::string & directory )
+{
+  ITK_OPENCL_D( OpenCLContext );
+  d->program_cache_directory = directory;
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLContext::GetProgramCacheDirectory() const
+{
+  ITK_OPENCL_D( const OpenCLContext );
+  return d->program_cache_directory;
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLProfiler &
+OpenCLContext::GetProfiler()
+{
+  ITK_OPENCL_D( OpenCLContext );
+  return d->profiler;
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLProgram
+OpenCLContext::BuildProgramFromCacheFile( const std::list< OpenCLDevice > & devices,
+  const std::string & fileName,
+  const std::string & extraBuildOptions )
+{
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if( !file.is_open() )
+  {
+    return OpenCLProgram();
+  }
+
+  const std::vector< unsigned char > binary(
+    ( std::istreambuf_iterator< char >( file ) ), std::istreambuf_iterator< char >() );
+  file.close();
+
+  // A binary still has to be built, which is cheap compared to the
+  // compilation from source. A binary that is not accepted, for example
+  // after a driver update, is removed and built again from source.
+  if( !binary.empty() )
+  {
+    try
+    {
+      OpenCLProgram program = this->CreateProgramFromBinaryCode( &binary[ 0 ], binary.size() );
+      if( !program.IsNull() && program.Build( devices, extraBuildOptions ) )
+      {
+        return program;
+      }
+    }
+    catch( ExceptionObject & )
+    {}
+  }
+
+  itkOpenCLWarningMacro( << "Cannot build OpenCL program from cached binary '"
+                         << fileName << "', building it from source." );
+  itksys::SystemTools::RemoveFile( fileName.c_str() );
+  return OpenCLProgram();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::WriteProgramToCacheFile( const OpenCLProgram & program,
+  const std::string & fileName )
+{
+  const std::vector< unsigned char > binary = program.GetBinary();
+  if( binary.empty() )
+  {
+    return;
+  }
+
+  ITK_OPENCL_D( OpenCLContext );
+  if( !itksys::SystemTools::MakeDirectory( d->program_cache_directory.c_str() ) )
+  {
+    itkOpenCLWarningMacro( << "Cannot create OpenCL program cache directory '"
+                           << d->program_cache_directory << "'." );
+    return;
+  }
+
+  // Write to a temporary file first, so that concurrent processes never
+  // read a partially written binary.
+  const std::string temporaryFileName = fileName + ".tmp";
+  std::ofstream     file( temporaryFileName.c_str(), std::ios::out | std::ios::binary );
+  if( !file.is_open() )
+  {
+    itkOpenCLWarningMacro( << "Cannot create OpenCL program cache file '"
+                           << temporaryFileName << "'." );
+    return;
+  }
+  file.write( reinterpret_cast< const char * >( &binary[ 0 ] ), binary.size() );
+  file.close();
+
+  if( file.fail() || std::rename( temporaryFileName.c_str(), fileName.c_str() ) != 0 )
+  {
+    itksys::SystemTools::RemoveFile( temporaryFileName.c_str() );
+  }
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLProgram
 OpenCLContext::BuildProgramFromSourceFile( const std::string & filename,
@@ -1798,7 +2095,13 @@ OpenCLContext::OpenCLProfile( cl_event clEvent,
 void
 OpenCLContext::SetUpProfiling()
 {
-#ifdef OPENCL_PROFILING
+  ITK_OPENCL_D( OpenCLContext );
+#ifndef OPENCL_PROFILING
+  if( !d->profiler.GetEnabled() )
+  {
+    return;
+  }
+#endif
   OpenCLCommandQueue queue = this->CreateCommandQueue( CL_QUEUE_PROFILING_ENABLE );
 
   if( !queue.IsProfilingEnabled() )
@@ -1810,7 +2113,6 @@ OpenCLContext::SetUpProfiling()
   {
     this->SetCommandQueue( queue );
   }
-#endif
 }
 
 
@@ -29,6 +29,7 @@
 #include "itkOpenCLSampler.h"
 #include "itkOpenCLProgram.h"
 #include "itkOpenCLUserEvent.h"
+#include "itkOpenCLProfiler.h"
 
 namespace itk
 {
@@ -238,6 +239,32 @@ public:
    * \sa GetCommandQueue(), CreateCommandQueue(), GetLastError() */
   OpenCLCommandQueue GetDefaultCommandQueue();
 
+  /** \overload
+   * Returns the default command queue for \a device, which is created once
+   * per device of this context, with the same properties as
+   * GetDefaultCommandQueue(). If \a device is null or the default device,
+   * then GetDefaultCommandQueue() is returned. This method is thread safe.
+   * \sa AcquireDevice() */
+  OpenCLCommandQueue GetDefaultCommandQueue( const OpenCLDevice & device );
+
+  /** Selects the device of this context with the fewest jobs in its queue,
+   * and adds a job to the queue depth of that device. Every call has to be
+   * paired with a call to ReleaseDevice(), when the job has finished.
+   * If the context has a single device, the default device is returned.
+   * This method is thread safe, so that concurrent jobs, for example
+   * resampling several images, are spread over all devices.
+   * \sa ReleaseDevice(), GetDefaultCommandQueue(), OpenCLKernelManager::SetDevice() */
+  OpenCLDevice AcquireDevice();
+
+  /** Removes a job, acquired by AcquireDevice(), from the queue depth
+   * of \a device. This method is thread safe.
+   * \sa AcquireDevice() */
+  void ReleaseDevice( const OpenCLDevice & device );
+
+  /** Returns the number of jobs acquired for \a device, and not yet released.
+   * \sa AcquireDevice(), ReleaseDevice() */
+  std::size_t GetDeviceQueueDepth( const OpenCLDevice & device ) const;
+
   /** Creates a new command queue on this context for \a device with
    * the specified \a properties. If \a device is null, then
    * GetDefaultDevice() will be used instead.
@@ -354,6 +381,14 @@ public:
     const std::string & prefixSourceCode = std::string(),
     const std::string & postfixSourceCode = std::string() );
 
+  /** \overload
+   * Builds the program for \a devices, with extra build compiler options
+   * specified by \a extraBuildOptions. If a program cache directory is set
+   * and \a devices is the default device only, the program binary is loaded
+   * from the cache when it was built before, and stored in the cache after it
+   * is built from source. The cached binaries are keyed on the device, its
+   * driver version, the source code and the build options.
+   * \sa SetProgramCacheDirectory() */
   OpenCLProgram BuildProgramFromSourceCode( const std::list< OpenCLDevice > & devices,
     const std::string & sourceCode,
     const std::string & prefixSourceCode = std::string(),
@@ -374,6 +409,25 @@ public:
     const std::string & postfixSourceCode = std::string(),
     const std::string & extraBuildOptions = std::string() );
 
+  /** Sets the directory in which the binaries of the programs built by
+   * BuildProgramFromSourceCode() are cached between runs. The directory is
+   * created when the first binary is stored. An empty directory, the default,
+   * disables the cache.
+   * \sa GetProgramCacheDirectory() */
+  void SetProgramCacheDirectory( const std::string & directory );
+
+  /** Returns the directory in which the program binaries are cached.
+   * \sa SetProgramCacheDirectory() */
+  std::string GetProgramCacheDirectory() const;
+
+  /** Returns the profiler of the kernel launches and the host/device
+   * transfers. When the profiler is enabled before the context is created,
+   * the command queues of the context are created with
+   * \c{CL_QUEUE_PROFILING_ENABLE}, and the timings of every kernel launch are
+   * aggregated per kernel.
+   * \sa OpenCLProfiler */
+  OpenCLProfiler & GetProfiler();
+
   /** Returns the list of supported image formats for processing
    * images with the specified image type \a image_type and memory \a flags. */
   std::list< OpenCLImageFormat > GetSupportedImageFormats(
@@ -486,6 +540,19 @@ private:
     const OpenCLDevice::DeviceType type,
     OpenCLContextPimpl * d );
 
+  /** \internal
+   * Builds the program for \a devices from the cached binary \a fileName.
+   * Returns a null OpenCLProgram if there is no such binary, or if it could
+   * not be built. */
+  OpenCLProgram BuildProgramFromCacheFile( const std::list< OpenCLDevice > & devices,
+    const std::string & fileName,
+    const std::string & extraBuildOptions );
+
+  /** \internal
+   * Stores the binary of the built \a program as \a fileName. */
+  void WriteProgramToCacheFile( const OpenCLProgram & program,
+    const std::string & fileName );
+
   /** \internal
    */
   void SetUpProfiling();
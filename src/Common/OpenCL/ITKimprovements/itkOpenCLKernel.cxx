@@ -40,7 +40,8 @@ public:
     id( other->id ),
     global_work_offset( other->global_work_offset ),
     global_work_size( other->global_work_size ),
-    local_work_size( other->local_work_size )
+    local_work_size( other->local_work_size ),
+    command_queue( other->command_queue )
   {
     if( id )
     {
@@ -65,6 +66,7 @@ public:
     global_work_offset = other->global_work_offset;
     global_work_size   = other->global_work_size;
     local_work_size    = other->local_work_size;
+    command_queue      = other->command_queue;
 
     if( id != other->id )
     {
@@ -86,6 +88,8 @@ public:
   OpenCLSize      global_work_offset;
   OpenCLSize      global_work_size;
   OpenCLSize      local_work_size;
+
+  OpenCLCommandQueue command_queue;
 };
 
 //------------------------------------------------------------------------------
@@ -163,6 +167,37 @@ OpenCLKernel::GetContext() const
 }
 
 
+//------------------------------------------------------------------------------
+void
+OpenCLKernel::SetCommandQueue( const OpenCLCommandQueue & queue )
+{
+  ITK_OPENCL_D( OpenCLKernel );
+  d->command_queue = queue;
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLCommandQueue
+OpenCLKernel::GetCommandQueue() const
+{
+  ITK_OPENCL_D( const OpenCLKernel );
+  return d->command_queue;
+}
+
+
+//------------------------------------------------------------------------------
+cl_command_queue
+OpenCLKernel::GetLaunchQueue() const
+{
+  ITK_OPENCL_D( const OpenCLKernel );
+  if( !d->command_queue.IsNull() )
+  {
+    return d->command_queue.GetQueueId();
+  }
+  return d->context->GetActiveQueue();
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLProgram
 OpenCLKernel::GetProgram() const
@@ -1333,12 +1368,12 @@ OpenCLKernel::LaunchKernel()
 
   if( gwoNull && lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, NULL, d->global_work_size.GetSizes(), NULL, 0, 0, &event );
   }
   else if( gwoNull && !lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, NULL, d->global_work_size.GetSizes(),
       ( d->local_work_size.GetWidth() ? d->local_work_size.GetSizes() : 0 ),
 
@@ -1346,13 +1381,13 @@ OpenCLKernel::LaunchKernel()
   }
   else if( !gwoNull && lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, d->global_work_offset.GetSizes(), d->global_work_size.GetSizes(),
       NULL, 0, 0, &event );
   }
   else
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, d->global_work_offset.GetSizes(), d->global_work_size.GetSizes(),
       ( d->local_work_size.GetWidth() ? d->local_work_size.GetSizes() : 0 ),
       0, 0, &event );
@@ -1371,7 +1406,12 @@ OpenCLKernel::LaunchKernel()
     const std::string profileStr = "clEnqueueNDRangeKernel: " + this->GetName();
     d->context->OpenCLProfile( event, profileStr );
 #endif
-    return OpenCLEvent( event );
+    const OpenCLEvent launchEvent( event );
+    if( d->context->GetProfiler().GetEnabled() )
+    {
+      d->context->GetProfiler().AddKernelEvent( this->GetName(), launchEvent );
+    }
+    return launchEvent;
   }
 }
 
@@ -1404,27 +1444,27 @@ OpenCLKernel::LaunchKernel( const OpenCLEventList & event_list )
 
   if( gwoNull && lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, NULL, d->global_work_size.GetSizes(), NULL,
       event_list.GetSize(), event_list.GetEventData(), &event );
   }
   else if( gwoNull && !lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, NULL, d->global_work_size.GetSizes(),
       ( d->local_work_size.GetWidth() ? d->local_work_size.GetSizes() : 0 ),
       event_list.GetSize(), event_list.GetEventData(), &event );
   }
   else if( !gwoNull && lwsNull )
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, d->global_work_offset.GetSizes(), d->global_work_size.GetSizes(),
       NULL,
       event_list.GetSize(), event_list.GetEventData(), &event );
   }
   else
   {
-    error = clEnqueueNDRangeKernel( d->context->GetActiveQueue(), this->m_KernelId,
+    error = clEnqueueNDRangeKernel( this->GetLaunchQueue(), this->m_KernelId,
       work_dim, d->global_work_offset.GetSizes(), d->global_work_size.GetSizes(),
       ( d->local_work_size.GetWidth() ? d->local_work_size.GetSizes() : 0 ),
       event_list.GetSize(), event_list.GetEventData(), &event );
@@ -1443,7 +1483,12 @@ OpenCLKernel::LaunchKernel( const OpenCLEventList & event_list )
     const std::string profileStr = "clEnqueueNDRangeKernel: " + this->GetName();
     d->context->OpenCLProfile( event, profileStr );
 #endif
-    return OpenCLEvent( event );
+    const OpenCLEvent launchEvent( event );
+    if( d->context->GetProfiler().GetEnabled() )
+    {
+      d->context->GetProfiler().AddKernelEvent( this->GetName(), launchEvent );
+    }
+    return launchEvent;
   }
 }
 
@@ -1473,7 +1518,7 @@ OpenCLKernel::LaunchTask( const OpenCLEventList & event_list )
 
   ITK_OPENCL_D( const OpenCLKernel );
   cl_event     event;
-  const cl_int error = clEnqueueTask( d->context->GetActiveQueue(), this->m_KernelId,
+  const cl_int error = clEnqueueTask( this->GetLaunchQueue(), this->m_KernelId,
     0, 0, &event );
 
   this->GetContext()->ReportError( error, __FILE__, __LINE__, ITK_LOCATION );
@@ -1501,7 +1546,7 @@ OpenCLKernel::LaunchTaskAsync( const OpenCLEventList & event_list )
 
   ITK_OPENCL_D( const OpenCLKernel );
   cl_event     event;
-  const cl_int error = clEnqueueTask( d->context->GetActiveQueue(), this->m_KernelId,
+  const cl_int error = clEnqueueTask( this->GetLaunchQueue(), this->m_KernelId,
     0, 0, &event );
 
   this->GetContext()->ReportError( error, __FILE__, __LINE__, ITK_LOCATION );
@@ -21,6 +21,7 @@
 #include "itkOpenCL.h"
 #include "itkOpenCLGlobal.h"
 #include "itkOpenCLEvent.h"
+#include "itkOpenCLCommandQueue.h"
 #include "itkOpenCLSize.h"
 #include "itkOpenCLMemoryObject.h"
 #include "itkOpenCLSampler.h"
@@ -172,6 +173,17 @@ public:
   /** Returns the OpenCL program that this kernel is associated with. */
   OpenCLProgram GetProgram() const;
 
+  /** Sets the command \a queue on which this kernel is launched, for example
+   * the queue of another device of a multi-device context. If \a queue is
+   * null, the default, the kernel is launched on the active command queue
+   * of GetContext().
+   * \sa GetCommandQueue(), OpenCLContext::GetDefaultCommandQueue() */
+  void SetCommandQueue( const OpenCLCommandQueue & queue );
+
+  /** Returns the command queue set by SetCommandQueue(), which is null if
+   * the kernel is launched on the active command queue of GetContext(). */
+  OpenCLCommandQueue GetCommandQueue() const;
+
   /** Returns the name of this OpenCL kernel's entry point function. */
   std::string GetName() const;
 
@@ -726,6 +738,10 @@ private:
   cl_kernel                          m_KernelId;
   bool                               m_DoubleAsFloat;
 
+  /** Returns the queue on which the kernel is launched, which is the
+   * queue set by SetCommandQueue() or the active queue of the context. */
+  cl_command_queue GetLaunchQueue() const;
+
   ITK_OPENCL_DECLARE_PRIVATE( OpenCLKernel )
 };
 
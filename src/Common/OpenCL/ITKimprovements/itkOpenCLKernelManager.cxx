@@ -56,6 +56,52 @@ OpenCLKernelManager::GetKernel( const std::size_t kernelId )
 }
 
 
+//------------------------------------------------------------------------------
+void
+OpenCLKernelManager::SetDevice( const OpenCLDevice & device )
+{
+  if( device.IsNull() || device == this->m_Context->GetDefaultDevice() )
+  {
+    this->m_Device       = OpenCLDevice();
+    this->m_CommandQueue = OpenCLCommandQueue();
+  }
+  else
+  {
+    this->m_Device       = device;
+    this->m_CommandQueue = this->m_Context->GetDefaultCommandQueue( device );
+  }
+
+  for( std::size_t i = 0; i < this->m_Kernels.size(); ++i )
+  {
+    this->m_Kernels[ i ].SetCommandQueue( this->m_CommandQueue );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLDevice
+OpenCLKernelManager::GetDevice() const
+{
+  if( this->m_Device.IsNull() )
+  {
+    return this->m_Context->GetDefaultDevice();
+  }
+  return this->m_Device;
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLCommandQueue
+OpenCLKernelManager::GetCommandQueue() const
+{
+  if( this->m_CommandQueue.IsNull() )
+  {
+    return this->m_Context->GetCommandQueue();
+  }
+  return this->m_CommandQueue;
+}
+
+
 //------------------------------------------------------------------------------
 std::size_t
 OpenCLKernelManager::CreateKernel( const OpenCLProgram & program,
@@ -81,7 +127,8 @@ OpenCLKernelManager::CreateKernel( const OpenCLProgram & program,
     return createResult;
   }
 
-  // Add kernel to container
+  // Add kernel to container, launched on the queue of the device
+  kernel.SetCommandQueue( this->m_CommandQueue );
   this->m_Kernels.push_back( kernel );
 
   // Add arguments list
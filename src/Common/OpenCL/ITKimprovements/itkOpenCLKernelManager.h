@@ -86,6 +86,23 @@ public:
   /** Returns the . */
   OpenCLKernel & GetKernel( const std::size_t kernelId );
 
+  /** Sets the device on which the kernels of this manager are launched.
+   * The kernels are launched on the default command queue of \a device,
+   * see OpenCLContext::GetDefaultCommandQueue(). If \a device is null or
+   * the default device of the context, the kernels are launched on the
+   * active command queue of the context.
+   * \sa GetDevice(), OpenCLContext::AcquireDevice() */
+  void SetDevice( const OpenCLDevice & device );
+
+  /** Returns the device on which the kernels of this manager are launched,
+   * which is the default device of the context if no device has been set. */
+  OpenCLDevice GetDevice() const;
+
+  /** Returns the command queue on which the kernels of this manager are
+   * launched. Use it to enqueue commands that belong to the kernels, for
+   * example memory transfers or a clFinish(). */
+  OpenCLCommandQueue GetCommandQueue() const;
+
   OpenCLEvent LaunchKernel( const std::size_t kernelId );
 
   OpenCLEvent LaunchKernel( const std::size_t kernelId,
@@ -147,7 +164,9 @@ private:
   OpenCLKernelManager( const Self & );   // purposely not implemented
   void operator=( const Self & );        // purposely not implemented
 
-  OpenCLContext * m_Context;
+  OpenCLContext *    m_Context;
+  OpenCLDevice       m_Device;
+  OpenCLCommandQueue m_CommandQueue;
 
   struct KernelArgumentList
   {
@@ -0,0 +1,278 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkOpenCLProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+// The number of pending events above which the completed ones are aggregated
+const std::size_t PendingEventsThreshold = 64;
+}
+
+namespace itk
+{
+OpenCLProfiler::OpenCLProfiler() :
+  m_Enabled( false ),
+  m_NumberOfHostToDeviceTransfers( 0 ),
+  m_HostToDeviceBytes( 0 ),
+  m_NumberOfDeviceToHostTransfers( 0 ),
+  m_DeviceToHostBytes( 0 )
+{}
+
+//------------------------------------------------------------------------------
+OpenCLProfiler::~OpenCLProfiler()
+{}
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::SetEnabled( const bool enabled )
+{
+  this->m_Lock.Lock();
+  this->m_Enabled = enabled;
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::AddKernelEvent( const std::string & kernelName,
+  const OpenCLEvent & event )
+{
+  if( !this->m_Enabled || event.IsNull() )
+  {
+    return;
+  }
+
+  this->m_Lock.Lock();
+  this->m_PendingEvents.push_back( PendingEventType( kernelName, event ) );
+  if( this->m_PendingEvents.size() >= PendingEventsThreshold )
+  {
+    this->AggregatePendingEvents( false );
+  }
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::AddHostToDeviceTransfer( const std::size_t size )
+{
+  if( !this->m_Enabled )
+  {
+    return;
+  }
+
+  this->m_Lock.Lock();
+  ++this->m_NumberOfHostToDeviceTransfers;
+  this->m_HostToDeviceBytes += size;
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::AddDeviceToHostTransfer( const std::size_t size )
+{
+  if( !this->m_Enabled )
+  {
+    return;
+  }
+
+  this->m_Lock.Lock();
+  ++this->m_NumberOfDeviceToHostTransfers;
+  this->m_DeviceToHostBytes += size;
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLProfiler::KernelStatisticsMapType
+OpenCLProfiler::GetKernelStatistics()
+{
+  this->m_Lock.Lock();
+  this->AggregatePendingEvents( true );
+  const KernelStatisticsMapType statistics = this->m_KernelStatistics;
+  this->m_Lock.Unlock();
+
+  return statistics;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLProfiler::GetNumberOfHostToDeviceTransfers() const
+{
+  this->m_Lock.Lock();
+  const std::size_t number = this->m_NumberOfHostToDeviceTransfers;
+  this->m_Lock.Unlock();
+  return number;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLProfiler::GetHostToDeviceBytes() const
+{
+  this->m_Lock.Lock();
+  const std::size_t bytes = this->m_HostToDeviceBytes;
+  this->m_Lock.Unlock();
+  return bytes;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLProfiler::GetNumberOfDeviceToHostTransfers() const
+{
+  this->m_Lock.Lock();
+  const std::size_t number = this->m_NumberOfDeviceToHostTransfers;
+  this->m_Lock.Unlock();
+  return number;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLProfiler::GetDeviceToHostBytes() const
+{
+  this->m_Lock.Lock();
+  const std::size_t bytes = this->m_DeviceToHostBytes;
+  this->m_Lock.Unlock();
+  return bytes;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::Flush()
+{
+  this->m_Lock.Lock();
+  this->AggregatePendingEvents( true );
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::Reset()
+{
+  this->m_Lock.Lock();
+  this->m_PendingEvents.clear();
+  this->m_KernelStatistics.clear();
+  this->m_NumberOfHostToDeviceTransfers = 0;
+  this->m_HostToDeviceBytes             = 0;
+  this->m_NumberOfDeviceToHostTransfers = 0;
+  this->m_DeviceToHostBytes             = 0;
+  this->m_Lock.Unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::Print( std::ostream & os )
+{
+  const KernelStatisticsMapType statistics = this->GetKernelStatistics();
+  const double                  megaByte   = 1024.0 * 1024.0;
+
+  os << "OpenCL profiling:" << std::endl;
+  if( statistics.empty() )
+  {
+    os << "  No kernels were launched." << std::endl;
+  }
+  else
+  {
+    os << "  kernel\tlaunches\tqueued (ms)\tsubmitted (ms)\trunning (ms)\tmax running (ms)" << std::endl;
+  }
+
+  const std::streamsize precision = os.precision();
+  os << std::fixed << std::setprecision( 3 );
+  for( KernelStatisticsMapType::const_iterator it = statistics.begin();
+    it != statistics.end(); ++it )
+  {
+    const KernelStatistics & s = it->second;
+    os << "  " << it->first << "\t" << s.NumberOfLaunches
+       << "\t" << s.QueuedTime << "\t" << s.SubmittedTime
+       << "\t" << s.RunningTime << "\t" << s.MaximumRunningTime;
+    if( s.NumberOfProfiledLaunches < s.NumberOfLaunches )
+    {
+      os << "\t(" << s.NumberOfLaunches - s.NumberOfProfiledLaunches << " launches without profiling information)";
+    }
+    os << std::endl;
+  }
+
+  this->m_Lock.Lock();
+  os << "  host to device: " << this->m_NumberOfHostToDeviceTransfers << " transfers, "
+     << this->m_HostToDeviceBytes / megaByte << " MB" << std::endl;
+  os << "  device to host: " << this->m_NumberOfDeviceToHostTransfers << " transfers, "
+     << this->m_DeviceToHostBytes / megaByte << " MB" << std::endl;
+  this->m_Lock.Unlock();
+
+  os.unsetf( std::ios_base::floatfield );
+  os.precision( precision );
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProfiler::AggregatePendingEvents( const bool wait )
+{
+  std::vector< PendingEventType > stillPending;
+  for( std::vector< PendingEventType >::iterator it = this->m_PendingEvents.begin();
+    it != this->m_PendingEvents.end(); ++it )
+  {
+    OpenCLEvent & event  = it->second;
+    cl_int        status = event.GetStatus();
+    if( wait && status > CL_COMPLETE )
+    {
+      event.WaitForFinished();
+      status = event.GetStatus();
+    }
+    if( status > CL_COMPLETE )
+    {
+      stillPending.push_back( *it );
+      continue;
+    }
+
+    KernelStatistics & statistics = this->m_KernelStatistics[ it->first ];
+    ++statistics.NumberOfLaunches;
+
+    // Failed commands, and queues without profiling, give no timings
+    const cl_ulong queued    = event.GetQueueTime();
+    const cl_ulong submitted = event.GetSubmitTime();
+    const cl_ulong started   = event.GetRunTime();
+    const cl_ulong finished  = event.GetFinishTime();
+    if( status != CL_COMPLETE || finished == 0 || started == 0 )
+    {
+      continue;
+    }
+
+    const double nanoToMilli = 1.0e-6;
+    const double running     = ( finished - started ) * nanoToMilli;
+    ++statistics.NumberOfProfiledLaunches;
+    statistics.QueuedTime        += ( submitted - queued ) * nanoToMilli;
+    statistics.SubmittedTime     += ( started - submitted ) * nanoToMilli;
+    statistics.RunningTime       += running;
+    statistics.MaximumRunningTime = std::max( statistics.MaximumRunningTime, running );
+  }
+  this->m_PendingEvents.swap( stillPending );
+}
+
+
+} // end namespace itk
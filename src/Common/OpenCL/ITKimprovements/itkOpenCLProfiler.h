@@ -0,0 +1,145 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkOpenCLProfiler_h
+#define __itkOpenCLProfiler_h
+
+#include "itkOpenCLExport.h"
+#include "itkOpenCLEvent.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class OpenCLProfiler
+ * \brief Aggregates the profiling information of the OpenCL kernel launches
+ * and the host/device transfers during a run.
+ *
+ * When enabled, the OpenCLContext creates its command queues with
+ * \c{CL_QUEUE_PROFILING_ENABLE}, every OpenCLKernel launch adds its event,
+ * and the GPU data managers add the sizes of their transfers. The events
+ * are only queried when they have completed, so recording does not add
+ * synchronization points to the launches. The statistics are aggregated
+ * per kernel name.
+ *
+ * The profiler is owned by the OpenCLContext, see OpenCLContext::GetProfiler().
+ * All methods are thread safe.
+ *
+ * \ingroup OpenCL
+ * \sa OpenCLContext, OpenCLEvent
+ */
+class ITKOpenCL_EXPORT OpenCLProfiler
+{
+public:
+
+  /** The statistics of one kernel, the times are in milliseconds. */
+  struct KernelStatistics
+  {
+    KernelStatistics() :
+      NumberOfLaunches( 0 ),
+      NumberOfProfiledLaunches( 0 ),
+      QueuedTime( 0.0 ),
+      SubmittedTime( 0.0 ),
+      RunningTime( 0.0 ),
+      MaximumRunningTime( 0.0 )
+    {}
+
+    /** The number of launches, and the number of launches of which the
+     * profiling information was available. */
+    std::size_t NumberOfLaunches;
+    std::size_t NumberOfProfiledLaunches;
+
+    /** The total time from queueing to submission, from submission to the
+     * start of the execution, and of the execution itself. */
+    double QueuedTime;
+    double SubmittedTime;
+    double RunningTime;
+    double MaximumRunningTime;
+  };
+
+  typedef std::map< std::string, KernelStatistics > KernelStatisticsMapType;
+
+  /** Constructor, the profiler is disabled by default. */
+  OpenCLProfiler();
+
+  /** Destructor. */
+  ~OpenCLProfiler();
+
+  /** Enable or disable the profiling. Enable it before the OpenCLContext is
+   * created, otherwise its command queues do not provide profiling information. */
+  void SetEnabled( const bool enabled );
+
+  bool GetEnabled() const { return this->m_Enabled; }
+
+  /** Adds the \a event of a launch of the kernel \a kernelName. */
+  void AddKernelEvent( const std::string & kernelName, const OpenCLEvent & event );
+
+  /** Adds a transfer of \a size bytes from the host to the device. */
+  void AddHostToDeviceTransfer( const std::size_t size );
+
+  /** Adds a transfer of \a size bytes from the device to the host. */
+  void AddDeviceToHostTransfer( const std::size_t size );
+
+  /** Returns the statistics per kernel, after waiting for the pending events. */
+  KernelStatisticsMapType GetKernelStatistics();
+
+  /** Returns the number of transfers and the transferred bytes. */
+  std::size_t GetNumberOfHostToDeviceTransfers() const;
+
+  std::size_t GetHostToDeviceBytes() const;
+
+  std::size_t GetNumberOfDeviceToHostTransfers() const;
+
+  std::size_t GetDeviceToHostBytes() const;
+
+  /** Waits for the pending events and aggregates them. Called by the
+   * OpenCLContext before it is released. */
+  void Flush();
+
+  /** Clears all statistics. */
+  void Reset();
+
+  /** Prints the statistics per kernel and the transfer volumes. */
+  void Print( std::ostream & os );
+
+private:
+
+  OpenCLProfiler( const OpenCLProfiler & ); // purposely not implemented
+  void operator=( const OpenCLProfiler & ); // purposely not implemented
+
+  typedef std::pair< std::string, OpenCLEvent > PendingEventType;
+
+  /** Aggregates the completed pending events, or all of them if \a wait
+   * is true. Assumes the lock is held. */
+  void AggregatePendingEvents( const bool wait );
+
+  bool                            m_Enabled;
+  std::vector< PendingEventType > m_PendingEvents;
+  KernelStatisticsMapType         m_KernelStatistics;
+  std::size_t                     m_NumberOfHostToDeviceTransfers;
+  std::size_t                     m_HostToDeviceBytes;
+  std::size_t                     m_NumberOfDeviceToHostTransfers;
+  std::size_t                     m_DeviceToHostBytes;
+  mutable SimpleFastMutexLock     m_Lock;
+};
+
+} // end namespace itk
+
+#endif // __itkOpenCLProfiler_h
@@ -394,6 +394,37 @@ std::list< OpenCLDevice > OpenCLProgram::GetDevices() const
 }
 
 
+//------------------------------------------------------------------------------
+std::vector< unsigned char >
+OpenCLProgram::GetBinary() const
+{
+  std::vector< unsigned char > binary;
+  cl_uint                      numberOfDevices = 0;
+
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_NUM_DEVICES,
+    sizeof( numberOfDevices ), &numberOfDevices, 0 ) != CL_SUCCESS || numberOfDevices != 1 )
+  {
+    return binary;
+  }
+
+  std::size_t size = 0;
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_BINARY_SIZES,
+    sizeof( size ), &size, 0 ) != CL_SUCCESS || size == 0 )
+  {
+    return binary;
+  }
+
+  binary.resize( size );
+  unsigned char * buffer = &binary[ 0 ];
+  if( clGetProgramInfo( this->m_Id, CL_PROGRAM_BINARIES,
+    sizeof( buffer ), &buffer, 0 ) != CL_SUCCESS )
+  {
+    binary.clear();
+  }
+  return binary;
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLKernel
 OpenCLProgram::CreateKernel( const std::string & name ) const
@@ -22,6 +22,7 @@
 #include "itkOpenCLKernel.h"
 
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -101,6 +102,13 @@ public:
    * \sa GetBinaries() */
   std::list< OpenCLDevice > GetDevices() const;
 
+  /** Returns the binary of this program, if it was built for a single
+   * device. Returns an empty vector otherwise, or if the binary could not be
+   * queried. The binary can be loaded by
+   * OpenCLContext::CreateProgramFromBinaryCode().
+   * \sa Build(), GetDevices() */
+  std::vector< unsigned char > GetBinary() const;
+
   /** Creates a kernel for the entry point associated with \a name
    * in this program.
    * \sa Build() */
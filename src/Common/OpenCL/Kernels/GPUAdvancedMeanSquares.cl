@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the value computation of
+// itk::AdvancedMeanSquaresImageToImageMetric, for a B-spline transform and
+// a linearly interpolated moving image.
+//
+// AdvancedMeanSquaresValue maps the samples, evaluates the moving image
+// value and gradient, and sums the squared differences and the number of
+// valid samples of each work group. The derivative, a sum over the samples
+// of 2 ( M - F ) dM/dx dT/dmu, is then computed by
+// ImageToImageMetricLinearDerivative.
+//
+// Requires GPUMath.cl, GPUImageBase.cl, GPUBSplineTransform.cl and
+// GPUImageToImageMetric.cl.
+
+//------------------------------------------------------------------------------
+// Sum the squared differences of the samples of each work group. The moving
+// image values and gradients are stored for the derivative kernel, with a
+// zero gradient for the invalid samples. The derivative buffer is cleared
+// here as well.
+#ifdef DIM_3
+__kernel void AdvancedMeanSquaresValue(
+  __global const float4 *samples,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant GPUImageBase3D *moving_image_base,
+  __global const float *coefficients,
+  __constant GPUImageBase3D *coefficients_image_base,
+  const uint spline_order,
+  const float4 moving_image_derivative_scales,
+  __global float4 *moving_values_and_gradients,
+  __local float *local_sums,
+  __global float *partial_measures,
+  __global uint *partial_counts,
+  __global float *derivative,
+  const uint number_of_parameters )
+{
+  __local uint local_count;
+
+  const uint local_id = get_local_id( 0 );
+  const uint global_id = get_global_id( 0 );
+  const uint global_size = get_global_size( 0 );
+
+  if( local_id == 0 ) { local_count = 0; }
+
+  for( uint i = global_id; i < number_of_parameters; i += global_size )
+  {
+    derivative[ i ] = 0.0f;
+  }
+
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  float measure = 0.0f;
+  uint count = 0;
+  for( uint s = global_id; s < number_of_samples; s += global_size )
+  {
+    const float4 sample = samples[ s ];
+    float4 value_and_gradient = (float4)( 0.0f, 0.0f, 0.0f, 0.0f );
+
+    float moving_value;
+    float3 gradient;
+    if( metric_evaluate_sample_3d( sample.xyz, spline_order,
+      coefficients_image_base, coefficients, moving_image, moving_image_base,
+      &moving_value, &gradient ) )
+    {
+      const float diff = moving_value - sample.w;
+      measure = mad( diff, diff, measure );
+      ++count;
+
+      value_and_gradient = (float4)( moving_value,
+        gradient * moving_image_derivative_scales.xyz );
+    }
+
+    moving_values_and_gradients[ s ] = value_and_gradient;
+  }
+
+  if( count > 0 ) { atomic_add( &local_count, count ); }
+  const float group_measure = reduce_local_float( measure, local_sums );
+
+  if( local_id == 0 )
+  {
+    const uint group_id = get_group_id( 0 );
+    partial_measures[ group_id ] = group_measure;
+    partial_counts[ group_id ] = local_count;
+  }
+}
+#endif // DIM_3
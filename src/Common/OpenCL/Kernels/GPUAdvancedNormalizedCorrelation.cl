@@ -0,0 +1,120 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the value computation of
+// itk::AdvancedNormalizedCorrelationImageToImageMetric, for a B-spline
+// transform and a linearly interpolated moving image.
+//
+// AdvancedNormalizedCorrelationSums maps the samples, evaluates the moving
+// image value and gradient, and computes the sums sf, sm, sff, smm and sfm
+// of the shifted sample values of each work group. The shifts are the means
+// of the previous evaluation, which keeps the sums small in single
+// precision. Given these sums, the derivative is a sum over the samples of
+// a linear function of the fixed and moving image values times the image
+// Jacobian, which is computed by ImageToImageMetricLinearDerivative.
+//
+// Requires GPUMath.cl, GPUImageBase.cl, GPUBSplineTransform.cl and
+// GPUImageToImageMetric.cl.
+
+//------------------------------------------------------------------------------
+// Compute the sums of the samples of each work group, stored as sf, sm,
+// sff, smm, sfm per group. The moving image values and gradients are stored
+// for the derivative kernel, with a zero gradient for the invalid samples.
+// The derivative buffer is cleared here as well.
+#ifdef DIM_3
+__kernel void AdvancedNormalizedCorrelationSums(
+  __global const float4 *samples,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant GPUImageBase3D *moving_image_base,
+  __global const float *coefficients,
+  __constant GPUImageBase3D *coefficients_image_base,
+  const uint spline_order,
+  const float4 moving_image_derivative_scales,
+  __global float4 *moving_values_and_gradients,
+  __local float *local_sums,
+  __global float *partial_sums,
+  __global uint *partial_counts,
+  __global float *derivative,
+  const uint number_of_parameters,
+  const float fixed_shift,
+  const float moving_shift )
+{
+  __local uint local_count;
+
+  const uint local_id = get_local_id( 0 );
+  const uint global_id = get_global_id( 0 );
+  const uint global_size = get_global_size( 0 );
+
+  if( local_id == 0 ) { local_count = 0; }
+
+  for( uint i = global_id; i < number_of_parameters; i += global_size )
+  {
+    derivative[ i ] = 0.0f;
+  }
+
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  float sf = 0.0f, sm = 0.0f, sff = 0.0f, smm = 0.0f, sfm = 0.0f;
+  uint count = 0;
+  for( uint s = global_id; s < number_of_samples; s += global_size )
+  {
+    const float4 sample = samples[ s ];
+    float4 value_and_gradient = (float4)( 0.0f, 0.0f, 0.0f, 0.0f );
+
+    float moving_value;
+    float3 gradient;
+    if( metric_evaluate_sample_3d( sample.xyz, spline_order,
+      coefficients_image_base, coefficients, moving_image, moving_image_base,
+      &moving_value, &gradient ) )
+    {
+      const float f = sample.w - fixed_shift;
+      const float m = moving_value - moving_shift;
+      sf += f;
+      sm += m;
+      sff = mad( f, f, sff );
+      smm = mad( m, m, smm );
+      sfm = mad( f, m, sfm );
+      ++count;
+
+      value_and_gradient = (float4)( moving_value,
+        gradient * moving_image_derivative_scales.xyz );
+    }
+
+    moving_values_and_gradients[ s ] = value_and_gradient;
+  }
+
+  if( count > 0 ) { atomic_add( &local_count, count ); }
+  const float group_sf = reduce_local_float( sf, local_sums );
+  const float group_sm = reduce_local_float( sm, local_sums );
+  const float group_sff = reduce_local_float( sff, local_sums );
+  const float group_smm = reduce_local_float( smm, local_sums );
+  const float group_sfm = reduce_local_float( sfm, local_sums );
+
+  if( local_id == 0 )
+  {
+    const uint group_id = get_group_id( 0 );
+    partial_sums[ 5 * group_id ] = group_sf;
+    partial_sums[ 5 * group_id + 1 ] = group_sm;
+    partial_sums[ 5 * group_id + 2 ] = group_sff;
+    partial_sums[ 5 * group_id + 3 ] = group_smm;
+    partial_sums[ 5 * group_id + 4 ] = group_sfm;
+    partial_counts[ group_id ] = local_count;
+  }
+}
+#endif // DIM_3
@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of itk::AdvancedRayCastInterpolateImageFunction
+//
+// Every work item casts one ray from a point towards the (transformed)
+// focal point, through the input volume, and integrates the bilinearly
+// interpolated intensities above the threshold on each plane of voxels
+// traversed. The traversal follows the CPU implementation: the volume is
+// centred on the origin, the ray steps one voxel plane at a time along the
+// axis in which it crosses the most planes, and the integral is scaled by
+// the distance between the ray points.
+
+//------------------------------------------------------------------------------
+// Definition of GPURayCastImageFunction 3D
+#ifdef DIM_3
+typedef struct {
+  float3 focal_point;
+  float  threshold;
+} GPURayCastImageFunction3D;
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Get the intensity of the voxel (x,y,z) of the input volume
+#ifdef DIM_3
+float raycast_get_voxel_3d(
+  const int x, const int y, const int z,
+  __global const INPIXELTYPE *in,
+  const uint3 size )
+{
+  const uint idx = mad24( size.x, mad24( (uint)z, size.y, (uint)y ), (uint)x );
+  return (float)( in[ idx ] );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Check that the four voxels around a ray point lie inside the volume.
+// The ray point has no neighbour in the traversal direction a.
+#ifdef DIM_3
+bool raycast_is_inside_3d(
+  const float *position,
+  const int a,
+  const uint3 size )
+{
+  const int n[ 3 ] = { (int)size.x, (int)size.y, (int)size.z };
+  for( int i = 0; i < 3; i++ )
+  {
+    const int index = (int)( floor( position[ i ] ) );
+    const int next = ( i == a ) ? index : index + 1;
+    if( index < 0 ) return false;
+    if( next >= n[ i ] ) return false;
+  }
+  return true;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+#ifdef DIM_3
+float raycast_integrate_above_threshold_3d(
+  const float3 point,
+  const float3 focal_point,
+  const float threshold,
+  __global const INPIXELTYPE *in,
+  const uint3 size,
+  const float3 spacing )
+{
+  // The CPU implementation translates the centre of the volume to the origin
+  const float3 extent = spacing * convert_float3( size );
+  const float3 ray_position = point + 0.5f * extent;
+  const float3 ray_direction = focal_point - point;
+
+  const float p[ 3 ] = { ray_position.x, ray_position.y, ray_position.z };
+  const float d[ 3 ] = { ray_direction.x, ray_direction.y, ray_direction.z };
+  const float e[ 3 ] = { extent.x, extent.y, extent.z };
+  const float s[ 3 ] = { spacing.x, spacing.y, spacing.z };
+
+  // Intersect the line with the bounding box of the volume. Like on the
+  // CPU, the ray is considered parallel to a side if the component of the
+  // direction normal to it is smaller than 0.01 mm.
+  float t_enter = -MAXFLOAT;
+  float t_exit = MAXFLOAT;
+  for( int i = 0; i < 3; i++ )
+  {
+    if( fabs( d[ i ] ) < 0.01f )
+    {
+      if( p[ i ] < 0.0f || p[ i ] > e[ i ] ) return 0.0f;
+      continue;
+    }
+    const float t0 = -p[ i ] / d[ i ];
+    const float t1 = ( e[ i ] - p[ i ] ) / d[ i ];
+    t_enter = fmax( t_enter, fmin( t0, t1 ) );
+    t_exit = fmin( t_exit, fmax( t0, t1 ) );
+  }
+  if( t_enter >= t_exit ) return 0.0f;
+
+  // The end points of the ray in voxels
+  float start[ 3 ], end[ 3 ], num[ 3 ];
+  for( int i = 0; i < 3; i++ )
+  {
+    start[ i ] = mad( t_enter, d[ i ], p[ i ] ) / s[ i ];
+    end[ i ] = mad( t_exit, d[ i ], p[ i ] ) / s[ i ];
+    num[ i ] = fabs( start[ i ] - end[ i ] );
+  }
+
+  // Traverse in the direction a with the greatest number of voxel planes,
+  // u and v are the two directions within the planes.
+  int a, u, v;
+  if( num[ 0 ] >= num[ 1 ] && num[ 0 ] >= num[ 2 ] ) { a = 0; u = 1; v = 2; }
+  else if( num[ 1 ] >= num[ 0 ] && num[ 1 ] >= num[ 2 ] ) { a = 1; u = 0; v = 2; }
+  else { a = 2; u = 0; v = 1; }
+
+  float increment[ 3 ];
+  increment[ a ] = ( start[ a ] < end[ a ] ) ? 1.0f : -1.0f;
+  increment[ u ] = increment[ a ] * ( start[ u ] - end[ u ] ) / ( start[ a ] - end[ a ] );
+  increment[ v ] = increment[ a ] * ( start[ v ] - end[ v ] ) / ( start[ a ] - end[ a ] );
+
+  // Place the ray points at the centres of the voxel planes, and shift the
+  // in-plane coordinates by half a voxel, so that the neighbouring voxels
+  // are found by truncation.
+  const float shift = (float)( (int)start[ a ] ) - start[ a ];
+  start[ u ] += shift * increment[ u ] * increment[ a ] + 0.5f * increment[ u ] - 0.5f;
+  start[ v ] += shift * increment[ v ] * increment[ a ] + 0.5f * increment[ v ] - 0.5f;
+  start[ a ] = (float)( (int)start[ a ] ) + 0.5f * increment[ a ];
+  int planes = (int)num[ a ];
+
+  // Shorten the ray until both end points lie inside the volume
+  bool start_ok, end_ok;
+  do
+  {
+    start_ok = raycast_is_inside_3d( start, a, size );
+    if( !start_ok )
+    {
+      for( int i = 0; i < 3; i++ ) start[ i ] += increment[ i ];
+      planes--;
+    }
+
+    float last[ 3 ];
+    for( int i = 0; i < 3; i++ ) last[ i ] = mad( (float)planes, increment[ i ], start[ i ] );
+    end_ok = raycast_is_inside_3d( last, a, size );
+    if( !end_ok ) planes--;
+  }
+  while( !( start_ok && end_ok ) && planes > 1 );
+
+  if( !( start_ok && end_ok ) ) return 0.0f;
+
+  // Integrate the bilinearly interpolated intensities along the ray
+  float integral = 0.0f;
+  float position[ 3 ] = { start[ 0 ], start[ 1 ], start[ 2 ] };
+  for( int plane = 0; plane < planes; plane++ )
+  {
+    int i00[ 3 ] = { (int)position[ 0 ], (int)position[ 1 ], (int)position[ 2 ] };
+    int i10[ 3 ] = { i00[ 0 ], i00[ 1 ], i00[ 2 ] };
+    int i01[ 3 ] = { i00[ 0 ], i00[ 1 ], i00[ 2 ] };
+    int i11[ 3 ] = { i00[ 0 ], i00[ 1 ], i00[ 2 ] };
+    i10[ u ]++;
+    i01[ v ]++;
+    i11[ u ]++; i11[ v ]++;
+
+    const float v00 = raycast_get_voxel_3d( i00[ 0 ], i00[ 1 ], i00[ 2 ], in, size );
+    const float v10 = raycast_get_voxel_3d( i10[ 0 ], i10[ 1 ], i10[ 2 ], in, size );
+    const float v01 = raycast_get_voxel_3d( i01[ 0 ], i01[ 1 ], i01[ 2 ], in, size );
+    const float v11 = raycast_get_voxel_3d( i11[ 0 ], i11[ 1 ], i11[ 2 ], in, size );
+
+    const float y = position[ u ] - floor( position[ u ] );
+    const float z = position[ v ] - floor( position[ v ] );
+    const float intensity = mad( y, mad( z, v11 - v10 - v01 + v00, v10 - v00 ),
+      mad( z, v01 - v00, v00 ) );
+
+    if( intensity > threshold )
+    {
+      integral += intensity - threshold;
+    }
+
+    for( int i = 0; i < 3; i++ ) position[ i ] += increment[ i ];
+  }
+
+  // Scale by the distance between the ray points in mm
+  const float3 step = (float3)( increment[ 0 ], increment[ 1 ], increment[ 2 ] ) * spacing;
+  return integral * length( step );
+}
+#endif // DIM_3
@@ -174,6 +174,210 @@ uint get_image_offset(const uint gix,
   return gidx;
 }
 
+//------------------------------------------------------------------------------
+// Get the global memory offset of element i of a line along direction.
+// The lines along x are numbered by (y, z), along y by (x, z), and along z
+// by (x, y), so that for y and z neighbouring lines are neighbours in x.
+uint get_line_element_offset(const uint4 image_size,
+                             const uint direction,
+                             const uint line, const uint i)
+{
+  if(direction == 0)
+  {
+    return line * image_size.x + i;
+  }
+  const uint slice = image_size.x * image_size.y;
+  if(direction == 1)
+  {
+    const uint z = line / image_size.x;
+    const uint x = line - z * image_size.x;
+    return z * slice + i * image_size.x + x;
+  }
+  return i * slice + line;
+}
+
+//------------------------------------------------------------------------------
+// Copy lines_per_group lines between global memory and the local tile.
+// Element i of line l is at tile[i * lines_per_group + l], so that the
+// recursions of neighbouring lines access neighbouring local memory.
+// Neighbouring work-items access neighbouring global memory: along the line
+// for direction x, and across the lines for directions y and z.
+void copy_lines_to_tile(__global const OUTPIXELTYPE *out,
+                        __local BUFFPIXELTYPE *tile,
+                        const uint4 image_size, const uint direction,
+                        const uint length, const uint number_of_lines,
+                        const uint first_line, const uint lines_per_group,
+                        const float gain)
+{
+  const uint tile_size = lines_per_group * length;
+  for(uint e = get_local_id(0); e < tile_size; e += get_local_size(0))
+  {
+    uint l, i;
+    if(direction == 0)
+    {
+      l = e / length;
+      i = e - l * length;
+    }
+    else
+    {
+      i = e / lines_per_group;
+      l = e - i * lines_per_group;
+    }
+    if(first_line + l < number_of_lines)
+    {
+      const uint gidx = get_line_element_offset(image_size, direction, first_line + l, i);
+      tile[i * lines_per_group + l] = gain * (BUFFPIXELTYPE)(out[gidx]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+void copy_tile_to_lines(__global OUTPIXELTYPE *out,
+                        __local const BUFFPIXELTYPE *tile,
+                        const uint4 image_size, const uint direction,
+                        const uint length, const uint number_of_lines,
+                        const uint first_line, const uint lines_per_group)
+{
+  const uint tile_size = lines_per_group * length;
+  for(uint e = get_local_id(0); e < tile_size; e += get_local_size(0))
+  {
+    uint l, i;
+    if(direction == 0)
+    {
+      l = e / length;
+      i = e - l * length;
+    }
+    else
+    {
+      i = e / lines_per_group;
+      l = e - i * lines_per_group;
+    }
+    if(first_line + l < number_of_lines)
+    {
+      const uint gidx = get_line_element_offset(image_size, direction, first_line + l, i);
+      out[gidx] = (OUTPIXELTYPE)(tile[i * lines_per_group + l]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Tiled version of BSplineDecompositionImageFilter for one direction of an
+// image of any dimension: the unused sizes of image_size are 1. A work-group
+// processes lines_per_group neighbouring lines, all poles, in local memory,
+// with get_local_size(0) / lines_per_group work-items per line. These sum
+// the initial causal coefficient in parallel; the recursions themselves are
+// run by the first work-item of every line. The gain of all poles is applied
+// when the lines are loaded.
+__kernel void BSplineDecompositionImageFilterTiled(__global OUTPIXELTYPE *out,
+                                                   const uint4 image_size,
+                                                   const uint direction,
+                                                   const float2 spline_poles,
+                                                   const int number_of_poles,
+                                                   const float gain,
+                                                   const uint lines_per_group,
+                                                   __local BUFFPIXELTYPE *tile,
+                                                   __local BUFFPIXELTYPE *partial)
+{
+  uint length = image_size.x;
+  if(direction == 1)
+  {
+    length = image_size.y;
+  }
+  else if(direction == 2)
+  {
+    length = image_size.z;
+  }
+  const uint number_of_lines
+    = image_size.x * image_size.y * image_size.z / length;
+  const uint first_line = get_group_id(0) * lines_per_group;
+  const uint threads_per_line = get_local_size(0) / lines_per_group;
+
+  copy_lines_to_tile(out, tile, image_size, direction, length,
+                     number_of_lines, first_line, lines_per_group, gain);
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // Work-item lid handles line l; the first work-items of all lines are the
+  // first lines_per_group work-items of the group.
+  const uint lid = get_local_id(0);
+  const uint l = lid % lines_per_group;
+  const uint p = lid / lines_per_group;
+  const uint stride = lines_per_group;
+  const bool active = first_line + l < number_of_lines;
+
+  float poles[2];
+  poles[0] = spline_poles.x;
+  poles[1] = spline_poles.y;
+
+  for(int k = 0; k < number_of_poles; ++k)
+  {
+    const float z = poles[k];
+
+    // The initial causal coefficient, for mirror boundaries, as in
+    // set_initial_causal_coefficient(), summed over the work-items of a line.
+    const float tolerance = 1e-10f;
+    const uint  horizon = (uint)( ceil( log(tolerance) / log( fabs(z) ) ) );
+    float       sum = 0.0f;
+    if(horizon < length)
+    {
+      for(uint n = p; n < horizon; n += threads_per_line)
+      {
+        sum = mad(pown(z, (int)n), tile[n * stride + l], sum);
+      }
+    }
+    else
+    {
+      for(uint n = p; n < length; n += threads_per_line)
+      {
+        float w = 1.0f;
+        if(n == length - 1)
+        {
+          w = pown(z, (int)(length - 1));
+        }
+        else if(n > 0)
+        {
+          w = pown(z, (int)n) + pown(z, (int)(2 * length - 2 - n));
+        }
+        sum = mad(w, tile[n * stride + l], sum);
+      }
+    }
+    partial[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if(p == 0 && active)
+    {
+      for(uint q = 1; q < threads_per_line; ++q)
+      {
+        sum += partial[q * stride + l];
+      }
+      if(horizon >= length)
+      {
+        sum /= 1.0f - pown(z, (int)(2 * length - 2));
+      }
+      tile[l] = sum;
+
+      // causal recursion
+      for(uint n = 1; n < length; ++n)
+      {
+        tile[n * stride + l] = mad(z, tile[(n - 1) * stride + l], tile[n * stride + l]);
+      }
+
+      // anticausal initialization, see set_initial_anticausal_coefficient()
+      const uint last = (length - 1) * stride + l;
+      tile[last] = ( z / (pown(z, 2) - 1.0f) ) * mad(z, tile[last - stride], tile[last]);
+
+      // anticausal recursion
+      for(int n = length - 2; 0 <= n; n--)
+      {
+        tile[n * stride + l] = z * (tile[(n + 1) * stride + l] - tile[n * stride + l]);
+      }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  copy_tile_to_lines(out, tile, image_size, direction, length,
+                     number_of_lines, first_line, lines_per_group);
+}
+
 //------------------------------------------------------------------------------
 #ifdef DIM_1
 __kernel void BSplineDecompositionImageFilter(__global const INPIXELTYPE *in,
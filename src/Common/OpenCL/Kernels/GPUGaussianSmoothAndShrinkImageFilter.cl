@@ -0,0 +1,139 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of itk::GaussianSmoothAndShrinkImageFilter
+//
+// The image is convolved one dimension after the other, and each pass only
+// computes the values at the pixels that are kept by the shrinking. The
+// buffers are stored with the pass dimension in the middle:
+//   [ inner size ][ size along the pass dimension ][ outer size ],
+// where the inner size is one for the pass along the first dimension.
+
+//------------------------------------------------------------------------------
+// The first pass writes the output directly for 1D images
+#ifdef DIM_1
+#define LINEPIXELTYPE OUTPIXELTYPE
+#else
+#define LINEPIXELTYPE float
+#endif
+
+//------------------------------------------------------------------------------
+// The pass along the first dimension. Every work item computes one kept pixel
+// of a line, get_global_id( 1 ) is the line. The input pixels that are needed
+// by a work group, including the kernel radius, are cast to float and loaded
+// into local memory once.
+__kernel void GaussianSmoothAndShrinkLines(
+  __global const INPIXELTYPE *in,
+  __global LINEPIXELTYPE *out,
+  __global const float *gaussian,
+  int radius,
+  uint source_size, uint destination_size,
+  int first_center, uint factor,
+  __local float *tile )
+{
+  const uint index      = get_global_id( 0 );
+  const uint line       = get_global_id( 1 );
+  const uint local_id   = get_local_id( 0 );
+  const uint group_size = get_local_size( 0 );
+
+  // Load the part of the line, with zero flux Neumann boundary conditions
+  const int  tile_start = first_center
+    + (int)( get_group_id( 0 ) * group_size * factor ) - radius;
+  const uint tile_size = ( group_size - 1 ) * factor + 2 * radius + 1;
+  __global const INPIXELTYPE *source = in + line * source_size;
+  for( uint t = local_id; t < tile_size; t += group_size )
+  {
+    const int s = clamp( tile_start + (int)t, 0, (int)source_size - 1 );
+    tile[ t ] = (float)source[ s ];
+  }
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  if( index < destination_size )
+  {
+    const uint center = local_id * factor + radius;
+    float      sum = 0.0f;
+    for( int k = -radius; k <= radius; k++ )
+    {
+      sum += gaussian[ k + radius ] * tile[ center + k ];
+    }
+    out[ line * destination_size + index ] = (LINEPIXELTYPE)sum;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Convolves the float source at a kept pixel along one of the other
+// dimensions. Neighbouring work items read neighbouring pixels of the inner
+// dimensions, so every kernel tap is a coalesced read.
+float convolve_strip( __global const float *in,
+  __global const float *gaussian, const int radius,
+  const uint inner_size, const uint source_size,
+  const int center, const uint x, const uint outer )
+{
+  __global const float *source = in + outer * source_size * inner_size + x;
+  float sum = 0.0f;
+  for( int k = -radius; k <= radius; k++ )
+  {
+    const int s = clamp( center + k, 0, (int)source_size - 1 );
+    sum += gaussian[ k + radius ] * source[ s * inner_size ];
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+// The pass along one of the middle dimensions, to a float buffer.
+__kernel void GaussianSmoothAndShrinkStrips(
+  __global const float *in,
+  __global float *out,
+  __global const float *gaussian,
+  int radius,
+  uint inner_size, uint source_size, uint destination_size,
+  int first_center, uint factor )
+{
+  const uint x     = get_global_id( 0 );
+  const uint index = get_global_id( 1 );
+  const uint outer = get_global_id( 2 );
+
+  if( x < inner_size && index < destination_size )
+  {
+    const int center = first_center + (int)( index * factor );
+    out[ ( outer * destination_size + index ) * inner_size + x ]
+      = convolve_strip( in, gaussian, radius, inner_size, source_size, center, x, outer );
+  }
+}
+
+//------------------------------------------------------------------------------
+// The pass along the last dimension, to the output image.
+__kernel void GaussianSmoothAndShrinkStripsToOutput(
+  __global const float *in,
+  __global OUTPIXELTYPE *out,
+  __global const float *gaussian,
+  int radius,
+  uint inner_size, uint source_size, uint destination_size,
+  int first_center, uint factor )
+{
+  const uint x     = get_global_id( 0 );
+  const uint index = get_global_id( 1 );
+  const uint outer = get_global_id( 2 );
+
+  if( x < inner_size && index < destination_size )
+  {
+    const int center = first_center + (int)( index * factor );
+    out[ ( outer * destination_size + index ) * inner_size + x ]
+      = (OUTPIXELTYPE)convolve_strip( in, gaussian, radius, inner_size, source_size, center, x, outer );
+  }
+}
@@ -0,0 +1,490 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// Functions shared by the OpenCL implementations of the image to image
+// metrics, for a B-spline transform and a linearly interpolated moving image.
+//
+// The metric kernels first map the samples and evaluate the moving image
+// value and gradient, and store these for a second kernel that scatters the
+// product of the B-spline transform Jacobian and the moving image gradient
+// to the derivative. That Jacobian is diagonal, with the B-spline weights
+// of the fixed point on the diagonal, so the image Jacobian of parameter
+// (d, k) is the gradient component d times weight k.
+//
+// The samples are stored as float4, with the fixed point in xyz and the
+// fixed image value in w. The moving values and gradients are stored as
+// float4 as well, with the value in x and the gradient in yzw; invalid
+// samples are stored with a zero gradient, so they do not contribute to
+// the derivative.
+//
+// Requires GPUMath.cl, GPUImageBase.cl and GPUBSplineTransform.cl.
+
+//------------------------------------------------------------------------------
+// Atomic addition of floats, OpenCL 1.1 only has integer atomics
+void atomic_add_local_float( volatile __local float *address, const float value )
+{
+  union { uint u; float f; } old_value, new_value;
+  do
+  {
+    old_value.f = *address;
+    new_value.f = old_value.f + value;
+  }
+  while( atomic_cmpxchg( (volatile __local uint *)address,
+    old_value.u, new_value.u ) != old_value.u );
+}
+
+//------------------------------------------------------------------------------
+void atomic_add_global_float( volatile __global float *address, const float value )
+{
+  union { uint u; float f; } old_value, new_value;
+  do
+  {
+    old_value.f = *address;
+    new_value.f = old_value.f + value;
+  }
+  while( atomic_cmpxchg( (volatile __global uint *)address,
+    old_value.u, new_value.u ) != old_value.u );
+}
+
+//------------------------------------------------------------------------------
+// Sum the values of the work items of a group by a tree reduction in local
+// memory. All work items of the group have to call this function, and the
+// local size has to be a power of two. Returns the sum to all work items.
+float reduce_local_float( const float value, __local float *buffer )
+{
+  const uint local_id = get_local_id( 0 );
+
+  barrier( CLK_LOCAL_MEM_FENCE );
+  buffer[ local_id ] = value;
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  for( uint offset = get_local_size( 0 ) / 2; offset > 0; offset >>= 1 )
+  {
+    if( local_id < offset )
+    {
+      buffer[ local_id ] += buffer[ local_id + offset ];
+    }
+    barrier( CLK_LOCAL_MEM_FENCE );
+  }
+
+  return buffer[ 0 ];
+}
+
+//------------------------------------------------------------------------------
+// Map a point with the B-spline transform. The coefficients of all
+// dimensions are stored in one buffer, in the order of the parameters.
+#ifdef DIM_3
+float3 metric_transform_point_3d( const float3 point,
+  const uint spline_order,
+  __constant GPUImageBase3D *coefficients_image,
+  __global const float *coefficients )
+{
+  float3 cindex = transform_physical_point_to_continuous_index_3d( point,
+    coefficients_image->physical_point_to_index, coefficients_image->origin );
+  if( !inside_valid_region_3d( &cindex, spline_order, coefficients_image->size ) )
+  {
+    return point;
+  }
+
+  const uint support_size = spline_order + 1;
+  const uint number_of_weights = support_size * support_size * support_size;
+  float weights[ 64 ];
+  const long3 start_index = evaluate_3d( cindex, spline_order, support_size,
+    number_of_weights, weights );
+
+  const uint3 size = coefficients_image->size;
+  const uint number_of_coefficients = size.x * size.y * size.z;
+
+  float3 displacement = (float3)( 0.0f, 0.0f, 0.0f );
+  for( uint k = 0; k < number_of_weights; ++k )
+  {
+    const uint x = start_index.x + ( k % support_size );
+    const uint y = start_index.y + ( k / support_size ) % support_size;
+    const uint z = start_index.z + ( k / support_size / support_size ) % support_size;
+    const uint gidx = mad24( size.x, mad24( z, size.y, y ), x );
+    const float w = weights[ k ];
+
+    displacement.x = mad( coefficients[ gidx ], w, displacement.x );
+    displacement.y = mad( coefficients[ number_of_coefficients + gidx ], w, displacement.y );
+    displacement.z = mad( coefficients[ 2 * number_of_coefficients + gidx ], w, displacement.z );
+  }
+
+  return point + displacement;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Trilinear interpolation of the moving image value and its gradient in
+// physical space. Returns false if the point is outside the image buffer.
+#ifdef DIM_3
+bool evaluate_moving_image_value_and_derivative_3d( const float3 point,
+  __global const float *in,
+  __constant GPUImageBase3D *image,
+  float *value, float3 *gradient )
+{
+  const float3 cindex = transform_physical_point_to_continuous_index_3d( point,
+    image->physical_point_to_index, image->origin );
+  const uint3 size = image->size;
+
+  // The same test as itk::ImageFunction::IsInsideBuffer()
+  if( cindex.x < -0.5f || cindex.x >= (float)( size.x ) - 0.5f ) { return false; }
+  if( cindex.y < -0.5f || cindex.y >= (float)( size.y ) - 0.5f ) { return false; }
+  if( cindex.z < -0.5f || cindex.z >= (float)( size.z ) - 0.5f ) { return false; }
+
+  // Near the border the missing neighbours are replaced by the base voxel
+  const float c[ 3 ] = { cindex.x, cindex.y, cindex.z };
+  const int n[ 3 ] = { (int)size.x, (int)size.y, (int)size.z };
+  int i0[ 3 ], i1[ 3 ];
+  float t[ 3 ];
+  for( int d = 0; d < 3; d++ )
+  {
+    i0[ d ] = max( (int)( floor( c[ d ] ) ), 0 );
+    i1[ d ] = i0[ d ] + 1;
+    t[ d ] = fmax( c[ d ] - (float)( i0[ d ] ), 0.0f );
+    if( i1[ d ] > n[ d ] - 1 )
+    {
+      i1[ d ] = i0[ d ];
+      t[ d ] = 0.0f;
+    }
+  }
+
+  const float v000 = get_pixel_3d( (long3)( i0[ 0 ], i0[ 1 ], i0[ 2 ] ), in, size );
+  const float v100 = get_pixel_3d( (long3)( i1[ 0 ], i0[ 1 ], i0[ 2 ] ), in, size );
+  const float v010 = get_pixel_3d( (long3)( i0[ 0 ], i1[ 1 ], i0[ 2 ] ), in, size );
+  const float v110 = get_pixel_3d( (long3)( i1[ 0 ], i1[ 1 ], i0[ 2 ] ), in, size );
+  const float v001 = get_pixel_3d( (long3)( i0[ 0 ], i0[ 1 ], i1[ 2 ] ), in, size );
+  const float v101 = get_pixel_3d( (long3)( i1[ 0 ], i0[ 1 ], i1[ 2 ] ), in, size );
+  const float v011 = get_pixel_3d( (long3)( i0[ 0 ], i1[ 1 ], i1[ 2 ] ), in, size );
+  const float v111 = get_pixel_3d( (long3)( i1[ 0 ], i1[ 1 ], i1[ 2 ] ), in, size );
+
+  const float v00 = mix( v000, v100, t[ 0 ] );
+  const float v10 = mix( v010, v110, t[ 0 ] );
+  const float v01 = mix( v001, v101, t[ 0 ] );
+  const float v11 = mix( v011, v111, t[ 0 ] );
+  const float v0 = mix( v00, v10, t[ 1 ] );
+  const float v1 = mix( v01, v11, t[ 1 ] );
+  (*value) = mix( v0, v1, t[ 2 ] );
+
+  // The gradient with respect to the continuous index
+  const float gx = mix( mix( v100 - v000, v110 - v010, t[ 1 ] ),
+    mix( v101 - v001, v111 - v011, t[ 1 ] ), t[ 2 ] );
+  const float gy = mix( v10 - v00, v11 - v01, t[ 2 ] );
+  const float gz = v1 - v0;
+
+  // The chain rule gives the gradient in physical space
+  const float16 pp2i = image->physical_point_to_index;
+  (*gradient) = gx * pp2i.s012 + gy * pp2i.s345 + gz * pp2i.s678;
+
+  return true;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Map a fixed point and evaluate the moving image value and gradient there,
+// see AdvancedImageToImageMetric::TransformPoint() and
+// EvaluateMovingImageValueAndDerivative(). Returns false if the mapped
+// point is outside the moving image buffer.
+#ifdef DIM_3
+bool metric_evaluate_sample_3d( const float3 fixed_point,
+  const uint spline_order,
+  __constant GPUImageBase3D *coefficients_image,
+  __global const float *coefficients,
+  __global const float *moving_image,
+  __constant GPUImageBase3D *moving_image_base,
+  float *moving_value, float3 *gradient )
+{
+  const float3 mapped_point = metric_transform_point_3d( fixed_point,
+    spline_order, coefficients_image, coefficients );
+
+  return evaluate_moving_image_value_and_derivative_3d( mapped_point,
+    moving_image, moving_image_base, moving_value, gradient );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Add the Jacobian gradient product of a fixed point, scaled_gradient times
+// the B-spline weights, to the parameters in its support region. Points
+// outside the valid region of the grid have a zero Jacobian.
+#ifdef DIM_3
+void metric_scatter_jacobian_gradient_product_3d( const float3 fixed_point,
+  const float3 scaled_gradient,
+  const uint spline_order,
+  __constant GPUImageBase3D *coefficients_image,
+  __global float *derivative )
+{
+  float3 cindex = transform_physical_point_to_continuous_index_3d( fixed_point,
+    coefficients_image->physical_point_to_index, coefficients_image->origin );
+  if( !inside_valid_region_3d( &cindex, spline_order, coefficients_image->size ) ) { return; }
+
+  const uint support_size = spline_order + 1;
+  const uint number_of_weights = support_size * support_size * support_size;
+  float weights[ 64 ];
+  const long3 start_index = evaluate_3d( cindex, spline_order, support_size,
+    number_of_weights, weights );
+
+  const uint3 size = coefficients_image->size;
+  const uint number_of_coefficients = size.x * size.y * size.z;
+
+  for( uint k = 0; k < number_of_weights; ++k )
+  {
+    const uint x = start_index.x + ( k % support_size );
+    const uint y = start_index.y + ( k / support_size ) % support_size;
+    const uint z = start_index.z + ( k / support_size / support_size ) % support_size;
+    const uint gidx = mad24( size.x, mad24( z, size.y, y ), x );
+    const float w = weights[ k ];
+
+    atomic_add_global_float( &derivative[ gidx ], scaled_gradient.x * w );
+    atomic_add_global_float( &derivative[ number_of_coefficients + gidx ], scaled_gradient.y * w );
+    atomic_add_global_float( &derivative[ 2 * number_of_coefficients + gidx ], scaled_gradient.z * w );
+  }
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Add the contribution of each sample to the derivative, for metrics of
+// which the derivative is a sum over the samples of a linear function of the
+// fixed and moving image values times the image Jacobian:
+//   dC/dmu = sum ( a * F + b * M + c ) * dM/dx * dT/dmu,
+// with (a, b, c) given in the xyz components of factors.
+// The derivative has to be cleared by the kernel that evaluated the samples.
+#ifdef DIM_3
+__kernel void ImageToImageMetricLinearDerivative(
+  __global const float4 *samples,
+  const uint number_of_samples,
+  __global const float4 *moving_values_and_gradients,
+  __constant GPUImageBase3D *coefficients_image_base,
+  const uint spline_order,
+  const float4 factors,
+  __global float *derivative )
+{
+  const uint s = get_global_id( 0 );
+  if( s >= number_of_samples ) { return; }
+
+  // Invalid samples, and samples without gradient, do not contribute
+  const float4 value_and_gradient = moving_values_and_gradients[ s ];
+  const float3 gradient = value_and_gradient.yzw;
+  if( gradient.x == 0.0f && gradient.y == 0.0f && gradient.z == 0.0f ) { return; }
+
+  const float4 sample = samples[ s ];
+  const float factor = mad( factors.x, sample.w,
+    mad( factors.y, value_and_gradient.x, factors.z ) );
+  if( factor == 0.0f ) { return; }
+
+  metric_scatter_jacobian_gradient_product_3d( sample.xyz, factor * gradient,
+    spline_order, coefficients_image_base, derivative );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Take a gradient descent step on the parameters that are kept on the device:
+//   g = derivative_scale * derivative,
+//   parameters -= step_size * g,
+// and store g as the previous derivative. Every work group writes its partial
+// sums of g . g and g . previous_derivative, for the step size adaptation of
+// the optimizer on the host. Launched with a fixed number of work groups,
+// which loop over the parameters.
+__kernel void ImageToImageMetricAdvanceParameters(
+  __global float *parameters,
+  __global const float *derivative,
+  __global float *previous_derivative,
+  const uint number_of_parameters,
+  const float derivative_scale,
+  const float step_size,
+  __local float *local_sums,
+  __global float *partial_inner_products )
+{
+  float squared_magnitude = 0.0f;
+  float inner_product = 0.0f;
+  for( uint i = get_global_id( 0 ); i < number_of_parameters; i += get_global_size( 0 ) )
+  {
+    const float g = derivative_scale * derivative[ i ];
+    squared_magnitude = mad( g, g, squared_magnitude );
+    inner_product = mad( g, previous_derivative[ i ], inner_product );
+    previous_derivative[ i ] = g;
+    parameters[ i ] = mad( -step_size, g, parameters[ i ] );
+  }
+
+  squared_magnitude = reduce_local_float( squared_magnitude, local_sums );
+  inner_product = reduce_local_float( inner_product, local_sums );
+  if( get_local_id( 0 ) == 0 )
+  {
+    partial_inner_products[ 2 * get_group_id( 0 ) ] = squared_magnitude;
+    partial_inner_products[ 2 * get_group_id( 0 ) + 1 ] = inner_product;
+  }
+}
+
+//------------------------------------------------------------------------------
+// The counter-based random number generator Philox4x32-10, the same as
+// itk::PhiloxRandomNumberGenerator::Generate(). The four random words are a
+// function of the key and the counter only.
+uint4 metric_philox4x32_10( uint4 counter, uint2 key )
+{
+  for( uint round = 0; round < 10; ++round )
+  {
+    if( round > 0 )
+    {
+      key.x += 0x9E3779B9u;
+      key.y += 0xBB67AE85u;
+    }
+
+    const uint hi0 = mul_hi( 0xD2511F53u, counter.x );
+    const uint lo0 = 0xD2511F53u * counter.x;
+    const uint hi1 = mul_hi( 0xCD9E8D57u, counter.z );
+    const uint lo1 = 0xCD9E8D57u * counter.z;
+
+    counter = (uint4)( hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0 );
+  }
+  return counter;
+}
+
+//------------------------------------------------------------------------------
+// Convert a random word to a float in [0, 1), from its upper 24 bits. This
+// is itk::PhiloxRandomNumberGenerator::ToUnitInterval( a, b ) rounded down
+// to single precision.
+float metric_unit_interval( const uint a )
+{
+  return (float)( a >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+//------------------------------------------------------------------------------
+// Trilinear interpolation of an image value at a continuous index, which
+// has to be inside the image buffer.
+#ifdef DIM_3
+float metric_interpolate_image_value_3d( const float3 cindex,
+  __global const float *in, const uint3 size )
+{
+  const float c[ 3 ] = { cindex.x, cindex.y, cindex.z };
+  const int n[ 3 ] = { (int)size.x, (int)size.y, (int)size.z };
+  int i0[ 3 ], i1[ 3 ];
+  float t[ 3 ];
+  for( int d = 0; d < 3; d++ )
+  {
+    i0[ d ] = clamp( (int)( floor( c[ d ] ) ), 0, n[ d ] - 1 );
+    i1[ d ] = min( i0[ d ] + 1, n[ d ] - 1 );
+    t[ d ] = clamp( c[ d ] - (float)( i0[ d ] ), 0.0f, 1.0f );
+  }
+
+  const float v00 = mix( get_pixel_3d( (long3)( i0[ 0 ], i0[ 1 ], i0[ 2 ] ), in, size ),
+    get_pixel_3d( (long3)( i1[ 0 ], i0[ 1 ], i0[ 2 ] ), in, size ), t[ 0 ] );
+  const float v10 = mix( get_pixel_3d( (long3)( i0[ 0 ], i1[ 1 ], i0[ 2 ] ), in, size ),
+    get_pixel_3d( (long3)( i1[ 0 ], i1[ 1 ], i0[ 2 ] ), in, size ), t[ 0 ] );
+  const float v01 = mix( get_pixel_3d( (long3)( i0[ 0 ], i0[ 1 ], i1[ 2 ] ), in, size ),
+    get_pixel_3d( (long3)( i1[ 0 ], i0[ 1 ], i1[ 2 ] ), in, size ), t[ 0 ] );
+  const float v11 = mix( get_pixel_3d( (long3)( i0[ 0 ], i1[ 1 ], i1[ 2 ] ), in, size ),
+    get_pixel_3d( (long3)( i1[ 0 ], i1[ 1 ], i1[ 2 ] ), in, size ), t[ 0 ] );
+
+  return mix( mix( v00, v10, t[ 1 ] ), mix( v01, v11, t[ 1 ] ), t[ 2 ] );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// The bit-packed mask of itk::ImageMaskSpatialObject2::IsInside(): the
+// bounding box test, the world-to-index transform, the rounding to the
+// nearest voxel and the bit test. Bit k of the mask region is bit ( k % 64 )
+// of word ( k / 64 ), in raster order.
+#ifdef DIM_3
+bool metric_is_inside_mask_3d( const float3 point,
+  __global const ulong *mask,
+  const float16 world_to_index,
+  const float4 world_to_index_offset,
+  const float4 bounds_minimum,
+  const float4 bounds_maximum,
+  const int4 mask_start,
+  const uint4 mask_size )
+{
+  if( any( point < bounds_minimum.xyz ) || any( point > bounds_maximum.xyz ) ) { return false; }
+
+  const float3 p = (float3)(
+    dot( world_to_index.s012, point ),
+    dot( world_to_index.s345, point ),
+    dot( world_to_index.s678, point ) ) + world_to_index_offset.xyz;
+  const int3 index = convert_int3( floor( p + 0.5f ) ) - mask_start.xyz;
+  if( any( index < 0 ) || any( index >= convert_int3( mask_size.xyz ) ) ) { return false; }
+
+  const ulong bit = ( (ulong)( index.z ) * mask_size.y + index.y ) * mask_size.x + index.x;
+  return ( ( mask[ bit >> 6 ] >> ( bit & 63 ) ) & 1 ) != 0;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Generate random coordinate samples on the device, the same as the counter-
+// based path of itk::ImageRandomCoordinateSampler: attempt a of sample s
+// draws its continuous index from the counters ( s, 0, a, 0 ) and
+// ( s, 0, a, 1 ) with key ( seed, update ), uniformly in the box from
+// smallest to largest, and retries while the point is outside the mask.
+// The fixed image is interpolated linearly, and its value is clamped to
+// fixed_value_range, see OpenCLMetricBase::GetGPUFixedImageValue().
+// The number of attempts and the number of samples without a valid point
+// are added to statistics[ 0 ] and statistics[ 1 ] when a mask is used.
+#ifdef DIM_3
+__kernel void ImageToImageMetricGenerateRandomCoordinateSamples(
+  __global float4 *samples,
+  const uint number_of_samples,
+  const uint2 key,
+  const float4 smallest_cindex,
+  const float4 largest_cindex,
+  __global const float *fixed_image,
+  __constant GPUImageBase3D *fixed_image_base,
+  const float2 fixed_value_range,
+  const uint use_mask,
+  __global const ulong *mask,
+  const float16 world_to_index,
+  const float4 world_to_index_offset,
+  const float4 bounds_minimum,
+  const float4 bounds_maximum,
+  const int4 mask_start,
+  const uint4 mask_size,
+  const uint maximum_number_of_attempts,
+  __global uint *statistics )
+{
+  const uint s = get_global_id( 0 );
+  if( s >= number_of_samples ) { return; }
+
+  const float16 i2pp = fixed_image_base->index_to_physical_point;
+  const float3 extent = largest_cindex.xyz - smallest_cindex.xyz;
+  float3 cindex = smallest_cindex.xyz;
+  float3 point = fixed_image_base->origin;
+  bool found = false;
+  uint attempt = 0;
+  while( !found && attempt < maximum_number_of_attempts )
+  {
+    const uint4 block0 = metric_philox4x32_10( (uint4)( s, 0, attempt, 0 ), key );
+    const uint4 block1 = metric_philox4x32_10( (uint4)( s, 0, attempt, 1 ), key );
+    const float3 u = (float3)( metric_unit_interval( block0.x ),
+      metric_unit_interval( block0.z ), metric_unit_interval( block1.x ) );
+    ++attempt;
+
+    cindex = mad( u, extent, smallest_cindex.xyz );
+    point = fixed_image_base->origin + (float3)(
+      dot( i2pp.s012, cindex ), dot( i2pp.s345, cindex ), dot( i2pp.s678, cindex ) );
+    found = !use_mask || metric_is_inside_mask_3d( point, mask, world_to_index,
+      world_to_index_offset, bounds_minimum, bounds_maximum, mask_start, mask_size );
+  }
+
+  if( use_mask )
+  {
+    atomic_add( &statistics[ 0 ], attempt );
+    if( !found ) { atomic_inc( &statistics[ 1 ] ); }
+  }
+
+  const float value = metric_interpolate_image_value_3d( cindex,
+    fixed_image, fixed_image_base->size );
+  samples[ s ] = (float4)( point,
+    clamp( value, fixed_value_range.x, fixed_value_range.y ) );
+}
+#endif // DIM_3
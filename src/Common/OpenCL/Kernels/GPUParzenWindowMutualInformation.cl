@@ -0,0 +1,372 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the low memory value and derivative computation
+// of itk::ParzenWindowMutualInformationImageToImageMetric, for a B-spline
+// transform and a linearly interpolated moving image.
+//
+// The computation consists of three kernels:
+//  1. ParzenWindowMutualInformationJointPDF maps the samples, evaluates the
+//     moving image value and gradient, and accumulates the joint histogram
+//     of each work group in local memory.
+//  2. ParzenWindowMutualInformationReduceJointPDF sums the histograms of
+//     the work groups.
+//  3. ParzenWindowMutualInformationDerivative scatters the contribution of
+//     each sample to the transform parameters in its B-spline support,
+//     given the ratio array computed on the host from the joint histogram.
+//
+// Requires GPUMath.cl, GPUImageBase.cl, GPUBSplineTransform.cl and
+// GPUImageToImageMetric.cl.
+
+//------------------------------------------------------------------------------
+// Definition of GPUParzenWindowHistogram
+typedef struct {
+  float fixed_image_bin_size;
+  float fixed_image_normalized_min;
+  float fixed_parzen_term_to_index_offset;
+  float moving_image_bin_size;
+  float moving_image_normalized_min;
+  float moving_parzen_term_to_index_offset;
+  float moving_limiter_upper_threshold;
+  float moving_limiter_upper_bound;
+  float moving_limiter_ut_min_ub;
+  float moving_limiter_ut_min_ub_inv;
+  float moving_limiter_lower_threshold;
+  float moving_limiter_lower_bound;
+  float moving_limiter_lt_min_lb;
+  float moving_limiter_lt_min_lb_inv;
+  float moving_image_derivative_scales[ 3 ];
+  uint  number_of_fixed_histogram_bins;
+  uint  number_of_moving_histogram_bins;
+  uint  fixed_kernel_bspline_order;
+  uint  moving_kernel_bspline_order;
+} GPUParzenWindowHistogram;
+
+//------------------------------------------------------------------------------
+// The B-spline Parzen window of the given order, evaluated for all bins in
+// its support, see itk::BSplineKernelFunction2.
+void parzen_window_values( const uint order, const float u, float *weights )
+{
+  const float abs_value = fabs( u );
+  const float sqr_value = u * u;
+
+  if( order == 0 )
+  {
+    if( abs_value < 0.5f ) { weights[ 0 ] = 1.0f; }
+    else if( abs_value == 0.5f ) { weights[ 0 ] = 0.5f; }
+    else { weights[ 0 ] = 0.0f; }
+  }
+  else if( order == 1 )
+  {
+    weights[ 0 ] = 1.0f - abs_value;
+    weights[ 1 ] = abs_value;
+  }
+  else if( order == 2 )
+  {
+    weights[ 0 ] = ( 9.0f - 12.0f * abs_value + 4.0f * sqr_value ) / 8.0f;
+    weights[ 1 ] = -0.25f + 2.0f * abs_value - sqr_value;
+    weights[ 2 ] = ( 1.0f - 4.0f * abs_value + 4.0f * sqr_value ) / 8.0f;
+  }
+  else
+  {
+    const float uuu = sqr_value * abs_value;
+    weights[ 0 ] = (  8.0f - 12.0f * abs_value +  6.0f * sqr_value -        uuu ) / 6.0f;
+    weights[ 1 ] = ( -5.0f + 21.0f * abs_value - 15.0f * sqr_value + 3.0f * uuu ) / 6.0f;
+    weights[ 2 ] = (  4.0f - 12.0f * abs_value + 12.0f * sqr_value - 3.0f * uuu ) / 6.0f;
+    weights[ 3 ] = ( -1.0f +  3.0f * abs_value -  3.0f * sqr_value +        uuu ) / 6.0f;
+  }
+}
+
+//------------------------------------------------------------------------------
+// The derivative of the B-spline Parzen window of the given order, evaluated
+// for all bins in its support, see itk::BSplineDerivativeKernelFunction2.
+void parzen_window_derivative_values( const uint order, const float u, float *weights )
+{
+  const float abs_value = fabs( u );
+  const float sqr_value = u * u;
+
+  if( order == 1 )
+  {
+    if( abs_value < 1.0f && abs_value > 0.0f )
+    {
+      weights[ 0 ] = -1.0f;
+      weights[ 1 ] = 1.0f;
+    }
+    else if( abs_value == 1.0f )
+    {
+      weights[ 0 ] = -0.5f;
+      weights[ 1 ] = 0.0f;
+    }
+    else
+    {
+      weights[ 0 ] = 0.0f;
+      weights[ 1 ] = 0.5f;
+    }
+  }
+  else if( order == 2 )
+  {
+    weights[ 0 ] =         u - 1.5f;
+    weights[ 1 ] = -2.0f * u + 2.0f;
+    weights[ 2 ] =         u - 0.5f;
+  }
+  else
+  {
+    weights[ 0 ] =  0.5f * sqr_value - 2.0f * abs_value + 2.0f;
+    weights[ 1 ] = -1.5f * sqr_value + 5.0f * abs_value - 3.5f;
+    weights[ 2 ] =  1.5f * sqr_value - 4.0f * abs_value + 2.0f;
+    weights[ 3 ] = -0.5f * sqr_value +        abs_value - 0.5f;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Soft limit the moving image value and its gradient,
+// see itk::ExponentialLimiterFunction.
+#ifdef DIM_3
+float limit_moving_image_value_3d( const float value, float3 *gradient,
+  __constant GPUParzenWindowHistogram *histogram )
+{
+  const float diffU = value - histogram->moving_limiter_upper_threshold;
+  if( diffU > 1e-10f )
+  {
+    const float temp = histogram->moving_limiter_ut_min_ub
+      * exp( histogram->moving_limiter_ut_min_ub_inv * diffU );
+    (*gradient) *= histogram->moving_limiter_ut_min_ub_inv * temp;
+    return temp + histogram->moving_limiter_upper_bound;
+  }
+
+  const float diffL = value - histogram->moving_limiter_lower_threshold;
+  if( diffL < -1e-10f )
+  {
+    const float temp = histogram->moving_limiter_lt_min_lb
+      * exp( histogram->moving_limiter_lt_min_lb_inv * diffL );
+    (*gradient) *= histogram->moving_limiter_lt_min_lb_inv * temp;
+    return temp + histogram->moving_limiter_lower_bound;
+  }
+
+  return value;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Accumulate the joint histogram of the samples of each work group in
+// local memory. The moving image values and gradients are stored for the
+// derivative kernel, with a zero gradient for the invalid samples.
+// The derivative buffer is cleared here as well.
+#ifdef DIM_3
+__kernel void ParzenWindowMutualInformationJointPDF(
+  __global const float4 *samples,
+  const uint number_of_samples,
+  __global const float *moving_image,
+  __constant GPUImageBase3D *moving_image_base,
+  __global const float *coefficients,
+  __constant GPUImageBase3D *coefficients_image_base,
+  const uint spline_order,
+  __constant GPUParzenWindowHistogram *histogram,
+  __global float4 *moving_values_and_gradients,
+  __local float *local_joint_pdf,
+  __global float *partial_joint_pdfs,
+  __global uint *partial_counts,
+  __global float *derivative,
+  const uint number_of_parameters )
+{
+  __local uint local_count;
+
+  const uint local_id = get_local_id( 0 );
+  const uint local_size = get_local_size( 0 );
+  const uint global_id = get_global_id( 0 );
+  const uint global_size = get_global_size( 0 );
+
+  const uint fixed_bins = histogram->number_of_fixed_histogram_bins;
+  const uint moving_bins = histogram->number_of_moving_histogram_bins;
+  const uint number_of_bins = fixed_bins * moving_bins;
+  const uint fixed_order = histogram->fixed_kernel_bspline_order;
+  const uint moving_order = histogram->moving_kernel_bspline_order;
+
+  for( uint i = local_id; i < number_of_bins; i += local_size )
+  {
+    local_joint_pdf[ i ] = 0.0f;
+  }
+  if( local_id == 0 ) { local_count = 0; }
+
+  for( uint i = global_id; i < number_of_parameters; i += global_size )
+  {
+    derivative[ i ] = 0.0f;
+  }
+
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  const float3 scales = (float3)( histogram->moving_image_derivative_scales[ 0 ],
+    histogram->moving_image_derivative_scales[ 1 ],
+    histogram->moving_image_derivative_scales[ 2 ] );
+
+  for( uint s = global_id; s < number_of_samples; s += global_size )
+  {
+    const float4 sample = samples[ s ];
+    float4 value_and_gradient = (float4)( 0.0f, 0.0f, 0.0f, 0.0f );
+
+    float moving_value;
+    float3 gradient;
+    if( metric_evaluate_sample_3d( sample.xyz, spline_order,
+      coefficients_image_base, coefficients, moving_image, moving_image_base,
+      &moving_value, &gradient ) )
+    {
+      gradient *= scales;
+      moving_value = limit_moving_image_value_3d( moving_value, &gradient, histogram );
+
+      // Determine the Parzen window arguments and the lowest bins affected
+      const float fixed_term = sample.w / histogram->fixed_image_bin_size
+        - histogram->fixed_image_normalized_min;
+      const float moving_term = moving_value / histogram->moving_image_bin_size
+        - histogram->moving_image_normalized_min;
+      const int fixed_index = (int)( floor( fixed_term
+        + histogram->fixed_parzen_term_to_index_offset ) );
+      const int moving_index = (int)( floor( moving_term
+        + histogram->moving_parzen_term_to_index_offset ) );
+
+      // The limiters keep the windows inside the histogram, but guard
+      // against rounding in single precision.
+      if( fixed_index >= 0 && fixed_index + fixed_order < fixed_bins
+        && moving_index >= 0 && moving_index + moving_order < moving_bins )
+      {
+        float fixed_parzen_values[ 4 ];
+        float moving_parzen_values[ 4 ];
+        parzen_window_values( fixed_order, (float)( fixed_index ) - fixed_term, fixed_parzen_values );
+        parzen_window_values( moving_order, (float)( moving_index ) - moving_term, moving_parzen_values );
+
+        for( uint f = 0; f <= fixed_order; ++f )
+        {
+          const uint offset = mad24( (uint)( fixed_index ) + f, moving_bins, (uint)( moving_index ) );
+          for( uint m = 0; m <= moving_order; ++m )
+          {
+            atomic_add_local_float( &local_joint_pdf[ offset + m ],
+              fixed_parzen_values[ f ] * moving_parzen_values[ m ] );
+          }
+        }
+
+        atomic_inc( &local_count );
+        value_and_gradient = (float4)( moving_value, gradient );
+      }
+    }
+
+    moving_values_and_gradients[ s ] = value_and_gradient;
+  }
+
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  const uint group_id = get_group_id( 0 );
+  for( uint i = local_id; i < number_of_bins; i += local_size )
+  {
+    partial_joint_pdfs[ mad24( group_id, number_of_bins, i ) ] = local_joint_pdf[ i ];
+  }
+  if( local_id == 0 ) { partial_counts[ group_id ] = local_count; }
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Sum the joint histograms and sample counts of the work groups
+__kernel void ParzenWindowMutualInformationReduceJointPDF(
+  __global const float *partial_joint_pdfs,
+  __global const uint *partial_counts,
+  const uint number_of_groups,
+  const uint number_of_bins,
+  __global float *joint_pdf,
+  __global uint *number_of_pixels_counted )
+{
+  const uint i = get_global_id( 0 );
+  if( i < number_of_bins )
+  {
+    float sum = 0.0f;
+    for( uint g = 0; g < number_of_groups; ++g )
+    {
+      sum += partial_joint_pdfs[ mad24( g, number_of_bins, i ) ];
+    }
+    joint_pdf[ i ] = sum;
+  }
+
+  if( i == 0 )
+  {
+    uint count = 0;
+    for( uint g = 0; g < number_of_groups; ++g )
+    {
+      count += partial_counts[ g ];
+    }
+    (*number_of_pixels_counted) = count;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Add the contribution of each sample to the derivative, see
+// ParzenWindowMutualInformationImageToImageMetric::UpdateDerivativeLowMemory().
+#ifdef DIM_3
+__kernel void ParzenWindowMutualInformationDerivative(
+  __global const float4 *samples,
+  const uint number_of_samples,
+  __global const float4 *moving_values_and_gradients,
+  __constant GPUImageBase3D *coefficients_image_base,
+  const uint spline_order,
+  __constant GPUParzenWindowHistogram *histogram,
+  __global const float *pratio,
+  __global float *derivative )
+{
+  const uint s = get_global_id( 0 );
+  if( s >= number_of_samples ) { return; }
+
+  // Invalid samples, and samples without gradient, do not contribute
+  const float4 value_and_gradient = moving_values_and_gradients[ s ];
+  const float3 gradient = value_and_gradient.yzw;
+  if( gradient.x == 0.0f && gradient.y == 0.0f && gradient.z == 0.0f ) { return; }
+
+  const float4 sample = samples[ s ];
+  const uint moving_bins = histogram->number_of_moving_histogram_bins;
+  const uint fixed_order = histogram->fixed_kernel_bspline_order;
+  const uint moving_order = histogram->moving_kernel_bspline_order;
+
+  const float fixed_term = sample.w / histogram->fixed_image_bin_size
+    - histogram->fixed_image_normalized_min;
+  const float moving_term = value_and_gradient.x / histogram->moving_image_bin_size
+    - histogram->moving_image_normalized_min;
+  const int fixed_index = (int)( floor( fixed_term
+    + histogram->fixed_parzen_term_to_index_offset ) );
+  const int moving_index = (int)( floor( moving_term
+    + histogram->moving_parzen_term_to_index_offset ) );
+
+  float fixed_parzen_values[ 4 ];
+  float derivative_moving_parzen_values[ 4 ];
+  parzen_window_values( fixed_order, (float)( fixed_index ) - fixed_term, fixed_parzen_values );
+  parzen_window_derivative_values( moving_order, (float)( moving_index ) - moving_term,
+    derivative_moving_parzen_values );
+
+  // Sum over the Parzen window region
+  const float et = histogram->moving_image_bin_size;
+  float sum = 0.0f;
+  for( uint f = 0; f <= fixed_order; ++f )
+  {
+    const float fv_et = fixed_parzen_values[ f ] / et;
+    const uint offset = mad24( (uint)( fixed_index ) + f, moving_bins, (uint)( moving_index ) );
+    for( uint m = 0; m <= moving_order; ++m )
+    {
+      sum += pratio[ offset + m ] * fv_et * derivative_moving_parzen_values[ m ];
+    }
+  }
+  if( sum == 0.0f ) { return; }
+
+  // Scatter sum * imageJacobian to the parameters in the support region
+  metric_scatter_jacobian_gradient_product_3d( sample.xyz, sum * gradient,
+    spline_order, coefficients_image_base, derivative );
+}
+#endif // DIM_3
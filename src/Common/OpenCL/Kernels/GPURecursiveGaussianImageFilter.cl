@@ -23,17 +23,21 @@
 // Scientific Research (NWO NRG-2010.02 and NWO 639.021.124).
 //
 // OpenCL implementation of itk::RecursiveGaussianImageFilter
-
-#define _ELASTIX_USE_OPENCL_OPTIMIZATIONS 0
+//
+// Every work group filters a tile of adjacent lines. The lines of the tile
+// are copied to local memory, so that the global memory is read and written
+// with coalesced access in all directions: along x the tile is contiguous in
+// memory, along y and z the work items of a group handle adjacent x.
+// The causal and anticausal passes are fused, keeping the last four values of
+// the recursion in registers instead of private scratch arrays.
 
 //------------------------------------------------------------------------------
-// Exact copy of FilterDataArray from RecursiveSeparableImageFilter
-void filter_data_array( BUFFPIXELTYPE *outs,
-                        const BUFFPIXELTYPE *data,
-                        BUFFPIXELTYPE *scratch,
-                        const unsigned int ln,
-                        const float4 N, const float4 D, const float4 M,
-                        const float4 BN, const float4 BM )
+// Fused version of FilterDataArray from RecursiveSeparableImageFilter
+void filter_line( __local BUFFPIXELTYPE *outs,
+                  __local const BUFFPIXELTYPE *data,
+                  const uint ln,
+                  const float4 N, const float4 D, const float4 M,
+                  const float4 BN, const float4 BM )
 {
   /**
   * Causal direction pass
@@ -44,40 +48,31 @@ void filter_data_array( BUFFPIXELTYPE *outs,
   /**
   * Initialize borders
   */
-  scratch[0] = ( outV1   * N.x +   outV1 * N.y + outV1   * N.z + outV1 * N.w );
-  scratch[1] = ( data[1] * N.x +   outV1 * N.y + outV1   * N.z + outV1 * N.w );
-  scratch[2] = ( data[2] * N.x + data[1] * N.y + outV1   * N.z + outV1 * N.w );
-  scratch[3] = ( data[3] * N.x + data[2] * N.y + data[1] * N.z + outV1 * N.w );
+  BUFFPIXELTYPE s0 = ( outV1   * N.x +   outV1 * N.y + outV1   * N.z + outV1 * N.w );
+  BUFFPIXELTYPE s1 = ( data[1] * N.x +   outV1 * N.y + outV1   * N.z + outV1 * N.w );
+  BUFFPIXELTYPE s2 = ( data[2] * N.x + data[1] * N.y + outV1   * N.z + outV1 * N.w );
+  BUFFPIXELTYPE s3 = ( data[3] * N.x + data[2] * N.y + data[1] * N.z + outV1 * N.w );
 
   // note that the outV1 value is multiplied by the Boundary coefficients m_BNi
-  scratch[0] -= ( outV1      * BN.x + outV1      * BN.y + outV1      * BN.z + outV1 * BN.w );
-  scratch[1] -= ( scratch[0] * D.x  + outV1      * BN.y + outV1      * BN.z + outV1 * BN.w );
-  scratch[2] -= ( scratch[1] * D.x  + scratch[0] * D.y  + outV1      * BN.z + outV1 * BN.w );
-  scratch[3] -= ( scratch[2] * D.x  + scratch[1] * D.y  + scratch[0] * D.z  + outV1 * BN.w );
+  s0 -= ( outV1 * BN.x + outV1 * BN.y + outV1 * BN.z + outV1 * BN.w );
+  s1 -= ( s0    * D.x  + outV1 * BN.y + outV1 * BN.z + outV1 * BN.w );
+  s2 -= ( s1    * D.x  + s0    * D.y  + outV1 * BN.z + outV1 * BN.w );
+  s3 -= ( s2    * D.x  + s1    * D.y  + s0    * D.z  + outV1 * BN.w );
 
-  /**
-  * Recursively filter the rest
-  */
-  float4 data_small, scratch_small;
-  for ( uint i = 4; i < ln; ++i )
-  {
-#if _ELASTIX_USE_OPENCL_OPTIMIZATIONS
-    data_small    = (float4)( data[i], data[i - 1], data[i - 2], data[i - 3] );
-    scratch_small = (float4)( scratch[i - 1], scratch[i - 2], scratch[i - 3], scratch[i - 4] );
-    scratch[i]  = dot( data_small, N );
-    scratch[i] -= dot( scratch_small, D );
-#else
-    scratch[i]  = data[i]        * N.x + data[i - 1]    * N.y + data[i - 2]    * N.z + data[i - 3]    * N.w;
-    scratch[i] -= scratch[i - 1] * D.x + scratch[i - 2] * D.y + scratch[i - 3] * D.z + scratch[i - 4] * D.w;
-#endif
-  }
+  outs[0] = s0;
+  outs[1] = s1;
+  outs[2] = s2;
+  outs[3] = s3;
 
   /**
-  * Store the causal result
+  * Recursively filter the rest, s3 is the last value and s0 the fourth last
   */
-  for ( uint i = 0; i < ln; ++i )
+  for ( uint i = 4; i < ln; ++i )
   {
-    outs[i] = scratch[i];
+    BUFFPIXELTYPE s = data[i] * N.x + data[i - 1] * N.y + data[i - 2] * N.z + data[i - 3] * N.w;
+    s -= s3 * D.x + s2 * D.y + s1 * D.z + s0 * D.w;
+    outs[i] = s;
+    s0 = s1; s1 = s2; s2 = s3; s3 = s;
   }
 
   /**
@@ -89,272 +84,124 @@ void filter_data_array( BUFFPIXELTYPE *outs,
   /**
   * Initialize borders
   */
-  scratch[ln - 1] = ( outV2        * M.x + outV2        * M.y + outV2        * M.z + outV2 * M.w );
-  scratch[ln - 2] = ( data[ln - 1] * M.x + outV2        * M.y + outV2        * M.z + outV2 * M.w );
-  scratch[ln - 3] = ( data[ln - 2] * M.x + data[ln - 1] * M.y + outV2        * M.z + outV2 * M.w );
-  scratch[ln - 4] = ( data[ln - 3] * M.x + data[ln - 2] * M.y + data[ln - 1] * M.z + outV2 * M.w );
+  s0 = ( outV2        * M.x + outV2        * M.y + outV2        * M.z + outV2 * M.w );
+  s1 = ( data[ln - 1] * M.x + outV2        * M.y + outV2        * M.z + outV2 * M.w );
+  s2 = ( data[ln - 2] * M.x + data[ln - 1] * M.y + outV2        * M.z + outV2 * M.w );
+  s3 = ( data[ln - 3] * M.x + data[ln - 2] * M.y + data[ln - 1] * M.z + outV2 * M.w );
 
   // note that the outV2value is multiplied by the Boundary coefficients m_BMi
-  scratch[ln - 1] -= ( outV2           * BM.x + outV2           * BM.y + outV2           * BM.z + outV2 * BM.w );
-  scratch[ln - 2] -= ( scratch[ln - 1] * D.x  + outV2           * BM.y + outV2           * BM.z + outV2 * BM.w );
-  scratch[ln - 3] -= ( scratch[ln - 2] * D.x  + scratch[ln - 1] * D.y  + outV2           * BM.z + outV2 * BM.w );
-  scratch[ln - 4] -= ( scratch[ln - 3] * D.x  + scratch[ln - 2] * D.y  + scratch[ln - 1] * D.z  + outV2 * BM.w );
+  s0 -= ( outV2 * BM.x + outV2 * BM.y + outV2 * BM.z + outV2 * BM.w );
+  s1 -= ( s0    * D.x  + outV2 * BM.y + outV2 * BM.z + outV2 * BM.w );
+  s2 -= ( s1    * D.x  + s0    * D.y  + outV2 * BM.z + outV2 * BM.w );
+  s3 -= ( s2    * D.x  + s1    * D.y  + s0    * D.z  + outV2 * BM.w );
 
   /**
-  * Recursively filter the rest
+  * Roll the antiCausal part into the output
   */
-  for ( unsigned int i = ln - 4; i > 0; i-- )
-  {
-#if _ELASTIX_USE_OPENCL_OPTIMIZATIONS
-    data_small    = (float4)( data[i], data[i + 1], data[i + 2], data[i + 3] );
-    scratch_small = (float4)( scratch[i], scratch[i + 1], scratch[i + 2], scratch[i + 3] );
-    scratch[i - 1]  = dot( data_small, M );
-    scratch[i - 1] -= dot( scratch_small, D );
-#else
-    scratch[i - 1] = data[i]     * M.x + data[i + 1]    * M.y + data[i + 2]    * M.z + data[i + 3]    * M.w;
-    scratch[i - 1] -= scratch[i] * D.x + scratch[i + 1] * D.y + scratch[i + 2] * D.z + scratch[i + 3] * D.w;
-#endif
-  }
+  outs[ln - 1] += s0;
+  outs[ln - 2] += s1;
+  outs[ln - 3] += s2;
+  outs[ln - 4] += s3;
 
   /**
-  * Roll the antiCausal part into the output
+  * Recursively filter the rest, s3 is the last value and s0 the fourth last
   */
-  for ( uint i = 0; i < ln; ++i )
+  for ( uint i = ln - 4; i > 0; i-- )
   {
-    outs[i] += scratch[i];
+    BUFFPIXELTYPE s = data[i] * M.x + data[i + 1] * M.y + data[i + 2] * M.z + data[i + 3] * M.w;
+    s -= s3 * D.x + s2 * D.y + s1 * D.z + s0 * D.w;
+    outs[i - 1] += s;
+    s0 = s1; s1 = s2; s2 = s3; s3 = s;
   }
 }
 
 //------------------------------------------------------------------------------
-// Get global memory offset
-uint get_image_offset( const uint gix,
-                       const uint giy,
-                       const uint giz,
-                       const uint width, const uint height )
-{
-  uint gidx = mad24( width, mad24( giz, height, giy ), gix );
-
-  return gidx;
-}
-
-//------------------------------------------------------------------------------
-#ifdef DIM_1
-__kernel void RecursiveGaussianImageFilter( __global const INPIXELTYPE *in,
-                                            __global OUTPIXELTYPE *out,
-                                            unsigned int ln, int direction,
-                                            float4 N, float4 D, float4 M,
-                                            float4 BN, float4 BM,
-                                            uint width, uint height )
+// Get the global memory offset of the first pixel of a line, and the stride
+// between the pixels of the line.
+uint2 get_line_offset_and_stride( const uint line, const int direction,
+                                  const uint width, const uint height )
 {
-  uint index = get_global_id( 0 );
-
-  // Define length
-  uint length = 0;
-
   if ( direction == 0 )
   {
-    length = width;
+    // lines are ordered by (y, z)
+    return (uint2)( line * width, 1 );
   }
   else if ( direction == 1 )
   {
-    length = height;
+    // lines are ordered by (x, z)
+    const uint z = line / width;
+    return (uint2)( z * width * height + ( line - z * width ), width );
   }
 
-  if ( index < length )
-  {
-    // local buffers
-    BUFFPIXELTYPE inps[BUFFSIZE];
-    BUFFPIXELTYPE outs[BUFFSIZE];
-    BUFFPIXELTYPE scratch[BUFFSIZE];
-
-    // fill local input buffer
-    uint id = 0;
-    uint lidx = 0;
-
-    // Having if() statement inside loop will cost performance penalty.
-    // Therefore we are moving for() loop inside the if () statement.
-    // The code become less compact, but faster.
-    if ( height != 0 )
-    {
-      if ( direction == 0 )
-      {
-        for ( uint i = 0; i < length; ++i )
-        {
-          lidx = get_image_offset( i, 0, index, width, 1 );
-          inps[id++] = (BUFFPIXELTYPE)( in[lidx] );
-        }
-      }
-      else if ( direction == 1 )
-      {
-        for ( uint i = 0; i < length; ++i )
-        {
-          lidx = get_image_offset( index, 0, i, width, 1 );
-          inps[id++] = (BUFFPIXELTYPE)( in[lidx] );
-        }
-      }
-    }
-    else
-    {
-      for ( uint i = 0; i < length; ++i )
-      {
-        inps[id++] = (BUFFPIXELTYPE)( in[i] );
-      }
-    }
-
-    // Apply the recursive Filter to an array of data. This method is called
-    // for each line of the volume. Parameter "scratch" is a scratch
-    // area used for internal computations that is the same size as the
-    // parameters "outs" and "data".
-    filter_data_array( outs, inps, scratch, ln, N, D, M, BN, BM );
-
-    // copy to output
-    id = 0;
-
-    // Having if() statement inside loop will cost performance penalty.
-    // Therefore we are moving for() loop inside the if () statement.
-    // The code become less compact, but faster.
-    if ( height != 0 )
-    {
-      if ( direction == 0 )
-      {
-        for ( uint i = 0; i < length; ++i )
-        {
-          lidx = get_image_offset( i, 0, index, width, 1 );
-          out[lidx] = (OUTPIXELTYPE)( outs[id++] );
-        }
-      }
-      else if ( direction == 1 )
-      {
-        for ( uint i = 0; i < length; ++i )
-        {
-          lidx = get_image_offset( index, 0, i, width, 1 );
-          out[lidx] = (OUTPIXELTYPE)( outs[id++] );
-        }
-      }
-    }
-    else
-    {
-      for ( uint i = 0; i < length; ++i )
-      {
-        out[i] = (OUTPIXELTYPE)( outs[id++] );
-      }
-    }
-  }
+  // lines are ordered by (x, y)
+  return (uint2)( line, width * height );
 }
 
-#endif
-
 //------------------------------------------------------------------------------
-#ifdef DIM_2
+// The local buffers hold ln pixels of every line of the tile, with a pitch of
+// (ln | 1) to avoid local memory bank conflicts.
 __kernel void RecursiveGaussianImageFilter( __global const INPIXELTYPE *in,
                                             __global OUTPIXELTYPE *out,
                                             unsigned int ln, int direction,
                                             float4 N, float4 D, float4 M,
                                             float4 BN, float4 BM,
-                                            uint width, uint height, uint depth )
+                                            uint width, uint height, uint depth,
+                                            __local BUFFPIXELTYPE *data,
+                                            __local BUFFPIXELTYPE *outs )
 {
-  uint2 index = (uint2)( get_global_id( 0 ), get_global_id( 1 ) );
+  const uint number_of_lines = ( width * height * depth ) / ln;
+  const uint tile_width      = get_local_size( 0 );
+  const uint first_line      = get_group_id( 0 ) * tile_width;
+  const uint lid             = get_local_id( 0 );
+  const uint pitch           = ln | 1;
 
-  // 0 (direction x) : y/z
-  // 1 (direction y) : x/z
-  // 2 (direction z) : x/y
-  uint3 length;
+  // The number of lines in this tile, the last tile may be partial
+  const uint tile_lines = min( tile_width, number_of_lines - first_line );
+  const uint2 line = get_line_offset_and_stride( first_line + lid, direction, width, height );
 
+  // Copy the tile to local memory
   if ( direction == 0 )
   {
-    length.x = height;
-    length.y = depth;
-    length.z = width;  // looping over
+    // The tile is contiguous in global memory
+    const uint offset = first_line * ln;
+    for ( uint k = lid; k < tile_lines * ln; k += tile_width )
+    {
+      const uint r = k / ln;
+      data[r * pitch + k - r * ln] = (BUFFPIXELTYPE)( in[offset + k] );
+    }
   }
-  else if ( direction == 1 )
+  else if ( lid < tile_lines )
   {
-    length.x = width;
-    length.y = depth;
-    length.z = height; // looping over
+    // Adjacent work items read adjacent pixels
+    for ( uint i = 0; i < ln; ++i )
+    {
+      data[lid * pitch + i] = (BUFFPIXELTYPE)( in[line.x + i * line.y] );
+    }
   }
-  else if ( direction == 2 )
+  barrier( CLK_LOCAL_MEM_FENCE );
+
+  // Apply the recursive Filter to the line of this work item.
+  if ( lid < tile_lines )
   {
-    length.x = width;
-    length.y = height;
-    length.z = depth;  // looping over
+    filter_line( outs + lid * pitch, data + lid * pitch, ln, N, D, M, BN, BM );
   }
+  barrier( CLK_LOCAL_MEM_FENCE );
 
-  if ( index.x < length.x && index.y < length.y )
+  // Copy the tile to the output
+  if ( direction == 0 )
   {
-    // local buffers
-    BUFFPIXELTYPE inps[BUFFSIZE];
-    BUFFPIXELTYPE outs[BUFFSIZE];
-    BUFFPIXELTYPE scratch[BUFFSIZE];
-
-    // fill local input buffer
-    uint id = 0;
-    uint lidx = 0;
-
-    // Having if() statement inside loop will cost performance penalty.
-    // Therefore we are moving for() loop inside the if () statement.
-    // The code become less compact, but faster.
-    if ( direction == 0 )
-    {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( i, index.x, index.y, width, height );
-        inps[id++] = (BUFFPIXELTYPE)( in[lidx] );
-      }
-    }
-    else if ( direction == 1 )
-    {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( index.x, i, index.y, width, height );
-        inps[id++] = (BUFFPIXELTYPE)( in[lidx] );
-      }
-    }
-    else if ( direction == 2 )
+    const uint offset = first_line * ln;
+    for ( uint k = lid; k < tile_lines * ln; k += tile_width )
     {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( index.x, index.y, i, width, height );
-        inps[id++] = (BUFFPIXELTYPE)( in[lidx] );
-      }
+      const uint r = k / ln;
+      out[offset + k] = (OUTPIXELTYPE)( outs[r * pitch + k - r * ln] );
     }
-
-    // Apply the recursive Filter to an array of data. This method is called
-    // for each line of the volume. Parameter "scratch" is a scratch
-    // area used for internal computations that is the same size as the
-    // parameters "outs" and "data".
-    filter_data_array( outs, inps, scratch, ln, N, D, M, BN, BM );
-
-    // copy to output
-    id = 0;
-
-    // Having if() statement inside loop will cost performance penalty.
-    // Therefore we are moving for() loop inside the if () statement.
-    // The code become less compact, but faster.
-    if ( direction == 0 )
-    {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( i, index.x, index.y, width, height );
-        out[lidx] = (OUTPIXELTYPE)( outs[id++] );
-      }
-    }
-    else if ( direction == 1 )
-    {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( index.x, i, index.y, width, height );
-        out[lidx] = (OUTPIXELTYPE)( outs[id++] );
-      }
-    }
-    else if ( direction == 2 )
+  }
+  else if ( lid < tile_lines )
+  {
+    for ( uint i = 0; i < ln; ++i )
     {
-      for ( uint i = 0; i < length.z; ++i )
-      {
-        lidx = get_image_offset( index.x, index.y, i, width, height );
-        out[lidx] = (OUTPIXELTYPE)( outs[id++] );
-      }
+      out[line.x + i * line.y] = (OUTPIXELTYPE)( outs[lid * pitch + i] );
     }
   }
 }
-
-#endif
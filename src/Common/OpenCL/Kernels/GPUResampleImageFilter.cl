@@ -288,7 +288,7 @@ __kernel void ResampleImageFilterLoop_BSplineTransform(
 #endif
 
 //------------------------------------------------------------------------------
-#if defined( DIM_1 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR )
+#if defined( DIM_1 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR ) && !defined( RAYCAST_INTERPOLATOR )
 __kernel void ResampleImageFilterPost(
   /* Transformation field buffer */
   __global const float *transformation_field,
@@ -562,7 +562,7 @@ __kernel void ResampleImageFilterLoop_BSplineTransform(
 #endif
 
 //------------------------------------------------------------------------------
-#if defined( DIM_2 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR )
+#if defined( DIM_2 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR ) && !defined( RAYCAST_INTERPOLATOR )
 __kernel void ResampleImageFilterPost(
   /* Transformation field buffer */
   __global const float2 *transformation_field,
@@ -615,6 +615,62 @@ __kernel void ResampleImageFilterPost(
 }
 #endif
 
+//------------------------------------------------------------------------------
+// The linear interpolator by the texture sampler of the device, see the 3D
+// ResampleImageFilterPost_TextureInterpolator.
+#if defined( DIM_2 ) && defined( RESAMPLE_POST ) && defined( TEXTURE_INTERPOLATOR )
+__kernel void ResampleImageFilterPost_TextureInterpolator(
+  /* Transformation field buffer */
+  __global const float2 *transformation_field,
+  /* Transformation field size */
+  uint2 transformation_field_size,
+  /* Input image texture */
+  __read_only image2d_t in,
+  /* Linear sampler of the input image texture */
+  sampler_t in_sampler,
+  /* Input image meta information. */
+  __constant GPUImageBase2D * input_image,
+  /* Output image buffer */
+  __global OUTPIXELTYPE *out,
+  /* Output image size */
+  uint2 output_image_size,
+  /* Filter parameters */
+  __constant FilterParameters *parameters,
+  /* Image function parameters. NOTE: Should be defined as __constant, but fails on GeForce GTX 780. */
+  __global GPUImageFunction2D *image_function )
+{
+  // Get current image index
+  uint2 global_id = get_global_id_2d();
+  uint2 index = get_current_image_index_2d( global_id );
+
+  if( is_valid_2d( index, transformation_field_size ) && is_valid_2d( global_id, output_image_size ) )
+  {
+    const uint tidx = mad24( transformation_field_size.x, index.y, index.x );
+    const uint gidx = mad24( output_image_size.x, global_id.y, global_id.x );
+
+    // Get the transformed point
+    const float2 transformed_point = transformation_field[tidx];
+    // Convert to continuous index
+    float2 continuous_index;
+    transform_physical_point_to_continuous_index_2d(
+      transformed_point, &continuous_index, input_image );
+
+    // sample the input texture at right position and copy to the output
+    if( interpolator_is_inside_buffer_2d( continuous_index,
+      image_function->start_continuous_index, image_function->end_continuous_index ) )
+    {
+      OUTPIXELTYPE value = read_imagef( in, in_sampler, continuous_index + 0.5f ).x;
+      out[gidx] = cast_pixel_with_bounds_checking(
+        value, parameters->min_max, parameters->min_max_output );
+    }
+    else
+    {
+      out[gidx] = parameters->default_value;
+    }
+  }
+}
+#endif
+
 //------------------------------------------------------------------------------
 #if defined( DIM_2 ) && defined( RESAMPLE_POST ) && defined( BSPLINE_INTERPOLATOR )
 __kernel void ResampleImageFilterPost_BSplineInterpolator(
@@ -848,7 +904,7 @@ __kernel void ResampleImageFilterLoop_BSplineTransform(
 #endif
 
 //------------------------------------------------------------------------------
-#if defined( DIM_3 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR )
+#if defined( DIM_3 ) && defined( RESAMPLE_POST ) && !defined( BSPLINE_INTERPOLATOR ) && !defined( RAYCAST_INTERPOLATOR )
 __kernel void ResampleImageFilterPost(
   /* Transformation field buffer */
   __global const float3 *transformation_field,
@@ -904,6 +960,68 @@ __kernel void ResampleImageFilterPost(
 }
 #endif
 
+//------------------------------------------------------------------------------
+// The linear interpolator by the texture sampler of the device. The input is
+// an image object, of which the texel centers are at the integer indices plus
+// one half. The sampler clamps to the edge of the image, and computes the
+// interpolation weights with a reduced precision.
+#if defined( DIM_3 ) && defined( RESAMPLE_POST ) && defined( TEXTURE_INTERPOLATOR )
+__kernel void ResampleImageFilterPost_TextureInterpolator(
+  /* Transformation field buffer */
+  __global const float3 *transformation_field,
+  /* Transformation field size */
+  uint3 transformation_field_size,
+  /* Input image texture */
+  __read_only image3d_t in,
+  /* Linear sampler of the input image texture */
+  sampler_t in_sampler,
+  /* Input image meta information. */
+  __constant GPUImageBase3D * input_image,
+  /* Output image buffer */
+  __global OUTPIXELTYPE *out,
+  /* Output image size */
+  uint3 output_image_size,
+  /* Filter parameters */
+  __constant FilterParameters *parameters,
+  /* Image function parameters. NOTE: Should be defined as __constant, but fails on GeForce GTX 780. */
+  __global GPUImageFunction3D *image_function )
+{
+  // Get current image index
+  uint3 global_id = get_global_id_3d();
+  uint3 index = get_current_image_index_3d( global_id );
+
+  if( is_valid_3d( index, transformation_field_size ) && is_valid_3d( global_id, output_image_size ) )
+  {
+    const uint tidx = mad24( transformation_field_size.x,
+      mad24( index.z, transformation_field_size.y, index.y ), index.x );
+    const uint gidx = mad24( output_image_size.x,
+      mad24( global_id.z, output_image_size.y, global_id.y ), global_id.x );
+
+    // Get the transformed point
+    const float3 transformed_point = transformation_field[tidx];
+    // Convert to continuous index
+    float3 continuous_index
+      = transform_physical_point_to_continuous_index_3d( transformed_point,
+      input_image->physical_point_to_index, input_image->origin );
+
+    // sample the input texture at right position and copy to the output
+    if( interpolator_is_inside_buffer_3d( continuous_index,
+      image_function->start_continuous_index, image_function->end_continuous_index ) )
+    {
+      const float4 coordinate = (float4)( continuous_index + 0.5f, 0.0f );
+      OUTPIXELTYPE value = read_imagef( in, in_sampler, coordinate ).x;
+
+      out[gidx] = cast_pixel_with_bounds_checking(
+        value, parameters->min_max, parameters->min_max_output );
+    }
+    else
+    {
+      out[gidx] = parameters->default_value;
+    }
+  }
+}
+#endif
+
 //------------------------------------------------------------------------------
 #if defined( DIM_3 ) && defined( RESAMPLE_POST ) && defined( BSPLINE_INTERPOLATOR )
 __kernel void ResampleImageFilterPost_BSplineInterpolator(
@@ -966,3 +1084,86 @@ __kernel void ResampleImageFilterPost_BSplineInterpolator(
   }
 }
 #endif
+
+//------------------------------------------------------------------------------
+#if defined( DIM_3 ) && defined( RESAMPLE_POST ) && defined( RAYCAST_INTERPOLATOR )
+__kernel void ResampleImageFilterPost_RayCastInterpolator(
+  /* Transformation field buffer */
+  __global const float3 *transformation_field,
+  /* Transformation field size */
+  uint3 transformation_field_size,
+  /* Input image buffer */
+  __global const INPIXELTYPE *in,
+  /* Input image meta information. */
+  __constant GPUImageBase3D * input_image,
+  /* Output image buffer */
+  __global OUTPIXELTYPE *out,
+  /* Output image size */
+  uint3 output_image_size,
+  /* Filter parameters */
+  __constant FilterParameters *parameters,
+  /* Ray cast parameters. NOTE: Should be defined as __constant, but fails on GeForce GTX 780. */
+  __global GPURayCastImageFunction3D *image_function )
+{
+  // Get current image index
+  uint3 global_id = get_global_id_3d();
+  uint3 index = get_current_image_index_3d( global_id );
+
+  if( is_valid_3d( index, transformation_field_size ) && is_valid_3d( global_id, output_image_size ) )
+  {
+    const uint tidx = mad24( transformation_field_size.x,
+      mad24( index.z, transformation_field_size.y, index.y ), index.x );
+    const uint gidx = mad24( output_image_size.x,
+      mad24( global_id.z, output_image_size.y, global_id.y ), global_id.x );
+
+    // Get the transformed point
+    const float3 transformed_point = transformation_field[tidx];
+
+    // Cast the ray from the transformed point to the focal point. Like on the
+    // CPU, the ray cast interpolator is defined at every point, so the
+    // default value is never used.
+    OUTPIXELTYPE value = raycast_integrate_above_threshold_3d(
+      transformed_point, image_function->focal_point, image_function->threshold,
+      in, input_image->size, input_image->spacing );
+
+    out[gidx] = cast_pixel_with_bounds_checking(
+      value, parameters->min_max, parameters->min_max_output );
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// This kernel computes the bounding box of the transformed points of a split
+// in input continuous indices, for the tiled execution of
+// itk::GPUResampleImageFilter. Every work item loops over a part of the
+// points, and stores its minimum and maximum at 2 * gid and 2 * gid + 1.
+#if defined( DIM_3 ) && defined( RESAMPLE_POST ) && !defined( RAYCAST_INTERPOLATOR )
+__kernel void ResampleImageFilterBoundingBox(
+  /* Transformation field buffer */
+  __global const float3 *transformation_field,
+  /* Transformation field size */
+  uint3 transformation_field_size,
+  /* Input image meta information. */
+  __constant GPUImageBase3D * input_image,
+  /* Minimum and maximum continuous index of every work item */
+  __global float *bounding_boxes )
+{
+  const uint gid = get_global_id( 0 );
+  const uint number_of_points = transformation_field_size.x
+    * transformation_field_size.y * transformation_field_size.z;
+
+  float3 min_index = (float3)( FLT_MAX );
+  float3 max_index = (float3)( -FLT_MAX );
+  for( uint i = gid; i < number_of_points; i += get_global_size( 0 ) )
+  {
+    const float3 continuous_index
+      = transform_physical_point_to_continuous_index_3d( transformation_field[i],
+      input_image->physical_point_to_index, input_image->origin );
+    min_index = fmin( min_index, continuous_index );
+    max_index = fmax( max_index, continuous_index );
+  }
+
+  vstore3( min_index, 2 * gid, bounding_boxes );
+  vstore3( max_index, 2 * gid + 1, bounding_boxes );
+}
+#endif
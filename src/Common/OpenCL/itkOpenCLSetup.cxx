@@ -27,7 +27,8 @@ namespace itk
 bool
 CreateOpenCLContext( std::string & errorMessage,
   const std::string openCLDeviceType,
-  const int openCLDeviceID )
+  const int openCLDeviceID,
+  const bool useMultipleDevices )
 {
   /** Get a handle to an existing OpenCL context. */
   itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
@@ -41,8 +42,16 @@ CreateOpenCLContext( std::string & errorMessage,
   if( openCLDeviceType == "GPU" && openCLDeviceID == -1 )
   {
 #if defined( OPENCL_USE_INTEL_CPU ) || defined( OPENCL_USE_AMD_CPU )
+    if( useMultipleDevices )
+    {
+      return context->Create( itk::OpenCLContext::DevelopmentMultipleMaximumFlopsDevices );
+    }
     return context->Create( itk::OpenCLContext::DevelopmentSingleMaximumFlopsDevice );
 #else
+    if( useMultipleDevices )
+    {
+      return context->Create( itk::OpenCLContext::MultipleMaximumFlopsDevices );
+    }
     return context->Create( itk::OpenCLContext::SingleMaximumFlopsDevice );
 #endif
   }
@@ -207,4 +216,39 @@ CreateOpenCLLogger( const std::string & prefixFileName, const std::string & outp
 } // end CreateOpenCLLogger()
 
 
+//------------------------------------------------------------------------------
+void
+SetOpenCLProgramCacheDirectory( const std::string & directory )
+{
+  /** Set the directory of the OpenCL program binaries, empty disables it. */
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  context->SetProgramCacheDirectory( directory );
+} // end SetOpenCLProgramCacheDirectory()
+
+
+//------------------------------------------------------------------------------
+void
+SetOpenCLProfilingEnabled( const bool enabled )
+{
+  /** Enable the profiler before the command queues are created. */
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  context->GetProfiler().SetEnabled( enabled );
+} // end SetOpenCLProfilingEnabled()
+
+
+//------------------------------------------------------------------------------
+void
+PrintOpenCLProfiling( std::ostream & os )
+{
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  if( !context->GetProfiler().GetEnabled() )
+  {
+    return;
+  }
+
+  context->GetProfiler().Print( os );
+  context->GetProfiler().Reset();
+} // end PrintOpenCLProfiling()
+
+
 } // end namespace itk
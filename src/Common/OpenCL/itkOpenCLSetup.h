@@ -18,6 +18,7 @@
 #ifndef __itkOpenCLSetup_h
 #define __itkOpenCLSetup_h
 
+#include <ostream>
 #include <string>
 
 /** This file contains helper functionality to enable
@@ -25,13 +26,29 @@
  */
 namespace itk
 {
-/** Method that is used to create OpenCL context within elastix and transformix. */
+/** Method that is used to create OpenCL context within elastix and transformix.
+ * If \a useMultipleDevices is true and no device ID is given, the context
+ * is created with all devices of the best performing platform. The GPU filters
+ * are then spread over these devices, see OpenCLContext::AcquireDevice(). */
 bool CreateOpenCLContext( std::string & errorMessage,
-  const std::string openCLDeviceType, const int openCLDeviceID );
+  const std::string openCLDeviceType, const int openCLDeviceID,
+  const bool useMultipleDevices = false );
 
 /** Method that is used to create OpenCL logger within elastix and transformix. */
 void CreateOpenCLLogger( const std::string & prefixFileName, const std::string & outputDirectory );
 
+/** Method that is used to set the OpenCL program cache directory within elastix and transformix. */
+void SetOpenCLProgramCacheDirectory( const std::string & directory );
+
+/** Method that is used to enable the OpenCL profiling within elastix and transformix.
+ * It has to be called before CreateOpenCLContext(), see OpenCLContext::GetProfiler(). */
+void SetOpenCLProfilingEnabled( const bool enabled );
+
+/** Method that is used to print the OpenCL profiling statistics within elastix and
+ * transformix. The statistics are reset afterwards. Nothing is printed if the
+ * profiling is disabled. */
+void PrintOpenCLProfiling( std::ostream & os );
+
 } // end namespace itk
 
 #endif
@@ -22,7 +22,18 @@
 #include "itkParameterFileParser.h"
 
 #include <itksys/SystemTools.hxx>
-#include <itksys/RegularExpression.hxx>
+
+#include <algorithm>
+
+namespace
+{
+// Tabs are treated as spaces
+inline bool
+IsSpace( const char c )
+{
+  return c == ' ' || c == '\t';
+}
+}
 
 namespace itk
 {
@@ -98,30 +109,40 @@ ParameterFileParser
   /** Clear the map. */
   this->m_ParameterMap.clear();
 
-  /** Loop over the parameter file, line by line. */
-  std::string lineIn  = "";
-  std::string lineOut = "";
-  while( this->m_ParameterFile.good() )
+  /** Read the complete file at once. In text mode the number of characters
+   * read may be smaller than the file size, due to line end conversion.
+   */
+  this->m_ParameterFile.seekg( 0, std::ios::end );
+  const std::streamoff fileSize = this->m_ParameterFile.tellg();
+  this->m_ParameterFile.seekg( 0, std::ios::beg );
+  std::string content( fileSize > 0 ? static_cast< std::size_t >( fileSize ) : 0, '\0' );
+  if( !content.empty() )
   {
-    /** Extract a line. */
-    itksys::SystemTools::GetLineFromStream( this->m_ParameterFile, lineIn );
+    this->m_ParameterFile.read( &content[ 0 ], content.size() );
+    content.resize( static_cast< std::size_t >( this->m_ParameterFile.gcount() ) );
+  }
 
-    /** Check this line. */
-    bool validLine = this->CheckLine( lineIn, lineOut );
+  /** Close the parameter file. */
+  this->m_ParameterFile.clear();
+  this->m_ParameterFile.close();
 
-    if( validLine )
+  /** Loop over the content, line by line. */
+  const char * contentEnd = content.data() + content.size();
+  const char * lineBegin  = content.data();
+  while( lineBegin < contentEnd )
+  {
+    const char * lineEnd = std::find( lineBegin, contentEnd, '\n' );
+    const char * next    = lineEnd == contentEnd ? contentEnd : lineEnd + 1;
+    if( lineEnd != lineBegin && *( lineEnd - 1 ) == '\r' )
     {
-      /** Get the parameter name from this line and store it. */
-      this->GetParameterFromLine( lineIn, lineOut );
+      --lineEnd;
     }
-    // Otherwise, we simply ignore this line
 
+    /** Store the parameter of this line, if any. */
+    this->ParseLine( lineBegin, lineEnd );
+    lineBegin = next;
   }
 
-  /** Close the parameter file. */
-  this->m_ParameterFile.clear();
-  this->m_ParameterFile.close();
-
 } // end ReadParameterFile()
 
 
@@ -173,233 +194,139 @@ ParameterFileParser
 
 
 /**
- * **************** CheckLine ***************
+ * **************** ParseLine ***************
  */
 
-bool
+void
 ParameterFileParser
-::CheckLine( const std::string & lineIn, std::string & lineOut ) const
+::ParseLine( const char * lineBegin, const char * lineEnd )
 {
-  /** Preprocessing of lineIn:
-   * 1) Replace tabs with spaces
-   * 2) Remove everything after comment sign //
-   * 3) Remove leading spaces
-   * 4) Remove trailing spaces
+  /** Remove everything after the comment sign //, and the leading and
+   * trailing spaces. Empty lines and comments are ignored.
    */
-  lineOut = lineIn;
-  itksys::SystemTools::ReplaceString( lineOut, "\t", " " );
-
-  itksys::RegularExpression commentPart( "//" );
-  if( commentPart.find( lineOut ) )
+  const char * end = lineBegin;
+  while( end != lineEnd && !( *end == '/' && end + 1 != lineEnd && *( end + 1 ) == '/' ) )
   {
-    lineOut = lineOut.substr( 0, commentPart.start() );
+    ++end;
   }
-
-  itksys::RegularExpression leadingSpaces( "^[ ]*(.*)" );
-  leadingSpaces.find( lineOut );
-  lineOut = leadingSpaces.match( 1 );
-
-  itksys::RegularExpression trailingSpaces( "[ \t]+$" );
-  if( trailingSpaces.find( lineOut ) )
-  {
-    lineOut = lineOut.substr( 0, trailingSpaces.start() );
-  }
-
-  /**
-   * Checks:
-   * 1. Empty line -> false
-   * 2. Comment (line starts with "//") -> false
-   * 3. Line is not between brackets (...) -> exception
-   * 4. Line contains less than two words -> exception
-   *
-   * Otherwise return true.
-   */
-
-  /** 1. Check for non-empty lines. */
-  itksys::RegularExpression reNonEmptyLine( "[^ ]+" );
-  bool                      match1 = reNonEmptyLine.find( lineOut );
-  if( !match1 )
+  const char * begin = lineBegin;
+  while( begin != end && IsSpace( *begin ) )
   {
-    return false;
+    ++begin;
   }
-
-  /** 2. Check for comments. */
-  itksys::RegularExpression reComment( "^//" );
-  bool                      match2 = reComment.find( lineOut );
-  if( match2 )
+  while( end != begin && IsSpace( *( end - 1 ) ) )
   {
-    return false;
+    --end;
   }
-
-  /** 3. Check if line is between brackets. */
-  if( !itksys::SystemTools::StringStartsWith( lineOut.c_str(), "(" )
-    || !itksys::SystemTools::StringEndsWith( lineOut.c_str(), ")" ) )
+  if( begin == end )
   {
-    std::string hint = "Line is not between brackets: \"(...)\".";
-    this->ThrowException( lineIn, hint );
+    return;
   }
 
-  /** Remove brackets. */
-  lineOut = lineOut.substr( 1, lineOut.size() - 2 );
-
-  /** 4. Check: the line should contain at least two words. */
-  itksys::RegularExpression reTwoWords( "([ ]+)([^ ]+)" );
-  bool                      match4 = reTwoWords.find( lineOut );
-  if( !match4 )
+  /** The line should be between brackets. */
+  if( *begin != '(' || *( end - 1 ) != ')' || end - begin < 2 )
   {
-    std::string hint = "Line does not contain a parameter name and value.";
-    this->ThrowException( lineIn, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ),
+      "Line is not between brackets: \"(...)\"." );
   }
+  ++begin;
+  --end;
 
-  /** At this point we know its at least a line containing a parameter.
-   * However, this line can still be invalid, for example:
-   * (string &^%^*)
-   * This will be checked later.
+  /** The line should contain at least two words, strings should start and
+   * end with a quote, so the number of quotes should be even, and the
+   * number of values is at most the number of separators.
    */
-
-  return true;
-
-} // end CheckLine()
-
-
-/**
- * **************** GetParameterFromLine ***************
- */
-
-void
-ParameterFileParser
-::GetParameterFromLine( const std::string & fullLine,
-  const std::string & line )
-{
-  /** A line has a parameter name followed by one or more parameters.
-   * They are all separated by one or more spaces (all tabs have been
-   * removed previously) or by quotes in case of strings. So,
-   * 1) we split the line at the spaces or quotes
-   * 2) the first one is the parameter name
-   * 3) the other strings that are not a series of spaces, are parameter values
-   */
-
-  /** 1) Split the line. */
-  std::vector< std::string > splittedLine;
-  this->SplitLine( fullLine, line, splittedLine );
-
-  /** 2) Get the parameter name. */
-  std::string parameterName = splittedLine[ 0 ];
-  itksys::SystemTools::ReplaceString( parameterName, " ", "" );
-  splittedLine.erase( splittedLine.begin() );
-
-  /** 3) Get the parameter values. */
-  std::vector< std::string > parameterValues;
-  for( unsigned int i = 0; i < splittedLine.size(); ++i )
+  bool        twoWords       = false;
+  std::size_t numberOfQuotes = 0;
+  std::size_t numberOfSpaces = 0;
+  for( const char * it = begin; it != end; ++it )
   {
-    if( splittedLine[ i ] != "" )
+    if( *it == '"' )
     {
-      parameterValues.push_back( splittedLine[ i ] );
+      ++numberOfQuotes;
     }
-  }
-
-  /** 4) Perform some checks on the parameter name. */
-  itksys::RegularExpression reInvalidCharacters1( "[.,:;!@#$%^&-+|<>?]" );
-  bool                      match = reInvalidCharacters1.find( parameterName );
-  if( match )
-  {
-    std::string hint = "The parameter \""
-      + parameterName
-      + "\" contains invalid characters (.,:;!@#$%^&-+|<>?).";
-    this->ThrowException( fullLine, hint );
-  }
-
-  /** 5) Perform checks on the parameter values. */
-  itksys::RegularExpression reInvalidCharacters2( "[,;!@#$%&|<>?]" );
-  for( unsigned int i = 0; i < parameterValues.size(); ++i )
-  {
-    /** For all entries some characters are not allowed. */
-    if( reInvalidCharacters2.find( parameterValues[ i ] ) )
+    if( IsSpace( *it ) )
     {
-      std::string hint = "The parameter value \""
-        + parameterValues[ i ]
-        + "\" contains invalid characters (,;!@#$%&|<>?).";
-      this->ThrowException( fullLine, hint );
+      ++numberOfSpaces;
+    }
+    else if( it != begin && IsSpace( *( it - 1 ) ) )
+    {
+      twoWords = true;
     }
   }
-
-  /** 6) Insert this combination in the parameter map. */
-  if( this->m_ParameterMap.count( parameterName ) )
+  if( !twoWords )
   {
-    std::string hint = "The parameter \""
-      + parameterName
-      + "\" is specified more than once.";
-    this->ThrowException( fullLine, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ),
+      "Line does not contain a parameter name and value." );
   }
-  else
+  if( numberOfQuotes % 2 == 1 )
   {
-    this->m_ParameterMap.insert( make_pair( parameterName, parameterValues ) );
+    this->ThrowException( std::string( lineBegin, lineEnd ),
+      "This line has an odd number of quotes (\")." );
   }
 
-} // end GetParameterFromLine()
-
-
-/**
- * **************** SplitLine ***************
- */
-
-void
-ParameterFileParser
-::SplitLine( const std::string & fullLine, const std::string & line,
-  std::vector< std::string > & splittedLine ) const
-{
-  splittedLine.clear();
-  splittedLine.resize( 1 );
-  std::vector< itksys::String > splittedLine1;
-
-  /** Count the number of quotes in the line. If it is an odd value, the
-   * line contains an error; strings should start and end with a quote, so
-   * the total number of quotes is even.
+  /** Split the line in a single pass, at the quotes, and at the spaces that
+   * are not between quotes. The first element is the parameter name, the
+   * other elements that are not empty are the values, which are stored in
+   * the map directly.
+   * The invalid characters of the name are those of the regular expression
+   * [.,:;!@#$%^&-+|<>?] that was used before, in which &-+ is a range.
    */
-  std::size_t numQuotes = itksys::SystemTools::CountChar( line.c_str(), '"' );
-  if( numQuotes % 2 == 1 )
+  const char * const    invalidNameCharacters  = ".,:;!@#$%^&'()*+|<>?";
+  const char * const    invalidValueCharacters = ",;!@#$%&|<>?";
+  ParameterValuesType * parameterValues        = 0;
+  const char *          elementBegin           = begin;
+  bool                  betweenQuotes          = false;
+  for( const char * it = begin; ; ++it )
   {
-    /** An invalid parameter line. */
-    std::string hint = "This line has an odd number of quotes (\").";
-    this->ThrowException( fullLine, hint );
-  }
-
-  /** Loop over the line. */
-  std::string::const_iterator it;
-  unsigned int                index = 0;
-  numQuotes = 0;
-  for( it = line.begin(); it < line.end(); ++it )
-  {
-    if( *it == '"' )
+    const bool atEnd = it == end;
+    if( !atEnd && *it != '"' && ( betweenQuotes || !IsSpace( *it ) ) )
     {
-      /** Start a new element. */
-      splittedLine.push_back( "" );
-      index++;
-      numQuotes++;
+      continue;
     }
-    else if( *it == ' ' )
+
+    if( parameterValues == 0 )
     {
-      /** Only start a new element if it is not a quote, otherwise just add
-       * the space to the string.
-       */
-      if( numQuotes % 2 == 0 )
+      /** The parameter name. */
+      const std::string parameterName( elementBegin, it );
+      if( parameterName.find_first_of( invalidNameCharacters ) != std::string::npos )
+      {
+        this->ThrowException( std::string( lineBegin, lineEnd ), "The parameter \""
+          + parameterName + "\" contains invalid characters (.,:;!@#$%^&-+|<>?)." );
+      }
+      if( this->m_ParameterMap.count( parameterName ) )
       {
-        splittedLine.push_back( "" );
-        index++;
+        this->ThrowException( std::string( lineBegin, lineEnd ), "The parameter \""
+          + parameterName + "\" is specified more than once." );
       }
-      else
+      parameterValues = &this->m_ParameterMap[ parameterName ];
+      parameterValues->reserve( numberOfSpaces + numberOfQuotes / 2 );
+    }
+    else if( it != elementBegin )
+    {
+      /** A parameter value, of which the tabs between quotes become spaces. */
+      parameterValues->push_back( std::string( elementBegin, it ) );
+      std::string & value = parameterValues->back();
+      std::replace( value.begin(), value.end(), '\t', ' ' );
+      if( value.find_first_of( invalidValueCharacters ) != std::string::npos )
       {
-        splittedLine[ index ].push_back( *it );
+        this->ThrowException( std::string( lineBegin, lineEnd ), "The parameter value \""
+          + value + "\" contains invalid characters (,;!@#$%&|<>?)." );
       }
     }
-    else
+
+    if( atEnd )
+    {
+      break;
+    }
+    if( *it == '"' )
     {
-      /** Add this character to the element. */
-      splittedLine[ index ].push_back( *it );
+      betweenQuotes = !betweenQuotes;
     }
+    elementBegin = it + 1;
   }
 
-} // end SplitLine()
+} // end ParseLine()
 
 
 /**
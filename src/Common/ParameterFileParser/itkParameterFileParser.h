@@ -131,20 +131,12 @@ private:
    */
   void BasicFileChecking( void ) const;
 
-  /** Checks a line.
-   * - Returns  true if it is a valid line: containing a parameter.
-   * - Returns false if it is a valid line: empty or comment.
+  /** Parses a line in a single pass, and stores its parameter name and
+   * values in m_ParameterMap.
+   * - Does nothing if the line is empty or a comment.
    * - Throws an exception if it is not a valid line.
    */
-  bool CheckLine( const std::string & line, std::string & lineOut ) const;
-
-  /** Fills m_ParameterMap with valid entries. */
-  void GetParameterFromLine( const std::string & fullLine,
-    const std::string & line );
-
-  /** Splits a line in parameter name and values. */
-  void SplitLine( const std::string & fullLine, const std::string & line,
-    std::vector< std::string > & splittedLine ) const;
+  void ParseLine( const char * lineBegin, const char * lineEnd );
 
   /** Uniform way to throw exceptions when the parameter file appears to be
    * invalid.
@@ -18,6 +18,10 @@
 
 #include "itkParameterMapInterface.h"
 
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
 namespace itk
 {
 
@@ -41,7 +45,7 @@ ParameterMapInterface
 ParameterMapInterface
 ::~ParameterMapInterface()
 {
-  // empty
+  this->ClearCache();
 } // end Destructor()
 
 
@@ -55,12 +59,70 @@ ParameterMapInterface
 {
   if( !parMap.empty() )
   {
+    /** The cache is keyed by the handles into the old map. */
+    this->ClearCache();
     this->m_ParameterMap = parMap;
   }
 
 } // end SetParameterMap()
 
 
+/**
+ * **************** ClearCache ***************
+ */
+
+void
+ParameterMapInterface
+::ClearCache( void )
+{
+  this->m_CacheLock.Lock();
+  for( CacheType::iterator it = this->m_Cache.begin(); it != this->m_Cache.end(); ++it )
+  {
+    delete it->second;
+  }
+  this->m_Cache.clear();
+  this->m_Warnings.clear();
+  this->m_CacheLock.Unlock();
+
+} // end ClearCache()
+
+
+/**
+ * **************** IsFirstWarning ***************
+ */
+
+bool
+ParameterMapInterface
+::IsFirstWarning( const std::string & parameterName,
+  const unsigned int entry_nr ) const
+{
+  this->m_CacheLock.Lock();
+  const bool first = this->m_Warnings.insert(
+    std::make_pair( parameterName, entry_nr ) ).second;
+  this->m_CacheLock.Unlock();
+  return first;
+
+} // end IsFirstWarning()
+
+
+/**
+ * **************** GetParameterHandle ***************
+ */
+
+ParameterMapInterface::ParameterHandle
+ParameterMapInterface
+::GetParameterHandle( const std::string & parameterName ) const
+{
+  ParameterMapType::const_iterator it = this->m_ParameterMap.find( parameterName );
+  if( it == this->m_ParameterMap.end() )
+  {
+    return 0;
+  }
+  return &it->second;
+
+} // end GetParameterHandle()
+
+
 /**
  * **************** CountNumberOfParameterEntries ***************
  */
@@ -70,11 +132,8 @@ ParameterMapInterface
 ::CountNumberOfParameterEntries(
   const std::string & parameterName ) const
 {
-  if( this->m_ParameterMap.count( parameterName ) )
-  {
-    return this->m_ParameterMap.find( parameterName )->second.size();
-  }
-  return 0;
+  const ParameterHandle handle = this->GetParameterHandle( parameterName );
+  return handle != 0 ? handle->size() : 0;
 
 } // end CountNumberOfParameterEntries()
 
@@ -133,6 +192,45 @@ ParameterMapInterface
 } // end ReadParameter()
 
 
+/**
+ * **************** ReadParameter ***************
+ */
+
+bool
+ParameterMapInterface
+::ReadParameter( bool & parameterValue,
+  const ParameterHandle handle,
+  const unsigned int entry_nr ) const
+{
+  std::string parameterValueString;
+  if( !this->ReadParameter( parameterValueString, handle, entry_nr ) )
+  {
+    return false;
+  }
+
+  if( parameterValueString == "true" )
+  {
+    parameterValue = true;
+  }
+  else if( parameterValueString == "false" )
+  {
+    parameterValue = false;
+  }
+  else
+  {
+    std::stringstream ss;
+    ss << "ERROR: Entry number " << entry_nr
+       << " should be a boolean, i.e. either \"true\" or \"false\""
+       << ", but it reads \"" << parameterValueString << "\".";
+
+    itkExceptionMacro( << ss.str() );
+  }
+
+  return true;
+
+} // end ReadParameter()
+
+
 /**
  * **************** StringCast ***************
  */
@@ -146,6 +244,78 @@ ParameterMapInterface
 } // end StringCast()
 
 
+/**
+ * **************** StringCast ***************
+ */
+
+bool
+ParameterMapInterface
+::StringCast( const std::string & parameterValue, double & casted ) const
+{
+  /** Only plain decimal numbers are parsed by strtod; for other notations,
+   * such as inf, nan and hexadecimal numbers, strtod and the stream differ,
+   * so these are left to the stream. Like the stream, strtod skips leading
+   * white space and stops at the first character that is not part of the number.
+   * Unlike the stream, strtod uses the decimal point of the C locale, which an
+   * application may have changed, e.g. to a comma. Then it stops at the '.',
+   * so a value is only accepted when strtod consumed the whole token, and is
+   * otherwise left to the stream as well.
+   */
+  const char * begin = parameterValue.c_str();
+  while( std::isspace( static_cast< unsigned char >( *begin ) ) )
+  {
+    ++begin;
+  }
+  const char * digits = ( *begin == '+' || *begin == '-' ) ? begin + 1 : begin;
+  const bool   plainDecimal
+    = ( std::isdigit( static_cast< unsigned char >( *digits ) ) || *digits == '.' )
+    && !( digits[ 0 ] == '0' && ( digits[ 1 ] == 'x' || digits[ 1 ] == 'X' ) );
+  if( !plainDecimal )
+  {
+    return this->StringCast< double >( parameterValue, casted );
+  }
+
+  char * end = 0;
+  errno = 0;
+  const double value = std::strtod( begin, &end );
+  if( end == begin || errno == ERANGE )
+  {
+    return this->StringCast< double >( parameterValue, casted );
+  }
+  while( std::isspace( static_cast< unsigned char >( *end ) ) )
+  {
+    ++end;
+  }
+  if( *end != '\0' )
+  {
+    return this->StringCast< double >( parameterValue, casted );
+  }
+  casted = value;
+  return true;
+
+} // end StringCast()
+
+
+/**
+ * **************** StringCast ***************
+ */
+
+bool
+ParameterMapInterface
+::StringCast( const std::string & parameterValue, float & casted ) const
+{
+  /** Like the stream, read the accumulate type, double, and cast. */
+  double value = 0.0;
+  if( !this->StringCast( parameterValue, value ) )
+  {
+    return false;
+  }
+  casted = static_cast< float >( value );
+  return true;
+
+} // end StringCast()
+
+
 /**
  * **************** ReadParameter ***************
  */
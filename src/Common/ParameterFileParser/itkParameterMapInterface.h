@@ -23,10 +23,16 @@
 #include "itkObjectFactory.h"
 #include "itkMacro.h"
 #include "itkNumericTraits.h"
+#include "itkSimpleFastMutexLock.h"
 
 #include "itkParameterFileParser.h"
 
+#include <functional>
 #include <iostream>
+#include <locale>
+#include <map>
+#include <set>
+#include <typeinfo>
 
 namespace itk
 {
@@ -50,6 +56,13 @@ namespace itk
  * 1) ReadParameter() is called with the function argument printWarningToStream
  *    set to true.
  * 2) The global member variable m_PrintErrorMessages is true.
+ * A warning about a missing parameter is given only once per parameter and
+ * entry number.
+ *
+ * Every entry is cast only once per type; the result is cached until the
+ * next SetParameterMap(). Components that read a parameter repeatedly can
+ * in addition save the lookup of the name with GetParameterHandle() and
+ * the ReadParameter() flavor that takes the handle.
  *
  * This class can be used in the following way:\n
  *
@@ -129,47 +142,43 @@ public:
     /** Reset the error message. */
     errorMessage = "";
 
-    /** Get the number of entries. */
-    std::size_t numberOfEntries = this->CountNumberOfParameterEntries(
-      parameterName );
-
     /** Check if the requested parameter exists. */
-    if( numberOfEntries == 0 )
+    const ParameterHandle handle = this->GetParameterHandle( parameterName );
+    if( handle == 0 )
     {
-      std::stringstream ss;
-      ss << "WARNING: The parameter \"" << parameterName
-         << "\", requested at entry number " << entry_nr
-         << ", does not exist at all.\n"
-         << "  The default value \"" << parameterValue
-         << "\" is used instead." << std::endl;
-      if( printThisErrorMessage && this->m_PrintErrorMessages )
+      if( printThisErrorMessage && this->m_PrintErrorMessages
+        && this->IsFirstWarning( parameterName, entry_nr ) )
       {
+        std::stringstream ss;
+        ss << "WARNING: The parameter \"" << parameterName
+           << "\", requested at entry number " << entry_nr
+           << ", does not exist at all.\n"
+           << "  The default value \"" << parameterValue
+           << "\" is used instead." << std::endl;
         errorMessage = ss.str();
       }
 
       return false;
     }
 
-    /** Get the vector of parameters. */
-    const ParameterValuesType & vec = this->m_ParameterMap.find( parameterName )->second;
-
     /** Check if it exists at the requested entry number. */
-    if( entry_nr >= numberOfEntries )
+    if( entry_nr >= handle->size() )
     {
-      std::stringstream ss;
-      ss << "WARNING: The parameter \"" << parameterName
-         << "\" does not exist at entry number " << entry_nr
-         << ".\n  The default value \"" << parameterValue
-         << "\" is used instead." << std::endl;
-      if( printThisErrorMessage && this->m_PrintErrorMessages )
+      if( printThisErrorMessage && this->m_PrintErrorMessages
+        && this->IsFirstWarning( parameterName, entry_nr ) )
       {
+        std::stringstream ss;
+        ss << "WARNING: The parameter \"" << parameterName
+           << "\" does not exist at entry number " << entry_nr
+           << ".\n  The default value \"" << parameterValue
+           << "\" is used instead." << std::endl;
         errorMessage = ss.str();
       }
       return false;
     }
 
     /** Cast the string to type T. */
-    bool castSuccesful = this->StringCast( vec[ entry_nr ], parameterValue );
+    bool castSuccesful = this->CachedStringCast( handle, entry_nr, parameterValue );
 
     /** Check if the cast was successful. */
     if( !castSuccesful )
@@ -178,7 +187,7 @@ public:
       ss << "ERROR: Casting entry number " << entry_nr
          << " for the parameter \"" << parameterName
          << "\" failed!\n"
-         << "  You tried to cast \"" << vec[ entry_nr ]
+         << "  You tried to cast \"" << ( *handle )[ entry_nr ]
          << "\" from std::string to "
          << typeid( parameterValue ).name() << std::endl;
 
@@ -197,6 +206,50 @@ public:
     const bool printThisErrorMessage,
     std::string & errorMessage ) const;
 
+  /** A handle to the values of a parameter, for components that read a
+   * parameter repeatedly, for example in every iteration. A handle saves the
+   * lookup of the parameter name. It is null if the parameter does not exist,
+   * and it is invalidated by SetParameterMap().
+   */
+  typedef const ParameterValuesType * ParameterHandle;
+
+  ParameterHandle GetParameterHandle( const std::string & parameterName ) const;
+
+  /** Get the parameter of \a handle at entry_nr as type T. Returns false
+   * without a warning if the handle is null or the entry does not exist, and
+   * throws an exception if the cast fails, like ReadParameter() does.
+   */
+  template< class T >
+  bool ReadParameter( T & parameterValue,
+    const ParameterHandle handle,
+    const unsigned int entry_nr ) const
+  {
+    if( handle == 0 || entry_nr >= handle->size() )
+    {
+      return false;
+    }
+
+    if( !this->CachedStringCast( handle, entry_nr, parameterValue ) )
+    {
+      std::stringstream ss;
+      ss << "ERROR: Casting entry number " << entry_nr
+         << " failed!\n"
+         << "  You tried to cast \"" << ( *handle )[ entry_nr ]
+         << "\" from std::string to "
+         << typeid( parameterValue ).name() << std::endl;
+
+      itkExceptionMacro( << ss.str() );
+    }
+
+    return true;
+  }
+
+
+  /** Boolean support for the handle based ReadParameter(). */
+  bool ReadParameter( bool & parameterValue,
+    const ParameterHandle handle,
+    const unsigned int entry_nr ) const;
+
   /** A shorter version of ReadParameter() that does not require the boolean
    * printThisErrorMessage. Instead the default value true is used.
    */
@@ -399,14 +452,108 @@ private:
 
   bool m_PrintErrorMessages;
 
+  /** The cache of the casted parameter values. The values are keyed by the
+   * parameter handle, the entry number and the type, and stored behind a
+   * base class without the type.
+   */
+  struct CachedValueBase
+  {
+    virtual ~CachedValueBase() {}
+  };
+
+  template< class T >
+  struct CachedValue : public CachedValueBase
+  {
+    T Value;
+  };
+
+  struct CacheKeyType
+  {
+    CacheKeyType( const ParameterHandle handle, const unsigned int entry_nr,
+      const std::type_info * type ) :
+      Handle( handle ), EntryNumber( entry_nr ), Type( type ) {}
+
+    bool operator<( const CacheKeyType & other ) const
+    {
+      if( this->Handle != other.Handle )
+      {
+        return std::less< ParameterHandle >()( this->Handle, other.Handle );
+      }
+      if( this->EntryNumber != other.EntryNumber )
+      {
+        return this->EntryNumber < other.EntryNumber;
+      }
+      return this->Type->before( *other.Type ) != 0;
+    }
+
+    ParameterHandle        Handle;
+    unsigned int           EntryNumber;
+    const std::type_info * Type;
+  };
+
+  typedef std::map< CacheKeyType, CachedValueBase * >       CacheType;
+  typedef std::set< std::pair< std::string, unsigned int > > WarningSetType;
+
+  mutable CacheType           m_Cache;
+  mutable WarningSetType      m_Warnings;
+  mutable SimpleFastMutexLock m_CacheLock;
+
+  /** Deletes the cached values and forgets the given warnings. */
+  void ClearCache( void );
+
+  /** Returns true the first time it is called for a parameter and entry
+   * number, so that a warning about a missing parameter is given only once,
+   * instead of every time the parameter is read.
+   */
+  bool IsFirstWarning( const std::string & parameterName,
+    const unsigned int entry_nr ) const;
+
+  /** Casts the entry of the parameter with a handle to type T, and caches the
+   * result, so that every entry is cast only once per type.
+   */
+  template< class T >
+  bool CachedStringCast( const ParameterHandle handle,
+    const unsigned int entry_nr, T & casted ) const
+  {
+    const CacheKeyType key( handle, entry_nr, &typeid( T ) );
+
+    this->m_CacheLock.Lock();
+    CacheType::const_iterator it = this->m_Cache.find( key );
+    if( it != this->m_Cache.end() )
+    {
+      casted = static_cast< const CachedValue< T > * >( it->second )->Value;
+      this->m_CacheLock.Unlock();
+      return true;
+    }
+    this->m_CacheLock.Unlock();
+
+    if( !this->StringCast( ( *handle )[ entry_nr ], casted ) )
+    {
+      return false;
+    }
+
+    CachedValue< T > * cachedValue = new CachedValue< T >;
+    cachedValue->Value = casted;
+    this->m_CacheLock.Lock();
+    if( !this->m_Cache.insert( std::make_pair( key, cachedValue ) ).second )
+    {
+      delete cachedValue;
+    }
+    this->m_CacheLock.Unlock();
+    return true;
+
+  } // end CachedStringCast()
+
   /** A templated function to cast strings to a type T.
    * Returns true when casting was successful and false otherwise.
-   * We make use of the casting functionality of string streams.
+   * We make use of the casting functionality of string streams. Parameter
+   * files do not depend on the locale, so the classic locale is used.
    */
   template< class T >
   bool StringCast( const std::string & parameterValue, T & casted ) const
   {
     std::stringstream ss( parameterValue );
+    ss.imbue( std::locale::classic() );
 
     /** For (unsigned) char we need a workaround, because ">>" casts it wrongly.
     * It takes the first digit and thinks it is a char. For example:
@@ -429,6 +576,14 @@ private:
    */
   bool StringCast( const std::string & parameterValue, std::string & casted ) const;
 
+  /** Provide overloads for floating point values, which are parsed by strtod
+   * instead of a stringstream. That is much faster for long lists, such as
+   * the TransformParameters of a B-spline transform.
+   */
+  bool StringCast( const std::string & parameterValue, double & casted ) const;
+
+  bool StringCast( const std::string & parameterValue, float & casted ) const;
+
 };
 
 } // end of namespace itk
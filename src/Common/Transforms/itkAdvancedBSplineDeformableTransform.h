@@ -183,6 +183,7 @@ public:
   typedef typename Superclass::InternalMatrixType           InternalMatrixType;
   typedef typename Superclass::MovingImageGradientType      MovingImageGradientType;
   typedef typename Superclass::MovingImageGradientValueType MovingImageGradientValueType;
+  typedef typename Superclass::CompressedJacobianType       CompressedJacobianType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename Superclass::PixelType    PixelType;
@@ -222,6 +223,7 @@ public:
     itkGetStaticConstMacro( SpaceDimension ),
     itkGetStaticConstMacro( SplineOrder ) >                 SODerivativeWeightsFunctionType;
   typedef typename SODerivativeWeightsFunctionType::Pointer SODerivativeWeightsFunctionPointer;
+  typedef typename WeightsFunctionType::PeriodicWeightTableType PeriodicWeightTableType;
 
   /** Parameter index array type. */
   typedef typename Superclass::ParameterIndexArrayType ParameterIndexArrayType;
@@ -240,6 +242,14 @@ public:
     ParameterIndexArrayType & indices,
     bool & inside ) const;
 
+  /** Transform a batch of points. The storage for the weights and indices
+   * is shared by all points, and the coefficients are only checked once.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
   /** Get number of weights. */
   unsigned long GetNumberOfWeights( void ) const
   {
@@ -266,6 +276,52 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** The fixed sample features are the offset of the support region in the
+   * coefficient images (-1 if the support region is not inside the grid),
+   * followed by the B-spline weights of the support region.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    return 1 + WeightsFunctionType::NumberOfWeights;
+  }
+
+
+  /** Compute the fixed sample features and the nonzero Jacobian indices. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Transform a point, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
+  /** The Jacobian consists of the B-spline weights of the support region,
+   * repeated for every dimension, so it can be compressed.
+   */
+  virtual bool GetSupportsCompressedJacobian( void ) const
+  {
+    return true;
+  }
+
+
+  /** Compute the B-spline weights and the parameter numbers of the first
+   * dimension of the support region.
+   */
+  virtual void GetCompressedJacobian(
+    const InputPointType & ipp,
+    CompressedJacobianType & compressedJacobian ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -326,6 +382,12 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
+  /** Compute the periodic weight table of the sample grid. */
+  void ComputePeriodicWeightTable( PeriodicWeightTableType & table ) const;
+
+  /** Give the weights functions the periodic weight table. */
+  virtual void UpdatePeriodicWeightTables( void );
+
   typedef typename Superclass::JacobianImageType JacobianImageType;
   typedef typename Superclass::JacobianPixelType JacobianPixelType;
 
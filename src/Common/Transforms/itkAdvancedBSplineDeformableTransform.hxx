@@ -136,8 +136,9 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
   // needed, there seems to be double functionality compared to base constructor
   this->UpdatePointIndexConversions();
 
-  this->m_HasNonZeroSpatialHessian           = true;
-  this->m_HasNonZeroJacobianOfSpatialHessian = true;
+  this->m_HasNonZeroSpatialHessian                       = true;
+  this->m_HasNonZeroJacobianOfSpatialHessian             = true;
+  this->m_HasSpecializedJacobianWithImageGradientProduct = true;
 
 } // end Constructor
 
@@ -337,6 +338,42 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 }
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  /** Without coefficients all points are mapped onto themselves. */
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    std::copy( inputPoints, inputPoints + numberOfPoints, outputPoints );
+    return;
+  }
+
+  /** Allocate memory on the stack, once for all points. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  typename ParameterIndexArrayType::ValueType indicesArray[ numberOfWeights ];
+  WeightsType             weights( weightsArray, numberOfWeights, false );
+  ParameterIndexArrayType indices( indicesArray, numberOfWeights, false );
+
+  bool inside;
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    this->TransformPoint( inputPoints[ n ], outputPoints[ n ], weights, indices, inside );
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* GetNumberOfAffectedWeights ****************************
  */
@@ -443,6 +480,63 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 } // end GetJacobian()
 
 
+/**
+ * ********************* GetCompressedJacobian ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::GetCompressedJacobian(
+  const InputPointType & ipp,
+  CompressedJacobianType & compressedJacobian ) const
+{
+  /** Sanity check. */
+  if( this->m_InputParametersPointer == NULL )
+  {
+    itkExceptionMacro( << "Cannot compute Jacobian: parameters not set" );
+  }
+
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  compressedJacobian.m_Weights.resize( numberOfWeights );
+
+  /** Outside the valid region the Jacobian is zero, with the same indices
+   * as returned by GetJacobian().
+   */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    std::fill( compressedJacobian.m_Weights.begin(), compressedJacobian.m_Weights.end(), 0.0 );
+    compressedJacobian.m_Indices.resize( numberOfWeights );
+    for( unsigned long i = 0; i < numberOfWeights; ++i )
+    {
+      compressedJacobian.m_Indices[ i ] = i;
+    }
+    compressedJacobian.m_ParametersPerDimension = numberOfWeights;
+    return;
+  }
+
+  /** Compute the weights directly in the compressed Jacobian. */
+  WeightsType weights( &compressedJacobian.m_Weights[ 0 ], numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+  /** Keep only the parameter numbers of the first dimension. Shrinking the
+   * vector does not free its memory, so it is only allocated once.
+   */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( compressedJacobian.m_Indices, supportRegion );
+  compressedJacobian.m_Indices.resize( numberOfWeights );
+  compressedJacobian.m_ParametersPerDimension = this->GetNumberOfParametersPerDimension();
+
+} // end GetCompressedJacobian()
+
+
 /**
  * ********************* EvaluateJacobianAndImageGradientProduct ****************************
  */
@@ -517,6 +611,159 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if( !this->m_CoefficientImages[ 0 ] || !this->InsideValidRegion( cindex ) )
+  {
+    features[ 0 ] = -1.0;
+    const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the weights directly in the features array. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  WeightsType weights( features + 1, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+  /** Store the offset of the support region. */
+  const OffsetValueType * offsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  OffsetValueType         offset      = 0;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    offset += supportIndex[ j ] * offsetTable[ j ];
+  }
+  features[ 0 ] = static_cast< double >( offset );
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+typename AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::OutputPointType
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  /** Zero displacement outside the valid region. */
+  OutputPointType outputPoint = ipp;
+  if( features[ 0 ] < 0.0 )
+  {
+    return outputPoint;
+  }
+
+  /** Get handles to the coefficients at the start of the support region. */
+  const OffsetValueType   startOffset = static_cast< OffsetValueType >( features[ 0 ] );
+  const OffsetValueType * offsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  const PixelType *       coefficients[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    coefficients[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + startOffset;
+  }
+
+  /** Loop over the support region, in the order of the weights. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  const double *      weights         = features + 1;
+  unsigned int        supportIndex[ SpaceDimension ];
+  std::fill( supportIndex, supportIndex + SpaceDimension, 0 );
+  OffsetValueType offset = 0;
+  for( unsigned long k = 0; k < numberOfWeights; ++k )
+  {
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      outputPoint[ j ] += static_cast< ScalarType >( weights[ k ] * coefficients[ j ][ offset ] );
+    }
+
+    /** Go to the next point of the support region. */
+    for( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      ++supportIndex[ d ];
+      offset += offsetTable[ d ];
+      if( supportIndex[ d ] < this->m_SupportSize[ d ] )
+      {
+        break;
+      }
+      offset          -= supportIndex[ d ] * offsetTable[ d ];
+      supportIndex[ d ] = 0;
+    }
+  }
+
+  return outputPoint;
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & itkNotUsed( ipp ),
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  /** Zero Jacobian outside the valid region. */
+  if( features[ 0 ] < 0.0 )
+  {
+    imageJacobian.Fill( 0.0 );
+    return;
+  }
+
+  /** Compute the inner product. */
+  const unsigned long    numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  const double *         weights         = features + 1;
+  NumberOfParametersType counter         = 0;
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    const MovingImageGradientValueType mig = movingImageGradient[ d ];
+    for( unsigned long i = 0; i < numberOfWeights; ++i )
+    {
+      imageJacobian[ counter ] = weights[ i ] * mig;
+      ++counter;
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -1077,9 +1324,9 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
    * Make use of the fact that the Hessian is symmetrical, so do not compute
    * both i,j and j,i for i != j.
    */
-  const unsigned int           d = SpaceDimension * ( SpaceDimension + 1 ) / 2;
-  FixedArray< WeightsType, d > weightVector;
-  unsigned int                 count = 0;
+  const unsigned int d = SpaceDimension * ( SpaceDimension + 1 ) / 2;
+  double             weightVector[ d * numberOfWeights ];
+  unsigned int       count = 0;
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
     for( unsigned int j = 0; j <= i; ++j )
@@ -1087,8 +1334,9 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
       /** Compute the derivative weights. */
       this->m_SODerivativeWeightsFunctions[ i ][ j ]->Evaluate( cindex, supportIndex, weights );
 
-      /** Remember the weights. */
-      weightVector[ count ] = weights;
+      /** Remember the weights, on the stack instead of in a heap allocated array. */
+      std::copy( weights.data_block(), weights.data_block() + numberOfWeights,
+        weightVector + count * numberOfWeights );
       ++count;
 
     } // end for j
@@ -1103,7 +1351,7 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
     {
       for( unsigned int j = 0; j <= i; ++j )
       {
-        double tmp = weightVector[ count ][ mu ];
+        const double tmp = *( weightVector + count * numberOfWeights + mu );
         matrix[ i ][ j ] = tmp;
         if( i != j ) { matrix[ j ][ i ] = tmp; }
         ++count;
@@ -1455,6 +1703,56 @@ AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 } // end ComputeNonZeroJacobianIndices()
 
 
+/**
+ * ********************* ComputePeriodicWeightTable ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputePeriodicWeightTable( PeriodicWeightTableType & table ) const
+{
+  table.RemoveSampleGrid();
+
+  ContinuousIndexType                offset, step;
+  FixedArray< bool, SpaceDimension > aligned;
+  this->ComputeSampleGridSteps( offset, step, aligned );
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    if( aligned[ i ] )
+    {
+      table.SetSampleGrid( i, offset[ i ], step[ i ] );
+    }
+  }
+
+} // end ComputePeriodicWeightTable()
+
+
+/**
+ * ********************* UpdatePeriodicWeightTables ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+AdvancedBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::UpdatePeriodicWeightTables( void )
+{
+  PeriodicWeightTableType table;
+  this->ComputePeriodicWeightTable( table );
+
+  this->m_WeightsFunction->SetPeriodicWeightTable( table );
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    this->m_DerivativeWeightsFunctions[ i ]->SetPeriodicWeightTable( table );
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      this->m_SODerivativeWeightsFunctions[ i ][ j ]->SetPeriodicWeightTable( table );
+    }
+  }
+
+} // end UpdatePeriodicWeightTables()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -22,6 +22,8 @@
 #include "itkImage.h"
 #include "itkImageRegion.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -88,6 +90,7 @@ public:
   typedef typename Superclass::InternalMatrixType           InternalMatrixType;
   typedef typename Superclass::MovingImageGradientType      MovingImageGradientType;
   typedef typename Superclass::MovingImageGradientValueType MovingImageGradientValueType;
+  typedef typename Superclass::CompressedJacobianType       CompressedJacobianType;
 
   /** This method sets the parameters of the transform.
      * For a B-spline deformation transform, the parameters are the BSpline
@@ -183,6 +186,18 @@ public:
    */
   virtual void SetCoefficientImages( ImagePointer images[] );
 
+  /** Keep a single precision copy of the coefficients, or not. Transforms that
+   * support it, currently the RecursiveBSplineTransform, then read the
+   * coefficients from this copy when evaluating the transform and its spatial
+   * derivatives, which halves the memory traffic for large grids. The results
+   * are still accumulated in double precision. The copy is updated by
+   * SetParameters() and SetCoefficientImages(), so parameters that are
+   * modified in place should be set again. Off by default.
+   */
+  virtual void SetUseFloatCoefficients( const bool _arg );
+  itkGetConstMacro( UseFloatCoefficients, bool );
+  itkBooleanMacro( UseFloatCoefficients );
+
   /** Typedefs for specifying the extend to the grid. */
   typedef ImageRegion< itkGetStaticConstMacro( SpaceDimension ) > RegionType;
 
@@ -217,6 +232,22 @@ public:
   //itkGetMacro( GridOrigin, OriginType );
   itkGetConstMacro( GridOrigin, OriginType );
 
+  /** Set the regular grid of points at which the transform is mostly
+   * evaluated, such as the voxels of the fixed image. Along the grid
+   * dimensions where the sample grid steps a ratio of small integers of a
+   * control point cell, the fractional positions in a cell repeat, and the
+   * weights are taken from a small table instead of being evaluated.
+   * Other points are evaluated as usual. Not thread safe.
+   */
+  virtual void SetSampleGrid( const OriginType & origin,
+    const SpacingType & spacing, const DirectionType & direction );
+
+  /** Stop using the sample grid. */
+  virtual void RemoveSampleGrid( void );
+
+  /** Get whether a sample grid is set. */
+  itkGetConstMacro( UseSampleGrid, bool );
+
   /** Parameter index array type. */
   typedef Array< unsigned long > ParameterIndexArrayType;
 
@@ -296,12 +327,27 @@ protected:
   /** Wrap flat array into images of coefficients. */
   void WrapAsImages( void );
 
+  /** Copy the coefficients to single precision, if desired. */
+  void UpdateFloatCoefficients( void );
+
   /** Convert an input point to a continuous index inside the B-spline grid. */
   void TransformPointToContinuousGridIndex(
     const InputPointType & point, ContinuousIndexType & index ) const;
 
   void UpdatePointIndexConversions( void );
 
+  /** Compute, for every grid dimension, the continuous grid index of the
+   * sample grid origin and the step of the continuous grid index per sample.
+   * A dimension is aligned when only one sample grid dimension steps along it.
+   */
+  void ComputeSampleGridSteps( ContinuousIndexType & offset,
+    ContinuousIndexType & step, FixedArray< bool, NDimensions > & aligned ) const;
+
+  /** Update the periodic weight tables of the weight functions, after the
+   * grid or the sample grid has changed. Does nothing here.
+   */
+  virtual void UpdatePeriodicWeightTables( void ) {}
+
   virtual void ComputeNonZeroJacobianIndices(
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const = 0;
@@ -332,6 +378,12 @@ protected:
 
   RegionType m_ValidRegion;
 
+  /** The sample grid. */
+  bool          m_UseSampleGrid;
+  OriginType    m_SampleGridOrigin;
+  SpacingType   m_SampleGridSpacing;
+  DirectionType m_SampleGridDirection;
+
   /** Variables defining the interpolation support region. */
   unsigned long       m_Offset;
   SizeType            m_SupportSize;
@@ -362,6 +414,13 @@ protected:
   /** Internal parameters buffer. */
   ParametersType m_InternalParametersBuffer;
 
+  /** The single precision copy of the coefficients, and pointers to the
+   * coefficients of each dimension in it.
+   */
+  bool                  m_UseFloatCoefficients;
+  std::vector< float >  m_FloatCoefficientBuffer;
+  const float *         m_FloatCoefficients[ NDimensions ];
+
   void UpdateGridOffsetTable( void );
 
 private:
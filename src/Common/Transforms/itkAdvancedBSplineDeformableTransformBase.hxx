@@ -47,6 +47,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
   this->m_InternalParametersBuffer = ParametersType( 0 );
   // Make sure the parameters pointer is not NULL after construction.
   this->m_InputParametersPointer = &( this->m_InternalParametersBuffer );
+  this->m_UseFloatCoefficients   = false;
 
   // Initialize coeffient images
   for( unsigned int j = 0; j < SpaceDimension; j++ )
@@ -57,6 +58,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
     this->m_WrappedImage[ j ]->SetSpacing( this->m_GridSpacing.GetDataPointer() );
     this->m_WrappedImage[ j ]->SetDirection( this->m_GridDirection );
     this->m_CoefficientImages[ j ] = NULL;
+    this->m_FloatCoefficients[ j ] = NULL;
   }
 
   this->m_ValidRegion = this->m_GridRegion;
@@ -96,6 +98,11 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
   this->UpdatePointIndexConversions();
 
   this->m_LastJacobianIndex = this->m_ValidRegion.GetIndex();
+
+  this->m_UseSampleGrid = false;
+  this->m_SampleGridOrigin.Fill( 0.0 );
+  this->m_SampleGridSpacing.Fill( 1.0 );
+  this->m_SampleGridDirection.SetIdentity();
 }
 
 
@@ -212,6 +219,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
     }
 
     this->UpdatePointIndexConversions();
+    this->UpdatePeriodicWeightTables();
 
     this->Modified();
   }
@@ -235,6 +243,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
     }
 
     this->UpdatePointIndexConversions();
+    this->UpdatePeriodicWeightTables();
 
     this->Modified();
   }
@@ -258,12 +267,92 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
       this->m_WrappedImage[ j ]->SetOrigin( this->m_GridOrigin.GetDataPointer() );
     }
 
+    this->UpdatePeriodicWeightTables();
+
     this->Modified();
   }
 
 }
 
 
+// Set the sample grid
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::SetSampleGrid( const OriginType & origin,
+  const SpacingType & spacing, const DirectionType & direction )
+{
+  this->m_UseSampleGrid       = true;
+  this->m_SampleGridOrigin    = origin;
+  this->m_SampleGridSpacing   = spacing;
+  this->m_SampleGridDirection = direction;
+
+  this->UpdatePeriodicWeightTables();
+
+}
+
+
+// Remove the sample grid
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::RemoveSampleGrid( void )
+{
+  if( this->m_UseSampleGrid )
+  {
+    this->m_UseSampleGrid = false;
+    this->UpdatePeriodicWeightTables();
+  }
+
+}
+
+
+// Compute the steps of the sample grid in grid index units
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::ComputeSampleGridSteps( ContinuousIndexType & offset,
+  ContinuousIndexType & step, FixedArray< bool, NDimensions > & aligned ) const
+{
+  offset.Fill( 0.0 );
+  step.Fill( 0.0 );
+  aligned.Fill( false );
+  if( !this->m_UseSampleGrid )
+  {
+    return;
+  }
+
+  /** The continuous grid index of sample grid index v is offset + A v. */
+  Vector< double, SpaceDimension > tvector;
+  DirectionType                    scale;
+  for( unsigned int j = 0; j < SpaceDimension; j++ )
+  {
+    tvector[ j ]    = this->m_SampleGridOrigin[ j ] - this->m_GridOrigin[ j ];
+    scale[ j ][ j ] = this->m_SampleGridSpacing[ j ];
+  }
+  const Vector< double, SpaceDimension > cvector = this->m_PointToIndexMatrix * tvector;
+  const DirectionType                    A
+    = this->m_PointToIndexMatrix * this->m_SampleGridDirection * scale;
+
+  /** A grid dimension is aligned when one column of A steps along it. */
+  for( unsigned int i = 0; i < SpaceDimension; i++ )
+  {
+    offset[ i ] = cvector[ i ];
+    unsigned int numberOfSteps = 0;
+    for( unsigned int j = 0; j < SpaceDimension; j++ )
+    {
+      if( vcl_abs( A[ i ][ j ] ) > 1e-9 )
+      {
+        step[ i ] = A[ i ][ j ];
+        ++numberOfSteps;
+      }
+    }
+    aligned[ i ] = numberOfSteps == 1;
+  }
+
+}
+
+
 // Set the parameters
 template< class TScalarType, unsigned int NDimensions >
 void
@@ -428,6 +517,56 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
     dataPointer                   += numberOfPixels;
     this->m_CoefficientImages[ j ] = this->m_WrappedImage[ j ];
   }
+
+  this->UpdateFloatCoefficients();
+}
+
+
+// Set whether a single precision copy of the coefficients is used
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::SetUseFloatCoefficients( const bool _arg )
+{
+  if( this->m_UseFloatCoefficients != _arg )
+  {
+    this->m_UseFloatCoefficients = _arg;
+    this->UpdateFloatCoefficients();
+    this->Modified();
+  }
+}
+
+
+// Copy the coefficients to single precision
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
+::UpdateFloatCoefficients( void )
+{
+  /** The coefficient images all have the buffered region of the first one. */
+  const SizeValueType numberOfPixels = this->m_CoefficientImages[ 0 ]
+    ? this->m_CoefficientImages[ 0 ]->GetBufferedRegion().GetNumberOfPixels() : 0;
+  if( !this->m_UseFloatCoefficients || numberOfPixels == 0 )
+  {
+    std::vector< float >().swap( this->m_FloatCoefficientBuffer );
+    for( unsigned int j = 0; j < SpaceDimension; j++ )
+    {
+      this->m_FloatCoefficients[ j ] = NULL;
+    }
+    return;
+  }
+
+  this->m_FloatCoefficientBuffer.resize( numberOfPixels * SpaceDimension );
+  for( unsigned int j = 0; j < SpaceDimension; j++ )
+  {
+    const PixelType * coefficients = this->m_CoefficientImages[ j ]->GetBufferPointer();
+    float *           copy         = &this->m_FloatCoefficientBuffer[ j * numberOfPixels ];
+    for( SizeValueType i = 0; i < numberOfPixels; ++i )
+    {
+      copy[ i ] = static_cast< float >( coefficients[ i ] );
+    }
+    this->m_FloatCoefficients[ j ] = copy;
+  }
 }
 
 
@@ -537,6 +676,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
     this->m_InternalParametersBuffer = ParametersType( 0 );
     this->m_InputParametersPointer   = NULL;
 
+    this->UpdateFloatCoefficients();
   }
 
 }
@@ -577,6 +717,7 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
 
   os << indent << "InputParametersPointer: "
      << this->m_InputParametersPointer << std::endl;
+  os << indent << "UseFloatCoefficients: " << this->m_UseFloatCoefficients << std::endl;
   os << indent << "ValidRegion: " << this->m_ValidRegion << std::endl;
   os << indent << "LastJacobianIndex: " << this->m_LastJacobianIndex << std::endl;
 }
@@ -612,6 +753,17 @@ AdvancedBSplineDeformableTransformBase< TScalarType, NDimensions >
   const InputPointType & point,
   ContinuousIndexType & cindex ) const
 {
+  /** Without rotation of the grid only the diagonal of the matrix is used. */
+  if( this->m_PointToIndexMatrixIsDiagonal )
+  {
+    for( unsigned int j = 0; j < SpaceDimension; j++ )
+    {
+      cindex[ j ] = static_cast< typename ContinuousIndexType::CoordRepType >(
+        this->m_PointToIndexMatrix[ j ][ j ] * ( point[ j ] - this->m_GridOrigin[ j ] ) );
+    }
+    return;
+  }
+
   Vector< double, SpaceDimension > tvector;
 
   for( unsigned int j = 0; j < SpaceDimension; j++ )
@@ -100,7 +100,9 @@ public:
   typedef typename Superclass::InverseTransformBasePointer   InverseTransformBasePointer;
   typedef typename Superclass::TransformCategoryType         TransformCategoryType;
   typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
+  typedef typename Superclass::TransformPointCacheType       TransformPointCacheType;
   typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::CompressedJacobianType        CompressedJacobianType;
 
   /** Transform typedefs for the from Superclass. */
   typedef typename Superclass::TransformType   TransformType;
@@ -159,9 +161,28 @@ public:
 
   itkGetConstMacro( UseAddition, bool );
 
+  /** Collapse a linear initial transform, for example a chain of translation,
+   * Euler and affine transforms, into a single cached matrix and offset.
+   * The cache is updated when the initial transform is set, and when the
+   * parameters of this transform are set, if the initial transform changed
+   * in the meantime. Default: true.
+   */
+  virtual void SetFlattenLinearInitialTransform( bool _arg );
+
+  itkGetConstMacro( FlattenLinearInitialTransform, bool );
+  itkBooleanMacro( FlattenLinearInitialTransform );
+
+  /** The modification time also includes those of the initial and current transform. */
+  virtual unsigned long GetMTime( void ) const;
+
   /**  Method to transform a point. */
   virtual OutputPointType TransformPoint( const InputPointType  & point ) const;
 
+  /** Method to transform a point, caching the weights of the current transform. */
+  virtual OutputPointType TransformPointAndCacheWeights(
+    const InputPointType & point,
+    TransformPointCacheType & cache ) const;
+
   /** ITK4 change:
    * The following pure virtual functions must be overloaded.
    * For now just throw an exception, since these are not used in elastix.
@@ -190,6 +211,26 @@ public:
   }
 
 
+  /** Batched versions of TransformPoint(), GetJacobian() and GetSpatialJacobian().
+   * The combination method is selected once for the whole batch, after which
+   * the batched functions of the initial and current transform are called.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  virtual void GetJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    SpatialJacobianType * spatialJacobians ) const;
+
   /** Return the number of parameters that completely define the CurrentTransform. */
   virtual NumberOfParametersType GetNumberOfParameters( void ) const;
 
@@ -253,6 +294,59 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * passing the Jacobian buffer on to the current transform.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingBuffer(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianType & jacobian ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the data cached by TransformPointAndCacheWeights().
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingCache(
+    const InputPointType & ipp,
+    const TransformPointCacheType & cache,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** The fixed sample features are those of the current transform. */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const;
+
+  /** Compute the fixed sample features of the current transform. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Transform a point, using the fixed sample features of the current transform. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features of the current transform.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
+  /** The Jacobian is that of the current transform, so the compressed
+   * Jacobian is supported when the current transform supports it.
+   */
+  virtual bool GetSupportsCompressedJacobian( void ) const;
+
+  /** Compute the compressed Jacobian of the current transform. */
+  virtual void GetCompressedJacobian(
+    const InputPointType & ipp,
+    CompressedJacobianType & compressedJacobian ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -349,6 +443,47 @@ protected:
   /** Throw an exception. */
   virtual void NoCurrentTransformSet( void ) const throw ( ExceptionObject );
 
+  /** Compute the matrix and offset of a linear initial transform. */
+  virtual void UpdateFlattenedInitialTransform( void );
+
+  /** Apply the initial transform, or its flattened version when available. */
+  inline OutputPointType TransformPointWithInitialTransform(
+    const InputPointType & point ) const
+  {
+    if( this->m_FlattenedInitialTransformIsValid )
+    {
+      return this->m_FlattenedInitialTransformMatrix * point
+             + this->m_FlattenedInitialTransformOffset;
+    }
+    return this->m_InitialTransform->TransformPoint( point );
+  }
+
+
+  /** Compute the spatial Jacobian of the initial transform, or use the flattened version. */
+  inline void GetSpatialJacobianOfInitialTransform(
+    const InputPointType & ipp,
+    SpatialJacobianType & sj ) const
+  {
+    if( this->m_FlattenedInitialTransformIsValid )
+    {
+      sj = this->m_FlattenedInitialTransformMatrix;
+      return;
+    }
+    this->m_InitialTransform->GetSpatialJacobian( ipp, sj );
+  }
+
+
+  /** Batched versions of the two functions above. */
+  void TransformPointsWithInitialTransform(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  void GetSpatialJacobiansOfInitialTransform(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    SpatialJacobianType * spatialJacobians ) const;
+
   /**  A pointer to one of the following functions:
    * - TransformPointUseAddition,
    * - TransformPointUseComposition,
@@ -625,6 +760,13 @@ protected:
   bool m_UseAddition;
   bool m_UseComposition;
 
+  /** The flattened initial transform: T_0(x) = A x + b. */
+  bool                m_FlattenLinearInitialTransform;
+  bool                m_FlattenedInitialTransformIsValid;
+  unsigned long       m_FlattenedInitialTransformMTime;
+  SpatialJacobianType m_FlattenedInitialTransformMatrix;
+  OutputVectorType    m_FlattenedInitialTransformOffset;
+
 private:
 
   AdvancedCombinationTransform( const Self & ); // purposely not implemented
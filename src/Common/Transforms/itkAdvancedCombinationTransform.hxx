@@ -20,6 +20,9 @@
 
 #include "itkAdvancedCombinationTransform.h"
 
+#include <algorithm> // std::max
+#include <vector>
+
 namespace itk
 {
 
@@ -39,6 +42,13 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   this->m_UseAddition    = false;
   this->m_UseComposition = true;
 
+  /** Collapse a linear initial transform by default. */
+  this->m_FlattenLinearInitialTransform    = true;
+  this->m_FlattenedInitialTransformIsValid = false;
+  this->m_FlattenedInitialTransformMTime   = 0;
+  this->m_FlattenedInitialTransformMatrix.SetIdentity();
+  this->m_FlattenedInitialTransformOffset.Fill( 0.0 );
+
   /** Set everything to have no current transform. */
   this->m_SelectedTransformPointFunction
     = &Self::TransformPointNoCurrentTransform;
@@ -326,6 +336,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   {
     this->Modified();
     this->m_CurrentTransform->SetParameters( param );
+    this->UpdateFlattenedInitialTransform();
   }
   else
   {
@@ -350,6 +361,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   {
     this->Modified();
     this->m_CurrentTransform->SetFixedParameters( param );
+    this->UpdateFlattenedInitialTransform();
   }
   else
   {
@@ -374,6 +386,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   {
     this->Modified();
     this->m_CurrentTransform->SetParametersByValue( param );
+    this->UpdateFlattenedInitialTransform();
   }
   else
   {
@@ -626,6 +639,9 @@ void
 AdvancedCombinationTransform< TScalarType, NDimensions >
 ::UpdateCombinationMethod( void )
 {
+  /** Collapse the initial transform, if possible. */
+  this->UpdateFlattenedInitialTransform();
+
   /** Update the m_SelectedTransformPointFunction and
    * the m_SelectedGetJacobianFunction
    */
@@ -725,6 +741,148 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end UpdateCombinationMethod()
 
 
+/**
+ * ****************** SetFlattenLinearInitialTransform ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::SetFlattenLinearInitialTransform( bool _arg )
+{
+  if( this->m_FlattenLinearInitialTransform != _arg )
+  {
+    this->m_FlattenLinearInitialTransform = _arg;
+    this->Modified();
+    this->UpdateFlattenedInitialTransform();
+  }
+
+} // end SetFlattenLinearInitialTransform()
+
+
+/**
+ * ****************** UpdateFlattenedInitialTransform ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::UpdateFlattenedInitialTransform( void )
+{
+  /** Only a linear initial transform can be collapsed. */
+  if( !this->m_FlattenLinearInitialTransform
+    || this->m_InitialTransform.IsNull()
+    || !this->m_InitialTransform->IsLinear() )
+  {
+    this->m_FlattenedInitialTransformIsValid = false;
+    return;
+  }
+
+  /** Nothing to do if the initial transform did not change. */
+  const unsigned long mtime = this->m_InitialTransform->GetMTime();
+  if( this->m_FlattenedInitialTransformIsValid
+    && mtime == this->m_FlattenedInitialTransformMTime )
+  {
+    return;
+  }
+
+  /** For a linear transform T(x) = A x + b, the spatial Jacobian is A
+   * everywhere, and b = T(0). For a chain of linear transforms this is
+   * evaluated once, instead of once per point and per link.
+   */
+  InputPointType origin;
+  origin.Fill( 0.0 );
+  this->m_InitialTransform->GetSpatialJacobian( origin, this->m_FlattenedInitialTransformMatrix );
+  const OutputPointType offset = this->m_InitialTransform->TransformPoint( origin );
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    this->m_FlattenedInitialTransformOffset[ i ] = offset[ i ];
+  }
+
+  this->m_FlattenedInitialTransformMTime   = mtime;
+  this->m_FlattenedInitialTransformIsValid = true;
+
+} // end UpdateFlattenedInitialTransform()
+
+
+/**
+ * ****************** GetMTime ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+unsigned long
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetMTime( void ) const
+{
+  /** The combination changes when one of its transforms changes. */
+  unsigned long mtime = this->Superclass::GetMTime();
+  if( this->m_InitialTransform.IsNotNull() )
+  {
+    mtime = std::max( mtime, static_cast< unsigned long >( this->m_InitialTransform->GetMTime() ) );
+  }
+  if( this->m_CurrentTransform.IsNotNull() )
+  {
+    mtime = std::max( mtime, static_cast< unsigned long >( this->m_CurrentTransform->GetMTime() ) );
+  }
+
+  return mtime;
+
+} // end GetMTime()
+
+
+/**
+ * ************* TransformPointsWithInitialTransform **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPointsWithInitialTransform(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  if( !this->m_FlattenedInitialTransformIsValid )
+  {
+    this->m_InitialTransform->TransformPoints( numberOfPoints, inputPoints, outputPoints );
+    return;
+  }
+
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    outputPoints[ n ] = this->m_FlattenedInitialTransformMatrix * inputPoints[ n ]
+      + this->m_FlattenedInitialTransformOffset;
+  }
+
+} // end TransformPointsWithInitialTransform()
+
+
+/**
+ * ************* GetSpatialJacobiansOfInitialTransform **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetSpatialJacobiansOfInitialTransform(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  SpatialJacobianType * spatialJacobians ) const
+{
+  if( !this->m_FlattenedInitialTransformIsValid )
+  {
+    this->m_InitialTransform->GetSpatialJacobians( numberOfPoints, inputPoints, spatialJacobians );
+    return;
+  }
+
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    spatialJacobians[ n ] = this->m_FlattenedInitialTransformMatrix;
+  }
+
+} // end GetSpatialJacobiansOfInitialTransform()
+
+
 /**
  * ************* NoCurrentTransformSet **********************
  */
@@ -771,7 +929,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   /** The Initial transform. */
   OutputPointType out0
-    = this->m_InitialTransform->TransformPoint( point );
+    = this->TransformPointWithInitialTransform( point );
 
   /** The Current transform. */
   OutputPointType out
@@ -798,7 +956,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 ::TransformPointUseComposition( const InputPointType & point ) const
 {
   return this->m_CurrentTransform->TransformPoint(
-    this->m_InitialTransform->TransformPoint( point ) );
+    this->TransformPointWithInitialTransform( point ) );
 
 } // end TransformPointUseComposition()
 
@@ -865,7 +1023,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->GetJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointWithInitialTransform( ipp ),
     j, nonZeroJacobianIndices );
 
 } // end GetJacobianUseComposition()
@@ -939,7 +1097,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->EvaluateJacobianWithImageGradientProduct(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointWithInitialTransform( ipp ),
     movingImageGradient, imageJacobian, nonZeroJacobianIndices );
 
 } // end EvaluateJacobianWithImageGradientProductUseComposition()
@@ -995,7 +1153,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialJacobianType & sj ) const
 {
   SpatialJacobianType sj0, sj1, identity;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian( ipp, sj1 );
   identity.SetIdentity();
   sj = sj0 + sj1 - identity;
@@ -1015,9 +1173,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialJacobianType & sj ) const
 {
   SpatialJacobianType sj0, sj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ), sj1 );
+    this->TransformPointWithInitialTransform( ipp ), sj1 );
 
   sj = sj1 * sj0;
 
@@ -1098,12 +1256,12 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointWithInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
    */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian( transformedPoint, sj1 );
   this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
   this->m_CurrentTransform->GetSpatialHessian( transformedPoint, sh1 );
@@ -1209,9 +1367,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   SpatialJacobianType           sj0;
   JacobianOfSpatialJacobianType jsj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointWithInitialTransform( ipp ),
     jsj1, nonZeroJacobianIndices );
 
   jsj.resize( nonZeroJacobianIndices.size() );
@@ -1238,9 +1396,9 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 {
   SpatialJacobianType           sj0, sj1;
   JacobianOfSpatialJacobianType jsj1;
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointWithInitialTransform( ipp ),
     sj1, jsj1, nonZeroJacobianIndices );
 
   sj = sj1 * sj0;
@@ -1385,11 +1543,11 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo: this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointWithInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms. */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
 
   /** Assume/demand that GetJacobianOfSpatialJacobian returns
@@ -1452,12 +1610,12 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointWithInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
    */
-  this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
+  this->GetSpatialJacobianOfInitialTransform( ipp, sj0 );
   this->m_InitialTransform->GetSpatialHessian( ipp, sh0 );
 
   /** Assume/demand that GetJacobianOfSpatialJacobian returns the same
@@ -1613,6 +1771,185 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end TransformPoint()
 
 
+/**
+ * ****************** TransformPointAndCacheWeights ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename AdvancedCombinationTransform< TScalarType, NDimensions >::OutputPointType
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPointAndCacheWeights(
+  const InputPointType & point,
+  TransformPointCacheType & cache ) const
+{
+  /** The cache refers to the current transform, which is evaluated at:
+   * - the point itself, without initial transform or when using addition,
+   * - the initially transformed point, when using composition.
+   */
+  cache.m_IsValid = false;
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    return this->TransformPoint( point );
+  }
+  else if( this->m_InitialTransform.IsNull() )
+  {
+    return this->m_CurrentTransform->TransformPointAndCacheWeights( point, cache );
+  }
+  else if( this->m_UseAddition )
+  {
+    const OutputPointType out0 = this->TransformPointWithInitialTransform( point );
+    OutputPointType       out  = this->m_CurrentTransform->TransformPointAndCacheWeights( point, cache );
+    for( unsigned int i = 0; i < SpaceDimension; i++ )
+    {
+      out[ i ] += ( out0[ i ] - point[ i ] );
+    }
+    return out;
+  }
+
+  return this->m_CurrentTransform->TransformPointAndCacheWeights(
+    this->TransformPointWithInitialTransform( point ), cache );
+
+} // end TransformPointAndCacheWeights()
+
+
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, inputPoints, outputPoints );
+  }
+  else if( this->m_UseAddition )
+  {
+    /** ADDITION: T(x) = T_0(x) + T_1(x) - x */
+    std::vector< OutputPointType > out0( numberOfPoints );
+    if( numberOfPoints == 0 ) { return; }
+    this->TransformPointsWithInitialTransform( numberOfPoints, inputPoints, &out0[ 0 ] );
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, inputPoints, outputPoints );
+    for( SizeValueType n = 0; n < numberOfPoints; ++n )
+    {
+      for( unsigned int i = 0; i < SpaceDimension; i++ )
+      {
+        outputPoints[ n ][ i ] += ( out0[ n ][ i ] - inputPoints[ n ][ i ] );
+      }
+    }
+  }
+  else
+  {
+    /** COMPOSITION: T(x) = T_1( T_0(x) ) */
+    std::vector< OutputPointType > out0( numberOfPoints );
+    if( numberOfPoints == 0 ) { return; }
+    this->TransformPointsWithInitialTransform( numberOfPoints, inputPoints, &out0[ 0 ] );
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, &out0[ 0 ], outputPoints );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ****************** GetJacobians ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    /** CURRENT ONLY and ADDITION: J(x) = J_1(x) */
+    this->m_CurrentTransform->GetJacobians(
+      numberOfPoints, inputPoints, jacobians, nonZeroJacobianIndices );
+  }
+  else
+  {
+    /** COMPOSITION: J(x) = J_1( T_0(x) ) */
+    std::vector< OutputPointType > out0( numberOfPoints );
+    if( numberOfPoints == 0 ) { return; }
+    this->TransformPointsWithInitialTransform( numberOfPoints, inputPoints, &out0[ 0 ] );
+    this->m_CurrentTransform->GetJacobians(
+      numberOfPoints, &out0[ 0 ], jacobians, nonZeroJacobianIndices );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ****************** GetSpatialJacobians ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetSpatialJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  SpatialJacobianType * spatialJacobians ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->GetSpatialJacobians(
+      numberOfPoints, inputPoints, spatialJacobians );
+  }
+  else if( this->m_UseAddition )
+  {
+    /** ADDITION: sJ(x) = sJ_0(x) + sJ_1(x) - I */
+    std::vector< SpatialJacobianType > sj0( numberOfPoints );
+    if( numberOfPoints == 0 ) { return; }
+    this->GetSpatialJacobiansOfInitialTransform( numberOfPoints, inputPoints, &sj0[ 0 ] );
+    this->m_CurrentTransform->GetSpatialJacobians( numberOfPoints, inputPoints, spatialJacobians );
+    for( SizeValueType n = 0; n < numberOfPoints; ++n )
+    {
+      spatialJacobians[ n ] += sj0[ n ];
+      for( unsigned int i = 0; i < SpaceDimension; i++ )
+      {
+        spatialJacobians[ n ]( i, i ) -= 1.0;
+      }
+    }
+  }
+  else
+  {
+    /** COMPOSITION: sJ(x) = sJ_1( T_0(x) ) * sJ_0(x) */
+    std::vector< OutputPointType >     out0( numberOfPoints );
+    std::vector< SpatialJacobianType > sj0( numberOfPoints );
+    if( numberOfPoints == 0 ) { return; }
+    this->TransformPointsWithInitialTransform( numberOfPoints, inputPoints, &out0[ 0 ] );
+    this->GetSpatialJacobiansOfInitialTransform( numberOfPoints, inputPoints, &sj0[ 0 ] );
+    this->m_CurrentTransform->GetSpatialJacobians( numberOfPoints, &out0[ 0 ], spatialJacobians );
+    for( SizeValueType n = 0; n < numberOfPoints; ++n )
+    {
+      spatialJacobians[ n ] = spatialJacobians[ n ] * sj0[ n ];
+    }
+  }
+
+} // end GetSpatialJacobians()
+
+
 /**
  * ****************** GetJacobian ****************************
  */
@@ -1652,6 +1989,226 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ****************** EvaluateJacobianWithImageGradientProductUsingBuffer ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::EvaluateJacobianWithImageGradientProductUsingBuffer(
+  const InputPointType & ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianType & jacobian ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+
+  /** Only in case of composition the current transform is evaluated
+   * at another point, see the selected functions.
+   */
+  const bool useComposition = this->m_InitialTransform.IsNotNull() && !this->m_UseAddition;
+  this->m_CurrentTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+    useComposition ? this->TransformPointWithInitialTransform( ipp ) : ipp,
+    movingImageGradient, imageJacobian, nonZeroJacobianIndices, jacobian );
+
+} // end EvaluateJacobianWithImageGradientProductUsingBuffer()
+
+
+/**
+ * ****************** EvaluateJacobianWithImageGradientProductUsingCache ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::EvaluateJacobianWithImageGradientProductUsingCache(
+  const InputPointType & ipp,
+  const TransformPointCacheType & cache,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** A valid cache has been filled by the current transform, so the point at
+   * which it is evaluated does not need to be recomputed.
+   */
+  if( !cache.m_IsValid )
+  {
+    this->EvaluateJacobianWithImageGradientProduct(
+      ipp, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+    return;
+  }
+
+  this->m_CurrentTransform->EvaluateJacobianWithImageGradientProductUsingCache(
+    ipp, cache, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+
+} // end EvaluateJacobianWithImageGradientProductUsingCache()
+
+
+/**
+ * ****************** GetNumberOfFixedSampleFeatures ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+unsigned int
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetNumberOfFixedSampleFeatures( void ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    return 0;
+  }
+  return this->m_CurrentTransform->GetNumberOfFixedSampleFeatures();
+
+} // end GetNumberOfFixedSampleFeatures()
+
+
+/**
+ * ****************** ComputeFixedSampleFeatures ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** The current transform is evaluated at:
+   * - the point itself, without initial transform or when using addition,
+   * - the initially transformed point, when using composition.
+   * The initial transform does not change during a registration, so the
+   * features at the initially transformed point can be stored as well.
+   */
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    this->m_CurrentTransform->ComputeFixedSampleFeatures(
+      ipp, features, nonZeroJacobianIndices );
+  }
+  else
+  {
+    this->m_CurrentTransform->ComputeFixedSampleFeatures(
+      this->TransformPointWithInitialTransform( ipp ), features, nonZeroJacobianIndices );
+  }
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ****************** TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename AdvancedCombinationTransform< TScalarType, NDimensions >::OutputPointType
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    return this->TransformPoint( ipp );
+  }
+  else if( this->m_InitialTransform.IsNull() )
+  {
+    return this->m_CurrentTransform->TransformPointUsingFixedSampleFeatures( ipp, features );
+  }
+  else if( this->m_UseAddition )
+  {
+    const OutputPointType out0 = this->TransformPointWithInitialTransform( ipp );
+    OutputPointType       out  = this->m_CurrentTransform->TransformPointUsingFixedSampleFeatures( ipp, features );
+    for( unsigned int i = 0; i < SpaceDimension; i++ )
+    {
+      out[ i ] += ( out0[ i ] - ipp[ i ] );
+    }
+    return out;
+  }
+
+  return this->m_CurrentTransform->TransformPointUsingFixedSampleFeatures(
+    this->TransformPointWithInitialTransform( ipp ), features );
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ****************** EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  /** The features already describe the point at which the current transform
+   * is evaluated, so the initial transform is not needed here.
+   */
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  this->m_CurrentTransform->EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    ipp, features, movingImageGradient, imageJacobian );
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
+/**
+ * ****************** GetSupportsCompressedJacobian ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+bool
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetSupportsCompressedJacobian( void ) const
+{
+  return this->m_CurrentTransform.IsNotNull()
+         && this->m_CurrentTransform->GetSupportsCompressedJacobian();
+
+} // end GetSupportsCompressedJacobian()
+
+
+/**
+ * ****************** GetCompressedJacobian ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetCompressedJacobian(
+  const InputPointType & ipp,
+  CompressedJacobianType & compressedJacobian ) const
+{
+  /** The current transform is evaluated at the same point as in GetJacobian(). */
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    this->m_CurrentTransform->GetCompressedJacobian( ipp, compressedJacobian );
+  }
+  else
+  {
+    this->m_CurrentTransform->GetCompressedJacobian(
+      this->TransformPointWithInitialTransform( ipp ), compressedJacobian );
+  }
+
+} // end GetCompressedJacobian()
+
+
 /**
  * ****************** GetSpatialJacobian ****************************
  */
@@ -113,6 +113,8 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
 
   /** Set/Get the transformation from a container of parameters
    * This is typically used by optimizers.  There are 6 parameters. The first
@@ -135,6 +137,15 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly, without constructing the Jacobian.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Set/Get the order of the computation. Default ZXY */
   itkSetMacro( ComputeZYX, bool );
   itkGetConstMacro( ComputeZYX, bool );
@@ -302,6 +302,31 @@ AdvancedEuler3DTransform< TScalarType >::GetJacobian( const InputPointType & p,
 }
 
 
+// Get the Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AdvancedEuler3DTransform< TScalarType >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Compute g^T * dR/dmu * (p-c) */
+  const InputVectorType pp = p - this->GetCenter();
+  this->EvaluateMatrixJacobianWithImageGradientProduct(
+    pp, movingImageGradient, imageJacobian, 0, 3 );
+
+  // the translation columns are unit vectors
+  for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    imageJacobian[ 3 + dim ] = movingImageGradient[ dim ];
+  }
+
+  // Copy the constant nonZeroJacobianIndices
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Precompute Jacobian of Spatial Jacobian
 template< class TScalarType >
 void
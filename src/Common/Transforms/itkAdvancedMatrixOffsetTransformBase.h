@@ -146,6 +146,8 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
 
   /** Standard matrix type for this class. */
   typedef Matrix< TScalarType,
@@ -400,11 +402,33 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly, without constructing the Jacobian.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType &,
     SpatialJacobianType & ) const;
 
+  /** Batched TransformPoint() and GetSpatialJacobian(). The matrix and offset
+   * are read once, and the points are transformed in a plain loop.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  virtual void GetSpatialJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    SpatialJacobianType * spatialJacobians ) const;
+
   /** Compute the spatial Hessian of the transformation. */
   virtual void GetSpatialHessian(
     const InputPointType &,
@@ -455,6 +479,17 @@ protected:
   /** Called by constructors: */
   virtual void PrecomputeJacobians( unsigned int paramDims );
 
+  /** Compute the inner products of the moving image gradient with the Jacobian
+   * columns dM/dmu * ( p - c ) of the parameters [begin, end), from the
+   * precomputed m_JacobianOfSpatialJacobian. Used by subclasses to implement
+   * EvaluateJacobianWithImageGradientProduct().
+   */
+  void EvaluateMatrixJacobianWithImageGradientProduct(
+    const InputVectorType & pp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    const unsigned int begin, const unsigned int end ) const;
+
   /** Destroy an AdvancedMatrixOffsetTransformBase object. */
   virtual ~AdvancedMatrixOffsetTransformBase() {}
 
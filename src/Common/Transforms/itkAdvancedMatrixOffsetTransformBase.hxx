@@ -153,6 +153,9 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 
   /** m_SpatialHessian is initialized with zeros */
   this->m_HasNonZeroSpatialHessian = false;
+
+  /** The inner product with the image gradient does not need the full Jacobian. */
+  this->m_HasSpecializedJacobianWithImageGradientProduct = true;
   for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
   {
     //SK: \todo: how can outputDims ever be different from OutputSpaceDimension?
@@ -607,6 +610,91 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 } // end GetJacobian()
 
 
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** The matrix part of the Jacobian has a single nonzero per column,
+   * so the product is the outer product of the gradient with p - c.
+   */
+  const InputVectorType v = p - this->GetCenter();
+
+  unsigned int par = 0;
+  for( unsigned int block = 0; block < NInputDimensions; ++block )
+  {
+    const double imDeriv = movingImageGradient[ block ];
+    for( unsigned int dim = 0; dim < NOutputDimensions; ++dim )
+    {
+      imageJacobian[ par ] = imDeriv * v[ dim ];
+      ++par;
+    }
+  }
+
+  for( unsigned int dim = 0; dim < NOutputDimensions; ++dim )
+  {
+    imageJacobian[ par + dim ] = movingImageGradient[ dim ];
+  }
+
+  // Copy the constant nonZeroJacobianIndices
+  nonZeroJacobianIndices = this->m_NonZeroJacobianIndices;
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
+/**
+ * ********************* EvaluateMatrixJacobianWithImageGradientProduct ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateMatrixJacobianWithImageGradientProduct(
+  const InputVectorType & pp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  const unsigned int begin, const unsigned int end ) const
+{
+  /** g^T * dM/dmu * pp is the inner product of dM/dmu with the outer
+   * product of g and pp, which is therefore computed only once.
+   */
+  double outer[ NOutputDimensions ][ NInputDimensions ];
+  for( unsigned int i = 0; i < NOutputDimensions; ++i )
+  {
+    for( unsigned int j = 0; j < NInputDimensions; ++j )
+    {
+      outer[ i ][ j ] = movingImageGradient[ i ] * pp[ j ];
+    }
+  }
+
+  const JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
+  for( unsigned int par = begin; par < end; ++par )
+  {
+    const SpatialJacobianType & dMdmu = jsj[ par ];
+    double                      sum   = 0.0;
+    for( unsigned int i = 0; i < NOutputDimensions; ++i )
+    {
+      for( unsigned int j = 0; j < NInputDimensions; ++j )
+      {
+        sum += dMdmu( i, j ) * outer[ i ][ j ];
+      }
+    }
+    imageJacobian[ par ] = sum;
+  }
+
+} // end EvaluateMatrixJacobianWithImageGradientProduct()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -624,6 +712,73 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 } // end GetSpatialJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  /** Copy the matrix and offset to plain arrays, so that the compiler can
+   * keep them in registers.
+   */
+  ScalarType matrix[ NOutputDimensions ][ NInputDimensions ];
+  ScalarType offset[ NOutputDimensions ];
+  for( unsigned int i = 0; i < NOutputDimensions; ++i )
+  {
+    for( unsigned int j = 0; j < NInputDimensions; ++j )
+    {
+      matrix[ i ][ j ] = this->m_Matrix[ i ][ j ];
+    }
+    offset[ i ] = this->m_Offset[ i ];
+  }
+
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    const InputPointType & point = inputPoints[ n ];
+    OutputPointType &      out   = outputPoints[ n ];
+    for( unsigned int i = 0; i < NOutputDimensions; ++i )
+    {
+      ScalarType value = offset[ i ];
+      for( unsigned int j = 0; j < NInputDimensions; ++j )
+      {
+        value += matrix[ i ][ j ] * point[ j ];
+      }
+      out[ i ] = value;
+    }
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::GetSpatialJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * itkNotUsed( inputPoints ),
+  SpatialJacobianType * spatialJacobians ) const
+{
+  const SpatialJacobianType sj = this->GetMatrix();
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    spatialJacobians[ n ] = sj;
+  }
+
+} // end GetSpatialJacobians()
+
+
 /**
  * ********************* GetSpatialHessian ****************************
  */
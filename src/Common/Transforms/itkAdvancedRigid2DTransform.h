@@ -136,6 +136,8 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
 
   /**
    * Set the rotation Matrix of a Rigid2D Transform
@@ -232,6 +234,15 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly, without constructing the Jacobian.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /**
    * This method creates and returns a new AdvancedRigid2DTransform object
    * which is the inverse of self.
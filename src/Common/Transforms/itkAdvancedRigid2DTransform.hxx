@@ -321,6 +321,35 @@ AdvancedRigid2DTransform< TScalarType >::GetJacobian( const InputPointType & p,
 }
 
 
+// Compute the transformation Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AdvancedRigid2DTransform< TScalarType >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  // Some helper variables
+  const double ca = vcl_cos( this->GetAngle() );
+  const double sa = vcl_sin( this->GetAngle() );
+  const double px = p[ 0 ] - this->GetCenter()[ 0 ];
+  const double py = p[ 1 ] - this->GetCenter()[ 1 ];
+
+  // derivatives with respect to the angle
+  imageJacobian[ 0 ]
+    = movingImageGradient[ 0 ] * ( -sa * px - ca * py )
+    + movingImageGradient[ 1 ] * (  ca * px - sa * py );
+
+  // derivatives with respect to the translation part
+  imageJacobian[ 1 ] = movingImageGradient[ 0 ];
+  imageJacobian[ 2 ] = movingImageGradient[ 1 ];
+
+  // Copy the constant nonZeroJacobianIndices
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Precompute Jacobian of Spatial Jacobian
 template< class TScalarType >
 void
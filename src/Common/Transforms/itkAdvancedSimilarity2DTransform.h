@@ -141,6 +141,8 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
 
   /** Set the Scale part of the transform. */
   void SetScale( ScaleType scale );
@@ -180,6 +182,15 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly, without constructing the Jacobian.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Set the transformation to an identity. */
   virtual void SetIdentity( void );
 
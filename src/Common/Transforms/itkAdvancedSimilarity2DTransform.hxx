@@ -220,6 +220,39 @@ AdvancedSimilarity2DTransform< TScalarType >::GetJacobian( const InputPointType
 }
 
 
+// Compute the transformation Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AdvancedSimilarity2DTransform< TScalarType >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  // Some helper variables
+  const double angle = this->GetAngle();
+  const double ca    = vcl_cos( angle );
+  const double sa    = vcl_sin( angle );
+  const double px    = p[ 0 ] - this->GetCenter()[ 0 ];
+  const double py    = p[ 1 ] - this->GetCenter()[ 1 ];
+  const double gx    = movingImageGradient[ 0 ];
+  const double gy    = movingImageGradient[ 1 ];
+
+  // derivatives with respect to the scale
+  imageJacobian[ 0 ] = gx * ( ca * px - sa * py ) + gy * ( sa * px + ca * py );
+
+  // derivatives with respect to the angle
+  imageJacobian[ 1 ] = ( gx * ( -sa * px - ca * py ) + gy * ( ca * px - sa * py ) ) * m_Scale;
+
+  // derivatives with respect to the translation part
+  imageJacobian[ 2 ] = gx;
+  imageJacobian[ 3 ] = gy;
+
+  // Copy the constant nonZeroJacobianIndices
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Set Identity
 template< class TScalarType >
 void
@@ -256,6 +256,40 @@ AdvancedSimilarity3DTransform< TScalarType >::GetJacobian( const InputPointType
 }
 
 
+// Get the Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AdvancedSimilarity3DTransform< TScalarType >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Compute g^T * dR/dmu * (p-c) */
+  const InputVectorType pp = p - this->GetCenter();
+  this->EvaluateMatrixJacobianWithImageGradientProduct(
+    pp, movingImageGradient, imageJacobian, 0, 3 );
+
+  // the translation columns are unit vectors
+  for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    imageJacobian[ 3 + dim ] = movingImageGradient[ dim ];
+  }
+
+  // derivative with respect to the scale parameter
+  const InputVectorType mpp = this->GetMatrix() * pp;
+  double                sum = 0.0;
+  for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    sum += movingImageGradient[ dim ] * mpp[ dim ];
+  }
+  imageJacobian[ 6 ] = sum / m_Scale;
+
+  // Copy the constant nonZeroJacobianIndices
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Set the scale factor
 template< class TScalarType >
 void
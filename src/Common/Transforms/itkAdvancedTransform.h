@@ -38,6 +38,8 @@
 #include "itkMatrix.h"
 #include "itkFixedArray.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -158,6 +160,22 @@ public:
   typedef OutputCovariantVectorType                   MovingImageGradientType;
   typedef typename MovingImageGradientType::ValueType MovingImageGradientValueType;
 
+  /** Per-sample data that a transform may compute in TransformPointAndCacheWeights(),
+   * and reuse in EvaluateJacobianWithImageGradientProductUsingCache() for the same
+   * point, to avoid computing the B-spline weights and support index twice.
+   * The cache lives on the stack of the calling thread. Transforms that do not
+   * support it set m_IsValid to false, which results in the normal computation.
+   * There is room for the weights of a spline of at most order 3.
+   */
+  itkStaticConstMacro( MaximumNumberOfCachedWeights, unsigned int, 4 * NInputDimensions );
+  struct TransformPointCacheType
+  {
+    bool            m_IsValid;
+    bool            m_IsInside;
+    IndexValueType  m_SupportIndex[ NInputDimensions ];
+    double          m_Weights[ MaximumNumberOfCachedWeights ];
+  };
+
   /** Get the number of nonzero Jacobian indices. By default all. */
   virtual NumberOfParametersType GetNumberOfNonZeroJacobianIndices( void ) const;
 
@@ -205,6 +223,108 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Same as EvaluateJacobianWithImageGradientProduct(), but a transform
+   * without a specialized implementation of it computes the Jacobian in the
+   * buffer \a jacobian of the caller, instead of in a temporary. A metric can
+   * thus pass a per-thread buffer, so that no memory is allocated per sample.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingBuffer(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    JacobianType & jacobian ) const;
+
+  /** Transform a point, and store data in the cache that can be reused by
+   * EvaluateJacobianWithImageGradientProductUsingCache() for the same point.
+   * By default the cache is not used.
+   */
+  virtual OutputPointType TransformPointAndCacheWeights(
+    const InputPointType & point,
+    TransformPointCacheType & cache ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the data cached by TransformPointAndCacheWeights() at the point ipp.
+   * If the cache is not valid, EvaluateJacobianWithImageGradientProduct() is called.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingCache(
+    const InputPointType & ipp,
+    const TransformPointCacheType & cache,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Fixed sample features: per-sample data that only depends on the position
+   * of the sample and on the grid of the transform, not on its parameters,
+   * such as the B-spline weights. When the fixed samples do not change during
+   * a resolution, a metric can compute them once, together with the nonzero
+   * Jacobian indices, and pass them in every iteration.
+   * The layout of the features is defined by the transform. Transforms that
+   * do not support them return zero features; this is the default.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    return 0;
+  }
+
+
+  /** Compute the fixed sample features of the point ipp, and its nonzero
+   * Jacobian indices, which are computed once for all iterations.
+   * The features array should have GetNumberOfFixedSampleFeatures() elements.
+   */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Transform the point ipp, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient
+   * at the point ipp, using its fixed sample features. The nonzero Jacobian
+   * indices are the ones returned by ComputeFixedSampleFeatures().
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
+  /** A compressed form of the Jacobian, for transforms in which every output
+   * dimension d depends on its own block of parameters, with the same weights
+   * for all dimensions, such as the B-spline transforms. With S the number of
+   * weights, the sparse Jacobian of GetJacobian() is given by
+   *   j[ d ][ d * S + k ] = m_Weights[ k ], and zero elsewhere, and
+   *   nonZeroJacobianIndices[ d * S + k ] = m_Indices[ k ] + d * m_ParametersPerDimension.
+   * Both the weights and the indices are NOutputDimensions times smaller than
+   * in the sparse form, and a product with the Jacobian reduces to a single
+   * product with the weights per dimension.
+   */
+  struct CompressedJacobianType
+  {
+    std::vector< double >      m_Weights;
+    NonZeroJacobianIndicesType m_Indices;
+    NumberOfParametersType     m_ParametersPerDimension;
+  };
+
+  /** Whether GetCompressedJacobian() is supported. By default false. */
+  virtual bool GetSupportsCompressedJacobian( void ) const
+  {
+    return false;
+  }
+
+
+  /** Compute the compressed Jacobian at the point ipp. The vectors of the
+   * compressed Jacobian are resized when needed, so a caller can reuse it
+   * without allocating memory per point. Throws an exception if the transform
+   * does not support it; the default.
+   */
+  virtual void GetCompressedJacobian(
+    const InputPointType & ipp,
+    CompressedJacobianType & compressedJacobian ) const;
+
   /** Compute the spatial Jacobian of the transformation.
    *
    * The spatial Jacobian is expressed as a vector of partial derivatives of the
@@ -235,6 +355,29 @@ public:
     const InputPointType & ipp,
     SpatialJacobianType & sj ) const = 0;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and GetSpatialJacobian().
+   * They evaluate the numberOfPoints points in the array inputPoints, and store
+   * the results in the arrays pointed to by the other arguments, which should
+   * have room for numberOfPoints elements. By default the single point function
+   * is called for every point. Transforms can override these functions to avoid
+   * the virtual call chain per point, and to exploit their internal structure.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  virtual void GetJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    SpatialJacobianType * spatialJacobians ) const;
+
   /** Override some pure virtual ITK4 functions. */
   virtual void ComputeJacobianWithRespectToParameters(
     const InputPointType & itkNotUsed( p ), JacobianType & itkNotUsed( j ) ) const
@@ -316,9 +459,21 @@ protected:
   AdvancedTransform( NumberOfParametersType numberOfParameters );
   virtual ~AdvancedTransform() {}
 
+  /** Computes the inner product of the full Jacobian with the moving image gradient. */
+  void MultiplyJacobianWithImageGradient(
+    const JacobianType & jacobian,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
   bool m_HasNonZeroSpatialHessian;
   bool m_HasNonZeroJacobianOfSpatialHessian;
 
+  /** Whether EvaluateJacobianWithImageGradientProduct() is specialized, i.e.
+   * does not compute the full Jacobian. Subclasses that specialize it set it
+   * to true in their constructor. Default: false.
+   */
+  bool m_HasSpecializedJacobianWithImageGradientProduct;
+
 private:
 
   AdvancedTransform( const Self & ); // purposely not implemented
@@ -47,8 +47,9 @@ template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutput
 AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
 ::AdvancedTransform() : Superclass()
 {
-  this->m_HasNonZeroSpatialHessian           = true;
-  this->m_HasNonZeroJacobianOfSpatialHessian = true;
+  this->m_HasNonZeroSpatialHessian                       = true;
+  this->m_HasNonZeroJacobianOfSpatialHessian             = true;
+  this->m_HasSpecializedJacobianWithImageGradientProduct = false;
 
 } // end Constructor
 
@@ -62,8 +63,9 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
 ::AdvancedTransform( NumberOfParametersType numberOfParameters ) :
   Superclass( numberOfParameters )
 {
-  this->m_HasNonZeroSpatialHessian           = true;
-  this->m_HasNonZeroJacobianOfSpatialHessian = true;
+  this->m_HasNonZeroSpatialHessian                       = true;
+  this->m_HasNonZeroJacobianOfSpatialHessian             = true;
+  this->m_HasSpecializedJacobianWithImageGradientProduct = false;
 } // end Constructor
 
 
@@ -85,6 +87,52 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
   this->GetJacobian( ipp, jacobian, nonZeroJacobianIndices );
 
   /** Perform a full multiplication. */
+  this->MultiplyJacobianWithImageGradient( jacobian, movingImageGradient, imageJacobian );
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingBuffer ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProductUsingBuffer(
+  const InputPointType & ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  JacobianType & jacobian ) const
+{
+  /** The specialized implementations do not need the full Jacobian. */
+  if( this->m_HasSpecializedJacobianWithImageGradientProduct )
+  {
+    this->EvaluateJacobianWithImageGradientProduct(
+      ipp, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+    return;
+  }
+
+  /** Obtain the Jacobian in the buffer; it keeps its memory between calls. */
+  this->GetJacobian( ipp, jacobian, nonZeroJacobianIndices );
+  this->MultiplyJacobianWithImageGradient( jacobian, movingImageGradient, imageJacobian );
+
+} // end EvaluateJacobianWithImageGradientProductUsingBuffer()
+
+
+/**
+ * ********************* MultiplyJacobianWithImageGradient ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::MultiplyJacobianWithImageGradient(
+  const JacobianType & jacobian,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
   typedef typename JacobianType::const_iterator JacobianIteratorType;
   typedef typename DerivativeType::iterator     DerivativeIteratorType;
   JacobianIteratorType jac = jacobian.begin();
@@ -104,7 +152,176 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
     }
   }
 
-} // end EvaluateJacobianWithImageGradientProduct()
+} // end MultiplyJacobianWithImageGradient()
+
+
+/**
+ * ********************* TransformPointAndCacheWeights ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+typename AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >::OutputPointType
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPointAndCacheWeights(
+  const InputPointType & point,
+  TransformPointCacheType & cache ) const
+{
+  cache.m_IsValid = false;
+  return this->TransformPoint( point );
+
+} // end TransformPointAndCacheWeights()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingCache ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProductUsingCache(
+  const InputPointType & ipp,
+  const TransformPointCacheType & itkNotUsed( cache ),
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  this->EvaluateJacobianWithImageGradientProduct(
+    ipp, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+
+} // end EvaluateJacobianWithImageGradientProductUsingCache()
+
+
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * itkNotUsed( features ),
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** There are no features; only the nonzero Jacobian indices are computed. */
+  JacobianType jacobian;
+  this->GetJacobian( ipp, jacobian, nonZeroJacobianIndices );
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+typename AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >::OutputPointType
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * itkNotUsed( features ) ) const
+{
+  return this->TransformPoint( ipp );
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * itkNotUsed( features ),
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  NonZeroJacobianIndicesType nonZeroJacobianIndices;
+  this->EvaluateJacobianWithImageGradientProduct(
+    ipp, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* GetCompressedJacobian ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetCompressedJacobian(
+  const InputPointType & itkNotUsed( ipp ),
+  CompressedJacobianType & itkNotUsed( compressedJacobian ) ) const
+{
+  itkExceptionMacro( << "ERROR: the compressed Jacobian is not supported by this transform." );
+
+} // end GetCompressedJacobian()
+
+
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->TransformPoint( inputPoints[ i ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetJacobian( inputPoints[ i ], jacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetSpatialJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  SpatialJacobianType * spatialJacobians ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetSpatialJacobian( inputPoints[ i ], spatialJacobians[ i ] );
+  }
+
+} // end GetSpatialJacobians()
 
 
 /**
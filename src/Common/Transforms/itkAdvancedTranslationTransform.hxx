@@ -71,8 +71,9 @@ AdvancedTranslationTransform< TScalarType, NDimensions >::AdvancedTranslationTra
   this->m_JacobianOfSpatialHessian.resize( ParametersDimension );
 
   /** m_SpatialHessian is automatically initialized with zeros */
-  this->m_HasNonZeroSpatialHessian           = false;
-  this->m_HasNonZeroJacobianOfSpatialHessian = false;
+  this->m_HasNonZeroSpatialHessian                       = false;
+  this->m_HasNonZeroJacobianOfSpatialHessian             = false;
+  this->m_HasSpecializedJacobianWithImageGradientProduct = true;
 }
 
 
@@ -224,6 +225,29 @@ AdvancedTranslationTransform< TScalarType, NDimensions >
 } // end GetJacobian()
 
 
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+AdvancedTranslationTransform< TScalarType, NDimensions >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & itkNotUsed( p ),
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** The Jacobian is the identity. */
+  for( unsigned int dim = 0; dim < NDimensions; ++dim )
+  {
+    imageJacobian[ dim ] = movingImageGradient[ dim ];
+  }
+  nonZeroJacobianIndices = this->m_NonZeroJacobianIndices;
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -259,6 +259,66 @@ AdvancedVersorTransform< TScalarType >::GetJacobian( const InputPointType & p,
 }
 
 
+/** Get the Jacobian multiplied by the moving image gradient */
+template< class TScalarType >
+void
+AdvancedVersorTransform< TScalarType >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  typedef typename VersorType::ValueType ValueType;
+
+  // compute derivatives with respect to rotation
+  const ValueType vx = m_Versor.GetX();
+  const ValueType vy = m_Versor.GetY();
+  const ValueType vz = m_Versor.GetZ();
+  const ValueType vw = m_Versor.GetW();
+
+  const double px = p[ 0 ] - this->GetCenter()[ 0 ];
+  const double py = p[ 1 ] - this->GetCenter()[ 1 ];
+  const double pz = p[ 2 ] - this->GetCenter()[ 2 ];
+
+  const double vxx = vx * vx;
+  const double vyy = vy * vy;
+  const double vzz = vz * vz;
+  const double vww = vw * vw;
+
+  const double vxy = vx * vy;
+  const double vxz = vx * vz;
+  const double vxw = vx * vw;
+
+  const double vyz = vy * vz;
+  const double vyw = vy * vw;
+
+  const double vzw = vz * vw;
+
+  const double gx = movingImageGradient[ 0 ];
+  const double gy = movingImageGradient[ 1 ];
+  const double gz = movingImageGradient[ 2 ];
+
+  // the columns of the Jacobian with respect to the versor, as in GetJacobian()
+  imageJacobian[ 0 ] = 2.0 * (
+      gx * ( ( vyw + vxz ) * py + ( vzw - vxy ) * pz )
+    + gy * ( ( vyw - vxz ) * px   - 2 * vxw   * py + ( vxx - vww ) * pz )
+    + gz * ( ( vzw + vxy ) * px + ( vww - vxx ) * py   - 2 * vxw   * pz ) ) / vw;
+
+  imageJacobian[ 1 ] = 2.0 * (
+      gx * ( -2 * vyw  * px + ( vxw + vyz ) * py + ( vww - vyy ) * pz )
+    + gy * ( ( vxw - vyz ) * px                + ( vzw + vxy ) * pz )
+    + gz * ( ( vyy - vww ) * px + ( vzw - vxy ) * py   - 2 * vyw   * pz ) ) / vw;
+
+  imageJacobian[ 2 ] = 2.0 * (
+      gx * ( -2 * vzw  * px + ( vzz - vww ) * py + ( vxw - vyz ) * pz )
+    + gy * ( ( vww - vzz ) * px   - 2 * vzw   * py + ( vyw + vxz ) * pz )
+    + gz * ( ( vxw + vyz ) * px + ( vyw - vxz ) * py ) ) / vw;
+
+  // Copy the constant nonZeroJacobianIndices
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 /** Print self */
 template< class TScalarType >
 void
@@ -0,0 +1,199 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineBlockStitcher_h
+#define __itkBSplineBlockStitcher_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageBase.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class BSplineBlockStitcher
+ * \brief Stitches the B-spline coefficients of registrations of overlapping
+ * blocks of the fixed image into one global B-spline transform.
+ *
+ * A very large fixed image can be registered block by block: the domain of
+ * the fixed image (its largest possible region) is divided into a regular
+ * grid of NumberOfBlocks blocks, and each block, extended by BlockOverlap
+ * voxels on each side, is registered independently, for example on a
+ * different node. ComputeBlockRegion() defines the decomposition; the
+ * registrations use the B-spline grid of the whole fixed image, so all
+ * blocks have the same parameter layout, and a block only determines the
+ * coefficients of the control points near it.
+ *
+ * The stitched coefficient of a control point is the weighted mean of the
+ * coefficients of the blocks. Across each inner boundary of the core of a
+ * block (the block without overlap), its weight rises smoothly from 0 to 1
+ * over a zone of BlockOverlap voxels on either side of the boundary:
+ *
+ *   w( s ) = 0.5 ( 1 + sin( pi / 2 * s / overlap ) ),  -overlap < s < overlap,
+ *
+ * with s the signed distance to the boundary, positive inside the core. The
+ * weights of two neighbouring blocks add up to 1, so the blend is a partition
+ * of unity. Control points outside the fixed image domain are treated as
+ * the nearest point of the domain. The overlap should be a few B-spline grid
+ * spacings, such that the control points in the blended zone are well
+ * determined by both blocks; an overlap of 0 picks the block that contains
+ * the control point.
+ *
+ * The control points are processed in parallel on the PersistentThreadPool.
+ *
+ * \ingroup Transforms
+ */
+
+template< class TScalarType = double, unsigned int NDimensions = 3 >
+class BSplineBlockStitcher : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BSplineBlockStitcher       Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BSplineBlockStitcher, Object );
+
+  /** The dimension. */
+  itkStaticConstMacro( Dimension, unsigned int, NDimensions );
+
+  /** Typedefs. */
+  typedef AdvancedBSplineDeformableTransformBase<
+    TScalarType, NDimensions >                          BSplineTransformType;
+  typedef typename BSplineTransformType::ParametersType ParametersType;
+  typedef ImageBase< NDimensions >                      ReferenceImageType;
+  typedef typename ReferenceImageType::ConstPointer     ReferenceImageConstPointer;
+  typedef ImageRegion< NDimensions >                    RegionType;
+  typedef typename RegionType::IndexType                IndexType;
+  typedef typename RegionType::SizeType                 SizeType;
+
+  /** Compute the region of block blockIndex of a domain that is divided into
+   * numberOfBlocks[ d ] blocks along dimension d. The blocks are numbered in
+   * raster order, the first dimension running fastest. The block is extended
+   * by overlap[ d ] voxels on each side, and clipped to the domain.
+   */
+  static RegionType ComputeBlockRegion( const RegionType & domain,
+    const SizeType & numberOfBlocks, SizeValueType blockIndex,
+    const SizeType & overlap );
+
+  /** The total number of blocks, the product of numberOfBlocks. */
+  static SizeValueType GetTotalNumberOfBlocks( const SizeType & numberOfBlocks );
+
+  /** Set/Get the image that defines the domain and the index space of the
+   * decomposition, normally the fixed image. Only its geometry is used.
+   */
+  itkSetConstObjectMacro( ReferenceImage, ReferenceImageType );
+  itkGetConstObjectMacro( ReferenceImage, ReferenceImageType );
+
+  /** Set/Get the number of blocks along each dimension. Default: 1. */
+  itkSetMacro( NumberOfBlocks, SizeType );
+  itkGetConstMacro( NumberOfBlocks, SizeType );
+
+  /** Set/Get the overlap of the blocks, in voxels of the reference image.
+   * Default: 0.
+   */
+  itkSetMacro( BlockOverlap, SizeType );
+  itkGetConstMacro( BlockOverlap, SizeType );
+
+  /** Set/Get a transform with the B-spline grid of the blocks, for example
+   * one of the block transforms. Only its grid is used.
+   */
+  itkSetConstObjectMacro( GridTransform, BSplineTransformType );
+  itkGetConstObjectMacro( GridTransform, BSplineTransformType );
+
+  /** Set the B-spline parameters of the registration of a block. All
+   * blocks must be set before Stitch() is called.
+   */
+  void SetBlockParameters( SizeValueType blockIndex, const ParametersType & parameters );
+
+  /** Set/Get whether the PersistentThreadPool is used. The default is true. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Blend the parameters of the blocks. Throws when the input is missing,
+   * or when the parameters of a block do not match the grid.
+   */
+  void Stitch( void );
+
+  /** Get the stitched parameters, which can be set in a transform with the
+   * grid of the GridTransform.
+   */
+  itkGetConstReferenceMacro( OutputParameters, ParametersType );
+
+protected:
+
+  BSplineBlockStitcher();
+  virtual ~BSplineBlockStitcher() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  BSplineBlockStitcher( const Self & ); // purposely not implemented
+  void operator=( const Self & );       // purposely not implemented
+
+  /** The data shared by the chunks of control points. The cores of the
+   * blocks are stored as their lower and upper bounds, in continuous
+   * indices of the reference image, with the inner boundaries flagged.
+   */
+  struct StitchJobType
+  {
+    const Self *          st_Stitcher;
+    ParametersType *      st_OutputParameters;
+    SizeValueType         st_NumberOfControlPoints;
+    std::vector< double > st_CoreLower;
+    std::vector< double > st_CoreUpper;
+    std::vector< bool >   st_InnerLower;
+    std::vector< bool >   st_InnerUpper;
+    double                st_DomainLower[ NDimensions ];
+    double                st_DomainUpper[ NDimensions ];
+  };
+
+  /** Blend the control points [begin, end). */
+  static void StitchRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  ReferenceImageConstPointer                  m_ReferenceImage;
+  SizeType                                    m_NumberOfBlocks;
+  SizeType                                    m_BlockOverlap;
+  typename BSplineTransformType::ConstPointer m_GridTransform;
+  std::vector< ParametersType >               m_BlockParameters;
+  bool                                        m_UseMultiThread;
+
+  ParametersType m_OutputParameters;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBSplineBlockStitcher.hxx"
+#endif
+
+#endif // end #ifndef __itkBSplineBlockStitcher_h
@@ -0,0 +1,330 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineBlockStitcher_hxx
+#define __itkBSplineBlockStitcher_hxx
+
+#include "itkBSplineBlockStitcher.h"
+#include "itkPersistentThreadPool.h"
+#include "itkContinuousIndex.h"
+#include "vnl/vnl_math.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ************************* Constructor *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+BSplineBlockStitcher< TScalarType, NDimensions >
+::BSplineBlockStitcher()
+{
+  this->m_NumberOfBlocks.Fill( 1 );
+  this->m_BlockOverlap.Fill( 0 );
+  this->m_UseMultiThread = true;
+
+} // end Constructor
+
+
+/**
+ * ************************* ComputeBlockRegion *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+typename BSplineBlockStitcher< TScalarType, NDimensions >::RegionType
+BSplineBlockStitcher< TScalarType, NDimensions >
+::ComputeBlockRegion( const RegionType & domain,
+  const SizeType & numberOfBlocks, SizeValueType blockIndex,
+  const SizeType & overlap )
+{
+  if( blockIndex >= Self::GetTotalNumberOfBlocks( numberOfBlocks ) )
+  {
+    itkGenericExceptionMacro( << "ERROR: block " << blockIndex
+      << " does not exist; the number of blocks is " << numberOfBlocks << "." );
+  }
+
+  IndexType     index;
+  SizeType      size;
+  SizeValueType remainder = blockIndex;
+  for( unsigned int d = 0; d < NDimensions; ++d )
+  {
+    const SizeValueType n = std::max< SizeValueType >( numberOfBlocks[ d ], 1 );
+    const SizeValueType k = remainder % n;
+    remainder /= n;
+
+    /** The core of the block, extended by the overlap and clipped to the domain. */
+    const IndexValueType domainLower = domain.GetIndex()[ d ];
+    const IndexValueType domainUpper = domainLower + static_cast< IndexValueType >( domain.GetSize()[ d ] );
+    const IndexValueType coreLower   = domainLower
+      + static_cast< IndexValueType >( ( k * domain.GetSize()[ d ] ) / n );
+    const IndexValueType coreUpper   = domainLower
+      + static_cast< IndexValueType >( ( ( k + 1 ) * domain.GetSize()[ d ] ) / n );
+    const IndexValueType lower = std::max( coreLower - static_cast< IndexValueType >( overlap[ d ] ), domainLower );
+    const IndexValueType upper = std::min( coreUpper + static_cast< IndexValueType >( overlap[ d ] ), domainUpper );
+
+    index[ d ] = lower;
+    size[ d ]  = static_cast< SizeValueType >( upper - lower );
+  }
+
+  return RegionType( index, size );
+
+} // end ComputeBlockRegion()
+
+
+/**
+ * ************************* GetTotalNumberOfBlocks *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+SizeValueType
+BSplineBlockStitcher< TScalarType, NDimensions >
+::GetTotalNumberOfBlocks( const SizeType & numberOfBlocks )
+{
+  SizeValueType total = 1;
+  for( unsigned int d = 0; d < NDimensions; ++d )
+  {
+    total *= std::max< SizeValueType >( numberOfBlocks[ d ], 1 );
+  }
+  return total;
+
+} // end GetTotalNumberOfBlocks()
+
+
+/**
+ * ************************* SetBlockParameters *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+BSplineBlockStitcher< TScalarType, NDimensions >
+::SetBlockParameters( SizeValueType blockIndex, const ParametersType & parameters )
+{
+  const SizeValueType numberOfBlocks = Self::GetTotalNumberOfBlocks( this->m_NumberOfBlocks );
+  if( blockIndex >= numberOfBlocks )
+  {
+    itkExceptionMacro( << "ERROR: block " << blockIndex
+      << " does not exist; the number of blocks is " << this->m_NumberOfBlocks << "." );
+  }
+
+  this->m_BlockParameters.resize( numberOfBlocks );
+  this->m_BlockParameters[ blockIndex ] = parameters;
+  this->Modified();
+
+} // end SetBlockParameters()
+
+
+/**
+ * ************************* Stitch *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+BSplineBlockStitcher< TScalarType, NDimensions >
+::Stitch( void )
+{
+  /** Check the input. */
+  if( !this->m_ReferenceImage )
+  {
+    itkExceptionMacro( << "Stitch(): No reference image has been set." );
+  }
+  if( !this->m_GridTransform )
+  {
+    itkExceptionMacro( << "Stitch(): No grid transform has been set." );
+  }
+  const SizeValueType numberOfBlocks    = Self::GetTotalNumberOfBlocks( this->m_NumberOfBlocks );
+  const SizeValueType numberOfParameters = this->m_GridTransform->GetNumberOfParameters();
+  if( this->m_BlockParameters.size() != numberOfBlocks )
+  {
+    itkExceptionMacro( << "Stitch(): The parameters of all " << numberOfBlocks
+                       << " blocks should be set." );
+  }
+  for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+  {
+    if( this->m_BlockParameters[ b ].GetSize() != numberOfParameters )
+    {
+      itkExceptionMacro( << "Stitch(): Block " << b << " has "
+                         << this->m_BlockParameters[ b ].GetSize() << " parameters instead of "
+                         << numberOfParameters << "; the blocks should use the B-spline grid "
+                         << "of the whole fixed image." );
+    }
+  }
+
+  /** Store the cores of the blocks as continuous indices, where the voxel
+   * centers are at integer positions.
+   */
+  StitchJobType job;
+  job.st_Stitcher              = this;
+  job.st_OutputParameters      = &this->m_OutputParameters;
+  job.st_NumberOfControlPoints = this->m_GridTransform->GetNumberOfParametersPerDimension();
+  job.st_CoreLower.resize( numberOfBlocks * NDimensions );
+  job.st_CoreUpper.resize( numberOfBlocks * NDimensions );
+  job.st_InnerLower.resize( numberOfBlocks * NDimensions );
+  job.st_InnerUpper.resize( numberOfBlocks * NDimensions );
+
+  const RegionType domain = this->m_ReferenceImage->GetLargestPossibleRegion();
+  SizeType         noOverlap;
+  noOverlap.Fill( 0 );
+  for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+  {
+    const RegionType core = Self::ComputeBlockRegion( domain, this->m_NumberOfBlocks, b, noOverlap );
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      const SizeValueType i = b * NDimensions + d;
+      job.st_CoreLower[ i ]  = static_cast< double >( core.GetIndex()[ d ] ) - 0.5;
+      job.st_CoreUpper[ i ]  = job.st_CoreLower[ i ] + static_cast< double >( core.GetSize()[ d ] );
+      job.st_InnerLower[ i ] = core.GetIndex()[ d ] > domain.GetIndex()[ d ];
+      job.st_InnerUpper[ i ] = core.GetIndex()[ d ] + static_cast< IndexValueType >( core.GetSize()[ d ] )
+        < domain.GetIndex()[ d ] + static_cast< IndexValueType >( domain.GetSize()[ d ] );
+    }
+  }
+  for( unsigned int d = 0; d < NDimensions; ++d )
+  {
+    job.st_DomainLower[ d ] = static_cast< double >( domain.GetIndex()[ d ] );
+    job.st_DomainUpper[ d ] = job.st_DomainLower[ d ]
+      + static_cast< double >( domain.GetSize()[ d ] ) - 1.0;
+  }
+
+  /** Blend the control points. */
+  this->m_OutputParameters.SetSize( numberOfParameters );
+  this->m_OutputParameters.Fill( 0.0 );
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      job.st_NumberOfControlPoints, 0, Self::StitchRangeFunction, &job );
+  }
+  else
+  {
+    Self::StitchRangeFunction( &job, 0, 0, job.st_NumberOfControlPoints );
+  }
+
+} // end Stitch()
+
+
+/**
+ * ************************* StitchRangeFunction *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+BSplineBlockStitcher< TScalarType, NDimensions >
+::StitchRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  StitchJobType *            job      = static_cast< StitchJobType * >( userData );
+  const Self *               stitcher = job->st_Stitcher;
+  const ReferenceImageType * image    = stitcher->m_ReferenceImage.GetPointer();
+  const typename BSplineTransformType::ImageType * grid
+    = stitcher->m_GridTransform->GetCoefficientImages()[ 0 ].GetPointer();
+
+  const SizeValueType numberOfBlocks = stitcher->m_BlockParameters.size();
+  const SizeValueType numberOfPoints = job->st_NumberOfControlPoints;
+  std::vector< double > weights( numberOfBlocks );
+
+  typename BSplineTransformType::ImageType::PointType point;
+  ContinuousIndex< double, NDimensions >              cindex;
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    /** The position of the control point in the domain of the blocks. */
+    grid->TransformIndexToPhysicalPoint( grid->ComputeIndex( j ), point );
+    image->TransformPhysicalPointToContinuousIndex( point, cindex );
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      cindex[ d ] = vnl_math_min( vnl_math_max( cindex[ d ], job->st_DomainLower[ d ] ),
+        job->st_DomainUpper[ d ] );
+    }
+
+    /** The weights of the blocks. */
+    double sumOfWeights = 0.0;
+    for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+    {
+      double weight = 1.0;
+      for( unsigned int d = 0; d < NDimensions && weight > 0.0; ++d )
+      {
+        const SizeValueType i       = b * NDimensions + d;
+        const double        overlap = static_cast< double >( stitcher->m_BlockOverlap[ d ] );
+        for( unsigned int side = 0; side < 2; ++side )
+        {
+          if( !( side == 0 ? job->st_InnerLower[ i ] : job->st_InnerUpper[ i ] ) )
+          {
+            continue;
+          }
+          const double s = side == 0
+            ? cindex[ d ] - job->st_CoreLower[ i ] : job->st_CoreUpper[ i ] - cindex[ d ];
+          if( s <= -overlap || ( overlap == 0.0 && s < 0.0 ) )
+          {
+            weight = 0.0;
+          }
+          else if( s < overlap )
+          {
+            weight *= 0.5 * ( 1.0 + std::sin( 0.5 * vnl_math::pi * s / overlap ) );
+          }
+        }
+      }
+      weights[ b ]  = weight;
+      sumOfWeights += weight;
+    }
+
+    /** The weighted mean of the coefficients of the blocks. */
+    if( sumOfWeights <= 0.0 )
+    {
+      continue;
+    }
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      const SizeValueType k     = d * numberOfPoints + j;
+      double              value = 0.0;
+      for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+      {
+        if( weights[ b ] > 0.0 )
+        {
+          value += weights[ b ] * stitcher->m_BlockParameters[ b ][ k ];
+        }
+      }
+      ( *job->st_OutputParameters )[ k ] = value / sumOfWeights;
+    }
+  }
+
+} // end StitchRangeFunction()
+
+
+/**
+ * ************************* PrintSelf *********************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+BSplineBlockStitcher< TScalarType, NDimensions >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "ReferenceImage: " << this->m_ReferenceImage.GetPointer() << std::endl;
+  os << indent << "NumberOfBlocks: " << this->m_NumberOfBlocks << std::endl;
+  os << indent << "BlockOverlap: " << this->m_BlockOverlap << std::endl;
+  os << indent << "GridTransform: " << this->m_GridTransform.GetPointer() << std::endl;
+  os << indent << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineBlockStitcher_hxx
@@ -70,10 +70,11 @@ public:
   itkStaticConstMacro( SplineOrder, unsigned int, VSplineOrder );
 
   /** Typedefs from Superclass. */
-  typedef typename Superclass::WeightsType         WeightsType;
-  typedef typename Superclass::IndexType           IndexType;
-  typedef typename Superclass::SizeType            SizeType;
-  typedef typename Superclass::ContinuousIndexType ContinuousIndexType;
+  typedef typename Superclass::WeightsType             WeightsType;
+  typedef typename Superclass::IndexType               IndexType;
+  typedef typename Superclass::SizeType                SizeType;
+  typedef typename Superclass::ContinuousIndexType     ContinuousIndexType;
+  typedef typename Superclass::PeriodicWeightTableType PeriodicWeightTableType;
 
   /** Set the first order derivative direction. */
   virtual void SetDerivativeDirection( unsigned int dir );
@@ -95,6 +95,13 @@ BSplineInterpolationDerivativeWeightFunction< TCoordRep, VSpaceDimension, VSplin
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    if( this->Lookup1DWeights( cindex, startIndex, i, i != this->m_DerivativeDirection
+      ? PeriodicWeightTableType::Weights : PeriodicWeightTableType::DerivativeWeights,
+      weights1D ) )
+    {
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
 
     if( i != this->m_DerivativeDirection )
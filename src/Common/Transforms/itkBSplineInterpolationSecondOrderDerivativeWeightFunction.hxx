@@ -111,6 +111,18 @@ BSplineInterpolationSecondOrderDerivativeWeightFunction< TCoordRep, VSpaceDimens
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    typename PeriodicWeightTableType::WeightsKindType kind = PeriodicWeightTableType::Weights;
+    if( i == this->m_DerivativeDirections[ 0 ] || i == this->m_DerivativeDirections[ 1 ] )
+    {
+      kind = this->m_EqualDerivativeDirections
+        ? PeriodicWeightTableType::SecondOrderDerivativeWeights
+        : PeriodicWeightTableType::DerivativeWeights;
+    }
+    if( this->Lookup1DWeights( index, startIndex, i, kind, weights1D ) )
+    {
+      continue;
+    }
+
     double x = index[ i ] - static_cast< double >( startIndex[ i ] );
 
     if( i != this->m_DerivativeDirections[ 0 ]
@@ -52,6 +52,12 @@ BSplineInterpolationWeightFunction2< TCoordRep, VSpaceDimension, VSplineOrder >
   /** Compute the 1D weights. */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    if( this->Lookup1DWeights( index, startIndex, i,
+      PeriodicWeightTableType::Weights, weights1D ) )
+    {
+      continue;
+    }
+
     double x = index[ i ] - static_cast< double >( startIndex[ i ] );
 
     // Compute weights
@@ -26,6 +26,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include "itkBSplinePeriodicWeightTable.h"
 
 namespace itk
 {
@@ -129,6 +130,28 @@ public:
   /** Get number of weights. */
   itkGetConstMacro( NumberOfWeights, unsigned long );
 
+  /** Typedef for the table of weights at the phases of a sample grid. */
+  typedef BSplinePeriodicWeightTable<
+    itkGetStaticConstMacro( SpaceDimension ),
+    itkGetStaticConstMacro( SplineOrder ) >  PeriodicWeightTableType;
+
+  /** Set/Get the table of weights at the phases of the sample grid. Indices
+   * at these phases get their start index and 1D weights from the table;
+   * other indices are evaluated as usual. Not thread safe: set it before
+   * evaluating.
+   */
+  void SetPeriodicWeightTable( const PeriodicWeightTableType & table )
+  {
+    this->m_PeriodicWeightTable = table;
+  }
+
+
+  const PeriodicWeightTableType & GetPeriodicWeightTable( void ) const
+  {
+    return this->m_PeriodicWeightTable;
+  }
+
+
 protected:
 
   BSplineInterpolationWeightFunctionBase();
@@ -160,6 +183,28 @@ protected:
     const IndexType & startIndex,
     OneDWeightsType & weights1D ) const = 0;
 
+  /** Copy the 1D weights of dimension dim from the periodic weight table.
+   * Returns false when cindex is not at a phase of the table.
+   */
+  inline bool Lookup1DWeights( const ContinuousIndexType & cindex,
+    const IndexType & startIndex, unsigned int dim,
+    typename PeriodicWeightTableType::WeightsKindType kind,
+    OneDWeightsType & weights1D ) const
+  {
+    const double * tableWeights = this->m_PeriodicWeightTable.LookupAtStartIndex(
+      dim, cindex[ dim ], startIndex[ dim ], kind );
+    if( tableWeights == 0 )
+    {
+      return false;
+    }
+    for( unsigned int k = 0; k < SplineOrder + 1; ++k )
+    {
+      weights1D[ dim ][ k ] = tableWeights[ k ];
+    }
+    return true;
+  }
+
+
   /** Print the member variables. */
   virtual void PrintSelf( std::ostream & os, Indent indent ) const;
 
@@ -168,6 +213,9 @@ protected:
   SizeType      m_SupportSize;
   TableType     m_OffsetToIndexTable;
 
+  /** The weights at the phases of the sample grid. */
+  PeriodicWeightTableType m_PeriodicWeightTable;
+
   /** Interpolation kernels. */
   typename KernelType::Pointer m_Kernel;
   typename DerivativeKernelType::Pointer m_DerivativeKernel;
@@ -140,9 +140,16 @@ BSplineInterpolationWeightFunctionBase< TCoordRep, VSpaceDimension, VSplineOrder
   const ContinuousIndexType & cindex,
   IndexType & startIndex ) const
 {
-  /** Find the starting index of the support region. */
+  /** Find the starting index of the support region, from the periodic
+   * weight table if cindex is at a phase of it.
+   */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    if( this->m_PeriodicWeightTable.Lookup( i, cindex[ i ], startIndex[ i ],
+      PeriodicWeightTableType::Weights ) )
+    {
+      continue;
+    }
     startIndex[ i ] = static_cast< typename IndexType::IndexValueType >(
       vcl_floor( cindex[ i ]
       - static_cast< double >( this->m_SupportSize[ i ] - 2.0 ) / 2.0 ) );
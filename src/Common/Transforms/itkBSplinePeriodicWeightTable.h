@@ -0,0 +1,182 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplinePeriodicWeightTable_h
+#define __itkBSplinePeriodicWeightTable_h
+
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+#include "vcl_cmath.h"
+#include "vnl/vnl_math.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class BSplinePeriodicWeightTable
+ *
+ * \brief A small table of the 1D B-spline weights at the positions of a
+ * regular sample grid that is aligned with the control point grid.
+ *
+ * The weights along a dimension only depend on the fractional part of the
+ * continuous grid index. When the samples are taken on a regular grid whose
+ * step, in grid index units, is a ratio m / n of small integers, for example
+ * the voxels of an image with a control point spacing of n voxels, there are
+ * only n fractional parts. The table holds, for each of these phases, the
+ * weights, their first and second order derivatives, and the offset of the
+ * start index of the support region.
+ *
+ * Lookup() finds the phase of a continuous index. Indices that are not at
+ * a phase of the sample grid, within a tolerance of 1e-9, are not found, so
+ * that the caller can evaluate the kernels instead. The table is tiny,
+ * (SplineOrder + 1) * 4 * n doubles per dimension, with n at most
+ * MaximumNumberOfPhases, and it is only read during the evaluation, so it
+ * can be shared by threads.
+ *
+ * \ingroup Transforms
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+class BSplinePeriodicWeightTable
+{
+public:
+
+  /** Space dimension, spline order and support size. */
+  itkStaticConstMacro( SpaceDimension, unsigned int, VSpaceDimension );
+  itkStaticConstMacro( SplineOrder, unsigned int, VSplineOrder );
+  itkStaticConstMacro( SupportSize, unsigned int, VSplineOrder + 1 );
+
+  /** The largest number of phases per dimension. */
+  itkStaticConstMacro( MaximumNumberOfPhases, unsigned int, 64 );
+
+  /** The kinds of weights in the table. The weights, the derivative
+   * weights and the second order derivative weights are tabulated as the
+   * BSplineInterpolation*WeightFunctions evaluate them, one support point at
+   * a time. The SupportDerivativeWeights are the derivative weights as
+   * BSplineDerivativeKernelFunction2 evaluates them for the whole support at
+   * once, which the RecursiveBSplineInterpolationWeightFunction uses; for
+   * spline order 3 these have the opposite sign of the DerivativeWeights.
+   */
+  typedef enum {
+    Weights                      = 0,
+    DerivativeWeights            = 1,
+    SecondOrderDerivativeWeights = 2,
+    SupportDerivativeWeights     = 3
+  } WeightsKindType;
+  itkStaticConstMacro( NumberOfWeightsKinds, unsigned int, 4 );
+
+  BSplinePeriodicWeightTable();
+  ~BSplinePeriodicWeightTable() {}
+
+  /** Set the sample grid along dimension dim: the samples are at the
+   * continuous grid indices offset + k * step, for integer k. Returns false,
+   * and disables the table for this dimension, when the step is not a ratio
+   * with a denominator of at most MaximumNumberOfPhases.
+   */
+  bool SetSampleGrid( unsigned int dim, double offset, double step );
+
+  /** Disable the table for dimension dim. */
+  void RemoveSampleGrid( unsigned int dim );
+
+  /** Disable the table for all dimensions. */
+  void RemoveSampleGrid( void );
+
+  /** Get the number of phases of dimension dim, or zero when disabled. */
+  unsigned int GetNumberOfPhases( unsigned int dim ) const
+  {
+    return this->m_NumberOfPhases[ dim ];
+  }
+
+
+  /** Check whether the table is enabled for any dimension. */
+  bool IsEnabled( void ) const
+  {
+    return this->m_Enabled;
+  }
+
+
+  /** Look up the continuous index cindex along dimension dim. Returns the
+   * SupportSize weights of the given kind, and sets startIndex to the start
+   * of the support region, or returns 0 when cindex is not at a phase of the
+   * sample grid.
+   */
+  inline const double * Lookup( unsigned int dim, double cindex,
+    IndexValueType & startIndex, WeightsKindType kind ) const
+  {
+    const unsigned int n = this->m_NumberOfPhases[ dim ];
+    if( n == 0 )
+    {
+      return 0;
+    }
+
+    /** Find the nearest sample position, and check that cindex is at it. */
+    const double u = ( cindex - this->m_Offset[ dim ] ) * static_cast< double >( n );
+    const double k = vcl_floor( u + 0.5 );
+    if( u - k > this->m_Tolerance[ dim ] || k - u > this->m_Tolerance[ dim ] )
+    {
+      return 0;
+    }
+
+    /** Split the sample position into a whole number of grid cells and a
+     * phase, and get the phase's start index and weights.
+     */
+    const double       q     = vcl_floor( k / static_cast< double >( n ) );
+    const unsigned int phase = static_cast< unsigned int >( k - q * static_cast< double >( n ) ) % n;
+    startIndex = static_cast< IndexValueType >( q ) + this->m_StartIndexOffsets[ dim ][ phase ];
+    return &this->m_Weights[ dim ][ ( phase * NumberOfWeightsKinds + kind ) * SupportSize ];
+  }
+
+
+  /** Look up the weights for a given start index: returns 0 when cindex is
+   * not at a phase of the sample grid, or when the phase has a different
+   * start index, for example one that was computed without the table.
+   */
+  inline const double * LookupAtStartIndex( unsigned int dim, double cindex,
+    IndexValueType startIndex, WeightsKindType kind ) const
+  {
+    IndexValueType tableStartIndex = 0;
+    const double * weights = this->Lookup( dim, cindex, tableStartIndex, kind );
+    return ( weights != 0 && tableStartIndex == startIndex ) ? weights : 0;
+  }
+
+
+private:
+
+  /** The number of phases, the offset and the lookup tolerance of each
+   * dimension.
+   */
+  unsigned int m_NumberOfPhases[ VSpaceDimension ];
+  double       m_Offset[ VSpaceDimension ];
+  double       m_Tolerance[ VSpaceDimension ];
+  bool         m_Enabled;
+
+  /** For each phase the offset of the start index, and the weights of
+   * each kind.
+   */
+  std::vector< IndexValueType > m_StartIndexOffsets[ VSpaceDimension ];
+  std::vector< double >         m_Weights[ VSpaceDimension ];
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBSplinePeriodicWeightTable.hxx"
+#endif
+
+#endif // end #ifndef __itkBSplinePeriodicWeightTable_h
@@ -0,0 +1,166 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplinePeriodicWeightTable_hxx
+#define __itkBSplinePeriodicWeightTable_hxx
+
+#include "itkBSplinePeriodicWeightTable.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+BSplinePeriodicWeightTable< VSpaceDimension, VSplineOrder >
+::BSplinePeriodicWeightTable()
+{
+  this->RemoveSampleGrid();
+
+} // end Constructor
+
+
+/**
+ * ********************* SetSampleGrid ****************************
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+bool
+BSplinePeriodicWeightTable< VSpaceDimension, VSplineOrder >
+::SetSampleGrid( unsigned int dim, double offset, double step )
+{
+  this->RemoveSampleGrid( dim );
+
+  /** Find the smallest n for which n * step is whole. */
+  const double tolerance      = 1e-9;
+  unsigned int numberOfPhases = 0;
+  for( unsigned int n = 1; n <= MaximumNumberOfPhases; ++n )
+  {
+    const double ns = static_cast< double >( n ) * vcl_abs( step );
+    if( vcl_abs( ns - vcl_floor( ns + 0.5 ) ) <= tolerance * vnl_math_max( 1.0, ns ) )
+    {
+      numberOfPhases = n;
+      break;
+    }
+  }
+  if( numberOfPhases == 0 )
+  {
+    return false;
+  }
+
+  /** The sample positions are offset + j / n for integer j. Move the offset
+   * to [0, 1/n), so that phase p is at offset + p / n in [0, 1).
+   */
+  const double n = static_cast< double >( numberOfPhases );
+  offset -= vcl_floor( offset * n ) / n;
+
+  typedef BSplineKernelFunction2< VSplineOrder >                      KernelType;
+  typedef BSplineDerivativeKernelFunction2< VSplineOrder >            DerivativeKernelType;
+  typedef BSplineSecondOrderDerivativeKernelFunction2< VSplineOrder > SecondOrderDerivativeKernelType;
+  typename KernelType::Pointer                      kernel = KernelType::New();
+  typename DerivativeKernelType::Pointer            derivativeKernel = DerivativeKernelType::New();
+  typename SecondOrderDerivativeKernelType::Pointer secondOrderDerivativeKernel
+    = SecondOrderDerivativeKernelType::New();
+
+  /** Tabulate the start index and the weights of every phase, as the
+   * weight functions compute them.
+   */
+  this->m_StartIndexOffsets[ dim ].resize( numberOfPhases );
+  this->m_Weights[ dim ].resize( numberOfPhases * NumberOfWeightsKinds * SupportSize );
+  for( unsigned int p = 0; p < numberOfPhases; ++p )
+  {
+    const double         position   = offset + static_cast< double >( p ) / n;
+    const IndexValueType startIndex = static_cast< IndexValueType >( vcl_floor(
+      position - static_cast< double >( SplineOrder - 1 ) / 2.0 ) );
+    const double x = position - static_cast< double >( startIndex );
+
+    double * weights = &this->m_Weights[ dim ][ p * NumberOfWeightsKinds * SupportSize ];
+    kernel->Evaluate( x, weights + Weights * SupportSize );
+    secondOrderDerivativeKernel->Evaluate( x, weights + SecondOrderDerivativeWeights * SupportSize );
+    derivativeKernel->Evaluate( x, weights + SupportDerivativeWeights * SupportSize );
+    for( unsigned int k = 0; k < SupportSize; ++k )
+    {
+      weights[ DerivativeWeights * SupportSize + k ]
+        = derivativeKernel->Evaluate( x - static_cast< double >( k ) );
+    }
+    this->m_StartIndexOffsets[ dim ][ p ] = startIndex;
+  }
+
+  this->m_NumberOfPhases[ dim ] = numberOfPhases;
+  this->m_Offset[ dim ]         = offset;
+  this->m_Tolerance[ dim ]      = tolerance * n;
+  this->m_Enabled               = true;
+
+  return true;
+
+} // end SetSampleGrid()
+
+
+/**
+ * ********************* RemoveSampleGrid ****************************
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+void
+BSplinePeriodicWeightTable< VSpaceDimension, VSplineOrder >
+::RemoveSampleGrid( unsigned int dim )
+{
+  this->m_NumberOfPhases[ dim ] = 0;
+  this->m_Offset[ dim ]         = 0.0;
+  this->m_Tolerance[ dim ]      = 0.0;
+  this->m_StartIndexOffsets[ dim ].clear();
+  this->m_Weights[ dim ].clear();
+
+  this->m_Enabled = false;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    this->m_Enabled |= this->m_NumberOfPhases[ i ] > 0;
+  }
+
+} // end RemoveSampleGrid()
+
+
+/**
+ * ********************* RemoveSampleGrid ****************************
+ */
+
+template< unsigned int VSpaceDimension, unsigned int VSplineOrder >
+void
+BSplinePeriodicWeightTable< VSpaceDimension, VSplineOrder >
+::RemoveSampleGrid( void )
+{
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    this->m_NumberOfPhases[ i ] = 0;
+    this->m_Offset[ i ]         = 0.0;
+    this->m_Tolerance[ i ]      = 0.0;
+    this->m_StartIndexOffsets[ i ].clear();
+    this->m_Weights[ i ].clear();
+  }
+  this->m_Enabled = false;
+
+} // end RemoveSampleGrid()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplinePeriodicWeightTable_hxx
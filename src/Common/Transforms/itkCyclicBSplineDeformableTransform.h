@@ -26,6 +26,8 @@
 #include "itkBSplineInterpolationSecondOrderDerivativeWeightFunction.h"
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkCyclicBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineInterpolationWeightFunction.h"
+#include "itkRecursiveBSplineTransformUnrolledImplementation.h"
 
 namespace itk
 {
@@ -35,6 +37,13 @@ namespace itk
  * \brief Deformable transform using a B-spline representation in which the
  *   B-spline grid is formulated in a cyclic way.
  *
+ * TransformPoint(), the Jacobian, the spatial Jacobian and the nonzero
+ * Jacobian indices use the recursive implementation of the
+ * RecursiveBSplineTransform. The support region may wrap around the end of
+ * the grid in the last dimension; this is handled at the top level of the
+ * recursion, by wrapping the index of each slice of the support region, so
+ * that the lower dimensions run through the normal (unrolled) code.
+ *
  * \ingroup Transforms
  */
 template<
@@ -75,9 +84,12 @@ public:
   typedef typename Superclass::SpatialHessianType SpatialHessianType;
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType     InternalMatrixType;
-  typedef typename Superclass::ParametersType         ParametersType;
-  typedef typename Superclass::NumberOfParametersType NumberOfParametersType;
+  typedef typename Superclass::InternalMatrixType      InternalMatrixType;
+  typedef typename Superclass::ParametersType          ParametersType;
+  typedef typename Superclass::ParametersValueType     ParametersValueType;
+  typedef typename Superclass::NumberOfParametersType  NumberOfParametersType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename ParametersType::ValueType PixelType;
@@ -92,6 +104,7 @@ public:
   typedef typename ImageType::DirectionType    DirectionType;
   typedef typename ImageType::PointType        OriginType;
   typedef typename RegionType::IndexType       GridOffsetType;
+  typedef typename GridOffsetType::OffsetValueType OffsetValueType;
   typedef typename Superclass::InputPointType  InputPointType;
   typedef typename Superclass::OutputPointType OutputPointType;
   typedef typename Superclass::WeightsType     WeightsType;
@@ -111,10 +124,24 @@ public:
     itkGetStaticConstMacro( SplineOrder ) >     RedWeightsFunctionType;
   typedef typename RedWeightsFunctionType::
     ContinuousIndexType RedContinuousIndexType;
+  typedef RecursiveBSplineInterpolationWeightFunction< ScalarType,
+    itkGetStaticConstMacro( SpaceDimension ),
+    itkGetStaticConstMacro( SplineOrder ) >     RecursiveBSplineWeightFunctionType;
 
   /** This method specifies the region over which the grid resides. */
   virtual void SetGridRegion( const RegionType & region );
 
+  /** Transform a point, with the recursive implementation. The last
+   * dimension is not displaced.
+   */
+  virtual OutputPointType TransformPoint( const InputPointType & point ) const;
+
+  /** Transform a batch of points with the recursive implementation. */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
   /** Transform points by a B-spline deformable transformation.
    * On return, weights contains the interpolation weights used to compute the
    * deformation and indices of the x (zeroth) dimension coefficient parameters
@@ -135,6 +162,52 @@ public:
     WeightsType & weights,
     ParameterIndexArrayType & indices ) const;
 
+  /** Compute the Jacobian of the transformation, with the recursive
+   * implementation.
+   */
+  virtual void GetJacobian(
+    const InputPointType & ipp,
+    JacobianType & j,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient. */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** The fixed sample features are the offset of the support region in the
+   * coefficient images in all but the last dimension (-1 if the support
+   * region is not inside the grid), the wrapped start index of the support
+   * region in the last dimension, and the 1D B-spline weights.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    return 2 + RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  }
+
+
+  /** Compute the fixed sample features and the nonzero Jacobian indices. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Transform a point, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -159,8 +232,37 @@ protected:
     RegionType & outRegion1,
     RegionType & outRegion2 ) const;
 
+  /** Give the weights functions the periodic weight table. */
+  virtual void UpdatePeriodicWeightTables( void );
+
+  typename RecursiveBSplineWeightFunctionType::Pointer m_RecursiveBSplineWeightFunction;
+
 private:
 
+  /** Split the start index of a support region into its offset in the
+   * coefficient images in all but the last dimension, and its index in the
+   * last dimension.
+   */
+  void ComputeCyclicOffset( const IndexType & supportIndex,
+    OffsetValueType & offsetToSupportIndex,
+    OffsetValueType & lastIndex ) const;
+
+  /** Compute the displacement in all but the last dimension of the support
+   * region that starts at the given offset and last index.
+   */
+  void ComputeDisplacement( ScalarType * displacement,
+    const OffsetValueType offsetToSupportIndex,
+    const OffsetValueType lastIndex,
+    const double * weights1D ) const;
+
+  /** Compute the nonzero Jacobian indices of the support region that
+   * starts at the given offset and last index.
+   */
+  void ComputeCyclicNonZeroJacobianIndices(
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+    const OffsetValueType offsetToSupportIndex,
+    const OffsetValueType lastIndex ) const;
+
   CyclicBSplineDeformableTransform( const Self & ); // purposely not implemented
   void operator=( const Self & );                   // purposely not implemented
 
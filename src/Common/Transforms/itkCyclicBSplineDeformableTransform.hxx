@@ -29,7 +29,20 @@ namespace itk
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
 CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 ::CyclicBSplineDeformableTransform() : Superclass()
-{}
+{
+  this->m_RecursiveBSplineWeightFunction = RecursiveBSplineWeightFunctionType::New();
+}
+
+/** Give the weights functions the periodic weight table. */
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::UpdatePeriodicWeightTables( void )
+{
+  this->Superclass::UpdatePeriodicWeightTables();
+  this->m_RecursiveBSplineWeightFunction->SetPeriodicWeightTable(
+    this->m_WeightsFunction->GetPeriodicWeightTable() );
+}
 
 /** Destructor. */
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
@@ -299,6 +312,323 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
 }
 
 
+/**
+ * ********************* TransformPoint ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+typename CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::OutputPointType
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPoint( const InputPointType & point ) const
+{
+  OutputPointType outputPoint = point;
+
+  /** Check if the coefficient image has been set. */
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    return outputPoint;
+  }
+
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( point, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * (except for the last dimension, which wraps around) we assume
+   * zero displacement and return the input point.
+   */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    return outputPoint;
+  }
+
+  /** Compute the 1D interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Call the recursive TransformPoint function. */
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportIndex, offsetToSupportIndex, lastIndex );
+  ScalarType displacement[ SpaceDimension - 1 ];
+  this->ComputeDisplacement( displacement, offsetToSupportIndex, lastIndex, weightsArray1D );
+
+  /** The output point is the start point + displacement. The last
+   * dimension is not displaced.
+   */
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+  {
+    outputPoint[ j ] += displacement[ j ];
+  }
+
+  return outputPoint;
+
+} // end TransformPoint()
+
+
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  /** Without coefficients all points are mapped onto themselves. */
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    std::copy( inputPoints, inputPoints + numberOfPoints, outputPoints );
+    return;
+  }
+
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    outputPoints[ n ] = this->Self::TransformPoint( inputPoints[ n ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::GetJacobian( const InputPointType & ipp, JacobianType & jacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** Initialize. */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if( ( jacobian.cols() != nnzji ) || ( jacobian.rows() != SpaceDimension ) )
+  {
+    jacobian.SetSize( SpaceDimension, nnzji );
+    jacobian.Fill( 0.0 );
+  }
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the 1D interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Recursively compute the first numberOfIndices entries of the Jacobian.
+   * They only depend on the weights, so the wrapping does not matter here.
+   */
+  ParametersValueType * jacobianPointer = jacobian.data_block();
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::GetJacobian( jacobianPointer, weightsArray1D, 1.0 );
+
+  /** Compute the nonzero Jacobian indices. */
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportIndex, offsetToSupportIndex, lastIndex );
+  this->ComputeCyclicNonZeroJacobianIndices( nonZeroJacobianIndices, offsetToSupportIndex, lastIndex );
+
+} // end GetJacobian()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if( !this->InsideValidRegion( cindex ) )
+  {
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the 1D interpolation weights. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Recursively compute the inner product of the Jacobian and the moving image gradient. */
+  double migArray[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    migArray[ j ] = movingImageGradient[ j ];
+  }
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, weightsArray1D, 1.0 );
+
+  /** Compute the nonzero Jacobian indices. */
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportIndex, offsetToSupportIndex, lastIndex );
+  this->ComputeCyclicNonZeroJacobianIndices( nonZeroJacobianIndices, offsetToSupportIndex, lastIndex );
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if( !this->m_CoefficientImages[ 0 ] || !this->InsideValidRegion( cindex ) )
+  {
+    features[ 0 ] = -1.0;
+    const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the 1D weights directly in the features array. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  WeightsType weights1D( features + 2, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Store the offset and the wrapped last index of the support region. */
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportIndex, offsetToSupportIndex, lastIndex );
+  const OffsetValueType lastSize
+    = this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion().GetSize( SpaceDimension - 1 );
+  features[ 0 ] = static_cast< double >( offsetToSupportIndex );
+  features[ 1 ] = static_cast< double >( RecursiveBSplineTransformImplementation<
+    SpaceDimension, SpaceDimension, SplineOrder, TScalarType >::WrapIndex( lastIndex, lastSize ) );
+
+  /** Compute the nonzero Jacobian indices. */
+  this->ComputeCyclicNonZeroJacobianIndices( nonZeroJacobianIndices, offsetToSupportIndex, lastIndex );
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+typename CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::OutputPointType
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  /** Zero displacement outside the valid region. */
+  OutputPointType outputPoint = ipp;
+  if( features[ 0 ] < 0.0 )
+  {
+    return outputPoint;
+  }
+
+  /** Call the recursive TransformPoint function with the stored weights. */
+  ScalarType displacement[ SpaceDimension - 1 ];
+  this->ComputeDisplacement( displacement,
+    static_cast< OffsetValueType >( features[ 0 ] ),
+    static_cast< OffsetValueType >( features[ 1 ] ), features + 2 );
+
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+  {
+    outputPoint[ j ] += displacement[ j ];
+  }
+
+  return outputPoint;
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & itkNotUsed( ipp ),
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  /** Zero Jacobian outside the valid region. */
+  if( features[ 0 ] < 0.0 )
+  {
+    imageJacobian.Fill( 0.0 );
+    return;
+  }
+
+  double migArray[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    migArray[ j ] = movingImageGradient[ j ];
+  }
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, features + 2, 1.0 );
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -318,8 +648,8 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
   }
 
   /** Convert the physical point to a continuous index, which
-       * is needed for the 'Evaluate()' functions below.
-       */
+   * is needed for the 'Evaluate()' functions below.
+   */
   ContinuousIndexType cindex;
   this->TransformPointToContinuousGridIndex( ipp, cindex );
 
@@ -331,64 +661,60 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
     return;
   }
 
-  /** Compute the number of affected B-spline parameters. */
-  /** Allocate memory on the stack: */
-  const SizeValueType numberOfWeights = WeightsFunctionType::NumberOfWeights;
-  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
-  WeightsType weights( weightsArray, numberOfWeights, false );
+  /** Compute the 1D interpolation weights and their derivatives. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  typename WeightsType::ValueType derivativeWeightsArray1D[ numberOfWeights ];
+  WeightsType derivativeWeights1D( derivativeWeightsArray1D, numberOfWeights, false );
 
   IndexType supportIndex;
-  this->m_DerivativeWeightsFunctions[ 0 ]->ComputeStartIndex(
-    cindex, supportIndex );
-  RegionType supportRegion;
-  supportRegion.SetSize( this->m_SupportSize );
-  supportRegion.SetIndex( supportIndex );
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+  this->m_RecursiveBSplineWeightFunction->EvaluateDerivative( cindex, derivativeWeights1D, supportIndex );
 
-  /** Split support region into two parts. */
-  RegionType supportRegions[ 2 ];
-  this->SplitRegion( this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion(),
-    supportRegion, supportRegions[ 0 ], supportRegions[ 1 ] );
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportIndex, offsetToSupportIndex, lastIndex );
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  const OffsetValueType   lastSize
+    = this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion().GetSize( SpaceDimension - 1 );
 
-  sj.Fill( 0.0 );
+  /** Recursively compute the spatial Jacobian, from the float copy of the
+   * coefficients if there is one.
+   */
+  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ];
+  if( this->m_FloatCoefficients[ 0 ] )
+  {
+    const float * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_FloatCoefficients[ j ] + offsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+      ::GetSpatialJacobianCyclic( spatialJacobian, mu, bsplineOffsetTable,
+      weightsArray1D, derivativeWeightsArray1D, lastIndex, lastSize );
+  }
+  else
+  {
+    ScalarType * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + offsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+      ::GetSpatialJacobianCyclic( spatialJacobian, mu, bsplineOffsetTable,
+      weightsArray1D, derivativeWeightsArray1D, lastIndex, lastSize );
+  }
 
-  /** Compute the spatial Jacobian sj:
-       *    dT_{dim} / dx_i = delta_{dim,i} + \sum coefs_{dim} * weights.
-       */
+  /** Copy the correct elements to the spatial Jacobian. The first
+   * SpaceDimension elements are the displacement.
+   */
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
-    /** Compute the derivative weights. */
-    this->m_DerivativeWeightsFunctions[ i ]->Evaluate( cindex, supportIndex, weights );
-
-    /** Compute the spatial Jacobian sj:
-            *    dT_{dim} / dx_i = \sum coefs_{dim} * weights.
-            */
-    for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
     {
-      /** Compute the sum for this dimension. */
-      double sum = 0.0;
-
-      typename WeightsType::const_iterator itWeights = weights.begin();
-
-      for( unsigned int r = 0; r < 2; ++r )
-      {
-        /** Create an iterator over the correct part of the coefficient
-                       * image. Create an iterator over the weights vector.
-                       */
-        ImageRegionConstIterator< ImageType > itCoef(
-        this->m_CoefficientImages[ dim ], supportRegions[ r ] );
-
-        while( !itCoef.IsAtEnd() )
-        {
-          sum += itCoef.Value() * ( *itWeights );
-          ++itWeights;
-          ++itCoef;
-        }
-      } // end for r
-
-      /** Update the spatial Jacobian sj. */
-      sj( dim, i ) += sum;
-    } // end for dim
-  }   // end for i
+      sj( i, j ) = spatialJacobian[ i + ( j + 1 ) * SpaceDimension ];
+    }
+  }
 
   /** Take into account grid spacing and direction cosines. */
   sj = sj * this->m_PointToIndexMatrix;
@@ -413,48 +739,106 @@ CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices,
   const RegionType & supportRegion ) const
 {
-  nonZeroJacobianIndices.resize( this->GetNumberOfNonZeroJacobianIndices() );
+  OffsetValueType offsetToSupportIndex, lastIndex;
+  this->ComputeCyclicOffset( supportRegion.GetIndex(), offsetToSupportIndex, lastIndex );
+  this->ComputeCyclicNonZeroJacobianIndices( nonZeroJacobianIndices, offsetToSupportIndex, lastIndex );
 
-  /** Split support region into two parts. */
-  RegionType supportRegions[ 2 ];
-  this->SplitRegion( this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion(),
-    supportRegion, supportRegions[ 0 ], supportRegions[ 1 ] );
+} // end ComputeNonZeroJacobianIndices()
 
-  /** Initialize some helper variables. */
-  const SizeValueType numberOfWeights = WeightsFunctionType::NumberOfWeights;
-  const SizeValueType parametersPerDim
-    = this->GetNumberOfParametersPerDimension();
-  unsigned long mu = 0;
 
-  for( unsigned int r = 0; r < 2; ++r )
+/**
+ * ********************* ComputeCyclicOffset ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeCyclicOffset(
+  const IndexType & supportIndex,
+  OffsetValueType & offsetToSupportIndex,
+  OffsetValueType & lastIndex ) const
+{
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  offsetToSupportIndex = 0;
+  for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
   {
-    /** Create iterator over the coefficient image (for current supportRegion). */
-    ImageRegionConstIteratorWithIndex< ImageType >
-    iterator( this->m_CoefficientImages[ 0 ], supportRegions[ r ] );
+    offsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+  }
+  lastIndex = supportIndex[ SpaceDimension - 1 ];
 
-    /** For all control points in the support region, set which of the
-            * indices in the parameter array are non-zero.
-            */
-    const PixelType * basePointer = this->m_CoefficientImages[ 0 ]->GetBufferPointer();
-    while( !iterator.IsAtEnd() )
+} // end ComputeCyclicOffset()
+
+
+/**
+ * ********************* ComputeDisplacement ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeDisplacement(
+  ScalarType * displacement,
+  const OffsetValueType offsetToSupportIndex,
+  const OffsetValueType lastIndex,
+  const double * weights1D ) const
+{
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  const OffsetValueType   lastSize
+    = this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion().GetSize( SpaceDimension - 1 );
+
+  /** Only the first SpaceDimension - 1 dimensions are displaced. Read the
+   * float copy of the coefficients if there is one.
+   */
+  if( this->m_FloatCoefficients[ 0 ] )
+  {
+    const float * mu[ SpaceDimension - 1 ];
+    for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
     {
-      /** Translate the index into a parameter number for the x-direction. */
-      const IdentifierType parameterNumber = &( iterator.Value() ) - basePointer;
+      mu[ j ] = this->m_FloatCoefficients[ j ] + offsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension - 1, SpaceDimension, SplineOrder, TScalarType >
+      ::TransformPointCyclic( displacement, mu, bsplineOffsetTable, weights1D, lastIndex, lastSize );
+  }
+  else
+  {
+    ScalarType * mu[ SpaceDimension - 1 ];
+    for( unsigned int j = 0; j < SpaceDimension - 1; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + offsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension - 1, SpaceDimension, SplineOrder, TScalarType >
+      ::TransformPointCyclic( displacement, mu, bsplineOffsetTable, weights1D, lastIndex, lastSize );
+  }
 
-      /** Update the nonZeroJacobianIndices for all directions. */
-      for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
-      {
-        nonZeroJacobianIndices[ mu + dim * numberOfWeights ]
-          = parameterNumber + dim * parametersPerDim;
-      }
+} // end ComputeDisplacement()
 
-      /** Increase the iterators. */
-      ++iterator;
-      ++mu;
-    } // end while
-  }   // end for (supportregions)
 
-} // end ComputeNonZeroJacobianIndices()
+/**
+ * ********************* ComputeCyclicNonZeroJacobianIndices ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+CyclicBSplineDeformableTransform< TScalarType, NDimensions, VSplineOrder >
+::ComputeCyclicNonZeroJacobianIndices(
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices,
+  const OffsetValueType offsetToSupportIndex,
+  const OffsetValueType lastIndex ) const
+{
+  nonZeroJacobianIndices.resize( this->GetNumberOfNonZeroJacobianIndices() );
+
+  const unsigned long     parametersPerDim = this->GetNumberOfParametersPerDimension();
+  const OffsetValueType * gridOffsetTable  = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  const OffsetValueType   lastSize
+    = this->m_CoefficientImages[ 0 ]->GetLargestPossibleRegion().GetSize( SpaceDimension - 1 );
+
+  /** Call the recursive implementation, which wraps the last dimension. */
+  unsigned long * nzjiPointer = &nonZeroJacobianIndices[ 0 ];
+  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalarType >
+    ::ComputeNonZeroJacobianIndicesCyclic( nzjiPointer, parametersPerDim,
+    offsetToSupportIndex, gridOffsetTable, lastIndex, lastSize );
+
+} // end ComputeCyclicNonZeroJacobianIndices()
 
 
 } // namespace
@@ -24,6 +24,10 @@
 #include "itkImage.h"
 #include "itkVectorInterpolateImageFunction.h"
 #include "itkVectorNearestNeighborInterpolateImageFunction.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+#include "itkHalfFloat.h"
+#include "itkMath.h"
+#include <vector>
 
 namespace itk
 {
@@ -36,6 +40,14 @@ namespace itk
 * is not implemented. DO NOT USE IT FOR REGISTRATION.
 * You may set your own interpolator!
 *
+* To save memory the deformation field can be stored in half precision
+* (16 bit floats), see SetHalfPrecisionStorage(). The field is then converted
+* when it is set, the transform does not keep a reference to the original
+* image, and TransformPoint() interpolates the half precision values itself,
+* with either nearest neighbour or linear interpolation, depending on the
+* type of the interpolator that is set. The relative precision of the
+* displacements is about 5e-4.
+*
 * \ingroup Transforms
 */
 
@@ -98,6 +110,8 @@ public:
   typedef typename DeformationFieldInterpolatorType::Pointer DeformationFieldInterpolatorPointer;
   typedef VectorNearestNeighborInterpolateImageFunction<
     DeformationFieldType, ScalarType >                DefaultDeformationFieldInterpolatorType;
+  typedef VectorLinearInterpolateImageFunction<
+    DeformationFieldType, ScalarType >                LinearDeformationFieldInterpolatorType;
 
   /** Set the transformation parameters is not supported.
    * Use SetDeformationField() instead
@@ -171,6 +185,20 @@ public:
 
   itkGetObjectMacro( DeformationFieldInterpolator, DeformationFieldInterpolatorType );
 
+  /** Store the deformation field in half precision. Must be set before
+   * SetDeformationField(). GetDeformationField() then returns an image
+   * without pixel buffer, that only holds the geometry of the field; use
+   * GetDecodedDeformationField() to obtain the values.
+   */
+  itkSetMacro( HalfPrecisionStorage, bool );
+  itkGetConstMacro( HalfPrecisionStorage, bool );
+  itkBooleanMacro( HalfPrecisionStorage );
+
+  /** Get the deformation field with its values: the stored field itself, or
+   * a newly allocated conversion of the half precision values.
+   */
+  virtual DeformationFieldPointer GetDecodedDeformationField( void ) const;
+
   virtual bool IsLinear( void ) const { return false; }
 
   /** Must be provided. */
@@ -249,6 +277,19 @@ protected:
 
 private:
 
+  /** TransformPoint() for the half precision field. */
+  OutputPointType TransformPointHalfPrecision( const InputPointType & point ) const;
+
+  /** The half precision displacements, NDimensions per voxel. */
+  bool                                  m_HalfPrecisionStorage;
+  std::vector< HalfFloat::StorageType > m_HalfPrecisionDeformationField;
+
+  /** The interpolation order of the interpolator: 0 for nearest neighbour,
+   * 1 for linear, and -1 for other interpolators, which cannot be
+   * emulated for the half precision field.
+   */
+  int m_InterpolationOrder;
+
   DeformationFieldInterpolatingTransform( const Self & ); // purposely not implemented
   void operator=( const Self & );                         // purposely not implemented
 
@@ -0,0 +1,320 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef _itkDeformationFieldInterpolatingTransform_hxx
+#define _itkDeformationFieldInterpolatingTransform_hxx
+
+#include "itkDeformationFieldInterpolatingTransform.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+// Constructor with default arguments
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::DeformationFieldInterpolatingTransform() :
+  Superclass( OutputSpaceDimension )
+{
+  this->m_DeformationField     = 0;
+  this->m_HalfPrecisionStorage = false;
+  this->m_InterpolationOrder   = 0;
+  this->m_ZeroDeformationField = DeformationFieldType::New();
+  typename DeformationFieldType::SizeType dummySize;
+  dummySize.Fill( 0 );
+  this->m_ZeroDeformationField->SetRegions( dummySize );
+  this->SetIdentity();
+
+} // end Constructor
+
+
+// Destructor
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::
+~DeformationFieldInterpolatingTransform()
+{} // end Destructor
+
+// Transform a point
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+typename DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::
+OutputPointType
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::TransformPoint( const InputPointType & point ) const
+{
+  if( this->m_HalfPrecisionStorage )
+  {
+    return this->TransformPointHalfPrecision( point );
+  }
+
+  InputContinuousIndexType cindex;
+  this->m_DeformationFieldInterpolator->ConvertPointToContinuousIndex(
+    point, cindex );
+
+  if( this->m_DeformationFieldInterpolator->IsInsideBuffer( cindex ) )
+  {
+    InterpolatorOutputType vec
+      = this->m_DeformationFieldInterpolator->EvaluateAtContinuousIndex( cindex );
+    OutputPointType outpoint;
+    for( unsigned int i = 0; i < InputSpaceDimension; ++i )
+    {
+      outpoint[ i ] = point[ i ] + static_cast< ScalarType >( vec[ i ] );
+    }
+    return outpoint;
+
+  }
+  else
+  {
+    return point;
+  }
+}
+
+
+// Transform a point, using the half precision deformation field
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+typename DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::
+OutputPointType
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::TransformPointHalfPrecision( const InputPointType & point ) const
+{
+  if( this->m_InterpolationOrder < 0 )
+  {
+    itkExceptionMacro( << "Only nearest neighbour and linear interpolation are "
+                       << "supported for a half precision deformation field." );
+  }
+
+  InputContinuousIndexType cindex;
+  this->m_DeformationFieldInterpolator->ConvertPointToContinuousIndex(
+    point, cindex );
+  if( !this->m_DeformationFieldInterpolator->IsInsideBuffer( cindex ) )
+  {
+    return point;
+  }
+
+  typedef typename DeformationFieldType::RegionType RegionType;
+  typedef typename DeformationFieldType::IndexType  IndexType;
+  const RegionType &      region      = this->m_DeformationField->GetBufferedRegion();
+  const OffsetValueType * offsetTable = this->m_DeformationField->GetOffsetTable();
+  const HalfFloat::StorageType * field = &this->m_HalfPrecisionDeformationField[ 0 ];
+
+  ScalarType displacement[ NDimensions ];
+  std::fill( displacement, displacement + NDimensions, 0.0 );
+
+  if( this->m_InterpolationOrder == 0 )
+  {
+    /** Round like the VectorNearestNeighborInterpolateImageFunction. */
+    OffsetValueType offset = 0;
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      const IndexValueType index = Math::RoundHalfIntegerUp< IndexValueType >( cindex[ d ] );
+      offset += ( index - region.GetIndex( d ) ) * offsetTable[ d ];
+    }
+    for( unsigned int k = 0; k < NDimensions; ++k )
+    {
+      displacement[ k ] = HalfFloat::ToFloat( field[ offset * NDimensions + k ] );
+    }
+  }
+  else
+  {
+    /** Linear interpolation over the 2^N neighbours, clamped to the buffer
+     * like the VectorLinearInterpolateImageFunction does.
+     */
+    IndexType  baseIndex;
+    ScalarType distance[ NDimensions ];
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      baseIndex[ d ] = Math::Floor< IndexValueType >( cindex[ d ] );
+      distance[ d ]  = cindex[ d ] - static_cast< ScalarType >( baseIndex[ d ] );
+    }
+
+    const unsigned int numberOfNeighbors = 1u << NDimensions;
+    for( unsigned int counter = 0; counter < numberOfNeighbors; ++counter )
+    {
+      ScalarType      weight = 1.0;
+      OffsetValueType offset = 0;
+      for( unsigned int d = 0; d < NDimensions; ++d )
+      {
+        IndexValueType index = baseIndex[ d ];
+        if( counter & ( 1u << d ) )
+        {
+          ++index;
+          weight *= distance[ d ];
+        }
+        else
+        {
+          weight *= 1.0 - distance[ d ];
+        }
+        const IndexValueType last = region.GetIndex( d )
+          + static_cast< IndexValueType >( region.GetSize( d ) ) - 1;
+        index   = std::max( region.GetIndex( d ), std::min( index, last ) );
+        offset += ( index - region.GetIndex( d ) ) * offsetTable[ d ];
+      }
+      if( weight == 0.0 ) { continue; }
+
+      for( unsigned int k = 0; k < NDimensions; ++k )
+      {
+        displacement[ k ] += weight * HalfFloat::ToFloat( field[ offset * NDimensions + k ] );
+      }
+    }
+  }
+
+  OutputPointType outpoint;
+  for( unsigned int i = 0; i < InputSpaceDimension; ++i )
+  {
+    outpoint[ i ] = point[ i ] + displacement[ i ];
+  }
+  return outpoint;
+
+} // end TransformPointHalfPrecision()
+
+
+// Set the deformation field
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::SetDeformationField( DeformationFieldType * _arg )
+{
+  itkDebugMacro( "setting DeformationField to " << _arg );
+  if( this->m_HalfPrecisionStorage && _arg != 0 )
+  {
+    /** Convert the field, and only keep its geometry as an image. */
+    const SizeValueType numberOfPixels = _arg->GetBufferedRegion().GetNumberOfPixels();
+    this->m_HalfPrecisionDeformationField.resize( numberOfPixels * NDimensions );
+    const DeformationFieldVectorType * vectors = _arg->GetBufferPointer();
+    for( SizeValueType i = 0; i < numberOfPixels; ++i )
+    {
+      for( unsigned int k = 0; k < NDimensions; ++k )
+      {
+        this->m_HalfPrecisionDeformationField[ i * NDimensions + k ]
+          = HalfFloat::FromFloat( static_cast< float >( vectors[ i ][ k ] ) );
+      }
+    }
+
+    DeformationFieldPointer geometry = DeformationFieldType::New();
+    geometry->CopyInformation( _arg );
+    geometry->SetBufferedRegion( _arg->GetBufferedRegion() );
+    geometry->SetRequestedRegion( _arg->GetBufferedRegion() );
+    this->m_DeformationField = geometry;
+    this->Modified();
+  }
+  else if( this->m_DeformationField != _arg )
+  {
+    this->m_DeformationField = _arg;
+    this->Modified();
+  }
+  if( this->m_DeformationFieldInterpolator.IsNotNull() )
+  {
+    this->m_DeformationFieldInterpolator->SetInputImage(
+      this->m_DeformationField );
+  }
+}
+
+
+// Set the deformation field interpolator
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::SetDeformationFieldInterpolator( DeformationFieldInterpolatorType * _arg )
+{
+  itkDebugMacro( "setting DeformationFieldInterpolator to " << _arg );
+  if( this->m_DeformationFieldInterpolator != _arg )
+  {
+    this->m_DeformationFieldInterpolator = _arg;
+    this->Modified();
+  }
+
+  /** Determine which interpolation to use for a half precision field. */
+  this->m_InterpolationOrder = -1;
+  if( dynamic_cast< DefaultDeformationFieldInterpolatorType * >( _arg ) )
+  {
+    this->m_InterpolationOrder = 0;
+  }
+  else if( dynamic_cast< LinearDeformationFieldInterpolatorType * >( _arg ) )
+  {
+    this->m_InterpolationOrder = 1;
+  }
+  if( this->m_DeformationFieldInterpolator.IsNotNull() )
+  {
+    this->m_DeformationFieldInterpolator->SetInputImage(
+      this->m_DeformationField );
+  }
+}
+
+
+// Get the deformation field with its values
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+typename DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::
+DeformationFieldPointer
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >
+::GetDecodedDeformationField( void ) const
+{
+  if( !this->m_HalfPrecisionStorage || this->m_DeformationField.IsNull() )
+  {
+    return this->m_DeformationField;
+  }
+
+  DeformationFieldPointer field = DeformationFieldType::New();
+  field->CopyInformation( this->m_DeformationField );
+  field->SetRegions( this->m_DeformationField->GetBufferedRegion() );
+  field->Allocate();
+
+  const SizeValueType          numberOfPixels = field->GetBufferedRegion().GetNumberOfPixels();
+  DeformationFieldVectorType * vectors        = field->GetBufferPointer();
+  for( SizeValueType i = 0; i < numberOfPixels; ++i )
+  {
+    for( unsigned int k = 0; k < NDimensions; ++k )
+    {
+      vectors[ i ][ k ] = static_cast< DeformationFieldComponentType >(
+        HalfFloat::ToFloat( this->m_HalfPrecisionDeformationField[ i * NDimensions + k ] ) );
+    }
+  }
+  return field;
+
+} // end GetDecodedDeformationField()
+
+
+// Print self
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "DeformationField: " << this->m_DeformationField << std::endl;
+  os << indent << "ZeroDeformationField: " << this->m_ZeroDeformationField << std::endl;
+  os << indent << "DeformationFieldInterpolator: " << this->m_DeformationFieldInterpolator << std::endl;
+  os << indent << "HalfPrecisionStorage: " << this->m_HalfPrecisionStorage << std::endl;
+}
+
+
+// Set the parameters for an Identity transform of this class
+template< class TScalarType, unsigned int NDimensions, class TComponentType >
+void
+DeformationFieldInterpolatingTransform< TScalarType, NDimensions,  TComponentType >::SetIdentity( void )
+{
+  if( this->m_DeformationFieldInterpolator.IsNull() )
+  {
+    this->m_DeformationFieldInterpolator
+      = DefaultDeformationFieldInterpolatorType::New();
+  }
+  this->SetDeformationField( this->m_ZeroDeformationField );
+
+} // end SetIdentity()
+
+
+} // end namespace itk
+
+#endif
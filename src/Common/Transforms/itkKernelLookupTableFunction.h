@@ -0,0 +1,156 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkKernelLookupTableFunction_h
+#define __itkKernelLookupTableFunction_h
+
+#include "itkKernelFunctionBase2.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class KernelLookupTableFunction
+ * \brief Tabulated version of a kernel that is evaluated at its entire support.
+ *
+ * The Parzen window histograms evaluate a kernel for all bins in the window
+ * at once, with an argument u that always lies in an interval of length one,
+ * [ uBegin, uBegin + 1 ]. This class tabulates the weights of the whole
+ * window at a number of equidistant u in that interval, and evaluates them
+ * by linear interpolation between two rows of the table. The inner loop over
+ * the window has no branches, so it is vectorized by the compiler.
+ *
+ * Since every row of a B-spline kernel sums to one, so do the interpolated
+ * weights. The error of the interpolation is of the order of
+ * 1 / ( 8 * numberOfEntries^2 ) times the second derivative of the weights.
+ * The kernel should be continuous on the interval, which is the case for
+ * B-splines of order one and higher, and their derivatives of order two
+ * and higher.
+ *
+ * Evaluating the kernel at a single point is forwarded to the tabulated kernel.
+ *
+ * \ingroup Functions
+ */
+
+class KernelLookupTableFunction : public KernelFunctionBase2< double >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef KernelLookupTableFunction     Self;
+  typedef KernelFunctionBase2< double > Superclass;
+  typedef SmartPointer< Self >          Pointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( KernelLookupTableFunction, KernelFunctionBase2 );
+
+  typedef Superclass                   KernelType;
+  typedef KernelType::ConstPointer     KernelConstPointer;
+
+  /** Tabulate the weights of the supportSize window of kernel for u in
+   * [ uBegin, uBegin + 1 ], at numberOfEntries + 1 points.
+   */
+  void SetKernel( const KernelType * kernel, unsigned int supportSize,
+    double uBegin, unsigned int numberOfEntries = 1024 )
+  {
+    this->m_Kernel          = kernel;
+    this->m_SupportSize     = supportSize;
+    this->m_Begin           = uBegin;
+    this->m_NumberOfEntries = numberOfEntries;
+    this->m_Table.resize( ( numberOfEntries + 1 ) * supportSize );
+    for( unsigned int i = 0; i <= numberOfEntries; ++i )
+    {
+      const double u = uBegin + static_cast< double >( i ) / static_cast< double >( numberOfEntries );
+      kernel->Evaluate( u, &this->m_Table[ i * supportSize ] );
+    }
+    this->Modified();
+  }
+
+
+  /** Get the tabulated kernel. */
+  const KernelType * GetKernel( void ) const
+  {
+    return this->m_Kernel.GetPointer();
+  }
+
+
+  /** Evaluate the function at one point. */
+  inline double Evaluate( const double & u ) const
+  {
+    return this->m_Kernel->Evaluate( u );
+  }
+
+
+  /** Evaluate the function at the entire support by interpolation in the table. */
+  inline void Evaluate( const double & u, double * weights ) const
+  {
+    double s = ( u - this->m_Begin ) * this->m_NumberOfEntries;
+    s = s < 0.0 ? 0.0 : s;
+    unsigned int i = static_cast< unsigned int >( s );
+    i = i < this->m_NumberOfEntries ? i : this->m_NumberOfEntries - 1;
+    const double f = s - static_cast< double >( i );
+
+    const unsigned int   n    = this->m_SupportSize;
+    const double * const row0 = &this->m_Table[ i * n ];
+    const double * const row1 = row0 + n;
+    for( unsigned int k = 0; k < n; ++k )
+    {
+      weights[ k ] = row0[ k ] + f * ( row1[ k ] - row0[ k ] );
+    }
+  }
+
+
+protected:
+
+  KernelLookupTableFunction()
+  {
+    this->m_SupportSize     = 0;
+    this->m_Begin           = 0.0;
+    this->m_NumberOfEntries = 0;
+  }
+
+
+  ~KernelLookupTableFunction(){}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const
+  {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "SupportSize: " << this->m_SupportSize << std::endl;
+    os << indent << "Begin: " << this->m_Begin << std::endl;
+    os << indent << "NumberOfEntries: " << this->m_NumberOfEntries << std::endl;
+  }
+
+
+private:
+
+  KernelLookupTableFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  KernelConstPointer    m_Kernel;
+  unsigned int          m_SupportSize;
+  double                m_Begin;
+  unsigned int          m_NumberOfEntries;
+  std::vector< double > m_Table;
+
+};
+
+} // end namespace itk
+
+#endif
@@ -30,6 +30,11 @@ namespace itk
  * The class is templated coordinate representation type (float or double),
  * the space dimension and the spline order.
  *
+ * When UseFloatCoefficients is on, TransformPoint() and the spatial Jacobian
+ * and Hessian read the single precision copy of the coefficients that is
+ * maintained by the base class, which halves the memory traffic of these
+ * functions. The weights and sums remain in double precision.
+ *
  * \ingroup ITKTransform
  */
 
@@ -100,6 +105,7 @@ public:
   typedef typename Superclass::InternalMatrixType            InternalMatrixType;
   typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
   typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::TransformPointCacheType       TransformPointCacheType;
 
   /** Interpolation weights function type. */
   typedef typename Superclass::WeightsFunctionType                WeightsFunctionType;
@@ -133,6 +139,33 @@ public:
    */
   virtual OutputPointType TransformPoint( const InputPointType & point ) const;
 
+  /** Compute point transformation, and cache the weights and support index
+   * for a subsequent call to EvaluateJacobianWithImageGradientProductUsingCache().
+   */
+  virtual OutputPointType TransformPointAndCacheWeights(
+    const InputPointType & point,
+    TransformPointCacheType & cache ) const;
+
+  /** Batched versions of TransformPoint(), GetJacobian() and GetSpatialJacobian().
+   * The single point functions of this class are called directly, without
+   * virtual dispatch, and a single weights cache is reused for all points.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  virtual void GetJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    SpatialJacobianType * spatialJacobians ) const;
+
   /** Compute the Jacobian of the transformation. */
   virtual void GetJacobian(
     const InputPointType & ipp,
@@ -148,6 +181,46 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * reusing the weights computed by TransformPointAndCacheWeights().
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingCache(
+    const InputPointType & ipp,
+    const TransformPointCacheType & cache,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** The fixed sample features are the offset of the support region in the
+   * coefficient images (-1 if the support region is not inside the grid),
+   * followed by the 1D B-spline weights.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    return 1 + RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  }
+
+
+  /** Compute the fixed sample features and the nonzero Jacobian indices. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
+  /** Transform a point, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
   /** Compute the spatial Jacobian of the transformation. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -203,8 +276,18 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
+  /** Give the weights functions the periodic weight table. */
+  virtual void UpdatePeriodicWeightTables( void );
+
 private:
 
+  /** Compute the displacement of the support region that starts at the
+   * given offset in the coefficient images, using the given weights.
+   */
+  void ComputeDisplacement( ScalarType * displacement,
+    const OffsetValueType totalOffsetToSupportIndex,
+    const double * weights1D ) const;
+
   RecursiveBSplineTransform( const Self & ); // purposely not implemented
   void operator=( const Self & );            // purposely not implemented
 
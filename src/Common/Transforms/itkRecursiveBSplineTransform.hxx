@@ -21,6 +21,7 @@
 #include "itkRecursiveBSplineTransform.h"
 
 #include "itkRecursiveBSplineTransformImplementation.h"
+#include "itkRecursiveBSplineTransformUnrolledImplementation.h"
 
 
 namespace itk
@@ -41,6 +42,22 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end Constructor()
 
 
+/**
+ * ********************* UpdatePeriodicWeightTables ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::UpdatePeriodicWeightTables( void )
+{
+  this->Superclass::UpdatePeriodicWeightTables();
+  this->m_RecursiveBSplineWeightFunction->SetPeriodicWeightTable(
+    this->m_WeightsFunction->GetPeriodicWeightTable() );
+
+} // end UpdatePeriodicWeightTables()
+
+
 /**
  * ********************* TransformPoint ****************************
  */
@@ -50,15 +67,42 @@ typename RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 ::OutputPointType
 RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 ::TransformPoint( const InputPointType & point ) const
+{
+  /** The weights are computed on the stack, in a cache that is not used further. */
+  TransformPointCacheType cache;
+  return this->Self::TransformPointAndCacheWeights( point, cache );
+
+} // end TransformPoint()
+
+
+/**
+ * ********************* TransformPointAndCacheWeights ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+typename RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::OutputPointType
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPointAndCacheWeights( const InputPointType & point,
+  TransformPointCacheType & cache ) const
 {
   /** Define some constants. */
   const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
 
+  /** The weights must fit in the cache. The array size below is negative
+   * otherwise, which does not compile.
+   */
+  typedef char NumberOfWeightsFitInCacheCheck[
+    numberOfWeights <= Superclass::MaximumNumberOfCachedWeights ? 1 : -1 ];
+  (void)sizeof( NumberOfWeightsFitInCacheCheck );
+
   /** Initialize output point. */
   OutputPointType outputPoint;
+  cache.m_IsValid  = false;
+  cache.m_IsInside = false;
 
-  /** Allocate weights on the stack: */
-  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  /** The weights are stored in the cache, which lives on the stack. */
+  double * weightsArray1D = cache.m_Weights;
   WeightsType weights1D( weightsArray1D, numberOfWeights, false );
 
   /** Check if the coefficient image has been set. */
@@ -75,12 +119,14 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 
   // NOTE: if the support region does not lie totally within the grid
   // we assume zero displacement and return the input point
+  cache.m_IsValid = true;
   bool inside = this->InsideValidRegion( cindex );
   if( !inside )
   {
     outputPoint = point;
     return outputPoint;
   }
+  cache.m_IsInside = true;
 
   // Compute interpolation weighs and store them in weights1D
   IndexType supportIndex;
@@ -91,19 +137,13 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
   OffsetValueType         totalOffsetToSupportIndex = 0;
   for( unsigned int j = 0; j < SpaceDimension; ++j )
   {
+    cache.m_SupportIndex[ j ]  = supportIndex[ j ];
     totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
   }
 
-  ScalarType * mu[ SpaceDimension ];
-  for( unsigned int j = 0; j < SpaceDimension; ++j )
-  {
-    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
-  }
-
   /** Call the recursive TransformPoint function. */
   ScalarType displacement[ SpaceDimension ];
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
-    ::TransformPoint( displacement, mu, bsplineOffsetTable, weightsArray1D );
+  this->ComputeDisplacement( displacement, totalOffsetToSupportIndex, weightsArray1D );
 
   // The output point is the start point + displacement.
   for( unsigned int j = 0; j < SpaceDimension; ++j )
@@ -112,7 +152,69 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
   }
 
   return outputPoint;
-} // end TransformPoint()
+} // end TransformPointAndCacheWeights()
+
+
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  TransformPointCacheType cache;
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    outputPoints[ n ] = this->Self::TransformPointAndCacheWeights( inputPoints[ n ], cache );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::GetJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    this->Self::GetJacobian( inputPoints[ n ], jacobians[ n ], nonZeroJacobianIndices[ n ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::GetSpatialJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  SpatialJacobianType * spatialJacobians ) const
+{
+  for( SizeValueType n = 0; n < numberOfPoints; ++n )
+  {
+    this->Self::GetSpatialJacobian( inputPoints[ n ], spatialJacobians[ n ] );
+  }
+
+} // end GetSpatialJacobians()
 
 
 /**
@@ -167,7 +269,7 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
    * The pointer has changed after this function call.
    */
   ParametersValueType * jacobianPointer = jacobian.data_block();
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
     ::GetJacobian( jacobianPointer, weightsArray1D, 1.0 );
 
   /** Compute the nonzero Jacobian indices.
@@ -234,7 +336,7 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
     migArray[ j ] = movingImageGradient[ j ];
   }
   ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
     ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, weightsArray1D, 1.0 );
 
   /** Setup support region needed for the nonZeroJacobianIndices. */
@@ -250,6 +352,188 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingCache ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProductUsingCache(
+  const InputPointType & ipp,
+  const TransformPointCacheType & cache,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Fall back to the normal computation if nothing was cached. */
+  if( !cache.m_IsValid )
+  {
+    this->EvaluateJacobianWithImageGradientProduct(
+      ipp, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+    return;
+  }
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if( !cache.m_IsInside )
+  {
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Recursively compute the inner product of the Jacobian and the moving image gradient,
+   * using the cached weights.
+   */
+  double migArray[ SpaceDimension ];
+  IndexType supportIndex;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    migArray[ j ]     = movingImageGradient[ j ];
+    supportIndex[ j ] = cache.m_SupportIndex[ j ];
+  }
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+    ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, cache.m_Weights, 1.0 );
+
+  /** Setup support region needed for the nonZeroJacobianIndices. */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+
+  /** Compute the nonzero Jacobian indices. */
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end EvaluateJacobianWithImageGradientProductUsingCache()
+
+
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** Convert the physical point to a continuous index. */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( ipp, cindex );
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if( !this->m_CoefficientImages[ 0 ] || !this->InsideValidRegion( cindex ) )
+  {
+    features[ 0 ] = -1.0;
+    const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+    nonZeroJacobianIndices.resize( nnzji );
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      nonZeroJacobianIndices[ i ] = i;
+    }
+    return;
+  }
+
+  /** Compute the 1D weights directly in the features array. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  WeightsType weights1D( features + 1, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  /** Store the offset of the support region. */
+  const OffsetValueType * bsplineOffsetTable        = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  OffsetValueType         totalOffsetToSupportIndex = 0;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+  }
+  features[ 0 ] = static_cast< double >( totalOffsetToSupportIndex );
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize( this->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+  this->ComputeNonZeroJacobianIndices( nonZeroJacobianIndices, supportRegion );
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+typename RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::OutputPointType
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  /** Zero displacement outside the valid region. */
+  OutputPointType outputPoint = ipp;
+  if( features[ 0 ] < 0.0 )
+  {
+    return outputPoint;
+  }
+
+  /** Call the recursive TransformPoint function with the stored weights. */
+  const OffsetValueType totalOffsetToSupportIndex = static_cast< OffsetValueType >( features[ 0 ] );
+  ScalarType            displacement[ SpaceDimension ];
+  this->ComputeDisplacement( displacement, totalOffsetToSupportIndex, features + 1 );
+
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    outputPoint[ j ] += displacement[ j ];
+  }
+
+  return outputPoint;
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & itkNotUsed( ipp ),
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  /** Zero Jacobian outside the valid region. */
+  if( features[ 0 ] < 0.0 )
+  {
+    imageJacobian.Fill( 0.0 );
+    return;
+  }
+
+  double migArray[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    migArray[ j ] = movingImageGradient[ j ];
+  }
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+    ::EvaluateJacobianWithImageGradientProduct( imageJacobianPointer, migArray, features + 1, 1.0 );
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -301,17 +585,30 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
     totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
   }
 
-  /** Get handles to the mu's. */
-  ScalarType * mu[ SpaceDimension ];
-  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  /** Recursively compute the spatial Jacobian, from the float copy of the
+   * coefficients if there is one.
+   */
+  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ]; //double
+  if( this->m_FloatCoefficients[ 0 ] )
   {
-    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    const float * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_FloatCoefficients[ j ] + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::GetSpatialJacobian( spatialJacobian, mu, bsplineOffsetTable, weightsPointer, derivativeWeightsPointer );
+  }
+  else
+  {
+    ScalarType * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::GetSpatialJacobian( spatialJacobian, mu, bsplineOffsetTable, weightsPointer, derivativeWeightsPointer );
   }
-
-  /** Recursively compute the spatial Jacobian. */
-  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ]; //double
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
-    ::GetSpatialJacobian( spatialJacobian, mu, bsplineOffsetTable, weightsPointer, derivativeWeightsPointer );
 
   /** Copy the correct elements to the spatial Jacobian.
    * The first SpaceDimension elements are actually the displacement, i.e. the recursive
@@ -395,19 +692,33 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
     totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
   }
 
-  /** Get handles to the mu's. */
-  ScalarType * mu[ SpaceDimension ];
-  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  /** Recursively compute the spatial Hessian, from the float copy of the
+   * coefficients if there is one.
+   */
+  double spatialHessian[ SpaceDimension * ( SpaceDimension + 1 ) * ( SpaceDimension + 2 ) / 2 ];
+  if( this->m_FloatCoefficients[ 0 ] )
+  {
+    const float * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_FloatCoefficients[ j ] + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::GetSpatialHessian( spatialHessian, mu, bsplineOffsetTable,
+      weightsPointer, derivativeWeightsPointer, hessianWeightsPointer );
+  }
+  else
   {
-    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    ScalarType * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::GetSpatialHessian( spatialHessian, mu, bsplineOffsetTable,
+      weightsPointer, derivativeWeightsPointer, hessianWeightsPointer );
   }
 
-  /** Recursively compute the spatial Hessian. */
-  double spatialHessian[ SpaceDimension * ( SpaceDimension + 1 ) * ( SpaceDimension + 2 ) / 2 ];
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
-    ::GetSpatialHessian( spatialHessian, mu, bsplineOffsetTable,
-    weightsPointer, derivativeWeightsPointer, hessianWeightsPointer );
-
   /** Copy the correct elements to the spatial Hessian.
    * The first SpaceDimension elements are actually the displacement, i.e. the recursive
    * function GetSpatialHessian() has the TransformPoint as a free by-product.
@@ -688,6 +999,47 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end ComputeNonZeroJacobianIndices()
 
 
+/**
+ * ********************* ComputeDisplacement ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::ComputeDisplacement(
+  ScalarType * displacement,
+  const OffsetValueType totalOffsetToSupportIndex,
+  const double * weights1D ) const
+{
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+
+  /** Read the float copy of the coefficients if there is one; the sums
+   * are computed in ScalarType either way.
+   */
+  if( this->m_FloatCoefficients[ 0 ] )
+  {
+    const float * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_FloatCoefficients[ j ] + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::TransformPoint( displacement, mu, bsplineOffsetTable, weights1D );
+  }
+  else
+  {
+    ScalarType * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    }
+    RecursiveBSplineTransformUnrolledImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::TransformPoint( displacement, mu, bsplineOffsetTable, weights1D );
+  }
+
+} // end ComputeDisplacement()
+
+
 } // end namespace itk
 
 #endif
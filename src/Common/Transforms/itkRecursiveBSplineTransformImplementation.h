@@ -62,13 +62,14 @@ public:
   typedef ScalarType ** CoefficientPointerVectorType;
 
   /** TransformPoint recursive implementation. */
+  template< class TCoefficient >
   static inline void TransformPoint(
-    OutputPointType opp, const CoefficientPointerVectorType mu,
+    OutputPointType opp, TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D )
   {
     /** Make a copy of the pointers to mu. The pointer will move later. */
-    ScalarType * tmp_mu[ OutputDimension ];
+    TCoefficient * tmp_mu[ OutputDimension ];
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
       tmp_mu[ j ] = mu[ j ];
@@ -151,15 +152,16 @@ public:
    * As an (almost) free by-product this function delivers the displacement,
    * i.e. the TransformPoint() function.
    */
+  template< class TCoefficient >
   static inline void GetSpatialJacobian(
     InternalFloatType * sj,
-    const CoefficientPointerVectorType mu,
+    TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D,                    // normal B-spline weights
     const double * derivativeWeights1D )         // 1st derivative of B-spline
   {
     /** Make a copy of the pointers to mu. The pointer will move later. */
-    ScalarType * tmp_mu[ OutputDimension ];
+    TCoefficient * tmp_mu[ OutputDimension ];
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
       tmp_mu[ j ] = mu[ j ];
@@ -217,9 +219,10 @@ public:
    *
    * Note that we store only one of the symmetric halves of Hk.
    */
+  template< class TCoefficient >
   static inline void GetSpatialHessian(
     InternalFloatType * sh,
-    const CoefficientPointerVectorType mu,
+    TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D,                   // normal B-spline weights
     const double * derivativeWeights1D,         // 1st derivative of B-spline
@@ -229,7 +232,7 @@ public:
     const unsigned int helperDim2 = OutputDimension * ( SpaceDimension + 1 ) * ( SpaceDimension + 2 ) / 2;
 
     /** Make a copy of the pointers to mu. The pointer will move later. */
-    ScalarType * tmp_mu[ OutputDimension ];
+    TCoefficient * tmp_mu[ OutputDimension ];
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
       tmp_mu[ j ] = mu[ j ];
@@ -362,6 +365,134 @@ public:
   } // end GetJacobianOfSpatialHessian()
 
 
+  /** Wrap an index into [0, size). The index may be negative. */
+  static inline OffsetValueType WrapIndex( OffsetValueType index, const OffsetValueType size )
+  {
+    index %= size;
+    return index < 0 ? index + size : index;
+  } // end WrapIndex()
+
+
+  /** TransformPoint for a grid that is cyclic in the last dimension.
+   * Only to be called at the top level, i.e. with SpaceDimension the
+   * dimension of the grid. The slices of the support region in the last
+   * dimension are not at consecutive offsets, but at the wrapped indices
+   * ( lastIndex + k ) mod lastSize. mu points to the start of the support
+   * region in the other dimensions, at index 0 of the last dimension. The
+   * lower dimensions are handled by the normal recursion.
+   */
+  template< class TCoefficient >
+  static inline void TransformPointCyclic(
+    OutputPointType opp, TCoefficient * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D,
+    const OffsetValueType lastIndex,
+    const OffsetValueType lastSize )
+  {
+    TCoefficient * tmp_mu[ OutputDimension ];
+    ScalarType     tmp_opp[ OutputDimension ];
+    for( unsigned int j = 0; j < OutputDimension; ++j )
+    {
+      opp[ j ] = 0.0;
+    }
+
+    const OffsetValueType bot = gridOffsetTable[ SpaceDimension - 1 ];
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Point to the wrapped slice. */
+      const OffsetValueType offset = WrapIndex( lastIndex + k, lastSize ) * bot;
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        tmp_mu[ j ] = mu[ j ] + offset;
+      }
+
+      /** Recurse. */
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+        ::TransformPoint( tmp_opp, tmp_mu, gridOffsetTable, weights1D );
+
+      /** Accumulate the weights. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        opp[ j ] += tmp_opp[ j ] * weights1D[ k + HelperConstVariable ];
+      }
+    }
+  } // end TransformPointCyclic()
+
+
+  /** ComputeNonZeroJacobianIndices for a grid that is cyclic in the last
+   * dimension. currentIndex is the offset of the support region in the other
+   * dimensions, at index 0 of the last dimension.
+   */
+  static inline void ComputeNonZeroJacobianIndicesCyclic(
+    unsigned long * & nzji,
+    const unsigned long parametersPerDim,
+    const unsigned long currentIndex,
+    const OffsetValueType * gridOffsetTable,
+    const OffsetValueType lastIndex,
+    const OffsetValueType lastSize )
+  {
+    const OffsetValueType bot = gridOffsetTable[ SpaceDimension - 1 ];
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Recurse. */
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+        ::ComputeNonZeroJacobianIndices( nzji, parametersPerDim,
+        currentIndex + WrapIndex( lastIndex + k, lastSize ) * bot, gridOffsetTable );
+    }
+  } // end ComputeNonZeroJacobianIndicesCyclic()
+
+
+  /** GetSpatialJacobian for a grid that is cyclic in the last dimension.
+   * The arguments are as for TransformPointCyclic(), the output as for
+   * GetSpatialJacobian().
+   */
+  template< class TCoefficient >
+  static inline void GetSpatialJacobianCyclic(
+    InternalFloatType * sj,
+    TCoefficient * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D,                    // normal B-spline weights
+    const double * derivativeWeights1D,          // 1st derivative of B-spline
+    const OffsetValueType lastIndex,
+    const OffsetValueType lastSize )
+  {
+    TCoefficient *    tmp_mu[ OutputDimension ];
+    InternalFloatType tmp_sj[ OutputDimension * SpaceDimension ];
+    for( unsigned int n = 0; n < OutputDimension * ( SpaceDimension + 1 ); ++n )
+    {
+      sj[ n ] = 0.0;
+    }
+
+    const OffsetValueType bot = gridOffsetTable[ SpaceDimension - 1 ];
+    for( unsigned int k = 0; k <= SplineOrder; ++k )
+    {
+      /** Point to the wrapped slice. */
+      const OffsetValueType offset = WrapIndex( lastIndex + k, lastSize ) * bot;
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        tmp_mu[ j ] = mu[ j ] + offset;
+      }
+
+      /** Recurse. */
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+        ::GetSpatialJacobian( tmp_sj, tmp_mu, gridOffsetTable, weights1D, derivativeWeights1D );
+
+      /** Accumulate the weights part. */
+      for( unsigned int n = 0; n < OutputDimension * SpaceDimension; ++n )
+      {
+        sj[ n ] += tmp_sj[ n ] * weights1D[ k + HelperConstVariable ];
+      }
+
+      /** Accumulate the derivative weights part. */
+      for( unsigned int j = 0; j < OutputDimension; ++j )
+      {
+        sj[ OutputDimension * SpaceDimension + j ]
+          += tmp_sj[ j ] * derivativeWeights1D[ k + HelperConstVariable ];
+      }
+    }
+  } // end GetSpatialJacobianCyclic()
+
+
 };
 
 
@@ -391,8 +522,9 @@ public:
   typedef ScalarType ** CoefficientPointerVectorType;
 
   /** TransformPoint recursive implementation. */
+  template< class TCoefficient >
   static inline void TransformPoint(
-    OutputPointType opp, const CoefficientPointerVectorType mu,
+    OutputPointType opp, TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D )
   {
@@ -446,9 +578,10 @@ public:
 
 
   /** GetSpatialJacobian recursive implementation. */
+  template< class TCoefficient >
   static inline void GetSpatialJacobian(
     InternalFloatType * sj,
-    const CoefficientPointerVectorType mu,
+    TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D,                    // normal B-spline weights
     const double * derivativeWeights1D )         // 1st derivative of B-spline
@@ -461,9 +594,10 @@ public:
 
 
   /** GetSpatialHessian recursive implementation. */
+  template< class TCoefficient >
   static inline void GetSpatialHessian(
     InternalFloatType * sh,
-    const CoefficientPointerVectorType mu,
+    TCoefficient * const * mu,
     const OffsetValueType * gridOffsetTable,
     const double * weights1D,                   // normal B-spline weights
     const double * derivativeWeights1D,         // 1st derivative of B-spline
@@ -0,0 +1,326 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRecursiveBSplineTransformUnrolledImplementation_h
+#define __itkRecursiveBSplineTransformUnrolledImplementation_h
+
+#include "itkRecursiveBSplineTransformImplementation.h"
+
+namespace itk
+{
+
+/** \class RecursiveBSplineTransformUnrolledImplementation
+ *
+ * \brief Selects an unrolled implementation of the most frequently used
+ * functions of the recursive B-spline transform, if there is one.
+ *
+ * The generic version forwards TransformPoint(), GetJacobian() and
+ * EvaluateJacobianWithImageGradientProduct() to the recursive
+ * RecursiveBSplineTransformImplementation. For cubic splines in 2D and 3D
+ * specializations are provided, that replace the recursion by loops with
+ * a fixed number of iterations over small arrays. The tensor products of the
+ * 1D weights are computed once in contiguous arrays, which the compiler can
+ * unroll and vectorize. The operations are done in the same order as in the
+ * recursive implementation, so the results are identical.
+ *
+ * The functions have the same signatures as those of the recursive
+ * implementation, and can be interchanged. Like there, the coefficients may
+ * be stored in another type than TScalar, e.g. float; the sums are computed
+ * in TScalar.
+ *
+ * \ingroup ITKTransform
+ */
+
+template< unsigned int OutputDimension, unsigned int SpaceDimension, unsigned int SplineOrder, class TScalar >
+class RecursiveBSplineTransformUnrolledImplementation
+{
+public:
+
+  /** Typedefs. */
+  typedef RecursiveBSplineTransformImplementation<
+    OutputDimension, SpaceDimension, SplineOrder, TScalar > RecursiveImplementationType;
+  typedef TScalar                                           ScalarType;
+  typedef double                                            InternalFloatType;
+  typedef ScalarType *                                      OutputPointType;
+  typedef ScalarType **                                     CoefficientPointerVectorType;
+
+  /** TransformPoint, recursive. */
+  template< class TCoefficient >
+  static inline void TransformPoint(
+    OutputPointType opp, TCoefficient * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D )
+  {
+    RecursiveImplementationType::TransformPoint( opp, mu, gridOffsetTable, weights1D );
+  }
+
+
+  /** GetJacobian, recursive. */
+  static inline void GetJacobian(
+    ScalarType * & jacobians, const double * weights1D, double value )
+  {
+    RecursiveImplementationType::GetJacobian( jacobians, weights1D, value );
+  }
+
+
+  /** EvaluateJacobianWithImageGradientProduct, recursive. */
+  static inline void EvaluateJacobianWithImageGradientProduct(
+    ScalarType * & imageJacobian, const InternalFloatType * movingImageGradient,
+    const double * weights1D, double value )
+  {
+    RecursiveImplementationType::EvaluateJacobianWithImageGradientProduct(
+      imageJacobian, movingImageGradient, weights1D, value );
+  }
+
+
+};
+
+
+/** \class RecursiveBSplineTransformUnrolledImplementation
+ *
+ * \brief Cubic B-spline transform in 2D.
+ */
+
+template< class TScalar >
+class RecursiveBSplineTransformUnrolledImplementation< 2, 2, 3, TScalar >
+{
+public:
+
+  /** Typedefs. */
+  typedef TScalar       ScalarType;
+  typedef double        InternalFloatType;
+  typedef ScalarType *  OutputPointType;
+  typedef ScalarType ** CoefficientPointerVectorType;
+
+  /** The number of weights along a dimension, and in the support region. */
+  enum { Order = 4, NumberOfIndices = Order * Order };
+
+  /** TransformPoint, unrolled. */
+  template< class TCoefficient >
+  static inline void TransformPoint(
+    OutputPointType opp, TCoefficient * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D )
+  {
+    const double *        w0 = weights1D;
+    const double *        w1 = weights1D + Order;
+    const OffsetValueType o0 = gridOffsetTable[ 0 ];
+    const OffsetValueType o1 = gridOffsetTable[ 1 ];
+
+    for( unsigned int j = 0; j < 2; ++j )
+    {
+      ScalarType result = 0.0;
+      for( unsigned int k1 = 0; k1 < Order; ++k1 )
+      {
+        const TCoefficient * row  = mu[ j ] + k1 * o1;
+        ScalarType           sum0 = 0.0;
+        sum0   += row[ 0 ] * w0[ 0 ];
+        sum0   += row[ o0 ] * w0[ 1 ];
+        sum0   += row[ 2 * o0 ] * w0[ 2 ];
+        sum0   += row[ 3 * o0 ] * w0[ 3 ];
+        result += sum0 * w1[ k1 ];
+      }
+      opp[ j ] = result;
+    }
+  } // end TransformPoint()
+
+
+  /** Compute the products of the weights, in the order of the support region. */
+  static inline void ComputeWeightProducts(
+    const double * weights1D, double value, double * products )
+  {
+    const double * w0 = weights1D;
+    const double * w1 = weights1D + Order;
+    for( unsigned int k1 = 0; k1 < Order; ++k1 )
+    {
+      const double v1 = value * w1[ k1 ];
+      for( unsigned int k0 = 0; k0 < Order; ++k0 )
+      {
+        products[ k1 * Order + k0 ] = v1 * w0[ k0 ];
+      }
+    }
+  } // end ComputeWeightProducts()
+
+
+  /** GetJacobian, unrolled. */
+  static inline void GetJacobian(
+    ScalarType * & jacobians, const double * weights1D, double value )
+  {
+    double products[ NumberOfIndices ];
+    ComputeWeightProducts( weights1D, value, products );
+
+    for( unsigned int j = 0; j < 2; ++j )
+    {
+      ScalarType * row = jacobians + j * NumberOfIndices * ( 2 + 1 );
+      for( unsigned int i = 0; i < NumberOfIndices; ++i )
+      {
+        row[ i ] = products[ i ];
+      }
+    }
+    jacobians += NumberOfIndices;
+  } // end GetJacobian()
+
+
+  /** EvaluateJacobianWithImageGradientProduct, unrolled. */
+  static inline void EvaluateJacobianWithImageGradientProduct(
+    ScalarType * & imageJacobian, const InternalFloatType * movingImageGradient,
+    const double * weights1D, double value )
+  {
+    double products[ NumberOfIndices ];
+    ComputeWeightProducts( weights1D, value, products );
+
+    for( unsigned int j = 0; j < 2; ++j )
+    {
+      const double g   = movingImageGradient[ j ];
+      ScalarType * row = imageJacobian + j * NumberOfIndices;
+      for( unsigned int i = 0; i < NumberOfIndices; ++i )
+      {
+        row[ i ] = products[ i ] * g;
+      }
+    }
+    imageJacobian += NumberOfIndices;
+  } // end EvaluateJacobianWithImageGradientProduct()
+
+
+};
+
+
+/** \class RecursiveBSplineTransformUnrolledImplementation
+ *
+ * \brief Cubic B-spline transform in 3D.
+ */
+
+template< class TScalar >
+class RecursiveBSplineTransformUnrolledImplementation< 3, 3, 3, TScalar >
+{
+public:
+
+  /** Typedefs. */
+  typedef TScalar       ScalarType;
+  typedef double        InternalFloatType;
+  typedef ScalarType *  OutputPointType;
+  typedef ScalarType ** CoefficientPointerVectorType;
+
+  /** The number of weights along a dimension, and in the support region. */
+  enum { Order = 4, NumberOfIndices = Order * Order * Order };
+
+  /** TransformPoint, unrolled. */
+  template< class TCoefficient >
+  static inline void TransformPoint(
+    OutputPointType opp, TCoefficient * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D )
+  {
+    const double *        w0 = weights1D;
+    const double *        w1 = weights1D + Order;
+    const double *        w2 = weights1D + 2 * Order;
+    const OffsetValueType o0 = gridOffsetTable[ 0 ];
+    const OffsetValueType o1 = gridOffsetTable[ 1 ];
+    const OffsetValueType o2 = gridOffsetTable[ 2 ];
+
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      ScalarType result = 0.0;
+      for( unsigned int k2 = 0; k2 < Order; ++k2 )
+      {
+        ScalarType sum1 = 0.0;
+        for( unsigned int k1 = 0; k1 < Order; ++k1 )
+        {
+          const TCoefficient * row  = mu[ j ] + k2 * o2 + k1 * o1;
+          ScalarType           sum0 = 0.0;
+          sum0 += row[ 0 ] * w0[ 0 ];
+          sum0 += row[ o0 ] * w0[ 1 ];
+          sum0 += row[ 2 * o0 ] * w0[ 2 ];
+          sum0 += row[ 3 * o0 ] * w0[ 3 ];
+          sum1 += sum0 * w1[ k1 ];
+        }
+        result += sum1 * w2[ k2 ];
+      }
+      opp[ j ] = result;
+    }
+  } // end TransformPoint()
+
+
+  /** Compute the products of the weights, in the order of the support region. */
+  static inline void ComputeWeightProducts(
+    const double * weights1D, double value, double * products )
+  {
+    const double * w0 = weights1D;
+    const double * w1 = weights1D + Order;
+    const double * w2 = weights1D + 2 * Order;
+    for( unsigned int k2 = 0; k2 < Order; ++k2 )
+    {
+      const double v2 = value * w2[ k2 ];
+      for( unsigned int k1 = 0; k1 < Order; ++k1 )
+      {
+        const double v1  = v2 * w1[ k1 ];
+        double *     out = products + ( k2 * Order + k1 ) * Order;
+        for( unsigned int k0 = 0; k0 < Order; ++k0 )
+        {
+          out[ k0 ] = v1 * w0[ k0 ];
+        }
+      }
+    }
+  } // end ComputeWeightProducts()
+
+
+  /** GetJacobian, unrolled. */
+  static inline void GetJacobian(
+    ScalarType * & jacobians, const double * weights1D, double value )
+  {
+    double products[ NumberOfIndices ];
+    ComputeWeightProducts( weights1D, value, products );
+
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      ScalarType * row = jacobians + j * NumberOfIndices * ( 3 + 1 );
+      for( unsigned int i = 0; i < NumberOfIndices; ++i )
+      {
+        row[ i ] = products[ i ];
+      }
+    }
+    jacobians += NumberOfIndices;
+  } // end GetJacobian()
+
+
+  /** EvaluateJacobianWithImageGradientProduct, unrolled. */
+  static inline void EvaluateJacobianWithImageGradientProduct(
+    ScalarType * & imageJacobian, const InternalFloatType * movingImageGradient,
+    const double * weights1D, double value )
+  {
+    double products[ NumberOfIndices ];
+    ComputeWeightProducts( weights1D, value, products );
+
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      const double g   = movingImageGradient[ j ];
+      ScalarType * row = imageJacobian + j * NumberOfIndices;
+      for( unsigned int i = 0; i < NumberOfIndices; ++i )
+      {
+        row[ i ] = products[ i ] * g;
+      }
+    }
+    imageJacobian += NumberOfIndices;
+  } // end EvaluateJacobianWithImageGradientProduct()
+
+
+};
+
+
+} // end namespace itk
+
+#endif /* __itkRecursiveBSplineTransformUnrolledImplementation_h */
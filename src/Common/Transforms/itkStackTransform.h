@@ -31,6 +31,12 @@ namespace itk
  * one for every last dimension index. This transform selects the right
  * transform based on the last dimension index of the input point.
  *
+ * The parameters of all sub transforms are stored in one contiguous array,
+ * ordered by sub transform. Sub transforms that keep a reference to their
+ * parameters, like the B-spline transforms, directly use this array.
+ * The batched TransformPoints() and GetJacobians() functions pass runs of
+ * consecutive points that lie in the same slice to the sub transform at once.
+ *
  * \ingroup Transforms
  *
  */
@@ -89,6 +95,9 @@ public:
   typedef typename Superclass::OutputPointType       OutputPointType;
   typedef typename Superclass::OutputVectorPixelType OutputVectorPixelType;
   typedef typename Superclass::InputVectorPixelType  InputVectorPixelType;
+  typedef typename Superclass::DerivativeType        DerivativeType;
+  typedef typename Superclass::MovingImageGradientType
+    MovingImageGradientType;
 
   /** Sub transform types, having a reduced dimension. */
   typedef AdvancedTransform< TScalarType,
@@ -143,6 +152,55 @@ public:
     JacobianType & jac,
     NonZeroJacobianIndicesType & nzji ) const;
 
+  /** Batched versions of TransformPoint() and GetJacobian(). Points in the same
+   * slice are forwarded to the batched functions of the sub transform.
+   */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
+  virtual void GetJacobians(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  /** The fixed sample features are the index of the sub transform, followed
+   * by the fixed sample features of the sub transform.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    if( this->m_SubTransformContainer.size() == 0
+      || this->m_SubTransformContainer[ 0 ].IsNull()
+      || this->m_SubTransformContainer[ 0 ]->GetNumberOfFixedSampleFeatures() == 0 )
+    {
+      return 0;
+    }
+    return 1 + this->m_SubTransformContainer[ 0 ]->GetNumberOfFixedSampleFeatures();
+  }
+
+
+  /** Compute the fixed sample features and the nonzero Jacobian indices. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nzji ) const;
+
+  /** Transform a point, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
   /** Set the parameters. Checks if the number of parameters
    * is correct and sets parameters of sub transforms. */
   virtual void SetParameters( const ParametersType & param );
@@ -293,10 +351,22 @@ private:
   StackTransform( const Self & );  // purposely not implemented
   void operator=( const Self & );  // purposely not implemented
 
+  /** The index of the sub transform for a given input point. */
+  unsigned int GetSubTransformIndex( const InputPointType & ipp ) const
+  {
+    return vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
+      vnl_math_max( 0,
+      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  }
+
+
   // Number of transforms and transform container
   unsigned int              m_NumberOfSubTransforms;
   SubTransformContainerType m_SubTransformContainer;
 
+  // Views on the contiguous parameter array, one per sub transform
+  std::vector< ParametersType > m_SubTransformParameters;
+
   // Stack spacing and origin of last dimension
   TScalarType m_StackSpacing, m_StackOrigin;
 
@@ -20,6 +20,8 @@
 
 #include "itkStackTransform.h"
 
+#include <algorithm> // std::copy
+
 namespace itk
 {
 
@@ -52,17 +54,39 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
     itkExceptionMacro( << "Number of parameters does not match the number of subtransforms * the number of parameters per subtransform." );
   }
 
-  // Set separate subtransform parameters
+  // Store all parameters in one contiguous array. The views on this array
+  // are recreated when they do not point into its current data block with
+  // the current number of parameters per subtransform, e.g. because
+  // GetParameters() resized the array after the subtransforms were resized.
   const NumberOfParametersType numSubTransformParameters = this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+  this->m_Parameters.SetSize( param.GetSize() );
+  bool viewsAreValid = this->m_SubTransformParameters.size() == this->m_NumberOfSubTransforms;
+  for( unsigned int t = 0; viewsAreValid && t < this->m_NumberOfSubTransforms; ++t )
+  {
+    viewsAreValid = this->m_SubTransformParameters[ t ].GetSize() == numSubTransformParameters
+      && this->m_SubTransformParameters[ t ].data_block()
+      == this->m_Parameters.data_block() + t * numSubTransformParameters;
+  }
+  if( !viewsAreValid )
+  {
+    this->m_SubTransformParameters.clear();
+    this->m_SubTransformParameters.resize( this->m_NumberOfSubTransforms );
+    for( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
+    {
+      this->m_SubTransformParameters[ t ].SetData(
+        this->m_Parameters.data_block() + t * numSubTransformParameters,
+        numSubTransformParameters, false );
+    }
+  }
+  if( &param != &( this->m_Parameters ) )
+  {
+    std::copy( param.begin(), param.end(), this->m_Parameters.begin() );
+  }
+
+  // Set separate subtransform parameters, as views on the contiguous array
   for( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
   {
-    // MS, \todo: the new itk::TransformParameters only have constructors taking 1 argument
-    //ParametersType subparams ( ParametersArrayType( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters, false ) );
-    //ParametersType subparams ( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters, false );
-    // NTA, split the parameter by number of subparameters
-    const Array< double > subarray( &( param.data_block()[ t * numSubTransformParameters ] ), numSubTransformParameters, false );
-    ParametersType        subparams( subarray );
-    this->m_SubTransformContainer[ t ]->SetParametersByValue( subparams );
+    this->m_SubTransformContainer[ t ]->SetParameters( this->m_SubTransformParameters[ t ] );
   }
 
   this->Modified();
@@ -78,7 +102,13 @@ const typename StackTransform< TScalarType, NInputDimensions, NOutputDimensions
 & StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 ::GetParameters( void ) const
 {
-  this->m_Parameters.SetSize( this->GetNumberOfParameters() );
+  // The subtransforms may still refer to views on m_Parameters, so when its
+  // size changes, fill a new array before the old one is released. The views
+  // are then recreated by the next SetParameters().
+  ParametersType   resizedParameters;
+  const bool       resize     = this->m_Parameters.GetSize() != this->GetNumberOfParameters();
+  ParametersType & parameters = resize ? resizedParameters : this->m_Parameters;
+  parameters.SetSize( this->GetNumberOfParameters() );
 
   // Fill params with parameters of subtransforms
   unsigned int i = 0;
@@ -87,9 +117,13 @@ const typename StackTransform< TScalarType, NInputDimensions, NOutputDimensions
     const ParametersType & subparams = this->m_SubTransformContainer[ t ]->GetParameters();
     for( unsigned int p = 0; p < this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters(); ++p, ++i )
     {
-      this->m_Parameters[ i ] = subparams[ p ];
+      parameters[ i ] = subparams[ p ];
     }
   }
+  if( resize )
+  {
+    this->m_Parameters = resizedParameters;
+  }
 
   return this->m_Parameters;
 } // end GetParameters()
@@ -114,10 +148,7 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 
   /** Transform point using right subtransform. */
   SubTransformOutputPointType oppr;
-  const unsigned int          subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  const unsigned int          subt = this->GetSubTransformIndex( ipp );
   oppr = this->m_SubTransformContainer[ subt ]->TransformPoint( ippr );
 
   /** Increase dimension of input point. */
@@ -153,10 +184,7 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
   }
 
   /** Get Jacobian from right subtransform. */
-  const unsigned int subt
-    = vnl_math_min( this->m_NumberOfSubTransforms - 1, static_cast< unsigned int >(
-      vnl_math_max( 0,
-      vnl_math_rnd( ( ipp[ ReducedInputSpaceDimension ] - m_StackOrigin ) / m_StackSpacing ) ) ) );
+  const unsigned int subt = this->GetSubTransformIndex( ipp );
   SubTransformJacobianType subjac;
   this->m_SubTransformContainer[ subt ]->GetJacobian( ippr, subjac, nzji );
 
@@ -180,6 +208,238 @@ StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end GetJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints ) const
+{
+  std::vector< SubTransformInputPointType >  ippr;
+  std::vector< SubTransformOutputPointType > oppr;
+
+  SizeValueType begin = 0;
+  while( begin < numberOfPoints )
+  {
+    /** Find the run of points that lie in the same slice. */
+    const unsigned int subt = this->GetSubTransformIndex( inputPoints[ begin ] );
+    SizeValueType      end  = begin + 1;
+    while( end < numberOfPoints && this->GetSubTransformIndex( inputPoints[ end ] ) == subt )
+    {
+      ++end;
+    }
+    const SizeValueType runLength = end - begin;
+
+    /** Reduce dimension of the input points. */
+    ippr.resize( runLength );
+    oppr.resize( runLength );
+    for( SizeValueType i = 0; i < runLength; ++i )
+    {
+      for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+      {
+        ippr[ i ][ d ] = inputPoints[ begin + i ][ d ];
+      }
+    }
+
+    /** Transform the run of points using the right subtransform. */
+    this->m_SubTransformContainer[ subt ]->TransformPoints( runLength, &ippr[ 0 ], &oppr[ 0 ] );
+
+    /** Increase dimension of the output points. */
+    for( SizeValueType i = 0; i < runLength; ++i )
+    {
+      OutputPointType & opp = outputPoints[ begin + i ];
+      for( unsigned int d = 0; d < ReducedOutputSpaceDimension; ++d )
+      {
+        opp[ d ] = oppr[ i ][ d ];
+      }
+      opp[ ReducedOutputSpaceDimension ] = inputPoints[ begin + i ][ ReducedInputSpaceDimension ];
+    }
+
+    begin = end;
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetJacobians(
+  const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  std::vector< SubTransformInputPointType > ippr;
+  std::vector< SubTransformJacobianType >   subjac;
+
+  const NumberOfParametersType numSubTransformParameters
+    = this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+
+  SizeValueType begin = 0;
+  while( begin < numberOfPoints )
+  {
+    /** Find the run of points that lie in the same slice. */
+    const unsigned int subt = this->GetSubTransformIndex( inputPoints[ begin ] );
+    SizeValueType      end  = begin + 1;
+    while( end < numberOfPoints && this->GetSubTransformIndex( inputPoints[ end ] ) == subt )
+    {
+      ++end;
+    }
+    const SizeValueType runLength = end - begin;
+
+    /** Reduce dimension of the input points. */
+    ippr.resize( runLength );
+    subjac.resize( runLength );
+    for( SizeValueType i = 0; i < runLength; ++i )
+    {
+      for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+      {
+        ippr[ i ][ d ] = inputPoints[ begin + i ][ d ];
+      }
+    }
+
+    /** Get the Jacobians from the right subtransform. */
+    this->m_SubTransformContainer[ subt ]->GetJacobians(
+      runLength, &ippr[ 0 ], &subjac[ 0 ], nonZeroJacobianIndices + begin );
+
+    /** Fill the output Jacobians and update the nonzero Jacobian indices. */
+    for( SizeValueType i = 0; i < runLength; ++i )
+    {
+      JacobianType &               jac  = jacobians[ begin + i ];
+      NonZeroJacobianIndicesType & nzji = nonZeroJacobianIndices[ begin + i ];
+      jac.set_size( InputSpaceDimension, nzji.size() );
+      jac.Fill( 0.0 );
+      for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+      {
+        for( unsigned int n = 0; n < nzji.size(); ++n )
+        {
+          jac[ d ][ n ] = subjac[ i ][ d ][ n ];
+        }
+      }
+      for( unsigned int n = 0; n < nzji.size(); ++n )
+      {
+        nzji[ n ] += subt * numSubTransformParameters;
+      }
+    }
+
+    begin = end;
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Reduce dimension of input point. */
+  SubTransformInputPointType ippr;
+  for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+  {
+    ippr[ d ] = ipp[ d ];
+  }
+
+  /** Get the features from the right subtransform. */
+  const unsigned int subt = this->GetSubTransformIndex( ipp );
+  features[ 0 ] = subt;
+  this->m_SubTransformContainer[ subt ]->ComputeFixedSampleFeatures( ippr, features + 1, nzji );
+
+  /** Update non zero Jacobian indices. */
+  for( unsigned int i = 0; i < nzji.size(); ++i )
+  {
+    nzji[ i ] += subt * this->m_SubTransformContainer[ 0 ]->GetNumberOfParameters();
+  }
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+typename StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::OutputPointType
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  /** Reduce dimension of input point. */
+  SubTransformInputPointType ippr;
+  for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+  {
+    ippr[ d ] = ipp[ d ];
+  }
+
+  /** Transform point using the stored subtransform. */
+  const unsigned int                subt = static_cast< unsigned int >( features[ 0 ] );
+  const SubTransformOutputPointType oppr
+    = this->m_SubTransformContainer[ subt ]->TransformPointUsingFixedSampleFeatures( ippr, features + 1 );
+
+  /** Increase dimension of input point. */
+  OutputPointType opp;
+  for( unsigned int d = 0; d < ReducedOutputSpaceDimension; ++d )
+  {
+    opp[ d ] = oppr[ d ];
+  }
+  opp[ ReducedOutputSpaceDimension ] = ipp[ ReducedInputSpaceDimension ];
+
+  return opp;
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+StackTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  /** Reduce dimension of input point and gradient. The last row of the
+   * Jacobian is zero, so the last component of the gradient does not count.
+   */
+  SubTransformInputPointType                         ippr;
+  typename SubTransformType::MovingImageGradientType migr;
+  for( unsigned int d = 0; d < ReducedInputSpaceDimension; ++d )
+  {
+    ippr[ d ] = ipp[ d ];
+    migr[ d ] = movingImageGradient[ d ];
+  }
+
+  /** Compute the product using the stored subtransform. */
+  const unsigned int subt = static_cast< unsigned int >( features[ 0 ] );
+  this->m_SubTransformContainer[ subt ]->EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    ippr, features + 1, migr, imageJacobian );
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
 /**
  * ********************* GetNumberOfNonZeroJacobianIndices ****************************
  */
@@ -39,7 +39,9 @@
 #include "itkAdvancedIdentityTransform.h"
 #include "itkProgressReporter.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageScanlineIterator.h"
 #include "vnl/vnl_det.h"
+#include <vector>
 
 namespace itk
 {
@@ -244,11 +246,19 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   // Get the output pointer
   OutputImagePointer outputPtr = this->GetOutput();
 
-  // Create an iterator that will walk the output region for this thread.
-  typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIteratorType;
+  // Create an iterator that will walk the output region for this thread,
+  // one scanline at a time.
+  typedef ImageScanlineIterator< TOutputImage > OutputIteratorType;
   OutputIteratorType it( outputPtr, outputRegionForThread );
   it.GoToBegin();
 
+  // The spatial Jacobians of a scanline are computed in a single batch
+  typedef typename TransformType::InputPointType InputPointType;
+  const SizeValueType                lineLength = outputRegionForThread.GetSize( 0 );
+  std::vector< InputPointType >      points( lineLength );
+  std::vector< SpatialJacobianType > spatialJacobians( lineLength );
+  if( lineLength == 0 ) { return; }
+
   // pixel coordinates
   PointType point;
 
@@ -258,19 +268,27 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   // Walk the output region
   while( !it.IsAtEnd() )
   {
-    // Determine the coordinates of the current voxel
-    outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    // Determine the coordinates of the voxels on the current line
+    IndexType index = it.GetIndex();
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      outputPtr->TransformIndexToPhysicalPoint( index, point );
+      points[ i ].CastFrom( point );
+      ++index[ 0 ];
+    }
 
-    SpatialJacobianType sj;
-    this->m_Transform->GetSpatialJacobian( point, sj );
-    const PixelType detjac = static_cast< PixelType >( vnl_det( sj.GetVnlMatrix() ) );
+    this->m_Transform->GetSpatialJacobians( lineLength, &points[ 0 ], &spatialJacobians[ 0 ] );
 
-    // Set it
-    it.Set( detjac );
+    // Set the determinants
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      it.Set( static_cast< PixelType >( vnl_det( spatialJacobians[ i ].GetVnlMatrix() ) ) );
 
-    // Update progress and iterator
-    progress.CompletedPixel();
-    ++it;
+      // Update progress and iterator
+      progress.CompletedPixel();
+      ++it;
+    }
+    it.NextLine();
   }
 
 } // end NonlinearThreadedGenerateData()
@@ -323,7 +341,6 @@ TransformToDeterminantOfSpatialJacobianSource< TOutputImage, TTransformPrecision
   outputPtr->SetSpacing( m_OutputSpacing );
   outputPtr->SetOrigin( m_OutputOrigin );
   outputPtr->SetDirection( m_OutputDirection );
-  outputPtr->Allocate();
 
 } // end GenerateOutputInformation()
 
@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToDisplacementFieldSource_h
+#define __itkTransformToDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+
+namespace itk
+{
+
+/** \class TransformToDisplacementFieldSource
+ * \brief Generate the displacement field T(x) - x of an AdvancedTransform.
+ *
+ * The output geometry is set like in TransformToDeterminantOfSpatialJacobianSource.
+ * The filter is multi-threaded and computes the displacements of a scanline
+ * in a single batch, using AdvancedTransform::TransformPoints(). It only
+ * computes the requested region of the output, so a writer can stream it
+ * to disk in parts, keeping the memory use independent of the image size.
+ *
+ * The output pixel type is a vector, typically of floats; the points are
+ * transformed in the precision of the transform.
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TOutputImage,
+class TTransformPrecisionType = double >
+class TransformToDisplacementFieldSource :
+  public ImageSource< TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef TransformToDisplacementFieldSource Self;
+  typedef ImageSource< TOutputImage >        Superclass;
+  typedef SmartPointer< Self >               Pointer;
+  typedef SmartPointer< const Self >         ConstPointer;
+
+  typedef TOutputImage                           OutputImageType;
+  typedef typename OutputImageType::Pointer      OutputImagePointer;
+  typedef typename OutputImageType::ConstPointer OutputImageConstPointer;
+  typedef typename OutputImageType::RegionType   OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformToDisplacementFieldSource, ImageSource );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform< TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) >     TransformType;
+  typedef typename TransformType::ConstPointer    TransformPointerType;
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase< itkGetStaticConstMacro( ImageDimension ) > ImageBaseType;
+
+  /** Set/Get the transform. By default an identity transform is used. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set/Get the region of the output image. */
+  itkSetMacro( OutputRegion, OutputImageRegionType );
+  itkGetConstReferenceMacro( OutputRegion, OutputImageRegionType );
+
+  /** Set/Get the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set/Get the output image origin. */
+  itkSetMacro( OutputOrigin, OriginType );
+  itkGetConstReferenceMacro( OutputOrigin, OriginType );
+
+  /** Set/Get the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** Helper method to set the output parameters based on this image. */
+  void SetOutputParametersFromImage( const ImageBaseType * image );
+
+  /** Set the output geometry. */
+  virtual void GenerateOutputInformation( void );
+
+  /** Check that the transform is set. */
+  virtual void BeforeThreadedGenerateData( void );
+
+  /** Compute the Modified Time based on changes to the components. */
+  unsigned long GetMTime( void ) const;
+
+protected:
+
+  TransformToDisplacementFieldSource();
+  ~TransformToDisplacementFieldSource() {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Compute the displacements of a part of the requested region. */
+  void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread,
+    ThreadIdType threadId );
+
+private:
+
+  TransformToDisplacementFieldSource( const Self & ); // purposely not implemented
+  void operator=( const Self & );                     // purposely not implemented
+
+  /** Member variables. */
+  RegionType           m_OutputRegion;
+  TransformPointerType m_Transform;
+  SpacingType          m_OutputSpacing;
+  OriginType           m_OutputOrigin;
+  DirectionType        m_OutputDirection;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformToDisplacementFieldSource.hxx"
+#endif
+
+#endif // end #ifndef __itkTransformToDisplacementFieldSource_h
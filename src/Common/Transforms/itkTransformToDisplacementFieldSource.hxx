@@ -0,0 +1,226 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToDisplacementFieldSource_hxx
+#define __itkTransformToDisplacementFieldSource_hxx
+
+#include "itkTransformToDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+#include "itkProgressReporter.h"
+#include "itkImageScanlineIterator.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::TransformToDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill( 0 );
+  this->m_OutputRegion.SetSize( size );
+
+  IndexType index;
+  index.Fill( 0 );
+  this->m_OutputRegion.SetIndex( index );
+
+  this->m_Transform = AdvancedIdentityTransform< TTransformPrecisionType, ImageDimension >::New();
+
+} // end Constructor
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* SetOutputParametersFromImage *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputParametersFromImage( const ImageBaseType * image )
+{
+  if( !image )
+  {
+    itkExceptionMacro( << "Cannot use a null image reference" );
+  }
+
+  this->SetOutputOrigin( image->GetOrigin() );
+  this->SetOutputSpacing( image->GetSpacing() );
+  this->SetOutputDirection( image->GetDirection() );
+  this->SetOutputRegion( image->GetLargestPossibleRegion() );
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::BeforeThreadedGenerateData( void )
+{
+  if( !this->m_Transform )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedGenerateData *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread,
+  ThreadIdType threadId )
+{
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  /** Walk the output region one scanline at a time. */
+  typedef ImageScanlineIterator< TOutputImage > OutputIteratorType;
+  OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.GoToBegin();
+
+  /** The points of a scanline are transformed in a single batch. */
+  const SizeValueType            lineLength = outputRegionForThread.GetSize( 0 );
+  std::vector< InputPointType >  inputPoints( lineLength );
+  std::vector< OutputPointType > outputPoints( lineLength );
+  if( lineLength == 0 ) { return; }
+
+  PointType        point;
+  PixelType        displacement;
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+
+  while( !it.IsAtEnd() )
+  {
+    /** The coordinates of the voxels on the current line. */
+    IndexType index = it.GetIndex();
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      outputPtr->TransformIndexToPhysicalPoint( index, point );
+      inputPoints[ i ].CastFrom( point );
+      ++index[ 0 ];
+    }
+
+    this->m_Transform->TransformPoints( lineLength, &inputPoints[ 0 ], &outputPoints[ 0 ] );
+
+    /** Store the displacements. */
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        displacement[ d ] = static_cast< PixelValueType >(
+          outputPoints[ i ][ d ] - inputPoints[ i ][ d ] );
+      }
+      it.Set( displacement );
+
+      progress.CompletedPixel();
+      ++it;
+    }
+    it.NextLine();
+  }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * ******************* GenerateOutputInformation *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GenerateOutputInformation( void )
+{
+  Superclass::GenerateOutputInformation();
+
+  OutputImagePointer outputPtr = this->GetOutput();
+  if( !outputPtr )
+  {
+    return;
+  }
+
+  outputPtr->SetLargestPossibleRegion( this->m_OutputRegion );
+  outputPtr->SetSpacing( this->m_OutputSpacing );
+  outputPtr->SetOrigin( this->m_OutputOrigin );
+  outputPtr->SetDirection( this->m_OutputDirection );
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ******************* GetMTime *******************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+unsigned long
+TransformToDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetMTime( void ) const
+{
+  unsigned long latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+  {
+    if( latestTime < this->m_Transform->GetMTime() )
+    {
+      latestTime = this->m_Transform->GetMTime();
+    }
+  }
+
+  return latestTime;
+
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformToDisplacementFieldSource_hxx
@@ -0,0 +1,219 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToInverseDisplacementFieldSource_h
+#define __itkTransformToInverseDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class TransformToInverseDisplacementFieldSource
+ * \brief Generate the displacement field of the inverse of a coordinate transform
+ *
+ * For every point y of the output grid, the point x with T(x) = y is found
+ * with the fixed point iteration x_{k+1} = x_k - ( T(x_k) - y ), i.e.
+ * x_{k+1} = y - u(x_k) with u the displacement of T. The output pixel is the
+ * inverse displacement x - y. The iteration converges when the spatial
+ * Jacobian of u has a norm smaller than one, which is the case for the smooth,
+ * invertible transformations that result from a registration.
+ *
+ * To reduce the number of iterations, the inverse is first computed on
+ * a grid that is coarser by a factor 2^(NumberOfLevels-1), and every finer
+ * level is seeded with the linear interpolation of the previous level.
+ * The iterations stop when the residual |T(x) - y| is below the Tolerance
+ * (in physical units) or after MaximumNumberOfIterations. The points are
+ * processed in parallel, by the threads of the PersistentThreadPool.
+ *
+ * Output information (spacing, size and direction) for the output
+ * image should be set, e.g. with SetOutputParametersFromImage(). For the
+ * inverse of a registration result this is the grid of the moving image.
+ *
+ * \sa TransformToSpatialJacobianSource
+ *
+ * \ingroup GeometricTransforms
+ */
+template< class TOutputImage,
+class TTransformPrecisionType = double >
+class TransformToInverseDisplacementFieldSource :
+  public ImageSource< TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef TransformToInverseDisplacementFieldSource Self;
+  typedef ImageSource< TOutputImage >               Superclass;
+  typedef SmartPointer< Self >                      Pointer;
+  typedef SmartPointer< const Self >                ConstPointer;
+
+  typedef TOutputImage                         OutputImageType;
+  typedef typename OutputImageType::Pointer    OutputImagePointer;
+  typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformToInverseDisplacementFieldSource, ImageSource );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform< TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension ) > TransformType;
+  typedef typename TransformType::ConstPointer    TransformPointerType;
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase< itkGetStaticConstMacro( ImageDimension ) > ImageBaseType;
+
+  /** Set/Get the transform of which the inverse is computed. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set/Get the region of the output image. */
+  itkSetMacro( OutputRegion, OutputImageRegionType );
+  itkGetConstReferenceMacro( OutputRegion, OutputImageRegionType );
+
+  /** Set/Get the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set/Get the output image origin. */
+  itkSetMacro( OutputOrigin, OriginType );
+  itkGetConstReferenceMacro( OutputOrigin, OriginType );
+
+  /** Set/Get the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** Helper method to set the output parameters based on this image. */
+  void SetOutputParametersFromImage( const ImageBaseType * image );
+
+  /** Set/Get the maximum number of fixed point iterations per level. Default 20. */
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( MaximumNumberOfIterations, unsigned int );
+
+  /** Set/Get the tolerance on the residual |T(x) - y|. Default 1e-3. */
+  itkSetMacro( Tolerance, double );
+  itkGetConstMacro( Tolerance, double );
+
+  /** Set/Get the number of resolution levels. Default 3; 1 disables the
+   * coarse-to-fine seeding.
+   */
+  itkSetClampMacro( NumberOfLevels, unsigned int, 1, 16 );
+  itkGetConstMacro( NumberOfLevels, unsigned int );
+
+  /** After Update(): the number of output points at which the iteration did
+   * not reach the tolerance, and the largest residual.
+   */
+  itkGetConstMacro( NumberOfUnconvergedPoints, SizeValueType );
+  itkGetConstMacro( MaximumResidual, double );
+
+  /** Set the output information. */
+  virtual void GenerateOutputInformation( void );
+
+  /** The complete output is computed at once. */
+  virtual void EnlargeOutputRequestedRegion( DataObject * output );
+
+  /** Compute the Modified Time based on changes to the components. */
+  unsigned long GetMTime( void ) const;
+
+protected:
+
+  TransformToInverseDisplacementFieldSource();
+  virtual ~TransformToInverseDisplacementFieldSource() {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Computes all levels; multi-threading is done per level. */
+  virtual void GenerateData( void );
+
+private:
+
+  TransformToInverseDisplacementFieldSource( const Self & ); // purposely not implemented
+  void operator=( const Self & );                            // purposely not implemented
+
+  /** The data of a single level. Its grid has the origin and direction of
+   * the output, and a spacing that is m_Factor times larger. The work items
+   * are the lines along the first dimension.
+   */
+  struct LevelType
+  {
+    const TransformType * m_Transform;
+    double                m_Origin[ ImageDimension ];
+    double                m_IndexToPoint[ ImageDimension ][ ImageDimension ];
+    SizeValueType         m_Size[ ImageDimension ];
+    double *              m_Displacement;
+    const double *        m_Seed;
+    SizeValueType         m_SeedSize[ ImageDimension ];
+    double                m_SeedScale;
+    unsigned int          m_MaximumNumberOfIterations;
+    double                m_Tolerance;
+    SizeValueType *       m_LineUnconverged;
+    double *              m_LineMaximumResidual;
+  };
+
+  /** Executes the iterations for the lines [begin, end). */
+  static void LevelRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Multilinear interpolation of the seed displacement at a continuous index. */
+  static void InterpolateSeed( const LevelType & level,
+    const double * continuousIndex, double * displacement );
+
+  /** Member variables. */
+  RegionType           m_OutputRegion;
+  TransformPointerType m_Transform;
+  SpacingType          m_OutputSpacing;
+  OriginType           m_OutputOrigin;
+  DirectionType        m_OutputDirection;
+  unsigned int         m_MaximumNumberOfIterations;
+  double               m_Tolerance;
+  unsigned int         m_NumberOfLevels;
+  SizeValueType        m_NumberOfUnconvergedPoints;
+  double               m_MaximumResidual;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformToInverseDisplacementFieldSource.hxx"
+#endif
+
+#endif // end #ifndef __itkTransformToInverseDisplacementFieldSource_h
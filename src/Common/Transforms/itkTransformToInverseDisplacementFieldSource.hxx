@@ -0,0 +1,434 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformToInverseDisplacementFieldSource_hxx
+#define __itkTransformToInverseDisplacementFieldSource_hxx
+
+#include "itkTransformToInverseDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::TransformToInverseDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill( 0 );
+  this->m_OutputRegion.SetSize( size );
+
+  IndexType index;
+  index.Fill( 0 );
+  this->m_OutputRegion.SetIndex( index );
+
+  this->m_Transform = AdvancedIdentityTransform< TTransformPrecisionType, ImageDimension >::New();
+
+  this->m_MaximumNumberOfIterations = 20;
+  this->m_Tolerance                 = 1e-3;
+  this->m_NumberOfLevels            = 3;
+  this->m_NumberOfUnconvergedPoints = 0;
+  this->m_MaximumResidual           = 0.0;
+
+} // end Constructor
+
+
+/**
+ * ******************* SetOutputParametersFromImage ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::SetOutputParametersFromImage( const ImageBaseType * image )
+{
+  if( !image )
+  {
+    itkExceptionMacro( << "Cannot use a null image reference" );
+  }
+
+  this->SetOutputOrigin( image->GetOrigin() );
+  this->SetOutputSpacing( image->GetSpacing() );
+  this->SetOutputDirection( image->GetDirection() );
+  this->SetOutputRegion( image->GetLargestPossibleRegion() );
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * ******************* GenerateOutputInformation ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GenerateOutputInformation( void )
+{
+  Superclass::GenerateOutputInformation();
+
+  OutputImagePointer outputPtr = this->GetOutput();
+  if( !outputPtr )
+  {
+    return;
+  }
+
+  outputPtr->SetLargestPossibleRegion( this->m_OutputRegion );
+  outputPtr->SetSpacing( this->m_OutputSpacing );
+  outputPtr->SetOrigin( this->m_OutputOrigin );
+  outputPtr->SetDirection( this->m_OutputDirection );
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ******************* EnlargeOutputRequestedRegion ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  if( output )
+  {
+    output->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end EnlargeOutputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GenerateData( void )
+{
+  if( !this->m_Transform )
+  {
+    itkExceptionMacro( << "Transform not set" );
+  }
+
+  OutputImageType * outputPtr = this->GetOutput();
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+
+  this->m_NumberOfUnconvergedPoints = 0;
+  this->m_MaximumResidual           = 0.0;
+
+  const RegionType & region = outputPtr->GetBufferedRegion();
+  if( region.GetNumberOfPixels() == 0 ) { return; }
+
+  /** The physical point of the first output pixel, and the matrix that maps
+   * an index offset to a physical offset.
+   */
+  PointType origin;
+  outputPtr->TransformIndexToPhysicalPoint( region.GetIndex(), origin );
+  const DirectionType & direction = outputPtr->GetDirection();
+  const SpacingType &   spacing   = outputPtr->GetSpacing();
+
+  std::vector< double >        seed;
+  std::vector< double >        displacement;
+  std::vector< SizeValueType > lineUnconverged;
+  std::vector< double >        lineMaximumResidual;
+
+  LevelType level;
+  level.m_Transform                 = this->m_Transform.GetPointer();
+  level.m_Seed                      = 0;
+  level.m_SeedScale                 = 0.5;
+  level.m_MaximumNumberOfIterations = this->m_MaximumNumberOfIterations;
+  level.m_Tolerance                 = this->m_Tolerance;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    level.m_Origin[ i ] = origin[ i ];
+  }
+
+  for( unsigned int l = this->m_NumberOfLevels; l > 0; --l )
+  {
+    /** The grid of this level covers the output grid, with a spacing that
+     * is 'factor' times larger.
+     */
+    const SizeValueType factor = static_cast< SizeValueType >( 1 ) << ( l - 1 );
+    SizeValueType       numberOfPoints = 1;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      level.m_Size[ d ] = ( region.GetSize( d ) - 1 + factor - 1 ) / factor + 1;
+      numberOfPoints   *= level.m_Size[ d ];
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        level.m_IndexToPoint[ i ][ d ] = direction[ i ][ d ] * spacing[ d ] * factor;
+      }
+    }
+    const SizeValueType numberOfLines = numberOfPoints / level.m_Size[ 0 ];
+
+    displacement.assign( numberOfPoints * ImageDimension, 0.0 );
+    lineUnconverged.assign( numberOfLines, 0 );
+    lineMaximumResidual.assign( numberOfLines, 0.0 );
+    level.m_Displacement        = &displacement[ 0 ];
+    level.m_LineUnconverged     = &lineUnconverged[ 0 ];
+    level.m_LineMaximumResidual = &lineMaximumResidual[ 0 ];
+
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfLines, 0, LevelRangeFunction, &level );
+
+    /** The result of this level is the seed of the next one. */
+    seed.swap( displacement );
+    level.m_Seed = &seed[ 0 ];
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      level.m_SeedSize[ d ] = level.m_Size[ d ];
+    }
+
+    /** The statistics of the finest level are reported. */
+    if( l == 1 )
+    {
+      for( SizeValueType line = 0; line < numberOfLines; ++line )
+      {
+        this->m_NumberOfUnconvergedPoints += lineUnconverged[ line ];
+        this->m_MaximumResidual            = std::max( this->m_MaximumResidual, lineMaximumResidual[ line ] );
+      }
+    }
+  }
+
+  /** Copy the finest level, which has the output grid, to the output. */
+  PixelType *         out            = outputPtr->GetBufferPointer();
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
+  for( SizeValueType p = 0; p < numberOfPixels; ++p )
+  {
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      out[ p ][ d ] = static_cast< PixelValueType >( seed[ p * ImageDimension + d ] );
+    }
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* LevelRangeFunction ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::LevelRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const LevelType &   level     = *static_cast< const LevelType * >( userData );
+  const SizeValueType lineSize  = level.m_Size[ 0 ];
+  const double        tolerance = level.m_Tolerance;
+
+  InputPointType x;
+  double         y[ ImageDimension ];
+  double         v[ ImageDimension ];
+  double         index[ ImageDimension ];
+  double         continuousIndex[ ImageDimension ];
+
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    /** The index of the first point of the line. */
+    SizeValueType rest = line;
+    index[ 0 ] = 0.0;
+    for( unsigned int d = 1; d < ImageDimension; ++d )
+    {
+      index[ d ] = static_cast< double >( rest % level.m_Size[ d ] );
+      rest      /= level.m_Size[ d ];
+    }
+
+    SizeValueType unconverged     = 0;
+    double        maximumResidual = 0.0;
+    for( SizeValueType i = 0; i < lineSize; ++i )
+    {
+      index[ 0 ] = static_cast< double >( i );
+      for( unsigned int r = 0; r < ImageDimension; ++r )
+      {
+        y[ r ] = level.m_Origin[ r ];
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          y[ r ] += level.m_IndexToPoint[ r ][ d ] * index[ d ];
+        }
+      }
+
+      /** Start from the coarser estimate, or from the identity. */
+      if( level.m_Seed )
+      {
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          continuousIndex[ d ] = index[ d ] * level.m_SeedScale;
+        }
+        InterpolateSeed( level, continuousIndex, v );
+      }
+      else
+      {
+        std::fill( v, v + ImageDimension, 0.0 );
+      }
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        x[ d ] = y[ d ] + v[ d ];
+      }
+
+      /** The fixed point iteration x <- x - ( T(x) - y ). */
+      double residual = 0.0;
+      for( unsigned int iteration = 0;; ++iteration )
+      {
+        const OutputPointType tx = level.m_Transform->TransformPoint( x );
+        double                squaredResidual = 0.0;
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          v[ d ]           = tx[ d ] - y[ d ];
+          squaredResidual += v[ d ] * v[ d ];
+        }
+        residual = std::sqrt( squaredResidual );
+        if( residual < tolerance || iteration == level.m_MaximumNumberOfIterations )
+        {
+          break;
+        }
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          x[ d ] -= v[ d ];
+        }
+      }
+
+      if( residual >= tolerance ) { ++unconverged; }
+      maximumResidual = std::max( maximumResidual, residual );
+
+      double * out = level.m_Displacement + ( line * lineSize + i ) * ImageDimension;
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        out[ d ] = x[ d ] - y[ d ];
+      }
+    }
+
+    level.m_LineUnconverged[ line ]     = unconverged;
+    level.m_LineMaximumResidual[ line ] = maximumResidual;
+  }
+
+} // end LevelRangeFunction()
+
+
+/**
+ * ******************* InterpolateSeed ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::InterpolateSeed( const LevelType & level,
+  const double * continuousIndex, double * displacement )
+{
+  /** The lower corner of the cell, clamped to the grid, and the weights. */
+  SizeValueType lower[ ImageDimension ];
+  SizeValueType strides[ ImageDimension ];
+  double        fractions[ ImageDimension ];
+  SizeValueType stride = 1;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    const SizeValueType last = level.m_SeedSize[ d ] - 1;
+    const double        c    = std::min( std::max( continuousIndex[ d ], 0.0 ), static_cast< double >( last ) );
+    lower[ d ]     = std::min( static_cast< SizeValueType >( c ), last > 0 ? last - 1 : 0 );
+    fractions[ d ] = last > 0 ? c - static_cast< double >( lower[ d ] ) : 0.0;
+    strides[ d ]   = stride;
+    stride        *= level.m_SeedSize[ d ];
+  }
+
+  std::fill( displacement, displacement + ImageDimension, 0.0 );
+  for( unsigned int corner = 0; corner < ( 1u << ImageDimension ); ++corner )
+  {
+    double        weight = 1.0;
+    SizeValueType offset = 0;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      const bool upper = ( corner >> d ) & 1u;
+      weight *= upper ? fractions[ d ] : 1.0 - fractions[ d ];
+      offset += ( lower[ d ] + ( upper && level.m_SeedSize[ d ] > 1 ? 1 : 0 ) ) * strides[ d ];
+    }
+    if( weight == 0.0 ) { continue; }
+
+    const double * seed = level.m_Seed + offset * ImageDimension;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      displacement[ d ] += weight * seed[ d ];
+    }
+  }
+
+} // end InterpolateSeed()
+
+
+/**
+ * ******************* GetMTime ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+unsigned long
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::GetMTime( void ) const
+{
+  unsigned long latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+  {
+    if( latestTime < this->m_Transform->GetMTime() )
+    {
+      latestTime = this->m_Transform->GetMTime();
+    }
+  }
+
+  return latestTime;
+} // end GetMTime()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template< class TOutputImage, class TTransformPrecisionType >
+void
+TransformToInverseDisplacementFieldSource< TOutputImage, TTransformPrecisionType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+  os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformToInverseDisplacementFieldSource_hxx
@@ -20,6 +20,9 @@
 
 #include "itkObject.h"
 #include "itkArray.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -33,6 +36,17 @@ namespace itk
  * on a denser grid. Therefore, the user needs to supply the old B-spline grid
  * (region, spacing, origin, direction), and the required B-spline grid.
  *
+ * The B-spline is evaluated at the new control points, after which the
+ * coefficients on the new grid are computed by a B-spline decomposition.
+ * The decomposition may use another B-spline order than the evaluation, see
+ * SetRequiredBSplineOrder(), to transfer the parameters to a transform with
+ * another spline order.
+ * When both grids have the same direction, both steps are separable. They
+ * are then fused in one pass per dimension, that processes strips of lines
+ * in parallel on the PersistentThreadPool, and reads and writes the parameter
+ * arrays directly. The results equal those of a ResampleImageFilter with a
+ * BSplineResampleImageFunction, followed by a BSplineDecompositionImageFilter,
+ * which is still used when the directions differ.
  */
 
 template< class TArray, class TImage >
@@ -91,8 +105,22 @@ public:
   /** Set the region of the required grid. */
   itkSetMacro( RequiredGridRegion, RegionType );
 
-  /** Set the B-spline order. */
-  itkSetMacro( BSplineOrder, unsigned int );
+  /** Set the B-spline order, of both the current and the required grid. */
+  virtual void SetBSplineOrder( const unsigned int order )
+  {
+    if( this->m_BSplineOrder != order || this->m_RequiredBSplineOrder != order )
+    {
+      this->m_BSplineOrder         = order;
+      this->m_RequiredBSplineOrder = order;
+      this->Modified();
+    }
+  }
+
+
+  /** Set the B-spline order of the required grid, if it differs from that of
+   * the current grid. Call it after SetBSplineOrder().
+   */
+  itkSetMacro( RequiredBSplineOrder, unsigned int );
 
   /** Compute the output parameter array. */
   virtual void UpsampleParameters( const ArrayType & param_in,
@@ -112,11 +140,64 @@ protected:
   /** Function that checks if upsampling is required. */
   virtual bool DoUpsampling( void );
 
+  /** Upsample with a resampler and a decomposition filter per coefficient
+   * image. This works for all grids.
+   */
+  virtual void UpsampleParametersWithResampler( const ArrayType & param_in,
+    ArrayType & param_out );
+
+  /** Upsample with separable passes; requires grids with the same direction. */
+  virtual void UpsampleParametersSeparable( const ArrayType & param_in,
+    ArrayType & param_out );
+
 private:
 
   UpsampleBSplineParametersFilter( const Self & ); // purposely not implemented
   void operator=( const Self & );                  // purposely not implemented
 
+  /** The data of a pass along one dimension, which transfers the lines from
+   * the current grid to the required grid. The source and destination are
+   * either one of the parameter arrays, or a work buffer.
+   */
+  struct PassType
+  {
+    /** The number of neighbouring lines processed together. */
+    enum { StripWidth = 16 };
+
+    const ValueType *       m_ArraySource;
+    const double *          m_BufferSource;
+    ValueType *             m_ArrayDestination;
+    double *                m_BufferDestination;
+    SizeValueType           m_SourceSize;
+    SizeValueType           m_DestinationSize;
+    SizeValueType           m_InnerSize;
+    SizeValueType           m_NumberOfStrips;
+    unsigned int            m_NumberOfTaps;
+    const SizeValueType *   m_Taps;
+    const double *          m_Weights;
+    const double *          m_Poles;
+    unsigned int            m_NumberOfPoles;
+  };
+
+  /** Evaluate the B-spline kernel of the given order. */
+  static double EvaluateBSplineKernel( const unsigned int order, const double x );
+
+  /** Get the poles of the B-spline decomposition, as used by the BSplineDecompositionImageFilter. */
+  void GetSplinePoles( std::vector< double > & poles ) const;
+
+  /** Executes a pass for the work items [begin, end). */
+  static void PassRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Executes a pass for a single strip of lines. */
+  template< class TSource, class TDestination >
+  static void ProcessStrip( const PassType & pass, const TSource * source,
+    TDestination * destination, double * scratch, const SizeValueType item );
+
+  /** Decompose the lines of a strip, stored as rows of width values. */
+  static void DecomposeStrip( const PassType & pass, double * scratch,
+    const SizeValueType width );
+
   /** Private member variables. */
   OriginType    m_CurrentGridOrigin;
   SpacingType   m_CurrentGridSpacing;
@@ -127,6 +208,7 @@ private:
   DirectionType m_RequiredGridDirection;
   RegionType    m_RequiredGridRegion;
   unsigned int  m_BSplineOrder;
+  unsigned int  m_RequiredBSplineOrder;
 
 };
 
@@ -24,6 +24,9 @@
 #include "itkBSplineDecompositionImageFilter.h"
 #include "itkResampleImageFilter.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -35,7 +38,8 @@ template< class TArray, class TImage >
 UpsampleBSplineParametersFilter< TArray, TImage >
 ::UpsampleBSplineParametersFilter()
 {
-  this->m_BSplineOrder = 3;
+  this->m_BSplineOrder         = 3;
+  this->m_RequiredBSplineOrder = 3;
 
   // Initialize grid settings.
   this->m_CurrentGridOrigin.Fill( 0.0 );
@@ -64,6 +68,29 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     return;
   }
 
+  /** The passes are only separable when the grids have the same direction. */
+  if( this->m_CurrentGridDirection == this->m_RequiredGridDirection )
+  {
+    this->UpsampleParametersSeparable( parameters_in, parameters_out );
+  }
+  else
+  {
+    this->UpsampleParametersWithResampler( parameters_in, parameters_out );
+  }
+
+} // end UpsampleParameters()
+
+
+/**
+ * ******************* UpsampleParametersWithResampler *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::UpsampleParametersWithResampler( const ArrayType & parameters_in,
+  ArrayType & parameters_out )
+{
   /** Typedefs. */
   typedef itk::ResampleImageFilter<
     ImageType, ImageType >                        UpsampleFilterType;
@@ -129,7 +156,8 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     upsampler->SetInput( coeffs_in );
 
     /** Setup the decomposition filter. */
-    decompositionFilter->SetSplineOrder( this->m_BSplineOrder );
+    coeffUpsampleFunction->SetSplineOrder( this->m_BSplineOrder );
+    decompositionFilter->SetSplineOrder( this->m_RequiredBSplineOrder );
     decompositionFilter->SetInput( upsampler->GetOutput() );
 
     /** Do the upsampling. */
@@ -161,7 +189,399 @@ UpsampleBSplineParametersFilter< TArray, TImage >
 
   } // end for dimension loop
 
-} // end UpsampleParameters()
+} // end UpsampleParametersWithResampler()
+
+
+/**
+ * ******************* UpsampleParametersSeparable *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::UpsampleParametersSeparable( const ArrayType & parameters_in,
+  ArrayType & parameters_out )
+{
+  /** Get the number of parameters. */
+  const SizeValueType currentNumberOfPixels
+    = this->m_CurrentGridRegion.GetNumberOfPixels();
+  const SizeValueType requiredNumberOfPixels
+    = this->m_RequiredGridRegion.GetNumberOfPixels();
+
+  /** Create the new vector of output parameters, with the correct size. */
+  parameters_out.SetSize( requiredNumberOfPixels * Dimension );
+
+  /** The poles of the decomposition. */
+  std::vector< double > poles;
+  this->GetSplinePoles( poles );
+
+  /** The continuous index u in the current grid of control point i of the
+   * required grid is u = S_c^-1 D^-1 ( o_r - o_c ) + S_c^-1 S_r i, with S the
+   * spacings and D the common direction, so every dimension can be treated
+   * separately. Per dimension and per new control point, we store the indices
+   * and weights of the current control points that contribute. The weights
+   * of points outside the current grid are zero, since that is what the
+   * ResampleImageFilter produces there.
+   */
+  const unsigned int numberOfTaps = this->m_BSplineOrder + 1;
+  const double       halfOffset   = ( this->m_BSplineOrder & 1 ) ? 0.0 : 0.5;
+  const typename DirectionType::InternalMatrixType inverseDirection
+    = this->m_CurrentGridDirection.GetInverse();
+  const typename OriginType::VectorType originOffset
+    = this->m_RequiredGridOrigin - this->m_CurrentGridOrigin;
+
+  std::vector< SizeValueType > taps[ Dimension ];
+  std::vector< double >        weights[ Dimension ];
+  for( unsigned int d = 0; d < Dimension; d++ )
+  {
+    double projectedOffset = 0.0;
+    for( unsigned int e = 0; e < Dimension; e++ )
+    {
+      projectedOffset += inverseDirection[ d ][ e ] * originOffset[ e ];
+    }
+
+    const OffsetValueType n = static_cast< OffsetValueType >( this->m_CurrentGridRegion.GetSize( d ) );
+    const SizeValueType   m = this->m_RequiredGridRegion.GetSize( d );
+    taps[ d ].resize( m * numberOfTaps );
+    weights[ d ].assign( m * numberOfTaps, 0.0 );
+
+    for( SizeValueType i = 0; i < m; i++ )
+    {
+      const double u = ( projectedOffset + ( this->m_RequiredGridRegion.GetIndex( d )
+        + static_cast< OffsetValueType >( i ) ) * this->m_RequiredGridSpacing[ d ] )
+        / this->m_CurrentGridSpacing[ d ] - this->m_CurrentGridRegion.GetIndex( d );
+      const bool            inside = u >= -0.5 && u < n - 0.5;
+      const OffsetValueType first  = static_cast< OffsetValueType >( std::floor( u + halfOffset ) )
+        - static_cast< OffsetValueType >( this->m_BSplineOrder / 2 );
+
+      for( unsigned int k = 0; k < numberOfTaps; k++ )
+      {
+        /** Mirror boundary conditions, like the BSplineInterpolateImageFunction. */
+        OffsetValueType tap = first + k;
+        if( n == 1 ) { tap = 0; }
+        if( tap < 0 ) { tap = -tap; }
+        if( tap > n - 1 ) { tap = 2 * ( n - 1 ) - tap; }
+        tap = std::min( std::max( tap, OffsetValueType( 0 ) ), n - 1 );
+
+        taps[ d ][ i * numberOfTaps + k ] = static_cast< SizeValueType >( tap );
+        if( inside )
+        {
+          weights[ d ][ i * numberOfTaps + k ]
+            = EvaluateBSplineKernel( this->m_BSplineOrder, u - ( first + k ) );
+        }
+      }
+    }
+  }
+
+  /** Setup the passes. */
+  PassType pass;
+  pass.m_NumberOfTaps  = numberOfTaps;
+  pass.m_Poles         = poles.empty() ? 0 : &poles[ 0 ];
+  pass.m_NumberOfPoles = static_cast< unsigned int >( poles.size() );
+
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+  std::vector< double >         buffers[ 2 ];
+
+  /** Loop over dimension: each coefficient image is upsampled separately,
+   * with a pass along every dimension. The passes alternate between two work
+   * buffers, the first reads the input parameters, the last writes the output.
+   */
+  for( unsigned int j = 0; j < Dimension; j++ )
+  {
+    SizeValueType sizes[ Dimension ];
+    for( unsigned int d = 0; d < Dimension; d++ )
+    {
+      sizes[ d ] = this->m_CurrentGridRegion.GetSize( d );
+    }
+    SizeValueType numberOfPixels = currentNumberOfPixels;
+    pass.m_InnerSize = 1;
+
+    for( unsigned int d = 0; d < Dimension; d++ )
+    {
+      const SizeValueType destinationSize = this->m_RequiredGridRegion.GetSize( d );
+      const SizeValueType outerSize       = numberOfPixels / ( sizes[ d ] * pass.m_InnerSize );
+      numberOfPixels = numberOfPixels / sizes[ d ] * destinationSize;
+
+      pass.m_ArraySource       = 0;
+      pass.m_BufferSource      = 0;
+      pass.m_ArrayDestination  = 0;
+      pass.m_BufferDestination = 0;
+      if( d == 0 )
+      {
+        pass.m_ArraySource = parameters_in.data_block() + j * currentNumberOfPixels;
+      }
+      else
+      {
+        pass.m_BufferSource = &buffers[ ( d - 1 ) % 2 ][ 0 ];
+      }
+      if( d == Dimension - 1 )
+      {
+        pass.m_ArrayDestination = parameters_out.data_block() + j * requiredNumberOfPixels;
+      }
+      else
+      {
+        buffers[ d % 2 ].resize( numberOfPixels );
+        pass.m_BufferDestination = &buffers[ d % 2 ][ 0 ];
+      }
+
+      pass.m_SourceSize      = sizes[ d ];
+      pass.m_DestinationSize = destinationSize;
+      pass.m_NumberOfStrips  = ( pass.m_InnerSize + PassType::StripWidth - 1 ) / PassType::StripWidth;
+      pass.m_Taps            = &taps[ d ][ 0 ];
+      pass.m_Weights         = &weights[ d ][ 0 ];
+
+      threadPool->ParallelFor( outerSize * pass.m_NumberOfStrips, 0,
+        PassRangeFunction, &pass );
+
+      sizes[ d ]        = destinationSize;
+      pass.m_InnerSize *= destinationSize;
+    }
+  } // end for dimension loop
+
+} // end UpsampleParametersSeparable()
+
+
+/**
+ * ******************* EvaluateBSplineKernel *******************
+ */
+
+template< class TArray, class TImage >
+double
+UpsampleBSplineParametersFilter< TArray, TImage >
+::EvaluateBSplineKernel( const unsigned int order, const double x )
+{
+  /** The Cox-de Boor recursion, for the centered B-spline. */
+  if( order == 0 )
+  {
+    return ( x >= -0.5 && x < 0.5 ) ? 1.0 : 0.0;
+  }
+
+  const double n = static_cast< double >( order );
+  return ( ( n + 1.0 ) / 2.0 + x ) / n * EvaluateBSplineKernel( order - 1, x + 0.5 )
+         + ( ( n + 1.0 ) / 2.0 - x ) / n * EvaluateBSplineKernel( order - 1, x - 0.5 );
+
+} // end EvaluateBSplineKernel()
+
+
+/**
+ * ******************* GetSplinePoles *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::GetSplinePoles( std::vector< double > & poles ) const
+{
+  poles.clear();
+  switch( this->m_RequiredBSplineOrder )
+  {
+    case 0:
+    case 1:
+      break;
+    case 2:
+      poles.push_back( std::sqrt( 8.0 ) - 3.0 );
+      break;
+    case 3:
+      poles.push_back( std::sqrt( 3.0 ) - 2.0 );
+      break;
+    case 4:
+      poles.push_back( std::sqrt( 664.0 - std::sqrt( 438976.0 ) ) + std::sqrt( 304.0 ) - 19.0 );
+      poles.push_back( std::sqrt( 664.0 + std::sqrt( 438976.0 ) ) - std::sqrt( 304.0 ) - 19.0 );
+      break;
+    case 5:
+      poles.push_back( std::sqrt( 135.0 / 2.0 - std::sqrt( 17745.0 / 4.0 ) ) + std::sqrt( 105.0 / 4.0 ) - 13.0 / 2.0 );
+      poles.push_back( std::sqrt( 135.0 / 2.0 + std::sqrt( 17745.0 / 4.0 ) ) - std::sqrt( 105.0 / 4.0 ) - 13.0 / 2.0 );
+      break;
+    default:
+      itkExceptionMacro( << "The B-spline order should be between 0 and 5, but is "
+                         << this->m_RequiredBSplineOrder << "." );
+  }
+
+} // end GetSplinePoles()
+
+
+/**
+ * ******************* PassRangeFunction *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::PassRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const PassType &      pass = *static_cast< const PassType * >( userData );
+  std::vector< double > scratch( pass.m_DestinationSize * PassType::StripWidth );
+
+  for( SizeValueType item = begin; item < end; ++item )
+  {
+    if( pass.m_ArraySource && pass.m_ArrayDestination )
+    {
+      ProcessStrip( pass, pass.m_ArraySource, pass.m_ArrayDestination, &scratch[ 0 ], item );
+    }
+    else if( pass.m_ArraySource )
+    {
+      ProcessStrip( pass, pass.m_ArraySource, pass.m_BufferDestination, &scratch[ 0 ], item );
+    }
+    else if( pass.m_ArrayDestination )
+    {
+      ProcessStrip( pass, pass.m_BufferSource, pass.m_ArrayDestination, &scratch[ 0 ], item );
+    }
+    else
+    {
+      ProcessStrip( pass, pass.m_BufferSource, pass.m_BufferDestination, &scratch[ 0 ], item );
+    }
+  }
+
+} // end PassRangeFunction()
+
+
+/**
+ * ******************* ProcessStrip *******************
+ */
+
+template< class TArray, class TImage >
+template< class TSource, class TDestination >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::ProcessStrip( const PassType & pass, const TSource * source,
+  TDestination * destination, double * scratch, const SizeValueType item )
+{
+  const SizeValueType outer = item / pass.m_NumberOfStrips;
+  const SizeValueType first = ( item % pass.m_NumberOfStrips ) * PassType::StripWidth;
+  const SizeValueType width = std::min( static_cast< SizeValueType >( PassType::StripWidth ),
+    pass.m_InnerSize - first );
+
+  const TSource * sourceStrip = source
+    + outer * pass.m_SourceSize * pass.m_InnerSize + first;
+  TDestination * destinationStrip = destination
+    + outer * pass.m_DestinationSize * pass.m_InnerSize + first;
+
+  /** Evaluate the B-spline at the new control points. The lines in the strip
+   * are contiguous, so every tap reads a block of memory.
+   */
+  for( SizeValueType i = 0; i < pass.m_DestinationSize; ++i )
+  {
+    double * row = scratch + i * width;
+    std::fill( row, row + width, 0.0 );
+    for( unsigned int k = 0; k < pass.m_NumberOfTaps; ++k )
+    {
+      const double weight = pass.m_Weights[ i * pass.m_NumberOfTaps + k ];
+      if( weight == 0.0 ) { continue; }
+      const TSource * sourceRow = sourceStrip + pass.m_Taps[ i * pass.m_NumberOfTaps + k ] * pass.m_InnerSize;
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        row[ b ] += weight * static_cast< double >( sourceRow[ b ] );
+      }
+    }
+  }
+
+  /** Compute the B-spline coefficients of the result. */
+  DecomposeStrip( pass, scratch, width );
+
+  for( SizeValueType i = 0; i < pass.m_DestinationSize; ++i )
+  {
+    const double * row            = scratch + i * width;
+    TDestination * destinationRow = destinationStrip + i * pass.m_InnerSize;
+    for( SizeValueType b = 0; b < width; ++b )
+    {
+      destinationRow[ b ] = static_cast< TDestination >( row[ b ] );
+    }
+  }
+
+} // end ProcessStrip()
+
+
+/**
+ * ******************* DecomposeStrip *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::DecomposeStrip( const PassType & pass, double * c, const SizeValueType width )
+{
+  /** This is the recursive filter of the BSplineDecompositionImageFilter,
+   * with mirror boundaries and the same tolerance, applied to all lines in
+   * the strip at once. See Unser, 1999, Box 2.
+   */
+  const SizeValueType length = pass.m_DestinationSize;
+  if( length == 1 || pass.m_NumberOfPoles == 0 ) { return; }
+
+  /** Compute the overall gain. */
+  double gain = 1.0;
+  for( unsigned int k = 0; k < pass.m_NumberOfPoles; ++k )
+  {
+    gain *= ( 1.0 - pass.m_Poles[ k ] ) * ( 1.0 - 1.0 / pass.m_Poles[ k ] );
+  }
+  for( SizeValueType i = 0; i < length * width; ++i )
+  {
+    c[ i ] *= gain;
+  }
+
+  const double tolerance = 1e-10;
+  double       sum[ PassType::StripWidth ];
+  for( unsigned int k = 0; k < pass.m_NumberOfPoles; ++k )
+  {
+    const double z = pass.m_Poles[ k ];
+
+    /** Causal initialization. */
+    const SizeValueType horizon = static_cast< SizeValueType >(
+      std::ceil( std::log( tolerance ) / std::log( std::fabs( z ) ) ) );
+    if( horizon < length )
+    {
+      /** Accelerated loop. */
+      std::copy( c, c + width, sum );
+      double zn = z;
+      for( SizeValueType n = 1; n < horizon; ++n )
+      {
+        for( SizeValueType b = 0; b < width; ++b ) { sum[ b ] += zn * c[ n * width + b ]; }
+        zn *= z;
+      }
+      std::copy( sum, sum + width, c );
+    }
+    else
+    {
+      /** Full loop. */
+      const double iz  = 1.0 / z;
+      double       zn  = z;
+      double       z2n = std::pow( z, static_cast< double >( length - 1 ) );
+      for( SizeValueType b = 0; b < width; ++b ) { sum[ b ] = c[ b ] + z2n * c[ ( length - 1 ) * width + b ]; }
+      z2n *= z2n * iz;
+      for( SizeValueType n = 1; n + 1 < length; ++n )
+      {
+        for( SizeValueType b = 0; b < width; ++b ) { sum[ b ] += ( zn + z2n ) * c[ n * width + b ]; }
+        zn  *= z;
+        z2n *= iz;
+      }
+      for( SizeValueType b = 0; b < width; ++b ) { c[ b ] = sum[ b ] / ( 1.0 - zn * zn ); }
+    }
+
+    /** Causal recursion. */
+    for( SizeValueType n = 1; n < length; ++n )
+    {
+      for( SizeValueType b = 0; b < width; ++b ) { c[ n * width + b ] += z * c[ ( n - 1 ) * width + b ]; }
+    }
+
+    /** Anticausal initialization. */
+    double * last     = c + ( length - 1 ) * width;
+    double * previous = c + ( length - 2 ) * width;
+    for( SizeValueType b = 0; b < width; ++b )
+    {
+      last[ b ] = ( z / ( z * z - 1.0 ) ) * ( z * previous[ b ] + last[ b ] );
+    }
+
+    /** Anticausal recursion. */
+    for( SizeValueType n = length - 1; n-- > 0; )
+    {
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        c[ n * width + b ] = z * ( c[ ( n + 1 ) * width + b ] - c[ n * width + b ] );
+      }
+    }
+  }
+
+} // end DecomposeStrip()
 
 
 /**
@@ -177,6 +597,7 @@ UpsampleBSplineParametersFilter< TArray, TImage >
   ret |= ( this->m_CurrentGridSpacing != this->m_RequiredGridSpacing );
   ret |= ( this->m_CurrentGridDirection != this->m_RequiredGridDirection );
   ret |= ( this->m_CurrentGridRegion != this->m_RequiredGridRegion );
+  ret |= ( this->m_BSplineOrder != this->m_RequiredBSplineOrder );
 
   return ret;
 
@@ -205,6 +626,7 @@ UpsampleBSplineParametersFilter< TArray, TImage >
   os << indent << "RequiredGridRegion: "  << this->m_RequiredGridRegion << std::endl;
 
   os << indent << "BSplineOrder: " << this->m_BSplineOrder << std::endl;
+  os << indent << "RequiredBSplineOrder: " << this->m_RequiredBSplineOrder << std::endl;
 
 } // end PrintSelf()
 
@@ -22,6 +22,8 @@
 
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -32,7 +34,51 @@ namespace itk
 template< class TInputImage, class TCoordRep >
 AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
 ::AdvancedLinearInterpolateImageFunction()
-{}
+{
+  this->m_UseBrickedImageLayout = false;
+} // end Constructor
+
+
+/**
+ * ***************** SetInputImage ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::SetInputImage( const InputImageType * ptr )
+{
+  Superclass::SetInputImage( ptr );
+
+  /** Only the 2D and 3D code reads the bricked copy. */
+  const bool supported = ImageDimension == 2 || ImageDimension == 3;
+  if( this->m_UseBrickedImageLayout && supported && ptr )
+  {
+    this->m_BrickedImage.CopyFromImage( ptr );
+  }
+  else
+  {
+    this->m_BrickedImage.Clear();
+  }
+
+} // end SetInputImage()
+
+
+/**
+ * ***************** PrintSelf ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "UseBrickedImageLayout: "
+     << ( this->m_UseBrickedImageLayout ? "On" : "Off" ) << std::endl;
+} // end PrintSelf()
+
 
 /**
  * ***************** EvaluateDerivativeAtContinuousIndex ***********************
@@ -129,13 +175,28 @@ AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
   }
 
   /** Get the 4 corner values. */
-  const RealType val00 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 0 ];
-  const RealType val10 = inputImage->GetPixel( baseIndex );
-  --baseIndex[ 0 ]; ++baseIndex[ 1 ];
-  const RealType val01 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 0 ];
-  const RealType val11 = inputImage->GetPixel( baseIndex );
+  RealType val00, val10, val01, val11;
+  if( this->IsUsingBrickedImage() )
+  {
+    const InputPixelType * p = this->m_BrickedImage.GetBufferPointer()
+      + this->m_BrickedImage.ComputeOffset( baseIndex );
+    const OffsetValueType o0 = this->m_BrickedImage.GetNeighbourOffset( 0 );
+    const OffsetValueType o1 = this->m_BrickedImage.GetNeighbourOffset( 1 );
+    val00 = p[ 0 ];
+    val10 = p[ o0 ];
+    val01 = p[ o1 ];
+    val11 = p[ o0 + o1 ];
+  }
+  else
+  {
+    val00 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 0 ];
+    val10 = inputImage->GetPixel( baseIndex );
+    --baseIndex[ 0 ]; ++baseIndex[ 1 ];
+    val01 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 0 ];
+    val11 = inputImage->GetPixel( baseIndex );
+  }
 
   /** Interpolate to get the value. */
   value = static_cast< OutputType >(
@@ -214,21 +275,41 @@ AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
   }
 
   /** Get the 8 corner values. */
-  const RealType val000 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 0 ];
-  const RealType val100 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 1 ];
-  const RealType val110 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 2 ];
-  const RealType val111 = inputImage->GetPixel( baseIndex );
-  --baseIndex[ 1 ];
-  const RealType val101 = inputImage->GetPixel( baseIndex );
-  --baseIndex[ 0 ];
-  const RealType val001 = inputImage->GetPixel( baseIndex );
-  ++baseIndex[ 1 ];
-  const RealType val011 = inputImage->GetPixel( baseIndex );
-  --baseIndex[ 2 ];
-  const RealType val010 = inputImage->GetPixel( baseIndex );
+  RealType val000, val100, val010, val110, val001, val101, val011, val111;
+  if( this->IsUsingBrickedImage() )
+  {
+    const InputPixelType * p = this->m_BrickedImage.GetBufferPointer()
+      + this->m_BrickedImage.ComputeOffset( baseIndex );
+    const OffsetValueType o0 = this->m_BrickedImage.GetNeighbourOffset( 0 );
+    const OffsetValueType o1 = this->m_BrickedImage.GetNeighbourOffset( 1 );
+    const OffsetValueType o2 = this->m_BrickedImage.GetNeighbourOffset( 2 );
+    val000 = p[ 0 ];
+    val100 = p[ o0 ];
+    val010 = p[ o1 ];
+    val110 = p[ o0 + o1 ];
+    val001 = p[ o2 ];
+    val101 = p[ o0 + o2 ];
+    val011 = p[ o1 + o2 ];
+    val111 = p[ o0 + o1 + o2 ];
+  }
+  else
+  {
+    val000 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 0 ];
+    val100 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 1 ];
+    val110 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 2 ];
+    val111 = inputImage->GetPixel( baseIndex );
+    --baseIndex[ 1 ];
+    val101 = inputImage->GetPixel( baseIndex );
+    --baseIndex[ 0 ];
+    val001 = inputImage->GetPixel( baseIndex );
+    ++baseIndex[ 1 ];
+    val011 = inputImage->GetPixel( baseIndex );
+    --baseIndex[ 2 ];
+    val010 = inputImage->GetPixel( baseIndex );
+  }
 
   /** Interpolate to get the value. */
   value = static_cast< OutputType >(
@@ -269,6 +350,287 @@ AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
 } // end EvaluateValueAndDerivativeOptimized()
 
 
+/**
+ * ***************** AreInsideInterior ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+bool
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::AreInsideInterior( const unsigned int numberOfPoints,
+  const ContinuousIndexType * x ) const
+{
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+    {
+      const ContinuousIndexValueType xd  = x[ i ][ dim ];
+      const ContinuousIndexValueType end = static_cast< ContinuousIndexValueType >( this->m_EndIndex[ dim ] );
+
+      /** The negation also returns false for NaN. */
+      if( !( xd >= this->m_StartIndex[ dim ] && xd < end )
+        || Math::FloatAlmostEqual( xd, end ) )
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end AreInsideInterior()
+
+
+/**
+ * ***************** TransformLocalDerivativesToPhysical ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::TransformLocalDerivativesToPhysical( const unsigned int numberOfPoints,
+  CovariantVectorType * derivs ) const
+{
+  typedef typename InputImageType::DirectionType DirectionType;
+  typedef typename CovariantVectorType::ValueType DerivativeValueType;
+  const DirectionType & direction = this->GetInputImage()->GetDirection();
+
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    const CovariantVectorType localDerivative = derivs[ i ];
+    for( unsigned int row = 0; row < ImageDimension; ++row )
+    {
+      double sum = 0.0;
+      for( unsigned int column = 0; column < ImageDimension; ++column )
+      {
+        sum += direction[ row ][ column ] * localDerivative[ column ];
+      }
+      derivs[ i ][ row ] = static_cast< DerivativeValueType >( sum );
+    }
+  }
+
+} // end TransformLocalDerivativesToPhysical()
+
+
+/**
+ * ***************** EvaluateValuesAndDerivativesOptimized ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::EvaluateValuesAndDerivativesOptimized(
+  const Dispatch< 2 > &,
+  const unsigned int numberOfPoints,
+  const ContinuousIndexType * x,
+  OutputType * values,
+  CovariantVectorType * derivs ) const
+{
+  // Get some handles
+  const InputImageType *        inputImage  = this->GetInputImage();
+  const InputImageSpacingType & spacing     = inputImage->GetSpacing();
+  const bool                    bricked     = this->IsUsingBrickedImage();
+  const InputPixelType *        buffer      = bricked
+    ? this->m_BrickedImage.GetBufferPointer() : inputImage->GetBufferPointer();
+  const OffsetValueType *       offsetTable = inputImage->GetOffsetTable();
+  const IndexType               bufferStart = inputImage->GetBufferedRegion().GetIndex();
+  const OffsetValueType         o0          = bricked ? this->m_BrickedImage.GetNeighbourOffset( 0 ) : 1;
+  const OffsetValueType         o1          = bricked ? this->m_BrickedImage.GetNeighbourOffset( 1 ) : offsetTable[ 1 ];
+
+  double deriv_sign[ ImageDimension ];
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    deriv_sign[ dim ] = 1.0 / spacing[ dim ];
+  }
+
+  for( unsigned int chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += ChunkSize )
+  {
+    const unsigned int          remaining = numberOfPoints - chunkBegin;
+    const unsigned int          n         = std::min( remaining, static_cast< unsigned int >( ChunkSize ) );
+    const ContinuousIndexType * xc        = x + chunkBegin;
+    OutputType *                vc        = values + chunkBegin;
+    CovariantVectorType *       dc        = derivs + chunkBegin;
+
+    /** Chunks that need boundary handling are evaluated point by point. */
+    if( !this->AreInsideInterior( n, xc ) )
+    {
+      for( unsigned int i = 0; i < n; ++i )
+      {
+        this->EvaluateValueAndDerivativeOptimized( Dispatch< 2 >(), xc[ i ], vc[ i ], dc[ i ] );
+      }
+      continue;
+    }
+
+    /** Compute the buffer offsets of the base indices and the distances. */
+    OffsetValueType offsets[ ChunkSize ];
+    double          dist[ ImageDimension ][ ChunkSize ];
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      IndexType       baseIndex;
+      OffsetValueType offset = 0;
+      for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+      {
+        baseIndex[ dim ] = Math::Floor< IndexValueType >( xc[ i ][ dim ] );
+        dist[ dim ][ i ] = xc[ i ][ dim ] - static_cast< double >( baseIndex[ dim ] );
+        offset          += ( baseIndex[ dim ] - bufferStart[ dim ] ) * offsetTable[ dim ];
+      }
+      offsets[ i ] = bricked ? this->m_BrickedImage.ComputeOffset( baseIndex ) : offset;
+    }
+
+    /** Interpolate, exactly like EvaluateValueAndDerivativeOptimized(). */
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      const InputPixelType * p     = buffer + offsets[ i ];
+      const RealType         val00 = p[ 0 ];
+      const RealType         val10 = p[ o0 ];
+      const RealType         val01 = p[ o1 ];
+      const RealType         val11 = p[ o0 + o1 ];
+
+      const double dist0 = dist[ 0 ][ i ];
+      const double dist1 = dist[ 1 ][ i ];
+      const double dinv0 = 1.0 - dist0;
+      const double dinv1 = 1.0 - dist1;
+
+      vc[ i ] = static_cast< OutputType >(
+        val00 * dinv0 * dinv1
+        + val10 * dist0 * dinv1
+        + val01 * dinv0 * dist1
+        + val11 * dist0 * dist1 );
+
+      dc[ i ][ 0 ] = deriv_sign[ 0 ] * ( dinv1 * ( val10 - val00 ) + dist1 * ( val11 - val01 ) );
+      dc[ i ][ 1 ] = deriv_sign[ 1 ] * ( dinv0 * ( val01 - val00 ) + dist0 * ( val11 - val10 ) );
+    }
+
+    /** Take direction cosines into account. */
+    this->TransformLocalDerivativesToPhysical( n, dc );
+  }
+
+} // end EvaluateValuesAndDerivativesOptimized()
+
+
+/**
+ * ***************** EvaluateValuesAndDerivativesOptimized ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::EvaluateValuesAndDerivativesOptimized(
+  const Dispatch< 3 > &,
+  const unsigned int numberOfPoints,
+  const ContinuousIndexType * x,
+  OutputType * values,
+  CovariantVectorType * derivs ) const
+{
+  // Get some handles
+  const InputImageType *        inputImage  = this->GetInputImage();
+  const InputImageSpacingType & spacing     = inputImage->GetSpacing();
+  const bool                    bricked     = this->IsUsingBrickedImage();
+  const InputPixelType *        buffer      = bricked
+    ? this->m_BrickedImage.GetBufferPointer() : inputImage->GetBufferPointer();
+  const OffsetValueType *       offsetTable = inputImage->GetOffsetTable();
+  const IndexType               bufferStart = inputImage->GetBufferedRegion().GetIndex();
+  const OffsetValueType         o0          = bricked ? this->m_BrickedImage.GetNeighbourOffset( 0 ) : 1;
+  const OffsetValueType         o1          = bricked ? this->m_BrickedImage.GetNeighbourOffset( 1 ) : offsetTable[ 1 ];
+  const OffsetValueType         o2          = bricked ? this->m_BrickedImage.GetNeighbourOffset( 2 ) : offsetTable[ 2 ];
+
+  double deriv_sign[ ImageDimension ];
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    deriv_sign[ dim ] = 1.0 / spacing[ dim ];
+  }
+
+  for( unsigned int chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += ChunkSize )
+  {
+    const unsigned int          remaining = numberOfPoints - chunkBegin;
+    const unsigned int          n         = std::min( remaining, static_cast< unsigned int >( ChunkSize ) );
+    const ContinuousIndexType * xc        = x + chunkBegin;
+    OutputType *                vc        = values + chunkBegin;
+    CovariantVectorType *       dc        = derivs + chunkBegin;
+
+    /** Chunks that need boundary handling are evaluated point by point. */
+    if( !this->AreInsideInterior( n, xc ) )
+    {
+      for( unsigned int i = 0; i < n; ++i )
+      {
+        this->EvaluateValueAndDerivativeOptimized( Dispatch< 3 >(), xc[ i ], vc[ i ], dc[ i ] );
+      }
+      continue;
+    }
+
+    /** Compute the buffer offsets of the base indices and the distances. */
+    OffsetValueType offsets[ ChunkSize ];
+    double          dist[ ImageDimension ][ ChunkSize ];
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      IndexType       baseIndex;
+      OffsetValueType offset = 0;
+      for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+      {
+        baseIndex[ dim ] = Math::Floor< IndexValueType >( xc[ i ][ dim ] );
+        dist[ dim ][ i ] = xc[ i ][ dim ] - static_cast< double >( baseIndex[ dim ] );
+        offset          += ( baseIndex[ dim ] - bufferStart[ dim ] ) * offsetTable[ dim ];
+      }
+      offsets[ i ] = bricked ? this->m_BrickedImage.ComputeOffset( baseIndex ) : offset;
+    }
+
+    /** Interpolate, exactly like EvaluateValueAndDerivativeOptimized(). */
+    for( unsigned int i = 0; i < n; ++i )
+    {
+      const InputPixelType * p      = buffer + offsets[ i ];
+      const RealType         val000 = p[ 0 ];
+      const RealType         val100 = p[ o0 ];
+      const RealType         val010 = p[ o1 ];
+      const RealType         val110 = p[ o0 + o1 ];
+      const RealType         val001 = p[ o2 ];
+      const RealType         val101 = p[ o0 + o2 ];
+      const RealType         val011 = p[ o1 + o2 ];
+      const RealType         val111 = p[ o0 + o1 + o2 ];
+
+      const double dist0 = dist[ 0 ][ i ];
+      const double dist1 = dist[ 1 ][ i ];
+      const double dist2 = dist[ 2 ][ i ];
+      const double dinv0 = 1.0 - dist0;
+      const double dinv1 = 1.0 - dist1;
+      const double dinv2 = 1.0 - dist2;
+
+      vc[ i ] = static_cast< OutputType >(
+        val000 * dinv0 * dinv1 * dinv2
+        + val100 * dist0 * dinv1 * dinv2
+        + val010 * dinv0 * dist1 * dinv2
+        + val001 * dinv0 * dinv1 * dist2
+        + val110 * dist0 * dist1 * dinv2
+        + val011 * dinv0 * dist1 * dist2
+        + val101 * dist0 * dinv1 * dist2
+        + val111 * dist0 * dist1 * dist2 );
+
+      dc[ i ][ 0 ] = deriv_sign[ 0 ]
+        * ( dinv1 * dinv2 * ( val100 - val000 )
+        + dist1 * dinv2 * ( val110 - val010 )
+        + dinv1 * dist2 * ( val101 - val001 )
+        + dist1 * dist2 * ( val111 - val011 )
+        );
+      dc[ i ][ 1 ] = deriv_sign[ 1 ]
+        * ( dinv0 * dinv2 * ( val010 - val000 )
+        + dist0 * dinv2 * ( val110 - val100 )
+        + dinv0 * dist2 * ( val011 - val001 )
+        + dist0 * dist2 * ( val111 - val101 )
+        );
+      dc[ i ][ 2 ] = deriv_sign[ 2 ]
+        * ( dinv0 * dinv1 * ( val001 - val000 )
+        + dist0 * dinv1 * ( val101 - val100 )
+        + dinv0 * dist1 * ( val011 - val010 )
+        + dist0 * dist1 * ( val111 - val110 )
+        );
+    }
+
+    /** Take direction cosines into account. */
+    this->TransformLocalDerivativesToPhysical( n, dc );
+  }
+
+} // end EvaluateValuesAndDerivativesOptimized()
+
+
 } // end namespace itk
 
 #endif
@@ -36,6 +36,8 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include "itkNumericTraits.h"
+#include "itkPersistentThreadPool.h"
 #include "vnl/vnl_math.h"
 
 // Put the helper class in an anonymous namespace so that it is not
@@ -129,6 +131,25 @@ public:
    */
   bool IntegrateAboveThreshold( double & integral, double threshold );
 
+  /** \brief
+   * Set the maxima of the blocks of voxels, used to skip the parts of the
+   * ray that are at or below the threshold.
+   *
+   * \param maxima          The block maxima, x fastest, or NULL.
+   * \param numberOfBlocks  The number of blocks in x, y and z.
+   * \param blockSize       The size of a block in voxels.
+   */
+  void SetBlockMaxima( const double * maxima, const int * numberOfBlocks, int blockSize )
+  {
+    m_BlockMaxima = maxima;
+    m_BlockSize   = blockSize;
+    for( unsigned int i = 0; i < 3; i++ )
+    {
+      m_NumberOfBlocks[ i ] = numberOfBlocks[ i ];
+    }
+  }
+
+
   /** \brief
    * Increment each of the intensities of the 4 planar voxels
    * surrounding the current ray point.
@@ -195,6 +216,18 @@ protected:
   /// Increment the voxel pointers surrounding the current point on the ray.
   void IncrementVoxelPointers( void );
 
+  /**
+   * Return the block of the current four voxels if all of its voxels
+   * are at or below the threshold, and -1 otherwise.
+   */
+  long GetEmptyBlock( double threshold ) const;
+
+  /**
+   * Advance the ray until it leaves the given block, without computing
+   * the intensities, and return the number of ray points skipped.
+   */
+  int SkipBlock( long block );
+
   /// Record volume dimensions and resolution
   void RecordVolumeDimensions( void );
 
@@ -329,6 +362,15 @@ protected:
   /// The direction of the ray
   double m_RayDirectionInMM[ 3 ];
 
+  /// The maximum intensity of each block of voxels, or NULL.
+  const double * m_BlockMaxima;
+
+  /// The number of blocks in each direction.
+  int m_NumberOfBlocks[ 3 ];
+
+  /// The size of the blocks in voxels.
+  int m_BlockSize;
+
 };
 
 /* -----------------------------------------------------------------------
@@ -1314,6 +1356,88 @@ RayCastHelper< TInputImage, TCoordRep >
 }
 
 
+/* -----------------------------------------------------------------------
+   GetEmptyBlock() - Get the current block if it is below the threshold
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+long
+RayCastHelper< TInputImage, TCoordRep >
+::GetEmptyBlock( double threshold ) const
+{
+  long block = 0;
+  for( int i = 2; i >= 0; i-- )
+  {
+    const int index = m_RayIntersectionVoxelIndex[ i ];
+    if( index < 0 )
+    {
+      return -1;
+    }
+    const int blockIndex = index / m_BlockSize;
+    if( blockIndex >= m_NumberOfBlocks[ i ] )
+    {
+      return -1;
+    }
+    block = block * m_NumberOfBlocks[ i ] + blockIndex;
+  }
+
+  return m_BlockMaxima[ block ] <= threshold ? block : -1;
+}
+
+
+/* -----------------------------------------------------------------------
+   SkipBlock() - Advance the ray to the next block
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+int
+RayCastHelper< TInputImage, TCoordRep >
+::SkipBlock( long block )
+{
+  const double before[ 3 ] = { m_Position3Dvox[ 0 ], m_Position3Dvox[ 1 ], m_Position3Dvox[ 2 ] };
+  const int    blockIndex[ 3 ] = {
+    static_cast< int >( block % m_NumberOfBlocks[ 0 ] ),
+    static_cast< int >( ( block / m_NumberOfBlocks[ 0 ] ) % m_NumberOfBlocks[ 1 ] ),
+    static_cast< int >( block / m_NumberOfBlocks[ 0 ] / m_NumberOfBlocks[ 1 ] )
+  };
+
+  /** Step along the ray in the same way as IncrementVoxelPointers(), so that
+   * the positions are exactly the same as without skipping.
+   */
+  int delta[ 3 ] = { 0, 0, 0 };
+  int skipped    = 0;
+  bool inside    = true;
+  while( inside && m_NumVoxelPlanesTraversed + skipped < m_TotalRayVoxelPlanes )
+  {
+    for( int i = 0; i < 3; i++ )
+    {
+      m_Position3Dvox[ i ] += m_VoxelIncrement[ i ];
+      delta[ i ]            = ( (int)m_Position3Dvox[ i ] ) - ( (int)before[ i ] );
+      const int index = m_RayIntersectionVoxelIndex[ i ] + delta[ i ];
+      if( index < 0 || index / m_BlockSize != blockIndex[ i ] )
+      {
+        inside = false;
+      }
+    }
+    skipped++;
+  }
+
+  m_RayIntersectionVoxelIndex[ 0 ] += delta[ 0 ];
+  m_RayIntersectionVoxelIndex[ 1 ] += delta[ 1 ];
+  m_RayIntersectionVoxelIndex[ 2 ] += delta[ 2 ];
+
+  int totalRayVoxelPlanes
+    = delta[ 0 ] + delta[ 1 ] * m_NumberOfVoxelsInX + delta[ 2 ] * m_NumberOfVoxelsInX * m_NumberOfVoxelsInY;
+
+  m_RayIntersectionVoxels[ 0 ] += totalRayVoxelPlanes;
+  m_RayIntersectionVoxels[ 1 ] += totalRayVoxelPlanes;
+  m_RayIntersectionVoxels[ 2 ] += totalRayVoxelPlanes;
+  m_RayIntersectionVoxels[ 3 ] += totalRayVoxelPlanes;
+
+  return skipped;
+}
+
+
 /* -----------------------------------------------------------------------
    GetCurrentIntensity() - Get the intensity of the current ray point.
    ----------------------------------------------------------------------- */
@@ -1421,6 +1545,17 @@ RayCastHelper< TInputImage, TCoordRep >
     m_NumVoxelPlanesTraversed < m_TotalRayVoxelPlanes;
     m_NumVoxelPlanesTraversed++ )
   {
+    /* Skip the blocks in which no voxel is above the threshold. */
+    if( m_BlockMaxima != NULL )
+    {
+      const long block = this->GetEmptyBlock( threshold );
+      if( block >= 0 )
+      {
+        m_NumVoxelPlanesTraversed += this->SkipBlock( block ) - 1;
+        continue;
+      }
+    }
+
     intensity = this->GetCurrentIntensity();
 
     if( intensity > threshold )
@@ -1494,6 +1629,13 @@ RayCastHelper< TInputImage, TCoordRep >
   {
     m_RayIntersectionVoxelIndex[ i ] = 0;
   }
+
+  m_BlockMaxima = NULL;
+  m_BlockSize   = 1;
+  for( i = 0; i < 3; i++ )
+  {
+    m_NumberOfBlocks[ i ] = 0;
+  }
 }
 
 
@@ -1524,6 +1666,141 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   m_FocalPoint[ 0 ] = 0.;
   m_FocalPoint[ 1 ] = 0.;
   m_FocalPoint[ 2 ] = 0.;
+
+  m_UseEmptySpaceSkipping = false;
+  m_EmptySpaceBlockSize   = 8;
+  m_NumberOfBlocks[ 0 ]   = 0;
+  m_NumberOfBlocks[ 1 ]   = 0;
+  m_NumberOfBlocks[ 2 ]   = 0;
+}
+
+
+/* -----------------------------------------------------------------------
+   SetInputImage
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::SetInputImage( const InputImageType * ptr )
+{
+  this->Superclass::SetInputImage( ptr );
+  this->ComputeBlockMaxima();
+}
+
+
+/* -----------------------------------------------------------------------
+   SetUseEmptySpaceSkipping
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::SetUseEmptySpaceSkipping( bool _arg )
+{
+  if( this->m_UseEmptySpaceSkipping != _arg )
+  {
+    this->m_UseEmptySpaceSkipping = _arg;
+    this->ComputeBlockMaxima();
+    this->Modified();
+  }
+}
+
+
+/* -----------------------------------------------------------------------
+   SetEmptySpaceBlockSize
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::SetEmptySpaceBlockSize( unsigned int _arg )
+{
+  _arg = _arg > 0 ? _arg : 1;
+  if( this->m_EmptySpaceBlockSize != _arg )
+  {
+    this->m_EmptySpaceBlockSize = _arg;
+    this->ComputeBlockMaxima();
+    this->Modified();
+  }
+}
+
+
+/* -----------------------------------------------------------------------
+   ComputeBlockMaxima
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::ComputeBlockMaxima( void )
+{
+  this->m_BlockMaxima.clear();
+  if( !this->m_UseEmptySpaceSkipping || this->m_Image.IsNull() )
+  {
+    return;
+  }
+
+  /** Each block also covers the first voxels of the next blocks, because
+   * the ray interpolates between a voxel and its neighbour.
+   */
+  const SizeType size = this->m_Image->GetBufferedRegion().GetSize();
+  SizeValueType  numberOfBlocks = 1;
+  for( unsigned int i = 0; i < 3; i++ )
+  {
+    m_NumberOfBlocks[ i ] = static_cast< int >(
+      ( size[ i ] + m_EmptySpaceBlockSize - 1 ) / m_EmptySpaceBlockSize );
+    numberOfBlocks *= m_NumberOfBlocks[ i ];
+  }
+  this->m_BlockMaxima.resize( numberOfBlocks );
+
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    numberOfBlocks, 0, Self::ComputeBlockMaximaRangeFunction, this );
+}
+
+
+/* -----------------------------------------------------------------------
+   ComputeBlockMaximaRangeFunction
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::ComputeBlockMaximaRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  Self *            self   = static_cast< Self * >( userData );
+  const int         bs     = static_cast< int >( self->m_EmptySpaceBlockSize );
+  const int * const nb     = self->m_NumberOfBlocks;
+  const SizeType    size   = self->m_Image->GetBufferedRegion().GetSize();
+  const PixelType * buffer = self->m_Image->GetBufferPointer();
+  const int         nx     = static_cast< int >( size[ 0 ] );
+  const int         ny     = static_cast< int >( size[ 1 ] );
+  const int         nz     = static_cast< int >( size[ 2 ] );
+
+  for( SizeValueType block = begin; block < end; ++block )
+  {
+    const int x0 = static_cast< int >( block % nb[ 0 ] ) * bs;
+    const int y0 = static_cast< int >( ( block / nb[ 0 ] ) % nb[ 1 ] ) * bs;
+    const int z0 = static_cast< int >( block / nb[ 0 ] / nb[ 1 ] ) * bs;
+    const int x1 = vnl_math_min( x0 + bs, nx - 1 );
+    const int y1 = vnl_math_min( y0 + bs, ny - 1 );
+    const int z1 = vnl_math_min( z0 + bs, nz - 1 );
+
+    double maximum = NumericTraits< double >::NonpositiveMin();
+    for( int z = z0; z <= z1; z++ )
+    {
+      for( int y = y0; y <= y1; y++ )
+      {
+        const PixelType * voxel = buffer + ( static_cast< OffsetValueType >( z ) * ny + y ) * nx + x0;
+        for( int x = x0; x <= x1; x++, voxel++ )
+        {
+          maximum = vnl_math_max( maximum, static_cast< double >( *voxel ) );
+        }
+      }
+    }
+    self->m_BlockMaxima[ block ] = maximum;
+  }
 }
 
 
@@ -1542,6 +1819,8 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   os << indent << "FocalPoint: " << m_FocalPoint << std::endl;
   os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
+  os << indent << "UseEmptySpaceSkipping: " << m_UseEmptySpaceSkipping << std::endl;
+  os << indent << "EmptySpaceBlockSize: " << m_EmptySpaceBlockSize << std::endl;
 
 }
 
@@ -1567,6 +1846,11 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   ray.SetImage( this->m_Image );
   ray.ZeroState();
   ray.Initialise();
+  if( !this->m_BlockMaxima.empty() )
+  {
+    ray.SetBlockMaxima( &this->m_BlockMaxima[ 0 ], this->m_NumberOfBlocks,
+      static_cast< int >( this->m_EmptySpaceBlockSize ) );
+  }
 
   ray.SetRay( point, direction );
   ray.IntegrateAboveThreshold( integral, m_Threshold );
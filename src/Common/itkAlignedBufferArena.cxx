@@ -0,0 +1,491 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAlignedBufferArena_cxx
+#define __itkAlignedBufferArena_cxx
+
+#include "itkAlignedBufferArena.h"
+#include "itkMacro.h"
+
+#include <cstdlib>
+
+#if defined( _WIN32 )
+#include <malloc.h>
+#elif defined( __linux__ )
+#include <sys/mman.h>
+#endif
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+AlignedBufferArena::Pointer
+AlignedBufferArena
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+AlignedBufferArena
+::AlignedBufferArena()
+{
+  this->m_NumberOfAllocatedBytes = 0;
+  this->m_NumberOfCachedBytes    = 0;
+  this->m_MaximumCachedBytes     = static_cast< SizeValueType >( 1 ) << 30;
+  this->m_HugePages              = NoHugePages;
+
+} // end Constructor
+
+
+/**
+ * ****************** Destructor *********************************
+ */
+
+AlignedBufferArena
+::~AlignedBufferArena()
+{
+  /** Blocks that are still in use are left alone; their owners may be
+   * destroyed after the arena, at program exit.
+   */
+  this->FreeCachedBlocks();
+
+} // end Destructor
+
+
+/**
+ * ****************** Allocate *********************************
+ */
+
+void *
+AlignedBufferArena
+::Allocate( SizeValueType numberOfBytes )
+{
+  /** Round up to a cache line, or to a huge page for large blocks. */
+  const SizeValueType roundTo = numberOfBytes >= HugePageSize
+    ? static_cast< SizeValueType >( HugePageSize )
+    : static_cast< SizeValueType >( Alignment );
+  const SizeValueType size
+    = ( ( numberOfBytes > 0 ? numberOfBytes : 1 ) + roundTo - 1 ) / roundTo * roundTo;
+
+  this->m_Mutex.Lock();
+
+  /** Reuse the smallest cached block that is large enough, if it is at
+   * most 25% larger than needed.
+   */
+  BlockType block;
+  bool      found = false;
+  CachedBlockMapType::iterator it = this->m_CachedBlocks.lower_bound( size );
+  if( it != this->m_CachedBlocks.end() && it->first <= size + size / 4 )
+  {
+    block = it->second;
+    this->m_NumberOfCachedBytes -= block.m_NumberOfBytes;
+    this->m_CachedBlocks.erase( it );
+    found = true;
+  }
+
+  /** Otherwise get a new block; when that fails, free the cache and try
+   * once more.
+   */
+  if( !found )
+  {
+    found = this->AllocateBlock( size, block );
+    if( !found && !this->m_CachedBlocks.empty() )
+    {
+      this->FreeCachedBlocks();
+      found = this->AllocateBlock( size, block );
+    }
+  }
+
+  if( found )
+  {
+    this->m_LiveBlocks[ block.m_Address ] = block;
+    this->m_NumberOfAllocatedBytes       += block.m_NumberOfBytes;
+  }
+
+  this->m_Mutex.Unlock();
+
+  return found ? block.m_Address : 0;
+
+} // end Allocate()
+
+
+/**
+ * ****************** Release *********************************
+ */
+
+bool
+AlignedBufferArena
+::Release( void * buffer )
+{
+  if( buffer == 0 )
+  {
+    return true;
+  }
+
+  this->m_Mutex.Lock();
+
+  LiveBlockMapType::iterator it = this->m_LiveBlocks.find( buffer );
+  if( it == this->m_LiveBlocks.end() )
+  {
+    this->m_Mutex.Unlock();
+    return false;
+  }
+
+  const BlockType block = it->second;
+  this->m_LiveBlocks.erase( it );
+  this->m_NumberOfAllocatedBytes -= block.m_NumberOfBytes;
+
+  /** Keep the block for reuse, if it fits in the cache. */
+  if( this->m_NumberOfCachedBytes + block.m_NumberOfBytes <= this->m_MaximumCachedBytes )
+  {
+    this->m_CachedBlocks.insert( CachedBlockMapType::value_type( block.m_NumberOfBytes, block ) );
+    this->m_NumberOfCachedBytes += block.m_NumberOfBytes;
+  }
+  else
+  {
+    Self::FreeBlock( block );
+  }
+
+  this->m_Mutex.Unlock();
+
+  return true;
+
+} // end Release()
+
+
+/**
+ * ****************** ReleaseCachedBuffers *********************************
+ */
+
+void
+AlignedBufferArena
+::ReleaseCachedBuffers( void )
+{
+  this->m_Mutex.Lock();
+  this->FreeCachedBlocks();
+  this->m_Mutex.Unlock();
+
+} // end ReleaseCachedBuffers()
+
+
+/**
+ * ****************** SetHugePages *********************************
+ */
+
+void
+AlignedBufferArena
+::SetHugePages( HugePagesType hugePages )
+{
+  this->m_Mutex.Lock();
+  const bool modified = this->m_HugePages != hugePages;
+  if( modified )
+  {
+    /** The cached blocks have the old backing. */
+    this->m_HugePages = hugePages;
+    this->FreeCachedBlocks();
+  }
+  this->m_Mutex.Unlock();
+
+  if( modified )
+  {
+    this->Modified();
+  }
+
+} // end SetHugePages()
+
+
+/**
+ * ****************** SetHugePages *********************************
+ */
+
+bool
+AlignedBufferArena
+::SetHugePages( const std::string & hugePages )
+{
+  if( hugePages == "off" )
+  {
+    this->SetHugePages( NoHugePages );
+  }
+  else if( hugePages == "transparent" )
+  {
+    this->SetHugePages( TransparentHugePages );
+  }
+  else if( hugePages == "explicit" )
+  {
+    this->SetHugePages( ExplicitHugePages );
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+
+} // end SetHugePages()
+
+
+/**
+ * ****************** SetMaximumCachedBytes *********************************
+ */
+
+void
+AlignedBufferArena
+::SetMaximumCachedBytes( SizeValueType maximumCachedBytes )
+{
+  this->m_Mutex.Lock();
+  const bool modified = this->m_MaximumCachedBytes != maximumCachedBytes;
+  this->m_MaximumCachedBytes = maximumCachedBytes;
+  if( this->m_NumberOfCachedBytes > maximumCachedBytes )
+  {
+    this->FreeCachedBlocks();
+  }
+  this->m_Mutex.Unlock();
+
+  if( modified )
+  {
+    this->Modified();
+  }
+
+} // end SetMaximumCachedBytes()
+
+
+/**
+ * ****************** GetNumberOfAllocatedBytes *********************************
+ */
+
+SizeValueType
+AlignedBufferArena
+::GetNumberOfAllocatedBytes( void ) const
+{
+  this->m_Mutex.Lock();
+  const SizeValueType numberOfBytes = this->m_NumberOfAllocatedBytes;
+  this->m_Mutex.Unlock();
+  return numberOfBytes;
+
+} // end GetNumberOfAllocatedBytes()
+
+
+/**
+ * ****************** GetNumberOfCachedBytes *********************************
+ */
+
+SizeValueType
+AlignedBufferArena
+::GetNumberOfCachedBytes( void ) const
+{
+  this->m_Mutex.Lock();
+  const SizeValueType numberOfBytes = this->m_NumberOfCachedBytes;
+  this->m_Mutex.Unlock();
+  return numberOfBytes;
+
+} // end GetNumberOfCachedBytes()
+
+
+/**
+ * ****************** AllocateBlock *********************************
+ */
+
+bool
+AlignedBufferArena
+::AllocateBlock( SizeValueType numberOfBytes, BlockType & block ) const
+{
+  block.m_Address       = 0;
+  block.m_NumberOfBytes = numberOfBytes;
+  block.m_IsMapped      = false;
+
+  const bool large = numberOfBytes >= HugePageSize;
+
+#if defined( __linux__ ) && defined( MAP_HUGETLB )
+  /** Map the block from the reserved huge pages. */
+  if( large && this->m_HugePages == ExplicitHugePages )
+  {
+    void * address = mmap( 0, numberOfBytes, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+    if( address != MAP_FAILED )
+    {
+      block.m_Address  = address;
+      block.m_IsMapped = true;
+      return true;
+    }
+  }
+#endif
+
+#if defined( _WIN32 )
+  block.m_Address = _aligned_malloc( numberOfBytes, Alignment );
+#else
+  /** Align large blocks at a huge page, so that the kernel can back them
+   * by transparent huge pages.
+   */
+  const SizeValueType alignment = large && this->m_HugePages != NoHugePages
+    ? static_cast< SizeValueType >( HugePageSize )
+    : static_cast< SizeValueType >( Alignment );
+  if( posix_memalign( &block.m_Address, alignment, numberOfBytes ) != 0 )
+  {
+    block.m_Address = 0;
+  }
+#if defined( __linux__ ) && defined( MADV_HUGEPAGE )
+  if( block.m_Address && large && this->m_HugePages != NoHugePages )
+  {
+    madvise( block.m_Address, numberOfBytes, MADV_HUGEPAGE );
+  }
+#endif
+#endif
+
+  return block.m_Address != 0;
+
+} // end AllocateBlock()
+
+
+/**
+ * ****************** FreeBlock *********************************
+ */
+
+void
+AlignedBufferArena
+::FreeBlock( const BlockType & block )
+{
+#if defined( __linux__ ) && defined( MAP_HUGETLB )
+  if( block.m_IsMapped )
+  {
+    munmap( block.m_Address, block.m_NumberOfBytes );
+    return;
+  }
+#endif
+
+#if defined( _WIN32 )
+  _aligned_free( block.m_Address );
+#else
+  free( block.m_Address );
+#endif
+
+} // end FreeBlock()
+
+
+/**
+ * ****************** FreeCachedBlocks *********************************
+ */
+
+void
+AlignedBufferArena
+::FreeCachedBlocks( void )
+{
+  for( CachedBlockMapType::iterator it = this->m_CachedBlocks.begin();
+    it != this->m_CachedBlocks.end(); ++it )
+  {
+    Self::FreeBlock( it->second );
+  }
+  this->m_CachedBlocks.clear();
+  this->m_NumberOfCachedBytes = 0;
+
+} // end FreeCachedBlocks()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+AlignedBufferArena
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "HugePages: " << this->m_HugePages << std::endl;
+  os << indent << "MaximumCachedBytes: " << this->m_MaximumCachedBytes << std::endl;
+  os << indent << "NumberOfAllocatedBytes: " << this->GetNumberOfAllocatedBytes() << std::endl;
+  os << indent << "NumberOfCachedBytes: " << this->GetNumberOfCachedBytes() << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** AlignedArenaBuffer::Resize *********************************
+ */
+
+void *
+AlignedArenaBuffer
+::Resize( SizeValueType numberOfBytes )
+{
+  if( this->m_Pointer && numberOfBytes == this->m_NumberOfBytes )
+  {
+    return this->m_Pointer;
+  }
+
+  this->Release();
+  if( numberOfBytes == 0 )
+  {
+    return 0;
+  }
+
+  if( this->m_Arena.IsNull() )
+  {
+    this->m_Arena = AlignedBufferArena::GetInstance();
+  }
+  this->m_Pointer = this->m_Arena->Allocate( numberOfBytes );
+  if( this->m_Pointer == 0 )
+  {
+    throw MemoryAllocationError( __FILE__, __LINE__,
+      "Failed to allocate memory from the aligned buffer arena.",
+      "AlignedArenaBuffer::Resize" );
+  }
+  this->m_NumberOfBytes = numberOfBytes;
+
+  return this->m_Pointer;
+
+} // end Resize()
+
+
+/**
+ * ****************** AlignedArenaBuffer::Release *********************************
+ */
+
+void
+AlignedArenaBuffer
+::Release( void )
+{
+  if( this->m_Pointer )
+  {
+    this->m_Arena->Release( this->m_Pointer );
+  }
+  this->m_Pointer       = 0;
+  this->m_NumberOfBytes = 0;
+
+} // end Release()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkAlignedBufferArena_cxx
@@ -0,0 +1,212 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAlignedBufferArena_h
+#define __itkAlignedBufferArena_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
+#include <string>
+
+namespace itk
+{
+
+/** \class AlignedBufferArena
+ *
+ * \brief An elastix-wide arena of aligned, reusable memory blocks for large
+ * buffers: image buffers, sample arrays and per-thread derivatives.
+ *
+ * Every block is aligned at Alignment (64) bytes, a cache line. Released
+ * blocks are not returned to the system, but cached, and handed out again
+ * for a later request of about the same size. In elastix the same sizes are
+ * requested again in every resolution and in every run of a batch, so that
+ * the blocks are reused instead of fragmenting the heap. A block is reused
+ * for a request when it is at most 25% larger. The cache is bounded by
+ * MaximumCachedBytes; blocks that do not fit are freed.
+ *
+ * Blocks of at least HugePageSize (2 MB) are rounded up to a multiple of it,
+ * and can be backed by huge pages, to reduce the TLB misses of random access
+ * into large images:
+ * \li NoHugePages: the default.
+ * \li TransparentHugePages: the blocks are aligned at HugePageSize and
+ *   advised as huge pages (madvise MADV_HUGEPAGE), so that the kernel backs
+ *   them by transparent huge pages if it can.
+ * \li ExplicitHugePages: the blocks are mapped from the reserved huge pages
+ *   (mmap MAP_HUGETLB), and fall back to transparent huge pages when none
+ *   are available.
+ * Huge pages are only supported on Linux; elsewhere the setting is ignored.
+ *
+ * The arena is a singleton, obtained via GetInstance(), and is thread safe.
+ * Usually it is not used directly, but through AlignedArenaBuffer or
+ * ArenaImportImageContainer.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class AlignedBufferArena : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef AlignedBufferArena         Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( AlignedBufferArena, Object );
+
+  /** The backing of the large blocks. */
+  typedef enum {
+    NoHugePages,
+    TransparentHugePages,
+    ExplicitHugePages
+  } HugePagesType;
+
+  /** The alignment of all blocks, and the size of a huge page. */
+  itkStaticConstMacro( Alignment, unsigned int, 64 );
+  itkStaticConstMacro( HugePageSize, unsigned int, 2097152 );
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** Get a block of at least numberOfBytes, aligned at Alignment bytes.
+   * The contents are undefined. Returns 0 if the memory is exhausted.
+   */
+  void * Allocate( SizeValueType numberOfBytes );
+
+  /** Return a block to the arena. Returns false, and does nothing, if the
+   * buffer was not allocated by the arena.
+   */
+  bool Release( void * buffer );
+
+  /** Free all cached blocks. */
+  void ReleaseCachedBuffers( void );
+
+  /** Set/Get the backing of the large blocks. Only affects blocks that are
+   * allocated afterwards. Default: NoHugePages.
+   */
+  virtual void SetHugePages( HugePagesType hugePages );
+  itkGetConstMacro( HugePages, HugePagesType );
+
+  /** Set the backing by name: "off", "transparent" or "explicit".
+   * Returns false for an unknown name.
+   */
+  bool SetHugePages( const std::string & hugePages );
+
+  /** Set/Get the maximum number of bytes of the cached blocks. The default
+   * is 1 GB. Zero disables the reuse of blocks.
+   */
+  virtual void SetMaximumCachedBytes( SizeValueType maximumCachedBytes );
+  itkGetConstMacro( MaximumCachedBytes, SizeValueType );
+
+  /** Get the number of bytes of the blocks that are in use. */
+  SizeValueType GetNumberOfAllocatedBytes( void ) const;
+
+  /** Get the number of bytes of the cached blocks. */
+  SizeValueType GetNumberOfCachedBytes( void ) const;
+
+protected:
+
+  AlignedBufferArena();
+  virtual ~AlignedBufferArena();
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  AlignedBufferArena( const Self & ); // purposely not implemented
+  void operator=( const Self & );     // purposely not implemented
+
+  /** A block, and how it was obtained from the system. */
+  struct BlockType
+  {
+    void *        m_Address;
+    SizeValueType m_NumberOfBytes;
+    bool          m_IsMapped;
+  };
+
+  typedef std::map< void *, BlockType >             LiveBlockMapType;
+  typedef std::multimap< SizeValueType, BlockType > CachedBlockMapType;
+
+  /** Get a new block from the system, or return false. */
+  bool AllocateBlock( SizeValueType numberOfBytes, BlockType & block ) const;
+
+  /** Return a block to the system. */
+  static void FreeBlock( const BlockType & block );
+
+  /** Free the cached blocks, while the mutex is locked. */
+  void FreeCachedBlocks( void );
+
+  mutable SimpleFastMutexLock m_Mutex;
+  LiveBlockMapType            m_LiveBlocks;
+  CachedBlockMapType          m_CachedBlocks;
+  SizeValueType               m_NumberOfAllocatedBytes;
+  SizeValueType               m_NumberOfCachedBytes;
+  SizeValueType               m_MaximumCachedBytes;
+  HugePagesType               m_HugePages;
+
+};
+
+/** \class AlignedArenaBuffer
+ *
+ * \brief A buffer from the AlignedBufferArena, that is returned to the
+ * arena when the buffer is resized or destroyed.
+ *
+ * The buffer keeps the arena alive, so it may be a static object.
+ */
+
+class AlignedArenaBuffer
+{
+public:
+
+  AlignedArenaBuffer() : m_Pointer( 0 ), m_NumberOfBytes( 0 ) {}
+  ~AlignedArenaBuffer() { this->Release(); }
+
+  /** Make the buffer numberOfBytes large, and return it. The current block
+   * is kept if it has that size already; otherwise the contents are
+   * undefined. Throws a MemoryAllocationError if the memory is exhausted.
+   */
+  void * Resize( SizeValueType numberOfBytes );
+
+  /** Return the block to the arena. */
+  void Release( void );
+
+  /** Get the buffer, or 0 if it is empty. */
+  void * GetPointer( void ) const { return this->m_Pointer; }
+
+  /** Get the size that was last given to Resize(). */
+  SizeValueType GetNumberOfBytes( void ) const { return this->m_NumberOfBytes; }
+
+private:
+
+  AlignedArenaBuffer( const AlignedArenaBuffer & ); // purposely not implemented
+  void operator=( const AlignedArenaBuffer & );     // purposely not implemented
+
+  AlignedBufferArena::Pointer m_Arena;
+  void *                      m_Pointer;
+  SizeValueType               m_NumberOfBytes;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkAlignedBufferArena_h
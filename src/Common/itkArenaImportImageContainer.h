@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkArenaImportImageContainer_h
+#define __itkArenaImportImageContainer_h
+
+#include "itkImportImageContainer.h"
+#include "itkAlignedBufferArena.h"
+
+#include <cstring>
+
+namespace itk
+{
+
+/** \class ArenaImportImageContainer
+ *
+ * \brief An import image container that allocates its elements from the
+ * AlignedBufferArena.
+ *
+ * The buffers are aligned at a cache line, can be backed by huge pages, and
+ * are reused by the next image of about the same size, instead of being
+ * returned to the system. Memory that was imported with
+ * SetImportPointer( ptr, n, true ) is still freed with delete[].
+ *
+ * The elements are not constructed or destroyed, so the element type must
+ * be a scalar. The ArenaImportImageContainerFactory installs this container
+ * for the images of scalar pixels.
+ */
+
+template< class TElementIdentifier, class TElement >
+class ArenaImportImageContainer :
+  public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ArenaImportImageContainer                            Self;
+  typedef ImportImageContainer< TElementIdentifier, TElement > Superclass;
+  typedef SmartPointer< Self >                                 Pointer;
+  typedef SmartPointer< const Self >                           ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ArenaImportImageContainer, ImportImageContainer );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::ElementIdentifier ElementIdentifier;
+  typedef typename Superclass::Element           Element;
+
+protected:
+
+  ArenaImportImageContainer() : m_Arena( AlignedBufferArena::GetInstance() ) {}
+
+  /** The superclass destructor does not call our DeallocateManagedMemory. */
+  virtual ~ArenaImportImageContainer()
+  {
+    this->DeallocateManagedMemory();
+  }
+
+  /** Get the elements from the arena; zero them if requested. */
+  virtual TElement * AllocateElements( ElementIdentifier size,
+    bool UseDefaultConstructor = false ) const ITK_OVERRIDE
+  {
+    const SizeValueType numberOfBytes
+      = static_cast< SizeValueType >( size ) * sizeof( TElement );
+    void * buffer = this->m_Arena->Allocate( numberOfBytes );
+    if( buffer == 0 )
+    {
+      throw MemoryAllocationError( __FILE__, __LINE__,
+        "Failed to allocate memory for image.",
+        ITK_LOCATION );
+    }
+    if( UseDefaultConstructor )
+    {
+      std::memset( buffer, 0, numberOfBytes );
+    }
+    return static_cast< TElement * >( buffer );
+  }
+
+  /** Return the elements to the arena. */
+  virtual void DeallocateManagedMemory( void ) ITK_OVERRIDE
+  {
+    /** Let the superclass forget the buffer, without deleting it. */
+    TElement * buffer  = this->GetImportPointer();
+    const bool managed = this->GetContainerManageMemory();
+    this->SetContainerManageMemory( false );
+    Superclass::DeallocateManagedMemory();
+
+    if( buffer && managed && !this->m_Arena->Release( buffer ) )
+    {
+      delete[] buffer;
+    }
+  }
+
+private:
+
+  ArenaImportImageContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  /** Keeps the arena alive as long as the buffer. */
+  AlignedBufferArena::Pointer m_Arena;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkArenaImportImageContainer_h
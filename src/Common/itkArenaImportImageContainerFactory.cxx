@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkArenaImportImageContainerFactory_cxx
+#define __itkArenaImportImageContainerFactory_cxx
+
+#include "itkArenaImportImageContainerFactory.h"
+#include "itkArenaImportImageContainer.h"
+#include "itkCreateObjectFunction.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkVersion.h"
+
+#include <typeinfo>
+
+namespace itk
+{
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+ArenaImportImageContainerFactory
+::ArenaImportImageContainerFactory()
+{
+  this->RegisterContainerOverride< char >();
+  this->RegisterContainerOverride< unsigned char >();
+  this->RegisterContainerOverride< short >();
+  this->RegisterContainerOverride< unsigned short >();
+  this->RegisterContainerOverride< int >();
+  this->RegisterContainerOverride< unsigned int >();
+  this->RegisterContainerOverride< long >();
+  this->RegisterContainerOverride< unsigned long >();
+  this->RegisterContainerOverride< float >();
+  this->RegisterContainerOverride< double >();
+
+} // end Constructor
+
+
+/**
+ * ****************** RegisterContainerOverride *********************************
+ */
+
+template< class TElement >
+void
+ArenaImportImageContainerFactory
+::RegisterContainerOverride( void )
+{
+  typedef ImportImageContainer< SizeValueType, TElement >      ContainerType;
+  typedef ArenaImportImageContainer< SizeValueType, TElement > OverrideType;
+
+  this->RegisterOverride( typeid( ContainerType ).name(),
+    typeid( OverrideType ).name(),
+    "Aligned buffer arena image container",
+    true,
+    CreateObjectFunction< OverrideType >::New() );
+
+} // end RegisterContainerOverride()
+
+
+/**
+ * ****************** RegisterOneFactory *********************************
+ */
+
+void
+ArenaImportImageContainerFactory
+::RegisterOneFactory( void )
+{
+  static SimpleFastMutexLock registerMutex;
+  static bool                registered = false;
+
+  registerMutex.Lock();
+  if( !registered )
+  {
+    Pointer factory = Self::New();
+    ObjectFactoryBase::RegisterFactory( factory );
+    registered = true;
+  }
+  registerMutex.Unlock();
+
+} // end RegisterOneFactory()
+
+
+/**
+ * ****************** GetITKSourceVersion *********************************
+ */
+
+const char *
+ArenaImportImageContainerFactory
+::GetITKSourceVersion( void ) const
+{
+  return ITK_SOURCE_VERSION;
+
+} // end GetITKSourceVersion()
+
+
+/**
+ * ****************** GetDescription *********************************
+ */
+
+const char *
+ArenaImportImageContainerFactory
+::GetDescription( void ) const
+{
+  return "Allocates the buffers of the images of scalar pixels from the aligned buffer arena";
+
+} // end GetDescription()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkArenaImportImageContainerFactory_cxx
@@ -0,0 +1,79 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkArenaImportImageContainerFactory_h
+#define __itkArenaImportImageContainerFactory_h
+
+#include "itkObjectFactoryBase.h"
+
+namespace itk
+{
+
+/** \class ArenaImportImageContainerFactory
+ *
+ * \brief Overrides the pixel containers of the images of scalar pixels by
+ * the ArenaImportImageContainer.
+ *
+ * When registered, every image of char, short, int, float or double pixels
+ * (signed or unsigned) that is allocated, such as the outputs of the
+ * pyramids, the resamplers and the coefficient images of the B-spline
+ * transforms, gets its buffer from the AlignedBufferArena.
+ */
+
+class ArenaImportImageContainerFactory : public ObjectFactoryBase
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ArenaImportImageContainerFactory Self;
+  typedef ObjectFactoryBase                Superclass;
+  typedef SmartPointer< Self >             Pointer;
+  typedef SmartPointer< const Self >       ConstPointer;
+
+  /** Class methods used to interface with the registered factories. */
+  virtual const char * GetITKSourceVersion( void ) const;
+
+  virtual const char * GetDescription( void ) const;
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ArenaImportImageContainerFactory, ObjectFactoryBase );
+
+  /** Register one factory of this type. Registering it again has no effect. */
+  static void RegisterOneFactory( void );
+
+protected:
+
+  ArenaImportImageContainerFactory();
+  virtual ~ArenaImportImageContainerFactory() {}
+
+private:
+
+  ArenaImportImageContainerFactory( const Self & ); // purposely not implemented
+  void operator=( const Self & );                   // purposely not implemented
+
+  /** Register the override for the containers of TElement. */
+  template< class TElement >
+  void RegisterContainerOverride( void );
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkArenaImportImageContainerFactory_h
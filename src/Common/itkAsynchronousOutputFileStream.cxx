@@ -0,0 +1,479 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAsynchronousOutputFileStream_cxx
+#define __itkAsynchronousOutputFileStream_cxx
+
+#include "itkAsynchronousOutputFileStream.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <set>
+
+namespace
+{
+/** The size of the blocks handed to the writer, and the maximum number of
+ * blocks that wait to be written.
+ */
+const std::size_t BlockSize                   = 64 * 1024;
+const std::size_t MaximumNumberOfQueuedBlocks = 16;
+
+/** Whether the streams write asynchronously. */
+bool Asynchronous = false;
+
+/** The registry of open streams, for SynchronizeAll(). */
+typedef std::set< itk::AsynchronousOutputFileStream * > StreamSetType;
+
+StreamSetType &
+GetOpenStreams( void )
+{
+  static StreamSetType openStreams;
+  return openStreams;
+}
+
+
+itk::SimpleFastMutexLock &
+GetOpenStreamsMutex( void )
+{
+  static itk::SimpleFastMutexLock mutex;
+  return mutex;
+}
+
+
+} // end namespace
+
+namespace itk
+{
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+AsynchronousOutputFileStream
+::AsynchronousOutputFileStream() : std::ostream( 0 )
+{
+  this->rdbuf( &this->m_Buffer );
+
+} // end Constructor
+
+
+/**
+ * ****************** Destructor *********************************
+ */
+
+AsynchronousOutputFileStream
+::~AsynchronousOutputFileStream()
+{
+  this->close();
+
+} // end Destructor
+
+
+/**
+ * ****************** open *********************************
+ */
+
+void
+AsynchronousOutputFileStream
+::open( const char * fileName, const std::ios_base::openmode mode )
+{
+  this->close();
+  if( this->m_Buffer.Open( fileName, mode ) )
+  {
+    this->clear();
+    GetOpenStreamsMutex().Lock();
+    GetOpenStreams().insert( this );
+    GetOpenStreamsMutex().Unlock();
+  }
+  else
+  {
+    this->setstate( std::ios_base::failbit );
+  }
+
+} // end open()
+
+
+/**
+ * ****************** is_open *********************************
+ */
+
+bool
+AsynchronousOutputFileStream
+::is_open( void ) const
+{
+  return this->m_Buffer.IsOpen();
+
+} // end is_open()
+
+
+/**
+ * ****************** close *********************************
+ */
+
+void
+AsynchronousOutputFileStream
+::close( void )
+{
+  if( !this->m_Buffer.IsOpen() )
+  {
+    return;
+  }
+
+  GetOpenStreamsMutex().Lock();
+  GetOpenStreams().erase( this );
+  GetOpenStreamsMutex().Unlock();
+  this->m_Buffer.Close();
+
+} // end close()
+
+
+/**
+ * ****************** Synchronize *********************************
+ */
+
+void
+AsynchronousOutputFileStream
+::Synchronize( void )
+{
+  this->m_Buffer.Synchronize();
+
+} // end Synchronize()
+
+
+/**
+ * ****************** SynchronizeAll *********************************
+ */
+
+void
+AsynchronousOutputFileStream
+::SynchronizeAll( void )
+{
+  GetOpenStreamsMutex().Lock();
+  const StreamSetType openStreams = GetOpenStreams();
+  GetOpenStreamsMutex().Unlock();
+
+  for( StreamSetType::const_iterator it = openStreams.begin(); it != openStreams.end(); ++it )
+  {
+    ( *it )->Synchronize();
+  }
+
+} // end SynchronizeAll()
+
+
+/**
+ * ****************** SetAsynchronous *********************************
+ */
+
+void
+AsynchronousOutputFileStream
+::SetAsynchronous( const bool asynchronous )
+{
+  if( !asynchronous )
+  {
+    SynchronizeAll();
+  }
+  Asynchronous = asynchronous;
+
+} // end SetAsynchronous()
+
+
+/**
+ * ****************** GetAsynchronous *********************************
+ */
+
+bool
+AsynchronousOutputFileStream
+::GetAsynchronous( void )
+{
+  return Asynchronous;
+
+} // end GetAsynchronous()
+
+
+/**
+ * ****************** StreamBuffer Constructor *********************************
+ */
+
+AsynchronousOutputFileStream::StreamBuffer
+::StreamBuffer() :
+  m_Block( BlockSize ),
+  m_WriterThreadId( 0 ),
+  m_WriterRunning( false ),
+  m_StopWriter( false ),
+  m_Writing( false )
+{
+  this->m_Condition      = ConditionVariable::New();
+  this->m_WriterThreader = MultiThreader::New();
+  this->setp( &this->m_Block[ 0 ], &this->m_Block[ 0 ] + this->m_Block.size() );
+
+} // end StreamBuffer Constructor
+
+
+/**
+ * ****************** StreamBuffer Destructor *********************************
+ */
+
+AsynchronousOutputFileStream::StreamBuffer
+::~StreamBuffer()
+{
+  this->Close();
+
+} // end StreamBuffer Destructor
+
+
+/**
+ * ****************** Open *********************************
+ */
+
+bool
+AsynchronousOutputFileStream::StreamBuffer
+::Open( const char * fileName, const std::ios_base::openmode mode )
+{
+  this->m_File.open( fileName, mode | std::ios_base::out );
+  return this->m_File.is_open();
+
+} // end Open()
+
+
+/**
+ * ****************** Close *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::Close( void )
+{
+  if( !this->m_File.is_open() )
+  {
+    return;
+  }
+
+  this->Synchronize();
+  this->StopWriter();
+  this->m_File.close();
+
+} // end Close()
+
+
+/**
+ * ****************** Synchronize *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::Synchronize( void )
+{
+  this->PassOn();
+  this->WaitForWriter();
+  this->m_File.flush();
+
+} // end Synchronize()
+
+
+/**
+ * ****************** overflow *********************************
+ */
+
+AsynchronousOutputFileStream::StreamBuffer::int_type
+AsynchronousOutputFileStream::StreamBuffer
+::overflow( int_type c )
+{
+  this->PassOn();
+  if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+  {
+    *this->pptr() = traits_type::to_char_type( c );
+    this->pbump( 1 );
+  }
+  return traits_type::not_eof( c );
+
+} // end overflow()
+
+
+/**
+ * ****************** sync *********************************
+ *
+ * A flush of the stream only reaches the file when writing synchronously.
+ */
+
+int
+AsynchronousOutputFileStream::StreamBuffer
+::sync( void )
+{
+  if( !Asynchronous )
+  {
+    this->PassOn();
+    this->m_File.flush();
+  }
+  return this->m_File.good() ? 0 : -1;
+
+} // end sync()
+
+
+/**
+ * ****************** PassOn *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::PassOn( void )
+{
+  const std::ptrdiff_t size = this->pptr() - this->pbase();
+  if( size == 0 )
+  {
+    return;
+  }
+
+  if( Asynchronous )
+  {
+    if( !this->m_WriterRunning )
+    {
+      this->StartWriter();
+    }
+
+    /** Wait for room in the queue; the writer broadcasts after every block. */
+    std::string block( this->pbase(), size );
+    this->m_Mutex.Lock();
+    while( this->m_Queue.size() >= MaximumNumberOfQueuedBlocks )
+    {
+      this->m_Condition->Wait( &this->m_Mutex );
+    }
+    this->m_Queue.push_back( std::string() );
+    this->m_Queue.back().swap( block );
+    this->m_Condition->Broadcast();
+    this->m_Mutex.Unlock();
+  }
+  else
+  {
+    /** Keep the order of the output that was queued before. */
+    this->WaitForWriter();
+    this->m_File.write( this->pbase(), size );
+  }
+
+  this->setp( &this->m_Block[ 0 ], &this->m_Block[ 0 ] + this->m_Block.size() );
+
+} // end PassOn()
+
+
+/**
+ * ****************** WaitForWriter *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::WaitForWriter( void )
+{
+  if( !this->m_WriterRunning )
+  {
+    return;
+  }
+
+  this->m_Mutex.Lock();
+  while( !this->m_Queue.empty() || this->m_Writing )
+  {
+    this->m_Condition->Wait( &this->m_Mutex );
+  }
+  this->m_Mutex.Unlock();
+
+} // end WaitForWriter()
+
+
+/**
+ * ****************** StartWriter *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::StartWriter( void )
+{
+  this->m_StopWriter     = false;
+  this->m_WriterThreadId = this->m_WriterThreader->SpawnThread( this->WriterCallback, this );
+  this->m_WriterRunning  = true;
+
+} // end StartWriter()
+
+
+/**
+ * ****************** StopWriter *********************************
+ */
+
+void
+AsynchronousOutputFileStream::StreamBuffer
+::StopWriter( void )
+{
+  if( !this->m_WriterRunning )
+  {
+    return;
+  }
+
+  this->m_Mutex.Lock();
+  this->m_StopWriter = true;
+  this->m_Condition->Broadcast();
+  this->m_Mutex.Unlock();
+
+  /** TerminateThread() joins the writer. */
+  this->m_WriterThreader->TerminateThread( this->m_WriterThreadId );
+  this->m_WriterRunning = false;
+
+} // end StopWriter()
+
+
+/**
+ * ****************** WriterCallback *********************************
+ */
+
+ITK_THREAD_RETURN_TYPE
+AsynchronousOutputFileStream::StreamBuffer
+::WriterCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  StreamBuffer *                    buffer     = static_cast< StreamBuffer * >( infoStruct->UserData );
+
+  buffer->m_Mutex.Lock();
+  while( true )
+  {
+    /** Sleep until there is a block to write, or until we have to stop. */
+    while( buffer->m_Queue.empty() && !buffer->m_StopWriter )
+    {
+      buffer->m_Condition->Wait( &buffer->m_Mutex );
+    }
+    if( buffer->m_Queue.empty() )
+    {
+      break;
+    }
+
+    std::string block;
+    block.swap( buffer->m_Queue.front() );
+    buffer->m_Queue.pop_front();
+    buffer->m_Writing = true;
+    buffer->m_Condition->Broadcast();
+    buffer->m_Mutex.Unlock();
+
+    buffer->m_File.write( block.data(), block.size() );
+
+    buffer->m_Mutex.Lock();
+    buffer->m_Writing = false;
+    buffer->m_Condition->Broadcast();
+  }
+  buffer->m_Mutex.Unlock();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end WriterCallback()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkAsynchronousOutputFileStream_cxx
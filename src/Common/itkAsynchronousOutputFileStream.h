@@ -0,0 +1,154 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAsynchronousOutputFileStream_h
+#define __itkAsynchronousOutputFileStream_h
+
+#include "itkMultiThreader.h"
+#include "itkSimpleMutexLock.h"
+#include "itkConditionVariable.h"
+
+#include <deque>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class AsynchronousOutputFileStream
+ *
+ * \brief An output file stream that optionally writes on a background thread.
+ *
+ * xout flushes its outputs after every cell, so the elastix.log and the
+ * IterationInfo files receive a few small synchronous writes per iteration.
+ * On network file systems that is a visible cost. When asynchronous writing
+ * is enabled, see SetAsynchronous(), this stream collects its output in
+ * blocks in memory, and a background thread writes the blocks to the file.
+ * A flush of the stream then does not wait for the file system. The number
+ * of blocks that wait to be written is bounded: when the writer falls behind,
+ * the thread that writes to the stream waits for it.
+ *
+ * Synchronize() writes all pending output and flushes the file;
+ * SynchronizeAll() does so for all open streams. Closing or destroying a
+ * stream synchronizes it as well. When asynchronous writing is disabled,
+ * which is the default, the stream behaves like a std::ofstream.
+ *
+ * Like a std::ofstream, a stream should be written to by one thread at a
+ * time. Synchronize() and SynchronizeAll() should be called by that thread.
+ *
+ * \ingroup Multithreading
+ */
+
+class AsynchronousOutputFileStream : public std::ostream
+{
+public:
+
+  /** Constructor and destructor. */
+  AsynchronousOutputFileStream();
+  virtual ~AsynchronousOutputFileStream();
+
+  /** Open, check and close the file, like std::ofstream. */
+  void open( const char * fileName,
+    const std::ios_base::openmode mode = std::ios_base::out );
+
+  bool is_open( void ) const;
+
+  void close( void );
+
+  /** Write all pending output and flush the file. */
+  void Synchronize( void );
+
+  /** Synchronize all open streams. */
+  static void SynchronizeAll( void );
+
+  /** Enable or disable asynchronous writing of all streams. Disabling
+   * synchronizes all open streams.
+   */
+  static void SetAsynchronous( const bool asynchronous );
+
+  static bool GetAsynchronous( void );
+
+private:
+
+  AsynchronousOutputFileStream( const AsynchronousOutputFileStream & ); // purposely not implemented
+  void operator=( const AsynchronousOutputFileStream & );               // purposely not implemented
+
+  /** The stream buffer that collects the output and hands it to the writer. */
+  class StreamBuffer : public std::streambuf
+  {
+public:
+
+    StreamBuffer();
+    virtual ~StreamBuffer();
+
+    bool Open( const char * fileName, const std::ios_base::openmode mode );
+
+    bool IsOpen( void ) const { return this->m_File.rdbuf()->is_open(); }
+
+    void Close( void );
+
+    void Synchronize( void );
+
+protected:
+
+    /** Called by the stream when the block is full, and on a flush. */
+    virtual int_type overflow( int_type c );
+
+    virtual int sync( void );
+
+private:
+
+    /** Pass the collected output on: to the writer when writing
+     * asynchronously, and directly to the file otherwise.
+     */
+    void PassOn( void );
+
+    /** Wait until the writer has written all queued blocks. */
+    void WaitForWriter( void );
+
+    void StartWriter( void );
+
+    void StopWriter( void );
+
+    /** The loop executed by the writer thread. */
+    static ITK_THREAD_RETURN_TYPE WriterCallback( void * arg );
+
+    std::ofstream             m_File;
+    std::vector< char >       m_Block;
+    std::deque< std::string > m_Queue;
+
+    /** Synchronization between the stream and the writer. The condition is
+     * broadcast whenever the queue or the writer state changes.
+     */
+    SimpleMutexLock            m_Mutex;
+    ConditionVariable::Pointer m_Condition;
+    MultiThreader::Pointer     m_WriterThreader;
+    ThreadIdType               m_WriterThreadId;
+    bool                       m_WriterRunning;
+    bool                       m_StopWriter;
+    bool                       m_Writing;
+  };
+
+  StreamBuffer m_Buffer;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkAsynchronousOutputFileStream_h
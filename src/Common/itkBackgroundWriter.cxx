@@ -0,0 +1,371 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBackgroundWriter_cxx
+#define __itkBackgroundWriter_cxx
+
+#include "itkBackgroundWriter.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined( _WIN32 )
+#include "itkWindows.h"
+#endif
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+BackgroundWriter::Pointer
+BackgroundWriter
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+BackgroundWriter
+::BackgroundWriter()
+{
+  this->m_Enabled                      = false;
+  this->m_MaximumNumberOfPendingWrites = 2;
+  this->m_Condition                    = ConditionVariable::New();
+  this->m_WriterThreader               = MultiThreader::New();
+  this->m_WriterThreadId               = 0;
+  this->m_WriterRunning                = false;
+  this->m_StopWriter                   = false;
+
+} // end Constructor
+
+
+/**
+ * ****************** Destructor *********************************
+ */
+
+BackgroundWriter
+::~BackgroundWriter()
+{
+  this->WaitForAll();
+
+} // end Destructor
+
+
+/**
+ * ****************** SubmitWriter *********************************
+ */
+
+void
+BackgroundWriter
+::SubmitWriter( ProcessObject * writer, const std::string & description )
+{
+  if( !this->m_Enabled )
+  {
+    writer->Update();
+    return;
+  }
+
+  WriteType write;
+  write.Writer   = writer;
+  write.FileName = description;
+  this->Submit( write );
+
+} // end SubmitWriter()
+
+
+/**
+ * ****************** SubmitTextFile *********************************
+ */
+
+void
+BackgroundWriter
+::SubmitTextFile( const std::string & fileName, const std::string & contents )
+{
+  WriteType write;
+  write.FileName = fileName;
+  write.Contents = contents;
+
+  if( !this->m_Enabled )
+  {
+    const std::string error = Execute( write );
+    if( !error.empty() )
+    {
+      itkExceptionMacro( << error );
+    }
+    return;
+  }
+
+  this->Submit( write );
+
+} // end SubmitTextFile()
+
+
+/**
+ * ****************** SubmitBinaryFile *********************************
+ */
+
+void
+BackgroundWriter
+::SubmitBinaryFile( const std::string & fileName, const std::string & contents )
+{
+  WriteType write;
+  write.FileName = fileName;
+  write.Contents = contents;
+  write.Binary   = true;
+
+  if( !this->m_Enabled )
+  {
+    const std::string error = Execute( write );
+    if( !error.empty() )
+    {
+      itkExceptionMacro( << error );
+    }
+    return;
+  }
+
+  this->Submit( write );
+
+} // end SubmitBinaryFile()
+
+
+/**
+ * ****************** WaitForAll *********************************
+ */
+
+std::vector< std::string >
+BackgroundWriter
+::WaitForAll( void )
+{
+  std::vector< std::string > errors;
+  if( !this->m_WriterRunning )
+  {
+    errors.swap( this->m_Errors );
+    return errors;
+  }
+
+  this->m_Mutex.Lock();
+  this->m_StopWriter = true;
+  this->m_Condition->Broadcast();
+  this->m_Mutex.Unlock();
+
+  /** The writer empties the queue before it stops; TerminateThread() joins it. */
+  this->m_WriterThreader->TerminateThread( this->m_WriterThreadId );
+  this->m_WriterRunning = false;
+
+  errors.swap( this->m_Errors );
+  return errors;
+
+} // end WaitForAll()
+
+
+/**
+ * ****************** Execute *********************************
+ */
+
+std::string
+BackgroundWriter
+::Execute( WriteType & write )
+{
+  std::ostringstream error( "" );
+  if( write.Writer.IsNotNull() )
+  {
+    try
+    {
+      write.Writer->Update();
+    }
+    catch( ExceptionObject & excp )
+    {
+      error << "Error occurred while writing \"" << write.FileName << "\":\n" << excp;
+    }
+
+    /** Release the input of the writer, e.g. the resampled image. */
+    write.Writer = 0;
+  }
+  else if( !write.Binary )
+  {
+    std::ofstream file( write.FileName.c_str() );
+    if( !file.is_open() )
+    {
+      error << "File \"" << write.FileName << "\" could not be opened!";
+    }
+    else
+    {
+      file.write( write.Contents.data(), write.Contents.size() );
+      if( !file )
+      {
+        error << "Error occurred while writing \"" << write.FileName << "\".";
+      }
+    }
+  }
+  else
+  {
+    /** Write to a temporary file, and replace the file when that succeeded. */
+    const std::string temporaryFileName = write.FileName + ".tmp";
+    std::ofstream     file( temporaryFileName.c_str(), std::ios::out | std::ios::binary );
+    if( !file.is_open() )
+    {
+      error << "File \"" << temporaryFileName << "\" could not be opened!";
+    }
+    else
+    {
+      file.write( write.Contents.data(), write.Contents.size() );
+      file.close();
+      if( !file )
+      {
+        error << "Error occurred while writing \"" << temporaryFileName << "\".";
+      }
+#if defined( _WIN32 )
+      /** On Windows, rename() does not replace an existing file. Removing
+       * it first would leave no file at all if the process is killed in
+       * between, so replace it in one step.
+       */
+      else if( !MoveFileExA( temporaryFileName.c_str(), write.FileName.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) )
+#else
+      else if( std::rename( temporaryFileName.c_str(), write.FileName.c_str() ) != 0 )
+#endif
+      {
+        error << "File \"" << temporaryFileName << "\" could not be renamed to \""
+              << write.FileName << "\".";
+      }
+    }
+  }
+
+  return error.str();
+
+} // end Execute()
+
+
+/**
+ * ****************** Submit *********************************
+ */
+
+void
+BackgroundWriter
+::Submit( WriteType & write )
+{
+  this->m_Mutex.Lock();
+  if( !this->m_WriterRunning )
+  {
+    this->m_StopWriter     = false;
+    this->m_WriterThreadId = this->m_WriterThreader->SpawnThread( this->WriterCallback, this );
+    this->m_WriterRunning  = true;
+  }
+
+  /** Wait for room in the queue; the writer broadcasts after every write. */
+  while( this->m_Queue.size() >= this->m_MaximumNumberOfPendingWrites )
+  {
+    this->m_Condition->Wait( &this->m_Mutex );
+  }
+  this->m_Queue.push_back( WriteType() );
+  this->m_Queue.back().Writer = write.Writer;
+  this->m_Queue.back().FileName.swap( write.FileName );
+  this->m_Queue.back().Contents.swap( write.Contents );
+  this->m_Queue.back().Binary = write.Binary;
+  write.Writer = 0;
+  this->m_Condition->Broadcast();
+  this->m_Mutex.Unlock();
+
+} // end Submit()
+
+
+/**
+ * ****************** WriterCallback *********************************
+ */
+
+ITK_THREAD_RETURN_TYPE
+BackgroundWriter
+::WriterCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  Self *                            self       = static_cast< Self * >( infoStruct->UserData );
+
+  self->m_Mutex.Lock();
+  while( true )
+  {
+    /** Sleep until there is something to write, or until we have to stop. */
+    while( self->m_Queue.empty() && !self->m_StopWriter )
+    {
+      self->m_Condition->Wait( &self->m_Mutex );
+    }
+    if( self->m_Queue.empty() )
+    {
+      break;
+    }
+
+    WriteType write = self->m_Queue.front();
+    self->m_Queue.pop_front();
+    self->m_Condition->Broadcast();
+    self->m_Mutex.Unlock();
+
+    const std::string error = Execute( write );
+
+    self->m_Mutex.Lock();
+    if( !error.empty() )
+    {
+      self->m_Errors.push_back( error );
+    }
+  }
+  self->m_Mutex.Unlock();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end WriterCallback()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+BackgroundWriter
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Enabled: " << this->m_Enabled << std::endl;
+  os << indent << "MaximumNumberOfPendingWrites: "
+     << this->m_MaximumNumberOfPendingWrites << std::endl;
+  os << indent << "NumberOfPendingWrites: " << this->m_Queue.size() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBackgroundWriter_cxx
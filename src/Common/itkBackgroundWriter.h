@@ -0,0 +1,161 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBackgroundWriter_h
+#define __itkBackgroundWriter_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkProcessObject.h"
+#include "itkMultiThreader.h"
+#include "itkSimpleMutexLock.h"
+#include "itkConditionVariable.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class BackgroundWriter
+ *
+ * \brief Writes result images and text files on a background thread.
+ *
+ * Writing the result image after a resolution, or the transform parameter
+ * file, blocks the registration until the file system is done, including the
+ * compression of the image. When the background writer is enabled, see
+ * SetEnabled(), such writes are handed to a background thread instead, and
+ * the registration continues with the next resolution or the next pair.
+ *
+ * An image is written by submitting its writer, see SubmitWriter(). The
+ * writer must not depend on a pipeline that is modified later, so its input
+ * should be disconnected from the pipeline first. The number of pending
+ * writes is bounded, see SetMaximumNumberOfPendingWrites(); when the writer
+ * falls behind, the submitting thread waits for it, which also bounds the
+ * memory of the images that wait to be written.
+ *
+ * WaitForAll() waits until everything is written and returns the errors of
+ * the background writes. It must be called before the code of the writers
+ * is unloaded, e.g. at exit. When the background writer is disabled, which
+ * is the default, the writes are done immediately, and errors are thrown.
+ *
+ * The writer is a singleton, obtained via GetInstance().
+ *
+ * \ingroup Multithreading
+ */
+
+class BackgroundWriter : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BackgroundWriter           Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BackgroundWriter, Object );
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** Enable or disable writing in the background. Default: false. */
+  itkSetMacro( Enabled, bool );
+  itkGetConstMacro( Enabled, bool );
+  itkBooleanMacro( Enabled );
+
+  /** The maximum number of writes that wait for the background thread.
+   * Default: 2.
+   */
+  itkSetClampMacro( MaximumNumberOfPendingWrites, SizeValueType,
+    1, NumericTraits< SizeValueType >::max() );
+  itkGetConstMacro( MaximumNumberOfPendingWrites, SizeValueType );
+
+  /** Update \a writer, e.g. an ImageFileWriter, in the background. The
+   * \a description, e.g. the file name, is used in the error messages.
+   */
+  void SubmitWriter( ProcessObject * writer, const std::string & description );
+
+  /** Write \a contents to the text file \a fileName in the background. */
+  void SubmitTextFile( const std::string & fileName, const std::string & contents );
+
+  /** Write \a contents to the binary file \a fileName in the background.
+   * The contents are first written to fileName + ".tmp", which is then
+   * renamed, so \a fileName is either the previous or the new file, also
+   * when the process is killed while writing.
+   */
+  void SubmitBinaryFile( const std::string & fileName, const std::string & contents );
+
+  /** Wait until all submitted writes are done, and stop the background
+   * thread. Returns the errors that occurred since the previous call.
+   */
+  std::vector< std::string > WaitForAll( void );
+
+protected:
+
+  BackgroundWriter();
+  virtual ~BackgroundWriter();
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  BackgroundWriter( const Self & ); // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  /** A write: either a writer, or a text or binary file with its contents. */
+  struct WriteType
+  {
+    ProcessObject::Pointer Writer;
+    std::string            FileName;
+    std::string            Contents;
+    bool                   Binary;
+    WriteType() : Binary( false ) {}
+  };
+
+  /** Execute a write; returns an error message, or an empty string. */
+  static std::string Execute( WriteType & write );
+
+  /** Queue a write, waiting for room in the queue. */
+  void Submit( WriteType & write );
+
+  /** The loop executed by the background thread. */
+  static ITK_THREAD_RETURN_TYPE WriterCallback( void * arg );
+
+  bool                       m_Enabled;
+  SizeValueType              m_MaximumNumberOfPendingWrites;
+  std::deque< WriteType >    m_Queue;
+  std::vector< std::string > m_Errors;
+
+  /** Synchronization between the submitters and the background thread. The
+   * condition is broadcast whenever the queue or the writer state changes.
+   */
+  SimpleMutexLock            m_Mutex;
+  ConditionVariable::Pointer m_Condition;
+  MultiThreader::Pointer     m_WriterThreader;
+  ThreadIdType               m_WriterThreadId;
+  bool                       m_WriterRunning;
+  bool                       m_StopWriter;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBackgroundWriter_h
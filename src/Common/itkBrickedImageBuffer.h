@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBrickedImageBuffer_h
+#define __itkBrickedImageBuffer_h
+
+#include "itkImageRegion.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+/**
+ * \class BrickedImageBuffer
+ * \brief A copy of an image buffer, stored as a grid of small bricks.
+ *
+ * In a normal image buffer, the neighbours of a pixel along the last
+ * dimensions are far away in memory. Interpolators that are evaluated at
+ * random positions therefore cause several cache and TLB misses per sample.
+ * This class stores the pixels of an image in bricks of 8 pixels along each
+ * dimension, so that a neighbourhood is stored in a few cache lines.
+ *
+ * Every brick also contains the first pixel of the next brick along each
+ * dimension, i.e. a brick has 9 pixels along each dimension. As a result,
+ * the 2^D corner pixels of a linear interpolation cell always lie in a
+ * single brick, at fixed offsets (see GetNeighbourOffset()). Along the edge
+ * of the image, these extra pixels replicate the last pixel.
+ *
+ * The buffer is a copy, so it has to be rebuilt when the image changes.
+ * Only the buffered region of the image is copied.
+ *
+ * \sa AdvancedLinearInterpolateImageFunction
+ * \sa ReducedDimensionBSplineInterpolateImageFunction
+ */
+
+template< class TValue, unsigned int VDimension >
+class BrickedImageBuffer
+{
+public:
+
+  /** Typedefs. */
+  typedef BrickedImageBuffer        Self;
+  typedef TValue                    ValueType;
+  typedef Index< VDimension >       IndexType;
+  typedef ImageRegion< VDimension > RegionType;
+
+  /** The number of pixels of a brick along each dimension, excluding the
+   * pixel shared with the next brick.
+   */
+  enum { BrickShift = 3, BrickEdge = 1 << BrickShift, BrickMask = BrickEdge - 1 };
+
+  BrickedImageBuffer()
+  {
+    this->Clear();
+  }
+
+
+  /** Copy the buffered region of an image. TImage::GetPixel() has to return
+   * something that converts to ValueType.
+   */
+  template< class TImage >
+  void CopyFromImage( const TImage * image )
+  {
+    this->Clear();
+    if( image == NULL ) { return; }
+
+    this->m_Region = image->GetBufferedRegion();
+    if( this->m_Region.GetNumberOfPixels() == 0 ) { return; }
+
+    /** Compute the layout. */
+    SizeValueType numberOfBricks[ VDimension ];
+    SizeValueType totalNumberOfBricks = 1;
+    this->m_BrickVolume = 1;
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      numberOfBricks[ d ]           = ( this->m_Region.GetSize( d ) + BrickMask ) >> BrickShift;
+      this->m_BrickStrides[ d ]     = static_cast< OffsetValueType >( totalNumberOfBricks );
+      this->m_NeighbourOffsets[ d ] = static_cast< OffsetValueType >( this->m_BrickVolume );
+      totalNumberOfBricks          *= numberOfBricks[ d ];
+      this->m_BrickVolume          *= BrickEdge + 1;
+    }
+    this->m_Buffer.resize( totalNumberOfBricks * this->m_BrickVolume );
+
+    /** Fill the bricks one after the other, in memory order. */
+    ValueType * out = &this->m_Buffer[ 0 ];
+    for( SizeValueType brick = 0; brick < totalNumberOfBricks; ++brick )
+    {
+      IndexType     brickStart;
+      SizeValueType remainder = brick;
+      for( unsigned int d = 0; d < VDimension; ++d )
+      {
+        brickStart[ d ] = this->m_Region.GetIndex( d )
+          + static_cast< IndexValueType >( ( remainder % numberOfBricks[ d ] ) << BrickShift );
+        remainder /= numberOfBricks[ d ];
+      }
+
+      for( SizeValueType local = 0; local < this->m_BrickVolume; ++local, ++out )
+      {
+        IndexType     index;
+        SizeValueType localRemainder = local;
+        for( unsigned int d = 0; d < VDimension; ++d )
+        {
+          const IndexValueType last = this->m_Region.GetIndex( d )
+            + static_cast< IndexValueType >( this->m_Region.GetSize( d ) ) - 1;
+          index[ d ] = std::min( brickStart[ d ]
+            + static_cast< IndexValueType >( localRemainder % ( BrickEdge + 1 ) ), last );
+          localRemainder /= BrickEdge + 1;
+        }
+        *out = static_cast< ValueType >( image->GetPixel( index ) );
+      }
+    }
+
+  } // end CopyFromImage()
+
+
+  /** Release the memory. */
+  void Clear( void )
+  {
+    std::vector< ValueType >().swap( this->m_Buffer );
+    this->m_Region      = RegionType();
+    this->m_BrickVolume = 0;
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      this->m_BrickStrides[ d ]     = 0;
+      this->m_NeighbourOffsets[ d ] = 0;
+    }
+  }
+
+
+  /** Returns true if no image has been copied. */
+  bool IsEmpty( void ) const
+  {
+    return this->m_Buffer.empty();
+  }
+
+
+  /** The region of the image that was copied. */
+  const RegionType & GetRegion( void ) const
+  {
+    return this->m_Region;
+  }
+
+
+  /** The memory offset of an index, which has to lie inside the region. */
+  OffsetValueType ComputeOffset( const IndexType & index ) const
+  {
+    OffsetValueType brick = 0;
+    OffsetValueType local = 0;
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      const OffsetValueType relative = index[ d ] - this->m_Region.GetIndex( d );
+      brick += ( relative >> BrickShift ) * this->m_BrickStrides[ d ];
+      local += ( relative & BrickMask ) * this->m_NeighbourOffsets[ d ];
+    }
+    return brick * static_cast< OffsetValueType >( this->m_BrickVolume ) + local;
+  }
+
+
+  /** The offset from the pixel at ComputeOffset( index ) to the value of
+   * the next index along dimension d. Valid for every index in the region,
+   * and may be accumulated over different dimensions.
+   */
+  OffsetValueType GetNeighbourOffset( const unsigned int d ) const
+  {
+    return this->m_NeighbourOffsets[ d ];
+  }
+
+
+  /** The value at an index, which has to lie inside the region. */
+  const ValueType & GetValue( const IndexType & index ) const
+  {
+    return this->m_Buffer[ this->ComputeOffset( index ) ];
+  }
+
+
+  /** The start of the memory. */
+  const ValueType * GetBufferPointer( void ) const
+  {
+    return this->IsEmpty() ? NULL : &this->m_Buffer[ 0 ];
+  }
+
+
+private:
+
+  std::vector< ValueType > m_Buffer;
+  RegionType               m_Region;
+  SizeValueType            m_BrickVolume;
+  OffsetValueType          m_BrickStrides[ VDimension ];
+  OffsetValueType          m_NeighbourOffsets[ VDimension ];
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBrickedImageBuffer_h
@@ -25,6 +25,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkImageFullSampler.h"
 #include "itkMultiThreader.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -40,6 +41,11 @@ namespace itk
  * SPIE Medical Imaging: Image Processing,February, 2014.
  * http://elastix.isi.uu.nl/marius/publications/2014_c_SPIEMI.php
  *
+ * By default the Jacobians are computed on a grid of approximately
+ * NumberOfJacobianMeasurements samples. Alternatively the samples of another
+ * sampler, e.g. the current samples of the metric, can be passed with
+ * SetSampleContainer(), which avoids sampling the fixed image again. The
+ * Jacobians are evaluated in batches with GetJacobians().
  */
 
 template< class TFixedImage, class TTransform >
@@ -95,6 +101,15 @@ public:
   /** Set some parameters. */
   itkSetMacro( NumberOfJacobianMeasurements, SizeValueType );
 
+  /** Typedef for the samples. */
+  typedef ImageSamplerBase< FixedImageType >                    ImageSamplerBaseType;
+  typedef typename ImageSamplerBaseType::ImageSampleContainerType ImageSampleContainerType;
+
+  /** Set the samples at which the Jacobians are computed, instead of sampling
+   * the fixed image on a grid. Set to 0 to use the grid again. Default: 0.
+   */
+  itkSetConstObjectMacro( SampleContainer, ImageSampleContainerType );
+
   /** Set the region over which the metric will be computed. */
   void SetFixedImageRegion( const FixedImageRegionType & region )
   {
@@ -155,7 +170,6 @@ protected:
   typedef typename  JacobianType::ValueType     JacobianValueType;
 
   /** Samplers. */
-  typedef ImageSamplerBase< FixedImageType >     ImageSamplerBaseType;
   typedef typename ImageSamplerBaseType::Pointer ImageSamplerBasePointer;
 
   typedef ImageFullSampler< FixedImageType >     ImageFullSamplerType;
@@ -164,11 +178,10 @@ protected:
   typedef ImageRandomSamplerBase< FixedImageType >     ImageRandomSamplerBaseType;
   typedef typename ImageRandomSamplerBaseType::Pointer ImageRandomSamplerBasePointer;
 
-  typedef ImageGridSampler< FixedImageType >     ImageGridSamplerType;
-  typedef typename ImageGridSamplerType::Pointer ImageGridSamplerPointer;
-  typedef typename ImageGridSamplerType
-    ::ImageSampleContainerType                   ImageSampleContainerType;
-  typedef typename ImageSampleContainerType::Pointer ImageSampleContainerPointer;
+  typedef ImageGridSampler< FixedImageType >              ImageGridSamplerType;
+  typedef typename ImageGridSamplerType::Pointer          ImageGridSamplerPointer;
+  typedef typename ImageSampleContainerType::Pointer      ImageSampleContainerPointer;
+  typedef typename ImageSampleContainerType::ConstPointer ImageSampleContainerConstPointer;
 
   /** Typedefs for support of sparse Jacobians and AdvancedTransforms. */
   typedef JacobianType                                   TransformJacobianType;
@@ -181,6 +194,27 @@ protected:
   virtual void SampleFixedImageForJacobianTerms(
     ImageSampleContainerPointer & sampleContainer );
 
+  /** Get the samples that were set, or else sample the fixed image on a grid. */
+  virtual ImageSampleContainerConstPointer GetSamplesForJacobianTerms( void );
+
+  /** The number of samples of which the Jacobians are computed at once. */
+  itkStaticConstMacro( JacobianBatchSize, unsigned int, 64 );
+
+  /** The points and scaled Jacobians of a batch of samples. */
+  struct JacobianBatchType
+  {
+    std::vector< typename TransformType::InputPointType > st_Points;
+    std::vector< JacobianType >                          st_Jacobians;
+    std::vector< NonZeroJacobianIndicesType >            st_NonZeroJacobianIndices;
+  };
+
+  /** Allocate the Jacobians of a batch. */
+  void InitializeJacobianBatch( JacobianBatchType & batch ) const;
+
+  /** Compute the scaled Jacobians of the samples [begin, begin + n). */
+  void ComputeJacobianBatch( const ImageSampleContainerType & samples,
+    const SizeValueType begin, const SizeValueType n, JacobianBatchType & batch ) const;
+
   /** Launch MultiThread GetValue. */
   void LaunchComputeThreaderCallback( void ) const;
 
@@ -218,10 +252,11 @@ protected:
   mutable AlignedComputePerThreadStruct * m_ComputePerThreadVariables;
   mutable ThreadIdType                    m_ComputePerThreadVariablesSize;
 
-  SizeValueType               m_NumberOfPixelsCounted;
-  bool                        m_UseMultiThread;
-  ScalesType                  m_Scales;
-  ImageSampleContainerPointer m_SampleContainer;
+  SizeValueType                    m_NumberOfPixelsCounted;
+  bool                             m_UseMultiThread;
+  ScalesType                       m_Scales;
+  ImageSampleContainerConstPointer m_SampleContainer;
+  ImageSampleContainerConstPointer m_SamplesForJacobianTerms;
 
 private:
 
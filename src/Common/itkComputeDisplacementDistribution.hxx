@@ -49,6 +49,7 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   this->m_FixedImageMask               = NULL;
   this->m_NumberOfJacobianMeasurements = 0;
   this->m_SampleContainer              = 0;
+  this->m_SamplesForJacobianTerms      = 0;
 
   /** Threading related variables. */
   this->m_UseMultiThread = true;
@@ -137,9 +138,8 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   maxJJ = jacg = 0.0;
 
   /** Get samples. */
-  ImageSampleContainerPointer sampleContainer = 0;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
+  ImageSampleContainerConstPointer sampleContainer = this->GetSamplesForJacobianTerms();
+  const SizeValueType              nrofsamples     = sampleContainer->Size();
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
@@ -156,20 +156,13 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   /** Get transform and set current position. */
   const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
   unsigned int samplenr = 0;
 
-  /** Variables for nonzerojacobian indices and the Jacobian. */
+  /** Variables for nonzerojacobian indices and the Jacobians. */
   const SizeValueType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-  jacind[ 0 ] = 0;
-  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
+  JacobianBatchType jacobianBatch;
+  this->InitializeJacobianBatch( jacobianBatch );
 
   /**
    * Compute maxJJ and jac*gradient
@@ -181,22 +174,18 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   const double          sqrt2             = vcl_sqrt( static_cast< double >( 2.0 ) );
   JacobianType          jacjjacj( outdim, outdim );
 
-  samplenr = 0;
-  for( iter = begin; iter != end; ++iter )
+  for( SizeValueType sample = 0; sample < nrofsamples; ++sample )
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Apply scales, if necessary. */
-    if( this->GetUseScales() )
+    /** Get the scaled Jacobian, computed per batch of samples. */
+    const SizeValueType batchIndex = sample % JacobianBatchSize;
+    if( batchIndex == 0 )
     {
-      for( unsigned int pi = 0; pi < sizejacind; ++pi )
-      {
-        const unsigned int p = jacind[ pi ];
-        jacj.scale_column( pi, 1.0 / scales[ p ] );
-      }
+      this->ComputeJacobianBatch( *sampleContainer, sample,
+        vnl_math_min( static_cast< SizeValueType >( JacobianBatchSize ), nrofsamples - sample ),
+        jacobianBatch );
     }
+    JacobianType &                     jacj   = jacobianBatch.st_Jacobians[ batchIndex ];
+    const NonZeroJacobianIndicesType & jacind = jacobianBatch.st_NonZeroJacobianIndices[ batchIndex ];
 
     /** Compute 1st part of JJ: ||J_j||_F^2. */
     double JJ_j = vnl_math_sqr( jacj.frobenius_norm() );
@@ -311,7 +300,7 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   this->GetScaledDerivative( mu, this->m_ExactGradient );
 
   /** Get samples. */
-  this->SampleFixedImageForJacobianTerms( this->m_SampleContainer );
+  this->m_SamplesForJacobianTerms = this->GetSamplesForJacobianTerms();
 
 } // end BeforeThreadedCompute()
 
@@ -325,13 +314,11 @@ void
 ComputeDisplacementDistribution< TFixedImage, TTransform >
 ::LaunchComputeThreaderCallback( void ) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->ComputeThreaderCallback,
+  /** Launch on the persistent thread pool. */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_Threader->GetNumberOfThreads(), this->ComputeThreaderCallback,
     const_cast< void * >( static_cast< const void * >( &this->m_ThreaderParameters ) ) );
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
-
 } // end LaunchComputeThreaderCallback()
 
 
@@ -368,13 +355,10 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
 ::ThreadedCompute( ThreadIdType threadId )
 {
   /** Get sample container size, number of threads, and output space dimension. */
-  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const SizeValueType sampleContainerSize = this->m_SamplesForJacobianTerms->Size();
   const ThreadIdType  numberOfThreads     = this->m_Threader->GetNumberOfThreads();
   const unsigned int  outdim              = this->m_Transform->GetOutputSpaceDimension();
 
-  /** Get a handle to the scales vector */
-  const ScalesType & scales = this->GetScales();
-
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads
     = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
@@ -385,14 +369,11 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
   pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
-  /** Variables for nonzerojacobian indices and the Jacobian. */
+  /** Variables for nonzerojacobian indices and the Jacobians. */
   const SizeValueType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-  jacind[ 0 ] = 0;
-  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
+  JacobianBatchType jacobianBatch;
+  this->InitializeJacobianBatch( jacobianBatch );
 
   /** Temporaries. */
   //std::vector< double > JGG_k; not here so only mean + 2 sigma is supported
@@ -405,30 +386,19 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   double         displacementSquared   = 0.0;
   unsigned long  numberOfPixelsCounted = 0;
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = this->m_SampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = this->m_SampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
-
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  /** Loop over the samples of this thread. */
+  for( SizeValueType sample = pos_begin; sample < pos_end; ++sample )
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *threader_fiter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Apply scales, if necessary. */
-    if( this->GetUseScales() )
+    /** Get the scaled Jacobian, computed per batch of samples. */
+    const SizeValueType batchIndex = ( sample - pos_begin ) % JacobianBatchSize;
+    if( batchIndex == 0 )
     {
-      for( unsigned int pi = 0; pi < sizejacind; ++pi )
-      {
-        const unsigned int p = jacind[ pi ];
-        jacj.scale_column( pi, 1.0 / scales[ p ] );
-      }
+      this->ComputeJacobianBatch( *this->m_SamplesForJacobianTerms, sample,
+        vnl_math_min( static_cast< SizeValueType >( JacobianBatchSize ), pos_end - sample ),
+        jacobianBatch );
     }
+    JacobianType &                     jacj   = jacobianBatch.st_Jacobians[ batchIndex ];
+    const NonZeroJacobianIndicesType & jacind = jacobianBatch.st_NonZeroJacobianIndices[ batchIndex ];
 
     /** Compute 1st part of JJ: ||J_j||_F^2. */
     double JJ_j = vnl_math_sqr( jacj.frobenius_norm() );
@@ -506,6 +476,9 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
 
   jacg = meanDisplacement + 2.0 * vcl_sqrt( sigma );
 
+  /** Release the samples. */
+  this->m_SamplesForJacobianTerms = 0;
+
 } // end AfterThreadedCompute()
 
 
@@ -529,9 +502,8 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   maxJJ = jacg = 0.0;
 
   /** Get samples. */
-  ImageSampleContainerPointer sampleContainer = 0;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
+  ImageSampleContainerConstPointer sampleContainer = this->GetSamplesForJacobianTerms();
+  const SizeValueType              nrofsamples     = sampleContainer->Size();
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
@@ -549,20 +521,13 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   typename TransformType::Pointer transform = this->m_Transform;
   const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
   unsigned int samplenr = 0;
 
-  /** Variables for nonzerojacobian indices and the Jacobian. */
+  /** Variables for nonzerojacobian indices and the Jacobians. */
   const SizeValueType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-  jacind[ 0 ] = 0;
-  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
+  JacobianBatchType jacobianBatch;
+  this->InitializeJacobianBatch( jacobianBatch );
 
   /**
    * Compute maxJJ and jac*gradient
@@ -571,24 +536,19 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   Jgg.Fill( 0.0 );
   std::vector< double > JGG_k;
   double                globalDeformation = 0.0;
-  JacobianType          jacjjacj( outdim, outdim );
 
-  samplenr = 0;
-  for( iter = begin; iter != end; ++iter )
+  for( SizeValueType sample = 0; sample < nrofsamples; ++sample )
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Apply scales, if necessary. */
-    if( this->GetUseScales() )
+    /** Get the scaled Jacobian, computed per batch of samples. */
+    const SizeValueType batchIndex = sample % JacobianBatchSize;
+    if( batchIndex == 0 )
     {
-      for( unsigned int pi = 0; pi < sizejacind; ++pi )
-      {
-        const unsigned int p = jacind[ pi ];
-        jacj.scale_column( pi, 1.0 / scales[ p ] );
-      }
+      this->ComputeJacobianBatch( *sampleContainer, sample,
+        vnl_math_min( static_cast< SizeValueType >( JacobianBatchSize ), nrofsamples - sample ),
+        jacobianBatch );
     }
+    const JacobianType &               jacj   = jacobianBatch.st_Jacobians[ batchIndex ];
+    const NonZeroJacobianIndicesType & jacind = jacobianBatch.st_NonZeroJacobianIndices[ batchIndex ];
 
     /** Compute the matrix of jac*gradient */
     for( unsigned int i = 0; i < outdim; ++i )
@@ -630,6 +590,93 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
 } // end ComputeUsingSearchDirection()
 
 
+/**
+ * ************************* InitializeJacobianBatch ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeDisplacementDistribution< TFixedImage, TTransform >
+::InitializeJacobianBatch( JacobianBatchType & batch ) const
+{
+  const unsigned int  outdim     = this->m_Transform->GetOutputSpaceDimension();
+  const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  batch.st_Points.resize( JacobianBatchSize );
+  batch.st_Jacobians.assign( JacobianBatchSize, jacj );
+  batch.st_NonZeroJacobianIndices.assign( JacobianBatchSize,
+    NonZeroJacobianIndicesType( sizejacind ) );
+
+} // end InitializeJacobianBatch()
+
+
+/**
+ * ************************* ComputeJacobianBatch ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeDisplacementDistribution< TFixedImage, TTransform >
+::ComputeJacobianBatch( const ImageSampleContainerType & samples,
+  const SizeValueType begin, const SizeValueType n, JacobianBatchType & batch ) const
+{
+  /** Compute the Jacobians of the batch at once. */
+  for( SizeValueType i = 0; i < n; ++i )
+  {
+    const FixedImagePointType & point = samples.ElementAt( begin + i ).m_ImageCoordinates;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      batch.st_Points[ i ][ d ] = point[ d ];
+    }
+  }
+  this->m_Transform->GetJacobians( n, &batch.st_Points[ 0 ],
+    &batch.st_Jacobians[ 0 ], &batch.st_NonZeroJacobianIndices[ 0 ] );
+
+  /** Apply scales, if necessary. */
+  if( this->GetUseScales() )
+  {
+    const ScalesType & scales = this->GetScales();
+    for( SizeValueType i = 0; i < n; ++i )
+    {
+      const NonZeroJacobianIndicesType & jacind = batch.st_NonZeroJacobianIndices[ i ];
+      for( unsigned int pi = 0; pi < jacind.size(); ++pi )
+      {
+        batch.st_Jacobians[ i ].scale_column( pi, 1.0 / scales[ jacind[ pi ] ] );
+      }
+    }
+  }
+
+} // end ComputeJacobianBatch()
+
+
+/**
+ * ************************* GetSamplesForJacobianTerms ************************
+ */
+
+template< class TFixedImage, class TTransform >
+typename ComputeDisplacementDistribution< TFixedImage, TTransform >::ImageSampleContainerConstPointer
+ComputeDisplacementDistribution< TFixedImage, TTransform >
+::GetSamplesForJacobianTerms( void )
+{
+  ImageSampleContainerConstPointer sampleContainer = this->m_SampleContainer;
+  if( sampleContainer.IsNull() )
+  {
+    ImageSampleContainerPointer gridSampleContainer = 0;
+    this->SampleFixedImageForJacobianTerms( gridSampleContainer );
+    sampleContainer = gridSampleContainer.GetPointer();
+  }
+  if( sampleContainer->Size() == 0 )
+  {
+    itkExceptionMacro( << "No samples given to estimate the AdaptiveStochasticGradientDescent parameters." );
+  }
+
+  return sampleContainer;
+
+} // end GetSamplesForJacobianTerms()
+
+
 /**
  * ************************* SampleFixedImageForJacobianTerms ************************
  */
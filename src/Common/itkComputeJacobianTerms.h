@@ -22,6 +22,10 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkPersistentThreadPool.h"
+#include "itkSimpleFastMutexLock.h"
+#include "vnl/vnl_diag_matrix.h"
+#include "vnl/vnl_sparse_matrix.h"
 
 namespace itk
 {
@@ -31,6 +35,12 @@ namespace itk
  * More specifically this class computes the Jacobian terms related to the automatic
  * parameter estimation for the adaptive stochastic gradient descent optimizer.
  * Details can be found in the paper.
+ *
+ * The Jacobians of the samples are computed in parallel, by the threads of the
+ * PersistentThreadPool. By default the samples are taken on a grid with
+ * approximately NumberOfJacobianMeasurements points; alternatively the
+ * samples of another sampler, e.g. that of the metric, can be passed with
+ * SetSampleContainer().
  */
 
 template< class TFixedImage, class TTransform >
@@ -103,10 +113,25 @@ public:
   /** Get the region over which the metric will be computed. */
   itkGetConstReferenceMacro( FixedImageRegion, FixedImageRegionType );
 
+  /** Typedef for the samples. */
+  typedef ImageSamplerBase< FixedImageType >                    ImageSamplerBaseType;
+  typedef typename ImageSamplerBaseType::ImageSampleContainerType ImageSampleContainerType;
+
+  /** Set the samples at which the Jacobians are computed, instead of sampling
+   * the fixed image on a grid. Set to 0 to use the grid again. Default: 0.
+   */
+  itkSetConstObjectMacro( SampleContainer, ImageSampleContainerType );
+
   /** The main functions that performs the computation. */
   virtual void Compute( double & TrC, double & TrCC,
     double & maxJJ, double & maxJCJ );
 
+  /** Compute only the diagonal of the covariance matrix C = 1/n \sum_j J_j^T J_j,
+   * i.e. the mean squared Jacobian of each parameter. It may serve as a
+   * diagonal preconditioner. The scales are not applied.
+   */
+  virtual void ComputeDiagonalOfCovariance( ScalesType & diagonal );
+
 protected:
 
   ComputeJacobianTerms();
@@ -127,18 +152,17 @@ protected:
   typedef typename  FixedImageType::PointType   FixedImagePointType;
   typedef typename  TransformType::JacobianType JacobianType;
   typedef typename  JacobianType::ValueType     JacobianValueType;
+  typedef typename  TransformType::CompressedJacobianType CompressedJacobianType;
 
   /** Samplers. */
-  typedef ImageSamplerBase< FixedImageType >           ImageSamplerBaseType;
   typedef typename ImageSamplerBaseType::Pointer       ImageSamplerBasePointer;
   typedef ImageRandomSamplerBase< FixedImageType >     ImageRandomSamplerBaseType;
   typedef typename ImageRandomSamplerBaseType::Pointer ImageRandomSamplerBasePointer;
 
   typedef ImageGridSampler< FixedImageType >     ImageGridSamplerType;
   typedef typename ImageGridSamplerType::Pointer ImageGridSamplerPointer;
-  typedef typename ImageGridSamplerType
-    ::ImageSampleContainerType ImageSampleContainerType;
-  typedef typename ImageSampleContainerType::Pointer ImageSampleContainerPointer;
+  typedef typename ImageSampleContainerType::Pointer      ImageSampleContainerPointer;
+  typedef typename ImageSampleContainerType::ConstPointer ImageSampleContainerConstPointer;
 
   /** Typedefs for support of sparse Jacobians and AdvancedTransforms. */
   typedef JacobianType                                   TransformJacobianType;
@@ -151,6 +175,81 @@ protected:
   virtual void SampleFixedImageForJacobianTerms(
     ImageSampleContainerPointer & sampleContainer );
 
+  /** Get the samples that were set, or else sample the fixed image on a grid. */
+  virtual ImageSampleContainerConstPointer GetSamplesForJacobianTerms( void );
+
+  ImageSampleContainerConstPointer m_SampleContainer;
+
+  /** Typedefs for the covariance matrix. */
+  typedef double                                   CovarianceValueType;
+  typedef Array2D< CovarianceValueType >           CovarianceMatrixType;
+  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
+  typedef SparseCovarianceMatrixType::row          SparseRowType;
+  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
+
+  /** The data shared by the threads of Compute(). */
+  struct ComputePassType
+  {
+    const Self *                        m_Self;
+    const ImageSampleContainerType *    m_SampleContainer;
+    double                              m_NumberOfSamples;
+    SparseCovarianceMatrixType *        m_Covariance;
+    CovarianceMatrixType *              m_BandCovariance;
+    const std::vector< unsigned int > * m_BandCovarianceMap;
+    unsigned int                        m_BandCovarianceSize;
+    SimpleFastMutexLock *               m_CovarianceLock;
+    const DiagCovarianceMatrixType *    m_DiagonalCovariance;
+    std::vector< double > *             m_MaxJJ;
+    std::vector< double > *             m_MaxJCJ;
+  };
+
+  /** The data shared by the threads of ComputeDiagonalOfCovariance(). */
+  struct DiagonalPassType
+  {
+    const Self *                     m_Self;
+    const ImageSampleContainerType * m_SampleContainer;
+    ScalesType *                     m_Diagonal;
+    SimpleFastMutexLock *            m_DiagonalLock;
+  };
+
+  /** Range function that adds the squared Jacobians of a range of samples
+   * to the diagonal of the covariance matrix.
+   */
+  static void DiagonalRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Range function that accumulates J_j^T J_j of a range of samples into the
+   * covariance matrix (term 1).
+   */
+  static void CovarianceRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Add the sum of J_j^T J_j / n of samples with equal nonzero Jacobian
+   * indices to the covariance matrix, under the covariance lock.
+   */
+  static void AddToCovariance( const ComputePassType & pass,
+    const CovarianceMatrixType & jactjac, const NonZeroJacobianIndicesType & jacind );
+
+  /** The same as CovarianceRangeFunction(), for transforms with a compressed
+   * Jacobian. J_j^T J_j then consists of the block w w^T for every dimension,
+   * with w the weights, so only that block is accumulated.
+   */
+  static void CompressedCovarianceRange( const ComputePassType & pass,
+    SizeValueType begin, SizeValueType end );
+
+  /** Add the sum of w w^T / n of samples with equal compressed Jacobian
+   * indices to the covariance matrix, for every dimension, under the
+   * covariance lock.
+   */
+  static void AddCompressedToCovariance( const ComputePassType & pass,
+    const CovarianceMatrixType & wwt, const CompressedJacobianType & compressedJacobian );
+
+  /** Range function that computes the maximum of JJ_j and JCJ_j over a
+   * range of samples (terms 3 and 4).
+   */
+  static void MaximaRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
 private:
 
   ComputeJacobianTerms( const Self & ); // purposely not implemented
@@ -22,8 +22,8 @@
 
 #include "vnl/vnl_math.h"
 #include "vnl/vnl_fastops.h"
-#include "vnl/vnl_diag_matrix.h"
-#include "vnl/vnl_sparse_matrix.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -44,6 +44,7 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   this->m_MaxBandCovSize               = 0;
   this->m_NumberOfBandStructureSamples = 0;
   this->m_NumberOfJacobianMeasurements = 0;
+  this->m_SampleContainer              = 0;
 
 } // end Constructor
 
@@ -73,41 +74,23 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * Term 4: maxJCJ, see (54)
    */
 
-  typedef double                                   CovarianceValueType;
-  typedef itk::Array2D< CovarianceValueType >      CovarianceMatrixType;
-  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
-  typedef SparseCovarianceMatrixType::row          SparseRowType;
-  typedef itk::Array< SizeValueType >              NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
-  /** Get samples. */
-  ImageSampleContainerPointer sampleContainer = 0;
-  SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-  const double        n           = static_cast< double >( nrofsamples );
+  /** Get samples, the given ones or samples on a grid. */
+  ImageSampleContainerConstPointer sampleContainer = this->GetSamplesForJacobianTerms();
+  const SizeValueType              nrofsamples     = sampleContainer->Size();
+  const double                     n               = static_cast< double >( nrofsamples );
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
 
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform
-    = this->m_Transform;
-  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
-
   /** Get scales vector */
   const ScalesType & scales = this->m_Scales;
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-  unsigned int samplenr = 0;
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
   NumberOfParametersType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
   JacobianType jacj( outdim, sizejacind );
@@ -115,17 +98,12 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   NonZeroJacobianIndicesType jacind( sizejacind );
   jacind[ 0 ] = 0;
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  NonZeroJacobianIndicesType prevjacind = jacind;
 
   /** Initialize covariance matrix. Sparse, diagonal, and band form. */
   SparseCovarianceMatrixType cov( P, P );
   DiagCovarianceMatrixType   diagcov( P, 0.0 );
   CovarianceMatrixType       bandcov;
 
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac( sizejacind, sizejacind );
-  jactjac.Fill( 0.0 );
-
   typedef std::vector< unsigned int >             DifHistType;
   typedef std::pair< unsigned int, unsigned int > FreqPairType;
   typedef std::vector< FreqPairType >             DifHist2Type;
@@ -163,7 +141,7 @@ ComputeJacobianTerms< TFixedImage, TTransform >
 
     /** Read fixed coordinates and get Jacobian J_j. */
     const FixedImagePointType & point
-      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
+      = sampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
     this->m_Transform->GetJacobian( point, jacj, jacind );
 
     /** Skip invalid Jacobians in the beginning, if any. */
@@ -220,6 +198,26 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   bandcov = CovarianceMatrixType( P, bandcovsize );
   bandcov.Fill( 0.0 );
 
+  /** The data shared by the threads. */
+  PersistentThreadPool * threadPool      = PersistentThreadPool::GetInstance();
+  const ThreadIdType     numberOfThreads = threadPool->GetNumberOfThreads();
+  SimpleFastMutexLock    covarianceLock;
+  std::vector< double >  maxJJs( numberOfThreads, 0.0 );
+  std::vector< double >  maxJCJs( numberOfThreads, 0.0 );
+
+  ComputePassType pass;
+  pass.m_Self               = this;
+  pass.m_SampleContainer    = sampleContainer.GetPointer();
+  pass.m_NumberOfSamples    = n;
+  pass.m_Covariance         = &cov;
+  pass.m_BandCovariance     = &bandcov;
+  pass.m_BandCovarianceMap  = &bandcovMap;
+  pass.m_BandCovarianceSize = bandcovsize;
+  pass.m_CovarianceLock     = &covarianceLock;
+  pass.m_DiagonalCovariance = &diagcov;
+  pass.m_MaxJJ              = &maxJJs;
+  pass.m_MaxJCJ             = &maxJCJs;
+
   /**
    *    TERM 1
    *
@@ -227,97 +225,7 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * Compute C = 1/n \sum_i J_i^T J_i
    * Possibly apply scaling afterwards.
    */
-  jacind[ 0 ] = 0;
-  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Print progress 0-50%.
-     *progressObserver->UpdateAndPrintProgress( samplenr );*/
-    ++samplenr;
-
-    /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind  );
-
-    /** Skip invalid Jacobians in the beginning, if any. */
-    if( sizejacind > 1 )
-    {
-      if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
-    }
-
-    if( jacind == prevjacind )
-    {
-      /** Update sum of J_j^T J_j. */
-      vnl_fastops::inc_X_by_AtA( jactjac, jacj );
-    }
-    else
-    {
-      /** The following should only be done after the first sample. */
-      if( iter != begin )
-      {
-        /** Update covariance matrix. */
-        for( unsigned int pi = 0; pi < sizejacind; ++pi )
-        {
-          const unsigned int p = prevjacind[ pi ];
-          for( unsigned int qi = 0; qi < sizejacind; ++qi )
-          {
-            const unsigned int q = prevjacind[ qi ];
-            if( q >= p )
-            {
-              const double tempval = jactjac( pi, qi ) / n;
-              if( vcl_abs( tempval ) > 1e-14 )
-              {
-                const unsigned int bandindex = bandcovMap[ q - p ];
-                if( bandindex < bandcovsize )
-                {
-                  bandcov( p, bandindex ) += tempval;
-                }
-                else
-                {
-                  cov( p, q ) += tempval;
-                }
-              }
-            }
-          } // qi
-        }   // pi
-      }     // end if
-
-      /** Initialize jactjac by J_j^T J_j. */
-      vnl_fastops::AtA( jactjac, jacj );
-
-      /** Remember nonzerojacobian indices. */
-      prevjacind = jacind;
-    } // end else
-
-  } // end iter loop: end computation of covariance matrix
-
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for( unsigned int pi = 0; pi < sizejacind; ++pi )
-  {
-    const unsigned int p = prevjacind[ pi ];
-    for( unsigned int qi = 0; qi < sizejacind; ++qi )
-    {
-      const unsigned int q = prevjacind[ qi ];
-      if( q >= p )
-      {
-        const double tempval = jactjac( pi, qi ) / n;
-        if( vcl_abs( tempval ) > 1e-14 )
-        {
-          const unsigned int bandindex = bandcovMap[ q - p ];
-          if( bandindex < bandcovsize )
-          {
-            bandcov( p, bandindex ) += tempval;
-          }
-          else
-          {
-            cov( p, q ) += tempval;
-          }
-        }
-      }
-    } // qi
-  }   // pi
+  threadPool->ParallelFor( nrofsamples, 0, CovarianceRangeFunction, &pass );
 
   /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
    * \todo: perhaps work further with this bandmatrix instead.
@@ -389,28 +297,303 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * Compute maxJJ and maxJCJ
    * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
    * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
+   * The covariance matrix is only read by the threads.
+   */
+  threadPool->ParallelFor( nrofsamples, 0, MaximaRangeFunction, &pass );
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    maxJJ  = vnl_math_max( maxJJ, maxJJs[ t ] );
+    maxJCJ = vnl_math_max( maxJCJ, maxJCJs[ t ] );
+  }
+
+} // end Compute()
+
+
+/**
+ * ************************* CovarianceRangeFunction ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::CovarianceRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const ComputePassType & pass      = *static_cast< const ComputePassType * >( userData );
+  const TransformType *   transform = pass.m_Self->m_Transform.GetPointer();
+  if( transform->GetSupportsCompressedJacobian() )
+  {
+    CompressedCovarianceRange( pass, begin, end );
+    return;
+  }
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const unsigned int           outdim     = transform->GetOutputSpaceDimension();
+  const NumberOfParametersType sizejacind = transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType                 jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  NonZeroJacobianIndicesType prevjacind;
+
+  /** For temporary storage of J'J. */
+  CovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.Fill( 0.0 );
+
+  for( SizeValueType samplenr = begin; samplenr < end; ++samplenr )
+  {
+    /** Read fixed coordinates and get Jacobian J_j. */
+    const FixedImagePointType & point
+      = pass.m_SampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
+    jacind[ 0 ] = 0;
+    if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
+    transform->GetJacobian( point, jacj, jacind );
+
+    /** Skip invalid Jacobians, if any. */
+    if( sizejacind > 1 )
+    {
+      if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
+    }
+
+    if( jacind == prevjacind )
+    {
+      /** Update sum of J_j^T J_j. */
+      vnl_fastops::inc_X_by_AtA( jactjac, jacj );
+    }
+    else
+    {
+      /** Add the previous samples to the covariance matrix. */
+      if( !prevjacind.empty() )
+      {
+        AddToCovariance( pass, jactjac, prevjacind );
+      }
+
+      /** Initialize jactjac by J_j^T J_j. */
+      vnl_fastops::AtA( jactjac, jacj );
+
+      /** Remember nonzerojacobian indices. */
+      prevjacind = jacind;
+    }
+  }
+
+  /** Add the last samples of this range. */
+  if( !prevjacind.empty() )
+  {
+    AddToCovariance( pass, jactjac, prevjacind );
+  }
+
+} // end CovarianceRangeFunction()
+
+
+/**
+ * ************************* AddToCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::AddToCovariance( const ComputePassType & pass,
+  const CovarianceMatrixType & jactjac, const NonZeroJacobianIndicesType & jacind )
+{
+  const unsigned int                  sizejacind  = jacind.size();
+  const double                        n           = pass.m_NumberOfSamples;
+  const unsigned int                  bandcovsize = pass.m_BandCovarianceSize;
+  const std::vector< unsigned int > & bandcovMap  = *pass.m_BandCovarianceMap;
+  SparseCovarianceMatrixType &        cov         = *pass.m_Covariance;
+  CovarianceMatrixType &              bandcov     = *pass.m_BandCovariance;
+
+  pass.m_CovarianceLock->Lock();
+  for( unsigned int pi = 0; pi < sizejacind; ++pi )
+  {
+    const unsigned int p = jacind[ pi ];
+    for( unsigned int qi = 0; qi < sizejacind; ++qi )
+    {
+      const unsigned int q = jacind[ qi ];
+      if( q >= p )
+      {
+        const double tempval = jactjac( pi, qi ) / n;
+        if( vcl_abs( tempval ) > 1e-14 )
+        {
+          const unsigned int bandindex = bandcovMap[ q - p ];
+          if( bandindex < bandcovsize )
+          {
+            bandcov( p, bandindex ) += tempval;
+          }
+          else
+          {
+            cov( p, q ) += tempval;
+          }
+        }
+      }
+    } // qi
+  }   // pi
+  pass.m_CovarianceLock->Unlock();
+
+} // end AddToCovariance()
+
+
+/**
+ * ************************* CompressedCovarianceRange ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::CompressedCovarianceRange( const ComputePassType & pass,
+  SizeValueType begin, SizeValueType end )
+{
+  const TransformType *  transform = pass.m_Self->m_Transform.GetPointer();
+  CompressedJacobianType compressedJacobian;
+  CompressedJacobianType previous;
+  CovarianceMatrixType   wwt;
+
+  for( SizeValueType samplenr = begin; samplenr < end; ++samplenr )
+  {
+    /** Read fixed coordinates and get the compressed Jacobian. */
+    const FixedImagePointType & point
+      = pass.m_SampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
+    transform->GetCompressedJacobian( point, compressedJacobian );
+    const std::vector< double > & w = compressedJacobian.m_Weights;
+    const unsigned int            S = w.size();
+
+    if( compressedJacobian.m_Indices != previous.m_Indices
+      || compressedJacobian.m_ParametersPerDimension != previous.m_ParametersPerDimension )
+    {
+      /** Add the previous samples to the covariance matrix. */
+      if( !previous.m_Indices.empty() )
+      {
+        AddCompressedToCovariance( pass, wwt, previous );
+      }
+      previous.m_Indices                = compressedJacobian.m_Indices;
+      previous.m_ParametersPerDimension = compressedJacobian.m_ParametersPerDimension;
+      wwt.SetSize( S, S );
+      wwt.Fill( 0.0 );
+    }
+
+    /** Update the sum of w w^T. */
+    for( unsigned int ki = 0; ki < S; ++ki )
+    {
+      for( unsigned int kj = 0; kj < S; ++kj )
+      {
+        wwt( ki, kj ) += w[ ki ] * w[ kj ];
+      }
+    }
+  }
+
+  /** Add the last samples of this range. */
+  if( !previous.m_Indices.empty() )
+  {
+    AddCompressedToCovariance( pass, wwt, previous );
+  }
+
+} // end CompressedCovarianceRange()
+
+
+/**
+ * ************************* AddCompressedToCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::AddCompressedToCovariance( const ComputePassType & pass,
+  const CovarianceMatrixType & wwt, const CompressedJacobianType & compressedJacobian )
+{
+  const NonZeroJacobianIndicesType &  indices     = compressedJacobian.m_Indices;
+  const unsigned int                  S           = indices.size();
+  const unsigned int                  outdim      = pass.m_Self->m_Transform->GetOutputSpaceDimension();
+  const double                        n           = pass.m_NumberOfSamples;
+  const unsigned int                  bandcovsize = pass.m_BandCovarianceSize;
+  const std::vector< unsigned int > & bandcovMap  = *pass.m_BandCovarianceMap;
+  SparseCovarianceMatrixType &        cov         = *pass.m_Covariance;
+  CovarianceMatrixType &              bandcov     = *pass.m_BandCovariance;
+
+  /** The blocks of different dimensions are zero, so only the blocks on the
+   * diagonal of J_j^T J_j are added.
    */
-  maxJJ  = 0.0;
-  maxJCJ = 0.0;
-  const double sqrt2 = vcl_sqrt( static_cast< double >( 2.0 ) );
-
-  JacobianType                       jacjjacj( outdim, outdim );
-  JacobianType                       jacjcov( outdim, sizejacind );
-  DiagCovarianceMatrixType           diagcovsparse( sizejacind );
-  JacobianType                       jacjdiagcov( outdim, sizejacind );
-  JacobianType                       jacjdiagcovjacj( outdim, outdim );
-  JacobianType                       jacjcovjacj( outdim, outdim );
-  NonZeroJacobianIndicesExpandedType jacindExpanded( P );
-
-  samplenr = 0;
-  for( iter = begin; iter != end; ++iter )
+  pass.m_CovarianceLock->Lock();
+  for( unsigned int d = 0; d < outdim; ++d )
+  {
+    const unsigned long offset = d * compressedJacobian.m_ParametersPerDimension;
+    for( unsigned int ki = 0; ki < S; ++ki )
+    {
+      const unsigned int p = indices[ ki ] + offset;
+      for( unsigned int kj = 0; kj < S; ++kj )
+      {
+        const unsigned int q = indices[ kj ] + offset;
+        if( q >= p )
+        {
+          const double tempval = wwt( ki, kj ) / n;
+          if( vcl_abs( tempval ) > 1e-14 )
+          {
+            const unsigned int bandindex = bandcovMap[ q - p ];
+            if( bandindex < bandcovsize )
+            {
+              bandcov( p, bandindex ) += tempval;
+            }
+            else
+            {
+              cov( p, q ) += tempval;
+            }
+          }
+        }
+      } // kj
+    }   // ki
+  }     // d
+  pass.m_CovarianceLock->Unlock();
+
+} // end AddCompressedToCovariance()
+
+
+/**
+ * ************************* MaximaRangeFunction ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::MaximaRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  const ComputePassType &          pass      = *static_cast< const ComputePassType * >( userData );
+  const Self *                     self      = pass.m_Self;
+  const TransformType *            transform = self->m_Transform.GetPointer();
+  const ScalesType &               scales    = self->m_Scales;
+  SparseCovarianceMatrixType &     cov       = *pass.m_Covariance;
+  const DiagCovarianceMatrixType & diagcov   = *pass.m_DiagonalCovariance;
+  const double                     sqrt2     = vcl_sqrt( static_cast< double >( 2.0 ) );
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const unsigned int           outdim     = transform->GetOutputSpaceDimension();
+  const NumberOfParametersType sizejacind = transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType                 jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+
+  JacobianType             jacjjacj( outdim, outdim );
+  JacobianType             jacjcov( outdim, sizejacind );
+  DiagCovarianceMatrixType diagcovsparse( sizejacind );
+  JacobianType             jacjdiagcov( outdim, sizejacind );
+  JacobianType             jacjdiagcovjacj( outdim, outdim );
+  JacobianType             jacjcovjacj( outdim, outdim );
+
+  /** The nonzero Jacobian indices with their position, sorted on index, to
+   * find the entries of the sparse cov rows (which are sorted on column) by
+   * merging, instead of with a lookup table of the length of the parameters.
+   */
+  typedef std::pair< unsigned long, unsigned int > IndexPositionPairType;
+  std::vector< IndexPositionPairType > sortedjacind( sizejacind );
+
+  double maxJJ  = 0.0;
+  double maxJCJ = 0.0;
+  for( SizeValueType samplenr = begin; samplenr < end; ++samplenr )
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind  );
+    const FixedImagePointType & point
+      = pass.m_SampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
+    transform->GetJacobian( point, jacj, jacind );
 
     /** Apply scales, if necessary. */
-    if( this->m_UseScales )
+    if( self->m_UseScales )
     {
       for( unsigned int pi = 0; pi < sizejacind; ++pi )
       {
@@ -438,13 +621,13 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     /** Store the nonzero Jacobian indices in a different format
      * and create the sparse diagcov.
      */
-    jacindExpanded.Fill( sizejacind );
     for( unsigned int pi = 0; pi < sizejacind; ++pi )
     {
       const unsigned int p = jacind[ pi ];
-      jacindExpanded[ p ] = pi;
+      sortedjacind[ pi ]  = IndexPositionPairType( p, pi );
       diagcovsparse[ pi ] = diagcov[ p ];
     }
+    std::sort( sortedjacind.begin(), sortedjacind.end() );
 
     /** We below calculate jacjC = J_j cov^T, but later we will correct
      * for this using:
@@ -457,24 +640,34 @@ ComputeJacobianTerms< TFixedImage, TTransform >
       if( !cov.empty_row( p ) )
       {
         SparseRowType & covrowp = cov.get_row( p );
-        typename SparseRowType::iterator covrowpit;
+        SparseRowType::iterator covrowpit = covrowp.begin();
+        std::vector< IndexPositionPairType >::const_iterator jacindit = sortedjacind.begin();
 
-        /** Loop over row p of the sparse cov matrix. */
-        for( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
+        /** Merge row p of the sparse cov matrix with the sorted indices. */
+        while( covrowpit != covrowp.end() && jacindit != sortedjacind.end() )
         {
-          const unsigned int q  = ( *covrowpit ).first;
-          const unsigned int qi = jacindExpanded[ q ];
-
-          if( qi < sizejacind )
+          const unsigned long q = ( *covrowpit ).first;
+          if( q < jacindit->first )
+          {
+            ++covrowpit;
+          }
+          else if( q > jacindit->first )
+          {
+            ++jacindit;
+          }
+          else
           {
             /** If found, update the jacjC matrix. */
+            const unsigned int        qi         = jacindit->second;
             const CovarianceValueType covElement = ( *covrowpit ).second;
             for( unsigned int dx = 0; dx < outdim; ++dx )
             {
               jacjcov[ dx ][ pi ] += jacj[ dx ][ qi ] * covElement;
             } //dx
-          }   // if qi < sizejacind
-        }     // for covrow
+            ++covrowpit;
+            ++jacindit;
+          }
+        } // while
 
       } // if not empty row
     }   // pi
@@ -502,16 +695,164 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     /** Max_j [JCJ_j]. */
     maxJCJ = vnl_math_max( maxJCJ, JCJ_j );
 
-    /** Show progress 50-100%. */
-    //progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
+  } // end loop over the range of samples
 
-  } // end loop over sample container
+  /** Merge with the maxima of the other ranges of this thread. */
+  ( *pass.m_MaxJJ )[ participantId ]  = vnl_math_max( ( *pass.m_MaxJJ )[ participantId ], maxJJ );
+  ( *pass.m_MaxJCJ )[ participantId ] = vnl_math_max( ( *pass.m_MaxJCJ )[ participantId ], maxJCJ );
 
-  /** Finalize progress information. */
-  //progressObserver->PrintProgress( 1.0 );
+} // end MaximaRangeFunction()
 
-} // end Compute()
+
+/**
+ * ************************* ComputeDiagonalOfCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeDiagonalOfCovariance( ScalesType & diagonal )
+{
+  ImageSampleContainerConstPointer sampleContainer = this->GetSamplesForJacobianTerms();
+
+  diagonal.SetSize( this->m_Transform->GetNumberOfParameters() );
+  diagonal.Fill( 0.0 );
+
+  SimpleFastMutexLock diagonalLock;
+  DiagonalPassType    pass;
+  pass.m_Self            = this;
+  pass.m_SampleContainer = sampleContainer.GetPointer();
+  pass.m_Diagonal        = &diagonal;
+  pass.m_DiagonalLock    = &diagonalLock;
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    sampleContainer->Size(), 0, DiagonalRangeFunction, &pass );
+
+  diagonal /= static_cast< double >( sampleContainer->Size() );
+
+} // end ComputeDiagonalOfCovariance()
+
+
+/**
+ * ************************* DiagonalRangeFunction ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::DiagonalRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const DiagonalPassType & pass      = *static_cast< const DiagonalPassType * >( userData );
+  const TransformType *    transform = pass.m_Self->m_Transform.GetPointer();
+
+  const unsigned int           outdim     = transform->GetOutputSpaceDimension();
+  const NumberOfParametersType sizejacind = transform->GetNumberOfNonZeroJacobianIndices();
+  const bool                   compressed = transform->GetSupportsCompressedJacobian();
+  CompressedJacobianType       compressedJacobian;
+
+  /** The Jacobians are computed in batches with GetJacobians(). */
+  const SizeValueType batchSize = 64;
+  JacobianType        jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  std::vector< typename TransformType::InputPointType > points( batchSize );
+  std::vector< JacobianType >                          jacs( compressed ? 0 : batchSize, jacj );
+  std::vector< NonZeroJacobianIndicesType >            jacinds( compressed ? 0 : batchSize,
+    NonZeroJacobianIndicesType( sizejacind ) );
+
+  /** Buffer the contributions, to add them under the lock in large batches. */
+  typedef std::pair< unsigned long, double > ContributionType;
+  std::vector< ContributionType > contributions;
+  const std::size_t               maximumNumberOfContributions = 16384;
+  contributions.reserve( maximumNumberOfContributions + batchSize * sizejacind );
+
+  for( SizeValueType batchBegin = begin; batchBegin < end; batchBegin += batchSize )
+  {
+    const SizeValueType n = std::min( batchSize, end - batchBegin );
+    for( SizeValueType i = 0; i < n; ++i )
+    {
+      const FixedImagePointType & point
+        = pass.m_SampleContainer->ElementAt( batchBegin + i ).m_ImageCoordinates;
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        points[ i ][ d ] = point[ d ];
+      }
+    }
+
+    /** With a compressed Jacobian, the squared norm of column d * S + k is
+     * the squared weight k, for every dimension d.
+     */
+    for( SizeValueType i = 0; compressed && i < n; ++i )
+    {
+      transform->GetCompressedJacobian( points[ i ], compressedJacobian );
+      const NumberOfParametersType ppd = compressedJacobian.m_ParametersPerDimension;
+      for( unsigned int k = 0; k < compressedJacobian.m_Weights.size(); ++k )
+      {
+        const double squaredWeight = vnl_math_sqr( compressedJacobian.m_Weights[ k ] );
+        for( unsigned int d = 0; d < outdim; ++d )
+        {
+          contributions.push_back( ContributionType(
+            compressedJacobian.m_Indices[ k ] + d * ppd, squaredWeight ) );
+        }
+      }
+    }
+    if( !compressed )
+    {
+      transform->GetJacobians( n, &points[ 0 ], &jacs[ 0 ], &jacinds[ 0 ] );
+    }
+
+    for( SizeValueType i = 0; !compressed && i < n; ++i )
+    {
+      const NonZeroJacobianIndicesType & jacind = jacinds[ i ];
+      for( unsigned int pi = 0; pi < jacind.size(); ++pi )
+      {
+        double squaredNorm = 0.0;
+        for( unsigned int d = 0; d < outdim; ++d )
+        {
+          squaredNorm += vnl_math_sqr( jacs[ i ][ d ][ pi ] );
+        }
+        contributions.push_back( ContributionType( jacind[ pi ], squaredNorm ) );
+      }
+    }
+
+    if( contributions.size() >= maximumNumberOfContributions || batchBegin + n == end )
+    {
+      pass.m_DiagonalLock->Lock();
+      for( std::size_t i = 0; i < contributions.size(); ++i )
+      {
+        ( *pass.m_Diagonal )[ contributions[ i ].first ] += contributions[ i ].second;
+      }
+      pass.m_DiagonalLock->Unlock();
+      contributions.clear();
+    }
+  }
+
+} // end DiagonalRangeFunction()
+
+
+/**
+ * ************************* GetSamplesForJacobianTerms ************************
+ */
+
+template< class TFixedImage, class TTransform >
+typename ComputeJacobianTerms< TFixedImage, TTransform >::ImageSampleContainerConstPointer
+ComputeJacobianTerms< TFixedImage, TTransform >
+::GetSamplesForJacobianTerms( void )
+{
+  ImageSampleContainerConstPointer sampleContainer = this->m_SampleContainer;
+  if( sampleContainer.IsNull() )
+  {
+    ImageSampleContainerPointer gridSampleContainer = 0;
+    this->SampleFixedImageForJacobianTerms( gridSampleContainer );
+    sampleContainer = gridSampleContainer.GetPointer();
+  }
+  if( sampleContainer->Size() == 0 )
+  {
+    itkExceptionMacro( << "No samples given to estimate the AdaptiveStochasticGradientDescent parameters." );
+  }
+
+  return sampleContainer;
+
+} // end GetSamplesForJacobianTerms()
 
 
 /**
@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkDistributedComputation_cxx
+#define __itkDistributedComputation_cxx
+
+#include "itkDistributedComputation.h"
+#include "itkSimpleFastMutexLock.h"
+
+#ifdef ELASTIX_USE_MPI
+#include <mpi.h>
+#include <algorithm>
+#include <limits>
+#endif
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+DistributedComputation::Pointer
+DistributedComputation
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+DistributedComputation
+::DistributedComputation()
+{
+  this->m_Rank          = 0;
+  this->m_NumberOfRanks = 1;
+
+#ifdef ELASTIX_USE_MPI
+  int initialized = 0;
+  MPI_Initialized( &initialized );
+  if( initialized )
+  {
+    int rank          = 0;
+    int numberOfRanks = 1;
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+    MPI_Comm_size( MPI_COMM_WORLD, &numberOfRanks );
+    this->m_Rank          = static_cast< unsigned int >( rank );
+    this->m_NumberOfRanks = static_cast< unsigned int >( numberOfRanks );
+  }
+#endif
+
+} // end Constructor
+
+
+/**
+ * ****************** Initialize *********************************
+ */
+
+void
+DistributedComputation
+::Initialize( int * argc, char *** argv )
+{
+#ifdef ELASTIX_USE_MPI
+  int initialized = 0;
+  MPI_Initialized( &initialized );
+  if( !initialized )
+  {
+    /** Only the main thread communicates. */
+    int provided = 0;
+    MPI_Init_thread( argc, argv, MPI_THREAD_FUNNELED, &provided );
+  }
+#else
+  (void)argc;
+  (void)argv;
+#endif
+
+} // end Initialize()
+
+
+/**
+ * ****************** Finalize *********************************
+ */
+
+void
+DistributedComputation
+::Finalize( void )
+{
+#ifdef ELASTIX_USE_MPI
+  int finalized = 0;
+  MPI_Finalized( &finalized );
+  if( !finalized )
+  {
+    MPI_Finalize();
+  }
+#endif
+
+} // end Finalize()
+
+
+/**
+ * ****************** AllReduceSum *********************************
+ */
+
+void
+DistributedComputation
+::AllReduceSum( double * data, SizeValueType n ) const
+{
+#ifdef ELASTIX_USE_MPI
+  if( !this->GetIsDistributed() )
+  {
+    return;
+  }
+
+  /** The count of MPI is an int, so large arrays are sent in chunks. */
+  const SizeValueType maximumChunk = static_cast< SizeValueType >( std::numeric_limits< int >::max() );
+  for( SizeValueType begin = 0; begin < n; begin += maximumChunk )
+  {
+    const int count = static_cast< int >( std::min( maximumChunk, n - begin ) );
+    MPI_Allreduce( MPI_IN_PLACE, data + begin, count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+  }
+#else
+  (void)data;
+  (void)n;
+#endif
+
+} // end AllReduceSum()
+
+
+/**
+ * ****************** Broadcast *********************************
+ */
+
+void
+DistributedComputation
+::Broadcast( double * data, SizeValueType n, unsigned int root ) const
+{
+#ifdef ELASTIX_USE_MPI
+  if( !this->GetIsDistributed() )
+  {
+    return;
+  }
+
+  const SizeValueType maximumChunk = static_cast< SizeValueType >( std::numeric_limits< int >::max() );
+  for( SizeValueType begin = 0; begin < n; begin += maximumChunk )
+  {
+    const int count = static_cast< int >( std::min( maximumChunk, n - begin ) );
+    MPI_Bcast( data + begin, count, MPI_DOUBLE, static_cast< int >( root ), MPI_COMM_WORLD );
+  }
+#else
+  (void)data;
+  (void)n;
+  (void)root;
+#endif
+
+} // end Broadcast()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+DistributedComputation
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Rank: " << this->m_Rank << std::endl;
+  os << indent << "NumberOfRanks: " << this->m_NumberOfRanks << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkDistributedComputation_cxx
@@ -0,0 +1,110 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkDistributedComputation_h
+#define __itkDistributedComputation_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+namespace itk
+{
+
+/** \class DistributedComputation
+ * \brief The processes (ranks) that share the evaluation of a metric.
+ *
+ * When elastix is built with ELASTIX_USE_MPI and started with mpirun, every
+ * rank runs the same registration. The metrics that support it divide their
+ * fixed image samples over the ranks, and combine the partial sums with
+ * AllReduceSum(), such that every rank obtains the value and derivative of
+ * all samples. Broadcast() keeps the transform parameters of the ranks
+ * identical.
+ *
+ * Without MPI, or when started as a single process, there is one rank, and
+ * the reductions do nothing.
+ *
+ * The object is a singleton, obtained via GetInstance(). Initialize() and
+ * Finalize() are called once, by the executable.
+ *
+ * \ingroup Multithreading
+ */
+
+class DistributedComputation : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef DistributedComputation     Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( DistributedComputation, Object );
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** Start the message passing, with the command line arguments of the
+   * executable. Does nothing without MPI.
+   */
+  static void Initialize( int * argc, char *** argv );
+
+  /** Stop the message passing. Does nothing without MPI. */
+  static void Finalize( void );
+
+  /** Get the rank of this process, and the number of ranks. */
+  itkGetConstMacro( Rank, unsigned int );
+  itkGetConstMacro( NumberOfRanks, unsigned int );
+
+  /** Check if there is more than one rank. */
+  bool GetIsDistributed( void ) const
+  {
+    return this->m_NumberOfRanks > 1;
+  }
+
+  /** Replace data[ 0 ... n ) by its sum over all ranks. All ranks must call
+   * it, in the same order, with the same n.
+   */
+  void AllReduceSum( double * data, SizeValueType n ) const;
+
+  /** Replace data[ 0 ... n ) by the data of rank root. All ranks must call
+   * it, in the same order, with the same n.
+   */
+  void Broadcast( double * data, SizeValueType n, unsigned int root ) const;
+
+protected:
+
+  DistributedComputation();
+  virtual ~DistributedComputation() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  DistributedComputation( const Self & ); // purposely not implemented
+  void operator=( const Self & );         // purposely not implemented
+
+  unsigned int m_Rank;
+  unsigned int m_NumberOfRanks;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkDistributedComputation_h
@@ -48,6 +48,16 @@ namespace itk
  *   the derivative of the metric.\n
  *   --> <tt>radius = static_cast<unsigned long>( 2 * schedule + 1 );</tt>
  *
+ * If UseLevelResolution == true:\n
+ *   The mask is first shrunk by the schedule of the resolution level, taking
+ *   the minimum of each block of schedule voxels, and then eroded on that
+ *   grid with the radius divided by the schedule. The output then has the
+ *   size of the level (so preparing the masks of the coarse levels is cheap),
+ *   the spacing of the input times the schedule, and the same direction.
+ *   The centers of the output voxels are the centers of the blocks. Taking
+ *   the minimum keeps the result conservative: a voxel of the output is only
+ *   nonzero when all input voxels of its block are nonzero. The shrinking is
+ *   done in parallel, on the PersistentThreadPool.
  *
  * \sa ParabolicErodeImageFilter
  *
@@ -117,6 +127,13 @@ public:
   itkSetMacro( ResolutionLevel, unsigned int );
   itkGetConstMacro( ResolutionLevel, unsigned int );
 
+  /** Set/Get whether the output is on the grid of the resolution level,
+   * instead of the grid of the input. Default: false.
+   */
+  itkSetMacro( UseLevelResolution, bool );
+  itkGetConstMacro( UseLevelResolution, bool );
+  itkBooleanMacro( UseLevelResolution );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( SameDimensionCheck,
@@ -138,14 +155,37 @@ protected:
    */
   virtual void GenerateData( void );
 
+  /** With UseLevelResolution, the output has the geometry of the shrunk
+   * input, and the whole input is needed.
+   */
+  virtual void GenerateOutputInformation( void );
+
+  virtual void GenerateInputRequestedRegion( void );
+
+  /** The shrink factors of the resolution level, at least 1. */
+  void GetShrinkFactors( unsigned int factors[] ) const;
+
 private:
 
   ErodeMaskImageFilter( const Self & );    // purposely not implemented
   void operator=( const Self & );          // purposely not implemented
 
+  /** The data shared by the slices of the shrunk mask. */
+  struct ShrinkJobType
+  {
+    const InputImageType * st_Input;
+    InputImageType *       st_Output;
+    unsigned int           st_Factors[ ImageDimension ];
+  };
+
+  /** Shrink the slices [begin, end) of the last dimension of the output. */
+  static void ShrinkRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
   bool         m_IsMovingMask;
   unsigned int m_ResolutionLevel;
   ScheduleType m_Schedule;
+  bool         m_UseLevelResolution;
 
 };
 
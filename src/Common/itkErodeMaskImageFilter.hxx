@@ -20,6 +20,11 @@
 
 #include "itkErodeMaskImageFilter.h"
 #include "itkParabolicErodeImageFilter.h"
+#include "itkPersistentThreadPool.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkContinuousIndex.h"
+#include <algorithm>
 //#include "itkThresholdImageFilter.h"
 
 namespace itk
@@ -33,8 +38,9 @@ template< class TImage >
 ErodeMaskImageFilter< TImage >
 ::ErodeMaskImageFilter()
 {
-  this->m_IsMovingMask    = false;
-  this->m_ResolutionLevel = 0;
+  this->m_IsMovingMask       = false;
+  this->m_ResolutionLevel    = 0;
+  this->m_UseLevelResolution = false;
 
   ScheduleType defaultSchedule( 1, InputImageDimension );
   defaultSchedule.Fill( NumericTraits< unsigned int >::OneValue() );
@@ -43,6 +49,91 @@ ErodeMaskImageFilter< TImage >
 } // end Constructor
 
 
+/**
+ * ************* GetShrinkFactors *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::GetShrinkFactors( unsigned int factors[] ) const
+{
+  for( unsigned int i = 0; i < InputImageDimension; ++i )
+  {
+    factors[ i ] = 1;
+    if( this->m_UseLevelResolution )
+    {
+      factors[ i ] = std::max( 1u,
+        static_cast< unsigned int >( this->m_Schedule[ this->m_ResolutionLevel ][ i ] ) );
+    }
+  }
+
+} // end GetShrinkFactors()
+
+
+/**
+ * ************* GenerateOutputInformation *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::GenerateOutputInformation( void )
+{
+  Superclass::GenerateOutputInformation();
+
+  const InputImageType * input  = this->GetInput();
+  OutputImageType *      output = this->GetOutput();
+  if( !this->m_UseLevelResolution || !input || !output )
+  {
+    return;
+  }
+
+  /** The output voxels are at the centers of the blocks of the input. */
+  unsigned int factors[ InputImageDimension ];
+  this->GetShrinkFactors( factors );
+  const typename InputImageType::RegionType & inputRegion = input->GetLargestPossibleRegion();
+  typename OutputImageType::SpacingType       spacing     = input->GetSpacing();
+  typename OutputImageType::RegionType        outputRegion;
+  ContinuousIndex< double, InputImageDimension > firstCenter;
+  for( unsigned int i = 0; i < InputImageDimension; ++i )
+  {
+    spacing[ i ] *= static_cast< double >( factors[ i ] );
+    outputRegion.SetIndex( i, 0 );
+    outputRegion.SetSize( i, ( inputRegion.GetSize()[ i ] + factors[ i ] - 1 ) / factors[ i ] );
+    firstCenter[ i ] = static_cast< double >( inputRegion.GetIndex()[ i ] )
+      + 0.5 * static_cast< double >( factors[ i ] - 1 );
+  }
+  typename OutputImageType::PointType origin;
+  input->TransformContinuousIndexToPhysicalPoint( firstCenter, origin );
+
+  output->SetLargestPossibleRegion( outputRegion );
+  output->SetSpacing( spacing );
+  output->SetOrigin( origin );
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ************* GenerateInputRequestedRegion *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::GenerateInputRequestedRegion( void )
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if( this->m_UseLevelResolution && input )
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
 /**
  * ************* GenerateData *******************
  */
@@ -59,7 +150,9 @@ ErodeMaskImageFilter< TImage >
   typedef typename ErodeFilterType::RadiusType     RadiusType;
   typedef typename ErodeFilterType::ScalarRealType ScalarRealType;
 
-  /** Get the correct radius. */
+  /** Get the correct radius, in voxels of the grid that is eroded. */
+  unsigned int factors[ InputImageDimension ];
+  this->GetShrinkFactors( factors );
   RadiusType     radiusarray;
   ScalarRealType radius   = 0.0;
   ScalarRealType schedule = 0.0;
@@ -75,6 +168,7 @@ ErodeMaskImageFilter< TImage >
     {
       radius = 2.0 * schedule + 1.0;
     }
+    radius /= static_cast< ScalarRealType >( factors[ i ] );
     // Very specific computation for the parabolic erosion filter:
     radius = radius * radius / 2.0 + 1.0;
 
@@ -88,12 +182,31 @@ ErodeMaskImageFilter< TImage >
   threshold->SetOutsideValue( itk::NumericTraits<InputPixelType>::OneValue() );
   threshold->SetInput( this->GetInput() ); */
 
+  /** Shrink the input to the grid of the resolution level, if needed. */
+  typename InputImageType::ConstPointer erosionInput = this->GetInput();
+  if( this->m_UseLevelResolution )
+  {
+    InputImagePointer shrunk = InputImageType::New();
+    shrunk->CopyInformation( this->GetOutput() );
+    shrunk->SetRegions( this->GetOutput()->GetLargestPossibleRegion() );
+    shrunk->Allocate();
+
+    ShrinkJobType job;
+    job.st_Input  = this->GetInput();
+    job.st_Output = shrunk;
+    std::copy( factors, factors + InputImageDimension, job.st_Factors );
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      shrunk->GetBufferedRegion().GetSize()[ InputImageDimension - 1 ], 1,
+      Self::ShrinkRangeFunction, &job );
+    erosionInput = shrunk;
+  }
+
   /** Create and run the erosion filter. */
   typename ErodeFilterType::Pointer erosion = ErodeFilterType::New();
   erosion->SetUseImageSpacing( false );
   erosion->SetScale( radiusarray );
   //erosion->SetInput( threshold->GetOutput() );
-  erosion->SetInput( this->GetInput() );
+  erosion->SetInput( erosionInput );
   erosion->Update();
 
   /** Graft the output of the mini-pipeline back onto the filter's output.
@@ -104,6 +217,63 @@ ErodeMaskImageFilter< TImage >
 } // end GenerateData()
 
 
+/**
+ * ************* ShrinkRangeFunction *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ShrinkRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  typedef typename InputImageType::RegionType            RegionType;
+  typedef typename InputImageType::IndexType             IndexType;
+  typedef ImageRegionIteratorWithIndex< InputImageType > OutputIteratorType;
+  typedef ImageRegionConstIterator< InputImageType >     InputIteratorType;
+
+  ShrinkJobType *        job         = static_cast< ShrinkJobType * >( userData );
+  const InputImageType * input       = job->st_Input;
+  InputImageType *       output      = job->st_Output;
+  const RegionType &     inputRegion = input->GetBufferedRegion();
+  const IndexType &      outputStart = output->GetBufferedRegion().GetIndex();
+
+  /** The slices [begin, end) of the output. */
+  RegionType sliceRegion = output->GetBufferedRegion();
+  sliceRegion.SetIndex( ImageDimension - 1,
+    outputStart[ ImageDimension - 1 ] + static_cast< IndexValueType >( begin ) );
+  sliceRegion.SetSize( ImageDimension - 1, end - begin );
+
+  /** Each output voxel is the minimum of its block of input voxels. The last
+   * blocks are cropped to the input region.
+   */
+  RegionType blockRegion;
+  for( OutputIteratorType it( output, sliceRegion ); !it.IsAtEnd(); ++it )
+  {
+    const IndexType & index = it.GetIndex();
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      const IndexValueType blockStart = inputRegion.GetIndex()[ i ]
+        + ( index[ i ] - outputStart[ i ] ) * static_cast< IndexValueType >( job->st_Factors[ i ] );
+      const IndexValueType inputEnd = inputRegion.GetIndex()[ i ]
+        + static_cast< IndexValueType >( inputRegion.GetSize()[ i ] );
+      blockRegion.SetIndex( i, blockStart );
+      blockRegion.SetSize( i, static_cast< SizeValueType >( std::min< IndexValueType >(
+        job->st_Factors[ i ], inputEnd - blockStart ) ) );
+    }
+
+    InputIteratorType blockIt( input, blockRegion );
+    InputPixelType    value = blockIt.Get();
+    for( ++blockIt; !blockIt.IsAtEnd() && value != NumericTraits< InputPixelType >::ZeroValue(); ++blockIt )
+    {
+      value = std::min( value, blockIt.Get() );
+    }
+    it.Set( value );
+  }
+
+} // end ShrinkRangeFunction()
+
+
 } // end namespace itk
 
 #endif
@@ -0,0 +1,149 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkExternalImageBuffer_h
+#define __itkExternalImageBuffer_h
+
+#include "itkImage.h"
+#include "itkImportImageContainer.h"
+
+namespace itk
+{
+
+/** \class ExternalBufferImportImageContainer
+ *
+ * \brief An import image container that points to a pixel buffer owned by
+ * the caller, and tells the caller when it is not used anymore.
+ *
+ * The container does not own its memory. When the last image using the
+ * container is gone, the release callback is called with the client data,
+ * so that the caller can free the buffer, or drop its reference to the
+ * object that owns it.
+ */
+
+template< class TElementIdentifier, class TElement >
+class ExternalBufferImportImageContainer :
+  public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ExternalBufferImportImageContainer                   Self;
+  typedef ImportImageContainer< TElementIdentifier, TElement > Superclass;
+  typedef SmartPointer< Self >                                 Pointer;
+  typedef SmartPointer< const Self >                           ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ExternalBufferImportImageContainer, ImportImageContainer );
+
+  /** The function that is called when the buffer is not used anymore. */
+  typedef void (* ReleaseCallbackType)( void * clientData );
+
+  /** Set the release callback, or 0 (the default) for none. */
+  void SetReleaseCallback( ReleaseCallbackType callback, void * clientData )
+  {
+    this->m_ReleaseCallback = callback;
+    this->m_ClientData      = clientData;
+  }
+
+protected:
+
+  ExternalBufferImportImageContainer() : m_ReleaseCallback( 0 ), m_ClientData( 0 ) {}
+  virtual ~ExternalBufferImportImageContainer()
+  {
+    if( this->m_ReleaseCallback )
+    {
+      this->m_ReleaseCallback( this->m_ClientData );
+    }
+  }
+
+private:
+
+  ExternalBufferImportImageContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );                      // purposely not implemented
+
+  ReleaseCallbackType m_ReleaseCallback;
+  void *              m_ClientData;
+
+};
+
+/** \class ExternalImageBuffer
+ *
+ * \brief Wraps a pixel buffer owned by the caller as an image, without
+ * copying it.
+ *
+ * This is the ImportImageFilter without the pipeline: Import() returns an
+ * image that points to the buffer, with the given geometry. The buffer must
+ * hold the pixels in the ITK order, the first index running fastest.
+ *
+ * The image, and every image that is grafted from it, keep the buffer in
+ * use. The release callback, if given, is called once the last of them is
+ * gone; until then the caller must keep the buffer alive and unchanged.
+ * Without a callback, the caller must keep the buffer alive as long as the
+ * image exists.
+ */
+
+template< class TImage >
+class ExternalImageBuffer
+{
+public:
+
+  /** Typedefs. */
+  typedef TImage                                      ImageType;
+  typedef typename ImageType::Pointer                 ImagePointer;
+  typedef typename ImageType::PixelType               PixelType;
+  typedef typename ImageType::SizeType                SizeType;
+  typedef typename ImageType::SpacingType             SpacingType;
+  typedef typename ImageType::PointType               PointType;
+  typedef typename ImageType::DirectionType           DirectionType;
+  typedef typename ImageType::RegionType              RegionType;
+  typedef typename ImageType::PixelContainer          PixelContainerType;
+  typedef ExternalBufferImportImageContainer<
+    typename PixelContainerType::ElementIdentifier,
+    typename PixelContainerType::Element >            ContainerType;
+  typedef typename ContainerType::ReleaseCallbackType ReleaseCallbackType;
+
+  /** Wrap \a buffer, which holds the pixels of an image of \a size. */
+  static ImagePointer Import( PixelType * buffer, const SizeType & size,
+    const SpacingType & spacing, const PointType & origin,
+    const DirectionType & direction,
+    ReleaseCallbackType releaseCallback = 0, void * clientData = 0 )
+  {
+    const RegionType region( size );
+
+    /** Set the callback first, so that the buffer is released on failure. */
+    typename ContainerType::Pointer container = ContainerType::New();
+    container->SetReleaseCallback( releaseCallback, clientData );
+    container->SetImportPointer( buffer, region.GetNumberOfPixels(), false );
+
+    ImagePointer image = ImageType::New();
+    image->SetRegions( region );
+    image->SetSpacing( spacing );
+    image->SetOrigin( origin );
+    image->SetDirection( direction );
+    image->SetPixelContainer( container );
+    return image;
+  }
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkExternalImageBuffer_h
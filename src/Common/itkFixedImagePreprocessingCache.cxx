@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkFixedImagePreprocessingCache_cxx
+#define __itkFixedImagePreprocessingCache_cxx
+
+#include "itkFixedImagePreprocessingCache.h"
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+FixedImagePreprocessingCache::Pointer
+FixedImagePreprocessingCache
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+FixedImagePreprocessingCache
+::FixedImagePreprocessingCache()
+{
+  this->m_Enabled      = false;
+  this->m_NumberOfHits = 0;
+
+} // end Constructor
+
+
+/**
+ * ****************** Find *********************************
+ */
+
+Object::Pointer
+FixedImagePreprocessingCache
+::Find( const Object * owner, const std::string & key )
+{
+  Object::Pointer artifact;
+  if( owner == NULL )
+  {
+    return artifact;
+  }
+
+  this->m_Lock.Lock();
+  if( this->m_Enabled )
+  {
+    EntryMapType::const_iterator it = this->m_Entries.find( EntryKeyType( owner, key ) );
+    if( it != this->m_Entries.end() && it->second.OwnerMTime == owner->GetMTime() )
+    {
+      artifact = it->second.Artifact;
+      ++this->m_NumberOfHits;
+    }
+  }
+  this->m_Lock.Unlock();
+
+  return artifact;
+
+} // end Find()
+
+
+/**
+ * ****************** Store *********************************
+ */
+
+void
+FixedImagePreprocessingCache
+::Store( const Object * owner, const std::string & key, Object * artifact )
+{
+  if( owner == NULL || artifact == NULL )
+  {
+    return;
+  }
+
+  this->m_Lock.Lock();
+  if( this->m_Enabled )
+  {
+    EntryType & entry = this->m_Entries[ EntryKeyType( owner, key ) ];
+    entry.Owner      = owner;
+    entry.OwnerMTime = owner->GetMTime();
+    entry.Artifact   = artifact;
+  }
+  this->m_Lock.Unlock();
+
+} // end Store()
+
+
+/**
+ * ****************** Clear *********************************
+ */
+
+void
+FixedImagePreprocessingCache
+::Clear( void )
+{
+  /** Release the entries outside the lock, since releasing an image may
+   * trigger arbitrary destructors.
+   */
+  EntryMapType entries;
+  this->m_Lock.Lock();
+  entries.swap( this->m_Entries );
+  this->m_NumberOfHits = 0;
+  this->m_Lock.Unlock();
+
+} // end Clear()
+
+
+/**
+ * ****************** GetNumberOfEntries *********************************
+ */
+
+SizeValueType
+FixedImagePreprocessingCache
+::GetNumberOfEntries( void ) const
+{
+  this->m_Lock.Lock();
+  const SizeValueType numberOfEntries = this->m_Entries.size();
+  this->m_Lock.Unlock();
+
+  return numberOfEntries;
+
+} // end GetNumberOfEntries()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+FixedImagePreprocessingCache
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Enabled: " << this->m_Enabled << std::endl;
+  os << indent << "NumberOfEntries: " << this->GetNumberOfEntries() << std::endl;
+  os << indent << "NumberOfHits: " << this->m_NumberOfHits << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkFixedImagePreprocessingCache_cxx
@@ -0,0 +1,181 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkFixedImagePreprocessingCache_h
+#define __itkFixedImagePreprocessingCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/** \class FixedImagePreprocessingCache
+ *
+ * \brief A process wide cache of the results that only depend on the fixed
+ * image, shared by the registrations of many moving images to one fixed image.
+ *
+ * When one fixed image is registered to many moving images in one process
+ * (the elastix "-batch" option, ELASTIX::RegisterImageBatch(), or repeated
+ * ElastixFilter updates) every registration recomputes the fixed image
+ * pyramid, the eroded fixed masks and the fixed image extrema. With the cache
+ * enabled these are computed by the first registration, and taken from the
+ * cache by the next ones.
+ *
+ * An entry is identified by its owner, typically the fixed image, its mask, or
+ * their pixel containers, and a key that describes the settings it was
+ * computed with, e.g. the pyramid schedule and the resolution level. The
+ * cache keeps a reference to the owner, so its address can not be reused
+ * while the entry exists. An entry is only returned while the owner has not
+ * been modified since it was stored.
+ *
+ * The cache is disabled by default, and holds on to the fixed images until
+ * Clear() is called. The cache is a singleton, obtained via GetInstance().
+ * All methods are thread safe.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class FixedImagePreprocessingCache : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef FixedImagePreprocessingCache Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( FixedImagePreprocessingCache, Object );
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** Enable or disable the cache. Disabling it does not clear it. */
+  itkSetMacro( Enabled, bool );
+  itkGetConstMacro( Enabled, bool );
+  itkBooleanMacro( Enabled );
+
+  /** Returns the artifact stored for the owner and key, or 0 if there is none
+   * or the owner has been modified. Always returns 0 if the cache is disabled.
+   */
+  Object::Pointer Find( const Object * owner, const std::string & key );
+
+  /** Stores the artifact for the owner and key. Does nothing if the cache
+   * is disabled.
+   */
+  void Store( const Object * owner, const std::string & key, Object * artifact );
+
+  /** Removes all entries, releasing the owners and artifacts. */
+  void Clear( void );
+
+  /** The number of entries, and the number of successful calls to Find(). */
+  SizeValueType GetNumberOfEntries( void ) const;
+
+  itkGetConstMacro( NumberOfHits, SizeValueType );
+
+protected:
+
+  FixedImagePreprocessingCache();
+  virtual ~FixedImagePreprocessingCache() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  FixedImagePreprocessingCache( const Self & ); // purposely not implemented
+  void operator=( const Self & );               // purposely not implemented
+
+  /** An entry of the cache. */
+  struct EntryType
+  {
+    Object::ConstPointer Owner;
+    ModifiedTimeType     OwnerMTime;
+    Object::Pointer      Artifact;
+  };
+
+  typedef std::pair< const Object *, std::string > EntryKeyType;
+  typedef std::map< EntryKeyType, EntryType >      EntryMapType;
+
+  bool                        m_Enabled;
+  SizeValueType               m_NumberOfHits;
+  EntryMapType                m_Entries;
+  mutable SimpleFastMutexLock m_Lock;
+
+};
+
+/** \class FixedImagePreprocessingValues
+ *
+ * \brief An artifact of the FixedImagePreprocessingCache that holds a few
+ * values, e.g. the fixed image extrema. The objects that the values depend
+ * on, besides the owner of the entry, can be kept alive via AddDependency(),
+ * so that their addresses can safely be part of the key.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class FixedImagePreprocessingValues : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef FixedImagePreprocessingValues Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( FixedImagePreprocessingValues, Object );
+
+  /** The values. */
+  std::vector< double > Values;
+
+  /** Keeps the object alive as long as these values. */
+  void AddDependency( const Object * object )
+  {
+    this->m_Dependencies.push_back( object );
+  }
+
+
+protected:
+
+  FixedImagePreprocessingValues() {}
+  virtual ~FixedImagePreprocessingValues() {}
+
+private:
+
+  FixedImagePreprocessingValues( const Self & ); // purposely not implemented
+  void operator=( const Self & );                // purposely not implemented
+
+  std::vector< Object::ConstPointer > m_Dependencies;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkFixedImagePreprocessingCache_h
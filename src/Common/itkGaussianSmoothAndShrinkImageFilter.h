@@ -0,0 +1,157 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGaussianSmoothAndShrinkImageFilter_h
+#define __itkGaussianSmoothAndShrinkImageFilter_h
+
+#include "itkShrinkImageFilter.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
+
+namespace itk
+{
+/**
+ * \class GaussianSmoothAndShrinkImageFilter
+ * \brief Smooths an image with a Gaussian and shrinks it, in one pass.
+ *
+ * This filter produces the same output grid as the ShrinkImageFilter, and
+ * samples the same input pixels, but these are first convolved with a
+ * discrete Gaussian kernel. In contrast to a SmoothingRecursiveGaussianImageFilter
+ * followed by a ShrinkImageFilter, no full resolution smoothed image is created:
+ * the separable convolution is done one dimension after the other, and each
+ * pass only computes the values at the pixels that are kept by the shrinking.
+ * The intermediate results are stored as float, and are therefore reduced by
+ * the shrink factor after every pass.
+ *
+ * The passes along the first dimension work on contiguous lines. The passes
+ * along the other dimensions process strips of neighbouring lines at once,
+ * so that every kernel tap reads a contiguous block of memory. The strips are
+ * distributed over the threads of the PersistentThreadPool.
+ *
+ * The Gaussian kernel is sampled, normalized to a sum of one, and truncated
+ * at four standard deviations. Outside the image the nearest pixel value is
+ * used (zero flux Neumann boundary condition). The sigmas are given in
+ * physical units. Only scalar pixel types are supported.
+ *
+ * \sa ShrinkImageFilter
+ * \sa GenericMultiResolutionPyramidImageFilter
+ *
+ * \ingroup ImageFilters
+ */
+
+template< class TInputImage, class TOutputImage >
+class GaussianSmoothAndShrinkImageFilter :
+  public ShrinkImageFilter< TInputImage, TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef GaussianSmoothAndShrinkImageFilter             Self;
+  typedef ShrinkImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                           Pointer;
+  typedef SmartPointer< const Self >                     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( GaussianSmoothAndShrinkImageFilter, ShrinkImageFilter );
+
+  /** ImageDimension enumeration. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TInputImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TInputImage                                InputImageType;
+  typedef TOutputImage                               OutputImageType;
+  typedef typename InputImageType::PixelType         InputPixelType;
+  typedef typename OutputImageType::PixelType        OutputPixelType;
+  typedef typename InputImageType::RegionType        InputImageRegionType;
+  typedef typename OutputImageType::RegionType       OutputImageRegionType;
+  typedef typename Superclass::ShrinkFactorsType     ShrinkFactorsType;
+  typedef FixedArray< double,
+    itkGetStaticConstMacro( ImageDimension ) >       SigmaArrayType;
+
+  /** Set/Get the standard deviations of the Gaussian, in physical units. */
+  itkSetMacro( SigmaArray, SigmaArrayType );
+  itkGetConstReferenceMacro( SigmaArray, SigmaArrayType );
+
+protected:
+
+  GaussianSmoothAndShrinkImageFilter();
+  virtual ~GaussianSmoothAndShrinkImageFilter() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** The convolution needs the complete input. */
+  virtual void GenerateInputRequestedRegion( void );
+
+  /** Performs all passes; multi-threading is done per pass. */
+  virtual void GenerateData( void );
+
+  /** Compute the kernel for a standard deviation in pixels. */
+  static void ComputeKernel( const double sigma,
+    std::vector< float > & kernel, OffsetValueType & radius );
+
+private:
+
+  GaussianSmoothAndShrinkImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                     // purposely not implemented
+
+  /** The data of a single pass along one dimension. The source and
+   * destination buffers have the same extents, except along the dimension
+   * of the pass, where the destination has m_DestinationSize pixels.
+   */
+  struct PassType
+  {
+    /** The number of lines processed together. */
+    enum { StripWidth = 64 };
+
+    const InputPixelType *       m_InputSource;
+    const float *                m_FloatSource;
+    float *                      m_Destination;
+    SizeValueType                m_SourceSize;
+    SizeValueType                m_DestinationSize;
+    SizeValueType                m_InnerSize;
+    SizeValueType                m_NumberOfStrips;
+    const OffsetValueType *      m_Centers;
+    const float *                m_Kernel;
+    OffsetValueType              m_Radius;
+  };
+
+  /** Executes a pass for the work items [begin, end). */
+  static void PassRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Executes a pass for a single work item, i.e. a strip of lines. */
+  template< class TSourceValue >
+  static void ProcessStrip( const PassType & pass, const TSourceValue * source,
+    const SizeValueType item );
+
+  SigmaArrayType m_SigmaArray;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkGaussianSmoothAndShrinkImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkGaussianSmoothAndShrinkImageFilter_h
@@ -0,0 +1,288 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGaussianSmoothAndShrinkImageFilter_hxx
+#define __itkGaussianSmoothAndShrinkImageFilter_hxx
+
+#include "itkGaussianSmoothAndShrinkImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::GaussianSmoothAndShrinkImageFilter()
+{
+  this->m_SigmaArray.Fill( 0.0 );
+} // end Constructor
+
+
+/**
+ * ******************* GenerateInputRequestedRegion ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion( void )
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+  if( input )
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::GenerateData( void )
+{
+  const InputImageType * inputPtr  = this->GetInput();
+  OutputImageType *      outputPtr = this->GetOutput();
+
+  this->AllocateOutputs();
+
+  const InputImageRegionType &  inputRegion  = inputPtr->GetBufferedRegion();
+  const OutputImageRegionType & outputRegion = outputPtr->GetBufferedRegion();
+  if( outputRegion.GetNumberOfPixels() == 0 ) { return; }
+
+  /** Compute the offset between the input index and the output index times
+   * the shrink factors, exactly like the ShrinkImageFilter does.
+   */
+  const ShrinkFactorsType                      factors     = this->GetShrinkFactors();
+  const typename OutputImageType::IndexType    outputIndex = outputPtr->GetLargestPossibleRegion().GetIndex();
+  typename OutputImageType::PointType          point;
+  typename InputImageType::IndexType           inputIndex;
+  outputPtr->TransformIndexToPhysicalPoint( outputIndex, point );
+  inputPtr->TransformPhysicalPointToIndex( point, inputIndex );
+
+  OffsetValueType offsets[ ImageDimension ];
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    offsets[ d ] = std::max( NumericTraits< OffsetValueType >::ZeroValue(),
+      static_cast< OffsetValueType >( inputIndex[ d ] - outputIndex[ d ] * factors[ d ] ) );
+  }
+
+  /** Perform a pass per dimension. The first pass reads the input image,
+   * the others the float result of the previous pass.
+   */
+  SizeValueType sizes[ ImageDimension ];
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    sizes[ d ] = inputRegion.GetSize( d );
+  }
+
+  std::vector< float >           source;
+  std::vector< float >           destination;
+  std::vector< OffsetValueType > centers;
+  std::vector< float >           kernel;
+
+  PassType pass;
+  pass.m_InputSource = inputPtr->GetBufferPointer();
+  pass.m_FloatSource = 0;
+
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    const SizeValueType destinationSize = outputRegion.GetSize( d );
+
+    /** The input pixel that is sampled for each output pixel. */
+    centers.resize( destinationSize );
+    for( SizeValueType i = 0; i < destinationSize; ++i )
+    {
+      centers[ i ] = ( outputRegion.GetIndex( d ) + static_cast< OffsetValueType >( i ) )
+        * static_cast< OffsetValueType >( factors[ d ] ) + offsets[ d ] - inputRegion.GetIndex( d );
+    }
+
+    OffsetValueType radius = 0;
+    ComputeKernel( this->m_SigmaArray[ d ] / inputPtr->GetSpacing()[ d ], kernel, radius );
+
+    SizeValueType innerSize = 1;
+    SizeValueType outerSize = 1;
+    for( unsigned int k = 0; k < d; ++k ) { innerSize *= sizes[ k ]; }
+    for( unsigned int k = d + 1; k < ImageDimension; ++k ) { outerSize *= sizes[ k ]; }
+
+    destination.resize( innerSize * destinationSize * outerSize );
+
+    pass.m_Destination     = &destination[ 0 ];
+    pass.m_SourceSize      = sizes[ d ];
+    pass.m_DestinationSize = destinationSize;
+    pass.m_InnerSize       = innerSize;
+    pass.m_NumberOfStrips  = ( innerSize + PassType::StripWidth - 1 ) / PassType::StripWidth;
+    pass.m_Centers         = &centers[ 0 ];
+    pass.m_Kernel          = &kernel[ 0 ];
+    pass.m_Radius          = radius;
+
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      outerSize * pass.m_NumberOfStrips, 0, PassRangeFunction, &pass );
+
+    /** The result of this pass is the source of the next one. */
+    sizes[ d ] = destinationSize;
+    source.swap( destination );
+    std::vector< float >().swap( destination );
+    pass.m_InputSource = 0;
+    pass.m_FloatSource = &source[ 0 ];
+  }
+
+  /** Copy the result to the output. */
+  OutputPixelType *   out            = outputPtr->GetBufferPointer();
+  const SizeValueType numberOfPixels = outputRegion.GetNumberOfPixels();
+  for( SizeValueType i = 0; i < numberOfPixels; ++i )
+  {
+    out[ i ] = static_cast< OutputPixelType >( source[ i ] );
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* ComputeKernel ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::ComputeKernel( const double sigma, std::vector< float > & kernel, OffsetValueType & radius )
+{
+  radius = sigma > 0.0 ? static_cast< OffsetValueType >( std::ceil( 4.0 * sigma ) ) : 0;
+  kernel.resize( 2 * radius + 1 );
+  if( radius == 0 )
+  {
+    kernel[ 0 ] = 1.0f;
+    return;
+  }
+
+  std::vector< double > weights( 2 * radius + 1 );
+  double                sum = 0.0;
+  for( OffsetValueType k = -radius; k <= radius; ++k )
+  {
+    const double x = static_cast< double >( k ) / sigma;
+    weights[ k + radius ] = std::exp( -0.5 * x * x );
+    sum += weights[ k + radius ];
+  }
+  for( std::size_t k = 0; k < weights.size(); ++k )
+  {
+    kernel[ k ] = static_cast< float >( weights[ k ] / sum );
+  }
+
+} // end ComputeKernel()
+
+
+/**
+ * ******************* PassRangeFunction ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::PassRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const PassType & pass = *static_cast< const PassType * >( userData );
+  for( SizeValueType item = begin; item < end; ++item )
+  {
+    if( pass.m_InputSource )
+    {
+      ProcessStrip( pass, pass.m_InputSource, item );
+    }
+    else
+    {
+      ProcessStrip( pass, pass.m_FloatSource, item );
+    }
+  }
+} // end PassRangeFunction()
+
+
+/**
+ * ******************* ProcessStrip ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+template< class TSourceValue >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::ProcessStrip( const PassType & pass, const TSourceValue * source, const SizeValueType item )
+{
+  const SizeValueType outer = item / pass.m_NumberOfStrips;
+  const SizeValueType first = ( item % pass.m_NumberOfStrips ) * PassType::StripWidth;
+  const SizeValueType width = std::min( static_cast< SizeValueType >( PassType::StripWidth ),
+    pass.m_InnerSize - first );
+
+  const TSourceValue * sourceStrip = source
+    + outer * pass.m_SourceSize * pass.m_InnerSize + first;
+  float * destinationStrip = pass.m_Destination
+    + outer * pass.m_DestinationSize * pass.m_InnerSize + first;
+
+  const OffsetValueType last = static_cast< OffsetValueType >( pass.m_SourceSize ) - 1;
+  float                 accumulator[ PassType::StripWidth ];
+
+  for( SizeValueType i = 0; i < pass.m_DestinationSize; ++i )
+  {
+    std::fill( accumulator, accumulator + width, 0.0f );
+
+    /** Lines in the strip are contiguous, so every tap reads a block of memory. */
+    const OffsetValueType center = pass.m_Centers[ i ];
+    for( OffsetValueType k = -pass.m_Radius; k <= pass.m_Radius; ++k )
+    {
+      const OffsetValueType j      = std::min( std::max( center + k, OffsetValueType( 0 ) ), last );
+      const float           weight = pass.m_Kernel[ k + pass.m_Radius ];
+      const TSourceValue *  row    = sourceStrip + static_cast< SizeValueType >( j ) * pass.m_InnerSize;
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        accumulator[ b ] += weight * static_cast< float >( row[ b ] );
+      }
+    }
+
+    float * destinationRow = destinationStrip + i * pass.m_InnerSize;
+    std::copy( accumulator, accumulator + width, destinationRow );
+  }
+
+} // end ProcessStrip()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+GaussianSmoothAndShrinkImageFilter< TInputImage, TOutputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "SigmaArray: " << this->m_SigmaArray << std::endl;
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkGaussianSmoothAndShrinkImageFilter_hxx
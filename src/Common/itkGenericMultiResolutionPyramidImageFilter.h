@@ -20,6 +20,7 @@
 
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkMultiThreader.h"
 
 namespace itk
 {
@@ -98,6 +99,13 @@ namespace itk
  * compute only single level of the pyramid via SetCurrentLevel() and
  * SetComputeOnlyForCurrentLevel() methods.
  *
+ * When only the current level is computed, SetComputeNextLevelInBackground()
+ * can be used to compute the next level on a background thread as soon as
+ * the current level has been generated.
+ * The next call to GenerateData() then only grafts the result to the output,
+ * so that the computation of level k+1 overlaps with whatever is done with
+ * level k, e.g. the optimization in a registration.
+ *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
  *
@@ -220,6 +228,26 @@ public:
   itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
   itkBooleanMacro( ComputeOnlyForCurrentLevel );
 
+  /** Set a control on whether the next level is computed in the background,
+   * directly after the current level has been generated. Only used when
+   * ComputeOnlyForCurrentLevel is true. The background result is only used
+   * if the input, the schedules and the output information did not change
+   * in the meantime, otherwise the level is computed again. Default false.
+   */
+  itkSetMacro( ComputeNextLevelInBackground, bool );
+  itkGetConstMacro( ComputeNextLevelInBackground, bool );
+  itkBooleanMacro( ComputeNextLevelInBackground );
+
+  /** Set a control on whether smoothing and shrinking are done in a single
+   * pass by the GaussianSmoothAndShrinkImageFilter, which uses a discrete
+   * Gaussian kernel and never allocates a full resolution smoothed image.
+   * Only used when the ShrinkImageFilter is used and the level is both
+   * smoothed and shrunk. Default false.
+   */
+  itkSetMacro( UseFusedSmoothingAndShrinking, bool );
+  itkGetConstMacro( UseFusedSmoothingAndShrinking, bool );
+  itkBooleanMacro( UseFusedSmoothingAndShrinking );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( SameDimensionCheck,
@@ -232,7 +260,7 @@ public:
 protected:
 
   GenericMultiResolutionPyramidImageFilter();
-  ~GenericMultiResolutionPyramidImageFilter() {}
+  virtual ~GenericMultiResolutionPyramidImageFilter();
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const;
@@ -265,6 +293,8 @@ protected:
   SmoothingScheduleType m_SmoothingSchedule;
   unsigned int          m_CurrentLevel;
   bool                  m_ComputeOnlyForCurrentLevel;
+  bool                  m_ComputeNextLevelInBackground;
+  bool                  m_UseFusedSmoothingAndShrinking;
   bool                  m_SmoothingScheduleDefined;
 
 private:
@@ -287,16 +317,17 @@ private:
   /** Smooth image at current level. Returns true if performed.
    * This method does not perform execution.
    */
-  bool SetupSmoother( const unsigned int level,
+  bool SetupSmoother( const SigmaArrayType & sigmaArray,
     typename SmootherType::Pointer & smoother,
     const InputImageConstPointer & input );
 
   /** Shrink or Resample image at current level. Returns 1 or 2 if performed,
    * 0 otherwise. This method does not perform execution.
    */
-  int SetupShrinkerOrResampler( const unsigned int level,
+  int SetupShrinkerOrResampler( const RescaleFactorArrayType & shrinkFactors,
     typename SmootherType::Pointer & smoother,
     const bool sameType,
+    const bool useShrinkImageFilter,
     const InputImageConstPointer & input,
     const OutputImagePointer & outputPtr,
     typename ImageToImageFilterSameTypes::Pointer & rescaleSameTypes,
@@ -305,11 +336,37 @@ private:
   /** Defines Shrink or Resample filters. */
   void DefineShrinkerOrResampler(
     const bool sameType,
+    const bool useShrinkImageFilter,
     const RescaleFactorArrayType & shrinkFactors,
     const OutputImagePointer & outputPtr,
     typename ImageToImageFilterSameTypes::Pointer & rescaleSameTypes,
     typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes );
 
+  /** Allocate outputPtr and compute a single level into it, using the given
+   * sigmas and shrink factors. The output information of outputPtr should
+   * have been set already.
+   */
+  void GenerateLevel( const SigmaArrayType & sigmaArray,
+    const RescaleFactorArrayType & shrinkFactors,
+    const bool useShrinkImageFilter,
+    const bool useFusedSmoothingAndShrinking,
+    const InputImageConstPointer & input,
+    const OutputImagePointer & outputPtr );
+
+  /** Start computing the given level on a background thread. */
+  void StartBackgroundLevel( const unsigned int level );
+
+  /** Wait until the background thread, if any, has finished. */
+  void WaitForBackgroundLevel( void );
+
+  /** Checks whether the level computed in the background can be used as the
+   * output of the given level.
+   */
+  bool IsBackgroundLevelUsable( const unsigned int level );
+
+  /** The function executed by the background thread. */
+  static ITK_THREAD_RETURN_TYPE BackgroundLevelThreaderCallback( void * arg );
+
   /** Initialize m_SmoothingSchedule to default values for backward compatibility. */
   void SetSmoothingScheduleToDefault( void );
 
@@ -348,6 +405,24 @@ private:
   /** Returns true if rescale has been used in pipeline, otherwise return false. */
   bool IsRescaleUsed( void ) const;
 
+  /** Members for computing the next level in the background. The settings
+   * are copied when the thread is started, so that the thread does not read
+   * members that may be changed in the meantime.
+   */
+  MultiThreader::Pointer m_BackgroundThreader;
+  ThreadIdType           m_BackgroundThreadId;
+  bool                   m_BackgroundRunning;
+  bool                   m_BackgroundSucceeded;
+  unsigned int           m_BackgroundLevel;
+  SigmaArrayType         m_BackgroundSigmaArray;
+  RescaleFactorArrayType m_BackgroundShrinkFactors;
+  bool                   m_BackgroundUseShrinkImageFilter;
+  bool                   m_BackgroundUseFusedSmoothingAndShrinking;
+  const InputImageType * m_BackgroundInputSource;
+  ModifiedTimeType       m_BackgroundInputMTime;
+  InputImagePointer      m_BackgroundInput;
+  OutputImagePointer     m_BackgroundOutput;
+
 private:
 
   GenericMultiResolutionPyramidImageFilter( const Self & ); // purposely not implemented
@@ -23,6 +23,8 @@
 #include "itkResampleImageFilter.h"
 #include "itkShrinkImageFilter.h"
 #include "itkImageAlgorithm.h"
+#include "itkGaussianSmoothAndShrinkImageFilter.h"
+#include "itkRegistrationProgress.h"
 
 namespace // anonymous namespace
 {
@@ -30,20 +32,21 @@ namespace // anonymous namespace
  * ******************* UpdateAndGraft ***********************
  */
 
-template< class GenericMultiResolutionPyramidImageFilterType,
-class ImageToImageFilterType, typename OutputImageType >
+template< class ImageToImageFilterType, typename OutputImageType >
 void
 UpdateAndGraft(
-  typename GenericMultiResolutionPyramidImageFilterType::Pointer thisFilter,
   typename ImageToImageFilterType::Pointer & filter,
-  OutputImageType * outImage, const unsigned int ilevel )
+  OutputImageType * outImage )
 {
   filter->GraftOutput( outImage );
 
+  // stop within the filter if the registration is cancelled
+  itk::RegistrationProgress::AbortOnCancel( filter.GetPointer() );
+
   // force to always update in case shrink factors are the same
   filter->Modified();
   filter->UpdateLargestPossibleRegion();
-  thisFilter->GraftNthOutput( ilevel, filter->GetOutput() );
+  outImage->Graft( filter->GetOutput() );
 } // end UpdateAndGraft()
 
 
@@ -59,15 +62,39 @@ template< class TInputImage, class TOutputImage, class TPrecisionType >
 GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
 ::GenericMultiResolutionPyramidImageFilter()
 {
-  this->m_CurrentLevel               = 0;
-  this->m_ComputeOnlyForCurrentLevel = false;
+  this->m_CurrentLevel                  = 0;
+  this->m_ComputeOnlyForCurrentLevel    = false;
+  this->m_ComputeNextLevelInBackground  = false;
+  this->m_UseFusedSmoothingAndShrinking = false;
   SmoothingScheduleType temp( this->GetNumberOfLevels(), ImageDimension );
   temp.Fill( NumericTraits< ScalarRealType >::ZeroValue() );
   this->m_SmoothingSchedule        = temp;
   this->m_SmoothingScheduleDefined = false;
+
+  this->m_BackgroundThreadId                      = 0;
+  this->m_BackgroundRunning                       = false;
+  this->m_BackgroundSucceeded                     = false;
+  this->m_BackgroundLevel                         = 0;
+  this->m_BackgroundUseShrinkImageFilter          = false;
+  this->m_BackgroundUseFusedSmoothingAndShrinking = false;
+  this->m_BackgroundInputSource                   = 0;
+  this->m_BackgroundInputMTime                    = 0;
 } // end Constructor
 
 
+/**
+ * ******************* Destructor ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::~GenericMultiResolutionPyramidImageFilter()
+{
+  /** The background thread uses this object. */
+  this->WaitForBackgroundLevel();
+} // end Destructor
+
+
 /**
  * ******************* SetNumberOfLevels ***********************
  */
@@ -295,6 +322,10 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   // Pipeline also takes care of memory allocation for N'th output if
   // SetComputeOnlyForCurrentLevel has been set to true.
 
+  // A level that is still being computed in the background has to be
+  // finished before anything else is done.
+  this->WaitForBackgroundLevel();
+
   // Get the input and output pointers
   InputImageConstPointer input = this->GetInput();
 
@@ -329,10 +360,6 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
     this->SetSmoothingScheduleToDefault();
   }
 
-  typename SmootherType::Pointer smoother;
-  typename ImageToImageFilterSameTypes::Pointer rescaleSameTypes;
-  typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
-
   for( unsigned int level = 0; level < this->m_NumberOfLevels; ++level )
   {
     if( !this->m_ComputeOnlyForCurrentLevel )
@@ -341,49 +368,274 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
         / static_cast< float >( this->m_NumberOfLevels ) );
     }
 
+    // Stop here if the registration was cancelled
+    RegistrationProgress::ThrowIfCurrentCancelRequested();
+
     if( this->ComputeForCurrentLevel( level ) )
     {
-      // Allocate memory for each output
       OutputImagePointer outputPtr = this->GetOutput( level );
-      outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
-      outputPtr->Allocate();
-
-      // Setup the smoother
-      const bool smootherIsUsed = this->SetupSmoother( level, smoother, input );
-
-      // Setup the shrinker or resampler
-      const int shrinkerOrResamplerIsUsed = this->SetupShrinkerOrResampler( level,
-        smoother, smootherIsUsed, input, outputPtr,
-        rescaleSameTypes, rescaleDifferentTypes );
 
-      // Update the pipeline and graft or copy results to this filters output
-      if( shrinkerOrResamplerIsUsed == 0 && smootherIsUsed )
+      // Use the level computed in the background if possible
+      if( this->m_ComputeOnlyForCurrentLevel && this->IsBackgroundLevelUsable( level ) )
       {
-        UpdateAndGraft< Self, SmootherType, OutputImageType >(
-          this, smoother, outputPtr, level );
+        outputPtr->Graft( this->m_BackgroundOutput );
       }
-      else if( shrinkerOrResamplerIsUsed == 0 )
-      {
-        ImageAlgorithm::Copy( input.GetPointer(), outputPtr.GetPointer(),
-          input->GetLargestPossibleRegion(), outputPtr->GetLargestPossibleRegion() );
-      }
-      else if( shrinkerOrResamplerIsUsed == 1 )
-      {
-        UpdateAndGraft< Self, ImageToImageFilterSameTypes, OutputImageType >(
-          this, rescaleSameTypes, outputPtr, level );
-      }
-      else if( shrinkerOrResamplerIsUsed == 2 )
+      else
       {
-        UpdateAndGraft< Self, ImageToImageFilterDifferentTypes, OutputImageType >(
-          this, rescaleDifferentTypes, outputPtr, level );
+        SigmaArrayType sigmaArray;
+        this->GetSigma( level, sigmaArray );
+        RescaleFactorArrayType shrinkFactors;
+        this->GetShrinkFactors( level, shrinkFactors );
+
+        this->GenerateLevel( sigmaArray, shrinkFactors,
+          this->GetUseShrinkImageFilter(), this->m_UseFusedSmoothingAndShrinking,
+          input, outputPtr );
       }
-      // no else needed
-
     }
   } // end for ilevel
+
+  // The background images are not needed anymore
+  this->m_BackgroundInput  = 0;
+  this->m_BackgroundOutput = 0;
+
+  // Start with the next level, while the current one is being used
+  if( this->m_ComputeOnlyForCurrentLevel && this->m_ComputeNextLevelInBackground
+    && this->m_CurrentLevel + 1 < this->m_NumberOfLevels )
+  {
+    this->StartBackgroundLevel( this->m_CurrentLevel + 1 );
+  }
 }   // end GenerateData()
 
 
+/**
+ * ******************* GenerateLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateLevel( const SigmaArrayType & sigmaArray,
+  const RescaleFactorArrayType & shrinkFactors,
+  const bool useShrinkImageFilter,
+  const bool useFusedSmoothingAndShrinking,
+  const InputImageConstPointer & input,
+  const OutputImagePointer & outputPtr )
+{
+  typename SmootherType::Pointer smoother;
+  typename ImageToImageFilterSameTypes::Pointer rescaleSameTypes;
+  typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
+
+  // Allocate memory for the output
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+
+  // Smooth and shrink in a single pass if requested
+  if( useFusedSmoothingAndShrinking && useShrinkImageFilter
+    && !this->AreSigmasAllZeros( sigmaArray )
+    && !this->AreRescaleFactorsAllOnes( shrinkFactors ) )
+  {
+    typedef GaussianSmoothAndShrinkImageFilter<
+      InputImageType, OutputImageType >                 SmoothAndShrinkType;
+    typename SmoothAndShrinkType::SigmaArrayType sigmas;
+    for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+    {
+      sigmas[ dim ] = sigmaArray[ dim ];
+    }
+
+    typename SmoothAndShrinkType::Pointer smoothAndShrink = SmoothAndShrinkType::New();
+    smoothAndShrink->SetInput( input );
+    smoothAndShrink->SetShrinkFactors( shrinkFactors );
+    smoothAndShrink->SetSigmaArray( sigmas );
+
+    rescaleDifferentTypes = smoothAndShrink.GetPointer();
+    UpdateAndGraft< ImageToImageFilterDifferentTypes, OutputImageType >(
+      rescaleDifferentTypes, outputPtr );
+    return;
+  }
+
+  // Setup the smoother
+  const bool smootherIsUsed = this->SetupSmoother( sigmaArray, smoother, input );
+
+  // Setup the shrinker or resampler
+  const int shrinkerOrResamplerIsUsed = this->SetupShrinkerOrResampler( shrinkFactors,
+    smoother, smootherIsUsed, useShrinkImageFilter, input, outputPtr,
+    rescaleSameTypes, rescaleDifferentTypes );
+
+  // Update the pipeline and graft or copy results to the output
+  if( shrinkerOrResamplerIsUsed == 0 && smootherIsUsed )
+  {
+    UpdateAndGraft< SmootherType, OutputImageType >( smoother, outputPtr );
+  }
+  else if( shrinkerOrResamplerIsUsed == 0 )
+  {
+    ImageAlgorithm::Copy( input.GetPointer(), outputPtr.GetPointer(),
+      input->GetLargestPossibleRegion(), outputPtr->GetLargestPossibleRegion() );
+  }
+  else if( shrinkerOrResamplerIsUsed == 1 )
+  {
+    UpdateAndGraft< ImageToImageFilterSameTypes, OutputImageType >(
+      rescaleSameTypes, outputPtr );
+  }
+  else if( shrinkerOrResamplerIsUsed == 2 )
+  {
+    UpdateAndGraft< ImageToImageFilterDifferentTypes, OutputImageType >(
+      rescaleDifferentTypes, outputPtr );
+  }
+  // no else needed
+
+} // end GenerateLevel()
+
+
+/**
+ * ******************* StartBackgroundLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::StartBackgroundLevel( const unsigned int level )
+{
+  this->WaitForBackgroundLevel();
+
+  /** Copy the settings for this level. */
+  this->m_BackgroundLevel = level;
+  this->GetSigma( level, this->m_BackgroundSigmaArray );
+  this->GetShrinkFactors( level, this->m_BackgroundShrinkFactors );
+  this->m_BackgroundUseShrinkImageFilter          = this->GetUseShrinkImageFilter();
+  this->m_BackgroundUseFusedSmoothingAndShrinking = this->m_UseFusedSmoothingAndShrinking;
+
+  /** The background thread works on a graft of the input, which shares the
+   * buffer but is disconnected from the pipeline, so that it never triggers
+   * an update of the upstream filters.
+   */
+  const InputImageType * input = this->GetInput();
+  this->m_BackgroundInputSource = input;
+  this->m_BackgroundInputMTime  = input->GetMTime();
+  this->m_BackgroundInput       = InputImageType::New();
+  this->m_BackgroundInput->Graft( input );
+
+  /** The output information was already computed for all levels. */
+  const OutputImageType * output = this->GetOutput( level );
+  this->m_BackgroundOutput = OutputImageType::New();
+  this->m_BackgroundOutput->CopyInformation( output );
+  this->m_BackgroundOutput->SetRequestedRegion( output->GetRequestedRegion() );
+
+  if( this->m_BackgroundThreader.IsNull() )
+  {
+    this->m_BackgroundThreader = MultiThreader::New();
+  }
+
+  this->m_BackgroundSucceeded = false;
+  this->m_BackgroundThreadId  = this->m_BackgroundThreader->SpawnThread(
+    this->BackgroundLevelThreaderCallback, this );
+  this->m_BackgroundRunning = true;
+
+} // end StartBackgroundLevel()
+
+
+/**
+ * ******************* WaitForBackgroundLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::WaitForBackgroundLevel( void )
+{
+  /** TerminateThread() joins the thread. */
+  if( this->m_BackgroundRunning )
+  {
+    this->m_BackgroundThreader->TerminateThread( this->m_BackgroundThreadId );
+    this->m_BackgroundRunning = false;
+  }
+
+} // end WaitForBackgroundLevel()
+
+
+/**
+ * ******************* IsBackgroundLevelUsable ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+bool
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::IsBackgroundLevelUsable( const unsigned int level )
+{
+  if( !this->m_BackgroundSucceeded || this->m_BackgroundOutput.IsNull()
+    || this->m_BackgroundLevel != level )
+  {
+    return false;
+  }
+
+  /** Check that the input did not change. */
+  const InputImageType * input = this->GetInput();
+  if( input != this->m_BackgroundInputSource
+    || input->GetMTime() != this->m_BackgroundInputMTime )
+  {
+    return false;
+  }
+
+  /** Check that the settings for this level did not change. */
+  SigmaArrayType sigmaArray;
+  this->GetSigma( level, sigmaArray );
+  RescaleFactorArrayType shrinkFactors;
+  this->GetShrinkFactors( level, shrinkFactors );
+  if( sigmaArray != this->m_BackgroundSigmaArray
+    || shrinkFactors != this->m_BackgroundShrinkFactors
+    || this->GetUseShrinkImageFilter() != this->m_BackgroundUseShrinkImageFilter
+    || this->m_UseFusedSmoothingAndShrinking != this->m_BackgroundUseFusedSmoothingAndShrinking )
+  {
+    return false;
+  }
+
+  /** Check that the output information did not change. */
+  const OutputImageType * output     = this->GetOutput( level );
+  const OutputImageType * background = this->m_BackgroundOutput;
+  return output->GetLargestPossibleRegion() == background->GetLargestPossibleRegion()
+         && output->GetRequestedRegion() == background->GetBufferedRegion()
+         && output->GetSpacing() == background->GetSpacing()
+         && output->GetOrigin() == background->GetOrigin()
+         && output->GetDirection() == background->GetDirection();
+
+} // end IsBackgroundLevelUsable()
+
+
+/**
+ * ******************* BackgroundLevelThreaderCallback ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+ITK_THREAD_RETURN_TYPE
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::BackgroundLevelThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  Self * self = static_cast< Self * >( infoStruct->UserData );
+
+  /** Exceptions can not be passed to the main thread; on failure the level
+   * is simply computed again in GenerateData(), which then reports the error.
+   */
+  bool succeeded = true;
+  try
+  {
+    self->GenerateLevel( self->m_BackgroundSigmaArray,
+      self->m_BackgroundShrinkFactors, self->m_BackgroundUseShrinkImageFilter,
+      self->m_BackgroundUseFusedSmoothingAndShrinking,
+      InputImageConstPointer( self->m_BackgroundInput.GetPointer() ),
+      self->m_BackgroundOutput );
+  }
+  catch( ... )
+  {
+    succeeded = false;
+  }
+  self->m_BackgroundSucceeded = succeeded;
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end BackgroundLevelThreaderCallback()
+
+
 /**
  * ******************* SetupSmoother ***********************
  */
@@ -391,12 +643,10 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
 template< class TInputImage, class TOutputImage, class TPrecisionType >
 bool
 GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
-::SetupSmoother( const unsigned int level,
+::SetupSmoother( const SigmaArrayType & sigmaArray,
   typename SmootherType::Pointer & smoother,
   const InputImageConstPointer & input )
 {
-  SigmaArrayType sigmaArray;
-  this->GetSigma( level, sigmaArray );
   const bool sigmasAllZeros = this->AreSigmasAllZeros( sigmaArray );
   if( !sigmasAllZeros )
   {
@@ -419,22 +669,21 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
 template< class TInputImage, class TOutputImage, class TPrecisionType >
 int
 GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
-::SetupShrinkerOrResampler( const unsigned int level,
+::SetupShrinkerOrResampler( const RescaleFactorArrayType & shrinkFactors,
   typename SmootherType::Pointer & smoother, const bool sameType,
+  const bool useShrinkImageFilter,
   const InputImageConstPointer & inputPtr,
   const OutputImagePointer & outputPtr,
   typename ImageToImageFilterSameTypes::Pointer & rescaleSameTypes,
   typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes )
 {
-  RescaleFactorArrayType shrinkFactors;
-  this->GetShrinkFactors( level, shrinkFactors );
   const bool rescaleFactorsAllOnes = this->AreRescaleFactorsAllOnes( shrinkFactors );
 
   // No shrinking or resampling needed: return 0
   if( rescaleFactorsAllOnes ) { return 0; }
 
   // Choose between shrinker or resampler
-  this->DefineShrinkerOrResampler( sameType, shrinkFactors, outputPtr,
+  this->DefineShrinkerOrResampler( sameType, useShrinkImageFilter, shrinkFactors, outputPtr,
     rescaleSameTypes, rescaleDifferentTypes );
 
   // Rescaling is done with input and output type being equal: return 1
@@ -461,6 +710,7 @@ template< class TInputImage, class TOutputImage, class TPrecisionType >
 void
 GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
 ::DefineShrinkerOrResampler( const bool sameType,
+  const bool useShrinkImageFilter,
   const RescaleFactorArrayType & shrinkFactors,
   const OutputImagePointer & outputPtr,
   typename ImageToImageFilterSameTypes::Pointer & rescaleSameTypes,
@@ -484,7 +734,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
     // A pipeline version that newly constructs the required filters:
     if( rescaleSameTypes.IsNull() )
     {
-      if( this->GetUseShrinkImageFilter() )
+      if( useShrinkImageFilter )
       {
         // Define and setup shrinker
         typename ShrinkerSameType::Pointer shrinker = ShrinkerSameType::New();
@@ -515,7 +765,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
     // A pipeline version that re-uses previously constructed filters:
     else
     {
-      if( this->GetUseShrinkImageFilter() )
+      if( useShrinkImageFilter )
       {
         // Setup shrinker
         typename ShrinkerSameType::Pointer shrinker
@@ -541,7 +791,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   // A pipeline version that newly constructs the required filters:
   if( rescaleDifferentTypes.IsNull() )
   {
-    if( this->GetUseShrinkImageFilter() )
+    if( useShrinkImageFilter )
     {
       // Define and setup shrinker
       typename ShrinkerDifferentType::Pointer shrinker = ShrinkerDifferentType::New();
@@ -572,7 +822,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   // A pipeline version that re-uses previously constructed filters:
   else
   {
-    if( this->GetUseShrinkImageFilter() )
+    if( useShrinkImageFilter )
     {
       typename ShrinkerDifferentType::Pointer shrinker
         = dynamic_cast< ShrinkerDifferentType * >( rescaleDifferentTypes.GetPointer() );
@@ -914,6 +1164,10 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
      << this->m_CurrentLevel << std::endl;
   os << indent << "ComputeOnlyForCurrentLevel: "
      << ( this->m_ComputeOnlyForCurrentLevel ? "true" : "false" ) << std::endl;
+  os << indent << "ComputeNextLevelInBackground: "
+     << ( this->m_ComputeNextLevelInBackground ? "true" : "false" ) << std::endl;
+  os << indent << "UseFusedSmoothingAndShrinking: "
+     << ( this->m_UseFusedSmoothingAndShrinking ? "true" : "false" ) << std::endl;
   os << indent << "SmoothingScheduleDefined: "
      << ( this->m_SmoothingScheduleDefined ? "true" : "false" ) << std::endl;
   os << indent << "Smoothing Schedule: ";
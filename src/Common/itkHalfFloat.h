@@ -0,0 +1,140 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkHalfFloat_h
+#define __itkHalfFloat_h
+
+#include <cstring>
+
+namespace itk
+{
+
+/** \class HalfFloat
+ *
+ * \brief Conversion between float and 16 bit IEEE 754 half precision floats.
+ *
+ * Half precision floats have a sign bit, 5 exponent bits and 10 mantissa
+ * bits, i.e. a relative precision of about 5e-4 and a maximum of 65504.
+ * They are stored as unsigned short. Conversion from float rounds to the
+ * nearest half, ties to even; values that are too large become infinite.
+ * Subnormal numbers, infinity and NaN are supported.
+ */
+
+class HalfFloat
+{
+public:
+
+  typedef unsigned short StorageType;
+
+  /** Convert a float to half precision. */
+  static StorageType FromFloat( const float value )
+  {
+    unsigned int bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+
+    const StorageType  sign     = static_cast< StorageType >( ( bits >> 16 ) & 0x8000u );
+    const unsigned int exponent = ( bits >> 23 ) & 0xffu;
+    unsigned int       mantissa = bits & 0x7fffffu;
+
+    /** Infinity and NaN. */
+    if( exponent == 0xffu )
+    {
+      return static_cast< StorageType >( sign | 0x7c00u | ( mantissa ? 0x200u : 0u ) );
+    }
+
+    const int halfExponent = static_cast< int >( exponent ) - 127 + 15;
+    if( halfExponent >= 31 )
+    {
+      return static_cast< StorageType >( sign | 0x7c00u );
+    }
+
+    /** Subnormal halves, or zero. */
+    if( halfExponent <= 0 )
+    {
+      if( halfExponent < -10 )
+      {
+        return sign;
+      }
+      mantissa |= 0x800000u;
+      const unsigned int shift     = static_cast< unsigned int >( 14 - halfExponent );
+      unsigned int       half      = mantissa >> shift;
+      const unsigned int remainder = mantissa & ( ( 1u << shift ) - 1u );
+      const unsigned int halfway   = 1u << ( shift - 1u );
+      if( remainder > halfway || ( remainder == halfway && ( half & 1u ) ) )
+      {
+        ++half;
+      }
+      return static_cast< StorageType >( sign | half );
+    }
+
+    /** Normal halves; a carry of the rounding correctly increments the exponent. */
+    unsigned int       half      = ( static_cast< unsigned int >( halfExponent ) << 10 ) | ( mantissa >> 13 );
+    const unsigned int remainder = mantissa & 0x1fffu;
+    if( remainder > 0x1000u || ( remainder == 0x1000u && ( half & 1u ) ) )
+    {
+      ++half;
+    }
+    return static_cast< StorageType >( sign | half );
+  }
+
+
+  /** Convert a half precision float to float; this is exact. */
+  static float ToFloat( const StorageType value )
+  {
+    const unsigned int sign     = static_cast< unsigned int >( value & 0x8000u ) << 16;
+    unsigned int       exponent = ( value >> 10 ) & 0x1fu;
+    unsigned int       mantissa = value & 0x3ffu;
+    unsigned int       bits;
+
+    if( exponent == 0 )
+    {
+      if( mantissa == 0 )
+      {
+        bits = sign;
+      }
+      else
+      {
+        /** Normalize the subnormal half. */
+        exponent = 127 - 15 + 1;
+        while( !( mantissa & 0x400u ) )
+        {
+          mantissa <<= 1;
+          --exponent;
+        }
+        bits = sign | ( exponent << 23 ) | ( ( mantissa & 0x3ffu ) << 13 );
+      }
+    }
+    else if( exponent == 0x1fu )
+    {
+      bits = sign | 0x7f800000u | ( mantissa << 13 );
+    }
+    else
+    {
+      bits = sign | ( ( exponent + 127 - 15 ) << 23 ) | ( mantissa << 13 );
+    }
+
+    float result;
+    std::memcpy( &result, &bits, sizeof( result ) );
+    return result;
+  }
+
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkHalfFloat_h
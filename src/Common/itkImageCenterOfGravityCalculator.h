@@ -0,0 +1,160 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageCenterOfGravityCalculator_h
+#define __itkImageCenterOfGravityCalculator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkVector.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageCenterOfGravityCalculator
+ * \brief Computes the total mass and the center of gravity of a scalar
+ * image, optionally restricted to a mask.
+ *
+ * The result equals the zeroth and first order moments computed by
+ * itk::ImageMomentsCalculator, but the voxels are visited in parallel on the
+ * PersistentThreadPool, one slice (the last image dimension) per chunk. The
+ * partial sums of the slices are added in a fixed order, so the result does
+ * not depend on the number of threads.
+ *
+ * The intensities are weighted by their voxel indices; as the mapping from
+ * index to physical space is affine, the weighted mean index is converted to
+ * a physical point only once. Physical points are only computed per voxel
+ * when a mask is set; a voxel counts when the nearest mask pixel is nonzero.
+ *
+ * With a MaximumNumberOfSamples larger than zero, the image is sampled on a
+ * regular grid with the same step in every dimension, chosen such that at
+ * most about that number of voxels is visited. Zero visits all voxels.
+ */
+
+template< class TImage >
+class ImageCenterOfGravityCalculator : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ImageCenterOfGravityCalculator Self;
+  typedef Object                         Superclass;
+  typedef SmartPointer< Self >           Pointer;
+  typedef SmartPointer< const Self >     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageCenterOfGravityCalculator, Object );
+
+  /** The image dimension. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TImage                                  ImageType;
+  typedef typename ImageType::ConstPointer        ImageConstPointer;
+  typedef typename ImageType::RegionType          RegionType;
+  typedef typename ImageType::IndexType           IndexType;
+  typedef typename ImageType::PointType           PointType;
+  typedef Image< unsigned char, ImageDimension >  MaskImageType;
+  typedef typename MaskImageType::ConstPointer    MaskImageConstPointer;
+  typedef Vector< double, ImageDimension >        VectorType;
+  typedef double                                  ScalarType;
+
+  /** Set/Get the image. */
+  itkSetConstObjectMacro( Image, ImageType );
+  itkGetConstObjectMacro( Image, ImageType );
+
+  /** Set/Get the mask; NULL (the default) uses all voxels. */
+  itkSetConstObjectMacro( Mask, MaskImageType );
+  itkGetConstObjectMacro( Mask, MaskImageType );
+
+  /** Set/Get the maximum number of voxels to visit. The default, 0, visits
+   * all voxels.
+   */
+  itkSetMacro( MaximumNumberOfSamples, SizeValueType );
+  itkGetConstMacro( MaximumNumberOfSamples, SizeValueType );
+
+  /** Set/Get whether the PersistentThreadPool is used. The default is true. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Compute the total mass and the center of gravity. Throws when the
+   * total mass is zero.
+   */
+  void Compute( void );
+
+  /** Get the sum of the intensities of the visited voxels. */
+  itkGetConstMacro( TotalMass, ScalarType );
+
+  /** Get the center of gravity, in physical coordinates. */
+  itkGetConstMacro( CenterOfGravity, VectorType );
+
+  /** Get the grid step of the last Compute(). */
+  itkGetConstMacro( SamplingStep, SizeValueType );
+
+protected:
+
+  ImageCenterOfGravityCalculator();
+  virtual ~ImageCenterOfGravityCalculator() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  ImageCenterOfGravityCalculator( const Self & ); // purposely not implemented
+  void operator=( const Self & );                 // purposely not implemented
+
+  /** The data shared by the slices. The sums of a slice are stored as
+   * the mass followed by the index weighted intensities.
+   */
+  struct ComputeJobType
+  {
+    const Self *          st_Calculator;
+    RegionType            st_Region;
+    SizeValueType         st_Step;
+    std::vector< double > st_SliceSums;
+  };
+
+  /** Sum the sampled voxels of the slices [begin, end). */
+  static void ComputeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  ImageConstPointer     m_Image;
+  MaskImageConstPointer m_Mask;
+  SizeValueType         m_MaximumNumberOfSamples;
+  bool                  m_UseMultiThread;
+
+  ScalarType    m_TotalMass;
+  VectorType    m_CenterOfGravity;
+  SizeValueType m_SamplingStep;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageCenterOfGravityCalculator.hxx"
+#endif
+
+#endif // end #ifndef __itkImageCenterOfGravityCalculator_h
@@ -0,0 +1,225 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageCenterOfGravityCalculator_hxx
+#define __itkImageCenterOfGravityCalculator_hxx
+
+#include "itkImageCenterOfGravityCalculator.h"
+#include "itkPersistentThreadPool.h"
+#include "itkContinuousIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ************************* Constructor *********************
+ */
+
+template< class TImage >
+ImageCenterOfGravityCalculator< TImage >
+::ImageCenterOfGravityCalculator()
+{
+  this->m_MaximumNumberOfSamples = 0;
+  this->m_UseMultiThread         = true;
+  this->m_TotalMass              = 0.0;
+  this->m_CenterOfGravity.Fill( 0.0 );
+  this->m_SamplingStep = 1;
+
+} // end Constructor
+
+
+/**
+ * ************************* Compute *********************
+ */
+
+template< class TImage >
+void
+ImageCenterOfGravityCalculator< TImage >
+::Compute( void )
+{
+  if( !this->m_Image )
+  {
+    itkExceptionMacro( << "Compute(): No image has been set." );
+  }
+
+  /** Determine the grid step. The first guess from the number of voxels may
+   * be too small, due to the rounding up of the sampled sizes.
+   */
+  ComputeJobType job;
+  job.st_Calculator = this;
+  job.st_Region     = this->m_Image->GetBufferedRegion();
+  job.st_Step       = 1;
+  const typename RegionType::SizeType & size = job.st_Region.GetSize();
+  const SizeValueType numberOfPixels = job.st_Region.GetNumberOfPixels();
+  if( this->m_MaximumNumberOfSamples > 0
+    && numberOfPixels > this->m_MaximumNumberOfSamples )
+  {
+    const double ratio = static_cast< double >( numberOfPixels )
+      / static_cast< double >( this->m_MaximumNumberOfSamples );
+    job.st_Step = std::max< SizeValueType >( 1, static_cast< SizeValueType >(
+      std::floor( std::pow( ratio, 1.0 / ImageDimension ) ) ) );
+    while( true )
+    {
+      SizeValueType numberOfSamples = 1;
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        numberOfSamples *= ( size[ d ] + job.st_Step - 1 ) / job.st_Step;
+      }
+      if( numberOfSamples <= this->m_MaximumNumberOfSamples ) { break; }
+      ++job.st_Step;
+    }
+  }
+  this->m_SamplingStep = job.st_Step;
+
+  /** Sum the slices. */
+  const SizeValueType numberOfSlices
+    = ( size[ ImageDimension - 1 ] + job.st_Step - 1 ) / job.st_Step;
+  job.st_SliceSums.assign( numberOfSlices * ( ImageDimension + 1 ), 0.0 );
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfSlices, 1, Self::ComputeRangeFunction, &job );
+  }
+  else
+  {
+    Self::ComputeRangeFunction( &job, 0, 0, numberOfSlices );
+  }
+
+  /** Add the slices in a fixed order. */
+  double sums[ ImageDimension + 1 ];
+  std::fill( sums, sums + ImageDimension + 1, 0.0 );
+  for( SizeValueType s = 0; s < numberOfSlices; ++s )
+  {
+    const double * sliceSums = &job.st_SliceSums[ s * ( ImageDimension + 1 ) ];
+    for( unsigned int i = 0; i <= ImageDimension; ++i )
+    {
+      sums[ i ] += sliceSums[ i ];
+    }
+  }
+
+  this->m_TotalMass = sums[ 0 ];
+  if( this->m_TotalMass == 0.0 )
+  {
+    itkExceptionMacro( << "Compute(): Total Mass of the image was zero. "
+                       << "Aborting here to prevent division by zero later on." );
+  }
+
+  /** The indices were summed relative to the start of the region. */
+  ContinuousIndex< double, ImageDimension > centerIndex;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    centerIndex[ d ] = job.st_Region.GetIndex()[ d ] + sums[ d + 1 ] / this->m_TotalMass;
+  }
+  Point< double, ImageDimension > centerPoint;
+  this->m_Image->TransformContinuousIndexToPhysicalPoint( centerIndex, centerPoint );
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    this->m_CenterOfGravity[ d ] = centerPoint[ d ];
+  }
+
+} // end Compute()
+
+
+/**
+ * ************************* ComputeRangeFunction *********************
+ */
+
+template< class TImage >
+void
+ImageCenterOfGravityCalculator< TImage >
+::ComputeRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  ComputeJobType *      job   = static_cast< ComputeJobType * >( userData );
+  const ImageType *     image = job->st_Calculator->m_Image.GetPointer();
+  const MaskImageType * mask  = job->st_Calculator->m_Mask.GetPointer();
+  const typename ImageType::PixelType * buffer = image->GetBufferPointer();
+
+  const IndexType &                     start = job->st_Region.GetIndex();
+  const typename RegionType::SizeType & size  = job->st_Region.GetSize();
+  const IndexValueType                  step  = static_cast< IndexValueType >( job->st_Step );
+
+  PointType                          point;
+  typename MaskImageType::IndexType  maskIndex;
+  for( SizeValueType s = begin; s < end; ++s )
+  {
+    double * sums = &job->st_SliceSums[ s * ( ImageDimension + 1 ) ];
+    IndexType index = start;
+    index[ ImageDimension - 1 ] += static_cast< IndexValueType >( s ) * step;
+
+    while( true )
+    {
+      bool inside = true;
+      if( mask )
+      {
+        image->TransformIndexToPhysicalPoint( index, point );
+        inside = mask->TransformPhysicalPointToIndex( point, maskIndex )
+          && mask->GetPixel( maskIndex ) != 0;
+      }
+      if( inside )
+      {
+        const double value = static_cast< double >( buffer[ image->ComputeOffset( index ) ] );
+        sums[ 0 ] += value;
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          sums[ d + 1 ] += value * static_cast< double >( index[ d ] - start[ d ] );
+        }
+      }
+
+      /** Next grid point of the slice. */
+      unsigned int d = 0;
+      for( ; d + 1 < ImageDimension; ++d )
+      {
+        index[ d ] += step;
+        if( index[ d ] < start[ d ] + static_cast< IndexValueType >( size[ d ] ) ) { break; }
+        index[ d ] = start[ d ];
+      }
+      if( d + 1 >= ImageDimension ) { break; }
+    }
+  }
+
+} // end ComputeRangeFunction()
+
+
+/**
+ * ************************* PrintSelf *********************
+ */
+
+template< class TImage >
+void
+ImageCenterOfGravityCalculator< TImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Image: " << this->m_Image.GetPointer() << std::endl;
+  os << indent << "Mask: " << this->m_Mask.GetPointer() << std::endl;
+  os << indent << "MaximumNumberOfSamples: " << this->m_MaximumNumberOfSamples << std::endl;
+  os << indent << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+  os << indent << "SamplingStep: " << this->m_SamplingStep << std::endl;
+  os << indent << "TotalMass: " << this->m_TotalMass << std::endl;
+  os << indent << "CenterOfGravity: " << this->m_CenterOfGravity << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageCenterOfGravityCalculator_hxx
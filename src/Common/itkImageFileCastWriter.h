@@ -23,7 +23,9 @@
 #include "itkExceptionObject.h"
 #include "itkSize.h"
 #include "itkImageIORegion.h"
-#include "itkCastImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +37,16 @@ namespace itk
  * if necessary. This is useful in some cases, to avoid the use of
  * a itk::CastImageFilter (to save memory for example).
  *
+ * Only the region that the image IO writes is cast, so when the image is
+ * written in pieces, see SetNumberOfStreamDivisions(), no full size copy
+ * is made.
+ *
+ * When compression is requested for a MetaImage (.mha or .mhd) of scalars,
+ * and SetUseParallelCompression() is on, the writer writes the file itself:
+ * the pixels are cast and compressed in blocks, on the threads of the
+ * PersistentThreadPool. The blocks form one standard zlib stream, which any
+ * MetaImage reader can read. The compression level can be set with
+ * SetCompressionLevel().
  */
 template< class TInputImage >
 class ITKIOImageBase_HIDDEN ImageFileCastWriter : public ImageFileWriter< TInputImage >
@@ -70,6 +82,25 @@ public:
   /** Determine the default outputcomponentType */
   std::string GetDefaultOutputComponentType( void ) const;
 
+  /** Compress MetaImages in parallel blocks. Default: false. */
+  itkSetMacro( UseParallelCompression, bool );
+  itkGetConstMacro( UseParallelCompression, bool );
+  itkBooleanMacro( UseParallelCompression );
+
+  /** The zlib compression level of the parallel compression, from 1 (fast)
+   * to 9 (small). Default: 6.
+   */
+  itkSetClampMacro( CompressionLevel, int, 1, 9 );
+  itkGetConstMacro( CompressionLevel, int );
+
+  /** The number of bytes per compressed block. Default: 1 MB. */
+  itkSetClampMacro( CompressionBlockSize, SizeValueType,
+    64 * 1024, 1024 * 1024 * 1024 );
+  itkGetConstMacro( CompressionBlockSize, SizeValueType );
+
+  /** Write the image, see the class description. */
+  virtual void Write( void ) ITK_OVERRIDE;
+
 protected:
 
   ImageFileCastWriter();
@@ -78,46 +109,92 @@ protected:
   /** Does the real work. */
   void GenerateData( void );
 
-  /** Templated function that casts the input image and returns a
-   * a pointer to the PixelBuffer. Assumes scalar singlecomponent images
-   * The buffer data is valid until this->m_Caster is destroyed or assigned
-   * a new caster. The ImageIO's PixelType is also adapted by this function */
+  /** Templated function that casts the pixels of \a region of the input
+   * image and returns a pointer to the converted buffer. Assumes scalar
+   * singlecomponent images. The buffer data is valid until the next
+   * conversion. The ImageIO's PixelType is also adapted by this function */
   template< class OutputComponentType >
   void * ConvertScalarImage( const DataObject * inputImage,
+    const InputImageRegionType & region,
     const OutputComponentType & itkNotUsed( dummy ) )
   {
-    typedef Image< OutputComponentType, InputImageDimension >      DiskImageType;
     typedef typename PixelTraits< InputImagePixelType >::ValueType InputImageComponentType;
     typedef Image< InputImageComponentType, InputImageDimension >  ScalarInputImageType;
-    typedef CastImageFilter< ScalarInputImageType, DiskImageType > CasterType;
 
     /** Reconfigure the imageIO */
     //this->GetImageIO()->SetPixelTypeInfo( typeid(OutputComponentType) );
     this->GetImageIO()->SetPixelTypeInfo( static_cast< const OutputComponentType * >( 0 ) );
 
-    /** cast the input image */
-    typename CasterType::Pointer caster                    = CasterType::New();
-    this->m_Caster                                         = caster;
+    /** cast the pixels of the region */
     typename ScalarInputImageType::Pointer localInputImage = ScalarInputImageType::New();
     localInputImage->Graft( inputImage );
-    caster->SetInput( localInputImage );
-    caster->Update();
+    this->m_ConvertedBuffer.resize( region.GetNumberOfPixels() * sizeof( OutputComponentType ) + 1 );
+    OutputComponentType * pixelBuffer
+      = reinterpret_cast< OutputComponentType * >( &this->m_ConvertedBuffer[ 0 ] );
+
+    ImageRegionConstIterator< ScalarInputImageType > it( localInputImage, region );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++pixelBuffer )
+    {
+      *pixelBuffer = static_cast< OutputComponentType >( it.Get() );
+    }
 
-    /** return the pixel buffer of the casted image */
-    OutputComponentType * pixelBuffer     = caster->GetOutput()->GetBufferPointer();
-    void *                convertedBuffer = static_cast< void * >( pixelBuffer );
-    return convertedBuffer;
+    return static_cast< void * >( &this->m_ConvertedBuffer[ 0 ] );
   }
 
 
-  ProcessObject::Pointer m_Caster;
+  /** Casts \a region to the OutputComponentType, see ConvertScalarImage().
+   * Returns 0 for an unknown component type.
+   */
+  void * ConvertScalarImageRegion( const DataObject * inputImage,
+    const InputImageRegionType & region );
+
+  /** Writes a compressed MetaImage with parallel block compression. */
+  template< class OutputComponentType >
+  void WriteCompressedMetaImage( const char * elementType );
+
+  /** Returns whether WriteCompressedMetaImage() can write the image. */
+  bool CanWriteCompressedMetaImage( void ) const;
+
+  /** Casts \a count pixels of the input buffer, starting at \a first, to
+   * the OutputComponentType, into \a output.
+   */
+  template< class OutputComponentType >
+  static void CastPixels( const void * input, SizeValueType first,
+    SizeValueType count, char * output );
+
+  /** The data of the blocks of one batch of WriteCompressedMetaImage(). */
+  struct CompressBlocksParameterType
+  {
+    typedef void (* CastFunctionType)( const void *, SizeValueType, SizeValueType, char * );
+
+    CastFunctionType                              st_CastFunction;
+    const void *                                  st_Input;
+    SizeValueType                                 st_NumberOfPixels;
+    SizeValueType                                 st_PixelsPerBlock;
+    SizeValueType                                 st_PixelSize;
+    SizeValueType                                 st_FirstBlock;
+    int                                           st_CompressionLevel;
+    std::vector< std::vector< unsigned char > > * st_CompressedBlocks;
+    std::vector< unsigned long > *                st_Checksums;
+    std::vector< unsigned char > *                st_Succeeded;
+  };
+
+  /** Compresses a range of blocks, as part of WriteCompressedMetaImage(). */
+  static void CompressBlocksRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The buffer of the cast pixels. */
+  std::vector< char > m_ConvertedBuffer;
 
 private:
 
   ImageFileCastWriter( const Self & ); // purposely not implemented
   void operator=( const Self & );      // purposely not implemented
 
-  std::string m_OutputComponentType;
+  std::string   m_OutputComponentType;
+  bool          m_UseParallelCompression;
+  int           m_CompressionLevel;
+  SizeValueType m_CompressionBlockSize;
 };
 
 } // end namespace itk
@@ -27,6 +27,15 @@
 #include "itkVectorImage.h"
 #include "itkDefaultConvertPixelTraits.h"
 #include "itkMetaImageIO.h"
+#include "itkPersistentThreadPool.h"
+#include "itkByteSwapper.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <itksys/SystemTools.hxx>
 
 namespace itk
 {
@@ -36,8 +45,10 @@ template< class TInputImage >
 ImageFileCastWriter< TInputImage >
 ::ImageFileCastWriter()
 {
-  this->m_Caster              = 0;
-  this->m_OutputComponentType = this->GetDefaultOutputComponentType();
+  this->m_OutputComponentType    = this->GetDefaultOutputComponentType();
+  this->m_UseParallelCompression = false;
+  this->m_CompressionLevel       = 6;
+  this->m_CompressionBlockSize   = 1024 * 1024;
 }
 
 
@@ -65,8 +76,82 @@ ImageFileCastWriter< TInputImage >
 template< class TInputImage >
 ImageFileCastWriter< TInputImage >
 ::~ImageFileCastWriter()
+{}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::Write( void )
 {
-  this->m_Caster = 0;
+  if( !this->CanWriteCompressedMetaImage() )
+  {
+    this->Superclass::Write();
+    return;
+  }
+
+  /** Make sure the input is up to date. */
+  InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+  input->UpdateOutputInformation();
+  input->SetRequestedRegionToLargestPossibleRegion();
+  input->PropagateRequestedRegion();
+  input->UpdateOutputData();
+
+  this->InvokeEvent( StartEvent() );
+
+  /** The MetaImage element types of the component types. */
+  const std::string & type = this->m_OutputComponentType;
+  if( type == "char" ) { this->WriteCompressedMetaImage< char >( "MET_CHAR" ); }
+  else if( type == "unsigned_char" ) { this->WriteCompressedMetaImage< unsigned char >( "MET_UCHAR" ); }
+  else if( type == "short" ) { this->WriteCompressedMetaImage< short >( "MET_SHORT" ); }
+  else if( type == "unsigned_short" ) { this->WriteCompressedMetaImage< unsigned short >( "MET_USHORT" ); }
+  else if( type == "int" ) { this->WriteCompressedMetaImage< int >( "MET_INT" ); }
+  else if( type == "unsigned_int" ) { this->WriteCompressedMetaImage< unsigned int >( "MET_UINT" ); }
+  else if( type == "long" )
+  {
+    this->WriteCompressedMetaImage< long >( sizeof( long ) == 8 ? "MET_LONG_LONG" : "MET_LONG" );
+  }
+  else if( type == "unsigned_long" )
+  {
+    this->WriteCompressedMetaImage< unsigned long >( sizeof( long ) == 8 ? "MET_ULONG_LONG" : "MET_ULONG" );
+  }
+  else if( type == "float" ) { this->WriteCompressedMetaImage< float >( "MET_FLOAT" ); }
+  else if( type == "double" ) { this->WriteCompressedMetaImage< double >( "MET_DOUBLE" ); }
+
+  this->InvokeEvent( EndEvent() );
+
+  /** Release upstream data if requested. */
+  if( input->ShouldIReleaseData() )
+  {
+    input->ReleaseData();
+  }
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+bool
+ImageFileCastWriter< TInputImage >
+::CanWriteCompressedMetaImage( void ) const
+{
+  if( !this->m_UseParallelCompression || !this->GetUseCompression() )
+  {
+    return false;
+  }
+
+  /** Only scalar MetaImages, of the known component types. */
+  const std::string extension = itksys::SystemTools::LowerCase(
+    itksys::SystemTools::GetFilenameLastExtension( this->GetFileName() ) );
+  const InputImageType * input = this->GetInput();
+  const std::string &    type  = this->m_OutputComponentType;
+  return ( extension == ".mha" || extension == ".mhd" )
+         && input != 0
+         && strcmp( input->GetNameOfClass(), "VectorImage" ) != 0
+         && input->GetNumberOfComponentsPerPixel() == 1
+         && ( type == "char" || type == "unsigned_char" || type == "short"
+         || type == "unsigned_short" || type == "int" || type == "unsigned_int"
+         || type == "long" || type == "unsigned_long" || type == "float" || type == "double" );
 }
 
 
@@ -106,83 +191,352 @@ ImageFileCastWriter< TInputImage >
   /** Get the number of Components */
   unsigned int numberOfComponents = this->GetImageIO()->GetNumberOfComponents();
 
+  /** The region that the image IO writes now; when the image is written in
+   * pieces it is a part of the buffered region.
+   */
+  InputImageRegionType ioRegion;
+  ImageIORegionAdaptor< InputImageDimension >::Convert(
+    this->GetImageIO()->GetIORegion(), ioRegion,
+    input->GetLargestPossibleRegion().GetIndex() );
+  const bool wholeBuffer = ioRegion == input->GetBufferedRegion();
+
   /** Extract the data as a raw buffer pointer and possibly convert.
    * Converting is only possible if the number of components equals 1 */
   if(
-    this->m_OutputComponentType !=
+    ( this->m_OutputComponentType !=
     this->GetImageIO()->GetComponentTypeAsString( this->GetImageIO()->GetComponentType() )
+    || !wholeBuffer )
     && numberOfComponents == 1 )
   {
-    void *             convertedDataBuffer = 0;
     const DataObject * inputAsDataObject
       = dynamic_cast< const DataObject * >( input );
 
     /** convert the scalar image to a scalar image with another componenttype
      * The imageIO's PixelType is also changed */
-    if( this->m_OutputComponentType == "char" )
+    void * convertedDataBuffer = this->ConvertScalarImageRegion( inputAsDataObject, ioRegion );
+    if( convertedDataBuffer == 0 )
     {
-      char dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy );
-    }
-    else if( this->m_OutputComponentType == "unsigned_char" )
-    {
-      unsigned char dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy );
-    }
-    else if( this->m_OutputComponentType == "short" )
-    {
-      short dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy    );
-    }
-    else if( this->m_OutputComponentType == "unsigned_short" )
-    {
-      unsigned short dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "int" )
-    {
-      int dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "unsigned_int" )
-    {
-      unsigned int dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "long" )
-    {
-      long dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "unsigned_long" )
-    {
-      unsigned long dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "float" )
-    {
-      float dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
-    }
-    else if( this->m_OutputComponentType == "double" )
-    {
-      double dummy;
-      convertedDataBuffer = this->ConvertScalarImage( inputAsDataObject, dummy   );
+      itkExceptionMacro( << "Unsupported output component type: " << this->m_OutputComponentType );
     }
 
     /** Do the writing */
     this->GetImageIO()->Write( convertedDataBuffer );
-    /** Release the caster's memory */
-    this->m_Caster = 0;
+
+    /** Release the memory of the converted pixels */
+    std::vector< char >().swap( this->m_ConvertedBuffer );
 
   }
-  else
+  else if( wholeBuffer )
   {
     /** No casting needed or possible, just write */
     const void * dataPtr = (const void *)input->GetBufferPointer();
     this->GetImageIO()->Write( dataPtr );
   }
+  else
+  {
+    itkExceptionMacro( << "Images with multiple components can only be written in one piece." );
+  }
+
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void *
+ImageFileCastWriter< TInputImage >
+::ConvertScalarImageRegion( const DataObject * inputImage,
+  const InputImageRegionType & region )
+{
+  const std::string & type = this->m_OutputComponentType;
+  if( type == "char" )
+  {
+    char dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "unsigned_char" )
+  {
+    unsigned char dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "short" )
+  {
+    short dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "unsigned_short" )
+  {
+    unsigned short dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "int" )
+  {
+    int dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "unsigned_int" )
+  {
+    unsigned int dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "long" )
+  {
+    long dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "unsigned_long" )
+  {
+    unsigned long dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "float" )
+  {
+    float dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  else if( type == "double" )
+  {
+    double dummy;
+    return this->ConvertScalarImage( inputImage, region, dummy );
+  }
+  return 0;
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+template< class OutputComponentType >
+void
+ImageFileCastWriter< TInputImage >
+::CastPixels( const void * input, SizeValueType first,
+  SizeValueType count, char * output )
+{
+  typedef typename PixelTraits< InputImagePixelType >::ValueType InputImageComponentType;
+
+  const InputImageComponentType * in  = static_cast< const InputImageComponentType * >( input ) + first;
+  OutputComponentType *           out = reinterpret_cast< OutputComponentType * >( output );
+  for( SizeValueType i = 0; i < count; ++i )
+  {
+    out[ i ] = static_cast< OutputComponentType >( in[ i ] );
+  }
+}
 
+
+//---------------------------------------------------------
+template< class TInputImage >
+template< class OutputComponentType >
+void
+ImageFileCastWriter< TInputImage >
+::WriteCompressedMetaImage( const char * elementType )
+{
+  const InputImageType *     input          = this->GetInput();
+  const InputImageRegionType largestRegion  = input->GetLargestPossibleRegion();
+  const SizeValueType        numberOfPixels = largestRegion.GetNumberOfPixels();
+  if( input->GetBufferedRegion() != largestRegion )
+  {
+    itkExceptionMacro( << "The input of the parallel compression must be complete." );
+  }
+
+  /** The header, with the geometry of the image. For a .mhd the compressed
+   * data is written to a .zraw file next to it. The compressed size is only
+   * known at the end, so room is kept for it.
+   */
+  const std::string fileName = this->GetFileName();
+  const bool        local    = itksys::SystemTools::LowerCase(
+    itksys::SystemTools::GetFilenameLastExtension( fileName ) ) == ".mha";
+  const std::string dataFileName = local ? fileName
+    : itksys::SystemTools::GetFilenamePath( fileName ) + "/"
+    + itksys::SystemTools::GetFilenameWithoutLastExtension( fileName ) + ".zraw";
+
+  std::ofstream header( fileName.c_str(), std::ios::out | std::ios::binary );
+  if( !header.is_open() )
+  {
+    itkExceptionMacro( << "File \"" << fileName << "\" could not be opened." );
+  }
+
+  typename InputImageType::PointType origin;
+  input->TransformIndexToPhysicalPoint( largestRegion.GetIndex(), origin );
+  const unsigned int dim = InputImageDimension;
+
+  header << std::setprecision( 16 );
+  header << "ObjectType = Image\n";
+  header << "NDims = " << dim << "\n";
+  header << "BinaryData = True\n";
+  header << "BinaryDataByteOrderMSB = "
+         << ( ByteSwapper< int >::SystemIsBigEndian() ? "True" : "False" ) << "\n";
+  header << "CompressedData = True\n";
+  header << "CompressedDataSize = ";
+  const std::streampos compressedSizePosition = header.tellp();
+  header << std::setw( 20 ) << std::setfill( '0' ) << 0 << std::setfill( ' ' ) << "\n";
+  header << "TransformMatrix =";
+  for( unsigned int i = 0; i < dim; ++i )
+  {
+    for( unsigned int j = 0; j < dim; ++j )
+    {
+      header << " " << input->GetDirection()[ j ][ i ];
+    }
+  }
+  header << "\nOffset =";
+  for( unsigned int i = 0; i < dim; ++i ) { header << " " << origin[ i ]; }
+  header << "\nCenterOfRotation =";
+  for( unsigned int i = 0; i < dim; ++i ) { header << " 0"; }
+  header << "\nElementSpacing =";
+  for( unsigned int i = 0; i < dim; ++i ) { header << " " << input->GetSpacing()[ i ]; }
+  header << "\nDimSize =";
+  for( unsigned int i = 0; i < dim; ++i ) { header << " " << largestRegion.GetSize( i ); }
+  header << "\nElementType = " << elementType << "\n";
+  header << "ElementDataFile = "
+         << ( local ? std::string( "LOCAL" ) : itksys::SystemTools::GetFilenameName( dataFileName ) ) << "\n";
+
+  std::ofstream  dataFile;
+  std::ostream * data = &header;
+  if( !local )
+  {
+    dataFile.open( dataFileName.c_str(), std::ios::out | std::ios::binary );
+    if( !dataFile.is_open() )
+    {
+      itkExceptionMacro( << "File \"" << dataFileName << "\" could not be opened." );
+    }
+    data = &dataFile;
+  }
+
+  /** A zlib stream: the header, the raw deflate blocks, and the checksum.
+   * The blocks are compressed in batches, and written in order.
+   */
+  const unsigned char zlibHeader[ 2 ] = { 0x78, 0x9C };
+  data->write( reinterpret_cast< const char * >( zlibHeader ), 2 );
+  SizeValueType compressedSize = 2;
+
+  PersistentThreadPool::Pointer pool         = PersistentThreadPool::GetInstance();
+  const SizeValueType           pixelSize    = sizeof( OutputComponentType );
+  const SizeValueType           batchSize    = 4 * pool->GetNumberOfThreads();
+  std::vector< std::vector< unsigned char > > compressedBlocks( batchSize );
+  std::vector< unsigned long >                checksums( batchSize );
+  std::vector< unsigned char >                succeeded( batchSize );
+
+  CompressBlocksParameterType pass;
+  pass.st_CastFunction     = &Self::template CastPixels< OutputComponentType >;
+  pass.st_Input            = input->GetBufferPointer();
+  pass.st_NumberOfPixels   = numberOfPixels;
+  pass.st_PixelsPerBlock   = std::max< SizeValueType >( this->m_CompressionBlockSize / pixelSize, 1 );
+  pass.st_PixelSize        = pixelSize;
+  pass.st_CompressionLevel = this->m_CompressionLevel;
+  pass.st_CompressedBlocks = &compressedBlocks;
+  pass.st_Checksums        = &checksums;
+  pass.st_Succeeded        = &succeeded;
+
+  const SizeValueType numberOfBlocks
+    = ( numberOfPixels + pass.st_PixelsPerBlock - 1 ) / pass.st_PixelsPerBlock;
+  uLong checksum = adler32( 0L, Z_NULL, 0 );
+  for( SizeValueType firstBlock = 0; firstBlock < numberOfBlocks; firstBlock += batchSize )
+  {
+    const SizeValueType blocks = std::min( batchSize, numberOfBlocks - firstBlock );
+    pass.st_FirstBlock = firstBlock;
+    pool->ParallelFor( blocks, 1, CompressBlocksRangeFunction, &pass );
+
+    for( SizeValueType b = 0; b < blocks; ++b )
+    {
+      if( !succeeded[ b ] )
+      {
+        itkExceptionMacro( << "Error occurred while compressing \"" << fileName << "\"." );
+      }
+      const SizeValueType blockBegin = ( firstBlock + b ) * pass.st_PixelsPerBlock;
+      const SizeValueType blockSize
+        = std::min( pass.st_PixelsPerBlock, numberOfPixels - blockBegin ) * pixelSize;
+      checksum = adler32_combine( checksum, checksums[ b ], static_cast< z_off_t >( blockSize ) );
+
+      data->write( reinterpret_cast< const char * >( &compressedBlocks[ b ][ 0 ] ),
+        compressedBlocks[ b ].size() );
+      compressedSize += compressedBlocks[ b ].size();
+      std::vector< unsigned char >().swap( compressedBlocks[ b ] );
+    }
+  }
+
+  /** An image without pixels still needs a final block. */
+  if( numberOfBlocks == 0 )
+  {
+    const unsigned char emptyBlock[ 2 ] = { 0x03, 0x00 };
+    data->write( reinterpret_cast< const char * >( emptyBlock ), 2 );
+    compressedSize += 2;
+  }
+
+  const unsigned char trailer[ 4 ] = {
+    static_cast< unsigned char >( ( checksum >> 24 ) & 0xFF ),
+    static_cast< unsigned char >( ( checksum >> 16 ) & 0xFF ),
+    static_cast< unsigned char >( ( checksum >> 8 ) & 0xFF ),
+    static_cast< unsigned char >( checksum & 0xFF )
+  };
+  data->write( reinterpret_cast< const char * >( trailer ), 4 );
+  compressedSize += 4;
+
+  /** Fill in the compressed size. */
+  header.seekp( compressedSizePosition );
+  header << std::setw( 20 ) << std::setfill( '0' ) << compressedSize;
+  if( !header || ( !local && !dataFile ) )
+  {
+    itkExceptionMacro( << "Error occurred while writing \"" << fileName << "\"." );
+  }
+}
+
+
+//---------------------------------------------------------
+template< class TInputImage >
+void
+ImageFileCastWriter< TInputImage >
+::CompressBlocksRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const CompressBlocksParameterType & pass
+    = *static_cast< const CompressBlocksParameterType * >( userData );
+  const SizeValueType numberOfBlocks
+    = ( pass.st_NumberOfPixels + pass.st_PixelsPerBlock - 1 ) / pass.st_PixelsPerBlock;
+
+  /** Every block is a raw deflate stream that ends on a byte boundary, with
+   * the last 32 kB before it as dictionary, like pigz does. The blocks then
+   * form one deflate stream.
+   */
+  const SizeValueType dictionaryPixels = ( 32 * 1024 ) / pass.st_PixelSize;
+  std::vector< char > pixels;
+  for( SizeValueType b = begin; b < end; ++b )
+  {
+    const SizeValueType block      = pass.st_FirstBlock + b;
+    const SizeValueType blockBegin = block * pass.st_PixelsPerBlock;
+    const SizeValueType blockEnd   = std::min( blockBegin + pass.st_PixelsPerBlock, pass.st_NumberOfPixels );
+    const SizeValueType castBegin  = blockBegin - std::min( blockBegin, dictionaryPixels );
+    const SizeValueType dictionary = ( blockBegin - castBegin ) * pass.st_PixelSize;
+    const SizeValueType blockSize  = ( blockEnd - blockBegin ) * pass.st_PixelSize;
+
+    pixels.resize( dictionary + blockSize );
+    pass.st_CastFunction( pass.st_Input, castBegin, blockEnd - castBegin, &pixels[ 0 ] );
+    Bytef * blockPixels = reinterpret_cast< Bytef * >( &pixels[ dictionary ] );
+
+    ( *pass.st_Checksums )[ b ] = adler32( adler32( 0L, Z_NULL, 0 ), blockPixels, static_cast< uInt >( blockSize ) );
+
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+    bool ok = deflateInit2( &stream, pass.st_CompressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+    if( ok && dictionary > 0 )
+    {
+      ok = deflateSetDictionary( &stream, reinterpret_cast< Bytef * >( &pixels[ 0 ] ),
+        static_cast< uInt >( dictionary ) ) == Z_OK;
+    }
+
+    std::vector< unsigned char > & compressed = ( *pass.st_CompressedBlocks )[ b ];
+    if( ok )
+    {
+      const bool last = block + 1 == numberOfBlocks;
+      compressed.resize( deflateBound( &stream, static_cast< uLong >( blockSize ) ) + 1024 );
+      stream.next_in   = blockPixels;
+      stream.avail_in  = static_cast< uInt >( blockSize );
+      stream.next_out  = &compressed[ 0 ];
+      stream.avail_out = static_cast< uInt >( compressed.size() );
+      const int result = deflate( &stream, last ? Z_FINISH : Z_SYNC_FLUSH );
+      ok = ( last ? result == Z_STREAM_END : result == Z_OK )
+        && stream.avail_in == 0 && stream.avail_out > 0;
+      compressed.resize( compressed.size() - stream.avail_out );
+      deflateEnd( &stream );
+    }
+    ( *pass.st_Succeeded )[ b ] = ok;
+  }
 }
 
 
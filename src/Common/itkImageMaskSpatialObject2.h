@@ -39,6 +39,9 @@
 
 #include "itkImageSpatialObject2.h"
 #include "itkImageSliceConstIteratorWithIndex.h"
+#include "itkIntTypes.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -50,6 +53,14 @@ namespace itk
  * the ImageSpatialObject with a wrong conversion between physical
  * coordinates and image coordinates. This class solves that.
  *
+ * In addition, IsInside() uses a bit-packed copy of the mask, restricted to
+ * the bounding box of the nonzero voxels, together with a precomputed
+ * world-to-index transform. This copy is built whenever the bounding box is
+ * computed (e.g. in SetImage()). It needs one bit per voxel of the bounding
+ * box instead of one byte per voxel of the image, so that it stays in cache.
+ * When the image or the transform are modified afterwards, IsInside() falls
+ * back to the original implementation until the bounding box is recomputed.
+ *
  */
 
 template< unsigned int TDimension = 3 >
@@ -78,6 +89,12 @@ public:
   typedef itk::ImageSliceConstIteratorWithIndex< ImageType >
     SliceIteratorType;
 
+  /** Typedefs for the bit-packed mask. */
+  typedef uint64_t                             BitMaskWordType;
+  typedef std::vector< BitMaskWordType >       BitMaskType;
+  typedef typename TransformType::MatrixType   WorldToIndexMatrixType;
+  typedef typename TransformType::OffsetType   WorldToIndexOffsetType;
+
   /** Method for creation through the object factory. */
   itkNewMacro( Self );
 
@@ -110,6 +127,17 @@ public:
   void ComputeLocalBoundingBoxIndexAndSize(
     IndexType & index, SizeType & size ) const;
 
+  /** Get whether the bit-packed mask can be used by IsInside(). */
+  bool GetBitMaskIsValid( void ) const;
+
+  /** Get the bit-packed mask, its region and the world-to-index transform
+   * that IsInside() uses, e.g. to test points on a GPU in the same way.
+   * Only meaningful while GetBitMaskIsValid() returns true. */
+  const BitMaskType & GetBitMask( void ) const { return this->m_BitMask; }
+  const RegionType & GetBitMaskRegion( void ) const { return this->m_BitMaskRegion; }
+  const WorldToIndexMatrixType & GetWorldToIndexMatrix( void ) const { return this->m_WorldToIndexMatrix; }
+  const WorldToIndexOffsetType & GetWorldToIndexOffset( void ) const { return this->m_WorldToIndexOffset; }
+
 protected:
 
   ImageMaskSpatialObject2( const Self & ); // purposely not implemented
@@ -120,6 +148,23 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /** Build the bit-packed mask of the nonzero bounding box given by index and size. */
+  void ComputeBitMask( const IndexType & index, const SizeType & size ) const;
+
+private:
+
+  /** The bit-packed mask. Bit k of the bounding box region is stored in
+   * bit ( k % 64 ) of word ( k / 64 ), in the raster order of the region. */
+  mutable BitMaskType            m_BitMask;
+  mutable RegionType             m_BitMaskRegion;
+  mutable OffsetValueType        m_BitMaskStrides[ TDimension ];
+  mutable WorldToIndexMatrixType m_WorldToIndexMatrix;
+  mutable WorldToIndexOffsetType m_WorldToIndexOffset;
+  mutable bool                   m_WorldToIndexIsDiagonal;
+  mutable bool                   m_BitMaskIsBuilt;
+  mutable ModifiedTimeType       m_BitMaskImageMTime;
+  mutable ModifiedTimeType       m_BitMaskTransformMTime;
+
 };
 
 } // end of namespace itk
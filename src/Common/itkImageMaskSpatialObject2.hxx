@@ -41,6 +41,7 @@
 #include "vnl/vnl_math.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
 
 namespace itk
 {
@@ -50,6 +51,11 @@ template< unsigned int TDimension >
 ImageMaskSpatialObject2< TDimension >
 ::ImageMaskSpatialObject2()
 {
+  this->m_BitMaskIsBuilt         = false;
+  this->m_BitMaskImageMTime      = 0;
+  this->m_BitMaskTransformMTime  = 0;
+  this->m_WorldToIndexIsDiagonal = false;
+
   this->SetTypeName( "ImageMaskSpatialObject2" );
   this->ComputeBoundingBox();
 }
@@ -73,6 +79,42 @@ ImageMaskSpatialObject2< TDimension >
   {
     return false;
   }
+
+  /** Fast path: the same rounding of the same continuous index, but a bit
+   * test instead of a buffered region test and a pixel fetch. */
+  if( this->GetBitMaskIsValid() )
+  {
+    /** Without rotation only the diagonal of the matrix is used. */
+    PointType p;
+    if( this->m_WorldToIndexIsDiagonal )
+    {
+      for( unsigned int i = 0; i < TDimension; i++ )
+      {
+        p[ i ] = this->m_WorldToIndexMatrix[ i ][ i ] * point[ i ] + this->m_WorldToIndexOffset[ i ];
+      }
+    }
+    else
+    {
+      p = this->m_WorldToIndexMatrix * point + this->m_WorldToIndexOffset;
+    }
+
+    OffsetValueType bit = 0;
+    for( unsigned int i = 0; i < TDimension; i++ )
+    {
+      const OffsetValueType index
+        = static_cast< int >( Math::Round< double >( p[ i ] ) )
+        - this->m_BitMaskRegion.GetIndex()[ i ];
+      if( index < 0
+        || index >= static_cast< OffsetValueType >( this->m_BitMaskRegion.GetSize()[ i ] ) )
+      {
+        return false;
+      }
+      bit += index * this->m_BitMaskStrides[ i ];
+    }
+
+    return ( this->m_BitMask[ bit >> 6 ] >> ( bit & 63 ) ) & 1;
+  }
+
   if( !this->SetInternalInverseTransformToWorldToIndexTransform() )
   {
     return false;
@@ -293,6 +335,9 @@ ImageMaskSpatialObject2< TDimension >
     SizeType  size;
     this->ComputeLocalBoundingBoxIndexAndSize( indexLow, size );
 
+    /** Build the bit-packed mask for IsInside(). */
+    this->ComputeBitMask( indexLow, size );
+
     /** Convert to points, which are NOT physical points! */
     PointType pointLow, pointHigh;
     for( unsigned int i = 0; i < ImageType::ImageDimension; ++i )
@@ -332,6 +377,91 @@ ImageMaskSpatialObject2< TDimension >
 } // end ComputeLocalBoundingBox()
 
 
+/** Build the bit-packed mask */
+template< unsigned int TDimension >
+void
+ImageMaskSpatialObject2< TDimension >
+::ComputeBitMask( const IndexType & index, const SizeType & size ) const
+{
+  this->m_BitMaskIsBuilt = false;
+  this->m_BitMask.clear();
+
+  if( !this->GetImage()
+    || !this->SetInternalInverseTransformToWorldToIndexTransform() )
+  {
+    return;
+  }
+
+  /** Store the world-to-index transform. */
+  this->m_WorldToIndexMatrix = this->GetInternalInverseTransform()->GetMatrix();
+  this->m_WorldToIndexOffset = this->GetInternalInverseTransform()->GetOffset();
+  this->m_WorldToIndexIsDiagonal = true;
+  for( unsigned int i = 0; i < TDimension; i++ )
+  {
+    for( unsigned int j = 0; j < TDimension; j++ )
+    {
+      if( i != j && this->m_WorldToIndexMatrix[ i ][ j ] != 0.0 )
+      {
+        this->m_WorldToIndexIsDiagonal = false;
+      }
+    }
+  }
+
+  /** Only the part of the bounding box that is buffered can be nonzero. An
+   * empty region gives an empty mask, for which IsInside() always returns false. */
+  this->m_BitMaskRegion.SetIndex( index );
+  this->m_BitMaskRegion.SetSize( size );
+  if( !this->m_BitMaskRegion.Crop( this->GetImage()->GetBufferedRegion() ) )
+  {
+    SizeType zeroSize;
+    zeroSize.Fill( 0 );
+    this->m_BitMaskRegion.SetSize( zeroSize );
+  }
+
+  OffsetValueType stride = 1;
+  for( unsigned int i = 0; i < TDimension; i++ )
+  {
+    this->m_BitMaskStrides[ i ] = stride;
+    stride                     *= this->m_BitMaskRegion.GetSize()[ i ];
+  }
+
+  /** Pack the voxels of the region, in raster order. */
+  const SizeValueType numberOfVoxels = this->m_BitMaskRegion.GetNumberOfPixels();
+  this->m_BitMask.assign( ( numberOfVoxels + 63 ) / 64, 0 );
+  if( numberOfVoxels > 0 )
+  {
+    typedef ImageRegionConstIterator< ImageType > IteratorType;
+    IteratorType  it( this->GetImage(), this->m_BitMaskRegion );
+    SizeValueType bit = 0;
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++bit )
+    {
+      if( it.Get() != NumericTraits< PixelType >::ZeroValue() )
+      {
+        this->m_BitMask[ bit >> 6 ] |= static_cast< BitMaskWordType >( 1 ) << ( bit & 63 );
+      }
+    }
+  }
+
+  this->m_BitMaskImageMTime     = this->GetImage()->GetMTime();
+  this->m_BitMaskTransformMTime = this->GetIndexToWorldTransform()->GetMTime();
+  this->m_BitMaskIsBuilt        = true;
+
+} // end ComputeBitMask()
+
+
+/** Check whether the bit-packed mask is up-to-date */
+template< unsigned int TDimension >
+bool
+ImageMaskSpatialObject2< TDimension >
+::GetBitMaskIsValid( void ) const
+{
+  return this->m_BitMaskIsBuilt
+         && this->m_BitMaskImageMTime == this->GetImage()->GetMTime()
+         && this->m_BitMaskTransformMTime == this->GetIndexToWorldTransform()->GetMTime();
+
+} // end GetBitMaskIsValid()
+
+
 /** Print the object */
 template< unsigned int TDimension >
 void
@@ -339,6 +469,8 @@ ImageMaskSpatialObject2< TDimension >
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
+  os << indent << "BitMaskIsValid: " << this->GetBitMaskIsValid() << std::endl;
+  os << indent << "BitMaskRegion: " << this->m_BitMaskRegion << std::endl;
 }
 
 
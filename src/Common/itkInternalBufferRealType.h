@@ -0,0 +1,43 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkInternalBufferRealType_h
+#define __itkInternalBufferRealType_h
+
+namespace itk
+{
+
+/** The value type of the image sized intermediate buffers of elastix, such
+ * as the B-spline coefficient images of the (resample) interpolators.
+ *
+ * It is double by default, and float when ELASTIX_USE_FLOAT_INTERNALS is
+ * defined, see the CMake option of the same name. Combined with float
+ * internal pixel types, this halves the memory of these buffers and the
+ * memory bandwidth of the interpolation. Accumulators, derivatives and the
+ * optimizer stay in double precision in both cases.
+ *
+ * \ingroup Miscellaneous
+ */
+#ifdef ELASTIX_USE_FLOAT_INTERNALS
+typedef float InternalBufferRealType;
+#else
+typedef double InternalBufferRealType;
+#endif
+
+} // end namespace itk
+
+#endif // end #ifndef __itkInternalBufferRealType_h
@@ -0,0 +1,249 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMappedCoordinateField_h
+#define __itkMappedCoordinateField_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageBase.h"
+#include "itkTransform.h"
+#include "itkInterpolateImageFunction.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class MappedCoordinateField
+ *
+ * \brief Stores, for every voxel of an output grid, the continuous index in
+ * an input grid that a transform maps it to.
+ *
+ * Resampling an image evaluates the transform at every output voxel, which
+ * for a B-spline transform costs more than the interpolation. When several
+ * images with the same geometry are resampled through the same transform,
+ * e.g. the images of a transformix batch, or the channels of an image, the
+ * mapped positions can be computed once by Compute(), after which Resample()
+ * only interpolates.
+ *
+ * The continuous indices are stored compactly, in 4 bytes per component:
+ * \li FloatStorage: as a float. The precision is relative, e.g. 6e-5 voxel
+ *   at index 1000.
+ * \li IntegerAndFractionStorage: as a 16 bit integer part and a 16 bit
+ *   fraction, i.e. with a precision of 1.5e-5 voxel everywhere. The buffered
+ *   regions of the input images must lie within the indices [-32767, 32767].
+ *
+ * For label images ResampleNearestNeighbor() copies the pixel at the nearest
+ * voxel, rounding the stored indices directly, without an interpolator and
+ * without a conversion of the pixel values to floating point.
+ *
+ * The field is valid for the transform, with its current parameters, the
+ * output grid and the geometry (origin, spacing and direction) of the input
+ * grid that it was computed for, see IsValidFor(). Both Compute() and
+ * Resample() run on the PersistentThreadPool.
+ *
+ * \ingroup ImageFilters
+ */
+
+template< unsigned int VDimension, class TCoordRep = double >
+class MappedCoordinateField : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MappedCoordinateField      Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MappedCoordinateField, Object );
+
+  itkStaticConstMacro( Dimension, unsigned int, VDimension );
+
+  /** Typedefs. */
+  typedef TCoordRep                                      CoordRepType;
+  typedef Transform< TCoordRep, VDimension, VDimension > TransformType;
+  typedef typename TransformType::ConstPointer           TransformConstPointer;
+  typedef typename TransformType::ParametersType         ParametersType;
+  typedef typename TransformType::InputPointType         InputPointType;
+  typedef ImageBase< VDimension >                        ImageBaseType;
+  typedef typename ImageBaseType::RegionType             RegionType;
+  typedef typename ImageBaseType::IndexType              IndexType;
+  typedef typename ImageBaseType::PointType              PointType;
+  typedef typename ImageBaseType::SpacingType            SpacingType;
+  typedef typename ImageBaseType::DirectionType          DirectionType;
+  typedef ContinuousIndex< TCoordRep, VDimension >       ContinuousIndexType;
+
+  /** The storage of the continuous indices. */
+  typedef enum {
+    FloatStorage,
+    IntegerAndFractionStorage
+  } StorageType;
+
+  /** Set the storage. Default: FloatStorage. */
+  itkSetMacro( Storage, StorageType );
+  itkGetConstMacro( Storage, StorageType );
+
+  /** Computes the continuous indices in \a inputGrid of the voxels of the
+   * largest possible region of \a outputGrid, mapped by \a transform. Only
+   * the geometry of the grids is used; they need not be buffered.
+   */
+  void Compute( const TransformType * transform,
+    const ImageBaseType * outputGrid, const ImageBaseType * inputGrid );
+
+  /** Returns true if the field was computed for this transform, with the
+   * same parameters, this output grid and the geometry of this input grid,
+   * and the current storage.
+   */
+  bool IsValidFor( const TransformType * transform,
+    const ImageBaseType * outputGrid, const ImageBaseType * inputGrid ) const;
+
+  /** Resamples the input image of \a interpolator into \a output, which
+   * must have the output grid and be allocated. Voxels that map outside the
+   * buffer of the input image get \a defaultValue. The interpolated values
+   * are clamped to the range of the output pixel type.
+   */
+  template< class TInputImage, class TOutputImage >
+  void Resample( const InterpolateImageFunction< TInputImage, TCoordRep > * interpolator,
+    const typename TOutputImage::PixelType & defaultValue, TOutputImage * output ) const;
+
+  /** Resamples \a input into \a output by nearest neighbour interpolation,
+   * like Resample() with a NearestNeighborInterpolateImageFunction, i.e.
+   * rounding half integers up. The pixels are copied, and cast directly to
+   * the output pixel type, so integer labels are kept exactly.
+   */
+  template< class TInputImage, class TOutputImage >
+  void ResampleNearestNeighbor( const TInputImage * input,
+    const typename TOutputImage::PixelType & defaultValue, TOutputImage * output ) const;
+
+  /** The memory used by the field, in bytes. */
+  SizeValueType GetNumberOfBytes( void ) const;
+
+protected:
+
+  MappedCoordinateField();
+  virtual ~MappedCoordinateField() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  MappedCoordinateField( const Self & ); // purposely not implemented
+  void operator=( const Self & );        // purposely not implemented
+
+  /** A component of a continuous index in IntegerAndFractionStorage. */
+  struct IntegerAndFractionType
+  {
+    short          Integer;
+    unsigned short Fraction;
+  };
+
+  /** The integer part that marks a voxel that maps outside, and the largest
+   * integer part that can be stored.
+   */
+  static const short OutsideInteger = -32768;
+  static const short MaximumInteger = 32767;
+
+  /** Get the continuous index of voxel \a i; returns false if it maps outside. */
+  bool GetContinuousIndex( const SizeValueType i, ContinuousIndexType & cindex ) const;
+
+  /** Get the index of the voxel nearest to the continuous index of voxel
+   * \a i; returns false if it maps outside.
+   */
+  bool GetNearestIndex( const SizeValueType i, IndexType & index ) const;
+
+  /** Checks the output, and, for the IntegerAndFractionStorage, that the
+   * input region lies within the indices that can be stored.
+   */
+  void CheckRegions( const RegionType & inputRegion, const ImageBaseType * output ) const;
+
+  /** Store the continuous index of voxel \a i. */
+  void SetContinuousIndex( const SizeValueType i, const ContinuousIndexType & cindex, const bool inside );
+
+  /** The struct and range function of Compute(). */
+  struct ComputeParameterType
+  {
+    Self *                st_Self;
+    const TransformType * st_Transform;
+    const ImageBaseType * st_OutputGrid;
+    const ImageBaseType * st_InputGrid;
+  };
+
+  static void ComputeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The struct and range function of Resample(). */
+  template< class TInputImage, class TOutputImage >
+  struct ResampleParameterType
+  {
+    const Self *                                               st_Self;
+    const InterpolateImageFunction< TInputImage, TCoordRep > * st_Interpolator;
+    typename TOutputImage::PixelType                           st_DefaultValue;
+    typename TOutputImage::PixelType *                         st_Output;
+  };
+
+  template< class TInputImage, class TOutputImage >
+  static void ResampleRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The struct and range function of ResampleNearestNeighbor(). */
+  template< class TInputImage, class TOutputImage >
+  struct NearestNeighborParameterType
+  {
+    const Self *                            st_Self;
+    const typename TInputImage::PixelType * st_Input;
+    RegionType                              st_InputRegion;
+    typename TOutputImage::PixelType        st_DefaultValue;
+    typename TOutputImage::PixelType *      st_Output;
+  };
+
+  template< class TInputImage, class TOutputImage >
+  static void NearestNeighborRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  StorageType                           m_Storage;
+  std::vector< float >                  m_FloatIndices;
+  std::vector< IntegerAndFractionType > m_IntegerAndFractionIndices;
+
+  /** What the field was computed for. */
+  StorageType           m_ComputedStorage;
+  TransformConstPointer m_Transform;
+  ParametersType        m_TransformParameters;
+  ParametersType        m_TransformFixedParameters;
+  RegionType            m_OutputRegion;
+  PointType             m_OutputOrigin;
+  SpacingType           m_OutputSpacing;
+  DirectionType         m_OutputDirection;
+  PointType             m_InputOrigin;
+  SpacingType           m_InputSpacing;
+  DirectionType         m_InputDirection;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMappedCoordinateField.hxx"
+#endif
+
+#endif // end #ifndef __itkMappedCoordinateField_h
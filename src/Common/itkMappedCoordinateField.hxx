@@ -0,0 +1,516 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMappedCoordinateField_hxx
+#define __itkMappedCoordinateField_hxx
+
+#include "itkMappedCoordinateField.h"
+#include "itkPersistentThreadPool.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+MappedCoordinateField< VDimension, TCoordRep >
+::MappedCoordinateField()
+{
+  this->m_Storage         = FloatStorage;
+  this->m_ComputedStorage = FloatStorage;
+
+} // end Constructor
+
+
+/**
+ * ******************* Compute ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::Compute( const TransformType * transform,
+  const ImageBaseType * outputGrid, const ImageBaseType * inputGrid )
+{
+  if( transform == 0 || outputGrid == 0 || inputGrid == 0 )
+  {
+    itkExceptionMacro( << "The transform, the output grid and the input grid must be set." );
+  }
+
+  /** Release the previous field first, and allocate the new one. */
+  const RegionType    outputRegion   = outputGrid->GetLargestPossibleRegion();
+  const SizeValueType numberOfPixels = outputRegion.GetNumberOfPixels();
+  std::vector< float >().swap( this->m_FloatIndices );
+  std::vector< IntegerAndFractionType >().swap( this->m_IntegerAndFractionIndices );
+  if( this->m_Storage == FloatStorage )
+  {
+    this->m_FloatIndices.resize( numberOfPixels * VDimension );
+  }
+  else
+  {
+    this->m_IntegerAndFractionIndices.resize( numberOfPixels * VDimension );
+  }
+  this->m_ComputedStorage = this->m_Storage;
+
+  ComputeParameterType pass;
+  pass.st_Self       = this;
+  pass.st_Transform  = transform;
+  pass.st_OutputGrid = outputGrid;
+  pass.st_InputGrid  = inputGrid;
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    numberOfPixels, 0, Self::ComputeRangeFunction, &pass );
+
+  /** Remember what the field was computed for. */
+  this->m_Transform                = transform;
+  this->m_TransformParameters      = transform->GetParameters();
+  this->m_TransformFixedParameters = transform->GetFixedParameters();
+  this->m_OutputRegion             = outputRegion;
+  this->m_OutputOrigin             = outputGrid->GetOrigin();
+  this->m_OutputSpacing            = outputGrid->GetSpacing();
+  this->m_OutputDirection          = outputGrid->GetDirection();
+  this->m_InputOrigin              = inputGrid->GetOrigin();
+  this->m_InputSpacing             = inputGrid->GetSpacing();
+  this->m_InputDirection           = inputGrid->GetDirection();
+  this->Modified();
+
+} // end Compute()
+
+
+/**
+ * ******************* IsValidFor ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+bool
+MappedCoordinateField< VDimension, TCoordRep >
+::IsValidFor( const TransformType * transform,
+  const ImageBaseType * outputGrid, const ImageBaseType * inputGrid ) const
+{
+  return this->m_Transform.IsNotNull()
+         && this->m_Transform.GetPointer() == transform
+         && this->m_ComputedStorage == this->m_Storage
+         && this->m_TransformParameters == transform->GetParameters()
+         && this->m_TransformFixedParameters == transform->GetFixedParameters()
+         && this->m_OutputRegion == outputGrid->GetLargestPossibleRegion()
+         && this->m_OutputOrigin == outputGrid->GetOrigin()
+         && this->m_OutputSpacing == outputGrid->GetSpacing()
+         && this->m_OutputDirection == outputGrid->GetDirection()
+         && this->m_InputOrigin == inputGrid->GetOrigin()
+         && this->m_InputSpacing == inputGrid->GetSpacing()
+         && this->m_InputDirection == inputGrid->GetDirection();
+
+} // end IsValidFor()
+
+
+/**
+ * ******************* Resample ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+template< class TInputImage, class TOutputImage >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::Resample( const InterpolateImageFunction< TInputImage, TCoordRep > * interpolator,
+  const typename TOutputImage::PixelType & defaultValue, TOutputImage * output ) const
+{
+  if( interpolator == 0 || interpolator->GetInputImage() == 0 )
+  {
+    itkExceptionMacro( << "The interpolator and its input image must be set." );
+  }
+  if( output == 0 || output->GetBufferPointer() == 0 )
+  {
+    itkExceptionMacro( << "The output must be allocated." );
+  }
+  this->CheckRegions( interpolator->GetInputImage()->GetBufferedRegion(), output );
+
+  ResampleParameterType< TInputImage, TOutputImage > pass;
+  pass.st_Self         = this;
+  pass.st_Interpolator = interpolator;
+  pass.st_DefaultValue = defaultValue;
+  pass.st_Output       = output->GetBufferPointer();
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_OutputRegion.GetNumberOfPixels(), 0,
+    Self::template ResampleRangeFunction< TInputImage, TOutputImage >, &pass );
+
+} // end Resample()
+
+
+/**
+ * ******************* ResampleNearestNeighbor ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+template< class TInputImage, class TOutputImage >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::ResampleNearestNeighbor( const TInputImage * input,
+  const typename TOutputImage::PixelType & defaultValue, TOutputImage * output ) const
+{
+  if( input == 0 || input->GetBufferPointer() == 0 )
+  {
+    itkExceptionMacro( << "The input image must be set and buffered." );
+  }
+  if( output == 0 || output->GetBufferPointer() == 0 )
+  {
+    itkExceptionMacro( << "The output must be allocated." );
+  }
+  this->CheckRegions( input->GetBufferedRegion(), output );
+
+  NearestNeighborParameterType< TInputImage, TOutputImage > pass;
+  pass.st_Self         = this;
+  pass.st_Input        = input->GetBufferPointer();
+  pass.st_InputRegion  = input->GetBufferedRegion();
+  pass.st_DefaultValue = defaultValue;
+  pass.st_Output       = output->GetBufferPointer();
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_OutputRegion.GetNumberOfPixels(), 0,
+    Self::template NearestNeighborRangeFunction< TInputImage, TOutputImage >, &pass );
+
+} // end ResampleNearestNeighbor()
+
+
+/**
+ * ******************* GetNumberOfBytes ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+SizeValueType
+MappedCoordinateField< VDimension, TCoordRep >
+::GetNumberOfBytes( void ) const
+{
+  return this->m_FloatIndices.size() * sizeof( float )
+         + this->m_IntegerAndFractionIndices.size() * sizeof( IntegerAndFractionType );
+
+} // end GetNumberOfBytes()
+
+
+/**
+ * ******************* GetContinuousIndex ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+bool
+MappedCoordinateField< VDimension, TCoordRep >
+::GetContinuousIndex( const SizeValueType i, ContinuousIndexType & cindex ) const
+{
+  if( this->m_ComputedStorage == FloatStorage )
+  {
+    const float * indices = &this->m_FloatIndices[ i * VDimension ];
+    if( indices[ 0 ] != indices[ 0 ] ) { return false; }
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      cindex[ d ] = indices[ d ];
+    }
+  }
+  else
+  {
+    const IntegerAndFractionType * indices = &this->m_IntegerAndFractionIndices[ i * VDimension ];
+    if( indices[ 0 ].Integer == OutsideInteger ) { return false; }
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      cindex[ d ] = indices[ d ].Integer + indices[ d ].Fraction / static_cast< TCoordRep >( 65536 );
+    }
+  }
+  return true;
+
+} // end GetContinuousIndex()
+
+
+/**
+ * ******************* GetNearestIndex ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+bool
+MappedCoordinateField< VDimension, TCoordRep >
+::GetNearestIndex( const SizeValueType i, IndexType & index ) const
+{
+  /** Round half integers up, like the NearestNeighborInterpolateImageFunction. */
+  if( this->m_ComputedStorage == FloatStorage )
+  {
+    const float * indices = &this->m_FloatIndices[ i * VDimension ];
+    if( indices[ 0 ] != indices[ 0 ] ) { return false; }
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      index[ d ] = static_cast< IndexValueType >( std::floor( indices[ d ] + 0.5f ) );
+    }
+  }
+  else
+  {
+    const IntegerAndFractionType * indices = &this->m_IntegerAndFractionIndices[ i * VDimension ];
+    if( indices[ 0 ].Integer == OutsideInteger ) { return false; }
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      index[ d ] = indices[ d ].Integer + ( indices[ d ].Fraction >= 32768 ? 1 : 0 );
+    }
+  }
+  return true;
+
+} // end GetNearestIndex()
+
+
+/**
+ * ******************* CheckRegions ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::CheckRegions( const RegionType & inputRegion, const ImageBaseType * output ) const
+{
+  if( this->m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "The field has not been computed." );
+  }
+  if( output->GetBufferedRegion() != this->m_OutputRegion )
+  {
+    itkExceptionMacro( << "The output must be allocated for the region " << this->m_OutputRegion );
+  }
+
+  /** Check that the integer parts can address the whole input buffer. */
+  if( this->m_ComputedStorage == IntegerAndFractionStorage )
+  {
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      const OffsetValueType first = inputRegion.GetIndex()[ d ];
+      const OffsetValueType last  = first + static_cast< OffsetValueType >( inputRegion.GetSize()[ d ] ) - 1;
+      if( first < -MaximumInteger || last > MaximumInteger )
+      {
+        itkExceptionMacro( << "The buffered region of the input image exceeds the indices ["
+                           << -MaximumInteger << ", " << MaximumInteger
+                           << "] of the IntegerAndFractionStorage." );
+      }
+    }
+  }
+
+} // end CheckRegions()
+
+
+/**
+ * ******************* SetContinuousIndex ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::SetContinuousIndex( const SizeValueType i, const ContinuousIndexType & cindex, const bool inside )
+{
+  if( this->m_ComputedStorage == FloatStorage )
+  {
+    float * indices = &this->m_FloatIndices[ i * VDimension ];
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      indices[ d ] = inside ? static_cast< float >( cindex[ d ] )
+        : std::numeric_limits< float >::quiet_NaN();
+    }
+    return;
+  }
+
+  IntegerAndFractionType * indices = &this->m_IntegerAndFractionIndices[ i * VDimension ];
+  for( unsigned int d = 0; d < VDimension; ++d )
+  {
+    if( !inside )
+    {
+      indices[ d ].Integer  = OutsideInteger;
+      indices[ d ].Fraction = 0;
+      continue;
+    }
+
+    /** Round the fraction to 16 bits, carrying into the integer part. */
+    long          integer  = static_cast< long >( std::floor( cindex[ d ] ) );
+    unsigned long fraction = static_cast< unsigned long >(
+      ( cindex[ d ] - integer ) * 65536.0 + 0.5 );
+    if( fraction == 65536 )
+    {
+      ++integer;
+      fraction = 0;
+    }
+    indices[ d ].Integer  = static_cast< short >( integer );
+    indices[ d ].Fraction = static_cast< unsigned short >( fraction );
+  }
+
+} // end SetContinuousIndex()
+
+
+/**
+ * ******************* ComputeRangeFunction ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::ComputeRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const ComputeParameterType * pass = static_cast< const ComputeParameterType * >( userData );
+  Self *                       self = pass->st_Self;
+  const RegionType             region = pass->st_OutputGrid->GetLargestPossibleRegion();
+
+  /** The index of the first voxel of the range. */
+  IndexType     index;
+  SizeValueType offset = begin;
+  for( unsigned int d = 0; d < VDimension; ++d )
+  {
+    index[ d ] = region.GetIndex()[ d ] + static_cast< OffsetValueType >( offset % region.GetSize()[ d ] );
+    offset    /= region.GetSize()[ d ];
+  }
+
+  InputPointType      point;
+  ContinuousIndexType cindex;
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    pass->st_OutputGrid->TransformIndexToPhysicalPoint( index, point );
+    pass->st_InputGrid->TransformPhysicalPointToContinuousIndex(
+      pass->st_Transform->TransformPoint( point ), cindex );
+
+    /** Mark the voxels that map to a position that can not be stored. */
+    bool inside = true;
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      inside &= cindex[ d ] == cindex[ d ];
+      if( self->m_ComputedStorage == IntegerAndFractionStorage )
+      {
+        inside &= cindex[ d ] > -MaximumInteger && cindex[ d ] < MaximumInteger;
+      }
+    }
+    self->SetContinuousIndex( i, cindex, inside );
+
+    /** Go to the next voxel. */
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      if( ++index[ d ] < region.GetIndex()[ d ] + static_cast< OffsetValueType >( region.GetSize()[ d ] ) )
+      {
+        break;
+      }
+      index[ d ] = region.GetIndex()[ d ];
+    }
+  }
+
+} // end ComputeRangeFunction()
+
+
+/**
+ * ******************* ResampleRangeFunction ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+template< class TInputImage, class TOutputImage >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::ResampleRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  typedef ResampleParameterType< TInputImage, TOutputImage > PassType;
+  typedef typename TOutputImage::PixelType                   OutputPixelType;
+  const PassType * pass = static_cast< const PassType * >( userData );
+
+  /** Clamp to the range of the output pixel type, like the ResampleImageFilter. */
+  const double minimum = static_cast< double >( NumericTraits< OutputPixelType >::NonpositiveMin() );
+  const double maximum = static_cast< double >( NumericTraits< OutputPixelType >::max() );
+
+  ContinuousIndexType cindex;
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    if( pass->st_Self->GetContinuousIndex( i, cindex )
+      && pass->st_Interpolator->IsInsideBuffer( cindex ) )
+    {
+      const double value = static_cast< double >(
+        pass->st_Interpolator->EvaluateAtContinuousIndex( cindex ) );
+      pass->st_Output[ i ] = static_cast< OutputPixelType >(
+        std::min( std::max( value, minimum ), maximum ) );
+    }
+    else
+    {
+      pass->st_Output[ i ] = pass->st_DefaultValue;
+    }
+  }
+
+} // end ResampleRangeFunction()
+
+
+/**
+ * ******************* NearestNeighborRangeFunction ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+template< class TInputImage, class TOutputImage >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::NearestNeighborRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  typedef NearestNeighborParameterType< TInputImage, TOutputImage > PassType;
+  typedef typename TOutputImage::PixelType                          OutputPixelType;
+  const PassType * pass = static_cast< const PassType * >( userData );
+
+  /** The strides of the input buffer. */
+  const RegionType & region = pass->st_InputRegion;
+  OffsetValueType    strides[ VDimension ];
+  strides[ 0 ] = 1;
+  for( unsigned int d = 1; d < VDimension; ++d )
+  {
+    strides[ d ] = strides[ d - 1 ] * static_cast< OffsetValueType >( region.GetSize()[ d - 1 ] );
+  }
+
+  IndexType index;
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    bool            inside = pass->st_Self->GetNearestIndex( i, index );
+    OffsetValueType offset = 0;
+    for( unsigned int d = 0; inside && d < VDimension; ++d )
+    {
+      const OffsetValueType local = index[ d ] - region.GetIndex()[ d ];
+      inside  = local >= 0 && local < static_cast< OffsetValueType >( region.GetSize()[ d ] );
+      offset += local * strides[ d ];
+    }
+    pass->st_Output[ i ] = inside
+      ? static_cast< OutputPixelType >( pass->st_Input[ offset ] )
+      : pass->st_DefaultValue;
+  }
+
+} // end NearestNeighborRangeFunction()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template< unsigned int VDimension, class TCoordRep >
+void
+MappedCoordinateField< VDimension, TCoordRep >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Storage: "
+     << ( this->m_Storage == FloatStorage ? "FloatStorage" : "IntegerAndFractionStorage" ) << std::endl;
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "NumberOfBytes: " << this->GetNumberOfBytes() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMappedCoordinateField_hxx
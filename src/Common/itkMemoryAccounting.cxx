@@ -0,0 +1,70 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkMemoryAccounting_cxx
+#define __itkMemoryAccounting_cxx
+
+#include "itkMemoryAccounting.h"
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <psapi.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+#include <sys/resource.h>
+#endif
+
+namespace itk
+{
+
+/**
+ * ****************** GetPeakResidentSetSize *********************************
+ */
+
+SizeValueType
+MemoryAccounting
+::GetPeakResidentSetSize( void )
+{
+#if defined( _WIN32 )
+  PROCESS_MEMORY_COUNTERS counters;
+  if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+  {
+    return static_cast< SizeValueType >( counters.PeakWorkingSetSize );
+  }
+  return 0;
+#elif defined( __unix__ ) || defined( __APPLE__ )
+  struct rusage usage;
+  if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+  {
+    return 0;
+  }
+#if defined( __APPLE__ )
+  /** On Mac OS X ru_maxrss is in bytes, elsewhere in kilobytes. */
+  return static_cast< SizeValueType >( usage.ru_maxrss );
+#else
+  return static_cast< SizeValueType >( usage.ru_maxrss ) * 1024;
+#endif
+#else
+  return 0;
+#endif
+
+} // end GetPeakResidentSetSize()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryAccounting_cxx
@@ -0,0 +1,77 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryAccounting_h
+#define __itkMemoryAccounting_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class MemoryAccounting
+ *
+ * \brief Helpers for the memory accounting of elastix, which reports the
+ * bytes held by the components in each resolution, and the peak resident
+ * set size of the process.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class MemoryAccounting
+{
+public:
+
+  /** Returns the peak resident set size of the process in bytes, or 0 if it
+   * can not be determined on this platform.
+   */
+  static SizeValueType GetPeakResidentSetSize( void );
+
+  /** Converts \a bytes to megabytes, rounded to one decimal, for printing. */
+  static double ToMegabytes( const SizeValueType bytes )
+  {
+    return static_cast< double >( static_cast< SizeValueType >(
+      static_cast< double >( bytes ) / 104857.6 + 0.5 ) ) / 10.0;
+  }
+
+
+  /** Returns the number of bytes of the pixel buffer of \a image, or 0 if
+   * \a image is 0 or has no buffer.
+   */
+  template< class TImage >
+  static SizeValueType GetImageBufferSize( const TImage * image )
+  {
+    if( image == 0 || image->GetPixelContainer() == 0 )
+    {
+      return 0;
+    }
+    return static_cast< SizeValueType >( image->GetPixelContainer()->Size() )
+           * sizeof( typename TImage::PixelContainer::Element );
+  }
+
+
+private:
+
+  MemoryAccounting();                           // purposely not implemented
+  MemoryAccounting( const MemoryAccounting & ); // purposely not implemented
+  void operator=( const MemoryAccounting & );   // purposely not implemented
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryAccounting_h
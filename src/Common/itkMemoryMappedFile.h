@@ -0,0 +1,100 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedFile_h
+#define __itkMemoryMappedFile_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <string>
+
+namespace itk
+{
+
+/** \class MemoryMappedFile
+ *
+ * \brief Maps a file into memory, for reading without copying.
+ *
+ * The file is mapped copy-on-write: the pages are read from the file on
+ * first access, and writing to the mapped memory does not change the file,
+ * but only gives the process a private copy of the page. Pages that are only
+ * read are shared between all processes that map the same file, so that many
+ * processes can use the same large data at the cost of one copy.
+ *
+ * The mapping is released when the object is destroyed.
+ *
+ * \sa MemoryMappedMetaImageReader
+ */
+
+class MemoryMappedFile : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedFile           Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedFile, Object );
+
+  /** Map the complete file. Throws an exception when this fails. */
+  void Open( const std::string & fileName );
+
+  /** Release the mapping. */
+  void Close( void );
+
+  /** The first byte of the mapped file, or 0 if no file is mapped. */
+  char * GetData( void ) const { return this->m_Data; }
+
+  /** The size of the mapped file in bytes. */
+  itkGetConstMacro( Size, SizeValueType );
+
+  /** The name of the mapped file. */
+  itkGetConstReferenceMacro( FileName, std::string );
+
+protected:
+
+  MemoryMappedFile();
+  virtual ~MemoryMappedFile();
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  MemoryMappedFile( const Self & ); // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  std::string   m_FileName;
+  char *        m_Data;
+  SizeValueType m_Size;
+
+  /** Platform specific handles of the file and the mapping. */
+  void * m_FileHandle;
+  void * m_MappingHandle;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryMappedFile_h
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedMetaImageReader_h
+#define __itkMemoryMappedMetaImageReader_h
+
+#include "itkImageSource.h"
+#include "itkImportImageContainer.h"
+#include "itkImageIOBase.h"
+#include "itkMemoryMappedFile.h"
+
+namespace itk
+{
+
+/** \class MemoryMappedImportImageContainer
+ *
+ * \brief An import image container that keeps a memory mapped file alive.
+ *
+ * The container does not own its memory; it points into the mapped file,
+ * which is released when the last image using the container is gone.
+ */
+
+template< class TElementIdentifier, class TElement >
+class MemoryMappedImportImageContainer :
+  public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedImportImageContainer                    Self;
+  typedef ImportImageContainer< TElementIdentifier, TElement > Superclass;
+  typedef SmartPointer< Self >                                Pointer;
+  typedef SmartPointer< const Self >                          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedImportImageContainer, ImportImageContainer );
+
+  /** Set/Get the file that contains the elements. */
+  itkSetObjectMacro( MappedFile, MemoryMappedFile );
+  itkGetConstObjectMacro( MappedFile, MemoryMappedFile );
+
+protected:
+
+  MemoryMappedImportImageContainer() {}
+  virtual ~MemoryMappedImportImageContainer() {}
+
+private:
+
+  MemoryMappedImportImageContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );                    // purposely not implemented
+
+  MemoryMappedFile::Pointer m_MappedFile;
+
+};
+
+/** \class MemoryMappedMetaImageReader
+ *
+ * \brief Reads an uncompressed MetaImage (.mha or .mhd/.raw) by mapping it into memory.
+ *
+ * In contrast to the ImageFileReader, the image data is not read and copied
+ * into a newly allocated buffer: the output image points directly into the
+ * mapped file. Reading is therefore almost instantaneous, the data is only
+ * loaded when it is accessed, and processes that read the same file share
+ * the memory. Writing to the output image is allowed, but only changes a
+ * private copy of the affected pages.
+ *
+ * This is only possible when the data on disk has exactly the layout of the
+ * output image: the component type and number of components of the file must
+ * match the pixel type, the data must be uncompressed, in the byte order of
+ * the machine, and stored in a single file. In addition, the data must be
+ * aligned to the size of the component type; this holds for .mhd/.raw files,
+ * but for .mha files it depends on the length of the header. An exception is
+ * thrown when one of these conditions is not met, so that the caller can
+ * fall back to the ImageFileReader.
+ *
+ * Optionally, see SetCastToPixelType(), a file of scalars with another
+ * component type is read too: the file is then mapped, and its pixels are
+ * cast in parallel into the buffer of the output image. That avoids the
+ * buffer of the file type that the ImageFileReader reads into before it
+ * converts the pixels.
+ *
+ * \sa MemoryMappedFile
+ * \sa ImageFileReader
+ *
+ * \ingroup IOFilters
+ */
+
+template< class TOutputImage >
+class MemoryMappedMetaImageReader : public ImageSource< TOutputImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef MemoryMappedMetaImageReader Self;
+  typedef ImageSource< TOutputImage > Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( MemoryMappedMetaImageReader, ImageSource );
+
+  /** Typedefs. */
+  typedef TOutputImage                                     OutputImageType;
+  typedef typename OutputImageType::PixelType              PixelType;
+  typedef typename NumericTraits< PixelType >::ValueType   ComponentType;
+  typedef typename OutputImageType::RegionType             RegionType;
+  typedef typename OutputImageType::PixelContainer         PixelContainerType;
+  typedef MemoryMappedImportImageContainer<
+    typename PixelContainerType::ElementIdentifier, PixelType > MappedContainerType;
+
+  itkStaticConstMacro( ImageDimension, unsigned int, OutputImageType::ImageDimension );
+
+  /** Set/Get the name of the header file. */
+  itkSetStringMacro( FileName );
+  itkGetStringMacro( FileName );
+
+  /** Cast the pixels of a scalar file with another component type to the
+   * pixel type, instead of throwing an exception. Default: false.
+   */
+  itkSetMacro( CastToPixelType, bool );
+  itkGetConstMacro( CastToPixelType, bool );
+  itkBooleanMacro( CastToPixelType );
+
+protected:
+
+  MemoryMappedMetaImageReader() : m_CastToPixelType( false ), m_FileComponentType( ImageIOBase::UNKNOWNCOMPONENTTYPE ) {}
+  virtual ~MemoryMappedMetaImageReader() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Read the header, check whether the data can be mapped, and set the
+   * geometry of the output.
+   */
+  virtual void GenerateOutputInformation( void );
+
+  /** The complete image is always produced. */
+  virtual void EnlargeOutputRequestedRegion( DataObject * output );
+
+  /** Map the data file and let the output point into it. */
+  virtual void GenerateData( void );
+
+private:
+
+  MemoryMappedMetaImageReader( const Self & ); // purposely not implemented
+  void operator=( const Self & );              // purposely not implemented
+
+  /** Check the component type of the file against the pixel type. */
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const char * ) { return t == ImageIOBase::CHAR; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const unsigned char * ) { return t == ImageIOBase::UCHAR; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const short * ) { return t == ImageIOBase::SHORT; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const unsigned short * ) { return t == ImageIOBase::USHORT; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const int * ) { return t == ImageIOBase::INT; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const unsigned int * ) { return t == ImageIOBase::UINT; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const long * ) { return t == ImageIOBase::LONG; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const unsigned long * ) { return t == ImageIOBase::ULONG; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const float * ) { return t == ImageIOBase::FLOAT; }
+  static bool IsComponentType( const ImageIOBase::IOComponentType t, const double * ) { return t == ImageIOBase::DOUBLE; }
+
+  /** Casts the pixels [begin, end) of the file data to the output. */
+  template< class TFileComponent >
+  static void CastPixels( const char * data, ComponentType * output,
+    SizeValueType begin, SizeValueType end );
+
+  /** The data of the parallel cast of GenerateData(). */
+  struct CastParameterType
+  {
+    typedef void (* CastFunctionType)( const char *, ComponentType *, SizeValueType, SizeValueType );
+
+    CastFunctionType st_CastFunction;
+    const char *     st_Data;
+    ComponentType *  st_Output;
+  };
+
+  /** Casts a range of pixels, on the threads of the PersistentThreadPool. */
+  static void CastRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  std::string m_FileName;
+  bool        m_CastToPixelType;
+
+  /** The file that holds the data, and its component type. */
+  std::string                  m_DataFileName;
+  ImageIOBase::IOComponentType m_FileComponentType;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMemoryMappedMetaImageReader.hxx"
+#endif
+
+#endif // end #ifndef __itkMemoryMappedMetaImageReader_h
@@ -0,0 +1,283 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMemoryMappedMetaImageReader_hxx
+#define __itkMemoryMappedMetaImageReader_hxx
+
+#include "itkMemoryMappedMetaImageReader.h"
+
+#include "itkMetaImageIO.h"
+#include "itkByteSwapper.h"
+#include "itkPersistentThreadPool.h"
+#include <cstring>
+#include <itksys/SystemTools.hxx>
+
+namespace itk
+{
+
+/**
+ * ******************* GenerateOutputInformation ***********************
+ */
+
+template< class TOutputImage >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::GenerateOutputInformation( void )
+{
+  /** Read the header. */
+  MetaImageIO::Pointer io = MetaImageIO::New();
+  if( this->m_FileName.empty() || !io->CanReadFile( this->m_FileName.c_str() ) )
+  {
+    itkExceptionMacro( << "Cannot read " << this->m_FileName << " as a MetaImage." );
+  }
+  io->SetFileName( this->m_FileName.c_str() );
+  io->ReadImageInformation();
+
+  /** Check that the data has the layout of the output image. */
+  if( io->GetNumberOfDimensions() != ImageDimension )
+  {
+    itkExceptionMacro( << "The dimension of " << this->m_FileName
+                       << " differs from the dimension of the output image." );
+  }
+  this->m_FileComponentType = io->GetComponentType();
+  const bool samePixelType
+    = IsComponentType( io->GetComponentType(), static_cast< const ComponentType * >( 0 ) )
+    && io->GetNumberOfComponents() == sizeof( PixelType ) / sizeof( ComponentType );
+  const bool castableScalars = this->m_CastToPixelType
+    && io->GetNumberOfComponents() == 1 && sizeof( PixelType ) == sizeof( ComponentType )
+    && io->GetComponentType() != ImageIOBase::UNKNOWNCOMPONENTTYPE;
+  if( !samePixelType && !castableScalars )
+  {
+    itkExceptionMacro( << "The pixel type of " << this->m_FileName
+                       << " differs from the pixel type of the output image." );
+  }
+  if( samePixelType )
+  {
+    this->m_FileComponentType = ImageIOBase::UNKNOWNCOMPONENTTYPE;
+  }
+
+  MetaImage * metaImage = io->GetMetaImagePointer();
+  if( metaImage->CompressedData() )
+  {
+    itkExceptionMacro( << "The data of " << this->m_FileName << " is compressed." );
+  }
+
+  const bool bigEndian = io->GetByteOrder() == ImageIOBase::BigEndian;
+  if( io->GetComponentSize() > 1 && bigEndian != ByteSwapper< int >::SystemIsBigEndian() )
+  {
+    itkExceptionMacro( << "The data of " << this->m_FileName
+                       << " does not have the byte order of this machine." );
+  }
+
+  /** Determine the data file; lists and patterns of files are not supported. */
+  const std::string dataFileName = metaImage->ElementDataFileName();
+  if( dataFileName == "LOCAL" )
+  {
+    this->m_DataFileName = this->m_FileName;
+  }
+  else if( dataFileName.find( "LIST" ) == 0 || dataFileName.find( '%' ) != std::string::npos
+    || dataFileName.find( ' ' ) != std::string::npos )
+  {
+    itkExceptionMacro( << "The data of " << this->m_FileName << " is stored in multiple files." );
+  }
+  else if( itksys::SystemTools::FileIsFullPath( dataFileName.c_str() ) )
+  {
+    this->m_DataFileName = dataFileName;
+  }
+  else
+  {
+    const std::string path = itksys::SystemTools::GetFilenamePath( this->m_FileName );
+    this->m_DataFileName = path.empty() ? dataFileName : path + "/" + dataFileName;
+  }
+
+  /** Set the geometry, like the ImageFileReader does. */
+  OutputImageType *                       output = this->GetOutput();
+  typename OutputImageType::SpacingType   spacing;
+  typename OutputImageType::PointType     origin;
+  typename OutputImageType::DirectionType direction;
+  typename RegionType::SizeType           size;
+  typename RegionType::IndexType          index;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    spacing[ i ] = io->GetSpacing( i );
+    origin[ i ]  = io->GetOrigin( i );
+    size[ i ]    = io->GetDimensions( i );
+    index[ i ]   = 0;
+    const std::vector< double > axis = io->GetDirection( i );
+    for( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      direction[ j ][ i ] = axis[ j ];
+    }
+  }
+
+  output->SetSpacing( spacing );
+  output->SetOrigin( origin );
+  output->SetDirection( direction );
+  output->SetLargestPossibleRegion( RegionType( index, size ) );
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ******************* EnlargeOutputRequestedRegion ***********************
+ */
+
+template< class TOutputImage >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  OutputImageType * image = dynamic_cast< OutputImageType * >( output );
+  if( image )
+  {
+    image->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end EnlargeOutputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TOutputImage >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::GenerateData( void )
+{
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+
+  MemoryMappedFile::Pointer file = MemoryMappedFile::New();
+  file->Open( this->m_DataFileName );
+
+  /** The headers precede the data, so the data is at the end of the file. */
+  const SizeValueType numberOfPixels = output->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType fileComponentSize
+    = this->m_FileComponentType == ImageIOBase::UNKNOWNCOMPONENTTYPE
+    ? sizeof( PixelType ) : ImageIOBase::GetComponentTypeSize( this->m_FileComponentType );
+  const SizeValueType dataSize = numberOfPixels * fileComponentSize;
+  if( file->GetSize() < dataSize )
+  {
+    itkExceptionMacro( << this->m_DataFileName << " is too small for the image of "
+                       << this->m_FileName );
+  }
+  char * data = file->GetData() + ( file->GetSize() - dataSize );
+
+  /** A file with another component type is cast into an allocated buffer;
+   * the file is unmapped afterwards.
+   */
+  if( this->m_FileComponentType != ImageIOBase::UNKNOWNCOMPONENTTYPE )
+  {
+    output->Allocate();
+
+    CastParameterType pass;
+    pass.st_Data   = data;
+    pass.st_Output = reinterpret_cast< ComponentType * >( output->GetBufferPointer() );
+    switch( this->m_FileComponentType )
+    {
+      case ImageIOBase::UCHAR: pass.st_CastFunction = &Self::template CastPixels< unsigned char >; break;
+      case ImageIOBase::CHAR: pass.st_CastFunction = &Self::template CastPixels< char >; break;
+      case ImageIOBase::USHORT: pass.st_CastFunction = &Self::template CastPixels< unsigned short >; break;
+      case ImageIOBase::SHORT: pass.st_CastFunction = &Self::template CastPixels< short >; break;
+      case ImageIOBase::UINT: pass.st_CastFunction = &Self::template CastPixels< unsigned int >; break;
+      case ImageIOBase::INT: pass.st_CastFunction = &Self::template CastPixels< int >; break;
+      case ImageIOBase::ULONG: pass.st_CastFunction = &Self::template CastPixels< unsigned long >; break;
+      case ImageIOBase::LONG: pass.st_CastFunction = &Self::template CastPixels< long >; break;
+      case ImageIOBase::FLOAT: pass.st_CastFunction = &Self::template CastPixels< float >; break;
+      case ImageIOBase::DOUBLE: pass.st_CastFunction = &Self::template CastPixels< double >; break;
+      default:
+        itkExceptionMacro( << "The component type of " << this->m_FileName << " is not supported." );
+    }
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfPixels, 0, Self::CastRangeFunction, &pass );
+    return;
+  }
+
+  if( reinterpret_cast< std::size_t >( data ) % sizeof( ComponentType ) != 0 )
+  {
+    itkExceptionMacro( << "The data of " << this->m_FileName
+                       << " is not aligned, and cannot be mapped." );
+  }
+
+  typename MappedContainerType::Pointer container = MappedContainerType::New();
+  container->SetImportPointer( reinterpret_cast< PixelType * >( data ), numberOfPixels, false );
+  container->SetMappedFile( file );
+  output->SetPixelContainer( container );
+
+} // end GenerateData()
+
+
+/**
+ * ******************* CastPixels ***********************
+ */
+
+template< class TOutputImage >
+template< class TFileComponent >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::CastPixels( const char * data, ComponentType * output,
+  SizeValueType begin, SizeValueType end )
+{
+  /** The data of an .mha file need not be aligned, so it is copied per pixel. */
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    TFileComponent value;
+    std::memcpy( &value, data + i * sizeof( TFileComponent ), sizeof( TFileComponent ) );
+    output[ i ] = static_cast< ComponentType >( value );
+  }
+
+} // end CastPixels()
+
+
+/**
+ * ******************* CastRangeFunction ***********************
+ */
+
+template< class TOutputImage >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::CastRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const CastParameterType * pass = static_cast< const CastParameterType * >( userData );
+  pass->st_CastFunction( pass->st_Data, pass->st_Output, begin, end );
+
+} // end CastRangeFunction()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template< class TOutputImage >
+void
+MemoryMappedMetaImageReader< TOutputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "FileName: " << this->m_FileName << std::endl;
+  os << indent << "DataFileName: " << this->m_DataFileName << std::endl;
+  os << indent << "CastToPixelType: " << this->m_CastToPixelType << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMemoryMappedMetaImageReader_hxx
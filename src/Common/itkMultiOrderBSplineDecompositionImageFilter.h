@@ -43,6 +43,7 @@
 #include "vnl/vnl_matrix.h"
 
 #include "itkImageToImageFilter.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -71,11 +72,17 @@ namespace itk
  *               Uses mirror boundary conditions.
  *               Can only process LargestPossibleRegion
  *
+ * The coefficients are computed in the output buffer, one dimension after the
+ * other. The lines along a dimension are independent, and are distributed over
+ * the threads of the PersistentThreadPool. Dimensions with a spline order of 0
+ * or 1 need no filtering, and are skipped. The output may have a float pixel
+ * type, in which case the recursions are still done in double precision, but
+ * per line only.
+ *
  * \sa itkBSplineInterpolateImageFunction
  *
  *  ***TODO: Is this an ImageFilter?  or does it belong to another group?
  * \ingroup ImageFilters
- * \ingroup SingleThreaded
  * \ingroup CannotBeStreamed
  */
 template< class TInputImage, class TOutputImage >
@@ -101,6 +108,7 @@ public:
   typedef typename Superclass::InputImagePointer      InputImagePointer;
   typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
   typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename TOutputImage::PixelType            OutputPixelType;
 
   typedef typename itk::NumericTraits< typename TOutputImage::PixelType >::RealType CoeffType;
 
@@ -153,7 +161,6 @@ protected:
   void EnlargeOutputRequestedRegion( DataObject * output );
 
   /** These are needed by the smoothing spline routine. */
-  std::vector< CoeffType > m_Scratch;             // temp storage for processing of Coefficients
   typename TInputImage::SizeType m_DataLength;    // Image size
 
   unsigned int m_SplineOrder[ ImageDimension ];            // User specified spline order per dimension (3rd or cubic is the default)
@@ -170,28 +177,39 @@ private:
   /** Determines the poles for dimension given the Spline Order. */
   virtual void SetPoles( unsigned int dimension );
 
-  /** Converts a vector of data to a vector of Spline coefficients. */
-  virtual bool DataToCoefficients1D();
+  /** The data of the filtering along one dimension, shared by the threads. */
+  struct DimensionPassType
+  {
+    const Self *      m_Filter;
+    OutputPixelType * m_Buffer;
+    unsigned int      m_Direction;
+    SizeValueType     m_Size[ ImageDimension ];
+    OffsetValueType   m_OffsetTable[ ImageDimension ];
+  };
+
+  /** Converts a vector of data to a vector of Spline coefficients,
+   * using the poles of the current dimension. */
+  virtual bool DataToCoefficients1D( CoeffType * scratch, const unsigned long length ) const;
 
   /** Converts an N-dimension image of data to an equivalent sized image
    *    of spline coefficients. */
   void DataToCoefficientsND();
 
+  /** Filters the lines [begin, end) along the dimension of a pass. */
+  static void DimensionPassRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
   /** Determines the first coefficient for the causal filtering of the data. */
-  virtual void SetInitialCausalCoefficient( double z );
+  virtual void SetInitialCausalCoefficient( double z,
+    CoeffType * scratch, const unsigned long length ) const;
 
   /** Determines the first coefficient for the anti-causal filtering of the data. */
-  virtual void SetInitialAntiCausalCoefficient( double z );
+  virtual void SetInitialAntiCausalCoefficient( double z,
+    CoeffType * scratch, const unsigned long length ) const;
 
   /** Used to initialize the Coefficients image before calculation. */
   void CopyImageToImage();
 
-  /** Copies a vector of data from the Coefficients image to the m_Scratch vector. */
-  void CopyCoefficientsToScratch( OutputLinearIterator & );
-
-  /** Copies a vector of data from m_Scratch to the Coefficients image. */
-  void CopyScratchToCoefficients( OutputLinearIterator & );
-
 };
 
 } // namespace itk
@@ -40,7 +40,6 @@
 #include "itkMultiOrderBSplineDecompositionImageFilter.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkImageRegionIterator.h"
-#include "itkProgressReporter.h"
 #include "itkVector.h"
 
 namespace itk
@@ -87,7 +86,7 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 template< class TInputImage, class TOutputImage >
 bool
 MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::DataToCoefficients1D()
+::DataToCoefficients1D( CoeffType * scratch, const unsigned long length ) const
 {
 
   // See Unser, 1993, Part II, Equation 2.5,
@@ -95,7 +94,7 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 
   double c0 = 1.0;
 
-  if( m_DataLength[ m_IteratorDirection ] == 1 ) //Required by mirror boundaries
+  if( length == 1 ) //Required by mirror boundaries
   {
     return false;
   }
@@ -108,28 +107,28 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
   }
 
   // apply the gain
-  for( unsigned int n = 0; n < m_DataLength[ m_IteratorDirection ]; n++ )
+  for( unsigned int n = 0; n < length; n++ )
   {
-    m_Scratch[ n ] *= c0;
+    scratch[ n ] *= c0;
   }
 
   // loop over all poles
   for( int k = 0; k < m_NumberOfPoles; k++ )
   {
     // causal initialization
-    this->SetInitialCausalCoefficient( m_SplinePoles[ k ] );
+    this->SetInitialCausalCoefficient( m_SplinePoles[ k ], scratch, length );
     // causal recursion
-    for( unsigned int n = 1; n < m_DataLength[ m_IteratorDirection ]; n++ )
+    for( unsigned int n = 1; n < length; n++ )
     {
-      m_Scratch[ n ] += m_SplinePoles[ k ] * m_Scratch[ n - 1 ];
+      scratch[ n ] += m_SplinePoles[ k ] * scratch[ n - 1 ];
     }
 
     // anticausal initialization
-    this->SetInitialAntiCausalCoefficient( m_SplinePoles[ k ] );
+    this->SetInitialAntiCausalCoefficient( m_SplinePoles[ k ], scratch, length );
     // anticausal recursion
-    for( int n = m_DataLength[ m_IteratorDirection ] - 2; 0 <= n; n-- )
+    for( int n = length - 2; 0 <= n; n-- )
     {
-      m_Scratch[ n ] = m_SplinePoles[ k ] * ( m_Scratch[ n + 1 ] - m_Scratch[ n ] );
+      scratch[ n ] = m_SplinePoles[ k ] * ( scratch[ n + 1 ] - scratch[ n ] );
     }
   }
   return true;
@@ -225,7 +224,8 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 template< class TInputImage, class TOutputImage >
 void
 MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::SetInitialCausalCoefficient( double z )
+::SetInitialCausalCoefficient( double z,
+  CoeffType * scratch, const unsigned long length ) const
 {
   /* begining InitialCausalCoefficient */
   /* See Unser, 1999, Box 2 for explaination */
@@ -234,37 +234,37 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
   unsigned long horizon;
 
   /* this initialization corresponds to mirror boundaries */
-  horizon = m_DataLength[ m_IteratorDirection ];
+  horizon = length;
   zn      = z;
   if( m_Tolerance > 0.0 )
   {
     horizon = (long)vcl_ceil( vcl_log( m_Tolerance ) / vcl_log( vcl_fabs( z ) ) );
   }
-  if( horizon < m_DataLength[ m_IteratorDirection ] )
+  if( horizon < length )
   {
     /* accelerated loop */
-    sum = m_Scratch[ 0 ];   // verify this
+    sum = scratch[ 0 ];   // verify this
     for( unsigned int n = 1; n < horizon; n++ )
     {
-      sum += zn * m_Scratch[ n ];
+      sum += zn * scratch[ n ];
       zn  *= z;
     }
-    m_Scratch[ 0 ] = sum;
+    scratch[ 0 ] = sum;
   }
   else
   {
     /* full loop */
     iz   = 1.0 / z;
-    z2n  = vcl_pow( z, (double)( m_DataLength[ m_IteratorDirection ] - 1L ) );
-    sum  = m_Scratch[ 0 ] + z2n * m_Scratch[ m_DataLength[ m_IteratorDirection ] - 1L ];
+    z2n  = vcl_pow( z, (double)( length - 1L ) );
+    sum  = scratch[ 0 ] + z2n * scratch[ length - 1L ];
     z2n *= z2n * iz;
-    for( unsigned int n = 1; n <= ( m_DataLength[ m_IteratorDirection ] - 2 ); n++ )
+    for( unsigned int n = 1; n <= ( length - 2 ); n++ )
     {
-      sum += ( zn + z2n ) * m_Scratch[ n ];
+      sum += ( zn + z2n ) * scratch[ n ];
       zn  *= z;
       z2n *= iz;
     }
-    m_Scratch[ 0 ] = sum / ( 1.0 - zn * zn );
+    scratch[ 0 ] = sum / ( 1.0 - zn * zn );
   }
 }
 
@@ -272,14 +272,15 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 template< class TInputImage, class TOutputImage >
 void
 MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::SetInitialAntiCausalCoefficient( double z )
+::SetInitialAntiCausalCoefficient( double z,
+  CoeffType * scratch, const unsigned long length ) const
 {
   // this initialization corresponds to mirror boundaries
   /* See Unser, 1999, Box 2 for explaination */
   //  Also see erratum at http://bigwww.epfl.ch/publications/unser9902.html
-  m_Scratch[ m_DataLength[ m_IteratorDirection ] - 1 ]
+  scratch[ length - 1 ]
     = ( z / ( z * z - 1.0 ) )
-    * ( z * m_Scratch[ m_DataLength[ m_IteratorDirection ] - 2 ] + m_Scratch[ m_DataLength[ m_IteratorDirection ] - 1 ] );
+    * ( z * scratch[ length - 2 ] + scratch[ length - 1 ] );
 }
 
 
@@ -290,15 +291,18 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 {
   OutputImagePointer output = this->GetOutput();
 
-  Size< ImageDimension > size = output->GetBufferedRegion().GetSize();
-
-  unsigned int count = output->GetBufferedRegion().GetNumberOfPixels() / size[ 0 ] * ImageDimension;
-
-  ProgressReporter progress( this, 0, count, 10 );
-
   // Initialize coeffient array
   this->CopyImageToImage();   // Coefficients are initialized to the input data
 
+  DimensionPassType pass;
+  pass.m_Filter = this;
+  pass.m_Buffer = output->GetBufferPointer();
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    pass.m_Size[ d ]        = output->GetBufferedRegion().GetSize( d );
+    pass.m_OffsetTable[ d ] = output->GetOffsetTable()[ d ];
+  }
+
   for( unsigned int n = 0; n < ImageDimension; n++ )
   {
     m_IteratorDirection = n;
@@ -307,89 +311,87 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
     // Compute poles for this dimension
     this->SetPoles( n );
 
-    // Initialize iterators
-    OutputLinearIterator CIterator( output, output->GetBufferedRegion() );
-    CIterator.SetDirection( m_IteratorDirection );
-    // For each data vector
-    while( !CIterator.IsAtEnd() )
+    // Without poles the gain is one, and the line is unchanged.
+    if( m_NumberOfPoles > 0 && pass.m_Size[ n ] > 1 )
     {
-      // Copy coefficients to scratch
-      this->CopyCoefficientsToScratch( CIterator );
-
-      // Perform 1D BSpline calculations
-      this->DataToCoefficients1D();
-
-      // Copy scratch back to coefficients.
-      // Brings us back to the end of the line we were working on.
-      CIterator.GoToBeginOfLine();
-      this->CopyScratchToCoefficients( CIterator ); // m_Scratch = m_Image;
-      CIterator.NextLine();
-      progress.CompletedPixel();
+      // Filter the lines along this dimension in parallel.
+      pass.m_Direction = n;
+      const SizeValueType numberOfLines
+        = output->GetBufferedRegion().GetNumberOfPixels() / pass.m_Size[ n ];
+      PersistentThreadPool::GetInstance()->ParallelFor(
+        numberOfLines, 0, DimensionPassRangeFunction, &pass );
     }
+
+    this->UpdateProgress( static_cast< float >( n + 1 ) / static_cast< float >( ImageDimension ) );
   }
 }
 
 
 /**
- * Copy the input image into the output image
+ * Filter a range of lines along one dimension
  */
 template< class TInputImage, class TOutputImage >
 void
 MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::CopyImageToImage()
+::DimensionPassRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
 {
-  typedef ImageRegionConstIteratorWithIndex< TInputImage > InputIterator;
-  typedef ImageRegionIterator< TOutputImage >              OutputIterator;
-  typedef typename TOutputImage::PixelType                 OutputPixelType;
-
-  InputIterator  inIt( this->GetInput(), this->GetInput()->GetBufferedRegion() );
-  OutputIterator outIt( this->GetOutput(), this->GetOutput()->GetBufferedRegion() );
+  const DimensionPassType & pass      = *static_cast< const DimensionPassType * >( userData );
+  const unsigned int        direction = pass.m_Direction;
+  const unsigned long       length    = pass.m_Size[ direction ];
+  const OffsetValueType     stride    = pass.m_OffsetTable[ direction ];
 
-  inIt.GoToBegin();
-  outIt.GoToBegin();
-  while( !outIt.IsAtEnd() )
+  std::vector< CoeffType > scratch( length );
+  for( SizeValueType line = begin; line < end; ++line )
   {
-    outIt.Set( static_cast< OutputPixelType >( inIt.Get() ) );
-    ++inIt;
-    ++outIt;
-  }
-}
+    // Compute the offset of the first pixel of the line.
+    SizeValueType   remainder = line;
+    OffsetValueType offset    = 0;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      if( d == direction ) { continue; }
+      offset    += static_cast< OffsetValueType >( remainder % pass.m_Size[ d ] ) * pass.m_OffsetTable[ d ];
+      remainder /= pass.m_Size[ d ];
+    }
 
+    // Copy the line to the scratch, filter, and copy it back.
+    OutputPixelType * data = pass.m_Buffer + offset;
+    for( unsigned long j = 0; j < length; ++j )
+    {
+      scratch[ j ] = static_cast< CoeffType >( data[ j * stride ] );
+    }
 
-/**
- * Copy the scratch to one line of the output image
- */
-template< class TInputImage, class TOutputImage >
-void
-MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::CopyScratchToCoefficients( OutputLinearIterator & Iter )
-{
-  typedef typename TOutputImage::PixelType OutputPixelType;
-  unsigned long j = 0;
-  while( !Iter.IsAtEndOfLine() )
-  {
-    Iter.Set( static_cast< OutputPixelType >( m_Scratch[ j ] ) );
-    ++Iter;
-    ++j;
-  }
+    pass.m_Filter->DataToCoefficients1D( &scratch[ 0 ], length );
 
+    for( unsigned long j = 0; j < length; ++j )
+    {
+      data[ j * stride ] = static_cast< OutputPixelType >( scratch[ j ] );
+    }
+  }
 }
 
 
 /**
- * Copy one line of the output image to the scratch
+ * Copy the input image into the output image
  */
 template< class TInputImage, class TOutputImage >
 void
 MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
-::CopyCoefficientsToScratch( OutputLinearIterator & Iter )
+::CopyImageToImage()
 {
-  unsigned long j = 0;
-  while( !Iter.IsAtEndOfLine() )
+  typedef ImageRegionConstIteratorWithIndex< TInputImage > InputIterator;
+  typedef ImageRegionIterator< TOutputImage >              OutputIterator;
+
+  InputIterator  inIt( this->GetInput(), this->GetInput()->GetBufferedRegion() );
+  OutputIterator outIt( this->GetOutput(), this->GetOutput()->GetBufferedRegion() );
+
+  inIt.GoToBegin();
+  outIt.GoToBegin();
+  while( !outIt.IsAtEnd() )
   {
-    m_Scratch[ j ] = static_cast< CoeffType >( Iter.Get() );
-    ++Iter;
-    ++j;
+    outIt.Set( static_cast< OutputPixelType >( inIt.Get() ) );
+    ++inIt;
+    ++outIt;
   }
 }
 
@@ -443,20 +445,9 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
 ::GenerateData()
 {
 
-  // Allocate scratch memory
   InputImageConstPointer inputPtr = this->GetInput();
   m_DataLength = inputPtr->GetBufferedRegion().GetSize();
 
-  unsigned long maxLength = 0;
-  for( unsigned int n = 0; n < ImageDimension; n++ )
-  {
-    if( m_DataLength[ n ] > maxLength )
-    {
-      maxLength = m_DataLength[ n ];
-    }
-  }
-  m_Scratch.resize( maxLength );
-
   // Allocate memory for output image
   OutputImagePointer outputPtr = this->GetOutput();
   outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
@@ -465,9 +456,6 @@ MultiOrderBSplineDecompositionImageFilter< TInputImage, TOutputImage >
   // Calculate actual output
   this->DataToCoefficientsND();
 
-  // Clean up
-  m_Scratch.clear();
-
 }
 
 
@@ -41,6 +41,7 @@
 #include "itkCastImageFilter.h"
 #include "itkRecursiveGaussianImageFilter.h"
 #include "itkExceptionObject.h"
+#include "itkRegistrationProgress.h"
 
 #include "vnl/vnl_math.h"
 
@@ -119,6 +120,7 @@ MultiResolutionGaussianSmoothingPyramidImageFilter< TInputImage, TOutputImage >
     smootherArray[ i ]->SetZeroOrder();
     smootherArray[ i ]->SetNormalizeAcrossScale( false );
     smootherArray[ i ]->ReleaseDataFlagOn();
+    RegistrationProgress::AbortOnCancel( smootherArray[ i ] );
   }
 
   /** Create smoother pointer array which maintains pointers
@@ -144,6 +146,9 @@ MultiResolutionGaussianSmoothingPyramidImageFilter< TInputImage, TOutputImage >
     this->UpdateProgress( static_cast< float >( ilevel )
       / static_cast< float >( this->m_NumberOfLevels ) );
 
+    // Stop here if the registration was cancelled
+    RegistrationProgress::ThrowIfCurrentCancelRequested();
+
     // Allocate memory for each output
     OutputImagePointer outputPtr = this->GetOutput( ilevel );
     outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
@@ -45,6 +45,8 @@
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkNumericTraits.h"
 #include "itkDataObjectDecorator.h"
+#include "itkPhaseTimer.h"
+#include <vector>
 
 namespace itk
 {
@@ -91,6 +93,15 @@ namespace itk
  * This class is templated over the fixed image type and the moving image
  * type.
  *
+ * Optionally, a multi-start is done at the first resolution level, see
+ * SetMultiStartCandidates(). The candidate initial parameters are optimized
+ * for a few iterations each, in rounds of successive halving: after each
+ * round the worse half of the candidates, in terms of the metric value, is
+ * dropped and the number of iterations is doubled. Only the best candidate is
+ * optimized further, and continued in the following resolution levels. The
+ * candidates share the pyramids, the metric and the image sampler, so that
+ * the preprocessing is done only once.
+ *
  * \sa ImageRegistrationMethod
  * \ingroup RegistrationFilters
  */
@@ -159,6 +170,9 @@ public:
    */
   typedef typename MetricType::TransformParametersType ParametersType;
 
+  /** Type of a container of transformation parameters. */
+  typedef std::vector< ParametersType > ParametersContainerType;
+
   /** Smart Pointer type to a DataObject. */
   typedef typename DataObject::Pointer DataObjectPointer;
 
@@ -212,6 +226,16 @@ public:
   /** Get the current resolution level being processed. */
   itkGetMacro( CurrentLevel, unsigned long );
 
+  /** Set/Get the first resolution level that is optimized. The levels
+   * before it are skipped: the IterationEvent is still invoked for them, so
+   * that the components are set up as usual, but the optimizer is not
+   * started, and the initial parameters of a skipped level are passed on to
+   * the next level. This is used to resume an interrupted registration.
+   * Default: 0.
+   */
+  itkSetMacro( FirstLevel, unsigned long );
+  itkGetConstMacro( FirstLevel, unsigned long );
+
   /** Set/Get the initial transformation parameters. */
   itkSetMacro( InitialTransformParameters, ParametersType );
   itkGetConstReferenceMacro( InitialTransformParameters, ParametersType );
@@ -228,6 +252,29 @@ public:
    */
   itkGetConstReferenceMacro( LastTransformParameters, ParametersType );
 
+  /** Set/Get the candidate initial transformation parameters of the
+   * multi-start at the first resolution level. With less than two candidates
+   * no multi-start is done, which is the default. The candidates replace the
+   * initial transformation parameters.
+   */
+  virtual void SetMultiStartCandidates( const ParametersContainerType & candidates )
+  {
+    this->m_MultiStartCandidates = candidates;
+    this->Modified();
+  }
+
+  itkGetConstReferenceMacro( MultiStartCandidates, ParametersContainerType );
+
+  /** Set/Get the number of iterations per candidate in the first round of
+   * the multi-start; it is doubled in every next round. Default: 10.
+   */
+  itkSetClampMacro( MultiStartNumberOfIterations, unsigned long, 1,
+    NumericTraits< unsigned long >::max() );
+  itkGetConstMacro( MultiStartNumberOfIterations, unsigned long );
+
+  /** Get the index of the candidate that was selected by the multi-start. */
+  itkGetConstMacro( MultiStartSelectedCandidate, unsigned long );
+
   /** Returns the transform resulting from the registration process. */
   const TransformOutputType * GetOutput( void ) const;
 
@@ -269,6 +316,19 @@ protected:
   /** Set the current level to be processed. */
   itkSetMacro( CurrentLevel, unsigned long );
 
+  /** Selects the best of the multi-start candidates by successive halving,
+   * and sets it as the initial position of the optimizer. Called after
+   * Initialize() at the first resolution level, if there are at least two
+   * candidates.
+   */
+  virtual void SelectMultiStartCandidate( void );
+
+  /** Observes the iterations of the optimizer during the multi-start, and
+   * aborts the optimization of a candidate when its iterations of the
+   * current round are done, by throwing a ProcessAborted exception.
+   */
+  void MultiStartIterationCallback( void );
+
   /** The last transform parameters. Compared to the ITK class
    * itk::MultiResolutionImageRegistrationMethod these member variables
    * are made protected, so they can be accessed by children classes.
@@ -300,6 +360,13 @@ private:
 
   unsigned long m_NumberOfLevels;
   unsigned long m_CurrentLevel;
+  unsigned long m_FirstLevel;
+
+  ParametersContainerType m_MultiStartCandidates;
+  unsigned long           m_MultiStartNumberOfIterations;
+  unsigned long           m_MultiStartSelectedCandidate;
+  unsigned long           m_MultiStartIterationCount;
+  unsigned long           m_MultiStartIterationBudget;
 
 };
 
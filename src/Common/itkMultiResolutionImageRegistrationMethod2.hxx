@@ -42,7 +42,10 @@
 #include "itkMultiResolutionImageRegistrationMethod2.h"
 #include "itkRecursiveMultiResolutionPyramidImageFilter.h"
 #include "itkContinuousIndex.h"
+#include "itkCommand.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
+#include <utility>
 
 namespace itk
 {
@@ -70,9 +73,15 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 
   this->m_NumberOfLevels = 1;
   this->m_CurrentLevel   = 0;
+  this->m_FirstLevel     = 0;
 
   this->m_Stop = false;
 
+  this->m_MultiStartNumberOfIterations = 10;
+  this->m_MultiStartSelectedCandidate  = 0;
+  this->m_MultiStartIterationCount     = 0;
+  this->m_MultiStartIterationBudget    = 0;
+
   this->m_InitialTransformParameters            = ParametersType( 0 );
   this->m_InitialTransformParametersOfNextLevel = ParametersType( 0 );
   this->m_LastTransformParameters               = ParametersType( 0 );
@@ -163,6 +172,8 @@ void
 MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 ::PreparePyramids( void )
 {
+  itkPhaseTimerMacro( "PreparePyramids" );
+
   if( !this->m_Transform )
   {
     itkExceptionMacro( << "Transform is not present" );
@@ -318,6 +329,15 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
         break;
       }
 
+      // Skip the levels before the first level; their initial parameters
+      // are passed on to the next level.
+      if( this->m_CurrentLevel < this->m_FirstLevel )
+      {
+        this->m_LastTransformParameters = this->m_InitialTransformParametersOfNextLevel;
+        this->m_Transform->SetParameters( this->m_LastTransformParameters );
+        continue;
+      }
+
       try
       {
         // initialize the interconnects between components
@@ -334,6 +354,12 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 
       try
       {
+        // select the best of the multi-start candidates
+        if( this->m_CurrentLevel == 0 && this->m_MultiStartCandidates.size() > 1 )
+        {
+          this->SelectMultiStartCandidate();
+        }
+
         // do the optimization
         this->m_Optimizer->StartOptimization();
       }
@@ -363,6 +389,136 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 } // end StartRegistration()
 
 
+/*
+ * SelectMultiStartCandidate
+ */
+template< typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
+::SelectMultiStartCandidate( void )
+{
+  typedef typename MetricType::MeasureType     MeasureType;
+  typedef std::pair< MeasureType, std::size_t > RankType;
+
+  const unsigned long     numberOfParameters = this->m_Transform->GetNumberOfParameters();
+  ParametersContainerType positions          = this->m_MultiStartCandidates;
+  for( std::size_t c = 0; c < positions.size(); ++c )
+  {
+    if( positions[ c ].GetSize() != numberOfParameters )
+    {
+      itkExceptionMacro( << "The size of multi-start candidate " << c
+                         << " (" << positions[ c ].GetSize()
+                         << ") does not match the number of transform parameters ("
+                         << numberOfParameters << ")." );
+    }
+  }
+
+  /** The candidates that are still in the race. */
+  std::vector< std::size_t > alive( positions.size() );
+  for( std::size_t c = 0; c < alive.size(); ++c )
+  {
+    alive[ c ] = c;
+  }
+
+  /** Count the iterations of the optimizer, to abort it after the budget of
+   * the current round. The optimizer only sees one candidate at a time; the
+   * metric and the optimizer are not re-entrant.
+   */
+  typedef SimpleMemberCommand< Self > CommandType;
+  typename CommandType::Pointer command = CommandType::New();
+  command->SetCallbackFunction( this, &Self::MultiStartIterationCallback );
+  const unsigned long tag = this->m_Optimizer->AddObserver( IterationEvent(), command );
+
+  this->m_MultiStartIterationBudget = this->m_MultiStartNumberOfIterations;
+  while( alive.size() > 1 )
+  {
+    /** Optimize each remaining candidate for the budget of this round,
+     * continuing from where it stopped in the previous round.
+     */
+    for( std::size_t a = 0; a < alive.size(); ++a )
+    {
+      const std::size_t c = alive[ a ];
+      this->m_MultiStartIterationCount = 0;
+      this->m_Optimizer->SetInitialPosition( positions[ c ] );
+      try
+      {
+        this->m_Optimizer->StartOptimization();
+      }
+      catch( ProcessAborted & )
+      {
+        // the budget of this round is used up
+      }
+      catch( ExceptionObject & )
+      {
+        this->m_Optimizer->RemoveObserver( tag );
+        throw;
+      }
+      positions[ c ] = this->m_Optimizer->GetCurrentPosition();
+    }
+
+    /** Rank the remaining candidates by their metric value, all evaluated
+     * with the same samples. Candidates that cannot be evaluated, e.g.
+     * because too many samples map outside the moving image, are ranked last.
+     */
+    std::vector< RankType > ranking( alive.size() );
+    for( std::size_t a = 0; a < alive.size(); ++a )
+    {
+      MeasureType value = NumericTraits< MeasureType >::max();
+      try
+      {
+        value = this->m_Metric->GetValue( positions[ alive[ a ] ] );
+      }
+      catch( ExceptionObject & )
+      {
+        // keep the maximum value
+      }
+      if( vnl_math_isnan( value ) )
+      {
+        value = NumericTraits< MeasureType >::max();
+      }
+      ranking[ a ] = RankType( value, alive[ a ] );
+    }
+    std::stable_sort( ranking.begin(), ranking.end() );
+
+    /** Keep the better half, and double the budget of the next round. */
+    alive.resize( ( alive.size() + 1 ) / 2 );
+    for( std::size_t a = 0; a < alive.size(); ++a )
+    {
+      alive[ a ] = ranking[ a ].second;
+    }
+    this->m_MultiStartIterationBudget *= 2;
+  }
+
+  this->m_Optimizer->RemoveObserver( tag );
+
+  /** Continue the optimization of this level from the winner. */
+  this->m_MultiStartSelectedCandidate           = alive[ 0 ];
+  this->m_InitialTransformParametersOfNextLevel = positions[ alive[ 0 ] ];
+  this->m_Transform->SetParameters( positions[ alive[ 0 ] ] );
+  this->m_Optimizer->SetInitialPosition( positions[ alive[ 0 ] ] );
+
+} // end SelectMultiStartCandidate()
+
+
+/*
+ * MultiStartIterationCallback
+ */
+template< typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
+::MultiStartIterationCallback( void )
+{
+  ++this->m_MultiStartIterationCount;
+  if( this->m_MultiStartIterationCount >= this->m_MultiStartIterationBudget )
+  {
+    ProcessAborted e( __FILE__, __LINE__ );
+    e.SetDescription( "The multi-start iterations of this candidate are done." );
+    throw e;
+  }
+
+} // end MultiStartIterationCallback()
+
+
 /*
  * PrintSelf
  */
@@ -385,6 +541,7 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
 
   os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
   os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
+  os << indent << "FirstLevel: " << this->m_FirstLevel << std::endl;
 
   os << indent << "InitialTransformParameters: "
      << this->m_InitialTransformParameters << std::endl;
@@ -401,6 +558,13 @@ MultiResolutionImageRegistrationMethod2< TFixedImage, TMovingImage >
        << this->m_FixedImageRegionPyramid[ level ] << std::endl;
   }
 
+  os << indent << "MultiStartCandidates: "
+     << this->m_MultiStartCandidates.size() << std::endl;
+  os << indent << "MultiStartNumberOfIterations: "
+     << this->m_MultiStartNumberOfIterations << std::endl;
+  os << indent << "MultiStartSelectedCandidate: "
+     << this->m_MultiStartSelectedCandidate << std::endl;
+
 } // end PrintSelf()
 
 
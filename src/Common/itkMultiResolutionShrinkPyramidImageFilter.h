@@ -31,6 +31,12 @@ namespace itk
  * No smoothing or any other operation is performed. This is useful for
  * example for registering binary images.
  *
+ * A level without shrinking (all factors 1) is not copied: when the input
+ * and output image types are the same, its output shares the pixel buffer
+ * of the input. The levels are read-only for the registration, so this saves
+ * the copy and the memory of the largest level. The shrunk levels are still
+ * allocated; they are at most half the size of the input in each dimension.
+ *
  * \sa ShrinkImageFilter
  *
  * \ingroup PyramidImageFilter Multithreaded Streamed
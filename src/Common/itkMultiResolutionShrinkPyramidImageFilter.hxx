@@ -21,6 +21,7 @@
 #include "itkMultiResolutionShrinkPyramidImageFilter.h"
 
 #include "itkShrinkImageFilter.h"
+#include "itkRegistrationProgress.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -39,6 +40,12 @@ MultiResolutionShrinkPyramidImageFilter< TInputImage, TOutputImage >
   typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
   shrinker->SetInput( this->GetInput() );
 
+  /** The input as output image, if the types are the same; used to share
+   * the buffer of the input with the levels without shrinking.
+   */
+  const OutputImageType * inputAsOutput
+    = dynamic_cast< const OutputImageType * >( this->GetInput() );
+
   /** Loop over all resolution levels. */
   unsigned int factors[ ImageDimension ];
   for( unsigned int ilevel = 0; ilevel < this->m_NumberOfLevels; ilevel++ )
@@ -46,16 +53,30 @@ MultiResolutionShrinkPyramidImageFilter< TInputImage, TOutputImage >
     this->UpdateProgress( static_cast< float >( ilevel )
       / static_cast< float >( this->m_NumberOfLevels ) );
 
-    // Allocate memory for each output
-    OutputImagePointer outputPtr = this->GetOutput( ilevel );
-    outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
-    outputPtr->Allocate();
+    /** Stop here if the registration was cancelled. */
+    RegistrationProgress::ThrowIfCurrentCancelRequested();
 
-    // compute and set shrink factors
+    // compute shrink factors
+    bool unitFactors = true;
     for( unsigned int idim = 0; idim < ImageDimension; idim++ )
     {
       factors[ idim ] = this->m_Schedule[ ilevel ][ idim ];
+      unitFactors    &= ( factors[ idim ] <= 1 );
+    }
+
+    // a level without shrinking shares the buffer of the input
+    OutputImagePointer outputPtr = this->GetOutput( ilevel );
+    if( unitFactors && inputAsOutput )
+    {
+      outputPtr->Graft( inputAsOutput );
+      continue;
     }
+
+    // Allocate memory for each output
+    outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+    outputPtr->Allocate();
+
+    // set shrink factors
     shrinker->SetShrinkFactors( factors );
     shrinker->GraftOutput( outputPtr );
 
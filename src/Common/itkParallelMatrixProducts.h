@@ -0,0 +1,87 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelMatrixProducts_h
+#define __itkParallelMatrixProducts_h
+
+#include "itkPersistentThreadPool.h"
+#include "itkNumericTraits.h"
+#include "vnl/vnl_matrix.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+/** \class ParallelMatrixProducts
+ * \brief Blocked, threaded products of tall data matrices.
+ *
+ * The groupwise metrics store their samples in a data matrix A of
+ * N samples times G images, with N much larger than G. This class computes
+ * the G x G cross product matrix A^T A and the product A B of such a matrix
+ * with a small matrix B, processing blocks of rows of A in parallel on the
+ * PersistentThreadPool. The partial results of the row blocks are summed
+ * in a fixed order, so the result does not depend on the number of threads.
+ * When elastix is built with ELASTIX_USE_EIGEN the products of the blocks
+ * are computed by Eigen.
+ */
+
+template< class TValue >
+class ParallelMatrixProducts
+{
+public:
+
+  typedef ParallelMatrixProducts Self;
+  typedef TValue                 ValueType;
+  typedef vnl_matrix< TValue >   MatrixType;
+
+  /** Compute C = A^T A. */
+  static void ComputeTransposeProduct( const MatrixType & A, MatrixType & C,
+    bool useMultiThread = true );
+
+  /** Compute C = A B, with A having many more rows than B. */
+  static void ComputeProduct( const MatrixType & A, const MatrixType & B,
+    MatrixType & C, bool useMultiThread = true );
+
+  /** The number of rows of A in a block. */
+  static const unsigned int BlockSize = 256;
+
+private:
+
+  struct ProductPassStruct
+  {
+    const MatrixType *                      st_A;
+    const MatrixType *                      st_B;
+    MatrixType *                            st_C;
+    std::vector< std::vector< ValueType > > st_BlockResults;
+  };
+
+  static void TransposeProductRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void ProductRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelMatrixProducts.hxx"
+#endif
+
+#endif // end #ifndef __itkParallelMatrixProducts_h
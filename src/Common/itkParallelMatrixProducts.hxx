@@ -0,0 +1,219 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelMatrixProducts_hxx
+#define __itkParallelMatrixProducts_hxx
+
+#include "itkParallelMatrixProducts.h"
+
+#ifdef ELASTIX_USE_EIGEN
+#include <Eigen/Core>
+#endif
+
+namespace itk
+{
+
+/**
+ * ******************* ComputeTransposeProduct *******************
+ */
+
+template< class TValue >
+void
+ParallelMatrixProducts< TValue >
+::ComputeTransposeProduct( const MatrixType & A, MatrixType & C,
+  bool useMultiThread )
+{
+  const SizeValueType N              = A.rows();
+  const unsigned int  G              = A.cols();
+  const SizeValueType numberOfBlocks = ( N + BlockSize - 1 ) / BlockSize;
+
+  /** Every block computes the lower triangle of its own partial product. */
+  ProductPassStruct pass;
+  pass.st_A = &A;
+  pass.st_B = 0;
+  pass.st_C = &C;
+  pass.st_BlockResults.resize( numberOfBlocks );
+  if( useMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfBlocks, 1, Self::TransposeProductRangeFunction, &pass );
+  }
+  else
+  {
+    Self::TransposeProductRangeFunction( &pass, 0, 0, numberOfBlocks );
+  }
+
+  /** Sum the blocks in a fixed order and fill the upper triangle. */
+  C.set_size( G, G );
+  C.fill( NumericTraits< ValueType >::Zero );
+  for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+  {
+    const ValueType * partial = &pass.st_BlockResults[ b ][ 0 ];
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      for( unsigned int k = 0; k <= j; ++k )
+      {
+        C( j, k ) += partial[ j * G + k ];
+      }
+    }
+  }
+  for( unsigned int j = 0; j < G; ++j )
+  {
+    for( unsigned int k = 0; k < j; ++k )
+    {
+      C( k, j ) = C( j, k );
+    }
+  }
+
+} // end ComputeTransposeProduct()
+
+
+/**
+ * ******************* ComputeProduct *******************
+ */
+
+template< class TValue >
+void
+ParallelMatrixProducts< TValue >
+::ComputeProduct( const MatrixType & A, const MatrixType & B,
+  MatrixType & C, bool useMultiThread )
+{
+  const SizeValueType numberOfBlocks = ( A.rows() + BlockSize - 1 ) / BlockSize;
+  C.set_size( A.rows(), B.cols() );
+
+  /** The rows of C are independent, so the blocks write directly into C. */
+  ProductPassStruct pass;
+  pass.st_A = &A;
+  pass.st_B = &B;
+  pass.st_C = &C;
+  if( useMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfBlocks, 1, Self::ProductRangeFunction, &pass );
+  }
+  else
+  {
+    Self::ProductRangeFunction( &pass, 0, 0, numberOfBlocks );
+  }
+
+} // end ComputeProduct()
+
+
+/**
+ * ***************** TransposeProductRangeFunction *****************
+ */
+
+template< class TValue >
+void
+ParallelMatrixProducts< TValue >
+::TransposeProductRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  ProductPassStruct * pass = static_cast< ProductPassStruct * >( userData );
+  const MatrixType &  A    = *pass->st_A;
+  const unsigned int  G    = A.cols();
+
+  for( SizeValueType b = begin; b < end; ++b )
+  {
+    const SizeValueType rowBegin = b * BlockSize;
+    const SizeValueType rowEnd   = std::min< SizeValueType >( rowBegin + BlockSize, A.rows() );
+
+    std::vector< ValueType > & partial = pass->st_BlockResults[ b ];
+    partial.assign( G * G, NumericTraits< ValueType >::Zero );
+
+#ifdef ELASTIX_USE_EIGEN
+    /** Wrap the row-major vnl data in Eigen jackets. */
+    typedef Eigen::Matrix< ValueType, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor > RowMajorMatrixType;
+    Eigen::Map< const RowMajorMatrixType > blockE( A[ rowBegin ], rowEnd - rowBegin, G );
+    Eigen::Map< RowMajorMatrixType >       partialE( &partial[ 0 ], G, G );
+    partialE.template selfadjointView< Eigen::Lower >().rankUpdate( blockE.transpose() );
+#else
+    for( SizeValueType i = rowBegin; i < rowEnd; ++i )
+    {
+      const ValueType * row = A[ i ];
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        const ValueType   rowj = row[ j ];
+        ValueType * const pj   = &partial[ j * G ];
+        for( unsigned int k = 0; k <= j; ++k )
+        {
+          pj[ k ] += rowj * row[ k ];
+        }
+      }
+    }
+#endif
+  }
+
+} // end TransposeProductRangeFunction()
+
+
+/**
+ * ********************** ProductRangeFunction **********************
+ */
+
+template< class TValue >
+void
+ParallelMatrixProducts< TValue >
+::ProductRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  ProductPassStruct * pass = static_cast< ProductPassStruct * >( userData );
+  const MatrixType &  A    = *pass->st_A;
+  const MatrixType &  B    = *pass->st_B;
+  MatrixType &        C    = *pass->st_C;
+  const unsigned int  G    = A.cols();
+  const unsigned int  K    = B.cols();
+
+  for( SizeValueType b = begin; b < end; ++b )
+  {
+    const SizeValueType rowBegin = b * BlockSize;
+    const SizeValueType rowEnd   = std::min< SizeValueType >( rowBegin + BlockSize, A.rows() );
+
+#ifdef ELASTIX_USE_EIGEN
+    typedef Eigen::Matrix< ValueType, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor > RowMajorMatrixType;
+    Eigen::Map< const RowMajorMatrixType > blockE( A[ rowBegin ], rowEnd - rowBegin, G );
+    Eigen::Map< const RowMajorMatrixType > BE( B.data_block(), G, K );
+    Eigen::Map< RowMajorMatrixType >       CE( C[ rowBegin ], rowEnd - rowBegin, K );
+    CE.noalias() = blockE * BE;
+#else
+    for( SizeValueType i = rowBegin; i < rowEnd; ++i )
+    {
+      const ValueType * row  = A[ i ];
+      ValueType *       crow = C[ i ];
+      for( unsigned int k = 0; k < K; ++k )
+      {
+        crow[ k ] = NumericTraits< ValueType >::Zero;
+      }
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        const ValueType   rowj = row[ j ];
+        const ValueType * brow = B[ j ];
+        for( unsigned int k = 0; k < K; ++k )
+        {
+          crow[ k ] += rowj * brow[ k ];
+        }
+      }
+    }
+#endif
+  }
+
+} // end ProductRangeFunction()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkParallelMatrixProducts_hxx
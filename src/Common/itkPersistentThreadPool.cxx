@@ -0,0 +1,716 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkPersistentThreadPool_cxx
+#define __itkPersistentThreadPool_cxx
+
+#include "itkPersistentThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+#if defined( _WIN32 )
+#include "itkWindows.h"
+#elif defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+PersistentThreadPool::Pointer
+PersistentThreadPool
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+PersistentThreadPool
+::PersistentThreadPool()
+{
+  this->m_NumberOfThreads         = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->m_ThreadPlacement         = NoThreadPlacement;
+  this->m_WorkerThreader          = MultiThreader::New();
+  this->m_WakeUpCondition         = ConditionVariable::New();
+  this->m_DoneCondition           = ConditionVariable::New();
+  this->m_Generation              = 0;
+  this->m_NumberOfJobParticipants = 0;
+  this->m_NumberOfBusyWorkers     = 0;
+  this->m_StopWorkers             = false;
+  this->m_Busy                    = 0;
+
+  this->m_JobFunction    = NULL;
+  this->m_JobUserData    = NULL;
+  this->m_JobGrainSize   = 1;
+  this->m_WorkRanges     = NULL;
+  this->m_WorkRangesSize = 0;
+
+  this->m_ExceptionOccurred = 0;
+
+  this->StartWorkers();
+
+} // end Constructor
+
+
+/**
+ * ****************** Destructor *********************************
+ */
+
+PersistentThreadPool
+::~PersistentThreadPool()
+{
+  this->StopWorkers();
+  delete[] this->m_WorkRanges;
+
+} // end Destructor
+
+
+/**
+ * ****************** SetNumberOfThreads *********************************
+ */
+
+void
+PersistentThreadPool
+::SetNumberOfThreads( ThreadIdType numberOfThreads )
+{
+  /** The MultiThreader cannot spawn more than ITK_MAX_THREADS threads. */
+  numberOfThreads = std::max( numberOfThreads, static_cast< ThreadIdType >( 1 ) );
+  numberOfThreads = std::min( numberOfThreads, static_cast< ThreadIdType >( ITK_MAX_THREADS ) );
+  if( numberOfThreads == this->m_NumberOfThreads )
+  {
+    return;
+  }
+
+  this->ClaimForRestart();
+  this->StopWorkers();
+  this->m_NumberOfThreads = numberOfThreads;
+  this->StartWorkers();
+  --this->m_Busy;
+  this->Modified();
+
+} // end SetNumberOfThreads()
+
+
+/**
+ * ****************** SetThreadPlacement *********************************
+ */
+
+void
+PersistentThreadPool
+::SetThreadPlacement( ThreadPlacementType placement )
+{
+  if( placement == this->m_ThreadPlacement )
+  {
+    return;
+  }
+
+  this->ClaimForRestart();
+  this->StopWorkers();
+  this->m_ThreadPlacement = placement;
+  this->StartWorkers();
+  --this->m_Busy;
+  this->Modified();
+
+} // end SetThreadPlacement()
+
+
+/**
+ * ****************** ClaimForRestart *********************************
+ */
+
+void
+PersistentThreadPool
+::ClaimForRestart( void )
+{
+  /** A running job still uses the workers, and jobs submitted during the
+   * restart run serially, as for a nested submission.
+   */
+  if( ++this->m_Busy != 1 )
+  {
+    --this->m_Busy;
+    itkExceptionMacro( << "The workers cannot be restarted while a job is running." );
+  }
+
+} // end ClaimForRestart()
+
+
+/**
+ * ****************** SetThreadPlacement *********************************
+ */
+
+bool
+PersistentThreadPool
+::SetThreadPlacement( const std::string & placement )
+{
+  if( placement == "none" )
+  {
+    this->SetThreadPlacement( NoThreadPlacement );
+  }
+  else if( placement == "compact" )
+  {
+    this->SetThreadPlacement( CompactThreadPlacement );
+  }
+  else if( placement == "scatter" )
+  {
+    this->SetThreadPlacement( ScatterThreadPlacement );
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+
+} // end SetThreadPlacement()
+
+
+/**
+ * ****************** GetProcessorTopology *********************************
+ */
+
+PersistentThreadPool::ProcessorTopologyType
+PersistentThreadPool
+::GetProcessorTopology( void )
+{
+  ProcessorTopologyType topology;
+
+#if defined( __linux__ )
+  /** Every node lists its processors as ranges, e.g. "0-7,16-23". */
+  for( unsigned int node = 0; ; ++node )
+  {
+    std::ostringstream fileName;
+    fileName << "/sys/devices/system/node/node" << node << "/cpulist";
+    std::ifstream file( fileName.str().c_str() );
+    if( !file.is_open() )
+    {
+      break;
+    }
+
+    std::vector< unsigned int > processors;
+    std::string                 range;
+    while( std::getline( file, range, ',' ) )
+    {
+      unsigned int       first = 0;
+      unsigned int       last  = 0;
+      char               dash  = 0;
+      std::istringstream rangeStream( range );
+      if( !( rangeStream >> first ) )
+      {
+        continue;
+      }
+      last = ( rangeStream >> dash >> last && dash == '-' ) ? last : first;
+      for( unsigned int p = first; p <= last; ++p )
+      {
+        processors.push_back( p );
+      }
+    }
+    if( !processors.empty() )
+    {
+      topology.push_back( processors );
+    }
+  }
+#endif
+
+  /** Fall back to a single node with all processors. */
+  if( topology.empty() )
+  {
+    std::vector< unsigned int > processors;
+    const ThreadIdType          numberOfProcessors = MultiThreader::GetGlobalDefaultNumberOfThreadsByPlatform();
+    for( unsigned int p = 0; p < numberOfProcessors; ++p )
+    {
+      processors.push_back( p );
+    }
+    topology.push_back( processors );
+  }
+
+  return topology;
+
+} // end GetProcessorTopology()
+
+
+/**
+ * ****************** ComputeProcessorAssignment *********************************
+ */
+
+void
+PersistentThreadPool
+::ComputeProcessorAssignment( void )
+{
+  this->m_ProcessorAssignment.clear();
+  if( this->m_ThreadPlacement == NoThreadPlacement )
+  {
+    return;
+  }
+
+  /** Order the processors: node by node, or round-robin over the nodes. */
+  const ProcessorTopologyType topology = GetProcessorTopology();
+  std::vector< unsigned int > order;
+  if( this->m_ThreadPlacement == CompactThreadPlacement )
+  {
+    for( std::size_t n = 0; n < topology.size(); ++n )
+    {
+      order.insert( order.end(), topology[ n ].begin(), topology[ n ].end() );
+    }
+  }
+  else
+  {
+    for( std::size_t i = 0; order.size() < this->m_NumberOfThreads; ++i )
+    {
+      bool added = false;
+      for( std::size_t n = 0; n < topology.size(); ++n )
+      {
+        if( i < topology[ n ].size() )
+        {
+          order.push_back( topology[ n ][ i ] );
+          added = true;
+        }
+      }
+      if( !added )
+      {
+        break;
+      }
+    }
+  }
+
+  /** More threads than processors wrap around. */
+  for( ThreadIdType p = 0; p < this->m_NumberOfThreads && !order.empty(); ++p )
+  {
+    this->m_ProcessorAssignment.push_back( order[ p % order.size() ] );
+  }
+
+} // end ComputeProcessorAssignment()
+
+
+/**
+ * ****************** PinCurrentThread *********************************
+ */
+
+bool
+PersistentThreadPool
+::PinCurrentThread( unsigned int processor )
+{
+#if defined( _WIN32 )
+  if( processor >= 8 * sizeof( DWORD_PTR ) )
+  {
+    return false;
+  }
+  const DWORD_PTR mask = static_cast< DWORD_PTR >( 1 ) << processor;
+  return SetThreadAffinityMask( GetCurrentThread(), mask ) != 0;
+#elif defined( __linux__ )
+  if( processor >= CPU_SETSIZE )
+  {
+    return false;
+  }
+  cpu_set_t processorSet;
+  CPU_ZERO( &processorSet );
+  CPU_SET( processor, &processorSet );
+  return pthread_setaffinity_np( pthread_self(), sizeof( cpu_set_t ), &processorSet ) == 0;
+#else
+  (void)processor;
+  return false;
+#endif
+
+} // end PinCurrentThread()
+
+
+/**
+ * ****************** StartWorkers *********************************
+ */
+
+void
+PersistentThreadPool
+::StartWorkers( void )
+{
+  /** Allocate the work ranges; one for every participant. */
+  if( this->m_WorkRangesSize != this->m_NumberOfThreads )
+  {
+    delete[] this->m_WorkRanges;
+    this->m_WorkRanges     = new AlignedWorkRangeStruct[ this->m_NumberOfThreads ];
+    this->m_WorkRangesSize = this->m_NumberOfThreads;
+  }
+
+  /** Determine where the workers run. */
+  this->ComputeProcessorAssignment();
+
+  /** The calling thread is participant 0, so we need one worker less. */
+  const ThreadIdType numberOfWorkers = this->m_NumberOfThreads - 1;
+  this->m_StopWorkers = false;
+  this->m_WorkerData.resize( numberOfWorkers );
+  this->m_WorkerThreadIds.resize( numberOfWorkers );
+
+  /** The initial generation is passed to the worker, so that a job that is
+   * submitted before the worker started waiting is not missed.
+   */
+  for( ThreadIdType i = 0; i < numberOfWorkers; ++i )
+  {
+    this->m_WorkerData[ i ].m_Pool              = this;
+    this->m_WorkerData[ i ].m_WorkerId          = i;
+    this->m_WorkerData[ i ].m_InitialGeneration = this->m_Generation;
+    this->m_WorkerThreadIds[ i ]                = this->m_WorkerThreader->SpawnThread(
+      this->WorkerCallback, &this->m_WorkerData[ i ] );
+  }
+
+} // end StartWorkers()
+
+
+/**
+ * ****************** StopWorkers *********************************
+ */
+
+void
+PersistentThreadPool
+::StopWorkers( void )
+{
+  this->m_Mutex.Lock();
+  this->m_StopWorkers = true;
+  this->m_WakeUpCondition->Broadcast();
+  this->m_Mutex.Unlock();
+
+  /** TerminateThread() joins the worker. */
+  for( std::size_t i = 0; i < this->m_WorkerThreadIds.size(); ++i )
+  {
+    this->m_WorkerThreader->TerminateThread( this->m_WorkerThreadIds[ i ] );
+  }
+  this->m_WorkerThreadIds.clear();
+  this->m_WorkerData.clear();
+
+} // end StopWorkers()
+
+
+/**
+ * ****************** WorkerCallback *********************************
+ */
+
+ITK_THREAD_RETURN_TYPE
+PersistentThreadPool
+::WorkerCallback( void * arg )
+{
+  ThreadInfoType *       infoStruct    = static_cast< ThreadInfoType * >( arg );
+  WorkerStruct *         worker        = static_cast< WorkerStruct * >( infoStruct->UserData );
+  PersistentThreadPool * pool          = worker->m_Pool;
+  const ThreadIdType     participantId = worker->m_WorkerId + 1;
+  SizeValueType          generation    = worker->m_InitialGeneration;
+
+  /** Pin the worker before it touches any memory of a job, so that the
+   * per-thread buffers it allocates end up on its own node.
+   */
+  if( participantId < pool->m_ProcessorAssignment.size() )
+  {
+    PinCurrentThread( pool->m_ProcessorAssignment[ participantId ] );
+  }
+
+  pool->m_Mutex.Lock();
+  while( true )
+  {
+    /** Sleep until there is a new job that needs this worker. */
+    while( !pool->m_StopWorkers
+      && ( pool->m_Generation == generation || participantId >= pool->m_NumberOfJobParticipants ) )
+    {
+      pool->m_WakeUpCondition->Wait( &pool->m_Mutex );
+    }
+    if( pool->m_StopWorkers )
+    {
+      break;
+    }
+    generation = pool->m_Generation;
+    pool->m_Mutex.Unlock();
+
+    pool->ProcessJob( participantId );
+
+    /** Report back; the last worker wakes up the submitting thread. */
+    pool->m_Mutex.Lock();
+    --pool->m_NumberOfBusyWorkers;
+    if( pool->m_NumberOfBusyWorkers == 0 )
+    {
+      pool->m_DoneCondition->Signal();
+    }
+  }
+  pool->m_Mutex.Unlock();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end WorkerCallback()
+
+
+/**
+ * ****************** ParallelFor *********************************
+ */
+
+void
+PersistentThreadPool
+::ParallelFor( SizeValueType numberOfItems, SizeValueType grainSize,
+  RangeFunctionType function, void * userData )
+{
+  if( numberOfItems == 0 )
+  {
+    return;
+  }
+
+  /** Determine the number of participants, and check if we can use the workers. */
+  const ThreadIdType numberOfParticipants = static_cast< ThreadIdType >(
+    std::min( static_cast< SizeValueType >( this->m_NumberOfThreads ), numberOfItems ) );
+  bool runSerial = numberOfParticipants < 2;
+  if( !runSerial && ++this->m_Busy != 1 )
+  {
+    /** Nested or concurrent submission. */
+    --this->m_Busy;
+    runSerial = true;
+  }
+
+  if( runSerial )
+  {
+    function( userData, 0, 0, numberOfItems );
+    return;
+  }
+
+  /** Choose a chunk size that gives every participant a few chunks. */
+  if( grainSize == 0 )
+  {
+    grainSize = std::max( numberOfItems / ( 4 * numberOfParticipants ),
+      static_cast< SizeValueType >( 1 ) );
+  }
+
+  /** Set up the job. No lock is needed here, since the workers only read
+   * these variables after acquiring the mutex below.
+   */
+  this->m_JobFunction       = function;
+  this->m_JobUserData       = userData;
+  this->m_JobGrainSize      = static_cast< CursorValueType >( grainSize );
+  this->m_ExceptionOccurred = 0;
+  for( ThreadIdType p = 0; p < numberOfParticipants; ++p )
+  {
+    this->m_WorkRanges[ p ].m_Next = static_cast< CursorValueType >( numberOfItems * p / numberOfParticipants );
+    this->m_WorkRanges[ p ].m_End  = static_cast< CursorValueType >( numberOfItems * ( p + 1 ) / numberOfParticipants );
+  }
+
+  /** Wake up the workers. */
+  this->m_Mutex.Lock();
+  this->m_NumberOfJobParticipants = numberOfParticipants;
+  this->m_NumberOfBusyWorkers     = numberOfParticipants - 1;
+  ++this->m_Generation;
+  this->m_WakeUpCondition->Broadcast();
+  this->m_Mutex.Unlock();
+
+  /** The calling thread participates as well. */
+  this->ProcessJob( 0 );
+
+  /** Wait until all workers are done. */
+  this->m_Mutex.Lock();
+  while( this->m_NumberOfBusyWorkers > 0 )
+  {
+    this->m_DoneCondition->Wait( &this->m_Mutex );
+  }
+  this->m_NumberOfJobParticipants = 0;
+  this->m_Mutex.Unlock();
+
+  --this->m_Busy;
+
+  /** Rethrow exceptions in the calling thread. */
+  if( this->m_ExceptionOccurred.load() != 0 )
+  {
+    itkExceptionMacro( << "Exception in PersistentThreadPool job: "
+                       << this->m_ExceptionDescription );
+  }
+
+} // end ParallelFor()
+
+
+/**
+ * ****************** SingleMethodExecute *********************************
+ */
+
+void
+PersistentThreadPool
+::SingleMethodExecute( ThreadIdType numberOfThreads,
+  ThreadFunctionType method, void * userData )
+{
+  SingleMethodStruct singleMethodStruct;
+  singleMethodStruct.m_Method          = method;
+  singleMethodStruct.m_UserData        = userData;
+  singleMethodStruct.m_NumberOfThreads = numberOfThreads;
+
+  /** Every thread id is a separate chunk, so that it can be stolen. */
+  this->ParallelFor( numberOfThreads, 1,
+    this->SingleMethodRangeFunction, &singleMethodStruct );
+
+} // end SingleMethodExecute()
+
+
+/**
+ * ****************** SingleMethodRangeFunction *********************************
+ */
+
+void
+PersistentThreadPool
+::SingleMethodRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  SingleMethodStruct * singleMethodStruct = static_cast< SingleMethodStruct * >( userData );
+
+  ThreadInfoType infoStruct;
+  infoStruct.NumberOfThreads = singleMethodStruct->m_NumberOfThreads;
+  infoStruct.ActiveFlag      = NULL;
+  infoStruct.UserData        = singleMethodStruct->m_UserData;
+  infoStruct.ThreadFunction  = singleMethodStruct->m_Method;
+
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    infoStruct.ThreadID = static_cast< ThreadIdType >( i );
+    singleMethodStruct->m_Method( &infoStruct );
+  }
+
+} // end SingleMethodRangeFunction()
+
+
+/**
+ * ****************** ProcessJob *********************************
+ */
+
+void
+PersistentThreadPool
+::ProcessJob( ThreadIdType participantId )
+{
+  /** First empty the own range, then steal from the others. */
+  const ThreadIdType numberOfParticipants = this->m_NumberOfJobParticipants;
+  CursorValueType    begin                = 0;
+  CursorValueType    end                  = 0;
+  for( ThreadIdType k = 0; k < numberOfParticipants; ++k )
+  {
+    const ThreadIdType owner = ( participantId + k ) % numberOfParticipants;
+    while( this->ClaimChunk( owner, begin, end ) )
+    {
+      /** After an exception the remaining chunks are only drained. */
+      if( this->m_ExceptionOccurred.load() != 0 )
+      {
+        continue;
+      }
+
+      try
+      {
+        this->m_JobFunction( this->m_JobUserData, participantId,
+          static_cast< SizeValueType >( begin ), static_cast< SizeValueType >( end ) );
+      }
+      catch( ExceptionObject & excp )
+      {
+        this->StoreException( excp.GetDescription() );
+      }
+      catch( std::exception & excp )
+      {
+        this->StoreException( excp.what() );
+      }
+      catch( ... )
+      {
+        this->StoreException( "Unknown exception" );
+      }
+    }
+  }
+
+} // end ProcessJob()
+
+
+/**
+ * ****************** ClaimChunk *********************************
+ */
+
+bool
+PersistentThreadPool
+::ClaimChunk( ThreadIdType owner, CursorValueType & begin, CursorValueType & end )
+{
+  AlignedWorkRangeStruct & range    = this->m_WorkRanges[ owner ];
+  const CursorValueType    rangeEnd = range.m_End;
+
+  /** Cheap check first, to avoid needless atomic updates of an empty range. */
+  if( range.m_Next.load() >= rangeEnd )
+  {
+    return false;
+  }
+
+  end   = ( range.m_Next += this->m_JobGrainSize );
+  begin = end - this->m_JobGrainSize;
+  if( begin >= rangeEnd )
+  {
+    return false;
+  }
+  end = std::min( end, rangeEnd );
+  return true;
+
+} // end ClaimChunk()
+
+
+/**
+ * ****************** StoreException *********************************
+ */
+
+void
+PersistentThreadPool
+::StoreException( const std::string & description )
+{
+  this->m_ExceptionMutex.Lock();
+  if( this->m_ExceptionOccurred.load() == 0 )
+  {
+    this->m_ExceptionDescription = description;
+    this->m_ExceptionOccurred    = 1;
+  }
+  this->m_ExceptionMutex.Unlock();
+
+} // end StoreException()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+PersistentThreadPool
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+  os << indent << "NumberOfWorkers: " << this->m_WorkerThreadIds.size() << std::endl;
+  os << indent << "ThreadPlacement: " << this->m_ThreadPlacement << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPersistentThreadPool_cxx
@@ -0,0 +1,266 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkPersistentThreadPool_h
+#define __itkPersistentThreadPool_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkMultiThreader.h"
+#include "itkSimpleMutexLock.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkConditionVariable.h"
+#include "itkAtomicInt.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class PersistentThreadPool
+ *
+ * \brief An elastix-wide pool of worker threads that stay alive for the whole run.
+ *
+ * The itk::MultiThreader spawns and joins its threads for every call to
+ * SingleMethodExecute(). In elastix this happens several times per iteration
+ * (metric value and derivative, derivative accumulation, the optimizer step),
+ * which for thousands of iterations and many cores becomes a visible cost.
+ * This class keeps its workers sleeping on a condition variable in between
+ * jobs, so that launching a job only costs a wake-up.
+ *
+ * Work is distributed as follows. The items of a job are divided in contiguous
+ * ranges, one per participant (the workers plus the calling thread). Every
+ * participant claims chunks from its own range, and when it runs out of work
+ * it steals chunks from the ranges of the other participants. This way an
+ * uneven split does not leave threads idle.
+ *
+ * Two interfaces are provided:
+ * \li SingleMethodExecute(): a drop-in replacement of the MultiThreader
+ *   function with the same name. The method is called once for every thread id
+ *   in [0, numberOfThreads), with a ThreadInfoStruct as argument. Existing
+ *   threader callbacks can therefore be used unchanged.
+ * \li ParallelFor(): calls a range function for chunks of [0, numberOfItems).
+ *
+ * Calls are not nested: if a job is submitted while another job is running
+ * (e.g. from within a task, or from a second thread) it is executed serially
+ * by the calling thread.
+ *
+ * On machines with several NUMA nodes (sockets) the workers can be pinned to
+ * processors, see SetThreadPlacement(). CompactThreadPlacement fills the
+ * processors of one node before using the next one, so that a small number of
+ * threads shares one memory controller and cache. ScatterThreadPlacement
+ * distributes the workers round-robin over the nodes, to use the memory
+ * bandwidth of all sockets. The calling thread, participant 0, is never
+ * pinned, since the threads it creates later would inherit its affinity.
+ * Pinning is supported on Linux and Windows; elsewhere it is ignored.
+ *
+ * The pool is a singleton, obtained via GetInstance(). By default the number
+ * of threads is MultiThreader::GetGlobalDefaultNumberOfThreads().
+ *
+ * \ingroup Multithreading
+ */
+
+class PersistentThreadPool : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef PersistentThreadPool       Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( PersistentThreadPool, Object );
+
+  /** Typedefs. */
+  typedef MultiThreader::ThreadFunctionType ThreadFunctionType;
+  typedef MultiThreader::ThreadInfoStruct   ThreadInfoType;
+
+  /** The function type used by ParallelFor(). It processes the items in the
+   * range [begin, end). The participantId is unique among the threads that
+   * are concurrently executing the job and smaller than GetNumberOfThreads().
+   */
+  typedef void (* RangeFunctionType)( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** The placement of the worker threads on the processors. */
+  typedef enum {
+    NoThreadPlacement,
+    CompactThreadPlacement,
+    ScatterThreadPlacement
+  } ThreadPlacementType;
+
+  /** The processors of every NUMA node. */
+  typedef std::vector< std::vector< unsigned int > > ProcessorTopologyType;
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** Set the number of threads that execute a job, including the calling thread.
+   * Workers are (re)started when the number changes. Throws an exception when
+   * it is called while a job is running, e.g. from within a task.
+   */
+  virtual void SetNumberOfThreads( ThreadIdType numberOfThreads );
+  itkGetConstMacro( NumberOfThreads, ThreadIdType );
+
+  /** Set the placement of the workers. Workers are restarted when the
+   * placement changes, which is not allowed while a job is running.
+   * Default: NoThreadPlacement.
+   */
+  virtual void SetThreadPlacement( ThreadPlacementType placement );
+  itkGetConstMacro( ThreadPlacement, ThreadPlacementType );
+
+  /** Set the placement by name: "none", "compact" or "scatter".
+   * Returns false for an unknown name.
+   */
+  bool SetThreadPlacement( const std::string & placement );
+
+  /** Returns the processors of every NUMA node. On Linux the topology is read
+   * from /sys/devices/system/node; elsewhere, or if that fails, all processors
+   * are assumed to belong to one node.
+   */
+  static ProcessorTopologyType GetProcessorTopology( void );
+
+  /** Execute the method for every thread id in [0, numberOfThreads).
+   * The method receives a ThreadInfoStruct, with ThreadID, NumberOfThreads and
+   * UserData set, just like callbacks launched by the MultiThreader.
+   * Exceptions thrown by the method are rethrown in the calling thread.
+   */
+  void SingleMethodExecute( ThreadIdType numberOfThreads,
+    ThreadFunctionType method, void * userData );
+
+  /** Call the range function for chunks of at most grainSize items, that
+   * together cover [0, numberOfItems). A grainSize of zero selects a chunk
+   * size that gives each participant a few chunks to be stolen.
+   */
+  void ParallelFor( SizeValueType numberOfItems, SizeValueType grainSize,
+    RangeFunctionType function, void * userData );
+
+protected:
+
+  PersistentThreadPool();
+  virtual ~PersistentThreadPool();
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  PersistentThreadPool( const Self & ); // purposely not implemented
+  void operator=( const Self & );       // purposely not implemented
+
+  /** Typedefs for the work ranges. */
+  typedef OffsetValueType              CursorValueType;
+  typedef AtomicInt< CursorValueType >  CursorType;
+
+  /** The range of work items owned by a participant; padded to occupy its own
+   * cache line, since the cursor is updated by several threads.
+   */
+  struct WorkRangeStruct
+  {
+    CursorType      m_Next;
+    CursorValueType m_End;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, WorkRangeStruct, PaddedWorkRangeStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedWorkRangeStruct, AlignedWorkRangeStruct );
+
+  /** The data passed to a worker thread. */
+  struct WorkerStruct
+  {
+    PersistentThreadPool * m_Pool;
+    ThreadIdType           m_WorkerId;
+    SizeValueType          m_InitialGeneration;
+  };
+
+  /** The data of SingleMethodExecute(), passed to ParallelFor(). */
+  struct SingleMethodStruct
+  {
+    ThreadFunctionType m_Method;
+    void *             m_UserData;
+    ThreadIdType       m_NumberOfThreads;
+  };
+
+  /** Start and stop the worker threads. */
+  void StartWorkers( void );
+  void StopWorkers( void );
+
+  /** Claim the pool for a restart of the workers. Throws an exception when
+   * a job is running; the claim is released with --m_Busy.
+   */
+  void ClaimForRestart( void );
+
+  /** Determine the processor of every participant, according to the placement. */
+  void ComputeProcessorAssignment( void );
+
+  /** Pin the calling thread to a processor; returns false if not supported. */
+  static bool PinCurrentThread( unsigned int processor );
+
+  /** The loop executed by the worker threads. */
+  static ITK_THREAD_RETURN_TYPE WorkerCallback( void * arg );
+
+  /** Range function that calls a SingleMethodExecute() method per item. */
+  static void SingleMethodRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Process chunks of the current job, starting with the own range. */
+  void ProcessJob( ThreadIdType participantId );
+
+  /** Claim a chunk from the range of a participant; returns false if empty. */
+  bool ClaimChunk( ThreadIdType owner, CursorValueType & begin, CursorValueType & end );
+
+  /** Store the description of an exception thrown by a task. */
+  void StoreException( const std::string & description );
+
+  /** Member variables. */
+  ThreadIdType                m_NumberOfThreads;
+  ThreadPlacementType         m_ThreadPlacement;
+  MultiThreader::Pointer      m_WorkerThreader;
+  std::vector< ThreadIdType > m_WorkerThreadIds;
+  std::vector< WorkerStruct > m_WorkerData;
+  std::vector< unsigned int > m_ProcessorAssignment;
+
+  /** Synchronization between the submitting thread and the workers. */
+  SimpleMutexLock            m_Mutex;
+  ConditionVariable::Pointer m_WakeUpCondition;
+  ConditionVariable::Pointer m_DoneCondition;
+  SizeValueType              m_Generation;
+  ThreadIdType               m_NumberOfJobParticipants;
+  ThreadIdType               m_NumberOfBusyWorkers;
+  bool                       m_StopWorkers;
+  CursorType                 m_Busy;
+
+  /** The current job. */
+  RangeFunctionType          m_JobFunction;
+  void *                     m_JobUserData;
+  CursorValueType            m_JobGrainSize;
+  AlignedWorkRangeStruct *   m_WorkRanges;
+  ThreadIdType               m_WorkRangesSize;
+
+  /** Exception handling. The flag is written by the workers, and read
+   * without the mutex by the others, hence atomic.
+   */
+  SimpleFastMutexLock        m_ExceptionMutex;
+  AtomicInt< int >           m_ExceptionOccurred;
+  std::string                m_ExceptionDescription;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPersistentThreadPool_h
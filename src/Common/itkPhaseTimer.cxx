@@ -0,0 +1,342 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef __itkPhaseTimer_cxx
+#define __itkPhaseTimer_cxx
+
+#include "itkPhaseTimer.h"
+
+#include <itksys/SystemTools.hxx>
+#include <algorithm>
+#include <iomanip>
+
+namespace itk
+{
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+PhaseTimerRegistry::Pointer
+PhaseTimerRegistry
+::GetInstance( void )
+{
+  static SimpleFastMutexLock instanceMutex;
+  static Pointer             instance;
+
+  instanceMutex.Lock();
+  if( instance.IsNull() )
+  {
+    instance = new Self;
+    instance->UnRegister();
+  }
+  instanceMutex.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+PhaseTimerRegistry
+::PhaseTimerRegistry()
+{
+  this->m_TraceEnabled               = false;
+  this->m_MaximumNumberOfTraceEvents = 100000;
+  this->Reset();
+
+} // end Constructor
+
+
+/**
+ * ****************** SetSection *********************************
+ */
+
+void
+PhaseTimerRegistry
+::SetSection( const std::string & section )
+{
+  this->m_Lock.Lock();
+  std::size_t s = 0;
+  while( s < this->m_Sections.size() && this->m_Sections[ s ].first != section )
+  {
+    ++s;
+  }
+  if( s == this->m_Sections.size() )
+  {
+    this->m_Sections.push_back( SectionType( section, PhaseMapType() ) );
+    this->m_MemoryUsage.push_back( MemoryMapType() );
+  }
+  this->m_CurrentSection = s;
+  this->m_Lock.Unlock();
+
+} // end SetSection()
+
+
+/**
+ * ****************** AddTime *********************************
+ */
+
+void
+PhaseTimerRegistry
+::AddTime( const char * phase, const double seconds )
+{
+  this->m_Lock.Lock();
+  PhaseStatistics & statistics
+    = this->m_Sections[ this->m_CurrentSection ].second[ phase ];
+  ++statistics.Count;
+  statistics.TotalTime  += seconds;
+  statistics.MaximumTime = std::max( statistics.MaximumTime, seconds );
+  this->m_Lock.Unlock();
+
+} // end AddTime()
+
+
+/**
+ * ****************** AddSpan *********************************
+ */
+
+void
+PhaseTimerRegistry
+::AddSpan( const char * phase, const double startTime,
+  const double seconds, const ThreadIdType threadId )
+{
+  this->m_Lock.Lock();
+  PhaseStatistics & statistics
+    = this->m_Sections[ this->m_CurrentSection ].second[ phase ];
+  ++statistics.Count;
+  statistics.TotalTime  += seconds;
+  statistics.MaximumTime = std::max( statistics.MaximumTime, seconds );
+
+  if( this->m_TraceEnabled )
+  {
+    if( this->m_TraceEvents.size() < this->m_MaximumNumberOfTraceEvents )
+    {
+      TraceEventType event;
+      event.Phase     = phase;
+      event.Section   = this->m_CurrentSection;
+      event.StartTime = startTime - this->m_TraceStartTime;
+      event.Duration  = seconds;
+      event.ThreadId  = threadId;
+      this->m_TraceEvents.push_back( event );
+    }
+    else
+    {
+      ++this->m_NumberOfDroppedTraceEvents;
+    }
+  }
+  this->m_Lock.Unlock();
+
+} // end AddSpan()
+
+
+/**
+ * ****************** SetMemoryUsage *********************************
+ */
+
+void
+PhaseTimerRegistry
+::SetMemoryUsage( const std::string & component, const SizeValueType bytes )
+{
+  this->m_Lock.Lock();
+  SizeValueType & maximum = this->m_MemoryUsage[ this->m_CurrentSection ][ component ];
+  maximum = std::max( maximum, bytes );
+  this->m_Lock.Unlock();
+
+} // end SetMemoryUsage()
+
+
+/**
+ * ****************** GetNumberOfDroppedTraceEvents *********************************
+ */
+
+SizeValueType
+PhaseTimerRegistry
+::GetNumberOfDroppedTraceEvents( void ) const
+{
+  this->m_Lock.Lock();
+  const SizeValueType numberOfDroppedTraceEvents = this->m_NumberOfDroppedTraceEvents;
+  this->m_Lock.Unlock();
+
+  return numberOfDroppedTraceEvents;
+
+} // end GetNumberOfDroppedTraceEvents()
+
+
+/**
+ * ****************** GetSections *********************************
+ */
+
+PhaseTimerRegistry::SectionContainerType
+PhaseTimerRegistry
+::GetSections( void ) const
+{
+  this->m_Lock.Lock();
+  const SectionContainerType sections = this->m_Sections;
+  this->m_Lock.Unlock();
+
+  return sections;
+
+} // end GetSections()
+
+
+/**
+ * ****************** Reset *********************************
+ */
+
+void
+PhaseTimerRegistry
+::Reset( void )
+{
+  this->m_Lock.Lock();
+  this->m_Sections.clear();
+  this->m_Sections.push_back( SectionType( "Initialization", PhaseMapType() ) );
+  this->m_MemoryUsage.clear();
+  this->m_MemoryUsage.push_back( MemoryMapType() );
+  this->m_CurrentSection = 0;
+
+  /** Release the memory of the previous timeline. */
+  TraceEventContainerType().swap( this->m_TraceEvents );
+  this->m_NumberOfDroppedTraceEvents = 0;
+  this->m_TraceStartTime             = GetTime();
+  this->m_Lock.Unlock();
+
+} // end Reset()
+
+
+/**
+ * ****************** WriteJSON *********************************
+ */
+
+void
+PhaseTimerRegistry
+::WriteJSON( std::ostream & os ) const
+{
+  this->m_Lock.Lock();
+  const SectionContainerType   sections    = this->m_Sections;
+  const MemoryMapContainerType memoryUsage = this->m_MemoryUsage;
+  this->m_Lock.Unlock();
+
+  const std::streamsize precision = os.precision();
+  os << std::setprecision( 9 );
+  os << "[\n";
+  for( std::size_t s = 0; s < sections.size(); ++s )
+  {
+    os << "  {\n    \"section\": \"" << sections[ s ].first << "\",\n    \"phases\": {";
+    const PhaseMapType & phases = sections[ s ].second;
+    for( PhaseMapType::const_iterator it = phases.begin(); it != phases.end(); ++it )
+    {
+      os << ( it == phases.begin() ? "\n" : ",\n" )
+         << "      \"" << it->first << "\": { \"count\": " << it->second.Count
+         << ", \"total\": " << it->second.TotalTime
+         << ", \"max\": " << it->second.MaximumTime << " }";
+    }
+    os << ( phases.empty() ? "}" : "\n    }" );
+    const MemoryMapType & memory = memoryUsage[ s ];
+    if( !memory.empty() )
+    {
+      os << ",\n    \"memory\": {";
+      for( MemoryMapType::const_iterator it = memory.begin(); it != memory.end(); ++it )
+      {
+        os << ( it == memory.begin() ? "\n" : ",\n" )
+           << "      \"" << it->first << "\": " << it->second;
+      }
+      os << "\n    }";
+    }
+    os << "\n";
+    os << ( s + 1 < sections.size() ? "  },\n" : "  }\n" );
+  }
+  os << "]\n";
+  os.precision( precision );
+
+} // end WriteJSON()
+
+
+/**
+ * ****************** WriteTrace *********************************
+ */
+
+void
+PhaseTimerRegistry
+::WriteTrace( std::ostream & os ) const
+{
+  this->m_Lock.Lock();
+  const TraceEventContainerType events                     = this->m_TraceEvents;
+  const SectionContainerType    sections                   = this->m_Sections;
+  const SizeValueType           numberOfDroppedTraceEvents = this->m_NumberOfDroppedTraceEvents;
+  this->m_Lock.Unlock();
+
+  /** The trace event format expects the times in microseconds. */
+  const std::streamsize precision = os.precision();
+  const std::ios::fmtflags flags  = os.flags();
+  os << std::fixed << std::setprecision( 3 );
+  os << "{\n  \"displayTimeUnit\": \"ms\",\n"
+     << "  \"otherData\": { \"droppedEvents\": " << numberOfDroppedTraceEvents << " },\n"
+     << "  \"traceEvents\": [";
+  for( std::size_t e = 0; e < events.size(); ++e )
+  {
+    const TraceEventType & event = events[ e ];
+    os << ( e == 0 ? "\n" : ",\n" )
+       << "    { \"name\": \"" << event.Phase
+       << "\", \"cat\": \"" << sections[ event.Section ].first
+       << "\", \"ph\": \"X\", \"ts\": " << event.StartTime * 1e6
+       << ", \"dur\": " << event.Duration * 1e6
+       << ", \"pid\": 0, \"tid\": " << event.ThreadId << " }";
+  }
+  os << ( events.empty() ? "]\n}\n" : "\n  ]\n}\n" );
+  os.flags( flags );
+  os.precision( precision );
+
+} // end WriteTrace()
+
+
+/**
+ * ****************** GetTime *********************************
+ */
+
+double
+PhaseTimerRegistry
+::GetTime( void )
+{
+  return itksys::SystemTools::GetTime();
+
+} // end GetTime()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+PhaseTimerRegistry
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Phases: " << std::endl;
+  this->WriteJSON( os );
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPhaseTimer_cxx
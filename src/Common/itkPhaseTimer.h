@@ -0,0 +1,267 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkPhaseTimer_h
+#define __itkPhaseTimer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/** \class PhaseTimerRegistry
+ *
+ * \brief Aggregates the wall clock time spent in the phases of a
+ * registration, such as the sampler update, the metric evaluation and the
+ * optimizer step.
+ *
+ * The times are measured by ScopedPhaseTimer objects, which are created by
+ * the itkPhaseTimerMacro. They are aggregated per phase name, within the
+ * current section, e.g. a resolution. Phases may be nested; the time of a
+ * phase then includes the time of the phases inside it. Phases that run in
+ * each thread of a multi-threaded method are counted once per thread.
+ *
+ * The registry also holds the memory usage per component, see
+ * SetMemoryUsage(), so that it is written together with the times.
+ *
+ * The statistics can be written in JSON format, see WriteJSON().
+ *
+ * Optionally, the registry also records a timeline of the individual spans,
+ * with the thread they ran in, see SetTraceEnabled(). Only the spans that are
+ * timed via the itkPhaseTimerThreadMacro are recorded, i.e. the per-thread
+ * work of the multi-threaded methods. The timeline can be written in the
+ * Chrome trace event format, see WriteTrace(), and shows the load imbalance
+ * between the threads and the serial parts in between. The number of
+ * recorded spans is bounded; the spans after that are only aggregated.
+ *
+ * The registry is a singleton, obtained via GetInstance().
+ * All methods are thread safe.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class PhaseTimerRegistry : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef PhaseTimerRegistry         Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( PhaseTimerRegistry, Object );
+
+  /** Get the singleton instance; it is created on first use. */
+  static Pointer GetInstance( void );
+
+  /** The statistics of one phase, the times are in seconds. */
+  struct PhaseStatistics
+  {
+    PhaseStatistics() : Count( 0 ), TotalTime( 0.0 ), MaximumTime( 0.0 ) {}
+
+    SizeValueType Count;
+    double        TotalTime;
+    double        MaximumTime;
+  };
+
+  typedef std::map< std::string, PhaseStatistics > PhaseMapType;
+  typedef std::pair< std::string, PhaseMapType >   SectionType;
+  typedef std::vector< SectionType >               SectionContainerType;
+
+  /** Starts a new section, e.g. "Resolution 0"; the next times are
+   * aggregated in it. Starting a section that already exists continues it.
+   */
+  void SetSection( const std::string & section );
+
+  /** Adds \a seconds spent in \a phase to the current section. */
+  void AddTime( const char * phase, const double seconds );
+
+  /** Adds \a seconds spent in \a phase to the current section, like
+   * AddTime(), and records the span on the timeline if the trace is enabled.
+   * \a startTime is a GetTime() value, \a phase must be a string literal.
+   */
+  void AddSpan( const char * phase, const double startTime,
+    const double seconds, const ThreadIdType threadId );
+
+  /** Records that \a component holds \a bytes in the current section. The
+   * maximum of the recorded values is kept per section.
+   */
+  void SetMemoryUsage( const std::string & component, const SizeValueType bytes );
+
+  /** Enable or disable the recording of the timeline. Default: false. */
+  itkSetMacro( TraceEnabled, bool );
+  itkGetConstMacro( TraceEnabled, bool );
+  itkBooleanMacro( TraceEnabled );
+
+  /** The maximum number of spans on the timeline. Default: 100000. */
+  itkSetMacro( MaximumNumberOfTraceEvents, SizeValueType );
+  itkGetConstMacro( MaximumNumberOfTraceEvents, SizeValueType );
+
+  /** The number of spans that did not fit on the timeline. */
+  SizeValueType GetNumberOfDroppedTraceEvents( void ) const;
+
+  /** Returns a copy of the statistics of all sections, in order. */
+  SectionContainerType GetSections( void ) const;
+
+  /** Removes all sections, statistics and spans, and starts the section
+   * "Initialization". The timeline starts at the time of the reset.
+   */
+  void Reset( void );
+
+  /** Writes the statistics in JSON format: an array of sections, each with
+   * a name and an object with the count, total and maximum time per phase,
+   * and, if recorded, an object with the bytes per component.
+   */
+  void WriteJSON( std::ostream & os ) const;
+
+  /** Writes the timeline in the Chrome trace event format, which can be
+   * opened in chrome://tracing or Perfetto. Each span is a complete event,
+   * with the thread id as tid, and the section as category.
+   */
+  void WriteTrace( std::ostream & os ) const;
+
+  /** Returns the current wall clock time in seconds. */
+  static double GetTime( void );
+
+protected:
+
+  PhaseTimerRegistry();
+  virtual ~PhaseTimerRegistry() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  PhaseTimerRegistry( const Self & ); // purposely not implemented
+  void operator=( const Self & );     // purposely not implemented
+
+  /** A span on the timeline; the times are in seconds since the reset. */
+  struct TraceEventType
+  {
+    const char * Phase;
+    std::size_t  Section;
+    double       StartTime;
+    double       Duration;
+    ThreadIdType ThreadId;
+  };
+
+  typedef std::vector< TraceEventType >          TraceEventContainerType;
+  typedef std::map< std::string, SizeValueType > MemoryMapType;
+  typedef std::vector< MemoryMapType >           MemoryMapContainerType;
+
+  SectionContainerType        m_Sections;
+  MemoryMapContainerType      m_MemoryUsage;
+  std::size_t                 m_CurrentSection;
+  bool                        m_TraceEnabled;
+  SizeValueType               m_MaximumNumberOfTraceEvents;
+  SizeValueType               m_NumberOfDroppedTraceEvents;
+  TraceEventContainerType     m_TraceEvents;
+  double                      m_TraceStartTime;
+  mutable SimpleFastMutexLock m_Lock;
+
+};
+
+/** \class ScopedPhaseTimer
+ *
+ * \brief Measures the time between its construction and destruction, and
+ * adds it to the PhaseTimerRegistry. Use the itkPhaseTimerMacro instead of
+ * creating it directly, so that the timers compile to nothing when
+ * ELASTIX_USE_PHASE_TIMERS is not defined.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class ScopedPhaseTimer
+{
+public:
+
+  /** Starts the timer of \a phase, a string literal. If \a traced is true
+   * the span is also recorded on the timeline, as run by thread \a threadId.
+   */
+  explicit ScopedPhaseTimer( const char * phase,
+    const bool traced = false, const ThreadIdType threadId = 0 ) :
+    m_Phase( phase ), m_Traced( traced ), m_ThreadId( threadId ),
+    m_StartTime( PhaseTimerRegistry::GetTime() )
+  {}
+
+  /** Stops the timer. */
+  ~ScopedPhaseTimer()
+  {
+    const double seconds = PhaseTimerRegistry::GetTime() - this->m_StartTime;
+    if( this->m_Traced )
+    {
+      PhaseTimerRegistry::GetInstance()->AddSpan(
+        this->m_Phase, this->m_StartTime, seconds, this->m_ThreadId );
+    }
+    else
+    {
+      PhaseTimerRegistry::GetInstance()->AddTime( this->m_Phase, seconds );
+    }
+  }
+
+
+private:
+
+  ScopedPhaseTimer( const ScopedPhaseTimer & ); // purposely not implemented
+  void operator=( const ScopedPhaseTimer & );   // purposely not implemented
+
+  const char * m_Phase;
+  bool         m_Traced;
+  ThreadIdType m_ThreadId;
+  double       m_StartTime;
+
+};
+
+} // end namespace itk
+
+/** itkPhaseTimerMacro times the rest of the enclosing scope as the phase
+ * \a phase, a string literal. itkPhaseTimerThreadMacro does the same for
+ * the per-thread work of thread \a threadId, which is also recorded on the
+ * timeline. itkPhaseTimeMacro adds a time that was measured otherwise, and
+ * itkPhaseTimerSectionMacro starts a section.
+ * They compile to nothing if ELASTIX_USE_PHASE_TIMERS is not defined.
+ */
+#ifdef ELASTIX_USE_PHASE_TIMERS
+#define itkPhaseTimerConcatenateMacro2( a, b ) a##b
+#define itkPhaseTimerConcatenateMacro( a, b ) itkPhaseTimerConcatenateMacro2( a, b )
+#define itkPhaseTimerMacro( phase ) \
+  ::itk::ScopedPhaseTimer itkPhaseTimerConcatenateMacro( phaseTimer, __LINE__ )( phase )
+#define itkPhaseTimerThreadMacro( phase, threadId ) \
+  ::itk::ScopedPhaseTimer itkPhaseTimerConcatenateMacro( phaseTimer, __LINE__ )( phase, true, threadId )
+#define itkPhaseTimeMacro( phase, seconds ) \
+  ::itk::PhaseTimerRegistry::GetInstance()->AddTime( phase, seconds )
+#define itkPhaseTimerSectionMacro( section ) \
+  ::itk::PhaseTimerRegistry::GetInstance()->SetSection( section )
+#else
+#define itkPhaseTimerMacro( phase )
+#define itkPhaseTimerThreadMacro( phase, threadId )
+#define itkPhaseTimeMacro( phase, seconds )
+#define itkPhaseTimerSectionMacro( section )
+#endif
+
+#endif // end #ifndef __itkPhaseTimer_h
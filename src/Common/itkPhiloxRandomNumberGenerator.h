@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkPhiloxRandomNumberGenerator_h
+#define __itkPhiloxRandomNumberGenerator_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class PhiloxRandomNumberGenerator
+ *
+ * \brief A counter-based random number generator (Philox4x32-10).
+ *
+ * Unlike the Mersenne Twister, this generator has no state that advances
+ * with every draw. A block of four random 32 bit words is a pure function of
+ * a key and a counter:
+ *
+ *   random = Philox( key, counter ),
+ *
+ * where the key (two words) is set in the constructor and the counter (four
+ * words) is supplied for every draw. Random numbers can therefore be generated
+ * in any order, by any number of threads, and the result only depends on the
+ * key and the counters that were used. For example, an image sampler can use
+ * key = ( seed, update ) and counter = ( sample index, attempt ), which makes
+ * the selected samples independent of the number of threads.
+ *
+ * The implementation follows:
+ *
+ * J.K. Salmon, M.A. Moraes, R.O. Dror, D.E. Shaw,
+ * "Parallel random numbers: as easy as 1, 2, 3",
+ * Proceedings of the International Conference for High Performance Computing,
+ * Networking, Storage and Analysis (SC11), 2011.
+ *
+ * This is a small value class; it is cheap to copy and all member
+ * functions are const, so one instance can be shared by all threads.
+ *
+ * \ingroup Numerics
+ */
+
+class PhiloxRandomNumberGenerator
+{
+public:
+
+  /** Typedefs. */
+  typedef uint32_t WordType;
+  typedef uint64_t IndexType;
+
+  /** Construct a generator with key ( key0, key1 ). */
+  PhiloxRandomNumberGenerator( WordType key0 = 0, WordType key1 = 0 )
+  {
+    this->m_Key[ 0 ] = key0;
+    this->m_Key[ 1 ] = key1;
+  }
+
+
+  /** Set/Get the key. */
+  void SetKey( WordType key0, WordType key1 )
+  {
+    this->m_Key[ 0 ] = key0;
+    this->m_Key[ 1 ] = key1;
+  }
+
+
+  const WordType * GetKey( void ) const { return this->m_Key; }
+
+  /** Compute the block of four random words that belongs to counter. */
+  void Generate( const WordType counter[ 4 ], WordType result[ 4 ] ) const
+  {
+    WordType key[ 2 ] = { this->m_Key[ 0 ], this->m_Key[ 1 ] };
+
+    result[ 0 ] = counter[ 0 ]; result[ 1 ] = counter[ 1 ];
+    result[ 2 ] = counter[ 2 ]; result[ 3 ] = counter[ 3 ];
+
+    for( unsigned int round = 0; round < 10; ++round )
+    {
+      if( round > 0 )
+      {
+        key[ 0 ] += 0x9E3779B9u;
+        key[ 1 ] += 0xBB67AE85u;
+      }
+
+      const uint64_t product0 = static_cast< uint64_t >( 0xD2511F53u ) * result[ 0 ];
+      const uint64_t product1 = static_cast< uint64_t >( 0xCD9E8D57u ) * result[ 2 ];
+      const WordType hi0      = static_cast< WordType >( product0 >> 32 );
+      const WordType lo0      = static_cast< WordType >( product0 );
+      const WordType hi1      = static_cast< WordType >( product1 >> 32 );
+      const WordType lo1      = static_cast< WordType >( product1 );
+
+      result[ 0 ] = hi1 ^ result[ 1 ] ^ key[ 0 ];
+      result[ 1 ] = lo1;
+      result[ 2 ] = hi0 ^ result[ 3 ] ^ key[ 1 ];
+      result[ 3 ] = lo0;
+    }
+  }
+
+
+  /** Fill values[ 0 .. n ) with uniform random numbers in [0, 1), with 53 bits
+   * of resolution. The numbers are a function of the key, the index and the
+   * subIndex only.
+   */
+  void GetUniformVariates( IndexType index, WordType subIndex,
+    double * values, unsigned int n ) const
+  {
+    WordType counter[ 4 ];
+    counter[ 0 ] = static_cast< WordType >( index );
+    counter[ 1 ] = static_cast< WordType >( index >> 32 );
+    counter[ 2 ] = subIndex;
+
+    WordType     block[ 4 ];
+    unsigned int i = 0;
+    for( counter[ 3 ] = 0; i < n; ++counter[ 3 ] )
+    {
+      this->Generate( counter, block );
+      values[ i++ ] = ToUnitInterval( block[ 0 ], block[ 1 ] );
+      if( i < n )
+      {
+        values[ i++ ] = ToUnitInterval( block[ 2 ], block[ 3 ] );
+      }
+    }
+  }
+
+
+  /** Combine two random words into a double in [0, 1). */
+  static double ToUnitInterval( WordType a, WordType b )
+  {
+    /** Same construction as genrand_res53() of the Mersenne Twister. */
+    return ( ( a >> 5 ) * 67108864.0 + ( b >> 6 ) ) * ( 1.0 / 9007199254740992.0 );
+  }
+
+
+private:
+
+  WordType m_Key[ 2 ];
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPhiloxRandomNumberGenerator_h
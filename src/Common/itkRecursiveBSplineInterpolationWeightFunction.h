@@ -23,6 +23,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include "itkBSplinePeriodicWeightTable.h"
 
 namespace itk
 {
@@ -121,6 +122,27 @@ public:
   /** Get number of indices. */
   itkGetConstMacro( NumberOfIndices, unsigned int );
 
+  /** Typedef for the table of weights at the phases of a sample grid. */
+  typedef BSplinePeriodicWeightTable<
+    itkGetStaticConstMacro( SpaceDimension ),
+    itkGetStaticConstMacro( SplineOrder ) >  PeriodicWeightTableType;
+
+  /** Set/Get the table of weights at the phases of the sample grid. Indices
+   * at these phases get their weights from the table; other indices are
+   * evaluated as usual. Not thread safe: set it before evaluating.
+   */
+  void SetPeriodicWeightTable( const PeriodicWeightTableType & table )
+  {
+    this->m_PeriodicWeightTable = table;
+  }
+
+
+  const PeriodicWeightTableType & GetPeriodicWeightTable( void ) const
+  {
+    return this->m_PeriodicWeightTable;
+  }
+
+
   /** Evaluate the weights at specified ContinousIndex position.
    * Subclasses must provide this method. */
   virtual WeightsType Evaluate( const ContinuousIndexType & index ) const;
@@ -168,6 +190,9 @@ private:
   typename DerivativeKernelType::Pointer m_DerivativeKernel;
   typename SecondOrderDerivativeKernelType::Pointer m_SecondOrderDerivativeKernel;
 
+  /** The weights at the phases of the sample grid. */
+  PeriodicWeightTableType m_PeriodicWeightTable;
+
 };
 
 } // end namespace itk
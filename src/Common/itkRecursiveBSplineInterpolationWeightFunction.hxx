@@ -25,6 +25,8 @@
 #include "itkMath.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -102,6 +104,16 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
   typename WeightsType::ValueType * weightsPtr = &weights[ 0 ];
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    /** Copy the weights from the table, if cindex is at a phase of it. */
+    const double * tableWeights = this->m_PeriodicWeightTable.Lookup(
+      i, cindex[ i ], startIndex[ i ], PeriodicWeightTableType::Weights );
+    if( tableWeights )
+    {
+      std::copy( tableWeights, tableWeights + SplineOrder + 1, weightsPtr );
+      weightsPtr += SplineOrder + 1;
+      continue;
+    }
+
     startIndex[ i ] = Math::Floor< IndexValueType >(
       cindex[ i ] - static_cast< double >( SplineOrder - 1 ) / 2.0 );
 
@@ -127,6 +139,15 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
 {
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    const double * tableWeights = this->m_PeriodicWeightTable.LookupAtStartIndex(
+      i, cindex[ i ], startIndex[ i ], PeriodicWeightTableType::SupportDerivativeWeights );
+    if( tableWeights )
+    {
+      std::copy( tableWeights, tableWeights + SplineOrder + 1,
+        &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
     this->m_DerivativeKernel->Evaluate( x, &derivativeWeights[ i * this->m_SupportSize[ i ] ] );
   }
@@ -147,6 +168,15 @@ RecursiveBSplineInterpolationWeightFunction< TCoordRep, VSpaceDimension, VSpline
 {
   for( unsigned int i = 0; i < SpaceDimension; ++i )
   {
+    const double * tableWeights = this->m_PeriodicWeightTable.LookupAtStartIndex(
+      i, cindex[ i ], startIndex[ i ], PeriodicWeightTableType::SecondOrderDerivativeWeights );
+    if( tableWeights )
+    {
+      std::copy( tableWeights, tableWeights + SplineOrder + 1,
+        &hessianWeights[ i * this->m_SupportSize[ i ] ] );
+      continue;
+    }
+
     double x = cindex[ i ] - static_cast< double >( startIndex[ i ] );
     this->m_SecondOrderDerivativeKernel->Evaluate( x, &hessianWeights[ i * this->m_SupportSize[ i ] ] );
   }
@@ -47,6 +47,7 @@
 #include "itkMultiOrderBSplineDecompositionImageFilter.h"
 #include "itkConceptChecking.h"
 #include "itkCovariantVector.h"
+#include "itkBrickedImageBuffer.h"
 
 namespace itk
 {
@@ -80,6 +81,11 @@ namespace itk
  *               Spline is determined in all dimensions, cannot selectively
  *                  pick dimension for calculating spline.
  *
+ * When UseBrickedImageLayout is on, SetInputImage() copies the coefficients to
+ * a BrickedImageBuffer, from which they are read during the evaluation. The
+ * support region of a sample then covers fewer cache lines, which helps when
+ * the interpolator is evaluated at random positions in a large image.
+ *
  * \sa MultiOrderBSplineDecompositionImageFilter
  *
  * \ingroup ImageFunctions
@@ -190,6 +196,13 @@ public:
   itkGetConstMacro( UseImageDirection, bool );
   itkBooleanMacro( UseImageDirection );
 
+  /** Set/Get whether the coefficients are copied to a bricked memory layout.
+   * Must be set before setting the image. Default: false.
+   */
+  itkSetMacro( UseBrickedImageLayout, bool );
+  itkGetConstMacro( UseBrickedImageLayout, bool );
+  itkBooleanMacro( UseBrickedImageLayout );
+
 protected:
 
   ReducedDimensionBSplineInterpolateImageFunction();
@@ -234,6 +247,17 @@ private:
   void ApplyMirrorBoundaryConditions( vnl_matrix< long > & evaluateIndex,
     unsigned int splineOrder ) const;
 
+  /** Get a coefficient, from the bricked copy if there is one. */
+  CoefficientDataType GetCoefficient( const IndexType & index ) const
+  {
+    if( !this->m_BrickedCoefficients.IsEmpty() )
+    {
+      return this->m_BrickedCoefficients.GetValue( index );
+    }
+    return this->m_Coefficients->GetPixel( index );
+  }
+
+
   Iterator                 m_CIterator;                    // Iterator for traversing spline coefficients.
   unsigned long            m_MaxNumberInterpolationPoints; // number of neighborhood points used for interpolation
   std::vector< IndexType > m_PointsToIndex;                // Preallocation of interpolation neighborhood indicies
@@ -244,6 +268,11 @@ private:
   // derivatives.
   bool m_UseImageDirection;
 
+  // flag to copy the coefficients to a bricked memory layout, and the copy.
+  bool m_UseBrickedImageLayout;
+  BrickedImageBuffer< CoefficientDataType,
+  itkGetStaticConstMacro( ImageDimension ) > m_BrickedCoefficients;
+
 };
 
 } // namespace itk
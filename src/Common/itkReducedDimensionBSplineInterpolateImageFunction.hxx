@@ -65,6 +65,7 @@ ReducedDimensionBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoeffic
   m_Coefficients = CoefficientImageType::New();
   this->SetSplineOrder( SplineOrder );
   this->m_UseImageDirection = true;
+  this->m_UseBrickedImageLayout = false;
 }
 
 
@@ -82,6 +83,8 @@ ReducedDimensionBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoeffic
   os << indent << "Spline Order: " << m_SplineOrder << std::endl;
   os << indent << "UseImageDirection = "
      << ( this->m_UseImageDirection ? "On" : "Off" ) << std::endl;
+  os << indent << "UseBrickedImageLayout = "
+     << ( this->m_UseBrickedImageLayout ? "On" : "Off" ) << std::endl;
 
 }
 
@@ -108,10 +111,21 @@ ReducedDimensionBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoeffic
     Superclass::SetInputImage( inputData );
 
     m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+    // Copy the coefficients once, so that the evaluation reads the bricks.
+    if( this->m_UseBrickedImageLayout )
+    {
+      this->m_BrickedCoefficients.CopyFromImage( m_Coefficients.GetPointer() );
+    }
+    else
+    {
+      this->m_BrickedCoefficients.Clear();
+    }
   }
   else
   {
     m_Coefficients = NULL;
+    this->m_BrickedCoefficients.Clear();
   }
 }
 
@@ -187,7 +201,7 @@ ReducedDimensionBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoeffic
     }
     // Convert our step p to the appropriate point in ND space in the
     // m_Coefficients cube.
-    interpolated += w * m_Coefficients->GetPixel( coefficientIndex );
+    interpolated += w * this->GetCoefficient( coefficientIndex );
   }
   return ( interpolated );
 
@@ -254,7 +268,7 @@ ReducedDimensionBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoeffic
           tempValue *= weights[ n1 ][ m_PointsToIndex[ p ][ n1 ] ];
         }
       }
-      derivativeValue[ n ] += m_Coefficients->GetPixel( coefficientIndex ) * tempValue;
+      derivativeValue[ n ] += this->GetCoefficient( coefficientIndex ) * tempValue;
     }
     derivativeValue[ n ] /= spacing[ n ];  // take spacing into account
   }
@@ -0,0 +1,266 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRegistrationCheckpoint_cxx
+#define __itkRegistrationCheckpoint_cxx
+
+#include "itkRegistrationCheckpoint.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace itk
+{
+
+/** The magic number "elxCKPT\0" and the version of the format. */
+static const char         CheckpointMagic[ 8 ] = { 'e', 'l', 'x', 'C', 'K', 'P', 'T', '\0' };
+static const unsigned int CheckpointVersion    = 1;
+
+/**
+ * ****************** SetEntry *********************************
+ */
+
+void
+RegistrationCheckpoint
+::SetEntry( const std::string & name, const EntryType & values )
+{
+  this->m_Entries[ name ] = values;
+
+} // end SetEntry()
+
+
+/**
+ * ****************** SetEntry *********************************
+ */
+
+void
+RegistrationCheckpoint
+::SetEntry( const std::string & name, double value )
+{
+  this->m_Entries[ name ].assign( 1, value );
+
+} // end SetEntry()
+
+
+/**
+ * ****************** GetEntry *********************************
+ */
+
+bool
+RegistrationCheckpoint
+::GetEntry( const std::string & name, EntryType & values ) const
+{
+  EntryMapType::const_iterator it = this->m_Entries.find( name );
+  if( it == this->m_Entries.end() )
+  {
+    return false;
+  }
+  values = it->second;
+  return true;
+
+} // end GetEntry()
+
+
+/**
+ * ****************** GetEntry *********************************
+ */
+
+bool
+RegistrationCheckpoint
+::GetEntry( const std::string & name, double & value ) const
+{
+  EntryMapType::const_iterator it = this->m_Entries.find( name );
+  if( it == this->m_Entries.end() || it->second.size() != 1 )
+  {
+    return false;
+  }
+  value = it->second[ 0 ];
+  return true;
+
+} // end GetEntry()
+
+
+/**
+ * ****************** Clear *********************************
+ */
+
+void
+RegistrationCheckpoint
+::Clear( void )
+{
+  this->m_Entries.clear();
+
+} // end Clear()
+
+
+/**
+ * ****************** Serialize *********************************
+ */
+
+std::string
+RegistrationCheckpoint
+::Serialize( void ) const
+{
+  /** Layout: magic, version, number of entries, and per entry the length of
+   * the name, the name, the number of values, and the values.
+   */
+  std::string        data( CheckpointMagic, sizeof( CheckpointMagic ) );
+  const unsigned int version         = CheckpointVersion;
+  const uint64_t     numberOfEntries = this->m_Entries.size();
+  data.append( reinterpret_cast< const char * >( &version ), sizeof( version ) );
+  data.append( reinterpret_cast< const char * >( &numberOfEntries ), sizeof( numberOfEntries ) );
+
+  for( EntryMapType::const_iterator it = this->m_Entries.begin(); it != this->m_Entries.end(); ++it )
+  {
+    const uint64_t nameLength     = it->first.size();
+    const uint64_t numberOfValues = it->second.size();
+    data.append( reinterpret_cast< const char * >( &nameLength ), sizeof( nameLength ) );
+    data.append( it->first );
+    data.append( reinterpret_cast< const char * >( &numberOfValues ), sizeof( numberOfValues ) );
+    if( numberOfValues > 0 )
+    {
+      data.append( reinterpret_cast< const char * >( &it->second[ 0 ] ),
+        numberOfValues * sizeof( double ) );
+    }
+  }
+
+  return data;
+
+} // end Serialize()
+
+
+/**
+ * ****************** Deserialize *********************************
+ */
+
+void
+RegistrationCheckpoint
+::Deserialize( const std::string & data )
+{
+  std::size_t position = 0;
+  bool        valid    = true;
+
+  /** Copy the next bytes, checking that the data is long enough. */
+#define elxReadCheckpointBytes( destination, numberOfBytes ) \
+  if( valid && data.size() - position >= ( numberOfBytes ) ) \
+  { \
+    std::memcpy( destination, data.data() + position, numberOfBytes ); \
+    position += numberOfBytes; \
+  } \
+  else \
+  { \
+    valid = false; \
+  }
+
+  char         magic[ sizeof( CheckpointMagic ) ];
+  unsigned int version         = 0;
+  uint64_t     numberOfEntries = 0;
+  elxReadCheckpointBytes( magic, sizeof( magic ) );
+  if( !valid || std::memcmp( magic, CheckpointMagic, sizeof( magic ) ) != 0 )
+  {
+    itkExceptionMacro( << "ERROR: the data is not a registration checkpoint." );
+  }
+  elxReadCheckpointBytes( &version, sizeof( version ) );
+  if( !valid || version != CheckpointVersion )
+  {
+    itkExceptionMacro( << "ERROR: the registration checkpoint has version " << version
+                       << ", while version " << CheckpointVersion << " is supported." );
+  }
+  elxReadCheckpointBytes( &numberOfEntries, sizeof( numberOfEntries ) );
+
+  EntryMapType entries;
+  for( uint64_t i = 0; valid && i < numberOfEntries; ++i )
+  {
+    uint64_t nameLength     = 0;
+    uint64_t numberOfValues = 0;
+    elxReadCheckpointBytes( &nameLength, sizeof( nameLength ) );
+    if( !valid || nameLength > data.size() - position )
+    {
+      valid = false;
+      break;
+    }
+    const std::string name = data.substr( position, nameLength );
+    position += nameLength;
+    elxReadCheckpointBytes( &numberOfValues, sizeof( numberOfValues ) );
+    if( !valid || numberOfValues > ( data.size() - position ) / sizeof( double ) )
+    {
+      valid = false;
+      break;
+    }
+    EntryType & values = entries[ name ];
+    values.resize( numberOfValues );
+    if( numberOfValues > 0 )
+    {
+      elxReadCheckpointBytes( &values[ 0 ], numberOfValues * sizeof( double ) );
+    }
+  }
+
+#undef elxReadCheckpointBytes
+
+  if( !valid || position != data.size() )
+  {
+    itkExceptionMacro( << "ERROR: the registration checkpoint is truncated or corrupt." );
+  }
+  this->m_Entries.swap( entries );
+
+} // end Deserialize()
+
+
+/**
+ * ****************** ReadFile *********************************
+ */
+
+void
+RegistrationCheckpoint
+::ReadFile( const std::string & fileName )
+{
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if( !file.is_open() )
+  {
+    itkExceptionMacro( << "ERROR: the registration checkpoint \"" << fileName
+                       << "\" could not be opened." );
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  this->Deserialize( contents.str() );
+
+} // end ReadFile()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+RegistrationCheckpoint
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfEntries: " << this->m_Entries.size() << std::endl;
+  for( EntryMapType::const_iterator it = this->m_Entries.begin(); it != this->m_Entries.end(); ++it )
+  {
+    os << indent.GetNextIndent() << it->first << ": " << it->second.size() << " values" << std::endl;
+  }
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRegistrationCheckpoint_cxx
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRegistrationCheckpoint_h
+#define __itkRegistrationCheckpoint_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class RegistrationCheckpoint
+ *
+ * \brief The state of a registration, to continue it after an interruption.
+ *
+ * A checkpoint is a set of named entries, each a vector of doubles: e.g. the
+ * current resolution and iteration, the transform parameters, and the
+ * internal state of the optimizer and the image sampler. Doubles represent
+ * the integers of such a state exactly up to 2^53.
+ *
+ * Serialize() converts the entries to a binary string, which starts with a
+ * magic number and a format version, followed by the entries sorted by name.
+ * The numbers are stored in the byte order of the machine, so a checkpoint
+ * is meant to be resumed on the same kind of machine. Deserialize() and
+ * ReadFile() do the reverse, and throw when the data is not a checkpoint.
+ *
+ * \ingroup Registration
+ */
+
+class RegistrationCheckpoint : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef RegistrationCheckpoint     Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( RegistrationCheckpoint, Object );
+
+  /** Typedefs. */
+  typedef std::vector< double >              EntryType;
+  typedef std::map< std::string, EntryType > EntryMapType;
+
+  /** Set an entry, replacing an existing entry with the same name. */
+  void SetEntry( const std::string & name, const EntryType & values );
+
+  /** Set an entry of a single value. */
+  void SetEntry( const std::string & name, double value );
+
+  /** Get an entry; returns false if it does not exist. */
+  bool GetEntry( const std::string & name, EntryType & values ) const;
+
+  /** Get an entry of a single value; returns false if it does not exist or
+   * does not have exactly one value.
+   */
+  bool GetEntry( const std::string & name, double & value ) const;
+
+  /** Get all entries. */
+  const EntryMapType & GetEntries( void ) const
+  {
+    return this->m_Entries;
+  }
+
+  /** Remove all entries. */
+  void Clear( void );
+
+  /** Convert the entries to a binary string. */
+  std::string Serialize( void ) const;
+
+  /** Replace the entries by those of a binary string made by Serialize(). */
+  void Deserialize( const std::string & data );
+
+  /** Replace the entries by those of a file. */
+  void ReadFile( const std::string & fileName );
+
+protected:
+
+  RegistrationCheckpoint() {}
+  virtual ~RegistrationCheckpoint() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  RegistrationCheckpoint( const Self & ); // purposely not implemented
+  void operator=( const Self & );         // purposely not implemented
+
+  EntryMapType m_Entries;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRegistrationCheckpoint_h
@@ -0,0 +1,179 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRegistrationProgress_cxx
+#define __itkRegistrationProgress_cxx
+
+#include "itkRegistrationProgress.h"
+#include "itkCommand.h"
+
+namespace itk
+{
+
+/** The object that is polled by the loops in Common. */
+static RegistrationProgress * CurrentRegistrationProgress = 0;
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+RegistrationProgress
+::RegistrationProgress()
+{
+  this->m_Callback   = 0;
+  this->m_ClientData = 0;
+  this->m_CancelRequested.store( 0 );
+
+} // end Constructor
+
+
+/**
+ * ****************** SetCallback *********************************
+ */
+
+void
+RegistrationProgress
+::SetCallback( CallbackType callback, void * clientData )
+{
+  this->m_Callback   = callback;
+  this->m_ClientData = clientData;
+
+} // end SetCallback()
+
+
+/**
+ * ****************** Report *********************************
+ */
+
+void
+RegistrationProgress
+::Report( const ReportType & report )
+{
+  if( this->m_Callback )
+  {
+    this->m_Callback( this->m_ClientData, report );
+  }
+
+} // end Report()
+
+
+/**
+ * ****************** Cancel *********************************
+ */
+
+void
+RegistrationProgress
+::Cancel( void )
+{
+  this->m_CancelRequested.store( 1 );
+
+} // end Cancel()
+
+
+/**
+ * ****************** ResetCancel *********************************
+ */
+
+void
+RegistrationProgress
+::ResetCancel( void )
+{
+  this->m_CancelRequested.store( 0 );
+
+} // end ResetCancel()
+
+
+/**
+ * ****************** SetCurrent *********************************
+ */
+
+void
+RegistrationProgress
+::SetCurrent( Self * progress )
+{
+  CurrentRegistrationProgress = progress;
+
+} // end SetCurrent()
+
+
+/**
+ * ****************** GetCurrent *********************************
+ */
+
+RegistrationProgress *
+RegistrationProgress
+::GetCurrent( void )
+{
+  return CurrentRegistrationProgress;
+
+} // end GetCurrent()
+
+
+/**
+ * ****************** AbortOnCancelCallback *********************************
+ */
+
+static void
+AbortOnCancelCallback( Object * caller, const EventObject &, void * )
+{
+  if( RegistrationProgress::GetCurrentCancelRequested() )
+  {
+    static_cast< ProcessObject * >( caller )->AbortGenerateDataOn();
+  }
+
+} // end AbortOnCancelCallback()
+
+
+/**
+ * ****************** AbortOnCancel *********************************
+ */
+
+void
+RegistrationProgress
+::AbortOnCancel( ProcessObject * filter )
+{
+  if( CurrentRegistrationProgress == 0 )
+  {
+    return;
+  }
+
+  CStyleCommand::Pointer command = CStyleCommand::New();
+  command->SetCallback( AbortOnCancelCallback );
+  filter->AddObserver( ProgressEvent(), command );
+
+} // end AbortOnCancel()
+
+
+/**
+ * ****************** PrintSelf *********************************
+ */
+
+void
+RegistrationProgress
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Callback: " << ( this->m_Callback ? "set" : "none" ) << std::endl;
+  os << indent << "CancelRequested: " << this->GetCancelRequested() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRegistrationProgress_cxx
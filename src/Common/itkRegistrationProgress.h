@@ -0,0 +1,158 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRegistrationProgress_h
+#define __itkRegistrationProgress_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkAtomicInt.h"
+#include "itkProcessObject.h"
+
+namespace itk
+{
+
+/** \class RegistrationProgress
+ *
+ * \brief Reports the progress of a registration to a callback, and lets
+ * another thread cancel it.
+ *
+ * The callback is called after every iteration, with the resolution, the
+ * iteration and the metric value, from the thread that runs the
+ * registration. It should return quickly; it may call Cancel().
+ *
+ * Cancel() may be called from any thread. The request is polled at the
+ * iteration and resolution boundaries, and inside the long loops of the
+ * image samplers and the image pyramids, so that the registration stops
+ * within milliseconds. A cancelled registration ends with a ProcessAborted
+ * exception, and produces no result.
+ *
+ * The loops in Common do not know which registration they belong to. They
+ * poll the object that is made current with SetCurrent(), which elastix
+ * does for the duration of ElastixMain::Run(). A polling costs a load of a
+ * pointer and of an integer.
+ *
+ * \ingroup Miscellaneous
+ */
+
+class RegistrationProgress : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef RegistrationProgress       Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( RegistrationProgress, Object );
+
+  /** The progress that is passed to the callback. The metric value is NaN
+   * when the optimizer does not provide it.
+   */
+  struct ReportType
+  {
+    unsigned int  Resolution;
+    unsigned int  NumberOfResolutions;
+    SizeValueType Iteration;
+    double        MetricValue;
+  };
+
+  /** The callback; \a clientData is passed as given to SetCallback(). */
+  typedef void (* CallbackType)( void * clientData, const ReportType & report );
+
+  /** Set the callback, or 0 (the default) for none. */
+  void SetCallback( CallbackType callback, void * clientData );
+
+  /** Call the callback, if set. */
+  void Report( const ReportType & report );
+
+  /** Request the registration to stop. Thread safe. */
+  void Cancel( void );
+
+  /** Withdraw the request, e.g. to reuse this object for a next run. */
+  void ResetCancel( void );
+
+  /** Whether Cancel() was called. Thread safe. */
+  bool GetCancelRequested( void ) const
+  {
+    return this->m_CancelRequested.load() != 0;
+  }
+
+  /** Make \a progress the object that is polled by the loops in Common, or
+   * 0 for none. Not thread safe: call it before the registration starts.
+   */
+  static void SetCurrent( Self * progress );
+
+  static Self * GetCurrent( void );
+
+  /** Whether the current object, if any, was cancelled. Thread safe. */
+  static bool GetCurrentCancelRequested( void )
+  {
+    const Self * current = Self::GetCurrent();
+    return current != 0 && current->GetCancelRequested();
+  }
+
+  /** Let \a filter abort when the current object is cancelled, by setting
+   * its AbortGenerateData flag on its next progress event. This stops the
+   * ITK filters that report their progress, within their pixel loops. Does
+   * nothing if there is no current object.
+   */
+  static void AbortOnCancel( ProcessObject * filter );
+
+  /** Throw a ProcessAborted exception if the current object was cancelled.
+   * Only call this from the thread that runs the registration; worker
+   * threads should poll GetCurrentCancelRequested() and return early.
+   */
+  static void ThrowIfCurrentCancelRequested( void )
+  {
+    if( Self::GetCurrentCancelRequested() )
+    {
+      ProcessAborted e( __FILE__, __LINE__ );
+      e.SetDescription( "The registration was cancelled." );
+      throw e;
+    }
+  }
+
+protected:
+
+  RegistrationProgress();
+  virtual ~RegistrationProgress() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  RegistrationProgress( const Self & ); // purposely not implemented
+  void operator=( const Self & );       // purposely not implemented
+
+  typedef AtomicInt< int > CancelFlagType;
+
+  CallbackType   m_Callback;
+  void *         m_ClientData;
+  CancelFlagType m_CancelRequested;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRegistrationProgress_h
@@ -95,6 +95,33 @@ ScaledSingleValuedNonLinearOptimizer
 } // end GetUseScales()
 
 
+/**
+ * ********************* SetUseCostFunctionCache ******************************
+ */
+
+void
+ScaledSingleValuedNonLinearOptimizer
+::SetUseCostFunctionCache( bool arg )
+{
+  this->m_ScaledCostFunction->SetUseCache( arg );
+  this->Modified();
+
+} // end SetUseCostFunctionCache()
+
+
+/**
+ * ********************* GetUseCostFunctionCache ******************************
+ */
+
+bool
+ScaledSingleValuedNonLinearOptimizer
+::GetUseCostFunctionCache( void ) const
+{
+  return this->m_ScaledCostFunction->GetUseCache();
+
+} // end GetUseCostFunctionCache()
+
+
 /**
  * ********************* GetScaledValue *****************************
  */
@@ -108,6 +135,21 @@ ScaledSingleValuedNonLinearOptimizer
 } // end GetScaledValue()
 
 
+/**
+ * ********************* GetScaledValues *****************************
+ */
+
+void
+ScaledSingleValuedNonLinearOptimizer
+::GetScaledValues(
+  const ParametersArrayType & parametersArray,
+  MeasureArrayType & values ) const
+{
+  this->m_ScaledCostFunction->GetValues( parametersArray, values );
+
+} // end GetScaledValues()
+
+
 /**
  * ********************* GetScaledDerivative *****************************
  */
@@ -232,6 +274,21 @@ ScaledSingleValuedNonLinearOptimizer
 }  // end SetMaximize()
 
 
+/**
+ * ******************** GetWorkMemorySize *******************************
+ */
+
+SizeValueType
+ScaledSingleValuedNonLinearOptimizer
+::GetWorkMemorySize( void ) const
+{
+  return ( this->m_CurrentPosition.Size() + this->m_ScaledCurrentPosition.Size()
+         + this->m_UnscaledCurrentPosition.Size() + this->GetScales().Size() )
+         * sizeof( double );
+
+} // end GetWorkMemorySize()
+
+
 /**
  * ******************** PrintSelf *******************************
  */
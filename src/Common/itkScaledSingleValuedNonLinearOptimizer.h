@@ -21,6 +21,8 @@
 #include "itkSingleValuedNonLinearOptimizer.h"
 #include "itkScaledSingleValuedCostFunction.h"
 
+#include <vector>
+
 namespace itk
 {
 /** \class ScaledSingleValuedNonLinearOptimizer
@@ -87,6 +89,9 @@ public:
   typedef ScaledSingleValuedCostFunction  ScaledCostFunctionType;
   typedef ScaledCostFunctionType::Pointer ScaledCostFunctionPointer;
 
+  /** The internal state of an optimization, see GetOptimizationState(). */
+  typedef std::vector< double > OptimizationStateType;
+
   /** Configure the scaled cost function. This function
    * sets the current scales in the ScaledCostFunction.
    * NB: it assumes that the scales entered by the user
@@ -106,6 +111,15 @@ public:
 
   bool GetUseScales( void ) const;
 
+  /** Setting: Turn on/off the caching of the last value and derivative in
+   * the scaled cost function. Useful for optimizers that may ask for the
+   * value and/or derivative at the same position more than once, as line
+   * search based optimizers do. See ScaledSingleValuedCostFunction::SetUseCache().
+   */
+  virtual void SetUseCostFunctionCache( bool arg );
+
+  bool GetUseCostFunctionCache( void ) const;
+
   /** Get the current scaled position. */
   itkGetConstReferenceMacro( ScaledCurrentPosition, ParametersType );
 
@@ -126,6 +140,39 @@ public:
 
   itkGetConstMacro( Maximize, bool );
 
+  /** Returns the number of bytes held by the parameter vectors of the
+   * optimizer, which is reported by the memory accounting of elastix.
+   * Subclasses add their own vectors, like the gradient.
+   */
+  virtual SizeValueType GetWorkMemorySize( void ) const;
+
+  /** Get the internal state of the optimization, apart from the position,
+   * to checkpoint a registration: e.g. the iteration number and the history
+   * of a quasi-Newton method. It is meant to be called from an observer of
+   * the IterationEvent, and describes the state at the start of the next
+   * iteration. The default, for optimizers without such a state, is empty.
+   */
+  virtual void GetOptimizationState( OptimizationStateType & state ) const
+  {
+    state.clear();
+  }
+
+  /** Set a state obtained by GetOptimizationState(), from which the next
+   * ResumeOptimization(), also when called by StartOptimization(), continues
+   * instead of starting afresh. The initial position should be set to the
+   * position at which the state was taken. The state is used only once.
+   */
+  virtual void SetOptimizationState( const OptimizationStateType & state )
+  {
+    this->m_PendingOptimizationState = state;
+  }
+
+  /** Whether a state is set that the next optimization continues from. */
+  bool GetHasPendingOptimizationState( void ) const
+  {
+    return !this->m_PendingOptimizationState.empty();
+  }
+
 protected:
 
   /** The constructor. */
@@ -140,6 +187,11 @@ protected:
   ParametersType            m_ScaledCurrentPosition;
   ScaledCostFunctionPointer m_ScaledCostFunction;
 
+  /** The state set by SetOptimizationState(), which the subclasses restore
+   * and clear at the start of ResumeOptimization().
+   */
+  OptimizationStateType m_PendingOptimizationState;
+
   /** Set m_ScaledCurrentPosition. */
   virtual void SetScaledCurrentPosition( const ParametersType & parameters );
 
@@ -162,6 +214,18 @@ protected:
   virtual MeasureType GetScaledValue(
     const ParametersType & parameters ) const;
 
+  /** Typedefs for evaluating several parameter vectors at once. */
+  typedef ScaledCostFunctionType::ParametersArrayType ParametersArrayType;
+  typedef ScaledCostFunctionType::MeasureArrayType    MeasureArrayType;
+
+  /** Compute the values at several (scaled) positions at once. This is
+   * faster than calling GetScaledValue() for every position, if the cost
+   * function is a MultiCandidateCostFunction.
+   */
+  virtual void GetScaledValues(
+    const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const;
+
   /** Divide the (scaled) parameters by the scales, call the GetDerivative routine
    * of the unscaled cost function and divide the resulting derivative by
    * the scales.
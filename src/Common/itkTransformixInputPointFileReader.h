@@ -20,8 +20,11 @@
 #define __itkTransformixInputPointFileReader_h
 
 #include "itkMeshFileReaderBase.h"
+#include "itkMemoryMappedFile.h"
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 namespace itk
 {
@@ -40,6 +43,21 @@ namespace itk
  *
  * The second word in the text file represents the number of points that
  * should be read.
+ *
+ * Besides the usual Update(), which fills the output point set, the points
+ * can be read in chunks with ReadPoints(), after UpdateOutputInformation().
+ * That way, large point files are processed without holding all points.
+ *
+ * The reader also understands binary point files, which avoid the parsing of
+ * text. Such a file is recognized by its first eight bytes, "ELXPOINT",
+ * followed by the dimension and a flag that tells whether the points are
+ * indices, both as 32 bit unsigned integers, and the number of points, as a
+ * 64 bit unsigned integer. The coordinates follow, as 32 bit floats. All
+ * values are little endian. The file is mapped into memory, see
+ * MemoryMappedFile. CreateBinaryHeader() gives the header for writers.
+ *
+ * MemoryMappedFile is compiled into elxCommon, so every executable that
+ * uses this reader must link against elxCommon.
  **/
 
 template< class TOutputMesh >
@@ -63,6 +81,7 @@ public:
   typedef typename Superclass::DataObjectPointer DatabObjectPointer;
   typedef typename Superclass::OutputMeshType    OutputMeshType;
   typedef typename Superclass::OutputMeshPointer OutputMeshPointer;
+  typedef typename OutputMeshType::PointType     PointType;
 
   /** Get whether the read points are indices; actually we should store this as a kind
    * of meta data in the output, but i don't understand this concept yet...
@@ -87,6 +106,23 @@ public:
    */
   virtual void GenerateOutputInformation( void );
 
+  /** Read the next at most maximumNumberOfPoints points of the file into
+   * points, which is resized to the number of points read. Call
+   * UpdateOutputInformation() first. Returns the number of points read,
+   * which is zero once all NumberOfPoints points have been read.
+   */
+  SizeValueType ReadPoints( const SizeValueType maximumNumberOfPoints,
+    std::vector< PointType > & points );
+
+  /** Get whether the file is a binary point file. */
+  itkGetConstMacro( IsBinary, bool );
+
+  /** Returns the header of a binary point file with numberOfPoints points;
+   * the coordinates of the points should follow it.
+   */
+  static std::string CreateBinaryHeader( const bool pointsAreIndices,
+    const SizeValueType numberOfPoints );
+
 protected:
 
   TransformixInputPointFileReader();
@@ -102,6 +138,31 @@ protected:
 
 private:
 
+  /** Read the next number of the file, via a buffer. Returns false at the
+   * end of the file.
+   */
+  bool ReadValue( double & value );
+
+  /** Append the next part of the file to the buffer. Returns false at the
+   * end of the file.
+   */
+  bool FillBuffer( void );
+
+  /** Map the file and read its header, if it is a binary point file.
+   * Returns false if it is not.
+   */
+  bool ReadBinaryHeader( void );
+
+  /** The size of the header of a binary point file, in bytes. */
+  itkStaticConstMacro( BinaryHeaderSize, unsigned int, 24 );
+
+  bool                      m_IsBinary;
+  MemoryMappedFile::Pointer m_MappedFile;
+
+  std::string   m_Buffer;
+  std::size_t   m_BufferPosition;
+  SizeValueType m_NumberOfPointsRead;
+
   TransformixInputPointFileReader( const Self & ); // purposely not implemented
   void operator=( const Self & );                  // purposely not implemented
 
@@ -20,6 +20,13 @@
 #define __itkTransformixInputPointFileReader_hxx
 
 #include "itkTransformixInputPointFileReader.h"
+#include "itkByteSwapper.h"
+#include "itkIntTypes.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 namespace itk
 {
@@ -32,8 +39,11 @@ template< class TOutputMesh >
 TransformixInputPointFileReader< TOutputMesh >
 ::TransformixInputPointFileReader()
 {
-  this->m_NumberOfPoints   = 0;
-  this->m_PointsAreIndices = false;
+  this->m_NumberOfPoints     = 0;
+  this->m_PointsAreIndices   = false;
+  this->m_BufferPosition     = 0;
+  this->m_NumberOfPointsRead = 0;
+  this->m_IsBinary           = false;
 } // end constructor
 
 
@@ -69,6 +79,17 @@ TransformixInputPointFileReader< TOutputMesh >
   {
     this->m_Reader.close();
   }
+  this->m_MappedFile = 0;
+  this->m_Buffer.clear();
+  this->m_BufferPosition     = 0;
+  this->m_NumberOfPointsRead = 0;
+
+  /** A binary point file is mapped, instead of read as text. */
+  this->m_IsBinary = this->ReadBinaryHeader();
+  if( this->m_IsBinary )
+  {
+    return;
+  }
   this->m_Reader.open( this->m_FileName.c_str() );
 
   /** Read the first entry */
@@ -111,37 +132,19 @@ TransformixInputPointFileReader< TOutputMesh >
 {
   typedef typename OutputMeshType::PointsContainer PointsContainerType;
   typedef typename PointsContainerType::Pointer    PointsContainerPointer;
-  typedef typename OutputMeshType::PointType       PointType;
-  const unsigned int dimension = OutputMeshType::PointDimension;
 
   OutputMeshPointer      output = this->GetOutput();
   PointsContainerPointer points = PointsContainerType::New();
 
   /** Read the file */
-  if( this->m_Reader.is_open() )
+  if( this->m_Reader.is_open() || this->m_MappedFile.IsNotNull() )
   {
-    for( unsigned int i = 0; i < this->m_NumberOfPoints; ++i )
+    std::vector< PointType > pointVector;
+    this->ReadPoints( this->m_NumberOfPoints, pointVector );
+    points->reserve( pointVector.size() );
+    for( std::size_t i = 0; i < pointVector.size(); ++i )
     {
-      // read point from textfile
-      PointType point;
-      for( unsigned int j = 0; j < dimension; j++ )
-      {
-        if( !this->m_Reader.eof() )
-        {
-          this->m_Reader >> point[ j ];
-        }
-        else
-        {
-          std::ostringstream msg;
-          msg << "The file is not large enough. "
-              << std::endl << "Filename: " << this->m_FileName
-              << std::endl;
-          MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
-          throw e;
-          return;
-        }
-      }
-      points->push_back( point );
+      points->push_back( pointVector[ i ] );
     }
   }
   else
@@ -161,6 +164,7 @@ TransformixInputPointFileReader< TOutputMesh >
 
   /** Close the reader */
   this->m_Reader.close();
+  this->m_MappedFile = 0;
 
   /** This indicates that the current BufferedRegion is equal to the
    * requested region. This action prevents useless re-executions of
@@ -171,6 +175,228 @@ TransformixInputPointFileReader< TOutputMesh >
 } // end GenerateData()
 
 
+/**
+ * ***************ReadPoints ***********
+ */
+
+template< class TOutputMesh >
+SizeValueType
+TransformixInputPointFileReader< TOutputMesh >
+::ReadPoints( const SizeValueType maximumNumberOfPoints,
+  std::vector< PointType > & points )
+{
+  const unsigned int  dimension      = OutputMeshType::PointDimension;
+  const SizeValueType numberOfPoints = std::min( maximumNumberOfPoints,
+    static_cast< SizeValueType >( this->m_NumberOfPoints - this->m_NumberOfPointsRead ) );
+
+  points.resize( numberOfPoints );
+
+  /** Copy the floats from the mapped binary file. */
+  if( this->m_IsBinary )
+  {
+    const char * data = this->m_MappedFile->GetData() + BinaryHeaderSize
+      + this->m_NumberOfPointsRead * dimension * sizeof( float );
+    for( SizeValueType i = 0; i < numberOfPoints; ++i )
+    {
+      for( unsigned int j = 0; j < dimension; ++j )
+      {
+        float value;
+        std::memcpy( &value, data, sizeof( float ) );
+        ByteSwapper< float >::SwapFromSystemToLittleEndian( &value );
+        points[ i ][ j ] = value;
+        data            += sizeof( float );
+      }
+    }
+    this->m_NumberOfPointsRead += numberOfPoints;
+    return numberOfPoints;
+  }
+
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    for( unsigned int j = 0; j < dimension; ++j )
+    {
+      double value = 0.0;
+      if( !this->ReadValue( value ) )
+      {
+        std::ostringstream msg;
+        msg << "The file is not large enough. "
+            << std::endl << "Filename: " << this->m_FileName
+            << std::endl;
+        MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+        throw e;
+      }
+      points[ i ][ j ] = value;
+    }
+  }
+  this->m_NumberOfPointsRead += numberOfPoints;
+
+  return numberOfPoints;
+
+} // end ReadPoints()
+
+
+/**
+ * ***************ReadValue ***********
+ */
+
+template< class TOutputMesh >
+bool
+TransformixInputPointFileReader< TOutputMesh >
+::ReadValue( double & value )
+{
+  for(;; )
+  {
+    /** Skip the white space, and find the end of the number. */
+    std::size_t & begin = this->m_BufferPosition;
+    while( begin < this->m_Buffer.size()
+      && std::isspace( static_cast< unsigned char >( this->m_Buffer[ begin ] ) ) )
+    {
+      ++begin;
+    }
+    std::size_t end = begin;
+    while( end < this->m_Buffer.size()
+      && !std::isspace( static_cast< unsigned char >( this->m_Buffer[ end ] ) ) )
+    {
+      ++end;
+    }
+
+    /** A number that ends at the end of the buffer may continue in the file. */
+    if( end == this->m_Buffer.size() && this->FillBuffer() )
+    {
+      continue;
+    }
+    if( end == begin )
+    {
+      return false;
+    }
+
+    const char * number    = this->m_Buffer.c_str() + begin;
+    char *       numberEnd = 0;
+    value = std::strtod( number, &numberEnd );
+    if( numberEnd != this->m_Buffer.c_str() + end )
+    {
+      std::ostringstream msg;
+      msg << "The file contains an invalid number: "
+          << std::string( number, this->m_Buffer.c_str() + end )
+          << std::endl << "Filename: " << this->m_FileName
+          << std::endl;
+      MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+      throw e;
+    }
+    begin = end;
+    return true;
+  }
+
+} // end ReadValue()
+
+
+/**
+ * ***************FillBuffer ***********
+ */
+
+template< class TOutputMesh >
+bool
+TransformixInputPointFileReader< TOutputMesh >
+::FillBuffer( void )
+{
+  /** Drop the part that has been read, and append the next megabyte. */
+  this->m_Buffer.erase( 0, this->m_BufferPosition );
+  this->m_BufferPosition = 0;
+
+  const std::size_t chunkSize = 1 << 20;
+  const std::size_t oldSize   = this->m_Buffer.size();
+  this->m_Buffer.resize( oldSize + chunkSize );
+  this->m_Reader.read( &this->m_Buffer[ oldSize ], chunkSize );
+  const std::size_t numberOfCharacters = static_cast< std::size_t >( this->m_Reader.gcount() );
+  this->m_Buffer.resize( oldSize + numberOfCharacters );
+
+  return numberOfCharacters > 0;
+
+} // end FillBuffer()
+
+
+/**
+ * ***************ReadBinaryHeader ***********
+ */
+
+template< class TOutputMesh >
+bool
+TransformixInputPointFileReader< TOutputMesh >
+::ReadBinaryHeader( void )
+{
+  /** Check the magic bytes. */
+  char magic[ 8 ] = { 0 };
+  {
+    std::ifstream file( this->m_FileName.c_str(), std::ios::in | std::ios::binary );
+    file.read( magic, sizeof( magic ) );
+    if( file.gcount() != sizeof( magic ) || std::memcmp( magic, "ELXPOINT", sizeof( magic ) ) != 0 )
+    {
+      return false;
+    }
+  }
+
+  this->m_MappedFile = MemoryMappedFile::New();
+  this->m_MappedFile->Open( this->m_FileName );
+
+  const char * data = this->m_MappedFile->GetData();
+  uint32_t     dimension        = 0;
+  uint32_t     pointsAreIndices = 0;
+  uint64_t     numberOfPoints   = 0;
+  if( this->m_MappedFile->GetSize() >= BinaryHeaderSize )
+  {
+    std::memcpy( &dimension, data + 8, sizeof( dimension ) );
+    std::memcpy( &pointsAreIndices, data + 12, sizeof( pointsAreIndices ) );
+    std::memcpy( &numberOfPoints, data + 16, sizeof( numberOfPoints ) );
+    ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian( &dimension );
+    ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian( &pointsAreIndices );
+    ByteSwapper< uint64_t >::SwapFromSystemToLittleEndian( &numberOfPoints );
+  }
+
+  const unsigned int pointDimension = OutputMeshType::PointDimension;
+  if( dimension != pointDimension
+    || this->m_MappedFile->GetSize() < BinaryHeaderSize + numberOfPoints * pointDimension * sizeof( float ) )
+  {
+    std::ostringstream msg;
+    msg << "The binary point file is not valid, or does not have dimension "
+        << pointDimension << "." << std::endl << "Filename: " << this->m_FileName
+        << std::endl;
+    MeshFileReaderException e( __FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION );
+    throw e;
+  }
+
+  this->m_PointsAreIndices = pointsAreIndices != 0;
+  this->m_NumberOfPoints   = static_cast< unsigned long >( numberOfPoints );
+  return true;
+
+} // end ReadBinaryHeader()
+
+
+/**
+ * ***************CreateBinaryHeader ***********
+ */
+
+template< class TOutputMesh >
+std::string
+TransformixInputPointFileReader< TOutputMesh >
+::CreateBinaryHeader( const bool pointsAreIndices, const SizeValueType numberOfPoints )
+{
+  uint32_t dimension = OutputMeshType::PointDimension;
+  uint32_t indices   = pointsAreIndices ? 1 : 0;
+  uint64_t number    = numberOfPoints;
+  ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian( &dimension );
+  ByteSwapper< uint32_t >::SwapFromSystemToLittleEndian( &indices );
+  ByteSwapper< uint64_t >::SwapFromSystemToLittleEndian( &number );
+
+  std::string header( BinaryHeaderSize, '\0' );
+  std::memcpy( &header[ 0 ], "ELXPOINT", 8 );
+  std::memcpy( &header[ 8 ], &dimension, sizeof( dimension ) );
+  std::memcpy( &header[ 12 ], &indices, sizeof( indices ) );
+  std::memcpy( &header[ 16 ], &number, sizeof( number ) );
+  return header;
+
+} // end CreateBinaryHeader()
+
+
 } // end namespace itk
 
 #endif
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __xoutbinary_h
+#define __xoutbinary_h
+
+#include "xoutbase.h"
+#include <sstream>
+#include <vector>
+
+namespace xoutlibrary
+{
+using namespace std;
+
+/**
+ * \class xoutbinary
+ * \brief Writes the rows of an xoutrow to a stream in a compact binary format.
+ *
+ * The xoutbinary class is added as an output of an xoutrow, like an
+ * ordinary stream. It receives the text of the cells, converts every cell
+ * to a 32 bit float, and writes one record per row to its output stream.
+ * The first row it receives, normally the one written by
+ * xoutrow::WriteHeaders(), gives the names of the columns. The records of
+ * the next rows have as many values as there are columns; cells that are
+ * not a number are written as NaN.
+ *
+ * The layout of the output, in the byte order of the host, is:
+ * \li the magic string "ELXITINF" (8 bytes);
+ * \li the version, 1, as a 32 bit unsigned integer, which also shows the
+ *   byte order;
+ * \li the number of columns, as a 32 bit unsigned integer;
+ * \li per column: the length of its name as a 32 bit unsigned integer, and
+ *   the characters of the name;
+ * \li per row: a 32 bit float per column.
+ *
+ * Only the char specialization writes meaningful output. The output stream
+ * should be opened in binary mode.
+ *
+ * \ingroup xout
+ */
+
+template< class charT, class traits = char_traits< charT > >
+class xoutbinary : public xoutbase< charT, traits >
+{
+public:
+
+  /** Typdef's. */
+  typedef xoutbinary                Self;
+  typedef xoutbase< charT, traits > Superclass;
+
+  typedef typename Superclass::traits_type  traits_type;
+  typedef typename Superclass::char_type    char_type;
+  typedef typename Superclass::int_type     int_type;
+  typedef typename Superclass::pos_type     pos_type;
+  typedef typename Superclass::off_type     off_type;
+  typedef typename Superclass::ostream_type ostream_type;
+  typedef typename Superclass::ios_type     ios_type;
+
+  typedef std::basic_ostringstream< charT, traits > InternalBufferType;
+  typedef std::basic_string< charT, traits >        StringType;
+
+  /** Constructors */
+  xoutbinary();
+
+  /** Destructor */
+  virtual ~xoutbinary();
+
+  /** Set the stream to which the records are written. A new stream starts
+   * with a new header, so the next row gives the column names again.
+   */
+  virtual void SetOutputStream( ostream_type * output );
+
+  /** Convert the text received since the last call: a cell, or the end of
+   * a row, after which the row is written to the output stream.
+   */
+  virtual void WriteBufferedData( void );
+
+protected:
+
+  /** Write the header with the column names, and a record. */
+  virtual void WriteHeader( void );
+
+  virtual void WriteRecord( void );
+
+  /** Write raw bytes to the output stream. */
+  void WriteBytes( const void * data, const std::size_t size );
+
+  InternalBufferType        m_InternalBuffer;
+  ostream_type *            m_OutputStream;
+  std::vector< StringType > m_Cells;
+  std::vector< float >      m_Record;
+  bool                      m_HeaderWritten;
+
+};
+
+} // end namespace xoutlibrary
+
+#include "xoutbinary.hxx"
+
+#endif // end #ifndef __xoutbinary_h
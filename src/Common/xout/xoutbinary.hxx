@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __xoutbinary_hxx
+#define __xoutbinary_hxx
+
+#include "xoutbinary.h"
+#include <limits>
+
+namespace xoutlibrary
+{
+using namespace std;
+
+/**
+ * ************************ Constructor *************************
+ */
+
+template< class charT, class traits >
+xoutbinary< charT, traits >::xoutbinary()
+{
+  this->m_OutputStream  = 0;
+  this->m_HeaderWritten = false;
+  this->AddTargetCell( "InternalBuffer", &( this->m_InternalBuffer ) );
+
+}   // end Constructor
+
+
+/**
+ * ********************* Destructor *****************************
+ */
+
+template< class charT, class traits >
+xoutbinary< charT, traits >::~xoutbinary()
+{
+  //nothing
+
+}   // end Destructor
+
+
+/**
+ * ******************** SetOutputStream *************************
+ */
+
+template< class charT, class traits >
+void
+xoutbinary< charT, traits >::SetOutputStream( ostream_type * output )
+{
+  this->m_OutputStream  = output;
+  this->m_HeaderWritten = false;
+  this->m_Cells.clear();
+  this->m_InternalBuffer.str( StringType() );
+
+}   // end SetOutputStream()
+
+
+/**
+ * ******************** WriteBufferedData ***********************
+ *
+ * An xoutrow sends every cell followed by a tab, and the end of
+ * the row as a separate newline.
+ */
+
+template< class charT, class traits >
+void
+xoutbinary< charT, traits >::WriteBufferedData( void )
+{
+  StringType text = this->m_InternalBuffer.str();
+  this->m_InternalBuffer.str( StringType() );
+
+  const charT newline  = this->m_InternalBuffer.widen( '\n' );
+  const charT tab      = this->m_InternalBuffer.widen( '\t' );
+  const bool  endOfRow = !text.empty() && text[ text.size() - 1 ] == newline;
+  if( endOfRow )
+  {
+    text.erase( text.size() - 1 );
+  }
+  if( !text.empty() && text[ text.size() - 1 ] == tab )
+  {
+    text.erase( text.size() - 1 );
+  }
+  if( !text.empty() || !endOfRow )
+  {
+    this->m_Cells.push_back( text );
+  }
+
+  if( endOfRow )
+  {
+    if( this->m_HeaderWritten )
+    {
+      this->WriteRecord();
+    }
+    else
+    {
+      this->WriteHeader();
+    }
+    this->m_Cells.clear();
+  }
+
+}   // end WriteBufferedData()
+
+
+/**
+ * ********************* WriteHeader ****************************
+ */
+
+template< class charT, class traits >
+void
+xoutbinary< charT, traits >::WriteHeader( void )
+{
+  const char         magic[ 8 ]      = { 'E', 'L', 'X', 'I', 'T', 'I', 'N', 'F' };
+  const unsigned int version         = 1;
+  const unsigned int numberOfColumns = static_cast< unsigned int >( this->m_Cells.size() );
+
+  this->WriteBytes( magic, sizeof( magic ) );
+  this->WriteBytes( &version, sizeof( version ) );
+  this->WriteBytes( &numberOfColumns, sizeof( numberOfColumns ) );
+  for( std::size_t i = 0; i < this->m_Cells.size(); ++i )
+  {
+    const unsigned int length = static_cast< unsigned int >( this->m_Cells[ i ].size() );
+    this->WriteBytes( &length, sizeof( length ) );
+    for( std::size_t j = 0; j < this->m_Cells[ i ].size(); ++j )
+    {
+      const char c = this->m_InternalBuffer.narrow( this->m_Cells[ i ][ j ], '?' );
+      this->WriteBytes( &c, 1 );
+    }
+  }
+
+  this->m_Record.resize( this->m_Cells.size() );
+  this->m_HeaderWritten = true;
+
+}   // end WriteHeader()
+
+
+/**
+ * ********************* WriteRecord ****************************
+ *
+ * The record has the schema of the header; missing cells and cells
+ * that are not a number are written as NaN.
+ */
+
+template< class charT, class traits >
+void
+xoutbinary< charT, traits >::WriteRecord( void )
+{
+  for( std::size_t i = 0; i < this->m_Record.size(); ++i )
+  {
+    double value = std::numeric_limits< double >::quiet_NaN();
+    if( i < this->m_Cells.size() )
+    {
+      std::basic_istringstream< charT, traits > ss( this->m_Cells[ i ] );
+      ss >> value;
+      if( ss.fail() )
+      {
+        value = std::numeric_limits< double >::quiet_NaN();
+      }
+    }
+    this->m_Record[ i ] = static_cast< float >( value );
+  }
+
+  if( !this->m_Record.empty() )
+  {
+    this->WriteBytes( &this->m_Record[ 0 ], this->m_Record.size() * sizeof( float ) );
+  }
+  if( this->m_OutputStream )
+  {
+    *( this->m_OutputStream ) << flush;
+  }
+
+}   // end WriteRecord()
+
+
+/**
+ * ********************* WriteBytes *****************************
+ */
+
+template< class charT, class traits >
+void
+xoutbinary< charT, traits >::WriteBytes( const void * data, const std::size_t size )
+{
+  if( this->m_OutputStream )
+  {
+    this->m_OutputStream->write(
+      static_cast< const charT * >( data ), size / sizeof( charT ) );
+  }
+
+}   // end WriteBytes()
+
+
+} // end namespace xoutlibrary
+
+#endif // end #ifndef __xoutbinary_hxx
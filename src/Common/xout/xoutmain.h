@@ -23,6 +23,7 @@
 #include "xoutsimple.h"
 #include "xoutrow.h"
 #include "xoutcell.h"
+#include "xoutbinary.h"
 
 /** Define a namespace alias. */
 namespace xl = xoutlibrary;
@@ -36,6 +37,7 @@ typedef xoutbase< char >   xoutbase_type;
 typedef xoutsimple< char > xoutsimple_type;
 typedef xoutrow< char >    xoutrow_type;
 typedef xoutcell< char >   xoutcell_type;
+typedef xoutbinary< char > xoutbinary_type;
 
 xoutbase_type & get_xout( void );
 
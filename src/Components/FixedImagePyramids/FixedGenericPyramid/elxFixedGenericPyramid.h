@@ -61,10 +61,21 @@ namespace elastix
  *    at once, or per resolution. Latter saves memory.\n
  *    example: <tt>(ComputePyramidImagesPerResolution "true")</tt>\n
  *    Default false.
+ * \parameter ComputePyramidImagesInBackground: Flag to specify if the pyramid images of the
+ *    next resolution are computed on a background thread, while the current resolution
+ *    is registered. Only used when ComputePyramidImagesPerResolution is true.\n
+ *    example: <tt>(ComputePyramidImagesInBackground "true")</tt>\n
+ *    Default false.
  * \parameter ImagePyramidUseShrinkImageFilter: Flag to specify if the ShrinkingImageFilter is used
  *    for rescaling the image, or the ResampleImageFilter. Skrinker is faster.\n
  *    example: <tt>(ImagePyramidUseShrinkImageFilter "true")</tt>\n
  *    Default false, so by default the resampler is used.
+ * \parameter ImagePyramidUseFusedSmoothingAndShrinking: Flag to specify if smoothing and
+ *    shrinking are done in a single pass, with a discrete instead of a recursive Gaussian.
+ *    This is faster and does not allocate a full resolution smoothed image per level.
+ *    Only used when ImagePyramidUseShrinkImageFilter is true.\n
+ *    example: <tt>(ImagePyramidUseFusedSmoothingAndShrinking "true")</tt>\n
+ *    Default false.
  *
  * \ingroup ImagePyramids
  */
@@ -136,6 +147,15 @@ protected:
   /** The destructor. */
   virtual ~FixedGenericPyramid() {}
 
+  /** Takes the levels from the fixed image preprocessing cache, or computes
+   * and stores them, see FixedImagePyramidBase::GraftPyramidFromCache().
+   * The cache is not used if only the current level is computed.
+   */
+  virtual void GenerateData( void );
+
+  /** Adds the rescale and smoothing schedules to the cache key. */
+  virtual std::string GetPyramidCacheKey( void ) const;
+
 private:
 
   /** The private constructor. */
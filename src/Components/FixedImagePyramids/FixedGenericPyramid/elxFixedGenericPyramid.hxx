@@ -144,6 +144,12 @@ FixedGenericPyramid< TElastix >
     "ImagePyramidUseShrinkImageFilter", 0, false );
   this->SetUseShrinkImageFilter( useShrinkImageFilter );
 
+  /** Smooth and shrink in a single pass, i.e. without a full resolution smoothed image. */
+  bool useFusedSmoothingAndShrinking = false;
+  this->m_Configuration->ReadParameter( useFusedSmoothingAndShrinking,
+    "ImagePyramidUseFusedSmoothingAndShrinking", 0, false );
+  this->SetUseFusedSmoothingAndShrinking( useFusedSmoothingAndShrinking );
+
   /** Decide whether or not to compute the pyramid images only for the current
    * resolution. Setting the option to true saves memory, since only one level
    * of the pyramid gets allocated per resolution.
@@ -153,6 +159,15 @@ FixedGenericPyramid< TElastix >
     "ComputePyramidImagesPerResolution", 0, false );
   this->SetComputeOnlyForCurrentLevel( computeThisResolution );
 
+  /** Decide whether or not to compute the pyramid images of the next resolution
+   * in the background, while the current resolution is being registered.
+   * Only used when the pyramid images are computed per resolution.
+   */
+  bool computeInBackground = false;
+  this->m_Configuration->ReadParameter( computeInBackground,
+    "ComputePyramidImagesInBackground", 0, false );
+  this->SetComputeNextLevelInBackground( computeInBackground );
+
 } // end SetFixedSchedule()
 
 
@@ -177,6 +192,49 @@ FixedGenericPyramid< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TElastix >
+void
+FixedGenericPyramid< TElastix >
+::GenerateData( void )
+{
+  if( this->GetComputeOnlyForCurrentLevel() )
+  {
+    this->Superclass1::GenerateData();
+    return;
+  }
+
+  if( !this->GraftPyramidFromCache() )
+  {
+    this->Superclass1::GenerateData();
+    this->StorePyramidInCache();
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* GetPyramidCacheKey ***********************
+ */
+
+template< class TElastix >
+std::string
+FixedGenericPyramid< TElastix >
+::GetPyramidCacheKey( void ) const
+{
+  std::ostringstream key( "" );
+  key << this->Superclass2::GetPyramidCacheKey()
+      << " rescale " << this->GetRescaleSchedule()
+      << " smoothing " << this->GetSmoothingSchedule()
+      << " fused " << this->GetUseFusedSmoothingAndShrinking();
+  return key.str();
+
+} // end GetPyramidCacheKey()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxFixedGenericPyramid_hxx
@@ -21,6 +21,27 @@
 
 #include "elxFixedRecursivePyramid.h"
 
-//nothing
+namespace elastix
+{
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TElastix >
+void
+FixedRecursivePyramid< TElastix >
+::GenerateData( void )
+{
+  if( !this->GraftPyramidFromCache() )
+  {
+    this->Superclass1::GenerateData();
+    this->StorePyramidInCache();
+  }
+
+} // end GenerateData()
+
+
+} // end namespace elastix
 
 #endif //#ifndef __elxFixedRecursivePyramid_hxx
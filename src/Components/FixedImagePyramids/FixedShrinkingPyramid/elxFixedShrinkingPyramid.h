@@ -94,6 +94,11 @@ protected:
   /** The destructor. */
   virtual ~FixedShrinkingPyramid() {}
 
+  /** Takes the levels from the fixed image preprocessing cache, or computes
+   * and stores them, see FixedImagePyramidBase::GraftPyramidFromCache().
+   */
+  virtual void GenerateData( void );
+
 private:
 
   /** The private constructor. */
@@ -22,6 +22,26 @@
 #include "elxFixedSmoothingPyramid.h"
 
 namespace elastix
-{} // end namespace elastix
+{
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template< class TElastix >
+void
+FixedSmoothingPyramid< TElastix >
+::GenerateData( void )
+{
+  if( !this->GraftPyramidFromCache() )
+  {
+    this->Superclass1::GenerateData();
+    this->StorePyramidInCache();
+  }
+
+} // end GenerateData()
+
+
+} // end namespace elastix
 
 #endif //#ifndef __elxFixedSmoothingPyramid_hxx
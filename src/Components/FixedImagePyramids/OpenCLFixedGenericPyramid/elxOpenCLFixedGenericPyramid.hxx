@@ -29,6 +29,7 @@
 #include "itkGPURecursiveGaussianImageFilterFactory.h"
 #include "itkGPUCastImageFilterFactory.h"
 #include "itkGPUShrinkImageFilterFactory.h"
+#include "itkGPUGaussianSmoothAndShrinkImageFilterFactory.h"
 #include "itkGPUResampleImageFilterFactory.h"
 #include "itkGPUIdentityTransformFactory.h"
 #include "itkGPULinearInterpolateImageFunctionFactory.h"
@@ -121,6 +122,7 @@ OpenCLFixedGenericPyramid< TElastix >
     this->m_GPUPyramid->SetRescaleSchedule( this->GetRescaleSchedule() );
     this->m_GPUPyramid->SetSmoothingSchedule( this->GetSmoothingSchedule() );
     this->m_GPUPyramid->SetUseShrinkImageFilter( this->GetUseShrinkImageFilter() );
+    this->m_GPUPyramid->SetUseFusedSmoothingAndShrinking( this->GetUseFusedSmoothingAndShrinking() );
     this->m_GPUPyramid->SetComputeOnlyForCurrentLevel( this->GetComputeOnlyForCurrentLevel() );
   }
 
@@ -234,6 +236,8 @@ OpenCLFixedGenericPyramid< TElastix >
     CastFactoryType;
   typedef itk::GPUShrinkImageFilterFactory2< OpenCLImageTypes, OpenCLImageTypes, OpenCLImageDimentions >
     ShrinkFactoryType;
+  typedef itk::GPUGaussianSmoothAndShrinkImageFilterFactory2< OpenCLImageTypes, OpenCLImageTypes, OpenCLImageDimentions >
+    SmoothAndShrinkFactoryType;
   typedef itk::GPUResampleImageFilterFactory2< OpenCLImageTypes, OpenCLImageTypes, OpenCLImageDimentions >
     ResampleFactoryType;
   typedef itk::GPUIdentityTransformFactory2< OpenCLImageDimentions >
@@ -250,6 +254,8 @@ OpenCLFixedGenericPyramid< TElastix >
     = CastFactoryType::New();
   typename ShrinkFactoryType::Pointer shrinkFactory
     = ShrinkFactoryType::New();
+  typename SmoothAndShrinkFactoryType::Pointer smoothAndShrinkFactory
+    = SmoothAndShrinkFactoryType::New();
   typename ResampleFactoryType::Pointer resampleFactory
     = ResampleFactoryType::New();
   typename IdentityFactoryType::Pointer identityFactory
@@ -262,6 +268,7 @@ OpenCLFixedGenericPyramid< TElastix >
   itk::ObjectFactoryBase::RegisterFactory( recursiveFactory );
   itk::ObjectFactoryBase::RegisterFactory( castFactory );
   itk::ObjectFactoryBase::RegisterFactory( shrinkFactory );
+  itk::ObjectFactoryBase::RegisterFactory( smoothAndShrinkFactory );
   itk::ObjectFactoryBase::RegisterFactory( resampleFactory );
   itk::ObjectFactoryBase::RegisterFactory( identityFactory );
   itk::ObjectFactoryBase::RegisterFactory( linearFactory );
@@ -271,6 +278,7 @@ OpenCLFixedGenericPyramid< TElastix >
   this->m_Factories.push_back( recursiveFactory.GetPointer() );
   this->m_Factories.push_back( castFactory.GetPointer() );
   this->m_Factories.push_back( shrinkFactory.GetPointer() );
+  this->m_Factories.push_back( smoothAndShrinkFactory.GetPointer() );
   this->m_Factories.push_back( resampleFactory.GetPointer() );
   this->m_Factories.push_back( identityFactory.GetPointer() );
   this->m_Factories.push_back( linearFactory.GetPointer() );
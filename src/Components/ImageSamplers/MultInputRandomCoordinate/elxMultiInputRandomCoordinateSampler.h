@@ -19,6 +19,7 @@
 #define __elxMultiInputRandomCoordinateSampler_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkRegistrationCheckpoint.h"
 #include "itkMultiInputImageRandomCoordinateSampler.h"
 
 namespace elastix
@@ -75,6 +76,12 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter UseCounterBasedRandomGenerator: Defines whether the sample coordinates are
+ *    computed by a counter-based random generator, keyed on the RandomSeed, the number of
+ *    times new samples were selected, and the sample index. The samples are then generated
+ *    in parallel, also when masks are used, and do not depend on the number of threads.\n
+ *    example: <tt>(UseCounterBasedRandomGenerator "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
  *
  * \ingroup ImageSamplers
  * \sa MultiResolutionRegistrationWithFeatures
@@ -152,9 +159,16 @@ public:
    * \li Set the number of samples.
    * \li Set the fixed image interpolation order
    * \li Set the UseRandomSampleRegion flag and the SampleRegionSize
+   * \li Set the UseCounterBasedRandomGenerator flag and the seed
    */
   virtual void BeforeEachResolution( void );
 
+  /** Save and restore the number of updates of the counter-based random
+   * generator, such that a resumed registration uses the same samples. */
+  virtual void WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const;
+
+  virtual void ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint );
+
 protected:
 
   /** The constructor. */
@@ -57,6 +57,16 @@ MultiInputRandomCoordinateSampler< TElastix >
     "UseRandomSampleRegion", this->GetComponentLabel(), level, 0 );
   this->SetUseRandomSampleRegion( useRandomSampleRegion );
 
+  /** Set the UseCounterBasedRandomGenerator bool, and use the same seed as
+   * the global random generator, see elx::ElastixBase::BeforeAllBase(). */
+  bool useCounterBasedRandomGenerator = false;
+  this->GetConfiguration()->ReadParameter( useCounterBasedRandomGenerator,
+    "UseCounterBasedRandomGenerator", this->GetComponentLabel(), level, 0 );
+  this->SetUseCounterBasedRandomGenerator( useCounterBasedRandomGenerator );
+  unsigned int randomSeed = 121212;
+  this->GetConfiguration()->ReadParameter( randomSeed, "RandomSeed", 0, false );
+  this->SetSeed( randomSeed );
+
   /** Set the SampleRegionSize. */
   if( useRandomSampleRegion )
   {
@@ -93,6 +103,40 @@ MultiInputRandomCoordinateSampler< TElastix >
 }   // end BeforeEachResolution
 
 
+/**
+ * ******************* WriteCheckpoint ******************
+ */
+
+template< class TElastix >
+void
+MultiInputRandomCoordinateSampler< TElastix >
+::WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const
+{
+  checkpoint.SetEntry( std::string( this->GetComponentLabel() ) + ".NumberOfUpdates",
+    static_cast< double >( this->GetNumberOfUpdates() ) );
+
+}   // end WriteCheckpoint
+
+
+/**
+ * ******************* ReadCheckpoint ******************
+ */
+
+template< class TElastix >
+void
+MultiInputRandomCoordinateSampler< TElastix >
+::ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint )
+{
+  double numberOfUpdates = 0.0;
+  if( checkpoint.GetEntry( std::string( this->GetComponentLabel() ) + ".NumberOfUpdates", numberOfUpdates ) )
+  {
+    this->SetNumberOfUpdates(
+      static_cast< itk::PhiloxRandomNumberGenerator::WordType >( numberOfUpdates ) );
+  }
+
+}   // end ReadCheckpoint
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxMultiInputRandomCoordinateSampler_hxx
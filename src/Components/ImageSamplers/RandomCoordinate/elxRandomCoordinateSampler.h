@@ -19,6 +19,7 @@
 #define __elxRandomCoordinateSampler_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkRegistrationCheckpoint.h"
 #include "itkImageRandomCoordinateSampler.h"
 
 namespace elastix
@@ -70,6 +71,30 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter UseCounterBasedRandomGenerator: Defines whether the sample coordinates are
+ *    computed by a counter-based random generator, keyed on the RandomSeed, the number of
+ *    times new samples were selected, and the sample index. The samples are then generated
+ *    in parallel, also when a mask is used, and do not depend on the number of threads.\n
+ *    example: <tt>(UseCounterBasedRandomGenerator "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
+ * \parameter UseBackgroundPrefetch: Defines whether the samples of the next iteration are
+ *    generated on a background thread, while the current iteration is computed. This
+ *    removes the sampler from the critical path when NewSamplesEveryIteration is used.
+ *    The selected samples are the same as without prefetching.
+ *    Requires UseCounterBasedRandomGenerator "true".\n
+ *    example: <tt>(UseBackgroundPrefetch "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
+ * \parameter SortSamplesInMortonOrder: Defines whether the samples of every iteration are
+ *    sorted along a Morton (Z-order) curve. The same samples are selected, but nearby
+ *    samples are processed together, which improves the cache use of the metric.\n
+ *    example: <tt>(SortSamplesInMortonOrder "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
+ * \parameter UseStratifiedSampling: Defines whether the samples are drawn on a jittered
+ *    grid: the sample region is divided into about NumberOfSpatialSamples cells, and
+ *    every cell gets one random sample. The samples cover the region more evenly,
+ *    which reduces the noise in the metric derivative.\n
+ *    example: <tt>(UseStratifiedSampling "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
  *
  * \ingroup ImageSamplers
  */
@@ -149,6 +174,12 @@ public:
    */
   virtual void BeforeEachResolution( void );
 
+  /** Save and restore the number of updates of the counter-based random
+   * generator, such that a resumed registration uses the same samples. */
+  virtual void WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const;
+
+  virtual void ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint );
+
 protected:
 
   /** The constructor. */
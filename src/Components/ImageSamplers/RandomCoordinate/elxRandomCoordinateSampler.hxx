@@ -68,6 +68,41 @@ RandomCoordinateSampler< TElastix >
     "UseRandomSampleRegion", this->GetComponentLabel(), level, 0 );
   this->SetUseRandomSampleRegion( useRandomSampleRegion );
 
+  /** Set the UseCounterBasedRandomGenerator bool, and use the same seed as
+   * the global random generator, see elx::ElastixBase::BeforeAllBase(). */
+  bool useCounterBasedRandomGenerator = false;
+  this->GetConfiguration()->ReadParameter( useCounterBasedRandomGenerator,
+    "UseCounterBasedRandomGenerator", this->GetComponentLabel(), level, 0 );
+  this->SetUseCounterBasedRandomGenerator( useCounterBasedRandomGenerator );
+  unsigned int randomSeed = 121212;
+  this->GetConfiguration()->ReadParameter( randomSeed, "RandomSeed", 0, false );
+  this->SetSeed( randomSeed );
+
+  /** Set the UseBackgroundPrefetch bool. */
+  bool useBackgroundPrefetch = false;
+  this->GetConfiguration()->ReadParameter( useBackgroundPrefetch,
+    "UseBackgroundPrefetch", this->GetComponentLabel(), level, 0 );
+  if( useBackgroundPrefetch && !useCounterBasedRandomGenerator )
+  {
+    xl::xout[ "warning" ]
+      << "WARNING: UseBackgroundPrefetch requires UseCounterBasedRandomGenerator \"true\".\n"
+      << "  The samples are not prefetched." << std::endl;
+    useBackgroundPrefetch = false;
+  }
+  this->SetUseBackgroundPrefetch( useBackgroundPrefetch );
+
+  /** Set the SortSamplesInMortonOrder bool. */
+  bool sortSamplesInMortonOrder = false;
+  this->GetConfiguration()->ReadParameter( sortSamplesInMortonOrder,
+    "SortSamplesInMortonOrder", this->GetComponentLabel(), level, 0 );
+  this->SetSortSamplesInMortonOrder( sortSamplesInMortonOrder );
+
+  /** Set the UseStratifiedSampling bool. */
+  bool useStratifiedSampling = false;
+  this->GetConfiguration()->ReadParameter( useStratifiedSampling,
+    "UseStratifiedSampling", this->GetComponentLabel(), level, 0 );
+  this->SetUseStratifiedSampling( useStratifiedSampling );
+
   /** Set the SampleRegionSize. */
   if( useRandomSampleRegion )
   {
@@ -118,6 +153,40 @@ RandomCoordinateSampler< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* WriteCheckpoint ******************
+ */
+
+template< class TElastix >
+void
+RandomCoordinateSampler< TElastix >
+::WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const
+{
+  checkpoint.SetEntry( std::string( this->GetComponentLabel() ) + ".NumberOfUpdates",
+    static_cast< double >( this->GetNumberOfUpdates() ) );
+
+} // end WriteCheckpoint()
+
+
+/**
+ * ******************* ReadCheckpoint ******************
+ */
+
+template< class TElastix >
+void
+RandomCoordinateSampler< TElastix >
+::ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint )
+{
+  double numberOfUpdates = 0.0;
+  if( checkpoint.GetEntry( std::string( this->GetComponentLabel() ) + ".NumberOfUpdates", numberOfUpdates ) )
+  {
+    this->SetNumberOfUpdates(
+      static_cast< itk::PhiloxRandomNumberGenerator::WordType >( numberOfUpdates ) );
+  }
+
+} // end ReadCheckpoint()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxRandomCoordinateSampler_hxx
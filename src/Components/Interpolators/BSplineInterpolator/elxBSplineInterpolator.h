@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 
 namespace elastix
 {
@@ -35,6 +36,9 @@ namespace elastix
  * but it determines the derivative slightly more accurate at grid points. That's
  * why the registration results can be slightly different.
  *
+ * The B-spline coefficients are stored in double precision, or in single
+ * precision when elastix is built with ELASTIX_USE_FLOAT_INTERNALS.
+ *
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "BSplineInterpolator")</tt>
@@ -52,7 +56,7 @@ class BSplineInterpolator :
   itk::BSplineInterpolateImageFunction<
   typename InterpolatorBase< TElastix >::InputImageType,
   typename InterpolatorBase< TElastix >::CoordRepType,
-  double >,        //CoefficientType
+  itk::InternalBufferRealType >, //CoefficientType
   public
   InterpolatorBase< TElastix >
 {
@@ -63,7 +67,7 @@ public:
   typedef itk::BSplineInterpolateImageFunction<
     typename InterpolatorBase< TElastix >::InputImageType,
     typename InterpolatorBase< TElastix >::CoordRepType,
-    double >                                  Superclass1;
+    itk::InternalBufferRealType >         Superclass1;
   typedef InterpolatorBase< TElastix >    Superclass2;
   typedef itk::SmartPointer< Self >       Pointer;
   typedef itk::SmartPointer< const Self > ConstPointer;
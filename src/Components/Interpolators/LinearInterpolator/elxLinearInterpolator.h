@@ -36,6 +36,11 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "LinearInterpolator")</tt>
+ * \parameter UseBrickedImageLayout: whether the interpolator copies the moving image
+ *    to a memory layout of small bricks, which reduces the number of cache misses
+ *    when sampling randomly in large images. The copy is made once per resolution.\n
+ *    example: <tt>(UseBrickedImageLayout "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
@@ -90,6 +95,11 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** Execute stuff before each new pyramid resolution:
+   * \li Set the memory layout.
+   */
+  virtual void BeforeEachResolution( void );
+
 protected:
 
   /** The constructor. */
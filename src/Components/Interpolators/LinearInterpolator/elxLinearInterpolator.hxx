@@ -24,7 +24,26 @@
 namespace elastix
 {
 
-/** Nothing */
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+LinearInterpolator< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Read whether the moving image is copied to a bricked layout. */
+  bool useBrickedImageLayout = false;
+  this->GetConfiguration()->ReadParameter( useBrickedImageLayout,
+    "UseBrickedImageLayout", this->GetComponentLabel(), level, 0 );
+  this->SetUseBrickedImageLayout( useBrickedImageLayout );
+
+} // end BeforeEachResolution()
 
 } // end namespace elastix
 
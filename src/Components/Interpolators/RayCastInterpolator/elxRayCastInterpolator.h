@@ -36,6 +36,14 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "RayCastInterpolator")</tt>
+ * \parameter UseEmptySpaceSkipping: Whether the rays skip blocks of voxels that are all at or
+ *    below the Threshold, without interpolating. Can be given for each resolution, or for all
+ *    resolutions at once. \n
+ *    example: <tt>(UseEmptySpaceSkipping "true")</tt> \n
+ *    The default value is "false".
+ * \parameter EmptySpaceBlockSize: The size in voxels of the blocks used by UseEmptySpaceSkipping. \n
+ *    example: <tt>(EmptySpaceBlockSize 8)</tt> \n
+ *    The default value is 8.
  *
  * \ingroup Interpolators
  */
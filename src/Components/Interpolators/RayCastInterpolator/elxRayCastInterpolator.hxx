@@ -116,6 +116,17 @@ RayCastInterpolator< TElastix >
   this->GetConfiguration()->ReadParameter( threshold, "Threshold", this->GetComponentLabel(), level, 0 );
   this->SetThreshold( threshold );
 
+  /** Set whether empty blocks of voxels are skipped. */
+  unsigned int emptySpaceBlockSize = 8;
+  this->GetConfiguration()->ReadParameter( emptySpaceBlockSize,
+    "EmptySpaceBlockSize", this->GetComponentLabel(), level, 0 );
+  this->SetEmptySpaceBlockSize( emptySpaceBlockSize );
+
+  bool useEmptySpaceSkipping = false;
+  this->GetConfiguration()->ReadParameter( useEmptySpaceSkipping,
+    "UseEmptySpaceSkipping", this->GetComponentLabel(), level, 0 );
+  this->SetUseEmptySpaceSkipping( useEmptySpaceSkipping );
+
 } // end BeforeEachResolution()
 
 
@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 
 namespace elastix
 {
@@ -40,6 +41,11 @@ namespace elastix
  *    The default order is 1. The parameter can be specified for each resolution.\n
  *    If only given for one resolution, that value is used for the other resolutions as well. \n
  *    Currently only first order B-spline interpolation is supported.
+ * \parameter UseBrickedImageLayout: whether the interpolator copies the B-spline coefficients
+ *    to a memory layout of small bricks, which reduces the number of cache misses
+ *    when sampling randomly in large images. The copy is made once per resolution.\n
+ *    example: <tt>(UseBrickedImageLayout "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
@@ -50,7 +56,7 @@ class ReducedDimensionBSplineInterpolator :
   itk::ReducedDimensionBSplineInterpolateImageFunction<
   typename InterpolatorBase< TElastix >::InputImageType,
   typename InterpolatorBase< TElastix >::CoordRepType,
-  double >,        //CoefficientType
+  itk::InternalBufferRealType >, //CoefficientType
   public
   InterpolatorBase< TElastix >
 {
@@ -61,7 +67,7 @@ public:
   typedef itk::ReducedDimensionBSplineInterpolateImageFunction<
     typename InterpolatorBase< TElastix >::InputImageType,
     typename InterpolatorBase< TElastix >::CoordRepType,
-    double >                                  Superclass1;
+    itk::InternalBufferRealType >         Superclass1;
   typedef InterpolatorBase< TElastix >    Superclass2;
   typedef itk::SmartPointer< Self >       Pointer;
   typedef itk::SmartPointer< const Self > ConstPointer;
@@ -105,6 +111,7 @@ public:
 
   /** Execute stuff before each new pyramid resolution:
    * \li Set the spline order.
+   * \li Set the memory layout.
    */
   virtual void BeforeEachResolution( void );
 
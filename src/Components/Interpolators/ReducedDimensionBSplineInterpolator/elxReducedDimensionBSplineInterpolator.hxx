@@ -54,6 +54,12 @@ ReducedDimensionBSplineInterpolator< TElastix >
   /** Set the splineOrder. */
   this->SetSplineOrder( splineOrder );
 
+  /** Read whether the coefficients are copied to a bricked layout. */
+  bool useBrickedImageLayout = false;
+  this->GetConfiguration()->ReadParameter( useBrickedImageLayout,
+    "UseBrickedImageLayout", this->GetComponentLabel(), level, 0 );
+  this->SetUseBrickedImageLayout( useBrickedImageLayout );
+
 } // end BeforeEachResolution()
 
 
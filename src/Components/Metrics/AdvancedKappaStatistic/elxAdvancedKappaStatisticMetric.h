@@ -40,6 +40,11 @@ namespace elastix
  *    calculated.\n
  *    <tt>(ForeGroundvalue 3.5)</tt>\n
  *    The default value is 1.0.
+ * \parameter UseBitPackedLabels: threshold the moving image once per resolution
+ *    into bit-packed labels, which are looked up with nearest neighbour
+ *    interpolation, and count the overlap per block of 64 samples.\n
+ *    <tt>(UseBitPackedLabels "true")</tt>\n
+ *    The default value is false.
  *
  * \ingroup Metrics
  *
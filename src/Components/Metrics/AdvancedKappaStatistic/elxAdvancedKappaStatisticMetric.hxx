@@ -75,6 +75,12 @@ AdvancedKappaStatisticMetric< TElastix >
     "ForegroundValue", this->GetComponentLabel(), 0, -1 );
   this->SetForegroundValue( foreground );
 
+  /** Get and set the use of the bit-packed moving labels. */
+  bool useBitPackedLabels = false;
+  this->GetConfiguration()->ReadParameter( useBitPackedLabels,
+    "UseBitPackedLabels", this->GetComponentLabel(), 0, -1 );
+  this->SetUseBitPackedLabels( useBitPackedLabels );
+
 } // end BeforeRegistration()
 
 
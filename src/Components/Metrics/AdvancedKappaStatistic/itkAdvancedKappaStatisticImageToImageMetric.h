@@ -20,6 +20,8 @@
 
 #include "itkAdvancedImageToImageMetric.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -47,6 +49,12 @@ namespace itk
  * (perfect foreground alignment).  When dealing with optimizers that can
  * only minimize a metric, use the ComplementOn() method.
  *
+ * With UseBitPackedLabelsOn() the moving image is thresholded once per
+ * resolution into a bit-packed label image, which is looked up with nearest
+ * neighbour interpolation. The areas are then counted per block of 64 samples
+ * with a population count, and the derivative is only evaluated for the
+ * samples at a label boundary, where the precomputed gradient is nonzero.
+ *
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -145,6 +153,9 @@ public:
     const TransformParametersType & parameters,
     MeasureType & Value, DerivativeType & Derivative ) const;
 
+  /** Initialize the metric; builds the bit-packed moving labels when requested. */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
   /** Computes the moving gradient image dM/dx. */
   virtual void ComputeGradient( void );
 
@@ -171,6 +182,15 @@ public:
   itkSetMacro( Epsilon, RealType );
   itkGetConstReferenceMacro( Epsilon, RealType );
 
+  /** Set/Get whether the foreground of the moving image is thresholded into a
+   * bit-packed label image, which is evaluated by nearest neighbour lookup
+   * instead of by the interpolator. Takes effect at the next Initialize().
+   * The default is false.
+   */
+  itkSetMacro( UseBitPackedLabels, bool );
+  itkGetConstMacro( UseBitPackedLabels, bool );
+  itkBooleanMacro( UseBitPackedLabels );
+
 protected:
 
   AdvancedKappaStatisticImageToImageMetric();
@@ -193,6 +213,11 @@ protected:
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
 
+  /** Typedefs for the bit-packed labels. */
+  typedef uint64_t                                  LabelWordType;
+  typedef std::vector< LabelWordType >              LabelBitsType;
+  typedef typename MovingImageType::OffsetValueType LabelOffsetValueType;
+
   /** Compute a pixel's contribution to the measure and derivatives;
    * Called by GetValueAndDerivative().
    */
@@ -232,6 +257,27 @@ private:
   RealType m_ForegroundValue;
   RealType m_Epsilon;
   bool     m_Complement;
+  bool     m_UseBitPackedLabels;
+
+  /** The thresholded moving image, one bit per voxel in raster order. */
+  LabelBitsType         m_MovingLabelBits;
+  MovingImageRegionType m_MovingLabelRegion;
+  LabelOffsetValueType  m_MovingLabelStrides[ MovingImageDimension ];
+
+  /** Returns whether a label value belongs to the foreground. */
+  bool IsForeground( const RealType & value ) const;
+
+  /** Threshold the moving image into m_MovingLabelBits. */
+  void ComputeMovingLabelBits( void );
+
+  /** Get the raster offset of the voxel nearest to a mapped point.
+   * Returns false if that voxel is outside the moving image buffer.
+   */
+  bool GetMovingLabelOffset( const MovingImagePointType & mappedPoint,
+    LabelOffsetValueType & offset ) const;
+
+  /** Counts the set bits of a word of packed labels. */
+  static unsigned int PopCount( LabelWordType word );
 
   /** Threading related parameters. */
 
@@ -254,6 +300,10 @@ private:
     SizeValueType  st_AreaIntersection;
     DerivativeType st_DerivativeSum1;
     DerivativeType st_DerivativeSum2;
+    // Scratch buffers of the per-sample computations
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    DerivativeType             st_ImageJacobian;
+    TransformJacobianType      st_TransformJacobian;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, KappaGetValueAndDerivativePerThreadStruct,
     PaddedKappaGetValueAndDerivativePerThreadStruct );
@@ -262,6 +312,18 @@ private:
   mutable AlignedKappaGetValueAndDerivativePerThreadStruct * m_KappaGetValueAndDerivativePerThreadVariables;
   mutable ThreadIdType                                       m_KappaGetValueAndDerivativePerThreadVariablesSize;
 
+  /** Compute the areas of the samples [begin, end) in the bit-packed label
+   * mode, where begin is a multiple of 64. The derivative sums are updated
+   * as well when derivativeVariables is not NULL.
+   */
+  void ComputeBitPackedLabelTerms(
+    const SizeValueType begin, const SizeValueType end,
+    std::size_t & fixedForegroundArea,
+    std::size_t & movingForegroundArea,
+    std::size_t & intersection,
+    SizeValueType & numberOfPixelsCounted,
+    KappaGetValueAndDerivativePerThreadStruct * derivativeVariables ) const;
+
 };
 
 } // end namespace itk
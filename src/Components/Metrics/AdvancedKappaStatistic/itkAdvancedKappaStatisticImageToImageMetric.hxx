@@ -19,6 +19,9 @@
 #define _itkAdvancedKappaStatisticImageToImageMetric_hxx
 
 #include "itkAdvancedKappaStatisticImageToImageMetric.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -40,6 +43,7 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   this->m_ForegroundValue    = 1.0;
   this->m_Epsilon            = 1e-3;
   this->m_Complement         = true;
+  this->m_UseBitPackedLabels = false;
 
   // Multi-threading structs
   this->m_KappaGetValueAndDerivativePerThreadVariables     = NULL;
@@ -85,8 +89,9 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   }
 
   /** Some initialization. */
-  const SizeValueType       zero1 = NumericTraits< SizeValueType >::Zero;
-  const DerivativeValueType zero2 = NumericTraits< DerivativeValueType >::Zero;
+  const SizeValueType          zero1 = NumericTraits< SizeValueType >::Zero;
+  const DerivativeValueType    zero2 = NumericTraits< DerivativeValueType >::Zero;
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
   for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
   {
     this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = zero1;
@@ -96,6 +101,8 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
     this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeSum2.SetSize( this->GetNumberOfParameters() );
     this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeSum1.Fill( zero2 );
     this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeSum2.Fill( zero2 );
+    this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_NonZeroJacobianIndices.resize( nnzji );
+    this->m_KappaGetValueAndDerivativePerThreadVariables[ i ].st_ImageJacobian.SetSize( nnzji );
   }
 
 } // end InitializeThreadingParameters()
@@ -118,10 +125,37 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
      << ( this->m_Complement ? "On" : "Off" ) << std::endl;
   os << indent << "ForegroundValue: " << this->m_ForegroundValue << std::endl;
   os << indent << "Epsilon: " << this->m_Epsilon << std::endl;
+  os << indent << "UseBitPackedLabels: "
+     << ( this->m_UseBitPackedLabels ? "On" : "Off" ) << std::endl;
 
 } // end PrintSelf()
 
 
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Initialize transform, interpolator, etc. This also computes the gradient image. */
+  Superclass::Initialize();
+
+  /** Threshold the moving image, or release a previous thresholding. */
+  if( this->m_UseBitPackedLabels )
+  {
+    this->ComputeMovingLabelBits();
+  }
+  else
+  {
+    LabelBitsType().swap( this->m_MovingLabelBits );
+  }
+
+} // end Initialize()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -167,60 +201,72 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   std::size_t          movingForegroundArea = 0;
   std::size_t          intersection         = 0;
 
-  /** Loop over the fixed image samples to calculate the kappa statistic. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** In the bit-packed label mode, count the areas per block of samples. */
+  if( this->m_UseBitPackedLabels )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside moving mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, 0 );
-    }
-
-    /** Do the actual calculation of the metric value. */
-    if( sampleOk )
+    SizeValueType numberOfPixelsCounted = 0;
+    this->ComputeBitPackedLabelTerms( 0, sampleContainer->Size(),
+      fixedForegroundArea, movingForegroundArea, intersection,
+      numberOfPixelsCounted, NULL );
+    this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+  }
+  else
+  {
+    /** Loop over the fixed image samples to calculate the kappa statistic. */
+    for( fiter = fbegin; fiter != fend; ++fiter )
     {
-      this->m_NumberOfPixelsCounted++;
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-      /** Update the intermediate values. */
-      if( this->m_UseForegroundValue )
+      /** Check if point is inside moving mask. */
+      if( sampleOk )
       {
-        const RealType diffFixed  = vnl_math_abs( fixedImageValue - this->m_ForegroundValue );
-        const RealType diffMoving = vnl_math_abs( movingImageValue - this->m_ForegroundValue );
-        if( diffFixed < this->m_Epsilon ) { fixedForegroundArea++; }
-        if( diffMoving < this->m_Epsilon ) { movingForegroundArea++; }
-        if( diffFixed < this->m_Epsilon
-          && diffMoving < this->m_Epsilon ) { intersection++; }
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
       }
-      else
+
+      /** Compute the moving image value and check if the point is
+       * inside the moving image buffer.
+       */
+      if( sampleOk )
       {
-        if( fixedImageValue  > this->m_Epsilon ) { fixedForegroundArea++; }
-        if( movingImageValue > this->m_Epsilon ) { movingForegroundArea++; }
-        if( fixedImageValue  > this->m_Epsilon
-          && movingImageValue > this->m_Epsilon ) { intersection++; }
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, 0 );
       }
 
-    } // end if samplOk
+      /** Do the actual calculation of the metric value. */
+      if( sampleOk )
+      {
+        this->m_NumberOfPixelsCounted++;
 
-  } // end for loop over the image sample container
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue
+          = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+
+        /** Update the intermediate values. */
+        if( this->m_UseForegroundValue )
+        {
+          const RealType diffFixed  = vnl_math_abs( fixedImageValue - this->m_ForegroundValue );
+          const RealType diffMoving = vnl_math_abs( movingImageValue - this->m_ForegroundValue );
+          if( diffFixed < this->m_Epsilon ) { fixedForegroundArea++; }
+          if( diffMoving < this->m_Epsilon ) { movingForegroundArea++; }
+          if( diffFixed < this->m_Epsilon
+            && diffMoving < this->m_Epsilon ) { intersection++; }
+        }
+        else
+        {
+          if( fixedImageValue  > this->m_Epsilon ) { fixedForegroundArea++; }
+          if( movingImageValue > this->m_Epsilon ) { movingForegroundArea++; }
+          if( fixedImageValue  > this->m_Epsilon
+            && movingImageValue > this->m_Epsilon ) { intersection++; }
+        }
+
+      } // end if samplOk
+
+    } // end for loop over the image sample container
+  }
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
@@ -323,57 +369,79 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
-  /** Loop over the fixed image to calculate the kappa statistic. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** In the bit-packed label mode, count the areas per block of samples. */
+  if( this->m_UseBitPackedLabels )
   {
-    /** Read fixed coordinates. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    KappaGetValueAndDerivativePerThreadStruct derivativeVariables;
+    derivativeVariables.st_DerivativeSum1.SetSize( this->GetNumberOfParameters() );
+    derivativeVariables.st_DerivativeSum2.SetSize( this->GetNumberOfParameters() );
+    derivativeVariables.st_DerivativeSum1.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    derivativeVariables.st_DerivativeSum2.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    derivativeVariables.st_NonZeroJacobianIndices.resize( nzji.size() );
+    derivativeVariables.st_ImageJacobian.SetSize( nzji.size() );
+
+    SizeValueType numberOfPixelsCounted = 0;
+    this->ComputeBitPackedLabelTerms( 0, sampleContainer->Size(),
+      fixedForegroundArea, movingForegroundArea, intersection,
+      numberOfPixelsCounted, &derivativeVariables );
+    this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+    vecSum1                       = derivativeVariables.st_DerivativeSum1;
+    vecSum2                       = derivativeVariables.st_DerivativeSum2;
+  }
+  else
+  {
+    /** Loop over the fixed image to calculate the kappa statistic. */
+    for( fiter = fbegin; fiter != fend; ++fiter )
+    {
+      /** Read fixed coordinates. */
+      const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-    /** Check if point is inside moving mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+      /** Check if point is inside moving mask. */
+      if( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    MovingImageDerivativeType movingImageDerivative;
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      MovingImageDerivativeType movingImageDerivative;
+      if( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative );
+      }
 
-    /** Do the actual calculation of the metric value. */
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
+      /** Do the actual calculation of the metric value. */
+      if( sampleOk )
+      {
+        this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue
+          = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        fixedForegroundArea, movingForegroundArea, intersection,
-        imageJacobian, nzji,
-        vecSum1, vecSum2 );
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValue,
+          fixedForegroundArea, movingForegroundArea, intersection,
+          imageJacobian, nzji,
+          vecSum1, vecSum2 );
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the image sample container
+  }
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
@@ -460,10 +528,15 @@ void
 AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nzji.size() );
+  /** Get handles to the pre-allocated arrays that store dM(x)/dmu, the sparse
+   * Jacobian indices, and the Jacobian, so that no memory is allocated here.
+   */
+  NonZeroJacobianIndicesType & nzji
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_NonZeroJacobianIndices;
+  DerivativeType & imageJacobian
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_ImageJacobian;
+  TransformJacobianType & jacobian
+    = this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_TransformJacobian;
 
   /** Get handles to the pre-allocated derivatives for the current thread.
    * The initialization is performed at the beginning of each resolution in
@@ -487,6 +560,29 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
   pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
+  /** In the bit-packed label mode every thread handles whole blocks of 64 samples. */
+  if( this->m_UseBitPackedLabels )
+  {
+    const unsigned long nrOfBlocks = ( sampleContainerSize + 63 ) / 64;
+    const unsigned long nrOfBlocksPerThread
+      = ( nrOfBlocks + this->m_NumberOfThreads - 1 ) / this->m_NumberOfThreads;
+    pos_begin = std::min( 64 * nrOfBlocksPerThread * threadId, sampleContainerSize );
+    pos_end   = std::min( 64 * nrOfBlocksPerThread * ( threadId + 1 ), sampleContainerSize );
+
+    std::size_t   fixedForegroundArea   = 0;
+    std::size_t   movingForegroundArea  = 0;
+    std::size_t   intersection          = 0;
+    SizeValueType numberOfPixelsCounted = 0;
+    this->ComputeBitPackedLabelTerms( pos_begin, pos_end,
+      fixedForegroundArea, movingForegroundArea, intersection,
+      numberOfPixelsCounted, &this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ] );
+
+    this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+    this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_AreaSum               = fixedForegroundArea + movingForegroundArea;
+    this->m_KappaGetValueAndDerivativePerThreadVariables[ threadId ].st_AreaIntersection      = intersection;
+    return;
+  }
+
   /** Some variables. */
   RealType             movingImageValue;
   MovingImagePointType mappedPoint;
@@ -545,8 +641,8 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
         jacobian, movingImageDerivative, imageJacobian );
 #else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji, jacobian );
 #endif
 
       /** Compute this pixel's contribution to the measure and derivatives. */
@@ -643,8 +739,8 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
     temp->st_Coefficient2      = tmp2;
     temp->st_DerivativePointer = derivative.begin();
 
-    this->m_Threader->SetSingleMethod( AccumulateDerivativesThreaderCallback, temp );
-    this->m_Threader->SingleMethodExecute();
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, AccumulateDerivativesThreaderCallback, temp );
 
     delete temp;
   }
@@ -665,6 +761,8 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
   ThreadIdType     threadId    = infoStruct->ThreadID;
   ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
+  itkPhaseTimerThreadMacro( "AccumulateDerivatives", threadId );
+
   MultiThreaderAccumulateDerivativeType * temp
     = static_cast< MultiThreaderAccumulateDerivativeType * >( infoStruct->UserData );
 
@@ -772,6 +870,222 @@ AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
 } // end UpdateValueAndDerivativeTerms()
 
 
+/**
+ * *************** IsForeground ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::IsForeground( const RealType & value ) const
+{
+  if( this->m_UseForegroundValue )
+  {
+    return vnl_math_abs( value - this->m_ForegroundValue ) < this->m_Epsilon;
+  }
+  return value > this->m_Epsilon;
+
+} // end IsForeground()
+
+
+/**
+ * *************** PopCount ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+unsigned int
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::PopCount( LabelWordType word )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+  return static_cast< unsigned int >( __builtin_popcountll( word ) );
+#else
+  word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+  word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+  word = ( word + ( word >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast< unsigned int >( ( word * 0x0101010101010101ULL ) >> 56 );
+#endif
+
+} // end PopCount()
+
+
+/**
+ * *************** ComputeMovingLabelBits ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMovingLabelBits( void )
+{
+  /** The labels cover the buffered region, like the gradient image. */
+  this->m_MovingLabelRegion = this->m_MovingImage->GetBufferedRegion();
+  LabelOffsetValueType stride = 1;
+  for( unsigned int i = 0; i < MovingImageDimension; i++ )
+  {
+    this->m_MovingLabelStrides[ i ] = stride;
+    stride                         *= this->m_MovingLabelRegion.GetSize()[ i ];
+  }
+
+  /** Pack the thresholded voxels, in raster order. */
+  const SizeValueType numberOfVoxels = this->m_MovingLabelRegion.GetNumberOfPixels();
+  this->m_MovingLabelBits.assign( ( numberOfVoxels + 63 ) / 64, 0 );
+
+  typedef ImageRegionConstIterator< MovingImageType > MovingIteratorType;
+  MovingIteratorType mit( this->m_MovingImage, this->m_MovingLabelRegion );
+  SizeValueType      bit = 0;
+  for( mit.GoToBegin(); !mit.IsAtEnd(); ++mit, ++bit )
+  {
+    if( this->IsForeground( static_cast< RealType >( mit.Get() ) ) )
+    {
+      this->m_MovingLabelBits[ bit >> 6 ] |= static_cast< LabelWordType >( 1 ) << ( bit & 63 );
+    }
+  }
+
+} // end ComputeMovingLabelBits()
+
+
+/**
+ * *************** GetMovingLabelOffset ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::GetMovingLabelOffset( const MovingImagePointType & mappedPoint,
+  LabelOffsetValueType & offset ) const
+{
+  MovingImageContinuousIndexType cindex;
+  this->ConvertMovingPointToContinuousIndex( mappedPoint, cindex );
+
+  /** Round to the nearest voxel, as the nearest neighbour interpolator does. */
+  offset = 0;
+  for( unsigned int i = 0; i < MovingImageDimension; i++ )
+  {
+    const LabelOffsetValueType index
+      = static_cast< LabelOffsetValueType >( Math::Round< double >( cindex[ i ] ) )
+      - this->m_MovingLabelRegion.GetIndex()[ i ];
+    if( index < 0
+      || index >= static_cast< LabelOffsetValueType >( this->m_MovingLabelRegion.GetSize()[ i ] ) )
+    {
+      return false;
+    }
+    offset += index * this->m_MovingLabelStrides[ i ];
+  }
+
+  return true;
+
+} // end GetMovingLabelOffset()
+
+
+/**
+ * *************** ComputeBitPackedLabelTerms ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedKappaStatisticImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeBitPackedLabelTerms(
+  const SizeValueType begin, const SizeValueType end,
+  std::size_t & fixedForegroundArea,
+  std::size_t & movingForegroundArea,
+  std::size_t & intersection,
+  SizeValueType & numberOfPixelsCounted,
+  KappaGetValueAndDerivativePerThreadStruct * derivativeVariables ) const
+{
+  /** Get a handle to the sample container and the gradient image buffer,
+   * which is indexed by the same raster offset as the labels.
+   */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const GradientPixelType *   gradientBuffer  = this->m_GradientImage->GetBufferPointer();
+  MovingImagePointType        mappedPoint;
+  MovingImageDerivativeType   movingImageDerivative;
+
+  typename ImageSampleContainerType::ConstIterator fiter = sampleContainer->Begin();
+  fiter += (int)begin;
+
+  /** Loop over the blocks of 64 samples. */
+  for( SizeValueType blockBegin = begin; blockBegin < end; blockBegin += 64 )
+  {
+    const SizeValueType blockEnd = std::min( blockBegin + 64, end );
+    LabelWordType       validBits  = 0;
+    LabelWordType       fixedBits  = 0;
+    LabelWordType       movingBits = 0;
+    for( SizeValueType i = blockBegin; i < blockEnd; ++i, ++fiter )
+    {
+      const LabelWordType         bit        = static_cast< LabelWordType >( 1 ) << ( i - blockBegin );
+      const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+      const bool                  fixedForeground
+        = this->IsForeground( static_cast< RealType >( ( *fiter ).Value().m_ImageValue ) );
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+      /** Check if point is inside moving mask. */
+      if( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Look up the nearest moving voxel. */
+      LabelOffsetValueType offset = 0;
+      if( sampleOk )
+      {
+        sampleOk = this->GetMovingLabelOffset( mappedPoint, offset );
+      }
+      if( !sampleOk ) { continue; }
+
+      validBits |= bit;
+      if( fixedForeground ) { fixedBits |= bit; }
+      if( ( this->m_MovingLabelBits[ offset >> 6 ] >> ( offset & 63 ) ) & 1 ) { movingBits |= bit; }
+
+      /** Only samples at a label boundary, where the gradient is nonzero,
+       * contribute to the derivative.
+       */
+      if( derivativeVariables == NULL ) { continue; }
+      const GradientPixelType & gradient = gradientBuffer[ offset ];
+      bool                      zeroGradient = true;
+      for( unsigned int d = 0; d < MovingImageDimension; d++ )
+      {
+        movingImageDerivative[ d ] = gradient[ d ];
+        zeroGradient              &= ( gradient[ d ] == 0.0 );
+      }
+      if( zeroGradient ) { continue; }
+      this->ApplyMovingImageDerivativeScales( movingImageDerivative );
+
+      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      NonZeroJacobianIndicesType & nzji          = derivativeVariables->st_NonZeroJacobianIndices;
+      DerivativeType &             imageJacobian = derivativeVariables->st_ImageJacobian;
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji,
+        derivativeVariables->st_TransformJacobian );
+
+      /** Update the derivative sums, as in UpdateValueAndDerivativeTerms(). */
+      DerivativeType & sum1 = derivativeVariables->st_DerivativeSum1;
+      DerivativeType & sum2 = derivativeVariables->st_DerivativeSum2;
+      for( unsigned int j = 0; j < nzji.size(); ++j )
+      {
+        const unsigned int        index = nzji[ j ];
+        const DerivativeValueType imjac = imageJacobian[ j ];
+        if( fixedForeground )
+        {
+          sum1[ index ] += 2.0 * imjac;
+        }
+        sum2[ index ] += imjac;
+      }
+    } // end for loop over the block
+
+    /** Count the areas of the block. */
+    numberOfPixelsCounted += PopCount( validBits );
+    fixedForegroundArea   += PopCount( fixedBits );
+    movingForegroundArea  += PopCount( movingBits );
+    intersection          += PopCount( fixedBits & movingBits );
+
+  } // end for loop over the blocks
+
+} // end ComputeBitPackedLabelTerms()
+
+
 /**
  * *************** ComputeGradient ***************************
  */
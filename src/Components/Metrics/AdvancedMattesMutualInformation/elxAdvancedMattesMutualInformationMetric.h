@@ -60,6 +60,25 @@ namespace elastix
  *    resolution, or for all resolutions at once. \n
  *    example: <tt>(MovingKernelBSplineOrder 3 3 3)</tt> \n
  *    The default value is 3.
+ * \parameter UseParzenKernelLookupTable: Whether the Parzen kernels of
+ *    B-spline order 2 and 3 are interpolated from a precomputed table,
+ *    instead of evaluating the B-spline polynomials for every sample.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseParzenKernelLookupTable "true")</tt> \n
+ *    The default value is "false".
+ * \parameter UseFixedParzenValueCache: Whether the fixed image Parzen window
+ *    of each sample is computed once when the samples change, and stored,
+ *    instead of in every iteration. This costs FixedKernelBSplineOrder + 2
+ *    numbers per sample. Can be given for each resolution, or for all
+ *    resolutions at once. \n
+ *    example: <tt>(UseFixedParzenValueCache "false")</tt> \n
+ *    The default value is "true".
+ * \parameter UseLimiterLookupTable: Whether the exponential of the moving
+ *    image limiter is interpolated from a precomputed table, instead of
+ *    calling exp() for every limited value.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseLimiterLookupTable "true")</tt> \n
+ *    The default value is "false".
  * \parameter FixedLimitRangeRatio: The relative extension of the intensity
  *    range of the fixed image.\n
  *    If your fixed image has grey values from a to b and the
@@ -91,6 +110,13 @@ namespace elastix
  *    B-spline grids.
  *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
  *    The default is "true".
+ * \parameter UseSparsePDFDerivatives: Only used when UseFastAndLowMemoryVersion
+ *    is "false". Store the joint histogram derivatives in blocks of parameters
+ *    that are only allocated when touched, instead of in the large 3D matrix.
+ *    For B-spline transforms this saves most of the memory, and gives the
+ *    same derivative.\n
+ *    example: <tt>(UseSparsePDFDerivatives "true")</tt> \n
+ *    The default is "false".
  *
  * \sa ParzenWindowMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -97,7 +97,12 @@ AdvancedMattesMutualInformationMetric< TElastix >
   typedef itk::HardLimiterFunction< RealType, FixedImageDimension >         FixedLimiterType;
   typedef itk::ExponentialLimiterFunction< RealType, MovingImageDimension > MovingLimiterType;
   this->SetFixedImageLimiter( FixedLimiterType::New() );
-  this->SetMovingImageLimiter( MovingLimiterType::New() );
+  typename MovingLimiterType::Pointer movingLimiter = MovingLimiterType::New();
+  bool useLimiterLookupTable = false;
+  this->GetConfiguration()->ReadParameter( useLimiterLookupTable,
+    "UseLimiterLookupTable", this->GetComponentLabel(), level, 0 );
+  movingLimiter->SetUseLookupTable( useLimiterLookupTable );
+  this->SetMovingImageLimiter( movingLimiter );
 
   /** Get and set the limit range ratios. */
   double fixedLimitRangeRatio  = 0.01;
@@ -119,12 +124,30 @@ AdvancedMattesMutualInformationMetric< TElastix >
   this->SetFixedKernelBSplineOrder( fixedKernelBSplineOrder );
   this->SetMovingKernelBSplineOrder( movingKernelBSplineOrder );
 
+  /** Set whether the Parzen kernels are tabulated. */
+  bool useParzenKernelLookupTable = false;
+  this->GetConfiguration()->ReadParameter( useParzenKernelLookupTable,
+    "UseParzenKernelLookupTable", this->GetComponentLabel(), level, 0 );
+  this->SetUseParzenKernelLookupTable( useParzenKernelLookupTable );
+
+  /** Set whether the fixed Parzen values of the samples are cached. */
+  bool useFixedParzenValueCache = true;
+  this->GetConfiguration()->ReadParameter( useFixedParzenValueCache,
+    "UseFixedParzenValueCache", this->GetComponentLabel(), level, 0 );
+  this->SetUseFixedParzenValueCache( useFixedParzenValueCache );
+
   /** Set whether a low memory consumption should be used. */
   bool useFastAndLowMemoryVersion = true;
   this->GetConfiguration()->ReadParameter( useFastAndLowMemoryVersion,
     "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
   this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
 
+  /** Set whether the explicit joint histogram derivatives are stored sparsely. */
+  bool useSparsePDFDerivatives = false;
+  this->GetConfiguration()->ReadParameter( useSparsePDFDerivatives,
+    "UseSparsePDFDerivatives", this->GetComponentLabel(), level, 0 );
+  this->SetUseSparseExplicitPDFDerivatives( useSparsePDFDerivatives );
+
   /** Set whether to use Nick Tustison's preconditioning technique. */
   bool useJacobianPreconditioning = false;
   this->GetConfiguration()->ReadParameter( useJacobianPreconditioning,
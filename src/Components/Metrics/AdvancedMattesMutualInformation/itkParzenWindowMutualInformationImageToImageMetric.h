@@ -170,6 +170,7 @@ protected:
   /** Typedefs inherited from superclass */
   typedef typename Superclass::FixedImageIndexType                 FixedImageIndexType;
   typedef typename Superclass::FixedImageIndexValueType            FixedImageIndexValueType;
+  typedef typename Superclass::OffsetValueType                     OffsetValueType;
   typedef typename Superclass::MovingImageIndexType                MovingImageIndexType;
   typedef typename Superclass::FixedImagePointType                 FixedImagePointType;
   typedef typename Superclass::MovingImagePointType                MovingImagePointType;
@@ -198,7 +199,9 @@ protected:
    *
    * Implements a version that only loops once over the samples, but uses
    * a large block of memory to explicitly store the joint histogram derivative.
-   * It's size is #FixedHistogramBins * #MovingHistogramBins * #parameters * float.
+   * It's size is #FixedHistogramBins * #MovingHistogramBins * #parameters * float,
+   * unless UseSparseExplicitPDFDerivatives == true, in which case only the
+   * parameter blocks touched by each bin are stored.
    */
   virtual void GetValueAndAnalyticDerivative(
     const ParametersType & parameters,
@@ -256,6 +259,14 @@ protected:
   /** Helper function to launch the threads. */
   void LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const;
 
+  /** Helper array for storing the values of the JointPDF ratios. */
+  typedef double                PRatioType;
+  typedef Array2D< PRatioType > PRatioArrayType;
+  mutable PRatioArrayType m_PRatioArray;
+
+  /** Helper function to compute m_PRatioArray in case of low memory consumption. */
+  void ComputeValueAndPRatioArray( double & MI ) const;
+
 private:
 
   /** The private constructor. */
@@ -263,11 +274,6 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                                  // purposely not implemented
 
-  /** Helper array for storing the values of the JointPDF ratios. */
-  typedef double                PRatioType;
-  typedef Array2D< PRatioType > PRatioArrayType;
-  mutable PRatioArrayType m_PRatioArray;
-
   /** Setting */
   bool m_UseJacobianPreconditioning;
 
@@ -276,16 +282,22 @@ private:
 
   void ComputeDerivativeLowMemory( DerivativeType & derivative ) const;
 
-  /** Helper function to update the derivative for the low memory variant. */
+  /** Helper function to update the derivative for the low memory variant,
+   * given the fixed Parzen window and the moving image value of a sample.
+   */
   void UpdateDerivativeLowMemory(
-    const RealType & fixedImageValue,
+    const OffsetValueType fixedParzenWindowIndex,
+    const PDFValueType * fixedParzenValues,
     const RealType & movingImageValue,
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji,
     DerivativeType & derivative ) const;
 
-  /** Helper function to compute m_PRatioArray in case of low memory consumption. */
-  void ComputeValueAndPRatioArray( double & MI ) const;
+  /** Helper function to compute the value and derivative from the sparse
+   * explicit joint histogram derivatives, in case UseSparseExplicitPDFDerivatives == true.
+   */
+  void ComputeValueAndDerivativeFromSparsePDFDerivatives(
+    MeasureType & value, DerivativeType & derivative ) const;
 
 };
 
@@ -27,6 +27,8 @@
 #include "vnl/vnl_inverse.h"
 #include "vnl/vnl_det.h"
 
+#include <algorithm>
+
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
 #endif
@@ -173,6 +175,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
+  /** Sparse variant of the double summation below. */
+  if( this->GetUseSparseExplicitPDFDerivatives() )
+  {
+    this->ComputeValueAndDerivativeFromSparsePDFDerivatives( value, derivative );
+    return;
+  }
+
   /** Compute the metric and derivatives by double summation over histogram. */
 
   /** Setup iterators .*/
@@ -241,6 +250,89 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndAnalyticDerivative()
 
 
+/**
+ * ******************** ComputeValueAndDerivativeFromSparsePDFDerivatives *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueAndDerivativeFromSparsePDFDerivatives(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Setup iterators. */
+  typedef ImageScanlineConstIterator< JointPDFType > JointPDFIteratorType;
+  typedef typename MarginalPDFType::const_iterator   MarginalPDFIteratorType;
+
+  JointPDFIteratorType jointPDFit(
+    this->m_JointPDF, this->m_JointPDF->GetLargestPossibleRegion() );
+  MarginalPDFIteratorType       fixedPDFit   = this->m_FixedImageMarginalPDF.begin();
+  const MarginalPDFIteratorType fixedPDFend  = this->m_FixedImageMarginalPDF.end();
+  MarginalPDFIteratorType       movingPDFit  = this->m_MovingImageMarginalPDF.begin();
+  const MarginalPDFIteratorType movingPDFend = this->m_MovingImageMarginalPDF.end();
+
+  const unsigned int   blockSize          = Superclass::SparsePDFDerivativesBlockSize;
+  const SizeValueType  numberOfBlocks     = this->m_NumberOfSparsePDFDerivativesBlocks;
+  const unsigned int   numberOfParameters = this->GetNumberOfParameters();
+  const unsigned int * blockIndex         = this->m_SparseJointPDFDerivativesBlockIndex.empty()
+    ? 0 : &( this->m_SparseJointPDFDerivativesBlockIndex[ 0 ] );
+  const PDFDerivativeValueType * values = this->m_SparseJointPDFDerivativesValues.empty()
+    ? 0 : &( this->m_SparseJointPDFDerivativesValues[ 0 ] );
+
+  /** Loop over the joint histogram, in the same order as the dense version,
+   * such that the derivative is accumulated in the same order. Blocks that are
+   * not allocated only contain zeros, and are skipped.
+   */
+  double MI = 0.0;
+  while( fixedPDFit != fixedPDFend )
+  {
+    const double fixedImagePDFValue = *fixedPDFit;
+    movingPDFit = this->m_MovingImageMarginalPDF.begin();
+    while( movingPDFit != movingPDFend )
+    {
+      const double movingImagePDFValue = *movingPDFit;
+      const double fixPDFmovPDF        = fixedImagePDFValue * movingImagePDFValue;
+      const double jointPDFValue       = jointPDFit.Get();
+
+      /** Check for non-zero bin contribution. */
+      if( jointPDFValue > 1e-16 && fixPDFmovPDF > 1e-16 )
+      {
+        const double pRatio      = vcl_log( jointPDFValue / fixPDFmovPDF );
+        const double pRatioAlpha = this->m_Alpha * pRatio;
+        MI += jointPDFValue * pRatio;
+        for( SizeValueType b = 0; b < numberOfBlocks; ++b )
+        {
+          if( blockIndex[ b ] == 0 )
+          {
+            continue;
+          }
+
+          /** Loop over the parameters in this block. */
+          const PDFDerivativeValueType * blockPtr = values + ( blockIndex[ b ] - 1 ) * blockSize;
+          const unsigned int             muBegin  = b * blockSize;
+          const unsigned int             muEnd    = std::min( muBegin + blockSize, numberOfParameters );
+          for( unsigned int mu = muBegin; mu < muEnd; ++mu )
+          {
+            /**  Ref: eq 23 of Thevenaz & Unser paper [3]. */
+            derivative[ mu ] -= blockPtr[ mu - muBegin ] * pRatioAlpha;
+          }
+        }
+      } // end if-block to check non-zero bin contribution
+
+      ++movingPDFit;
+      ++jointPDFit;
+      blockIndex += numberOfBlocks;
+
+    }  // end while-loop over moving index
+    ++fixedPDFit;
+    jointPDFit.NextLine();
+  }  // end while-loop over fixed index
+
+  value = static_cast< MeasureType >( -1.0 * MI );
+
+} // end ComputeValueAndDerivativeFromSparsePDFDerivatives()
+
+
 /**
  * ******************** GetValueAndAnalyticDerivativeLowMemory *******************
  */
@@ -318,6 +410,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fiter;
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  ParzenValueContainerType fixedParzenValueBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
 
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
@@ -348,12 +441,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of the sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValueBuffer );
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()
-        ->Evaluate( fixedImageValue );
+      /** Make sure the moving value falls within the histogram range. */
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
@@ -383,8 +477,8 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji, derivative );
+      this->UpdateDerivativeLowMemory( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, imageJacobian, nzji, derivative );
 
     } // end sampleOk
   }   // end loop over sample container
@@ -484,6 +578,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
   fbegin                                                 += (int)pos_begin;
   fend                                                   += (int)pos_end;
+  ParzenValueContainerType fixedParzenValueBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
 
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
@@ -514,11 +609,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of the sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValueBuffer );
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+      /** Make sure the moving value falls within the histogram range. */
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
@@ -557,9 +654,8 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivative );
+      this->UpdateDerivativeLowMemory( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, imageJacobian, nzji, derivative );
 
     } // end sampleOk
   }   // end loop over sample container
@@ -628,9 +724,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
 
-    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, this->AccumulateDerivativesThreaderCallback,
       const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
-    this->m_Threader->SingleMethodExecute();
   }
 
 } // end AfterThreadedComputeDerivativeLowMemory()
@@ -667,14 +763,12 @@ void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->ComputeDerivativeLowMemoryThreaderCallback,
+  /** Launch on the persistent thread pool. */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->ComputeDerivativeLowMemoryThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
       &this->m_ParzenWindowMutualInformationThreaderParameters ) ) );
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
-
 } // end LaunchComputeDerivativeLowMemoryThreaderCallback()
 
 
@@ -763,7 +857,8 @@ template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateDerivativeLowMemory(
-  const RealType & fixedImageValue,
+  const OffsetValueType fixedParzenWindowIndex,
+  const PDFValueType * fixedParzenValues,
   const RealType & movingImageValue,
   const DerivativeType & imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
@@ -781,28 +876,15 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * Note (2) that imageJacobian may be sparse.
    */
 
-  /** Determine the affected region. */
-
-  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
-  const double fixedImageParzenWindowTerm
-    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  /** Determine the moving Parzen window argument (see eq. 6 of Mattes paper [2]). */
   const double movingImageParzenWindowTerm
     = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
-  /** The lowest bin numbers affected by this pixel: */
-  const int fixedParzenWindowIndex
-    = static_cast< int >( vcl_floor(
-    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+  /** The lowest moving bin number affected by this pixel: */
   const int movingParzenWindowIndex
     = static_cast< int >( vcl_floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** Compute the fixed Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedParzenWindowIndex,
-    this->m_FixedKernel, fixedParzenValues );
-
   /** Compute the derivatives of the moving Parzen window. */
   ParzenValueContainerType derivativeMovingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
   this->EvaluateParzenValues(
@@ -814,7 +896,8 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Loop over the Parzen window region and increment sum. */
   PDFValueType sum = 0.0;
-  for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+  const unsigned int fixedWindowSize = this->m_JointPDFWindow.GetSize()[ 1 ];
+  for( unsigned int f = 0; f < fixedWindowSize; ++f )
   {
     const double fv_et = fixedParzenValues[ f ] / et;
     for( unsigned int m = 0; m < derivativeMovingParzenValues.GetSize(); ++m )
@@ -47,6 +47,12 @@ namespace itk
  * \li Image derivatives are computed using either the B-spline interpolator's implementation
  * or by nearest neighbor interpolation of a precomputed central difference image.
  * \li A minimum number of samples that should map within the moving image (mask) can be specified.
+ * \li The contribution of each sample is multiplied by the weight of the sample, which
+ * corrects for a non-uniform selection of the samples, see ImageImportanceSampler.
+ * The batched GetValues() and the GetSelfHessian() assume unit weights; the former
+ * falls back to GetValue() for a sampler with weights.
+ * \li With UseMultiThread, the samples of a grid or full sampler with UseImplicitSampling
+ * are generated on the fly by the threads, instead of being stored by the sampler.
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -108,8 +114,11 @@ public:
   typedef typename Superclass::ImageSamplerType           ImageSamplerType;
   typedef typename Superclass::ImageSamplerPointer        ImageSamplerPointer;
   typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleType            ImageSampleType;
   typedef typename
     Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename
+    Superclass::ImageSampleSoAContainerType ImageSampleSoAContainerType;
   typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
   typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
   typedef typename
@@ -136,6 +145,18 @@ public:
 
   virtual MeasureType GetValue( const TransformParametersType & parameters ) const;
 
+  /** Typedefs for evaluating several parameter vectors at once. */
+  typedef typename Superclass::ParametersArrayType ParametersArrayType;
+  typedef typename Superclass::MeasureArrayType    MeasureArrayType;
+
+  /** Get the values for several parameter vectors at once. The samples are
+   * processed in blocks; each block is evaluated for all parameter vectors
+   * before moving on, such that the fixed image samples are read from memory
+   * only once.
+   */
+  virtual void GetValues( const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const;
+
   /** Get the derivatives of the match measure. */
   virtual void GetDerivative( const TransformParametersType & parameters,
     DerivativeType & derivative ) const;
@@ -147,9 +168,13 @@ public:
   virtual void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const;
 
-  /** Experimental feature: compute SelfHessian */
+  /** Experimental feature: compute SelfHessian. It is assembled in parallel. */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Compute only the diagonal of the SelfHessian. */
+  virtual void GetSelfHessianDiagonal( const TransformParametersType & parameters,
+    DerivativeType & diagonal ) const;
+
   /** Default: 1.0 mm */
   itkSetMacro( SelfHessianSmoothingSigma, double );
   itkGetConstMacro( SelfHessianSmoothingSigma, double );
@@ -205,6 +230,8 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::TransformPointCacheType             TransformPointCacheType;
+  typedef typename Superclass::GetValueAndDerivativePerThreadStruct GetValueAndDerivativePerThreadStruct;
 
   /** Protected typedefs for SelfHessian */
   typedef SmoothingRecursiveGaussianImageFilter<
@@ -217,22 +244,34 @@ protected:
 
   double m_NormalizationFactor;
 
-  /** Compute a pixel's contribution to the measure and derivatives;
-   * Called by GetValueAndDerivative(). */
+  /** The multi-threaded GetValue() and GetValueAndDerivative() support implicit sampling. */
+  virtual bool GetSupportsImplicitSampling( void ) const
+  {
+    return this->m_UseMultiThread;
+  }
+
+
+  /** Compute a pixel's contribution to the measure and derivatives, times
+   * the weight of its sample; Called by GetValueAndDerivative(). */
   void UpdateValueAndDerivativeTerms(
     const RealType fixedImageValue,
     const RealType movingImageValue,
+    const RealType weight,
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji,
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
-  /** Compute a pixel's contribution to the SelfHessian;
-   * Called by GetSelfHessian(). */
-  void UpdateSelfHessianTerms(
-    const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
-    HessianType & H ) const;
+  /** Compute the SelfHessian, or only its diagonal if diagonalOnly is true.
+   * Called by GetSelfHessian() and GetSelfHessianDiagonal(). */
+  void ComputeSelfHessian( const TransformParametersType & parameters,
+    bool diagonalOnly, HessianType & H, DerivativeType & diagonal ) const;
+
+  /** Compute a pixel's contribution to the SelfHessian: the single column of
+   * terms is the image Jacobian, with the derivative of the smoothed fixed
+   * image plus noise. Called by AssembleSelfHessian(). */
+  virtual bool EvaluateSelfHessianTerms( const ImageSampleContainerType * samples,
+    SizeValueType sampleIndex, NonZeroJacobianIndicesType & nzji, double * terms ) const;
 
   /** Get value for each thread. */
   inline void ThreadedGetValue( ThreadIdType threadID );
@@ -247,6 +286,32 @@ protected:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const;
 
+  /** Compute the sum of squared differences and the number of valid samples
+   * over the samples [begin, end), for the current transform parameters.
+   * The samples are read from the structure-of-arrays output of the sampler,
+   * since the same block of samples is read once per candidate.
+   */
+  void ComputeValueOfSampleRange( const ImageSampleSoAContainerType * samples,
+    SizeValueType begin, SizeValueType end,
+    MeasureType & measure, SizeValueType & numberOfPixelsCounted ) const;
+
+  /** The data passed to ComputeValuesRangeFunction(). The accumulators are
+   * strided per participant, to prevent false sharing.
+   */
+  struct GetValuesThreaderParameterType
+  {
+    const Self *                        st_Metric;
+    const ImageSampleSoAContainerType * st_Samples;
+    SizeValueType                       st_BlockBegin;
+    SizeValueType                       st_Stride;
+    MeasureType *                       st_Measures;
+    SizeValueType *                     st_NumberOfPixelsCounted;
+  };
+
+  /** Range function for the thread pool, used by GetValues(). */
+  static void ComputeValuesRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
 private:
 
   AdvancedMeanSquaresImageToImageMetric( const Self & ); // purposely not implemented
@@ -257,6 +322,9 @@ private:
   double       m_SelfHessianNoiseRange;
   unsigned int m_NumberOfSamplesForSelfHessian;
 
+  /** The interpolator of the smoothed fixed image, during ComputeSelfHessian(). */
+  mutable typename FixedImageInterpolatorType::Pointer m_SelfHessianFixedInterpolator;
+
 };
 
 } // end namespace itk
@@ -20,7 +20,9 @@
 
 #include "itkAdvancedMeanSquaresImageToImageMetric.h"
 #include "vnl/algo/vnl_matrix_update.h"
-#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPhiloxRandomNumberGenerator.h"
+
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -51,6 +53,9 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
   this->m_SelfHessianNoiseRange = 1.0;
 
+  /** The derivative can be accumulated sparsely over the threads. */
+  this->m_SparseDerivativeAccumulationIsSupported = true;
+
 } // end Constructor
 
 
@@ -189,9 +194,9 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       /** Get the fixed image value. */
       const RealType & fixedImageValue = static_cast< double >( ( *fiter ).Value().m_ImageValue );
 
-      /** The difference squared. */
+      /** The difference squared, times the weight of the sample. */
       const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
+      measure += ( *fiter ).Value().m_Weight * diff * diff;
 
     } // end if sampleOk
 
@@ -216,6 +221,187 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueSingleThreaded()
 
 
+/**
+ * ******************* ComputeValueOfSampleRange *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueOfSampleRange( const ImageSampleSoAContainerType * samples,
+  SizeValueType begin, SizeValueType end,
+  MeasureType & measure, SizeValueType & numberOfPixelsCounted ) const
+{
+  /** Get handles to the arrays of the samples. */
+  const typename ImageSampleSoAContainerType::CoordinateType * coordinates[ FixedImageDimension ];
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    coordinates[ d ] = samples->GetCoordinates( d );
+  }
+  const typename ImageSampleSoAContainerType::ValueType * fixedImageValues = samples->GetValues();
+
+  /** Loop over the fixed image samples to calculate the mean squares. */
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    FixedImagePointType  fixedPoint;
+    RealType             movingImageValue;
+    MovingImagePointType mappedPoint;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      fixedPoint[ d ] = coordinates[ d ][ i ];
+    }
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value and check if the point is
+     * inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, 0 );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+
+      /** The difference squared. */
+      const RealType & fixedImageValue = static_cast< RealType >( fixedImageValues[ i ] );
+      const RealType   diff            = movingImageValue - fixedImageValue;
+      measure += diff * diff;
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+} // end ComputeValueOfSampleRange()
+
+
+/**
+ * ******************* ComputeValuesRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValuesRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  GetValuesThreaderParameterType * temp
+    = static_cast< GetValuesThreaderParameterType * >( userData );
+
+  const SizeValueType offset = participantId * temp->st_Stride;
+  temp->st_Metric->ComputeValueOfSampleRange( temp->st_Samples,
+    temp->st_BlockBegin + begin, temp->st_BlockBegin + end,
+    temp->st_Measures[ offset ], temp->st_NumberOfPixelsCounted[ offset ] );
+
+} // end ComputeValuesRangeFunction()
+
+
+/**
+ * ******************* GetValues *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetValues( const ParametersArrayType & parametersArray,
+  MeasureArrayType & values ) const
+{
+  /** The parameters can only be switched per block if this metric sets
+   * the transform parameters itself, see BeforeThreadedGetValueAndDerivative().
+   */
+  const std::size_t numberOfCandidates = parametersArray.size();
+  if( numberOfCandidates < 2 || !this->m_UseMetricSingleThreaded
+    || this->GetImageSampler()->GetUseSampleWeights()
+    || this->GetImageSampler()->GetUseImplicitSampling() )
+  {
+    this->Superclass::GetValues( parametersArray, values );
+    return;
+  }
+
+  /** Call non-thread-safe stuff, such as the sampler update, once for all candidates. */
+  this->BeforeThreadedGetValueAndDerivative( parametersArray[ 0 ] );
+
+  /** Get a handle to the samples, in structure-of-arrays layout. */
+  const ImageSampleSoAContainerType * samples             = this->GetImageSampler()->GetOutputSoA();
+  const SizeValueType                 sampleContainerSize = samples->Size();
+
+  /** Accumulators per candidate, and per participant of the thread pool.
+   * The stride of a cache line prevents false sharing.
+   */
+  const SizeValueType stride
+    = ( ITK_CACHE_LINE_ALIGNMENT + sizeof( MeasureType ) - 1 ) / sizeof( MeasureType );
+  const SizeValueType numberOfParticipants = this->GetNumberOfParallelForBlocks();
+  std::vector< MeasureType >   measures( numberOfCandidates * numberOfParticipants * stride,
+    NumericTraits< MeasureType >::Zero );
+  std::vector< SizeValueType > numberOfPixelsCounted( numberOfCandidates * numberOfParticipants * stride, 0 );
+
+  /** Sweep over the samples in blocks that fit in the cache, and evaluate
+   * each block for all candidates.
+   */
+  const SizeValueType blockSize = 1024;
+  for( SizeValueType blockBegin = 0; blockBegin < sampleContainerSize; blockBegin += blockSize )
+  {
+    const SizeValueType blockEnd = std::min( blockBegin + blockSize, sampleContainerSize );
+    for( std::size_t k = 0; k < numberOfCandidates; ++k )
+    {
+      this->SetTransformParameters( parametersArray[ k ] );
+
+      const SizeValueType offset = k * numberOfParticipants * stride;
+      if( this->m_UseMultiThread )
+      {
+        GetValuesThreaderParameterType parameters;
+        parameters.st_Metric                = this;
+        parameters.st_Samples               = samples;
+        parameters.st_BlockBegin            = blockBegin;
+        parameters.st_Stride                = stride;
+        parameters.st_Measures              = &measures[ offset ];
+        parameters.st_NumberOfPixelsCounted = &numberOfPixelsCounted[ offset ];
+        this->ParallelForBlocks( blockEnd - blockBegin,
+          this->ComputeValuesRangeFunction, &parameters );
+      }
+      else
+      {
+        this->ComputeValueOfSampleRange( samples, blockBegin, blockEnd,
+          measures[ offset ], numberOfPixelsCounted[ offset ] );
+      }
+    }
+  }
+
+  /** Gather the results of all participants, per candidate. */
+  values.resize( numberOfCandidates );
+  for( std::size_t k = 0; k < numberOfCandidates; ++k )
+  {
+    MeasureType   measure = NumericTraits< MeasureType >::Zero;
+    SizeValueType count   = 0;
+    for( SizeValueType p = 0; p < numberOfParticipants; ++p )
+    {
+      const SizeValueType index = ( k * numberOfParticipants + p ) * stride;
+      measure += measures[ index ];
+      count   += numberOfPixelsCounted[ index ];
+    }
+
+    /** Check if enough samples were valid. */
+    this->m_NumberOfPixelsCounted = count;
+    this->CheckNumberOfSamples( sampleContainerSize, this->m_NumberOfPixelsCounted );
+
+    values[ k ] = measure * this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted );
+  }
+
+} // end GetValues()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -266,37 +452,27 @@ void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValue( ThreadIdType threadId )
 {
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
+  /** Get a handle to the sample container. It is not used with an implicit
+   * sample grid, which generates the samples on the fly. */
+  const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
 
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  /** Get the samples for this thread, within the part of this rank when the
+   * computation is distributed. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end   = 0;
+  this->GetThreadSampleRange( threadId, pos_begin, pos_end );
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
   /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  ImageSampleType sample;
+  for( unsigned long i = pos_begin; i < pos_end; ++i )
   {
     /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
+    if( !this->GetFixedImageSample( sampleContainer, i, sample ) ) { continue; }
+    const FixedImagePointType & fixedPoint = sample.m_ImageCoordinates;
     RealType                    movingImageValue;
     MovingImagePointType        mappedPoint;
 
@@ -323,12 +499,11 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       numberOfPixelsCounted++;
 
       /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+      const RealType & fixedImageValue = static_cast< RealType >( sample.m_ImageValue );
 
-      /** The difference squared. */
+      /** The difference squared, times the weight of the sample. */
       const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
+      measure += sample.m_Weight * diff * diff;
 
     } // end if sampleOk
 
@@ -360,15 +535,6 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
   }
 
-  /** Check if enough samples were valid. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-
-  /** The normalization factor. */
-  DerivativeValueType normal_sum = this->m_NormalizationFactor
-    / static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
-
   /** Accumulate values. */
   value = NumericTraits< MeasureType >::Zero;
   for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
@@ -378,6 +544,17 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     /** Reset this variable for the next iteration. */
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
   }
+
+  /** Add the sums of the other ranks, if the computation is distributed. */
+  this->DistributedSumOfValue( value, this->m_NumberOfPixelsCounted );
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    this->GetNumberOfFixedImageSamples(), this->m_NumberOfPixelsCounted );
+
+  /** The normalization factor. */
+  DerivativeValueType normal_sum = this->m_NormalizationFactor
+    / static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
   value *= normal_sum;
 
 } // end AfterThreadedGetValue()
@@ -453,17 +630,34 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
+  /** Check if the fixed sample features have been stored. */
+  const bool    useFixedSampleFeatures = this->GetFixedSampleFeatureCacheIsValid();
+  unsigned long sampleIndex            = 0;
+
   /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  for( fiter = fbegin; fiter != fend; ++fiter, ++sampleIndex )
   {
     /** Read fixed coordinates and initialize some variables. */
     const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
     RealType                    movingImageValue;
     MovingImagePointType        mappedPoint;
     MovingImageDerivativeType   movingImageDerivative;
+    TransformPointCacheType     transformPointCache;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    /** Transform point and check if it is inside the B-spline support region.
+     * The B-spline weights are cached, to be reused for the Jacobian below,
+     * or taken from the stored fixed sample features.
+     */
+    bool sampleOk = true;
+    if( useFixedSampleFeatures )
+    {
+      mappedPoint = this->m_AdvancedTransform->TransformPointUsingFixedSampleFeatures(
+        fixedPoint, this->GetFixedSampleFeatures( sampleIndex ) );
+    }
+    else
+    {
+      sampleOk = this->TransformPoint( fixedPoint, mappedPoint, transformPointCache );
+    }
 
     /** Check if point is inside mask. */
     if( sampleOk )
@@ -497,15 +691,24 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
         jacobian, movingImageDerivative, imageJacobian );
 #else
       /** Compute the inner product of the transform Jacobian and the moving image gradient. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative,
-        imageJacobian, nzji );
+      if( useFixedSampleFeatures )
+      {
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+          fixedPoint, this->GetFixedSampleFeatures( sampleIndex ),
+          movingImageDerivative, imageJacobian );
+      }
+      else
+      {
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingCache(
+          fixedPoint, transformPointCache, movingImageDerivative,
+          imageJacobian, nzji );
+      }
 #endif
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
+        fixedImageValue, movingImageValue, ( *fiter ).Value().m_Weight, imageJacobian,
+        useFixedSampleFeatures ? this->GetFixedSampleNonZeroJacobianIndices( sampleIndex ) : nzji,
         measure, derivative );
 
     } // end if sampleOk
@@ -583,102 +786,148 @@ void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nnzji );
+  /** Get handles to the pre-allocated arrays that store dM(x)/dmu, the sparse
+   * Jacobian indices, and the Jacobian, so that no memory is allocated here.
+   */
+  GetValueAndDerivativePerThreadStruct & variables     = this->m_GetValueAndDerivativePerThreadVariables[ threadId ];
+  NonZeroJacobianIndicesType &           nzji          = variables.st_NonZeroJacobianIndices;
+  DerivativeType &                       imageJacobian = variables.st_ImageJacobian;
+  TransformJacobianType &                jacobian      = variables.st_TransformJacobian;
 
   /** Get a handle to the pre-allocated derivative for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   * It is empty when the derivative is accumulated sparsely.
    */
-  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
-
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( this->m_NumberOfThreads ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+  DerivativeType & derivative                      = variables.st_Derivative;
+  const bool       useSparseDerivativeAccumulation = this->GetSparseDerivativeAccumulationIsActive();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+  /** Get a handle to the sample container. It is not used with an implicit
+   * sample grid, which generates the samples on the fly. */
+  const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
 
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  /** Get the samples for this thread, within the part of this rank when the
+   * computation is distributed. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end   = 0;
+  this->GetThreadSampleRange( threadId, pos_begin, pos_end );
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
+  /** Check if the fixed sample features have been stored. */
+  const bool useFixedSampleFeatures = this->GetFixedSampleFeatureCacheIsValid();
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+  /** The samples are processed in blocks. First all points of a block are
+   * transformed, then the moving image is evaluated for the whole block at
+   * once, and finally the contributions are accumulated in sample order.
+   */
+  const unsigned int        blockSize = 64;
+  ImageSampleType           samples[ blockSize ];
+  MovingImagePointType      mappedPoints[ blockSize ];
+  bool                      sampleOks[ blockSize ];
+  RealType                  movingImageValues[ blockSize ];
+  MovingImageDerivativeType movingImageDerivatives[ blockSize ];
+  TransformPointCacheType   transformPointCaches[ blockSize ];
+
+  for( unsigned long blockBegin = pos_begin; blockBegin < pos_end; blockBegin += blockSize )
+  {
+    const unsigned int numberOfBlockSamples = static_cast< unsigned int >(
+      std::min( static_cast< unsigned long >( blockSize ), pos_end - blockBegin ) );
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
+    for( unsigned int k = 0; k < numberOfBlockSamples; ++k )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
+      /** Read fixed coordinates. Implicit grid points outside the fixed mask are skipped. */
+      sampleOks[ k ] = this->GetFixedImageSample( sampleContainer, blockBegin + k, samples[ k ] );
+      if( !sampleOks[ k ] ) { continue; }
+      const FixedImagePointType & fixedPoint = samples[ k ].m_ImageCoordinates;
+
+      /** Transform point and check if it is inside the B-spline support region.
+       * The B-spline weights are cached, to be reused for the Jacobian below,
+       * or taken from the stored fixed sample features.
+       */
+      if( useFixedSampleFeatures )
+      {
+        mappedPoints[ k ] = this->m_AdvancedTransform->TransformPointUsingFixedSampleFeatures(
+          fixedPoint, this->GetFixedSampleFeatures( blockBegin + k ) );
+      }
+      else
+      {
+        sampleOks[ k ] = this->TransformPoint( fixedPoint, mappedPoints[ k ], transformPointCaches[ k ] );
+      }
+
+      /** Check if point is inside mask. */
+      if( sampleOks[ k ] )
+      {
+        sampleOks[ k ] = this->IsInsideMovingMask( mappedPoints[ k ] ); // thread-safe?
+      }
     }
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
+    /** Compute the moving image values M(T(x)) and derivatives dM/dx and check if
+     * the points are inside the moving image buffer.
      */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
+    this->EvaluateMovingImageValuesAndDerivatives( numberOfBlockSamples,
+      mappedPoints, sampleOks, movingImageValues, movingImageDerivatives );
 
-    if( sampleOk )
+    for( unsigned int k = 0; k < numberOfBlockSamples; ++k )
     {
+      if( !sampleOks[ k ] ) { continue; }
+
       numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+      const FixedImagePointType & fixedPoint  = samples[ k ].m_ImageCoordinates;
+      const unsigned long         sampleIndex = blockBegin + k;
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue = static_cast< RealType >( samples[ k ].m_ImageValue );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
+      if( useFixedSampleFeatures )
+      {
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+          fixedPoint, this->GetFixedSampleFeatures( sampleIndex ), movingImageDerivatives[ k ], imageJacobian );
+      }
+      else if( transformPointCaches[ k ].m_IsValid )
+      {
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingCache(
+          fixedPoint, transformPointCaches[ k ], movingImageDerivatives[ k ], imageJacobian, nzji );
+      }
+      else
+      {
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+          fixedPoint, movingImageDerivatives[ k ], imageJacobian, nzji, jacobian );
+      }
 
       /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
+      const NonZeroJacobianIndicesType & sampleNzji = useFixedSampleFeatures
+        ? this->GetFixedSampleNonZeroJacobianIndices( sampleIndex ) : nzji;
+      if( useSparseDerivativeAccumulation )
+      {
+        const RealType weight = samples[ k ].m_Weight;
+        const RealType diff   = movingImageValues[ k ] - fixedImageValue;
+        measure += weight * diff * diff;
+        this->AddSparseDerivativeContributions( threadId, sampleNzji, imageJacobian, weight * diff * 2.0 );
+      }
+      else
+      {
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValues[ k ], samples[ k ].m_Weight,
+          imageJacobian, sampleNzji,
+          measure, derivative );
+      }
 
-    } // end if sampleOk
+    } // end for loop over the block
 
   } // end for loop over the image sample container
 
+  /** Add the remaining buffered derivative contributions. */
+  if( useSparseDerivativeAccumulation )
+  {
+    this->FlushSparseDerivativeContributions( threadId );
+  }
+
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
@@ -706,15 +955,6 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
   }
 
-  /** Check if enough samples were valid. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-
-  /** The normalization factor. */
-  DerivativeValueType normal_sum = this->m_NormalizationFactor
-    / static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
-
   /** Accumulate values. */
   value = NumericTraits< MeasureType >::Zero;
   for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
@@ -724,11 +964,27 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     /** Reset this variable for the next iteration. */
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
   }
+
+  /** Add the sums of the other ranks, if the computation is distributed. */
+  this->DistributedSumOfValue( value, this->m_NumberOfPixelsCounted );
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    this->GetNumberOfFixedImageSamples(), this->m_NumberOfPixelsCounted );
+
+  /** The normalization factor. */
+  DerivativeValueType normal_sum = this->m_NormalizationFactor
+    / static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
   value *= normal_sum;
 
   /** Accumulate derivatives. */
+  // copy the sparsely accumulated derivative
+  if( this->GetSparseDerivativeAccumulationIsActive() )
+  {
+    this->AccumulateSparseDerivatives( derivative, normal_sum );
+  }
   // compute single-threadedly
-  if( !this->m_UseMultiThread && false ) // force multi-threaded
+  else if( !this->m_UseMultiThread && false ) // force multi-threaded
   {
     derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative * normal_sum;
     for( ThreadIdType i = 1; i < this->m_NumberOfThreads; i++ )
@@ -742,9 +998,9 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
     this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0 / normal_sum;
 
-    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, this->AccumulateDerivativesThreaderCallback,
       const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
-    this->m_Threader->SingleMethodExecute();
   }
 #ifdef ELASTIX_USE_OPENMP
   // compute multi-threadedly with openmp
@@ -765,6 +1021,9 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   }
 #endif
 
+  /** Add the derivatives of the other ranks, which are normalized alike. */
+  this->DistributedSumOfDerivative( derivative );
+
 } // end AfterThreadedGetValueAndDerivative()
 
 
@@ -778,18 +1037,19 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateValueAndDerivativeTerms(
   const RealType fixedImageValue,
   const RealType movingImageValue,
+  const RealType weight,
   const DerivativeType & imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
   MeasureType & measure,
   DerivativeType & deriv ) const
 {
-  /** The difference squared. */
+  /** The difference squared, times the weight of the sample. */
   const RealType diff     = movingImageValue - fixedImageValue;
   const RealType diffdiff = diff * diff;
-  measure += diffdiff;
+  measure += weight * diffdiff;
 
   /** Calculate the contributions to the derivatives with respect to each parameter. */
-  const RealType diff_2 = diff * 2.0;
+  const RealType diff_2 = weight * diff * 2.0;
   if( nzji.size() == this->GetNumberOfParameters() )
   {
     /** Loop over all Jacobians. */
@@ -824,26 +1084,56 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const
 {
   itkDebugMacro( "GetSelfHessian()" );
-  typedef Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
 
-  /** Initialize some variables. */
-  this->m_NumberOfPixelsCounted = 0;
-  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
-  randomGenerator->Initialize();
+  DerivativeType diagonal;
+  this->ComputeSelfHessian( parameters, false, H, diagonal );
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
+} // end GetSelfHessian()
 
+
+/**
+ * ******************* GetSelfHessianDiagonal *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianDiagonal( const TransformParametersType & parameters,
+  DerivativeType & diagonal ) const
+{
+  itkDebugMacro( "GetSelfHessianDiagonal()" );
+
+  HessianType H;
+  this->ComputeSelfHessian( parameters, true, H, diagonal );
+
+} // end GetSelfHessianDiagonal()
+
+
+/**
+ * ******************* ComputeSelfHessian *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSelfHessian( const TransformParametersType & parameters,
+  bool diagonalOnly, HessianType & H, DerivativeType & diagonal ) const
+{
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); // done by set_size if sparse matrix
+  /** Prepare Hessian, or its diagonal. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if( diagonalOnly )
+  {
+    diagonal.SetSize( numberOfParameters );
+    diagonal.Fill( 0.0 );
+  }
+  else
+  {
+    H.set_size( numberOfParameters, numberOfParameters );
+    //H.Fill(0.0); // done by set_size if sparse matrix
+  }
 
   /** Smooth fixed image */
   typename SmootherType::Pointer smoother = SmootherType::New();
@@ -852,191 +1142,135 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   smoother->Update();
 
   /** Set up interpolator for fixed image */
-  typename FixedImageInterpolatorType::Pointer fixedInterpolator = FixedImageInterpolatorType::New();
+  this->m_SelfHessianFixedInterpolator = FixedImageInterpolatorType::New();
   if( this->m_BSplineInterpolator.IsNotNull() )
   {
-    fixedInterpolator->SetSplineOrder( this->m_BSplineInterpolator->GetSplineOrder() );
+    this->m_SelfHessianFixedInterpolator->SetSplineOrder( this->m_BSplineInterpolator->GetSplineOrder() );
   }
   else
   {
-    fixedInterpolator->SetSplineOrder( 1 );
+    this->m_SelfHessianFixedInterpolator->SetSplineOrder( 1 );
   }
-  fixedInterpolator->SetInputImage( smoother->GetOutput() );
+  this->m_SelfHessianFixedInterpolator->SetInputImage( smoother->GetOutput() );
 
   /** Set up random coordinate sampler
    * Actually we could do without a sampler, but it's easy like this.
    */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  //typename DummyFixedImageInterpolatorType::Pointer dummyInterpolator =
-  //  DummyFixedImageInterpolatorType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
   sampler->SetInput( smoother->GetInput() );
   sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
-  //sampler->SetInterpolator( dummyInterpolator );
 
   /** Update the imageSampler and get a handle to the sample container. */
   sampler->Update();
   ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
-
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. NB: we assume here that the
-     * initial transformation is approximately ok.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    /** Check if point is inside moving image. NB: we assume here that the
-     * initial transformation is approximately ok.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->m_Interpolator->IsInsideBuffer( mappedPoint );
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
-
-      /** Use the derivative of the fixed image for the self Hessian!
-       * \todo: we can do this more efficient without the interpolation,
-       * without the sampler, and with a precomputed gradient image,
-       * but is this the bottleneck?
-       */
-      movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
-      for( unsigned int d = 0; d < FixedImageDimension; ++d )
-      {
-        movingImageDerivative[ d ] += randomGenerator->GetVariateWithClosedRange(
-          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
-      }
-
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the innerproducts (dM/dx)^T (dT/dmu) */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-
-      /** Compute this pixel's contribution to the SelfHessian. */
-      this->UpdateSelfHessianTerms( imageJacobian, nzji, H );
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+  /** Add the contributions of all samples, in parallel. */
+  this->m_NumberOfPixelsCounted = this->AssembleSelfHessian(
+    sampleContainer, 1, diagonalOnly, H, diagonal );
+  this->m_SelfHessianFixedInterpolator = 0;
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
-  /** Compute the measure value and derivative. */
+  /** Normalize, or fall back to the identity. */
   if( this->m_NumberOfPixelsCounted > 0 )
   {
     const double normal_sum = 2.0 * this->m_NormalizationFactor
       / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    if( diagonalOnly )
+    {
+      diagonal *= normal_sum;
+    }
+    else
     {
-      H.scale_row( i, normal_sum );
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        H.scale_row( i, normal_sum );
+      }
     }
   }
+  else if( diagonalOnly )
+  {
+    diagonal.Fill( 1.0 );
+  }
   else
   {
     //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
     {
       H( i, i ) = 1.0;
     }
   }
 
-} // end GetSelfHessian()
+} // end ComputeSelfHessian()
 
 
 /**
- * *************** UpdateSelfHessianTerms ***************************
+ * *************** EvaluateSelfHessianTerms ***************************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+bool
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
-::UpdateSelfHessianTerms(
-  const DerivativeType & imageJacobian,
-  const NonZeroJacobianIndicesType & nzji,
-  HessianType & H ) const
+::EvaluateSelfHessianTerms( const ImageSampleContainerType * samples,
+  SizeValueType sampleIndex, NonZeroJacobianIndicesType & nzji, double * terms ) const
 {
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
-
-  // does not work for sparse matrix. \todo: distinguish between sparse and nonsparse
-  ///** Do rank-1 update of H */
-  //if ( nzji.size() == this->GetNumberOfParameters() )
-  //{
-  //  /** Loop over all Jacobians. */
-  //  vnl_matrix_update( H, imageJacobian, imageJacobian );
-  //}
-  //else
-  //{
-  /** Only pick the nonzero Jacobians.
-  * Save only upper triangular part of the matrix */
-  const unsigned int imjacsize = imageJacobian.GetSize();
-  for( unsigned int i = 0; i < imjacsize; ++i )
-  {
-    const unsigned int row      = nzji[ i ];
-    const double       imjacrow = imageJacobian[ i ];
+  /** Read fixed coordinates and initialize some variables. */
+  const FixedImagePointType & fixedPoint = samples->ElementAt( sampleIndex ).m_ImageCoordinates;
+  MovingImagePointType        mappedPoint;
 
-    RowType &       rowVector = H.get_row( row );
-    RowIteratorType rowIt     = rowVector.begin();
+  /** Transform point and check if it is inside the B-spline support region. */
+  bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-    for( unsigned int j = i; j < imjacsize; ++j )
-    {
-      const unsigned int col = nzji[ j ];
-      const double       val = imjacrow * imageJacobian[ j ];
-      if( ( val < 1e-14 ) && ( val > -1e-14 ) )
-      {
-        continue;
-      }
+  /** Check if point is inside mask. NB: we assume here that the
+   * initial transformation is approximately ok.
+   */
+  if( sampleOk )
+  {
+    sampleOk = this->IsInsideMovingMask( mappedPoint );
+  }
 
-      /** The following implements:
-       * H(row,col) += imjacrow * imageJacobian[ j ];
-       * But more efficient.
-       */
+  /** Check if point is inside moving image. NB: we assume here that the
+   * initial transformation is approximately ok.
+   */
+  if( sampleOk )
+  {
+    sampleOk = this->m_Interpolator->IsInsideBuffer( mappedPoint );
+  }
 
-      /** Go to next element */
-      for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
-      {}
+  if( !sampleOk )
+  {
+    return false;
+  }
 
-      if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
-      {
-        /** Add new column to the row and set iterator to that column. */
-        rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
-      }
-      else
-      {
-        /** Add to existing value */
-        ( *rowIt ).second += val;
-      }
-    }
+  /** Use the derivative of the fixed image for the self Hessian! The noise
+   * is a function of the sample index, so it does not depend on the threads.
+   */
+  MovingImageDerivativeType movingImageDerivative
+    = this->m_SelfHessianFixedInterpolator->EvaluateDerivative( fixedPoint );
+  const PhiloxRandomNumberGenerator randomGenerator;
+  double                            noise[ FixedImageDimension ];
+  randomGenerator.GetUniformVariates( sampleIndex, 0, noise, FixedImageDimension );
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    movingImageDerivative[ d ] += ( noise[ d ] - 0.5 ) * this->m_SelfHessianNoiseRange;
   }
 
-  //} // end else
+  /** Get the TransformJacobian dT/dmu. */
+  TransformJacobianType jacobian;
+  this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+  /** Compute the innerproducts (dM/dx)^T (dT/dmu) into the terms. */
+  DerivativeType imageJacobian( terms, nzji.size(), false );
+  this->EvaluateTransformJacobianInnerProduct(
+    jacobian, movingImageDerivative, imageJacobian );
+
+  return true;
 
-} // end UpdateSelfHessianTerms()
+} // end EvaluateSelfHessianTerms()
 
 
 } // end namespace itk
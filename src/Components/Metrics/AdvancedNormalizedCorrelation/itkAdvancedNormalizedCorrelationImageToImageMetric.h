@@ -19,6 +19,7 @@
 #define __itkAdvancedNormalizedCorrelationImageToImageMetric_h
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkCompensatedSummation.h"
 
 namespace itk
 {
@@ -81,6 +82,17 @@ namespace itk
  *
  * where Af and Am are the average of f and m, respectively.
  *
+ * The sums are accumulated with compensated (Kahan) summation, and the sums
+ * of the threads are added in a fixed order. When SubtractMean is true, the
+ * sums are computed over the sample values minus the averages of the previous
+ * evaluation. The centered sums do not change by such a shift, but they no
+ * longer suffer from cancellation when the averages are large compared to
+ * the spread of the sample values.
+ *
+ * With UseSparseDerivativeAccumulation the threads add their contributions
+ * to the three derivative terms to one interleaved shared vector, instead of
+ * each thread filling three vectors of the full number of parameters.
+ *
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -238,6 +250,10 @@ protected:
   /** AccumulateDerivatives threader callback function */
   static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
 
+  /** Computes the derivative from the sparsely accumulated derivative terms. */
+  static void AccumulateSharedDerivativesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
 private:
 
   AdvancedNormalizedCorrelationImageToImageMetric( const Self & ); // purposely not implemented
@@ -246,6 +262,13 @@ private:
   mutable bool m_SubtractMean;
 
   typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+  typedef CompensatedSummation< AccumulateType >                CompensatedSumType;
+
+  /** The averages of the fixed and moving sample values of the previous
+   * evaluation, which are subtracted from the sample values when SubtractMean is true.
+   */
+  mutable AccumulateType m_FixedValueShift;
+  mutable AccumulateType m_MovingValueShift;
 
   /** Helper structs that multi-threads the computation of
    * the metric derivative using ITK threads.
@@ -272,6 +295,10 @@ private:
     DerivativeType st_DerivativeF;
     DerivativeType st_DerivativeM;
     DerivativeType st_Differential;
+    // Scratch buffers of the per-sample computations
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    DerivativeType             st_ImageJacobian;
+    TransformJacobianType      st_TransformJacobian;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, CorrelationGetValueAndDerivativePerThreadStruct,
     PaddedCorrelationGetValueAndDerivativePerThreadStruct );
@@ -35,7 +35,9 @@ template< class TFixedImage, class TMovingImage >
 AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::AdvancedNormalizedCorrelationImageToImageMetric()
 {
-  this->m_SubtractMean = false;
+  this->m_SubtractMean     = false;
+  this->m_FixedValueShift  = NumericTraits< AccumulateType >::Zero;
+  this->m_MovingValueShift = NumericTraits< AccumulateType >::Zero;
 
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
@@ -45,6 +47,10 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CorrelationGetValueAndDerivativePerThreadVariables     = NULL;
   this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize = 0;
 
+  /** The derivative terms F, M and the differential can be accumulated sparsely. */
+  this->m_SparseDerivativeAccumulationIsSupported = true;
+  this->m_NumberOfSparseDerivativeComponents      = 3;
+
 } // end Constructor
 
 
@@ -76,6 +82,16 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
    * which has performance benefits for larger vector sizes.
    */
 
+  /** The superclass sets up the sparse derivative accumulation. It is only
+   * called when needed, since it also allocates dense per thread derivatives.
+   */
+  if( this->GetUseSparseDerivativeAccumulation() )
+  {
+    Superclass::InitializeThreadingParameters();
+  }
+  const NumberOfParametersType derivativeSize
+    = this->GetSparseDerivativeAccumulationIsActive() ? 0 : this->GetNumberOfParameters();
+
   /** Only resize the array of structs when needed. */
   if( this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize != this->m_NumberOfThreads )
   {
@@ -87,8 +103,9 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   }
 
   /** Some initialization. */
-  const AccumulateType      zero1 = NumericTraits< AccumulateType >::Zero;
-  const DerivativeValueType zero2 = NumericTraits< DerivativeValueType >::Zero;
+  const AccumulateType         zero1 = NumericTraits< AccumulateType >::Zero;
+  const DerivativeValueType    zero2 = NumericTraits< DerivativeValueType >::Zero;
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
   for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
   {
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
@@ -97,12 +114,14 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sfm                   = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sf                    = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm                    = zero1;
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.SetSize( this->GetNumberOfParameters() );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.SetSize( this->GetNumberOfParameters() );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.SetSize( this->GetNumberOfParameters() );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.SetSize( derivativeSize );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.SetSize( derivativeSize );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.SetSize( derivativeSize );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.Fill( zero2 );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.Fill( zero2 );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.Fill( zero2 );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_NonZeroJacobianIndices.resize( nnzji );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_ImageJacobian.SetSize( nnzji );
   }
 
 } // end InitializeThreadingParameters()
@@ -119,6 +138,8 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "SubtractMean: " << this->m_SubtractMean << std::endl;
+  os << indent << "FixedValueShift: " << this->m_FixedValueShift << std::endl;
+  os << indent << "MovingValueShift: " << this->m_MovingValueShift << std::endl;
 
 } // end PrintSelf()
 
@@ -214,11 +235,15 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
   /** Create variables to store intermediate results. */
-  AccumulateType sff = NumericTraits< AccumulateType >::Zero;
-  AccumulateType smm = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sfm = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sf  = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sm  = NumericTraits< AccumulateType >::Zero;
+  CompensatedSumType sff;
+  CompensatedSumType smm;
+  CompensatedSumType sfm;
+  CompensatedSumType sf;
+  CompensatedSumType sm;
+
+  /** The shifts of the sample values, only used when SubtractMean is true. */
+  const AccumulateType fixedShift  = this->m_SubtractMean ? this->m_FixedValueShift : 0.0;
+  const AccumulateType movingShift = this->m_SubtractMean ? this->m_MovingValueShift : 0.0;
 
   /** Loop over the fixed image samples to calculate the mean squares. */
   for( fiter = fbegin; fiter != fend; ++fiter )
@@ -250,7 +275,9 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       this->m_NumberOfPixelsCounted++;
 
       /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast< double >( ( *fiter ).Value().m_ImageValue );
+      const RealType fixedImageValue
+        = static_cast< double >( ( *fiter ).Value().m_ImageValue ) - fixedShift;
+      movingImageValue -= movingShift;
 
       /** Update some sums needed to calculate NC. */
       sff += fixedImageValue  * fixedImageValue;
@@ -271,21 +298,30 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
   /** If SubtractMean, then subtract things from sff, smm and sfm. */
-  const RealType N = static_cast< RealType >( this->m_NumberOfPixelsCounted );
+  const RealType N      = static_cast< RealType >( this->m_NumberOfPixelsCounted );
+  AccumulateType sffSum = sff.GetSum();
+  AccumulateType smmSum = smm.GetSum();
+  AccumulateType sfmSum = sfm.GetSum();
   if( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
   {
-    sff -= ( sf * sf / N );
-    smm -= ( sm * sm / N );
-    sfm -= ( sf * sm / N );
+    const AccumulateType sf_N = sf.GetSum() / N;
+    const AccumulateType sm_N = sm.GetSum() / N;
+    sffSum -= ( sf.GetSum() * sf_N );
+    smmSum -= ( sm.GetSum() * sm_N );
+    sfmSum -= ( sf.GetSum() * sm_N );
+
+    /** Shift the sample values of the next evaluation by the current averages. */
+    this->m_FixedValueShift  = fixedShift + sf_N;
+    this->m_MovingValueShift = movingShift + sm_N;
   }
 
   /** The denominator of the NC. */
-  const RealType denom = -1.0 * vcl_sqrt( sff * smm );
+  const RealType denom = -1.0 * vcl_sqrt( sffSum * smmSum );
 
   /** Calculate the measure value. */
   if( this->m_NumberOfPixelsCounted > 0 && denom < -1e-14 )
   {
-    measure = sfm / denom;
+    measure = sfmSum / denom;
   }
   else
   {
@@ -350,11 +386,15 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   TransformJacobianType      jacobian;
 
   /** Initialize some variables for intermediate results. */
-  AccumulateType sff = NumericTraits< AccumulateType >::Zero;
-  AccumulateType smm = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sfm = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sf  = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sm  = NumericTraits< AccumulateType >::Zero;
+  CompensatedSumType sff;
+  CompensatedSumType smm;
+  CompensatedSumType sfm;
+  CompensatedSumType sf;
+  CompensatedSumType sm;
+
+  /** The shifts of the sample values, only used when SubtractMean is true. */
+  const AccumulateType fixedShift  = this->m_SubtractMean ? this->m_FixedValueShift : 0.0;
+  const AccumulateType movingShift = this->m_SubtractMean ? this->m_MovingValueShift : 0.0;
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -410,8 +450,10 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the (shifted) fixed and moving image values. */
+      const RealType fixedImageValue
+        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue ) - fixedShift;
+      movingImageValue -= movingShift;
 
       /** Get the TransformJacobian dT/dmu. */
       this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
@@ -443,30 +485,39 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   /** If SubtractMean, then subtract things from sff, smm, sfm,
    * derivativeF and derivativeM.
    */
-  const RealType N = static_cast< RealType >( this->m_NumberOfPixelsCounted );
+  const RealType N      = static_cast< RealType >( this->m_NumberOfPixelsCounted );
+  AccumulateType sffSum = sff.GetSum();
+  AccumulateType smmSum = smm.GetSum();
+  AccumulateType sfmSum = sfm.GetSum();
   if( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
   {
-    sff -= ( sf * sf / N );
-    smm -= ( sm * sm / N );
-    sfm -= ( sf * sm / N );
+    const AccumulateType sf_N = sf.GetSum() / N;
+    const AccumulateType sm_N = sm.GetSum() / N;
+    sffSum -= ( sf.GetSum() * sf_N );
+    smmSum -= ( sm.GetSum() * sm_N );
+    sfmSum -= ( sf.GetSum() * sm_N );
 
     for( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
     {
-      derivativeF[ i ] -= sf * differential[ i ] / N;
-      derivativeM[ i ] -= sm * differential[ i ] / N;
+      derivativeF[ i ] -= sf_N * differential[ i ];
+      derivativeM[ i ] -= sm_N * differential[ i ];
     }
+
+    /** Shift the sample values of the next evaluation by the current averages. */
+    this->m_FixedValueShift  = fixedShift + sf_N;
+    this->m_MovingValueShift = movingShift + sm_N;
   }
 
   /** The denominator of the value and the derivative. */
-  const RealType denom = -1.0 * vcl_sqrt( sff * smm );
+  const RealType denom = -1.0 * vcl_sqrt( sffSum * smmSum );
 
   /** Calculate the value and the derivative. */
   if( this->m_NumberOfPixelsCounted > 0 && denom < -1e-14 )
   {
-    value = sfm / denom;
+    value = sfmSum / denom;
     for( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
     {
-      derivative[ i ] = ( derivativeF[ i ] - ( sfm / smm ) * derivativeM[ i ] )
+      derivative[ i ] = ( derivativeF[ i ] - ( sfmSum / smmSum ) * derivativeM[ i ] )
         / denom;
     }
   }
@@ -530,19 +581,26 @@ void
 AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
-  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
-  DerivativeType               imageJacobian( nzji.size() );
+  /** Get handles to the pre-allocated arrays that store dM(x)/dmu, the sparse
+   * Jacobian indices, and the Jacobian, so that no memory is allocated here.
+   */
+  NonZeroJacobianIndicesType & nzji
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_NonZeroJacobianIndices;
+  DerivativeType & imageJacobian
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_ImageJacobian;
+  TransformJacobianType & jacobian
+    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_TransformJacobian;
 
   /** Get handles to the pre-allocated derivatives for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   * They are empty when the derivative terms are accumulated sparsely.
    */
   DerivativeType & derivativeF  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_DerivativeF;
   DerivativeType & derivativeM  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_DerivativeM;
   DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Differential;
+  const bool       useSparseDerivativeAccumulation = this->GetSparseDerivativeAccumulationIsActive();
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
@@ -567,12 +625,16 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   threader_fend   += (int)pos_end;
 
   /** Create variables to store intermediate results. */
-  AccumulateType sff                   = NumericTraits< AccumulateType >::Zero;
-  AccumulateType smm                   = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sfm                   = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sf                    = NumericTraits< AccumulateType >::Zero;
-  AccumulateType sm                    = NumericTraits< AccumulateType >::Zero;
-  unsigned long  numberOfPixelsCounted = 0;
+  CompensatedSumType sff;
+  CompensatedSumType smm;
+  CompensatedSumType sfm;
+  CompensatedSumType sf;
+  CompensatedSumType sm;
+  unsigned long      numberOfPixelsCounted = 0;
+
+  /** The shifts of the sample values, only used when SubtractMean is true. */
+  const AccumulateType fixedShift  = this->m_SubtractMean ? this->m_FixedValueShift : 0.0;
+  const AccumulateType movingShift = this->m_SubtractMean ? this->m_MovingValueShift : 0.0;
 
   /** Loop over the fixed image to calculate the mean squares. */
   for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
@@ -605,9 +667,10 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     {
       numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+      /** Get the (shifted) fixed and moving image values. */
+      const RealType fixedImageValue
+        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue ) - fixedShift;
+      movingImageValue -= movingShift;
 
 #if 0
       /** Get the TransformJacobian dT/dmu. */
@@ -618,8 +681,8 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
         jacobian, movingImageDerivative, imageJacobian );
 #else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji, jacobian );
 #endif
 
       /** Update some sums needed to calculate the value of NC. */
@@ -630,21 +693,35 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       sm  += movingImageValue; // Only needed when m_SubtractMean == true
 
       /** Compute this voxel's contribution to the derivative terms. */
-      this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivativeF, derivativeM, differential );
+      if( useSparseDerivativeAccumulation )
+      {
+        const DerivativeValueType factors[ 3 ] = { fixedImageValue, movingImageValue, 1.0 };
+        this->AddSparseDerivativeContributions( threadId, nzji, imageJacobian, factors );
+      }
+      else
+      {
+        this->UpdateDerivativeTerms(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          derivativeF, derivativeM, differential );
+      }
 
     } // end if sampleOk
 
   } // end for loop over the image sample container
 
+  /** Add the remaining buffered derivative contributions. */
+  if( useSparseDerivativeAccumulation )
+  {
+    this->FlushSparseDerivativeContributions( threadId );
+  }
+
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sff                   = sff;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Smm                   = smm;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sfm                   = sfm;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sf                    = sf;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sm                    = sm;
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sff                   = sff.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Smm                   = smm.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sfm                   = sfm.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sf                    = sf.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sm                    = sm.GetSum();
 
 } // end ThreadedGetValueAndDerivative()
 
@@ -676,20 +753,16 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->CheckNumberOfSamples(
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
-  /** Accumulate values. */
+  /** Accumulate values, in a fixed order and compensated. */
   const AccumulateType zero = NumericTraits< AccumulateType >::Zero;
-  AccumulateType       sff  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sff;
-  AccumulateType       smm  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Smm;
-  AccumulateType       sfm  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sfm;
-  AccumulateType       sf   = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sf;
-  AccumulateType       sm   = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Sm;
-  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  CompensatedSumType   sffSum, smmSum, sfmSum, sfSum, smSum;
+  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
   {
-    sff += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sff;
-    smm += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Smm;
-    sfm += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sfm;
-    sf  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sf;
-    sm  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm;
+    sffSum += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sff;
+    smmSum += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Smm;
+    sfmSum += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sfm;
+    sfSum  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sf;
+    smSum  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm;
 
     /** Reset these variables for the next iteration. */
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sff = zero;
@@ -699,6 +772,12 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm  = zero;
   }
 
+  AccumulateType       sff  = sffSum.GetSum();
+  AccumulateType       smm  = smmSum.GetSum();
+  AccumulateType       sfm  = sfmSum.GetSum();
+  const AccumulateType sf   = sfSum.GetSum();
+  const AccumulateType sm   = smSum.GetSum();
+
   /** If SubtractMean, then subtract things from sff, smm and sfm. */
   const RealType N = static_cast< RealType >( this->m_NumberOfPixelsCounted );
   if( this->m_SubtractMean )
@@ -706,6 +785,13 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     sff -= ( sf * sf / N );
     smm -= ( sm * sm / N );
     sfm -= ( sf * sm / N );
+
+    /** Shift the sample values of the next evaluation by the current averages. */
+    if( this->m_NumberOfPixelsCounted > 0 )
+    {
+      this->m_FixedValueShift  += sf / N;
+      this->m_MovingValueShift += sm / N;
+    }
   }
 
   /** The denominator of the value and the derivative. */
@@ -716,6 +802,10 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   {
     value = NumericTraits< MeasureType >::Zero;
     derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    if( this->GetSparseDerivativeAccumulationIsActive() )
+    {
+      this->GetSparseDerivative().Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
     return;
   }
 
@@ -723,8 +813,22 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   value = sfm / denom;
 
   /** Calculate the metric derivative. */
+  // from the sparsely accumulated derivative terms
+  if( this->GetSparseDerivativeAccumulationIsActive() )
+  {
+    MultiThreaderAccumulateDerivativeType pass;
+    pass.st_Metric              = const_cast< Self * >( this );
+    pass.st_sf_N                = sf / N;
+    pass.st_sm_N                = sm / N;
+    pass.st_sfm_smm             = sfm / smm;
+    pass.st_InvertedDenominator = 1.0 / denom;
+    pass.st_DerivativePointer   = derivative.begin();
+
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      this->GetNumberOfParameters(), 0, AccumulateSharedDerivativesRangeFunction, &pass );
+  }
   // single-threaded
-  if( !this->m_UseMultiThread && false ) // force multi-threaded
+  else if( !this->m_UseMultiThread && false ) // force multi-threaded
   {
     DerivativeType & derivativeF  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeF;
     DerivativeType & derivativeM  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeM;
@@ -768,8 +872,8 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     temp->st_InvertedDenominator = 1.0 / denom;
     temp->st_DerivativePointer   = derivative.begin();
 
-    this->m_Threader->SetSingleMethod( AccumulateDerivativesThreaderCallback, temp );
-    this->m_Threader->SingleMethodExecute();
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, AccumulateDerivativesThreaderCallback, temp );
 
     delete temp;
   }
@@ -826,6 +930,8 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   ThreadIdType     threadId    = infoStruct->ThreadID;
   ThreadIdType     nrOfThreads = infoStruct->NumberOfThreads;
 
+  itkPhaseTimerThreadMacro( "AccumulateDerivatives", threadId );
+
   MultiThreaderAccumulateDerivativeType * temp
     = static_cast< MultiThreaderAccumulateDerivativeType * >( infoStruct->UserData );
 
@@ -874,6 +980,51 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ *********** AccumulateSharedDerivativesRangeFunction *************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateSharedDerivativesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MultiThreaderAccumulateDerivativeType & pass
+    = *static_cast< const MultiThreaderAccumulateDerivativeType * >( userData );
+
+  const AccumulateType sf_N                = pass.st_sf_N;
+  const AccumulateType sm_N                = pass.st_sm_N;
+  const AccumulateType sfm_smm             = pass.st_sfm_smm;
+  const RealType       invertedDenominator = pass.st_InvertedDenominator;
+  const bool           subtractMean        = pass.st_Metric->m_SubtractMean;
+
+  /** The terms F, M and the differential of a parameter are stored together. */
+  DerivativeValueType *     shared = pass.st_Metric->GetSparseDerivative().data_block();
+  const DerivativeValueType zero   = NumericTraits< DerivativeValueType >::Zero;
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    DerivativeValueType * terms        = shared + 3 * j;
+    DerivativeValueType   derivativeF  = terms[ 0 ];
+    DerivativeValueType   derivativeM  = terms[ 1 ];
+    DerivativeValueType   differential = terms[ 2 ];
+
+    /** Reset these variables for the next iteration. */
+    terms[ 0 ] = terms[ 1 ] = terms[ 2 ] = zero;
+
+    if( subtractMean )
+    {
+      derivativeF -= sf_N * differential;
+      derivativeM -= sm_N * differential;
+    }
+
+    pass.st_DerivativePointer[ j ]
+      = ( derivativeF - sfm_smm * derivativeM ) * invertedDenominator;
+  }
+
+} // end AccumulateSharedDerivativesRangeFunction()
+
+
 } // end namespace itk
 
 #endif // end #ifndef _itkAdvancedNormalizedCorrelationImageToImageMetric_hxx
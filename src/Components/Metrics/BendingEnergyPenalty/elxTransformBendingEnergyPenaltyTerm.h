@@ -39,6 +39,18 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "TransformBendingEnergyPenalty")</tt>
+ * \parameter UseClosedForm: Compute the bending energy of a cubic B-spline transform
+ *    exactly, from the B-spline coefficients, instead of from the samples. The cost
+ *    then depends on the size of the B-spline grid only. Masks are not used in this
+ *    mode. Can be given for each resolution. \n
+ *    example: <tt>(UseClosedForm "true")</tt> \n
+ *    Default: "false".
+ * \parameter UseControlPointDomain: For a B-spline transform, evaluate the penalty on a
+ *    fixed quadrature of 2^d points per cell of the B-spline grid, instead of on the
+ *    samples of the image sampler. The cost then depends on the number of control
+ *    points, and the penalty is deterministic. Can be given for each resolution. \n
+ *    example: <tt>(UseControlPointDomain "true")</tt> \n
+ *    Default: "false".
  *
  * \ingroup Metrics
  *
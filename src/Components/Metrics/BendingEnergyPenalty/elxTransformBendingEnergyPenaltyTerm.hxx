@@ -62,6 +62,18 @@ TransformBendingEnergyPenalty< TElastix >
     "NumberOfSamplesForSelfHessian", this->GetComponentLabel(), level, 0 );
   this->SetNumberOfSamplesForSelfHessian( numberOfSamplesForSelfHessian );
 
+  /** Set whether the bending energy is computed in closed form. */
+  bool useClosedForm = false;
+  this->GetConfiguration()->ReadParameter( useClosedForm,
+    "UseClosedForm", this->GetComponentLabel(), level, 0 );
+  this->SetUseClosedForm( useClosedForm );
+
+  /** Set whether the bending energy is evaluated in the control point domain. */
+  bool useControlPointDomain = false;
+  this->GetConfiguration()->ReadParameter( useControlPointDomain,
+    "UseControlPointDomain", this->GetComponentLabel(), level, 0 );
+  this->SetUseControlPointDomain( useControlPointDomain );
+
 } // end BeforeEachResolution()
 
 
@@ -34,6 +34,19 @@ namespace itk
  * [1]. For rigid and affine transformation this energy is always
  * zero.
  *
+ * By default the bending energy is averaged over the samples of the image
+ * sampler. With UseClosedForm, and a third order B-spline transform
+ * (possibly added to an initial transform), the bending energy is computed
+ * exactly: the integral of the squared second order derivatives over the
+ * fixed image region is a quadratic form in the B-spline coefficients,
+ * \f$E = c^T A c / |\Omega|\f$. The operator \f$A\f$ is a sum of
+ * Kronecker products of banded 1D Gram matrices of the B-spline and its
+ * derivatives. These are computed once per B-spline grid, and the value and
+ * derivative cost one sparse matrix-vector product \f$Ac\f$, independent of
+ * the number of samples. The fixed and moving image masks are not used in
+ * this mode, and the grid direction is assumed to be orthonormal. Other
+ * transforms fall back to the sampled computation.
+ *
  *
  * [1]: D. Rueckert, L. I. Sonoda, C. Hayes, D. L. G. Hill,
  *      M. O. Leach, and D. J. Hawkes, "Nonrigid registration
@@ -153,13 +166,23 @@ public:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const;
 
-  /** Experimental feature: compute SelfHessian */
+  /** Experimental feature: compute SelfHessian. It is assembled in parallel. */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Compute only the diagonal of the SelfHessian. */
+  virtual void GetSelfHessianDiagonal( const TransformParametersType & parameters,
+    DerivativeType & diagonal ) const;
+
   /** Default: 100000 */
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
 
+  /** Compute the bending energy of a third order B-spline in closed form.
+   * Default: false.
+   */
+  itkSetMacro( UseClosedForm, bool );
+  itkGetConstMacro( UseClosedForm, bool );
+
 protected:
 
   /** Typedefs for indices and points. */
@@ -174,6 +197,16 @@ protected:
   /** Typedefs for SelfHessian */
   typedef ImageGridSampler< FixedImageType > SelfHessianSamplerType;
 
+  /** Compute the SelfHessian, or only its diagonal if diagonalOnly is true.
+   * Called by GetSelfHessian() and GetSelfHessianDiagonal(). */
+  void ComputeSelfHessian( bool diagonalOnly, HessianType & H, DerivativeType & diagonal ) const;
+
+  /** Compute a point's contribution to the SelfHessian: the terms of a
+   * parameter are its Jacobian of the spatial Hessian, times sqrt( 2 ).
+   * Called by AssembleSelfHessian(). */
+  virtual bool EvaluateSelfHessianTerms( const ImageSampleContainerType * samples,
+    SizeValueType sampleIndex, NonZeroJacobianIndicesType & nzji, double * terms ) const;
+
   /** The constructor. */
   TransformBendingEnergyPenaltyTerm();
 
@@ -187,7 +220,64 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                    // purposely not implemented
 
+  /** Typedefs for the closed form. */
+  typedef typename BSplineOrder3TransformType::RegionType    GridRegionType;
+  typedef typename BSplineOrder3TransformType::SpacingType   GridSpacingType;
+  typedef typename BSplineOrder3TransformType::OriginType    GridOriginType;
+  typedef typename BSplineOrder3TransformType::DirectionType GridDirectionType;
+
+  /** The number of entries per row of the banded Gram matrices. */
+  itkStaticConstMacro( GramBandWidth, unsigned int, 7 );
+
+  /** Return the B-spline if the closed form can be used, and 0 otherwise. */
+  const BSplineOrder3TransformType * GetClosedFormBSplineTransform( void ) const;
+
+  /** Compute the 1D Gram matrices of the B-spline grid, if it has changed. */
+  void UpdateClosedFormOperator( const BSplineOrder3TransformType * bspline ) const;
+
+  /** Compute the value, and the derivative if not 0, in closed form. */
+  void ComputeClosedFormValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType * derivative ) const;
+
+  /** Compute output = A input, for the coefficients of one dimension. */
+  void ApplyClosedFormOperator( const double * input, double * output,
+    std::vector< double > & work1, std::vector< double > & work2 ) const;
+
+  /** Apply the banded 1D Gram matrix of the given derivative order
+   * along one dimension of the coefficient grid.
+   */
+  void ApplyGramMatrix( unsigned int dimension, unsigned int order,
+    const double * input, double * output ) const;
+
+  /** Range function computing A c for a range of dimensions. */
+  static void ClosedFormRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** The cubic B-spline and its first and second derivative. */
+  static double EvaluateCubicBSpline( unsigned int order, double t );
+
+  struct ClosedFormPassStruct
+  {
+    const Self *            st_Metric;
+    const double *          st_Coefficients;
+    std::vector< double > * st_Products;
+  };
+
   unsigned int m_NumberOfSamplesForSelfHessian;
+  bool         m_UseClosedForm;
+
+  /** The banded 1D Gram matrices per dimension and derivative order, and
+   * the grid and domain they have been computed for.
+   */
+  mutable std::vector< double > m_GramMatrices[ FixedImageDimension ][ 3 ];
+  mutable bool                  m_ClosedFormOperatorIsValid;
+  mutable GridRegionType        m_ClosedFormGridRegion;
+  mutable GridSpacingType       m_ClosedFormGridSpacing;
+  mutable GridOriginType        m_ClosedFormGridOrigin;
+  mutable GridDirectionType     m_ClosedFormGridDirection;
+  mutable FixedImageRegionType  m_ClosedFormFixedImageRegion;
+  mutable const FixedImageType * m_ClosedFormFixedImage;
+  mutable double                m_ClosedFormDomainVolume;
 
 };
 
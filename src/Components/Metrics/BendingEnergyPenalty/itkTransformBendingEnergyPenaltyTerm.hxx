@@ -19,6 +19,8 @@
 #define __itkTransformBendingEnergyPenaltyTerm_hxx
 
 #include "itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkPersistentThreadPool.h"
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -41,6 +43,10 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   this->SetUseImageSampler( true );
 
   this->m_NumberOfSamplesForSelfHessian = 100000;
+  this->m_UseClosedForm                 = false;
+  this->m_ClosedFormOperatorIsValid     = false;
+  this->m_ClosedFormDomainVolume        = 0.0;
+  this->m_ClosedFormFixedImage          = 0;
 
 } // end Constructor
 
@@ -65,6 +71,14 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
     return static_cast< MeasureType >( measure );
   }
 
+  /** Exact computation in the coefficient domain. */
+  if( this->m_UseClosedForm && this->GetClosedFormBSplineTransform() != 0 )
+  {
+    MeasureType value = NumericTraits< MeasureType >::Zero;
+    this->ComputeClosedFormValueAndDerivative( parameters, value, 0 );
+    return value;
+  }
+
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
@@ -81,7 +95,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer = this->GetPenaltySamples();
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
@@ -210,7 +224,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer = this->GetPenaltySamples();
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
@@ -368,6 +382,13 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   const ParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Exact computation in the coefficient domain. */
+  if( this->m_UseClosedForm && this->GetClosedFormBSplineTransform() != 0 )
+  {
+    this->ComputeClosedFormValueAndDerivative( parameters, value, &derivative );
+    return;
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -437,7 +458,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer     = this->GetPenaltySamples();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
   /** Get the samples for this thread. */
@@ -603,7 +624,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   }
 
   /** Check if enough samples were valid. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer = this->GetPenaltySamples();
   this->CheckNumberOfSamples(
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
@@ -638,9 +659,9 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
     this->m_ThreaderMetricParameters.st_NormalizationFactor
       = static_cast< DerivativeValueType >( this->m_NumberOfPixelsCounted );
 
-    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    PersistentThreadPool::GetInstance()->SingleMethodExecute(
+      this->m_NumberOfThreads, this->AccumulateDerivativesThreaderCallback,
       const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
-    this->m_Threader->SingleMethodExecute();
   }
 #ifdef ELASTIX_USE_OPENMP
   // compute multi-threadedly with openmp
@@ -673,172 +694,562 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 template< class TFixedImage, class TScalarType >
 void
 TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
-::GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const
+::GetSelfHessian( const TransformParametersType & itkNotUsed( parameters ), HessianType & H ) const
 {
   itkDebugMacro( "GetSelfHessian()" );
 
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
+  /** Make sure the transform parameters are up to date. */
+  //this->SetTransformParameters( parameters );
 
+  DerivativeType diagonal;
+  this->ComputeSelfHessian( false, H, diagonal );
+
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetSelfHessianDiagonal *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetSelfHessianDiagonal( const TransformParametersType & itkNotUsed( parameters ),
+  DerivativeType & diagonal ) const
+{
+  itkDebugMacro( "GetSelfHessianDiagonal()" );
+
+  HessianType H;
+  this->ComputeSelfHessian( true, H, diagonal );
+
+} // end GetSelfHessianDiagonal()
+
+
+/**
+ * ******************* ComputeSelfHessian *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ComputeSelfHessian( bool diagonalOnly, HessianType & H, DerivativeType & diagonal ) const
+{
   /** Initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nonZeroJacobianIndices(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
+  /** Prepare Hessian, or its diagonal. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if( diagonalOnly )
+  {
+    diagonal.SetSize( numberOfParameters );
+    diagonal.Fill( 0.0 );
+  }
+  else
+  {
+    H.set_size( numberOfParameters, numberOfParameters );
+    //H.Fill(0.0); //done by set_size for sparse matrix
+  }
 
-  /** Make sure the transform parameters are up to date. */
-  //this->SetTransformParameters( parameters );
+  if( this->m_AdvancedTransform->GetHasNonZeroJacobianOfSpatialHessian() )
+  {
+    /** Set up grid sampler */
+    typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
+    sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
+    sampler->SetMask( this->GetImageSampler()->GetMask() );
+    sampler->SetInput( this->GetFixedImage() );
+    sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
+
+    /** Update the imageSampler and get a handle to the sample container. */
+    sampler->Update();
+    ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
+
+    /** Add the d/dmu dT/dxdx terms of all samples, in parallel. */
+    this->m_NumberOfPixelsCounted = this->AssembleSelfHessian( sampleContainer,
+      FixedImageDimension * FixedImageDimension * FixedImageDimension, diagonalOnly, H, diagonal );
+
+    /** Check if enough samples were valid. */
+    this->CheckNumberOfSamples(
+      sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  }
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); //done by set_size for sparse matrix
-  if( !this->m_AdvancedTransform->GetHasNonZeroJacobianOfSpatialHessian() )
+  /** Normalize, or fall back to the identity. */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    const double normal_sum = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
+    if( diagonalOnly )
+    {
+      diagonal *= normal_sum;
+    }
+    else
+    {
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        H.scale_row( i, normal_sum );
+      }
+    }
+  }
+  else if( diagonalOnly )
+  {
+    diagonal.Fill( 1.0 );
+  }
+  else
   {
     //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
     {
       H( i, i ) = 1.0;
     }
-    return;
   }
 
-  /** Set up grid sampler */
-  typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
-  sampler->SetMask( this->GetImageSampler()->GetMask() );
-  sampler->SetInput( this->GetFixedImage() );
-  sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
+} // end ComputeSelfHessian()
 
-  /** Update the imageSampler and get a handle to the sample container. */
-  sampler->Update();
-  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+/**
+ * ******************* EvaluateSelfHessianTerms *******************
+ */
 
-  /** Loop over the fixed image to calculate the d/dmu dT/dxdx terms. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+template< class TFixedImage, class TScalarType >
+bool
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::EvaluateSelfHessianTerms( const ImageSampleContainerType * samples,
+  SizeValueType sampleIndex, NonZeroJacobianIndicesType & nzji, double * terms ) const
+{
+  /** Read fixed coordinates and initialize some variables. */
+  const FixedImagePointType & fixedPoint = samples->ElementAt( sampleIndex ).m_ImageCoordinates;
+  MovingImagePointType        mappedPoint;
+
+  /** Although the mapped point is not needed to compute the penalty term,
+   * we compute in order to check if it maps inside the support region of
+   * the B-spline and if it maps inside the moving image mask.
+   */
+
+  /** Transform point and check if it is inside the B-spline support region. */
+  bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+  /** Check if point is inside mask. */
+  if( sampleOk )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    MovingImagePointType        mappedPoint;
+    sampleOk = this->IsInsideMovingMask( mappedPoint );
+  }
 
-    /** Although the mapped point is not needed to compute the penalty term,
-     * we compute in order to check if it maps inside the support region of
-     * the B-spline and if it maps inside the moving image mask.
-     */
+  if( !sampleOk )
+  {
+    return false;
+  }
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
+  this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
+    jacobianOfSpatialHessian, nzji );
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
+  /** The inner product of the terms of parameters A and B then is:
+   * 2 \sum_k \sum_i \sum_j A_kij B_kij.
+   */
+  const double scale = vcl_sqrt( 2.0 );
+  for( unsigned int mu = 0; mu < nzji.size(); ++mu )
+  {
+    for( unsigned int k = 0; k < FixedImageDimension; ++k )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
+      const InternalMatrixType & A = jacobianOfSpatialHessian[ mu ][ k ].GetVnlMatrix();
+
+      typename InternalMatrixType::const_iterator itA    = A.begin();
+      typename InternalMatrixType::const_iterator itAend = A.end();
+      while( itA != itAend )
+      {
+        *terms = scale * ( *itA );
+        ++terms;
+        ++itA;
+      }
     }
+  }
 
-    if( sampleOk )
+  return true;
+
+} // end EvaluateSelfHessianTerms()
+
+
+/**
+ * ******************* GetClosedFormBSplineTransform *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+const typename TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >::BSplineOrder3TransformType *
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetClosedFormBSplineTransform( void ) const
+{
+  /** A plain third order B-spline. */
+  const BSplineOrder3TransformType * bspline
+    = dynamic_cast< const BSplineOrder3TransformType * >( this->m_AdvancedTransform.GetPointer() );
+
+  /** Or one in a combination transform. An initial transform is only allowed
+   * if it is added: a linear transform has no second order derivatives, but
+   * composition would change the domain and the Hessian.
+   */
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( combination )
+  {
+    if( combination->GetInitialTransform() != 0 && !combination->GetUseAddition() )
     {
-      this->m_NumberOfPixelsCounted++;
+      return 0;
+    }
+    bspline = dynamic_cast< const BSplineOrder3TransformType * >(
+      combination->GetCurrentTransform() );
+  }
 
-      this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-        jacobianOfSpatialHessian, nonZeroJacobianIndices );
+  /** The parameters must be those of the B-spline. */
+  if( bspline == 0 || bspline->GetNumberOfParameters() != this->GetNumberOfParameters() )
+  {
+    return 0;
+  }
+  return bspline;
+
+} // end GetClosedFormBSplineTransform()
+
+
+/**
+ * ******************* EvaluateCubicBSpline *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+double
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::EvaluateCubicBSpline( unsigned int order, double t )
+{
+  const double absT = vcl_abs( t );
+  if( absT >= 2.0 )
+  {
+    return 0.0;
+  }
+
+  const double sign = ( t < 0.0 ) ? -1.0 : 1.0;
+  if( absT < 1.0 )
+  {
+    if( order == 0 ) { return 2.0 / 3.0 - t * t + 0.5 * absT * t * t; }
+    if( order == 1 ) { return -2.0 * t + 1.5 * t * absT; }
+    return -2.0 + 3.0 * absT;
+  }
+
+  const double u = 2.0 - absT;
+  if( order == 0 ) { return u * u * u / 6.0; }
+  if( order == 1 ) { return -0.5 * sign * u * u; }
+  return u;
+
+} // end EvaluateCubicBSpline()
+
+
+/**
+ * ******************* UpdateClosedFormOperator *******************
+ */
 
-      /** Compute the contribution to the metric derivative of this point. */
-      for( unsigned int muA = 0; muA < nonZeroJacobianIndices.size(); ++muA )
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::UpdateClosedFormOperator( const BSplineOrder3TransformType * bspline ) const
+{
+  const GridRegionType       gridRegion       = bspline->GetGridRegion();
+  const GridSpacingType      gridSpacing      = bspline->GetGridSpacing();
+  const GridOriginType       gridOrigin       = bspline->GetGridOrigin();
+  const GridDirectionType    gridDirection    = bspline->GetGridDirection();
+  const FixedImageType *     fixedImage       = this->GetFixedImage();
+  const FixedImageRegionType fixedImageRegion = this->GetFixedImageRegion();
+
+  /** Nothing to do if neither the grid nor the domain has changed. */
+  if( this->m_ClosedFormOperatorIsValid
+    && this->m_ClosedFormGridRegion == gridRegion
+    && this->m_ClosedFormGridSpacing == gridSpacing
+    && this->m_ClosedFormGridOrigin == gridOrigin
+    && this->m_ClosedFormGridDirection == gridDirection
+    && this->m_ClosedFormFixedImage == fixedImage
+    && this->m_ClosedFormFixedImageRegion == fixedImageRegion )
+  {
+    return;
+  }
+
+  /** The domain is the box covered by the voxels of the fixed image region,
+   * in continuous grid index coordinates: u = D^T ( x - origin ) / spacing.
+   */
+  double lower[ FixedImageDimension ];
+  double upper[ FixedImageDimension ];
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    lower[ d ] = NumericTraits< double >::max();
+    upper[ d ] = NumericTraits< double >::NonpositiveMin();
+  }
+  for( unsigned int corner = 0; corner < ( 1u << FixedImageDimension ); ++corner )
+  {
+    ContinuousIndex< double, FixedImageDimension > cindex;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      cindex[ d ] = static_cast< double >( fixedImageRegion.GetIndex()[ d ] ) - 0.5;
+      if( corner & ( 1u << d ) )
       {
-        const unsigned int nmA       = nonZeroJacobianIndices[ muA ];
-        RowType &          rowVector = H.get_row( nmA );
-        RowIteratorType    rowIt     = rowVector.begin();
+        cindex[ d ] += static_cast< double >( fixedImageRegion.GetSize()[ d ] );
+      }
+    }
+    FixedImagePointType point;
+    fixedImage->TransformContinuousIndexToPhysicalPoint( cindex, point );
 
-        for( unsigned int muB = muA; muB < nonZeroJacobianIndices.size(); ++muB )
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      double u = 0.0;
+      for( unsigned int e = 0; e < FixedImageDimension; ++e )
+      {
+        u += gridDirection[ e ][ d ] * ( point[ e ] - gridOrigin[ e ] );
+      }
+      u /= gridSpacing[ d ];
+      lower[ d ] = std::min( lower[ d ], u );
+      upper[ d ] = std::max( upper[ d ], u );
+    }
+  }
+
+  /** Four point Gauss-Legendre quadrature on [0,1]; this is exact for the
+   * products of cubic polynomials on each knot interval.
+   */
+  const double gaussPoints[ 4 ] = {
+    0.5 - 0.5 * 0.8611363115940526, 0.5 - 0.5 * 0.3399810435848563,
+    0.5 + 0.5 * 0.3399810435848563, 0.5 + 0.5 * 0.8611363115940526 };
+  const double gaussWeights[ 4 ] = {
+    0.5 * 0.3478548451374538, 0.5 * 0.6521451548625461,
+    0.5 * 0.6521451548625461, 0.5 * 0.3478548451374538 };
+
+  /** G^a_kl = \int_L^U beta^(a)( u - k ) beta^(a)( u - l ) du, for |k - l| <= 3. */
+  const int halfBand = static_cast< int >( GramBandWidth ) / 2;
+  this->m_ClosedFormDomainVolume = 1.0;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    this->m_ClosedFormDomainVolume *= upper[ d ] - lower[ d ];
+
+    const int    gridSize  = static_cast< int >( gridRegion.GetSize()[ d ] );
+    const double gridStart = static_cast< double >( gridRegion.GetIndex()[ d ] );
+    for( unsigned int order = 0; order < 3; ++order )
+    {
+      std::vector< double > & G = this->m_GramMatrices[ d ][ order ];
+      G.assign( gridSize * GramBandWidth, 0.0 );
+      for( int k = 0; k < gridSize; ++k )
+      {
+        const double uk = gridStart + k;
+        for( int l = std::max( 0, k - halfBand ); l <= std::min( gridSize - 1, k + halfBand ); ++l )
         {
-          const unsigned int nmB = nonZeroJacobianIndices[ muB ];
+          const double ul = gridStart + l;
 
-          RealType matrixProduct = 0.0;
-          for( unsigned int k = 0; k < FixedImageDimension; ++k )
+          /** Integrate over the unit knot intervals of the common support. */
+          double sum = 0.0;
+          for( double m = std::max( uk, ul ) - 2.0; m < std::min( uk, ul ) + 2.0; m += 1.0 )
           {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            const InternalMatrixType & A
-              = jacobianOfSpatialHessian[ muA ][ k ].GetVnlMatrix();
-            const InternalMatrixType & B
-              = jacobianOfSpatialHessian[ muB ][ k ].GetVnlMatrix();
-
-            typename InternalMatrixType::const_iterator itA    = A.begin();
-            typename InternalMatrixType::const_iterator itB    = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A.end();
-            while( itA != itAend )
+            const double a = std::max( m, lower[ d ] );
+            const double b = std::min( m + 1.0, upper[ d ] );
+            if( b <= a ) { continue; }
+            for( unsigned int q = 0; q < 4; ++q )
             {
-              matrixProduct += ( *itA ) * ( *itB );
-              ++itA;
-              ++itB;
+              const double u = a + ( b - a ) * gaussPoints[ q ];
+              sum += ( b - a ) * gaussWeights[ q ]
+                * EvaluateCubicBSpline( order, u - uk )
+                * EvaluateCubicBSpline( order, u - ul );
             }
-
           }
+          G[ k * GramBandWidth + ( l - k + halfBand ) ] = sum;
+        }
+      }
+    }
+  }
 
-          /** Store at the right location in the H matrix.
-          * Only upper triangular part is stored */
+  this->m_ClosedFormGridRegion       = gridRegion;
+  this->m_ClosedFormGridSpacing      = gridSpacing;
+  this->m_ClosedFormGridOrigin       = gridOrigin;
+  this->m_ClosedFormGridDirection    = gridDirection;
+  this->m_ClosedFormFixedImage       = fixedImage;
+  this->m_ClosedFormFixedImageRegion = fixedImageRegion;
+  this->m_ClosedFormOperatorIsValid  = true;
 
-          /** Update hessian element */
-          if( ( matrixProduct > 1e-12 ) || ( matrixProduct < 1e-12 ) )
-          {
-            /**
-            * H( nmA, nmB ) += 2.0 * matrixProduct;
-            * But more efficient
-            */
-            const double val = 2.0 * matrixProduct;
+} // end UpdateClosedFormOperator()
 
-            /** Go to next element */
-            for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < nmB ); ++rowIt )
-            {}
 
-            if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != nmB ) )
-            {
-              /** Add new column to the row and set iterator to that column. */
-              rowIt = rowVector.insert( rowIt, ElementType( nmB, val ) );
-            }
-            else
-            {
-              /** Add to existing value */
-              ( *rowIt ).second += val;
-            }
-          }
+/**
+ * ******************* ApplyGramMatrix *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyGramMatrix( unsigned int dimension, unsigned int order,
+  const double * input, double * output ) const
+{
+  const typename GridRegionType::SizeType & gridSize = this->m_ClosedFormGridRegion.GetSize();
+  const std::vector< double > &             G        = this->m_GramMatrices[ dimension ][ order ];
+  const int                                 halfBand = static_cast< int >( GramBandWidth ) / 2;
+
+  /** The coefficients are stored with the first dimension running fastest. */
+  SizeValueType stride = 1;
+  for( unsigned int d = 0; d < dimension; ++d )
+  {
+    stride *= gridSize[ d ];
+  }
+  const int           n              = static_cast< int >( gridSize[ dimension ] );
+  const SizeValueType numberOfBlocks = this->m_ClosedFormGridRegion.GetNumberOfPixels() / ( n * stride );
+
+  for( SizeValueType block = 0; block < numberOfBlocks; ++block )
+  {
+    const SizeValueType blockOffset = block * n * stride;
+    for( SizeValueType inner = 0; inner < stride; ++inner )
+    {
+      const double * in  = input + blockOffset + inner;
+      double *       out = output + blockOffset + inner;
+      for( int k = 0; k < n; ++k )
+      {
+        const double * row = &G[ k * GramBandWidth ];
+        double         sum = 0.0;
+        for( int l = std::max( 0, k - halfBand ); l <= std::min( n - 1, k + halfBand ); ++l )
+        {
+          sum += row[ l - k + halfBand ] * in[ l * stride ];
         }
+        out[ k * stride ] = sum;
       }
-    } // end if sampleOk
-  } // end for loop over the image sample container
+    }
+  }
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+} // end ApplyGramMatrix()
 
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
+
+/**
+ * ******************* ApplyClosedFormOperator *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyClosedFormOperator( const double * input, double * output,
+  std::vector< double > & work1, std::vector< double > & work2 ) const
+{
+  /** A = \sum_ij w_ij ( G_0^a0 x G_1^a1 x ... ), with derivative orders a_d:
+   * 2 in dimension i if i == j, and 1 in dimensions i and j otherwise.
+   * The weights w_ij = 1 / ( h_i h_j )^2 convert the derivatives to physical
+   * space; the terms with i != j appear twice in the sum over i and j.
+   */
+  const SizeValueType numberOfCoefficients = this->m_ClosedFormGridRegion.GetNumberOfPixels();
+  std::fill( output, output + numberOfCoefficients, 0.0 );
+  work1.resize( numberOfCoefficients );
+  work2.resize( numberOfCoefficients );
+
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
   {
-    const double normal_sum = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    for( unsigned int j = i; j < FixedImageDimension; ++j )
     {
-      H.scale_row( i, normal_sum );
+      const double hij    = this->m_ClosedFormGridSpacing[ i ] * this->m_ClosedFormGridSpacing[ j ];
+      const double weight = ( i == j ? 1.0 : 2.0 ) / ( hij * hij );
+
+      /** Apply the Kronecker product one dimension at a time. */
+      const double * source = input;
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        const unsigned int order = ( d == i ? 1 : 0 ) + ( d == j ? 1 : 0 );
+        double *           target = ( d % 2 == 0 ) ? &work1[ 0 ] : &work2[ 0 ];
+        this->ApplyGramMatrix( d, order, source, target );
+        source = target;
+      }
+
+      for( SizeValueType c = 0; c < numberOfCoefficients; ++c )
+      {
+        output[ c ] += weight * source[ c ];
+      }
     }
   }
+
+} // end ApplyClosedFormOperator()
+
+
+/**
+ * ******************* ClosedFormRangeFunction *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ClosedFormRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const ClosedFormPassStruct * pass   = static_cast< const ClosedFormPassStruct * >( userData );
+  const Self *                 metric = pass->st_Metric;
+  const SizeValueType          numberOfCoefficients
+    = metric->m_ClosedFormGridRegion.GetNumberOfPixels();
+
+  std::vector< double > work1;
+  std::vector< double > work2;
+  for( SizeValueType dim = begin; dim < end; ++dim )
+  {
+    metric->ApplyClosedFormOperator(
+      pass->st_Coefficients + dim * numberOfCoefficients,
+      &( ( *pass->st_Products )[ dim * numberOfCoefficients ] ), work1, work2 );
+  }
+
+} // end ClosedFormRangeFunction()
+
+
+/**
+ * ******************* ComputeClosedFormValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ComputeClosedFormValueAndDerivative( const ParametersType & parameters,
+  MeasureType & value, DerivativeType * derivative ) const
+{
+  /** Only the transform parameters are needed, not the samples. */
+  if( this->m_UseMetricSingleThreaded )
+  {
+    this->SetTransformParameters( parameters );
+  }
+
+  const BSplineOrder3TransformType * bspline = this->GetClosedFormBSplineTransform();
+  this->UpdateClosedFormOperator( bspline );
+
+  /** Copy the coefficients, in case the parameters are not stored as doubles. */
+  const SizeValueType   numberOfParameters = this->GetNumberOfParameters();
+  std::vector< double > coefficients( numberOfParameters );
+  for( SizeValueType p = 0; p < numberOfParameters; ++p )
+  {
+    coefficients[ p ] = static_cast< double >( parameters[ p ] );
+  }
+
+  /** y = A c, per dimension of the displacement. */
+  std::vector< double > products( numberOfParameters );
+  ClosedFormPassStruct  pass;
+  pass.st_Metric       = this;
+  pass.st_Coefficients = &coefficients[ 0 ];
+  pass.st_Products     = &products;
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      FixedImageDimension, 1, Self::ClosedFormRangeFunction, &pass );
+  }
   else
   {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    Self::ClosedFormRangeFunction( &pass, 0, 0, FixedImageDimension );
+  }
+
+  /** E = c^T A c / |Omega|, dE/dc = 2 A c / |Omega|. */
+  const double normalization = ( this->m_ClosedFormDomainVolume > 0.0 )
+    ? 1.0 / this->m_ClosedFormDomainVolume : 0.0;
+  double measure = 0.0;
+  for( SizeValueType p = 0; p < numberOfParameters; ++p )
+  {
+    measure += coefficients[ p ] * products[ p ];
+  }
+  value = static_cast< MeasureType >( measure * normalization );
+
+  if( derivative != 0 )
+  {
+    derivative->SetSize( numberOfParameters );
+    for( SizeValueType p = 0; p < numberOfParameters; ++p )
     {
-      H( i, i ) = 1.0;
+      ( *derivative )[ p ] = static_cast< DerivativeValueType >( 2.0 * normalization * products[ p ] );
     }
   }
 
-} // end GetSelfHessian()
+  /** There are no samples; report the number of voxels of the domain. */
+  this->m_NumberOfPixelsCounted = this->m_ClosedFormFixedImageRegion.GetNumberOfPixels();
+
+} // end ComputeClosedFormValueAndDerivative()
 
 
 } // end namespace itk
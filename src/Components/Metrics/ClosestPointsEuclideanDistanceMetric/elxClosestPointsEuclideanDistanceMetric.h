@@ -0,0 +1,191 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxClosestPointsEuclideanDistanceMetric_H__
+#define __elxClosestPointsEuclideanDistanceMetric_H__
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkClosestPointsEuclideanDistancePointMetric.h"
+
+namespace elastix
+{
+
+/**
+ * \class ClosestPointsEuclideanDistanceMetric
+ * \brief An metric based on the itk::ClosestPointsEuclideanDistancePointMetric.
+ *
+ * The fixed and moving point sets are read like in the
+ * CorrespondingPointsEuclideanDistanceMetric, via the command line arguments
+ * -fp and -mp, but they need not correspond, nor have the same size: every
+ * iteration the closest moving point of each transformed fixed point is used.
+ *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "ClosestPointsEuclideanDistanceMetric")</tt>
+ * \parameter BucketSize: the number of moving points in a bucket of the kd-tree.\n
+ *    example: <tt>(BucketSize 8 8 4)</tt>\n
+ *    The default is 8 for each resolution.
+ * \parameter ErrorBound: the error bound of the approximate closest point search.
+ *    A closest point is accepted when it is at most (1 + ErrorBound) times
+ *    further away than the true closest point.\n
+ *    example: <tt>(ErrorBound 0.5 0.0 0.0)</tt>\n
+ *    The default is 0.0 for each resolution, i.e. exact search.
+ * \parameter MaximumDistance: fixed points of which the closest moving point is
+ *    further away than this distance, in mm, are ignored as outliers.\n
+ *    example: <tt>(MaximumDistance 20.0 10.0 5.0)</tt>\n
+ *    By default no points are ignored.
+ *
+ * \ingroup Metrics
+ *
+ */
+
+template< class TElastix >
+class ClosestPointsEuclideanDistanceMetric :
+  public
+  itk::ClosestPointsEuclideanDistancePointMetric<
+  typename MetricBase< TElastix >::FixedPointSetType,
+  typename MetricBase< TElastix >::MovingPointSetType >,
+  public MetricBase< TElastix >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ClosestPointsEuclideanDistanceMetric Self;
+  typedef itk::ClosestPointsEuclideanDistancePointMetric<
+    typename MetricBase< TElastix >::FixedPointSetType,
+    typename MetricBase< TElastix >::MovingPointSetType > Superclass1;
+  typedef MetricBase< TElastix >          Superclass2;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ClosestPointsEuclideanDistanceMetric,
+    itk::ClosestPointsEuclideanDistancePointMetric );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "ClosestPointsEuclideanDistanceMetric")</tt>\n
+   */
+  elxClassNameMacro( "ClosestPointsEuclideanDistanceMetric" );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass1::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass1::FixedPointSetType            FixedPointSetType;
+  typedef typename Superclass1::FixedPointSetConstPointer    FixedPointSetConstPointer;
+  typedef typename Superclass1::MovingPointSetType           MovingPointSetType;
+  typedef typename Superclass1::MovingPointSetConstPointer   MovingPointSetConstPointer;
+
+//  typedef typename Superclass1::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass1::TransformType           TransformType;
+  typedef typename Superclass1::TransformPointer        TransformPointer;
+  typedef typename Superclass1::InputPointType          InputPointType;
+  typedef typename Superclass1::OutputPointType         OutputPointType;
+  typedef typename Superclass1::TransformParametersType TransformParametersType;
+  typedef typename Superclass1::TransformJacobianType   TransformJacobianType;
+//  typedef typename Superclass1::RealType                   RealType;
+  typedef typename Superclass1::FixedImageMaskType     FixedImageMaskType;
+  typedef typename Superclass1::FixedImageMaskPointer  FixedImageMaskPointer;
+  typedef typename Superclass1::MovingImageMaskType    MovingImageMaskType;
+  typedef typename Superclass1::MovingImageMaskPointer MovingImageMaskPointer;
+  typedef typename Superclass1::MeasureType            MeasureType;
+  typedef typename Superclass1::DerivativeType         DerivativeType;
+  typedef typename Superclass1::ParametersType         ParametersType;
+
+  /** Typedefs inherited from elastix. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+  typedef typename Superclass2::FixedImageType       FixedImageType;
+  typedef typename Superclass2::MovingImageType      MovingImageType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Assuming fixed and moving pointsets are of equal type, which implicitly
+   * assumes that the fixed and moving image are of the same type.
+   */
+  typedef FixedPointSetType PointSetType;
+  typedef FixedImageType    ImageType;
+
+  /** Sets up a timer to measure the initialization time and calls the
+   * Superclass' implementation.
+   */
+  virtual void Initialize( void ) throw ( itk::ExceptionObject );
+
+  /**
+   * Do some things before all:
+   * \li Check and print the command line arguments fp and mp.
+   *   This should be done in BeforeAllBase and not BeforeAll.
+   */
+  virtual int BeforeAllBase( void );
+
+  /**
+   * Do some things before registration:
+   * \li Load and set the pointsets.
+   */
+  virtual void BeforeRegistration( void );
+
+  /**
+   * Do some things before each resolution:
+   * \li Set the BucketSize, ErrorBound and MaximumDistance.
+   */
+  virtual void BeforeEachResolution( void );
+
+  /** Function to read the points. */
+  unsigned int ReadLandmarks(
+  const std::string & landmarkFileName,
+  typename PointSetType::Pointer & pointSet,
+  const typename ImageType::ConstPointer image );
+
+  /** Overwrite to silence warning. */
+  virtual void SelectNewSamples( void ){}
+
+protected:
+
+  /** The constructor. */
+  ClosestPointsEuclideanDistanceMetric(){}
+  /** The destructor. */
+  virtual ~ClosestPointsEuclideanDistanceMetric() {}
+
+private:
+
+  /** The private constructor. */
+  ClosestPointsEuclideanDistanceMetric( const Self & ); // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );              // purposely not implemented
+
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxClosestPointsEuclideanDistanceMetric.hxx"
+#endif
+
+#endif // end #ifndef __elxClosestPointsEuclideanDistanceMetric_H__
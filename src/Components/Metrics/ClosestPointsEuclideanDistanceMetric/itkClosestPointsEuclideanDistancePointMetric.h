@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkClosestPointsEuclideanDistancePointMetric_h
+#define __itkClosestPointsEuclideanDistancePointMetric_h
+
+#include "itkSingleValuedPointSetToPointSetMetric.h"
+#include "itkPoint.h"
+#include "itkPointSet.h"
+#include "itkImage.h"
+
+#include "itkListSampleCArray.h"
+#include "itkANNkDTree.h"
+#include "itkANNStandardTreeSearch.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ClosestPointsEuclideanDistancePointMetric
+ * \brief Computes the mean Euclidean distance between the transformed fixed
+ *  points and their closest points in the moving point-set.
+ *
+ * No correspondence is needed: the closest moving point of each transformed
+ * fixed point is searched every iteration, like in the iterative closest
+ * point (ICP) algorithm. The moving points do not move, so they are stored
+ * once in a kd-tree, see SetBucketSize(). The closest points are searched
+ * multi-threaded, with the ANNStandardTreeSearch.
+ *
+ * Fixed points of which the closest moving point is further away than
+ * the MaximumDistance are considered outliers, and are ignored.
+ *
+ * \ingroup RegistrationMetrics
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+class ClosestPointsEuclideanDistancePointMetric :
+  public SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef ClosestPointsEuclideanDistancePointMetric Self;
+  typedef SingleValuedPointSetToPointSetMetric<
+    TFixedPointSet, TMovingPointSet >               Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ClosestPointsEuclideanDistancePointMetric,
+    SingleValuedPointSetToPointSetMetric );
+
+  /** Types transferred from the base class */
+  typedef typename Superclass::TransformType           TransformType;
+  typedef typename Superclass::TransformPointer        TransformPointer;
+  typedef typename Superclass::TransformParametersType TransformParametersType;
+  typedef typename Superclass::TransformJacobianType   TransformJacobianType;
+
+  typedef typename Superclass::MeasureType                MeasureType;
+  typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
+  typedef typename Superclass::FixedPointSetType          FixedPointSetType;
+  typedef typename Superclass::MovingPointSetType         MovingPointSetType;
+  typedef typename Superclass::FixedPointSetConstPointer  FixedPointSetConstPointer;
+  typedef typename Superclass::MovingPointSetConstPointer MovingPointSetConstPointer;
+
+  typedef typename Superclass::PointIterator     PointIterator;
+  typedef typename Superclass::PointDataIterator PointDataIterator;
+
+  typedef typename Superclass::InputPointType    InputPointType;
+  typedef typename Superclass::OutputPointType   OutputPointType;
+  typedef typename Superclass::OutputVectorType  OutputVectorType;
+  typedef typename OutputPointType::CoordRepType CoordRepType;
+
+  typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+
+  /** Typedefs for the kd-tree of the moving points. */
+  typedef Array< double > MeasurementVectorType;
+  typedef Statistics::ListSampleCArray<
+    MeasurementVectorType, double >                   ListSampleType;
+  typedef typename ListSampleType::Pointer            ListSamplePointer;
+  typedef ANNkDTree< ListSampleType >                 KDTreeType;
+  typedef ANNStandardTreeSearch< ListSampleType >     TreeSearchType;
+  typedef typename TreeSearchType::IndexArrayType    IndexArrayType;
+  typedef typename TreeSearchType::DistanceArrayType DistanceArrayType;
+
+  /** Set and get the number of moving points in a bucket of the kd-tree.
+   * Default: 8.
+   */
+  itkSetMacro( BucketSize, unsigned int );
+  itkGetConstMacro( BucketSize, unsigned int );
+
+  /** Set and get the error bound of the approximate closest point search.
+   * A point is accepted when it is at most (1 + ErrorBound) times further
+   * away than the true closest point. Default: 0.0, i.e. exact search.
+   */
+  itkSetMacro( ErrorBound, double );
+  itkGetConstMacro( ErrorBound, double );
+
+  /** Set and get the maximum distance between a transformed fixed point and
+   * its closest moving point. Points that are further away are ignored.
+   * Default: NumericTraits< double >::max(), i.e. no points are ignored.
+   */
+  itkSetMacro( MaximumDistance, double );
+  itkGetConstMacro( MaximumDistance, double );
+
+  /** Initialize the metric; copies the point sets to arrays, and builds the
+   * kd-tree of the moving points.
+   */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
+  /**  Get the value for single valued optimizers. */
+  MeasureType GetValue( const TransformParametersType & parameters ) const;
+
+  /** Get the derivatives of the match measure. */
+  void GetDerivative( const TransformParametersType & parameters,
+    DerivativeType & Derivative ) const;
+
+  /**  Get value and derivatives for multiple valued optimizers. */
+  void GetValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & Value, DerivativeType & Derivative ) const;
+
+protected:
+
+  ClosestPointsEuclideanDistancePointMetric();
+  virtual ~ClosestPointsEuclideanDistancePointMetric() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  ClosestPointsEuclideanDistancePointMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                            // purposely not implemented
+
+  /** The job of the threads that search the closest points. */
+  struct ClosestPointsJobType
+  {
+    const Self * st_Metric;
+  };
+
+  /** Transforms the fixed points to m_MappedPoints, and searches the
+   * closest moving point of each of them, multi-threaded.
+   */
+  void FindClosestPoints( void ) const;
+
+  /** Searches the closest moving points of the mapped points [begin, end). */
+  static void FindClosestPointsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The number of mapped points per chunk of the closest point search. */
+  static const SizeValueType ClosestPointsGrainSize = 64;
+
+  std::vector< InputPointType >           m_FixedPoints;
+  std::vector< OutputPointType >          m_MovingPoints;
+  mutable std::vector< OutputPointType >  m_MappedPoints;
+  mutable std::vector< OutputVectorType > m_PointGradients;
+  mutable std::vector< SizeValueType >    m_ClosestPointIndices;
+  mutable std::vector< double >           m_ClosestPointDistances;
+
+  ListSamplePointer                m_MovingSample;
+  typename KDTreeType::Pointer     m_KDTree;
+  typename TreeSearchType::Pointer m_TreeSearcher;
+
+  unsigned int m_BucketSize;
+  double       m_ErrorBound;
+  double       m_MaximumDistance;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkClosestPointsEuclideanDistancePointMetric.hxx"
+#endif
+
+#endif
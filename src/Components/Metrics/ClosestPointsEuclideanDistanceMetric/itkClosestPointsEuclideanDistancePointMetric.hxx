@@ -0,0 +1,370 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkClosestPointsEuclideanDistancePointMetric_hxx
+#define __itkClosestPointsEuclideanDistancePointMetric_hxx
+
+#include "itkClosestPointsEuclideanDistancePointMetric.h"
+#include "itkPersistentThreadPool.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::ClosestPointsEuclideanDistancePointMetric()
+{
+  this->m_BucketSize      = 8;
+  this->m_ErrorBound      = 0.0;
+  this->m_MaximumDistance = NumericTraits< double >::max();
+
+} // end Constructor
+
+
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Call the initialize of the superclass. */
+  this->Superclass::Initialize();
+
+  FixedPointSetConstPointer  fixedPointSet  = this->GetFixedPointSet();
+  MovingPointSetConstPointer movingPointSet = this->GetMovingPointSet();
+  const SizeValueType numberOfFixedPoints  = fixedPointSet->GetNumberOfPoints();
+  const SizeValueType numberOfMovingPoints = movingPointSet->GetNumberOfPoints();
+  if( numberOfMovingPoints == 0 )
+  {
+    itkExceptionMacro( << "The moving point set should contain at least one point" );
+  }
+
+  /** Copy the fixed points to an array, for the batched transformation. */
+  this->m_FixedPoints.resize( numberOfFixedPoints );
+  this->m_MappedPoints.resize( numberOfFixedPoints );
+  this->m_PointGradients.resize( numberOfFixedPoints );
+  this->m_ClosestPointIndices.resize( numberOfFixedPoints );
+  this->m_ClosestPointDistances.resize( numberOfFixedPoints );
+
+  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
+  for( SizeValueType i = 0; i < numberOfFixedPoints; ++i, ++pointItFixed )
+  {
+    this->m_FixedPoints[ i ] = pointItFixed.Value();
+  }
+
+  /** Copy the moving points to an array and to a list sample. */
+  const unsigned int dimension = OutputPointType::PointDimension;
+  this->m_MovingPoints.resize( numberOfMovingPoints );
+  this->m_MovingSample = ListSampleType::New();
+  this->m_MovingSample->SetMeasurementVectorSize( dimension );
+  this->m_MovingSample->Resize( numberOfMovingPoints );
+
+  MeasurementVectorType movingVector( dimension );
+  PointIterator         pointItMoving = movingPointSet->GetPoints()->Begin();
+  for( SizeValueType i = 0; i < numberOfMovingPoints; ++i, ++pointItMoving )
+  {
+    this->m_MovingPoints[ i ] = pointItMoving.Value();
+    for( unsigned int d = 0; d < dimension; ++d )
+    {
+      movingVector[ d ] = this->m_MovingPoints[ i ][ d ];
+    }
+    this->m_MovingSample->SetMeasurementVector( i, movingVector );
+  }
+  this->m_MovingSample->SetActualSize( numberOfMovingPoints );
+
+  /** The moving points do not move, so the kd-tree is built only once. */
+  this->m_KDTree = KDTreeType::New();
+  this->m_KDTree->SetBucketSize( this->m_BucketSize );
+  this->m_KDTree->SetSample( this->m_MovingSample );
+  this->m_KDTree->GenerateTree();
+
+  this->m_TreeSearcher = TreeSearchType::New();
+  this->m_TreeSearcher->SetKNearestNeighbors( 1 );
+  this->m_TreeSearcher->SetErrorBound( this->m_ErrorBound );
+  this->m_TreeSearcher->SetBinaryTree( this->m_KDTree );
+
+} // end Initialize()
+
+
+/**
+ * ******************* FindClosestPoints *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::FindClosestPoints( void ) const
+{
+  if( this->m_TreeSearcher.IsNull()
+    || this->m_FixedPoints.size() != this->GetFixedPointSet()->GetNumberOfPoints() )
+  {
+    itkExceptionMacro( << "The metric has not been initialized" );
+  }
+  if( this->m_FixedPoints.empty() ) { return; }
+
+  /** Transform all fixed points. */
+  this->TransformPointsThreaded( this->m_FixedPoints.size(),
+    &this->m_FixedPoints[ 0 ], &this->m_MappedPoints[ 0 ] );
+
+  /** Search their closest moving points. The searches only read the
+   * kd-tree, so they run concurrently, unless ANN keeps the state of a
+   * search in global variables.
+   */
+  ClosestPointsJobType job;
+  job.st_Metric = this;
+#ifdef ANN_NO_THREAD_LOCAL_SEARCH
+  Self::FindClosestPointsRangeFunction( &job, 0, 0, this->m_MappedPoints.size() );
+#else
+  PersistentThreadPool::GetInstance()->ParallelFor( this->m_MappedPoints.size(),
+    Self::ClosestPointsGrainSize, Self::FindClosestPointsRangeFunction, &job );
+#endif
+
+} // end FindClosestPoints()
+
+
+/**
+ * ******************* FindClosestPointsRangeFunction *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::FindClosestPointsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const ClosestPointsJobType & job = *static_cast< const ClosestPointsJobType * >( userData );
+  const Self *                 self = job.st_Metric;
+
+  const unsigned int    dimension = OutputPointType::PointDimension;
+  MeasurementVectorType queryPoint( dimension );
+  IndexArrayType        indices;
+  DistanceArrayType     distances;
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    for( unsigned int d = 0; d < dimension; ++d )
+    {
+      queryPoint[ d ] = self->m_MappedPoints[ i ][ d ];
+    }
+    self->m_TreeSearcher->Search( queryPoint, indices, distances );
+
+    /** ANN returns the squared distance. */
+    self->m_ClosestPointIndices[ i ]   = static_cast< SizeValueType >( indices[ 0 ] );
+    self->m_ClosestPointDistances[ i ] = vcl_sqrt( distances[ 0 ] );
+  }
+
+} // end FindClosestPointsRangeFunction()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+typename ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >::MeasureType
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  /** Sanity checks. */
+  FixedPointSetConstPointer fixedPointSet = this->GetFixedPointSet();
+  if( !fixedPointSet )
+  {
+    itkExceptionMacro( << "Fixed point set has not been assigned" );
+  }
+
+  MovingPointSetConstPointer movingPointSet = this->GetMovingPointSet();
+  if( !movingPointSet )
+  {
+    itkExceptionMacro( << "Moving point set has not been assigned" );
+  }
+
+  /** Initialize some variables. */
+  this->m_NumberOfPointsCounted = 0;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+
+  /** Make sure the transform parameters are up to date. */
+  this->SetTransformParameters( parameters );
+
+  /** Transform all fixed points and search their closest points, multi-threaded. */
+  this->FindClosestPoints();
+
+  /** Loop over the closest points. */
+  for( std::size_t i = 0; i < this->m_MappedPoints.size(); ++i )
+  {
+    /** Check if point is inside mask, and not an outlier. */
+    bool sampleOk = this->m_ClosestPointDistances[ i ] <= this->m_MaximumDistance;
+    if( sampleOk && this->m_MovingImageMask.IsNotNull() )
+    {
+      sampleOk = this->m_MovingImageMask->IsInside( this->m_MappedPoints[ i ] );
+    }
+
+    if( sampleOk )
+    {
+      this->m_NumberOfPointsCounted++;
+      measure += this->m_ClosestPointDistances[ i ];
+    }
+
+  } // end loop over all fixed points
+
+  if( this->m_NumberOfPointsCounted > 0 )
+  {
+    measure /= this->m_NumberOfPointsCounted;
+  }
+  return measure;
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  /** When the derivative is calculated, all information for calculating
+   * the metric value is available. It does not cost anything to calculate
+   * the metric value now. Therefore, we have chosen to only implement the
+   * GetValueAndDerivative(), supplying it with a dummy value variable.
+   */
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::GetValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Sanity checks. */
+  FixedPointSetConstPointer fixedPointSet = this->GetFixedPointSet();
+  if( !fixedPointSet )
+  {
+    itkExceptionMacro( << "Fixed point set has not been assigned" );
+  }
+
+  MovingPointSetConstPointer movingPointSet = this->GetMovingPointSet();
+  if( !movingPointSet )
+  {
+    itkExceptionMacro( << "Moving point set has not been assigned" );
+  }
+
+  /** Initialize some variables */
+  this->m_NumberOfPointsCounted = 0;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  derivative = DerivativeType( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+
+  /** Call non-thread-safe stuff, see
+   * CorrespondingPointsEuclideanDistancePointMetric::GetValueAndDerivative().
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Transform all fixed points and search their closest points, multi-threaded. */
+  this->FindClosestPoints();
+
+  /** Loop over the closest points, and compute the derivatives of the
+   * distances with respect to the mapped points. The closest points are
+   * kept fixed in the derivative, like in the ICP algorithm.
+   */
+  for( std::size_t i = 0; i < this->m_MappedPoints.size(); ++i )
+  {
+    const OutputPointType & mappedPoint = this->m_MappedPoints[ i ];
+    const MeasureType       distance    = this->m_ClosestPointDistances[ i ];
+    this->m_PointGradients[ i ].Fill( 0.0 );
+
+    /** Check if point is inside mask, and not an outlier. */
+    bool sampleOk = distance <= this->m_MaximumDistance;
+    if( sampleOk && this->m_MovingImageMask.IsNotNull() )
+    {
+      sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
+    }
+
+    if( sampleOk )
+    {
+      this->m_NumberOfPointsCounted++;
+      measure += distance;
+
+      /** The derivative of the distance is -diff/distance times dT/dmu. */
+      if( distance > vcl_numeric_limits< MeasureType >::epsilon() )
+      {
+        const OutputVectorType diffPoint
+          = this->m_MovingPoints[ this->m_ClosestPointIndices[ i ] ] - mappedPoint;
+        this->m_PointGradients[ i ] = diffPoint * ( -1.0 / distance );
+      }
+
+    } // end if sampleOk
+
+  } // end loop over all fixed points
+
+  /** Calculate the contributions to the derivatives with respect to each parameter,
+   * using the batched Jacobians, multi-threaded.
+   */
+  if( !this->m_FixedPoints.empty() )
+  {
+    this->AccumulateDerivativeThreaded( this->m_FixedPoints.size(),
+      &this->m_FixedPoints[ 0 ], &this->m_PointGradients[ 0 ], derivative );
+  }
+
+  /** Copy the measure to value. */
+  value = measure;
+  if( this->m_NumberOfPointsCounted > 0 )
+  {
+    derivative /= this->m_NumberOfPointsCounted;
+    value       = measure / this->m_NumberOfPointsCounted;
+  }
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+ClosestPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "BucketSize: " << this->m_BucketSize << std::endl;
+  os << indent << "ErrorBound: " << this->m_ErrorBound << std::endl;
+  os << indent << "MaximumDistance: " << this->m_MaximumDistance << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkClosestPointsEuclideanDistancePointMetric_hxx
@@ -23,6 +23,8 @@
 #include "itkPointSet.h"
 #include "itkImage.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -74,11 +76,15 @@ public:
 
   typedef typename Superclass::InputPointType    InputPointType;
   typedef typename Superclass::OutputPointType   OutputPointType;
+  typedef typename Superclass::OutputVectorType  OutputVectorType;
   typedef typename OutputPointType::CoordRepType CoordRepType;
   typedef vnl_vector< CoordRepType >             VnlVectorType;
 
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Initialize the metric; copies the point sets to arrays. */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
   /**  Get the value for single valued optimizers. */
   MeasureType GetValue( const TransformParametersType & parameters ) const;
 
@@ -100,6 +106,14 @@ private:
   CorrespondingPointsEuclideanDistancePointMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                                  // purposely not implemented
 
+  /** Transforms the fixed points to m_MappedPoints. */
+  void TransformFixedPoints( void ) const;
+
+  std::vector< InputPointType >           m_FixedPoints;
+  std::vector< OutputPointType >          m_MovingPoints;
+  mutable std::vector< OutputPointType >  m_MappedPoints;
+  mutable std::vector< OutputVectorType > m_PointGradients;
+
 };
 
 } // end namespace itk
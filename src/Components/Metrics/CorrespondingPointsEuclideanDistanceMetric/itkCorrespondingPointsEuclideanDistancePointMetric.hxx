@@ -32,6 +32,65 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 ::CorrespondingPointsEuclideanDistancePointMetric()
 {} // end Constructor
 
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Call the initialize of the superclass. */
+  this->Superclass::Initialize();
+
+  FixedPointSetConstPointer  fixedPointSet  = this->GetFixedPointSet();
+  MovingPointSetConstPointer movingPointSet = this->GetMovingPointSet();
+  if( fixedPointSet->GetNumberOfPoints() != movingPointSet->GetNumberOfPoints() )
+  {
+    itkExceptionMacro( << "The fixed and moving point sets should have the same number of points" );
+  }
+
+  /** Copy the corresponding points to arrays, for the batched transformation. */
+  const SizeValueType numberOfPoints = fixedPointSet->GetNumberOfPoints();
+  this->m_FixedPoints.resize( numberOfPoints );
+  this->m_MovingPoints.resize( numberOfPoints );
+  this->m_MappedPoints.resize( numberOfPoints );
+  this->m_PointGradients.resize( numberOfPoints );
+
+  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
+  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
+  for( SizeValueType i = 0; i < numberOfPoints; ++i, ++pointItFixed, ++pointItMoving )
+  {
+    this->m_FixedPoints[ i ]  = pointItFixed.Value();
+    this->m_MovingPoints[ i ] = pointItMoving.Value();
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* TransformFixedPoints *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::TransformFixedPoints( void ) const
+{
+  if( this->m_FixedPoints.size() != this->GetFixedPointSet()->GetNumberOfPoints() )
+  {
+    itkExceptionMacro( << "The metric has not been initialized" );
+  }
+  if( !this->m_FixedPoints.empty() )
+  {
+    this->TransformPointsThreaded( this->m_FixedPoints.size(),
+      &this->m_FixedPoints[ 0 ], &this->m_MappedPoints[ 0 ] );
+  }
+
+} // end TransformFixedPoints()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -56,52 +115,35 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 
   /** Initialize some variables. */
   this->m_NumberOfPointsCounted = 0;
-  MeasureType     measure = NumericTraits< MeasureType >::Zero;
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
+  /** Transform all fixed points, multi-threaded. */
+  this->TransformFixedPoints();
 
   /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
+  for( std::size_t i = 0; i < this->m_MappedPoints.size(); ++i )
   {
-    /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
+    const OutputPointType & mappedPoint = this->m_MappedPoints[ i ];
 
     /** Check if point is inside mask. */
     bool sampleOk = true;
-    if( sampleOk )
+    if( this->m_MovingImageMask.IsNotNull() )
     {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
-      }
+      sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
     }
 
     if( sampleOk )
     {
       this->m_NumberOfPointsCounted++;
 
-      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
+      VnlVectorType diffPoint = ( this->m_MovingPoints[ i ] - mappedPoint ).GetVnlVector();
       measure += diffPoint.magnitude();
 
     } // end if sampleOk
 
-    ++pointItFixed;
-    ++pointItMoving;
-
   } // end loop over all corresponding points
 
   return measure / this->m_NumberOfPointsCounted;
@@ -158,12 +200,6 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
   MeasureType measure = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-  NonZeroJacobianIndicesType nzji(
-  this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-  TransformJacobianType jacobian;
-
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -180,73 +216,51 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
+  /** Transform all fixed points, multi-threaded. */
+  this->TransformFixedPoints();
 
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
+  /** Loop over the corresponding points, and compute the derivatives of
+   * the distances with respect to the mapped points.
+   */
+  for( std::size_t i = 0; i < this->m_MappedPoints.size(); ++i )
   {
-    /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
+    const OutputPointType & mappedPoint = this->m_MappedPoints[ i ];
+    this->m_PointGradients[ i ].Fill( 0.0 );
 
     /** Check if point is inside mask. */
     bool sampleOk = true;
-    if( sampleOk )
+    if( this->m_MovingImageMask.IsNotNull() )
     {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
-      }
+      sampleOk = this->m_MovingImageMask->IsInside( mappedPoint );
     }
 
     if( sampleOk )
     {
       this->m_NumberOfPointsCounted++;
 
-      /** Get the TransformJacobian dT/dmu. */
-      //this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-      this->m_Transform->GetJacobian( fixedPoint, jacobian, nzji );
-
-      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
-      MeasureType   distance  = diffPoint.magnitude();
+      const OutputVectorType diffPoint = this->m_MovingPoints[ i ] - mappedPoint;
+      const MeasureType      distance  = diffPoint.GetNorm();
       measure += distance;
 
-      /** Calculate the contributions to the derivatives with respect to each parameter. */
+      /** The derivative of the distance is -diff/distance times dT/dmu. */
       if( distance > vcl_numeric_limits< MeasureType >::epsilon() )
       {
-        VnlVectorType diff_2 = diffPoint / distance;
-        if( nzji.size() == this->GetNumberOfParameters() )
-        {
-          /** Loop over all Jacobians. */
-          derivative -= diff_2 * jacobian;
-        }
-        else
-        {
-          /** Only pick the nonzero Jacobians. */
-          for( unsigned int i = 0; i < nzji.size(); ++i )
-          {
-            const unsigned int index  = nzji[ i ];
-            VnlVectorType      column = jacobian.get_column( i );
-            derivative[ index ] -= dot_product( diff_2, column );
-          }
-        }
-      } // end if distance != 0
+        this->m_PointGradients[ i ] = diffPoint * ( -1.0 / distance );
+      }
 
     } // end if sampleOk
 
-    ++pointItFixed;
-    ++pointItMoving;
-
   } // end loop over all corresponding points
 
+  /** Calculate the contributions to the derivatives with respect to each parameter,
+   * using the batched Jacobians, multi-threaded.
+   */
+  if( !this->m_FixedPoints.empty() )
+  {
+    this->AccumulateDerivativeThreaded( this->m_FixedPoints.size(),
+      &this->m_FixedPoints[ 0 ], &this->m_PointGradients[ 0 ], derivative );
+  }
+
   /** Check if enough samples were valid. */
 //   this->CheckNumberOfSamples(
 //     fixedPointSet->GetNumberOfPoints(), this->m_NumberOfPointsCounted );
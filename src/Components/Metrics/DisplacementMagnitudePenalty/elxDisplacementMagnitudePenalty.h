@@ -36,6 +36,12 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "DisplacementMagnitudePenalty")</tt>
+ * \parameter UseControlPointDomain: For a B-spline transform, evaluate the penalty on a
+ *    fixed quadrature of 2^d points per cell of the B-spline grid, instead of on the
+ *    samples of the image sampler. The cost then depends on the number of control
+ *    points, and the penalty is deterministic. Can be given for each resolution. \n
+ *    example: <tt>(UseControlPointDomain "true")</tt> \n
+ *    Default: "false".
  *
  * \ingroup Metrics
  * \sa DisplacementEnergyPenaltyTerm
@@ -138,6 +144,12 @@ public:
    */
   virtual void Initialize( void ) throw ( itk::ExceptionObject );
 
+  /**
+   * Do some things before each resolution:
+   * \li Set UseControlPointDomain.
+   */
+  virtual void BeforeEachResolution( void );
+
 protected:
 
   /** The constructor. */
@@ -43,6 +43,28 @@ DisplacementMagnitudePenalty< TElastix >
 } // end Initialize()
 
 
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+DisplacementMagnitudePenalty< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Set whether the penalty is evaluated in the control point domain. */
+  bool useControlPointDomain = false;
+  this->GetConfiguration()->ReadParameter( useControlPointDomain,
+    "UseControlPointDomain", this->GetComponentLabel(), level, 0 );
+  this->SetUseControlPointDomain( useControlPointDomain );
+
+} // end BeforeEachResolution()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxDisplacementMagnitudePenalty_HXX__
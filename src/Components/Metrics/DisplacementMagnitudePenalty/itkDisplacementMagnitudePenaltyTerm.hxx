@@ -73,9 +73,9 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  /** Update the samples and get a handle to the sample container. */
+  this->UpdatePenaltySamples();
+  ImageSampleContainerPointer sampleContainer = this->GetPenaltySamples();
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
@@ -187,7 +187,7 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer = this->GetPenaltySamples();
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
@@ -33,6 +33,8 @@
 #include "itkImageRegionIterator.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <vector>
+
 namespace itk
 {
 /**
@@ -63,6 +65,11 @@ namespace itk
  *  resolutions.
  *  - In the publication above, the grid spacing was set as [4, 4, 1].
  *
+ * The pairs of penalty grid points that belong to the same rigid region
+ * are determined once in Initialize(), and stored as compact neighbour lists
+ * (compressed sparse row layout). The penalty and its derivative are then
+ * computed in a threaded pass over these lists.
+ *
  * \author Jihun Kim, University of Michigan, Ann Arbor
  * \author Martha M. Matuszak, University of Michigan, Ann Arbor
  * \author Kazuhiro Saitou, University of Michigan, Ann Arbor
@@ -213,6 +220,30 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                        // purposely not implemented
 
+  typedef typename PenaltyGridImageType::PointType PenaltyGridPointType;
+
+  /** Determine the rigid penalty grid points and their neighbour lists. */
+  void ComputeRigidGridNeighborLists( void );
+
+  /** Transform the rigid grid points and compute the per point penalty
+   * and, optionally, its gradient with respect to the point displacement.
+   */
+  void ComputeRigidGridPointContributions( bool computeGradients ) const;
+
+  /** Range functions transforming the rigid grid points and evaluating
+   * their neighbour lists.
+   */
+  static void TransformRigidGridPointsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+  static void EvaluateNeighborListsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  struct RigidGridPassStruct
+  {
+    const Self * st_Metric;
+    bool         st_ComputeGradients;
+  };
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
 
@@ -225,6 +256,20 @@ private:
 
   unsigned int m_NumberOfRigidGrids;
 
+  /** The rigid penalty grid points, their weight 1 / ( #same-label neighbours
+   * times #rigid grids ), and their neighbour lists: the neighbours of point i
+   * are m_NeighborList[ m_NeighborListOffsets[ i ] .. m_NeighborListOffsets[ i + 1 ] ).
+   */
+  std::vector< PenaltyGridPointType > m_RigidGridPoints;
+  std::vector< double >               m_RigidGridPointWeights;
+  std::vector< SizeValueType >        m_NeighborListOffsets;
+  std::vector< SizeValueType >        m_NeighborList;
+
+  /** Per point results of the last evaluation. */
+  mutable std::vector< OutputPointType > m_TransformedRigidGridPoints;
+  mutable std::vector< double >          m_RigidGridPointValues;
+  mutable std::vector< double >          m_RigidGridPointGradients;
+
 };
 
 // end class DistancePreservingRigidityPenaltyTerm
@@ -22,6 +22,7 @@
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 #include "itkImageRegionIterator.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -120,153 +121,275 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   this->m_PenaltyGridImage->SetDirection( sampledSegmentedImageDirection );
   this->m_PenaltyGridImage->Update();
 
-  /** compute number of knots in rigid regions */
-  this->m_NumberOfRigidGrids = 0;
+  /** Compute the number of knots in rigid regions and their neighbour lists. */
+  this->ComputeRigidGridNeighborLists();
+
+} // end Initialize()
 
-  typedef itk::ImageRegionIterator< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridIteratorType ki( this->m_PenaltyGridImage, this->m_PenaltyGridImage->GetBufferedRegion() );
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint;
+/**
+ * ***************** ComputeRigidGridNeighborLists ****************
+ */
 
-  //typedef itk::LinearInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRigidGridNeighborLists( void )
+{
   typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
   typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
-
   segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
 
-  unsigned int PixelValue;
+  const PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+  const SizeValueType              numberOfGridPoints     = penaltyGridImageRegion.GetNumberOfPixels();
 
-  ki.GoToBegin();
+  /** Scan the segmentation once: the label of every penalty grid point. */
+  std::vector< unsigned int > labels( numberOfGridPoints, 0 );
+  this->m_NumberOfRigidGrids = 0;
 
-  while( !ki.IsAtEnd() )
+  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
+  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
+  PenaltyGridPointType    penaltyGridPoint;
+  for( pgi.GoToBegin(); !pgi.IsAtEnd(); ++pgi )
   {
-    penaltyGridIndex = ki.GetIndex();
+    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( pgi.GetIndex(), penaltyGridPoint );
+    const unsigned int pixelValue = static_cast< unsigned int >(
+      segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+    labels[ this->m_PenaltyGridImage->ComputeOffset( pgi.GetIndex() ) ] = pixelValue;
+    if( pixelValue > 0 )
+    {
+      this->m_NumberOfRigidGrids++;
+    }
+  }
 
-    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+  /** The penalty is only defined in 3D. */
+  this->m_RigidGridPoints.clear();
+  this->m_RigidGridPointWeights.clear();
+  this->m_NeighborListOffsets.assign( 1, 0 );
+  this->m_NeighborList.clear();
+  if( MovingImageDimension != 3 )
+  {
+    return;
+  }
 
-    PixelValue =  static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+  /** The offsets of the 3x3x3 neighbourhood. */
+  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
+  typename NeighborhoodIteratorType::RadiusType radius;
+  radius.Fill( 1 );
+  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
+  const unsigned int       numberOfNeighborhood = ni.Size();
+
+  /** Select the points in a rigid region that have at least one neighbour
+   * with the same label. Points outside the grid are not neighbours.
+   */
+  std::vector< SizeValueType > pointIds( numberOfGridPoints,
+    NumericTraits< SizeValueType >::max() );
+  std::vector< unsigned int > numberOfRigidGridsNeighbor;
+  typename PenaltyGridImageType::IndexType neighborPenaltyGridIndex;
+  for( pgi.GoToBegin(); !pgi.IsAtEnd(); ++pgi )
+  {
+    const SizeValueType offset     = this->m_PenaltyGridImage->ComputeOffset( pgi.GetIndex() );
+    const unsigned int  pixelValue = labels[ offset ];
+    if( pixelValue == 0 || pixelValue >= 6 )
+    {
+      continue;
+    }
 
-    if( PixelValue > 0 )
+    unsigned int count = 0;
+    for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
     {
-      this->m_NumberOfRigidGrids++;
+      neighborPenaltyGridIndex = pgi.GetIndex() + ni.GetOffset( kk );
+      if( penaltyGridImageRegion.IsInside( neighborPenaltyGridIndex )
+        && labels[ this->m_PenaltyGridImage->ComputeOffset( neighborPenaltyGridIndex ) ] == pixelValue )
+      {
+        count++;
+      }
+    }
+
+    if( count > 1 )
+    {
+      pointIds[ offset ] = this->m_RigidGridPoints.size();
+      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( pgi.GetIndex(), penaltyGridPoint );
+      this->m_RigidGridPoints.push_back( penaltyGridPoint );
+      this->m_RigidGridPointWeights.push_back( 1.0 / count / this->m_NumberOfRigidGrids );
     }
-    ++ki;
   }
-} // end Initialize()
+
+  /** Create the neighbour lists. All neighbours with the same label are
+   * rigid grid points themselves, since they have at least two neighbours.
+   */
+  for( pgi.GoToBegin(); !pgi.IsAtEnd(); ++pgi )
+  {
+    const SizeValueType offset = this->m_PenaltyGridImage->ComputeOffset( pgi.GetIndex() );
+    if( pointIds[ offset ] == NumericTraits< SizeValueType >::max() )
+    {
+      continue;
+    }
+
+    for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+    {
+      neighborPenaltyGridIndex = pgi.GetIndex() + ni.GetOffset( kk );
+      if( !penaltyGridImageRegion.IsInside( neighborPenaltyGridIndex ) )
+      {
+        continue;
+      }
+      const SizeValueType neighborOffset = this->m_PenaltyGridImage->ComputeOffset( neighborPenaltyGridIndex );
+      if( neighborOffset != offset && labels[ neighborOffset ] == labels[ offset ] )
+      {
+        this->m_NeighborList.push_back( pointIds[ neighborOffset ] );
+      }
+    }
+    this->m_NeighborListOffsets.push_back( this->m_NeighborList.size() );
+  }
+
+} // end ComputeRigidGridNeighborLists()
 
 
 /**
- * *********************** GetValue *****************************
+ * ************** ComputeRigidGridPointContributions **************
  */
 
 template< class TFixedImage, class TScalarType >
-typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+void
 DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
-::GetValue( const ParametersType & parameters ) const
+::ComputeRigidGridPointContributions( bool computeGradients ) const
 {
-  /** Set output values to zero. */
-  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
-
-  //this->SetTransformParameters( parameters );
-  this->m_BSplineTransform->SetParameters( parameters );
+  const SizeValueType numberOfPoints = this->m_RigidGridPoints.size();
+  this->m_TransformedRigidGridPoints.resize( numberOfPoints );
+  this->m_RigidGridPointValues.resize( numberOfPoints );
+  if( computeGradients )
+  {
+    this->m_RigidGridPointGradients.resize( 3 * numberOfPoints );
+  }
 
-  /** distance-preserving penalty computation */
-  MeasureType penaltyTerm       = 0.0;
-  MeasureType penaltyTermBuffer = 0.0;
+  RigidGridPassStruct pass;
+  pass.st_Metric           = this;
+  pass.st_ComputeGradients = computeGradients;
 
-  MeasureType dx = 0.0;
-  MeasureType dX = 0.0;
+  /** Transform every point once, then evaluate the neighbour lists. */
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::Pointer pool = PersistentThreadPool::GetInstance();
+    pool->ParallelFor( numberOfPoints, 256, Self::TransformRigidGridPointsRangeFunction, &pass );
+    pool->ParallelFor( numberOfPoints, 256, Self::EvaluateNeighborListsRangeFunction, &pass );
+  }
+  else
+  {
+    Self::TransformRigidGridPointsRangeFunction( &pass, 0, 0, numberOfPoints );
+    Self::EvaluateNeighborListsRangeFunction( &pass, 0, 0, numberOfPoints );
+  }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+} // end ComputeRigidGridPointContributions()
 
-  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+/**
+ * ************ TransformRigidGridPointsRangeFunction *************
+ */
 
-  typename TransformType::OutputVectorType dd_dx, dd_dy, dd_dz;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::TransformRigidGridPointsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const RigidGridPassStruct * pass = static_cast< const RigidGridPassStruct * >( userData );
+  const Self *                self = pass->st_Metric;
 
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    self->m_TransformedRigidGridPoints[ i ]
+      = self->m_Transform->TransformPoint( self->m_RigidGridPoints[ i ] );
+  }
 
-  unsigned int numberOfRigidGridsNeighbor;
+} // end TransformRigidGridPointsRangeFunction()
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
+/**
+ * ************* EvaluateNeighborListsRangeFunction ***************
+ */
 
-  unsigned int pixelValue, pixelValueNeighbor;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::EvaluateNeighborListsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const RigidGridPassStruct * pass = static_cast< const RigidGridPassStruct * >( userData );
+  const Self *                self = pass->st_Metric;
 
-  /** Penalty term computation */
-  if( MovingImageDimension == 3 )
+  for( SizeValueType i = begin; i < end; ++i )
   {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
+    const PenaltyGridPointType & Xf = self->m_RigidGridPoints[ i ];
+    const OutputPointType &      xf = self->m_TransformedRigidGridPoints[ i ];
+    const double                 wf = self->m_RigidGridPointWeights[ i ];
+
+    double value         = 0.0;
+    double gradient[ 3 ] = { 0.0, 0.0, 0.0 };
+    for( SizeValueType k = self->m_NeighborListOffsets[ i ];
+      k < self->m_NeighborListOffsets[ i + 1 ]; ++k )
     {
-      penaltyGridIndex = pgi.GetIndex();
-
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
-
-      ni.SetLocation( penaltyGridIndex );
-
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+      const SizeValueType          j  = self->m_NeighborList[ k ];
+      const PenaltyGridPointType & Xn = self->m_RigidGridPoints[ j ];
+      const OutputPointType &      xn = self->m_TransformedRigidGridPoints[ j ];
 
-      if( pixelValue > 0 && pixelValue < 6 )
+      double dX = 0.0;
+      double dx = 0.0;
+      for( unsigned int d = 0; d < 3; ++d )
       {
-        numberOfRigidGridsNeighbor = 0;
+        dX += ( Xn[ d ] - Xf[ d ] ) * ( Xn[ d ] - Xf[ d ] );
+        dx += ( xn[ d ] - xf[ d ] ) * ( xn[ d ] - xf[ d ] );
+      }
+      value += ( dx - dX ) * ( dx - dX );
 
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+      /** Both the pair (i,j) and the pair (j,i) contribute to the gradient
+       * at point i, with the weight of i and j respectively.
+       */
+      if( pass->st_ComputeGradients )
+      {
+        const double factor = -4.0 * ( dx - dX ) * ( wf + self->m_RigidGridPointWeights[ j ] );
+        for( unsigned int d = 0; d < 3; ++d )
         {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
-
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
-
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
-
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
+          gradient[ d ] += factor * ( xn[ d ] - xf[ d ] );
         }
+      }
+    }
 
-        if( numberOfRigidGridsNeighbor > 1 )
-        {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
+    self->m_RigidGridPointValues[ i ] = wf * value;
+    if( pass->st_ComputeGradients )
+    {
+      for( unsigned int d = 0; d < 3; ++d )
+      {
+        self->m_RigidGridPointGradients[ 3 * i + d ] = gradient[ d ];
+      }
+    }
+  }
 
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+} // end EvaluateNeighborListsRangeFunction()
 
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
 
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
+/**
+ * *********************** GetValue *****************************
+ */
 
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
+template< class TFixedImage, class TScalarType >
+typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetValue( const ParametersType & parameters ) const
+{
+  /** Set output values to zero. */
+  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
 
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
+  //this->SetTransformParameters( parameters );
+  this->m_BSplineTransform->SetParameters( parameters );
 
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
+  /** Distance-preserving penalty computation over the neighbour lists. */
+  this->ComputeRigidGridPointContributions( false );
 
-              penaltyTerm += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-            }
-          } // end for
-        }   // end if
-      }     // end if
-    }       // end for
-  }         // end if ( dimension = 3 )
+  MeasureType penaltyTerm = 0.0;
+  for( SizeValueType i = 0; i < this->m_RigidGridPointValues.size(); ++i )
+  {
+    penaltyTerm += this->m_RigidGridPointValues[ i ];
+  }
 
   /** Return the rigidity penalty term value. */
   return penaltyTerm;
@@ -309,18 +432,10 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
 
   this->m_BSplineTransform->SetParameters( parameters );
 
-  /** Distance-preserving penalty */
-  MeasureType penaltyTermBuffer   = 0.0;
-  MeasureType derivativeTermTemp1 = 0.0, derivativeTermTemp2 = 0.0, derivativeTermTemp3 = 0.0;
-
-  unsigned int par1, par2;
-
-  MeasureType dX = 0.0;
-  MeasureType dx = 0.0;
-
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+  /** Distance-preserving penalty computation over the neighbour lists. */
+  this->ComputeRigidGridPointContributions( true );
 
+  /** Distribute the gradient of every point over its B-spline control points. */
   typedef itk::BSplineKernelFunction< 3 > BSplineKernelFunctionType;
   BSplineKernelFunctionType::Pointer bSplineKernel = BSplineKernelFunctionType::New();
 
@@ -328,167 +443,49 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   typedef typename WeightsFunctionType::ContinuousIndexType                    ContinuousIndexType;
   typedef double                                                               ContinuousIndexValueType;
 
-  ContinuousIndexType      tindex, neighbor_tindex, neighbor_tindex_start;
-  ContinuousIndexValueType tx, ty, tz;
-
-  ContinuousIndexValueType m, n, p, neighbor_m, neighbor_n, neighbor_p;
-
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
-  PenaltyGridIteratorType    pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
-
-  // neighborhood iterator
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
-
-  ContinuousIndexType      tindex_neighbor, ntindex_start, ntindex_neighbor_start;
-  ContinuousIndexValueType tx_neighbor, ty_neighbor, tz_neighbor;
+  ContinuousIndexType      tindex, ntindex_start;
+  ContinuousIndexValueType m, n, p;
 
   typename BSplineKnotImageType::SizeType bSplineKnotImageSize = this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
 
-  MeasureType du_dC, du_dC_neighbor;
-
-  unsigned int numberOfRigidGridsNeighbor;
-
   const unsigned int parametersDimension            = this->GetNumberOfParameters();
   unsigned int       numberOfParametersPerDimension = parametersDimension / ImageDimension;
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
-
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
-
-  unsigned int pixelValue, pixelValueNeighbor;
-
-  if( MovingImageDimension == 3 )
+  for( SizeValueType i = 0; i < this->m_RigidGridPoints.size(); ++i )
   {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
-    {
-      penaltyGridIndex = pgi.GetIndex();
-
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+    value += this->m_RigidGridPointValues[ i ];
 
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
-
-      ni.SetLocation( penaltyGridIndex );
+    const double * gradient = &this->m_RigidGridPointGradients[ 3 * i ];
+    this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( this->m_RigidGridPoints[ i ], tindex );
+    for( unsigned dd = 0; dd < ImageDimension; dd++ )
+    {
+      ntindex_start[ dd ] = static_cast< ContinuousIndexValueType >( floor( tindex[ dd ] ) ) - 1.0;
+    }
 
-      /** Penalty term calculation */
-      if( pixelValue > 0 && pixelValue < 6 )
+    for( unsigned int kk = 0; kk < 4; ++kk )
+    {
+      p = ntindex_start[ 2 ] + kk;
+      for( unsigned int jj = 0; jj < 4; ++jj )
       {
-        numberOfRigidGridsNeighbor = 0;
-
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+        n = ntindex_start[ 1 ] + jj;
+        for( unsigned int ii = 0; ii < 4; ++ii )
         {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
+          m = ntindex_start[ 0 ] + ii;
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+          const MeasureType du_dC = ( bSplineKernel->Evaluate( tindex[ 0 ] - m ) )
+            * ( bSplineKernel->Evaluate( tindex[ 1 ] - n ) )
+            * ( bSplineKernel->Evaluate( tindex[ 2 ] - p ) );
 
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+          const unsigned int par = static_cast< unsigned int >( m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( n )
+            + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( p );
 
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
+          derivative[ par ]                                      += gradient[ 0 ] * du_dC;
+          derivative[ par + numberOfParametersPerDimension ]     += gradient[ 1 ] * du_dC;
+          derivative[ par + 2 * numberOfParametersPerDimension ] += gradient[ 2 ] * du_dC;
         }
-
-        if( numberOfRigidGridsNeighbor > 1 )
-        {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
-
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
-
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
-
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
-
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
-
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
-
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
-
-              value += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              // find neighboring B-Spline control points
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( penaltyGridPoint, tindex );
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( neighborPenaltyGridPoint, tindex_neighbor );
-
-              tx = tindex[ 0 ];
-              ty = tindex[ 1 ];
-              tz = tindex[ 2 ];
-
-              tx_neighbor = tindex_neighbor[ 0 ];
-              ty_neighbor = tindex_neighbor[ 1 ];
-              tz_neighbor = tindex_neighbor[ 2 ];
-
-              for( unsigned dd = 0; dd < ImageDimension; dd++ )
-              {
-                ntindex_start[ dd ]          = static_cast< ContinuousIndexValueType >( floor( tindex[ dd ] ) ) - 1.0;
-                ntindex_neighbor_start[ dd ] = static_cast< ContinuousIndexValueType >( floor( tindex_neighbor[ dd ] ) ) - 1.0;
-              }
-
-              derivativeTermTemp1 = 4 * ( dx - dX ) * ( xn[ 0 ] - xf[ 0 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp2 = 4 * ( dx - dX ) * ( xn[ 1 ] - xf[ 1 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp3 = 4 * ( dx - dX ) * ( xn[ 2 ] - xf[ 2 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              for( unsigned int kk = 0; kk < 4; ++kk )
-              {
-                p          = ntindex_start[ 2 ] + kk;
-                neighbor_p = ntindex_neighbor_start[ 2 ] + kk;
-
-                for( unsigned int jj = 0; jj < 4; ++jj )
-                {
-                  n          = ntindex_start[ 1 ] + jj;
-                  neighbor_n = ntindex_neighbor_start[ 1 ] + jj;
-
-                  for( unsigned int ii = 0; ii < 4; ++ii )
-                  {
-                    m          = ntindex_start[ 0 ] + ii;
-                    neighbor_m = ntindex_neighbor_start[ 0 ] + ii;
-
-                    // neighborhood of (i',j',k')
-                    du_dC_neighbor = ( bSplineKernel->Evaluate( tx_neighbor - neighbor_m ) ) * ( bSplineKernel->Evaluate( ty_neighbor - neighbor_n ) )
-                      * ( bSplineKernel->Evaluate( tz_neighbor - neighbor_p ) );
-
-                    par1 = static_cast< unsigned int >( neighbor_m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( neighbor_n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( neighbor_p );
-
-                    derivative[ par1 ]                                      += derivativeTermTemp1 * du_dC_neighbor;
-                    derivative[ par1 + numberOfParametersPerDimension ]     += derivativeTermTemp2 * du_dC_neighbor;
-                    derivative[ par1 + 2 * numberOfParametersPerDimension ] += derivativeTermTemp3 * du_dC_neighbor;
-
-                    // neighborhood of (i,j,k)
-                    du_dC = ( bSplineKernel->Evaluate( tx - m ) ) * ( bSplineKernel->Evaluate( ty - n ) )
-                      * ( bSplineKernel->Evaluate( tz - p ) );
-
-                    par2 = static_cast< unsigned int >( m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( p );
-
-                    derivative[ par2 ]                                      -= derivativeTermTemp1 * du_dC;
-                    derivative[ par2 + numberOfParametersPerDimension ]     -= derivativeTermTemp2 * du_dC;
-                    derivative[ par2 + 2 * numberOfParametersPerDimension ] -= derivativeTermTemp3 * du_dC;
-                  }
-                }
-              }
-            }
-          } // end for
-        }   // end if
       }
-    } // end for
-  }   // end if ( dimension = 3 )
+    }
+  }
 
 } // end GetValueAndDerivative()
 
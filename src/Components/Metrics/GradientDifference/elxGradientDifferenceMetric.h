@@ -28,6 +28,15 @@ namespace elastix
  * \class GradientDifferenceMetric
  * \brief An metric based on the itk::GradientDifferenceImageToImageMetric.
  *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "GradientDifference")</tt>
+ * \parameter UseSampledMovingGradients: Whether the metric is computed at the samples of the
+ *    image sampler only, instead of at all pixels of the fixed image. The moving image is then
+ *    only resampled in the neighbourhoods of the samples. An ImageSampler should be selected,
+ *    for example "Grid" or "RandomCoordinate". Given for all resolutions at once. \n
+ *    example: <tt>(UseSampledMovingGradients "true")</tt> \n
+ *    The default value is "false".
  *
  * \ingroup Metrics
  *
@@ -137,6 +146,11 @@ public:
    * \li Set UseNormalization setting
    */
 
+  /** Read the UseSampledMovingGradients option. This has to be done before
+   * the registration connects the image sampler to the metric.
+   */
+  virtual int BeforeAll( void );
+
   virtual void BeforeRegistration( void );
 
   virtual void BeforeEachResolution( void );
@@ -43,6 +43,27 @@ GradientDifferenceMetric< TElastix >
 } // end Initialize()
 
 
+/**
+ * ***************** BeforeAll ***********************
+ */
+
+template< class TElastix >
+int
+GradientDifferenceMetric< TElastix >
+::BeforeAll( void )
+{
+  /** Check if the metric is computed at the samples only. */
+  bool useSampledMovingGradients = false;
+  this->GetConfiguration()->ReadParameter( useSampledMovingGradients,
+    "UseSampledMovingGradients", this->GetComponentLabel(), 0, 0, true );
+  this->SetUseSampledMovingGradients( useSampledMovingGradients );
+  this->SetUseImageSampler( useSampledMovingGradients );
+
+  return 0;
+
+} // end BeforeAll()
+
+
 /**
  * ***************** BeforeRegistration ***********************
  */
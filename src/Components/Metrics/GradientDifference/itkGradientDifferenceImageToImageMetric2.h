@@ -44,6 +44,7 @@
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkMovedImageGradientSampler.h"
 
 namespace itk
 {
@@ -69,6 +70,13 @@ namespace itk
  * Cerebral Angiograms,", IEEE Transactions on Medical Imaging,
  * 22(11):1417-1426.
  *
+ * By default the moving image is resampled on the whole fixed image grid, and
+ * the measure is computed over the whole fixed image region. If
+ * UseSampledMovingGradients is set, the measure is only computed at the
+ * samples of the image sampler, and the moving image is only resampled in
+ * the neighbourhoods of those samples. The gradients of the fixed image are
+ * computed once in Initialize().
+ *
  * \ingroup RegistrationMetrics
  */
 template< class TFixedImage, class TMovingImage >
@@ -144,6 +152,11 @@ public:
     CastMovedImageFilterType;
   typedef typename CastMovedImageFilterType::Pointer CastMovedImageFilterPointer;
   typedef typename MovedGradientImageType::PixelType MovedGradientPixelType;
+  typedef MovedImageGradientSampler< FixedImageType, MovingImageType >
+    MovedGradientSamplerType;
+  typedef typename MovedGradientSamplerType::Pointer MovedGradientSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
 
   /** Get the derivatives of the match measure. */
   void GetDerivative( const TransformParametersType & parameters,
@@ -170,6 +183,13 @@ public:
   itkSetMacro( DerivativeDelta, double );
   itkGetConstReferenceMacro( DerivativeDelta, double );
 
+  /** Compute the measure at the samples of the image sampler only, instead
+   * of over the whole fixed image region. Default: false.
+   */
+  itkSetMacro( UseSampledMovingGradients, bool );
+  itkGetConstMacro( UseSampledMovingGradients, bool );
+  itkBooleanMacro( UseSampledMovingGradients );
+
 protected:
 
   GradientDifferenceImageToImageMetric();
@@ -186,6 +206,14 @@ protected:
   MeasureType ComputeMeasure( const TransformParametersType & parameters,
     const double * subtractionFactor ) const;
 
+  /** Compute the similarity measure at the samples of the image sampler. */
+  MeasureType ComputeMeasureAtSamples( const TransformParametersType & parameters ) const;
+
+  /** Pass the fixed image indices of the samples to the moved gradient
+   * sampler, if the sample container changed.
+   */
+  void UpdateMovedGradientSampleIndices( void ) const;
+
   typedef NeighborhoodOperatorImageFilter<
     FixedGradientImageType, FixedGradientImageType > FixedSobelFilter;
 
@@ -239,6 +267,12 @@ private:
   double                      m_Rescalingfactor;
   CombinationTransformPointer m_CombinationTransform;
 
+  /** The sampled computation of the moving image gradients. */
+  bool                        m_UseSampledMovingGradients;
+  MovedGradientSamplerPointer m_MovedGradientSampler;
+  mutable unsigned long       m_MovedGradientSampleMTime;
+  mutable const void *        m_MovedGradientSampleContainer;
+
 };
 
 } // end namespace itk
@@ -78,6 +78,10 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 
   this->m_DerivativeDelta = 0.001;
   this->m_Rescalingfactor = 1.0;
+
+  this->m_UseSampledMovingGradients    = false;
+  this->m_MovedGradientSampleMTime     = 0;
+  this->m_MovedGradientSampleContainer = 0;
 }
 
 
@@ -123,6 +127,31 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
                        << "only suitable for 2D-3D registration.\n"
                        << "  Therefore it expects an interpolator of type RayCastInterpolator." );
   }
+  /** The sampled version only needs the fixed image gradients. */
+  if( this->m_UseSampledMovingGradients )
+  {
+    if( !this->m_UseImageSampler )
+    {
+      itkExceptionMacro( << "ERROR: UseSampledMovingGradients requires an image sampler." );
+    }
+    this->m_MovedGradientSampler = MovedGradientSamplerType::New();
+    this->m_MovedGradientSampler->SetFixedImage( this->m_FixedImage );
+    this->m_MovedGradientSampler->SetInterpolator( this->m_Interpolator );
+    this->m_MovedGradientSampler->SetTransform( rayCaster->GetTransform() );
+    this->m_MovedGradientSampleMTime     = 0;
+    this->m_MovedGradientSampleContainer = 0;
+
+    this->ComputeVariance();
+
+    this->m_Rescalingfactor = 1.0;
+    MeasureType tmpmeasure = this->GetValue( this->m_Transform->GetParameters() );
+    while( ( fabs( tmpmeasure ) / m_Rescalingfactor ) > 1 )
+    {
+      this->m_Rescalingfactor *= 10;
+    }
+    return;
+  }
+
   this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
   this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
   this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
@@ -171,6 +200,7 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+  os << indent << "UseSampledMovingGradients: " << this->m_UseSampledMovingGradients << std::endl;
 
 }
 
@@ -455,6 +485,108 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeMeasure()
 
 
+/**
+ * ******************** UpdateMovedGradientSampleIndices ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateMovedGradientSampleIndices( void ) const
+{
+  /** The samples are only converted when the sampler selected new ones. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  if( sampleContainer.GetPointer() == this->m_MovedGradientSampleContainer
+    && sampleContainer->GetMTime() == this->m_MovedGradientSampleMTime )
+  {
+    return;
+  }
+
+  /** Round the sample positions to the fixed image grid. */
+  typename MovedGradientSamplerType::IndexContainerType indices;
+  indices.reserve( sampleContainer->Size() );
+  typename FixedImageType::IndexType index;
+  typename ImageSampleContainerType::ConstIterator iter;
+  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
+  for( iter = sampleContainer->Begin(); iter != end; ++iter )
+  {
+    if( this->m_FixedImage->TransformPhysicalPointToIndex(
+      ( *iter ).Value().m_ImageCoordinates, index ) )
+    {
+      indices.push_back( index );
+    }
+  }
+
+  this->m_MovedGradientSampler->SetSampleIndices( indices );
+  this->m_MovedGradientSampleContainer = sampleContainer.GetPointer();
+  this->m_MovedGradientSampleMTime     = sampleContainer->GetMTime();
+
+} // end UpdateMovedGradientSampleIndices()
+
+
+/**
+ * ******************** ComputeMeasureAtSamples ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasureAtSamples( const TransformParametersType & parameters ) const
+{
+  /** Set the parameters and update the image sampler. */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+  this->UpdateMovedGradientSampleIndices();
+
+  /** Compute the moved image gradients at the samples only. */
+  this->m_MovedGradientSampler->Compute();
+  const typename MovedGradientSamplerType::IndexContainerType & indices
+    = this->m_MovedGradientSampler->GetSampleIndices();
+  const typename MovedGradientSamplerType::GradientContainerType & movedGradients
+    = this->m_MovedGradientSampler->GetGradients();
+  const std::size_t numberOfSamples = indices.size();
+
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  if( numberOfSamples == 0 )
+  {
+    return measure;
+  }
+
+  for( unsigned int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    /** Compute the range of the moved image gradients at the samples. */
+    this->m_MinMovedGradient[ iDimension ] = movedGradients[ 0 ][ iDimension ];
+    this->m_MaxMovedGradient[ iDimension ] = movedGradients[ 0 ][ iDimension ];
+    for( std::size_t s = 1; s < numberOfSamples; ++s )
+    {
+      const MovedGradientPixelType gradient = movedGradients[ s ][ iDimension ];
+      this->m_MinMovedGradient[ iDimension ] = vnl_math_min( this->m_MinMovedGradient[ iDimension ], gradient );
+      this->m_MaxMovedGradient[ iDimension ] = vnl_math_max( this->m_MaxMovedGradient[ iDimension ], gradient );
+    }
+
+    if( this->m_Variance[ iDimension ] == NumericTraits< MovedGradientPixelType >::ZeroValue() )
+    {
+      continue;
+    }
+
+    const MovedGradientPixelType subtractionFactor
+      = this->m_MaxFixedGradient[ iDimension ] / this->m_MaxMovedGradient[ iDimension ];
+    const FixedGradientImageType * fixedGradientImage
+      = this->m_FixedSobelFilters[ iDimension ]->GetOutput();
+
+    for( std::size_t s = 0; s < numberOfSamples; ++s )
+    {
+      const FixedGradientPixelType fixedGradient = fixedGradientImage->GetPixel( indices[ s ] );
+      const MovedGradientPixelType diff
+        = fixedGradient - subtractionFactor * movedGradients[ s ][ iDimension ];
+      measure += this->m_Variance[ iDimension ] / ( this->m_Variance[ iDimension ] + diff * diff );
+    }
+  }
+
+  return measure /= -this->m_Rescalingfactor; //negative for minimization
+
+} // end ComputeMeasureAtSamples()
+
+
 /**
  * ******************** GetValue ******************************
  */
@@ -464,6 +596,11 @@ typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::Meas
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
+  if( this->m_UseSampledMovingGradients )
+  {
+    return this->ComputeMeasureAtSamples( parameters );
+  }
+
   unsigned int iFilter;
   unsigned int iDimension;
   this->SetTransformParameters( parameters );
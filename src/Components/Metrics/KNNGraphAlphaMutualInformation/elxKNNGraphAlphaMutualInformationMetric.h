@@ -37,12 +37,20 @@ namespace elastix
  *    Choose a value between 0.0 and 1.0. The default is 0.5.
  * \parameter TreeType: The type of the kNN binary tree. \n
  *    <tt>(TreeType "BDTree" "BruteForceTree")</tt> \n
- *    Choose one of { KDTree, BDTree, BruteForceTree }. \n
+ *    Choose one of { KDTree, BDTree, BruteForceTree, UniformGridHashTree }. \n
+ *    The UniformGridHashTree sorts the samples into the cells of a uniform grid, with a hash table.
+ *    It is built in linear time and searched exactly, and is efficient for feature spaces of a few
+ *    dimensions. It supports the Standard and FixedRadius TreeSearchType, and ignores the ErrorBound. \n
  *    The default is "KDTree" for all resolutions.
  * \parameter BucketSize: The maximum number of samples in one bucket. \n
- *    This parameter influences the calculation time only, and is not appropiate for the BruteForceTree. \n
+ *    This parameter influences the calculation time only, and is not appropiate for the BruteForceTree.
+ *    For the UniformGridHashTree it is the average number of samples per cell, if GridCellSize is 0. \n
  *    <tt>(BucketSize 5 100 50)</tt> \n
- *    The default is 50 for all resolutions.
+ *    The default is 50 for all resolutions, and 10 for the UniformGridHashTree.
+ * \parameter GridCellSize: The size of the cells of the UniformGridHashTree, in feature units. \n
+ *    For a FixedRadius search a size near the radius is efficient. \n
+ *    <tt>(GridCellSize 16.0 8.0 4.0)</tt> \n
+ *    The default is 0.0 for all resolutions, which chooses the size from the BucketSize.
  * \parameter SplittingRule: This rule defines how the feature space is split. \n
  *    <tt>(SplittingRule "ANN_KD_STD" "ANN_KD_FAIR")</tt> \n
  *    Choose one of { ANN_KD_STD, ANN_KD_MIDPT, ANN_KD_SL_MIDPT, ANN_KD_FAIR, ANN_KD_SL_FAIR, ANN_KD_SUGGEST } \n
@@ -70,6 +78,15 @@ namespace elastix
  * \parameter AvoidDivisionBy: a small number to avoid division by zero in the implentation. \n
  *    <tt>(AvoidDivisionBy 0.000000001)</tt> \n
  *    The default is 1e-5.
+ * \parameter UseIncrementalKNNGraph: keep the kNN graph between iterations and only
+ *    rebuild the trees when the samples change or when too many points moved too far. \n
+ *    This is most effective in combination with (NewSamplesEveryIteration "false"). \n
+ *    <tt>(UseIncrementalKNNGraph "true")</tt> \n
+ *    The default is "false" for all resolutions.
+ * \parameter IncrementalKNNGraphRebuildFraction: the fraction of points for which the
+ *    stored candidate neighbours may be unreliable before the incremental kNN graph is rebuilt. \n
+ *    <tt>(IncrementalKNNGraphRebuildFraction 0.05)</tt> \n
+ *    The default is 0.05 for all resolutions.
  *
  * \warning Note that we assume the FixedFeatureImageType to have the same
  * pixeltype as the FixedImageType
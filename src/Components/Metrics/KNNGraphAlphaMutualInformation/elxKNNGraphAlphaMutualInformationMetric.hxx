@@ -101,9 +101,16 @@ KNNGraphAlphaMutualInformationMetric< TElastix >
     silentSplit  = true;
     silentShrink = true;
   }
+  else if( treeType == "UniformGridHashTree" )
+  {
+    silentSplit  = true;
+    silentShrink = true;
+  }
 
-  /** Get the bucket size. */
-  unsigned int bucketSize = 50;
+  /** Get the bucket size. For the uniform grid hash tree it is the average
+   * number of samples per cell.
+   */
+  unsigned int bucketSize = treeType == "UniformGridHashTree" ? 10 : 50;
   this->m_Configuration->ReadParameter( bucketSize, "BucketSize", 0, silentBS );
   this->m_Configuration->ReadParameter( bucketSize, "BucketSize", level, true );
 
@@ -179,6 +186,13 @@ KNNGraphAlphaMutualInformationMetric< TElastix >
   {
     this->SetANNBruteForceTree();
   }
+  else if( treeType == "UniformGridHashTree" )
+  {
+    double cellSize = 0.0;
+    this->m_Configuration->ReadParameter( cellSize, "GridCellSize", 0, true );
+    this->m_Configuration->ReadParameter( cellSize, "GridCellSize", level, true );
+    this->SetUniformGridHashTree( bucketSize, cellSize );
+  }
   else
   {
     itkExceptionMacro( << "ERROR: there is no tree type \""
@@ -217,8 +231,26 @@ KNNGraphAlphaMutualInformationMetric< TElastix >
   this->m_Configuration->ReadParameter( squaredSearchRadius,
     "SquaredSearchRadius", level, true );
 
-  /** Set the tree searcher. */
-  if( treeSearchType == "Standard" )
+  /** Set the tree searcher. The uniform grid hash tree has its own exact
+   * searcher, with or without a radius.
+   */
+  if( treeType == "UniformGridHashTree" )
+  {
+    if( treeSearchType == "Standard" )
+    {
+      this->SetUniformGridHashTreeSearch( kNearestNeighbours, 0.0 );
+    }
+    else if( treeSearchType == "FixedRadius" )
+    {
+      this->SetUniformGridHashTreeSearch( kNearestNeighbours, squaredSearchRadius );
+    }
+    else
+    {
+      itkExceptionMacro( << "ERROR: the tree searcher type \""
+                         << treeSearchType << "\" is not implemented for the UniformGridHashTree." );
+    }
+  }
+  else if( treeSearchType == "Standard" )
   {
     this->SetANNStandardTreeSearch( kNearestNeighbours, errorBound );
   }
@@ -237,6 +269,17 @@ KNNGraphAlphaMutualInformationMetric< TElastix >
                        << treeSearchType << "\" implemented." );
   }
 
+  /** Get the settings of the incremental kNN graph. */
+  bool useIncrementalKNNGraph = false;
+  this->GetConfiguration()->ReadParameter( useIncrementalKNNGraph,
+    "UseIncrementalKNNGraph", this->GetComponentLabel(), level, 0 );
+  this->SetUseIncrementalKNNGraph( useIncrementalKNNGraph );
+
+  double rebuildFraction = 0.05;
+  this->GetConfiguration()->ReadParameter( rebuildFraction,
+    "IncrementalKNNGraphRebuildFraction", this->GetComponentLabel(), level, 0 );
+  this->SetIncrementalKNNGraphRebuildFraction( rebuildFraction );
+
 } // end BeforeEachResolution()
 
 
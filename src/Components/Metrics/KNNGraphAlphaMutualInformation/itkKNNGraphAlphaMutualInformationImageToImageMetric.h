@@ -31,11 +31,13 @@
 #include "itkANNkDTree.h"
 #include "itkANNbdTree.h"
 #include "itkANNBruteForceTree.h"
+#include "itkUniformGridHashTree.h"
 
 /** Supported tree searchers. */
 #include "itkANNStandardTreeSearch.h"
 #include "itkANNFixedRadiusTreeSearch.h"
 #include "itkANNPriorityTreeSearch.h"
+#include "itkUniformGridHashTreeSearch.h"
 
 /** Include for the spatial derivatives. */
 #include "itkArray2D.h"
@@ -154,20 +156,23 @@ public:
   typedef typename Statistics::ListSampleCArray<
     MeasurementVectorType, double >                   ListSampleType;
   typedef typename ListSampleType::Pointer ListSamplePointer;
+  typedef typename ListSampleType::InternalDataContainerType InternalDataContainerType;
 
   /** Typedefs for trees. */
-  typedef BinaryTreeBase< ListSampleType >    BinaryKNNTreeType;
-  typedef typename BinaryKNNTreeType::Pointer BinaryKNNTreePointer;
-  typedef ANNkDTree< ListSampleType >         ANNkDTreeType;
-  typedef ANNbdTree< ListSampleType >         ANNbdTreeType;
-  typedef ANNBruteForceTree< ListSampleType > ANNBruteForceTreeType;
+  typedef BinaryTreeBase< ListSampleType >      BinaryKNNTreeType;
+  typedef typename BinaryKNNTreeType::Pointer   BinaryKNNTreePointer;
+  typedef ANNkDTree< ListSampleType >           ANNkDTreeType;
+  typedef ANNbdTree< ListSampleType >           ANNbdTreeType;
+  typedef ANNBruteForceTree< ListSampleType >   ANNBruteForceTreeType;
+  typedef UniformGridHashTree< ListSampleType > UniformGridHashTreeType;
 
   /** Typedefs for tree searchers. */
-  typedef BinaryTreeSearchBase< ListSampleType >     BinaryKNNTreeSearchType;
-  typedef typename BinaryKNNTreeSearchType::Pointer  BinaryKNNTreeSearchPointer;
-  typedef ANNStandardTreeSearch< ListSampleType >    ANNStandardTreeSearchType;
-  typedef ANNFixedRadiusTreeSearch< ListSampleType > ANNFixedRadiusTreeSearchType;
-  typedef ANNPriorityTreeSearch< ListSampleType >    ANNPriorityTreeSearchType;
+  typedef BinaryTreeSearchBase< ListSampleType >      BinaryKNNTreeSearchType;
+  typedef typename BinaryKNNTreeSearchType::Pointer   BinaryKNNTreeSearchPointer;
+  typedef ANNStandardTreeSearch< ListSampleType >     ANNStandardTreeSearchType;
+  typedef ANNFixedRadiusTreeSearch< ListSampleType >  ANNFixedRadiusTreeSearchType;
+  typedef ANNPriorityTreeSearch< ListSampleType >     ANNPriorityTreeSearchType;
+  typedef UniformGridHashTreeSearch< ListSampleType > UniformGridHashTreeSearchType;
 
   typedef typename BinaryKNNTreeSearchType::IndexArrayType    IndexArrayType;
   typedef typename BinaryKNNTreeSearchType::DistanceArrayType DistanceArrayType;
@@ -177,7 +182,7 @@ public:
 
   /**
    * *** Set trees: ***
-   * Currently kd, bd, and brute force trees are supported.
+   * Currently kd, bd, brute force and uniform grid hash trees are supported.
    */
 
   /** Set ANNkDTree. */
@@ -200,9 +205,13 @@ public:
   /** Set ANNBruteForceTree. */
   void SetANNBruteForceTree( void );
 
+  /** Set UniformGridHashTree, with a cellSize of 0 for an automatic one. */
+  void SetUniformGridHashTree( unsigned int pointsPerCell, double cellSize );
+
   /**
    * *** Set tree searchers: ***
-   * Currently standard, fixed radius, and priority tree searchers are supported.
+   * Currently standard, fixed radius, and priority tree searchers are supported,
+   * and the uniform grid hash tree searcher, for the uniform grid hash tree.
    */
 
   /** Set ANNStandardTreeSearch. */
@@ -217,6 +226,10 @@ public:
   void SetANNPriorityTreeSearch( unsigned int kNearestNeighbors,
     double errorBound );
 
+  /** Set UniformGridHashTreeSearch, with a squaredRadius of 0 for no radius. */
+  void SetUniformGridHashTreeSearch( unsigned int kNearestNeighbors,
+    double squaredRadius );
+
   /**
    * *** Standard metric stuff: ***
    */
@@ -247,6 +260,27 @@ public:
   /** Avoid division by a small number. */
   itkGetConstReferenceMacro( AvoidDivisionBy, double );
 
+  /** Keep the kNN graph between iterations and update it incrementally.
+   * At a rebuild 2k candidate neighbours are stored for every query point of
+   * the moving and joint graphs, together with the gap between the distance of
+   * the k-th and the last candidate. In the next iterations the neighbours are
+   * selected from the candidates, which is exact as long as the displacement
+   * of the moving features is small compared to that gap. Points that move too
+   * far are searched exhaustively; when their fraction exceeds the
+   * IncrementalKNNGraphRebuildFraction, or when the samples change, the trees
+   * are rebuilt. The fixed graph only changes with the samples. This mode is
+   * meant for the standard and priority tree searchers.
+   */
+  itkSetMacro( UseIncrementalKNNGraph, bool );
+  itkGetConstMacro( UseIncrementalKNNGraph, bool );
+  itkBooleanMacro( UseIncrementalKNNGraph );
+
+  /** The fraction of query points that may need an exhaustive search
+   * before the incremental kNN graph is rebuilt.
+   */
+  itkSetClampMacro( IncrementalKNNGraphRebuildFraction, double, 0.0, 1.0 );
+  itkGetConstMacro( IncrementalKNNGraphRebuildFraction, double );
+
 protected:
 
   /** Constructor. */
@@ -270,6 +304,11 @@ protected:
   double m_Alpha;
   double m_AvoidDivisionBy;
 
+  /** The list samples, kept between iterations to reuse their memory. */
+  ListSamplePointer m_ListSampleFixed;
+  ListSamplePointer m_ListSampleMoving;
+  ListSamplePointer m_ListSampleJoint;
+
 private:
 
   KNNGraphAlphaMutualInformationImageToImageMetric( const Self & ); // purposely not implemented
@@ -335,6 +374,114 @@ private:
     DerivativeType & dGamma_M,
     DerivativeType & dGamma_J ) const;
 
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+  typedef std::pair< double, int >                              CandidateType;
+  typedef std::vector< CandidateType >                          CandidateContainerType;
+
+  /** The ways in which the neighbours of the query points are found. */
+  enum KNNSearchModeType {
+    TreeSearch,
+    RebuildKNNGraph,
+    UpdateKNNGraph
+  };
+
+  /** Decide whether the trees are (re)generated or whether the incremental
+   * kNN graph can be updated, and generate the trees if needed.
+   */
+  void PrepareKNNSearch(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint ) const;
+
+  /** Select the k nearest neighbours of a query point from a list of
+   * candidates by computing the distances explicitly. If candidates is 0
+   * all points of the list sample are candidates.
+   */
+  static void SelectNearestNeighbours(
+    const ListSampleType * listSample, SizeValueType query,
+    const int * candidates, SizeValueType numberOfCandidates, unsigned int k,
+    CandidateContainerType & scratch,
+    IndexArrayType & indices, DistanceArrayType & distances );
+
+  /** Generate the fixed, moving and joint trees, concurrently if
+   * multi-threading is enabled, and connect them to the searchers.
+   */
+  void GenerateTrees(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint ) const;
+
+  /** Search the k nearest neighbours of all query points and add their
+   * contributions to sumG and, if contribution is not 0, to the derivative.
+   * The query points are distributed over the threads.
+   */
+  void ComputeKNNContributions(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint,
+    const TransformJacobianContainerType * jacobians,
+    const TransformJacobianIndicesContainerType * jacobiansIndices,
+    const SpatialDerivativeContainerType * spatialDerivatives,
+    AccumulateType & sumG,
+    DerivativeType * contribution ) const;
+
+  /** Range functions for the PersistentThreadPool. */
+  static void GenerateTreesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void KNNQueryRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  struct GenerateTreesPassStruct
+  {
+    BinaryKNNTreeType * st_Trees[ 3 ];
+  };
+
+  struct KNNQueryPassStruct
+  {
+    const Self *                                  st_Metric;
+    const ListSampleType *                        st_ListSampleFixed;
+    const ListSampleType *                        st_ListSampleMoving;
+    const ListSampleType *                        st_ListSampleJoint;
+    const TransformJacobianContainerType *        st_Jacobians;
+    const TransformJacobianIndicesContainerType * st_JacobiansIndices;
+    const SpatialDerivativeContainerType *        st_SpatialDerivatives;
+    bool                                          st_ComputeDerivative;
+  };
+
+  /** The partial results of a thread. */
+  struct KNNQueryPerThreadStruct
+  {
+    AccumulateType         st_SumG;
+    DerivativeType         st_Contribution;
+    DerivativeType         st_dGamma_M;
+    DerivativeType         st_dGamma_J;
+    bool                   st_ContributionIsInitialized;
+    CandidateContainerType st_Candidates;
+  };
+
+  mutable std::vector< KNNQueryPerThreadStruct > m_KNNQueryPerThreadVariables;
+
+  /** Variables of the incremental kNN graph. */
+  bool   m_UseIncrementalKNNGraph;
+  double m_IncrementalKNNGraphRebuildFraction;
+
+  mutable KNNSearchModeType            m_KNNSearchMode;
+  mutable bool                         m_KNNGraphIsValid;
+  mutable unsigned int                 m_KNNGraphK;
+  mutable unsigned int                 m_KNNGraphNumberOfCandidates;
+  mutable unsigned long                m_KNNGraphSampleMTime;
+  mutable std::vector< unsigned long > m_KNNGraphSampleIndices;
+  mutable std::vector< unsigned long > m_CurrentSampleIndices;
+  mutable std::vector< int >           m_KNNGraphFixedIndices;
+  mutable std::vector< double >        m_KNNGraphFixedDistances;
+  mutable std::vector< int >           m_KNNGraphMovingCandidates;
+  mutable std::vector< int >           m_KNNGraphJointCandidates;
+  mutable std::vector< double >        m_KNNGraphMovingGaps;
+  mutable std::vector< double >        m_KNNGraphJointGaps;
+  mutable std::vector< double >        m_KNNGraphReferenceMovingFeatures;
+  mutable std::vector< unsigned char > m_KNNGraphNeedsExactSearch;
+
 };
 
 } // end namespace itk
@@ -20,6 +20,8 @@
 
 #include "itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -44,6 +46,18 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_BinaryKNNTreeSearcherMoving = 0;
   this->m_BinaryKNNTreeSearcherJoint  = 0;
 
+  this->m_ListSampleFixed  = ListSampleType::New();
+  this->m_ListSampleMoving = ListSampleType::New();
+  this->m_ListSampleJoint  = ListSampleType::New();
+
+  this->m_UseIncrementalKNNGraph             = false;
+  this->m_IncrementalKNNGraphRebuildFraction = 0.05;
+  this->m_KNNSearchMode                      = TreeSearch;
+  this->m_KNNGraphIsValid                    = false;
+  this->m_KNNGraphK                          = 0;
+  this->m_KNNGraphNumberOfCandidates         = 0;
+  this->m_KNNGraphSampleMTime                = 0;
+
 } // end Constructor()
 
 
@@ -161,6 +175,34 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end SetANNBruteForceTree()
 
 
+/**
+ * ************************ SetUniformGridHashTree *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::SetUniformGridHashTree( unsigned int pointsPerCell, double cellSize )
+{
+  typename UniformGridHashTreeType::Pointer tmpPtrF = UniformGridHashTreeType::New();
+  typename UniformGridHashTreeType::Pointer tmpPtrM = UniformGridHashTreeType::New();
+  typename UniformGridHashTreeType::Pointer tmpPtrJ = UniformGridHashTreeType::New();
+
+  tmpPtrF->SetPointsPerCell( pointsPerCell );
+  tmpPtrM->SetPointsPerCell( pointsPerCell );
+  tmpPtrJ->SetPointsPerCell( pointsPerCell );
+
+  tmpPtrF->SetCellSize( cellSize );
+  tmpPtrM->SetCellSize( cellSize );
+  tmpPtrJ->SetCellSize( cellSize );
+
+  this->m_BinaryKNNTreeFixed  = tmpPtrF;
+  this->m_BinaryKNNTreeMoving = tmpPtrM;
+  this->m_BinaryKNNTreeJoint  = tmpPtrJ;
+
+} // end SetUniformGridHashTree()
+
+
 /**
  * ************************ SetANNStandardTreeSearch *************************
  */
@@ -265,6 +307,39 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end SetANNPriorityTreeSearch()
 
 
+/**
+ * ************************ SetUniformGridHashTreeSearch *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::SetUniformGridHashTreeSearch(
+  unsigned int kNearestNeighbors,
+  double squaredRadius )
+{
+  typename UniformGridHashTreeSearchType::Pointer tmpPtrF
+    = UniformGridHashTreeSearchType::New();
+  typename UniformGridHashTreeSearchType::Pointer tmpPtrM
+    = UniformGridHashTreeSearchType::New();
+  typename UniformGridHashTreeSearchType::Pointer tmpPtrJ
+    = UniformGridHashTreeSearchType::New();
+
+  tmpPtrF->SetKNearestNeighbors( kNearestNeighbors );
+  tmpPtrM->SetKNearestNeighbors( kNearestNeighbors );
+  tmpPtrJ->SetKNearestNeighbors( kNearestNeighbors );
+
+  tmpPtrF->SetSquaredRadius( squaredRadius );
+  tmpPtrM->SetSquaredRadius( squaredRadius );
+  tmpPtrJ->SetSquaredRadius( squaredRadius );
+
+  this->m_BinaryKNNTreeSearcherFixed  = tmpPtrF;
+  this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
+  this->m_BinaryKNNTreeSearcherJoint  = tmpPtrJ;
+
+} // end SetUniformGridHashTreeSearch()
+
+
 /**
  * ********************* Initialize *****************************
  */
@@ -289,6 +364,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     itkExceptionMacro( << "ERROR: The kNN tree searcher is not set. " );
   }
 
+  /** The trees and the searchers may have changed, so start a new kNN graph. */
+  this->m_KNNGraphIsValid = false;
+
 } // end Initialize()
 
 
@@ -311,10 +389,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * *************** Create the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed  = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint  = ListSampleType::New();
+  /** Get the list samples, which keep their memory between iterations. */
+  ListSamplePointer listSampleFixed  = this->m_ListSampleFixed;
+  ListSamplePointer listSampleMoving = this->m_ListSampleMoving;
+  ListSamplePointer listSampleJoint  = this->m_ListSampleJoint;
 
   /** Compute the three list samples. */
   TransformJacobianContainerType        dummyJacobianContainer;
@@ -333,28 +411,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   /**
    * *************** Generate the three trees ******************
    *
-   * and connect them to the searchers.
+   * and connect them to the searchers, or update the incremental kNN graph.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->PrepareKNNSearch( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI ******************
@@ -389,77 +449,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J;
-  IndexArrayType        indices_F, indices_M, indices_J;
-  DistanceArrayType     distances_F, distances_M, distances_J;
-
-  MeasureType    H, G;
+  /** Search the neighbours of all query points and sum the contributions. */
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize  = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize  = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
-
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
-  {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = vcl_sqrt( distsJ[ j ] );
-    denominator = vcl_sqrt( vcl_sqrt( distsF[ j ] ) * vcl_sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += vcl_pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-    * for the three graphs:
-    * sum M / sqrt( sum F * sum M)
-    */
-
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
-
-    /** Loop over the neighbours. */
-    for( unsigned int p = 0; p < k; p++ )
-    {
-      Gamma_F += vcl_sqrt( distances_F[ p ] );
-      Gamma_M += vcl_sqrt( distances_M[ p ] );
-      Gamma_J += vcl_sqrt( distances_J[ p ] );
-    } // end loop over the k neighbours
-
-    /** Calculate the contribution of this query point. */
-    H = vcl_sqrt( Gamma_F * Gamma_M );
-    if( H > this->m_AvoidDivisionBy )
-    {
-      /** Compute some sums. */
-      G     = Gamma_J / H;
-      sumG += vcl_pow( G, twoGamma );
-    }
-  } // end looping over all query points
+  this->ComputeKNNContributions( listSampleFixed, listSampleMoving, listSampleJoint,
+    0, 0, 0, sumG, 0 );
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -538,10 +531,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * *************** Create the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed  = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint  = ListSampleType::New();
+  /** Get the list samples, which keep their memory between iterations. */
+  ListSamplePointer listSampleFixed  = this->m_ListSampleFixed;
+  ListSamplePointer listSampleMoving = this->m_ListSampleMoving;
+  ListSamplePointer listSampleJoint  = this->m_ListSampleJoint;
 
   /** Compute the three list samples and the derivatives. */
   TransformJacobianContainerType        jacobianContainer;
@@ -558,28 +551,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   /**
    * *************** Generate the three trees ******************
    *
-   * and connect them to the searchers.
+   * and connect them to the searchers, or update the incremental kNN graph.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->PrepareKNNSearch( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI and its derivatives ******************
@@ -614,32 +589,404 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
+  /** Get the size of the feature vectors. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages()
+    + this->GetNumberOfMovingImages();
+
+  /** Search the neighbours of all query points and sum the contributions
+   * to the value and the derivative.
+   */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  DerivativeType contribution( this->GetNumberOfParameters() );
+  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  this->ComputeKNNContributions( listSampleFixed, listSampleMoving, listSampleJoint,
+    &jacobianContainer, &jacobianIndicesContainer, &spatialDerivativesContainer,
+    sumG, &contribution );
+
+  /**
+   * *************** Finally, calculate the metric value and derivative ******************
+   */
+
+  /** Compute the value. */
+  double n, number;
+  if( sumG > this->m_AvoidDivisionBy )
+  {
+    /** Compute the measure. */
+    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
+    number  = vcl_pow( n, this->m_Alpha );
+    measure = vcl_log( sumG / number ) / ( this->m_Alpha - 1.0 );
+
+    /** Compute the derivative (-2.0 * d = -jointSize). */
+    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+  }
+  value = -measure;
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ************************ PrepareKNNSearch *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::PrepareKNNSearch(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint ) const
+{
+  /** Without the incremental kNN graph the trees are generated every time. */
+  if( !this->m_UseIncrementalKNNGraph )
+  {
+    this->m_KNNSearchMode = TreeSearch;
+    this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
+    return;
+  }
+
+  const SizeValueType numberOfPoints = this->m_NumberOfPixelsCounted;
+  const unsigned int  k              = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  const unsigned int  movingSize     = this->GetNumberOfMovingImages();
+  const unsigned long sampleMTime    = this->GetImageSampler()->GetOutput()->GetMTime();
+
+  /** The graph has to be rebuilt when the samples have changed. */
+  bool rebuild = !this->m_KNNGraphIsValid
+    || k != this->m_KNNGraphK
+    || sampleMTime != this->m_KNNGraphSampleMTime
+    || this->m_CurrentSampleIndices != this->m_KNNGraphSampleIndices;
+
+  /** Otherwise check for every point whether its k nearest neighbours are
+   * guaranteed to be among its candidates. When the points moved at most
+   * delta_i and delta_max since the rebuild, the distance between them
+   * changed at most delta_i + delta_max. The candidates then contain the
+   * k nearest neighbours if the gap between the distances of the k-th and
+   * the last candidate at the rebuild is at least 2 ( delta_i + delta_max ).
+   * The joint features only differ from the moving features by the fixed
+   * features, so they move the same distance.
+   */
+  if( !rebuild )
+  {
+    const InternalDataContainerType movingData = listSampleMoving->GetInternalContainer();
+    std::vector< double >           displacements( numberOfPoints );
+    double                          maximumDisplacement = 0.0;
+    for( SizeValueType i = 0; i < numberOfPoints; ++i )
+    {
+      const double * reference = &this->m_KNNGraphReferenceMovingFeatures[ i * movingSize ];
+      double         squaredDisplacement = 0.0;
+      for( unsigned int d = 0; d < movingSize; ++d )
+      {
+        const double diff = movingData[ i ][ d ] - reference[ d ];
+        squaredDisplacement += diff * diff;
+      }
+      displacements[ i ]  = vcl_sqrt( squaredDisplacement );
+      maximumDisplacement = std::max( maximumDisplacement, displacements[ i ] );
+    }
+
+    SizeValueType numberOfExactSearches = 0;
+    for( SizeValueType i = 0; i < numberOfPoints; ++i )
+    {
+      const double  bound = 2.0 * ( displacements[ i ] + maximumDisplacement );
+      unsigned char flags = 0;
+      if( this->m_KNNGraphMovingGaps[ i ] < bound ) { flags |= 1; }
+      if( this->m_KNNGraphJointGaps[ i ] < bound ) { flags |= 2; }
+      this->m_KNNGraphNeedsExactSearch[ i ] = flags;
+      if( flags != 0 ) { ++numberOfExactSearches; }
+    }
+
+    rebuild = numberOfExactSearches
+      > this->m_IncrementalKNNGraphRebuildFraction * numberOfPoints;
+  }
+
+  if( !rebuild )
+  {
+    this->m_KNNSearchMode = UpdateKNNGraph;
+    return;
+  }
+
+  /** Rebuild: generate the trees and store the reference state of the graph.
+   * The candidates and the fixed neighbours are filled by the queries.
+   */
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
+
+  const unsigned int numberOfCandidates = static_cast< unsigned int >(
+    std::min< SizeValueType >( 2 * k, numberOfPoints ) );
+  this->m_KNNGraphK                  = k;
+  this->m_KNNGraphNumberOfCandidates = numberOfCandidates;
+  this->m_KNNGraphSampleMTime        = sampleMTime;
+  this->m_KNNGraphSampleIndices.swap( this->m_CurrentSampleIndices );
+  this->m_KNNGraphFixedIndices.resize( numberOfPoints * k );
+  this->m_KNNGraphFixedDistances.resize( numberOfPoints * k );
+  this->m_KNNGraphMovingCandidates.resize( numberOfPoints * numberOfCandidates );
+  this->m_KNNGraphJointCandidates.resize( numberOfPoints * numberOfCandidates );
+  this->m_KNNGraphMovingGaps.resize( numberOfPoints );
+  this->m_KNNGraphJointGaps.resize( numberOfPoints );
+  this->m_KNNGraphNeedsExactSearch.assign( numberOfPoints, 0 );
+
+  const InternalDataContainerType movingData = listSampleMoving->GetInternalContainer();
+  this->m_KNNGraphReferenceMovingFeatures.resize( numberOfPoints * movingSize );
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    std::copy( movingData[ i ], movingData[ i ] + movingSize,
+      &this->m_KNNGraphReferenceMovingFeatures[ i * movingSize ] );
+  }
+
+  this->m_KNNGraphIsValid = true;
+  this->m_KNNSearchMode   = RebuildKNNGraph;
+
+} // end PrepareKNNSearch()
+
+
+/**
+ * ************************ SelectNearestNeighbours *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::SelectNearestNeighbours(
+  const ListSampleType * listSample, SizeValueType query,
+  const int * candidates, SizeValueType numberOfCandidates, unsigned int k,
+  CandidateContainerType & scratch,
+  IndexArrayType & indices, DistanceArrayType & distances )
+{
+  const InternalDataContainerType data = listSample->GetInternalContainer();
+  const unsigned int              dim  = listSample->GetMeasurementVectorSize();
+  const double *                  q    = data[ query ];
+
+  /** Compute the squared distances to all candidates. */
+  scratch.resize( numberOfCandidates );
+  for( SizeValueType c = 0; c < numberOfCandidates; ++c )
+  {
+    const int      j = candidates ? candidates[ c ] : static_cast< int >( c );
+    const double * z = data[ j ];
+    double         squaredDistance = 0.0;
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      const double diff = q[ d ] - z[ d ];
+      squaredDistance += diff * diff;
+    }
+    scratch[ c ] = CandidateType( squaredDistance, j );
+  }
+
+  /** Select the k nearest, sorted by increasing distance like ANN does. */
+  std::partial_sort( scratch.begin(), scratch.begin() + k, scratch.end() );
+  indices.SetSize( k );
+  distances.SetSize( k );
+  for( unsigned int p = 0; p < k; ++p )
+  {
+    distances[ p ] = scratch[ p ].first;
+    indices[ p ]   = scratch[ p ].second;
+  }
+
+} // end SelectNearestNeighbours()
+
+
+/**
+ * ************************ GenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTrees(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint ) const
+{
+  /** Connect the list samples to the trees. */
+  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
+  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
+  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
+
+  /** Generate the three trees. They are independent, so they are built
+   * concurrently when multi-threading is enabled.
+   */
+  GenerateTreesPassStruct pass;
+  pass.st_Trees[ 0 ] = this->m_BinaryKNNTreeFixed.GetPointer();
+  pass.st_Trees[ 1 ] = this->m_BinaryKNNTreeMoving.GetPointer();
+  pass.st_Trees[ 2 ] = this->m_BinaryKNNTreeJoint.GetPointer();
+  if( this->m_UseMultiThread )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      3, 1, Self::GenerateTreesRangeFunction, &pass );
+  }
+  else
+  {
+    Self::GenerateTreesRangeFunction( &pass, 0, 0, 3 );
+  }
+
+  /** Initialize tree searchers. */
+  this->m_BinaryKNNTreeSearcherFixed
+  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  this->m_BinaryKNNTreeSearcherMoving
+  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
+  this->m_BinaryKNNTreeSearcherJoint
+  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+
+} // end GenerateTrees()
+
+
+/**
+ * ************************ GenerateTreesRangeFunction *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTreesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  GenerateTreesPassStruct * pass = static_cast< GenerateTreesPassStruct * >( userData );
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    pass->st_Trees[ i ]->GenerateTree();
+  }
+
+} // end GenerateTreesRangeFunction()
+
+
+/**
+ * ************************ ComputeKNNContributions *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeKNNContributions(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint,
+  const TransformJacobianContainerType * jacobians,
+  const TransformJacobianIndicesContainerType * jacobiansIndices,
+  const SpatialDerivativeContainerType * spatialDerivatives,
+  AccumulateType & sumG,
+  DerivativeType * contribution ) const
+{
+  /** The searches do not modify the trees, and ANN keeps the state of a
+   * search in thread local variables, so the query points can be
+   * distributed over the threads. Each thread has its own partial sums.
+   */
+#ifdef ANN_NO_THREAD_LOCAL_SEARCH
+  const bool useMultiThread = false;
+#else
+  const bool useMultiThread = this->m_UseMultiThread;
+#endif
+  const ThreadIdType numberOfParticipants = useMultiThread
+    ? this->GetNumberOfParallelForBlocks() : 1;
+  this->m_KNNQueryPerThreadVariables.resize( numberOfParticipants );
+  for( ThreadIdType t = 0; t < numberOfParticipants; ++t )
+  {
+    this->m_KNNQueryPerThreadVariables[ t ].st_SumG                     = NumericTraits< AccumulateType >::Zero;
+    this->m_KNNQueryPerThreadVariables[ t ].st_ContributionIsInitialized = false;
+  }
+
+  KNNQueryPassStruct pass;
+  pass.st_Metric             = this;
+  pass.st_ListSampleFixed    = listSampleFixed.GetPointer();
+  pass.st_ListSampleMoving   = listSampleMoving.GetPointer();
+  pass.st_ListSampleJoint    = listSampleJoint.GetPointer();
+  pass.st_Jacobians          = jacobians;
+  pass.st_JacobiansIndices   = jacobiansIndices;
+  pass.st_SpatialDerivatives = spatialDerivatives;
+  pass.st_ComputeDerivative  = contribution != 0;
+
+  /** When the kNN graph is rebuilt the moving and joint searchers return
+   * all candidates. They are sorted, so the first k are the neighbours.
+   */
+  const unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  if( this->m_KNNSearchMode == RebuildKNNGraph )
+  {
+    this->m_BinaryKNNTreeSearcherMoving->SetKNearestNeighbors( this->m_KNNGraphNumberOfCandidates );
+    this->m_BinaryKNNTreeSearcherJoint->SetKNearestNeighbors( this->m_KNNGraphNumberOfCandidates );
+  }
+
+  if( useMultiThread )
+  {
+    this->ParallelForBlocks( this->m_NumberOfPixelsCounted, Self::KNNQueryRangeFunction, &pass );
+  }
+  else
+  {
+    Self::KNNQueryRangeFunction( &pass, 0, 0, this->m_NumberOfPixelsCounted );
+  }
+
+  if( this->m_KNNSearchMode == RebuildKNNGraph )
+  {
+    this->m_BinaryKNNTreeSearcherMoving->SetKNearestNeighbors( k );
+    this->m_BinaryKNNTreeSearcherJoint->SetKNearestNeighbors( k );
+  }
+
+  /** Gather the partial sums of the threads. */
+  for( ThreadIdType t = 0; t < numberOfParticipants; ++t )
+  {
+    const KNNQueryPerThreadStruct & partial = this->m_KNNQueryPerThreadVariables[ t ];
+    sumG += partial.st_SumG;
+    if( contribution != 0 && partial.st_ContributionIsInitialized )
+    {
+      *contribution += partial.st_Contribution;
+    }
+  }
+
+} // end ComputeKNNContributions()
+
+
+/**
+ * ************************ KNNQueryRangeFunction *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::KNNQueryRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  const KNNQueryPassStruct * pass = static_cast< const KNNQueryPassStruct * >( userData );
+  const Self *               self = pass->st_Metric;
+  KNNQueryPerThreadStruct &  out  = self->m_KNNQueryPerThreadVariables[ participantId ];
+
+  const ListSampleType *                        listSampleFixed          = pass->st_ListSampleFixed;
+  const ListSampleType *                        listSampleMoving         = pass->st_ListSampleMoving;
+  const ListSampleType *                        listSampleJoint          = pass->st_ListSampleJoint;
+  const TransformJacobianContainerType &        jacobianContainer        = *pass->st_Jacobians;
+  const TransformJacobianIndicesContainerType & jacobianIndicesContainer = *pass->st_JacobiansIndices;
+  const SpatialDerivativeContainerType &        spatialDerivativesContainer = *pass->st_SpatialDerivatives;
+  const bool                                    doDerivative             = pass->st_ComputeDerivative;
+
   /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
   MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
   IndexArrayType        indices_F,   indices_M,   indices_J;
   DistanceArrayType     distances_F, distances_M, distances_J;
   MeasureType           distance_F,  distance_M,  distance_J;
+  MeasureType           H, G, Gpow;
 
-  MeasureType    H, G, Gpow;
-  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  DerivativeType contribution( this->GetNumberOfParameters() );
-  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-  DerivativeType dGamma_M( this->GetNumberOfParameters() );
-  DerivativeType dGamma_J( this->GetNumberOfParameters() );
+  /** The derivative variables of this thread. */
+  const unsigned int numberOfParameters = self->GetNumberOfParameters();
+  if( doDerivative && !out.st_ContributionIsInitialized )
+  {
+    out.st_Contribution.SetSize( numberOfParameters );
+    out.st_Contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    out.st_dGamma_M.SetSize( numberOfParameters );
+    out.st_dGamma_J.SetSize( numberOfParameters );
+    out.st_ContributionIsInitialized = true;
+  }
+  DerivativeType & contribution = out.st_Contribution;
+  DerivativeType & dGamma_M     = out.st_dGamma_M;
+  DerivativeType & dGamma_J     = out.st_dGamma_J;
 
   /** Get the size of the feature vectors. */
-  unsigned int fixedSize  = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize  = fixedSize + movingSize;
+  const unsigned int jointSize = self->GetNumberOfFixedImages() + self->GetNumberOfMovingImages();
 
   /** Get the number of neighbours and \gamma. */
-  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
+  const unsigned int k        = self->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  const double       twoGamma = jointSize * ( 1.0 - self->m_Alpha );
 
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  /** Variables of the incremental kNN graph. */
+  const KNNSearchModeType mode               = self->m_KNNSearchMode;
+  const SizeValueType     numberOfPoints     = self->m_NumberOfPixelsCounted;
+  const unsigned int      numberOfCandidates = self->m_KNNGraphNumberOfCandidates;
+
+  /** Loop over the query points of this range. */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  for( SizeValueType i = begin; i < end; i++ )
   {
     /** Get the i-th query point. */
     listSampleFixed->GetMeasurementVector(  i, z_F );
@@ -647,94 +994,142 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     listSampleJoint->GetMeasurementVector(  i, z_J );
 
     /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+    if( mode == TreeSearch )
+    {
+      self->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
+      self->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
+      self->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+    }
+    else if( mode == RebuildKNNGraph )
+    {
+      self->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
+      self->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
+      self->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+
+      /** Store the fixed neighbours and the candidates of this point. */
+      std::copy( indices_F.begin(), indices_F.begin() + k,
+        &self->m_KNNGraphFixedIndices[ i * k ] );
+      std::copy( distances_F.begin(), distances_F.begin() + k,
+        &self->m_KNNGraphFixedDistances[ i * k ] );
+      std::copy( indices_M.begin(), indices_M.begin() + numberOfCandidates,
+        &self->m_KNNGraphMovingCandidates[ i * numberOfCandidates ] );
+      std::copy( indices_J.begin(), indices_J.begin() + numberOfCandidates,
+        &self->m_KNNGraphJointCandidates[ i * numberOfCandidates ] );
+      self->m_KNNGraphMovingGaps[ i ] = vcl_sqrt( distances_M[ numberOfCandidates - 1 ] )
+        - vcl_sqrt( distances_M[ k - 1 ] );
+      self->m_KNNGraphJointGaps[ i ] = vcl_sqrt( distances_J[ numberOfCandidates - 1 ] )
+        - vcl_sqrt( distances_J[ k - 1 ] );
+    }
+    else
+    {
+      /** The fixed neighbours do not change. */
+      indices_F.SetSize( k );
+      distances_F.SetSize( k );
+      std::copy( &self->m_KNNGraphFixedIndices[ i * k ],
+        &self->m_KNNGraphFixedIndices[ i * k ] + k, indices_F.begin() );
+      std::copy( &self->m_KNNGraphFixedDistances[ i * k ],
+        &self->m_KNNGraphFixedDistances[ i * k ] + k, distances_F.begin() );
+
+      /** Select the moving and joint neighbours from the candidates,
+       * or from all points if the candidates are not reliable.
+       */
+      const unsigned char exact = self->m_KNNGraphNeedsExactSearch[ i ];
+      Self::SelectNearestNeighbours( listSampleMoving, i,
+        ( exact & 1 ) ? 0 : &self->m_KNNGraphMovingCandidates[ i * numberOfCandidates ],
+        ( exact & 1 ) ? numberOfPoints : numberOfCandidates,
+        k, out.st_Candidates, indices_M, distances_M );
+      Self::SelectNearestNeighbours( listSampleJoint, i,
+        ( exact & 2 ) ? 0 : &self->m_KNNGraphJointCandidates[ i * numberOfCandidates ],
+        ( exact & 2 ) ? numberOfPoints : numberOfCandidates,
+        k, out.st_Candidates, indices_J, distances_J );
+    }
 
     /** Variables to compute the measure and its derivative. */
     AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
     AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
     AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
 
-    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
+    if( !doDerivative )
+    {
+      /** Add the distances of all neighbours of the query point,
+       * for the three graphs: sum M / sqrt( sum F * sum M).
+       */
+      for( unsigned int p = 0; p < k; p++ )
+      {
+        Gamma_F += vcl_sqrt( distances_F[ p ] );
+        Gamma_M += vcl_sqrt( distances_M[ p ] );
+        Gamma_J += vcl_sqrt( distances_J[ p ] );
+      } // end loop over the k neighbours
+    }
+    else
+    {
+      SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
+      D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
 
-    dGamma_M.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-    dGamma_J.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+      dGamma_M.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+      dGamma_J.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
-    /** Loop over the neighbours. */
-    for( unsigned int p = 0; p < k; p++ )
-    {
-      /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
-      listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
-
-      /** Get the distances. */
-      distance_F = vcl_sqrt( distances_F[ p ] );
-      distance_M = vcl_sqrt( distances_M[ p ] );
-      distance_J = vcl_sqrt( distances_J[ p ] );
-
-      /** Compute Gamma's. */
-      Gamma_F += distance_F;
-      Gamma_M += distance_M;
-      Gamma_J += distance_J;
-
-      /** Get the difference of z_ip^M with z_i^M. */
-      diff_M = z_M - z_M_ip;
-      diff_J = z_M - z_J_ip;
-
-      /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
-        * jacobianContainer[ indices_M[ p ] ];
-      D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
-        * jacobianContainer[ indices_J[ p ] ];
-
-      /** Update the dGamma's. */
-      this->UpdateDerivativeOfGammas(
-        D1sparse, D2sparse_M, D2sparse_J,
-        jacobianIndicesContainer[ i ],
-        jacobianIndicesContainer[ indices_M[ p ] ],
-        jacobianIndicesContainer[ indices_J[ p ] ],
-        diff_M, diff_J,
-        distance_M, distance_J,
-        dGamma_M, dGamma_J );
-
-    } // end loop over the k neighbours
-
-    /** Compute contributions. */
+      /** Loop over the neighbours. */
+      for( unsigned int p = 0; p < k; p++ )
+      {
+        /** Get the neighbour point z_ip^M. */
+        listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
+        listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
+
+        /** Get the distances. */
+        distance_F = vcl_sqrt( distances_F[ p ] );
+        distance_M = vcl_sqrt( distances_M[ p ] );
+        distance_J = vcl_sqrt( distances_J[ p ] );
+
+        /** Compute Gamma's. */
+        Gamma_F += distance_F;
+        Gamma_M += distance_M;
+        Gamma_J += distance_J;
+
+        /** Get the difference of z_ip^M with z_i^M. */
+        diff_M = z_M - z_M_ip;
+        diff_J = z_M - z_J_ip;
+
+        /** Compute derivatives. */
+        D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
+          * jacobianContainer[ indices_M[ p ] ];
+        D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
+          * jacobianContainer[ indices_J[ p ] ];
+
+        /** Update the dGamma's. */
+        self->UpdateDerivativeOfGammas(
+          D1sparse, D2sparse_M, D2sparse_J,
+          jacobianIndicesContainer[ i ],
+          jacobianIndicesContainer[ indices_M[ p ] ],
+          jacobianIndicesContainer[ indices_J[ p ] ],
+          diff_M, diff_J,
+          distance_M, distance_J,
+          dGamma_M, dGamma_J );
+
+      } // end loop over the k neighbours
+    }
+
+    /** Calculate the contribution of this query point. */
     H = vcl_sqrt( Gamma_F * Gamma_M );
-    if( H > this->m_AvoidDivisionBy )
+    if( H > self->m_AvoidDivisionBy )
     {
       /** Compute some sums. */
       G     = Gamma_J / H;
       sumG += vcl_pow( G, twoGamma );
 
       /** Compute the contribution to the derivative. */
-      Gpow          = vcl_pow( G, twoGamma - 1.0 );
-      contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
+      if( doDerivative )
+      {
+        Gpow          = vcl_pow( G, twoGamma - 1.0 );
+        contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
+      }
     }
-
   } // end looping over all query points
 
-  /**
-   * *************** Finally, calculate the metric value and derivative ******************
-   */
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  out.st_SumG += sumG;
 
-  /** Compute the value. */
-  double n, number;
-  if( sumG > this->m_AvoidDivisionBy )
-  {
-    /** Compute the measure. */
-    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
-    number  = vcl_pow( n, this->m_Alpha );
-    measure = vcl_log( sumG / number ) / ( this->m_Alpha - 1.0 );
-
-    /** Compute the derivative (-2.0 * d = -jointSize). */
-    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
-  }
-  value = -measure;
-
-} // end GetValueAndDerivative()
+} // end KNNQueryRangeFunction()
 
 
 /**
@@ -755,6 +1150,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 {
   /** Initialize. */
   this->m_NumberOfPixelsCounted = 0;
+  this->m_CurrentSampleIndices.resize( 0 );
   jacobianContainer.resize( 0 );
   jacobianIndicesContainer.resize( 0 );
   spatialDerivativesContainer.resize( 0 );
@@ -798,8 +1194,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   TransformJacobianType jacobian;
 
   /** Loop over the fixed image samples to calculate the list samples. */
-  unsigned int ii = 0;
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  unsigned int  ii           = 0;
+  unsigned long sampleNumber = 0;
+  for( fiter = fbegin; fiter != fend; ++fiter, ++sampleNumber )
   {
     /** Read fixed coordinates and initialize some variables. */
     const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
@@ -907,6 +1304,12 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
       } // end if doDerivative
 
+      /** Remember which samples are valid, to detect changes of the kNN graph. */
+      if( this->m_UseIncrementalKNNGraph )
+      {
+        this->m_CurrentSampleIndices.push_back( sampleNumber );
+      }
+
       /** Update the NumberOfPixelsCounted. */
       this->m_NumberOfPixelsCounted++;
 
@@ -1089,6 +1492,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
   os << indent << "Alpha: " << this->m_Alpha << std::endl;
   os << indent << "AvoidDivisionBy: " << this->m_AvoidDivisionBy << std::endl;
+  os << indent << "UseIncrementalKNNGraph: " << this->m_UseIncrementalKNNGraph << std::endl;
+  os << indent << "IncrementalKNNGraphRebuildFraction: "
+     << this->m_IncrementalKNNGraphRebuildFraction << std::endl;
 
   os << indent << "BinaryKNNTreeFixed: "
      << this->m_BinaryKNNTreeFixed.GetPointer() << std::endl;
@@ -26,6 +26,8 @@
 #include "itkVectorContainer.h"
 #include "vnl_adjugate_fixed.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -74,6 +76,7 @@ public:
 
   typedef typename Superclass::InputPointType    InputPointType;
   typedef typename Superclass::OutputPointType   OutputPointType;
+  typedef typename Superclass::OutputVectorType  OutputVectorType;
   typedef typename OutputPointType::CoordRepType CoordRepType;
   typedef vnl_vector< CoordRepType >             VnlVectorType;
 
@@ -175,6 +178,56 @@ private:
 
   void SubVector( const VectorType & fullVector, SubVectorType & subVector, const unsigned int leaveOutIndex ) const;
 
+  /** The topology of a mesh, precomputed in Initialize(), and the buffers
+   * of its evaluation. Each cell has FixedPointSetDimension points; the
+   * corners of all cells are numbered cell * FixedPointSetDimension + i.
+   * The coordinates and corner gradients are stored per dimension
+   * (structure of arrays), e.g. coordinate d of point i is at
+   * st_Coordinates[ d * numberOfPoints + i ].
+   */
+  struct MeshDataType
+  {
+    SizeValueType                           st_NumberOfPoints;
+    SizeValueType                           st_NumberOfCells;
+    std::vector< FixedMeshPointIdentifier > st_CornerPointIds;
+    std::vector< SizeValueType >            st_PointCornerOffsets;
+    std::vector< SizeValueType >            st_PointCorners;
+    mutable std::vector< CoordRepType >     st_Coordinates;
+    mutable std::vector< CoordRepType >     st_CornerGradients;
+    mutable std::vector< float >            st_SignedVolumes;
+  };
+
+  /** The job of the threads that evaluate one mesh. */
+  struct MeshJobType
+  {
+    const MeshDataType *    st_MeshData;
+    const OutputPointType * st_MappedPoints;
+    const MeshPointType *   st_Centroid;
+    OutputVectorType *      st_PointGradients;
+  };
+
+  /** Subtracts the centroid from the mapped points [begin, end). */
+  static void CenterPointsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Computes the signed volumes of the cells [begin, end), and the
+   * derivatives of their absolute values with respect to their points.
+   */
+  static void ComputeCellsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Gathers the derivatives of the points [begin, end) from their corners,
+   * in the order of the cells.
+   */
+  static void GatherPointGradientsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** The number of points or cells per chunk of the threaded loops. */
+  static const SizeValueType MeshGrainSize = 256;
+
+  std::vector< MeshDataType >             m_MeshData;
+  mutable std::vector< OutputVectorType > m_PointGradients;
+
   MissingVolumeMeshPenalty( const Self & ); // purposely not implemented
   void operator=( const Self & );           // purposely not implemented
 
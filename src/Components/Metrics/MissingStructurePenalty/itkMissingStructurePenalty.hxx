@@ -19,6 +19,7 @@
 #define __itkMissingStructurePenalty_hxx
 
 #include "itkMissingStructurePenalty.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -69,6 +70,13 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
 
   const FixedMeshContainerElementIdentifier numberOfMeshes = this->m_FixedMeshContainer->Size();
   this->m_MappedMeshContainer->Reserve( numberOfMeshes );
+  this->m_MeshData.resize( numberOfMeshes );
+
+  const unsigned int cellSize = FixedPointSetDimension;
+  if( cellSize < 2 || cellSize > 4 )
+  {
+    itkExceptionMacro( << "Only meshes of dimension 2, 3 and 4 are supported" );
+  }
 
   for( FixedMeshContainerElementIdentifier meshId = 0; meshId < numberOfMeshes; ++meshId )
   {
@@ -91,6 +99,58 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
 
     this->m_MappedMeshContainer->SetElement( meshId, mappedMesh );
 
+    /** Precompute the topology: the points at the corners of the cells, and
+     * for each point its corners in the order of the cells.
+     */
+    MeshDataType & meshData = this->m_MeshData[ meshId ];
+    meshData.st_NumberOfPoints = numberOfPoints;
+    meshData.st_NumberOfCells  = fixedMesh->GetNumberOfCells();
+    meshData.st_CornerPointIds.clear();
+    meshData.st_CornerPointIds.reserve( meshData.st_NumberOfCells * cellSize );
+    meshData.st_PointCornerOffsets.assign( numberOfPoints + 1, 0 );
+
+    if( meshData.st_NumberOfCells > 0 )
+    {
+      typename FixedMeshType::CellsContainerConstIterator cellIt  = fixedMesh->GetCells()->Begin();
+      typename FixedMeshType::CellsContainerConstIterator cellEnd = fixedMesh->GetCells()->End();
+      for(; cellIt != cellEnd; ++cellIt )
+      {
+        if( cellIt->Value()->GetNumberOfPoints() != cellSize )
+        {
+          itkExceptionMacro( << "The cells of mesh " << meshId << " should have "
+                             << cellSize << " points" );
+        }
+        typename CellInterfaceType::PointIdConstIterator pointIdIt = cellIt->Value()->PointIdsBegin();
+        for( unsigned int i = 0; i < cellSize; ++i, ++pointIdIt )
+        {
+          if( *pointIdIt >= numberOfPoints )
+          {
+            itkExceptionMacro( << "Mesh " << meshId << " refers to a non-existing point" );
+          }
+          meshData.st_CornerPointIds.push_back( *pointIdIt );
+          ++meshData.st_PointCornerOffsets[ *pointIdIt + 1 ];
+        }
+      }
+    }
+
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+      meshData.st_PointCornerOffsets[ i + 1 ] += meshData.st_PointCornerOffsets[ i ];
+    }
+
+    const SizeValueType          numberOfCorners = meshData.st_CornerPointIds.size();
+    std::vector< SizeValueType > nextCorner(
+      meshData.st_PointCornerOffsets.begin(), meshData.st_PointCornerOffsets.end() - 1 );
+    meshData.st_PointCorners.resize( numberOfCorners );
+    for( SizeValueType corner = 0; corner < numberOfCorners; ++corner )
+    {
+      meshData.st_PointCorners[ nextCorner[ meshData.st_CornerPointIds[ corner ] ]++ ] = corner;
+    }
+
+    meshData.st_Coordinates.resize( cellSize * numberOfPoints );
+    meshData.st_CornerGradients.resize( cellSize * numberOfCorners );
+    meshData.st_SignedVolumes.resize( meshData.st_NumberOfCells );
+
   }
 } // end Initialize()
 
@@ -175,9 +235,6 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
-  NonZeroJacobianIndicesType nzji( this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-  TransformJacobianType      jacobian;
-
   const FixedMeshContainerElementIdentifier numberOfMeshes = this->m_FixedMeshContainer->Size();
 
   typedef typename FixedMeshType::PointType FixedMeshPointType;
@@ -197,147 +254,239 @@ MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
     const FixedMeshPointer           mappedMesh   = this->m_MappedMeshContainer->ElementAt( meshId );
     const MeshPointsContainerPointer mappedPoints = mappedMesh->GetPoints();
 
-    typename FixedMeshType::PointType &              pointCentroid = pointCentroids->ElementAt( meshId );
-    typedef typename FixedMeshType::PointsContainer FixedMeshPointsContainerType;
-    typename FixedMeshType::PointsContainer::Pointer derivPoints = FixedMeshPointsContainerType::New();
+    typename FixedMeshType::PointType & pointCentroid = pointCentroids->ElementAt( meshId );
+
+    const MeshDataType & meshData = this->m_MeshData[ meshId ];
+    if( meshData.st_NumberOfPoints != numberOfPoints )
+    {
+      itkExceptionMacro( << "The metric has not been initialized" );
+    }
 
-    derivPoints->resize( numberOfPoints, typename FixedMeshPointType::Point( zeroPoint ) );
+    /** The derivatives of the volume with respect to the mapped points. */
+    this->m_PointGradients.resize( numberOfPoints );
 
-    MeshPointsContainerConstIteratorType fixedPointIt  = fixedPoints->Begin();
-    MeshPointsContainerIteratorType      mappedPointIt = mappedPoints->Begin();
-    MeshPointsContainerConstIteratorType fixedPointEnd = fixedPoints->End();
+    /** Transform all points, multi-threaded. */
+    if( numberOfPoints > 0 )
+    {
+      this->TransformPointsThreaded( numberOfPoints,
+        &fixedPoints->ElementAt( 0 ), &mappedPoints->ElementAt( 0 ) );
+    }
 
-    for(; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++mappedPointIt )
+    MeshPointsContainerIteratorType mappedPointIt  = mappedPoints->Begin();
+    MeshPointsContainerIteratorType mappedPointEnd = mappedPoints->End();
+    for(; mappedPointIt != mappedPointEnd; ++mappedPointIt )
     {
-      const OutputPointType mappedPoint = this->m_Transform->TransformPoint( fixedPointIt->Value() );
-      mappedPointIt.Value()         = mappedPoint;
-      pointCentroid.GetVnlVector() += mappedPoint.GetVnlVector();
+      pointCentroid.GetVnlVector() += mappedPointIt.Value().GetVnlVector();
     }
     pointCentroid.GetVnlVector() /= numberOfPoints;
 
-    typename FixedMeshType::CellsContainerConstIterator cellBegin = fixedMesh->GetCells()->Begin();
-    typename FixedMeshType::CellsContainerConstIterator cellEnd   = fixedMesh->GetCells()->End();
+    /** Center the points, compute the volumes of the cells and the
+     * derivatives at their corners, and gather these per point,
+     * multi-threaded.
+     */
+    MeshJobType job;
+    job.st_MeshData       = &meshData;
+    job.st_MappedPoints   = numberOfPoints > 0 ? &mappedPoints->ElementAt( 0 ) : 0;
+    job.st_Centroid       = &pointCentroid;
+    job.st_PointGradients = numberOfPoints > 0 ? &this->m_PointGradients[ 0 ] : 0;
+
+    PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+    threadPool->ParallelFor( numberOfPoints, Self::MeshGrainSize,
+      Self::CenterPointsRangeFunction, &job );
+    threadPool->ParallelFor( meshData.st_NumberOfCells, Self::MeshGrainSize,
+      Self::ComputeCellsRangeFunction, &job );
+    threadPool->ParallelFor( numberOfPoints, Self::MeshGrainSize,
+      Self::GatherPointGradientsRangeFunction, &job );
+
+    /** Sum the volumes in the order of the cells. */
+    float sumAbsVolume = 0.0;
+    for( SizeValueType cell = 0; cell < meshData.st_NumberOfCells; ++cell )
+    {
+      sumAbsVolume += vcl_abs( meshData.st_SignedVolumes[ cell ] );
+    }
 
-    typename CellInterfaceType::PointIdIterator beginpointer;
-    float sumSignedVolume = 0.0;
-    float sumAbsVolume    = 0.0;
+    /** Add gradient^T * dT/dmu of all points to the derivative, using the
+     * batched Jacobians, multi-threaded.
+     */
+    if( numberOfPoints > 0 )
+    {
+      this->AccumulateDerivativeThreaded( numberOfPoints,
+        &fixedPoints->ElementAt( 0 ), &this->m_PointGradients[ 0 ], derivative );
+    }
 
-    const float eps = 0.00001;
+    /** Check if enough samples were valid. */
 
-    for(; cellBegin != cellEnd; ++cellBegin )
-    {
-      beginpointer = cellBegin->Value()->PointIdsBegin();
-      float signedVolume;  // = vnl_determinant(fullMatrix.GetVnlMatrix());
+    /** Copy the measure to value. */
+    value += sumAbsVolume;
 
-      //const VectorType::const_pointer p1,p2,p3,p4;
-      switch( static_cast< unsigned int >( FixedPointSetDimension ) )
-      {
-        case 2:
-        {
-          const FixedMeshPointIdentifier p1Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p2Id = *beginpointer;
-          ++beginpointer;
-          const VectorType p2 = mappedPoints->GetElement( p2Id ) - pointCentroid;
+  } // end loop over all meshes in container
+} // end GetValueAndDerivative()
 
-          signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer() );
 
-          const int sign = ( signedVolume > eps ) - ( signedVolume < -eps );
-          if( sign != 0 )
-          {
-            derivPoints->at( p1Id )[ 0 ] += sign * p2[ 1 ];
-            derivPoints->at( p1Id )[ 1 ] -= sign * p2[ 0 ];
-            derivPoints->at( p2Id )[ 0 ] -= sign * p1[ 1 ];
-            derivPoints->at( p2Id )[ 1 ] += sign * p1[ 0 ];
-          }
+/**
+ * ******************* CenterPointsRangeFunction *******************
+ */
 
-        }
-        break;
-        case 3:
-        {
-          const FixedMeshPointIdentifier p1Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p1   = mappedPoints->GetElement( p1Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p2Id = *beginpointer;
-          ++beginpointer;
-          const VectorType               p2   = mappedPoints->GetElement( p2Id ) - pointCentroid;
-          const FixedMeshPointIdentifier p3Id = *beginpointer;
-          ++beginpointer;
-          const VectorType p3 = mappedPoints->GetElement( p3Id ) - pointCentroid;
+template< class TFixedPointSet, class TMovingPointSet >
+void
+MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
+::CenterPointsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MeshJobType &  job      = *static_cast< const MeshJobType * >( userData );
+  const MeshDataType & meshData = *job.st_MeshData;
 
-          signedVolume = vnl_determinant( p1.GetDataPointer(), p2.GetDataPointer(), p3.GetDataPointer() );
+  const unsigned int  dimension      = FixedPointSetDimension;
+  const SizeValueType numberOfPoints = meshData.st_NumberOfPoints;
+  CoordRepType *      coordinates    = &meshData.st_Coordinates[ 0 ];
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    for( unsigned int d = 0; d < dimension; ++d )
+    {
+      coordinates[ d * numberOfPoints + i ] = job.st_MappedPoints[ i ][ d ] - ( *job.st_Centroid )[ d ];
+    }
+  }
 
-          const int sign = ( ( signedVolume > eps ) - ( signedVolume < -eps ) );
+} // end CenterPointsRangeFunction()
 
-          if( sign != 0 )
-          {
-            derivPoints->at( p1Id )[ 0 ] += sign * ( p2[ 1 ] * p3[ 2 ] - p2[ 2 ] * p3[ 1 ] );
-            derivPoints->at( p1Id )[ 1 ] += sign * ( p2[ 2 ] * p3[ 0 ] - p2[ 0 ] * p3[ 2 ] );
-            derivPoints->at( p1Id )[ 2 ] += sign * ( p2[ 0 ] * p3[ 1 ] - p2[ 1 ] * p3[ 0 ] );
 
-            derivPoints->at( p2Id )[ 0 ] += sign * ( p1[ 2 ] * p3[ 1 ] - p1[ 1 ] * p3[ 2 ] );
-            derivPoints->at( p2Id )[ 1 ] += sign * ( p1[ 0 ] * p3[ 2 ] - p1[ 2 ] * p3[ 0 ] );
-            derivPoints->at( p2Id )[ 2 ] += sign * ( p1[ 1 ] * p3[ 0 ] - p1[ 0 ] * p3[ 1 ] );
+/**
+ * ******************* ComputeCellsRangeFunction *******************
+ */
 
-            derivPoints->at( p3Id )[ 0 ] += sign * ( p1[ 1 ] * p2[ 2 ] - p1[ 2 ] * p2[ 1 ] );
-            derivPoints->at( p3Id )[ 1 ] += sign * ( p1[ 2 ] * p2[ 0 ] - p1[ 0 ] * p2[ 2 ] );
-            derivPoints->at( p3Id )[ 2 ] += sign * ( p1[ 0 ] * p2[ 1 ] - p1[ 1 ] * p2[ 0 ] );
+template< class TFixedPointSet, class TMovingPointSet >
+void
+MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
+::ComputeCellsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MeshJobType &  job      = *static_cast< const MeshJobType * >( userData );
+  const MeshDataType & meshData = *job.st_MeshData;
 
-          }
-        }
+  const unsigned int   dimension       = FixedPointSetDimension;
+  const SizeValueType  numberOfPoints  = meshData.st_NumberOfPoints;
+  const SizeValueType  numberOfCorners = meshData.st_CornerPointIds.size();
+  const CoordRepType * coordinates     = &meshData.st_Coordinates[ 0 ];
+  CoordRepType *       cornerGradients = &meshData.st_CornerGradients[ 0 ];
 
-        break;
-        case 4:
-        {
-          const VectorConstPointer p1 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p2 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p3 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          const VectorConstPointer p4 = mappedPoints->GetElement( *beginpointer++ ).GetDataPointer();
-          signedVolume = vnl_determinant( p1, p2, p3, p4 );
-        }
-        break;
-        default:
-          std::cout << "no dimensions higher than 4"  << std::endl;
-      }
+  const float eps = 0.00001;
+
+  for( SizeValueType cell = begin; cell < end; ++cell )
+  {
+    const SizeValueType              firstCorner = cell * dimension;
+    const FixedMeshPointIdentifier * pointIds    = &meshData.st_CornerPointIds[ firstCorner ];
 
-      sumSignedVolume +=  signedVolume;
-      sumAbsVolume    += vcl_abs( signedVolume );
+    /** Copy the centered points of the cell to the stack. */
+    CoordRepType p[ FixedPointSetDimension ][ FixedPointSetDimension ];
+    CoordRepType g[ FixedPointSetDimension ][ FixedPointSetDimension ];
+    for( unsigned int i = 0; i < dimension; ++i )
+    {
+      for( unsigned int d = 0; d < dimension; ++d )
+      {
+        p[ i ][ d ] = coordinates[ d * numberOfPoints + pointIds[ i ] ];
+        g[ i ][ d ] = 0.0;
+      }
     }
 
-    /** Create iterators. */
-    fixedPointIt = fixedPoints->Begin();
-    unsigned int pointIndex;
-    /** Loop over points. */
-    for( pointIndex = 0; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++pointIndex )
+    float signedVolume = 0.0;
+    switch( static_cast< unsigned int >( FixedPointSetDimension ) )
     {
-      /** Get the TransformJacobian dT/dmu. */
-      this->m_Transform->GetJacobian( fixedPointIt.Value(), jacobian, nzji );
-      if( nzji.size() == this->GetNumberOfParameters() )
+      case 2:
       {
-        /** Loop over all Jacobians. */
-        derivative += derivPoints->at( pointIndex ).GetVnlVector() * jacobian; //* sumAbsVolumeEps;
+        signedVolume = vnl_determinant( p[ 0 ], p[ 1 ] );
+
+        const int sign = ( signedVolume > eps ) - ( signedVolume < -eps );
+        if( sign != 0 )
+        {
+          g[ 0 ][ 0 ] =  sign * p[ 1 ][ 1 ];
+          g[ 0 ][ 1 ] = -( sign * p[ 1 ][ 0 ] );
+          g[ 1 ][ 0 ] = -( sign * p[ 0 ][ 1 ] );
+          g[ 1 ][ 1 ] =  sign * p[ 0 ][ 0 ];
+        }
       }
-      else
+      break;
+      case 3:
       {
-        /** Only pick the nonzero Jacobians. */
-        for( unsigned int i = 0; i < nzji.size(); ++i )
+        signedVolume = vnl_determinant( p[ 0 ], p[ 1 ], p[ 2 ] );
+
+        const int sign = ( ( signedVolume > eps ) - ( signedVolume < -eps ) );
+        if( sign != 0 )
         {
-          const unsigned int index  = nzji[ i ];
-          VnlVectorType      column = jacobian.get_column( i );
-          derivative[ index ] += dot_product( derivPoints->at( pointIndex ).GetVnlVector(), column ); // *sumAbsVolumeEps;
+          g[ 0 ][ 0 ] = sign * ( p[ 1 ][ 1 ] * p[ 2 ][ 2 ] - p[ 1 ][ 2 ] * p[ 2 ][ 1 ] );
+          g[ 0 ][ 1 ] = sign * ( p[ 1 ][ 2 ] * p[ 2 ][ 0 ] - p[ 1 ][ 0 ] * p[ 2 ][ 2 ] );
+          g[ 0 ][ 2 ] = sign * ( p[ 1 ][ 0 ] * p[ 2 ][ 1 ] - p[ 1 ][ 1 ] * p[ 2 ][ 0 ] );
+
+          g[ 1 ][ 0 ] = sign * ( p[ 0 ][ 2 ] * p[ 2 ][ 1 ] - p[ 0 ][ 1 ] * p[ 2 ][ 2 ] );
+          g[ 1 ][ 1 ] = sign * ( p[ 0 ][ 0 ] * p[ 2 ][ 2 ] - p[ 0 ][ 2 ] * p[ 2 ][ 0 ] );
+          g[ 1 ][ 2 ] = sign * ( p[ 0 ][ 1 ] * p[ 2 ][ 0 ] - p[ 0 ][ 0 ] * p[ 2 ][ 1 ] );
+
+          g[ 2 ][ 0 ] = sign * ( p[ 0 ][ 1 ] * p[ 1 ][ 2 ] - p[ 0 ][ 2 ] * p[ 1 ][ 1 ] );
+          g[ 2 ][ 1 ] = sign * ( p[ 0 ][ 2 ] * p[ 1 ][ 0 ] - p[ 0 ][ 0 ] * p[ 1 ][ 2 ] );
+          g[ 2 ][ 2 ] = sign * ( p[ 0 ][ 0 ] * p[ 1 ][ 1 ] - p[ 0 ][ 1 ] * p[ 1 ][ 0 ] );
         }
       }
+      break;
+      case 4:
+      {
+        /** The 4D volume is computed from the uncentered points, without derivative. */
+        signedVolume = vnl_determinant(
+          job.st_MappedPoints[ pointIds[ 0 ] ].GetDataPointer(),
+          job.st_MappedPoints[ pointIds[ 1 ] ].GetDataPointer(),
+          job.st_MappedPoints[ pointIds[ 2 ] ].GetDataPointer(),
+          job.st_MappedPoints[ pointIds[ 3 ] ].GetDataPointer() );
+      }
+      break;
+    }
+
+    meshData.st_SignedVolumes[ cell ] = signedVolume;
+    for( unsigned int i = 0; i < dimension; ++i )
+    {
+      for( unsigned int d = 0; d < dimension; ++d )
+      {
+        cornerGradients[ d * numberOfCorners + firstCorner + i ] = g[ i ][ d ];
+      }
+    }
+  }
 
-    }   // end loop over all corresponding points
+} // end ComputeCellsRangeFunction()
 
-    /** Check if enough samples were valid. */
 
-    /** Copy the measure to value. */
-    value += sumAbsVolume;
+/**
+ * ******************* GatherPointGradientsRangeFunction *******************
+ */
 
-  } // end loop over all meshes in container
-} // end GetValueAndDerivative()
+template< class TFixedPointSet, class TMovingPointSet >
+void
+MissingVolumeMeshPenalty< TFixedPointSet, TMovingPointSet >
+::GatherPointGradientsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MeshJobType &  job      = *static_cast< const MeshJobType * >( userData );
+  const MeshDataType & meshData = *job.st_MeshData;
+
+  const unsigned int   dimension       = FixedPointSetDimension;
+  const SizeValueType  numberOfCorners = meshData.st_CornerPointIds.size();
+  const CoordRepType * cornerGradients = numberOfCorners > 0 ? &meshData.st_CornerGradients[ 0 ] : 0;
+
+  /** The corners are visited in the order of the cells, so that the sums are
+   * the same as those of a serial loop over the cells.
+   */
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    OutputVectorType & gradient = job.st_PointGradients[ i ];
+    gradient.Fill( 0.0 );
+    for( SizeValueType k = meshData.st_PointCornerOffsets[ i ];
+      k < meshData.st_PointCornerOffsets[ i + 1 ]; ++k )
+    {
+      const SizeValueType corner = meshData.st_PointCorners[ k ];
+      for( unsigned int d = 0; d < dimension; ++d )
+      {
+        gradient[ d ] += cornerGradients[ d * numberOfCorners + corner ];
+      }
+    }
+  }
+
+} // end GatherPointGradientsRangeFunction()
 
 
 /**
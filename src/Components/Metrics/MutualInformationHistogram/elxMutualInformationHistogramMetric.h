@@ -19,33 +19,50 @@
 #define __elxMutualInformationHistogramMetric_H__
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkMutualInformationHistogramImageToImageMetric.h"
+#include "itkAdvancedMutualInformationHistogramImageToImageMetric.h"
 
 namespace elastix
 {
 
 /**
  * \class MutualInformationHistogramMetric
- * \brief A metric based on the itk::MutualInformationHistogramImageToImageMetric.
+ * \brief A metric based on the itk::AdvancedMutualInformationHistogramImageToImageMetric.
  *
- * This metric is not yet fully supported. But with a little effort it is!
+ * The joint histogram is filled with the samples of the ImageSampler, by
+ * all threads. The derivative is computed with central differences, which
+ * costs two evaluations per parameter; this metric is therefore only
+ * suitable for transforms with few parameters.
  *
  * \warning: this metric is not very well tested in elastix.
- * \warning: this metric is not based on the AdvancedImageToImageMetric so
- * does not support the ImageSampler framework and might be very slow in
- * combination with B-spline transform.
  *
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "MutualInformationHistogram")</tt>
+ * \parameter NumberOfHistogramBins: for each resolution the number of bins of
+ *    the joint histogram, in both dimensions. \n
+ *    example: <tt>(NumberOfHistogramBins 32 32 64)</tt> \n
+ *    The default is 32 for each resolution.
+ * \parameter NumberOfFixedHistogramBins: for each resolution the number of
+ *    fixed image bins; overrides NumberOfHistogramBins. \n
+ *    example: <tt>(NumberOfFixedHistogramBins 32 32 64)</tt> \n
+ *    The default is the NumberOfHistogramBins.
+ * \parameter NumberOfMovingHistogramBins: for each resolution the number of
+ *    moving image bins; overrides NumberOfHistogramBins. \n
+ *    example: <tt>(NumberOfMovingHistogramBins 32 32 64)</tt> \n
+ *    The default is the NumberOfHistogramBins.
+ * \parameter DerivativeStepLength: for each resolution the step length of
+ *    the central differences. \n
+ *    example: <tt>(DerivativeStepLength 0.5 0.1 0.05)</tt> \n
+ *    The default is 0.1 for each resolution.
  *
+ * \sa AdvancedMutualInformationHistogramImageToImageMetric
  * \ingroup Metrics
  */
 
 template< class TElastix >
 class MutualInformationHistogramMetric :
   public
-  itk::MutualInformationHistogramImageToImageMetric<
+  itk::AdvancedMutualInformationHistogramImageToImageMetric<
   typename MetricBase< TElastix >::FixedImageType,
   typename MetricBase< TElastix >::MovingImageType >,
   public MetricBase< TElastix >
@@ -54,7 +71,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef MutualInformationHistogramMetric Self;
-  typedef itk::MutualInformationHistogramImageToImageMetric<
+  typedef itk::AdvancedMutualInformationHistogramImageToImageMetric<
     typename MetricBase< TElastix >::FixedImageType,
     typename MetricBase< TElastix >::MovingImageType >    Superclass1;
   typedef MetricBase< TElastix >          Superclass2;
@@ -66,7 +83,7 @@ public:
 
   /** Run-time type information (and related methods). */
   itkTypeMacro( MutualInformationHistogramMetric,
-    itk::MutualInformationHistogramImageToImageMetric );
+    itk::AdvancedMutualInformationHistogramImageToImageMetric );
 
   /** Name of this class.
    * Use this name in the parameter file to select this specific metric. \n
@@ -101,13 +118,9 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
-  /** Execute stuff before the actual registration:
-   * \li Nothing yet: still to be implemented.
-   */
-  virtual void BeforeRegistration( void );
-
   /** Execute stuff before each new pyramid resolution:
-   * \li Nothing yet: still to be implemented.
+   * \li Set the number of histogram bins.
+   * \li Set the step length of the central differences.
    */
   virtual void BeforeEachResolution( void );
 
@@ -53,21 +53,6 @@ MutualInformationHistogramMetric< TElastix >
 } // end Initialize()
 
 
-/**
- * ******************* BeforeRegistration ***********************
- */
-
-template< class TElastix >
-void
-MutualInformationHistogramMetric< TElastix >
-::BeforeRegistration( void )
-{
-  /** This exception can be removed once this class is fully implemented. */
-  itkExceptionMacro( << "ERROR: This class is not yet fully implemented." );
-
-} // end BeforeRegistration()
-
-
 /**
  * ***************** BeforeEachResolution ***********************
  */
@@ -77,32 +62,28 @@ void
 MutualInformationHistogramMetric< TElastix >
 ::BeforeEachResolution( void )
 {
-  /** \todo adapt SecondOrderRegularisationMetric.
-   * Set alpha, which balances the similarity and deformation energy
-   * E_total = (1-alpha)*E_sim + alpha*E_def.
-   * metric->SetAlpha( config.GetAlpha(level) );
-   */
-
-  const unsigned int nrOfParameters = this->m_Elastix->GetElxTransformBase()
-    ->GetAsITKBaseType()->GetNumberOfParameters();
-  ScalesType derivativeStepLengthScales( nrOfParameters );
-  derivativeStepLengthScales.Fill( 1.0 );
-
-  /** Read the parameters from the ParameterFile.*
-  this->m_Configuration->ReadParameter( histogramSize, "HistogramSize", 0 );
-  this->m_Configuration->ReadParameter( paddingValue, "PaddingValue", 0 );
-  this->m_Configuration->ReadParameter( derivativeStepLength, "DerivativeStepLength", 0 );
-  this->m_Configuration->ReadParameter( derivativeStepLengthScales, "DerivativeStepLengthScales", 0 );
-  this->m_Configuration->ReadParameter( upperBoundIncreaseFactor, "UpperBoundIncreaseFactor", 0 );
-  this->m_Configuration->ReadParameter( usePaddingValue, "UsePaddingValue", 0 );
-  */
-  /** Set them.*/
-  //this->SetHistogramSize( ?? );
-  //this->SetPaddingValue( ?? );
-  //this->SetDerivativeStepLength( ?? );
-  this->SetDerivativeStepLengthScales( derivativeStepLengthScales );
-  //this->SetUpperBoundIncreaseFactor( ?? );
-  //this->SetUsePaddingValue( ?? );
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Get and set the number of histogram bins. */
+  unsigned long numberOfHistogramBins = 32;
+  this->GetConfiguration()->ReadParameter( numberOfHistogramBins,
+    "NumberOfHistogramBins", this->GetComponentLabel(), level, 0 );
+  unsigned long numberOfFixedHistogramBins  = numberOfHistogramBins;
+  unsigned long numberOfMovingHistogramBins = numberOfHistogramBins;
+  this->GetConfiguration()->ReadParameter( numberOfFixedHistogramBins,
+    "NumberOfFixedHistogramBins", this->GetComponentLabel(), level, 0 );
+  this->GetConfiguration()->ReadParameter( numberOfMovingHistogramBins,
+    "NumberOfMovingHistogramBins", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfFixedHistogramBins( numberOfFixedHistogramBins );
+  this->SetNumberOfMovingHistogramBins( numberOfMovingHistogramBins );
+
+  /** Get and set the step length of the central differences. */
+  double derivativeStepLength = 0.1;
+  this->GetConfiguration()->ReadParameter( derivativeStepLength,
+    "DerivativeStepLength", this->GetComponentLabel(), level, 0 );
+  this->SetDerivativeStepLength( derivativeStepLength );
 
 } // end BeforeEachResolution()
 
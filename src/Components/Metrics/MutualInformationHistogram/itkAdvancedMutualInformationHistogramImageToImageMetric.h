@@ -0,0 +1,227 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAdvancedMutualInformationHistogramImageToImageMetric_h
+#define __itkAdvancedMutualInformationHistogramImageToImageMetric_h
+
+#include "itkAdvancedImageToImageMetric.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class AdvancedMutualInformationHistogramImageToImageMetric
+ * \brief Computes the mutual information from a joint histogram of the
+ * image samples.
+ *
+ * The fixed and moving intensities of the samples are binned, without any
+ * Parzen window, into a joint histogram of NumberOfFixedHistogramBins x
+ * NumberOfMovingHistogramBins bins, which cover the intensity ranges of
+ * the images. Every thread fills its own histogram for its part of the
+ * samples; the histograms are added afterwards.
+ *
+ * As the value is piecewise constant in the parameters, the derivative is
+ * computed with central differences, like itk::HistogramImageToImageMetric
+ * does. All evaluations of one derivative use the same samples.
+ *
+ * The value is minus the mutual information.
+ *
+ * \ingroup RegistrationMetrics
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class AdvancedMutualInformationHistogramImageToImageMetric :
+  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef AdvancedMutualInformationHistogramImageToImageMetric Self;
+  typedef AdvancedImageToImageMetric<
+    TFixedImage, TMovingImage >                                Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( AdvancedMutualInformationHistogramImageToImageMetric, AdvancedImageToImageMetric );
+
+  /** Typedefs from the superclass. */
+  typedef typename
+    Superclass::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType            MovingImageType;
+  typedef typename Superclass::MovingImagePixelType       MovingImagePixelType;
+  typedef typename Superclass::MovingImageConstPointer    MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType             FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer     FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass::TransformType              TransformType;
+  typedef typename Superclass::TransformPointer           TransformPointer;
+  typedef typename Superclass::InputPointType             InputPointType;
+  typedef typename Superclass::OutputPointType            OutputPointType;
+  typedef typename Superclass::TransformParametersType    TransformParametersType;
+  typedef typename Superclass::TransformJacobianType      TransformJacobianType;
+  typedef typename Superclass::NumberOfParametersType     NumberOfParametersType;
+  typedef typename Superclass::InterpolatorType           InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer        InterpolatorPointer;
+  typedef typename Superclass::RealType                   RealType;
+  typedef typename Superclass::GradientPixelType          GradientPixelType;
+  typedef typename Superclass::GradientImageType          GradientImageType;
+  typedef typename Superclass::GradientImagePointer       GradientImagePointer;
+  typedef typename Superclass::GradientImageFilterType    GradientImageFilterType;
+  typedef typename Superclass::GradientImageFilterPointer GradientImageFilterPointer;
+  typedef typename Superclass::FixedImageMaskType         FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer      FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType        MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer     MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                MeasureType;
+  typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
+  typedef typename Superclass::ParametersType             ParametersType;
+  typedef typename Superclass::FixedImagePixelType        FixedImagePixelType;
+  typedef typename Superclass::MovingImageRegionType      MovingImageRegionType;
+  typedef typename Superclass::ImageSamplerType           ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer        ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename
+    Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
+  typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
+  typedef typename
+    Superclass::FixedImageLimiterOutputType FixedImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** Typedef for the scales of the derivative step lengths. */
+  typedef Array< double > ScalesType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Initialize the metric; determines the bins of the joint histogram. */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
+  /** Get the value for single valued optimizers. */
+  virtual MeasureType GetValue( const TransformParametersType & parameters ) const;
+
+  /** Get the derivatives of the match measure. */
+  virtual void GetDerivative( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const;
+
+  /** Get value and derivatives for multiple valued optimizers. */
+  virtual void GetValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Set/Get the number of histogram bins. The default is 32 for both. */
+  itkSetClampMacro( NumberOfFixedHistogramBins, unsigned long,
+    1, NumericTraits< unsigned long >::max() );
+  itkGetConstMacro( NumberOfFixedHistogramBins, unsigned long );
+  itkSetClampMacro( NumberOfMovingHistogramBins, unsigned long,
+    1, NumericTraits< unsigned long >::max() );
+  itkGetConstMacro( NumberOfMovingHistogramBins, unsigned long );
+
+  /** Set/Get the step length of the central differences. The default is 0.1. */
+  itkSetMacro( DerivativeStepLength, double );
+  itkGetConstMacro( DerivativeStepLength, double );
+
+  /** Set/Get the scales of the step lengths; the step length of parameter i
+   * is DerivativeStepLength / DerivativeStepLengthScales[ i ]. If empty, all
+   * scales are 1.
+   */
+  itkSetMacro( DerivativeStepLengthScales, ScalesType );
+  itkGetConstReferenceMacro( DerivativeStepLengthScales, ScalesType );
+
+protected:
+
+  AdvancedMutualInformationHistogramImageToImageMetric();
+  virtual ~AdvancedMutualInformationHistogramImageToImageMetric();
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Protected Typedefs ******************/
+
+  /** Typedefs inherited from superclass */
+  typedef typename Superclass::FixedImagePointType  FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType MovingImagePointType;
+
+  /** Initialize the per-thread histograms. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Fill the joint histogram of a thread. */
+  inline void ThreadedGetValue( ThreadIdType threadID );
+
+  /** Add the histograms of the threads and compute the value. */
+  inline void AfterThreadedGetValue( MeasureType & value ) const;
+
+private:
+
+  AdvancedMutualInformationHistogramImageToImageMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                                       // purposely not implemented
+
+  /** Compute the value for some parameters; the samples are only updated
+   * when requested, so that central differences use the same samples.
+   */
+  MeasureType ComputeValue( const TransformParametersType & parameters,
+    const bool updateSamples ) const;
+
+  unsigned long m_NumberOfFixedHistogramBins;
+  unsigned long m_NumberOfMovingHistogramBins;
+  double        m_DerivativeStepLength;
+  ScalesType    m_DerivativeStepLengthScales;
+
+  /** The bins cover [min, min + numberOfBins / scale). */
+  double m_FixedHistogramMinimum;
+  double m_FixedHistogramScale;
+  double m_MovingHistogramMinimum;
+  double m_MovingHistogramScale;
+
+  /** The joint histogram of a thread, with the moving bins in the inner dimension. */
+  struct HistogramPerThreadStruct
+  {
+    SizeValueType                st_NumberOfPixelsCounted;
+    std::vector< SizeValueType > st_JointHistogram;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, HistogramPerThreadStruct,
+    PaddedHistogramPerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedHistogramPerThreadStruct,
+    AlignedHistogramPerThreadStruct );
+  mutable AlignedHistogramPerThreadStruct * m_HistogramPerThreadVariables;
+  mutable ThreadIdType                      m_HistogramPerThreadVariablesSize;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkAdvancedMutualInformationHistogramImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef __itkAdvancedMutualInformationHistogramImageToImageMetric_h
@@ -0,0 +1,414 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef _itkAdvancedMutualInformationHistogramImageToImageMetric_hxx
+#define _itkAdvancedMutualInformationHistogramImageToImageMetric_hxx
+
+#include "itkAdvancedMutualInformationHistogramImageToImageMetric.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::AdvancedMutualInformationHistogramImageToImageMetric()
+{
+  this->SetUseImageSampler( true );
+  this->SetUseFixedImageLimiter( false );
+  this->SetUseMovingImageLimiter( false );
+
+  this->m_NumberOfFixedHistogramBins  = 32;
+  this->m_NumberOfMovingHistogramBins = 32;
+  this->m_DerivativeStepLength        = 0.1;
+  this->m_FixedHistogramMinimum       = 0.0;
+  this->m_FixedHistogramScale         = 1.0;
+  this->m_MovingHistogramMinimum      = 0.0;
+  this->m_MovingHistogramScale        = 1.0;
+
+  // Multi-threading structs
+  this->m_HistogramPerThreadVariables     = NULL;
+  this->m_HistogramPerThreadVariablesSize = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::~AdvancedMutualInformationHistogramImageToImageMetric()
+{
+  delete[] this->m_HistogramPerThreadVariables;
+} // end Destructor
+
+
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Initialize transform, interpolator, etc. */
+  Superclass::Initialize();
+
+  /** Let the bins cover the intensity ranges of the images. */
+  this->ComputeFixedImageExtrema(
+    this->GetFixedImage(), this->GetFixedImageRegion() );
+  this->ComputeMovingImageExtrema(
+    this->GetMovingImage(), this->GetMovingImage()->GetBufferedRegion() );
+
+  const double fixedRange = static_cast< double >( this->m_FixedImageTrueMax )
+    - static_cast< double >( this->m_FixedImageTrueMin );
+  const double movingRange = static_cast< double >( this->m_MovingImageTrueMax )
+    - static_cast< double >( this->m_MovingImageTrueMin );
+  this->m_FixedHistogramMinimum  = static_cast< double >( this->m_FixedImageTrueMin );
+  this->m_MovingHistogramMinimum = static_cast< double >( this->m_MovingImageTrueMin );
+  this->m_FixedHistogramScale    = this->m_NumberOfFixedHistogramBins
+    / ( fixedRange > 0.0 ? fixedRange : 1.0 );
+  this->m_MovingHistogramScale = this->m_NumberOfMovingHistogramBins
+    / ( movingRange > 0.0 ? movingRange : 1.0 );
+
+} // end Initialize()
+
+
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Only resize the array of structs when needed. The histograms are
+   * cleared by the threads themselves.
+   */
+  if( this->m_HistogramPerThreadVariablesSize != this->m_NumberOfThreads )
+  {
+    delete[] this->m_HistogramPerThreadVariables;
+    this->m_HistogramPerThreadVariables     = new AlignedHistogramPerThreadStruct[ this->m_NumberOfThreads ];
+    this->m_HistogramPerThreadVariablesSize = this->m_NumberOfThreads;
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfFixedHistogramBins: "
+     << this->m_NumberOfFixedHistogramBins << std::endl;
+  os << indent << "NumberOfMovingHistogramBins: "
+     << this->m_NumberOfMovingHistogramBins << std::endl;
+  os << indent << "DerivativeStepLength: "
+     << this->m_DerivativeStepLength << std::endl;
+  os << indent << "DerivativeStepLengthScales: "
+     << this->m_DerivativeStepLengthScales << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  return this->ComputeValue( parameters, true );
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** The value selects the samples, which are kept for the differences. */
+  value = this->ComputeValue( parameters, true );
+
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if( this->m_DerivativeStepLengthScales.GetSize() != 0
+    && this->m_DerivativeStepLengthScales.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "The size of DerivativeStepLengthScales ("
+                       << this->m_DerivativeStepLengthScales.GetSize()
+                       << ") does not match the number of parameters ("
+                       << numberOfParameters << ")." );
+  }
+
+  /** Central differences. */
+  derivative.SetSize( numberOfParameters );
+  TransformParametersType testPoint = parameters;
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    double step = this->m_DerivativeStepLength;
+    if( this->m_DerivativeStepLengthScales.GetSize() != 0 )
+    {
+      step /= this->m_DerivativeStepLengthScales[ i ];
+    }
+
+    testPoint[ i ] = parameters[ i ] - step;
+    const MeasureType valuep0 = this->ComputeValue( testPoint, false );
+    testPoint[ i ] = parameters[ i ] + step;
+    const MeasureType valuep1 = this->ComputeValue( testPoint, false );
+    testPoint[ i ] = parameters[ i ];
+
+    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2.0 * step );
+  }
+
+  /** Restore the transform parameters. */
+  this->SetTransformParameters( parameters );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ComputeValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValue( const TransformParametersType & parameters, const bool updateSamples ) const
+{
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * For the central differences only the transform parameters change.
+   */
+  if( updateSamples )
+  {
+    this->BeforeThreadedGetValueAndDerivative( parameters );
+  }
+  else
+  {
+    this->SetTransformParameters( parameters );
+  }
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueThreaderCallback();
+
+  /** Gather the histograms from all threads. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetValue( value );
+
+  return value;
+
+} // end ComputeValue()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( this->m_NumberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
+
+  /** Clear the histogram of this thread. */
+  std::vector< SizeValueType > & jointHistogram
+    = this->m_HistogramPerThreadVariables[ threadId ].st_JointHistogram;
+  jointHistogram.assign( this->m_NumberOfFixedHistogramBins * this->m_NumberOfMovingHistogramBins, 0 );
+  const long    lastFixedBin          = static_cast< long >( this->m_NumberOfFixedHistogramBins ) - 1;
+  const long    lastMovingBin         = static_cast< long >( this->m_NumberOfMovingHistogramBins ) - 1;
+  unsigned long numberOfPixelsCounted = 0;
+
+  /** Loop over the fixed image samples to fill the joint histogram. */
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
+    RealType                    movingImageValue;
+    MovingImagePointType        mappedPoint;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and check if
+     * the point is inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, 0 );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+
+      /** Get the bins of the fixed and moving image values. */
+      const double fixedImageValue
+        = static_cast< double >( ( *threader_fiter ).Value().m_ImageValue );
+      const long fixedBin = std::max( 0L, std::min( lastFixedBin, static_cast< long >( vcl_floor(
+        ( fixedImageValue - this->m_FixedHistogramMinimum ) * this->m_FixedHistogramScale ) ) ) );
+      const long movingBin = std::max( 0L, std::min( lastMovingBin, static_cast< long >( vcl_floor(
+        ( movingImageValue - this->m_MovingHistogramMinimum ) * this->m_MovingHistogramScale ) ) ) );
+
+      jointHistogram[ fixedBin * this->m_NumberOfMovingHistogramBins + movingBin ]++;
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_HistogramPerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMutualInformationHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  /** Accumulate the number of pixels and the histograms in those of thread 0. */
+  std::vector< SizeValueType > & jointHistogram
+    = this->m_HistogramPerThreadVariables[ 0 ].st_JointHistogram;
+  this->m_NumberOfPixelsCounted = this->m_HistogramPerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
+  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += this->m_HistogramPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    const std::vector< SizeValueType > & threadHistogram
+      = this->m_HistogramPerThreadVariables[ i ].st_JointHistogram;
+    for( std::size_t k = 0; k < jointHistogram.size(); ++k )
+    {
+      jointHistogram[ k ] += threadHistogram[ k ];
+    }
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute the marginal histograms. */
+  const unsigned long          nf = this->m_NumberOfFixedHistogramBins;
+  const unsigned long          nm = this->m_NumberOfMovingHistogramBins;
+  std::vector< SizeValueType > fixedHistogram( nf, 0 );
+  std::vector< SizeValueType > movingHistogram( nm, 0 );
+  for( unsigned long f = 0; f < nf; ++f )
+  {
+    for( unsigned long m = 0; m < nm; ++m )
+    {
+      fixedHistogram[ f ]  += jointHistogram[ f * nm + m ];
+      movingHistogram[ m ] += jointHistogram[ f * nm + m ];
+    }
+  }
+
+  /** MI = sum p(f,m) log( p(f,m) / ( p(f) p(m) ) ), with p = count / N. */
+  const double numberOfSamples   = static_cast< double >( this->m_NumberOfPixelsCounted );
+  double       mutualInformation = 0.0;
+  for( unsigned long f = 0; f < nf; ++f )
+  {
+    for( unsigned long m = 0; m < nm; ++m )
+    {
+      const double count = static_cast< double >( jointHistogram[ f * nm + m ] );
+      if( count > 0.0 )
+      {
+        mutualInformation += count * std::log( count * numberOfSamples
+          / ( static_cast< double >( fixedHistogram[ f ] ) * static_cast< double >( movingHistogram[ m ] ) ) );
+      }
+    }
+  }
+
+  value = static_cast< MeasureType >( -mutualInformation / numberOfSamples );
+
+} // end AfterThreadedGetValue()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkAdvancedMutualInformationHistogramImageToImageMetric_hxx
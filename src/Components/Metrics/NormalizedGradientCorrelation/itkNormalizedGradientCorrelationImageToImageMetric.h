@@ -27,6 +27,7 @@
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkMovedImageGradientSampler.h"
 
 namespace itk
 {
@@ -35,6 +36,12 @@ namespace itk
  * \class NormalizedGradientCorrelationImageToImageMetric
  * \brief An metric based on the itk::NormalizedGradientCorrelationImageToImageMetric.
  *
+ * By default the moving image is resampled on the whole fixed image grid, and
+ * the measure is computed over the whole fixed image region. If
+ * UseSampledMovingGradients is set, the measure is only computed at the
+ * samples of the image sampler, and the moving image is only resampled in
+ * the neighbourhoods of those samples. The gradients of the fixed image are
+ * computed once in Initialize().
  *
  * \ingroup Metrics
  *
@@ -123,6 +130,13 @@ public:
   typedef typename CastMovedImageFilterType::Pointer CastMovedImageFilterPointer;
   typedef typename MovedGradientImageType::PixelType MovedGradientPixelType;
 
+  /** The sampled computation of the moved image gradients. */
+  typedef MovedImageGradientSampler< FixedImageType, MovingImageType >
+    MovedGradientSamplerType;
+  typedef typename MovedGradientSamplerType::Pointer       MovedGradientSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+
   /** Get the derivatives of the match measure. */
   virtual void GetDerivative( const TransformParametersType & parameters,
     DerivativeType  & derivative ) const;
@@ -152,6 +166,13 @@ public:
   itkSetMacro( DerivativeDelta, double );
   itkGetConstReferenceMacro( DerivativeDelta, double );
 
+  /** Compute the measure at the samples of the image sampler only, instead
+   * of over the whole fixed image region. Default: false.
+   */
+  itkSetMacro( UseSampledMovingGradients, bool );
+  itkGetConstMacro( UseSampledMovingGradients, bool );
+  itkBooleanMacro( UseSampledMovingGradients );
+
   /** Set the parameters defining the Transform. */
   void SetTransformParameters( const TransformParametersType & parameters ) const;
 
@@ -169,6 +190,14 @@ protected:
   /** Compute the similarity measure  */
   MeasureType ComputeMeasure( const TransformParametersType & parameters ) const;
 
+  /** Compute the similarity measure at the samples of the image sampler. */
+  MeasureType ComputeMeasureAtSamples( const TransformParametersType & parameters ) const;
+
+  /** Pass the fixed image indices of the samples to the moved gradient
+   * sampler, if the sample container changed.
+   */
+  void UpdateMovedGradientSampleIndices( void ) const;
+
   typedef NeighborhoodOperatorImageFilter<
     FixedGradientImageType, FixedGradientImageType >        FixedSobelFilter;
   typedef NeighborhoodOperatorImageFilter<
@@ -183,6 +212,12 @@ private:
   double                      m_DerivativeDelta;
   CombinationTransformPointer m_CombinationTransform;
 
+  /** The sampled computation of the moving image gradients. */
+  bool                        m_UseSampledMovingGradients;
+  MovedGradientSamplerPointer m_MovedGradientSampler;
+  mutable unsigned long       m_MovedGradientSampleMTime;
+  mutable const void *        m_MovedGradientSampleContainer;
+
   /** The mean of the moving image gradients. */
   mutable MovedGradientPixelType m_MeanMovedGradient[ MovedImageDimension ];
 
@@ -44,6 +44,10 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_TransformMovingImageFilter = TransformMovingImageFilterType::New();
   this->m_DerivativeDelta            = 0.001;
 
+  this->m_UseSampledMovingGradients    = false;
+  this->m_MovedGradientSampleMTime     = 0;
+  this->m_MovedGradientSampleContainer = 0;
+
   for( unsigned int iDimension = 0; iDimension < MovedImageDimension; iDimension++ )
   {
     this->m_MeanFixedGradient[ iDimension ] = 0;
@@ -97,6 +101,22 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
                        << "only suitable for 2D-3D registration.\n"
                        << "  Therefore it expects an interpolator of type RayCastInterpolator." );
   }
+  /** The sampled version only needs the fixed image gradients. */
+  if( this->m_UseSampledMovingGradients )
+  {
+    if( !this->m_UseImageSampler )
+    {
+      itkExceptionMacro( << "ERROR: UseSampledMovingGradients requires an image sampler." );
+    }
+    this->m_MovedGradientSampler = MovedGradientSamplerType::New();
+    this->m_MovedGradientSampler->SetFixedImage( this->m_FixedImage );
+    this->m_MovedGradientSampler->SetInterpolator( this->m_Interpolator );
+    this->m_MovedGradientSampler->SetTransform( rayCaster->GetTransform() );
+    this->m_MovedGradientSampleMTime     = 0;
+    this->m_MovedGradientSampleContainer = 0;
+    return;
+  }
+
   this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
   this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
   this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
@@ -134,6 +154,7 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+  os << indent << "UseSampledMovingGradients: " << this->m_UseSampledMovingGradients << std::endl;
 } // end PrintSelf()
 
 
@@ -303,9 +324,8 @@ typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingIm
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeMeasure( const TransformParametersType & parameters ) const
 {
+  /** The moving image has already been resampled by GetValue(). */
   this->SetTransformParameters( parameters );
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
 
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
@@ -400,6 +420,120 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeMeasure()
 
 
+/**
+ * ***************** UpdateMovedGradientSampleIndices *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateMovedGradientSampleIndices( void ) const
+{
+  /** The samples are only converted when the sampler selected new ones. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  if( sampleContainer.GetPointer() == this->m_MovedGradientSampleContainer
+    && sampleContainer->GetMTime() == this->m_MovedGradientSampleMTime )
+  {
+    return;
+  }
+
+  /** Round the sample positions to the fixed image grid. */
+  typename MovedGradientSamplerType::IndexContainerType indices;
+  indices.reserve( sampleContainer->Size() );
+  typename FixedImageType::IndexType index;
+  typename ImageSampleContainerType::ConstIterator iter;
+  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
+  for( iter = sampleContainer->Begin(); iter != end; ++iter )
+  {
+    if( this->m_FixedImage->TransformPhysicalPointToIndex(
+      ( *iter ).Value().m_ImageCoordinates, index ) )
+    {
+      indices.push_back( index );
+    }
+  }
+
+  this->m_MovedGradientSampler->SetSampleIndices( indices );
+  this->m_MovedGradientSampleContainer = sampleContainer.GetPointer();
+  this->m_MovedGradientSampleMTime     = sampleContainer->GetMTime();
+
+} // end UpdateMovedGradientSampleIndices()
+
+
+/**
+ * ***************** ComputeMeasureAtSamples *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasureAtSamples( const TransformParametersType & parameters ) const
+{
+  /** Set the parameters and update the image sampler. */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+  this->UpdateMovedGradientSampleIndices();
+
+  /** Compute the moved image gradients at the samples only. */
+  this->m_MovedGradientSampler->Compute();
+  const typename MovedGradientSamplerType::IndexContainerType & indices
+    = this->m_MovedGradientSampler->GetSampleIndices();
+  const typename MovedGradientSamplerType::GradientContainerType & movedGradients
+    = this->m_MovedGradientSampler->GetGradients();
+  const std::size_t numberOfSamples = indices.size();
+
+  this->m_NumberOfPixelsCounted = numberOfSamples;
+  if( numberOfSamples == 0 )
+  {
+    return NumericTraits< MeasureType >::Zero;
+  }
+
+  /** Gather the fixed gradients, and compute the means over the samples. */
+  const FixedGradientImageType * fixedGradientImagex = this->m_FixedSobelFilters[ 0 ]->GetOutput();
+  const FixedGradientImageType * fixedGradientImagey = this->m_FixedSobelFilters[ 1 ]->GetOutput();
+  std::vector< FixedGradientPixelType > fixedGradients( 2 * numberOfSamples );
+  for( int i = 0; i < 2; i++ )
+  {
+    this->m_MeanFixedGradient[ i ] = 0.0;
+    this->m_MeanMovedGradient[ i ] = 0.0;
+  }
+  for( std::size_t s = 0; s < numberOfSamples; ++s )
+  {
+    fixedGradients[ 2 * s ]         = fixedGradientImagex->GetPixel( indices[ s ] );
+    fixedGradients[ 2 * s + 1 ]     = fixedGradientImagey->GetPixel( indices[ s ] );
+    this->m_MeanFixedGradient[ 0 ] += fixedGradients[ 2 * s ];
+    this->m_MeanFixedGradient[ 1 ] += fixedGradients[ 2 * s + 1 ];
+    this->m_MeanMovedGradient[ 0 ] += movedGradients[ s ][ 0 ];
+    this->m_MeanMovedGradient[ 1 ] += movedGradients[ s ][ 1 ];
+  }
+  for( int i = 0; i < 2; i++ )
+  {
+    this->m_MeanFixedGradient[ i ] /= numberOfSamples;
+    this->m_MeanMovedGradient[ i ] /= numberOfSamples;
+  }
+
+  MovedGradientPixelType NmovedGradient[ FixedImageDimension ];
+  FixedGradientPixelType NfixedGradient[ FixedImageDimension ];
+
+  MeasureType NGcrosscorrelation      = NumericTraits< MeasureType >::Zero;
+  MeasureType NGautocorrelationfixed  = NumericTraits< MeasureType >::Zero;
+  MeasureType NGautocorrelationmoving = NumericTraits< MeasureType >::Zero;
+
+  for( std::size_t s = 0; s < numberOfSamples; ++s )
+  {
+    NmovedGradient[ 0 ]      = movedGradients[ s ][ 0 ] - this->m_MeanMovedGradient[ 0 ];
+    NfixedGradient[ 0 ]      = fixedGradients[ 2 * s ] - this->m_MeanFixedGradient[ 0 ];
+    NmovedGradient[ 1 ]      = movedGradients[ s ][ 1 ] - this->m_MeanMovedGradient[ 1 ];
+    NfixedGradient[ 1 ]      = fixedGradients[ 2 * s + 1 ] - this->m_MeanFixedGradient[ 1 ];
+    NGcrosscorrelation      += NmovedGradient[ 0 ] * NfixedGradient[ 0 ] + NmovedGradient[ 1 ] * NfixedGradient[ 1 ];
+    NGautocorrelationmoving += NmovedGradient[ 0 ] * NmovedGradient[ 0 ] + NmovedGradient[ 1 ] * NmovedGradient[ 1 ];
+    NGautocorrelationfixed  += NfixedGradient[ 0 ] * NfixedGradient[ 0 ] + NfixedGradient[ 1 ] * NfixedGradient[ 1 ];
+  }
+
+  return -1.0 * ( NGcrosscorrelation
+         / ( vcl_sqrt( NGautocorrelationfixed ) * vcl_sqrt( NGautocorrelationmoving ) ) );
+
+} // end ComputeMeasureAtSamples()
+
+
 /**
  * ***************** GetValue *****************
  */
@@ -409,6 +543,11 @@ typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingIm
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
+  if( this->m_UseSampledMovingGradients )
+  {
+    return this->ComputeMeasureAtSamples( parameters );
+  }
+
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
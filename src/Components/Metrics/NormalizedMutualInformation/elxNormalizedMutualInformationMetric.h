@@ -52,6 +52,16 @@ namespace elastix
  *    the joint histogram. Can be given for each resolution, or for all resolutions at once. \n
  *    example: <tt>(MovingKernelBSplineOrder 3 3 3)</tt> \n
  *    The default value is 3.
+ * \parameter UseParzenKernelLookupTable: Whether the Parzen kernels of B-spline order 2 and 3
+ *    are interpolated from a precomputed table, instead of evaluating the B-spline polynomials
+ *    for every sample. Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseParzenKernelLookupTable "true")</tt> \n
+ *    The default value is "false".
+ * \parameter UseLimiterLookupTable: Whether the exponential of the moving image limiter is
+ *    interpolated from a precomputed table, instead of calling exp() for every limited value.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseLimiterLookupTable "true")</tt> \n
+ *    The default value is "false".
  * \parameter FixedLimitRangeRatio: The relative extension of the intensity range of the fixed image.\n
  *    If your image has gray values from 0 to 1000 and the FixedLimitRangeRatio is 0.001, the
  *    joint histogram will expect fixed image gray values from -0.001 to 1000.001. This may be
@@ -64,6 +74,12 @@ namespace elastix
  *    useful if you use high order B-spline interpolator for the moving image.\n
  *    example: <tt>(MovingLimitRangeRatio 0.001 0.01 0.01)</tt> \n
  *    The default value is 0.01. Can be given for each resolution, or for all resolutions at once.
+ * \parameter UseFastAndLowMemoryVersion: Switch between a version that explicitly
+ *    computes the derivatives of the joint histogram to each transformation parameter
+ *    (false), and a version that loops over the samples twice instead, which needs
+ *    much less memory and runs multi-threaded (true).\n
+ *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
+ *    The default is "true".
  *
  * \sa ParzenWindowNormalizedMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -80,7 +80,12 @@ NormalizedMutualInformationMetric< TElastix >
   typedef itk::HardLimiterFunction< RealType, FixedImageDimension >         FixedLimiterType;
   typedef itk::ExponentialLimiterFunction< RealType, MovingImageDimension > MovingLimiterType;
   this->SetFixedImageLimiter( FixedLimiterType::New() );
-  this->SetMovingImageLimiter( MovingLimiterType::New() );
+  typename MovingLimiterType::Pointer movingLimiter = MovingLimiterType::New();
+  bool useLimiterLookupTable = false;
+  this->GetConfiguration()->ReadParameter( useLimiterLookupTable,
+    "UseLimiterLookupTable", this->GetComponentLabel(), level, 0 );
+  movingLimiter->SetUseLookupTable( useLimiterLookupTable );
+  this->SetMovingImageLimiter( movingLimiter );
 
   /** Get and set the number of histogram bins. */
   double fixedLimitRangeRatio  = 0.01;
@@ -102,6 +107,18 @@ NormalizedMutualInformationMetric< TElastix >
   this->SetFixedKernelBSplineOrder( fixedKernelBSplineOrder );
   this->SetMovingKernelBSplineOrder( movingKernelBSplineOrder );
 
+  /** Set whether the Parzen kernels are tabulated. */
+  bool useParzenKernelLookupTable = false;
+  this->GetConfiguration()->ReadParameter( useParzenKernelLookupTable,
+    "UseParzenKernelLookupTable", this->GetComponentLabel(), level, 0 );
+  this->SetUseParzenKernelLookupTable( useParzenKernelLookupTable );
+
+  /** Set whether a low memory consumption should be used. */
+  bool useFastAndLowMemoryVersion = true;
+  this->GetConfiguration()->ReadParameter( useFastAndLowMemoryVersion,
+    "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
+  this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
+
 } // end BeforeEachResolution()
 
 
@@ -20,6 +20,7 @@
 #define __itkParzenWindowNormalizedMutualInformationImageToImageMetric_H__
 
 #include "itkParzenWindowHistogramImageToImageMetric.h"
+#include "itkArray2D.h"
 
 namespace itk
 {
@@ -134,6 +135,9 @@ public:
     Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+  typedef typename Superclass::DerivativeValueType    DerivativeValueType;
+  typedef typename Superclass::NumberOfParametersType NumberOfParametersType;
+  typedef typename Superclass::ThreadInfoType         ThreadInfoType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -153,7 +157,7 @@ public:
 protected:
 
   /** The constructor. */
-  ParzenWindowNormalizedMutualInformationImageToImageMetric() {}
+  ParzenWindowNormalizedMutualInformationImageToImageMetric();
 
   /** The destructor. */
   virtual ~ParzenWindowNormalizedMutualInformationImageToImageMetric() {}
@@ -200,6 +204,43 @@ protected:
    */
   virtual MeasureType ComputeNormalizedMutualInformation( MeasureType & jointEntropy ) const;
 
+  /** Some initialization functions, called by Initialize. */
+  virtual void InitializeHistograms( void );
+
+  /** Get the value and analytic derivative.
+   * Called by GetValueAndDerivative if UseExplicitPDFDerivatives == false.
+   *
+   * Like the low memory version of the ParzenWindowMutualInformationImageToImageMetric,
+   * this avoids the large joint histogram derivative. The joint histogram is
+   * computed by the (multi-threaded) ComputePDFs(), after which a second
+   * (multi-threaded) loop over the samples computes the derivative from the
+   * precomputed ratios of the normalized mutual information.
+   */
+  virtual void GetValueAndAnalyticDerivativeLowMemory(
+    const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Threading related parameters. */
+  struct ParzenWindowNormalizedMutualInformationMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+  ParzenWindowNormalizedMutualInformationMultiThreaderParameterType
+    m_ParzenWindowNormalizedMutualInformationThreaderParameters;
+
+  /** Multi-threaded version of the derivative computation. */
+  inline void ThreadedComputeDerivativeLowMemory( ThreadIdType threadId );
+
+  /** Single-threadedly accumulate results. */
+  inline void AfterThreadedComputeDerivativeLowMemory(
+    DerivativeType & derivative ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE ComputeDerivativeLowMemoryThreaderCallback( void * arg );
+
+  /** Helper function to launch the threads. */
+  void LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const;
+
 private:
 
   /** The private constructor. */
@@ -207,6 +248,31 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                               // purposely not implemented
 
+  /** Helper array for storing the derivative weights of the joint histogram bins:
+   * alpha ( NMI log p(i,k) - log pf(k) - log pm(i) ) / Ej.
+   */
+  typedef double                PRatioType;
+  typedef Array2D< PRatioType > PRatioArrayType;
+  mutable PRatioArrayType m_PRatioArray;
+
+  /** Helper function to compute m_PRatioArray. Assumes the marginal pdfs are log'ed. */
+  void ComputePRatioArray( const MeasureType & nMI, const MeasureType & jointEntropy ) const;
+
+  /** Helper function to compute the derivative for the low memory variant. */
+  void ComputeDerivativeLowMemory( DerivativeType & derivative ) const;
+
+  /** Add the derivative contributions of the samples [begin, end). */
+  void ComputeDerivativeLowMemoryOfSamples( unsigned long pos_begin,
+    unsigned long pos_end, DerivativeType & derivative ) const;
+
+  /** Helper function to update the derivative for the low memory variant. */
+  void UpdateDerivativeLowMemory(
+    const RealType & fixedImageValue,
+    const RealType & movingImageValue,
+    const DerivativeType & imageJacobian,
+    const NonZeroJacobianIndicesType & nzji,
+    DerivativeType & derivative ) const;
+
 };
 
 } // end namespace itk
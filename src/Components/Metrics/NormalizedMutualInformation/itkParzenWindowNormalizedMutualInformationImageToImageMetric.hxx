@@ -22,11 +22,49 @@
 #include "itkParzenWindowNormalizedMutualInformationImageToImageMetric.h"
 
 #include "itkImageLinearConstIteratorWithIndex.h"
+#include "itkImageScanlineConstIterator.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
 {
 
+/**
+ * ********************* Constructor ******************************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ParzenWindowNormalizedMutualInformationImageToImageMetric()
+{
+  /** Initialize the m_ParzenWindowNormalizedMutualInformationThreaderParameters. */
+  this->m_ParzenWindowNormalizedMutualInformationThreaderParameters.m_Metric = this;
+
+}   // end Constructor
+
+
+/**
+ * ********************* InitializeHistograms ******************************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeHistograms( void )
+{
+  /** Call Superclass implementation. */
+  this->Superclass::InitializeHistograms();
+
+  /** Allocate small amount of memory for the m_PRatioArray. */
+  if( !this->GetUseExplicitPDFDerivatives() )
+  {
+    this->m_PRatioArray.SetSize(
+      this->GetNumberOfFixedHistogramBins(),
+      this->GetNumberOfMovingHistogramBins() );
+  }
+
+}   // end InitializeHistograms()
+
+
 /**
  * ********************* PrintSelf ******************************
  *
@@ -181,6 +219,14 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
   MeasureType & value,
   DerivativeType & derivative ) const
 {
+  /** Low memory variant. */
+  if( !this->GetUseExplicitPDFDerivatives() )
+  {
+    this->GetValueAndAnalyticDerivativeLowMemory(
+      parameters, value, derivative );
+    return;
+  }
+
   /** Initialize some variables */
   value      = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
@@ -280,6 +326,384 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
 }   // end GetValueAndDerivative
 
 
+/**
+ * ******************** GetValueAndAnalyticDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndAnalyticDerivativeLowMemory(
+  const ParametersType & parameters,
+  MeasureType & value,
+  DerivativeType & derivative ) const
+{
+  /** Initialize some variables */
+  value      = NumericTraits< MeasureType >::Zero;
+  derivative = DerivativeType( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< double >::ZeroValue() );
+
+  /** Construct the JointPDF and Alpha.
+   * This function contains a loop over the samples.
+   * It executes multi-threadedly when m_UseMultiThread == true.
+   */
+  this->ComputePDFs( parameters );
+
+  /** Normalize the pdfs: p = alpha h */
+  this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
+
+  /** Compute the fixed and moving marginal pdf by summing over the histogram */
+  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
+
+  /** Replace the probabilities by log(probabilities) */
+  this->ComputeLogMarginalPDF( this->m_FixedImageMarginalPDF );
+  this->ComputeLogMarginalPDF( this->m_MovingImageMarginalPDF );
+
+  /** Compute the measure and joint entropy (which we both need to compute the derivative) */
+  MeasureType       jointEntropy = 0.0;
+  const MeasureType nMI          = this->ComputeNormalizedMutualInformation( jointEntropy );
+  value = static_cast< MeasureType >( -1.0 * nMI );
+
+  /** Compute the weights of the joint histogram bins in the derivative. */
+  this->ComputePRatioArray( nMI, jointEntropy );
+
+  /* Compute the derivative.
+   * This function contains a second loop over the samples.
+   * It executes multi-threadedly when m_UseMultiThread == true.
+   */
+  this->ComputeDerivativeLowMemory( derivative );
+
+}   // end GetValueAndAnalyticDerivativeLowMemory()
+
+
+/**
+ * ******************** ComputePRatioArray *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePRatioArray( const MeasureType & nMI, const MeasureType & jointEntropy ) const
+{
+  /** The derivative is (see GetValueAndDerivative):
+   * -dNMI/dmu = - sum_k sum_i dhdmu(i,k) alpha*pRatio/Ej,
+   * so store alpha*pRatio/Ej for every bin.
+   */
+  typedef ImageScanlineConstIterator< JointPDFType > JointPDFIteratorType;
+  JointPDFIteratorType jointPDFit(
+    this->m_JointPDF, this->m_JointPDF->GetLargestPossibleRegion() );
+
+  this->m_PRatioArray.Fill( itk::NumericTraits< PRatioType >::ZeroValue() );
+
+  const unsigned int numberOfFixedBins  = this->m_FixedImageMarginalPDF.size();
+  const unsigned int numberOfMovingBins = this->m_MovingImageMarginalPDF.size();
+  for( unsigned int fixedIndex = 0; fixedIndex < numberOfFixedBins; ++fixedIndex )
+  {
+    const double logFixedImagePDFValue = this->m_FixedImageMarginalPDF[ fixedIndex ];
+    for( unsigned int movingIndex = 0; movingIndex < numberOfMovingBins; ++movingIndex )
+    {
+      const double logMovingImagePDFValue = this->m_MovingImageMarginalPDF[ movingIndex ];
+      const double jointPDFValue          = jointPDFit.Value();
+
+      /** check for non-zero bin contribution */
+      if( jointPDFValue > 1e-16 )
+      {
+        const double pRatio = ( nMI * vcl_log( jointPDFValue )
+          - logFixedImagePDFValue - logMovingImagePDFValue ) / jointEntropy;
+        this->m_PRatioArray[ fixedIndex ][ movingIndex ]
+          = static_cast< PRatioType >( this->m_Alpha * pRatio );
+      }
+      ++jointPDFit;
+    }
+    jointPDFit.NextLine();
+  }
+
+}   // end ComputePRatioArray()
+
+
+/**
+ * ******************** ComputeDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDerivativeLowMemory( DerivativeType & derivative ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if( !this->m_UseMultiThread )
+  {
+    derivative.Fill( NumericTraits< double >::ZeroValue() );
+    this->ComputeDerivativeLowMemoryOfSamples( 0,
+      this->GetImageSampler()->GetOutput()->Size(), derivative );
+    return;
+  }
+
+  /** Launch multi-threading derivative computation. */
+  this->LaunchComputeDerivativeLowMemoryThreaderCallback();
+
+  /** Gather the results from all threads. */
+  this->AfterThreadedComputeDerivativeLowMemory( derivative );
+
+}   // end ComputeDerivativeLowMemory()
+
+
+/**
+ * ******************* ThreadedComputeDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeDerivativeLowMemory( ThreadIdType threadId )
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  /** Get the samples for this thread. */
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( this->m_NumberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  this->ComputeDerivativeLowMemoryOfSamples( pos_begin, pos_end, derivative );
+
+}   // end ThreadedComputeDerivativeLowMemory()
+
+
+/**
+ * ******************* AfterThreadedComputeDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedComputeDerivativeLowMemory( DerivativeType & derivative ) const
+{
+  /** Accumulate the derivatives of the threads, and reset them. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+
+}   // end AfterThreadedComputeDerivativeLowMemory()
+
+
+/**
+ * **************** ComputeDerivativeLowMemoryThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage  >
+ITK_THREAD_RETURN_TYPE
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDerivativeLowMemoryThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->ThreadID;
+
+  ParzenWindowNormalizedMutualInformationMultiThreaderParameterType * temp
+    = static_cast< ParzenWindowNormalizedMutualInformationMultiThreaderParameterType * >(
+    infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputeDerivativeLowMemory( threadId );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+}   // end ComputeDerivativeLowMemoryThreaderCallback()
+
+
+/**
+ * *********************** LaunchComputeDerivativeLowMemoryThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const
+{
+  /** Launch on the persistent thread pool. */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->ComputeDerivativeLowMemoryThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_ParzenWindowNormalizedMutualInformationThreaderParameters ) ) );
+
+}   // end LaunchComputeDerivativeLowMemoryThreaderCallback()
+
+
+/**
+ * ******************* ComputeDerivativeLowMemoryOfSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeDerivativeLowMemoryOfSamples( unsigned long pos_begin,
+  unsigned long pos_end, DerivativeType & derivative ) const
+{
+  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji  = NonZeroJacobianIndicesType( nnzji );
+  DerivativeType               imageJacobian( nzji.size() );
+
+  /** Create iterator over the samples in [pos_begin, pos_end). */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
+  fbegin                                                 += (int)pos_begin;
+  fend                                                   += (int)pos_end;
+
+  /** Loop over the samples and compute their contribution to the derivative. */
+  for( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    /** Read fixed coordinates and create some variables. */
+    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    RealType                    movingImageValue;
+    MovingImageDerivativeType   movingImageDerivative;
+    MovingImagePointType        mappedPoint;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if the point is inside the moving mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value, its derivative, and check
+     * if the point is inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+    }
+
+    if( sampleOk )
+    {
+      /** Get the fixed image value. */
+      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+
+      /** Make sure the values fall within the histogram range. */
+      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+      movingImageValue = this->GetMovingImageLimiter()
+        ->Evaluate( movingImageValue, movingImageDerivative );
+
+      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji );
+
+      /** Compute this sample's contribution to the derivative. */
+      this->UpdateDerivativeLowMemory(
+        fixedImageValue, movingImageValue, imageJacobian, nzji, derivative );
+
+    } // end sampleOk
+  }   // end loop over sample container
+
+}   // end ComputeDerivativeLowMemoryOfSamples()
+
+
+/**
+ * ******************* UpdateDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage  >
+void
+ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateDerivativeLowMemory(
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  const DerivativeType & imageJacobian,
+  const NonZeroJacobianIndicesType & nzji,
+  DerivativeType & derivative ) const
+{
+  /** In this function we need to do:
+   *      derivative -= constant * imageJacobian *
+   *          \sum_i \sum_k PRatio(i,k) * dB/dxi(xi,i,k),
+   * with i, k, the fixed and moving histogram bins,
+   * PRatio the precomputed alpha*pRatio/Ej, and dB/dxi the B-spline
+   * derivative. We only have to loop over i,k within the support of the
+   * B-spline Parzen-window, and imageJacobian may be sparse.
+   */
+
+  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  const double fixedImageParzenWindowTerm
+    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  const double movingImageParzenWindowTerm
+    = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin numbers affected by this pixel: */
+  const int fixedParzenWindowIndex
+    = static_cast< int >( vcl_floor(
+    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+  const int movingParzenWindowIndex
+    = static_cast< int >( vcl_floor(
+    movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
+
+  /** Compute the fixed Parzen values. */
+  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+  this->EvaluateParzenValues(
+    fixedImageParzenWindowTerm, fixedParzenWindowIndex,
+    this->m_FixedKernel, fixedParzenValues );
+
+  /** Compute the derivatives of the moving Parzen window. */
+  ParzenValueContainerType derivativeMovingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+  this->EvaluateParzenValues(
+    movingImageParzenWindowTerm, movingParzenWindowIndex,
+    this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
+
+  /** Get the moving image bin size. */
+  const double et = static_cast< double >( this->m_MovingImageBinSize );
+
+  /** Loop over the Parzen window region and increment sum. */
+  PDFValueType sum = 0.0;
+  for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+  {
+    const double fv_et = fixedParzenValues[ f ] / et;
+    for( unsigned int m = 0; m < derivativeMovingParzenValues.GetSize(); ++m )
+    {
+      sum += this->m_PRatioArray[ f + fixedParzenWindowIndex ][ m + movingParzenWindowIndex ]
+        * fv_et * derivativeMovingParzenValues[ m ];
+    }
+  }
+
+  /** Now compute derivative -= sum * imageJacobian. */
+  if( nzji.size() == this->GetNumberOfParameters() )
+  {
+    /** Loop over all Jacobians. */
+    for( unsigned int mu = 0; mu < this->GetNumberOfParameters(); ++mu )
+    {
+      derivative[ mu ] += static_cast< DerivativeValueType >(
+        imageJacobian[ mu ] * sum );
+    }
+  }
+  else
+  {
+    /** Loop only over the non-zero Jacobians. */
+    for( unsigned int i = 0; i < imageJacobian.GetSize(); ++i )
+    {
+      const unsigned int mu = nzji[ i ];
+      derivative[ mu ] += static_cast< DerivativeValueType >(
+        imageJacobian[ i ] * sum );
+    }
+  }
+
+}   // end UpdateDerivativeLowMemory()
+
+
 } // end namespace itk
 
 #endif // end #ifndef _itkParzenWindowNormalizedMutualInformationImageToImageMetric_HXX__
@@ -0,0 +1,154 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLAdvancedMeanSquaresMetric_h
+#define __elxOpenCLAdvancedMeanSquaresMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdvancedMeanSquaresMetric.h"
+#include "elxOpenCLMetricBase.h"
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLAdvancedMeanSquaresMetric
+ * \brief The AdvancedMeanSquares metric, with the value and derivative
+ * computed by OpenCL.
+ *
+ * The sum of squared differences and the derivative are computed on the
+ * GPU, as described in OpenCLMetricBase; per iteration only the sums of the
+ * work groups and the derivative are read back.
+ *
+ * The GPU computes in single precision, and is used when:
+ * \li the images are 3D,
+ * \li the transform is an AdvancedBSplineDeformableTransform of order 2 or 3,
+ *    without initial transform,
+ * \li the moving image is interpolated linearly, by the LinearInterpolator or
+ *    by a BSplineInterpolator of order 1, and no gradient image is used,
+ * \li no moving mask is used,
+ * \li the number of samples is at least
+ *    OpenCLAdvancedMeanSquaresMinimumNumberOfSamples.
+ *
+ * In other cases, or if the OpenCL context could not be created, the metric
+ * is computed on the CPU, like the AdvancedMeanSquares. GetValue() is always
+ * computed on the CPU.
+ *
+ * The parameters used in this class are those of the AdvancedMeanSquares
+ * metric, and:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "OpenCLAdvancedMeanSquares")</tt>
+ * \parameter OpenCLAdvancedMeanSquaresUseOpenCL: Enable the OpenCL
+ *    computation of the metric. Can be given for each resolution, or for
+ *    all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresUseOpenCL "true")</tt> \n
+ *    The default value is "true".
+ * \parameter OpenCLAdvancedMeanSquaresMinimumNumberOfSamples: The minimum
+ *    number of samples for which the metric is computed on the GPU. Can be
+ *    given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresMinimumNumberOfSamples 20000)</tt> \n
+ *    The default value is 10000.
+ * \parameter OpenCLAdvancedMeanSquaresUseOpenCLImageSampler: Generate the samples
+ *    on the GPU as well, when a RandomCoordinate sampler with the
+ *    counter-based random generator is used, see OpenCLMetricBase. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresUseOpenCLImageSampler "false")</tt> \n
+ *    The default value is "true".
+ *
+ * \sa AdvancedMeanSquaresMetric, OpenCLMetricBase
+ * \ingroup Metrics
+ */
+
+template< class TElastix >
+class OpenCLAdvancedMeanSquaresMetric :
+  public OpenCLMetricBase< AdvancedMeanSquaresMetric< TElastix > >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef OpenCLAdvancedMeanSquaresMetric Self;
+  typedef OpenCLMetricBase<
+    AdvancedMeanSquaresMetric< TElastix > > Superclass;
+  typedef typename Superclass::Superclass1 Superclass1;
+  typedef typename Superclass::Superclass2 Superclass2;
+  typedef itk::SmartPointer< Self >        Pointer;
+  typedef itk::SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( OpenCLAdvancedMeanSquaresMetric, OpenCLMetricBase );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "OpenCLAdvancedMeanSquares")</tt>\n
+   */
+  elxClassNameMacro( "OpenCLAdvancedMeanSquares" );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::MeasureType    MeasureType;
+  typedef typename Superclass::DerivativeType DerivativeType;
+  typedef typename Superclass::ParametersType ParametersType;
+
+  /** Compute the value and derivative on the GPU, or, if the GPU is not
+   * used, by the Superclass' implementation. */
+  virtual void GetValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+protected:
+
+  /** The constructor. */
+  OpenCLAdvancedMeanSquaresMetric();
+
+  /** The destructor. */
+  virtual ~OpenCLAdvancedMeanSquaresMetric() {}
+
+  /** Allocate the buffers of the partial sums, and set the kernel arguments
+   * that are fixed during a resolution. */
+  virtual void InitializeGPUMetric( void );
+
+  /** Set the kernel arguments that depend on the samples. */
+  virtual void SetGPUSampleKernelArguments( void ) const;
+
+  typedef typename Superclass::GPUDataManagerPointer GPUDataManagerPointer;
+
+private:
+
+  /** The private constructor. */
+  OpenCLAdvancedMeanSquaresMetric( const Self & ); // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );                  // purposely not implemented
+
+  /** The kernels, in the order of m_KernelHandles. */
+  enum { ValueKernel = 0, DerivativeKernel = 1 };
+
+  /** The sums of the work groups. */
+  GPUDataManagerPointer m_GPUPartialMeasures;
+  GPUDataManagerPointer m_GPUPartialCounts;
+
+  /** Host copies of the sums of the work groups. */
+  mutable std::vector< float >   m_PartialMeasuresBuffer;
+  mutable std::vector< cl_uint > m_PartialCountsBuffer;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxOpenCLAdvancedMeanSquaresMetric.hxx"
+#endif
+
+#endif // end #ifndef __elxOpenCLAdvancedMeanSquaresMetric_h
@@ -0,0 +1,169 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLAdvancedMeanSquaresMetric_hxx
+#define __elxOpenCLAdvancedMeanSquaresMetric_hxx
+
+#include "elxOpenCLAdvancedMeanSquaresMetric.h"
+
+#include "itkGPUAdvancedMeanSquares.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TElastix >
+OpenCLAdvancedMeanSquaresMetric< TElastix >
+::OpenCLAdvancedMeanSquaresMetric()
+{
+  std::vector< std::string > kernelNames;
+  kernelNames.push_back( "AdvancedMeanSquaresValue" );
+  kernelNames.push_back( "ImageToImageMetricLinearDerivative" );
+  this->BuildGPUProgram(
+    itk::GPUAdvancedMeanSquaresKernel::GetOpenCLSource(), kernelNames );
+
+} // end Constructor
+
+
+/**
+ * ******************* InitializeGPUMetric ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedMeanSquaresMetric< TElastix >
+::InitializeGPUMetric( void )
+{
+  const std::size_t numberOfGroups = this->m_NumberOfGroups;
+  this->AllocateGPUBuffer( this->m_GPUPartialMeasures,
+    numberOfGroups * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUPartialCounts,
+    numberOfGroups * sizeof( cl_uint ), CL_MEM_READ_WRITE );
+  this->m_PartialMeasuresBuffer.resize( numberOfGroups );
+  this->m_PartialCountsBuffer.resize( numberOfGroups );
+
+  /** Set the kernel arguments that do not depend on the samples. */
+  const cl_uint   numberOfDerivatives = static_cast< cl_uint >( this->GetNumberOfParameters() );
+  const cl_float4 scales              = this->GetGPUMovingImageDerivativeScales();
+
+  const std::size_t valueKernel = this->m_KernelHandles[ ValueKernel ];
+  this->SetGPUMovingImageKernelArguments( valueKernel, 2 );
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 4, this->m_GPUParameters );
+  this->SetGPUCoefficientImageKernelArguments( valueKernel, 5 );
+  this->m_KernelManager->SetKernelArg( valueKernel, 7, sizeof( cl_float4 ), &scales );
+  this->m_KernelManager->SetKernelArg( valueKernel, 9, this->m_LocalSize * sizeof( cl_float ), NULL );
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 10, this->m_GPUPartialMeasures );
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 11, this->m_GPUPartialCounts );
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 12, this->m_GPUDerivative );
+  this->m_KernelManager->SetKernelArg( valueKernel, 13, sizeof( cl_uint ), &numberOfDerivatives );
+
+  const std::size_t derivativeKernel = this->m_KernelHandles[ DerivativeKernel ];
+  this->SetGPUCoefficientImageKernelArguments( derivativeKernel, 3 );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 6, this->m_GPUDerivative );
+
+} // end InitializeGPUMetric()
+
+
+/**
+ * ******************* SetGPUSampleKernelArguments ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedMeanSquaresMetric< TElastix >
+::SetGPUSampleKernelArguments( void ) const
+{
+  const cl_uint     numberOfGPUSamples = static_cast< cl_uint >( this->m_NumberOfGPUSamples );
+  const std::size_t valueKernel        = this->m_KernelHandles[ ValueKernel ];
+  const std::size_t derivativeKernel   = this->m_KernelHandles[ DerivativeKernel ];
+
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( valueKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( valueKernel, 8, this->m_GPUMovingValuesAndGradients );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( derivativeKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 2, this->m_GPUMovingValuesAndGradients );
+
+} // end SetGPUSampleKernelArguments()
+
+
+/**
+ * ******************* GetValueAndDerivative ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedMeanSquaresMetric< TElastix >
+::GetValueAndDerivative( const ParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  if( !this->m_GPUMetricReady )
+  {
+    this->Superclass1::GetValueAndDerivative( parameters, value, derivative );
+    return;
+  }
+
+  /** Set the transform parameters and update the samples. */
+  this->m_NumberOfPixelsCounted = 0;
+  this->BeforeGPUGetValueAndDerivative( parameters );
+  this->UpdateGPUParameters( parameters );
+
+  /** Sum the squared differences of the work groups on the host. */
+  this->LaunchGPUKernelPerGroup( this->m_KernelHandles[ ValueKernel ] );
+  this->ReadGPUBuffer( this->m_GPUPartialMeasures, &this->m_PartialMeasuresBuffer[ 0 ] );
+  this->ReadGPUBuffer( this->m_GPUPartialCounts, &this->m_PartialCountsBuffer[ 0 ] );
+
+  double measure = 0.0;
+  for( std::size_t g = 0; g < this->m_NumberOfGroups; ++g )
+  {
+    measure += this->m_PartialMeasuresBuffer[ g ];
+    this->m_NumberOfPixelsCounted += this->m_PartialCountsBuffer[ g ];
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples( this->m_NumberOfGPUSamples, this->m_NumberOfPixelsCounted );
+
+  /** Compute the measure value, see GetValueAndDerivativeSingleThreaded(). */
+  double normal_sum = 0.0;
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted );
+  }
+  value = static_cast< MeasureType >( normal_sum * measure );
+
+  /** The derivative is the sum of 2 ( M - F ) dM/dx dT/dmu, normalized. */
+  cl_float4 factors;
+  factors.s[ 0 ] = static_cast< cl_float >( -2.0 * normal_sum );
+  factors.s[ 1 ] = static_cast< cl_float >( 2.0 * normal_sum );
+  factors.s[ 2 ] = 0.0f;
+  factors.s[ 3 ] = 0.0f;
+
+  const std::size_t derivativeKernel = this->m_KernelHandles[ DerivativeKernel ];
+  this->m_KernelManager->SetKernelArg( derivativeKernel, 5, sizeof( cl_float4 ), &factors );
+  this->LaunchGPUKernel( derivativeKernel, this->m_NumberOfGPUSamples );
+  this->ReadGPUDerivative( derivative, 1.0 );
+
+} // end GetValueAndDerivative()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxOpenCLAdvancedMeanSquaresMetric_hxx
@@ -0,0 +1,156 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLAdvancedNormalizedCorrelationMetric_h
+#define __elxOpenCLAdvancedNormalizedCorrelationMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdvancedNormalizedCorrelationMetric.h"
+#include "elxOpenCLMetricBase.h"
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLAdvancedNormalizedCorrelationMetric
+ * \brief The AdvancedNormalizedCorrelation metric, with the value and derivative
+ * computed by OpenCL.
+ *
+ * The sums of the sample values and their products, and the derivative,
+ * are computed on the GPU, as described in OpenCLMetricBase; per iteration
+ * only the sums of the work groups and the derivative are read back. The
+ * sample values are shifted by the means of the previous evaluation, as on
+ * the CPU, which keeps the sums accurate in single precision.
+ *
+ * The GPU computes in single precision, and is used when:
+ * \li the images are 3D,
+ * \li the transform is an AdvancedBSplineDeformableTransform of order 2 or 3,
+ *    without initial transform,
+ * \li the moving image is interpolated linearly, by the LinearInterpolator or
+ *    by a BSplineInterpolator of order 1, and no gradient image is used,
+ * \li no moving mask is used,
+ * \li the number of samples is at least
+ *    OpenCLAdvancedNormalizedCorrelationMinimumNumberOfSamples.
+ *
+ * In other cases, or if the OpenCL context could not be created, the metric
+ * is computed on the CPU, like the AdvancedNormalizedCorrelation. GetValue() is always
+ * computed on the CPU.
+ *
+ * The parameters used in this class are those of the AdvancedNormalizedCorrelation
+ * metric, and:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "OpenCLAdvancedNormalizedCorrelation")</tt>
+ * \parameter OpenCLAdvancedNormalizedCorrelationUseOpenCL: Enable the OpenCL
+ *    computation of the metric. Can be given for each resolution, or for
+ *    all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedNormalizedCorrelationUseOpenCL "true")</tt> \n
+ *    The default value is "true".
+ * \parameter OpenCLAdvancedNormalizedCorrelationMinimumNumberOfSamples: The minimum
+ *    number of samples for which the metric is computed on the GPU. Can be
+ *    given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedNormalizedCorrelationMinimumNumberOfSamples 20000)</tt> \n
+ *    The default value is 10000.
+ * \parameter OpenCLAdvancedNormalizedCorrelationUseOpenCLImageSampler: Generate the samples
+ *    on the GPU as well, when a RandomCoordinate sampler with the
+ *    counter-based random generator is used, see OpenCLMetricBase. \n
+ *    example: <tt>(OpenCLAdvancedNormalizedCorrelationUseOpenCLImageSampler "false")</tt> \n
+ *    The default value is "true".
+ *
+ * \sa AdvancedNormalizedCorrelationMetric, OpenCLMetricBase
+ * \ingroup Metrics
+ */
+
+template< class TElastix >
+class OpenCLAdvancedNormalizedCorrelationMetric :
+  public OpenCLMetricBase< AdvancedNormalizedCorrelationMetric< TElastix > >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef OpenCLAdvancedNormalizedCorrelationMetric Self;
+  typedef OpenCLMetricBase<
+    AdvancedNormalizedCorrelationMetric< TElastix > > Superclass;
+  typedef typename Superclass::Superclass1 Superclass1;
+  typedef typename Superclass::Superclass2 Superclass2;
+  typedef itk::SmartPointer< Self >        Pointer;
+  typedef itk::SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( OpenCLAdvancedNormalizedCorrelationMetric, OpenCLMetricBase );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "OpenCLAdvancedNormalizedCorrelation")</tt>\n
+   */
+  elxClassNameMacro( "OpenCLAdvancedNormalizedCorrelation" );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::MeasureType    MeasureType;
+  typedef typename Superclass::DerivativeType DerivativeType;
+  typedef typename Superclass::ParametersType ParametersType;
+
+  /** Compute the value and derivative on the GPU, or, if the GPU is not
+   * used, by the Superclass' implementation. */
+  virtual void GetValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+protected:
+
+  /** The constructor. */
+  OpenCLAdvancedNormalizedCorrelationMetric();
+
+  /** The destructor. */
+  virtual ~OpenCLAdvancedNormalizedCorrelationMetric() {}
+
+  /** Allocate the buffers of the partial sums, and set the kernel arguments
+   * that are fixed during a resolution. */
+  virtual void InitializeGPUMetric( void );
+
+  /** Set the kernel arguments that depend on the samples. */
+  virtual void SetGPUSampleKernelArguments( void ) const;
+
+  typedef typename Superclass::GPUDataManagerPointer GPUDataManagerPointer;
+
+private:
+
+  /** The private constructor. */
+  OpenCLAdvancedNormalizedCorrelationMetric( const Self & ); // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );                            // purposely not implemented
+
+  /** The kernels, in the order of m_KernelHandles. */
+  enum { SumsKernel = 0, DerivativeKernel = 1 };
+
+  /** The sums of the work groups. */
+  GPUDataManagerPointer m_GPUPartialSums;
+  GPUDataManagerPointer m_GPUPartialCounts;
+
+  /** Host copies of the sums of the work groups. */
+  mutable std::vector< float >   m_PartialSumsBuffer;
+  mutable std::vector< cl_uint > m_PartialCountsBuffer;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxOpenCLAdvancedNormalizedCorrelationMetric.hxx"
+#endif
+
+#endif // end #ifndef __elxOpenCLAdvancedNormalizedCorrelationMetric_h
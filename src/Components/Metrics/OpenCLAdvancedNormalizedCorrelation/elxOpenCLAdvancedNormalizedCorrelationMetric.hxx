@@ -0,0 +1,208 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLAdvancedNormalizedCorrelationMetric_hxx
+#define __elxOpenCLAdvancedNormalizedCorrelationMetric_hxx
+
+#include "elxOpenCLAdvancedNormalizedCorrelationMetric.h"
+
+#include "itkGPUAdvancedNormalizedCorrelation.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TElastix >
+OpenCLAdvancedNormalizedCorrelationMetric< TElastix >
+::OpenCLAdvancedNormalizedCorrelationMetric()
+{
+  std::vector< std::string > kernelNames;
+  kernelNames.push_back( "AdvancedNormalizedCorrelationSums" );
+  kernelNames.push_back( "ImageToImageMetricLinearDerivative" );
+  this->BuildGPUProgram(
+    itk::GPUAdvancedNormalizedCorrelationKernel::GetOpenCLSource(), kernelNames );
+
+} // end Constructor
+
+
+/**
+ * ******************* InitializeGPUMetric ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedNormalizedCorrelationMetric< TElastix >
+::InitializeGPUMetric( void )
+{
+  /** Every work group stores sf, sm, sff, smm and sfm. */
+  const std::size_t numberOfGroups = this->m_NumberOfGroups;
+  this->AllocateGPUBuffer( this->m_GPUPartialSums,
+    5 * numberOfGroups * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUPartialCounts,
+    numberOfGroups * sizeof( cl_uint ), CL_MEM_READ_WRITE );
+  this->m_PartialSumsBuffer.resize( 5 * numberOfGroups );
+  this->m_PartialCountsBuffer.resize( numberOfGroups );
+
+  /** Set the kernel arguments that do not depend on the samples. */
+  const cl_uint   numberOfDerivatives = static_cast< cl_uint >( this->GetNumberOfParameters() );
+  const cl_float4 scales              = this->GetGPUMovingImageDerivativeScales();
+
+  const std::size_t sumsKernel = this->m_KernelHandles[ SumsKernel ];
+  this->SetGPUMovingImageKernelArguments( sumsKernel, 2 );
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 4, this->m_GPUParameters );
+  this->SetGPUCoefficientImageKernelArguments( sumsKernel, 5 );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 7, sizeof( cl_float4 ), &scales );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 9, this->m_LocalSize * sizeof( cl_float ), NULL );
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 10, this->m_GPUPartialSums );
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 11, this->m_GPUPartialCounts );
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 12, this->m_GPUDerivative );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 13, sizeof( cl_uint ), &numberOfDerivatives );
+
+  const std::size_t derivativeKernel = this->m_KernelHandles[ DerivativeKernel ];
+  this->SetGPUCoefficientImageKernelArguments( derivativeKernel, 3 );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 6, this->m_GPUDerivative );
+
+} // end InitializeGPUMetric()
+
+
+/**
+ * ******************* SetGPUSampleKernelArguments ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedNormalizedCorrelationMetric< TElastix >
+::SetGPUSampleKernelArguments( void ) const
+{
+  const cl_uint     numberOfGPUSamples = static_cast< cl_uint >( this->m_NumberOfGPUSamples );
+  const std::size_t sumsKernel         = this->m_KernelHandles[ SumsKernel ];
+  const std::size_t derivativeKernel   = this->m_KernelHandles[ DerivativeKernel ];
+
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( sumsKernel, 8, this->m_GPUMovingValuesAndGradients );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( derivativeKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 2, this->m_GPUMovingValuesAndGradients );
+
+} // end SetGPUSampleKernelArguments()
+
+
+/**
+ * ******************* GetValueAndDerivative ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLAdvancedNormalizedCorrelationMetric< TElastix >
+::GetValueAndDerivative( const ParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  if( !this->m_GPUMetricReady )
+  {
+    this->Superclass1::GetValueAndDerivative( parameters, value, derivative );
+    return;
+  }
+
+  /** The shifts of the sample values, only used when SubtractMean is true. */
+  const double fixedShift  = this->m_SubtractMean ? static_cast< double >( this->m_FixedValueShift ) : 0.0;
+  const double movingShift = this->m_SubtractMean ? static_cast< double >( this->m_MovingValueShift ) : 0.0;
+
+  /** Set the transform parameters and update the samples. */
+  this->m_NumberOfPixelsCounted = 0;
+  this->BeforeGPUGetValueAndDerivative( parameters );
+  this->UpdateGPUParameters( parameters );
+
+  /** Compute the sums of the work groups. */
+  const std::size_t sumsKernel         = this->m_KernelHandles[ SumsKernel ];
+  const cl_float    gpuFixedShift      = static_cast< cl_float >( fixedShift );
+  const cl_float    gpuMovingShift     = static_cast< cl_float >( movingShift );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 14, sizeof( cl_float ), &gpuFixedShift );
+  this->m_KernelManager->SetKernelArg( sumsKernel, 15, sizeof( cl_float ), &gpuMovingShift );
+  this->LaunchGPUKernelPerGroup( sumsKernel );
+  this->ReadGPUBuffer( this->m_GPUPartialSums, &this->m_PartialSumsBuffer[ 0 ] );
+  this->ReadGPUBuffer( this->m_GPUPartialCounts, &this->m_PartialCountsBuffer[ 0 ] );
+
+  /** Sum the work groups on the host. */
+  double sf = 0.0, sm = 0.0, sff = 0.0, smm = 0.0, sfm = 0.0;
+  for( std::size_t g = 0; g < this->m_NumberOfGroups; ++g )
+  {
+    sf  += this->m_PartialSumsBuffer[ 5 * g ];
+    sm  += this->m_PartialSumsBuffer[ 5 * g + 1 ];
+    sff += this->m_PartialSumsBuffer[ 5 * g + 2 ];
+    smm += this->m_PartialSumsBuffer[ 5 * g + 3 ];
+    sfm += this->m_PartialSumsBuffer[ 5 * g + 4 ];
+    this->m_NumberOfPixelsCounted += this->m_PartialCountsBuffer[ g ];
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples( this->m_NumberOfGPUSamples, this->m_NumberOfPixelsCounted );
+
+  /** If SubtractMean, then subtract things from sff, smm and sfm,
+   * see GetValueAndDerivativeSingleThreaded(). */
+  const double N    = static_cast< double >( this->m_NumberOfPixelsCounted );
+  double       sf_N = 0.0;
+  double       sm_N = 0.0;
+  if( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
+  {
+    sf_N = sf / N;
+    sm_N = sm / N;
+    sff -= ( sf * sf_N );
+    smm -= ( sm * sm_N );
+    sfm -= ( sf * sm_N );
+
+    /** Shift the sample values of the next evaluation by the current averages. */
+    this->m_FixedValueShift  = fixedShift + sf_N;
+    this->m_MovingValueShift = movingShift + sm_N;
+  }
+
+  /** The denominator of the value and the derivative. */
+  const double denom = -1.0 * vcl_sqrt( sff * smm );
+  if( this->m_NumberOfPixelsCounted == 0 || denom >= -1e-14 )
+  {
+    value = itk::NumericTraits< MeasureType >::Zero;
+    derivative.SetSize( this->GetNumberOfParameters() );
+    derivative.Fill( itk::NumericTraits< typename DerivativeType::ValueType >::ZeroValue() );
+    return;
+  }
+  value = static_cast< MeasureType >( sfm / denom );
+
+  /** The derivative is the sum of
+   *   ( ( F - meanF ) - sfm / smm * ( M - meanM ) ) / denom * dM/dx dT/dmu,
+   * with meanF and meanM including the shifts. */
+  const double ratio = sfm / smm;
+  cl_float4    factors;
+  factors.s[ 0 ] = static_cast< cl_float >( 1.0 / denom );
+  factors.s[ 1 ] = static_cast< cl_float >( -ratio / denom );
+  factors.s[ 2 ] = static_cast< cl_float >(
+    ( -( fixedShift + sf_N ) + ratio * ( movingShift + sm_N ) ) / denom );
+  factors.s[ 3 ] = 0.0f;
+
+  const std::size_t derivativeKernel = this->m_KernelHandles[ DerivativeKernel ];
+  this->m_KernelManager->SetKernelArg( derivativeKernel, 5, sizeof( cl_float4 ), &factors );
+  this->LaunchGPUKernel( derivativeKernel, this->m_NumberOfGPUSamples );
+  this->ReadGPUDerivative( derivative, 1.0 );
+
+} // end GetValueAndDerivative()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxOpenCLAdvancedNormalizedCorrelationMetric_hxx
@@ -0,0 +1,183 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLMattesMutualInformationMetric_h
+#define __elxOpenCLMattesMutualInformationMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdvancedMattesMutualInformationMetric.h"
+#include "elxOpenCLMetricBase.h"
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLMattesMutualInformationMetric
+ * \brief The AdvancedMattesMutualInformation metric, with the value and
+ * derivative computed by OpenCL.
+ *
+ * The joint histogram and the derivative of the low memory version of the
+ * mutual information (UseFastAndLowMemoryVersion "true") are computed on the
+ * GPU. The moving image, the samples and the transform coefficients stay
+ * resident on the device; per iteration only the transform parameters are
+ * uploaded, and only the joint histogram and the derivative are read back.
+ * The metric value and the ratio array of the joint histogram are computed
+ * on the host, as they only involve the small histogram.
+ *
+ * The GPU computes in single precision, and is used when:
+ * \li the images are 3D,
+ * \li the transform is an AdvancedBSplineDeformableTransform of order 2 or 3,
+ *    without initial transform,
+ * \li the moving image is interpolated linearly, by the LinearInterpolator or
+ *    by a BSplineInterpolator of order 1, and no gradient image is used,
+ * \li no moving mask is used and UseJacobianPreconditioning is "false",
+ * \li the MovingKernelBSplineOrder is 1, 2 or 3,
+ * \li the joint histogram fits in the local memory of the device.
+ *
+ * In other cases, or if the OpenCL context could not be created, the metric
+ * reports so and is computed on the CPU, like the AdvancedMattesMutualInformation.
+ * The same holds for resolutions with less samples than
+ * OpenCLMattesMutualInformationMinimumNumberOfSamples.
+ *
+ * The parameters used in this class are those of the
+ * AdvancedMattesMutualInformation metric, and:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "OpenCLMattesMutualInformation")</tt>
+ * \parameter OpenCLMattesMutualInformationUseOpenCL: Enable the OpenCL
+ *    computation of the metric. Can be given for each resolution, or for
+ *    all resolutions at once. \n
+ *    example: <tt>(OpenCLMattesMutualInformationUseOpenCL "true")</tt> \n
+ *    The default value is "true".
+ * \parameter OpenCLMattesMutualInformationMinimumNumberOfSamples: The
+ *    minimum number of samples for which the metric is computed on the GPU.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLMattesMutualInformationMinimumNumberOfSamples 20000)</tt> \n
+ *    The default value is 10000.
+ * \parameter OpenCLMattesMutualInformationUseOpenCLImageSampler: Generate the samples
+ *    on the GPU as well, when a RandomCoordinate sampler with the
+ *    counter-based random generator is used, see OpenCLMetricBase. \n
+ *    example: <tt>(OpenCLMattesMutualInformationUseOpenCLImageSampler "false")</tt> \n
+ *    The default value is "true".
+ *
+ * \sa AdvancedMattesMutualInformationMetric, OpenCLMetricBase
+ * \ingroup Metrics
+ */
+
+template< class TElastix >
+class OpenCLMattesMutualInformationMetric :
+  public OpenCLMetricBase< AdvancedMattesMutualInformationMetric< TElastix > >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef OpenCLMattesMutualInformationMetric Self;
+  typedef OpenCLMetricBase<
+    AdvancedMattesMutualInformationMetric< TElastix > > Superclass;
+  typedef typename Superclass::Superclass1 Superclass1;
+  typedef typename Superclass::Superclass2 Superclass2;
+  typedef itk::SmartPointer< Self >        Pointer;
+  typedef itk::SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( OpenCLMattesMutualInformationMetric, OpenCLMetricBase );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "OpenCLMattesMutualInformation")</tt>\n
+   */
+  elxClassNameMacro( "OpenCLMattesMutualInformation" );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::MeasureType    MeasureType;
+  typedef typename Superclass::DerivativeType DerivativeType;
+  typedef typename Superclass::ParametersType ParametersType;
+  typedef typename Superclass::RealType       RealType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    Superclass::FixedImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    Superclass::MovingImageDimension );
+
+protected:
+
+  /** The constructor. */
+  OpenCLMattesMutualInformationMetric();
+
+  /** The destructor. */
+  virtual ~OpenCLMattesMutualInformationMetric() {}
+
+  /** Compute the value and low memory derivative on the GPU, or, if the
+   * GPU is not used, by the Superclass' implementation. */
+  virtual void GetValueAndAnalyticDerivativeLowMemory(
+    const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Check the histogram and limiter settings, in addition to the
+   * Superclass' checks. */
+  virtual bool IsGPUSupported( std::string & reason ) const;
+
+  /** Copy the histogram settings to the device, and set the kernel
+   * arguments that are fixed during a resolution. */
+  virtual void InitializeGPUMetric( void );
+
+  /** Set the kernel arguments that depend on the samples. */
+  virtual void SetGPUSampleKernelArguments( void ) const;
+
+  /** The fixed image value is stored limited. */
+  virtual cl_float GetGPUFixedImageValue( const RealType & value ) const;
+
+  /** The bounds of the fixed image limiter, if it is a hard limiter. */
+  virtual bool GetGPUFixedImageValueRange( cl_float2 & range ) const;
+
+  typedef typename Superclass::GPUDataManagerPointer GPUDataManagerPointer;
+
+private:
+
+  /** The private constructor. */
+  OpenCLMattesMutualInformationMetric( const Self & ); // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );                      // purposely not implemented
+
+  /** The kernels, in the order of m_KernelHandles. */
+  enum { JointPDFKernel = 0, ReduceJointPDFKernel = 1, DerivativeKernel = 2 };
+
+  /** Device data that is fixed during a resolution. */
+  GPUDataManagerPointer m_GPUHistogram;
+  GPUDataManagerPointer m_GPUPartialJointPDFs;
+  GPUDataManagerPointer m_GPUPartialCounts;
+  GPUDataManagerPointer m_GPUJointPDF;
+  GPUDataManagerPointer m_GPUNumberOfPixelsCounted;
+  GPUDataManagerPointer m_GPUPRatio;
+
+  /** Host copies of the device data that is exchanged every iteration. */
+  mutable std::vector< float > m_JointPDFBuffer;
+  mutable std::vector< float > m_PRatioBuffer;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxOpenCLMattesMutualInformationMetric.hxx"
+#endif
+
+#endif // end #ifndef __elxOpenCLMattesMutualInformationMetric_h
@@ -0,0 +1,382 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLMattesMutualInformationMetric_hxx
+#define __elxOpenCLMattesMutualInformationMetric_hxx
+
+#include "elxOpenCLMattesMutualInformationMetric.h"
+
+#include "itkExponentialLimiterFunction.h"
+#include "itkHardLimiterFunction.h"
+#include "itkGPUParzenWindowMutualInformation.h"
+
+// begin of unnamed namespace
+namespace
+{
+typedef struct
+{
+  cl_float fixed_image_bin_size;
+  cl_float fixed_image_normalized_min;
+  cl_float fixed_parzen_term_to_index_offset;
+  cl_float moving_image_bin_size;
+  cl_float moving_image_normalized_min;
+  cl_float moving_parzen_term_to_index_offset;
+  cl_float moving_limiter_upper_threshold;
+  cl_float moving_limiter_upper_bound;
+  cl_float moving_limiter_ut_min_ub;
+  cl_float moving_limiter_ut_min_ub_inv;
+  cl_float moving_limiter_lower_threshold;
+  cl_float moving_limiter_lower_bound;
+  cl_float moving_limiter_lt_min_lb;
+  cl_float moving_limiter_lt_min_lb_inv;
+  cl_float moving_image_derivative_scales[ 3 ];
+  cl_uint  number_of_fixed_histogram_bins;
+  cl_uint  number_of_moving_histogram_bins;
+  cl_uint  fixed_kernel_bspline_order;
+  cl_uint  moving_kernel_bspline_order;
+} GPUParzenWindowHistogram;
+} // end of unnamed namespace
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TElastix >
+OpenCLMattesMutualInformationMetric< TElastix >
+::OpenCLMattesMutualInformationMetric()
+{
+  std::vector< std::string > kernelNames;
+  kernelNames.push_back( "ParzenWindowMutualInformationJointPDF" );
+  kernelNames.push_back( "ParzenWindowMutualInformationReduceJointPDF" );
+  kernelNames.push_back( "ParzenWindowMutualInformationDerivative" );
+  this->BuildGPUProgram(
+    itk::GPUParzenWindowMutualInformationKernel::GetOpenCLSource(), kernelNames );
+
+} // end Constructor
+
+
+/**
+ * ******************* IsGPUSupported ***********************
+ */
+
+template< class TElastix >
+bool
+OpenCLMattesMutualInformationMetric< TElastix >
+::IsGPUSupported( std::string & reason ) const
+{
+  if( !this->Superclass::IsGPUSupported( reason ) )
+  {
+    return false;
+  }
+
+  if( this->GetUseExplicitPDFDerivatives() || this->GetUseFiniteDifferenceDerivative() )
+  {
+    reason = "Only UseFastAndLowMemoryVersion \"true\" is supported.";
+    return false;
+  }
+
+  if( this->GetUseJacobianPreconditioning() )
+  {
+    reason = "UseJacobianPreconditioning is not supported.";
+    return false;
+  }
+
+  if( this->GetFixedKernelBSplineOrder() > 3
+    || this->GetMovingKernelBSplineOrder() < 1 || this->GetMovingKernelBSplineOrder() > 3 )
+  {
+    reason = "Only a MovingKernelBSplineOrder of 1, 2 or 3 is supported.";
+    return false;
+  }
+
+  typedef itk::ExponentialLimiterFunction< RealType, MovingImageDimension > MovingLimiterType;
+  if( dynamic_cast< const MovingLimiterType * >( this->GetMovingImageLimiter() ) == NULL )
+  {
+    reason = "Only the exponential moving image limiter is supported.";
+    return false;
+  }
+
+  /** The joint histogram of each work group is accumulated in local memory. */
+  const itk::OpenCLDevice device = this->m_KernelManager->GetContext()->GetDefaultDevice();
+  const std::size_t       jointPDFSize = this->m_PRatioArray.rows() * this->m_PRatioArray.cols() * sizeof( cl_float );
+  if( jointPDFSize + sizeof( cl_uint ) > device.GetLocalMemorySize() )
+  {
+    reason = "The joint histogram does not fit in the local memory of the device.";
+    return false;
+  }
+
+  return true;
+
+} // end IsGPUSupported()
+
+
+/**
+ * ******************* InitializeGPUMetric ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLMattesMutualInformationMetric< TElastix >
+::InitializeGPUMetric( void )
+{
+  const std::size_t numberOfFixedBins  = this->m_PRatioArray.rows();
+  const std::size_t numberOfMovingBins = this->m_PRatioArray.cols();
+  const std::size_t numberOfBins       = numberOfFixedBins * numberOfMovingBins;
+  const std::size_t numberOfParameters = this->GetNumberOfParameters();
+
+  /** Copy the histogram settings to the device. */
+  typedef itk::ExponentialLimiterFunction< RealType, MovingImageDimension > MovingLimiterType;
+  const MovingLimiterType * movingLimiter
+    = dynamic_cast< const MovingLimiterType * >( this->GetMovingImageLimiter() );
+
+  GPUParzenWindowHistogram histogram;
+  histogram.fixed_image_bin_size              = static_cast< cl_float >( this->m_FixedImageBinSize );
+  histogram.fixed_image_normalized_min        = static_cast< cl_float >( this->m_FixedImageNormalizedMin );
+  histogram.fixed_parzen_term_to_index_offset = static_cast< cl_float >( this->m_FixedParzenTermToIndexOffset );
+  histogram.moving_image_bin_size             = static_cast< cl_float >( this->m_MovingImageBinSize );
+  histogram.moving_image_normalized_min       = static_cast< cl_float >( this->m_MovingImageNormalizedMin );
+  histogram.moving_parzen_term_to_index_offset
+    = static_cast< cl_float >( this->m_MovingParzenTermToIndexOffset );
+
+  /** The same settings as ExponentialLimiterFunction::ComputeLimiterSettings(). */
+  const double upperThreshold = static_cast< double >( movingLimiter->GetUpperThreshold() );
+  const double upperBound     = static_cast< double >( movingLimiter->GetUpperBound() );
+  const double lowerThreshold = static_cast< double >( movingLimiter->GetLowerThreshold() );
+  const double lowerBound     = static_cast< double >( movingLimiter->GetLowerBound() );
+  double       UTminUB        = upperThreshold - upperBound;
+  double       UTminUBinv     = 0.0;
+  double       LTminLB        = lowerThreshold - lowerBound;
+  double       LTminLBinv     = 0.0;
+  if( UTminUB < -1e-10 ) { UTminUBinv = 1.0 / UTminUB; }
+  else { UTminUB = 0.0; }
+  if( LTminLB > 1e-10 ) { LTminLBinv = 1.0 / LTminLB; }
+  else { LTminLB = 0.0; }
+
+  histogram.moving_limiter_upper_threshold = static_cast< cl_float >( upperThreshold );
+  histogram.moving_limiter_upper_bound     = static_cast< cl_float >( upperBound );
+  histogram.moving_limiter_ut_min_ub       = static_cast< cl_float >( UTminUB );
+  histogram.moving_limiter_ut_min_ub_inv   = static_cast< cl_float >( UTminUBinv );
+  histogram.moving_limiter_lower_threshold = static_cast< cl_float >( lowerThreshold );
+  histogram.moving_limiter_lower_bound     = static_cast< cl_float >( lowerBound );
+  histogram.moving_limiter_lt_min_lb       = static_cast< cl_float >( LTminLB );
+  histogram.moving_limiter_lt_min_lb_inv   = static_cast< cl_float >( LTminLBinv );
+
+  const cl_float4 scales = this->GetGPUMovingImageDerivativeScales();
+  for( unsigned int i = 0; i < 3; ++i )
+  {
+    histogram.moving_image_derivative_scales[ i ] = scales.s[ i ];
+  }
+
+  histogram.number_of_fixed_histogram_bins  = static_cast< cl_uint >( numberOfFixedBins );
+  histogram.number_of_moving_histogram_bins = static_cast< cl_uint >( numberOfMovingBins );
+  histogram.fixed_kernel_bspline_order      = this->GetFixedKernelBSplineOrder();
+  histogram.moving_kernel_bspline_order     = this->GetMovingKernelBSplineOrder();
+
+  this->AllocateGPUBuffer( this->m_GPUHistogram, sizeof( GPUParzenWindowHistogram ), CL_MEM_READ_ONLY );
+  this->WriteGPUBuffer( this->m_GPUHistogram, &histogram );
+
+  /** Allocate the buffers that are exchanged every iteration. */
+  this->AllocateGPUBuffer( this->m_GPUPartialJointPDFs,
+    this->m_NumberOfGroups * numberOfBins * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUPartialCounts,
+    this->m_NumberOfGroups * sizeof( cl_uint ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUJointPDF,
+    numberOfBins * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUNumberOfPixelsCounted,
+    sizeof( cl_uint ), CL_MEM_READ_WRITE );
+  this->AllocateGPUBuffer( this->m_GPUPRatio,
+    numberOfBins * sizeof( cl_float ), CL_MEM_READ_ONLY );
+
+  this->m_JointPDFBuffer.resize( numberOfBins );
+  this->m_PRatioBuffer.resize( numberOfBins );
+
+  /** Set the kernel arguments that do not depend on the samples. */
+  const cl_uint numberOfGroups = static_cast< cl_uint >( this->m_NumberOfGroups );
+  const cl_uint numberOfJointPDFBins = static_cast< cl_uint >( numberOfBins );
+  const cl_uint numberOfDerivatives = static_cast< cl_uint >( numberOfParameters );
+
+  const std::size_t jointPDFKernel = this->m_KernelHandles[ JointPDFKernel ];
+  this->SetGPUMovingImageKernelArguments( jointPDFKernel, 2 );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 4, this->m_GPUParameters );
+  this->SetGPUCoefficientImageKernelArguments( jointPDFKernel, 5 );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 7, this->m_GPUHistogram );
+  this->m_KernelManager->SetKernelArg( jointPDFKernel, 9, numberOfBins * sizeof( cl_float ), NULL );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 10, this->m_GPUPartialJointPDFs );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 11, this->m_GPUPartialCounts );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 12, this->m_GPUDerivative );
+  this->m_KernelManager->SetKernelArg( jointPDFKernel, 13, sizeof( cl_uint ), &numberOfDerivatives );
+
+  const std::size_t reduceKernel = this->m_KernelHandles[ ReduceJointPDFKernel ];
+  this->m_KernelManager->SetKernelArgWithImage( reduceKernel, 0, this->m_GPUPartialJointPDFs );
+  this->m_KernelManager->SetKernelArgWithImage( reduceKernel, 1, this->m_GPUPartialCounts );
+  this->m_KernelManager->SetKernelArg( reduceKernel, 2, sizeof( cl_uint ), &numberOfGroups );
+  this->m_KernelManager->SetKernelArg( reduceKernel, 3, sizeof( cl_uint ), &numberOfJointPDFBins );
+  this->m_KernelManager->SetKernelArgWithImage( reduceKernel, 4, this->m_GPUJointPDF );
+  this->m_KernelManager->SetKernelArgWithImage( reduceKernel, 5, this->m_GPUNumberOfPixelsCounted );
+
+  const std::size_t derivativeKernel = this->m_KernelHandles[ DerivativeKernel ];
+  this->SetGPUCoefficientImageKernelArguments( derivativeKernel, 3 );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 5, this->m_GPUHistogram );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 6, this->m_GPUPRatio );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 7, this->m_GPUDerivative );
+
+} // end InitializeGPUMetric()
+
+
+/**
+ * ******************* SetGPUSampleKernelArguments ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLMattesMutualInformationMetric< TElastix >
+::SetGPUSampleKernelArguments( void ) const
+{
+  const cl_uint     numberOfGPUSamples = static_cast< cl_uint >( this->m_NumberOfGPUSamples );
+  const std::size_t jointPDFKernel     = this->m_KernelHandles[ JointPDFKernel ];
+  const std::size_t derivativeKernel   = this->m_KernelHandles[ DerivativeKernel ];
+
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( jointPDFKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( jointPDFKernel, 8, this->m_GPUMovingValuesAndGradients );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( derivativeKernel, 1, sizeof( cl_uint ), &numberOfGPUSamples );
+  this->m_KernelManager->SetKernelArgWithImage( derivativeKernel, 2, this->m_GPUMovingValuesAndGradients );
+
+} // end SetGPUSampleKernelArguments()
+
+
+/**
+ * ******************* GetGPUFixedImageValue ***********************
+ */
+
+template< class TElastix >
+cl_float
+OpenCLMattesMutualInformationMetric< TElastix >
+::GetGPUFixedImageValue( const RealType & value ) const
+{
+  return static_cast< cl_float >( this->GetFixedImageLimiter()->Evaluate( value ) );
+
+} // end GetGPUFixedImageValue()
+
+
+/**
+ * ******************* GetGPUFixedImageValueRange ***********************
+ */
+
+template< class TElastix >
+bool
+OpenCLMattesMutualInformationMetric< TElastix >
+::GetGPUFixedImageValueRange( cl_float2 & range ) const
+{
+  typedef itk::HardLimiterFunction< RealType, FixedImageDimension > FixedLimiterType;
+  const FixedLimiterType * fixedLimiter
+    = dynamic_cast< const FixedLimiterType * >( this->GetFixedImageLimiter() );
+  if( fixedLimiter == NULL )
+  {
+    return false;
+  }
+
+  range.s[ 0 ] = static_cast< cl_float >( fixedLimiter->GetLowerBound() );
+  range.s[ 1 ] = static_cast< cl_float >( fixedLimiter->GetUpperBound() );
+  return true;
+
+} // end GetGPUFixedImageValueRange()
+
+
+/**
+ * ******************* GetValueAndAnalyticDerivativeLowMemory ***********************
+ */
+
+template< class TElastix >
+void
+OpenCLMattesMutualInformationMetric< TElastix >
+::GetValueAndAnalyticDerivativeLowMemory(
+  const ParametersType & parameters,
+  MeasureType & value,
+  DerivativeType & derivative ) const
+{
+  if( !this->m_GPUMetricReady )
+  {
+    this->Superclass1::GetValueAndAnalyticDerivativeLowMemory( parameters, value, derivative );
+    return;
+  }
+
+  /** Set the transform parameters and update the samples, see ComputePDFs(). */
+  this->m_NumberOfPixelsCounted = 0;
+  this->m_Alpha                 = 0.0;
+  this->BeforeGPUGetValueAndDerivative( parameters );
+
+  /** Copy the B-spline coefficients to the device. */
+  this->UpdateGPUParameters( parameters );
+
+  /** Compute the joint histogram. */
+  const std::size_t numberOfBins = this->m_JointPDFBuffer.size();
+  this->LaunchGPUKernelPerGroup( this->m_KernelHandles[ JointPDFKernel ] );
+  this->LaunchGPUKernel( this->m_KernelHandles[ ReduceJointPDFKernel ], numberOfBins );
+
+  /** Copy the joint histogram and the number of valid samples to the host. */
+  cl_uint numberOfPixelsCounted = 0;
+  this->ReadGPUBuffer( this->m_GPUNumberOfPixelsCounted, &numberOfPixelsCounted );
+  this->ReadGPUBuffer( this->m_GPUJointPDF, &this->m_JointPDFBuffer[ 0 ] );
+
+  typedef typename Superclass1::PDFValueType PDFValueType;
+  PDFValueType * jointPDF = this->m_JointPDF->GetBufferPointer();
+  for( std::size_t i = 0; i < numberOfBins; ++i )
+  {
+    jointPDF[ i ] = static_cast< PDFValueType >( this->m_JointPDFBuffer[ i ] );
+  }
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+  /** Check if enough samples were valid, and compute alpha. */
+  this->CheckNumberOfSamples( this->m_NumberOfGPUSamples, this->m_NumberOfPixelsCounted );
+  this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
+
+  /** The value and the ratio array only involve the joint histogram,
+   * see Superclass1::GetValueAndAnalyticDerivativeLowMemory(). */
+  this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
+  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
+
+  double MI = 0.0;
+  this->ComputeValueAndPRatioArray( MI );
+  value = static_cast< MeasureType >( -1.0 * MI );
+
+  /** Copy the ratio array to the device and compute the derivative. */
+  const std::size_t numberOfFixedBins  = this->m_PRatioArray.rows();
+  const std::size_t numberOfMovingBins = this->m_PRatioArray.cols();
+  for( std::size_t f = 0; f < numberOfFixedBins; ++f )
+  {
+    for( std::size_t m = 0; m < numberOfMovingBins; ++m )
+    {
+      this->m_PRatioBuffer[ f * numberOfMovingBins + m ]
+        = static_cast< float >( this->m_PRatioArray[ f ][ m ] );
+    }
+  }
+  this->WriteGPUBuffer( this->m_GPUPRatio, &this->m_PRatioBuffer[ 0 ] );
+
+  this->LaunchGPUKernel( this->m_KernelHandles[ DerivativeKernel ], this->m_NumberOfGPUSamples );
+  this->ReadGPUDerivative( derivative, 1.0 );
+
+} // end GetValueAndAnalyticDerivativeLowMemory()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxOpenCLMattesMutualInformationMetric_hxx
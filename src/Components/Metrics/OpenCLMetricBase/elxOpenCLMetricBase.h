@@ -0,0 +1,345 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLMetricBase_h
+#define __elxOpenCLMetricBase_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+
+#include "itkGPUImage.h"
+#include "itkGPUDataManager.h"
+#include "itkOpenCLKernelManager.h"
+#include "itkResidentParametersCostFunction.h"
+
+#include <cfloat>
+#include <string>
+#include <vector>
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLMetricBase
+ * \brief Base class of the metrics that compute their value and derivative
+ * by OpenCL.
+ *
+ * OpenCLMetricBase derives from the CPU metric given by TSuperclass, for
+ * example the AdvancedMeanSquaresMetric, and implements what the GPU
+ * metrics share: building the OpenCL program, checking the configuration,
+ * and keeping the moving image, the B-spline grid and the samples resident
+ * on the device. Per iteration only the transform parameters are uploaded
+ * and the derivative is read back. The kernels map the samples by a
+ * B-spline transform of order 2 or 3 and interpolate the moving image
+ * linearly, see GPUImageToImageMetric.cl.
+ *
+ * The GPU is used per resolution, when the configuration is supported and
+ * the number of samples is at least OpenCL<Metric>MinimumNumberOfSamples:
+ * for small sample sets the kernel launches and transfers cost more than
+ * the CPU computation. Otherwise the metric reports why, and is computed
+ * on the CPU by TSuperclass.
+ *
+ * The subclasses create their kernels by BuildGPUProgram() in their
+ * constructor, allocate their own buffers in InitializeGPUMetric(), and
+ * set the kernel arguments that depend on the samples in
+ * SetGPUSampleKernelArguments().
+ *
+ * The metric implements the itk::ResidentParametersCostFunction interface,
+ * so that a gradient descent optimizer can keep the transform parameters
+ * and the derivative on the device. The step on the parameters is then
+ * taken by the kernel ImageToImageMetricAdvanceParameters, and per
+ * iteration only the value and two inner products are read back.
+ *
+ * With a RandomCoordinate sampler that uses the counter-based random
+ * generator, the samples of every new sample set are generated on the
+ * device as well, by the kernel ImageToImageMetricGenerateRandomCoordinateSamples.
+ * It draws the same candidates as the sampler, tests them against a
+ * bit-packed copy of the fixed mask, and interpolates the fixed image
+ * linearly, so that the sample buffer never crosses the bus. This requires
+ * a FixedImageBSplineInterpolationOrder of 1, no random sample region, no
+ * stratification and no Morton order, and at most one fixed mask. Otherwise
+ * the samples are generated by the sampler, and copied to the device.
+ *
+ * The parameters used in this class are:
+ * \parameter OpenCL<Metric>UseOpenCL: Enable the OpenCL computation of the
+ *    metric, where <Metric> is the name of the metric. Can be given for each
+ *    resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresUseOpenCL "true")</tt> \n
+ *    The default value is "true".
+ * \parameter OpenCL<Metric>MinimumNumberOfSamples: The minimum number of
+ *    samples for which the metric is computed on the GPU. Can be given for
+ *    each resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresMinimumNumberOfSamples 20000)</tt> \n
+ *    The default value is 10000.
+ * \parameter OpenCL<Metric>UseOpenCLImageSampler: Generate the random
+ *    coordinate samples on the device, when the sampler supports it. Can be
+ *    given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(OpenCLAdvancedMeanSquaresUseOpenCLImageSampler "false")</tt> \n
+ *    The default value is "true".
+ *
+ * \ingroup Metrics
+ */
+
+template< class TSuperclass >
+class OpenCLMetricBase :
+  public TSuperclass,
+  public itk::ResidentParametersCostFunction
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef OpenCLMetricBase                 Self;
+  typedef TSuperclass                      Superclass;
+  typedef typename Superclass::Superclass1 Superclass1;
+  typedef typename Superclass::Superclass2 Superclass2;
+  typedef itk::SmartPointer< Self >        Pointer;
+  typedef itk::SmartPointer< const Self >  ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( OpenCLMetricBase, TSuperclass );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::MovingImageType             MovingImageType;
+  typedef typename Superclass::MovingImagePixelType        MovingImagePixelType;
+  typedef typename Superclass::FixedImageType              FixedImageType;
+  typedef typename Superclass::MeasureType                 MeasureType;
+  typedef typename Superclass::DerivativeType              DerivativeType;
+  typedef typename Superclass::ParametersType              ParametersType;
+  typedef typename Superclass::RealType                    RealType;
+  typedef typename Superclass::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Read OpenCL<Metric>UseOpenCL, OpenCL<Metric>MinimumNumberOfSamples and
+   * OpenCL<Metric>UseOpenCLImageSampler, and call the Superclass' implementation. */
+  virtual void BeforeEachResolution( void );
+
+  /** Call the Superclass' implementation, then decide whether the GPU is
+   * used in this resolution, and copy the moving image and the B-spline
+   * grid to the device. */
+  virtual void Initialize( void ) throw ( itk::ExceptionObject );
+
+  /** The ResidentParametersCostFunction interface. The parameters can be
+   * kept resident when the metric is computed on the GPU. */
+  virtual bool CanKeepParametersResident( void ) const;
+
+  virtual void SetResidentParameters( const ParametersType & parameters );
+
+  virtual void GetValueAndResidentDerivative( MeasureType & value );
+
+  virtual void AdvanceResidentParameters( const double stepSize,
+    double & squaredMagnitude, double & innerProductWithPrevious );
+
+  virtual void GetResidentParameters( ParametersType & parameters ) const;
+
+protected:
+
+  /** The constructor. */
+  OpenCLMetricBase();
+
+  /** The destructor. */
+  virtual ~OpenCLMetricBase() {}
+
+  /** GPU typedefs. */
+  typedef itk::GPUImage< float, MovingImageDimension > GPUImageType;
+  typedef typename GPUImageType::Pointer               GPUImagePointer;
+  typedef itk::GPUDataManager::Pointer                 GPUDataManagerPointer;
+
+  /** Build the program from the given metric source, preceded by the sources
+   * of GPUMath, GPUImageBase, GPUBSplineTransform and GPUImageToImageMetric,
+   * and create the given kernels, in m_KernelHandles. To be called by the
+   * constructor of the subclasses. */
+  void BuildGPUProgram( const std::string & source,
+    const std::vector< std::string > & kernelNames );
+
+  /** Check whether the current configuration can be computed on the GPU.
+   * Returns false and sets reason otherwise. Subclasses may add their own
+   * checks, after calling this implementation. */
+  virtual bool IsGPUSupported( std::string & reason ) const;
+
+  /** Allocate the buffers of the subclass and set its kernel arguments that
+   * are fixed during a resolution. Called after the moving image, the
+   * B-spline grid and the parameter and derivative buffers are allocated. */
+  virtual void InitializeGPUMetric( void ) = 0;
+
+  /** Set the kernel arguments that depend on the samples. Called when new
+   * samples are copied to the device. */
+  virtual void SetGPUSampleKernelArguments( void ) const = 0;
+
+  /** The fixed image value stored with a sample. Returns the value itself
+   * by default. */
+  virtual cl_float GetGPUFixedImageValue( const RealType & value ) const
+  {
+    return static_cast< cl_float >( value );
+  }
+
+  /** The range of GetGPUFixedImageValue(), to which the fixed image values
+   * of the samples generated on the device are clamped. Returns false if
+   * GetGPUFixedImageValue() is not such a clamp. Unbounded by default. */
+  virtual bool GetGPUFixedImageValueRange( cl_float2 & range ) const
+  {
+    range.s[ 0 ] = -FLT_MAX;
+    range.s[ 1 ] = FLT_MAX;
+    return true;
+  }
+
+  /** Check whether the samples can be generated on the device. Returns false
+   * and sets reason otherwise. */
+  virtual bool IsGPUSamplerSupported( std::string & reason ) const;
+
+  /** Copy the samples to the device, if they changed. */
+  void UpdateGPUSamples( void ) const;
+
+  /** Generate the samples of the next update of the sampler on the device. */
+  void GenerateGPUSamples( void ) const;
+
+  /** Set the transform parameters and make sure the samples on the device
+   * are up-to-date: generated on the device when the sampler is modified,
+   * or otherwise updated by the sampler and copied to the device. Replaces
+   * BeforeThreadedGetValueAndDerivative() in the GPU metrics. */
+  void BeforeGPUGetValueAndDerivative( const ParametersType & parameters ) const;
+
+  /** Copy the transform parameters to the device. Does nothing while the
+   * parameters are resident. */
+  void UpdateGPUParameters( const ParametersType & parameters ) const;
+
+  /** Copy the derivative to the host, multiplied by scale. While the
+   * parameters are resident, only the scale is stored for the next step. */
+  void ReadGPUDerivative( DerivativeType & derivative, const double scale ) const;
+
+  /** Set the moving image and its geometry as the kernel arguments argIdx
+   * and argIdx + 1. */
+  void SetGPUMovingImageKernelArguments( const std::size_t kernelHandle, cl_uint argIdx );
+
+  /** Set the geometry of the B-spline grid and the spline order as the
+   * kernel arguments argIdx and argIdx + 1. */
+  void SetGPUCoefficientImageKernelArguments( const std::size_t kernelHandle, cl_uint argIdx );
+
+  /** The moving image derivative scales, or ones if they are not used. */
+  cl_float4 GetGPUMovingImageDerivativeScales( void ) const;
+
+  /** Launch a kernel that loops over the samples with m_NumberOfGroups work
+   * groups of m_LocalSize work items. */
+  void LaunchGPUKernelPerGroup( const std::size_t kernelHandle ) const;
+
+  /** Launch a kernel with at least numberOfWorkItems work items. */
+  void LaunchGPUKernel( const std::size_t kernelHandle,
+    const std::size_t numberOfWorkItems ) const;
+
+  /** Allocate a device buffer of the given size. */
+  static void AllocateGPUBuffer( GPUDataManagerPointer & buffer,
+    const std::size_t size, const cl_mem_flags flags );
+
+  /** Copy a device buffer to cpuBuffer, or cpuBuffer to a device buffer. */
+  static void ReadGPUBuffer( const GPUDataManagerPointer & buffer, void * cpuBuffer );
+  static void WriteGPUBuffer( const GPUDataManagerPointer & buffer, void * cpuBuffer );
+
+  /** Helper method to report switching to CPU mode. */
+  void SwitchingToCPUAndReport( const std::string & reason ) const;
+
+  /** Helper method to report to elastix log. */
+  void ReportToLog( void ) const;
+
+  itk::OpenCLKernelManager::Pointer m_KernelManager;
+  std::vector< std::size_t >        m_KernelHandles;
+
+  /** Device data that is fixed during a resolution. */
+  GPUImagePointer                      m_GPUMovingImage;
+  GPUImagePointer                      m_GPUCoefficientImage;
+  std::vector< GPUDataManagerPointer > m_GPUImageBases;
+  GPUDataManagerPointer                m_GPUParameters;
+  GPUDataManagerPointer                m_GPUDerivative;
+  GPUDataManagerPointer                m_GPUPreviousDerivative;
+  GPUDataManagerPointer                m_GPUPartialInnerProducts;
+
+  /** Device data that changes with the samples. */
+  mutable GPUDataManagerPointer            m_GPUSamples;
+  mutable GPUDataManagerPointer            m_GPUMovingValuesAndGradients;
+  mutable std::size_t                      m_GPUSamplesCapacity;
+  mutable std::size_t                      m_NumberOfGPUSamples;
+  mutable const ImageSampleContainerType * m_GPUSampleContainer;
+  mutable unsigned long                    m_GPUSampleContainerMTime;
+
+  /** Device data of the sample generation, fixed during a resolution. */
+  GPUImagePointer                m_GPUFixedImage;
+  GPUDataManagerPointer          m_GPUFixedMask;
+  GPUDataManagerPointer          m_GPUSamplerStatistics;
+  std::size_t                    m_GenerateSamplesKernelHandle;
+  mutable unsigned long          m_GPUSamplerMTime;
+  mutable std::vector< cl_uint > m_SamplerStatisticsBuffer;
+
+  /** Host copies of the device data that is exchanged every iteration. */
+  mutable std::vector< float >     m_ParametersBuffer;
+  mutable std::vector< float >     m_DerivativeBuffer;
+  mutable std::vector< cl_float4 > m_SamplesBuffer;
+  std::vector< float >             m_PartialInnerProductsBuffer;
+
+  /** The state of the resident parameters. The transform refers to the
+   * host copy of the initial parameters during the resident evaluations. */
+  ParametersType m_ResidentParameters;
+  DerivativeType m_ResidentDerivative;
+  mutable bool   m_GPUParametersResident;
+  mutable bool   m_ResidentDerivativeComputed;
+  mutable double m_ResidentDerivativeScale;
+  std::size_t    m_AdvanceParametersKernelHandle;
+
+  unsigned int m_SplineOrder;
+  std::size_t  m_LocalSize;
+  std::size_t  m_NumberOfGroups;
+
+  bool          m_ContextCreated;
+  bool          m_GPUMetricCreated;
+  bool          m_UseOpenCL;
+  unsigned long m_MinimumNumberOfSamples;
+  mutable bool  m_GPUMetricReady;
+  bool          m_UseOpenCLImageSampler;
+  bool          m_GPUSamplerReady;
+
+private:
+
+  /** The private constructor. */
+  OpenCLMetricBase( const Self & ); // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self & );   // purposely not implemented
+
+  /** Copy the moving image and the B-spline grid to the device, and
+   * allocate the parameter and derivative buffers. */
+  void InitializeGPU( void );
+
+  /** Copy the fixed image and the fixed mask to the device, and set the
+   * arguments of the sample generation kernel that are fixed during a
+   * resolution. */
+  void InitializeGPUSampler( void );
+
+  /** Grow the sample buffers on the device to at least numberOfSamples. */
+  void ReserveGPUSamples( const std::size_t numberOfSamples ) const;
+
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxOpenCLMetricBase.hxx"
+#endif
+
+#endif // end #ifndef __elxOpenCLMetricBase_h
@@ -0,0 +1,1211 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxOpenCLMetricBase_hxx
+#define __elxOpenCLMetricBase_hxx
+
+#include "elxOpenCLMetricBase.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkGPUKernelManagerHelperFunctions.h"
+#include "itkGPUMath.h"
+#include "itkGPUImageBase.h"
+#include "itkGPUBSplineBaseTransform.h"
+#include "itkGPUImageToImageMetric.h"
+#include "itkOpenCLLogger.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkLinearInterpolateImageFunction.h"
+
+#include <algorithm>
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template< class TSuperclass >
+OpenCLMetricBase< TSuperclass >
+::OpenCLMetricBase()
+{
+  this->m_GPUSamplesCapacity      = 0;
+  this->m_NumberOfGPUSamples      = 0;
+  this->m_GPUSampleContainer      = NULL;
+  this->m_GPUSampleContainerMTime = 0;
+  this->m_SplineOrder             = 3;
+  this->m_LocalSize               = 1;
+  this->m_NumberOfGroups          = 1;
+  this->m_GPUMetricCreated        = false;
+  this->m_GPUMetricReady          = false;
+  this->m_UseOpenCL               = true;
+  this->m_MinimumNumberOfSamples  = 10000;
+
+  this->m_UseOpenCLImageSampler       = true;
+  this->m_GPUSamplerReady             = false;
+  this->m_GenerateSamplesKernelHandle = 0;
+  this->m_GPUSamplerMTime             = 0;
+
+  this->m_GPUParametersResident         = false;
+  this->m_ResidentDerivativeComputed    = false;
+  this->m_ResidentDerivativeScale       = 1.0;
+  this->m_AdvanceParametersKernelHandle = 0;
+
+  // Check if the OpenCL context has been created.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  this->m_ContextCreated = context->IsCreated();
+
+} // end Constructor
+
+
+/**
+ * ******************* BuildGPUProgram ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::BuildGPUProgram( const std::string & metricSource,
+  const std::vector< std::string > & kernelNames )
+{
+  // The kernels are only implemented for 3D
+  if( !this->m_ContextCreated || MovingImageDimension != 3 )
+  {
+    return;
+  }
+
+  try
+  {
+    this->m_KernelManager = itk::OpenCLKernelManager::New();
+
+    std::ostringstream defines;
+    defines << "#define DIM_3\n";
+    defines << "#define INPIXELTYPE float\n";
+
+    // Defines source code for GPUMath, GPUImageBase, GPUBSplineTransform,
+    // GPUImageToImageMetric and the metric
+    std::ostringstream source;
+    source << itk::GPUMathKernel::GetOpenCLSource() << std::endl;
+    source << itk::GPUImageBaseKernel::GetOpenCLSource() << std::endl;
+    source << itk::GPUBSplineTransformKernel::GetOpenCLSource() << std::endl;
+    source << itk::GPUImageToImageMetricKernel::GetOpenCLSource() << std::endl;
+    source << metricSource << std::endl;
+
+    // Build and create kernels
+    const itk::OpenCLProgram program
+      = this->m_KernelManager->BuildProgramFromSourceCode( source.str(), defines.str() );
+    if( program.IsNull() )
+    {
+      itkExceptionMacro( << "Kernel has not been loaded from string:\n"
+                         << defines.str() << std::endl << source.str() );
+    }
+
+    this->m_KernelHandles.clear();
+    for( std::size_t i = 0; i < kernelNames.size(); ++i )
+    {
+      this->m_KernelHandles.push_back(
+        this->m_KernelManager->CreateKernel( program, kernelNames[ i ] ) );
+    }
+    this->m_AdvanceParametersKernelHandle = this->m_KernelManager->CreateKernel(
+      program, "ImageToImageMetricAdvanceParameters" );
+    this->m_GenerateSamplesKernelHandle = this->m_KernelManager->CreateKernel(
+      program, "ImageToImageMetricGenerateRandomCoordinateSamples" );
+    this->m_GPUMetricCreated = true;
+  }
+  catch( itk::OpenCLCompileError & e )
+  {
+    // First log then report OpenCL compile error
+    itk::OpenCLLogger::Pointer logger = itk::OpenCLLogger::GetInstance();
+    logger->Write( itk::LoggerBase::CRITICAL, e.GetDescription() );
+
+    xl::xout[ "error" ] << "ERROR: OpenCL program has not been compiled"
+                        << " during GPU metric creation." << std::endl
+                        << "  Please check the '" << logger->GetLogFileName()
+                        << "' in output directory." << std::endl;
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    xl::xout[ "error" ] << "ERROR: Exception during GPU metric creation: " << e << std::endl;
+  }
+
+} // end BuildGPUProgram()
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::BeforeEachResolution( void )
+{
+  /** Read the parameters of the CPU metric. */
+  this->Superclass::BeforeEachResolution();
+
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Are we using a OpenCL enabled GPU for the metric? */
+  const std::string name = this->elxGetClassName();
+  this->m_UseOpenCL = true;
+  this->GetConfiguration()->ReadParameter( this->m_UseOpenCL,
+    name + "UseOpenCL", this->GetComponentLabel(), level, 0 );
+
+  /** From how many samples on? */
+  this->m_MinimumNumberOfSamples = 10000;
+  this->GetConfiguration()->ReadParameter( this->m_MinimumNumberOfSamples,
+    name + "MinimumNumberOfSamples", this->GetComponentLabel(), level, 0 );
+
+  /** Are the samples generated on the GPU as well? */
+  this->m_UseOpenCLImageSampler = true;
+  this->GetConfiguration()->ReadParameter( this->m_UseOpenCLImageSampler,
+    name + "UseOpenCLImageSampler", this->GetComponentLabel(), level, 0 );
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::Initialize( void ) throw ( itk::ExceptionObject )
+{
+  /** Initialize the CPU metric. */
+  this->Superclass::Initialize();
+
+  this->m_GPUMetricReady        = false;
+  this->m_GPUSamplerReady       = false;
+  this->m_GPUParametersResident = false;
+  if( !this->m_UseOpenCL )
+  {
+    return;
+  }
+
+  if( !this->m_ContextCreated )
+  {
+    this->SwitchingToCPUAndReport( "The OpenCL context could not be created." );
+    return;
+  }
+
+  if( !this->m_GPUMetricCreated )
+  {
+    if( MovingImageDimension != 3 )
+    {
+      this->SwitchingToCPUAndReport( "Only 3D images are supported." );
+    }
+    else
+    {
+      this->SwitchingToCPUAndReport( "Unable to configure the GPU." );
+    }
+    return;
+  }
+
+  std::string reason;
+  if( !this->IsGPUSupported( reason ) )
+  {
+    this->SwitchingToCPUAndReport( reason );
+    return;
+  }
+
+  /** The sampler is set up by the Superclass, and does not execute again
+   * in the first iteration if its inputs are not modified. */
+  this->GetImageSampler()->Update();
+  const std::size_t numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  if( numberOfSamples < this->m_MinimumNumberOfSamples )
+  {
+    elxout << "  The " << this->elxGetClassName() << " metric is computed on the CPU"
+           << " in this resolution, as the number of samples (" << numberOfSamples
+           << ") is smaller than " << this->elxGetClassName() << "MinimumNumberOfSamples ("
+           << this->m_MinimumNumberOfSamples << ")." << std::endl;
+    return;
+  }
+
+  try
+  {
+    this->InitializeGPU();
+    this->InitializeGPUMetric();
+    this->m_GPUMetricReady = true;
+    this->ReportToLog();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    xl::xout[ "error" ] << "ERROR: Exception during GPU metric initialization: " << e << std::endl;
+    this->SwitchingToCPUAndReport( "Unable to configure the GPU." );
+    return;
+  }
+
+  /** Generate the samples on the GPU as well, if possible. */
+  if( !this->m_UseOpenCLImageSampler )
+  {
+    return;
+  }
+  if( !this->IsGPUSamplerSupported( reason ) )
+  {
+    elxout << "  The samples of the " << this->elxGetClassName()
+           << " metric are generated on the CPU: " << reason << std::endl;
+    return;
+  }
+
+  try
+  {
+    this->InitializeGPUSampler();
+    this->m_GPUSamplerReady = true;
+    elxout << "  The samples of the " << this->elxGetClassName()
+           << " metric are generated on the GPU." << std::endl;
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    xl::xout[ "error" ] << "ERROR: Exception during GPU sampler initialization: " << e << std::endl;
+    elxout << "  The samples of the " << this->elxGetClassName()
+           << " metric are generated on the CPU." << std::endl;
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* IsGPUSupported ***********************
+ */
+
+template< class TSuperclass >
+bool
+OpenCLMetricBase< TSuperclass >
+::IsGPUSupported( std::string & reason ) const
+{
+  if( FixedImageDimension != 3 || MovingImageDimension != 3 )
+  {
+    reason = "Only 3D images are supported.";
+    return false;
+  }
+
+  if( this->GetMovingImageMask() )
+  {
+    reason = "Moving masks are not supported.";
+    return false;
+  }
+
+  /** The moving image value and gradient are interpolated linearly. */
+  const bool linear = this->m_InterpolatorIsLinear
+    || ( this->m_InterpolatorIsBSpline && this->m_BSplineInterpolator->GetSplineOrder() == 1 );
+  if( !linear || this->GetComputeGradient() || this->m_PackedMovingImage.IsNotNull()
+    || ( this->GetUseMovingImageDerivativeScales()
+    && this->GetScaleGradientWithRespectToMovingImageOrientation() ) )
+  {
+    reason = "Only linear interpolation of the moving image is supported.";
+    return false;
+  }
+
+  const MovingImageType * movingImage = this->GetMovingImage();
+  if( movingImage->GetBufferedRegion() != movingImage->GetLargestPossibleRegion()
+    || movingImage->GetLargestPossibleRegion().GetIndex() != typename MovingImageType::IndexType::Filled( 0 ) )
+  {
+    reason = "The moving image should be buffered completely, with start index zero.";
+    return false;
+  }
+
+  /** The transform should be a single B-spline transform. */
+  typedef typename Superclass1::CombinationTransformType CombinationTransformType;
+  const CombinationTransformType * combinationTransform
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( combinationTransform == NULL || combinationTransform->GetInitialTransform() != NULL )
+  {
+    reason = "Only a B-spline transform without initial transform is supported.";
+    return false;
+  }
+
+  typedef itk::AdvancedBSplineDeformableTransform<
+    typename Superclass1::ScalarType, FixedImageDimension, 2 > BSplineTransform2Type;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    typename Superclass1::ScalarType, FixedImageDimension, 3 > BSplineTransform3Type;
+  const typename CombinationTransformType::CurrentTransformType * currentTransform
+    = combinationTransform->GetCurrentTransform();
+  const bool isBSpline = currentTransform != NULL
+    && std::string( currentTransform->GetNameOfClass() ) == "AdvancedBSplineDeformableTransform"
+    && ( dynamic_cast< const BSplineTransform2Type * >( currentTransform ) != NULL
+    || dynamic_cast< const BSplineTransform3Type * >( currentTransform ) != NULL );
+  if( !isBSpline )
+  {
+    reason = "Only an AdvancedBSplineDeformableTransform of order 2 or 3 is supported.";
+    return false;
+  }
+
+  return true;
+
+} // end IsGPUSupported()
+
+
+/**
+ * ******************* IsGPUSamplerSupported ***********************
+ */
+
+template< class TSuperclass >
+bool
+OpenCLMetricBase< TSuperclass >
+::IsGPUSamplerSupported( std::string & reason ) const
+{
+  typedef itk::ImageRandomCoordinateSampler< FixedImageType > RandomCoordinateSamplerType;
+  typedef typename RandomCoordinateSamplerType::InterpolatorType InterpolatorType;
+  typedef typename RandomCoordinateSamplerType::DefaultInterpolatorType BSplineInterpolatorType;
+  typedef itk::LinearInterpolateImageFunction<
+    FixedImageType, typename RandomCoordinateSamplerType::CoordRepType > LinearInterpolatorType;
+  typedef itk::ImageMaskSpatialObject2< FixedImageDimension > FixedMaskType;
+
+  /** The kernel draws the candidates of the counter-based generator. */
+  RandomCoordinateSamplerType * sampler
+    = dynamic_cast< RandomCoordinateSamplerType * >( this->GetImageSampler() );
+  if( !this->GetUseImageSampler() || sampler == NULL
+    || !sampler->GetUseCounterBasedRandomGenerator() )
+  {
+    reason = "Only a RandomCoordinate sampler with UseCounterBasedRandomGenerator is supported.";
+    return false;
+  }
+
+  if( sampler->GetUseRandomSampleRegion() || sampler->GetUseStratifiedSampling()
+    || sampler->GetSortSamplesInMortonOrder() )
+  {
+    reason = "Random sample regions, stratified sampling and Morton order are not supported.";
+    return false;
+  }
+
+  if( this->GetDistributedComputationIsActive() )
+  {
+    reason = "Distributed computation is not supported.";
+    return false;
+  }
+
+  /** The fixed image value is interpolated linearly. */
+  const InterpolatorType *        interpolator = sampler->GetInterpolator();
+  const BSplineInterpolatorType * bsplineInterpolator
+    = dynamic_cast< const BSplineInterpolatorType * >( interpolator );
+  const bool linear = dynamic_cast< const LinearInterpolatorType * >( interpolator ) != NULL
+    || ( bsplineInterpolator != NULL && bsplineInterpolator->GetSplineOrder() == 1 );
+  if( !linear )
+  {
+    reason = "Only linear interpolation of the fixed image is supported.";
+    return false;
+  }
+
+  const FixedImageType * fixedImage = this->GetFixedImage();
+  if( fixedImage->GetBufferedRegion() != fixedImage->GetLargestPossibleRegion()
+    || fixedImage->GetLargestPossibleRegion().GetIndex() != typename FixedImageType::IndexType::Filled( 0 ) )
+  {
+    reason = "The fixed image should be buffered completely, with start index zero.";
+    return false;
+  }
+
+  /** The mask is tested by its bit-packed copy. */
+  if( sampler->GetNumberOfMasks() > 1 )
+  {
+    reason = "Only a single fixed mask is supported.";
+    return false;
+  }
+  if( sampler->GetMask() != NULL )
+  {
+    const FixedMaskType * mask = dynamic_cast< const FixedMaskType * >( sampler->GetMask() );
+    if( mask == NULL || !mask->GetBitMaskIsValid() )
+    {
+      reason = "Only a fixed mask image with an up-to-date bit mask is supported.";
+      return false;
+    }
+  }
+
+  cl_float2 range;
+  if( !this->GetGPUFixedImageValueRange( range ) )
+  {
+    reason = "The fixed image values of this metric cannot be computed on the GPU.";
+    return false;
+  }
+
+  return true;
+
+} // end IsGPUSamplerSupported()
+
+
+/**
+ * ******************* InitializeGPU ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::InitializeGPU( void )
+{
+  typedef itk::AdvancedBSplineDeformableTransformBase<
+    typename Superclass1::ScalarType, FixedImageDimension > BSplineTransformBaseType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    typename Superclass1::ScalarType, FixedImageDimension, 2 > BSplineTransform2Type;
+  typedef typename Superclass1::CombinationTransformType CombinationTransformType;
+
+  const CombinationTransformType * combinationTransform
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  const BSplineTransformBaseType * bsplineTransform
+    = dynamic_cast< const BSplineTransformBaseType * >( combinationTransform->GetCurrentTransform() );
+  this->m_SplineOrder = 3;
+  if( dynamic_cast< const BSplineTransform2Type * >( bsplineTransform ) != NULL )
+  {
+    this->m_SplineOrder = 2;
+  }
+
+  /** The grid is addressed from index zero, in the order of the parameters. */
+  const typename BSplineTransformBaseType::RegionType gridRegion = bsplineTransform->GetGridRegion();
+  if( gridRegion.GetIndex() != typename BSplineTransformBaseType::RegionType::IndexType::Filled( 0 )
+    || this->GetNumberOfParameters() != FixedImageDimension * gridRegion.GetNumberOfPixels() )
+  {
+    itkExceptionMacro( << "The B-spline grid should start at index zero." );
+  }
+
+  /** Determine the work sizes. The local size is a power of two, for the
+   * reductions in local memory, and the kernels that loop over the samples
+   * use a number of groups in the order of the number of compute units. */
+  const itk::OpenCLDevice device = this->m_KernelManager->GetContext()->GetDefaultDevice();
+  const std::size_t maximumLocalSize = std::min< std::size_t >( 256,
+    std::max< std::size_t >( device.GetMaximumWorkItemsPerGroup(), 1 ) );
+  this->m_LocalSize = 1;
+  while( 2 * this->m_LocalSize <= maximumLocalSize )
+  {
+    this->m_LocalSize *= 2;
+  }
+  this->m_NumberOfGroups = 4 * std::max< std::size_t >( device.GetComputeUnits(), 1 );
+
+  /** Copy the moving image to the device, cast to float. */
+  const MovingImageType * movingImage = this->GetMovingImage();
+  this->m_GPUMovingImage = GPUImageType::New();
+  this->m_GPUMovingImage->CopyInformation( movingImage );
+  this->m_GPUMovingImage->SetRegions( movingImage->GetLargestPossibleRegion() );
+  this->m_GPUMovingImage->Allocate();
+
+  const MovingImagePixelType * movingBuffer = movingImage->GetBufferPointer();
+  float *                      gpuBuffer    = this->m_GPUMovingImage->GetBufferPointer();
+  const std::size_t            numberOfPixels
+    = movingImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  for( std::size_t i = 0; i < numberOfPixels; ++i )
+  {
+    gpuBuffer[ i ] = static_cast< float >( movingBuffer[ i ] );
+  }
+  this->m_GPUMovingImage->GetGPUDataManager()->SetGPUDirtyFlag( true );
+  this->m_GPUMovingImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  /** The B-spline grid, only its geometry is copied. */
+  this->m_GPUCoefficientImage = GPUImageType::New();
+  this->m_GPUCoefficientImage->SetRegions( gridRegion );
+  this->m_GPUCoefficientImage->SetSpacing( bsplineTransform->GetGridSpacing() );
+  this->m_GPUCoefficientImage->SetOrigin( bsplineTransform->GetGridOrigin() );
+  this->m_GPUCoefficientImage->SetDirection( bsplineTransform->GetGridDirection() );
+
+  /** Allocate the buffers that are exchanged every iteration. The parameters
+   * are written by the device as well, when they are resident. */
+  const std::size_t numberOfParameters = this->GetNumberOfParameters();
+  AllocateGPUBuffer( this->m_GPUParameters,
+    numberOfParameters * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  AllocateGPUBuffer( this->m_GPUDerivative,
+    numberOfParameters * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->m_ParametersBuffer.resize( numberOfParameters );
+  this->m_DerivativeBuffer.resize( numberOfParameters );
+
+  /** The buffers of the steps on the resident parameters. Every work group
+   * stores the squared magnitude and the inner product with the previous
+   * derivative. */
+  AllocateGPUBuffer( this->m_GPUPreviousDerivative,
+    numberOfParameters * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  AllocateGPUBuffer( this->m_GPUPartialInnerProducts,
+    2 * this->m_NumberOfGroups * sizeof( cl_float ), CL_MEM_READ_WRITE );
+  this->m_PartialInnerProductsBuffer.resize( 2 * this->m_NumberOfGroups );
+
+  const std::size_t advanceKernel         = this->m_AdvanceParametersKernelHandle;
+  const cl_uint     gpuNumberOfParameters = static_cast< cl_uint >( numberOfParameters );
+  this->m_KernelManager->SetKernelArgWithImage( advanceKernel, 0, this->m_GPUParameters );
+  this->m_KernelManager->SetKernelArgWithImage( advanceKernel, 1, this->m_GPUDerivative );
+  this->m_KernelManager->SetKernelArgWithImage( advanceKernel, 2, this->m_GPUPreviousDerivative );
+  this->m_KernelManager->SetKernelArg( advanceKernel, 3, sizeof( cl_uint ), &gpuNumberOfParameters );
+  this->m_KernelManager->SetKernelArg( advanceKernel, 6, this->m_LocalSize * sizeof( cl_float ), NULL );
+  this->m_KernelManager->SetKernelArgWithImage( advanceKernel, 7, this->m_GPUPartialInnerProducts );
+
+  /** The image geometries are set again by the subclass. */
+  this->m_GPUImageBases.clear();
+
+  /** Force copying the samples in the first iteration. */
+  this->m_GPUSampleContainer      = NULL;
+  this->m_GPUSampleContainerMTime = 0;
+
+} // end InitializeGPU()
+
+
+/**
+ * ******************* InitializeGPUSampler ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::InitializeGPUSampler( void )
+{
+  typedef itk::ImageRandomCoordinateSampler< FixedImageType > RandomCoordinateSamplerType;
+  typedef itk::ImageMaskSpatialObject2< FixedImageDimension > FixedMaskType;
+  typedef typename FixedImageType::PixelType                  FixedImagePixelType;
+
+  const RandomCoordinateSamplerType * sampler
+    = dynamic_cast< const RandomCoordinateSamplerType * >( this->GetImageSampler() );
+  const FixedMaskType * mask = dynamic_cast< const FixedMaskType * >( sampler->GetMask() );
+
+  /** Copy the fixed image to the device, cast to float. */
+  const FixedImageType * fixedImage = this->GetFixedImage();
+  this->m_GPUFixedImage = GPUImageType::New();
+  this->m_GPUFixedImage->CopyInformation( fixedImage );
+  this->m_GPUFixedImage->SetRegions( fixedImage->GetLargestPossibleRegion() );
+  this->m_GPUFixedImage->Allocate();
+
+  const FixedImagePixelType * fixedBuffer = fixedImage->GetBufferPointer();
+  float *                     gpuBuffer   = this->m_GPUFixedImage->GetBufferPointer();
+  const std::size_t           numberOfPixels
+    = fixedImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  for( std::size_t i = 0; i < numberOfPixels; ++i )
+  {
+    gpuBuffer[ i ] = static_cast< float >( fixedBuffer[ i ] );
+  }
+  this->m_GPUFixedImage->GetGPUDataManager()->SetGPUDirtyFlag( true );
+  this->m_GPUFixedImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  /** Copy the bit-packed mask, with the world-to-index transform and the
+   * bounding box of ImageMaskSpatialObject2::IsInside(). Without a mask a
+   * single word is allocated, which is not read. */
+  std::vector< cl_ulong > maskWords( 1, 0 );
+  const cl_uint           useMask = mask != NULL ? 1 : 0;
+  cl_float16              worldToIndex;
+  cl_float4               worldToIndexOffset;
+  cl_float4               boundsMinimum;
+  cl_float4               boundsMaximum;
+  cl_int4                 maskStart;
+  cl_uint4                maskSize;
+  for( unsigned int i = 0; i < 16; ++i )
+  {
+    worldToIndex.s[ i ] = 0.0f;
+  }
+  for( unsigned int i = 0; i < 4; ++i )
+  {
+    worldToIndexOffset.s[ i ] = 0.0f;
+    boundsMinimum.s[ i ]      = 0.0f;
+    boundsMaximum.s[ i ]      = 0.0f;
+    maskStart.s[ i ]          = 0;
+    maskSize.s[ i ]           = 0;
+  }
+  if( mask != NULL )
+  {
+    if( !mask->GetBitMask().empty() )
+    {
+      maskWords.assign( mask->GetBitMask().begin(), mask->GetBitMask().end() );
+    }
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      for( unsigned int j = 0; j < FixedImageDimension; ++j )
+      {
+        worldToIndex.s[ 3 * i + j ] = static_cast< cl_float >( mask->GetWorldToIndexMatrix()[ i ][ j ] );
+      }
+      worldToIndexOffset.s[ i ] = static_cast< cl_float >( mask->GetWorldToIndexOffset()[ i ] );
+      boundsMinimum.s[ i ]      = static_cast< cl_float >( mask->GetBounds()->GetMinimum()[ i ] );
+      boundsMaximum.s[ i ]      = static_cast< cl_float >( mask->GetBounds()->GetMaximum()[ i ] );
+      maskStart.s[ i ]          = static_cast< cl_int >( mask->GetBitMaskRegion().GetIndex()[ i ] );
+      maskSize.s[ i ]           = static_cast< cl_uint >( mask->GetBitMaskRegion().GetSize()[ i ] );
+    }
+  }
+  AllocateGPUBuffer( this->m_GPUFixedMask,
+    maskWords.size() * sizeof( cl_ulong ), CL_MEM_READ_ONLY );
+  WriteGPUBuffer( this->m_GPUFixedMask, &maskWords[ 0 ] );
+
+  /** The number of attempts and of failed samples. */
+  AllocateGPUBuffer( this->m_GPUSamplerStatistics, 2 * sizeof( cl_uint ), CL_MEM_READ_WRITE );
+  this->m_SamplerStatisticsBuffer.assign( 2, 0 );
+
+  /** Set the kernel arguments that are fixed during a resolution. */
+  const std::size_t generateKernel = this->m_GenerateSamplesKernelHandle;
+  cl_float2         range;
+  this->GetGPUFixedImageValueRange( range );
+
+  cl_uint               argIdx    = 5;
+  GPUDataManagerPointer imageBase = itk::GPUDataManager::New();
+  this->m_GPUImageBases.push_back( imageBase );
+  itk::SetKernelWithITKImage< GPUImageType >( this->m_KernelManager, generateKernel,
+    argIdx, this->m_GPUFixedImage, imageBase, true, true );
+  this->m_KernelManager->SetKernelArg( generateKernel, 7, sizeof( cl_float2 ), &range );
+  this->m_KernelManager->SetKernelArg( generateKernel, 8, sizeof( cl_uint ), &useMask );
+  this->m_KernelManager->SetKernelArgWithImage( generateKernel, 9, this->m_GPUFixedMask );
+  this->m_KernelManager->SetKernelArg( generateKernel, 10, sizeof( cl_float16 ), &worldToIndex );
+  this->m_KernelManager->SetKernelArg( generateKernel, 11, sizeof( cl_float4 ), &worldToIndexOffset );
+  this->m_KernelManager->SetKernelArg( generateKernel, 12, sizeof( cl_float4 ), &boundsMinimum );
+  this->m_KernelManager->SetKernelArg( generateKernel, 13, sizeof( cl_float4 ), &boundsMaximum );
+  this->m_KernelManager->SetKernelArg( generateKernel, 14, sizeof( cl_int4 ), &maskStart );
+  this->m_KernelManager->SetKernelArg( generateKernel, 15, sizeof( cl_uint4 ), &maskSize );
+  this->m_KernelManager->SetKernelArgWithImage( generateKernel, 17, this->m_GPUSamplerStatistics );
+
+  /** The samples of the first iteration were already generated by the
+   * sampler in Initialize(), so they are copied instead. */
+  this->UpdateGPUSamples();
+  this->m_GPUSamplerMTime = sampler->GetMTime();
+
+} // end InitializeGPUSampler()
+
+
+/**
+ * ******************* UpdateGPUSamples ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::UpdateGPUSamples( void ) const
+{
+  /** The samples only change when the sampler generates new ones. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  if( sampleContainer.GetPointer() == this->m_GPUSampleContainer
+    && sampleContainer->GetMTime() == this->m_GPUSampleContainerMTime )
+  {
+    return;
+  }
+
+  /** Store the fixed points and the fixed image values. */
+  const std::size_t numberOfSamples = sampleContainer->Size();
+  this->m_SamplesBuffer.resize( std::max< std::size_t >( numberOfSamples, 1 ) );
+
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  std::size_t                                      s      = 0;
+  for( fiter = fbegin; fiter != fend; ++fiter, ++s )
+  {
+    cl_float4 & sample = this->m_SamplesBuffer[ s ];
+    for( unsigned int d = 0; d < 3; ++d )
+    {
+      sample.s[ d ] = d < FixedImageDimension
+        ? static_cast< cl_float >( ( *fiter ).Value().m_ImageCoordinates[ d ] ) : 0.0f;
+    }
+    sample.s[ 3 ] = this->GetGPUFixedImageValue(
+      static_cast< RealType >( ( *fiter ).Value().m_ImageValue ) );
+  }
+
+  this->ReserveGPUSamples( this->m_SamplesBuffer.size() );
+  WriteGPUBuffer( this->m_GPUSamples, &this->m_SamplesBuffer[ 0 ] );
+
+  this->m_NumberOfGPUSamples      = numberOfSamples;
+  this->m_GPUSampleContainer      = sampleContainer.GetPointer();
+  this->m_GPUSampleContainerMTime = sampleContainer->GetMTime();
+
+  /** Set the kernel arguments that depend on the samples. */
+  this->SetGPUSampleKernelArguments();
+
+} // end UpdateGPUSamples()
+
+
+/**
+ * ******************* ReserveGPUSamples ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::ReserveGPUSamples( const std::size_t numberOfSamples ) const
+{
+  /** Grow the device buffers when needed. The samples are written by the
+   * sample generation kernel as well. */
+  if( numberOfSamples > this->m_GPUSamplesCapacity )
+  {
+    this->m_GPUSamplesCapacity = numberOfSamples;
+    AllocateGPUBuffer( this->m_GPUSamples,
+      this->m_GPUSamplesCapacity * sizeof( cl_float4 ), CL_MEM_READ_WRITE );
+    AllocateGPUBuffer( this->m_GPUMovingValuesAndGradients,
+      this->m_GPUSamplesCapacity * sizeof( cl_float4 ), CL_MEM_READ_WRITE );
+  }
+
+} // end ReserveGPUSamples()
+
+
+/**
+ * ******************* GenerateGPUSamples ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::GenerateGPUSamples( void ) const
+{
+  typedef itk::ImageRandomCoordinateSampler< FixedImageType > RandomCoordinateSamplerType;
+  typedef itk::PhiloxRandomNumberGenerator::WordType          WordType;
+
+  RandomCoordinateSamplerType * sampler
+    = dynamic_cast< RandomCoordinateSamplerType * >( this->GetImageSampler() );
+
+  /** Take the key of the next update of the sampler, and skip that update
+   * on the host. */
+  const WordType update = sampler->GetNumberOfUpdates() + 1;
+  sampler->SetNumberOfUpdates( update );
+  cl_uint2 key;
+  key.s[ 0 ] = static_cast< cl_uint >( sampler->GetSeed() );
+  key.s[ 1 ] = static_cast< cl_uint >( update );
+
+  /** The box of continuous indices of the cropped input image region. */
+  const typename FixedImageType::RegionType & region = sampler->GetCroppedInputImageRegion();
+  cl_float4                                   smallestIndex;
+  cl_float4                                   largestIndex;
+  for( unsigned int d = 0; d < 4; ++d )
+  {
+    smallestIndex.s[ d ] = 0.0f;
+    largestIndex.s[ d ]  = 0.0f;
+    if( d < FixedImageDimension )
+    {
+      smallestIndex.s[ d ] = static_cast< cl_float >( region.GetIndex()[ d ] );
+      largestIndex.s[ d ]  = static_cast< cl_float >( region.GetIndex()[ d ]
+        + static_cast< itk::IndexValueType >( region.GetSize()[ d ] ) - 1 );
+    }
+  }
+
+  /** The sampler fails when it needs more than ten attempts per sample on
+   * average. One sample gets at most 1024 attempts. */
+  const std::size_t numberOfSamples         = sampler->GetNumberOfSamples();
+  const std::size_t maximumNumberOfTries    = 10 * numberOfSamples;
+  const cl_uint     gpuNumberOfSamples      = static_cast< cl_uint >( numberOfSamples );
+  const cl_uint     maximumNumberOfAttempts = static_cast< cl_uint >(
+    std::min< std::size_t >( maximumNumberOfTries, 1024 ) );
+  const bool        useMask = sampler->GetMask() != NULL;
+
+  this->ReserveGPUSamples( std::max< std::size_t >( numberOfSamples, 1 ) );
+  const std::size_t generateKernel = this->m_GenerateSamplesKernelHandle;
+  this->m_KernelManager->SetKernelArgWithImage( generateKernel, 0, this->m_GPUSamples );
+  this->m_KernelManager->SetKernelArg( generateKernel, 1, sizeof( cl_uint ), &gpuNumberOfSamples );
+  this->m_KernelManager->SetKernelArg( generateKernel, 2, sizeof( cl_uint2 ), &key );
+  this->m_KernelManager->SetKernelArg( generateKernel, 3, sizeof( cl_float4 ), &smallestIndex );
+  this->m_KernelManager->SetKernelArg( generateKernel, 4, sizeof( cl_float4 ), &largestIndex );
+  this->m_KernelManager->SetKernelArg( generateKernel, 16, sizeof( cl_uint ), &maximumNumberOfAttempts );
+  if( useMask )
+  {
+    std::fill( this->m_SamplerStatisticsBuffer.begin(), this->m_SamplerStatisticsBuffer.end(), 0 );
+    WriteGPUBuffer( this->m_GPUSamplerStatistics, &this->m_SamplerStatisticsBuffer[ 0 ] );
+  }
+  this->LaunchGPUKernel( generateKernel, numberOfSamples );
+
+  /** Only with a mask samples can fail, so only then the statistics are read. */
+  if( useMask )
+  {
+    ReadGPUBuffer( this->m_GPUSamplerStatistics, &this->m_SamplerStatisticsBuffer[ 0 ] );
+    if( this->m_SamplerStatisticsBuffer[ 1 ] > 0
+      || this->m_SamplerStatisticsBuffer[ 0 ] > maximumNumberOfTries )
+    {
+      itkExceptionMacro( << "Could not find enough image samples within "
+                         << "reasonable time. Probably the mask is too small" );
+    }
+  }
+
+  /** The samples on the device no longer belong to the sample container. */
+  this->m_NumberOfGPUSamples = numberOfSamples;
+  this->m_GPUSampleContainer = NULL;
+  this->m_GPUSamplerMTime    = sampler->GetMTime();
+
+  /** Set the kernel arguments that depend on the samples. */
+  this->SetGPUSampleKernelArguments();
+
+} // end GenerateGPUSamples()
+
+
+/**
+ * ******************* BeforeGPUGetValueAndDerivative ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::BeforeGPUGetValueAndDerivative( const ParametersType & parameters ) const
+{
+  if( !this->m_GPUSamplerReady )
+  {
+    this->BeforeThreadedGetValueAndDerivative( parameters );
+    this->UpdateGPUSamples();
+    return;
+  }
+
+  /** The sampler is modified when new samples are requested, and is then
+   * not updated on the host. */
+  this->SetTransformParameters( parameters );
+  if( this->GetImageSampler()->GetMTime() != this->m_GPUSamplerMTime )
+  {
+    this->GenerateGPUSamples();
+  }
+
+} // end BeforeGPUGetValueAndDerivative()
+
+
+/**
+ * ******************* UpdateGPUParameters ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::UpdateGPUParameters( const ParametersType & parameters ) const
+{
+  if( this->m_GPUParametersResident )
+  {
+    return;
+  }
+
+  const std::size_t numberOfParameters = this->m_ParametersBuffer.size();
+  for( std::size_t i = 0; i < numberOfParameters; ++i )
+  {
+    this->m_ParametersBuffer[ i ] = static_cast< float >( parameters[ i ] );
+  }
+  WriteGPUBuffer( this->m_GPUParameters, &this->m_ParametersBuffer[ 0 ] );
+
+} // end UpdateGPUParameters()
+
+
+/**
+ * ******************* ReadGPUDerivative ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::ReadGPUDerivative( DerivativeType & derivative, const double scale ) const
+{
+  if( this->m_GPUParametersResident )
+  {
+    this->m_ResidentDerivativeScale    = scale;
+    this->m_ResidentDerivativeComputed = true;
+    return;
+  }
+
+  ReadGPUBuffer( this->m_GPUDerivative, &this->m_DerivativeBuffer[ 0 ] );
+
+  const std::size_t numberOfParameters = this->m_DerivativeBuffer.size();
+  derivative.SetSize( numberOfParameters );
+  for( std::size_t i = 0; i < numberOfParameters; ++i )
+  {
+    derivative[ i ] = static_cast< typename DerivativeType::ValueType >(
+      scale * this->m_DerivativeBuffer[ i ] );
+  }
+
+} // end ReadGPUDerivative()
+
+
+/**
+ * ******************* CanKeepParametersResident ***********************
+ */
+
+template< class TSuperclass >
+bool
+OpenCLMetricBase< TSuperclass >
+::CanKeepParametersResident( void ) const
+{
+  return this->m_GPUMetricReady;
+
+} // end CanKeepParametersResident()
+
+
+/**
+ * ******************* SetResidentParameters ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::SetResidentParameters( const ParametersType & parameters )
+{
+  /** Keep a host copy, the transform refers to it in the evaluations. */
+  this->m_ResidentParameters      = parameters;
+  this->m_GPUParametersResident   = false;
+  this->m_ResidentDerivativeScale = 1.0;
+  this->UpdateGPUParameters( this->m_ResidentParameters );
+
+  /** The first step has no previous derivative. */
+  std::fill( this->m_DerivativeBuffer.begin(), this->m_DerivativeBuffer.end(), 0.0f );
+  WriteGPUBuffer( this->m_GPUPreviousDerivative, &this->m_DerivativeBuffer[ 0 ] );
+
+} // end SetResidentParameters()
+
+
+/**
+ * ******************* GetValueAndResidentDerivative ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::GetValueAndResidentDerivative( MeasureType & value )
+{
+  /** Evaluate the metric as usual, without exchanging the parameters and
+   * the derivative with the device. */
+  this->m_GPUParametersResident      = true;
+  this->m_ResidentDerivativeComputed = false;
+  try
+  {
+    this->GetValueAndDerivative( this->m_ResidentParameters, value, this->m_ResidentDerivative );
+  }
+  catch( itk::ExceptionObject & )
+  {
+    this->m_GPUParametersResident = false;
+    throw;
+  }
+  this->m_GPUParametersResident = false;
+
+  /** The metrics set a zero derivative on the host, without computing it
+   * on the device, when it is undefined. */
+  if( !this->m_ResidentDerivativeComputed )
+  {
+    this->m_ResidentDerivativeScale = 0.0;
+  }
+
+} // end GetValueAndResidentDerivative()
+
+
+/**
+ * ******************* AdvanceResidentParameters ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::AdvanceResidentParameters( const double stepSize,
+  double & squaredMagnitude, double & innerProductWithPrevious )
+{
+  const std::size_t advanceKernel = this->m_AdvanceParametersKernelHandle;
+  const cl_float    scale         = static_cast< cl_float >( this->m_ResidentDerivativeScale );
+  const cl_float    step          = static_cast< cl_float >( stepSize );
+  this->m_KernelManager->SetKernelArg( advanceKernel, 4, sizeof( cl_float ), &scale );
+  this->m_KernelManager->SetKernelArg( advanceKernel, 5, sizeof( cl_float ), &step );
+  this->LaunchGPUKernelPerGroup( advanceKernel );
+  ReadGPUBuffer( this->m_GPUPartialInnerProducts, &this->m_PartialInnerProductsBuffer[ 0 ] );
+
+  /** Sum the work groups on the host. */
+  squaredMagnitude         = 0.0;
+  innerProductWithPrevious = 0.0;
+  for( std::size_t g = 0; g < this->m_NumberOfGroups; ++g )
+  {
+    squaredMagnitude         += this->m_PartialInnerProductsBuffer[ 2 * g ];
+    innerProductWithPrevious += this->m_PartialInnerProductsBuffer[ 2 * g + 1 ];
+  }
+
+} // end AdvanceResidentParameters()
+
+
+/**
+ * ******************* GetResidentParameters ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::GetResidentParameters( ParametersType & parameters ) const
+{
+  ReadGPUBuffer( this->m_GPUParameters, &this->m_ParametersBuffer[ 0 ] );
+
+  const std::size_t numberOfParameters = this->m_ParametersBuffer.size();
+  parameters.SetSize( numberOfParameters );
+  for( std::size_t i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = static_cast< typename ParametersType::ValueType >(
+      this->m_ParametersBuffer[ i ] );
+  }
+
+} // end GetResidentParameters()
+
+
+/**
+ * ******************* SetGPUMovingImageKernelArguments ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::SetGPUMovingImageKernelArguments( const std::size_t kernelHandle, cl_uint argIdx )
+{
+  /** Every kernel gets its own copy of the image geometry. */
+  GPUDataManagerPointer imageBase = itk::GPUDataManager::New();
+  this->m_GPUImageBases.push_back( imageBase );
+  itk::SetKernelWithITKImage< GPUImageType >( this->m_KernelManager, kernelHandle,
+    argIdx, this->m_GPUMovingImage, imageBase, true, true );
+
+} // end SetGPUMovingImageKernelArguments()
+
+
+/**
+ * ******************* SetGPUCoefficientImageKernelArguments ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::SetGPUCoefficientImageKernelArguments( const std::size_t kernelHandle, cl_uint argIdx )
+{
+  GPUDataManagerPointer imageBase = itk::GPUDataManager::New();
+  this->m_GPUImageBases.push_back( imageBase );
+  itk::SetKernelWithITKImage< GPUImageType >( this->m_KernelManager, kernelHandle,
+    argIdx, this->m_GPUCoefficientImage, imageBase, false, true );
+
+  const cl_uint splineOrder = this->m_SplineOrder;
+  this->m_KernelManager->SetKernelArg( kernelHandle, argIdx, sizeof( cl_uint ), &splineOrder );
+
+} // end SetGPUCoefficientImageKernelArguments()
+
+
+/**
+ * ******************* GetGPUMovingImageDerivativeScales ***********************
+ */
+
+template< class TSuperclass >
+cl_float4
+OpenCLMetricBase< TSuperclass >
+::GetGPUMovingImageDerivativeScales( void ) const
+{
+  cl_float4 scales;
+  for( unsigned int i = 0; i < 4; ++i )
+  {
+    scales.s[ i ] = 1.0f;
+    if( this->GetUseMovingImageDerivativeScales() && i < MovingImageDimension )
+    {
+      scales.s[ i ] = static_cast< cl_float >( this->GetMovingImageDerivativeScales()[ i ] );
+    }
+  }
+  return scales;
+
+} // end GetGPUMovingImageDerivativeScales()
+
+
+/**
+ * ******************* LaunchGPUKernelPerGroup ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::LaunchGPUKernelPerGroup( const std::size_t kernelHandle ) const
+{
+  this->m_KernelManager->LaunchKernel( kernelHandle,
+    itk::OpenCLSize( this->m_LocalSize * this->m_NumberOfGroups ),
+    itk::OpenCLSize( this->m_LocalSize ) );
+
+} // end LaunchGPUKernelPerGroup()
+
+
+/**
+ * ******************* LaunchGPUKernel ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::LaunchGPUKernel( const std::size_t kernelHandle,
+  const std::size_t numberOfWorkItems ) const
+{
+  const std::size_t localSize = this->m_LocalSize;
+  const std::size_t numberOfLocalGroups
+    = std::max< std::size_t >( ( numberOfWorkItems + localSize - 1 ) / localSize, 1 );
+  this->m_KernelManager->LaunchKernel( kernelHandle,
+    itk::OpenCLSize( numberOfLocalGroups * localSize ), itk::OpenCLSize( localSize ) );
+
+} // end LaunchGPUKernel()
+
+
+/**
+ * ******************* AllocateGPUBuffer ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::AllocateGPUBuffer( GPUDataManagerPointer & buffer,
+  const std::size_t size, const cl_mem_flags flags )
+{
+  buffer = itk::GPUDataManager::New();
+  buffer->Initialize();
+  buffer->SetBufferFlag( flags );
+  buffer->SetBufferSize( static_cast< unsigned int >( size ) );
+  buffer->Allocate();
+
+} // end AllocateGPUBuffer()
+
+
+/**
+ * ******************* ReadGPUBuffer ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::ReadGPUBuffer( const GPUDataManagerPointer & buffer, void * cpuBuffer )
+{
+  buffer->SetCPUBufferPointer( cpuBuffer );
+  buffer->SetCPUDirtyFlag( true );
+  buffer->UpdateCPUBuffer();
+
+} // end ReadGPUBuffer()
+
+
+/**
+ * ******************* WriteGPUBuffer ***********************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::WriteGPUBuffer( const GPUDataManagerPointer & buffer, void * cpuBuffer )
+{
+  buffer->SetCPUBufferPointer( cpuBuffer );
+  buffer->SetGPUDirtyFlag( true );
+  buffer->UpdateGPUBuffer();
+
+} // end WriteGPUBuffer()
+
+
+/**
+ * ************************* SwitchingToCPUAndReport ************************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::SwitchingToCPUAndReport( const std::string & reason ) const
+{
+  xl::xout[ "warning" ] << "WARNING: " << reason << "\n";
+  xl::xout[ "warning" ] << "  The " << this->elxGetClassName()
+                        << " metric is switching back to CPU mode." << std::endl;
+  this->m_GPUMetricReady = false;
+
+} // end SwitchingToCPUAndReport()
+
+
+/**
+ * ************************* ReportToLog ************************************
+ */
+
+template< class TSuperclass >
+void
+OpenCLMetricBase< TSuperclass >
+::ReportToLog( void ) const
+{
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  itk::OpenCLDevice           device  = context->GetDefaultDevice();
+  elxout << "  The " << this->elxGetClassName() << " metric is computed by "
+         <<  device.GetName() << " from " << device.GetVendor() << "." << std::endl;
+
+} // end ReportToLog()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxOpenCLMetricBase_hxx
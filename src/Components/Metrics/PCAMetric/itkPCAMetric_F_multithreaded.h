@@ -19,6 +19,7 @@
 #define __itkPCAMetric_F_multithreaded_H__
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkParallelMatrixProducts.h"
 
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
 #include "itkImageRandomCoordinateSampler.h"
@@ -235,10 +236,12 @@ private:
   /** Integer to indicate how many eigenvalues you want to use in the metric */
   unsigned int m_NumEigenValues;
 
-  /** Matrices, needed for derivative calculation */
+  /** Matrices, needed for derivative calculation. m_Amm holds the
+   * mean-subtracted samples and m_AmmSv = Amm S v, i.e. (v^T S Atmm)^T.
+   */
   mutable std::vector< unsigned int > m_PixelStartIndex;
-  mutable MatrixType                  m_Atmm;
-  mutable DerivativeMatrixType        m_vSAtmm;
+  mutable MatrixType                  m_Amm;
+  mutable DerivativeMatrixType        m_AmmSv;
   mutable DerivativeMatrixType        m_CSv;
   mutable DerivativeMatrixType        m_Sv;
   mutable DerivativeMatrixType        m_vdSdmu_part1;
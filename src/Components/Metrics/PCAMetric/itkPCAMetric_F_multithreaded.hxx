@@ -309,7 +309,8 @@ PCAMetric< TFixedImage, TMovingImage >
   }
 
   /** Compute covariance matrix C */
-  MatrixType C( Amm.transpose() * Amm );
+  MatrixType C;
+  ParallelMatrixProducts< RealType >::ComputeTransposeProduct( Amm, C, this->m_UseMultiThread );
   C /= static_cast< RealType >( RealType( this->m_NumberOfPixelsCounted ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( this->m_G );
@@ -496,8 +497,8 @@ PCAMetric< TFixedImage, TMovingImage >
   }
 
   /** Compute covariance matrix C */
-  MatrixType Atmm = Amm.transpose();
-  MatrixType C( Atmm * Amm );
+  MatrixType C;
+  ParallelMatrixProducts< RealType >::ComputeTransposeProduct( Amm, C, false );
   C /= static_cast< RealType >( RealType( this->m_NumberOfPixelsCounted ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( this->m_G );
@@ -545,9 +546,10 @@ PCAMetric< TFixedImage, TMovingImage >
     dSdmu_part1( d, d ) = -S_qub;
   }
 
-  DerivativeMatrixType vSAtmm( eigenVectorMatrixTranspose * S * Atmm );
   DerivativeMatrixType CSv( C * S * eigenVectorMatrix );
   DerivativeMatrixType Sv( S * eigenVectorMatrix );
+  DerivativeMatrixType AmmSv;
+  ParallelMatrixProducts< RealType >::ComputeProduct( Amm, Sv, AmmSv, false );
   DerivativeMatrixType vdSdmu_part1( eigenVectorMatrixTranspose * dSdmu_part1 );
 
   /** Second loop over fixed image samples. */
@@ -586,15 +588,18 @@ PCAMetric< TFixedImage, TMovingImage >
 
       /** Store values. */
       dMTdmu = imageJacobian;
+      /** The sum over the eigenvalues does not depend on the parameter. */
+      DerivativeValueType factor = 0.0;
+      for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
+      {
+        factor += AmmSv[ pixelIndex ][ z ] * Sv[ d ][ z ]
+          + vdSdmu_part1[ z ][ d ] * Amm[ pixelIndex ][ d ] * CSv[ d ][ z ];
+      } //end loop over eigenvalues
+
       /** build metric derivative components */
       for( unsigned int p = 0; p < nzjis[ d ].size(); ++p )
       {
-        for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
-        {
-          derivative[ nzjis[ d ][ p ] ] += vSAtmm[ z ][ pixelIndex ] * dMTdmu[ p ] * Sv[ d ][ z ]
-            + vdSdmu_part1[ z ][ d ] * Atmm[ d ][ pixelIndex ] * dMTdmu[ p ] * CSv[ d ][ z ];
-        } //end loop over eigenvalues
-
+        derivative[ nzjis[ d ][ p ] ] += factor * dMTdmu[ p ];
       } //end loop over non-zero jacobian indices
 
     } //end loop over last dimension
@@ -867,8 +872,8 @@ PCAMetric< TFixedImage, TMovingImage >
   mean /= RealType( this->m_NumberOfPixelsCounted );
 
   /** Calculate standard deviation from columns */
-  MatrixType Amm( this->m_NumberOfPixelsCounted, this->m_G );
-  Amm.fill( NumericTraits< RealType >::Zero );
+  MatrixType & Amm = this->m_Amm;
+  Amm.set_size( this->m_NumberOfPixelsCounted, this->m_G );
   for( unsigned int i = 0; i < this->m_NumberOfPixelsCounted; i++ )
   {
     for( unsigned int j = 0; j < this->m_G; j++ )
@@ -877,9 +882,9 @@ PCAMetric< TFixedImage, TMovingImage >
     }
   }
 
-  /** Compute covariancematrix C */
-  this->m_Atmm = Amm.transpose();
-  MatrixType C( this->m_Atmm * Amm );
+  /** Compute covariancematrix C, blocked and threaded. */
+  MatrixType C;
+  ParallelMatrixProducts< RealType >::ComputeTransposeProduct( Amm, C, true );
   C /= static_cast< RealType >( RealType( this->m_NumberOfPixelsCounted ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( this->m_G );
@@ -916,10 +921,10 @@ PCAMetric< TFixedImage, TMovingImage >
     dSdmu_part1( d, d ) = -S_qub;
   }
 
-  this->m_vSAtmm       = eigenVectorMatrixTranspose * S * this->m_Atmm;
   this->m_CSv          = C * S * eigenVectorMatrix;
   this->m_Sv           = S * eigenVectorMatrix;
   this->m_vdSdmu_part1 = eigenVectorMatrixTranspose * dSdmu_part1;
+  ParallelMatrixProducts< RealType >::ComputeProduct( Amm, this->m_Sv, this->m_AmmSv, true );
 
 } // end AfterThreadedGetSamples()
 
@@ -1023,16 +1028,18 @@ PCAMetric< TFixedImage, TMovingImage >
       this->EvaluateTransformJacobianInnerProduct(
         jacobian, movingImageDerivative, imageJacobian );
 
+      /** The sum over the eigenvalues does not depend on the parameter. */
+      DerivativeValueType factor = 0.0;
+      for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
+      {
+        factor += this->m_AmmSv[ pixelIndex ][ z ] * this->m_Sv[ d ][ z ]
+          + this->m_vdSdmu_part1[ z ][ d ] * this->m_Amm[ pixelIndex ][ d ] * this->m_CSv[ d ][ z ];
+      } //end loop over eigenvalues
+
       /** build metric derivative components */
       for( unsigned int p = 0; p < nzjis.size(); ++p )
       {
-        DerivativeValueType tmp = 0.0;
-        for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
-        {
-          tmp += this->m_vSAtmm[ z ][ pixelIndex ] * imageJacobian[ p ] * this->m_Sv[ d ][ z ]
-            + this->m_vdSdmu_part1[ z ][ d ] * this->m_Atmm[ d ][ pixelIndex ] * imageJacobian[ p ] * this->m_CSv[ d ][ z ];
-        } //end loop over eigenvalues
-        derivative[ nzjis[ p ] ] += tmp;
+        derivative[ nzjis[ p ] ] += factor * imageJacobian[ p ];
       } //end loop over non-zero jacobian indices
 
     } //end loop over last dimension
@@ -19,6 +19,7 @@
 #define __itkPCAMetric2_H__
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkParallelMatrixProducts.h"
 
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
 #include "itkImageRandomCoordinateSampler.h"
@@ -84,6 +85,7 @@ public:
   typedef typename Superclass::MovingImageMaskPointer     MovingImageMaskPointer;
   typedef typename Superclass::MeasureType                MeasureType;
   typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
   typedef typename Superclass::ParametersType             ParametersType;
   typedef typename Superclass::FixedImagePixelType        FixedImagePixelType;
   typedef typename Superclass::MovingImageRegionType      MovingImageRegionType;
@@ -165,6 +167,26 @@ private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void SampleRandom( const int n, const int m, std::vector< int > & numbers ) const;
 
+  typedef vnl_matrix< RealType > MatrixType;
+
+  /** The data shared by the threads assembling the derivative. */
+  struct DerivativePassStruct
+  {
+    const Self *                               st_Metric;
+    const std::vector< FixedImagePointType > * st_Samples;
+    const MatrixType *                         st_Amm;
+    const MatrixType *                         st_AmmSv;
+    const MatrixType *                         st_Sv;
+    const MatrixType *                         st_CSv;
+    const MatrixType *                         st_vdSdmu_part1;
+    std::vector< DerivativeType > *            st_Derivatives;
+    std::vector< unsigned char > *             st_DerivativesUsed;
+  };
+
+  /** Add the derivative contributions of a range of samples. */
+  static void ComputeDerivativeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed;
   unsigned int m_ReducedDimensionIndex;
@@ -178,6 +200,9 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** The derivative contributions of the threads. */
+  mutable std::vector< DerivativeType > m_ThreaderDerivatives;
+
 };
 
 } // end namespace itk
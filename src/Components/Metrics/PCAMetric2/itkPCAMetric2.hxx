@@ -295,7 +295,8 @@ PCAMetric2< TFixedImage, TMovingImage >
   }
 
   /** Compute covariancematrix C */
-  MatrixType C( Amm.transpose() * Amm );
+  MatrixType C;
+  ParallelMatrixProducts< RealType >::ComputeTransposeProduct( Amm, C, this->m_UseMultiThread );
   C /= static_cast< RealType >( RealType( N ) - 1.0 );
 
   MatrixType S( G, G );
@@ -507,8 +508,8 @@ PCAMetric2< TFixedImage, TMovingImage >
   }
 
   /** Compute covariance matrix C */
-  MatrixType Atmm = Amm.transpose();
-  MatrixType C( Atmm * Amm );
+  MatrixType C;
+  ParallelMatrixProducts< RealType >::ComputeTransposeProduct( Amm, C, this->m_UseMultiThread );
   C /= static_cast< RealType >( RealType( N ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( G );
@@ -538,18 +539,9 @@ PCAMetric2< TFixedImage, TMovingImage >
 
   MatrixType eigenVectorMatrixTranspose( eigenVectorMatrix.transpose() );
 
-  /** Create variables to store intermediate results in. */
-  TransformJacobianType                     jacobian;
-  DerivativeType                            dMTdmu;
-  DerivativeType                            imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  std::vector< NonZeroJacobianIndicesType > nzjis( G, NonZeroJacobianIndicesType() );
-
   /** Sub components of metric derivative */
   vnl_diag_matrix< DerivativeValueType > dSdmu_part1( G );
 
-  unsigned int startSamplesOK;
-  startSamplesOK = 0;
-
   for( unsigned int d = 0; d < G; d++ )
   {
     double S_sqr = S( d, d ) * S( d, d );
@@ -557,65 +549,47 @@ PCAMetric2< TFixedImage, TMovingImage >
     dSdmu_part1( d, d ) = -S_qub;
   }
 
-  DerivativeMatrixType vSAtmm( eigenVectorMatrixTranspose * S * Atmm );
   DerivativeMatrixType CSv( C * S * eigenVectorMatrix );
   DerivativeMatrixType Sv( S * eigenVectorMatrix );
   DerivativeMatrixType vdSdmu_part1( eigenVectorMatrixTranspose * dSdmu_part1 );
+  DerivativeMatrixType AmmSv;
+  ParallelMatrixProducts< RealType >::ComputeProduct( Amm, Sv, AmmSv, this->m_UseMultiThread );
 
-  /** Second loop over fixed image samples. */
-  for( pixelIndex = 0; pixelIndex < SamplesOK.size(); ++pixelIndex )
+  /** Second loop over fixed image samples, in parallel. Every thread
+   * accumulates its contributions in its own derivative.
+   */
+  const ThreadIdType numberOfParticipants = this->m_UseMultiThread
+    ? this->GetNumberOfParallelForBlocks() : 1;
+  this->m_ThreaderDerivatives.resize( numberOfParticipants );
+  std::vector< unsigned char > derivativesUsed( numberOfParticipants, 0 );
+
+  DerivativePassStruct pass;
+  pass.st_Metric          = this;
+  pass.st_Samples         = &SamplesOK;
+  pass.st_Amm             = &Amm;
+  pass.st_AmmSv           = &AmmSv;
+  pass.st_Sv              = &Sv;
+  pass.st_CSv             = &CSv;
+  pass.st_vdSdmu_part1    = &vdSdmu_part1;
+  pass.st_Derivatives     = &this->m_ThreaderDerivatives;
+  pass.st_DerivativesUsed = &derivativesUsed;
+  if( this->m_UseMultiThread )
   {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = SamplesOK[ startSamplesOK ];
-    startSamplesOK++;
-
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
-
-    const unsigned int G = lastDimPositions.size();
+    this->ParallelForBlocks( SamplesOK.size(), Self::ComputeDerivativeRangeFunction, &pass );
+  }
+  else
+  {
+    Self::ComputeDerivativeRangeFunction( &pass, 0, 0, SamplesOK.size() );
+  }
 
-    for( unsigned int d = 0; d < G; ++d )
+  /** Sum the contributions of the threads. */
+  for( ThreadIdType t = 0; t < numberOfParticipants; ++t )
+  {
+    if( derivativesUsed[ t ] )
     {
-      /** Initialize some variables. */
-      RealType                  movingImageValue;
-      MovingImagePointType      mappedPoint;
-      MovingImageDerivativeType movingImageDerivative;
-
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = lastDimPositions[ d ];
-
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
-      this->TransformPoint( fixedPoint, mappedPoint );
-
-      this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-
-      /** Get the TransformJacobian dT/dmu */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis[ d ] );
-
-      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-
-      /** Store values. */
-      dMTdmu = imageJacobian;
-
-      /** build metric derivative components */
-      for( unsigned int p = 0; p < nzjis[ d ].size(); ++p )
-      {
-        for( unsigned int z = 0; z < G; z++ )
-        {
-          derivative[ nzjis[ d ][ p ] ] += z * ( vSAtmm[ z ][ pixelIndex ] * dMTdmu[ p ] * Sv[ d ][ z ]
-            + vdSdmu_part1[ z ][ d ] * Atmm[ d ][ pixelIndex ] * dMTdmu[ p ] * CSv[ d ][ z ] );
-        } //end loop over eigenvalues
-
-      } //end loop over non-zero jacobian indices
-
-    } //end loop over last dimension
-
-  } // end second for loop over sample container
+      derivative += this->m_ThreaderDerivatives[ t ];
+    }
+  }
 
   derivative *= ( 2.0 / ( DerivativeValueType( N ) - 1.0 ) ); //normalize
   measure     = sumWeightedEigenValues;
@@ -695,6 +669,95 @@ PCAMetric2< TFixedImage, TMovingImage >
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* ComputeDerivativeRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::ComputeDerivativeRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  const DerivativePassStruct * pass = static_cast< const DerivativePassStruct * >( userData );
+  const Self *                 self = pass->st_Metric;
+
+  const unsigned int lastDim      = self->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G            = self->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+  const MatrixType & Amm          = *pass->st_Amm;
+  const MatrixType & AmmSv        = *pass->st_AmmSv;
+  const MatrixType & Sv           = *pass->st_Sv;
+  const MatrixType & CSv          = *pass->st_CSv;
+  const MatrixType & vdSdmu_part1 = *pass->st_vdSdmu_part1;
+
+  /** The derivative of this thread; it is cleared on first use. */
+  DerivativeType & derivative = ( *pass->st_Derivatives )[ participantId ];
+  if( !( *pass->st_DerivativesUsed )[ participantId ] )
+  {
+    derivative.SetSize( self->GetNumberOfParameters() );
+    derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+    ( *pass->st_DerivativesUsed )[ participantId ] = 1;
+  }
+
+  /** Create variables to store intermediate results in. */
+  TransformJacobianType      jacobian;
+  DerivativeType             imageJacobian( self->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  NonZeroJacobianIndicesType nzji;
+
+  for( SizeValueType pixelIndex = begin; pixelIndex < end; ++pixelIndex )
+  {
+    /** Read fixed coordinates. */
+    FixedImagePointType fixedPoint = ( *pass->st_Samples )[ pixelIndex ];
+
+    /** Transform sampled point to voxel coordinates. */
+    FixedImageContinuousIndexType voxelCoord;
+    self->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      /** Initialize some variables. */
+      RealType                  movingImageValue;
+      MovingImagePointType      mappedPoint;
+      MovingImageDerivativeType movingImageDerivative;
+
+      /** Set fixed point's last dimension to lastDimPosition. */
+      voxelCoord[ lastDim ] = d;
+
+      /** Transform sampled point back to world coordinates. */
+      self->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+      self->TransformPoint( fixedPoint, mappedPoint );
+
+      self->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+
+      /** Get the TransformJacobian dT/dmu */
+      self->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+      self->EvaluateTransformJacobianInnerProduct(
+        jacobian, movingImageDerivative, imageJacobian );
+
+      /** The weighted sum over the eigenvalues does not depend on the parameter. */
+      DerivativeValueType factor = 0.0;
+      for( unsigned int z = 0; z < G; z++ )
+      {
+        factor += z * ( AmmSv[ pixelIndex ][ z ] * Sv[ d ][ z ]
+          + vdSdmu_part1[ z ][ d ] * Amm[ pixelIndex ][ d ] * CSv[ d ][ z ] );
+      } //end loop over eigenvalues
+
+      /** build metric derivative components */
+      for( unsigned int p = 0; p < nzji.size(); ++p )
+      {
+        derivative[ nzji[ p ] ] += factor * imageJacobian[ p ];
+      } //end loop over non-zero jacobian indices
+
+    } //end loop over last dimension
+
+  } // end loop over samples
+
+} // end ComputeDerivativeRangeFunction()
+
+
 } // end namespace itk
 
 #endif // __itkPCAMetric2_HXX__
@@ -21,22 +21,27 @@
 #include "itkAdvancedImageToImageMetric.h"
 
 #include "itkPoint.h"
-#include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
-#include "itkMultiplyImageFilter.h"
-#include "itkSubtractImageFilter.h"
 #include "itkOptimizer.h"
-#include "itkRescaleIntensityImageFilter.h"
-#include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include <vector>
+
 namespace itk
 {
 
 /** \class PatternIntensityImageToImageMetric
  * \brief Computes similarity between two objects to be registered
  *
+ * The pattern intensity of the difference of the fixed image and the
+ * ray-cast moving image is computed in the (2*3+1)^2 neighbourhoods of the
+ * samples of the ImageSampler, in the first two dimensions. Only the pixels
+ * of these neighbourhoods are ray cast, instead of the whole projection
+ * image; with a full sampler the value equals that of the whole image.
+ * The ray casting and the neighbourhood sums are distributed over the
+ * threads of the PersistentThreadPool.
  *
+ * The derivative is computed with central differences. All evaluations of
+ * one derivative use the same samples.
  *
  * \ingroup RegistrationMetrics
  */
@@ -114,31 +119,9 @@ public:
   itkStaticConstMacro( FixedImageDimension, unsigned int,
     FixedImageType::ImageDimension );
 
-  typedef itk::Image< FixedImagePixelType,
-    itkGetStaticConstMacro( FixedImageDimension ) >       TransformedMovingImageType;
-  typedef typename itk::AdvancedCombinationTransform<
-    ScalarType, FixedImageDimension >                      CombinationTransformType;
-  typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
   typedef typename itk::AdvancedRayCastInterpolateImageFunction<
     MovingImageType, ScalarType >                         RayCastInterpolatorType;
   typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
-  typedef itk::ResampleImageFilter<
-    MovingImageType, TransformedMovingImageType >         TransformMovingImageFilterType;
-  typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
-  typedef itk::RescaleIntensityImageFilter<
-    TransformedMovingImageType, TransformedMovingImageType > RescaleIntensityImageFilterType;
-  typedef typename RescaleIntensityImageFilterType::Pointer RescaleIntensityImageFilterPointer;
-
-  typedef itk::SubtractImageFilter<
-    FixedImageType,
-    TransformedMovingImageType,
-    TransformedMovingImageType >        DifferenceImageFilterType;
-  typedef typename DifferenceImageFilterType::Pointer DifferenceImageFilterPointer;
-  typedef itk::MultiplyImageFilter<
-    TransformedMovingImageType,
-    TransformedMovingImageType,
-    TransformedMovingImageType >         MultiplyImageFilterType;
-  typedef typename MultiplyImageFilterType::Pointer MultiplyImageFilterPointer;
 
   /** The moving image dimension. */
   itkStaticConstMacro( MovingImageDimension, unsigned int,
@@ -180,30 +163,90 @@ protected:
   virtual ~PatternIntensityImageToImageMetric() {}
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
-  /** Compute the pattern intensity fixed image*/
+  /** Compute the pattern intensity of the fixed image in the sample neighbourhoods. */
   MeasureType ComputePIFixed( void ) const;
 
-  /** Compute the pattern intensity difference image. */
-  MeasureType ComputePIDiff( const TransformParametersType & parameters, float scalingfactor ) const;
+  /** Compute the pattern intensity of the difference image in the sample
+   * neighbourhoods, using the moving values of the last RayCastNeighbourhoods().
+   */
+  MeasureType ComputePIDiff( float scalingfactor ) const;
+
+  /** Determine the sample neighbourhoods and their pixels. */
+  void InitializeNeighbourhoods( void ) const;
+
+  /** Ray cast the pixels of the sample neighbourhoods. */
+  void RayCastNeighbourhoods( void ) const;
 
 private:
 
   PatternIntensityImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                     // purposely not implemented
 
-  TransformMovingImageFilterPointer  m_TransformMovingImageFilter;
-  DifferenceImageFilterPointer       m_DifferenceImageFilter;
-  RescaleIntensityImageFilterPointer m_RescaleImageFilter;
-  MultiplyImageFilterPointer         m_MultiplyImageFilter;
-  double                             m_NoiseConstant;
-  unsigned int                       m_NeighborhoodRadius;
-  double                             m_DerivativeDelta;
-  double                             m_NormalizationFactor;
-  double                             m_Rescalingfactor;
-  bool                               m_OptimizeNormalizationFactor;
-  ScalesType                         m_Scales;
-  MeasureType                        m_FixedMeasure;
-  CombinationTransformPointer        m_CombinationTransform;
+  /** Compute the value for some parameters; the samples are only updated
+   * when requested, so that central differences use the same samples.
+   */
+  MeasureType ComputeValue( const TransformParametersType & parameters,
+    const bool updateSamples ) const;
+
+  /** Compute the pattern intensity, of the fixed image if st_UseMovingImage
+   * is false, for the neighbourhoods [begin, end).
+   */
+  static void ComputePIRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Ray cast the neighbourhood pixels [begin, end). */
+  static void RayCastRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Add the pattern intensities of the threads. */
+  MeasureType ComputePI( const float scalingfactor, const bool useMovingImage ) const;
+
+  /** The number of neighbourhoods or pixels processed per chunk of ParallelFor(). */
+  itkStaticConstMacro( NeighbourhoodsGrainSize, unsigned int, 16 );
+  itkStaticConstMacro( PixelsGrainSize, unsigned int, 8 );
+
+  /** The data shared by the range functions. */
+  struct PatternIntensityJobType
+  {
+    const Self * st_Metric;
+    double       st_ScalingFactor;
+    bool         st_UseMovingImage;
+  };
+
+  /** The pattern intensity sum of a thread. */
+  struct PerThreadStruct
+  {
+    double st_Measure;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, PerThreadStruct,
+    PaddedPerThreadStruct );
+
+  double       m_NoiseConstant;
+  unsigned int m_NeighborhoodRadius;
+  double       m_DerivativeDelta;
+  double       m_NormalizationFactor;
+  double       m_Rescalingfactor;
+  bool         m_OptimizeNormalizationFactor;
+  ScalesType   m_Scales;
+
+  /** The ray cast interpolator, and its transform. */
+  RayCastInterpolatorType * m_RayCastInterpolator;
+
+  /** The pattern intensity of the fixed image in the current neighbourhoods. */
+  mutable MeasureType m_FixedMeasure;
+
+  /** The buffer offsets of the pixels of all neighbourhoods, without
+   * duplicates, and the fixed and moving values of these pixels.
+   */
+  mutable std::vector< OffsetValueType > m_PixelOffsets;
+  mutable std::vector< double >          m_PixelFixedValues;
+  mutable std::vector< double >          m_PixelMovingValues;
+
+  /** For every neighbourhood: the pixel of its centre, followed by all its pixels. */
+  mutable std::vector< SizeValueType > m_NeighbourhoodPixels;
+  mutable SizeValueType                m_NumberOfNeighbourhoods;
+
+  mutable std::vector< PaddedPerThreadStruct > m_PerThreadVariables;
 
 };
 
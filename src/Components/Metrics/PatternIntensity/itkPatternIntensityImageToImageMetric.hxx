@@ -19,13 +19,10 @@
 #define __itkPatternIntensityImageToImageMetric_hxx
 
 #include "itkPatternIntensityImageToImageMetric.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkPersistentThreadPool.h"
 #include "itkNumericTraits.h"
 
-#include <iostream>
-#include <iomanip>
-#include <stdio.h>
-#include "itkSimpleFilterWatcher.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -38,6 +35,8 @@ template< class TFixedImage, class TMovingImage >
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::PatternIntensityImageToImageMetric()
 {
+  this->SetUseImageSampler( true );
+
   this->m_NormalizationFactor         = 1.0;
   this->m_Rescalingfactor             = 1.0;
   this->m_DerivativeDelta             = 0.001;
@@ -45,11 +44,8 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->m_NeighborhoodRadius          = 3;
   this->m_FixedMeasure                = 0;
   this->m_OptimizeNormalizationFactor = false;
-  this->m_TransformMovingImageFilter  = TransformMovingImageFilterType::New();
-  this->m_CombinationTransform        = CombinationTransformType::New();
-  this->m_RescaleImageFilter          = RescaleIntensityImageFilterType::New();
-  this->m_DifferenceImageFilter       = DifferenceImageFilterType::New();
-  this->m_MultiplyImageFilter         = MultiplyImageFilterType::New();
+  this->m_RayCastInterpolator         = 0;
+  this->m_NumberOfNeighbourhoods      = 0;
 
 } // end Constructor
 
@@ -66,45 +62,34 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   Superclass::Initialize();
 
   /** Resampling for 3D->2D */
-  RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
+  this->m_RayCastInterpolator = dynamic_cast< RayCastInterpolatorType * >(
     const_cast< InterpolatorType * >( this->GetInterpolator() ) );
-  if( rayCaster != 0 )
-  {
-    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
-  }
-  else
+  if( this->m_RayCastInterpolator == 0 )
   {
-    itkExceptionMacro( << "ERROR: the NormalizedGradientCorrelationImageToImageMetric is currently "
+    itkExceptionMacro( << "ERROR: the PatternIntensityImageToImageMetric is currently "
                        << "only suitable for 2D-3D registration.\n"
                        << "  Therefore it expects an interpolator of type RayCastInterpolator." );
   }
-  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
-  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
-
-  this->m_TransformMovingImageFilter->SetSize(
-    this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
-  this->m_TransformMovingImageFilter->SetOutputOrigin(
-    this->m_FixedImage->GetOrigin() );
-  this->m_TransformMovingImageFilter->SetOutputSpacing(
-    this->m_FixedImage->GetSpacing() );
-  this->m_TransformMovingImageFilter->SetOutputDirection(
-    this->m_FixedImage->GetDirection() );
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+
+  /** Estimate the normalization factor from the ray cast values of the
+   * sample neighbourhoods, instead of from the whole projection image.
+   */
+  this->BeforeThreadedGetValueAndDerivative( this->m_Transform->GetParameters() );
+  this->InitializeNeighbourhoods();
+  this->RayCastNeighbourhoods();
+
   this->ComputeFixedImageExtrema(
     this->GetFixedImage(), this->GetFixedImageRegion() );
-  this->ComputeMovingImageExtrema(
-    this->m_TransformMovingImageFilter->GetOutput(),
-    this->m_TransformMovingImageFilter->GetOutput()->GetBufferedRegion() );
-  this->m_NormalizationFactor = this->m_FixedImageTrueMax / this->m_MovingImageTrueMax;
-  this->m_MultiplyImageFilter->SetInput(
-    this->m_TransformMovingImageFilter->GetOutput() );
-  this->m_MultiplyImageFilter->SetConstant(
-    this->m_NormalizationFactor );
-  this->m_DifferenceImageFilter->SetInput1( this->m_FixedImage );
-  this->m_DifferenceImageFilter->SetInput2( this->m_MultiplyImageFilter->GetOutput() );
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
-  this->m_FixedMeasure = this->ComputePIFixed();
+  double movingMaximum = 0.0;
+  if( !this->m_PixelMovingValues.empty() )
+  {
+    movingMaximum = *std::max_element(
+      this->m_PixelMovingValues.begin(), this->m_PixelMovingValues.end() );
+  }
+  if( movingMaximum > 0.0 )
+  {
+    this->m_NormalizationFactor = this->m_FixedImageTrueMax / movingMaximum;
+  }
 
   /* to rescale the similarity measure between 0-1;*/
   MeasureType tmpmeasure = this->GetValue( this->m_Transform->GetParameters() );
@@ -118,7 +103,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ********************* Constructor ******************************PrintSelf
+ * ********************* PrintSelf ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
@@ -128,243 +113,310 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+  os << indent << "NumberOfNeighbourhoods: " << this->m_NumberOfNeighbourhoods << std::endl;
+  os << indent << "NumberOfNeighbourhoodPixels: " << this->m_PixelOffsets.size() << std::endl;
 
 } // end PrintSelf()
 
 
 /**
- * ********************* ComputePIFixed ******************************
+ * ********************* InitializeNeighbourhoods ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
-typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+void
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::ComputePIFixed() const
+::InitializeNeighbourhoods( void ) const
 {
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-  MeasureType diff    = NumericTraits< MeasureType >::Zero;
-
-  typename FixedImageType::SizeType iterationSize
-    = this->m_FixedImage->GetLargestPossibleRegion().GetSize();
-  typename FixedImageType::IndexType iterationStartIndex, currentIndex, neighborIndex;
-  typename FixedImageType::SizeType neighborIterationSize;
-  typename FixedImageType::PointType point;
-
-  iterationSize.Fill( 1 ); neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
+  /** The neighbourhood centres must lie at least the radius from the image
+   * border, in the first two dimensions.
+   */
+  const typename FixedImageType::RegionType & largestRegion
+    = this->m_FixedImage->GetLargestPossibleRegion();
+  typename FixedImageType::SizeType  iterationSize = largestRegion.GetSize();
+  typename FixedImageType::IndexType iterationStartIndex;
+  iterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
   for( unsigned int i = 0; i < 2; ++i ) // Only 2D
   {
-    iterationSize[ i ]        -= static_cast< int >( 2 * this->m_NeighborhoodRadius );
-    iterationStartIndex[ i ]   = static_cast< int >( this->m_NeighborhoodRadius );
-    neighborIterationSize[ i ] = static_cast< int >( 2 * this->m_NeighborhoodRadius ) + 1;
+    iterationSize[ i ]       = largestRegion.GetSize()[ i ] - static_cast< int >( 2 * this->m_NeighborhoodRadius );
+    iterationStartIndex[ i ] = largestRegion.GetIndex()[ i ] + static_cast< int >( this->m_NeighborhoodRadius );
   }
-
-  typename FixedImageType::RegionType iterationRegion, neighboriterationRegion;
+  typename FixedImageType::RegionType iterationRegion;
   iterationRegion.SetIndex( iterationStartIndex );
   iterationRegion.SetSize( iterationSize );
 
-  typedef  itk::ImageRegionConstIteratorWithIndex< FixedImageType > FixedImageTypeIteratorType;
-
-  FixedImageTypeIteratorType fixedImageIt( this->m_FixedImage, iterationRegion );
-  fixedImageIt.GoToBegin();
-
-  neighboriterationRegion.SetSize( neighborIterationSize );
-
-  bool sampleOK = false;
-
-  if( this->m_FixedImageMask.IsNull() )
+  /** The offsets of the neighbourhood pixels relative to the centre. */
+  const OffsetValueType          radius    = static_cast< OffsetValueType >( this->m_NeighborhoodRadius );
+  const OffsetValueType          rowStride = this->m_FixedImage->GetOffsetTable()[ 1 ];
+  std::vector< OffsetValueType > neighbourOffsets;
+  for( OffsetValueType j = -radius; j <= radius; ++j )
   {
-    sampleOK = true;
+    for( OffsetValueType i = -radius; i <= radius; ++i )
+    {
+      neighbourOffsets.push_back( j * rowStride + i );
+    }
   }
-
-  while( !fixedImageIt.IsAtEnd() )
+  const SizeValueType neighbourhoodSize = neighbourOffsets.size();
+
+  /** Collect the offsets of the centres of the valid samples. */
+  ImageSampleContainerPointer    sampleContainer = this->GetImageSampler()->GetOutput();
+  std::vector< OffsetValueType > centreOffsets;
+  centreOffsets.reserve( sampleContainer->Size() );
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  typename FixedImageType::IndexType currentIndex;
+  for( fiter = fbegin; fiter != fend; ++fiter )
   {
-    /** Get current index */
-    currentIndex = fixedImageIt.GetIndex();
-    this->m_FixedImage->TransformIndexToPhysicalPoint( currentIndex, point );
+    const FixedImagePointType & point = ( *fiter ).Value().m_ImageCoordinates;
+    if( !this->m_FixedImage->TransformPhysicalPointToIndex( point, currentIndex )
+      || !iterationRegion.IsInside( currentIndex ) )
+    {
+      continue;
+    }
 
     /** if fixedMask is given */
-    if( !this->m_FixedImageMask.IsNull() )
+    if( !this->m_FixedImageMask.IsNull() && !this->m_FixedImageMask->IsInside( point ) )
     {
-      if( this->m_FixedImageMask->IsInside( point ) )
-      {
-        sampleOK = true;
-      }
-      else
-      {
-        sampleOK = false;
-      }
+      continue;
     }
 
-    if( sampleOK )
+    centreOffsets.push_back( this->m_FixedImage->ComputeOffset( currentIndex ) );
+  }
+
+  /** Collect the pixels of all neighbourhoods, without duplicates. */
+  this->m_PixelOffsets.clear();
+  this->m_PixelOffsets.reserve( centreOffsets.size() * neighbourhoodSize );
+  for( std::size_t c = 0; c < centreOffsets.size(); ++c )
+  {
+    for( SizeValueType n = 0; n < neighbourhoodSize; ++n )
     {
-      /** setup the neighborhood iterator */
-      neighborIndex.Fill( 0 );
-      for( unsigned int i = 0; i < 2; ++i ) // 2D only
-      {
-        neighborIndex[ i ] = currentIndex[ i ] - this->m_NeighborhoodRadius;
-      }
+      this->m_PixelOffsets.push_back( centreOffsets[ c ] + neighbourOffsets[ n ] );
+    }
+  }
+  std::sort( this->m_PixelOffsets.begin(), this->m_PixelOffsets.end() );
+  this->m_PixelOffsets.erase( std::unique( this->m_PixelOffsets.begin(),
+    this->m_PixelOffsets.end() ), this->m_PixelOffsets.end() );
+
+  /** Store the pixels of every neighbourhood, with its centre first. */
+  this->m_NumberOfNeighbourhoods = centreOffsets.size();
+  this->m_NeighbourhoodPixels.resize( this->m_NumberOfNeighbourhoods * ( neighbourhoodSize + 1 ) );
+  std::vector< SizeValueType >::iterator pixelIt = this->m_NeighbourhoodPixels.begin();
+  const std::vector< OffsetValueType >::const_iterator offsetsBegin = this->m_PixelOffsets.begin();
+  const std::vector< OffsetValueType >::const_iterator offsetsEnd   = this->m_PixelOffsets.end();
+  for( std::size_t c = 0; c < centreOffsets.size(); ++c )
+  {
+    *pixelIt++ = std::lower_bound( offsetsBegin, offsetsEnd, centreOffsets[ c ] ) - offsetsBegin;
+    for( SizeValueType n = 0; n < neighbourhoodSize; ++n )
+    {
+      *pixelIt++ = std::lower_bound( offsetsBegin, offsetsEnd,
+        centreOffsets[ c ] + neighbourOffsets[ n ] ) - offsetsBegin;
+    }
+  }
 
-      neighboriterationRegion.SetIndex( neighborIndex );
-      FixedImageTypeIteratorType neighborIt( this->m_FixedImage, neighboriterationRegion );
-      neighborIt.GoToBegin();
+  /** Read the fixed image values of the pixels. */
+  const FixedImagePixelType * fixedBuffer = this->m_FixedImage->GetBufferPointer();
+  this->m_PixelFixedValues.resize( this->m_PixelOffsets.size() );
+  for( std::size_t p = 0; p < this->m_PixelOffsets.size(); ++p )
+  {
+    this->m_PixelFixedValues[ p ] = static_cast< double >( fixedBuffer[ this->m_PixelOffsets[ p ] ] );
+  }
+  this->m_PixelMovingValues.resize( this->m_PixelOffsets.size() );
 
-      while( !neighborIt.IsAtEnd() )
-      {
-        diff     = fixedImageIt.Value() - neighborIt.Value();
-        measure += ( this->m_NoiseConstant ) / ( this->m_NoiseConstant + ( diff * diff ) );
-        ++neighborIt;
-      } // end while neighborIt
+  /** The fixed image does not change, so its pattern intensity only
+   * changes with the neighbourhoods.
+   */
+  this->m_FixedMeasure = this->ComputePIFixed();
 
-    } // end if sampleOK
+} // end InitializeNeighbourhoods()
 
-    ++fixedImageIt;
-  } //end while fixedImageIt
 
-  return measure;
+/**
+ * ********************* RayCastNeighbourhoods ******************************
+ */
 
-} // end ComputePIFixed()
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::RayCastNeighbourhoods( void ) const
+{
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+
+  PatternIntensityJobType job;
+  job.st_Metric         = this;
+  job.st_ScalingFactor  = 1.0;
+  job.st_UseMovingImage = true;
+  threadPool->ParallelFor( this->m_PixelOffsets.size(), Self::PixelsGrainSize,
+    Self::RayCastRangeFunction, &job );
+
+} // end RayCastNeighbourhoods()
 
 
 /**
- * ********************* ComputePIDiff ******************************
+ * ********************* RayCastRangeFunction ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
-typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+void
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::ComputePIDiff( const TransformParametersType & parameters, float scalingfactor ) const
+::RayCastRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
+  const PatternIntensityJobType & job    = *static_cast< const PatternIntensityJobType * >( userData );
+  const Self &                    metric = *job.st_Metric;
+
+  /** Like the ResampleImageFilter did, map the pixel with the transform of
+   * the ray caster, and let the ray caster integrate along the ray.
    */
-  this->BeforeThreadedGetValueAndDerivative( parameters );
-  //this->SetTransformParameters( parameters );
-
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_MultiplyImageFilter->SetConstant( scalingfactor );
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-  MeasureType diff    = NumericTraits< MeasureType >::Zero;
-
-  typename FixedImageType::SizeType iterationSize
-    = this->m_FixedImage->GetLargestPossibleRegion().GetSize();
-  typename FixedImageType::IndexType iterationStartIndex, currentIndex, neighborIndex;
-  typename FixedImageType::SizeType neighborIterationSize;
+  const typename RayCastInterpolatorType::TransformType * transform
+    = metric.m_RayCastInterpolator->GetTransform();
   typename FixedImageType::PointType point;
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    metric.m_FixedImage->TransformIndexToPhysicalPoint(
+      metric.m_FixedImage->ComputeIndex( metric.m_PixelOffsets[ p ] ), point );
+    metric.m_PixelMovingValues[ p ] = static_cast< double >(
+      metric.m_RayCastInterpolator->Evaluate( transform->TransformPoint( point ) ) );
+  }
 
-  iterationSize.Fill( 1 ); neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
-  for( unsigned int i = 0; i < 2; ++i ) // Only 2D
+} // end RayCastRangeFunction()
+
+
+/**
+ * ********************* ComputePIRangeFunction ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePIRangeFunction( void * userData,
+  ThreadIdType participantId, SizeValueType begin, SizeValueType end )
+{
+  const PatternIntensityJobType & job    = *static_cast< const PatternIntensityJobType * >( userData );
+  const Self &                    metric = *job.st_Metric;
+
+  const double * fixedValues   = &metric.m_PixelFixedValues[ 0 ];
+  const double * movingValues  = &metric.m_PixelMovingValues[ 0 ];
+  const double   scalingFactor = job.st_UseMovingImage ? job.st_ScalingFactor : 0.0;
+  const double   noiseConstant = metric.m_NoiseConstant;
+  const SizeValueType stride   = metric.m_NeighbourhoodPixels.size() / metric.m_NumberOfNeighbourhoods;
+
+  double measure = 0.0;
+  for( SizeValueType c = begin; c < end; ++c )
   {
-    iterationSize[ i ]        -= static_cast< int >( 2 * this->m_NeighborhoodRadius );
-    iterationStartIndex[ i ]   = static_cast< int >( this->m_NeighborhoodRadius );
-    neighborIterationSize[ i ] = static_cast< int >( 2 * this->m_NeighborhoodRadius + 1 );
+    const SizeValueType * pixels = &metric.m_NeighbourhoodPixels[ c * stride ];
+    const double          centre = fixedValues[ pixels[ 0 ] ] - scalingFactor * movingValues[ pixels[ 0 ] ];
+    for( SizeValueType n = 1; n < stride; ++n )
+    {
+      const double diff = centre
+        - ( fixedValues[ pixels[ n ] ] - scalingFactor * movingValues[ pixels[ n ] ] );
+      measure += noiseConstant / ( noiseConstant + ( diff * diff ) );
+    }
   }
 
-  typename FixedImageType::RegionType iterationRegion, neighboriterationRegion;
-  iterationRegion.SetIndex( iterationStartIndex );
-  iterationRegion.SetSize( iterationSize );
+  metric.m_PerThreadVariables[ participantId ].st_Measure += measure;
+
+} // end ComputePIRangeFunction()
+
 
-  typedef itk::ImageRegionConstIteratorWithIndex< TransformedMovingImageType >
-    DifferenceImageIteratorType;
-  DifferenceImageIteratorType differenceImageIt(
-  this->m_DifferenceImageFilter->GetOutput(), iterationRegion );
-  differenceImageIt.GoToBegin();
+/**
+ * ********************* ComputePI ******************************
+ */
 
-  neighboriterationRegion.SetSize( neighborIterationSize );
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePI( const float scalingfactor, const bool useMovingImage ) const
+{
+  if( this->m_NumberOfNeighbourhoods == 0 )
+  {
+    return NumericTraits< MeasureType >::Zero;
+  }
 
-  bool sampleOK = false;
-  if( this->m_FixedImageMask.IsNull() )
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+  const ThreadIdType            numberOfThreads
+    = std::max( threadPool->GetNumberOfThreads(), static_cast< ThreadIdType >( 1 ) );
+  this->m_PerThreadVariables.resize( numberOfThreads );
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
   {
-    sampleOK = true;
+    this->m_PerThreadVariables[ t ].st_Measure = 0.0;
   }
 
-  while( !differenceImageIt.IsAtEnd() )
+  PatternIntensityJobType job;
+  job.st_Metric         = this;
+  job.st_ScalingFactor  = scalingfactor;
+  job.st_UseMovingImage = useMovingImage;
+  threadPool->ParallelFor( this->m_NumberOfNeighbourhoods, Self::NeighbourhoodsGrainSize,
+    Self::ComputePIRangeFunction, &job );
+
+  double measure = 0.0;
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
   {
-    /** Get current index */
-    currentIndex = differenceImageIt.GetIndex();
-    this->m_FixedImage->TransformIndexToPhysicalPoint( currentIndex, point );
+    measure += this->m_PerThreadVariables[ t ].st_Measure;
+  }
 
-    /** if fixedMask is given */
-    if( !this->m_FixedImageMask.IsNull() )
-    {
-      if( this->m_FixedImageMask->IsInside( point ) )
-      {
-        sampleOK = true;
-      }
-      else
-      {
-        sampleOK = false;
-      }
-    }
+  return static_cast< MeasureType >( measure );
 
-    if( sampleOK )
-    {
-      /** setup the neighborhood iterator */
-      neighborIndex.Fill( 0 );
-      for( unsigned int i = 0; i < 2; ++i ) // 2D only
-      {
-        neighborIndex[ i ] = currentIndex[ i ] - this->m_NeighborhoodRadius;
-      }
+} // end ComputePI()
 
-      neighboriterationRegion.SetIndex( neighborIndex );
-      DifferenceImageIteratorType neighborIt(
-      this->m_DifferenceImageFilter->GetOutput(), neighboriterationRegion );
-      neighborIt.GoToBegin();
 
-      while( !neighborIt.IsAtEnd() )
-      {
-        diff     = differenceImageIt.Value() - neighborIt.Value();
-        measure += this->m_NoiseConstant / ( this->m_NoiseConstant + ( diff * diff ) );
-        ++neighborIt;
-      } // end while neighborIt
+/**
+ * ********************* ComputePIFixed ******************************
+ */
 
-    } // end if sampleOK
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePIFixed() const
+{
+  return this->ComputePI( 0.0f, false );
 
-    ++differenceImageIt;
-  } // end while differenceImageIt
+} // end ComputePIFixed()
 
-  return measure;
+
+/**
+ * ********************* ComputePIDiff ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePIDiff( float scalingfactor ) const
+{
+  return this->ComputePI( scalingfactor, true );
 
 } // end ComputePIDiff()
 
 
 /**
- * ********************* GetValue ******************************
+ * ********************* ComputeValue ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
 typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::GetValue( const TransformParametersType & parameters ) const
+::ComputeValue( const TransformParametersType & parameters, const bool updateSamples ) const
 {
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
+   * For the central differences only the transform parameters change.
+   */
+  if( updateSamples )
+  {
+    this->BeforeThreadedGetValueAndDerivative( parameters );
+    this->InitializeNeighbourhoods();
+  }
+  else
+  {
+    this->SetTransformParameters( parameters );
+  }
+
+  /** The ray casting is the expensive part; the moving values are reused
+   * for all normalization factors.
    */
-  this->BeforeThreadedGetValueAndDerivative( parameters );
-  //this->SetTransformParameters( parameters );
+  this->RayCastNeighbourhoods();
 
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
   MeasureType measure        = 1e10;
   MeasureType currentMeasure = 1e10;
 
@@ -372,18 +424,16 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   {
     float tmpfactor  =  0.0;
     float factorstep =  ( this->m_NormalizationFactor * 10 - tmpfactor ) / 100;
-    //float bestfactor = tmpfactor;
     MeasureType tmpMeasure = 1e10;
 
     while( tmpfactor <=  this->m_NormalizationFactor * 1.0 )
     {
-      measure    = this->ComputePIDiff( parameters, tmpfactor );
+      measure    = this->ComputePIDiff( tmpfactor );
       tmpMeasure = ( measure - this->m_FixedMeasure ) / -this->m_Rescalingfactor;
 
       if( tmpMeasure < currentMeasure )
       {
         currentMeasure = tmpMeasure;
-        //bestfactor = tmpfactor;
       }
 
       tmpfactor += factorstep;
@@ -391,12 +441,26 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   }
   else
   {
-    measure        = this->ComputePIDiff( parameters, this->m_NormalizationFactor );
+    measure        = this->ComputePIDiff( this->m_NormalizationFactor );
     currentMeasure = -( measure - this->m_FixedMeasure ) / this->m_Rescalingfactor;
   }
 
   return currentMeasure;
 
+} // end ComputeValue()
+
+
+/**
+ * ********************* GetValue ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  return this->ComputeValue( parameters, true );
+
 } // end GetValue()
 
 
@@ -410,20 +474,8 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::GetDerivative( const TransformParametersType & parameters,
   DerivativeType & derivative ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
-  const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  derivative = DerivativeType( numberOfParameters );
-
-  for( unsigned int i = 0; i < numberOfParameters; i++ )
-  {
-    testPoint[ i ] -= this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep0 = this->GetValue( testPoint );
-    testPoint[ i ] += 2 * this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep1 = this->GetValue( testPoint );
-    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] ) );
-    testPoint[ i ]  = parameters[ i ];
-  }
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
 
 } // end GetDerivative()
 
@@ -438,8 +490,26 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & Value, DerivativeType & derivative ) const
 {
-  Value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  /** The value selects the samples, which are kept for the differences. */
+  Value = this->ComputeValue( parameters, true );
+
+  TransformParametersType testPoint;
+  testPoint = parameters;
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  derivative = DerivativeType( numberOfParameters );
+
+  for( unsigned int i = 0; i < numberOfParameters; i++ )
+  {
+    testPoint[ i ] -= this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] );
+    const MeasureType valuep0 = this->ComputeValue( testPoint, false );
+    testPoint[ i ] += 2 * this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] );
+    const MeasureType valuep1 = this->ComputeValue( testPoint, false );
+    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / vcl_sqrt( this->m_Scales[ i ] ) );
+    testPoint[ i ]  = parameters[ i ];
+  }
+
+  /** Restore the transform parameters. */
+  this->SetTransformParameters( parameters );
 
 } // end GetValueAndDerivative()
 
@@ -218,20 +218,16 @@ MeshPenalty< TFixedPointSet, TMovingPointSet >
     //zeroPoint.Fill(0.0);
     //derivPoints->resize(numberOfPoints,FixedMeshType::PointType::Point(zeroPoint));
 
-    MeshPointsContainerConstIteratorType fixedPointIt  = fixedPoints->Begin();
-    MeshPointsContainerIteratorType      mappedPointIt = mappedPoints->Begin();
-    MeshPointsContainerConstIteratorType fixedPointEnd = fixedPoints->End();
-
     //MeshPointDataContainerConstIteratorType fixedPointDataIt =fixedNormals->Begin();
     //MeshPointDataContainerIteratorType mappedPointDataIt = mappedNormals->Begin();
 
-    /* Transform all points and their normals by current transformation*/
-    for(; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++mappedPointIt )  //,++fixedPointDataIt,++mappedPointDataIt)
+    /* Transform all points by current transformation, multi-threaded */
+    //this->TransformPointNormal(fixedPointIt->Value(),  fixedPointDataIt->Value(), mappedPointDataIt->Value()  );
+    const unsigned int numberOfPoints = fixedPoints->Size();
+    if( numberOfPoints > 0 )
     {
-      const OutputPointType mappedPoint = this->m_Transform->TransformPoint( fixedPointIt->Value() );
-      mappedPointIt.Value() = mappedPoint;
-      //this->TransformPointNormal(fixedPointIt->Value(),  fixedPointDataIt->Value(), mappedPointDataIt->Value()  );
-
+      this->TransformPointsThreaded( numberOfPoints,
+        &fixedPoints->ElementAt( 0 ), &mappedPoints->ElementAt( 0 ) );
     }
   }   // End of loop over meshes
 
@@ -326,6 +326,39 @@ private:
   CoefficientImagePointer FilterSeparable( const CoefficientImageType *,
     const std::vector< NeighborhoodType > & Operators ) const;
 
+  /** A separable filter job: filter the input with one 1D operator per
+   * dimension and store the result in the (preallocated) output.
+   */
+  struct SeparableFilterJobType
+  {
+    const CoefficientImageType *            st_Input;
+    const std::vector< NeighborhoodType > * st_Operators;
+    CoefficientImageType *                  st_Output;
+  };
+
+  /** Execute a batch of separable filter jobs in a single threaded pass.
+   * The boundaries are treated with zero flux Neumann conditions, like the
+   * NeighborhoodOperatorImageFilter does.
+   */
+  void FilterSeparable( const std::vector< SeparableFilterJobType > & jobs ) const;
+
+  /** Range function filtering a range of jobs. */
+  static void FilterSeparableRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  struct FilterSeparablePassStruct
+  {
+    const Self *                                  st_Metric;
+    const std::vector< SeparableFilterJobType > * st_Jobs;
+  };
+
+  /** Get scratch image number slot, with the region and information of the
+   * reference image. The images are kept between calls and are only
+   * reallocated when the region changes, so they are not thread safe.
+   */
+  CoefficientImageType * GetScratchImage( unsigned int slot,
+    const CoefficientImageType * reference ) const;
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
   ScalarType              m_LinearityConditionWeight;
@@ -361,6 +394,10 @@ private:
   bool                               m_UseFixedRigidityImage;
   bool                               m_UseMovingRigidityImage;
 
+  /** Reused intermediate images and per-thread filter buffers. */
+  mutable std::vector< CoefficientImagePointer > m_ScratchImages;
+  mutable std::vector< std::vector< ScalarType > > m_FilterScratchBuffers;
+
 };
 
 } // end namespace itk
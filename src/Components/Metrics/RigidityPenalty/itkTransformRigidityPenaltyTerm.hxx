@@ -21,6 +21,7 @@
 #include "itkTransformRigidityPenaltyTerm.h"
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -552,18 +553,18 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** For all dimensions ... */
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
+    /** ... get the reused filtered images ... */
+    ui_FA[ i ] = this->GetScratchImage( 0 * ImageDimension + i, inputImages[ i ] );
+    ui_FB[ i ] = this->GetScratchImage( 1 * ImageDimension + i, inputImages[ i ] );
+    ui_FD[ i ] = this->GetScratchImage( 3 * ImageDimension + i, inputImages[ i ] );
+    ui_FE[ i ] = this->GetScratchImage( 4 * ImageDimension + i, inputImages[ i ] );
+    ui_FG[ i ] = this->GetScratchImage( 6 * ImageDimension + i, inputImages[ i ] );
     if( ImageDimension == 3 )
     {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
+      ui_FC[ i ] = this->GetScratchImage( 2 * ImageDimension + i, inputImages[ i ] );
+      ui_FF[ i ] = this->GetScratchImage( 5 * ImageDimension + i, inputImages[ i ] );
+      ui_FH[ i ] = this->GetScratchImage( 7 * ImageDimension + i, inputImages[ i ] );
+      ui_FI[ i ] = this->GetScratchImage( 8 * ImageDimension + i, inputImages[ i ] );
     }
     /** ... and the apropiate operators.
      * The operators C, D and E from the paper are here created
@@ -588,22 +589,28 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
+  /** Filter the inputImages, all components and operators in a single pass. */
+  std::vector< SeparableFilterJobType > filterJobs;
+  filterJobs.reserve( 9 * ImageDimension );
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
+    const std::vector< NeighborhoodType > * operators[ 9 ] = {
+      &Operators_A, &Operators_B, &Operators_C, &Operators_D, &Operators_E,
+      &Operators_F, &Operators_G, &Operators_H, &Operators_I };
+    CoefficientImageType * outputs[ 9 ] = {
+      ui_FA[ i ], ui_FB[ i ], ui_FC[ i ], ui_FD[ i ], ui_FE[ i ],
+      ui_FF[ i ], ui_FG[ i ], ui_FH[ i ], ui_FI[ i ] };
+    for( unsigned int k = 0; k < 9; k++ )
     {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
+      if( outputs[ k ] == 0 ) { continue; }
+      SeparableFilterJobType job;
+      job.st_Input     = inputImages[ i ];
+      job.st_Operators = operators[ k ];
+      job.st_Output    = outputs[ k ];
+      filterJobs.push_back( job );
     }
   }
+  this->FilterSeparable( filterJobs );
 
   /** TASK 3:
    * Create iterators.
@@ -1036,18 +1043,18 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** For all dimensions ... */
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
+    /** ... get the reused filtered images ... */
+    ui_FA[ i ] = this->GetScratchImage( 0 * ImageDimension + i, inputImages[ i ] );
+    ui_FB[ i ] = this->GetScratchImage( 1 * ImageDimension + i, inputImages[ i ] );
+    ui_FD[ i ] = this->GetScratchImage( 3 * ImageDimension + i, inputImages[ i ] );
+    ui_FE[ i ] = this->GetScratchImage( 4 * ImageDimension + i, inputImages[ i ] );
+    ui_FG[ i ] = this->GetScratchImage( 6 * ImageDimension + i, inputImages[ i ] );
     if( ImageDimension == 3 )
     {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
+      ui_FC[ i ] = this->GetScratchImage( 2 * ImageDimension + i, inputImages[ i ] );
+      ui_FF[ i ] = this->GetScratchImage( 5 * ImageDimension + i, inputImages[ i ] );
+      ui_FH[ i ] = this->GetScratchImage( 7 * ImageDimension + i, inputImages[ i ] );
+      ui_FI[ i ] = this->GetScratchImage( 8 * ImageDimension + i, inputImages[ i ] );
     }
     /** ... and the apropiate operators.
      * The operators C, D and E from the paper are here created
@@ -1072,22 +1079,28 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
+  /** Filter the inputImages, all components and operators in a single pass. */
+  std::vector< SeparableFilterJobType > filterJobs;
+  filterJobs.reserve( 9 * ImageDimension );
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
+    const std::vector< NeighborhoodType > * operators[ 9 ] = {
+      &Operators_A, &Operators_B, &Operators_C, &Operators_D, &Operators_E,
+      &Operators_F, &Operators_G, &Operators_H, &Operators_I };
+    CoefficientImageType * outputs[ 9 ] = {
+      ui_FA[ i ], ui_FB[ i ], ui_FC[ i ], ui_FD[ i ], ui_FE[ i ],
+      ui_FF[ i ], ui_FG[ i ], ui_FH[ i ], ui_FI[ i ] };
+    for( unsigned int k = 0; k < 9; k++ )
     {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
+      if( outputs[ k ] == 0 ) { continue; }
+      SeparableFilterJobType job;
+      job.st_Input     = inputImages[ i ];
+      job.st_Operators = operators[ k ];
+      job.st_Output    = outputs[ k ];
+      filterJobs.push_back( job );
     }
   }
+  this->FilterSeparable( filterJobs );
 
   /** TASK 3:
    * Create subparts and iterators.
@@ -1136,12 +1149,10 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     PCparts[ i ].resize( ImageDimension );
     for( unsigned int j = 0; j < ImageDimension; j++ )
     {
-      OCparts[ i ][ j ] = CoefficientImageType::New();
-      OCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      OCparts[ i ][ j ]->Allocate();
-      PCparts[ i ][ j ] = CoefficientImageType::New();
-      PCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      PCparts[ i ][ j ]->Allocate();
+      OCparts[ i ][ j ] = this->GetScratchImage(
+        9 * ImageDimension + i * ImageDimension + j, inputImages[ 0 ] );
+      PCparts[ i ][ j ] = this->GetScratchImage(
+        9 * ImageDimension + ( ImageDimension + i ) * ImageDimension + j, inputImages[ 0 ] );
     }
   }
 
@@ -1153,9 +1164,8 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     LCparts[ i ].resize( NofLParts );
     for( unsigned int j = 0; j < NofLParts; j++ )
     {
-      LCparts[ i ][ j ] = CoefficientImageType::New();
-      LCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      LCparts[ i ][ j ]->Allocate();
+      LCparts[ i ][ j ] = this->GetScratchImage(
+        9 * ImageDimension + 2 * ImageDimension * ImageDimension + i * NofLParts + j, inputImages[ 0 ] );
     }
   }
 
@@ -1809,15 +1819,12 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   std::vector< CoefficientImagePointer > LCpartsF( ImageDimension );
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    OCpartsF[ i ] = CoefficientImageType::New();
-    OCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    OCpartsF[ i ]->Allocate();
-    PCpartsF[ i ] = CoefficientImageType::New();
-    PCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    PCpartsF[ i ]->Allocate();
-    LCpartsF[ i ] = CoefficientImageType::New();
-    LCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    LCpartsF[ i ]->Allocate();
+    OCpartsF[ i ] = this->GetScratchImage(
+      ( 6 + 5 * ImageDimension ) * ImageDimension + 3 * i + 0, inputImages[ 0 ] );
+    PCpartsF[ i ] = this->GetScratchImage(
+      ( 6 + 5 * ImageDimension ) * ImageDimension + 3 * i + 1, inputImages[ 0 ] );
+    LCpartsF[ i ] = this->GetScratchImage(
+      ( 6 + 5 * ImageDimension ) * ImageDimension + 3 * i + 2, inputImages[ 0 ] );
   }
 
   /** Create neighborhood iterators over the subparts. */
@@ -2069,9 +2076,8 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   std::vector< CoefficientImagePointer > derivativeImages( ImageDimension );
   for( unsigned int i = 0; i < ImageDimension; i++ )
   {
-    derivativeImages[ i ] = CoefficientImageType::New();
-    derivativeImages[ i ]->SetRegions( inputImages[ i ]->GetLargestPossibleRegion() );
-    derivativeImages[ i ]->Allocate();
+    derivativeImages[ i ] = this->GetScratchImage(
+      ( 9 + 5 * ImageDimension ) * ImageDimension + i, inputImages[ i ] );
   }
 
   /** Create iterators over the derivative images. */
@@ -2392,28 +2398,164 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   const CoefficientImageType * image,
   const std::vector< NeighborhoodType > & Operators ) const
 {
-  /** Create filters, supply them with boundary conditions and operators. */
-  std::vector< typename NOIFType::Pointer > filters( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  /** Create the output image. */
+  CoefficientImagePointer output = CoefficientImageType::New();
+  output->CopyInformation( image );
+  output->SetRegions( image->GetLargestPossibleRegion() );
+  output->Allocate();
+
+  /** Filter it as a batch of one job. */
+  std::vector< SeparableFilterJobType > jobs( 1 );
+  jobs[ 0 ].st_Input     = image;
+  jobs[ 0 ].st_Operators = &Operators;
+  jobs[ 0 ].st_Output    = output;
+  this->FilterSeparable( jobs );
+
+  /** Return the filtered image. */
+  return output;
+
+} // end FilterSeparable()
+
+
+/**
+ * ********************* FilterSeparable (batch) *****************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::FilterSeparable( const std::vector< SeparableFilterJobType > & jobs ) const
+{
+  /** Make sure every participating thread owns a scratch line buffer. */
+  const ThreadIdType numberOfParticipants = this->m_UseMultiThread
+    ? PersistentThreadPool::GetInstance()->GetNumberOfThreads() : 1;
+  if( this->m_FilterScratchBuffers.size() < numberOfParticipants )
   {
-    filters[ i ] = NOIFType::New();
-    filters[ i ]->SetOperator( Operators[ i ] );
+    this->m_FilterScratchBuffers.resize( numberOfParticipants );
   }
 
-  /** Set up the mini-pipline. */
-  filters[ 0 ]->SetInput( image );
-  for( unsigned int i = 1; i < ImageDimension; i++ )
+  /** Filter the jobs, which are independent of each other. */
+  FilterSeparablePassStruct pass;
+  pass.st_Metric = this;
+  pass.st_Jobs   = &jobs;
+  if( this->m_UseMultiThread )
   {
-    filters[ i ]->SetInput( filters[ i - 1 ]->GetOutput() );
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      jobs.size(), 1, Self::FilterSeparableRangeFunction, &pass );
+  }
+  else
+  {
+    Self::FilterSeparableRangeFunction( &pass, 0, 0, jobs.size() );
   }
 
-  /** Execute the mini-pipeline. */
-  filters[ ImageDimension - 1 ]->Update();
+} // end FilterSeparable()
 
-  /** Return the filtered image. */
-  return filters[ ImageDimension - 1 ]->GetOutput();
 
-} // end FilterSeparable()
+/**
+ * ****************** FilterSeparableRangeFunction ***************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::FilterSeparableRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  const FilterSeparablePassStruct * pass
+    = static_cast< const FilterSeparablePassStruct * >( userData );
+  std::vector< ScalarType > & buffer
+    = pass->st_Metric->m_FilterScratchBuffers[ participantId ];
+
+  for( SizeValueType jobId = begin; jobId < end; ++jobId )
+  {
+    const SeparableFilterJobType & job = ( *pass->st_Jobs )[ jobId ];
+    const typename CoefficientImageType::SizeType size
+      = job.st_Input->GetLargestPossibleRegion().GetSize();
+    const SizeValueType numberOfPixels
+      = job.st_Input->GetLargestPossibleRegion().GetNumberOfPixels();
+    if( buffer.size() < numberOfPixels )
+    {
+      buffer.resize( numberOfPixels );
+    }
+
+    /** Apply the 1D operators one dimension at a time, alternating between
+     * the output and the scratch buffer, such that the last pass ends up
+     * in the output.
+     */
+    const ScalarType * source = job.st_Input->GetBufferPointer();
+    for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+      ScalarType * target = ( ( ImageDimension - 1 - d ) % 2 == 0 )
+        ? job.st_Output->GetBufferPointer() : &buffer[ 0 ];
+
+      /** The operator has radius 1 along dimension d only. */
+      const NeighborhoodType & op = ( *job.st_Operators )[ d ];
+      const ScalarType f0 = op[ 0 ];
+      const ScalarType f1 = op[ 1 ];
+      const ScalarType f2 = op[ 2 ];
+
+      SizeValueType stride = 1;
+      for( unsigned int k = 0; k < d; k++ )
+      {
+        stride *= size[ k ];
+      }
+      const SizeValueType n      = size[ d ];
+      const SizeValueType blocks = numberOfPixels / ( stride * n );
+
+      for( SizeValueType block = 0; block < blocks; ++block )
+      {
+        for( SizeValueType inner = 0; inner < stride; ++inner )
+        {
+          const ScalarType * in  = source + block * stride * n + inner;
+          ScalarType *       out = target + block * stride * n + inner;
+
+          /** Zero flux Neumann boundaries: clamp to the first / last pixel. */
+          for( SizeValueType k = 0; k < n; ++k )
+          {
+            const SizeValueType left  = k > 0 ? k - 1 : 0;
+            const SizeValueType right = k + 1 < n ? k + 1 : n - 1;
+            out[ k * stride ] = f0 * in[ left * stride ]
+              + f1 * in[ k * stride ] + f2 * in[ right * stride ];
+          }
+        }
+      }
+      source = target;
+    }
+  }
+
+} // end FilterSeparableRangeFunction()
+
+
+/**
+ * *********************** GetScratchImage ***********************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::CoefficientImageType *
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetScratchImage( unsigned int slot, const CoefficientImageType * reference ) const
+{
+  if( this->m_ScratchImages.size() <= slot )
+  {
+    this->m_ScratchImages.resize( slot + 1 );
+  }
+
+  /** Only (re)allocate when the region changed. */
+  CoefficientImagePointer & image = this->m_ScratchImages[ slot ];
+  const typename CoefficientImageType::RegionType & region
+    = reference->GetLargestPossibleRegion();
+  if( image.IsNull() || image->GetBufferedRegion() != region )
+  {
+    image = CoefficientImageType::New();
+    image->SetRegions( region );
+    image->Allocate();
+  }
+  image->CopyInformation( reference );
+
+  return image.GetPointer();
+
+} // end GetScratchImage()
+
 
 
 /**
@@ -44,6 +44,11 @@ using namespace itk;
  * \parameter BaseVariance: The width ($\sigma_0^2$) of the non-informative prior.
  *   Can be defined for each resolution\n
  *    example: <tt>(BaseVariance 1000.0)</tt>
+ * \parameter MaximumShapeModelRank: The maximum number of eigenmodes of the shape
+ *   model that are used by the ShapeModelCalculation options 1 and 2. The modes
+ *   with the largest eigenvalues are kept, which makes the evaluation cheaper for
+ *   shape models with many points. 0 means that all modes are used. Default: 0.\n
+ *    example: <tt>(MaximumShapeModelRank 20)</tt>
  *
  * \author F.F. Berendsen, Image Sciences Institute, UMC Utrecht, The Netherlands
  * \note This work was funded by the projects Care4Me and Mediate.
@@ -70,6 +70,11 @@ StatisticalShapePenalty< TElastix >
   this->GetConfiguration()->ReadParameter( shapeModelCalculation, "ShapeModelCalculation", 0, 0 );
   this->SetShapeModelCalculation( shapeModelCalculation );
 
+  /** Get and set MaximumShapeModelRank. Default 0, i.e. all modes. */
+  unsigned int maximumShapeModelRank = 0;
+  this->GetConfiguration()->ReadParameter( maximumShapeModelRank, "MaximumShapeModelRank", 0, 0 );
+  this->SetMaximumShapeModelRank( maximumShapeModelRank );
+
   /** Read and set the fixed pointset. */
   std::string fixedName = this->GetConfiguration()->GetCommandLineArgument( "-fp" );
   typename PointSetType::Pointer fixedPointSet      = 0;
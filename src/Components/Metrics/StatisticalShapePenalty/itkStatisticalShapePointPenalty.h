@@ -36,6 +36,7 @@
 
 #include <vcl_iostream.h>
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -165,6 +166,15 @@ public:
   itkGetConstReferenceMacro( NormalizedShapeModel, bool );
   itkBooleanMacro( NormalizedShapeModel );
 
+  /** Set/Get the maximum number of eigenmodes of the shape model, for the
+   * ShapeModelCalculation options 1 and 2. The eigendecomposition is computed
+   * in Initialize(), and only the modes with the largest eigenvalues are kept,
+   * so that the penalty is evaluated by a projection on these modes. Zero
+   * keeps all modes with a non-zero eigenvalue. Default: 0.
+   */
+  itkSetMacro( MaximumShapeModelRank, unsigned int );
+  itkGetConstMacro( MaximumShapeModelRank, unsigned int );
+
   itkSetConstObjectMacro( EigenVectors, vnl_matrix< double > );
   itkSetConstObjectMacro( EigenValues, vnl_vector< double > );
   itkSetConstObjectMacro( MeanVector, vnl_vector< double > );
@@ -184,8 +194,8 @@ private:
   StatisticalShapePointPenalty( const Self & );  // purposely not implemented
   void operator=( const Self & );                // purposely not implemented
 
-  void FillProposalVector( const OutputPointType & fixedPoint,
-    const unsigned int vertexindex ) const;
+  /** Transforms all fixed points, multi-threaded, and copies them in the proposal vector. */
+  void FillProposalVector( void ) const;
 
   void FillProposalDerivative( const OutputPointType & fixedPoint,
     const unsigned int vertexindex ) const;
@@ -222,6 +232,10 @@ private:
 
   VnlMatrixType * m_InverseCovarianceMatrix;
 
+  std::vector< InputPointType >          m_FixedPoints;
+  mutable std::vector< OutputPointType > m_MappedPoints;
+  unsigned int                           m_MaximumShapeModelRank;
+
   double m_CentroidXVariance;
   double m_CentroidXStd;
   double m_CentroidYVariance;
@@ -20,6 +20,8 @@
 
 #include "itkStatisticalShapePointPenalty.h"
 
+#include <algorithm>
+
 namespace itk
 {
 /**
@@ -36,6 +38,7 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   this->m_EigenValuesRegularized  = NULL;
   this->m_ProposalDerivative      = NULL;
   this->m_InverseCovarianceMatrix = NULL;
+  this->m_MaximumShapeModelRank   = 0;
 
   this->m_ShrinkageIntensityNeedsUpdate = true;
   this->m_BaseVarianceNeedsUpdate       = true;
@@ -103,8 +106,18 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   /** Call the initialize of the superclass. */
   this->Superclass::Initialize();
 
+  /** Copy the fixed points to an array, for the batched transformation. */
+  FixedPointSetConstPointer fixedPointSet = this->GetFixedPointSet();
+  this->m_FixedPoints.resize( fixedPointSet->GetNumberOfPoints() );
+  this->m_MappedPoints.resize( fixedPointSet->GetNumberOfPoints() );
+  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
+  for( std::size_t i = 0; i < this->m_FixedPoints.size(); ++i, ++pointItFixed )
+  {
+    this->m_FixedPoints[ i ] = pointItFixed.Value();
+  }
+
   const unsigned int shapeLength = Self::FixedPointSetDimension
-    * this->GetFixedPointSet()->GetNumberOfPoints();
+    * fixedPointSet->GetNumberOfPoints();
   if( this->m_NormalizedShapeModel )
   {
     this->m_ProposalLength = shapeLength + Self::FixedPointSetDimension + 1;
@@ -194,6 +207,13 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
       unsigned int nonZeroLength = 0;
       for(; lambdaIt != lambdaEnd && ( *lambdaIt ) > 1e-14; ++lambdaIt, ++nonZeroLength )
       {}
+
+      /** Truncate the model to the modes with the largest eigenvalues. */
+      if( this->m_MaximumShapeModelRank > 0 )
+      {
+        nonZeroLength = std::min( nonZeroLength, this->m_MaximumShapeModelRank );
+      }
+
       if( this->m_EigenValues != NULL )
       {
         delete this->m_EigenValues;
@@ -287,6 +307,12 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
         for(; lambdaIt != lambdaEnd && ( *lambdaIt ) > 1e-14; ++lambdaIt, ++nonZeroLength )
         {}
 
+        /** Truncate the model to the modes with the largest eigenvalues. */
+        if( this->m_MaximumShapeModelRank > 0 )
+        {
+          nonZeroLength = std::min( nonZeroLength, this->m_MaximumShapeModelRank );
+        }
+
         if( this->m_EigenValues != NULL )
         {
           delete this->m_EigenValues;
@@ -366,9 +392,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   //this->m_NumberOfPointsCounted = 0;
   MeasureType value = NumericTraits< MeasureType >::Zero;
 
-  //InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
@@ -379,22 +402,8 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   /** Part 1:
    * - Copy point positions in proposal vector
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd     = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  this->FillProposalVector();
+  this->m_NumberOfPointsCounted += fixedPointSet->GetNumberOfPoints();
 
   if( this->m_NormalizedShapeModel )
   {
@@ -485,6 +494,7 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
    * - Copy point positions in proposal vector
    * - Copy point derivatives in proposal derivative vector
    */
+  this->FillProposalVector();
 
   /** Create iterators. */
   PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
@@ -495,7 +505,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   while( pointItFixed != pointEnd )
   {
     fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
     this->FillProposalDerivative( fixedPoint, vertexindex );
 
     this->m_NumberOfPointsCounted++;
@@ -568,18 +577,23 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::FillProposalVector( const OutputPointType & fixedPoint,
-  const unsigned int vertexindex ) const
+::FillProposalVector( void ) const
 {
-  OutputPointType mappedPoint;
   /** Get the current corresponding points. */
-  mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
+  this->TransformPointsThreaded( this->m_FixedPoints.size(),
+    &this->m_FixedPoints[ 0 ], &this->m_MappedPoints[ 0 ] );
 
   /** Copy n-D coordinates into big Shape vector. Aligning the centroids is done later. */
-  for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+  unsigned int vertexindex = 0;
+  for( std::size_t i = 0; i < this->m_MappedPoints.size(); ++i )
   {
-    this->m_ProposalVector[ vertexindex + d ] = mappedPoint[ d ];
+    for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+    {
+      this->m_ProposalVector[ vertexindex + d ] = this->m_MappedPoints[ i ][ d ];
+    }
+    vertexindex += Self::FixedPointSetDimension;
   }
+
 } // end FillProposalVector()
 
 
@@ -877,10 +891,60 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 ::CalculateDerivative( DerivativeType & derivative,
   const MeasureType & value,
   const VnlVectorType & differenceVector,
-  const VnlVectorType & centerrotated,
+  const VnlVectorType & itkNotUsed( centerrotated ),
   const VnlVectorType & eigrot,
   const unsigned int shapeLength ) const
 {
+  /** The derivative of the value with respect to mu is
+   * diff^T * Sigma^-1 * d/dmu (diff) / value. The vector diff^T * Sigma^-1 is
+   * the same for all mu-s, so it is computed once, after which every mu only
+   * costs an inner product with the proposal derivative.
+   */
+  VnlVectorType gradient;
+  switch( this->m_ShapeModelCalculation )
+  {
+    case 0: // full covariance
+    {
+      /** diff^T * Sigma^-1 */
+      gradient = differenceVector * ( *this->m_InverseCovarianceMatrix );
+      break;
+    }
+    case 1: // decomposed covariance (uniform regularization)
+    {
+      /** diff^T * V * Lambda^-1 * V^T  +  1/(Beta*sigma_0^2)*diff^T */
+      gradient = ( *this->m_EigenVectors ) * eigrot;
+      if( this->m_ShrinkageIntensity != 0 )
+      {
+        gradient += differenceVector / ( this->m_ShrinkageIntensity * this->m_BaseVariance );
+      }
+      break;
+    }
+    case 2: // decomposed scaled covariance (element specific regularization)
+    {
+      /** diff^T * V * Lambda^-1 * V^T  +  1/(Beta)*diff^T, in the scaled space. */
+      gradient = ( *this->m_EigenVectors ) * eigrot;
+      if( this->m_ShrinkageIntensity != 0 )
+      {
+        gradient += differenceVector / this->m_ShrinkageIntensity;
+      }
+
+      /** Scale back with the sigma's, instead of scaling all proposal derivatives. */
+      typename VnlVectorType::iterator gradientElementIt = gradient.begin();
+      for( unsigned int gradientElementIndex = 0; gradientElementIndex < shapeLength;
+        ++gradientElementIndex, ++gradientElementIt )
+      {
+        ( *gradientElementIt ) /= this->m_BaseStd;
+      }
+      gradient[ shapeLength     ] /= this->m_CentroidXStd;
+      gradient[ shapeLength + 1 ] /= this->m_CentroidYStd;
+      gradient[ shapeLength + 2 ] /= this->m_CentroidZStd;
+      gradient[ shapeLength + 3 ] /= this->m_SizeStd;
+      break;
+    }
+    default:
+      break;
+  }
+
   typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
   typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
 
@@ -890,75 +954,13 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   {
     if( *proposalDerivativeIt != NULL )
     {
-      switch( this->m_ShapeModelCalculation )
+      if( gradient.size() > 0 )
       {
-        case 0: // full covariance
-        {
-          /**innerproduct diff^T * Sigma^-1 * d/dmu (diff), where iterated over mu-s*/
-          *derivativeIt = bracket( differenceVector, *m_InverseCovarianceMatrix, ( **proposalDerivativeIt ) ) / value;
-          this->CalculateCutOffDerivative( *derivativeIt, value );
-          break;
-        }
-        case 1: // decomposed covariance (uniform regularization)
-        {
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** Innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / ( this->m_ShrinkageIntensity * this->m_BaseVariance ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        case 2: // decomposed scaled covariance (element specific regularization)
-        {
-          // first scale proposalDerivatives with their sigma's in order to evaluate
-          // with the EigenValues and EigenVectors of the scaled CovarianceMatrix
-          typename VnlVectorType::iterator propDerivElementIt = ( *proposalDerivativeIt )->begin();
-          for( unsigned int propDerivElementIndex = 0; propDerivElementIndex < shapeLength;
-            ++propDerivElementIndex, ++propDerivElementIt )
-          {
-            ( *propDerivElementIt ) /= this->m_BaseStd;
-          }
-          ( **proposalDerivativeIt )[ shapeLength     ] /= this->m_CentroidXStd;
-          ( **proposalDerivativeIt )[ shapeLength + 1 ] /= this->m_CentroidYStd;
-          ( **proposalDerivativeIt )[ shapeLength + 2 ] /= this->m_CentroidZStd;
-          ( **proposalDerivativeIt )[ shapeLength + 3 ] /= this->m_SizeStd;
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / this->m_ShrinkageIntensity ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        default:
-        {}
-
-          delete ( *proposalDerivativeIt );
-          // nzjacs++;
+        /** innerproduct diff^T * Sigma^-1 * d/dmu (diff), where iterated over mu-s */
+        *derivativeIt = dot_product( gradient, **proposalDerivativeIt ) / value;
+        this->CalculateCutOffDerivative( *derivativeIt, value );
       }
+      delete ( *proposalDerivativeIt );
     }
   }
 
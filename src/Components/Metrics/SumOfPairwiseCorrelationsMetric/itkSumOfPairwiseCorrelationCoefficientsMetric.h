@@ -102,6 +102,12 @@ public:
     Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+  typedef typename DerivativeType::ValueType              DerivativeValueType;
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
+
+  typedef vnl_matrix< RealType > MatrixType;
+  typedef vnl_vector< RealType > VectorType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -119,6 +125,9 @@ public:
     DerivativeType & derivative ) const;
 
   /** Get value and derivatives for multiple valued optimizers. */
+  void GetValueAndDerivativeSingleThreaded( const TransformParametersType & parameters,
+    MeasureType & Value, DerivativeType & Derivative ) const;
+
   virtual void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType & Value, DerivativeType & Derivative ) const;
 
@@ -131,7 +140,7 @@ public:
 protected:
 
   SumOfPairwiseCorrelationCoefficientsMetric();
-  virtual ~SumOfPairwiseCorrelationCoefficientsMetric() {}
+  virtual ~SumOfPairwiseCorrelationCoefficientsMetric();
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
   /** Protected Typedefs ******************/
@@ -158,6 +167,62 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian ) const;
 
+  /** The multi-threaded computation consists of two passes over the samples.
+   * In the first pass every thread collects the intensities of its valid
+   * samples, and their mean and pairwise co-moment matrix. These are merged
+   * in AfterThreadedGetSamples(), which also computes the metric value and the
+   * matrices that the derivative needs. In the second pass, the
+   * ThreadedGetValueAndDerivative() of the superclass scheme, every thread
+   * computes the derivative contributions of its own samples.
+   */
+  struct SumOfPairwiseCorrelationsMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+
+  SumOfPairwiseCorrelationsMultiThreaderParameterType m_SumOfPairwiseCorrelationsThreaderParameters;
+
+  struct SumOfPairwiseCorrelationsGetSamplesPerThreadStruct
+  {
+    SizeValueType                      st_NumberOfPixelsCounted;
+    MatrixType                         st_DataBlock;
+    std::vector< FixedImagePointType > st_ApprovedSamples;
+    VectorType                         st_Mean;
+    MatrixType                         st_CoMoments;
+  };
+
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, SumOfPairwiseCorrelationsGetSamplesPerThreadStruct,
+    PaddedSumOfPairwiseCorrelationsGetSamplesPerThreadStruct );
+
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT,
+    PaddedSumOfPairwiseCorrelationsGetSamplesPerThreadStruct,
+    AlignedSumOfPairwiseCorrelationsGetSamplesPerThreadStruct );
+
+  mutable AlignedSumOfPairwiseCorrelationsGetSamplesPerThreadStruct * m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables;
+  mutable ThreadIdType                                                m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariablesSize;
+
+  /** Collect the samples of a thread. */
+  inline void ThreadedGetSamples( ThreadIdType threadID );
+
+  /** Merge the samples of all threads and compute the metric value. */
+  inline void AfterThreadedGetSamples( MeasureType & value ) const;
+
+  /** Compute the derivative contributions of the samples of a thread. */
+  inline void ThreadedGetValueAndDerivative( ThreadIdType threadID );
+
+  /** Gather the derivatives from all threads. */
+  inline void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE GetSamplesThreaderCallback( void * arg );
+
+  /** Helper function to launch the threads. */
+  void LaunchGetSamplesThreaderCallback( void ) const;
+
+  /** Initialize some multi-threading related parameters. */
+  virtual void InitializeThreadingParameters( void ) const;
+
 private:
 
   SumOfPairwiseCorrelationCoefficientsMetric( const Self & ); // purposely not implemented
@@ -179,6 +244,18 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** Results of AfterThreadedGetSamples(), needed for the derivative.
+   * m_S holds the inverse standard deviations, m_KS = K S, and
+   * m_dSdmuPart1 and m_KSAtAdiagonal the factors of the derivative of S.
+   */
+  mutable unsigned int m_G;
+  mutable VectorType   m_Mean;
+  mutable VectorType   m_S;
+  mutable MatrixType   m_KS;
+  mutable VectorType   m_dSdmuPart1;
+  mutable VectorType   m_KSAtAdiagonal;
+  mutable RealType     m_KFrobeniusNorm;
+
 };
 
 } // end namespace itk
@@ -35,14 +35,35 @@ template< class TFixedImage, class TMovingImage >
 SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 ::SumOfPairwiseCorrelationCoefficientsMetric() :
   m_SubtractMean( true ),
-  m_TransformIsStackTransform( true )
+  m_TransformIsStackTransform( true ),
+  m_G( 0 ),
+  m_KFrobeniusNorm( 0.0 )
 {
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
+
+  // Multi-threading structs
+  this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables     = NULL;
+  this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariablesSize = 0;
+
+  /** Initialize the m_SumOfPairwiseCorrelationsThreaderParameters. */
+  this->m_SumOfPairwiseCorrelationsThreaderParameters.m_Metric = this;
 } // end constructor
 
 
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::~SumOfPairwiseCorrelationCoefficientsMetric()
+{
+  delete[] this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables;
+} // end Destructor
+
+
 /**
  * ******************* Initialize *******************
  */
@@ -70,6 +91,37 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ********************* InitializeThreadingParameters ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the derivative structs of the superclass. */
+  Superclass::InitializeThreadingParameters();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariablesSize != this->m_NumberOfThreads )
+  {
+    delete[] this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables;
+    this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables
+      = new AlignedSumOfPairwiseCorrelationsGetSamplesPerThreadStruct[ this->m_NumberOfThreads ];
+    this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariablesSize = this->m_NumberOfThreads;
+  }
+
+  /** Some initialization. */
+  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  {
+    this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
+    this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables[ i ].st_ApprovedSamples.clear();
+  }
+
+} // end InitializeThreadingParameters()
+
+
 /**
  * ******************* SampleRandom *******************
  */
@@ -149,6 +201,18 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 {
   itkDebugMacro( "GetValue( " << parameters << " ) " );
 
+  /** The multi-threaded computation of the value only needs the first pass. */
+  if( this->m_UseMultiThread )
+  {
+    this->BeforeThreadedGetValueAndDerivative( parameters );
+    this->InitializeThreadingParameters();
+    this->LaunchGetSamplesThreaderCallback();
+
+    MeasureType value = NumericTraits< MeasureType >::Zero;
+    this->AfterThreadedGetSamples( value );
+    return value;
+  }
+
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
@@ -310,13 +374,13 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ******************* GetValueAndDerivative *******************
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
-::GetValueAndDerivative( const TransformParametersType & parameters,
+::GetValueAndDerivativeSingleThreaded( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
   itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
@@ -612,9 +676,528 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
   /** Return the measure value. */
   value = measure;
 
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if( !this->m_UseMultiThread )
+  {
+    return this->GetValueAndDerivativeSingleThreaded(
+      parameters, value, derivative );
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  this->InitializeThreadingParameters();
+
+  /** Launch multi-threading GetSamples */
+  this->LaunchGetSamplesThreaderCallback();
+
+  /** Merge the sample moments of all threads and compute the value. */
+  this->AfterThreadedGetSamples( value );
+
+  /** Launch multi-threading derivative computation. */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Sum derivative contributions from all threads. */
+  this->AfterThreadedGetValueAndDerivative( value, derivative );
+
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* ThreadedGetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::ThreadedGetSamples( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( vcl_ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( this->m_NumberOfThreads ) ) );
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+  threader_fbegin                                                 += (int)pos_begin;
+  threader_fend                                                   += (int)pos_end;
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** The rows of the data block contain the samples of the images of the stack.
+   * The block is kept between iterations, so it is only reallocated when
+   * the number of samples changes.
+   */
+  SumOfPairwiseCorrelationsGetSamplesPerThreadStruct & threadVariables
+    = this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables[ threadId ];
+  MatrixType &                         datablock = threadVariables.st_DataBlock;
+  std::vector< FixedImagePointType > & SamplesOK = threadVariables.st_ApprovedSamples;
+  if( datablock.rows() != nrOfSamplesPerThreads || datablock.cols() != G )
+  {
+    datablock.set_size( nrOfSamplesPerThreads, G );
+  }
+
+  unsigned int pixelIndex = 0;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  {
+    /** Read fixed coordinates. */
+    const FixedImagePointType & samplePoint = ( *threader_fiter ).Value().m_ImageCoordinates;
+    FixedImagePointType         fixedPoint;
+
+    /** Transform sampled point to voxel coordinates. */
+    FixedImageContinuousIndexType voxelCoord;
+    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( samplePoint, voxelCoord );
+
+    unsigned int numSamplesOk = 0;
+
+    /** Loop over t */
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      /** Initialize some variables. */
+      RealType             movingImageValue;
+      MovingImagePointType mappedPoint;
+
+      /** Set fixed point's last dimension to lastDimPosition. */
+      voxelCoord[ lastDim ] = d;
+
+      /** Transform sampled point back to world coordinates. */
+      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+      /** Check if point is inside mask. */
+      if( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      if( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, 0 );
+      }
+
+      if( !sampleOk )
+      {
+        break;
+      }
+
+      numSamplesOk++;
+      datablock( pixelIndex, d ) = movingImageValue;
+
+    } // end loop over t
+
+    if( numSamplesOk == G )
+    {
+      SamplesOK.push_back( samplePoint );
+      pixelIndex++;
+    }
+
+  } // end loop over image sample container
+
+  /** Compute the mean and the pairwise co-moments of the samples of this
+   * thread. Centering with the mean of the thread keeps the sums accurate.
+   */
+  VectorType & mean      = threadVariables.st_Mean;
+  MatrixType & coMoments = threadVariables.st_CoMoments;
+  mean.set_size( G );
+  mean.fill( NumericTraits< RealType >::Zero );
+  coMoments.set_size( G, G );
+  coMoments.fill( NumericTraits< RealType >::Zero );
+  if( pixelIndex > 0 )
+  {
+    for( unsigned int i = 0; i < pixelIndex; ++i )
+    {
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        mean[ j ] += datablock( i, j );
+      }
+    }
+    mean /= static_cast< RealType >( pixelIndex );
+
+    VectorType centered( G );
+    for( unsigned int i = 0; i < pixelIndex; ++i )
+    {
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        centered[ j ] = datablock( i, j ) - mean[ j ];
+      }
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        const RealType cj = centered[ j ];
+        for( unsigned int k = 0; k <= j; ++k )
+        {
+          coMoments( j, k ) += cj * centered[ k ];
+        }
+      }
+    }
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  threadVariables.st_NumberOfPixelsCounted = pixelIndex;
+
+} // end ThreadedGetSamples()
+
+
+/**
+ * ******************* AfterThreadedGetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetSamples( MeasureType & value ) const
+{
+  typedef vnl_matrix< DerivativeValueType > DerivativeMatrixType;
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+  this->m_G = G;
+
+  /** Merge the means and co-moments of the threads, in thread order, with
+   * the pairwise update formula of Chan et al.:
+   *   M = M_a + M_b + (mean_b - mean_a)(mean_b - mean_a)^T n_a n_b / n.
+   */
+  SizeValueType N = 0;
+  VectorType &  mean = this->m_Mean;
+  MatrixType    coMoments( G, G );
+  mean.set_size( G );
+  mean.fill( NumericTraits< RealType >::Zero );
+  coMoments.fill( NumericTraits< RealType >::Zero );
+  VectorType delta( G );
+  for( ThreadIdType i = 0; i < this->m_NumberOfThreads; ++i )
+  {
+    const SumOfPairwiseCorrelationsGetSamplesPerThreadStruct & threadVariables
+      = this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables[ i ];
+    const SizeValueType Nb = threadVariables.st_NumberOfPixelsCounted;
+    if( Nb == 0 )
+    {
+      continue;
+    }
+
+    const SizeValueType Na     = N;
+    const SizeValueType Nab    = Na + Nb;
+    const RealType      weight = static_cast< RealType >( Na ) * static_cast< RealType >( Nb )
+      / static_cast< RealType >( Nab );
+    delta = threadVariables.st_Mean - mean;
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      for( unsigned int k = 0; k <= j; ++k )
+      {
+        coMoments( j, k ) += threadVariables.st_CoMoments( j, k ) + weight * delta[ j ] * delta[ k ];
+      }
+    }
+    mean += delta * ( static_cast< RealType >( Nb ) / static_cast< RealType >( Nab ) );
+    N     = Nab;
+  }
+  for( unsigned int j = 0; j < G; ++j )
+  {
+    for( unsigned int k = 0; k < j; ++k )
+    {
+      coMoments( k, j ) = coMoments( j, k );
+    }
+  }
+  this->m_NumberOfPixelsCounted = N;
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(
+    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+
+  /** Compute the covariance and correlation matrices. */
+  MatrixType C( coMoments );
+  C /= static_cast< RealType >( RealType( N ) - 1.0 );
+
+  vnl_diag_matrix< RealType > S( G );
+  for( unsigned int j = 0; j < G; j++ )
+  {
+    S( j, j ) = 1.0 / sqrt( C( j, j ) );
+  }
+
+  DerivativeMatrixType K( S * C * S );
+  this->m_KFrobeniusNorm = K.fro_norm();
+
+  value = RealType( 1.0 - ( this->m_KFrobeniusNorm / RealType( G ) ) );
+
+  /** Precompute the G x G factors of the derivative, so that the threads
+   * only need the row of a sample:
+   *   (K S Amm^T)[d][i]   = sum_k KS[d][k] Amm[i][k],
+   *   (K S Amm^T Amm)[d][d] = sum_k KS[d][k] M[k][d].
+   */
+  this->m_S.set_size( G );
+  this->m_dSdmuPart1.set_size( G );
+  this->m_KSAtAdiagonal.set_size( G );
+  this->m_KS = K * S;
+  for( unsigned int d = 0; d < G; d++ )
+  {
+    const double S_sqr = S( d, d ) * S( d, d );
+    const double S_qub = S_sqr * S( d, d );
+    this->m_S[ d ]          = S( d, d );
+    this->m_dSdmuPart1[ d ] = -S_qub / ( DerivativeValueType( N ) - 1.0 );
+
+    RealType diagonal = NumericTraits< RealType >::Zero;
+    for( unsigned int k = 0; k < G; k++ )
+    {
+      diagonal += this->m_KS( d, k ) * coMoments( k, d );
+    }
+    this->m_KSAtAdiagonal[ d ] = diagonal;
+  }
+
+} // end AfterThreadedGetSamples()
+
+
+/**
+ * **************** GetSamplesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::GetSamplesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->ThreadID;
+
+  SumOfPairwiseCorrelationsMultiThreaderParameterType * temp
+    = static_cast< SumOfPairwiseCorrelationsMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGetSamples( threadId );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetSamplesThreaderCallback()
+
+
+/**
+ * *********************** LaunchGetSamplesThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::LaunchGetSamplesThreaderCallback( void ) const
+{
+  /** Launch on the persistent thread pool, like the superclass does. */
+  PersistentThreadPool::GetInstance()->SingleMethodExecute(
+    this->m_NumberOfThreads, this->GetSamplesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_SumOfPairwiseCorrelationsThreaderParameters ) ) );
+
+} // end LaunchGetSamplesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** The derivative of this thread, zeroed by InitializeThreadingParameters(). */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  const SumOfPairwiseCorrelationsGetSamplesPerThreadStruct & threadVariables
+    = this->m_SumOfPairwiseCorrelationsGetSamplesPerThreadVariables[ threadId ];
+  const MatrixType & datablock = threadVariables.st_DataBlock;
+
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->m_G;
+
+  /** Create variables to store intermediate results in. */
+  RealType                   movingImageValue;
+  MovingImagePointType       mappedPoint;
+  MovingImageDerivativeType  movingImageDerivative;
+  TransformJacobianType      jacobian;
+  DerivativeType             imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  NonZeroJacobianIndicesType nzjis( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  VectorType                 Amm( G );
+
+  /** Second loop over the approved samples of this thread. */
+  for( unsigned int pixelIndex = 0; pixelIndex < threadVariables.st_NumberOfPixelsCounted; ++pixelIndex )
+  {
+    /** The mean-subtracted intensities of this sample. */
+    for( unsigned int k = 0; k < G; ++k )
+    {
+      Amm[ k ] = datablock( pixelIndex, k ) - this->m_Mean[ k ];
+    }
+
+    /** Transform sampled point to voxel coordinates. */
+    FixedImagePointType           fixedPoint = threadVariables.st_ApprovedSamples[ pixelIndex ];
+    FixedImageContinuousIndexType voxelCoord;
+    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      /** Set fixed point's last dimension to lastDimPosition. */
+      voxelCoord[ lastDim ] = d;
+
+      /** Transform sampled point back to world coordinates. */
+      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+      this->TransformPoint( fixedPoint, mappedPoint );
+
+      this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+
+      /** Get the TransformJacobian dT/dmu */
+      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis );
+
+      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+      this->EvaluateTransformJacobianInnerProduct(
+        jacobian, movingImageDerivative, imageJacobian );
+
+      /** The factor does not depend on the parameter. */
+      DerivativeValueType KSAmm = 0.0;
+      for( unsigned int k = 0; k < G; ++k )
+      {
+        KSAmm += this->m_KS( d, k ) * Amm[ k ];
+      }
+      const DerivativeValueType factor = KSAmm * this->m_S[ d ]
+        + this->m_dSdmuPart1[ d ] * Amm[ d ] * this->m_KSAtAdiagonal[ d ];
+
+      /** build metric derivative components */
+      for( unsigned int p = 0; p < nzjis.size(); ++p )
+      {
+        derivative[ nzjis[ p ] ] += factor * imageJacobian[ p ];
+      } // end loop over non-zero jacobian indices
+
+    } // end loop over t
+
+  } // end second loop over sample container
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & itkNotUsed( value ), DerivativeType & derivative ) const
+{
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->m_G;
+  const SizeValueType N      = this->m_NumberOfPixelsCounted;
+
+  /** Sum the derivatives of the threads, in thread order. */
+  derivative = this->m_GetValueAndDerivativePerThreadVariables[ 0 ].st_Derivative;
+  for( ThreadIdType i = 1; i < this->m_NumberOfThreads; ++i )
+  {
+    derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
+  }
+
+  derivative *= -static_cast< DerivativeValueType >( 2.0 )
+    / ( static_cast< DerivativeValueType >( N
+    - static_cast< DerivativeValueType >( 1.0 ) ) * ( this->m_KFrobeniusNorm * RealType( G ) ) ); //normalize
+
+  /** Subtract mean from derivative elements. */
+  if( this->m_SubtractMean )
+  {
+    if( !this->m_TransformIsStackTransform )
+    {
+      /** Update derivative per dimension.
+       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+       * per dimension xyz.
+       */
+      const unsigned int lastDimGridSize = this->m_GridSize[ lastDim ];
+      const unsigned int numParametersPerDimension
+        = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+      DerivativeType     mean( numControlPointsPerDimension );
+      for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
+      {
+        /** Compute mean per dimension. */
+        mean.Fill( 0.0 );
+        const unsigned int starti = numParametersPerDimension * d;
+        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+        {
+          const unsigned int index = i % numControlPointsPerDimension;
+          mean[ index ] += derivative[ i ];
+        }
+        mean /= static_cast< double >( lastDimGridSize );
+
+        /** Update derivative for every control point per dimension. */
+        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+        {
+          const unsigned int index = i % numControlPointsPerDimension;
+          derivative[ i ] -= mean[ index ];
+        }
+      }
+    }
+    else
+    {
+      /** Update derivative per dimension.
+       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+       * the number the time point index.
+       */
+      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
+      DerivativeType     mean( numParametersPerLastDimension );
+      mean.Fill( 0.0 );
+
+      /** Compute mean per control point. */
+      for( unsigned int t = 0; t < G; ++t )
+      {
+        const unsigned int startc = numParametersPerLastDimension * t;
+        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+        {
+          const unsigned int index = c % numParametersPerLastDimension;
+          mean[ index ] += derivative[ c ];
+        }
+      }
+      mean /= static_cast< double >( G );
+
+      /** Update derivative per control point. */
+      for( unsigned int t = 0; t < G; ++t )
+      {
+        const unsigned int startc = numParametersPerLastDimension * t;
+        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+        {
+          const unsigned int index = c % numParametersPerLastDimension;
+          derivative[ c ] -= mean[ index ];
+        }
+      }
+    }
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
 } // end namespace itk
 
 #endif // __itkSumOfPairwiseCorrelationCoefficientsMetric_HXX__
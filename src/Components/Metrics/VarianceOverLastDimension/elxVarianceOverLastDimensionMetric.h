@@ -58,6 +58,11 @@ namespace elastix
  * \parameter SubtractMean: subtract the over time computed mean parameter value from
  *    each parameter. This should be used when registration is performed directly on the moving
  *    image, without using a fixed image. Possible values are "true" or "false".
+ * \parameter UseBatchedLastDimensionEvaluation: map the points of all time points of a
+ *    sample in one batched call to the transform, and distribute the samples over the
+ *    threads. Can be given for each resolution. \n
+ *    example: <tt>(UseBatchedLastDimensionEvaluation "true")</tt> \n
+ *    Default is "false".
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -125,6 +125,12 @@ VarianceOverLastDimensionMetric< TElastix >
     this->GetComponentLabel(), 0, 0 );
   this->SetReducedDimensionIndex( reducedDimensionIndex );
 
+  /** Get and set the batched and threaded evaluation of the time points. */
+  bool useBatchedLastDimensionEvaluation = false;
+  this->GetConfiguration()->ReadParameter( useBatchedLastDimensionEvaluation,
+    "UseBatchedLastDimensionEvaluation", this->GetComponentLabel(), level, 0 );
+  this->SetUseBatchedLastDimensionEvaluation( useBatchedLastDimensionEvaluation );
+
   /** Check if this transform is a B-spline transform. */
   CombinationTransformType * testPtr1
     = dynamic_cast< CombinationTransformType * >( this->GetElastix()->GetElxTransformBase() );
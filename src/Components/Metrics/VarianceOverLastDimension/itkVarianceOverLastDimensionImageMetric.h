@@ -44,6 +44,12 @@ namespace itk
  * or by nearest neighbor interpolation of a precomputed central difference image.
  * \li A minimum number of samples that should map within the moving image (mask) can be specified.
  *
+ * With UseBatchedLastDimensionEvaluation the points of all last dimension
+ * positions of a spatial sample are mapped in one batched TransformPoints()
+ * call, which lets a StackTransform pass them to its sub-transforms in one go,
+ * and the spatial samples are distributed over the threads of the
+ * PersistentThreadPool, each accumulating its own variance partials.
+ *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
  */
@@ -78,10 +84,12 @@ public:
   itkSetMacro( SubtractMean, bool );
   itkSetMacro( GridSize, FixedImageSizeType );
   itkSetMacro( TransformIsStackTransform, bool );
+  itkSetMacro( UseBatchedLastDimensionEvaluation, bool );
 
   /** Get functions. */
   itkGetConstMacro( SampleLastDimensionRandomly, bool );
   itkGetConstMacro( NumSamplesLastDimension, int );
+  itkGetConstMacro( UseBatchedLastDimensionEvaluation, bool );
 
   /** Typedefs from the superclass. */
   typedef typename
@@ -190,6 +198,36 @@ private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void SampleRandom( const int n, const int m, std::vector< int > & numbers ) const;
 
+  /** Compute the sum of variances, the number of valid samples and,
+   * optionally, the derivative with the batched and threaded implementation.
+   * The results are not normalized.
+   */
+  void ComputeBatched( MeasureType & measure, DerivativeType * derivative ) const;
+
+  /** The data shared by the threads of ComputeBatched(). */
+  struct BatchedPassStruct
+  {
+    const Self *                     st_Metric;
+    const ImageSampleContainerType * st_Samples;
+    const std::vector< int > *       st_LastDimPositions;
+    unsigned int                     st_NumberOfPositions;
+    bool                             st_RandomPositions;
+    bool                             st_ComputeDerivative;
+  };
+
+  /** The partial results of a thread. */
+  struct BatchedPerThreadStruct
+  {
+    SizeValueType  st_NumberOfPixelsCounted;
+    MeasureType    st_Value;
+    DerivativeType st_Derivative;
+    bool           st_DerivativeIsInitialized;
+  };
+
+  /** Process a range of spatial samples. */
+  static void BatchedRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
   /** Variables to control random sampling in last dimension. */
   bool         m_SampleLastDimensionRandomly;
   unsigned int m_NumSamplesLastDimension;
@@ -208,6 +246,10 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** Batched and threaded evaluation of the last dimension positions. */
+  bool                                          m_UseBatchedLastDimensionEvaluation;
+  mutable std::vector< BatchedPerThreadStruct > m_BatchedPerThreadVariables;
+
 };
 
 } // end namespace itk
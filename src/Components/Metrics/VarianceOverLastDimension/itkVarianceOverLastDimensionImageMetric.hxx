@@ -21,6 +21,7 @@
 #include "itkVarianceOverLastDimensionImageMetric.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "vnl/algo/vnl_matrix_update.h"
+#include "itkPersistentThreadPool.h"
 #include <numeric>
 
 namespace itk
@@ -36,7 +37,8 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
   m_SampleLastDimensionRandomly( false ),
   m_NumSamplesLastDimension( 10 ),
   m_SubtractMean( false ),
-  m_TransformIsStackTransform( false )
+  m_TransformIsStackTransform( false ),
+  m_UseBatchedLastDimensionEvaluation( false )
 {
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
@@ -192,6 +194,207 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateTransformJacobianInnerProduct()
 
 
+/**
+ * ******************* ComputeBatched *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ComputeBatched( MeasureType & measure, DerivativeType * derivative ) const
+{
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const SizeValueType         numberOfSamples = sampleContainer->Size();
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim     = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** Determine the last dimension positions up front, in sample order, so
+   * the random generator is not used by the threads and draws the same
+   * positions as the sequential implementation.
+   */
+  std::vector< int > lastDimPositions;
+  unsigned int       numberOfPositions = lastDimSize;
+  if( this->m_SampleLastDimensionRandomly )
+  {
+    numberOfPositions = this->m_NumSamplesLastDimension + this->m_NumAdditionalSamplesFixed;
+    lastDimPositions.reserve( numberOfSamples * numberOfPositions );
+    std::vector< int > positions;
+    for( SizeValueType i = 0; i < numberOfSamples; ++i )
+    {
+      this->SampleRandom( this->m_NumSamplesLastDimension, lastDimSize, positions );
+      lastDimPositions.insert( lastDimPositions.end(), positions.begin(), positions.end() );
+    }
+  }
+  else
+  {
+    for( unsigned int i = 0; i < lastDimSize; ++i )
+    {
+      lastDimPositions.push_back( i );
+    }
+  }
+
+  /** Reset the partial results of the threads. */
+  const ThreadIdType numberOfParticipants = this->m_UseMultiThread
+    ? this->GetNumberOfParallelForBlocks() : 1;
+  this->m_BatchedPerThreadVariables.resize( numberOfParticipants );
+  for( ThreadIdType t = 0; t < numberOfParticipants; ++t )
+  {
+    this->m_BatchedPerThreadVariables[ t ].st_NumberOfPixelsCounted   = 0;
+    this->m_BatchedPerThreadVariables[ t ].st_Value                   = NumericTraits< MeasureType >::Zero;
+    this->m_BatchedPerThreadVariables[ t ].st_DerivativeIsInitialized = false;
+  }
+
+  BatchedPassStruct pass;
+  pass.st_Metric            = this;
+  pass.st_Samples           = sampleContainer.GetPointer();
+  pass.st_LastDimPositions  = &lastDimPositions;
+  pass.st_NumberOfPositions = numberOfPositions;
+  pass.st_RandomPositions   = this->m_SampleLastDimensionRandomly;
+  pass.st_ComputeDerivative = derivative != 0;
+  if( this->m_UseMultiThread )
+  {
+    this->ParallelForBlocks( numberOfSamples, Self::BatchedRangeFunction, &pass );
+  }
+  else
+  {
+    Self::BatchedRangeFunction( &pass, 0, 0, numberOfSamples );
+  }
+
+  /** Gather the partial results. */
+  this->m_NumberOfPixelsCounted = 0;
+  for( ThreadIdType t = 0; t < numberOfParticipants; ++t )
+  {
+    const BatchedPerThreadStruct & partial = this->m_BatchedPerThreadVariables[ t ];
+    this->m_NumberOfPixelsCounted += partial.st_NumberOfPixelsCounted;
+    measure                       += partial.st_Value;
+    if( derivative != 0 && partial.st_DerivativeIsInitialized )
+    {
+      *derivative += partial.st_Derivative;
+    }
+  }
+
+} // end ComputeBatched()
+
+
+/**
+ * ******************* BatchedRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::BatchedRangeFunction( void * userData, ThreadIdType participantId,
+  SizeValueType begin, SizeValueType end )
+{
+  typedef typename DerivativeType::ValueType DerivativeValueType;
+
+  const BatchedPassStruct * pass = static_cast< const BatchedPassStruct * >( userData );
+  const Self *              self = pass->st_Metric;
+  BatchedPerThreadStruct &  out  = self->m_BatchedPerThreadVariables[ participantId ];
+
+  const unsigned int lastDim           = self->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int numberOfPositions = pass->st_NumberOfPositions;
+  const bool         computeDerivative = pass->st_ComputeDerivative;
+
+  if( computeDerivative && !out.st_DerivativeIsInitialized )
+  {
+    out.st_Derivative.SetSize( self->GetNumberOfParameters() );
+    out.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    out.st_DerivativeIsInitialized = true;
+  }
+
+  /** Buffers for the points of all last dimension positions of a sample. */
+  std::vector< FixedImagePointType >        fixedPoints( numberOfPositions );
+  std::vector< MovingImagePointType >       mappedPoints( numberOfPositions );
+  std::vector< FixedImagePointType >        validPoints( numberOfPositions );
+  std::vector< RealType >                   MT( numberOfPositions );
+  std::vector< MovingImageDerivativeType >  movingImageDerivatives( numberOfPositions );
+  std::vector< TransformJacobianType >      jacobians( computeDerivative ? numberOfPositions : 0 );
+  std::vector< NonZeroJacobianIndicesType > nzjis( computeDerivative ? numberOfPositions : 0 );
+  DerivativeType                            imageJacobian( self->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+
+  SizeValueType numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    /** Read fixed coordinates and the last dimension positions. */
+    const FixedImagePointType & samplePoint = pass->st_Samples->ElementAt( i ).m_ImageCoordinates;
+    const int *                 positions   = &( *pass->st_LastDimPositions )[
+      pass->st_RandomPositions ? i * numberOfPositions : 0 ];
+
+    /** Create the fixed points of all positions and map them in one go. */
+    FixedImageContinuousIndexType voxelCoord;
+    self->GetFixedImage()->TransformPhysicalPointToContinuousIndex( samplePoint, voxelCoord );
+    for( unsigned int d = 0; d < numberOfPositions; ++d )
+    {
+      voxelCoord[ lastDim ] = positions[ d ];
+      self->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoints[ d ] );
+    }
+    self->m_AdvancedTransform->TransformPoints( numberOfPositions, &fixedPoints[ 0 ], &mappedPoints[ 0 ] );
+
+    /** Evaluate the moving image at the mapped points. */
+    float        sumValues        = 0.0;
+    float        sumValuesSquared = 0.0;
+    unsigned int numSamplesOk     = 0;
+    for( unsigned int d = 0; d < numberOfPositions; ++d )
+    {
+      RealType movingImageValue;
+      bool     sampleOk = self->IsInsideMovingMask( mappedPoints[ d ] );
+      if( sampleOk )
+      {
+        sampleOk = self->EvaluateMovingImageValueAndDerivative( mappedPoints[ d ], movingImageValue,
+          computeDerivative ? &movingImageDerivatives[ numSamplesOk ] : 0 );
+      }
+
+      if( sampleOk )
+      {
+        sumValues                  += movingImageValue;
+        sumValuesSquared           += movingImageValue * movingImageValue;
+        MT[ numSamplesOk ]          = movingImageValue;
+        validPoints[ numSamplesOk ] = fixedPoints[ d ];
+        numSamplesOk++;
+      }
+    }
+
+    if( numSamplesOk == 0 )
+    {
+      continue;
+    }
+    numberOfPixelsCounted++;
+
+    /** Add this variance to the variance sum. */
+    const float expectedValue        = sumValues / static_cast< float >( numSamplesOk );
+    const float expectedSquaredValue = sumValuesSquared / static_cast< float >( numSamplesOk );
+    measure += expectedSquaredValue - expectedValue * expectedValue;
+
+    /** Update the derivative, with the Jacobians of the valid points. */
+    if( computeDerivative )
+    {
+      self->m_AdvancedTransform->GetJacobians( numSamplesOk, &validPoints[ 0 ], &jacobians[ 0 ], &nzjis[ 0 ] );
+      for( unsigned int d = 0; d < numSamplesOk; ++d )
+      {
+        self->EvaluateTransformJacobianInnerProduct(
+          jacobians[ d ], movingImageDerivatives[ d ], imageJacobian );
+        const DerivativeValueType weight
+          = 2.0 * ( MT[ d ] - expectedValue ) / static_cast< float >( numSamplesOk );
+        for( unsigned int j = 0; j < nzjis[ d ].size(); ++j )
+        {
+          out.st_Derivative[ nzjis[ d ][ j ] ] += weight * imageJacobian[ j ];
+        }
+      }
+    }
+  } // end for loop over the samples
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  out.st_NumberOfPixelsCounted += numberOfPixelsCounted;
+  out.st_Value                 += measure;
+
+} // end BatchedRangeFunction()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -225,6 +428,17 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
+  /** The batched and threaded implementation. */
+  if( this->m_UseBatchedLastDimensionEvaluation )
+  {
+    this->ComputeBatched( measure, 0 );
+    this->CheckNumberOfSamples(
+      sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+    measure /= static_cast< float >( this->m_NumberOfPixelsCounted );
+    measure /= this->m_InitialVariance;
+    return measure;
+  }
+
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
@@ -415,124 +629,132 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
     }
   }
 
-  /** Create variables to store intermediate results in. */
-  TransformJacobianType jacobian;
-  DerivativeType        imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-
-  /** Get real last dim samples. */
-  const unsigned int realNumLastDimPositions
-    = this->m_SampleLastDimensionRandomly
-    ? this->m_NumSamplesLastDimension + this->m_NumAdditionalSamplesFixed
-    : lastDimSize;
+  /** The batched and threaded implementation. */
+  if( this->m_UseBatchedLastDimensionEvaluation )
+  {
+    this->ComputeBatched( measure, &derivative );
+  }
+  else
+  {
+    /** Create variables to store intermediate results in. */
+    TransformJacobianType jacobian;
+    DerivativeType        imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
 
-  /** Variable to store and nzjis. */
-  std::vector< NonZeroJacobianIndicesType > nzjis(
-  realNumLastDimPositions, NonZeroJacobianIndicesType() );
+    /** Get real last dim samples. */
+    const unsigned int realNumLastDimPositions
+      = this->m_SampleLastDimensionRandomly
+      ? this->m_NumSamplesLastDimension + this->m_NumAdditionalSamplesFixed
+      : lastDimSize;
 
-  std::vector< RealType >       MT( realNumLastDimPositions );
-  std::vector< DerivativeType > dMTdmu( realNumLastDimPositions );
+    /** Variable to store and nzjis. */
+    std::vector< NonZeroJacobianIndicesType > nzjis(
+    realNumLastDimPositions, NonZeroJacobianIndicesType() );
 
-  /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    std::vector< RealType >       MT( realNumLastDimPositions );
+    std::vector< DerivativeType > dMTdmu( realNumLastDimPositions );
 
-    /** Determine random last dimension positions if needed. */
-    if( this->m_SampleLastDimensionRandomly )
+    /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
+    for( fiter = fbegin; fiter != fend; ++fiter )
     {
-      this->SampleRandom( this->m_NumSamplesLastDimension, lastDimSize, lastDimPositions );
-    }
+      /** Read fixed coordinates. */
+      FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
 
-    /** Initialize MT vector. */
-    std::fill( MT.begin(), MT.end(), itk::NumericTraits< RealType >::ZeroValue() );
+      /** Determine random last dimension positions if needed. */
+      if( this->m_SampleLastDimensionRandomly )
+      {
+        this->SampleRandom( this->m_NumSamplesLastDimension, lastDimSize, lastDimPositions );
+      }
 
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+      /** Initialize MT vector. */
+      std::fill( MT.begin(), MT.end(), itk::NumericTraits< RealType >::ZeroValue() );
 
-    /** Loop over the slowest varying dimension. */
-    float        sumValues        = 0.0;
-    float        sumValuesSquared = 0.0;
-    unsigned int numSamplesOk     = 0;
-
-    /** First loop over t: compute M(T(x,t)), dM(T(x,t))/dmu, nzji and store. */
-    for( unsigned int d = 0; d < realNumLastDimPositions; ++d )
-    {
-      /** Initialize some variables. */
-      RealType                  movingImageValue;
-      MovingImagePointType      mappedPoint;
-      MovingImageDerivativeType movingImageDerivative;
+      /** Transform sampled point to voxel coordinates. */
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
 
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = lastDimPositions[ d ];
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
-      /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      /** Loop over the slowest varying dimension. */
+      float        sumValues        = 0.0;
+      float        sumValuesSquared = 0.0;
+      unsigned int numSamplesOk     = 0;
 
-      /** Check if point is inside mask. */
-      if( sampleOk )
+      /** First loop over t: compute M(T(x,t)), dM(T(x,t))/dmu, nzji and store. */
+      for( unsigned int d = 0; d < realNumLastDimPositions; ++d )
       {
-        sampleOk = this->IsInsideMovingMask( mappedPoint );
-      }
+        /** Initialize some variables. */
+        RealType                  movingImageValue;
+        MovingImagePointType      mappedPoint;
+        MovingImageDerivativeType movingImageDerivative;
+
+        /** Set fixed point's last dimension to lastDimPosition. */
+        voxelCoord[ lastDim ] = lastDimPositions[ d ];
+        /** Transform sampled point back to world coordinates. */
+        this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+        /** Transform point and check if it is inside the B-spline support region. */
+        bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+        /** Check if point is inside mask. */
+        if( sampleOk )
+        {
+          sampleOk = this->IsInsideMovingMask( mappedPoint );
+        }
 
-      /** Compute the moving image value and check if the point is
-      * inside the moving image buffer. */
-      if( sampleOk )
-      {
-        sampleOk = this->EvaluateMovingImageValueAndDerivative(
-          mappedPoint, movingImageValue, &movingImageDerivative );
-      }
+        /** Compute the moving image value and check if the point is
+        * inside the moving image buffer. */
+        if( sampleOk )
+        {
+          sampleOk = this->EvaluateMovingImageValueAndDerivative(
+            mappedPoint, movingImageValue, &movingImageDerivative );
+        }
 
-      if( sampleOk )
-      {
-        /** Update value terms **/
-        numSamplesOk++;
-        sumValues        += movingImageValue;
-        sumValuesSquared += movingImageValue * movingImageValue;
+        if( sampleOk )
+        {
+          /** Update value terms **/
+          numSamplesOk++;
+          sumValues        += movingImageValue;
+          sumValuesSquared += movingImageValue * movingImageValue;
 
-        /** Get the TransformJacobian dT/dmu. */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis[ d ] );
+          /** Get the TransformJacobian dT/dmu. */
+          this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis[ d ] );
 
-        /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
-        this->EvaluateTransformJacobianInnerProduct(
-          jacobian, movingImageDerivative, imageJacobian );
+          /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+          this->EvaluateTransformJacobianInnerProduct(
+            jacobian, movingImageDerivative, imageJacobian );
 
-        /** Store values. */
-        MT[ d ]     = movingImageValue;
-        dMTdmu[ d ] = imageJacobian;
+          /** Store values. */
+          MT[ d ]     = movingImageValue;
+          dMTdmu[ d ] = imageJacobian;
+        }
+        else
+        {
+          dMTdmu[ d ] = DerivativeType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+          dMTdmu[ d ].Fill( itk::NumericTraits< DerivativeValueType >::ZeroValue() );
+          nzjis[ d ] = NonZeroJacobianIndicesType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 0 );
+        } // end if sampleOk
       }
-      else
+
+      if( numSamplesOk > 0 )
       {
-        dMTdmu[ d ] = DerivativeType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-        dMTdmu[ d ].Fill( itk::NumericTraits< DerivativeValueType >::ZeroValue() );
-        nzjis[ d ] = NonZeroJacobianIndicesType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 0 );
-      } // end if sampleOk
-    }
+        this->m_NumberOfPixelsCounted++;
 
-    if( numSamplesOk > 0 )
-    {
-      this->m_NumberOfPixelsCounted++;
+        /** Compute average intensity value. */
+        const float expectedValue = sumValues / static_cast< float >( numSamplesOk );
+        /** Add this variance to the variance sum. */
+        const float expectedSquaredValue = sumValuesSquared / static_cast< float >( numSamplesOk );
+        measure += expectedSquaredValue - expectedValue * expectedValue;
 
-      /** Compute average intensity value. */
-      const float expectedValue = sumValues / static_cast< float >( numSamplesOk );
-      /** Add this variance to the variance sum. */
-      const float expectedSquaredValue = sumValuesSquared / static_cast< float >( numSamplesOk );
-      measure += expectedSquaredValue - expectedValue * expectedValue;
-
-      /** Second loop over t: update derivative. */
-      for( unsigned int d = 0; d < realNumLastDimPositions; ++d )
-      {
-        for( unsigned int j = 0; j < nzjis[ d ].size(); ++j )
+        /** Second loop over t: update derivative. */
+        for( unsigned int d = 0; d < realNumLastDimPositions; ++d )
         {
-          derivative[ nzjis[ d ][ j ] ] += ( 2.0 * ( MT[ d ] - expectedValue ) * dMTdmu[ d ][ j ] )
-            / static_cast< float >( numSamplesOk );
+          for( unsigned int j = 0; j < nzjis[ d ].size(); ++j )
+          {
+            derivative[ nzjis[ d ][ j ] ] += ( 2.0 * ( MT[ d ] - expectedValue ) * dMTdmu[ d ][ j ] )
+              / static_cast< float >( numSamplesOk );
+          }
         }
-      }
 
-    }
-  } // end for loop over the image sample container
+      }
+    } // end for loop over the image sample container
+  } // end if batched
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
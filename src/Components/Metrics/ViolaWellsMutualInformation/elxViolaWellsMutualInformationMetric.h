@@ -19,28 +19,33 @@
 #define __elxViolaWellsMutualInformationMetric_H__
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkMutualInformationImageToImageMetric.h"
+#include "itkAdvancedViolaWellsMutualInformationImageToImageMetric.h"
 
 namespace elastix
 {
 
 /**
  * \class ViolaWellsMutualInformationMetric
- * \brief A metric based on the itk::MutualInformationImageToImageMetric.
+ * \brief A metric based on the itk::AdvancedViolaWellsMutualInformationImageToImageMetric.
  *
  * \warning: this metric is not very well tested in elastix.
- * \warning: this metric is not based on the AdvancedImageToImageMetric so
- * does not support the ImageSampler framework and might be very slow in
- * combination with B-spline transform.
- * \warning: this metric uses stochastic sampling of the images. Do not use
- * a quasi-Newton optimizer or a conjugate gradient. The StandardGradientDescent
- * is a better choice.
+ * \warning: the cost of this metric grows quadratically with the number of
+ * samples; use a ParzenWindowCutOff for large numbers of samples.
+ * \warning: with a random image sampler, do not use a quasi-Newton optimizer
+ * or a conjugate gradient. The StandardGradientDescent is a better choice.
+ *
+ * The ImageSampler is optional. Without it, the metric takes
+ * NumberOfSpatialSamples new random samples for each of its two sample sets
+ * in every iteration, as before. With an ImageSampler, its samples are split
+ * over the two sets, so each set gets half of them, and NumberOfSpatialSamples
+ * is not used.
  *
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "ViolaWellsMutualInformation")</tt>
  * \parameter NumberOfSpatialSamples: for each resolution the number of samples
- *    used to calculate this metrics value and its derivative. \n
+ *    of each of the two sample sets, used to calculate this metrics value and
+ *    its derivative, if no ImageSampler is given. \n
  *    example: <tt>(NumberOfSpatialSamples 5000 5000 10000)</tt> \n
  *    The default is 10000 for each resolution.
  * \parameter FixedImageStandardDeviation: for each resolution the standard
@@ -51,15 +56,19 @@ namespace elastix
  *    deviation of the moving image. \n
  *    example: <tt>(MovingImageStandardDeviation 1.3 1.9 1.0)</tt> \n
  *    The default is 0.4 for each resolution.
+ * \parameter ParzenWindowCutOff: for each resolution the number of standard
+ *    deviations beyond which sample pairs are ignored. \n
+ *    example: <tt>(ParzenWindowCutOff 4.0)</tt> \n
+ *    The default is 0.0 for each resolution, which evaluates all pairs.
  *
- * \sa MutualInformationImageToImageMetric
+ * \sa AdvancedViolaWellsMutualInformationImageToImageMetric
  * \ingroup Metrics
  */
 
 template< class TElastix >
 class ViolaWellsMutualInformationMetric :
   public
-  itk::MutualInformationImageToImageMetric<
+  itk::AdvancedViolaWellsMutualInformationImageToImageMetric<
   typename MetricBase< TElastix >::FixedImageType,
   typename MetricBase< TElastix >::MovingImageType >,
   public MetricBase< TElastix >
@@ -68,7 +77,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef ViolaWellsMutualInformationMetric Self;
-  typedef itk::MutualInformationImageToImageMetric<
+  typedef itk::AdvancedViolaWellsMutualInformationImageToImageMetric<
     typename MetricBase< TElastix >::FixedImageType,
     typename MetricBase< TElastix >::MovingImageType >    Superclass1;
   typedef MetricBase< TElastix >          Superclass2;
@@ -80,7 +89,7 @@ public:
 
   /** Run-time type information (and related methods). */
   itkTypeMacro( ViolaWellsMutualInformationMetric,
-    itk::MutualInformationImageToImageMetric );
+    itk::AdvancedViolaWellsMutualInformationImageToImageMetric );
 
   /** Name of this class.
    * Use this name in the parameter file to select this specific metric. \n
@@ -89,22 +98,17 @@ public:
   elxClassNameMacro( "ViolaWellsMutualInformation" );
 
   /** Typedefs inherited from the superclass. */
-  typedef typename Superclass1::TransformType            TransformType;
-  typedef typename Superclass1::TransformPointer         TransformPointer;
-  typedef typename Superclass1::TransformJacobianType    TransformJacobianType;
-  typedef typename Superclass1::InterpolatorType         InterpolatorType;
-  typedef typename Superclass1::MeasureType              MeasureType;
-  typedef typename Superclass1::DerivativeType           DerivativeType;
-  typedef typename Superclass1::ParametersType           ParametersType;
-  typedef typename Superclass1::FixedImageType           FixedImageType;
-  typedef typename Superclass1::MovingImageType          MovingImageType;
-  typedef typename Superclass1::FixedImageConstPointer   FixedImageConstPointer;
-  typedef typename Superclass1::MovingImageConstPointer  MovingImageCosntPointer;
-  typedef typename Superclass1::FixedImageIndexType      FixedImageIndexType;
-  typedef typename Superclass1::FixedImageIndexValueType FixedImageIndexValueType;
-  typedef typename Superclass1::MovingImageIndexType     MovingImageIndexType;
-  typedef typename Superclass1::FixedImagePointType      FixedImagePointType;
-  typedef typename Superclass1::MovingImagePointType     MovingImagePointType;
+  typedef typename Superclass1::TransformType           TransformType;
+  typedef typename Superclass1::TransformPointer        TransformPointer;
+  typedef typename Superclass1::TransformJacobianType   TransformJacobianType;
+  typedef typename Superclass1::InterpolatorType        InterpolatorType;
+  typedef typename Superclass1::MeasureType             MeasureType;
+  typedef typename Superclass1::DerivativeType          DerivativeType;
+  typedef typename Superclass1::ParametersType          ParametersType;
+  typedef typename Superclass1::FixedImageType          FixedImageType;
+  typedef typename Superclass1::MovingImageType         MovingImageType;
+  typedef typename Superclass1::FixedImageConstPointer  FixedImageConstPointer;
+  typedef typename Superclass1::MovingImageConstPointer MovingImageCosntPointer;
 
   /** The moving image dimension. */
   itkStaticConstMacro( MovingImageDimension, unsigned int,
@@ -123,6 +127,7 @@ public:
    * \li Set the number of spatial samples.
    * \li Set the standard deviation of the fixed image.
    * \li Set the standard deviation of the moving image.
+   * \li Set the Parzen window cut-off.
    */
   virtual void BeforeEachResolution( void );
 
@@ -131,6 +136,11 @@ public:
    */
   virtual void Initialize( void ) throw ( itk::ExceptionObject );
 
+  /** The ImageSampler is optional for this metric: it is only used if one
+   * is given in the parameter file.
+   */
+  virtual bool GetAdvancedMetricUseImageSampler( void ) const;
+
 protected:
 
   /** The constructor. */
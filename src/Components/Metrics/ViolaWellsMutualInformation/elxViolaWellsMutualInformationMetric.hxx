@@ -52,6 +52,21 @@ ViolaWellsMutualInformationMetric< TElastix >
 } // end Initialize()
 
 
+/**
+ * ******************* GetAdvancedMetricUseImageSampler ***********************
+ */
+
+template< class TElastix >
+bool
+ViolaWellsMutualInformationMetric< TElastix >
+::GetAdvancedMetricUseImageSampler( void ) const
+{
+  /** Without an ImageSampler, the metric takes random samples itself. */
+  return this->GetElastix()->GetNumberOfImageSamplers() > 0;
+
+} // end GetAdvancedMetricUseImageSampler()
+
+
 /**
  * ***************** BeforeEachResolution ***********************
  */
@@ -65,7 +80,7 @@ ViolaWellsMutualInformationMetric< TElastix >
   unsigned int level
     = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
 
-  /** Set the number of histogram bins and spatial samples. */
+  /** Set the number of spatial samples. */
   unsigned int numberOfSpatialSamples = 10000;
 
   /** Set the intensity standard deviation of the fixed
@@ -79,6 +94,9 @@ ViolaWellsMutualInformationMetric< TElastix >
   double movingImageStandardDeviation = 0.4;
   /** \todo calculate them??? */
 
+  /** Evaluate all sample pairs by default. */
+  double parzenWindowCutOff = 0.0;
+
   /** Read the parameters from the ParameterFile. */
   this->m_Configuration->ReadParameter( numberOfSpatialSamples,
     "NumberOfSpatialSamples", this->GetComponentLabel(), level, 0 );
@@ -86,11 +104,14 @@ ViolaWellsMutualInformationMetric< TElastix >
     "FixedImageStandardDeviation", this->GetComponentLabel(), level, 0 );
   this->m_Configuration->ReadParameter( movingImageStandardDeviation,
     "MovingImageStandardDeviation", this->GetComponentLabel(), level, 0 );
+  this->m_Configuration->ReadParameter( parzenWindowCutOff,
+    "ParzenWindowCutOff", this->GetComponentLabel(), level, 0 );
 
   /** Set them. */
   this->SetNumberOfSpatialSamples( numberOfSpatialSamples );
   this->SetFixedImageStandardDeviation( fixedImageStandardDeviation );
   this->SetMovingImageStandardDeviation( movingImageStandardDeviation );
+  this->SetParzenWindowCutOff( parzenWindowCutOff );
 
 } // end BeforeEachResolution()
 
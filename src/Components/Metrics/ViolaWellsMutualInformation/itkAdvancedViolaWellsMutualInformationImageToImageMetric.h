@@ -0,0 +1,281 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkAdvancedViolaWellsMutualInformationImageToImageMetric_h
+#define __itkAdvancedViolaWellsMutualInformationImageToImageMetric_h
+
+#include "itkAdvancedImageToImageMetric.h"
+#include "itkImageRandomSampler.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class AdvancedViolaWellsMutualInformationImageToImageMetric
+ * \brief Computes the mutual information between two images, using the
+ * method of Viola and Wells.
+ *
+ * The value and derivative are those of itk::MutualInformationImageToImageMetric:
+ * the marginal and joint densities of a sample set B are estimated with
+ * Gaussian Parzen windows centred at the samples of a set A. If no
+ * ImageSampler is set, the metric draws NumberOfSpatialSamples new random
+ * samples for each of the sets A and B at every evaluation, like the ITK
+ * metric. Otherwise the valid samples of the ImageSampler are split
+ * alternately over A and B, so each set gets half of them. Both the
+ * evaluation of the samples and the N_A x N_B sample pairs are distributed
+ * over the threads of the PersistentThreadPool.
+ *
+ * With a ParzenWindowCutOff c > 0 only the pairs whose intensities differ by
+ * less than c standard deviations are evaluated. The samples of A are then
+ * sorted by intensity, such that the window of every sample of B is found by
+ * a binary search. This truncates the Gaussian windows at exp(-c^2/2) of
+ * their maximum; a c of 0 evaluates all pairs, like the ITK metric.
+ *
+ * As in the ITK metric, the value is minus the mutual information.
+ *
+ * \sa MutualInformationImageToImageMetric
+ * \ingroup RegistrationMetrics
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class AdvancedViolaWellsMutualInformationImageToImageMetric :
+  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef AdvancedViolaWellsMutualInformationImageToImageMetric Self;
+  typedef AdvancedImageToImageMetric<
+    TFixedImage, TMovingImage >                                 Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( AdvancedViolaWellsMutualInformationImageToImageMetric, AdvancedImageToImageMetric );
+
+  /** Typedefs from the superclass. */
+  typedef typename
+    Superclass::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType            MovingImageType;
+  typedef typename Superclass::MovingImagePixelType       MovingImagePixelType;
+  typedef typename Superclass::MovingImageConstPointer    MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType             FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer     FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType       FixedImageRegionType;
+  typedef typename Superclass::TransformType              TransformType;
+  typedef typename Superclass::TransformPointer           TransformPointer;
+  typedef typename Superclass::InputPointType             InputPointType;
+  typedef typename Superclass::OutputPointType            OutputPointType;
+  typedef typename Superclass::TransformParametersType    TransformParametersType;
+  typedef typename Superclass::TransformJacobianType      TransformJacobianType;
+  typedef typename Superclass::NumberOfParametersType     NumberOfParametersType;
+  typedef typename Superclass::InterpolatorType           InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer        InterpolatorPointer;
+  typedef typename Superclass::RealType                   RealType;
+  typedef typename Superclass::GradientPixelType          GradientPixelType;
+  typedef typename Superclass::GradientImageType          GradientImageType;
+  typedef typename Superclass::GradientImagePointer       GradientImagePointer;
+  typedef typename Superclass::GradientImageFilterType    GradientImageFilterType;
+  typedef typename Superclass::GradientImageFilterPointer GradientImageFilterPointer;
+  typedef typename Superclass::FixedImageMaskType         FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer      FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType        MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer     MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                MeasureType;
+  typedef typename Superclass::DerivativeType             DerivativeType;
+  typedef typename Superclass::DerivativeValueType        DerivativeValueType;
+  typedef typename Superclass::ParametersType             ParametersType;
+  typedef typename Superclass::FixedImagePixelType        FixedImagePixelType;
+  typedef typename Superclass::MovingImageRegionType      MovingImageRegionType;
+  typedef typename Superclass::ImageSamplerType           ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer        ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
+  typedef typename
+    Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
+  typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
+  typedef typename
+    Superclass::FixedImageLimiterOutputType FixedImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
+  typedef typename
+    Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Get the value for single valued optimizers. */
+  virtual MeasureType GetValue( const TransformParametersType & parameters ) const;
+
+  /** Get the derivatives of the match measure. */
+  virtual void GetDerivative( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const;
+
+  /** Get value and derivatives for multiple valued optimizers. */
+  virtual void GetValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Initialize the metric. Sets the internal random sampler if no
+   * ImageSampler was set.
+   */
+  virtual void Initialize( void ) throw ( ExceptionObject );
+
+  /** Set/Get the number of samples of each of the sets A and B, when no
+   * ImageSampler is set. The default is 50, as in the ITK metric.
+   */
+  itkSetMacro( NumberOfSpatialSamples, SizeValueType );
+  itkGetConstMacro( NumberOfSpatialSamples, SizeValueType );
+
+  /** Set/Get the standard deviation of the Parzen windows of the fixed image
+   * intensities. The default is 0.4, which works well for intensities that are
+   * normalized to a mean of 0 and a standard deviation of 1.
+   */
+  itkSetClampMacro( FixedImageStandardDeviation, double,
+    NumericTraits< double >::min(), NumericTraits< double >::max() );
+  itkGetConstMacro( FixedImageStandardDeviation, double );
+
+  /** Set/Get the standard deviation of the Parzen windows of the moving image
+   * intensities. The default is 0.4.
+   */
+  itkSetClampMacro( MovingImageStandardDeviation, double,
+    NumericTraits< double >::min(), NumericTraits< double >::max() );
+  itkGetConstMacro( MovingImageStandardDeviation, double );
+
+  /** Set/Get the number of standard deviations beyond which sample pairs are
+   * ignored. The default is 0, which evaluates all pairs.
+   */
+  itkSetClampMacro( ParzenWindowCutOff, double, 0.0, NumericTraits< double >::max() );
+  itkGetConstMacro( ParzenWindowCutOff, double );
+
+protected:
+
+  AdvancedViolaWellsMutualInformationImageToImageMetric();
+  virtual ~AdvancedViolaWellsMutualInformationImageToImageMetric() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Protected Typedefs ******************/
+
+  /** Typedefs inherited from superclass */
+  typedef typename Superclass::FixedImagePointType        FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType       MovingImagePointType;
+  typedef typename Superclass::MovingImageDerivativeType  MovingImageDerivativeType;
+  typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+
+private:
+
+  AdvancedViolaWellsMutualInformationImageToImageMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                                        // purposely not implemented
+
+  /** Compute the value, and the derivative if it is not NULL. */
+  void ComputeValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType * derivative ) const;
+
+  /** Evaluates the Gaussian Parzen window. */
+  static double EvaluateKernel( const double u );
+
+  /** The number of samples or pairs processed per chunk of ParallelFor(). */
+  itkStaticConstMacro( SamplesGrainSize, unsigned int, 64 );
+  itkStaticConstMacro( PairsGrainSize, unsigned int, 16 );
+
+  /** The sampler that is used if no ImageSampler was set. */
+  typedef ImageRandomSampler< FixedImageType >          InternalImageSamplerType;
+  typedef typename InternalImageSamplerType::Pointer    InternalImageSamplerPointer;
+
+  /** The data shared by the range functions. */
+  struct MutualInformationJobType
+  {
+    const Self *          st_Metric;
+    bool                  st_ComputeDerivative;
+    DerivativeValueType * st_Derivative;
+  };
+
+  /** The accumulators and scratch buffers of a thread. */
+  struct PerThreadStruct
+  {
+    double                     st_LogSumFixed;
+    double                     st_LogSumMoving;
+    double                     st_LogSumJoint;
+    DerivativeType             st_Derivative;
+    bool                       st_DerivativeIsUsed;
+    std::vector< double >      st_KernelValues;
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    DerivativeType             st_ImageJacobian;
+    TransformJacobianType      st_TransformJacobian;
+  };
+
+  /** Evaluate the samples [begin, end) of the sample container. */
+  static void EvaluateSamplesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Evaluate the pairs of the samples [begin, end) of set B with set A. */
+  static void EvaluatePairsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  /** Add the derivatives of the threads, for the parameters [begin, end). */
+  static void ReduceDerivativeRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  double m_FixedImageStandardDeviation;
+  double m_MovingImageStandardDeviation;
+  double m_MinProbability;
+  double m_ParzenWindowCutOff;
+
+  SizeValueType               m_NumberOfSpatialSamples;
+  InternalImageSamplerPointer m_InternalImageSampler;
+
+  /** The evaluated samples. The image Jacobians dM/dmu and their nonzero
+   * indices are stored per sample, in blocks of the number of nonzero
+   * Jacobian indices.
+   */
+  mutable std::vector< double >              m_FixedValues;
+  mutable std::vector< double >              m_MovingValues;
+  mutable std::vector< unsigned char >       m_SampleIsValid;
+  mutable std::vector< DerivativeValueType > m_ImageJacobians;
+  mutable std::vector< unsigned int >        m_ImageJacobianIndices;
+  mutable NumberOfParametersType             m_NumberOfNonZeroJacobianIndices;
+
+  /** The sample sets. The fixed values of A are sorted on their own, and the
+   * samples of A are sorted by their moving value, when a cut-off is used.
+   */
+  mutable std::vector< SizeValueType > m_SetA;
+  mutable std::vector< double >        m_SetAFixedValues;
+  mutable std::vector< double >        m_SetAMovingValues;
+  mutable std::vector< SizeValueType > m_SetB;
+
+  mutable std::vector< PerThreadStruct > m_PerThreadVariables;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkAdvancedViolaWellsMutualInformationImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef __itkAdvancedViolaWellsMutualInformationImageToImageMetric_h
@@ -0,0 +1,562 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef _itkAdvancedViolaWellsMutualInformationImageToImageMetric_hxx
+#define _itkAdvancedViolaWellsMutualInformationImageToImageMetric_hxx
+
+#include "itkAdvancedViolaWellsMutualInformationImageToImageMetric.h"
+#include "itkPersistentThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::AdvancedViolaWellsMutualInformationImageToImageMetric()
+{
+  this->SetUseImageSampler( true );
+  this->SetUseFixedImageLimiter( false );
+  this->SetUseMovingImageLimiter( false );
+
+  this->m_FixedImageStandardDeviation    = 0.4;
+  this->m_MovingImageStandardDeviation   = 0.4;
+  this->m_MinProbability                 = 0.0001;
+  this->m_ParzenWindowCutOff             = 0.0;
+  this->m_NumberOfSpatialSamples         = 50;
+  this->m_NumberOfNonZeroJacobianIndices = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "FixedImageStandardDeviation: "
+     << this->m_FixedImageStandardDeviation << std::endl;
+  os << indent << "MovingImageStandardDeviation: "
+     << this->m_MovingImageStandardDeviation << std::endl;
+  os << indent << "ParzenWindowCutOff: "
+     << this->m_ParzenWindowCutOff << std::endl;
+  os << indent << "NumberOfSpatialSamples: "
+     << this->m_NumberOfSpatialSamples << std::endl;
+  os << indent << "InternalImageSampler: "
+     << this->m_InternalImageSampler.GetPointer() << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* Initialize *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void ) throw ( ExceptionObject )
+{
+  /** Without an ImageSampler, take random samples, as the ITK metric. */
+  if( this->GetImageSampler() == NULL )
+  {
+    if( this->m_InternalImageSampler.IsNull() )
+    {
+      this->m_InternalImageSampler = InternalImageSamplerType::New();
+    }
+    this->SetImageSampler( this->m_InternalImageSampler );
+  }
+
+  /** Call the superclass' implementation, which initializes the sampler. */
+  this->Superclass::Initialize();
+
+} // end Initialize()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->ComputeValueAndDerivative( parameters, value, NULL );
+  return value;
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  /** When the derivative is calculated, all information for calculating
+   * the metric value is available. It does not cost anything to calculate
+   * the metric value now. Therefore, we have chosen to only implement the
+   * GetValueAndDerivative(), supplying it with a dummy value variable.
+   */
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  this->ComputeValueAndDerivative( parameters, value, &derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* EvaluateKernel *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+double
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateKernel( const double u )
+{
+  /** The normalized Gaussian, as the GaussianKernelFunction. */
+  static const double factor = 1.0 / std::sqrt( 2.0 * vnl_math::pi );
+  return factor * std::exp( -0.5 * u * u );
+
+} // end EvaluateKernel()
+
+
+/**
+ * ******************* ComputeValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType * derivative ) const
+{
+  /** The internal sampler draws NumberOfSpatialSamples new samples for each
+   * set: the first half of its samples is set A, the second half set B.
+   */
+  const bool useInternalImageSampler = this->m_InternalImageSampler.IsNotNull()
+    && this->GetImageSampler() == this->m_InternalImageSampler.GetPointer();
+  if( useInternalImageSampler )
+  {
+    this->m_InternalImageSampler->SetNumberOfSamples( 2 * this->m_NumberOfSpatialSamples );
+    this->m_InternalImageSampler->Modified();
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const SizeValueType         sampleContainerSize = sampleContainer->Size();
+  const bool                  computeDerivative   = ( derivative != NULL );
+
+  /** Setup the sample buffers and the scratch buffers of the threads. */
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
+  const ThreadIdType            numberOfThreads
+    = std::max( threadPool->GetNumberOfThreads(), static_cast< ThreadIdType >( 1 ) );
+  this->m_NumberOfNonZeroJacobianIndices = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  this->m_FixedValues.resize( sampleContainerSize );
+  this->m_MovingValues.resize( sampleContainerSize );
+  this->m_SampleIsValid.resize( sampleContainerSize );
+  if( computeDerivative )
+  {
+    this->m_ImageJacobians.resize( sampleContainerSize * this->m_NumberOfNonZeroJacobianIndices );
+    this->m_ImageJacobianIndices.resize( sampleContainerSize * this->m_NumberOfNonZeroJacobianIndices );
+  }
+  if( this->m_PerThreadVariables.size() != numberOfThreads )
+  {
+    this->m_PerThreadVariables.resize( numberOfThreads );
+  }
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    PerThreadStruct & perThread = this->m_PerThreadVariables[ t ];
+    perThread.st_LogSumFixed      = 0.0;
+    perThread.st_LogSumMoving     = 0.0;
+    perThread.st_LogSumJoint      = 0.0;
+    perThread.st_DerivativeIsUsed = false;
+    perThread.st_NonZeroJacobianIndices.resize( this->m_NumberOfNonZeroJacobianIndices );
+    perThread.st_ImageJacobian.SetSize( this->m_NumberOfNonZeroJacobianIndices );
+  }
+
+  MutualInformationJobType job;
+  job.st_Metric            = this;
+  job.st_ComputeDerivative = computeDerivative;
+  job.st_Derivative        = 0;
+
+  /** Evaluate the fixed and moving image values of all samples. */
+  threadPool->ParallelFor( sampleContainerSize, Self::SamplesGrainSize,
+    Self::EvaluateSamplesRangeFunction, &job );
+
+  /** Split the valid samples over the sets A and B: in two halves for the
+   * internal sampler, otherwise alternately.
+   */
+  this->m_SetA.clear();
+  this->m_SetB.clear();
+  for( SizeValueType i = 0; i < sampleContainerSize; ++i )
+  {
+    if( this->m_SampleIsValid[ i ] )
+    {
+      const bool belongsToA = useInternalImageSampler
+        ? i < sampleContainerSize / 2
+        : this->m_SetA.size() == this->m_SetB.size();
+      if( belongsToA )
+      {
+        this->m_SetA.push_back( i );
+      }
+      else
+      {
+        this->m_SetB.push_back( i );
+      }
+    }
+  }
+  this->m_NumberOfPixelsCounted = this->m_SetA.size() + this->m_SetB.size();
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples( sampleContainerSize, this->m_NumberOfPixelsCounted );
+
+  if( this->m_SetB.empty() )
+  {
+    itkExceptionMacro( << "Too few samples map inside the moving image buffer." );
+  }
+
+  /** With a cut-off, sort set A by moving value, and its fixed values separately. */
+  const SizeValueType sizeA = this->m_SetA.size();
+  if( this->m_ParzenWindowCutOff > 0.0 )
+  {
+    std::vector< std::pair< double, SizeValueType > > sortedA( sizeA );
+    for( SizeValueType k = 0; k < sizeA; ++k )
+    {
+      sortedA[ k ] = std::make_pair( this->m_MovingValues[ this->m_SetA[ k ] ], this->m_SetA[ k ] );
+    }
+    std::sort( sortedA.begin(), sortedA.end() );
+    for( SizeValueType k = 0; k < sizeA; ++k )
+    {
+      this->m_SetA[ k ] = sortedA[ k ].second;
+    }
+  }
+  this->m_SetAFixedValues.resize( sizeA );
+  this->m_SetAMovingValues.resize( sizeA );
+  for( SizeValueType k = 0; k < sizeA; ++k )
+  {
+    this->m_SetAFixedValues[ k ]  = this->m_FixedValues[ this->m_SetA[ k ] ];
+    this->m_SetAMovingValues[ k ] = this->m_MovingValues[ this->m_SetA[ k ] ];
+  }
+  if( this->m_ParzenWindowCutOff > 0.0 )
+  {
+    std::sort( this->m_SetAFixedValues.begin(), this->m_SetAFixedValues.end() );
+  }
+
+  /** Evaluate the pairs of the samples of B with the samples of A. */
+  threadPool->ParallelFor( this->m_SetB.size(), Self::PairsGrainSize,
+    Self::EvaluatePairsRangeFunction, &job );
+
+  /** Gather the log sums of the threads. */
+  double dLogSumFixed  = 0.0;
+  double dLogSumMoving = 0.0;
+  double dLogSumJoint  = 0.0;
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    dLogSumFixed  += this->m_PerThreadVariables[ t ].st_LogSumFixed;
+    dLogSumMoving += this->m_PerThreadVariables[ t ].st_LogSumMoving;
+    dLogSumJoint  += this->m_PerThreadVariables[ t ].st_LogSumJoint;
+  }
+
+  /** At least half the samples in B should occur within the Parzen window
+   * width of the samples in A.
+   */
+  const double nsamp     = static_cast< double >( this->m_SetB.size() );
+  const double threshold = -0.5 * nsamp * std::log( this->m_MinProbability );
+  if( dLogSumMoving > threshold || dLogSumFixed > threshold || dLogSumJoint > threshold )
+  {
+    itkExceptionMacro( << "Standard deviation is too small" );
+  }
+
+  /** Compute the value. */
+  value = ( dLogSumFixed + dLogSumMoving - dLogSumJoint ) / nsamp + std::log( nsamp );
+
+  /** Add the derivatives of the threads, and scale the result. */
+  if( computeDerivative )
+  {
+    derivative->SetSize( this->GetNumberOfParameters() );
+    derivative->Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    job.st_Derivative = derivative->data_block();
+    threadPool->ParallelFor( derivative->GetSize(), 0,
+      Self::ReduceDerivativeRangeFunction, &job );
+    *derivative /= nsamp * vnl_math_sqr( this->m_MovingImageStandardDeviation );
+  }
+
+} // end ComputeValueAndDerivative()
+
+
+/**
+ * ******************* EvaluateSamplesRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateSamplesRangeFunction( void * userData,
+  ThreadIdType participantId, SizeValueType begin, SizeValueType end )
+{
+  const MutualInformationJobType & job       = *static_cast< const MutualInformationJobType * >( userData );
+  const Self &                     metric    = *job.st_Metric;
+  PerThreadStruct &                perThread = metric.m_PerThreadVariables[ participantId ];
+  const SizeValueType              nnzji     = metric.m_NumberOfNonZeroJacobianIndices;
+
+  ImageSampleContainerPointer sampleContainer = metric.GetImageSampler()->GetOutput();
+  typename ImageSampleContainerType::ConstIterator fiter = sampleContainer->Begin();
+  fiter += (int)begin;
+
+  MovingImagePointType      mappedPoint;
+  MovingImageDerivativeType movingImageDerivative;
+  RealType                  movingImageValue;
+  for( SizeValueType i = begin; i < end; ++i, ++fiter )
+  {
+    /** Read fixed coordinates. */
+    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = metric.TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside moving mask. */
+    if( sampleOk )
+    {
+      sampleOk = metric.IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)), and the derivative dM/dx if
+     * requested, and check if the point is inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = metric.EvaluateMovingImageValueAndDerivative( mappedPoint,
+        movingImageValue, job.st_ComputeDerivative ? &movingImageDerivative : 0 );
+    }
+
+    metric.m_SampleIsValid[ i ] = sampleOk;
+    if( !sampleOk )
+    {
+      continue;
+    }
+    metric.m_FixedValues[ i ]  = static_cast< double >( ( *fiter ).Value().m_ImageValue );
+    metric.m_MovingValues[ i ] = static_cast< double >( movingImageValue );
+
+    /** Store the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+    if( job.st_ComputeDerivative )
+    {
+      metric.m_AdvancedTransform->EvaluateJacobianWithImageGradientProductUsingBuffer(
+        fixedPoint, movingImageDerivative, perThread.st_ImageJacobian,
+        perThread.st_NonZeroJacobianIndices, perThread.st_TransformJacobian );
+      std::copy( perThread.st_ImageJacobian.begin(), perThread.st_ImageJacobian.end(),
+        metric.m_ImageJacobians.begin() + i * nnzji );
+      std::copy( perThread.st_NonZeroJacobianIndices.begin(), perThread.st_NonZeroJacobianIndices.end(),
+        metric.m_ImageJacobianIndices.begin() + i * nnzji );
+    }
+  }
+
+} // end EvaluateSamplesRangeFunction()
+
+
+/**
+ * ******************* EvaluatePairsRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluatePairsRangeFunction( void * userData,
+  ThreadIdType participantId, SizeValueType begin, SizeValueType end )
+{
+  const MutualInformationJobType & job       = *static_cast< const MutualInformationJobType * >( userData );
+  const Self &                     metric    = *job.st_Metric;
+  PerThreadStruct &                perThread = metric.m_PerThreadVariables[ participantId ];
+  const SizeValueType              nnzji     = metric.m_NumberOfNonZeroJacobianIndices;
+  const double                     sigmaF    = metric.m_FixedImageStandardDeviation;
+  const double                     sigmaM    = metric.m_MovingImageStandardDeviation;
+  const double                     minProb   = metric.m_MinProbability;
+  const double                     cutOff    = metric.m_ParzenWindowCutOff;
+  const std::vector< double > &    fixedA    = metric.m_SetAFixedValues;
+  const std::vector< double > &    movingA   = metric.m_SetAMovingValues;
+
+  /** The derivative of the thread is cleared when it is first used in a call;
+   * a previous call may have thrown before its reduction.
+   */
+  DerivativeValueType * derivative = 0;
+  if( job.st_ComputeDerivative )
+  {
+    if( !perThread.st_DerivativeIsUsed )
+    {
+      perThread.st_Derivative.SetSize( metric.GetNumberOfParameters() );
+      perThread.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+      perThread.st_DerivativeIsUsed = true;
+    }
+    derivative = perThread.st_Derivative.data_block();
+  }
+
+  for( SizeValueType k = begin; k < end; ++k )
+  {
+    const SizeValueType sampleB = metric.m_SetB[ k ];
+    const double        fixedB  = metric.m_FixedValues[ sampleB ];
+    const double        movingB = metric.m_MovingValues[ sampleB ];
+
+    /** Find the samples of A within the windows; without cut-off all of them. */
+    SizeValueType fixedBegin  = 0;
+    SizeValueType fixedEnd    = fixedA.size();
+    SizeValueType movingBegin = 0;
+    SizeValueType movingEnd   = movingA.size();
+    if( cutOff > 0.0 )
+    {
+      fixedBegin = std::lower_bound( fixedA.begin(), fixedA.end(), fixedB - cutOff * sigmaF ) - fixedA.begin();
+      fixedEnd   = std::upper_bound( fixedA.begin(), fixedA.end(), fixedB + cutOff * sigmaF ) - fixedA.begin();
+      movingBegin
+        = std::lower_bound( movingA.begin(), movingA.end(), movingB - cutOff * sigmaM ) - movingA.begin();
+      movingEnd
+        = std::upper_bound( movingA.begin(), movingA.end(), movingB + cutOff * sigmaM ) - movingA.begin();
+    }
+
+    /** The marginal fixed density only depends on the fixed values. */
+    double dSumFixed = minProb;
+    for( SizeValueType a = fixedBegin; a < fixedEnd; ++a )
+    {
+      dSumFixed += EvaluateKernel( ( fixedB - fixedA[ a ] ) / sigmaF );
+    }
+
+    /** The marginal moving and joint densities; keep the kernel values for the derivative. */
+    double dDenominatorMoving = minProb;
+    double dDenominatorJoint  = minProb;
+    perThread.st_KernelValues.resize( 2 * ( movingEnd - movingBegin ) );
+    double * kernelValues = perThread.st_KernelValues.empty() ? 0 : &perThread.st_KernelValues[ 0 ];
+    for( SizeValueType a = movingBegin; a < movingEnd; ++a )
+    {
+      const SizeValueType sampleA     = metric.m_SetA[ a ];
+      const double        valueFixed  = EvaluateKernel( ( fixedB - metric.m_FixedValues[ sampleA ] ) / sigmaF );
+      const double        valueMoving = EvaluateKernel( ( movingB - movingA[ a ] ) / sigmaM );
+      dDenominatorMoving += valueMoving;
+      dDenominatorJoint  += valueMoving * valueFixed;
+      kernelValues[ 2 * ( a - movingBegin ) ]     = valueFixed;
+      kernelValues[ 2 * ( a - movingBegin ) + 1 ] = valueMoving;
+    }
+
+    perThread.st_LogSumFixed  -= std::log( dSumFixed );
+    perThread.st_LogSumMoving -= std::log( dDenominatorMoving );
+    perThread.st_LogSumJoint  -= std::log( dDenominatorJoint );
+
+    if( !job.st_ComputeDerivative )
+    {
+      continue;
+    }
+
+    /** Add the weighted image Jacobians of the samples of A, and of B. */
+    double totalWeight = 0.0;
+    for( SizeValueType a = movingBegin; a < movingEnd; ++a )
+    {
+      const SizeValueType sampleA      = metric.m_SetA[ a ];
+      const double        valueFixed   = kernelValues[ 2 * ( a - movingBegin ) ];
+      const double        valueMoving  = kernelValues[ 2 * ( a - movingBegin ) + 1 ];
+      const double        weightMoving = valueMoving / dDenominatorMoving;
+      const double        weightJoint  = valueMoving * valueFixed / dDenominatorJoint;
+      const double        weight       = ( weightMoving - weightJoint ) * ( movingB - movingA[ a ] );
+      totalWeight += weight;
+
+      const DerivativeValueType * imageJacobian = &metric.m_ImageJacobians[ sampleA * nnzji ];
+      const unsigned int *        indices       = &metric.m_ImageJacobianIndices[ sampleA * nnzji ];
+      for( SizeValueType j = 0; j < nnzji; ++j )
+      {
+        derivative[ indices[ j ] ] -= imageJacobian[ j ] * weight;
+      }
+    }
+
+    const DerivativeValueType * imageJacobian = &metric.m_ImageJacobians[ sampleB * nnzji ];
+    const unsigned int *        indices       = &metric.m_ImageJacobianIndices[ sampleB * nnzji ];
+    for( SizeValueType j = 0; j < nnzji; ++j )
+    {
+      derivative[ indices[ j ] ] += imageJacobian[ j ] * totalWeight;
+    }
+  }
+
+} // end EvaluatePairsRangeFunction()
+
+
+/**
+ * ******************* ReduceDerivativeRangeFunction *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedViolaWellsMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ReduceDerivativeRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const MutualInformationJobType & job = *static_cast< const MutualInformationJobType * >( userData );
+  std::vector< PerThreadStruct > & perThreadVariables = job.st_Metric->m_PerThreadVariables;
+
+  /** Add the used derivatives. */
+  for( std::size_t t = 0; t < perThreadVariables.size(); ++t )
+  {
+    if( !perThreadVariables[ t ].st_DerivativeIsUsed )
+    {
+      continue;
+    }
+    DerivativeValueType * threadDerivative = perThreadVariables[ t ].st_Derivative.data_block();
+    for( SizeValueType j = begin; j < end; ++j )
+    {
+      job.st_Derivative[ j ] += threadDerivative[ j ];
+    }
+  }
+
+} // end ReduceDerivativeRangeFunction()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkAdvancedViolaWellsMutualInformationImageToImageMetric_hxx
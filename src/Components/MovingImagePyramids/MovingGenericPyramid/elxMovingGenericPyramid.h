@@ -61,10 +61,21 @@ namespace elastix
  *    at once, or per resolution. Latter saves memory.\n
  *    example: <tt>(ComputePyramidImagesPerResolution "true")</tt>\n
  *    Default false.
+ * \parameter ComputePyramidImagesInBackground: Flag to specify if the pyramid images of the
+ *    next resolution are computed on a background thread, while the current resolution
+ *    is registered. Only used when ComputePyramidImagesPerResolution is true.\n
+ *    example: <tt>(ComputePyramidImagesInBackground "true")</tt>\n
+ *    Default false.
  * \parameter ImagePyramidUseShrinkImageFilter: Flag to specify if the ShrinkingImageFilter is used
  *    for rescaling the image, or the ResampleImageFilter. Shrinker is faster.\n
  *    example: <tt>(ImagePyramidUseShrinkImageFilter "true")</tt>\n
  *    Default false, so by default the resampler is used.
+ * \parameter ImagePyramidUseFusedSmoothingAndShrinking: Flag to specify if smoothing and
+ *    shrinking are done in a single pass, with a discrete instead of a recursive Gaussian.
+ *    This is faster and does not allocate a full resolution smoothed image per level.
+ *    Only used when ImagePyramidUseShrinkImageFilter is true.\n
+ *    example: <tt>(ImagePyramidUseFusedSmoothingAndShrinking "true")</tt>\n
+ *    Default false.
  *
  * \ingroup ImagePyramids
  */
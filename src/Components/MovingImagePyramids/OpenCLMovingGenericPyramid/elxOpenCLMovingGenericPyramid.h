@@ -34,6 +34,10 @@ namespace elastix
  * \parameter Pyramid: Enable the OpenCL pyramid as follows:\n
  *    <tt>(OpenCLMovingGenericImagePyramidUseOpenCL "true")</tt>
  *
+ * With <tt>(ImagePyramidUseFusedSmoothingAndShrinking "true")</tt> the smoothing,
+ * the casting and the shrinking of a level are done by one kernel per dimension,
+ * see itk::GPUGaussianSmoothAndShrinkImageFilter.
+ *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
  *
@@ -25,6 +25,7 @@
 #include "elxProgressCommand.h"
 #include "itkAdvancedTransform.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPhaseTimer.h"
 
 namespace elastix
 {
@@ -71,6 +72,8 @@ namespace elastix
  *    Default/recommended value: 500. When you are in a hurry, you may go down to 250 for example.
  *    When you have plenty of time, and want to be absolutely sure of the best results, a setting
  *    of 2000 is reasonable. In general, 500 gives satisfactory results.
+ *    With a TotalIterationBudget or TotalTimeBudget, see OptimizerBase, the iterations
+ *    are redistributed over the resolutions, in proportion to this parameter.
  * \parameter MaximumNumberOfSamplingAttempts: The maximum number of sampling attempts. Sometimes
  *   not enough corresponding samples can be drawn, upon which an exception is thrown. With this
  *   parameter it is possible to try to draw another set of samples. \n
@@ -180,6 +183,103 @@ namespace elastix
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(NoiseCompensation "true")</tt>\n
  *   Default/recommended: true.
+ * \parameter UseConvergenceStopping: Whether to stop a resolution before MaximumNumberOfIterations
+ *   when the exponentially averaged metric value no longer decreases significantly. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseConvergenceStopping "true")</tt>\n
+ *   Default: false.
+ * \parameter ConvergenceWindowSize: The number of iterations over which a line is fitted to
+ *   the averaged metric values, to measure their decrease. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceWindowSize 50 100 200)</tt>\n
+ *   Default: 100. The parameter has only influence when UseConvergenceStopping is used.
+ * \parameter ConvergenceRelativeTolerance: The optimization stops when the upper bound of the
+ *   95% confidence interval of the decrease over the window is below this fraction of the
+ *   magnitude of the averaged metric value. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ConvergenceRelativeTolerance 1e-3)</tt>\n
+ *   Default: 1e-4. The parameter has only influence when UseConvergenceStopping is used.
+ * \parameter UseMultiThreadingForOptimizers: Whether the parameter update of each iteration
+ *   is computed in parallel, for transforms with many parameters. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseMultiThreadingForOptimizers "false")</tt>\n
+ *   Default: true.
+ * \parameter MultiThreadingThresholdForOptimizers: The minimum number of transform parameters
+ *   for which the parameter update is computed in parallel. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(MultiThreadingThresholdForOptimizers 1000000)</tt>\n
+ *   Default: 100000.
+ * \parameter UseResidentParameters: Whether the transform parameters and the gradient are kept
+ *   in the metric during the iterations, if the metric supports that, such as the OpenCL metrics
+ *   when they are computed on the GPU. Per iteration only the metric value and two inner
+ *   products are copied from the GPU, and the parameters are copied back at the end of the
+ *   resolution. Only used without scales, with a single metric. Note that the transform
+ *   parameters of the iterations are not available to the other components. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseResidentParameters "true")</tt>\n
+ *   Default: false.
+ * \parameter UseMetricSamplerForJacobianTerms: Whether the Jacobian terms of the automatic
+ *   parameter estimation are computed on the samples of the metric's image sampler,
+ *   instead of on a grid of NumberOfJacobianMeasurements samples. This holds for both
+ *   the Original and the DisplacementDistribution ASGDParameterEstimationMethod. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseMetricSamplerForJacobianTerms "true")</tt>\n
+ *   Default: false.
+ * \parameter UseAdaptiveNumberOfSamples: Whether the number of spatial samples of the random
+ *   samplers of the metrics is increased during the optimization, when the estimated ratio of
+ *   the noise to the signal of the gradients exceeds the TargetGradientNoiseToSignalRatio.
+ *   The number is checked every AdaptiveNumberOfSamplesInterval iterations, and grows by at
+ *   most a factor of two per check. Requires NewSamplesEveryIteration. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseAdaptiveNumberOfSamples "true")</tt>\n
+ *   Default: false.
+ * \parameter MinimumNumberOfSpatialSamples: The number of spatial samples at the start of
+ *   each resolution, when UseAdaptiveNumberOfSamples is true. \n
+ *   example: <tt>(MinimumNumberOfSpatialSamples 1000 2000)</tt>\n
+ *   Default: 0, which means the NumberOfSpatialSamples of the sampler.
+ * \parameter MaximumNumberOfSpatialSamples: The largest number of spatial samples,
+ *   when UseAdaptiveNumberOfSamples is true. \n
+ *   example: <tt>(MaximumNumberOfSpatialSamples 8000 16000)</tt>\n
+ *   Default: 0, which means eight times the MinimumNumberOfSpatialSamples.
+ * \parameter TargetGradientNoiseToSignalRatio: The ratio of the squared magnitudes of the
+ *   approximation error and of the exact gradient above which the number of samples grows. \n
+ *   example: <tt>(TargetGradientNoiseToSignalRatio 2.0)</tt>\n
+ *   Default: 1.0.
+ * \parameter AdaptiveNumberOfSamplesInterval: The number of iterations between the checks
+ *   of the number of samples. \n
+ *   example: <tt>(AdaptiveNumberOfSamplesInterval 20)</tt>\n
+ *   Default: 10.
+ * \parameter AutomaticParameterEstimationCacheDirectory: A directory in which the results of the
+ *   automatic parameter estimation (SP_a, SP_alpha, the sigmoid settings and the
+ *   NumberOfGradientMeasurements) are stored, and from which they are reused by later runs.
+ *   The results are looked up per resolution, with a key composed of the fixed image geometry,
+ *   the fixed image region, the transform type and grid, the scales, and the metric, sampler
+ *   and optimizer settings. Note that the image intensities and the current transform
+ *   parameters are not part of the key, so only use this for series of similar registrations.\n
+ *   example: <tt>(AutomaticParameterEstimationCacheDirectory "/data/asgdcache")</tt>\n
+ *   Default: "", which means that nothing is cached.
+ * \parameter WarmStartAutomaticParameterEstimation: Whether the automatic parameter estimation
+ *   is replaced by the results of the previous resolution, scaled for the new resolution.
+ *   SP_a is scaled by the ratio of the MaximumStepLength, by the square root of the ratio of
+ *   the number of parameters, and by the inverse ratio of the gradient magnitudes at the start
+ *   of both resolutions; SigmoidScale by the squared ratio of the gradient magnitudes. The time
+ *   at the end of the previous resolution, times the WarmStartTimeFactor, replaces the
+ *   SigmoidInitialTime. The gradient is measured once at the start of the resolution. When the
+ *   root mean square of its elements differs by more than the WarmStartGradientTolerance
+ *   factor from that of the previous resolution, the parameters are estimated as usual.
+ *   Only used when AutomaticParameterEstimation was also used in the previous resolution.\n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(WarmStartAutomaticParameterEstimation "true")</tt>\n
+ *   Default: false.
+ * \parameter WarmStartTimeFactor: The factor by which the time at the end of the previous
+ *   resolution is multiplied, when WarmStartAutomaticParameterEstimation is used. Smaller
+ *   values give larger steps at the start of the resolution.\n
+ *   example: <tt>(WarmStartTimeFactor 0.5)</tt>\n
+ *   Default: 1.0.
+ * \parameter WarmStartGradientTolerance: The largest factor by which the root mean square of
+ *   the gradient elements may change between resolutions, for a warm start. \n
+ *   example: <tt>(WarmStartGradientTolerance 4.0)</tt>\n
+ *   Default: 10.0.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -243,6 +343,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetValue();
+  }
+
   virtual void AfterRegistration( void );
 
   /** Check if any scales are set, and set the UseScales flag on or off;
@@ -259,6 +365,14 @@ public:
   /** Stop optimization and pass on exception. */
   virtual void MetricErrorResponse( itk::ExceptionObject & err );
 
+  /** Save and restore the step size parameters, in addition to the state of
+   * the optimization. The restored parameters replace the automatic
+   * parameter estimation of the next StartOptimization().
+   */
+  virtual void WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const;
+
+  virtual void ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint );
+
   /** Set/Get whether automatic parameter estimation is desired.
    * If true, make sure to set the maximum step length.
    *
@@ -379,6 +493,28 @@ protected:
    */
   virtual void AutomaticParameterEstimationUsingDisplacementDistribution( void );
 
+  /** Set the parameters from those of the previous resolution, scaled by the
+   * gradient measured at the current position, if WarmStartAutomaticParameterEstimation
+   * and the gradient passes the consistency check. Returns whether that was the case.
+   */
+  virtual bool WarmStartAutomaticParameterEstimation( void );
+
+  /** Compose the key that identifies the automatic parameter estimation of the
+   * current resolution in the cache.
+   */
+  virtual std::string GetAutomaticParameterEstimationCacheKey(
+    const std::string & estimationMethod ) const;
+
+  /** Read the estimated parameters from a cache file, if it exists and was
+   * written for the same key. Returns whether that was the case.
+   */
+  virtual bool ReadAutomaticParameterEstimationCache(
+    const std::string & fileName, const std::string & key );
+
+  /** Write the estimated parameters to a cache file. */
+  virtual void WriteAutomaticParameterEstimationCache(
+    const std::string & fileName, const std::string & key, const bool writeSigmoid ) const;
+
   /** Measure some derivatives, exact and approximated. Returns
    * the squared magnitude of the gradient and approximation error.
    * Needed for the automatic parameter estimation.
@@ -400,6 +536,17 @@ protected:
    */
   virtual void AddRandomPerturbation( ParametersType & parameters, double sigma );
 
+  /** Collect the random samplers of the metrics and set them to the minimum
+   * number of samples, if UseAdaptiveNumberOfSamples. Called at the start
+   * of each resolution.
+   */
+  virtual void InitializeAdaptiveNumberOfSamples( void );
+
+  /** Increase the number of samples of the random samplers according to
+   * the estimated noise-to-signal ratio of the gradients.
+   */
+  virtual void AdaptNumberOfSamples( void );
+
 private:
 
   AdaptiveStochasticGradientDescent( const Self & );  // purposely not implemented
@@ -413,15 +560,40 @@ private:
   SizeValueType m_CurrentNumberOfSamplingAttempts;
   SizeValueType m_PreviousErrorAtIteration;
   bool          m_AutomaticParameterEstimationDone;
+  bool          m_StepSizeParametersFromCheckpoint;
 
   /** Private variables for band size estimation of covariance matrix. */
   SizeValueType m_MaxBandCovSize;
   SizeValueType m_NumberOfBandStructureSamples;
+  bool          m_UseMetricSamplerForJacobianTerms;
+
+  /** Private variables for the adaptive number of samples. */
+  bool                                         m_UseAdaptiveNumberOfSamples;
+  SizeValueType                                m_MinimumNumberOfSpatialSamples;
+  SizeValueType                                m_MaximumNumberOfSpatialSamples;
+  double                                       m_TargetGradientNoiseToSignalRatio;
+  SizeValueType                                m_AdaptiveNumberOfSamplesInterval;
+  std::vector< ImageRandomSamplerBasePointer > m_AdaptiveSamplers;
+  std::vector< SizeValueType >                 m_AdaptiveSamplersMaximum;
 
   /** The flag of using noise compensation. */
   bool m_UseNoiseCompensation;
   bool m_OriginalButSigmoidToDefault;
 
+  /** Private variables for the warm start from the previous resolution. */
+  bool          m_WarmStartAutomaticParameterEstimation;
+  double        m_WarmStartTimeFactor;
+  double        m_WarmStartGradientTolerance;
+  bool          m_WarmStartAvailable;
+  SettingsType  m_WarmStartSettings;
+  bool          m_WarmStartSigmoidEstimated;
+  double        m_WarmStartTime;
+  double        m_WarmStartMaximumStepLength;
+  double        m_WarmStartGradientMagnitude;
+  SizeValueType m_WarmStartNumberOfParameters;
+  double        m_InitialGradientMagnitude;
+  bool          m_SigmoidEstimated;
+
 };
 
 } // end namespace elastix
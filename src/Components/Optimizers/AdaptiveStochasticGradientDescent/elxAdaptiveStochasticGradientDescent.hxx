@@ -20,6 +20,8 @@
 
 #include "elxAdaptiveStochasticGradientDescent.h"
 
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
 #include <string>
 #include <vector>
@@ -44,6 +46,7 @@ AdaptiveStochasticGradientDescent< TElastix >
   this->m_CurrentNumberOfSamplingAttempts  = 0;
   this->m_PreviousErrorAtIteration         = 0;
   this->m_AutomaticParameterEstimationDone = false;
+  this->m_StepSizeParametersFromCheckpoint = false;
 
   this->m_AutomaticParameterEstimation = false;
   this->m_MaximumStepLength            = 1.0;
@@ -56,8 +59,27 @@ AdaptiveStochasticGradientDescent< TElastix >
   this->m_RandomGenerator   = RandomGeneratorType::GetInstance();
   this->m_AdvancedTransform = 0;
 
-  this->m_UseNoiseCompensation        = true;
-  this->m_OriginalButSigmoidToDefault = false;
+  this->m_UseNoiseCompensation             = true;
+  this->m_OriginalButSigmoidToDefault      = false;
+  this->m_UseMetricSamplerForJacobianTerms = false;
+
+  this->m_UseAdaptiveNumberOfSamples       = false;
+  this->m_MinimumNumberOfSpatialSamples    = 0;
+  this->m_MaximumNumberOfSpatialSamples    = 0;
+  this->m_TargetGradientNoiseToSignalRatio = 1.0;
+  this->m_AdaptiveNumberOfSamplesInterval  = 10;
+
+  this->m_WarmStartAutomaticParameterEstimation = false;
+  this->m_WarmStartTimeFactor                   = 1.0;
+  this->m_WarmStartGradientTolerance            = 10.0;
+  this->m_WarmStartAvailable                    = false;
+  this->m_WarmStartSigmoidEstimated             = false;
+  this->m_WarmStartTime                         = 0.0;
+  this->m_WarmStartMaximumStepLength            = 0.0;
+  this->m_WarmStartGradientMagnitude            = 0.0;
+  this->m_WarmStartNumberOfParameters           = 0;
+  this->m_InitialGradientMagnitude              = 0.0;
+  this->m_SigmoidEstimated                      = false;
 
 } // Constructor
 
@@ -84,6 +106,7 @@ AdaptiveStochasticGradientDescent< TElastix >
   xl::xout[ "iteration" ][ "4:||Gradient||" ] << std::showpoint << std::fixed;
 
   this->m_SettingsVector.clear();
+  this->m_WarmStartAvailable = false;
 
 } // end BeforeRegistration()
 
@@ -108,7 +131,7 @@ AdaptiveStochasticGradientDescent< TElastix >
   SizeValueType maximumNumberOfIterations = 500;
   this->GetConfiguration()->ReadParameter( maximumNumberOfIterations,
     "MaximumNumberOfIterations", this->GetComponentLabel(), level, 0 );
-  this->SetNumberOfIterations( maximumNumberOfIterations );
+  this->SetNumberOfIterations( this->DistributeComputeBudget( maximumNumberOfIterations ) );
 
   /** Set the gain parameter A. */
   double A = 20.0;
@@ -138,6 +161,36 @@ AdaptiveStochasticGradientDescent< TElastix >
     "SigmoidInitialTime", this->GetComponentLabel(), level, 0 );
   this->SetInitialTime( initialTime );
 
+  /** Set whether to stop when the metric value has converged, and how to measure that. */
+  bool useConvergenceStopping = false;
+  this->GetConfiguration()->ReadParameter( useConvergenceStopping,
+    "UseConvergenceStopping", this->GetComponentLabel(), level, 0 );
+  this->SetUseConvergenceStopping( useConvergenceStopping );
+  SizeValueType convergenceWindowSize = 100;
+  this->GetConfiguration()->ReadParameter( convergenceWindowSize,
+    "ConvergenceWindowSize", this->GetComponentLabel(), level, 0 );
+  this->SetConvergenceWindowSize( convergenceWindowSize );
+  double convergenceRelativeTolerance = 1e-4;
+  this->GetConfiguration()->ReadParameter( convergenceRelativeTolerance,
+    "ConvergenceRelativeTolerance", this->GetComponentLabel(), level, 0 );
+  this->SetConvergenceRelativeTolerance( convergenceRelativeTolerance );
+
+  /** Set whether the parameter update is multi-threaded, and from how many parameters. */
+  bool useMultiThreading = true;
+  this->GetConfiguration()->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetUseMultiThread( useMultiThreading );
+  SizeValueType multiThreadingThreshold = 100000;
+  this->GetConfiguration()->ReadParameter( multiThreadingThreshold,
+    "MultiThreadingThresholdForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetMultiThreadingThreshold( multiThreadingThreshold );
+
+  /** Set whether the parameters are kept resident in the metric, e.g. on the GPU. */
+  bool useResidentParameters = false;
+  this->GetConfiguration()->ReadParameter( useResidentParameters,
+    "UseResidentParameters", this->GetComponentLabel(), level, 0 );
+  this->SetUseResidentParameters( useResidentParameters );
+
   /** Set the maximum band size of the covariance matrix. */
   this->m_MaxBandCovSize = 192;
   this->GetConfiguration()->ReadParameter( this->m_MaxBandCovSize,
@@ -148,6 +201,30 @@ AdaptiveStochasticGradientDescent< TElastix >
   this->GetConfiguration()->ReadParameter( this->m_NumberOfBandStructureSamples,
     "NumberOfBandStructureSamples", this->GetComponentLabel(), level, 0 );
 
+  /** Set whether the Jacobian terms are computed on the samples of the metric. */
+  this->m_UseMetricSamplerForJacobianTerms = false;
+  this->GetConfiguration()->ReadParameter( this->m_UseMetricSamplerForJacobianTerms,
+    "UseMetricSamplerForJacobianTerms", this->GetComponentLabel(), level, 0 );
+
+  /** Set the bounds and the target of the adaptive number of samples. */
+  this->m_UseAdaptiveNumberOfSamples = false;
+  this->GetConfiguration()->ReadParameter( this->m_UseAdaptiveNumberOfSamples,
+    "UseAdaptiveNumberOfSamples", this->GetComponentLabel(), level, 0 );
+  this->m_MinimumNumberOfSpatialSamples = 0;
+  this->GetConfiguration()->ReadParameter( this->m_MinimumNumberOfSpatialSamples,
+    "MinimumNumberOfSpatialSamples", this->GetComponentLabel(), level, 0 );
+  this->m_MaximumNumberOfSpatialSamples = 0;
+  this->GetConfiguration()->ReadParameter( this->m_MaximumNumberOfSpatialSamples,
+    "MaximumNumberOfSpatialSamples", this->GetComponentLabel(), level, 0 );
+  this->m_TargetGradientNoiseToSignalRatio = 1.0;
+  this->GetConfiguration()->ReadParameter( this->m_TargetGradientNoiseToSignalRatio,
+    "TargetGradientNoiseToSignalRatio", this->GetComponentLabel(), level, 0 );
+  this->m_AdaptiveNumberOfSamplesInterval = 10;
+  this->GetConfiguration()->ReadParameter( this->m_AdaptiveNumberOfSamplesInterval,
+    "AdaptiveNumberOfSamplesInterval", this->GetComponentLabel(), level, 0 );
+  this->m_AdaptiveNumberOfSamplesInterval
+    = vnl_math_max( this->m_AdaptiveNumberOfSamplesInterval, static_cast< SizeValueType >( 1 ) );
+
   /** Set/Get whether the adaptive step size mechanism is desired. Default: true
    * NB: the setting is turned of in case of UseRandomSampleRegion=true.
    * Deprecated alias UseCruzAcceleration is also still supported.
@@ -231,6 +308,17 @@ AdaptiveStochasticGradientDescent< TElastix >
       "SigmoidScaleFactor", this->GetComponentLabel(), level, 0 );
     this->m_SigmoidScaleFactor = sigmoidScaleFactor;
 
+    /** Set whether the results of the previous resolution are reused. */
+    this->m_WarmStartAutomaticParameterEstimation = false;
+    this->GetConfiguration()->ReadParameter( this->m_WarmStartAutomaticParameterEstimation,
+      "WarmStartAutomaticParameterEstimation", this->GetComponentLabel(), level, 0 );
+    this->m_WarmStartTimeFactor = 1.0;
+    this->GetConfiguration()->ReadParameter( this->m_WarmStartTimeFactor,
+      "WarmStartTimeFactor", this->GetComponentLabel(), level, 0 );
+    this->m_WarmStartGradientTolerance = 10.0;
+    this->GetConfiguration()->ReadParameter( this->m_WarmStartGradientTolerance,
+      "WarmStartGradientTolerance", this->GetComponentLabel(), level, 0 );
+
   } // end if automatic parameter estimation
   else
   {
@@ -282,6 +370,8 @@ AdaptiveStochasticGradientDescent< TElastix >
   xl::xout[ "iteration" ][ "2:Metric" ] << this->GetValue();
   xl::xout[ "iteration" ][ "3a:Time" ] << this->GetCurrentTime();
   xl::xout[ "iteration" ][ "3b:StepSize" ] << this->GetLearningRate();
+  const double gradientMagnitude = this->GetParametersAreResident()
+    ? this->GetResidentGradientMagnitude() : this->GetGradient().magnitude();
   bool asFastAsPossible = false;
   if( asFastAsPossible )
   {
@@ -289,7 +379,28 @@ AdaptiveStochasticGradientDescent< TElastix >
   }
   else
   {
-    xl::xout[ "iteration" ][ "4:||Gradient||" ] << this->GetGradient().magnitude();
+    xl::xout[ "iteration" ][ "4:||Gradient||" ] << gradientMagnitude;
+  }
+
+  /** Remember the gradient at the start of the resolution, for a warm start
+   * of the next resolution.
+   */
+  if( this->GetCurrentIteration() == 0 )
+  {
+    this->m_InitialGradientMagnitude = gradientMagnitude;
+  }
+
+  /** Stop when the time budget of this resolution is used up. */
+  if( this->ComputeBudgetIsExhausted() )
+  {
+    this->m_StopCondition = ComputeBudgetExhausted;
+    this->StopOptimization();
+  }
+
+  /** Adapt the number of samples before the new samples are selected. */
+  if( !this->m_AdaptiveSamplers.empty() )
+  {
+    this->AdaptNumberOfSamples();
   }
 
   /** Select new spatial samples for the computation of the metric. */
@@ -318,7 +429,9 @@ AdaptiveStochasticGradientDescent< TElastix >
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   MetricValueConvergence,
+   *   ComputeBudgetExhausted } StopConditionType;
    */
   std::string stopcondition;
 
@@ -336,6 +449,20 @@ AdaptiveStochasticGradientDescent< TElastix >
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case MetricValueConvergence:
+    {
+      std::ostringstream makeStopCondition;
+      makeStopCondition << "The averaged metric value has converged (no significant decrease in the last "
+                        << this->GetConvergenceWindowSize() << " iterations, at iteration "
+                        << this->GetCurrentIteration() << ")";
+      stopcondition = makeStopCondition.str();
+      break;
+    }
+
+    case ComputeBudgetExhausted:
+      stopcondition = "The time budget of this resolution has been used up";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -344,6 +471,13 @@ AdaptiveStochasticGradientDescent< TElastix >
   /** Print the stopping condition. */
   elxout << "Stopping condition: " << stopcondition << "." << std::endl;
 
+  /** Print the final number of samples. */
+  for( unsigned int i = 0; i < this->m_AdaptiveSamplers.size(); ++i )
+  {
+    elxout << "Adaptive number of spatial samples at the end of this resolution: "
+           << this->m_AdaptiveSamplers[ i ]->GetNumberOfSamples() << std::endl;
+  }
+
   /** Store the used parameters, for later printing to screen. */
   SettingsType settings;
   settings.a     = this->GetParam_a();
@@ -354,6 +488,18 @@ AdaptiveStochasticGradientDescent< TElastix >
   settings.omega = this->GetSigmoidScale();
   this->m_SettingsVector.push_back( settings );
 
+  /** Keep the estimated parameters and the final time for a warm start of
+   * the next resolution.
+   */
+  this->m_WarmStartAvailable = this->GetAutomaticParameterEstimation()
+    && this->m_InitialGradientMagnitude > 0.0;
+  this->m_WarmStartSettings           = settings;
+  this->m_WarmStartSigmoidEstimated   = this->m_SigmoidEstimated;
+  this->m_WarmStartTime               = this->GetCurrentTime();
+  this->m_WarmStartMaximumStepLength  = this->GetMaximumStepLength();
+  this->m_WarmStartGradientMagnitude  = this->m_InitialGradientMagnitude;
+  this->m_WarmStartNumberOfParameters = this->GetScaledCurrentPosition().GetSize();
+
   /** Print settings that were used in this resolution. */
   SettingsVectorType tempSettingsVector;
   tempSettingsVector.push_back( settings );
@@ -412,13 +558,119 @@ AdaptiveStochasticGradientDescent< TElastix >
     }
   }
 
-  this->m_AutomaticParameterEstimationDone = false;
+  /** Parameters restored from a checkpoint are not estimated again. */
+  this->m_AutomaticParameterEstimationDone = this->m_StepSizeParametersFromCheckpoint;
+  this->m_StepSizeParametersFromCheckpoint = false;
+
+  this->InitializeAdaptiveNumberOfSamples();
+  this->m_InitialGradientMagnitude = 0.0;
 
   this->Superclass1::StartOptimization();
 
 } // end StartOptimization()
 
 
+/**
+ * ************** InitializeAdaptiveNumberOfSamples *****************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::InitializeAdaptiveNumberOfSamples( void )
+{
+  this->m_AdaptiveSamplers.clear();
+  this->m_AdaptiveSamplersMaximum.clear();
+  this->SetEstimateGradientNoise( false );
+  if( !this->m_UseAdaptiveNumberOfSamples )
+  {
+    return;
+  }
+
+  if( !this->GetNewSamplesEveryIteration() )
+  {
+    xl::xout[ "warning" ]
+      << "WARNING: UseAdaptiveNumberOfSamples is ignored, "
+      << "because NewSamplesEveryIteration is not set to \"true\"." << std::endl;
+    return;
+  }
+
+  /** Collect the random samplers, each once. */
+  const unsigned int M = this->GetElastix()->GetNumberOfMetrics();
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    ImageRandomSamplerBasePointer sampler = dynamic_cast< ImageRandomSamplerBaseType * >(
+      this->GetElastix()->GetElxMetricBase( m )->GetAdvancedMetricImageSampler() );
+    if( sampler.IsNull()
+      || std::find( this->m_AdaptiveSamplers.begin(), this->m_AdaptiveSamplers.end(), sampler )
+      != this->m_AdaptiveSamplers.end() )
+    {
+      continue;
+    }
+
+    const SizeValueType minimum = this->m_MinimumNumberOfSpatialSamples > 0
+      ? this->m_MinimumNumberOfSpatialSamples : sampler->GetNumberOfSamples();
+    const SizeValueType maximum = vnl_math_max( minimum,
+      this->m_MaximumNumberOfSpatialSamples > 0
+      ? this->m_MaximumNumberOfSpatialSamples : 8 * minimum );
+    sampler->SetNumberOfSamples( minimum );
+
+    /** Let the growing sample sets fit in the memory of the output. */
+    sampler->GetOutput()->reserve( maximum );
+
+    this->m_AdaptiveSamplers.push_back( sampler );
+    this->m_AdaptiveSamplersMaximum.push_back( maximum );
+  }
+
+  this->SetEstimateGradientNoise( !this->m_AdaptiveSamplers.empty() );
+
+} // end InitializeAdaptiveNumberOfSamples()
+
+
+/**
+ * ********************* AdaptNumberOfSamples ***********************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::AdaptNumberOfSamples( void )
+{
+  /** Wait for a noise estimate of at least one interval. */
+  const SizeValueType interval = this->m_AdaptiveNumberOfSamplesInterval;
+  if( this->GetNumberOfGradientNoiseMeasurements() < interval
+    || ( this->GetCurrentIteration() + 1 ) % interval != 0 )
+  {
+    return;
+  }
+
+  /** The variance of the approximation error is inversely proportional to
+   * the number of samples. Grow by at most a factor of two per interval,
+   * so that the moving averages can follow.
+   */
+  const double ratio  = this->GetGradientNoiseToSignalRatio();
+  const double factor = vnl_math_min( 2.0,
+    ratio / vnl_math_max( this->m_TargetGradientNoiseToSignalRatio, 1e-14 ) );
+  if( factor <= 1.0 )
+  {
+    return;
+  }
+
+  for( unsigned int i = 0; i < this->m_AdaptiveSamplers.size(); ++i )
+  {
+    const SizeValueType current = this->m_AdaptiveSamplers[ i ]->GetNumberOfSamples();
+    const SizeValueType grown   = static_cast< SizeValueType >(
+      vcl_ceil( factor * static_cast< double >( current ) ) );
+    const SizeValueType number = vnl_math_min( grown, this->m_AdaptiveSamplersMaximum[ i ] );
+    if( number > current )
+    {
+      this->m_AdaptiveSamplers[ i ]->SetNumberOfSamples( number );
+    }
+  }
+
+} // end AdaptNumberOfSamples()
+
+
 /**
  * ********************** ResumeOptimization **********************
  */
@@ -436,7 +688,10 @@ AdaptiveStochasticGradientDescent< TElastix >
   if( this->GetAutomaticParameterEstimation()
     && !this->m_AutomaticParameterEstimationDone )
   {
-    this->AutomaticParameterEstimation();
+    if( !this->WarmStartAutomaticParameterEstimation() )
+    {
+      this->AutomaticParameterEstimation();
+    }
     // hack
     this->m_AutomaticParameterEstimationDone = true;
   }
@@ -446,6 +701,56 @@ AdaptiveStochasticGradientDescent< TElastix >
 } // end ResumeOptimization()
 
 
+/**
+ * ****************** WriteCheckpoint *************************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const
+{
+  this->Superclass2::WriteCheckpoint( checkpoint );
+
+  itk::RegistrationCheckpoint::EntryType parameters( 6 );
+  parameters[ 0 ] = this->GetParam_a();
+  parameters[ 1 ] = this->GetParam_A();
+  parameters[ 2 ] = this->GetParam_alpha();
+  parameters[ 3 ] = this->GetSigmoidMax();
+  parameters[ 4 ] = this->GetSigmoidMin();
+  parameters[ 5 ] = this->GetSigmoidScale();
+  checkpoint.SetEntry( std::string( this->GetComponentLabel() ) + ".StepSizeParameters", parameters );
+
+} // end WriteCheckpoint()
+
+
+/**
+ * ****************** ReadCheckpoint *************************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint )
+{
+  this->Superclass2::ReadCheckpoint( checkpoint );
+
+  itk::RegistrationCheckpoint::EntryType parameters;
+  if( checkpoint.GetEntry( std::string( this->GetComponentLabel() ) + ".StepSizeParameters", parameters )
+    && parameters.size() == 6 )
+  {
+    this->SetParam_a( parameters[ 0 ] );
+    this->SetParam_A( parameters[ 1 ] );
+    this->SetParam_alpha( parameters[ 2 ] );
+    this->SetSigmoidMax( parameters[ 3 ] );
+    this->SetSigmoidMin( parameters[ 4 ] );
+    this->SetSigmoidScale( parameters[ 5 ] );
+    this->m_StepSizeParametersFromCheckpoint = true;
+  }
+
+} // end ReadCheckpoint()
+
+
 /**
  * ****************** MetricErrorResponse *************************
  */
@@ -488,6 +793,9 @@ void
 AdaptiveStochasticGradientDescent< TElastix >
 ::AutomaticParameterEstimation( void )
 {
+  itkPhaseTimerMacro( "AutomaticParameterEstimation" );
+  this->m_SigmoidEstimated = false;
+
   /** Total time. */
   itk::TimeProbe timer1;
   timer1.Start();
@@ -500,6 +808,39 @@ AdaptiveStochasticGradientDescent< TElastix >
   this->GetConfiguration()->ReadParameter( asgdParameterEstimationMethod,
     "ASGDParameterEstimationMethod", this->GetComponentLabel(), 0, 0 );
 
+  /** Check the cache for the results of an earlier identical estimation. */
+  std::string cacheDirectory = "";
+  this->GetConfiguration()->ReadParameter( cacheDirectory,
+    "AutomaticParameterEstimationCacheDirectory", this->GetComponentLabel(), 0, 0 );
+  std::string cacheKey      = "";
+  std::string cacheFileName = "";
+  if( !cacheDirectory.empty() )
+  {
+    cacheKey = this->GetAutomaticParameterEstimationCacheKey( asgdParameterEstimationMethod );
+
+    /** The file name is based on a FNV-1a hash of the key. */
+    unsigned int hash = 2166136261u;
+    for( std::string::const_iterator it = cacheKey.begin(); it != cacheKey.end(); ++it )
+    {
+      hash ^= static_cast< unsigned char >( *it );
+      hash *= 16777619u;
+    }
+    std::ostringstream makeFileName;
+    makeFileName << cacheDirectory << "/ASGDParameterEstimation_"
+                 << std::hex << std::setw( 8 ) << std::setfill( '0' ) << hash << ".txt";
+    cacheFileName = makeFileName.str();
+
+    if( this->ReadAutomaticParameterEstimationCache( cacheFileName, cacheKey ) )
+    {
+      timer1.Stop();
+      elxout << "  Reused the estimated parameters cached in "
+             << cacheFileName << "\n"
+             << "Automatic parameter estimation took "
+             << this->ConvertSecondsToDHMS( timer1.GetMean(), 2 ) << std::endl;
+      return;
+    }
+  }
+
   /** Perform automatic optimizer parameter estimation by the desired method. */
   if( asgdParameterEstimationMethod == "Original" )
   {
@@ -519,6 +860,13 @@ AdaptiveStochasticGradientDescent< TElastix >
     this->AutomaticParameterEstimationUsingDisplacementDistribution();
   }
 
+  /** Store the results for later runs. */
+  if( !cacheDirectory.empty() )
+  {
+    this->WriteAutomaticParameterEstimationCache( cacheFileName, cacheKey,
+      asgdParameterEstimationMethod == "Original" );
+  }
+
   /** Print the elapsed time. */
   timer1.Stop();
   elxout << "Automatic parameter estimation took "
@@ -527,6 +875,205 @@ AdaptiveStochasticGradientDescent< TElastix >
 } // end AutomaticParameterEstimation()
 
 
+/**
+ * ************** GetAutomaticParameterEstimationCacheKey **************
+ */
+
+template< class TElastix >
+std::string
+AdaptiveStochasticGradientDescent< TElastix >
+::GetAutomaticParameterEstimationCacheKey( const std::string & estimationMethod ) const
+{
+  /** The parameters that influence the estimation, other than through the
+   * geometry of the fixed image and the transform.
+   */
+  static const char * const parameterNames[] = {
+    "Registration", "Metric", "ImageSampler", "Interpolator", "FixedImagePyramid",
+    "Transform", "NumberOfResolutions", "FixedImagePyramidSchedule", "ImagePyramidSchedule",
+    "NumberOfSpatialSamples", "NumberOfHistogramBins", "FixedKernelBSplineOrder",
+    "MovingKernelBSplineOrder", "UseRandomSampleRegion", "SampleRegionSize",
+    "FinalGridSpacingInVoxels", "FinalGridSpacingInPhysicalUnits", "GridSpacingSchedule",
+    "Metric0Weight", "Metric1Weight", "Metric2Weight", "Metric3Weight",
+    "NumberOfJacobianMeasurements", "NumberOfGradientMeasurements",
+    "NumberOfSamplesForExactGradient", "NumberOfBandStructureSamples", "MaxBandCovSize",
+    "UseMetricSamplerForJacobianTerms", "NoiseCompensation", "SigmoidScaleFactor",
+    "MaximumDisplacementEstimationMethod" };
+  const unsigned int numberOfParameterNames
+    = sizeof( parameterNames ) / sizeof( parameterNames[ 0 ] );
+
+  std::ostringstream key;
+  key << std::setprecision( 17 );
+  key << "Level=" << this->m_Registration->GetAsITKBaseType()->GetCurrentLevel()
+      << ";Method=" << estimationMethod
+      << ";MaximumStepLength=" << this->GetMaximumStepLength()
+      << ";SP_A=" << this->GetParam_A();
+  for( unsigned int i = 0; i < numberOfParameterNames; ++i )
+  {
+    const std::size_t numberOfEntries
+      = this->GetConfiguration()->CountNumberOfParameterEntries( parameterNames[ i ] );
+    std::vector< std::string > values;
+    if( numberOfEntries > 0 )
+    {
+      this->GetConfiguration()->ReadParameter( values, parameterNames[ i ],
+        0, numberOfEntries - 1, false );
+    }
+    key << ";" << parameterNames[ i ] << "=";
+    for( unsigned int j = 0; j < values.size(); ++j )
+    {
+      key << values[ j ] << " ";
+    }
+  }
+
+  /** The geometry of the fixed image and region of the (first) metric. */
+  typedef typename ElastixType::MetricBaseType::AdvancedMetricType MetricType;
+  const MetricType * metric = dynamic_cast< const MetricType * >(
+    this->GetElastix()->GetElxMetricBase()->GetAsITKBaseType() );
+  if( metric != 0 && metric->GetFixedImage() != 0 )
+  {
+    const FixedImageType * fixedImage = metric->GetFixedImage();
+    key << ";FixedImageSize=" << fixedImage->GetLargestPossibleRegion().GetSize()
+        << ";FixedImageSpacing=" << fixedImage->GetSpacing()
+        << ";FixedImageOrigin=" << fixedImage->GetOrigin()
+        << ";FixedImageDirection=";
+    for( unsigned int i = 0; i < FixedImageType::ImageDimension; ++i )
+    {
+      for( unsigned int j = 0; j < FixedImageType::ImageDimension; ++j )
+      {
+        key << fixedImage->GetDirection()[ i ][ j ] << " ";
+      }
+    }
+    key << ";FixedImageRegionIndex=" << metric->GetFixedImageRegion().GetIndex()
+        << ";FixedImageRegionSize=" << metric->GetFixedImageRegion().GetSize()
+        << ";FixedImageMask=" << ( metric->GetFixedImageMask() != 0 );
+  }
+
+  /** The transform type and grid. */
+  const TransformType * transform
+    = this->GetRegistration()->GetAsITKBaseType()->GetTransform();
+  key << ";TransformClass=" << transform->GetNameOfClass()
+      << ";NumberOfParameters=" << transform->GetNumberOfParameters()
+      << ";FixedParameters=";
+  const ParametersType & fixedParameters = transform->GetFixedParameters();
+  for( unsigned int i = 0; i < fixedParameters.GetSize(); ++i )
+  {
+    key << fixedParameters[ i ] << " ";
+  }
+
+  /** The scales. */
+  key << ";UseScales=" << this->GetUseScales() << ";Scales=";
+  if( this->GetUseScales() )
+  {
+    const ScalesType & scales = this->GetScales();
+    for( unsigned int i = 0; i < scales.GetSize(); ++i )
+    {
+      key << scales[ i ] << " ";
+    }
+  }
+
+  return key.str();
+
+} // end GetAutomaticParameterEstimationCacheKey()
+
+
+/**
+ * ************** ReadAutomaticParameterEstimationCache **************
+ */
+
+template< class TElastix >
+bool
+AdaptiveStochasticGradientDescent< TElastix >
+::ReadAutomaticParameterEstimationCache(
+  const std::string & fileName, const std::string & key )
+{
+  std::ifstream cacheFile( fileName.c_str() );
+  if( !cacheFile.is_open() )
+  {
+    return false;
+  }
+
+  /** The first line holds the key, the second one the results. */
+  std::string storedKey;
+  std::getline( cacheFile, storedKey );
+  if( storedKey != key )
+  {
+    return false;
+  }
+
+  double        a = 0.0, alpha = 0.0, fmax = 0.0, fmin = 0.0, omega = 0.0;
+  SizeValueType numberOfGradientMeasurements = 0;
+  unsigned int  readSigmoid                  = 0;
+  cacheFile >> a >> alpha >> fmax >> fmin >> omega
+  >> numberOfGradientMeasurements >> readSigmoid;
+  if( cacheFile.fail() )
+  {
+    xl::xout[ "warning" ] << "WARNING: The cache file " << fileName
+                          << " could not be read and is ignored." << std::endl;
+    return false;
+  }
+
+  /** Set the parameters as the estimation would have done. */
+  this->SetParam_a( a );
+  this->SetParam_alpha( alpha );
+  if( readSigmoid != 0 )
+  {
+    this->SetSigmoidMax( fmax );
+    this->SetSigmoidMin( fmin );
+    this->SetSigmoidScale( omega );
+    this->m_SigmoidEstimated = true;
+  }
+  if( this->m_NumberOfGradientMeasurements == 0 )
+  {
+    this->m_NumberOfGradientMeasurements = numberOfGradientMeasurements;
+  }
+
+  return true;
+
+} // end ReadAutomaticParameterEstimationCache()
+
+
+/**
+ * ************** WriteAutomaticParameterEstimationCache **************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::WriteAutomaticParameterEstimationCache(
+  const std::string & fileName, const std::string & key, const bool writeSigmoid ) const
+{
+  /** Write to a temporary file first and rename it, so that concurrent runs
+   * never read a partially written cache file.
+   */
+  std::ostringstream makeTemporaryFileName;
+  makeTemporaryFileName << fileName << "." << this << ".tmp";
+  const std::string temporaryFileName = makeTemporaryFileName.str();
+
+  std::ofstream cacheFile( temporaryFileName.c_str() );
+  if( !cacheFile.is_open() )
+  {
+    xl::xout[ "warning" ] << "WARNING: The cache file " << fileName
+                          << " could not be written." << std::endl;
+    return;
+  }
+  cacheFile << key << "\n" << std::setprecision( 17 )
+            << this->GetParam_a() << " " << this->GetParam_alpha() << " "
+            << this->GetSigmoidMax() << " " << this->GetSigmoidMin() << " "
+            << this->GetSigmoidScale() << " "
+            << this->m_NumberOfGradientMeasurements << " "
+            << ( writeSigmoid ? 1 : 0 ) << std::endl;
+  cacheFile.close();
+
+  std::remove( fileName.c_str() );
+  if( std::rename( temporaryFileName.c_str(), fileName.c_str() ) != 0 )
+  {
+    std::remove( temporaryFileName.c_str() );
+    xl::xout[ "warning" ] << "WARNING: The cache file " << fileName
+                          << " could not be written." << std::endl;
+  }
+
+} // end WriteAutomaticParameterEstimationCache()
+
+
 /**
  * ******************* AutomaticParameterEstimationOriginal **********************
  */
@@ -574,6 +1121,13 @@ AdaptiveStochasticGradientDescent< TElastix >
   computeJacobianTerms->SetNumberOfJacobianMeasurements(
     this->m_NumberOfJacobianMeasurements );
 
+  /** Reuse the samples of the metric, instead of sampling the fixed image on a grid. */
+  if( this->m_UseMetricSamplerForJacobianTerms && testPtr->GetImageSampler() != 0 )
+  {
+    testPtr->GetImageSampler()->Update();
+    computeJacobianTerms->SetSampleContainer( testPtr->GetImageSampler()->GetOutput() );
+  }
+
   /** Check if use scales. */
   bool useScales = this->GetUseScales();
   if( useScales )
@@ -679,10 +1233,86 @@ AdaptiveStochasticGradientDescent< TElastix >
     this->SetSigmoidMax( fmax );
     this->SetSigmoidMin( fmin );
     this->SetSigmoidScale( omega );
+    this->m_SigmoidEstimated = true;
   }
 } // end AutomaticParameterEstimationOriginal()
 
 
+/**
+ * *************** WarmStartAutomaticParameterEstimation **********************
+ */
+
+template< class TElastix >
+bool
+AdaptiveStochasticGradientDescent< TElastix >
+::WarmStartAutomaticParameterEstimation( void )
+{
+  if( !this->m_WarmStartAutomaticParameterEstimation || !this->m_WarmStartAvailable )
+  {
+    return false;
+  }
+
+  /** Measure the gradient at the start of this resolution. */
+  DerivativeType gradient;
+  this->GetScaledDerivativeWithExceptionHandling( this->GetScaledCurrentPosition(), gradient );
+  const double        gradientMagnitude  = gradient.magnitude();
+  const SizeValueType numberOfParameters = gradient.GetSize();
+
+  /** The root mean square of the gradient elements should be comparable to
+   * that of the previous resolution, otherwise the landscape has changed too
+   * much to trust the scaled parameters. The check also fails for zero or
+   * non-finite gradients.
+   */
+  const double gradientRatio = gradientMagnitude / this->m_WarmStartGradientMagnitude;
+  const double rmsRatio      = gradientRatio * vcl_sqrt(
+    static_cast< double >( this->m_WarmStartNumberOfParameters )
+    / static_cast< double >( numberOfParameters ) );
+  const double tolerance = vnl_math_max( this->m_WarmStartGradientTolerance, 1.0 );
+  if( !( rmsRatio >= 1.0 / tolerance && rmsRatio <= tolerance ) )
+  {
+    elxout << "The root mean square of the gradient changed by a factor "
+           << rmsRatio << " since the previous resolution;\n"
+           << "  the parameters of " << this->elxGetClassName()
+           << " are estimated instead of warm started." << std::endl;
+    return false;
+  }
+
+  /** The estimated SP_a is proportional to the maximum step length and the
+   * square root of the number of parameters (through the trace of the
+   * Jacobian covariance), and inversely proportional to the gradient
+   * magnitude. The sigmoid compares inner products of gradients, so its
+   * scale goes with the squared gradient magnitude.
+   */
+  const double a = this->m_WarmStartSettings.a
+    * this->GetMaximumStepLength() / this->m_WarmStartMaximumStepLength
+    * vcl_sqrt( static_cast< double >( numberOfParameters )
+    / static_cast< double >( this->m_WarmStartNumberOfParameters ) )
+    / gradientRatio;
+  this->SetParam_a( a );
+  this->SetParam_alpha( this->m_WarmStartSettings.alpha );
+  if( this->m_WarmStartSigmoidEstimated )
+  {
+    this->SetSigmoidMax( this->m_WarmStartSettings.fmax );
+    this->SetSigmoidMin( this->m_WarmStartSettings.fmin );
+    this->SetSigmoidScale( vnl_math_max( 1e-14,
+      this->m_WarmStartSettings.omega * gradientRatio * gradientRatio ) );
+  }
+  this->m_SigmoidEstimated = this->m_WarmStartSigmoidEstimated;
+
+  /** Continue from the time reached in the previous resolution. */
+  this->SetInitialTime( vnl_math_max( 0.0, this->m_WarmStartTime * this->m_WarmStartTimeFactor ) );
+  this->ResetCurrentTimeToInitialTime();
+
+  elxout << "Warm started the parameters of " << this->elxGetClassName()
+         << " from the previous resolution:\n"
+         << "  SP_a = " << a << ", initial time = " << this->GetCurrentTime()
+         << ", gradient magnitude ratio = " << gradientRatio << std::endl;
+
+  return true;
+
+} // end WarmStartAutomaticParameterEstimation()
+
+
 /**
  * *************** AutomaticParameterEstimationUsingDisplacementDistribution *****
  */
@@ -724,6 +1354,13 @@ AdaptiveStochasticGradientDescent< TElastix >
   computeDisplacementDistribution->SetNumberOfJacobianMeasurements(
     this->m_NumberOfJacobianMeasurements );
 
+  /** Reuse the samples of the metric, instead of sampling the fixed image on a grid. */
+  if( this->m_UseMetricSamplerForJacobianTerms && testPtr->GetImageSampler() != 0 )
+  {
+    testPtr->GetImageSampler()->Update();
+    computeDisplacementDistribution->SetSampleContainer( testPtr->GetImageSampler()->GetOutput() );
+  }
+
   /** Check if use scales. */
   if( this->GetUseScales() )
   {
@@ -20,6 +20,9 @@
 
 #include "vnl/vnl_math.h"
 #include "itkSigmoidImageFilter.h"
+#include "itkPhaseTimer.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -36,9 +39,398 @@ AdaptiveStochasticGradientDescentOptimizer
   this->m_SigmoidMin           = -0.8;
   this->m_SigmoidScale         = 1e-8;
 
+  this->m_UseConvergenceStopping       = false;
+  this->m_ConvergenceWindowSize        = 100;
+  this->m_ConvergenceRelativeTolerance = 1e-4;
+  this->m_AveragedValue                = 0.0;
+  this->m_NumberOfAveragedValues       = 0;
+
+  this->m_UseResidentParameters     = false;
+  this->m_ResidentCostFunction      = 0;
+  this->m_ResidentGradientMagnitude = 0.0;
+  this->m_ResidentInnerProduct      = 0.0;
+
+  this->m_EstimateGradientNoise             = false;
+  this->m_AveragedGradientInnerProduct      = 0.0;
+  this->m_AveragedSquaredGradientMagnitude  = 0.0;
+  this->m_NumberOfGradientNoiseMeasurements = 0;
+
 }   // end Constructor
 
 
+/**
+ * ********************** StartOptimization *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::StartOptimization( void )
+{
+  this->m_AveragedValue          = 0.0;
+  this->m_NumberOfAveragedValues = 0;
+  this->m_AveragedValues.assign(
+    vnl_math_max( this->m_ConvergenceWindowSize, static_cast< unsigned long >( 3 ) ), 0.0 );
+
+  this->m_AveragedGradientInnerProduct      = 0.0;
+  this->m_AveragedSquaredGradientMagnitude  = 0.0;
+  this->m_NumberOfGradientNoiseMeasurements = 0;
+
+  this->Superclass::StartOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ********************** ResumeOptimization *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::ResumeOptimization( void )
+{
+  this->RestorePendingOptimizationState();
+
+  /** The resident steps take the gradient as it is, so only without scales
+   * and for minimization the scaled cost function may be bypassed.
+   */
+  this->m_ResidentCostFunction = 0;
+  if( this->m_UseResidentParameters && !this->GetUseScales() && !this->GetMaximize() )
+  {
+    this->m_ResidentCostFunction
+      = ResidentParametersCostFunction::Get( this->m_CostFunction.GetPointer() );
+  }
+  if( this->m_ResidentCostFunction == 0 )
+  {
+    this->Superclass::ResumeOptimization();
+    return;
+  }
+
+  this->m_ResidentCostFunction->SetResidentParameters( this->GetScaledCurrentPosition() );
+
+  this->m_Stop = false;
+  this->InvokeEvent( StartEvent() );
+
+  /** The loop of GradientDescentOptimizer2::ResumeOptimization(), of which
+   * the gradient stays in the cost function.
+   */
+  while( !this->m_Stop )
+  {
+    try
+    {
+      this->m_ResidentCostFunction->GetValueAndResidentDerivative( this->m_Value );
+    }
+    catch( ExceptionObject & err )
+    {
+      /** The response may resume from the current position. */
+      this->PullResidentParameters();
+      this->MetricErrorResponse( err );
+    }
+
+    /** StopOptimization may have been called. */
+    if( this->m_Stop )
+    {
+      break;
+    }
+
+    this->AdvanceOneStep();
+
+    /** StopOptimization may have been called. */
+    if( this->m_Stop )
+    {
+      break;
+    }
+
+    this->m_CurrentIteration++;
+
+    if( this->m_CurrentIteration >= this->m_NumberOfIterations )
+    {
+      this->m_StopCondition = MaximumNumberOfIterations;
+      this->StopOptimization();
+      break;
+    }
+
+  } // end while
+
+} // end ResumeOptimization()
+
+
+/**
+ * ********************** StopOptimization *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::StopOptimization( void )
+{
+  /** Make the final position available to the EndEvent observers. */
+  this->PullResidentParameters();
+  this->m_ResidentCostFunction = 0;
+
+  this->Superclass::StopOptimization();
+
+} // end StopOptimization()
+
+
+/**
+ * ********************** GetWorkMemorySize *********************
+ */
+
+SizeValueType
+AdaptiveStochasticGradientDescentOptimizer
+::GetWorkMemorySize( void ) const
+{
+  return this->Superclass::GetWorkMemorySize()
+         + this->m_PreviousGradient.Size() * sizeof( double );
+
+} // end GetWorkMemorySize()
+
+
+/**
+ * ********************** GetOptimizationState *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::GetOptimizationState( OptimizationStateType & state ) const
+{
+  /** Called during the iteration event, before the iteration is counted. */
+  state.clear();
+  state.push_back( static_cast< double >( this->m_CurrentIteration + 1 ) );
+  state.push_back( this->m_CurrentTime );
+  state.push_back( this->m_AveragedValue );
+  state.push_back( static_cast< double >( this->m_NumberOfAveragedValues ) );
+  state.push_back( this->m_AveragedGradientInnerProduct );
+  state.push_back( this->m_AveragedSquaredGradientMagnitude );
+  state.push_back( static_cast< double >( this->m_NumberOfGradientNoiseMeasurements ) );
+  state.push_back( static_cast< double >( this->m_AveragedValues.size() ) );
+  state.insert( state.end(), this->m_AveragedValues.begin(), this->m_AveragedValues.end() );
+  state.push_back( static_cast< double >( this->m_PreviousGradient.Size() ) );
+  state.insert( state.end(), this->m_PreviousGradient.begin(), this->m_PreviousGradient.end() );
+
+} // end GetOptimizationState()
+
+
+/**
+ * ********************** RestorePendingOptimizationState *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::RestorePendingOptimizationState( void )
+{
+  if( this->m_PendingOptimizationState.empty() )
+  {
+    return;
+  }
+  OptimizationStateType state;
+  state.swap( this->m_PendingOptimizationState );
+
+  /** Check the sizes of the window and the gradient. */
+  const std::size_t windowSize = state.size() > 7 ? static_cast< std::size_t >( state[ 7 ] ) : 0;
+  const std::size_t gradientPosition = 8 + windowSize;
+  if( state.size() <= gradientPosition || windowSize != this->m_AveragedValues.size()
+    || state.size() != gradientPosition + 1 + static_cast< std::size_t >( state[ gradientPosition ] ) )
+  {
+    itkExceptionMacro( << "ERROR: the optimization state does not match the settings of the optimizer." );
+  }
+
+  this->m_CurrentIteration                  = static_cast< unsigned long >( state[ 0 ] );
+  this->m_CurrentTime                       = state[ 1 ];
+  this->m_AveragedValue                     = state[ 2 ];
+  this->m_NumberOfAveragedValues            = static_cast< unsigned long >( state[ 3 ] );
+  this->m_AveragedGradientInnerProduct      = state[ 4 ];
+  this->m_AveragedSquaredGradientMagnitude  = state[ 5 ];
+  this->m_NumberOfGradientNoiseMeasurements = static_cast< unsigned long >( state[ 6 ] );
+  std::copy( state.begin() + 8, state.begin() + gradientPosition, this->m_AveragedValues.begin() );
+  this->m_PreviousGradient.SetSize( static_cast< unsigned int >( state[ gradientPosition ] ) );
+  std::copy( state.begin() + gradientPosition + 1, state.end(), this->m_PreviousGradient.begin() );
+
+} // end RestorePendingOptimizationState()
+
+
+/**
+ * ********************** PullResidentParameters *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::PullResidentParameters( void )
+{
+  if( this->m_ResidentCostFunction == 0 )
+  {
+    return;
+  }
+
+  ParametersType parameters;
+  this->m_ResidentCostFunction->GetResidentParameters( parameters );
+  this->SetScaledCurrentPosition( parameters );
+
+} // end PullResidentParameters()
+
+
+/**
+ * ********************** AdvanceOneStep *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::AdvanceOneStep( void )
+{
+  if( this->m_ResidentCostFunction == 0 )
+  {
+    this->Superclass::AdvanceOneStep();
+  }
+  else
+  {
+    /** The steps of StandardGradientDescentOptimizer::AdvanceOneStep(). */
+    if( this->m_UseConstantStep )
+    {
+      this->SetLearningRate( this->Compute_a( 0 ) );
+    }
+    else
+    {
+      this->SetLearningRate( this->Compute_a( this->m_CurrentTime ) );
+    }
+
+    double squaredMagnitude = 0.0;
+    {
+      itkPhaseTimerMacro( "OptimizerStep" );
+      this->m_ResidentCostFunction->AdvanceResidentParameters(
+        this->m_LearningRate, squaredMagnitude, this->m_ResidentInnerProduct );
+    }
+    this->m_ResidentGradientMagnitude = vcl_sqrt( squaredMagnitude );
+
+    this->InvokeEvent( IterationEvent() );
+
+    /** An observer may have stopped the optimization. */
+    if( this->m_Stop )
+    {
+      return;
+    }
+
+    this->UpdateCurrentTime();
+  }
+
+  if( this->m_UseConvergenceStopping && this->CheckConvergence() )
+  {
+    this->m_StopCondition = MetricValueConvergence;
+    this->StopOptimization();
+  }
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ********************** CheckConvergence *********************
+ */
+
+bool
+AdaptiveStochasticGradientDescentOptimizer
+::CheckConvergence( void )
+{
+  const unsigned long windowSize = this->m_AveragedValues.size();
+
+  /** Update the exponential moving average, with a memory of about a quarter window. */
+  const double decay = vnl_math_max( 0.5, 1.0 - 4.0 / static_cast< double >( windowSize ) );
+  if( this->m_NumberOfAveragedValues == 0 )
+  {
+    this->m_AveragedValue = this->GetValue();
+  }
+  else
+  {
+    this->m_AveragedValue = decay * this->m_AveragedValue + ( 1.0 - decay ) * this->GetValue();
+  }
+  this->m_AveragedValues[ this->m_NumberOfAveragedValues % windowSize ] = this->m_AveragedValue;
+  ++this->m_NumberOfAveragedValues;
+
+  /** Wait until the window is filled with values that are not dominated
+   * by the start of the moving average.
+   */
+  if( this->m_NumberOfAveragedValues < 2 * windowSize )
+  {
+    return false;
+  }
+
+  /** Least squares fit of a line through the window, with x = 0 for the oldest value. */
+  const double n     = static_cast< double >( windowSize );
+  const double meanx = ( n - 1.0 ) / 2.0;
+  const double sxx   = n * ( n * n - 1.0 ) / 12.0;
+  double       meany = 0.0;
+  double       sxy   = 0.0;
+  for( unsigned long k = 0; k < windowSize; ++k )
+  {
+    const double y = this->m_AveragedValues[ ( this->m_NumberOfAveragedValues + k ) % windowSize ];
+    meany += y;
+    sxy   += ( static_cast< double >( k ) - meanx ) * y;
+  }
+  meany /= n;
+  const double slope = sxy / sxx;
+
+  /** Standard error of the slope. */
+  double ssr = 0.0;
+  for( unsigned long k = 0; k < windowSize; ++k )
+  {
+    const double y = this->m_AveragedValues[ ( this->m_NumberOfAveragedValues + k ) % windowSize ];
+    ssr += vnl_math_sqr( y - meany - slope * ( static_cast< double >( k ) - meanx ) );
+  }
+  const double slopeError = vcl_sqrt( ssr / ( n - 2.0 ) / sxx );
+
+  /** Converged if the decrease over the window is insignificant, even at
+   * the upper bound of its 95% confidence interval.
+   */
+  const double maximumDecrease = ( -slope + 2.0 * slopeError ) * ( n - 1.0 );
+  return maximumDecrease < this->m_ConvergenceRelativeTolerance
+         * vnl_math_max( vcl_abs( meany ), 1e-14 );
+
+} // end CheckConvergence()
+
+
+/**
+ * ********************** UpdateGradientNoiseEstimate *********************
+ */
+
+void
+AdaptiveStochasticGradientDescentOptimizer
+::UpdateGradientNoiseEstimate( const double innerProduct,
+  const double squaredMagnitude )
+{
+  const double decay = 0.9;
+  if( this->m_NumberOfGradientNoiseMeasurements == 0 )
+  {
+    this->m_AveragedGradientInnerProduct     = innerProduct;
+    this->m_AveragedSquaredGradientMagnitude = squaredMagnitude;
+  }
+  else
+  {
+    this->m_AveragedGradientInnerProduct = decay * this->m_AveragedGradientInnerProduct
+      + ( 1.0 - decay ) * innerProduct;
+    this->m_AveragedSquaredGradientMagnitude = decay * this->m_AveragedSquaredGradientMagnitude
+      + ( 1.0 - decay ) * squaredMagnitude;
+  }
+  ++this->m_NumberOfGradientNoiseMeasurements;
+
+} // end UpdateGradientNoiseEstimate()
+
+
+/**
+ * ********************** GetGradientNoiseToSignalRatio *********************
+ */
+
+double
+AdaptiveStochasticGradientDescentOptimizer
+::GetGradientNoiseToSignalRatio( void ) const
+{
+  if( this->m_AveragedGradientInnerProduct <= 0.0 )
+  {
+    return NumericTraits< double >::max();
+  }
+  const double noise = vnl_math_max( 0.0,
+    this->m_AveragedSquaredGradientMagnitude - this->m_AveragedGradientInnerProduct );
+  return noise / this->m_AveragedGradientInnerProduct;
+
+} // end GetGradientNoiseToSignalRatio()
+
+
 /**
  * ************************** UpdateCurrentTime ********************
  */
@@ -49,6 +441,32 @@ AdaptiveStochasticGradientDescentOptimizer
 {
   typedef itk::Functor::Sigmoid< double, double > SigmoidType;
 
+  /** The inner product with the previous gradient, for the adaptive step
+   * sizes and the noise estimate. The resident steps computed it already.
+   */
+  const bool usePreviousGradient = this->m_UseAdaptiveStepSizes || this->m_EstimateGradientNoise;
+  double     inprod              = 0.0;
+  if( usePreviousGradient && this->GetCurrentIteration() > 0 )
+  {
+    inprod = this->m_ResidentCostFunction != 0
+      ? this->m_ResidentInnerProduct
+      : inner_product( this->m_PreviousGradient, this->GetGradient() );
+
+    if( this->m_EstimateGradientNoise )
+    {
+      const double squaredMagnitude = this->m_ResidentCostFunction != 0
+        ? vnl_math_sqr( this->m_ResidentGradientMagnitude )
+        : this->GetGradient().squared_magnitude();
+      this->UpdateGradientNoiseEstimate( inprod, squaredMagnitude );
+    }
+  }
+
+  /** Save for next iteration, the resident steps keep it in the cost function */
+  if( usePreviousGradient && this->m_ResidentCostFunction == 0 )
+  {
+    this->m_PreviousGradient = this->GetGradient();
+  }
+
   if( this->m_UseAdaptiveStepSizes )
   {
     if( this->GetCurrentIteration() > 0 )
@@ -64,15 +482,10 @@ AdaptiveStochasticGradientDescentOptimizer
         * vcl_log( -this->GetSigmoidMax() / this->GetSigmoidMin() );
       sigmoid.SetBeta( beta );
 
-      /** Formula (2) in Cruz */
-      const double inprod = inner_product(
-        this->m_PreviousGradient, this->GetGradient() );
+      /** Formula (2) in Cruz. */
       this->m_CurrentTime += sigmoid( -inprod );
       this->m_CurrentTime  = vnl_math_max( 0.0, this->m_CurrentTime );
     }
-
-    /** Save for next iteration */
-    this->m_PreviousGradient = this->GetGradient();
   }
   else
   {
@@ -20,6 +20,8 @@
 #define __itkAdaptiveStochasticGradientDescentOptimizer_h
 
 #include "../StandardGradientDescent/itkStandardGradientDescentOptimizer.h"
+#include "itkResidentParametersCostFunction.h"
+#include <vector>
 
 namespace itk
 {
@@ -65,6 +67,31 @@ namespace itk
 * \c NewSamplesEveryIteration to \c "true" to achieve this effect.
 * For more information on this strategy, you may have a look at:
 *
+* Optionally, the optimization stops before the maximum number of iterations
+* when the metric value has converged. The noisy metric values are smoothed by
+* an exponential moving average, and a straight line is fitted to the averaged
+* values of the last ConvergenceWindowSize iterations. The optimization stops
+* when even the upper bound of the 95% confidence interval of the decrease
+* over the window is smaller than ConvergenceRelativeTolerance times the
+* magnitude of the averaged metric value.
+*
+* Optionally, the parameters are kept resident in the cost function, when
+* it implements the ResidentParametersCostFunction interface, for example
+* a metric that is computed on the GPU. The steps are then taken in the
+* storage of the cost function, and per iteration only the value and two
+* inner products are exchanged; the step size adaptation needs no more
+* than that. The GetGradient() and GetCurrentPosition() are not updated
+* during the iterations; the position is copied back when the optimization
+* stops. Only used without scales, for minimization.
+*
+* Optionally, the ratio of the noise to the signal of the stochastic gradients
+* is estimated during the optimization. For gradients g_k = g + e_k, with a
+* slowly changing exact gradient g and independent errors e_k, the inner
+* product of successive gradients measures |g|^2, and the squared magnitude
+* of a gradient |g|^2 + |e|^2. Both are smoothed by an exponential moving
+* average, with a memory of about ten iterations. The inner products are
+* computed anyway for the adaptive step sizes.
+*
 * \sa AdaptiveStochasticGradientDescent, StandardGradientDescentOptimizer
 * \ingroup Optimizers
 */
@@ -117,6 +144,68 @@ public:
   itkSetMacro( SigmoidScale, double );
   itkGetConstMacro( SigmoidScale, double );
 
+  /** Set/Get whether to stop when the metric value has converged. Default: false */
+  itkSetMacro( UseConvergenceStopping, bool );
+  itkGetConstMacro( UseConvergenceStopping, bool );
+
+  /** Set/Get the number of iterations over which the convergence of the
+  * averaged metric value is measured. Should be >= 3. Default: 100 */
+  itkSetMacro( ConvergenceWindowSize, unsigned long );
+  itkGetConstMacro( ConvergenceWindowSize, unsigned long );
+
+  /** Set/Get the relative decrease of the averaged metric value over the window
+  * below which the optimization is considered converged. Default: 1e-4 */
+  itkSetMacro( ConvergenceRelativeTolerance, double );
+  itkGetConstMacro( ConvergenceRelativeTolerance, double );
+
+  /** Set/Get whether to keep the parameters resident in the cost function,
+  * if it supports that. Default: false */
+  itkSetMacro( UseResidentParameters, bool );
+  itkGetConstMacro( UseResidentParameters, bool );
+
+  /** Whether the parameters are resident, during the optimization. */
+  bool GetParametersAreResident( void ) const
+  {
+    return this->m_ResidentCostFunction != 0;
+  }
+
+  /** The magnitude of the gradient of the last step taken on the resident
+  * parameters. */
+  itkGetConstMacro( ResidentGradientMagnitude, double );
+
+  /** Set/Get whether to estimate the noise-to-signal ratio of the gradients.
+  * Default: false */
+  itkSetMacro( EstimateGradientNoise, bool );
+  itkGetConstMacro( EstimateGradientNoise, bool );
+
+  /** The number of gradient pairs that contributed to the noise estimate,
+  * since the start of the optimization. */
+  itkGetConstMacro( NumberOfGradientNoiseMeasurements, unsigned long );
+
+  /** The estimated ratio |e|^2 / |g|^2 of the squared magnitudes of the
+  * approximation error and of the exact gradient. The maximum double when
+  * no signal is measured. */
+  double GetGradientNoiseToSignalRatio( void ) const;
+
+  /** Reset the convergence measurement and call the Superclass' implementation. */
+  virtual void StartOptimization( void );
+
+  /** Keep the parameters resident in the cost function if possible, and
+  * iterate like the Superclass. Otherwise, call the Superclass' implementation. */
+  virtual void ResumeOptimization( void );
+
+  /** Copy the resident parameters to the current position, and call the
+  * Superclass' implementation. */
+  virtual void StopOptimization( void );
+
+  /** The state of the optimization: the iteration number, the current time,
+  * the averaged metric values, the gradient noise estimate, and the previous
+  * gradient. */
+  virtual void GetOptimizationState( OptimizationStateType & state ) const;
+
+  /** Adds the previous gradient to the work memory of the Superclass. */
+  virtual SizeValueType GetWorkMemorySize( void ) const;
+
 protected:
 
   AdaptiveStochasticGradientDescentOptimizer();
@@ -131,6 +220,28 @@ protected:
   */
   virtual void UpdateCurrentTime( void );
 
+  /** Call the Superclass' implementation, or take the step on the resident
+  * parameters, and stop the optimization if the metric value has converged.
+  */
+  virtual void AdvanceOneStep( void );
+
+  /** Add the current value to the averaged metric values, and test whether
+  * they have converged.
+  */
+  virtual bool CheckConvergence( void );
+
+  /** Add the inner product of the current and the previous gradient and the
+  * squared magnitude of the current gradient to the noise estimate.
+  */
+  void UpdateGradientNoiseEstimate( const double innerProduct,
+    const double squaredMagnitude );
+
+  /** Copy the resident parameters to the current position. */
+  void PullResidentParameters( void );
+
+  /** Restore and clear the state set by SetOptimizationState(), if any. */
+  void RestorePendingOptimizationState( void );
+
   /** The PreviousGradient, necessary for the CruzAcceleration */
   DerivativeType m_PreviousGradient;
 
@@ -145,6 +256,28 @@ private:
   double m_SigmoidMin;
   double m_SigmoidScale;
 
+  bool          m_UseConvergenceStopping;
+  unsigned long m_ConvergenceWindowSize;
+  double        m_ConvergenceRelativeTolerance;
+
+  /** The averaged metric values of the last ConvergenceWindowSize iterations. */
+  double                m_AveragedValue;
+  std::vector< double > m_AveragedValues;
+  unsigned long         m_NumberOfAveragedValues;
+
+  /** The cost function that keeps the parameters resident, if any, and the
+  * results of the last step. */
+  bool                             m_UseResidentParameters;
+  ResidentParametersCostFunction * m_ResidentCostFunction;
+  double                           m_ResidentGradientMagnitude;
+  double                           m_ResidentInnerProduct;
+
+  /** The moving averages of the noise estimate. */
+  bool          m_EstimateGradientNoise;
+  double        m_AveragedGradientInnerProduct;
+  double        m_AveragedSquaredGradientMagnitude;
+  unsigned long m_NumberOfGradientNoiseMeasurements;
+
 };
 
 } // end namespace itk
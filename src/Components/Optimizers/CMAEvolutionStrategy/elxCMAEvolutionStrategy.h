@@ -107,6 +107,18 @@ namespace elastix
  *    reported back in the elastix.log file. This parameter can be specified for each resolution. \n
  *    example: <tt>(UpdateBDPeriod 0 0 50)</tt> \n
  *    Default: 0 (so, automatically determined).
+ * \parameter UseSeparableCovariance: a boolean that determines whether only the diagonal of the
+ *    covariance matrix is adapted. This makes the memory use and the time per iteration linear in
+ *    the number of parameters, instead of quadratic, and is recommended for transforms with more
+ *    than a few hundred parameters. UpdateBDPeriod is then ignored.
+ *    This parameter can be specified for each resolution. \n
+ *    example: <tt>(UseSeparableCovariance "true")</tt> \n
+ *    Default: "false".
+ * \parameter UseMultiThreadingForOptimizers: a boolean that determines whether the sampling of the
+ *    offspring and the update of the full covariance matrix are computed in parallel.
+ *    This parameter can be specified for each resolution. \n
+ *    example: <tt>(UseMultiThreadingForOptimizers "false")</tt> \n
+ *    Default: "true".
  *
  * \ingroup Optimizers
  */
@@ -170,6 +182,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetCurrentValue();
+  }
+
   virtual void AfterRegistration( void );
 
 protected:
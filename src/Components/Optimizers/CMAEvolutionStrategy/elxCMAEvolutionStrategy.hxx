@@ -184,6 +184,18 @@ CMAEvolutionStrategy< TElastix >
     "UpdateBDPeriod", this->GetComponentLabel(), level, 0 );
   this->SetUpdateBDPeriod( updateBDPeriod );
 
+  /** Set UseSeparableCovariance */
+  bool useSeparableCovariance = false;
+  this->m_Configuration->ReadParameter( useSeparableCovariance,
+    "UseSeparableCovariance", this->GetComponentLabel(), level, 0 );
+  this->SetUseSeparableCovariance( useSeparableCovariance );
+
+  /** Set UseMultiThread */
+  bool useMultiThreading = true;
+  this->m_Configuration->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetUseMultiThread( useMultiThreading );
+
   /** Set PositionToleranceMin */
   double positionToleranceMin = 1e-8;
   this->m_Configuration->ReadParameter( positionToleranceMin,
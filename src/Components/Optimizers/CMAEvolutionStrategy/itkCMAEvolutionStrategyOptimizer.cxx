@@ -21,6 +21,7 @@
 
 #include "itkCMAEvolutionStrategyOptimizer.h"
 #include "itkSymmetricEigenAnalysis.h"
+#include "itkPersistentThreadPool.h"
 #include "vnl/vnl_math.h"
 #include <algorithm>
 #include "itkCommand.h"
@@ -30,6 +31,22 @@
 namespace itk
 {
 
+namespace
+{
+
+/** Append the values of a container to an optimization state. */
+template< class TIterator >
+void
+AppendToOptimizationState( std::vector< double > & state, TIterator begin, TIterator end )
+{
+  for( ; begin != end; ++begin )
+  {
+    state.push_back( static_cast< double >( *begin ) );
+  }
+}
+
+} // end namespace
+
 /**
  * ******************** Constructor *************************
  */
@@ -75,6 +92,8 @@ CMAEvolutionStrategyOptimizer::CMAEvolutionStrategyOptimizer()
   this->m_PositionToleranceMin       = 1e-12;
   this->m_PositionToleranceMax       = 1e8;
   this->m_ValueTolerance             = 1e-12;
+  this->m_UseSeparableCovariance     = false;
+  this->m_UseMultiThread             = true;
 
 }   // end constructor
 
@@ -124,6 +143,8 @@ CMAEvolutionStrategyOptimizer::PrintSelf( std::ostream & os, Indent indent ) con
   os << indent << "m_PositionToleranceMin: " << this->m_PositionToleranceMin << std::endl;
   os << indent << "m_PositionToleranceMax: " << this->m_PositionToleranceMax << std::endl;
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "m_UseSeparableCovariance: " << this->m_UseSeparableCovariance << std::endl;
+  os << indent << "m_UseMultiThread: " << this->m_UseMultiThread << std::endl;
 
   os << indent << "m_RecombinationWeights: " << this->m_RecombinationWeights << std::endl;
   os << indent << "m_C: " << this->m_C << std::endl;
@@ -190,6 +211,8 @@ CMAEvolutionStrategyOptimizer::ResumeOptimization()
   this->m_Stop          = false;
   this->m_StopCondition = Unknown;
 
+  this->RestorePendingOptimizationState();
+
   this->InvokeEvent( StartEvent() );
 
   try
@@ -359,11 +382,22 @@ CMAEvolutionStrategyOptimizer::InitializeConstants( void )
     = ( 1.0 / mucov ) * 2.0 / vnl_math_sqr( Nd + vcl_sqrt( 2.0 ) )
     + ( 1.0 - 1.0 / mucov )
     * vnl_math_min( 1.0, ( 2.0 * mueff - 1.0 ) / ( vnl_math_sqr( Nd + 2.0 ) + mueff ) );
+  /** The diagonal is learned faster in the separable variant (Ros and Hansen, 2008). */
+  if( this->m_UseSeparableCovariance )
+  {
+    this->m_CovarianceMatrixAdaptationConstant = vnl_math_min( 1.0,
+      this->m_CovarianceMatrixAdaptationConstant * ( Nd + 2.0 ) / 3.0 );
+  }
   /** alias: */
   const double c_cov = this->m_CovarianceMatrixAdaptationConstant;
 
-  /** Update only every 'period' iterations */
-  if( this->m_UpdateBDPeriod == 0 )
+  /** Update only every 'period' iterations. The separable variant needs
+   * no eigendecomposition, so it updates D in each iteration. */
+  if( this->m_UseSeparableCovariance )
+  {
+    this->m_UpdateBDPeriod = 1;
+  }
+  else if( this->m_UpdateBDPeriod == 0 )
   {
     this->m_UpdateBDPeriod = static_cast< unsigned int >( vcl_floor( 1.0 / c_cov / Nd / 10.0 ) );
   }
@@ -388,6 +422,118 @@ CMAEvolutionStrategyOptimizer::InitializeConstants( void )
 }   // end InitializeConstants
 
 
+/**
+ * ****************** GetOptimizationState *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::GetOptimizationState( OptimizationStateType & state ) const
+{
+  /** Called during the iteration event, before the paths, C and sigma are
+   * updated with the offspring of the iteration.
+   */
+  state.clear();
+  state.push_back( static_cast< double >( this->m_CurrentIteration ) );
+  state.push_back( this->m_CurrentSigma );
+  state.push_back( this->m_Heaviside ? 1.0 : 0.0 );
+  state.push_back( this->m_CurrentMinimumD );
+  state.push_back( this->m_CurrentMaximumD );
+  state.push_back( static_cast< double >( this->m_MeasureHistory.size() ) );
+  state.push_back( static_cast< double >( this->m_CostFunctionValues.size() ) );
+
+  AppendToOptimizationState( state, this->m_EvolutionPath.begin(), this->m_EvolutionPath.end() );
+  AppendToOptimizationState( state, this->m_ConjugateEvolutionPath.begin(), this->m_ConjugateEvolutionPath.end() );
+  AppendToOptimizationState( state, this->m_CurrentScaledStep.begin(), this->m_CurrentScaledStep.end() );
+  AppendToOptimizationState( state, this->m_CurrentNormalizedStep.begin(), this->m_CurrentNormalizedStep.end() );
+  AppendToOptimizationState( state, this->m_MeasureHistory.begin(), this->m_MeasureHistory.end() );
+  for( std::size_t i = 0; i < this->m_CostFunctionValues.size(); ++i )
+  {
+    state.push_back( static_cast< double >( this->m_CostFunctionValues[ i ].first ) );
+    state.push_back( static_cast< double >( this->m_CostFunctionValues[ i ].second ) );
+  }
+  for( std::size_t i = 0; i < this->m_SearchDirs.size(); ++i )
+  {
+    AppendToOptimizationState( state, this->m_SearchDirs[ i ].begin(), this->m_SearchDirs[ i ].end() );
+    AppendToOptimizationState( state,
+      this->m_NormalizedSearchDirs[ i ].begin(), this->m_NormalizedSearchDirs[ i ].end() );
+  }
+  AppendToOptimizationState( state, this->m_C.begin(), this->m_C.end() );
+  AppendToOptimizationState( state, this->m_B.begin(), this->m_B.end() );
+  AppendToOptimizationState( state, this->m_D.diagonal().begin(), this->m_D.diagonal().end() );
+  AppendToOptimizationState( state, this->m_DiagonalC.begin(), this->m_DiagonalC.end() );
+
+} // end GetOptimizationState()
+
+
+/**
+ * ****************** RestorePendingOptimizationState *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::RestorePendingOptimizationState( void )
+{
+  if( this->m_PendingOptimizationState.empty() )
+  {
+    return;
+  }
+  OptimizationStateType state;
+  state.swap( this->m_PendingOptimizationState );
+
+  /** The sizes follow from the settings, which StartOptimization() applied. */
+  const std::size_t N              = this->m_EvolutionPath.GetSize();
+  const std::size_t lambda         = this->m_SearchDirs.size();
+  const std::size_t historySize    = state.size() > 5 ? static_cast< std::size_t >( state[ 5 ] ) : 0;
+  const std::size_t numberOfValues = state.size() > 6 ? static_cast< std::size_t >( state[ 6 ] ) : 0;
+  const std::size_t expectedSize   = 7 + 4 * N + historySize + 2 * numberOfValues
+    + 2 * lambda * N + this->m_C.size() + this->m_B.size() + this->m_D.rows() + this->m_DiagonalC.GetSize();
+  if( state.size() != expectedSize || numberOfValues > lambda )
+  {
+    itkExceptionMacro( << "ERROR: the optimization state does not match the settings of the optimizer." );
+  }
+
+  this->m_CurrentIteration = static_cast< unsigned long >( state[ 0 ] );
+  this->m_CurrentSigma     = state[ 1 ];
+  this->m_Heaviside        = state[ 2 ] != 0.0;
+  this->m_CurrentMinimumD  = state[ 3 ];
+  this->m_CurrentMaximumD  = state[ 4 ];
+
+  const double * p = &state[ 7 ];
+  std::copy( p, p + N, this->m_EvolutionPath.begin() ); p += N;
+  std::copy( p, p + N, this->m_ConjugateEvolutionPath.begin() ); p += N;
+  std::copy( p, p + N, this->m_CurrentScaledStep.begin() ); p += N;
+  std::copy( p, p + N, this->m_CurrentNormalizedStep.begin() ); p += N;
+  this->m_MeasureHistory.assign( p, p + historySize ); p += historySize;
+  this->m_CostFunctionValues.resize( numberOfValues );
+  for( std::size_t i = 0; i < numberOfValues; ++i, p += 2 )
+  {
+    this->m_CostFunctionValues[ i ].first  = static_cast< MeasureType >( p[ 0 ] );
+    this->m_CostFunctionValues[ i ].second = static_cast< unsigned int >( p[ 1 ] );
+  }
+  for( std::size_t i = 0; i < lambda; ++i )
+  {
+    std::copy( p, p + N, this->m_SearchDirs[ i ].begin() ); p += N;
+    std::copy( p, p + N, this->m_NormalizedSearchDirs[ i ].begin() ); p += N;
+  }
+  std::copy( p, p + this->m_C.size(), this->m_C.begin() ); p += this->m_C.size();
+  std::copy( p, p + this->m_B.size(), this->m_B.begin() ); p += this->m_B.size();
+  vnl_vector< double > diagonalD( p, this->m_D.rows() ); p += this->m_D.rows();
+  this->m_D.set( diagonalD );
+  std::copy( p, p + this->m_DiagonalC.GetSize(), this->m_DiagonalC.begin() );
+
+  /** Finish the iteration, like ResumeOptimization() does after the
+   * iteration event. */
+  this->UpdateConjugateEvolutionPath();
+  this->UpdateHeaviside();
+  this->UpdateEvolutionPath();
+  this->UpdateC();
+  this->UpdateSigma();
+  this->UpdateBD();
+  this->FixNumericalErrors();
+  ++( this->m_CurrentIteration );
+
+} // end RestorePendingOptimizationState()
+
+
 /**
  * ****************** InitializeProgressVariables *********************
  */
@@ -459,15 +605,25 @@ CMAEvolutionStrategyOptimizer::InitializeBCD( void )
 {
   itkDebugMacro( "InitializeBCD" );
 
-  if( this->GetUseCovarianceMatrixAdaptation() )
-  {
-    /** Get the number of parameters from the cost function */
-    const unsigned int numberOfParameters
-      = this->GetScaledCostFunction()->GetNumberOfParameters();
+  /** Get the number of parameters from the cost function */
+  const unsigned int numberOfParameters
+    = this->GetScaledCostFunction()->GetNumberOfParameters();
 
-    /** Some casts/aliases: */
-    const unsigned int N = numberOfParameters;
+  /** Some casts/aliases: */
+  const unsigned int N = numberOfParameters;
 
+  if( this->GetUseCovarianceMatrixAdaptation() && this->m_UseSeparableCovariance )
+  {
+    /** Only the diagonal of C is stored; B is the identity. */
+    this->m_B.SetSize( 0, 0 );
+    this->m_C.SetSize( 0, 0 );
+    this->m_DiagonalC.SetSize( N );
+    this->m_DiagonalC.Fill( 1.0 );
+    this->m_D.set_size( N );
+    this->m_D.fill( 1.0 );
+  }
+  else if( this->GetUseCovarianceMatrixAdaptation() )
+  {
     /** Resize */
     this->m_B.SetSize( N, N );
     this->m_C.SetSize( N, N );
@@ -479,6 +635,7 @@ CMAEvolutionStrategyOptimizer::InitializeBCD( void )
     this->m_B.fill_diagonal( 1.0 );
     this->m_C.fill_diagonal( 1.0 );
     this->m_D.fill( 1.0 );
+    this->m_DiagonalC.SetSize( 0 );
   }
   else
   {
@@ -486,6 +643,7 @@ CMAEvolutionStrategyOptimizer::InitializeBCD( void )
     this->m_B.SetSize( 0, 0 );
     this->m_C.SetSize( 0, 0 );
     this->m_D.clear();
+    this->m_DiagonalC.SetSize( 0 );
   }
 
 }   // end InitializeBCD
@@ -500,48 +658,78 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 {
   itkDebugMacro( "GenerateOffspring" );
 
-  /** Get the number of parameters from the cost function */
-  const unsigned int numberOfParameters
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
-
   /** Some casts/aliases: */
-  const unsigned int N      = numberOfParameters;
   const unsigned int lambda = this->m_PopulationSize;
 
   /** Clear the old values */
   this->m_CostFunctionValues.clear();
 
-  /** Fill the m_NormalizedSearchDirs and SearchDirs */
-  unsigned int lam       = 0;
-  unsigned int nrOfFails = 0;
-  while( lam < lambda )
+  /** Fill the m_NormalizedSearchDirs and SearchDirs, and compute the
+   * offspring x_lam = m + d_lam. The random numbers are drawn serially;
+   * with a full covariance matrix the O(N^2) transformations to N(0,C)
+   * are computed in parallel.
+   */
+  for( unsigned int lam = 0; lam < lambda; ++lam )
   {
-    /** draw from distribution N(0,I) */
-    for( unsigned int par = 0; par < N; ++par )
-    {
-      this->m_NormalizedSearchDirs[ lam ][ par ]
-        = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if( this->GetUseCovarianceMatrixAdaptation() )
+    this->DrawNormalizedSearchDirection( lam );
+  }
+  if( this->m_UseMultiThread && this->GetUseCovarianceMatrixAdaptation()
+    && !this->m_UseSeparableCovariance )
+  {
+    SearchDirectionsPassType pass;
+    pass.m_Optimizer = this;
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      lambda, 1, SearchDirectionsRangeFunction, &pass );
+  }
+  else
+  {
+    for( unsigned int lam = 0; lam < lambda; ++lam )
     {
-      this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+      this->ComputeSearchDirection( lam );
     }
-    else
+  }
+
+  ParametersArrayType offspring( lambda );
+  for( unsigned int lam = 0; lam < lambda; ++lam )
+  {
+    offspring[ lam ]  = this->GetScaledCurrentPosition();
+    offspring[ lam ] += this->m_SearchDirs[ lam ];
+  }
+
+  /** Compute the cost function for the whole population at once. */
+  MeasureArrayType costFunctionValues;
+  bool             allOffspringOk = true;
+  try
+  {
+    this->GetScaledValues( offspring, costFunctionValues );
+  }
+  catch( ExceptionObject & )
+  {
+    allOffspringOk = false;
+  }
+
+  if( allOffspringOk )
+  {
+    for( unsigned int lam = 0; lam < lambda; ++lam )
     {
-      this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+      this->m_CostFunctionValues.push_back(
+        MeasureIndexPairType( costFunctionValues[ lam ], lam ) );
     }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+    return;
+  }
 
+  /** Some offspring member gave an error: evaluate them one by one,
+   * and replace the failing ones by new search directions.
+   */
+  unsigned int lam       = 0;
+  unsigned int nrOfFails = 0;
+  while( lam < lambda )
+  {
     /** Compute the cost function */
     MeasureType costFunctionValue = 0.0;
-    /** x_lam = m + d_lam */
-    ParametersType x_lam = this->GetScaledCurrentPosition();
-    x_lam += this->m_SearchDirs[ lam ];
     try
     {
-      costFunctionValue = this->GetScaledValue( x_lam );
+      costFunctionValue = this->GetScaledValue( offspring[ lam ] );
     }
     catch( ExceptionObject & err )
     {
@@ -549,6 +737,9 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
       /** try another parameter vector if we haven't tried that for 10 times already */
       if( nrOfFails <= 10 )
       {
+        this->DrawSearchDirection( lam );
+        offspring[ lam ]  = this->GetScaledCurrentPosition();
+        offspring[ lam ] += this->m_SearchDirs[ lam ];
         continue;
       }
       else
@@ -572,6 +763,87 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 }   // end GenerateOffspring
 
 
+/**
+ * ****************** DrawSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DrawSearchDirection( unsigned int lam )
+{
+  this->DrawNormalizedSearchDirection( lam );
+  this->ComputeSearchDirection( lam );
+
+}   // end DrawSearchDirection
+
+
+/**
+ * ****************** DrawNormalizedSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DrawNormalizedSearchDirection( unsigned int lam )
+{
+  /** Get the number of parameters from the cost function */
+  const unsigned int N = this->GetScaledCostFunction()->GetNumberOfParameters();
+
+  /** draw from distribution N(0,I) */
+  for( unsigned int par = 0; par < N; ++par )
+  {
+    this->m_NormalizedSearchDirs[ lam ][ par ]
+      = this->m_RandomGenerator->GetNormalVariate();
+  }
+
+}   // end DrawNormalizedSearchDirection
+
+
+/**
+ * ****************** ComputeSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ComputeSearchDirection( unsigned int lam )
+{
+  /** Make like it was drawn from N(0,C) */
+  if( this->GetUseCovarianceMatrixAdaptation() && this->m_UseSeparableCovariance )
+  {
+    const unsigned int N = this->m_NormalizedSearchDirs[ lam ].GetSize();
+    for( unsigned int par = 0; par < N; ++par )
+    {
+      this->m_SearchDirs[ lam ][ par ]
+        = this->m_D[ par ] * this->m_NormalizedSearchDirs[ lam ][ par ];
+    }
+  }
+  else if( this->GetUseCovarianceMatrixAdaptation() )
+  {
+    this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+  }
+  else
+  {
+    this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+  }
+  /** Make like it was drawn from N( 0, sigma^2 C ) */
+  this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+
+}   // end ComputeSearchDirection
+
+
+/**
+ * ****************** SearchDirectionsRangeFunction *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::SearchDirectionsRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  SearchDirectionsPassType * pass = static_cast< SearchDirectionsPassType * >( userData );
+  for( SizeValueType lam = begin; lam < end; ++lam )
+  {
+    pass->m_Optimizer->ComputeSearchDirection( static_cast< unsigned int >( lam ) );
+  }
+
+}   // end SearchDirectionsRangeFunction
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
@@ -654,7 +926,7 @@ CMAEvolutionStrategyOptimizer::UpdateConjugateEvolutionPath( void )
   /** Update p_sigma */
   const double factor = vcl_sqrt( c_sigma * ( 2.0 - c_sigma ) * this->m_EffectiveMu );
   this->m_ConjugateEvolutionPath *= ( 1.0 - c_sigma );
-  if( this->GetUseCovarianceMatrixAdaptation() )
+  if( this->GetUseCovarianceMatrixAdaptation() && !this->m_UseSeparableCovariance )
   {
     this->m_ConjugateEvolutionPath
       += ( factor * ( this->m_B * this->m_CurrentNormalizedStep ) );
@@ -751,46 +1023,108 @@ CMAEvolutionStrategyOptimizer::UpdateC( void )
   const double       mu_cov = this->m_CovarianceMatrixAdaptationWeight;
   const double       sigma  = this->m_CurrentSigma;
 
-  /** Multiply old m_C with some factor */
+  /** The factor with which the old m_C is multiplied */
   double oldCfactor = 1.0 - c_cov;
   if( !this->m_Heaviside )
   {
     oldCfactor += ( c_cov * c_c * ( 2.0 - c_c ) / mu_cov );
   }
-  this->m_C *= oldCfactor;
-
-  /** Do rank-one update */
   const double rankonefactor = c_cov / mu_cov;
-  for( unsigned int i = 0; i < N; ++i )
+  const double rankmufactor  = c_cov * ( 1.0 - 1.0 / mu_cov );
+
+  /** The weighted search directions of the rank-mu update */
+  ParameterContainerType weightedSearchDirs( mu );
+  for( unsigned int m = 0; m < mu; ++m )
   {
-    const double evolutionPath_i = this->m_EvolutionPath[ i ];
-    for( unsigned int j = 0; j < N; ++j )
+    const unsigned int lam        = this->m_CostFunctionValues[ m ].second;
+    const double       sqrtweight = vcl_sqrt( this->m_RecombinationWeights[ m ] );
+    weightedSearchDirs[ m ]  = this->m_SearchDirs[ lam ];
+    weightedSearchDirs[ m ] *= ( sqrtweight / sigma );
+  }
+
+  /** The separable variant only updates the diagonal */
+  if( this->m_UseSeparableCovariance )
+  {
+    for( unsigned int i = 0; i < N; ++i )
     {
-      const double update = rankonefactor * evolutionPath_i * this->m_EvolutionPath[ j ];
-      this->m_C[ i ][ j ] += update;
+      double rankmuupdate = 0.0;
+      for( unsigned int m = 0; m < mu; ++m )
+      {
+        rankmuupdate += vnl_math_sqr( weightedSearchDirs[ m ][ i ] );
+      }
+      this->m_DiagonalC[ i ] = oldCfactor * this->m_DiagonalC[ i ]
+        + rankonefactor * vnl_math_sqr( this->m_EvolutionPath[ i ] )
+        + rankmufactor * rankmuupdate;
     }
+    return;
   }
 
-  /** Do rank-mu update */
-  const double rankmufactor = c_cov * ( 1.0 - 1.0 / mu_cov );
-  for( unsigned int m = 0; m < mu; ++m )
+  /** Multiply old m_C with some factor, and do the rank-one and rank-mu
+   * updates, row by row. The rows are independent, so they can be
+   * updated in parallel. */
+  UpdateCPassType pass;
+  pass.m_Optimizer          = this;
+  pass.m_WeightedSearchDirs = &weightedSearchDirs;
+  pass.m_OldCFactor         = oldCfactor;
+  pass.m_RankOneFactor      = rankonefactor;
+  pass.m_RankMuFactor       = rankmufactor;
+  if( this->m_UseMultiThread )
   {
-    const unsigned int lam               = this->m_CostFunctionValues[ m ].second;
-    const double       sqrtweight        = vcl_sqrt( this->m_RecombinationWeights[ m ] );
-    ParametersType     weightedSearchDir = this->m_SearchDirs[ lam ];
-    weightedSearchDir *= ( sqrtweight / sigma );
-    for( unsigned int i = 0; i < N; ++i )
+    PersistentThreadPool::GetInstance()->ParallelFor( N, 0, UpdateCRangeFunction, &pass );
+  }
+  else
+  {
+    UpdateCRangeFunction( &pass, 0, 0, N );
+  }
+
+}   // end UpdateC
+
+
+/**
+ * ****************** UpdateCRangeFunction *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::UpdateCRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const UpdateCPassType &        pass               = *static_cast< UpdateCPassType * >( userData );
+  CovarianceMatrixType &         C                  = pass.m_Optimizer->m_C;
+  const ParametersType &         evolutionPath      = pass.m_Optimizer->m_EvolutionPath;
+  const ParameterContainerType & weightedSearchDirs = *pass.m_WeightedSearchDirs;
+  const unsigned int             N                  = evolutionPath.GetSize();
+  const unsigned int             mu                 = weightedSearchDirs.size();
+
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    double * Ci = C[ i ];
+
+    /** Multiply old m_C with some factor */
+    for( unsigned int j = 0; j < N; ++j )
+    {
+      Ci[ j ] *= pass.m_OldCFactor;
+    }
+
+    /** Do rank-one update */
+    const double evolutionPath_i = pass.m_RankOneFactor * evolutionPath[ i ];
+    for( unsigned int j = 0; j < N; ++j )
+    {
+      Ci[ j ] += evolutionPath_i * evolutionPath[ j ];
+    }
+
+    /** Do rank-mu update */
+    for( unsigned int m = 0; m < mu; ++m )
     {
-      const double weightedSearchDir_i = weightedSearchDir[ i ];
+      const ParametersType & weightedSearchDir   = weightedSearchDirs[ m ];
+      const double           weightedSearchDir_i = pass.m_RankMuFactor * weightedSearchDir[ i ];
       for( unsigned int j = 0; j < N; ++j )
       {
-        const double update = rankmufactor * weightedSearchDir_i * weightedSearchDir[ j ];
-        this->m_C[ i ][ j ] += update;
+        Ci[ j ] += weightedSearchDir_i * weightedSearchDir[ j ];
       }
     }
-  }   // end for m
+  }
 
-}   // end UpdateC
+}   // end UpdateCRangeFunction
 
 
 /**
@@ -847,24 +1181,35 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
     return;
   }
 
-  typedef itk::SymmetricEigenAnalysis<
-    CovarianceMatrixType,
-    EigenValueMatrixType,
-    CovarianceMatrixType >                      EigenAnalysisType;
-
-  /** In the itkEigenAnalysis only the upper triangle of the matrix will be accessed, so
-   * we do not need to make sure the matrix is symmetric, like in the
-   * matlab code. Just run the eigenAnalysis! */
-  EigenAnalysisType eigenAnalysis( N );
-  unsigned int      returncode = 0;
-  returncode = eigenAnalysis.ComputeEigenValuesAndVectors( this->m_C, this->m_D, this->m_B );
-  if( returncode != 0 )
+  if( this->m_UseSeparableCovariance )
   {
-    itkExceptionMacro( << "EigenAnalysis failed while computing eigenvalue nr: " << returncode );
+    /** C is diagonal, so it is its own eigendecomposition, with B = I. */
+    for( unsigned int i = 0; i < N; ++i )
+    {
+      this->m_D[ i ] = this->m_DiagonalC[ i ];
+    }
   }
+  else
+  {
+    typedef itk::SymmetricEigenAnalysis<
+      CovarianceMatrixType,
+      EigenValueMatrixType,
+      CovarianceMatrixType >                      EigenAnalysisType;
+
+    /** In the itkEigenAnalysis only the upper triangle of the matrix will be accessed, so
+     * we do not need to make sure the matrix is symmetric, like in the
+     * matlab code. Just run the eigenAnalysis! */
+    EigenAnalysisType eigenAnalysis( N );
+    unsigned int      returncode = 0;
+    returncode = eigenAnalysis.ComputeEigenValuesAndVectors( this->m_C, this->m_D, this->m_B );
+    if( returncode != 0 )
+    {
+      itkExceptionMacro( << "EigenAnalysis failed while computing eigenvalue nr: " << returncode );
+    }
 
-  /** itk eigen analysis returns eigen vectors in rows... */
-  this->m_B.inplace_transpose();
+    /** itk eigen analysis returns eigen vectors in rows... */
+    this->m_B.inplace_transpose();
+  }
 
   /**  limit condition of C to 1e10 + 1, and avoid negative eigenvalues */
   const double largeNumber = 1e10;
@@ -879,8 +1224,8 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
       {
         this->m_D[ i ] = 0.0;
       }
-      this->m_C[ i ][ i ] += diagadd;
-      this->m_D[ i ]      += diagadd;
+      this->AddToCovarianceDiagonalElement( i, diagadd );
+      this->m_D[ i ] += diagadd;
     }
   }
 
@@ -891,8 +1236,8 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
     const double diagadd = dmax / largeNumber  - dmin;
     for( unsigned int i = 0; i < N; ++i )
     {
-      this->m_C[ i ][ i ] += diagadd;
-      this->m_D[ i ]      += diagadd;
+      this->AddToCovarianceDiagonalElement( i, diagadd );
+      this->m_D[ i ] += diagadd;
     }
   }
 
@@ -938,7 +1283,7 @@ CMAEvolutionStrategyOptimizer::FixNumericalErrors( void )
     /** Check for too large deviation */
     for( unsigned int i = 0; i < N; ++i )
     {
-      const double sqrtCii   = vcl_sqrt( this->m_C[ i ][ i ] );
+      const double sqrtCii   = vcl_sqrt( this->GetCovarianceDiagonalElement( i ) );
       const double actualDev = this->m_CurrentSigma * sqrtCii;
       if( actualDev > this->m_MaximumDeviation )
       {
@@ -950,7 +1295,7 @@ CMAEvolutionStrategyOptimizer::FixNumericalErrors( void )
     bool minDevViolated = false;
     for( unsigned int i = 0; i < N; ++i )
     {
-      const double sqrtCii   = vcl_sqrt( this->m_C[ i ][ i ] );
+      const double sqrtCii   = vcl_sqrt( this->GetCovarianceDiagonalElement( i ) );
       const double actualDev = this->m_CurrentSigma * sqrtCii;
       if( actualDev < this->m_MinimumDeviation )
       {
@@ -1002,12 +1347,14 @@ CMAEvolutionStrategyOptimizer::FixNumericalErrors( void )
     /** Check for numerically too small deviation */
     for( unsigned int i = 0; i < N; ++i )
     {
-      const double actualDev = 0.2 * this->m_CurrentSigma * vcl_sqrt( this->m_C[ i ][ i ] );
+      const double actualDev = 0.2 * this->m_CurrentSigma
+        * vcl_sqrt( this->GetCovarianceDiagonalElement( i ) );
       if( param[ i ] == ( param[ i ] + actualDev ) )
       {
         /** The parameters wouldn't change after perturbation, because
          * of too low precision. Increase the problematic diagonal element of C */
-        this->m_C[ i ][ i ]         *= ( 1.0 + c_cov );
+        this->AddToCovarianceDiagonalElement( i,
+          c_cov * this->GetCovarianceDiagonalElement( i ) );
         numericalProblemsEncountered = true;
       }
     }   // end for i
@@ -1041,7 +1388,16 @@ CMAEvolutionStrategyOptimizer::FixNumericalErrors( void )
    * In the code below: colnr=i-1 (zero-based indexing). */
   bool               numericalProblemsEncountered2 = false;
   const unsigned int colnr                         = static_cast< unsigned int >( nextit % N );
-  if( this->GetUseCovarianceMatrixAdaptation() )
+  if( this->GetUseCovarianceMatrixAdaptation() && this->m_UseSeparableCovariance )
+  {
+    /** B is the identity, so only parameter colnr is perturbed */
+    const double sigDcol = 0.1 * this->m_CurrentSigma * this->m_D[ colnr ];
+    if( param[ colnr ] == ( param[ colnr ] + sigDcol ) )
+    {
+      numericalProblemsEncountered2 = true;
+    }
+  }
+  else if( this->GetUseCovarianceMatrixAdaptation() )
   {
     const double sigDcol = 0.1 * this->m_CurrentSigma * this->m_D[ colnr ];
     //const ParametersType actualDevVector = sigDcol * this->m_B.get_column(colnr);
@@ -1129,7 +1485,7 @@ CMAEvolutionStrategyOptimizer::TestConvergence( bool firstCheck )
   {
     for( unsigned int i = 0; i < N; ++i )
     {
-      const double sqrtCii  = vcl_sqrt( this->m_C[ i ][ i ] );
+      const double sqrtCii  = vcl_sqrt( this->GetCovarianceDiagonalElement( i ) );
       const double stepsize =  this->m_CurrentSigma * sqrtCii;
       if( stepsize > tolxmax )
       {
@@ -1192,7 +1548,7 @@ CMAEvolutionStrategyOptimizer::TestConvergence( bool firstCheck )
     double       sqrtCii = 1.0;
     if( this->m_UseCovarianceMatrixAdaptation )
     {
-      sqrtCii = vcl_sqrt( this->m_C[ i ][ i ] );
+      sqrtCii = vcl_sqrt( this->GetCovarianceDiagonalElement( i ) );
     }
     const double stepsize =  this->m_CurrentSigma * vnl_math_max( pci, sqrtCii );
     if( stepsize > tolxmin )
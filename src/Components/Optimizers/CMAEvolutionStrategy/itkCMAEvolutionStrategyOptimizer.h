@@ -27,6 +27,7 @@
 #include "itkArray.h"
 #include "itkArray2D.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkIntTypes.h"
 #include "vnl/vnl_diag_matrix.h"
 
 namespace itk
@@ -43,6 +44,20 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * For problems with many parameters the full covariance matrix, with its
+ * \f$O(N^2)\f$ storage and \f$O(N^3)\f$ eigendecomposition, can be replaced
+ * by a diagonal one (UseSeparableCovariance), following:
+ *   - Ros and Hansen,
+ *     "A Simple Modification in CMA-ES Achieving Linear Time and Space Complexity",
+ *     Parallel Problem Solving from Nature (PPSN X), pp. 296-305 (2008).
+ *
+ * The population is evaluated at once through GetScaledValues(), so cost
+ * functions that support it evaluate the offspring concurrently. With the
+ * full covariance matrix, the \f$O(N^2)\f$ work per iteration (sampling the
+ * offspring and updating C) is distributed over the threads of the
+ * PersistentThreadPool (UseMultiThread). The random numbers are always drawn
+ * serially, so the result does not depend on the number of threads.
+ *
  * \ingroup Numerics Optimizers
  */
 
@@ -66,6 +81,8 @@ public:
   typedef Superclass::ScaledCostFunctionType ScaledCostFunctionType;
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
+  typedef Superclass::ParametersArrayType    ParametersArrayType;
+  typedef Superclass::MeasureArrayType       MeasureArrayType;
 
   typedef enum {
     MetricError,
@@ -83,6 +100,12 @@ public:
 
   virtual void StopOptimization( void );
 
+  /** The state of the optimization: the iteration number, sigma, the
+   * evolution paths, the covariance matrix and its eigen decomposition, and
+   * the offspring of the current iteration, which are needed to finish it.
+   * The state of the random generator is not included. */
+  virtual void GetOptimizationState( OptimizationStateType & state ) const;
+
   /** Get the current iteration number: */
   itkGetConstMacro( CurrentIteration, unsigned long );
 
@@ -180,6 +203,21 @@ public:
   itkSetMacro( UseCovarianceMatrixAdaptation, bool );
   itkGetConstMacro( UseCovarianceMatrixAdaptation, bool );
 
+  /** Setting: whether only the diagonal of the covariance matrix is adapted
+   * (separable CMA-ES). This reduces the memory and the time per iteration
+   * from quadratic (and cubic, for the eigendecomposition) to linear in
+   * the number of parameters. The learning rate c_cov is increased by a
+   * factor (N+2)/3, and UpdateBDPeriod is ignored (B = I always).
+   * Default: false. */
+  itkSetMacro( UseSeparableCovariance, bool );
+  itkGetConstMacro( UseSeparableCovariance, bool );
+
+  /** Setting: whether the sampling of the offspring and the update of the
+   * full covariance matrix are distributed over multiple threads.
+   * Default: true. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+
   /** Setting: how the recombination weights are chosen:
    * "equal", "linear" or "superlinear" are supported
    * equal:       weights = ones(mu,1);
@@ -224,6 +262,7 @@ protected:
   typedef Array< double >               RecombinationWeightsType;
   typedef vnl_diag_matrix< double >     EigenValueMatrixType;
   typedef Array2D< double >             CovarianceMatrixType;
+  typedef Array< double >               CovarianceDiagonalType;
   typedef std::vector< ParametersType > ParameterContainerType;
   typedef std::deque< MeasureType >     MeasureHistoryType;
 
@@ -311,6 +350,33 @@ protected:
   CovarianceMatrixType m_B;
   /** D: sqrt(eigen values) */
   EigenValueMatrixType m_D;
+  /** diag(C), only used if m_UseSeparableCovariance is true */
+  CovarianceDiagonalType m_DiagonalC;
+
+  /** The data passed to SearchDirectionsRangeFunction(). */
+  struct SearchDirectionsPassType
+  {
+    Self * m_Optimizer;
+  };
+
+  /** The data passed to UpdateCRangeFunction(). */
+  struct UpdateCPassType
+  {
+    Self *                         m_Optimizer;
+    const ParameterContainerType * m_WeightedSearchDirs;
+    double                         m_OldCFactor;
+    double                         m_RankOneFactor;
+    double                         m_RankMuFactor;
+  };
+
+  /** Range functions for the PersistentThreadPool. The first computes
+   * the search directions of a range of offspring, the second updates a
+   * range of rows of C. */
+  static void SearchDirectionsRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
+  static void UpdateCRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
 
   /** Constructor */
   CMAEvolutionStrategyOptimizer();
@@ -358,6 +424,37 @@ protected:
    * and m_CostFunctionValues */
   virtual void GenerateOffspring( void );
 
+  /** DrawSearchDirection: draw m_NormalizedSearchDirs[ lam ] and compute
+   * m_SearchDirs[ lam ]; called by GenerateOffspring. */
+  virtual void DrawSearchDirection( unsigned int lam );
+
+  /** Draw m_NormalizedSearchDirs[ lam ] from N(0,I). */
+  virtual void DrawNormalizedSearchDirection( unsigned int lam );
+
+  /** Compute m_SearchDirs[ lam ] from m_NormalizedSearchDirs[ lam ].
+   * Thread safe for different values of lam. */
+  virtual void ComputeSearchDirection( unsigned int lam );
+
+  /** Return C[i][i], for both the full and the separable covariance. */
+  double GetCovarianceDiagonalElement( unsigned int i ) const
+  {
+    return this->m_UseSeparableCovariance
+           ? this->m_DiagonalC[ i ] : this->m_C[ i ][ i ];
+  }
+
+  /** Add a value to C[i][i], for both the full and the separable covariance. */
+  void AddToCovarianceDiagonalElement( unsigned int i, double value )
+  {
+    if( this->m_UseSeparableCovariance )
+    {
+      this->m_DiagonalC[ i ] += value;
+    }
+    else
+    {
+      this->m_C[ i ][ i ] += value;
+    }
+  }
+
   /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
   virtual void SortCostFunctionValues( void );
 
@@ -405,6 +502,10 @@ protected:
    * \li Check if the value tolerance is satisfied.  */
   virtual bool TestConvergence( bool firstCheck );
 
+  /** Restore and clear the state set by SetOptimizationState(), if any, and
+   * finish the iteration during which it was taken. */
+  void RestorePendingOptimizationState( void );
+
 private:
 
   CMAEvolutionStrategyOptimizer( const Self & ); // purposely not implemented
@@ -422,6 +523,8 @@ private:
   double        m_PositionToleranceMax;
   double        m_PositionToleranceMin;
   double        m_ValueTolerance;
+  bool          m_UseSeparableCovariance;
+  bool          m_UseMultiThread;
 
 };
 
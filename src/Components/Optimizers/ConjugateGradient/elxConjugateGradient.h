@@ -82,6 +82,11 @@ namespace elastix
  *    In general it is wise to do so.\n
  *    example: <tt>(StopIfWolfeNotSatisfied "true" "false")</tt> \n
  *    Default value: "true".\n
+ * \parameter UseCostFunctionCache: Whether the value and derivative at the last evaluated
+ *    position are remembered, so that the metric is not evaluated twice at the same position.
+ *    The cache is cleared when new samples are selected.\n
+ *    example: <tt>(UseCostFunctionCache "false")</tt> \n
+ *    Default value: "true".\n
  *
  *
  * \ingroup Optimizers
@@ -152,6 +157,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetCurrentValue();
+  }
+
   virtual void AfterRegistration( void );
 
   itkGetConstMacro( StartLineSearch, bool );
@@ -292,6 +292,12 @@ ConjugateGradient< TElastix >
     this->m_StopIfWolfeNotSatisfied = false;
   }
 
+  /** Set whether repeated evaluations at the same position are cached. */
+  bool useCostFunctionCache = true;
+  this->m_Configuration->ReadParameter( useCostFunctionCache,
+    "UseCostFunctionCache", this->GetComponentLabel(), level, 0 );
+  this->SetUseCostFunctionCache( useCostFunctionCache );
+
   this->m_WolfeIsStopCondition     = false;
   this->m_SearchDirectionMagnitude = 0.0;
   this->m_StartLineSearch          = false;
@@ -47,6 +47,8 @@ GenericConjugateGradientOptimizer::GenericConjugateGradientOptimizer()
   this->m_LineSearchOptimizer                   = 0;
   this->m_PreviousGradientAndSearchDirValid     = false;
 
+  this->SetUseCostFunctionCache( true );
+
   this->AddBetaDefinition(
     "SteepestDescent", &Self::ComputeBetaSD );
   this->AddBetaDefinition(
@@ -33,6 +33,10 @@ namespace itk
  * The steplength is determined at each iteration by means of a
  * line search routine. The itk::MoreThuenteLineSearchOptimizer works well.
  *
+ * The cost function cache of the ScaledSingleValuedNonLinearOptimizer is
+ * enabled by default, so that repeated requests for the value and derivative
+ * at the same position (e.g. at the start of a line search) are answered
+ * without evaluating the cost function again.
  *
  * \ingroup Numerics Optimizers
  */
@@ -26,6 +26,7 @@
 
 #include "math.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -168,20 +169,36 @@ FiniteDifferenceGradientDescentOptimizer
     /** Calculate the derivative; this may take a while... */
     try
     {
-      for( unsigned int j = 0; j < spaceDimension; j++ )
+      /** The perturbed positions are evaluated in batches, which is faster
+       * for cost functions that can evaluate several positions at once.
+       * The batch size limits the memory needed for the positions.
+       */
+      const unsigned int maximumBatchSize = 16;
+      ParametersArrayType perturbedPositions;
+      MeasureArrayType    perturbedValues;
+      for( unsigned int jbegin = 0; jbegin < spaceDimension; jbegin += maximumBatchSize )
       {
-        param[ j ] += ck;
-        valueplus   = this->GetScaledValue( param );
-        param[ j ] -= 2.0 * ck;
-        valuemin    = this->GetScaledValue( param );
-        param[ j ] += ck;
-
-        const double gradient = ( valueplus - valuemin ) / ( 2.0 * ck );
-        this->m_Gradient[ j ] = gradient;
-
-        sumOfSquaredGradients += ( gradient * gradient );
-
-      }   // for j = 0 .. spaceDimension
+        const unsigned int jend = std::min( jbegin + maximumBatchSize, spaceDimension );
+        perturbedPositions.assign( 2 * ( jend - jbegin ), param );
+        for( unsigned int j = jbegin; j < jend; j++ )
+        {
+          perturbedPositions[ 2 * ( j - jbegin ) ][ j ]     += ck;
+          perturbedPositions[ 2 * ( j - jbegin ) + 1 ][ j ] -= ck;
+        }
+        this->GetScaledValues( perturbedPositions, perturbedValues );
+
+        for( unsigned int j = jbegin; j < jend; j++ )
+        {
+          valueplus = perturbedValues[ 2 * ( j - jbegin ) ];
+          valuemin  = perturbedValues[ 2 * ( j - jbegin ) + 1 ];
+
+          const double gradient = ( valueplus - valuemin ) / ( 2.0 * ck );
+          this->m_Gradient[ j ] = gradient;
+
+          sumOfSquaredGradients += ( gradient * gradient );
+        }
+
+      }   // for jbegin = 0 .. spaceDimension
     }
     catch( ExceptionObject & err )
     {
@@ -63,6 +63,10 @@ public:
   typedef SmartPointer< Self >                     Pointer;
   typedef SmartPointer< const Self >               ConstPointer;
 
+  /** Typedefs for evaluating several positions at once. */
+  typedef Superclass::ParametersArrayType ParametersArrayType;
+  typedef Superclass::MeasureArrayType    MeasureArrayType;
+
   /** Method for creation through the object factory. */
   itkNewMacro( Self );
 
@@ -48,6 +48,28 @@ namespace elastix
  *   This varies the second transform parameter in the range [-4.0 3.0] with steps of 1.0
  *   and the third parameter in the range [-1.0 1.0] with steps of 0.5. The names are used
  *   as column headers in the screen output.
+ * \parameter NumberOfCandidatesPerBatch: The number of grid points that are passed to the
+ *   metric at once. Metrics that support it evaluate such a batch in a single sweep.\n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(NumberOfCandidatesPerBatch 1024)</tt>\n
+ *   Default: 256.
+ * \parameter UseCoarseToFineSearch: Whether the search space is searched coarse-to-fine,
+ *   instead of exhaustively. The grid is first scanned with a stride of 2^(NumberOfCoarseToFineLevels-1);
+ *   each following level halves the stride and only evaluates the neighbours of the
+ *   NumberOfRefinementCandidates best points found so far. Points that are not visited
+ *   are NaN in the OptimizationSurface image.\n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseCoarseToFineSearch "true")</tt>\n
+ *   Default: "false".
+ * \parameter NumberOfCoarseToFineLevels: The number of levels of the coarse-to-fine search.\n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(NumberOfCoarseToFineLevels 4)</tt>\n
+ *   Default: 3.
+ * \parameter NumberOfRefinementCandidates: The number of best points that are refined in each
+ *   level of the coarse-to-fine search.\n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(NumberOfRefinementCandidates 10)</tt>\n
+ *   Default: 5.
  *
  * \ingroup Optimizers
  * \sa FullSearchOptimizer
@@ -164,6 +164,26 @@ FullSearch< TElastix >
     }
   } // end while
 
+  /** Set the number of grid points that are evaluated at once. */
+  unsigned int numberOfCandidatesPerBatch = 256;
+  this->GetConfiguration()->ReadParameter( numberOfCandidatesPerBatch,
+    "NumberOfCandidatesPerBatch", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfCandidatesPerBatch( numberOfCandidatesPerBatch );
+
+  /** Set the coarse-to-fine search settings. */
+  bool useCoarseToFineSearch = false;
+  this->GetConfiguration()->ReadParameter( useCoarseToFineSearch,
+    "UseCoarseToFineSearch", this->GetComponentLabel(), level, 0 );
+  this->SetUseCoarseToFineSearch( useCoarseToFineSearch );
+  unsigned int numberOfCoarseToFineLevels = 3;
+  this->GetConfiguration()->ReadParameter( numberOfCoarseToFineLevels,
+    "NumberOfCoarseToFineLevels", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfCoarseToFineLevels( numberOfCoarseToFineLevels );
+  unsigned int numberOfRefinementCandidates = 5;
+  this->GetConfiguration()->ReadParameter( numberOfRefinementCandidates,
+    "NumberOfRefinementCandidates", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfRefinementCandidates( numberOfRefinementCandidates );
+
   if( realGood )
   {
     /** The number of dimensions. */
@@ -181,6 +201,13 @@ FullSearch< TElastix >
     this->m_OptimizationSurface->Allocate();
     /** \todo try/catch block around Allocate? */
 
+    /** With a coarse-to-fine search not all points are visited. */
+    if( useCoarseToFineSearch )
+    {
+      this->m_OptimizationSurface->FillBuffer(
+        itk::NumericTraits< float >::quiet_NaN() );
+    }
+
     /** Set the name of this image on disk. */
     std::string resultImageFormat = "mhd";
     this->m_Configuration->ReadParameter(
@@ -194,10 +221,22 @@ FullSearch< TElastix >
       << "." << resultImageFormat;
     this->m_OptimizationSurface->SetOutputFileName( makeString.str().c_str() );
 
-    elxout
-      << "Total number of iterations needed in this resolution: "
-      << this->GetNumberOfIterations()
-      << "." << std::endl;
+    if( useCoarseToFineSearch )
+    {
+      elxout
+        << "Number of grid points in this resolution: "
+        << this->GetNumberOfIterations()
+        << ", searched coarse-to-fine in "
+        << this->GetNumberOfCoarseToFineLevels()
+        << " levels." << std::endl;
+    }
+    else
+    {
+      elxout
+        << "Total number of iterations needed in this resolution: "
+        << this->GetNumberOfIterations()
+        << "." << std::endl;
+    }
 
   }
   else
@@ -246,7 +285,7 @@ void
 FullSearch< TElastix >
 ::AfterEachResolution( void )
 {
-  //typedef enum {FullRangeSearched,  MetricError } StopConditionType;
+  //typedef enum {FullRangeSearched, MetricError, CoarseToFineSearched } StopConditionType;
   std::string stopcondition;
 
   switch( this->GetStopCondition() )
@@ -259,6 +298,10 @@ FullSearch< TElastix >
       stopcondition = "Error in metric";
       break;
 
+    case CoarseToFineSearched:
+      stopcondition = "The coarse-to-fine search has finished";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -24,6 +24,9 @@
 #include "itkEventObject.h"
 #include "itkExceptionObject.h"
 #include "itkNumericTraits.h"
+#include "itkMultiCandidateCostFunction.h"
+#include <algorithm>
+#include <functional>
 
 namespace itk
 {
@@ -45,6 +48,10 @@ FullSearchOptimizer
   m_NumberOfSearchSpaceDimensions = 0;
   m_SearchSpace                   = 0;
   m_LastSearchSpaceChanges        = 0;
+  m_NumberOfCandidatesPerBatch    = 256;
+  m_UseCoarseToFineSearch         = false;
+  m_NumberOfCoarseToFineLevels    = 3;
+  m_NumberOfRefinementCandidates  = 5;
 
 }   //end constructor
 
@@ -80,6 +87,13 @@ FullSearchOptimizer
     m_BestValue = NumericTraits< double >::max();
   }
 
+  m_EvaluatedPoints.clear();
+  m_IsEvaluated.clear();
+  if( m_UseCoarseToFineSearch )
+  {
+    m_IsEvaluated.resize( this->GetNumberOfIterations(), false );
+  }
+
   this->ResumeOptimization();
 
 }
@@ -98,29 +112,241 @@ FullSearchOptimizer
   m_Stop = false;
 
   InvokeEvent( StartEvent() );
+
+  if( m_UseCoarseToFineSearch )
+  {
+    this->CoarseToFineSearch();
+  }
+  else
+  {
+    this->ScanFullGrid();
+  }
+
+}   //end function ResumeOptimization
+
+
+/**
+ * ************************** ScanFullGrid ***********************
+ */
+void
+FullSearchOptimizer
+::ScanFullGrid( void )
+{
+  const unsigned long numberOfIterations = this->GetNumberOfIterations();
+
+  SearchSpaceIndexArrayType indices;
+  indices.reserve( m_NumberOfCandidatesPerBatch );
   while( !m_Stop )
   {
+    /** Collect the next batch of grid points, starting at the current one. */
+    indices.clear();
+    indices.push_back( m_CurrentIndexInSearchSpace );
+    while( indices.size() < m_NumberOfCandidatesPerBatch
+      && m_CurrentIteration + indices.size() < numberOfIterations )
+    {
+      this->UpdateCurrentPosition();
+      indices.push_back( m_CurrentIndexInSearchSpace );
+    }
+
+    this->EvaluateBatch( indices );
 
-    try
+    if( m_Stop )
     {
-      m_Value = m_CostFunction->GetValue( this->GetCurrentPosition() );
+      /** An observer stopped the optimization. Move to the next grid point,
+       * for ResumeOptimization, but keep the position set by StopOptimization. */
+      if( m_CurrentIteration < numberOfIterations )
+      {
+        const ParametersType stopPosition = this->GetCurrentPosition();
+        this->UpdateCurrentPosition();
+        this->SetCurrentPosition( stopPosition );
+      }
+      break;
     }
-    catch( ExceptionObject & err )
+
+    if( m_CurrentIteration >= numberOfIterations )
     {
-      // An exception has occurred.
-      // Terminate immediately.
-      m_StopCondition = MetricError;
+      m_StopCondition = FullRangeSearched;
       StopOptimization();
+      break;
+    }
 
-      // Pass exception to caller
-      throw err;
+    /** Set the next position in search space. */
+    this->UpdateCurrentPosition();
+
+  }   // end while
+
+}   // end ScanFullGrid
+
+
+/**
+ * ************************** CoarseToFineSearch *****************
+ */
+void
+FullSearchOptimizer
+::CoarseToFineSearch( void )
+{
+  const unsigned int          searchSpaceDimension = this->GetNumberOfSearchSpaceDimensions();
+  const SearchSpaceSizeType & searchSpaceSize      = this->GetSearchSpaceSize();
+  const unsigned int          numberOfLevels       = m_NumberOfCoarseToFineLevels;
+
+  /** The first level: all grid points at a multiple of the coarsest stride. */
+  IndexValueType stride = static_cast< IndexValueType >( 1 ) << ( numberOfLevels - 1 );
+
+  SearchSpaceIndexArrayType candidates;
+  SearchSpaceIndexType      index( searchSpaceDimension );
+  index.Fill( 0 );
+  bool done = ( searchSpaceDimension == 0 );
+  while( !done )
+  {
+    if( !m_IsEvaluated[ this->IndexToLinearIndex( index ) ] )
+    {
+      candidates.push_back( index );
+    }
+    done = true;
+    for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim )
+    {
+      index[ ssdim ] += stride;
+      if( index[ ssdim ] < static_cast< IndexValueType >( searchSpaceSize[ ssdim ] ) )
+      {
+        done = false;
+        break;
+      }
+      index[ ssdim ] = 0;
     }
+  }
+  this->EvaluateCandidates( candidates );
 
-    if( m_Stop )
+  /** The next levels: the neighbours of the best points, at half the stride. */
+  unsigned int numberOfNeighbours = 1;
+  for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim )
+  {
+    numberOfNeighbours *= 3;
+  }
+  for( unsigned int level = 1; level < numberOfLevels && !m_Stop; ++level )
+  {
+    stride /= 2;
+
+    /** Select the best points found so far. */
+    const std::size_t numberOfBest = std::min< std::size_t >(
+      m_NumberOfRefinementCandidates, m_EvaluatedPoints.size() );
+    if( m_Maximize )
     {
-      break;
+      std::partial_sort( m_EvaluatedPoints.begin(), m_EvaluatedPoints.begin() + numberOfBest,
+        m_EvaluatedPoints.end(), std::greater< ValueIndexPairType >() );
+    }
+    else
+    {
+      std::partial_sort( m_EvaluatedPoints.begin(), m_EvaluatedPoints.begin() + numberOfBest,
+        m_EvaluatedPoints.end() );
     }
 
+    /** Collect their unevaluated neighbours. */
+    candidates.clear();
+    for( std::size_t b = 0; b < numberOfBest; ++b )
+    {
+      /** Convert the linear index back to an index. */
+      SearchSpaceIndexType center( searchSpaceDimension );
+      unsigned long        linearIndex = m_EvaluatedPoints[ b ].second;
+      for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim )
+      {
+        center[ ssdim ] = static_cast< IndexValueType >( linearIndex % searchSpaceSize[ ssdim ] );
+        linearIndex    /= searchSpaceSize[ ssdim ];
+      }
+
+      for( unsigned int n = 0; n < numberOfNeighbours; ++n )
+      {
+        /** Neighbour n has offset ( (n / 3^d) % 3 - 1 ) * stride in dimension d. */
+        bool         inside = true;
+        unsigned int code   = n;
+        for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim )
+        {
+          index[ ssdim ] = center[ ssdim ]
+            + ( static_cast< IndexValueType >( code % 3 ) - 1 ) * stride;
+          code /= 3;
+          inside = inside && index[ ssdim ] >= 0
+            && index[ ssdim ] < static_cast< IndexValueType >( searchSpaceSize[ ssdim ] );
+        }
+        const unsigned long linearNeighbour = inside ? this->IndexToLinearIndex( index ) : 0;
+        if( inside && !m_IsEvaluated[ linearNeighbour ] )
+        {
+          /** Mark it already, to avoid duplicates between the best points. */
+          m_IsEvaluated[ linearNeighbour ] = true;
+          candidates.push_back( index );
+        }
+      }
+    }
+
+    this->EvaluateCandidates( candidates );
+
+  }   // end for level
+
+  if( !m_Stop )
+  {
+    m_StopCondition = CoarseToFineSearched;
+    StopOptimization();
+  }
+
+}   // end CoarseToFineSearch
+
+
+/**
+ * ************************** EvaluateCandidates *****************
+ */
+void
+FullSearchOptimizer
+::EvaluateCandidates( const SearchSpaceIndexArrayType & indices )
+{
+  SearchSpaceIndexArrayType batch;
+  for( std::size_t first = 0; first < indices.size() && !m_Stop;
+    first += m_NumberOfCandidatesPerBatch )
+  {
+    const std::size_t last = std::min< std::size_t >(
+      first + m_NumberOfCandidatesPerBatch, indices.size() );
+    batch.assign( indices.begin() + first, indices.begin() + last );
+    this->EvaluateBatch( batch );
+  }
+
+}   // end EvaluateCandidates
+
+
+/**
+ * ************************** EvaluateBatch **********************
+ */
+void
+FullSearchOptimizer
+::EvaluateBatch( const SearchSpaceIndexArrayType & indices )
+{
+  /** Compute the cost function for the whole batch at once. */
+  ParametersArrayType positions( indices.size() );
+  for( std::size_t k = 0; k < indices.size(); ++k )
+  {
+    positions[ k ] = this->IndexToPosition( indices[ k ] );
+  }
+
+  MeasureArrayType values;
+  try
+  {
+    MultiCandidateCostFunction::GetValues( m_CostFunction.GetPointer(), positions, values );
+  }
+  catch( ExceptionObject & err )
+  {
+    // An exception has occurred.
+    // Terminate immediately.
+    m_StopCondition = MetricError;
+    StopOptimization();
+
+    // Pass exception to caller
+    throw err;
+  }
+
+  /** Report the grid points one by one. */
+  for( std::size_t k = 0; k < indices.size(); ++k )
+  {
+    m_CurrentIndexInSearchSpace = indices[ k ];
+    m_CurrentPointInSearchSpace = this->IndexToPoint( indices[ k ] );
+    this->SetCurrentPosition( positions[ k ] );
+    m_Value = values[ k ];
+
     /** Check if the value is a minimum or maximum */
     if( ( m_Value < m_BestValue )  ^  m_Maximize )         // ^ = xor, yields true if only one of the expressions is true
     {
@@ -129,24 +355,44 @@ FullSearchOptimizer
       m_BestIndexInSearchSpace = m_CurrentIndexInSearchSpace;
     }
 
+    if( m_UseCoarseToFineSearch )
+    {
+      const unsigned long linearIndex = this->IndexToLinearIndex( m_CurrentIndexInSearchSpace );
+      m_IsEvaluated[ linearIndex ] = true;
+      m_EvaluatedPoints.push_back( ValueIndexPairType( m_Value, linearIndex ) );
+    }
+
     this->InvokeEvent( IterationEvent() );
 
     /** Prepare for next step */
     m_CurrentIteration++;
 
-    if( m_CurrentIteration >= this->GetNumberOfIterations() )
+    if( m_Stop )
     {
-      m_StopCondition = FullRangeSearched;
-      StopOptimization();
       break;
     }
+  }
 
-    /** Set the next position in search space. */
-    this->UpdateCurrentPosition();
+}   // end EvaluateBatch
 
-  }   // end while
 
-}   //end function ResumeOptimization
+/**
+ * ********************* IndexToLinearIndex **********************
+ */
+unsigned long
+FullSearchOptimizer
+::IndexToLinearIndex( const SearchSpaceIndexType & index ) const
+{
+  unsigned long linearIndex = 0;
+  unsigned long stride      = 1;
+  for( unsigned int ssdim = 0; ssdim < m_NumberOfSearchSpaceDimensions; ++ssdim )
+  {
+    linearIndex += static_cast< unsigned long >( index[ ssdim ] ) * stride;
+    stride      *= m_SearchSpaceSize[ ssdim ];
+  }
+  return linearIndex;
+
+}   // end IndexToLinearIndex
 
 
 /**
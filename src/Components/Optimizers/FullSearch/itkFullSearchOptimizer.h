@@ -24,6 +24,8 @@
 #include "itkImage.h"
 #include "itkArray.h"
 #include "itkFixedArray.h"
+#include <vector>
+#include <utility>
 
 namespace itk
 {
@@ -35,6 +37,20 @@ namespace itk
  * Optimizer that scans a subspace of the parameter space
  * and searches for the best parameters.
  *
+ * The grid points are evaluated in batches of NumberOfCandidatesPerBatch
+ * points, through MultiCandidateCostFunction::GetValues(), so that cost
+ * functions implementing that interface score a whole batch in a single
+ * (multi-threaded) sweep over their data. An IterationEvent is still
+ * invoked for each grid point, after the evaluation of its batch.
+ *
+ * Instead of scanning the full grid, a coarse-to-fine search can be
+ * selected (UseCoarseToFineSearch). The grid is then first sampled with a
+ * stride of \f$2^{L-1}\f$ in each dimension, with \f$L\f$ the
+ * NumberOfCoarseToFineLevels. In each following level the stride is halved,
+ * and only the neighbours (at the new stride) of the
+ * NumberOfRefinementCandidates best points found so far are evaluated.
+ * Grid points are never evaluated twice.
+ *
  * \todo This optimizer has similar functionality as the recently added
  * itkExhaustiveOptimizer. See if we can replace it by that optimizer,
  * or inherit from it.
@@ -62,7 +78,8 @@ public:
   /** Codes of stopping conditions */
   typedef enum {
     FullRangeSearched,
-    MetricError
+    MetricError,
+    CoarseToFineSearched
   } StopConditionType;
 
   /* Typedefs inherited from superclass */
@@ -89,6 +106,11 @@ public:
   /** The size of each dimension to be searched ((max-min)/step)) */
   typedef Array< SizeValueType > SearchSpaceSizeType;
 
+  /** Typedefs for the batched evaluation of grid points. */
+  typedef std::vector< ParametersType >       ParametersArrayType;
+  typedef std::vector< MeasureType >          MeasureArrayType;
+  typedef std::vector< SearchSpaceIndexType > SearchSpaceIndexArrayType;
+
   /** NB: The methods SetScales has no influence! */
 
   /** Methods to configure the cost function. */
@@ -191,6 +213,29 @@ public:
   /** Get Stop condition. */
   itkGetConstMacro( StopCondition, StopConditionType );
 
+  /** Set/Get the number of grid points that are passed to the cost
+   * function at once. Default: 256. */
+  itkSetClampMacro( NumberOfCandidatesPerBatch, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfCandidatesPerBatch, unsigned int );
+
+  /** Set/Get whether a coarse-to-fine search is done, instead of
+   * scanning the full grid. Default: false. */
+  itkSetMacro( UseCoarseToFineSearch, bool );
+  itkGetConstMacro( UseCoarseToFineSearch, bool );
+
+  /** Set/Get the number of levels of the coarse-to-fine search. The
+   * stride of the first level is 2^(levels-1). Default: 3. */
+  itkSetClampMacro( NumberOfCoarseToFineLevels, unsigned int,
+    1, 32 );
+  itkGetConstMacro( NumberOfCoarseToFineLevels, unsigned int );
+
+  /** Set/Get the number of best points around which the coarse-to-fine
+   * search is refined. Default: 5. */
+  itkSetClampMacro( NumberOfRefinementCandidates, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfRefinementCandidates, unsigned int );
+
 protected:
 
   FullSearchOptimizer();
@@ -215,6 +260,25 @@ protected:
   unsigned long m_LastSearchSpaceChanges;
   virtual void ProcessSearchSpaceChanges( void );
 
+  /** Scan the full grid, in batches, starting at the current index. */
+  virtual void ScanFullGrid( void );
+
+  /** Search the grid coarse-to-fine. */
+  virtual void CoarseToFineSearch( void );
+
+  /** Evaluate the cost function for a batch of grid points, and for each of
+   * them set the current index, point, position, and value, update the
+   * best value, and invoke an IterationEvent. Stops the optimization when
+   * an observer asks for it, or on a metric error. */
+  virtual void EvaluateBatch( const SearchSpaceIndexArrayType & indices );
+
+  /** Evaluate a list of grid points in batches of m_NumberOfCandidatesPerBatch. */
+  virtual void EvaluateCandidates( const SearchSpaceIndexArrayType & indices );
+
+  /** Convert an index to the position in a linear ordering of the grid. */
+  unsigned long IndexToLinearIndex( const SearchSpaceIndexType & index ) const;
+
+
 private:
 
   FullSearchOptimizer( const Self & ); // purposely not implemented
@@ -222,6 +286,17 @@ private:
 
   unsigned long m_CurrentIteration;
 
+  unsigned int m_NumberOfCandidatesPerBatch;
+  bool         m_UseCoarseToFineSearch;
+  unsigned int m_NumberOfCoarseToFineLevels;
+  unsigned int m_NumberOfRefinementCandidates;
+
+  /** The value and linear index of all points evaluated so far in the
+   * coarse-to-fine search, and which grid points have been evaluated. */
+  typedef std::pair< MeasureType, unsigned long > ValueIndexPairType;
+  std::vector< ValueIndexPairType > m_EvaluatedPoints;
+  std::vector< bool >               m_IsEvaluated;
+
 };
 
 } // end namespace itk
@@ -75,11 +75,29 @@ namespace elastix
  *    line search.\n
  *    example: <tt>(LBFGSUpdateAccuracy 5 10 20)</tt> \n
  *    Default value: 5.\n
+ * \parameter UseSinglePrecisionHistory: Whether the past steps and gradient differences
+ *    are stored in single precision, which halves the memory of the history. The inner
+ *    products are still accumulated in double precision.\n
+ *    example: <tt>(UseSinglePrecisionHistory "true")</tt> \n
+ *    Default value: "false".\n
+ * \parameter UseMultiThreadingForOptimizers: Whether the search direction is computed
+ *    in parallel, for transforms with many parameters.\n
+ *    example: <tt>(UseMultiThreadingForOptimizers "false")</tt> \n
+ *    Default value: "true".\n
+ * \parameter MultiThreadingThresholdForOptimizers: The minimum number of transform parameters
+ *    for which the search direction is computed in parallel.\n
+ *    example: <tt>(MultiThreadingThresholdForOptimizers 1000000)</tt> \n
+ *    Default value: 100000.\n
  * \parameter StopIfWolfeNotSatisfied: Whether to stop the optimisation if in one iteration
  *    the Wolfe conditions can not be satisfied by the itk::MoreThuenteLineSearchOptimizer.\n
  *    In general it is wise to do so.\n
  *    example: <tt>(StopIfWolfeNotSatisfied "true" "false")</tt> \n
  *    Default value: "true".\n
+ * \parameter UseCostFunctionCache: Whether the value and derivative at the last evaluated
+ *    position are remembered, so that the metric is not evaluated twice at the same position.
+ *    The cache is cleared when new samples are selected.\n
+ *    example: <tt>(UseCostFunctionCache "false")</tt> \n
+ *    Default value: "true".\n
  *
  * \ingroup Optimizers
  */
@@ -149,6 +167,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetCurrentValue();
+  }
+
   virtual void AfterRegistration( void );
 
   itkGetConstMacro( StartLineSearch, bool );
@@ -272,6 +272,22 @@ QuasiNewtonLBFGS< TElastix >
     "LBFGSUpdateAccuracy", this->GetComponentLabel(), level, 0 );
   this->SetMemory( LBFGSUpdateAccuracy );
 
+  /** Set whether the history is stored in single precision. */
+  bool useSinglePrecisionHistory = false;
+  this->m_Configuration->ReadParameter( useSinglePrecisionHistory,
+    "UseSinglePrecisionHistory", this->GetComponentLabel(), level, 0 );
+  this->SetUseSinglePrecisionHistory( useSinglePrecisionHistory );
+
+  /** Set whether the search direction is multi-threaded, and from how many parameters. */
+  bool useMultiThreading = true;
+  this->m_Configuration->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetUseMultiThread( useMultiThreading );
+  itk::SizeValueType multiThreadingThreshold = 100000;
+  this->m_Configuration->ReadParameter( multiThreadingThreshold,
+    "MultiThreadingThresholdForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetMultiThreadingThreshold( multiThreadingThreshold );
+
   /** Check whether to stop optimisation if Wolfe conditions are not satisfied. */
   this->m_StopIfWolfeNotSatisfied = true;
   std::string stopIfWolfeNotSatisfied = "true";
@@ -282,6 +298,12 @@ QuasiNewtonLBFGS< TElastix >
     this->m_StopIfWolfeNotSatisfied = false;
   }
 
+  /** Set whether repeated evaluations at the same position are cached. */
+  bool useCostFunctionCache = true;
+  this->m_Configuration->ReadParameter( useCostFunctionCache,
+    "UseCostFunctionCache", this->GetComponentLabel(), level, 0 );
+  this->SetUseCostFunctionCache( useCostFunctionCache );
+
   this->m_WolfeIsStopCondition     = false;
   this->m_SearchDirectionMagnitude = 0.0;
   this->m_StartLineSearch          = false;
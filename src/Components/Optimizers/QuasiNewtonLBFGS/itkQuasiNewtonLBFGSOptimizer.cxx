@@ -21,8 +21,11 @@
 
 #include "itkQuasiNewtonLBFGSOptimizer.h"
 #include "itkArray.h"
+#include "itkPersistentThreadPool.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -48,6 +51,11 @@ QuasiNewtonLBFGSOptimizer::QuasiNewtonLBFGSOptimizer()
   this->m_GradientMagnitudeTolerance = 1e-5;
   this->m_LineSearchOptimizer        = 0;
   this->m_Memory                     = 5;
+  this->m_UseSinglePrecisionHistory  = false;
+  this->m_UseMultiThread             = true;
+  this->m_MultiThreadingThreshold    = 100000;
+
+  this->SetUseCostFunctionCache( true );
 
 }   // end constructor
 
@@ -80,10 +88,24 @@ QuasiNewtonLBFGSOptimizer::StartOptimization()
   this->m_CurrentGradient.SetSize( numberOfParameters );
   this->m_CurrentGradient.Fill( 0.0 );
 
-  /** Resize Rho, Alpha, S and Y. */
+  /** Resize Rho, Alpha, S and Y. Only the history in the selected
+   * precision is kept; the vectors are sized in StoreCurrentPoint(). */
   this->m_Rho.SetSize( this->GetMemory() );
-  this->m_S.resize( this->GetMemory() );
-  this->m_Y.resize( this->GetMemory() );
+  this->m_YY.SetSize( this->GetMemory() );
+  this->m_S.clear();
+  this->m_Y.clear();
+  this->m_SSinglePrecision.clear();
+  this->m_YSinglePrecision.clear();
+  if( this->m_UseSinglePrecisionHistory )
+  {
+    this->m_SSinglePrecision.resize( this->GetMemory() );
+    this->m_YSinglePrecision.resize( this->GetMemory() );
+  }
+  else
+  {
+    this->m_S.resize( this->GetMemory() );
+    this->m_Y.resize( this->GetMemory() );
+  }
 
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
@@ -112,8 +134,9 @@ QuasiNewtonLBFGSOptimizer::ResumeOptimization()
   this->m_StopCondition     = Unknown;
   this->m_CurrentStepLength = 0.0;
 
+  this->RestorePendingOptimizationState();
+
   ParametersType searchDir;
-  DerivativeType previousGradient;
 
   this->InvokeEvent( StartEvent() );
 
@@ -151,7 +174,7 @@ QuasiNewtonLBFGSOptimizer::ResumeOptimization()
     }
 
     /** Store the current gradient */
-    previousGradient = this->GetCurrentGradient();
+    this->m_PreviousGradient = this->GetCurrentGradient();
 
     /** Perform a line search along the search direction. On return the
      * m_CurrentStepLength, m_CurrentScaledPosition, m_CurrentValue, and
@@ -172,13 +195,17 @@ QuasiNewtonLBFGSOptimizer::ResumeOptimization()
      * compute the search direction in the next iterations */
     if( this->GetMemory() > 0 )
     {
-      ParametersType s;
-      DerivativeType y;
-      s = this->GetCurrentStepLength() * searchDir;
-      y = this->GetCurrentGradient() - previousGradient;
-      this->StoreCurrentPoint( s, y );
-      s.clear();
-      y.clear();
+      const unsigned int     numberOfParameters = searchDir.GetSize();
+      const double           stepLength         = this->GetCurrentStepLength();
+      const DerivativeType & currentGradient    = this->GetCurrentGradient();
+      this->m_Step.SetSize( numberOfParameters );
+      this->m_GradientDifference.SetSize( numberOfParameters );
+      for( unsigned int j = 0; j < numberOfParameters; ++j )
+      {
+        this->m_Step[ j ]               = stepLength * searchDir[ j ];
+        this->m_GradientDifference[ j ] = currentGradient[ j ] - this->m_PreviousGradient[ j ];
+      }
+      this->StoreCurrentPoint( this->m_Step, this->m_GradientDifference );
     }
 
     /** Number of valid entries in m_S and m_Y */
@@ -230,6 +257,118 @@ QuasiNewtonLBFGSOptimizer::StopOptimization()
 }   // end StopOptimization()
 
 
+/**
+ * *********************** GetOptimizationState *****************************
+ */
+
+void
+QuasiNewtonLBFGSOptimizer::GetOptimizationState( OptimizationStateType & state ) const
+{
+  /** Called during the iteration event, before the iteration is counted
+   * and the index of the history is advanced.
+   */
+  const unsigned int memory    = this->GetMemory();
+  const unsigned int nextPoint = this->m_Point + 1 >= memory ? 0 : this->m_Point + 1;
+
+  state.clear();
+  state.push_back( static_cast< double >( this->m_CurrentIteration + 1 ) );
+  state.push_back( static_cast< double >( nextPoint ) );
+  state.push_back( static_cast< double >( this->m_Point ) );
+  state.push_back( static_cast< double >( this->m_Bound ) );
+  state.push_back( static_cast< double >( memory ) );
+  state.push_back( this->m_UseSinglePrecisionHistory ? 1.0 : 0.0 );
+  state.insert( state.end(), this->m_Rho.begin(), this->m_Rho.end() );
+  state.insert( state.end(), this->m_YY.begin(), this->m_YY.end() );
+
+  /** Per entry of the history: the size of s and its values, and of y. */
+  for( unsigned int i = 0; i < memory; ++i )
+  {
+    if( this->m_UseSinglePrecisionHistory )
+    {
+      const SinglePrecisionVectorType & s = this->m_SSinglePrecision[ i ];
+      const SinglePrecisionVectorType & y = this->m_YSinglePrecision[ i ];
+      state.push_back( static_cast< double >( s.GetSize() ) );
+      state.insert( state.end(), s.begin(), s.end() );
+      state.push_back( static_cast< double >( y.GetSize() ) );
+      state.insert( state.end(), y.begin(), y.end() );
+    }
+    else
+    {
+      const ParametersType & s = this->m_S[ i ];
+      const DerivativeType & y = this->m_Y[ i ];
+      state.push_back( static_cast< double >( s.GetSize() ) );
+      state.insert( state.end(), s.begin(), s.end() );
+      state.push_back( static_cast< double >( y.GetSize() ) );
+      state.insert( state.end(), y.begin(), y.end() );
+    }
+  }
+
+} // end GetOptimizationState()
+
+
+/**
+ * ******************* RestorePendingOptimizationState *********************
+ */
+
+void
+QuasiNewtonLBFGSOptimizer::RestorePendingOptimizationState( void )
+{
+  if( this->m_PendingOptimizationState.empty() )
+  {
+    return;
+  }
+  OptimizationStateType state;
+  state.swap( this->m_PendingOptimizationState );
+
+  const unsigned int memory          = this->GetMemory();
+  const bool         singlePrecision = this->m_UseSinglePrecisionHistory;
+  if( state.size() < 6 + 2 * memory
+    || static_cast< unsigned int >( state[ 4 ] ) != memory
+    || ( state[ 5 ] != 0.0 ) != singlePrecision )
+  {
+    itkExceptionMacro( << "ERROR: the optimization state does not match the settings of the optimizer." );
+  }
+
+  this->m_CurrentIteration = static_cast< unsigned long >( state[ 0 ] );
+  this->m_Point            = static_cast< unsigned int >( state[ 1 ] );
+  this->m_PreviousPoint    = static_cast< unsigned int >( state[ 2 ] );
+  this->m_Bound            = static_cast< unsigned int >( state[ 3 ] );
+  std::copy( state.begin() + 6, state.begin() + 6 + memory, this->m_Rho.begin() );
+  std::copy( state.begin() + 6 + memory, state.begin() + 6 + 2 * memory, this->m_YY.begin() );
+
+  std::size_t position = 6 + 2 * memory;
+  for( unsigned int i = 0; i < 2 * memory; ++i )
+  {
+    const std::size_t size = position < state.size()
+      ? static_cast< std::size_t >( state[ position ] ) : state.size();
+    if( size > state.size() - position - 1 )
+    {
+      itkExceptionMacro( << "ERROR: the optimization state is truncated." );
+    }
+    OptimizationStateType::const_iterator begin = state.begin() + position + 1;
+    if( singlePrecision )
+    {
+      SinglePrecisionVectorType & v = i % 2 == 0
+        ? this->m_SSinglePrecision[ i / 2 ] : this->m_YSinglePrecision[ i / 2 ];
+      v.SetSize( static_cast< unsigned int >( size ) );
+      std::copy( begin, begin + size, v.begin() );
+    }
+    else if( i % 2 == 0 )
+    {
+      this->m_S[ i / 2 ].SetSize( static_cast< unsigned int >( size ) );
+      std::copy( begin, begin + size, this->m_S[ i / 2 ].begin() );
+    }
+    else
+    {
+      this->m_Y[ i / 2 ].SetSize( static_cast< unsigned int >( size ) );
+      std::copy( begin, begin + size, this->m_Y[ i / 2 ].begin() );
+    }
+    position += 1 + size;
+  }
+
+} // end RestorePendingOptimizationState()
+
+
 /**
  * ********************* ComputeDiagonalMatrix ********************
  */
@@ -244,9 +383,8 @@ QuasiNewtonLBFGSOptimizer::ComputeDiagonalMatrix( DiagonalMatrixType & diag_H0 )
 
   if( this->m_Bound > 0 )
   {
-    const DerivativeType & y  = this->m_Y[ this->m_PreviousPoint ];
-    const double           ys = 1.0 / this->m_Rho[ this->m_PreviousPoint ];
-    const double           yy = y.squared_magnitude();
+    const double ys = 1.0 / this->m_Rho[ this->m_PreviousPoint ];
+    const double yy = this->m_YY[ this->m_PreviousPoint ];
     fill_value = ys / yy;
     if( fill_value <= 0. )
     {
@@ -273,54 +411,46 @@ QuasiNewtonLBFGSOptimizer::ComputeSearchDirection(
 
   /** Assumes m_Rho, m_S, and m_Y are up-to-date at m_PreviousPoint */
 
-  typedef Array< double > AlphaType;
-  AlphaType alpha( this->GetMemory() );
-
   const unsigned int numberOfParameters = gradient.GetSize();
-  DiagonalMatrixType H0;
-  this->ComputeDiagonalMatrix( H0 );
+  this->ComputeDiagonalMatrix( this->m_DiagonalMatrix );
 
-  searchDir = -gradient;
-
-  int cp = static_cast< int >( this->m_Point );
+  searchDir.SetSize( numberOfParameters );
+  for( unsigned int j = 0; j < numberOfParameters; ++j )
+  {
+    searchDir[ j ] = -gradient[ j ];
+  }
 
+  /** Collect the valid history, from oldest to newest. */
+  std::vector< const double * > s( this->m_Bound );
+  std::vector< const double * > y( this->m_Bound );
+  std::vector< const float * >  sSinglePrecision( this->m_Bound );
+  std::vector< const float * >  ySinglePrecision( this->m_Bound );
+  std::vector< double >         rho( this->m_Bound );
+  unsigned int                  cp = ( this->m_Point + this->GetMemory() - this->m_Bound ) % vnl_math_max( this->GetMemory(), 1u );
   for( unsigned int i = 0; i < this->m_Bound; ++i )
   {
-    --cp;
-    if( cp == -1 )
+    if( this->m_UseSinglePrecisionHistory )
     {
-      cp = this->GetMemory() - 1;
+      sSinglePrecision[ i ] = this->m_SSinglePrecision[ cp ].data_block();
+      ySinglePrecision[ i ] = this->m_YSinglePrecision[ cp ].data_block();
     }
-    const double sq = inner_product( this->m_S[ cp ], searchDir );
-    alpha[ cp ] = this->m_Rho[ cp ] * sq;
-    const double &         alpha_cp = alpha[ cp ];
-    const DerivativeType & y        = this->m_Y[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
+    else
     {
-      searchDir[ j ] -= alpha_cp * y[ j ];
+      s[ i ] = this->m_S[ cp ].data_block();
+      y[ i ] = this->m_Y[ cp ].data_block();
     }
+    rho[ i ] = this->m_Rho[ cp ];
+    cp       = ( cp + 1 ) % this->GetMemory();
   }
 
-  for( unsigned int j = 0; j < numberOfParameters; ++j )
+  if( this->m_UseSinglePrecisionHistory )
   {
-    searchDir[ j ] *= H0[ j ];
+    this->TwoLoopRecursion< float >( sSinglePrecision, ySinglePrecision, rho,
+      this->m_DiagonalMatrix, searchDir );
   }
-
-  for( unsigned int i = 0; i < this->m_Bound; ++i )
+  else
   {
-    const double           yr             = inner_product( this->m_Y[ cp ], searchDir );
-    const double           beta           = this->m_Rho[ cp ] * yr;
-    const double           alpha_min_beta = alpha[ cp ] - beta;
-    const ParametersType & s              = this->m_S[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
-    {
-      searchDir[ j ] += alpha_min_beta * s[ j ];
-    }
-    ++cp;
-    if( static_cast< unsigned int >( cp ) == this->GetMemory() )
-    {
-      cp = 0;
-    }
+    this->TwoLoopRecursion< double >( s, y, rho, this->m_DiagonalMatrix, searchDir );
   }
 
   /** Normalize if no information about previous steps is available yet */
@@ -407,9 +537,33 @@ QuasiNewtonLBFGSOptimizer::StoreCurrentPoint(
 {
   itkDebugMacro( "StoreCurrentPoint" );
 
-  this->m_S[ this->m_Point ]   = step;                                  // s
-  this->m_Y[ this->m_Point ]   = grad_dif;                              // y
-  this->m_Rho[ this->m_Point ] = 1.0 / inner_product( step, grad_dif ); // 1/ys
+  double ys = 0.0;
+  double yy = 0.0;
+  if( this->m_UseSinglePrecisionHistory )
+  {
+    /** Compute ys and yy from the rounded values, as they are used later on. */
+    const unsigned int          numberOfParameters = step.GetSize();
+    SinglePrecisionVectorType & s                  = this->m_SSinglePrecision[ this->m_Point ];
+    SinglePrecisionVectorType & y                  = this->m_YSinglePrecision[ this->m_Point ];
+    s.SetSize( numberOfParameters );
+    y.SetSize( numberOfParameters );
+    for( unsigned int j = 0; j < numberOfParameters; ++j )
+    {
+      s[ j ] = static_cast< float >( step[ j ] );
+      y[ j ] = static_cast< float >( grad_dif[ j ] );
+      ys    += static_cast< double >( s[ j ] ) * y[ j ];
+      yy    += static_cast< double >( y[ j ] ) * y[ j ];
+    }
+  }
+  else
+  {
+    this->m_S[ this->m_Point ] = step;     // s
+    this->m_Y[ this->m_Point ] = grad_dif; // y
+    ys = inner_product( step, grad_dif );
+    yy = grad_dif.squared_magnitude();
+  }
+  this->m_Rho[ this->m_Point ] = 1.0 / ys; // 1/ys
+  this->m_YY[ this->m_Point ]  = yy;
 
 }   // end StoreCurrentPoint
 
@@ -454,6 +608,164 @@ QuasiNewtonLBFGSOptimizer::TestConvergence( bool firstLineSearchDone )
 }   // end TestConvergence
 
 
+/**
+ * ********************* TwoLoopRecursion ************************
+ */
+
+template< class TValue >
+void
+QuasiNewtonLBFGSOptimizer::TwoLoopRecursion(
+  const std::vector< const TValue * > & s,
+  const std::vector< const TValue * > & y,
+  const std::vector< double > & rho,
+  const DiagonalMatrixType & H0,
+  ParametersType & searchDir )
+{
+  const SizeValueType numberOfParameters = searchDir.GetSize();
+  const int           bound              = static_cast< int >( s.size() );
+  double *            q                  = searchDir.data_block();
+
+  if( bound == 0 )
+  {
+    this->FusedUpdateAndInnerProduct< TValue >( numberOfParameters, q, 0, 0.0, H0.data_block(), 0 );
+    return;
+  }
+
+  /** First loop, from newest to oldest: alpha_i = rho_i s_i^T q, q -= alpha_i y_i.
+   * Each update of q is fused with the next inner product. The last update
+   * is fused with the multiplication by H0 and the first inner product of
+   * the second loop.
+   */
+  std::vector< double > alpha( bound );
+  double                sq = this->FusedUpdateAndInnerProduct< TValue >(
+    numberOfParameters, q, 0, 0.0, 0, s[ bound - 1 ] );
+  double yr = 0.0;
+  for( int i = bound - 1; i >= 0; --i )
+  {
+    alpha[ i ] = rho[ i ] * sq;
+    if( i > 0 )
+    {
+      sq = this->FusedUpdateAndInnerProduct< TValue >(
+        numberOfParameters, q, y[ i ], -alpha[ i ], 0, s[ i - 1 ] );
+    }
+    else
+    {
+      yr = this->FusedUpdateAndInnerProduct< TValue >(
+        numberOfParameters, q, y[ 0 ], -alpha[ 0 ], H0.data_block(), y[ 0 ] );
+    }
+  }
+
+  /** Second loop, from oldest to newest: beta_i = rho_i y_i^T r, r += ( alpha_i - beta_i ) s_i. */
+  for( int i = 0; i < bound; ++i )
+  {
+    const double beta           = rho[ i ] * yr;
+    const double alpha_min_beta = alpha[ i ] - beta;
+    yr = this->FusedUpdateAndInnerProduct< TValue >( numberOfParameters,
+      q, s[ i ], alpha_min_beta, 0, i + 1 < bound ? y[ i + 1 ] : 0 );
+  }
+
+}   // end TwoLoopRecursion
+
+
+/**
+ * ********************* FusedUpdateAndInnerProduct ************************
+ */
+
+template< class TValue >
+double
+QuasiNewtonLBFGSOptimizer::FusedUpdateAndInnerProduct(
+  const SizeValueType numberOfParameters,
+  double * x, const TValue * a, const double c, const double * d, const TValue * b )
+{
+  /** Blocks of a size that remains in cache between the passes over a block. */
+  const SizeValueType blockSize      = 4096;
+  const SizeValueType numberOfBlocks = ( numberOfParameters + blockSize - 1 ) / blockSize;
+  this->m_PartialInnerProducts.resize( numberOfBlocks );
+
+  FusedUpdatePassType< TValue > pass;
+  pass.m_X                    = x;
+  pass.m_A                    = a;
+  pass.m_C                    = c;
+  pass.m_D                    = d;
+  pass.m_B                    = b;
+  pass.m_NumberOfParameters   = numberOfParameters;
+  pass.m_BlockSize            = blockSize;
+  pass.m_PartialInnerProducts = numberOfBlocks > 0 ? &this->m_PartialInnerProducts[ 0 ] : 0;
+
+  if( this->m_UseMultiThread && numberOfParameters >= this->m_MultiThreadingThreshold )
+  {
+    PersistentThreadPool::GetInstance()->ParallelFor(
+      numberOfBlocks, 0, FusedUpdateRangeFunction< TValue >, &pass );
+  }
+  else
+  {
+    FusedUpdateRangeFunction< TValue >( &pass, 0, 0, numberOfBlocks );
+  }
+
+  /** Sum the partial inner products in block order. */
+  double innerProduct = 0.0;
+  if( b != 0 )
+  {
+    for( SizeValueType block = 0; block < numberOfBlocks; ++block )
+    {
+      innerProduct += this->m_PartialInnerProducts[ block ];
+    }
+  }
+  return innerProduct;
+
+}   // end FusedUpdateAndInnerProduct
+
+
+/**
+ * ********************* FusedUpdateRangeFunction ************************
+ */
+
+template< class TValue >
+void
+QuasiNewtonLBFGSOptimizer::FusedUpdateRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  const FusedUpdatePassType< TValue > & pass
+    = *static_cast< const FusedUpdatePassType< TValue > * >( userData );
+  double * const x = pass.m_X;
+
+  for( SizeValueType block = begin; block < end; ++block )
+  {
+    const SizeValueType first = block * pass.m_BlockSize;
+    const SizeValueType last  = vnl_math_min( first + pass.m_BlockSize, pass.m_NumberOfParameters );
+
+    if( pass.m_A != 0 )
+    {
+      const TValue * const a = pass.m_A;
+      const double         c = pass.m_C;
+      for( SizeValueType j = first; j < last; ++j )
+      {
+        x[ j ] += c * a[ j ];
+      }
+    }
+    if( pass.m_D != 0 )
+    {
+      const double * const d = pass.m_D;
+      for( SizeValueType j = first; j < last; ++j )
+      {
+        x[ j ] *= d[ j ];
+      }
+    }
+    double innerProduct = 0.0;
+    if( pass.m_B != 0 )
+    {
+      const TValue * const b = pass.m_B;
+      for( SizeValueType j = first; j < last; ++j )
+      {
+        innerProduct += b[ j ] * x[ j ];
+      }
+    }
+    pass.m_PartialInnerProducts[ block ] = innerProduct;
+  }
+
+}   // end FusedUpdateRangeFunction
+
+
 } // end namespace itk
 
 #endif // #ifndef __itkQuasiNewtonLBFGSOptimizer_cxx
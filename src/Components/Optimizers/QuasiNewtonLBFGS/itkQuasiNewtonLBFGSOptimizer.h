@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkLineSearchOptimizer.h"
+#include "itkIntTypes.h"
 #include <vector>
 
 namespace itk
@@ -51,6 +52,18 @@ namespace itk
  * The steplength is determined at each iteration by means of a
  * line search routine. The itk::MoreThuenteLineSearchOptimizer works well.
  *
+ * For large numbers of parameters the memory traffic of the two-loop
+ * recursion dominates. The history vectors may therefore be stored in single
+ * precision (UseSinglePrecisionHistory), which halves their memory. The
+ * recursion fuses each vector update with the next inner product, and splits
+ * the work in blocks that are processed on the thread pool. The partial inner
+ * products are summed in block order, so the result does not depend on the
+ * number of threads.
+ *
+ * The cost function cache of the ScaledSingleValuedNonLinearOptimizer is
+ * enabled by default, so that repeated requests for the value and derivative
+ * at the same position (e.g. at the start of a line search) are answered
+ * without evaluating the cost function again.
  *
  * \ingroup Numerics Optimizers
  */
@@ -74,11 +87,13 @@ public:
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
 
-  typedef Array< double >               RhoType;
-  typedef std::vector< ParametersType > SType;
-  typedef std::vector< DerivativeType > YType;
-  typedef Array< double >               DiagonalMatrixType;
-  typedef LineSearchOptimizer           LineSearchOptimizerType;
+  typedef Array< double >                          RhoType;
+  typedef std::vector< ParametersType >            SType;
+  typedef std::vector< DerivativeType >            YType;
+  typedef Array< float >                           SinglePrecisionVectorType;
+  typedef std::vector< SinglePrecisionVectorType > SinglePrecisionHistoryType;
+  typedef Array< double >                          DiagonalMatrixType;
+  typedef LineSearchOptimizer                      LineSearchOptimizerType;
 
   typedef LineSearchOptimizerType::Pointer LineSearchOptimizerPointer;
 
@@ -98,6 +113,10 @@ public:
 
   virtual void StopOptimization( void );
 
+  /** The state of the optimization: the iteration number and the history
+   * of s, y and 1/(ys), in the precision in which it is stored. */
+  virtual void GetOptimizationState( OptimizationStateType & state ) const;
+
   /** Get information about optimization process: */
   itkGetConstMacro( CurrentIteration, unsigned long );
   itkGetConstMacro( CurrentValue, MeasureType );
@@ -129,6 +148,19 @@ public:
   itkSetClampMacro( Memory, unsigned int, 0, NumericTraits< unsigned int >::max() );
   itkGetConstMacro( Memory, unsigned int );
 
+  /** Setting: store the history vectors s and y in single precision, which
+   * halves the memory of the history. The recursion itself is computed in
+   * double precision. Default: false. */
+  itkSetMacro( UseSinglePrecisionHistory, bool );
+  itkGetConstMacro( UseSinglePrecisionHistory, bool );
+
+  /** Setting: compute the two-loop recursion multi-threaded, if the number of
+   * parameters is at least the MultiThreadingThreshold. Default: true, 100000. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkSetMacro( MultiThreadingThreshold, SizeValueType );
+  itkGetConstMacro( MultiThreadingThreshold, SizeValueType );
+
 protected:
 
   QuasiNewtonLBFGSOptimizer();
@@ -151,6 +183,14 @@ protected:
   SType   m_S;
   YType   m_Y;
 
+  /** The history in single precision, used instead of m_S and m_Y
+   * if UseSinglePrecisionHistory is true. */
+  SinglePrecisionHistoryType m_SSinglePrecision;
+  SinglePrecisionHistoryType m_YSinglePrecision;
+
+  /** y^T y of the history, for ComputeDiagonalMatrix. */
+  RhoType m_YY;
+
   unsigned int m_Point;
   unsigned int m_PreviousPoint;
   unsigned int m_Bound;
@@ -196,6 +236,42 @@ protected:
    * (so, before the actual optimisation begins)  */
   virtual bool TestConvergence( bool firstLineSearchDone );
 
+  /** Restore and clear the state set by SetOptimizationState(), if any. */
+  void RestorePendingOptimizationState( void );
+
+  /** Compute x = ( x + c a ) .* d and return b^T x, in one pass over x.
+   * The vectors a, b and d may be 0, in which case the corresponding
+   * operation is skipped. */
+  template< class TValue >
+  double FusedUpdateAndInnerProduct( const SizeValueType numberOfParameters,
+    double * x, const TValue * a, const double c, const double * d, const TValue * b );
+
+  /** The two-loop recursion on the history vectors s_i and y_i, ordered
+   * from oldest to newest. On entry searchDir contains -gradient. */
+  template< class TValue >
+  void TwoLoopRecursion( const std::vector< const TValue * > & s,
+    const std::vector< const TValue * > & y, const std::vector< double > & rho,
+    const DiagonalMatrixType & H0, ParametersType & searchDir );
+
+  /** The data shared by the threads of FusedUpdateAndInnerProduct(). */
+  template< class TValue >
+  struct FusedUpdatePassType
+  {
+    double *       m_X;
+    const TValue * m_A;
+    double         m_C;
+    const double * m_D;
+    const TValue * m_B;
+    SizeValueType  m_NumberOfParameters;
+    SizeValueType  m_BlockSize;
+    double *       m_PartialInnerProducts;
+  };
+
+  /** Range function that processes a range of blocks of FusedUpdateAndInnerProduct(). */
+  template< class TValue >
+  static void FusedUpdateRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
 private:
 
   QuasiNewtonLBFGSOptimizer( const Self & ); // purposely not implemented
@@ -205,6 +281,16 @@ private:
   double                     m_GradientMagnitudeTolerance;
   LineSearchOptimizerPointer m_LineSearchOptimizer;
   unsigned int               m_Memory;
+  bool                       m_UseSinglePrecisionHistory;
+  bool                       m_UseMultiThread;
+  SizeValueType              m_MultiThreadingThreshold;
+
+  /** Preallocated work vectors, to avoid allocations in each iteration. */
+  ParametersType        m_Step;
+  DerivativeType        m_GradientDifference;
+  DerivativeType        m_PreviousGradient;
+  DiagonalMatrixType    m_DiagonalMatrix;
+  std::vector< double > m_PartialInnerProducts;
 
 };
 
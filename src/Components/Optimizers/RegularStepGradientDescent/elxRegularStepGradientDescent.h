@@ -115,6 +115,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetValue();
+  }
+
   virtual void AfterRegistration( void );
 
   /** Override the SetInitialPosition.
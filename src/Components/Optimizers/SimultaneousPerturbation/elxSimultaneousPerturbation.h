@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkSPSAOptimizer.h"
+#include "itkMultiCandidateCostFunction.h"
 
 namespace elastix
 {
@@ -32,6 +33,11 @@ namespace elastix
  *
  * This optimizer supports the NewSamplesEveryIteration parameter.
  *
+ * The cost function values at all \f$\pm\f$perturbations of an iteration
+ * are independent, and are requested in a single batch, such that cost
+ * functions implementing the itk::MultiCandidateCostFunction interface
+ * can evaluate them in one sweep over their data.
+ *
  * The parameters used in this class are:
  * \parameter Optimizer: Select this optimizer as follows:\n
  *    <tt>(Optimizer "SimultaneousPerturbation")</tt>
@@ -148,6 +154,14 @@ protected:
 
   bool m_ShowMetricValues;
 
+  /** Override the gradient estimate of the superclass, to evaluate
+   * the cost function at all perturbations in a single batch.
+   * The perturbations are drawn in the same order as in the superclass,
+   * so the result is identical.
+   */
+  virtual void ComputeGradient( const ParametersType & parameters,
+    DerivativeType & gradient );
+
 private:
 
   SimultaneousPerturbation( const Self & );     // purposely not implemented
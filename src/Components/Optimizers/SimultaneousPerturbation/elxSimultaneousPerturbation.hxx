@@ -22,6 +22,7 @@
 #include "elxSimultaneousPerturbation.h"
 #include <iomanip>
 #include <string>
+#include <vector>
 #include "vnl/vnl_math.h"
 
 namespace elastix
@@ -251,6 +252,70 @@ SimultaneousPerturbation< TElastix >
 }   // end SetInitialPosition
 
 
+/**
+ * ******************* ComputeGradient ***********************
+ */
+
+template< class TElastix >
+void
+SimultaneousPerturbation< TElastix >
+::ComputeGradient( const ParametersType & parameters,
+  DerivativeType & gradient )
+{
+  typedef itk::MultiCandidateCostFunction::ParametersArrayType ParametersArrayType;
+  typedef itk::MultiCandidateCostFunction::MeasureArrayType    MeasureArrayType;
+
+  const unsigned int       numberOfParameters    = parameters.GetSize();
+  const itk::SizeValueType numberOfPerturbations = this->GetNumberOfPerturbations();
+  const double             ck                    = this->Compute_c( this->GetCurrentIteration() );
+  const ScalesType &       scales                = this->GetScales();
+
+  /** Draw all perturbations first, in the same order as the superclass,
+   * and create the candidates thetaplus and thetamin for each of them.
+   */
+  std::vector< DerivativeType > deltas( numberOfPerturbations );
+  ParametersArrayType           thetas( 2 * numberOfPerturbations );
+  for( itk::SizeValueType p = 0; p < numberOfPerturbations; ++p )
+  {
+    this->GenerateDelta( numberOfParameters );
+    deltas[ p ] = this->m_Delta;
+
+    ParametersType & thetaplus = thetas[ 2 * p ];
+    ParametersType & thetamin  = thetas[ 2 * p + 1 ];
+    thetaplus.SetSize( numberOfParameters );
+    thetamin.SetSize( numberOfParameters );
+    for( unsigned int j = 0; j < numberOfParameters; ++j )
+    {
+      thetaplus[ j ] = parameters[ j ] + ck * this->m_Delta[ j ];
+      thetamin[ j ]  = parameters[ j ] - ck * this->m_Delta[ j ];
+    }
+  }
+
+  /** Evaluate all candidates at once. */
+  MeasureArrayType values;
+  itk::MultiCandidateCostFunction::GetValues(
+    this->GetCostFunction(), thetas, values );
+
+  /** Average the SPSA gradients, and apply the scaling. */
+  gradient.SetSize( numberOfParameters );
+  gradient.Fill( 0.0 );
+  for( itk::SizeValueType p = 0; p < numberOfPerturbations; ++p )
+  {
+    const double valplusminvalmin = values[ 2 * p ] - values[ 2 * p + 1 ];
+    for( unsigned int j = 0; j < numberOfParameters; ++j )
+    {
+      gradient[ j ] += valplusminvalmin / ( 2.0 * ck * deltas[ p ][ j ] )
+        / numberOfPerturbations;
+    }
+  }
+  for( unsigned int j = 0; j < numberOfParameters; ++j )
+  {
+    gradient[ j ] /= vnl_math_sqr( scales[ j ] );
+  }
+
+}   // end ComputeGradient
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxSimultaneousPerturbation_hxx
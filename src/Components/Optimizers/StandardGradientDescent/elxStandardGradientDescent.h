@@ -59,6 +59,16 @@ namespace elastix
 *   SP_alpha can be defined for each resolution. \n
 *   example: <tt>(SP_alpha 0.602 0.602 0.602)</tt> \n
 *   The default/recommended value is 0.602.
+* \parameter UseMultiThreadingForOptimizers: Whether the parameter update of each iteration
+*   is computed in parallel, for transforms with many parameters. \n
+*   The parameter can be specified for each resolution, or for all resolutions at once.\n
+*   example: <tt>(UseMultiThreadingForOptimizers "false")</tt>\n
+*   Default: true.
+* \parameter MultiThreadingThresholdForOptimizers: The minimum number of transform parameters
+*   for which the parameter update is computed in parallel. \n
+*   The parameter can be specified for each resolution, or for all resolutions at once.\n
+*   example: <tt>(MultiThreadingThresholdForOptimizers 1000000)</tt>\n
+*   Default: 100000.
 *
 * \sa StandardGradientDescentOptimizer
 * \ingroup Optimizers
@@ -119,6 +129,12 @@ public:
 
   virtual void AfterEachIteration( void );
 
+  /** The metric value of the current iteration. */
+  virtual double GetCurrentMetricValue( void ) const ITK_OVERRIDE
+  {
+    return this->GetValue();
+  }
+
   virtual void AfterRegistration( void );
 
   /** Check if any scales are set, and set the UseScales flag on or off;
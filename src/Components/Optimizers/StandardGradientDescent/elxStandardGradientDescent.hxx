@@ -108,6 +108,16 @@ StandardGradientDescent< TElastix >
       << std::endl;
   }
 
+  /** Set whether the parameter update is multi-threaded, and from how many parameters. */
+  bool useMultiThreading = true;
+  this->GetConfiguration()->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetUseMultiThread( useMultiThreading );
+  itk::SizeValueType multiThreadingThreshold = 100000;
+  this->GetConfiguration()->ReadParameter( multiThreadingThreshold,
+    "MultiThreadingThresholdForOptimizers", this->GetComponentLabel(), level, 0 );
+  this->SetMultiThreadingThreshold( multiThreadingThreshold );
+
 }   // end BeforeEachResolution()
 
 
@@ -21,16 +21,12 @@
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkExceptionObject.h"
+#include "itkPhaseTimer.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
 #endif
 
-#ifdef ELASTIX_USE_EIGEN
-#include <Eigen/Dense>
-#include <Eigen/Core>
-#endif
-
 namespace itk
 {
 
@@ -56,7 +52,8 @@ GradientDescentOptimizer2
 #ifdef ELASTIX_USE_OPENMP
   this->m_UseOpenMP = true;
 #endif
-  this->m_UseEigen = false;
+  this->m_UseEigen                = false;
+  this->m_MultiThreadingThreshold = 100000;
 
   //this->m_Threader->SetUseThreadPool( true );
 
@@ -200,6 +197,20 @@ GradientDescentOptimizer2
 } // end StopOptimization()
 
 
+/**
+ * ***************** GetWorkMemorySize ************************
+ */
+
+SizeValueType
+GradientDescentOptimizer2
+::GetWorkMemorySize( void ) const
+{
+  return this->Superclass::GetWorkMemorySize()
+         + ( this->m_Gradient.Size() + this->m_SearchDirection.Size() ) * sizeof( double );
+
+} // end GetWorkMemorySize()
+
+
 /**
  * ************ AdvanceOneStep ****************************
  */
@@ -216,93 +227,49 @@ GradientDescentOptimizer2
   /** Get a reference to the previously allocated newPosition. */
   ParametersType & newPosition = this->m_ScaledCurrentPosition;
 
-  /** Advance one step. */
-#ifndef ELASTIX_USE_OPENMP // If no OpenMP detected then use single-threaded code
   /** Get a reference to the current position. */
   const ParametersType & currentPosition = this->GetScaledCurrentPosition();
 
-  /** Update the new position. */
-  for( unsigned int j = 0; j < spaceDimension; ++j )
   {
-    newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
-  }
-#else // Otherwise use OpenMP
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  const int nthreads = static_cast< int >( this->m_Threader->GetNumberOfThreads() );
-  omp_set_num_threads( nthreads );
-  #pragma omp parallel for
-  for( int j = 0; j < static_cast< int >( spaceDimension ); j++ )
-  {
-    newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
-  }
-#endif
-
-#if 0 // disable as it seems slower
-#ifdef ELASTIX_USE_EIGEN
-  else if( !this->m_UseOpenMP && this->m_UseEigen )
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-    const double           learningRate    = this->m_LearningRate;
-
-    /** Wrap itk::Arrays into Eigen jackets. */
-    typedef Eigen::VectorXd ParametersTypeEigen;
-    Eigen::Map< ParametersTypeEigen >       newPositionE( newPosition.data_block(), spaceDimension );
-    Eigen::Map< const ParametersTypeEigen > currentPositionE( currentPosition.data_block(), spaceDimension );
-    Eigen::Map< ParametersTypeEigen >       gradientE( this->m_Gradient.data_block(), spaceDimension );
-
-    /** Update the new position. */
-    newPositionE = currentPositionE - learningRate * gradientE;
-  }
-#endif
-#if defined( ELASTIX_USE_OPENMP ) && defined( ELASTIX_USE_EIGEN )
-  else if( this->m_UseOpenMP && this->m_UseEigen )
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-    const double           learningRate    = this->m_LearningRate;
-
-    /** Wrap itk::Arrays into Eigen jackets. */
-    typedef Eigen::VectorXd ParametersTypeEigen;
-    Eigen::Map< ParametersTypeEigen >       newPositionE( newPosition.data_block(), spaceDimension );
-    Eigen::Map< const ParametersTypeEigen > currentPositionE( currentPosition.data_block(), spaceDimension );
-    Eigen::Map< ParametersTypeEigen >       gradientE( this->m_Gradient.data_block(), spaceDimension );
-
-    /** Update the new position. */
-    const int spaceDim = static_cast< int >( spaceDimension );
-    const int nthreads = static_cast< int >( this->m_Threader->GetNumberOfThreads() );
-    omp_set_num_threads( nthreads );
-    #pragma omp parallel for
-    for( int i = 0; i < nthreads; i += 1 )
+    itkPhaseTimerMacro( "OptimizerStep" );
+
+    /** Advance one step: mu_{k+1} = mu_k - a_k * gradient_k.
+     * Of the variants compared in itkAdvanceOneStepParallellizationTest,
+     * the thread pool is the fastest for large parameter vectors, while for
+     * small vectors the serial loop is faster than waking up the threads.
+     * The Eigen variants were not faster than the plain loops and are not used.
+     */
+    if( this->m_UseMultiThread && spaceDimension >= this->m_MultiThreadingThreshold )
     {
-      int threadId = omp_get_thread_num();
-      int chunk    = ( spaceDimension + nthreads - 1 ) / nthreads;
-      int jmin     = threadId * chunk;
-      int jmax     = ( threadId + 1 ) * chunk < spaceDim ? ( threadId + 1 ) * chunk : spaceDim;
-      int subSize  = jmax - jmin;
-
-      newPositionE.segment( jmin, subSize ) = currentPositionE.segment( jmin, subSize )
-        - learningRate * gradientE.segment( jmin, subSize );
+      MultiThreaderParameterType pass;
+      pass.t_CurrentPosition = currentPosition.data_block();
+      pass.t_Gradient        = this->m_Gradient.data_block();
+      pass.t_NewPosition     = newPosition.data_block();
+      pass.t_LearningRate    = this->m_LearningRate;
+
+      PersistentThreadPool::GetInstance()->ParallelFor(
+        spaceDimension, 0, AdvanceOneStepRangeFunction, &pass );
+    }
+#ifdef ELASTIX_USE_OPENMP
+    else if( this->m_UseOpenMP && spaceDimension >= this->m_MultiThreadingThreshold )
+    {
+      const int nthreads = static_cast< int >( this->m_Threader->GetNumberOfThreads() );
+      omp_set_num_threads( nthreads );
+      #pragma omp parallel for
+      for( int j = 0; j < static_cast< int >( spaceDimension ); j++ )
+      {
+        newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
+      }
     }
-  }
 #endif
-  else
-  {
-    /** Fill the threader parameter struct with information. */
-    MultiThreaderParameterType * temp = new  MultiThreaderParameterType;
-    temp->t_NewPosition = &newPosition;
-    temp->t_Optimizer   = this;
-
-    /** Call multi-threaded AdvanceOneStep(). */
-    this->m_Threader->SetSingleMethod( AdvanceOneStepThreaderCallback, (void *)( temp ) );
-    this->m_Threader->SingleMethodExecute();
-
-    delete temp;
+    else
+    {
+      for( unsigned int j = 0; j < spaceDimension; ++j )
+      {
+        newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
+      }
+    }
   }
-#endif
 
   this->InvokeEvent( IterationEvent() );
 
@@ -310,57 +277,28 @@ GradientDescentOptimizer2
 
 
 /**
- * ************ AdvanceOneStepThreaderCallback ****************************
- */
-
-ITK_THREAD_RETURN_TYPE
-GradientDescentOptimizer2
-::AdvanceOneStepThreaderCallback( void * arg )
-{
-  /** Get the current thread id and user data. */
-  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType                 threadID   = infoStruct->ThreadID;
-  MultiThreaderParameterType * temp
-    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
-
-  /** Call the real implementation. */
-  temp->t_Optimizer->ThreadedAdvanceOneStep( threadID, *( temp->t_NewPosition ) );
-
-  return ITK_THREAD_RETURN_VALUE;
-
-} // end AdvanceOneStepThreaderCallback()
-
-
-/**
- * ************ ThreadedAdvanceOneStep ****************************
+ * ************ AdvanceOneStepRangeFunction ****************************
  */
 
 void
 GradientDescentOptimizer2
-::ThreadedAdvanceOneStep( ThreadIdType threadId, ParametersType & newPosition )
+::AdvanceOneStepRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
 {
-  /** Compute the range for this thread. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
-  const unsigned int subSize = static_cast< unsigned int >(
-    vcl_ceil( static_cast< double >( spaceDimension )
-    / static_cast< double >( this->m_Threader->GetNumberOfThreads() ) ) );
-  const unsigned int jmin = threadId * subSize;
-  unsigned int       jmax = ( threadId + 1 ) * subSize;
-  jmax = ( jmax > spaceDimension ) ? spaceDimension : jmax;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-  const double           learningRate    = this->m_LearningRate;
-  const DerivativeType & gradient        = this->m_Gradient;
+  const MultiThreaderParameterType & pass
+    = *static_cast< const MultiThreaderParameterType * >( userData );
+  const double * currentPosition = pass.t_CurrentPosition;
+  const double * gradient        = pass.t_Gradient;
+  double *       newPosition     = pass.t_NewPosition;
+  const double   learningRate    = pass.t_LearningRate;
 
   /** Advance one step: mu_{k+1} = mu_k - a_k * gradient_k */
-  for( unsigned int j = jmin; j < jmax; j++ )
+  for( SizeValueType j = begin; j < end; ++j )
   {
     newPosition[ j ] = currentPosition[ j ] - learningRate * gradient[ j ];
   }
 
-} // end ThreadedAdvanceOneStep()
+} // end AdvanceOneStepRangeFunction()
 
 
 } // end namespace itk
@@ -20,6 +20,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkMultiThreader.h"
+#include "itkPersistentThreadPool.h"
 
 namespace itk
 {
@@ -77,12 +78,14 @@ public:
   typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
 
   /** Codes of stopping conditions
-   * The MinimumStepSize stopcondition never occurs, but may
-   * be implemented in inheriting classes */
+   * The MinimumStepSize, MetricValueConvergence and ComputeBudgetExhausted
+   * stopconditions never occur, but may be implemented in inheriting classes */
   typedef enum {
     MaximumNumberOfIterations,
     MetricError,
-    MinimumStepSize
+    MinimumStepSize,
+    MetricValueConvergence,
+    ComputeBudgetExhausted
   } StopConditionType;
 
   /** Advance one step following the gradient direction. */
@@ -102,6 +105,9 @@ public:
   * \sa ResumeOptimization */
   virtual void StopOptimization( void );
 
+  /** Adds the gradient and the search direction to the work memory. */
+  virtual SizeValueType GetWorkMemorySize( void ) const;
+
   /** Set the learning rate. */
   itkSetMacro( LearningRate, double );
 
@@ -138,9 +144,17 @@ public:
 
   //itkGetConstReferenceMacro( NumberOfThreads, ThreadIdType );
   itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
   itkSetMacro( UseOpenMP, bool );
   itkSetMacro( UseEigen, bool );
 
+  /** Set/Get the minimum number of parameters for which AdvanceOneStep()
+   * updates the parameters in parallel. For smaller parameter vectors the
+   * threading overhead exceeds the gain. Default: 100000.
+   */
+  itkSetMacro( MultiThreadingThreshold, SizeValueType );
+  itkGetConstMacro( MultiThreadingThreshold, SizeValueType );
+
 protected:
 
   GradientDescentOptimizer2();
@@ -170,21 +184,22 @@ private:
   void operator=( const Self & );            // purposely not implemented
 
   // multi-threaded AdvanceOneStep:
-  bool m_UseMultiThread;
+  bool          m_UseMultiThread;
+  SizeValueType m_MultiThreadingThreshold;
   struct MultiThreaderParameterType
   {
-    ParametersType * t_NewPosition;
-    Self *           t_Optimizer;
+    const double * t_CurrentPosition;
+    const double * t_Gradient;
+    double *       t_NewPosition;
+    double         t_LearningRate;
   };
 
   bool m_UseOpenMP;
   bool m_UseEigen;
 
-  /** The callback function. */
-  static ITK_THREAD_RETURN_TYPE AdvanceOneStepThreaderCallback( void * arg );
-
-  /** The threaded implementation of AdvanceOneStep(). */
-  inline void ThreadedAdvanceOneStep( ThreadIdType threadId, ParametersType & newPosition );
+  /** The range function of the multi-threaded AdvanceOneStep(). */
+  static void AdvanceOneStepRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
 
 };
 
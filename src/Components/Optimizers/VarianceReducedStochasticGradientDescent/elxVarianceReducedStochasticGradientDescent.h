@@ -0,0 +1,183 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxVarianceReducedStochasticGradientDescent_h
+#define __elxVarianceReducedStochasticGradientDescent_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdaptiveStochasticGradientDescent.h"
+
+namespace elastix
+{
+
+/**
+ * \class VarianceReducedStochasticGradientDescent
+ * \brief An adaptive stochastic gradient descent optimizer with variance
+ * reduction and a diagonal preconditioner.
+ *
+ * This optimizer extends the AdaptiveStochasticGradientDescent optimizer with
+ * two techniques that reduce the number of iterations that is needed:
+ *
+ * 1. Stochastic variance reduced gradients (SVRG). Every VarianceReductionEpochLength
+ * iterations, the 'exact' gradient \f$\mu = g(\tilde{x})\f$ is computed at a snapshot
+ * \f$\tilde{x}\f$ of the parameters, on a grid of NumberOfSamplesForExactGradient
+ * samples. In the other iterations, the stochastic gradient \f$g_k(x_k)\f$ is replaced by
+ * \f[ g_k(x_k) - g_k(\tilde{x}) + \mu, \f]
+ * where both stochastic gradients are computed on the same random samples. The noise of the
+ * samples then largely cancels. This doubles the cost per iteration, plus one exact gradient
+ * per epoch.
+ *
+ * 2. A diagonal preconditioner. At the start of each resolution the mean squared Jacobian
+ * \f$C_{pp} = 1/n \sum_j \|\partial T(x_j) / \partial \mu_p \|^2\f$ of every parameter is
+ * measured with the ComputeJacobianTerms class, on NumberOfJacobianMeasurements samples.
+ * \f$C_{pp} + \lambda \bar{C}\f$ is then used as the (squared) scales of the optimizer, which
+ * equalizes the sensitivity of the transformation to each of its parameters. The preconditioner
+ * replaces any scales set by the transform.
+ *
+ * Both techniques are combined with the automatic parameter estimation of the
+ * AdaptiveStochasticGradientDescent optimizer, which is computed with the preconditioner
+ * applied. All parameters of that optimizer may be used. Note that its estimate of SP_a is
+ * based on the noise of the plain stochastic gradients, and is therefore conservative here.
+ *
+ * The parameters used in this class are:
+ * \parameter Optimizer: Select this optimizer as follows:\n
+ *   <tt>(Optimizer "VarianceReducedStochasticGradientDescent")</tt>
+ * \parameter UseVarianceReduction: Whether to use the variance reduced gradients. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseVarianceReduction "false")</tt>\n
+ *   Default: true. It has only influence for random samplers with
+ *   (NewSamplesEveryIteration "true").
+ * \parameter VarianceReductionEpochLength: The number of iterations after which a new
+ *   snapshot and exact gradient are computed. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(VarianceReductionEpochLength 25 50 100)</tt>\n
+ *   Default: 50.
+ * \parameter UsePreconditioner: Whether to use the diagonal preconditioner. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UsePreconditioner "false")</tt>\n
+ *   Default: true.
+ * \parameter PreconditionerRegularization: The fraction \f$\lambda\f$ of the mean squared
+ *   Jacobian that is added to the preconditioner, which limits the amplification of
+ *   parameters with little support. \n
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(PreconditionerRegularization 0.01)</tt>\n
+ *   Default: 0.1.
+ *
+ * \sa AdaptiveStochasticGradientDescent, ComputeJacobianTerms
+ * \ingroup Optimizers
+ */
+
+template< class TElastix >
+class VarianceReducedStochasticGradientDescent :
+  public AdaptiveStochasticGradientDescent< TElastix >
+{
+public:
+
+  /** Standard ITK. */
+  typedef VarianceReducedStochasticGradientDescent      Self;
+  typedef AdaptiveStochasticGradientDescent< TElastix > Superclass;
+  typedef typename Superclass::Superclass1              Superclass1;
+  typedef typename Superclass::Superclass2              Superclass2;
+  typedef itk::SmartPointer< Self >                     Pointer;
+  typedef itk::SmartPointer< const Self >               ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( VarianceReducedStochasticGradientDescent,
+    AdaptiveStochasticGradientDescent );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific optimizer.
+   * example: <tt>(Optimizer "VarianceReducedStochasticGradientDescent")</tt>\n
+   */
+  elxClassNameMacro( "VarianceReducedStochasticGradientDescent" );
+
+  /** Typedef's inherited from the superclasses. */
+  typedef typename Superclass::ElastixType       ElastixType;
+  typedef typename Superclass::ConfigurationType ConfigurationType;
+  typedef typename Superclass::RegistrationType  RegistrationType;
+  typedef typename Superclass::ParametersType    ParametersType;
+  typedef typename Superclass1::DerivativeType   DerivativeType;
+  typedef typename Superclass1::ScalesType       ScalesType;
+  typedef typename Superclass::SizeValueType     SizeValueType;
+
+  /** Read the settings of variance reduction and preconditioning. */
+  virtual void BeforeEachResolution( void );
+
+  /** Estimate the preconditioner, and call the Superclass' implementation. */
+  virtual void StartOptimization( void );
+
+protected:
+
+  VarianceReducedStochasticGradientDescent();
+  virtual ~VarianceReducedStochasticGradientDescent() {}
+
+  /** Protected typedefs. */
+  typedef typename Superclass::FixedImageType                FixedImageType;
+  typedef typename Superclass::TransformType                 TransformType;
+  typedef typename Superclass::ComputeJacobianTermsType      ComputeJacobianTermsType;
+  typedef typename Superclass::ImageSamplerBasePointer       ImageSamplerBasePointer;
+  typedef typename Superclass::ImageRandomSamplerBaseType    ImageRandomSamplerBaseType;
+  typedef typename Superclass::ImageRandomSamplerBasePointer ImageRandomSamplerBasePointer;
+  typedef typename Superclass::ImageGridSamplerType          ImageGridSamplerType;
+  typedef typename Superclass::ImageGridSamplerPointer       ImageGridSamplerPointer;
+
+  /** Replace the stochastic gradient by the variance reduced gradient, and
+   * call the Superclass' implementation.
+   */
+  virtual void AdvanceOneStep( void );
+
+  /** Compute the diagonal preconditioner and set it as the scales. */
+  virtual void ComputePreconditioner( void );
+
+  /** Compute the 'exact' gradient at the given (scaled) position, on the grid
+   * samplers that replace the random samplers of the metrics.
+   */
+  virtual void ComputeExactGradient( const ParametersType & position,
+    DerivativeType & exactGradient );
+
+private:
+
+  VarianceReducedStochasticGradientDescent( const Self & ); // purposely not implemented
+  void operator=( const Self & );                           // purposely not implemented
+
+  /** Settings. */
+  bool          m_UseVarianceReduction;
+  SizeValueType m_VarianceReductionEpochLength;
+  bool          m_UsePreconditioner;
+  double        m_PreconditionerRegularization;
+
+  /** The snapshot and the exact gradient at the snapshot. */
+  ParametersType m_SnapshotPosition;
+  DerivativeType m_SnapshotGradient;
+  DerivativeType m_StochasticSnapshotGradient;
+
+  /** The random samplers of the metrics and the grid samplers that replace them. */
+  std::vector< ImageRandomSamplerBasePointer > m_RandomSamplers;
+  std::vector< ImageGridSamplerPointer >       m_GridSamplers;
+
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxVarianceReducedStochasticGradientDescent.hxx"
+#endif
+
+#endif // end #ifndef __elxVarianceReducedStochasticGradientDescent_h
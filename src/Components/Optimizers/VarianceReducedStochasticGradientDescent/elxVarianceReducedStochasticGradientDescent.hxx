@@ -0,0 +1,280 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxVarianceReducedStochasticGradientDescent_hxx
+#define __elxVarianceReducedStochasticGradientDescent_hxx
+
+#include "elxVarianceReducedStochasticGradientDescent.h"
+#include "itkAdvancedImageToImageMetric.h"
+#include "itkTimeProbe.h"
+
+namespace elastix
+{
+
+/**
+ * ********************** Constructor ***********************
+ */
+
+template< class TElastix >
+VarianceReducedStochasticGradientDescent< TElastix >
+::VarianceReducedStochasticGradientDescent()
+{
+  this->m_UseVarianceReduction         = true;
+  this->m_VarianceReductionEpochLength = 50;
+  this->m_UsePreconditioner            = true;
+  this->m_PreconditionerRegularization = 0.1;
+
+} // Constructor
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+VarianceReducedStochasticGradientDescent< TElastix >
+::BeforeEachResolution( void )
+{
+  this->Superclass::BeforeEachResolution();
+
+  /** Get the current resolution level. */
+  unsigned int level = static_cast< unsigned int >(
+    this->m_Registration->GetAsITKBaseType()->GetCurrentLevel() );
+
+  /** Set the variance reduction settings. */
+  this->m_UseVarianceReduction = true;
+  this->GetConfiguration()->ReadParameter( this->m_UseVarianceReduction,
+    "UseVarianceReduction", this->GetComponentLabel(), level, 0 );
+  this->m_VarianceReductionEpochLength = 50;
+  this->GetConfiguration()->ReadParameter( this->m_VarianceReductionEpochLength,
+    "VarianceReductionEpochLength", this->GetComponentLabel(), level, 0 );
+  this->m_VarianceReductionEpochLength = vnl_math_max(
+    this->m_VarianceReductionEpochLength, static_cast< SizeValueType >( 1 ) );
+
+  /** Set the preconditioner settings. */
+  this->m_UsePreconditioner = true;
+  this->GetConfiguration()->ReadParameter( this->m_UsePreconditioner,
+    "UsePreconditioner", this->GetComponentLabel(), level, 0 );
+  this->m_PreconditionerRegularization = 0.1;
+  this->GetConfiguration()->ReadParameter( this->m_PreconditionerRegularization,
+    "PreconditionerRegularization", this->GetComponentLabel(), level, 0 );
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ****************** StartOptimization *************************
+ */
+
+template< class TElastix >
+void
+VarianceReducedStochasticGradientDescent< TElastix >
+::StartOptimization( void )
+{
+  /** Estimate the preconditioner at the initial position. */
+  if( this->m_UsePreconditioner )
+  {
+    this->ComputePreconditioner();
+  }
+
+  /** Prepare a grid sampler for the 'exact' gradients of each metric with a
+   * random sampler. Without any random sampler variance reduction is useless.
+   */
+  this->m_SnapshotGradient.SetSize( 0 );
+  this->m_RandomSamplers.clear();
+  this->m_GridSamplers.clear();
+  if( this->m_UseVarianceReduction )
+  {
+    const unsigned int M                   = this->GetElastix()->GetNumberOfMetrics();
+    bool               stochasticgradients = false;
+    this->m_RandomSamplers.resize( M, 0 );
+    this->m_GridSamplers.resize( M, 0 );
+    for( unsigned int m = 0; m < M && this->GetNewSamplesEveryIteration(); ++m )
+    {
+      ImageSamplerBasePointer sampler
+        = this->GetElastix()->GetElxMetricBase( m )->GetAdvancedMetricImageSampler();
+      this->m_RandomSamplers[ m ]
+        = dynamic_cast< ImageRandomSamplerBaseType * >( sampler.GetPointer() );
+      if( this->m_RandomSamplers[ m ].IsNotNull() )
+      {
+        stochasticgradients = true;
+
+        /** Copy the settings from the random sampler and update. */
+        this->m_GridSamplers[ m ] = ImageGridSamplerType::New();
+        this->m_GridSamplers[ m ]->SetInput( this->m_RandomSamplers[ m ]->GetInput() );
+        this->m_GridSamplers[ m ]->SetInputImageRegion(
+          this->m_RandomSamplers[ m ]->GetInputImageRegion() );
+        this->m_GridSamplers[ m ]->SetMask( this->m_RandomSamplers[ m ]->GetMask() );
+        this->m_GridSamplers[ m ]->SetNumberOfSamples( this->m_NumberOfSamplesForExactGradient );
+        this->m_GridSamplers[ m ]->Update();
+      }
+    }
+
+    if( !stochasticgradients )
+    {
+      xl::xout[ "warning" ]
+        << "WARNING: UseVarianceReduction is turned off in this resolution, "
+        << "because no metric uses a random sampler with NewSamplesEveryIteration." << std::endl;
+      this->m_UseVarianceReduction = false;
+      this->m_RandomSamplers.clear();
+      this->m_GridSamplers.clear();
+    }
+  }
+
+  this->Superclass::StartOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ****************** AdvanceOneStep *************************
+ */
+
+template< class TElastix >
+void
+VarianceReducedStochasticGradientDescent< TElastix >
+::AdvanceOneStep( void )
+{
+  if( this->m_UseVarianceReduction )
+  {
+    if( this->GetCurrentIteration() % this->m_VarianceReductionEpochLength == 0
+      || this->m_SnapshotGradient.GetSize() != this->m_Gradient.GetSize() )
+    {
+      /** Take a new snapshot. At the snapshot the variance reduced
+       * gradient equals the exact gradient.
+       */
+      this->m_SnapshotPosition = this->GetScaledCurrentPosition();
+      this->ComputeExactGradient( this->m_SnapshotPosition, this->m_SnapshotGradient );
+      this->m_Gradient = this->m_SnapshotGradient;
+    }
+    else
+    {
+      /** g_k( x_k ) - g_k( snapshot ) + g( snapshot ), on the same samples. */
+      this->GetScaledDerivativeWithExceptionHandling(
+        this->m_SnapshotPosition, this->m_StochasticSnapshotGradient );
+      this->m_Gradient -= this->m_StochasticSnapshotGradient;
+      this->m_Gradient += this->m_SnapshotGradient;
+    }
+  }
+
+  this->Superclass::AdvanceOneStep();
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ****************** ComputePreconditioner *************************
+ */
+
+template< class TElastix >
+void
+VarianceReducedStochasticGradientDescent< TElastix >
+::ComputePreconditioner( void )
+{
+  itk::TimeProbe timer;
+  timer.Start();
+  elxout << "  Computing the preconditioner ..." << std::endl;
+
+  /** Cast to advanced metric type. */
+  typedef typename ElastixType::MetricBaseType::AdvancedMetricType MetricType;
+  MetricType * testPtr = dynamic_cast< MetricType * >(
+    this->GetElastix()->GetElxMetricBase()->GetAsITKBaseType() );
+  if( !testPtr )
+  {
+    itkExceptionMacro( << "ERROR: VarianceReducedStochasticGradientDescent expects "
+                       << "the metric to be of type AdvancedImageToImageMetric!" );
+  }
+
+  /** Measure the Jacobians at the initial position. */
+  TransformType * transform = this->GetRegistration()->GetAsITKBaseType()->GetTransform();
+  transform->SetParameters( this->GetInitialPosition() );
+  const SizeValueType P = transform->GetNumberOfParameters();
+
+  typename ComputeJacobianTermsType::Pointer computeJacobianTerms = ComputeJacobianTermsType::New();
+  computeJacobianTerms->SetFixedImage( testPtr->GetFixedImage() );
+  computeJacobianTerms->SetFixedImageRegion( testPtr->GetFixedImageRegion() );
+  computeJacobianTerms->SetFixedImageMask( testPtr->GetFixedImageMask() );
+  computeJacobianTerms->SetTransform( transform );
+  computeJacobianTerms->SetNumberOfJacobianMeasurements(
+    this->m_NumberOfJacobianMeasurements > 0 ? this->m_NumberOfJacobianMeasurements
+    : vnl_math_max( static_cast< SizeValueType >( 1000 ), P ) );
+
+  ScalesType diagonal;
+  computeJacobianTerms->ComputeDiagonalOfCovariance( diagonal );
+
+  /** Regularize with a fraction of the mean. */
+  const double meanDiagonal = diagonal.mean();
+  if( meanDiagonal < 1e-14 )
+  {
+    xl::xout[ "warning" ]
+      << "WARNING: The preconditioner is not used in this resolution, "
+      << "because the transform has no measurable Jacobian." << std::endl;
+    return;
+  }
+  ScalesType scales( P );
+  for( SizeValueType p = 0; p < P; ++p )
+  {
+    scales[ p ] = diagonal[ p ] + this->m_PreconditionerRegularization * meanDiagonal;
+  }
+  this->SetScales( scales );
+
+  timer.Stop();
+  elxout << "  Computing the preconditioner took "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 6 ) << std::endl;
+
+} // end ComputePreconditioner()
+
+
+/**
+ * ****************** ComputeExactGradient *************************
+ */
+
+template< class TElastix >
+void
+VarianceReducedStochasticGradientDescent< TElastix >
+::ComputeExactGradient( const ParametersType & position, DerivativeType & exactGradient )
+{
+  const unsigned int M = this->m_GridSamplers.size();
+
+  /** Set the grid samplers and get the exact derivative. */
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    if( this->m_GridSamplers[ m ].IsNotNull() )
+    {
+      this->GetElastix()->GetElxMetricBase( m )
+      ->SetAdvancedMetricImageSampler( this->m_GridSamplers[ m ] );
+    }
+  }
+  this->GetScaledDerivativeWithExceptionHandling( position, exactGradient );
+
+  /** Set back the random samplers. */
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    if( this->m_RandomSamplers[ m ].IsNotNull() )
+    {
+      this->GetElastix()->GetElxMetricBase( m )
+      ->SetAdvancedMetricImageSampler( this->m_RandomSamplers[ m ] );
+    }
+  }
+
+} // end ComputeExactGradient()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxVarianceReducedStochasticGradientDescent_hxx
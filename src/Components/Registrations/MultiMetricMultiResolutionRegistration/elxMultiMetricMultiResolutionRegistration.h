@@ -53,8 +53,7 @@ namespace elastix
  * \li 1 fixed image pyramid is used.
  * This will save a bit of memory and computation time.
  * In general however, it is better to use the same number of samplers as
- * metrics. Note that some metrics (ViolaWellsMutualInformation for example)
- * do not support the image sampler functionality (yet).
+ * metrics.
  *
  * The parameters used in this class are:\n
  * \parameter Registration: Select this registration framework as follows:\n
@@ -88,6 +87,15 @@ namespace elastix
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter UseSharedFixedSampleFeatures: Whether metrics with the same image
+ *    sampler share the fixed sample features of the transform, when they store
+ *    them (see UseFixedSampleFeatureCache). Can be given for each resolution. \n
+ *    example: <tt>(UseSharedFixedSampleFeatures "false")</tt> \n
+ *    The default is "true".
+ * \parameter UseConcurrentMetrics: Whether the metrics are evaluated concurrently,
+ *    one thread per metric. Can be given for each resolution. \n
+ *    example: <tt>(UseConcurrentMetrics "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Registrations
  */
@@ -74,8 +74,12 @@ MultiMetricMultiResolutionRegistration< TElastix >
       throw excp;
     }
 
-    /** Set the fixedImageRegion. */
-    this->SetFixedImageRegion( this->GetElastix()->GetFixedImage( i )->GetBufferedRegion(), i );
+    /** Set the fixedImageRegion. This is the cropped region, if the fixed image was
+     * cropped to the fixed mask in SetComponents(), restricted to the block that is
+     * registered, if the fixed image is decomposed into blocks. */
+    this->SetFixedImageRegion( this->GenerateFixedImageBlockRegion(
+      this->GetElastix()->GetFixedImage( i ),
+      this->GetFixedImage( i )->GetBufferedRegion() ), i );
   }
 
   /** Add the target cells "Metric<i>" and "||Gradient<i>||" to xout["iteration"]
@@ -236,6 +240,17 @@ MultiMetricMultiResolutionRegistration< TElastix >
     this->GetCombinationMetric()->SetUseMetric( use, metricnr );
   }
 
+  /** Set the sharing of fixed sample features and the concurrent evaluation. */
+  bool useSharedFixedSampleFeatures = true;
+  this->GetConfiguration()->ReadParameter( useSharedFixedSampleFeatures,
+    "UseSharedFixedSampleFeatures", "", level, 0, false );
+  this->GetCombinationMetric()->SetUseSharedFixedSampleFeatures( useSharedFixedSampleFeatures );
+
+  bool useConcurrentMetrics = false;
+  this->GetConfiguration()->ReadParameter( useConcurrentMetrics,
+    "UseConcurrentMetrics", "", level, 0, false );
+  this->GetCombinationMetric()->SetUseConcurrentMetrics( useConcurrentMetrics );
+
   /** Check if the exact metric value, computed on all pixels, should be shown.
    * If at least one of the metrics has it enabled, show also the weighted sum of all
    * exact metric values. */
@@ -285,9 +300,15 @@ MultiMetricMultiResolutionRegistration< TElastix >
       GetElxMetricBase( i )->GetAsITKBaseType(), i );
   }
 
+  /** The fixed images are cropped to the fixed mask with the same index, or to the
+   * first fixed mask if there is only one. */
+  const unsigned int nrOfFixedMasks = this->GetElastix()->GetNumberOfFixedMasks();
   for( unsigned int i = 0; i < this->GetElastix()->GetNumberOfFixedImages(); ++i )
   {
-    this->SetFixedImage( this->GetElastix()->GetFixedImage( i ), i );
+    FixedMaskImageType * fixedMask
+      = this->GetElastix()->GetFixedMask( nrOfFixedMasks == 1 ? 0 : i );
+    this->SetFixedImage( this->GenerateCroppedFixedImage(
+      this->GetElastix()->GetFixedImage( i ), fixedMask ), i );
   }
 
   for( unsigned int i = 0; i < this->GetElastix()->GetNumberOfMovingImages(); ++i )
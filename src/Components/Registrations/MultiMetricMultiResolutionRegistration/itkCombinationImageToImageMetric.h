@@ -50,6 +50,21 @@ namespace itk
  * why we chose to reimplement the Get{Transform,Interpolator}()
  * methods.
  *
+ * Sub metrics that share the image sampler and the transform also share
+ * the fixed sample features of the transform (the B-spline weights and
+ * nonzero Jacobian indices of each sample, see
+ * AdvancedImageToImageMetric::SetUseFixedSampleFeatureCache()). These are
+ * then computed and stored once, by the first of these metrics, instead of
+ * once per metric (UseSharedFixedSampleFeatures, default true).
+ *
+ * With UseConcurrentMetrics the sub metrics are evaluated concurrently in
+ * GetValueAndDerivative(), one thread per metric. The thread-unsafe
+ * preparations (setting the parameters, updating the samplers) are still
+ * done serially first. A sub metric that distributes its own work over the
+ * PersistentThreadPool while the pool is busy with another sub metric runs
+ * serially in its thread, so this mode pays off most when one expensive
+ * metric is combined with cheaper penalty terms. Default: false.
+ *
  *
  * \ingroup RegistrationMetrics
  *
@@ -203,6 +218,16 @@ public:
   /** \todo: Temporary, should think about interface. */
   itkSetMacro( UseMultiThread, bool );
 
+  /** Share the fixed sample features between sub metrics with the
+   * same image sampler and transform. Takes effect in Initialize().
+   */
+  itkSetMacro( UseSharedFixedSampleFeatures, bool );
+  itkGetConstMacro( UseSharedFixedSampleFeatures, bool );
+
+  /** Evaluate the sub metrics concurrently in GetValueAndDerivative(). */
+  itkSetMacro( UseConcurrentMetrics, bool );
+  itkGetConstMacro( UseConcurrentMetrics, bool );
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -382,6 +407,14 @@ public:
   /** The GetValue()-method. */
   virtual MeasureType GetValue( const ParametersType & parameters ) const;
 
+  /** Typedefs for evaluating several parameter vectors at once. */
+  typedef typename Superclass::ParametersArrayType ParametersArrayType;
+  typedef typename Superclass::MeasureArrayType    MeasureArrayType;
+
+  /** The GetValues()-method: passes all parameter vectors to each sub metric. */
+  virtual void GetValues( const ParametersArrayType & parametersArray,
+    MeasureArrayType & values ) const;
+
   /** The GetDerivative()-method. */
   virtual void GetDerivative(
     const ParametersType & parameters,
@@ -398,6 +431,11 @@ public:
     const TransformParametersType & parameters,
     HessianType & H ) const;
 
+  /** Compute the weighted sum of the diagonals of the sub metrics' SelfHessians. */
+  virtual void GetSelfHessianDiagonal(
+    const TransformParametersType & parameters,
+    DerivativeType & diagonal ) const;
+
   /** Method to return the latest modified time of this object or any of its
    * cached ivars.
    */
@@ -450,6 +488,11 @@ private:
    */
   double GetFinalMetricWeight( unsigned int pos ) const;
 
+  /** Let every image sub metric use the fixed sample features of the first
+   * preceding sub metric with the same image sampler and transform.
+   */
+  void ShareFixedSampleFeatures( void );
+
   /** For threading: store thread data. */
   struct MultiThreaderComboMetricsType
   {
@@ -468,6 +511,8 @@ private:
   };
 
   bool m_UseMultiThread;
+  bool m_UseSharedFixedSampleFeatures;
+  bool m_UseConcurrentMetrics;
 
 };
 
@@ -164,7 +164,9 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_UseRelativeWeights = false;
   this->ComputeGradientOff();
 
-  this->m_UseMultiThread = true;
+  this->m_UseMultiThread               = true;
+  this->m_UseSharedFixedSampleFeatures = true;
+  this->m_UseConcurrentMetrics         = false;
 
 } // end Constructor
 
@@ -641,9 +643,60 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
+  /** Avoid computing the same fixed sample features in several metrics. */
+  this->ShareFixedSampleFeatures();
+
 } // end Initialize()
 
 
+/**
+ * ******************* ShareFixedSampleFeatures *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::ShareFixedSampleFeatures( void )
+{
+  for( unsigned int i = 0; i < this->GetNumberOfMetrics(); i++ )
+  {
+    ImageMetricType * metricI = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+    if( !metricI )
+    {
+      continue;
+    }
+
+    /** By default a metric uses its own features. */
+    metricI->SetFixedSampleFeatureCacheSource( 0 );
+    if( !this->m_UseSharedFixedSampleFeatures
+      || !metricI->GetUseFixedSampleFeatureCache()
+      || !metricI->GetUseImageSampler() )
+    {
+      continue;
+    }
+
+    /** Find the first metric with the same sampler and transform that computes
+     * the features itself.
+     */
+    for( unsigned int j = 0; j < i; j++ )
+    {
+      const ImageMetricType * metricJ = dynamic_cast< const ImageMetricType * >( this->GetMetric( j ) );
+      if( metricJ
+        && metricJ->GetFixedSampleFeatureCacheSource() == 0
+        && metricJ->GetUseFixedSampleFeatureCache()
+        && metricJ->GetUseImageSampler()
+        && metricJ->GetImageSampler() == metricI->GetImageSampler()
+        && metricJ->GetTransform() == metricI->GetTransform() )
+      {
+        metricI->SetFixedSampleFeatureCacheSource( metricJ );
+        break;
+      }
+    }
+  }
+
+} // end ShareFixedSampleFeatures()
+
+
 /**
  * ******************* InitializeThreadingParameters *******************
  */
@@ -755,6 +808,75 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValue()
 
 
+/**
+ * ********************* GetValues ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValues( const ParametersArrayType & parametersArray,
+  MeasureArrayType & values ) const
+{
+  /** Initialise. */
+  const std::size_t numberOfCandidates = parametersArray.size();
+  values.assign( numberOfCandidates, NumericTraits< MeasureType >::Zero );
+  if( numberOfCandidates == 0 )
+  {
+    return;
+  }
+
+  /** Compute the values of all sub metrics, for all candidates at once. */
+  std::vector< MeasureArrayType > metricValues( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    /** Time the computation per metric. */
+    itk::TimeProbe timer;
+    timer.Start();
+    MultiCandidateCostFunction::GetValues(
+      this->m_Metrics[ i ], parametersArray, metricValues[ i ] );
+    timer.Stop();
+    this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
+  }
+
+  /** Combine per candidate, as in GetValue(). The stored metric values
+   * are those of the last candidate.
+   */
+  for( std::size_t k = 0; k < numberOfCandidates; ++k )
+  {
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      this->m_MetricValues[ i ] = metricValues[ i ][ k ];
+    }
+
+    MeasureType measure = NumericTraits< MeasureType >::Zero;
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      if( this->m_UseMetric[ i ] )
+      {
+        if( !this->m_UseRelativeWeights )
+        {
+          measure += this->m_MetricWeights[ i ] * this->m_MetricValues[ i ];
+        }
+        else
+        {
+          /** See GetValue() for the relative weights. */
+          if( this->m_MetricValues[ i ] > 1e-10 )
+          {
+            const double weight = this->m_MetricRelativeWeights[ i ]
+              * this->m_MetricValues[ 0 ]
+              / this->m_MetricValues[ i ];
+            measure += weight * this->m_MetricValues[ i ];
+          }
+        }
+      }
+    }
+    values[ k ] = measure;
+  }
+
+} // end GetValues()
+
+
 /**
  * ********************* GetDerivative ****************************
  */
@@ -872,9 +994,13 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     useMultiThread = false;
   }
 
-  // For now we disable multi-threading of the combo metric, since the MacMini build
-  // segfaults with it. Have to investigate this issue later
-  useMultiThread = false;
+  /** Running the metrics concurrently has been seen to segfault on the MacMini
+   * build, so it is only done on request.
+   */
+  if( !this->m_UseConcurrentMetrics )
+  {
+    useMultiThread = false;
+  }
 
   /** Compute all metric values and derivatives, single-threadedly. */
   if( !useMultiThread )
@@ -1205,6 +1331,51 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetSelfHessian()
 
 
+/**
+ * ********************* GetSelfHessianDiagonal ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianDiagonal( const TransformParametersType & parameters,
+  DerivativeType & diagonal ) const
+{
+  /** Prepare the diagonal. */
+  diagonal.SetSize( this->GetNumberOfParameters() );
+  diagonal.Fill( 0.0 );
+  DerivativeType tmpDiagonal;
+
+  /** Add all metrics' diagonals. */
+  bool initialized = false;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if( this->m_UseMetric[ i ] )
+    {
+      const double      w      = this->m_MetricWeights[ i ];
+      ImageMetricType * metric = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+      if( metric )
+      {
+        initialized = true;
+        metric->GetSelfHessianDiagonal( parameters, tmpDiagonal );
+        for( unsigned int j = 0; j < this->GetNumberOfParameters(); ++j )
+        {
+          diagonal[ j ] += w * tmpDiagonal[ j ];
+        }
+      }
+    }
+  }
+
+  /** If none of the submetrics has a valid implementation of GetSelfHessian,
+   * then return the diagonal of an identity matrix */
+  if( !initialized )
+  {
+    diagonal.Fill( 1.0 );
+  }
+
+} // end GetSelfHessianDiagonal()
+
+
 /**
  * ********************* GetMTime ****************************
  */
@@ -400,6 +400,15 @@ MultiMetricMultiResolutionImageRegistrationMethod< TFixedImage, TMovingImage >
       break;
     }
 
+    // Skip the levels before the first level; their initial parameters
+    // are passed on to the next level.
+    if( currentLevel < this->GetFirstLevel() )
+    {
+      this->m_LastTransformParameters = this->GetInitialTransformParametersOfNextLevel();
+      this->GetTransform()->SetParameters( this->m_LastTransformParameters );
+      continue;
+    }
+
     try
     {
       // initialize the interconnects between components
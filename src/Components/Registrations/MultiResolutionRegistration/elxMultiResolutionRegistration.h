@@ -37,6 +37,22 @@ namespace elastix
  * \parameter NumberOfResolutions: the number of resolutions used. \n
  *    example: <tt>(NumberOfResolutions 4)</tt> \n
  *    The default is 3.
+ * \parameter NumberOfMultiStartCandidates: the number of initial transform parameter
+ *    vectors that are tried at the first resolution. The first candidate is the initial
+ *    transform, the others are random perturbations of it. The candidates are pruned by
+ *    successive halving, and only the best one is optimized further, see
+ *    itk::MultiResolutionImageRegistrationMethod2. \n
+ *    example: <tt>(NumberOfMultiStartCandidates 8)</tt> \n
+ *    The default is 1, i.e. no multi-start.
+ * \parameter MultiStartParameterRange: the maximum perturbation of the transform parameters
+ *    for the multi-start candidates, in the units of the parameters, e.g. radians for
+ *    rotations and mm for translations. Give one value per transform parameter, or one
+ *    value for all parameters. Required if NumberOfMultiStartCandidates is larger than 1. \n
+ *    example: <tt>(MultiStartParameterRange 0.5 0.5 0.5 10.0 10.0 10.0)</tt>
+ * \parameter MultiStartNumberOfIterations: the number of iterations per candidate in the
+ *    first round of the successive halving; it is doubled in every next round. \n
+ *    example: <tt>(MultiStartNumberOfIterations 20)</tt> \n
+ *    The default is 10.
  *
  * \ingroup Registrations
  */
@@ -131,7 +147,8 @@ public:
   virtual void BeforeRegistration( void );
 
   /** Execute stuff before each resolution:
-   * \li Update masks with an erosion. */
+   * \li Update masks with an erosion.
+   * \li Set the multi-start candidates, at the first resolution. */
   virtual void BeforeEachResolution( void );
 
 protected:
@@ -158,6 +175,10 @@ protected:
   /** Read the components from m_Elastix and set them in the Registration class. */
   virtual void SetComponents( void );
 
+  /** Generate the multi-start candidates from the initial transform parameters,
+   * as specified in the parameter file. */
+  virtual void GenerateMultiStartCandidates( void );
+
 private:
 
   /** The private constructor. */
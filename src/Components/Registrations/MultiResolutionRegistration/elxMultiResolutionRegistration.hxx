@@ -21,6 +21,7 @@
 #include "elxMultiResolutionRegistration.h"
 #include "vnl/vnl_math.h"
 #include "itkTimeProbe.h"
+#include "vnl/vnl_random.h"
 
 namespace elastix
 {
@@ -75,8 +76,11 @@ MultiResolutionRegistration< TElastix >
     throw excp;
   }
 
-  /** Set the fixedImageRegion. */
-  this->SetFixedImageRegion( this->GetElastix()->GetFixedImage()->GetBufferedRegion() );
+  /** Set the fixedImageRegion. This is the cropped region, if the fixed image was
+   * cropped to the fixed mask in SetComponents(), restricted to the block that is
+   * registered, if the fixed image is decomposed into blocks. */
+  this->SetFixedImageRegion( this->GenerateFixedImageBlockRegion(
+    this->GetElastix()->GetFixedImage(), this->GetFixedImage()->GetBufferedRegion() ) );
 
 } // end BeforeRegistration()
 
@@ -98,9 +102,83 @@ MultiResolutionRegistration< TElastix >
    */
   this->UpdateMasks( level );
 
+  /** Set the candidates of the multi-start. */
+  if( level == 0 )
+  {
+    this->GenerateMultiStartCandidates();
+  }
+
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* GenerateMultiStartCandidates ***********************
+ */
+
+template< class TElastix >
+void
+MultiResolutionRegistration< TElastix >
+::GenerateMultiStartCandidates( void )
+{
+  typedef typename Superclass1::ParametersContainerType ParametersContainerType;
+
+  unsigned int numberOfCandidates = 1;
+  this->m_Configuration->ReadParameter( numberOfCandidates,
+    "NumberOfMultiStartCandidates", 0 );
+  if( numberOfCandidates < 2 )
+  {
+    this->SetMultiStartCandidates( ParametersContainerType() );
+    return;
+  }
+
+  unsigned int numberOfIterations = 10;
+  this->m_Configuration->ReadParameter( numberOfIterations,
+    "MultiStartNumberOfIterations", 0 );
+  this->SetMultiStartNumberOfIterations( numberOfIterations );
+
+  /** Read the range of the perturbations: one value for all parameters,
+   * or one value per parameter.
+   */
+  const ParametersType & initialParameters
+    = this->GetInitialTransformParametersOfNextLevel();
+  const unsigned int numberOfParameters = initialParameters.GetSize();
+  const std::size_t  count
+    = this->m_Configuration->CountNumberOfParameterEntries( "MultiStartParameterRange" );
+  if( count != 1 && count != numberOfParameters )
+  {
+    itkExceptionMacro( << "ERROR: The MultiStartParameterRange-option in the parameter-file"
+                       << " has not been set properly. Give one value, or one value per"
+                       << " transform parameter (" << numberOfParameters << ")." );
+  }
+  ParametersType range( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    range[ i ] = 0.0;
+    this->m_Configuration->ReadParameter( range[ i ],
+      "MultiStartParameterRange", count == 1 ? 0 : i );
+  }
+
+  /** The first candidate is the initial transform. The others are uniformly
+   * distributed in the range around it. A fixed seed keeps the registration
+   * reproducible.
+   */
+  vnl_random              random( 121212 );
+  ParametersContainerType candidates( numberOfCandidates, initialParameters );
+  for( unsigned int c = 1; c < numberOfCandidates; ++c )
+  {
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      candidates[ c ][ i ] += range[ i ] * random.drand64( -1.0, 1.0 );
+    }
+  }
+  this->SetMultiStartCandidates( candidates );
+
+  elxout << "  Multi-start with " << numberOfCandidates << " candidates, "
+         << numberOfIterations << " iterations in the first round." << std::endl;
+
+} // end GenerateMultiStartCandidates()
+
+
 /**
  * *********************** SetComponents ************************
  */
@@ -113,7 +191,8 @@ MultiResolutionRegistration< TElastix >
   /** Get the component from this-GetElastix() (as elx::...BaseType *),
    * cast it to the appropriate type and set it in 'this'. */
 
-  this->SetFixedImage( this->GetElastix()->GetFixedImage() );
+  this->SetFixedImage( this->GenerateCroppedFixedImage(
+    this->GetElastix()->GetFixedImage(), this->GetElastix()->GetFixedMask() ) );
   this->SetMovingImage( this->GetElastix()->GetMovingImage() );
 
   this->SetFixedImagePyramid( this->GetElastix()->
@@ -46,6 +46,10 @@ namespace elastix
  *    example: <tt>(Metric1Weight 0.5 0.5 0.2)</tt> \n
  *    The default is 1.0.
  *
+ * The pyramids of all inputs are computed concurrently. If a MemoryBudget is
+ * given, see ElastixTemplate, the pyramids that are computed at the same time
+ * together stay within it, as far as their estimated memory goes.
+ *
  * \ingroup Registrations
  */
 
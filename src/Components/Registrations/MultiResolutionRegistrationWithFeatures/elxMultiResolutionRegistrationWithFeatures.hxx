@@ -47,6 +47,12 @@ MultiResolutionRegistrationWithFeatures< TElastix >
   /** Set the fixed image interpolators. */
   this->GetAndSetFixedImageInterpolators();
 
+  /** Limit the memory of the pyramids that are computed concurrently. */
+  double memoryBudget = 0.0;
+  this->m_Configuration->ReadParameter( memoryBudget, "MemoryBudget", 0, false );
+  this->SetMaximumPyramidMemorySize(
+    static_cast< itk::SizeValueType >( memoryBudget * 1024.0 * 1024.0 ) );
+
 }   // end BeforeRegistration()
 
 
@@ -98,7 +104,8 @@ MultiResolutionRegistrationWithFeatures< TElastix >
   /** Set the fixed images. */
   for( unsigned int i = 0; i < this->GetElastix()->GetNumberOfFixedImages(); ++i )
   {
-    this->SetFixedImage( this->GetElastix()->GetFixedImage( i ), i );
+    this->SetFixedImage( this->GenerateCroppedFixedImage(
+      this->GetElastix()->GetFixedImage( i ), this->GetElastix()->GetFixedMask() ), i );
   }
 
   /** Set the moving images. */
@@ -181,8 +188,12 @@ MultiResolutionRegistrationWithFeatures< TElastix >
       throw excp;
     }
 
-    /** Set the fixed image region. */
-    this->SetFixedImageRegion( this->GetElastix()->GetFixedImage( i )->GetBufferedRegion(), i );
+    /** Set the fixed image region. This is the cropped region, if the fixed image was
+     * cropped to the fixed mask in GetAndSetComponents(), restricted to the block that
+     * is registered, if the fixed image is decomposed into blocks. */
+    this->SetFixedImageRegion( this->GenerateFixedImageBlockRegion(
+      this->GetElastix()->GetFixedImage( i ),
+      this->GetFixedImage( i )->GetBufferedRegion() ), i );
   }
 
 }   // end GetAndSetFixedImageRegions()
@@ -65,6 +65,13 @@ namespace itk
  * ImageToImageMetric, but a regularizer for example (which does
  * not need an image.
  *
+ * The pyramids of all inputs are computed concurrently, as tasks on the
+ * PersistentThreadPool. The pyramids are processed in batches, such that
+ * the estimated memory of a batch stays below the MaximumPyramidMemorySize.
+ * Pyramids that compute only the current level, see
+ * GenericMultiResolutionPyramidImageFilter::SetComputeOnlyForCurrentLevel(),
+ * compute each level when its resolution starts, so that levels that are
+ * never reached are never computed.
  *
  * \sa ImageRegistrationMethod
  * \sa MultiResolutionImageRegistrationMethod
@@ -233,6 +240,12 @@ public:
   /** Get a metric that takes multiple inputs. */
   itkGetObjectMacro( MultiInputMetric, MultiInputMetricType );
 
+  /** Set/Get the maximum memory, in bytes, of the pyramids that are computed
+   * concurrently. Zero means no limit, which is the default.
+   */
+  itkSetMacro( MaximumPyramidMemorySize, SizeValueType );
+  itkGetConstMacro( MaximumPyramidMemorySize, SizeValueType );
+
   /** Method to return the latest modified time of this object or
    * any of its cached ivars.
    */
@@ -271,6 +284,12 @@ protected:
   /** Function called by Initialize, which checks if the user input is ok. */
   virtual void CheckOnInitialize( void ) throw ( ExceptionObject );
 
+  /** Update all fixed and moving pyramids, concurrently. Called by
+   * PreparePyramids, and by Initialize for the pyramids that compute only
+   * the current level; up to date pyramids are not recomputed.
+   */
+  virtual void UpdatePyramids( void );
+
   /** Containers for the pointers supplied by the user */
   FixedImageVectorType             m_FixedImages;
   MovingImageVectorType            m_MovingImages;
@@ -292,6 +311,20 @@ private:
   void operator=( const Self & );                                       // purposely not implemented
 
   MultiInputMetricPointer m_MultiInputMetric;
+  SizeValueType           m_MaximumPyramidMemorySize;
+
+  /** Estimate the memory allocated by an update of the pyramid: its input,
+   * for the temporary images, and all its output levels.
+   */
+  template< class TPyramid >
+  static SizeValueType EstimatePyramidMemorySize( TPyramid * pyramid );
+
+  /** The pyramids to update, passed to the threads of UpdatePyramids. */
+  typedef std::vector< ProcessObject * > PyramidTaskContainerType;
+
+  /** Update the pyramids in [begin, end). */
+  static void UpdatePyramidsRange( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
 
 };
 
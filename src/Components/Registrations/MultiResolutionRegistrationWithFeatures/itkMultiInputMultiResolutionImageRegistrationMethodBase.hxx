@@ -21,7 +21,9 @@
 #include "itkMultiInputMultiResolutionImageRegistrationMethodBase.h"
 
 #include "itkContinuousIndex.h"
+#include "itkPersistentThreadPool.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
 
 /** macro that implements the Set methods */
 #define itkImplementationSetMacro( _name, _type ) \
@@ -79,7 +81,10 @@ itkImplementationSetMacro2( FixedImageInterpolator, FixedImageInterpolatorType *
 template< typename TFixedImage, typename TMovingImage >
 MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
 ::MultiInputMultiResolutionImageRegistrationMethodBase()
-{}  // end Constructor()
+{
+  this->m_MaximumPyramidMemorySize = 0;
+
+}  // end Constructor()
 
 /**
  * **************** GetFixedImage **********************************
@@ -272,6 +277,9 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
   /** Sanity checks. */
   this->CheckOnInitialize();
 
+  /** Compute the current level of the pyramids that compute one level at a time. */
+  this->UpdatePyramids();
+
   /** Setup the metric: the transform. */
   this->GetMultiInputMetric()->SetTransform( this->GetTransform() );
 
@@ -339,22 +347,24 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
   /** Check some assumptions. */
   this->CheckPyramids();
 
-  /** Setup the moving image pyramids. */
+  /** Setup the moving image pyramids. The inputs are grafted on images that
+   * are disconnected from their pipeline, so that the pyramids can be updated
+   * concurrently, also when they share an input. Only the output information
+   * is computed here; the pyramids are updated by UpdatePyramids().
+   */
   for( unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i )
   {
     MovingImagePyramidPointer movpyr = this->GetMovingImagePyramid( i );
     if( movpyr.IsNotNull() )
     {
       movpyr->SetNumberOfLevels( this->GetNumberOfLevels() );
-      if( this->GetNumberOfMovingImages() > 1 )
-      {
-        movpyr->SetInput( this->GetMovingImage( i ) );
-      }
-      else
-      {
-        movpyr->SetInput( this->GetMovingImage() );
-      }
-      movpyr->UpdateLargestPossibleRegion();
+      const MovingImageType * movingImage = this->GetNumberOfMovingImages() > 1
+        ? this->GetMovingImage( i ) : this->GetMovingImage();
+      const_cast< MovingImageType * >( movingImage )->Update();
+      typename MovingImageType::Pointer movingInput = MovingImageType::New();
+      movingInput->Graft( movingImage );
+      movpyr->SetInput( movingInput );
+      movpyr->UpdateOutputInformation();
     }
   }
 
@@ -372,15 +382,13 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
     if( fixpyr.IsNotNull() )
     {
       fixpyr->SetNumberOfLevels( this->GetNumberOfLevels() );
-      if( this->GetNumberOfFixedImages() > 1 )
-      {
-        fixpyr->SetInput( this->GetFixedImage( i ) );
-      }
-      else
-      {
-        fixpyr->SetInput( this->GetFixedImage() );
-      }
-      fixpyr->UpdateLargestPossibleRegion();
+      const FixedImageType * fixedImage = this->GetNumberOfFixedImages() > 1
+        ? this->GetFixedImage( i ) : this->GetFixedImage();
+      const_cast< FixedImageType * >( fixedImage )->Update();
+      typename FixedImageType::Pointer fixedInput = FixedImageType::New();
+      fixedInput->Graft( fixedImage );
+      fixpyr->SetInput( fixedInput );
+      fixpyr->UpdateOutputInformation();
 
       /** Setup the fixed image region pyramid. */
       ScheduleType schedule = fixpyr->GetSchedule();
@@ -453,9 +461,116 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
 
   }   // end for loop over fixed pyramids
 
+  /** Compute the pyramids. */
+  this->UpdatePyramids();
+
 }   // end PreparePyramids()
 
 
+/*
+ * ****************** UpdatePyramids ******************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
+::UpdatePyramids( void )
+{
+  /** Collect the distinct pyramids, with their estimated memory. */
+  PyramidTaskContainerType     pyramids;
+  std::vector< SizeValueType > memorySizes;
+  for( unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i )
+  {
+    FixedImagePyramidType * fixpyr = this->GetFixedImagePyramid( i );
+    if( fixpyr != 0 && std::find( pyramids.begin(), pyramids.end(), fixpyr ) == pyramids.end() )
+    {
+      pyramids.push_back( fixpyr );
+      memorySizes.push_back( EstimatePyramidMemorySize( fixpyr ) );
+    }
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i )
+  {
+    MovingImagePyramidType * movpyr = this->GetMovingImagePyramid( i );
+    if( movpyr != 0 && std::find( pyramids.begin(), pyramids.end(), movpyr ) == pyramids.end() )
+    {
+      pyramids.push_back( movpyr );
+      memorySizes.push_back( EstimatePyramidMemorySize( movpyr ) );
+    }
+  }
+
+  /** Update the pyramids in batches that fit in the memory limit; a
+   * pyramid that does not fit by itself gets its own batch.
+   */
+  PersistentThreadPool::Pointer pool = PersistentThreadPool::GetInstance();
+  std::size_t                   begin = 0;
+  while( begin < pyramids.size() )
+  {
+    std::size_t   end       = begin + 1;
+    SizeValueType batchSize = memorySizes[ begin ];
+    while( end < pyramids.size() && ( this->m_MaximumPyramidMemorySize == 0
+      || batchSize + memorySizes[ end ] <= this->m_MaximumPyramidMemorySize ) )
+    {
+      batchSize += memorySizes[ end ];
+      ++end;
+    }
+
+    PyramidTaskContainerType batch( pyramids.begin() + begin, pyramids.begin() + end );
+    pool->ParallelFor( batch.size(), 1, UpdatePyramidsRange, &batch );
+    begin = end;
+  }
+
+}   // end UpdatePyramids()
+
+
+/*
+ * ****************** UpdatePyramidsRange ******************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+void
+MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
+::UpdatePyramidsRange( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  PyramidTaskContainerType & pyramids = *static_cast< PyramidTaskContainerType * >( userData );
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    pyramids[ p ]->UpdateLargestPossibleRegion();
+  }
+
+}   // end UpdatePyramidsRange()
+
+
+/*
+ * ****************** EstimatePyramidMemorySize ******************
+ */
+
+template< typename TFixedImage, typename TMovingImage >
+template< class TPyramid >
+SizeValueType
+MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage >
+::EstimatePyramidMemorySize( TPyramid * pyramid )
+{
+  typedef typename TPyramid::InputImageType  InputImageType;
+  typedef typename TPyramid::OutputImageType OutputImageType;
+
+  SizeValueType memorySize = 0;
+  if( pyramid->GetInput() != 0 )
+  {
+    memorySize += pyramid->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels()
+      * sizeof( typename InputImageType::PixelType );
+  }
+  for( unsigned int level = 0; level < pyramid->GetNumberOfLevels(); ++level )
+  {
+    memorySize += pyramid->GetOutput( level )->GetLargestPossibleRegion().GetNumberOfPixels()
+      * sizeof( typename OutputImageType::PixelType );
+  }
+
+  return memorySize;
+
+}   // end EstimatePyramidMemorySize()
+
+
 /*
  * ********************* GenerateData ***********************
  */
@@ -500,6 +615,15 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
       break;
     }
 
+    // Skip the levels before the first level; their initial parameters
+    // are passed on to the next level.
+    if( currentLevel < this->GetFirstLevel() )
+    {
+      this->m_LastTransformParameters = this->GetInitialTransformParametersOfNextLevel();
+      this->GetTransform()->SetParameters( this->m_LastTransformParameters );
+      continue;
+    }
+
     try
     {
       // initialize the interconnects between components
@@ -762,6 +886,9 @@ MultiInputMultiResolutionImageRegistrationMethodBase< TFixedImage, TMovingImage
   }
   os << "]" << std::endl;
 
+  os << indent << "MaximumPyramidMemorySize: "
+     << this->m_MaximumPyramidMemorySize << std::endl;
+
   /** Print all moving image interpolators. */
   os << indent << "Interpolators: [ ";
   for( unsigned int i = 0; i < this->GetNumberOfInterpolators(); ++i )
@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 
 namespace elastix
 {
@@ -41,7 +42,9 @@ namespace elastix
  *    example: <tt>(FinalBSplineInterpolationOrder 3) </tt> \n
  *    Default: 3.
  *
- * With very large images, memory problems may be avoided by using the BSplineResampleInterpolatorFloat.
+ * With very large images, memory problems may be avoided by using the BSplineResampleInterpolatorFloat,
+ * or by building elastix with ELASTIX_USE_FLOAT_INTERNALS, which stores the coefficients of this
+ * interpolator in single precision as well.
  * The differences of the result are generally negligible.
  * If you are really in memory problems, you may use the LinearResampleInterpolator,
  * or the NearestNeighborResampleInterpolator.
@@ -56,7 +59,7 @@ class BSplineResampleInterpolator :
   itk::BSplineInterpolateImageFunction<
   typename ResampleInterpolatorBase< TElastix >::InputImageType,
   typename ResampleInterpolatorBase< TElastix >::CoordRepType,
-  double >,   //CoefficientType
+  itk::InternalBufferRealType >, //CoefficientType
   public ResampleInterpolatorBase< TElastix >
 {
 public:
@@ -66,7 +69,7 @@ public:
   typedef itk::BSplineInterpolateImageFunction<
     typename ResampleInterpolatorBase< TElastix >::InputImageType,
     typename ResampleInterpolatorBase< TElastix >::CoordRepType,
-    double >                                    Superclass1;
+    itk::InternalBufferRealType >              Superclass1;
   typedef ResampleInterpolatorBase< TElastix > Superclass2;
   typedef itk::SmartPointer< Self >            Pointer;
   typedef itk::SmartPointer< const Self >      ConstPointer;
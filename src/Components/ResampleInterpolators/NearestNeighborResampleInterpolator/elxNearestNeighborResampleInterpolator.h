@@ -33,6 +33,11 @@ namespace elastix
 * this resample interpolator if memory burden is an issue and nearest neighbor interpolation
 * is sufficient.
 *
+* To resample label images, e.g. segmentations, set the
+* MovingInternalImagePixelType and the ResultImagePixelType to an integer type,
+* and (CacheMappedCoordinates "true"), see the ResamplerBase. The labels are
+* then copied from the nearest voxel, without a conversion to floating point.
+*
 * The parameters used in this class are:
 * \parameter ResampleInterpolator: Select this resample interpolator as follows:\n
 *   <tt>(ResampleInterpolator "FinalNearestNeighborInterpolator")</tt>
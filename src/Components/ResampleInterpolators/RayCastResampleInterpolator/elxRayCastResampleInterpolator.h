@@ -31,6 +31,12 @@ namespace elastix
  * \class RayCastResampleInterpolator
  * \brief An interpolator based on ...
  *
+ * The parameters used in this class are:
+ * \parameter UseEmptySpaceSkipping: Whether the rays skip blocks of voxels that are all at or
+ *    below the Threshold, without interpolating. \n
+ *    example: <tt>(UseEmptySpaceSkipping "true")</tt> \n
+ *    The default value is "false".
+ *
  * \ingroup Interpolators
  */
 
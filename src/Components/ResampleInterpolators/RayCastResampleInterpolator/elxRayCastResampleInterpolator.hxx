@@ -90,6 +90,10 @@ RayCastResampleInterpolator< TElastix >
   this->GetConfiguration()->ReadParameter( threshold, "Threshold", 0 );
   this->SetThreshold( threshold );
 
+  bool useEmptySpaceSkipping = false;
+  this->GetConfiguration()->ReadParameter( useEmptySpaceSkipping, "UseEmptySpaceSkipping", 0 );
+  this->SetUseEmptySpaceSkipping( useEmptySpaceSkipping );
+
 } // end InitializeRayCastInterpolator()
 
 
@@ -189,6 +193,9 @@ RayCastResampleInterpolator< TElastix >
   xout[ "transpar" ] << "(Threshold "
                      << threshold << ")" << std::endl;
 
+  xout[ "transpar" ] << "(UseEmptySpaceSkipping \""
+                     << ( this->GetUseEmptySpaceSkipping() ? "true" : "false" ) << "\")" << std::endl;
+
 }   // end WriteToFile()
 
 
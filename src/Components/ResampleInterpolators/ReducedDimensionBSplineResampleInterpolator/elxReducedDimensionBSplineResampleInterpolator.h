@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
+#include "itkInternalBufferRealType.h"
 
 namespace elastix
 {
@@ -56,7 +57,7 @@ class ReducedDimensionBSplineResampleInterpolator :
   itk::ReducedDimensionBSplineInterpolateImageFunction<
   typename ResampleInterpolatorBase< TElastix >::InputImageType,
   typename ResampleInterpolatorBase< TElastix >::CoordRepType,
-  double >,   //CoefficientType
+  itk::InternalBufferRealType >, //CoefficientType
   public ResampleInterpolatorBase< TElastix >
 {
 public:
@@ -66,7 +67,7 @@ public:
   typedef itk::BSplineInterpolateImageFunction<
     typename ResampleInterpolatorBase< TElastix >::InputImageType,
     typename ResampleInterpolatorBase< TElastix >::CoordRepType,
-    double >                                    Superclass1;
+    itk::InternalBufferRealType >              Superclass1;
   typedef ResampleInterpolatorBase< TElastix > Superclass2;
   typedef itk::SmartPointer< Self >            Pointer;
   typedef itk::SmartPointer< const Self >      ConstPointer;
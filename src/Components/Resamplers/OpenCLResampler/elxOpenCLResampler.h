@@ -31,11 +31,33 @@ namespace elastix
 /**
  * \class OpenCLResampler
  * \brief A resampler based on the itk::GPUResampleImageFilter.
+ *
+ * The nearest neighbor, linear and B-spline resample interpolators are supported,
+ * as well as the RayCastResampleInterpolator, which generates the DRR on the GPU.
+ *
  * The parameters used in this class are:
  * \parameter Resampler: Select this resampler as follows:\n
  *    <tt>(Resampler "OpenCLResampler")</tt>
  * \parameter Resampler: Enable the OpenCL resampler as follows:\n
  *    <tt>(OpenCLResamplerUseOpenCL "true")</tt>
+ * \parameter OpenCLResamplerUseTiledExecution: Resample 3D images in slabs,
+ *    copying only the part of the input that a slab needs to the device. This
+ *    is done anyway when the input or the output does not fit in the device
+ *    memory. Not used for the RayCastResampleInterpolator. \n
+ *    example: <tt>(OpenCLResamplerUseTiledExecution "true")</tt> \n
+ *    The default value is "false".
+ * \parameter OpenCLResamplerUseHardwareInterpolation: Evaluate the linear
+ *    interpolator by the texture sampler of the device, which is faster, but
+ *    computes the interpolation weights with a reduced precision of about 8
+ *    bits. Only used for 2D and 3D images, devices that support images, and
+ *    when the image is not resampled in tiles. \n
+ *    example: <tt>(OpenCLResamplerUseHardwareInterpolation "true")</tt> \n
+ *    The default value is "false".
+ * \parameter OpenCLResamplerHardwareInterpolationPrecision: The precision in
+ *    which the input image is stored for the hardware interpolation, "float"
+ *    or "half". Half precision halves the device memory of the input image. \n
+ *    example: <tt>(OpenCLResamplerHardwareInterpolationPrecision "half")</tt> \n
+ *    The default value is "float".
  *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
@@ -166,6 +188,9 @@ private:
   /** Helper method to report to elastix log. */
   void ReportToLog( void );
 
+  /** Returns true if the input and the output fit in the device memory. */
+  bool ImagesFitInDeviceMemory( void ) const;
+
   TransformCopierPointer   m_TransformCopier;
   InterpolateCopierPointer m_InterpolatorCopier;
   GPUResamplerPointer      m_GPUResampler;
@@ -173,6 +198,9 @@ private:
   bool                     m_GPUResamplerCreated;
   bool                     m_ContextCreated;
   bool                     m_UseOpenCL;
+  bool                     m_UseTiledExecution;
+  bool                     m_UseHardwareInterpolation;
+  std::string              m_HardwareInterpolationPrecision;
 };
 
 // end class OpenCLResampler
@@ -71,8 +71,12 @@ elastix::OpenCLResampler< TElastix >
     this->SwitchingToCPUAndReport( false );
   }
 
-  this->m_UseOpenCL    = true;
-  this->m_ShowProgress = false;
+  this->m_UseOpenCL         = true;
+  this->m_UseTiledExecution = false;
+  this->m_ShowProgress      = false;
+
+  this->m_UseHardwareInterpolation       = false;
+  this->m_HardwareInterpolationPrecision = "float";
 
 } // end Constructor
 
@@ -165,21 +169,9 @@ OpenCLResampler< TElastix >
 
   if( this->m_GPUResamplerReady )
   {
-    // Create GPU input image
-    try
-    {
-      gpuInputImage = GPUInputImageType::New();
-      gpuInputImage->GraftITKImage( this->GetInput() );
-      gpuInputImage->AllocateGPU();
-      gpuInputImage->GetGPUDataManager()->SetCPUBufferLock( true );
-      gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag( true );
-      gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
-    }
-    catch( itk::ExceptionObject & e )
-    {
-      xl::xout[ "error" ] << "ERROR: Exception during creating GPU input image: " << e << std::endl;
-      this->SwitchingToCPUAndReport( true );
-    }
+    // Create GPU input image, it is copied to the device below
+    gpuInputImage = GPUInputImageType::New();
+    gpuInputImage->GraftITKImage( this->GetInput() );
   }
 
   if( this->m_GPUResamplerReady )
@@ -220,6 +212,40 @@ OpenCLResampler< TElastix >
       this->SwitchingToCPUAndReport( true );
     }
   }
+
+  if( this->m_GPUResamplerReady )
+  {
+    // Resample in tiles if requested, or if the images do not fit on the
+    // device. Otherwise copy the whole input image to the device.
+    this->m_GPUResampler->SetUseTiledExecution(
+      this->m_UseTiledExecution || !this->ImagesFitInDeviceMemory() );
+    this->m_GPUResampler->SetUseHardwareInterpolation( this->m_UseHardwareInterpolation );
+    this->m_GPUResampler->SetUseHalfPrecisionTexture( this->m_HardwareInterpolationPrecision == "half" );
+    if( this->m_GPUResampler->IsTiledExecution() )
+    {
+      elxout << "  The OpenCLResampler resamples the image in tiles." << std::endl;
+    }
+    else if( this->m_GPUResampler->IsHardwareInterpolation() )
+    {
+      // The input image is copied to a texture by the GPU resampler
+      elxout << "  The OpenCLResampler interpolates the image with the texture sampler." << std::endl;
+    }
+    else
+    {
+      try
+      {
+        gpuInputImage->AllocateGPU();
+        gpuInputImage->GetGPUDataManager()->SetCPUBufferLock( true );
+        gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag( true );
+        gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+      }
+      catch( itk::ExceptionObject & e )
+      {
+        xl::xout[ "error" ] << "ERROR: Exception during creating GPU input image: " << e << std::endl;
+        this->SwitchingToCPUAndReport( true );
+      }
+    }
+  }
 } // end BeforeGenerateData()
 
 
@@ -275,6 +301,18 @@ OpenCLResampler< TElastix >
   this->m_UseOpenCL = true;
   this->m_Configuration->ReadParameter( this->m_UseOpenCL, "OpenCLResamplerUseOpenCL", 0, false );
 
+  // Are we resampling in tiles?
+  this->m_UseTiledExecution = false;
+  this->m_Configuration->ReadParameter( this->m_UseTiledExecution, "OpenCLResamplerUseTiledExecution", 0, false );
+
+  // Are we interpolating with the texture sampler?
+  this->m_UseHardwareInterpolation = false;
+  this->m_Configuration->ReadParameter( this->m_UseHardwareInterpolation,
+    "OpenCLResamplerUseHardwareInterpolation", 0, false );
+  this->m_HardwareInterpolationPrecision = "float";
+  this->m_Configuration->ReadParameter( this->m_HardwareInterpolationPrecision,
+    "OpenCLResamplerHardwareInterpolationPrecision", 0, false );
+
 } // end BeforeRegistration()
 
 
@@ -293,6 +331,16 @@ OpenCLResampler< TElastix >
   // OpenCL resampler specific.
   this->m_UseOpenCL = true;
   this->m_Configuration->ReadParameter( this->m_UseOpenCL, "OpenCLResamplerUseOpenCL", 0 );
+  this->m_UseTiledExecution = false;
+  this->m_Configuration->ReadParameter( this->m_UseTiledExecution, "OpenCLResamplerUseTiledExecution", 0, false );
+
+  // Are we interpolating with the texture sampler?
+  this->m_UseHardwareInterpolation = false;
+  this->m_Configuration->ReadParameter( this->m_UseHardwareInterpolation,
+    "OpenCLResamplerUseHardwareInterpolation", 0, false );
+  this->m_HardwareInterpolationPrecision = "float";
+  this->m_Configuration->ReadParameter( this->m_HardwareInterpolationPrecision,
+    "OpenCLResamplerHardwareInterpolationPrecision", 0, false );
 
 } // end ReadFromFile()
 
@@ -317,6 +365,21 @@ OpenCLResampler< TElastix >
   if( this->m_UseOpenCL ) { useOpenCL = "true"; }
   xout[ "transpar" ] << "(OpenCLResamplerUseOpenCL \"" << useOpenCL << "\")" << std::endl;
 
+  // Write OpenCLResamplerUseTiledExecution.
+  std::string useTiledExecution = "false";
+  if( this->m_UseTiledExecution ) { useTiledExecution = "true"; }
+  xout[ "transpar" ] << "(OpenCLResamplerUseTiledExecution \"" << useTiledExecution << "\")" << std::endl;
+
+  // Write OpenCLResamplerUseHardwareInterpolation.
+  std::string useHardwareInterpolation = "false";
+  if( this->m_UseHardwareInterpolation ) { useHardwareInterpolation = "true"; }
+  xout[ "transpar" ] << "(OpenCLResamplerUseHardwareInterpolation \""
+                     << useHardwareInterpolation << "\")" << std::endl;
+
+  // Write OpenCLResamplerHardwareInterpolationPrecision.
+  xout[ "transpar" ] << "(OpenCLResamplerHardwareInterpolationPrecision \""
+                     << this->m_HardwareInterpolationPrecision << "\")" << std::endl;
+
 } // end WriteToFile()
 
 
@@ -360,6 +423,33 @@ OpenCLResampler< TElastix >
 } // end ReportToLog()
 
 
+/**
+ * ************************* ImagesFitInDeviceMemory ************************
+ */
+
+template< class TElastix >
+bool
+OpenCLResampler< TElastix >
+::ImagesFitInDeviceMemory( void ) const
+{
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  itk::OpenCLDevice           device  = context->GetDefaultDevice();
+
+  double numberOfOutputPixels = 1.0;
+  for( unsigned int i = 0; i < OutputImageType::ImageDimension; ++i )
+  {
+    numberOfOutputPixels *= static_cast< double >( this->GetSize()[ i ] );
+  }
+  const double inputSize = static_cast< double >( this->GetInput()->GetBufferedRegion().GetNumberOfPixels() )
+    * sizeof( InputImagePixelType );
+  const double outputSize    = numberOfOutputPixels * sizeof( OutputImagePixelType );
+  const double maxAllocation = static_cast< double >( device.GetMaximumAllocationSize() );
+
+  return inputSize <= maxAllocation && outputSize <= maxAllocation
+         && inputSize + outputSize <= static_cast< double >( device.GetGlobalMemorySize() );
+} // end ImagesFitInDeviceMemory()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxOpenCLResampler_hxx
@@ -62,6 +62,11 @@ namespace elastix
  *    transform. Should be one of {GeometricalCenter, CenterOfGravity, Origins, GeometryTop}.\n
  *    example: <tt>(AutomaticTransformInitializationMethod "CenterOfGravity")</tt> \n
  *    By default "GeometricalCenter" is assumed.\n
+ * \parameter NumberOfSamplesForCenterOfGravityCalculation: the maximum number of
+ *    voxels per image used by the CenterOfGravity method. The images are then
+ *    sampled on a regular grid. 0 means all voxels.\n
+ *    example: <tt>(NumberOfSamplesForCenterOfGravityCalculation 100000)</tt> \n
+ *    By default 0 is assumed.\n
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
  * \transformparameter CenterOfRotation: stores the center of rotation as an index. \n
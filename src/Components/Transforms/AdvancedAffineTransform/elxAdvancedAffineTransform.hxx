@@ -217,8 +217,7 @@ AdvancedAffineTransformElastix< TElastix >
   bool CORPointInImage = true;
   if( centerGivenAsIndex )
   {
-    CORIndexInImage =  this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->GetLargestPossibleRegion().IsInside(
+    CORIndexInImage =  this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().IsInside(
       centerOfRotationIndex );
   }
 
@@ -226,8 +225,7 @@ AdvancedAffineTransformElastix< TElastix >
   {
     typedef itk::ContinuousIndex< double, SpaceDimension > ContinuousIndexType;
     ContinuousIndexType cindex;
-    CORPointInImage = this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
+    CORPointInImage = this->GetElastix()->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
       centerOfRotationPoint, cindex );
   }
 
@@ -271,7 +269,7 @@ AdvancedAffineTransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetFixedImageMask(
@@ -291,6 +289,11 @@ AdvancedAffineTransformElastix< TElastix >
     if( method == "CenterOfGravity" )
     {
       transformInitializer->MomentsOn();
+
+      unsigned long numberOfSamples = 0;
+      this->m_Configuration->ReadParameter( numberOfSamples,
+        "NumberOfSamplesForCenterOfGravityCalculation", 0 );
+      transformInitializer->SetNumberOfSamplesForCenterOfGravity( numberOfSamples );
     }
     else if( method == "Origins" )
     {
@@ -326,7 +329,7 @@ AdvancedAffineTransformElastix< TElastix >
     if( centerGivenAsIndex )
     {
       /** Convert from index-value to physical-point-value. */
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+      this->GetElastix()->GetFixedImage()
       ->TransformIndexToPhysicalPoint(
         centerOfRotationIndex, centerOfRotationPoint );
     }
@@ -37,7 +37,7 @@
 #include "itkObject.h"
 #include "itkObjectFactory.h"
 #include "itkSpatialObject.h"
-#include "itkImageMomentsCalculator.h"
+#include "itkImageCenterOfGravityCalculator.h"
 
 #include <iostream>
 
@@ -66,7 +66,10 @@ namespace itk
  * centers.
  *
  * In the second mode, the moments of gray level values are computed
- * for both images. The center of mass of the moving image is then
+ * for both images, within the masks if they are set. The moments are
+ * computed by a threaded ImageCenterOfGravityCalculator, which visits at
+ * most NumberOfSamplesForCenterOfGravity voxels of each image (0, the
+ * default, visits all voxels). The center of mass of the moving image is then
  * used as center of rotation. The vector between the two centers of
  * mass is passes as the initial translation to the transform. This
  * second approach assumes that the moments of the anatomical objects
@@ -128,9 +131,9 @@ public:
   typedef typename MovingImageMaskType::ConstPointer   MovingImageMaskPointer;
 
   /** Moment calculators */
-  typedef ImageMomentsCalculator< FixedImageType >
+  typedef ImageCenterOfGravityCalculator< FixedImageType >
     FixedImageCalculatorType;
-  typedef ImageMomentsCalculator< MovingImageType >
+  typedef ImageCenterOfGravityCalculator< MovingImageType >
     MovingImageCalculatorType;
 
   typedef typename FixedImageCalculatorType::Pointer
@@ -170,6 +173,12 @@ public:
   void OriginsOn()     { m_UseMoments = false; m_UseOrigins = true; m_UseTop = false; }
   void GeometryTopOn() { m_UseMoments = false; m_UseOrigins = false; m_UseTop = true; }
 
+  /** Set/Get the maximum number of voxels per image used for the center of
+   * gravity. The default, 0, uses all voxels.
+   */
+  itkSetMacro( NumberOfSamplesForCenterOfGravity, SizeValueType );
+  itkGetConstMacro( NumberOfSamplesForCenterOfGravity, SizeValueType );
+
   /** Get() access to the moments calculators */
   itkGetConstObjectMacro( FixedCalculator,  FixedImageCalculatorType  );
   itkGetConstObjectMacro( MovingCalculator, MovingImageCalculatorType );
@@ -199,6 +208,8 @@ private:
   bool m_UseOrigins;
   bool m_UseTop;
 
+  SizeValueType m_NumberOfSamplesForCenterOfGravity;
+
   FixedImageCalculatorPointer  m_FixedCalculator;
   MovingImageCalculatorPointer m_MovingCalculator;
 
@@ -49,6 +49,8 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
   m_UseMoments       = false;
   m_UseOrigins       = false;
   m_UseTop           = false;
+
+  m_NumberOfSamplesForCenterOfGravity = 0;
 }
 
 
@@ -93,28 +95,15 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
 
   if( m_UseMoments )
   {
-    // Convert the masks to spatial objects
-    typename FixedMaskSpatialObjectType::Pointer fixedMaskAsSpatialObject = 0;
-    if( this->m_FixedImageMask )
-    {
-      fixedMaskAsSpatialObject = FixedMaskSpatialObjectType::New();
-      fixedMaskAsSpatialObject->SetImage( this->m_FixedImageMask );
-    }
-
-    typename MovingMaskSpatialObjectType::Pointer movingMaskAsSpatialObject = 0;
-    if( this->m_MovingImageMask )
-    {
-      movingMaskAsSpatialObject = MovingMaskSpatialObjectType::New();
-      movingMaskAsSpatialObject->SetImage( this->m_MovingImageMask );
-    }
-
     // Moments
     m_FixedCalculator->SetImage(  m_FixedImage );
-    m_FixedCalculator->SetSpatialObjectMask( fixedMaskAsSpatialObject );
+    m_FixedCalculator->SetMask( m_FixedImageMask );
+    m_FixedCalculator->SetMaximumNumberOfSamples( m_NumberOfSamplesForCenterOfGravity );
     m_FixedCalculator->Compute();
 
     m_MovingCalculator->SetImage( m_MovingImage );
-    m_MovingCalculator->SetSpatialObjectMask( movingMaskAsSpatialObject );
+    m_MovingCalculator->SetMask( m_MovingImageMask );
+    m_MovingCalculator->SetMaximumNumberOfSamples( m_NumberOfSamplesForCenterOfGravity );
     m_MovingCalculator->Compute();
 
     typename FixedImageCalculatorType::VectorType fixedCenter = m_FixedCalculator->GetCenterOfGravity();
@@ -369,6 +358,9 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
     os << indent << "None" << std::endl;
   }
 
+  os << indent << "NumberOfSamplesForCenterOfGravity   = "
+     << m_NumberOfSamplesForCenterOfGravity << std::endl;
+
   os << indent << "MovingMomentCalculator   = " << std::endl;
   if( m_UseMoments && m_MovingCalculator )
   {
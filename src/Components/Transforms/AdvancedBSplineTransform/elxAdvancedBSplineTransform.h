@@ -41,6 +41,13 @@ namespace elastix
  * \parameter BSplineTransformSplineOrder: choose a B-spline order 1,2, or 3. \n
  *    example: <tt>(BSplineTransformSplineOrder 3)</tt>\n
  *    Default value: 3 (cubic B-splines).
+ *    The order may also be specified for each resolution, to use the cheaper
+ *    lower-order weights in the early resolutions: \n
+ *    example: <tt>(BSplineTransformSplineOrder 1 1 3 3)</tt>\n
+ *    When the order changes, the deformation of the previous resolution is
+ *    transferred to the new order, on the grid of the new resolution. Combine
+ *    it with <tt>(BSplineInterpolationOrder 1 1 3 3)</tt> for a linear
+ *    interpolator in the same resolutions.
  * \parameter FinalGridSpacingInVoxels: the grid spacing of the B-spline transform for each dimension. \n
  *    example: <tt>(FinalGridSpacingInVoxels 8.0 8.0 8.0)</tt> \n
  *    If only one argument is given, that factor is used for each dimension. The spacing
@@ -268,6 +275,15 @@ public:
    */
   virtual void IncreaseScale( void );
 
+  /** Method to change the B-spline order of the transform.
+   * \li Create the B-spline transform and grid schedule of the new order.
+   * \li Determine the B-spline coefficients of the new order that describe the current
+   * deformation field on the new grid, see IncreaseScale().
+   * Called by BeforeEachResolution(), if the BSplineTransformSplineOrder of the
+   * current resolution differs from that of the previous one.
+   */
+  virtual void ChangeSplineOrder( const unsigned int splineOrder );
+
   /** Function to read transform-parameters from a file. */
   virtual void ReadFromFile( void );
 
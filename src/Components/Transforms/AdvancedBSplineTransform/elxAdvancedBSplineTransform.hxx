@@ -201,8 +201,21 @@ AdvancedBSplineTransform< TElastix >
   }
   else
   {
-    /** Upsample the B-spline grid, if required. */
-    this->IncreaseScale();
+    /** Check if the spline order changes in this resolution. */
+    unsigned int splineOrder = this->m_SplineOrder;
+    this->GetConfiguration()->ReadParameter( splineOrder,
+      "BSplineTransformSplineOrder", this->GetComponentLabel(), level, 0, false );
+
+    if( splineOrder != this->m_SplineOrder )
+    {
+      /** Transfer the deformation to the new order and grid. */
+      this->ChangeSplineOrder( splineOrder );
+    }
+    else
+    {
+      /** Upsample the B-spline grid, if required. */
+      this->IncreaseScale();
+    }
   }
 
   /** Get the PassiveEdgeWidth and use it to set the OptimizerScales. */
@@ -478,6 +491,55 @@ AdvancedBSplineTransform< TElastix >
 }  // end IncreaseScale()
 
 
+/**
+ * *********************** ChangeSplineOrder ************************
+ */
+
+template< class TElastix >
+void
+AdvancedBSplineTransform< TElastix >
+::ChangeSplineOrder( const unsigned int splineOrder )
+{
+  /** Remember the current grid and order. */
+  const OriginType    currentGridOrigin    = this->m_BSplineTransform->GetGridOrigin();
+  const SpacingType   currentGridSpacing   = this->m_BSplineTransform->GetGridSpacing();
+  const RegionType    currentGridRegion    = this->m_BSplineTransform->GetGridRegion();
+  const DirectionType currentGridDirection = this->m_BSplineTransform->GetGridDirection();
+  const unsigned int  currentSplineOrder   = this->m_SplineOrder;
+
+  /** Create the transform and grid schedule of the new order. The grid
+   * schedule depends on the order, via the support region of the B-splines.
+   */
+  this->m_SplineOrder = splineOrder;
+  if( this->InitializeBSplineTransform() != 0 )
+  {
+    itkExceptionMacro( << "ERROR: Changing the B-spline order to "
+                       << splineOrder << " failed." );
+  }
+  this->PreComputeGridInformation();
+
+  /** The new transform starts from the current grid, so that IncreaseScale()
+   * reads it. The parameters are set by IncreaseScale().
+   */
+  this->m_BSplineTransform->SetGridOrigin( currentGridOrigin );
+  this->m_BSplineTransform->SetGridSpacing( currentGridSpacing );
+  this->m_BSplineTransform->SetGridRegion( currentGridRegion );
+  this->m_BSplineTransform->SetGridDirection( currentGridDirection );
+
+  /** Evaluate the current deformation with the current order, and decompose
+   * it with the new order, on the grid of this resolution.
+   */
+  this->m_GridUpsampler->SetBSplineOrder( currentSplineOrder );
+  this->m_GridUpsampler->SetRequiredBSplineOrder( splineOrder );
+  this->IncreaseScale();
+  this->m_GridUpsampler->SetBSplineOrder( splineOrder );
+
+  elxout << "  The B-spline order is changed from " << currentSplineOrder
+         << " to " << splineOrder << "." << std::endl;
+
+} // end ChangeSplineOrder()
+
+
 /**
  * ************************* ReadFromFile ************************
  */
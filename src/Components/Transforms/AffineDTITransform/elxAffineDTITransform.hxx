@@ -194,8 +194,7 @@ AffineDTITransformElastix< TElastix >
   bool CORPointInImage = true;
   if( centerGivenAsIndex )
   {
-    CORIndexInImage =  this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->GetLargestPossibleRegion().IsInside(
+    CORIndexInImage =  this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().IsInside(
       centerOfRotationIndex );
   }
 
@@ -203,8 +202,7 @@ AffineDTITransformElastix< TElastix >
   {
     typedef itk::ContinuousIndex< double, SpaceDimension > ContinuousIndexType;
     ContinuousIndexType cindex;
-    CORPointInImage = this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
+    CORPointInImage = this->GetElastix()->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
       centerOfRotationPoint, cindex );
   }
 
@@ -250,7 +248,7 @@ AffineDTITransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetTransform( this->m_AffineDTITransform );
@@ -284,7 +282,7 @@ AffineDTITransformElastix< TElastix >
     if( centerGivenAsIndex )
     {
       /** Convert from index-value to physical-point-value. */
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+      this->GetElastix()->GetFixedImage()
         ->TransformIndexToPhysicalPoint(
         centerOfRotationIndex, centerOfRotationPoint );
     }
@@ -231,6 +231,31 @@ AffineDTI2DTransform< TScalarType >
 }
 
 
+// Get the Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AffineDTI2DTransform< TScalarType >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Compute g^T * dA/dmu * (p-c) */
+  const InputVectorType pp = p - this->GetCenter();
+  this->EvaluateMatrixJacobianWithImageGradientProduct(
+    pp, movingImageGradient, imageJacobian, 0, 5 );
+
+  // the translation columns are unit vectors
+  for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    imageJacobian[ 5 + dim ] = movingImageGradient[ dim ];
+  }
+
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Precompute Jacobian of Spatial Jacobian
 template< class TScalarType >
 void
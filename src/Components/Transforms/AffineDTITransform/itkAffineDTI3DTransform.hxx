@@ -283,6 +283,31 @@ AffineDTI3DTransform< TScalarType >
 }
 
 
+// Get the Jacobian multiplied by the moving image gradient
+template< class TScalarType >
+void
+AffineDTI3DTransform< TScalarType >
+::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Compute g^T * dA/dmu * (p-c) */
+  const InputVectorType pp = p - this->GetCenter();
+  this->EvaluateMatrixJacobianWithImageGradientProduct(
+    pp, movingImageGradient, imageJacobian, 0, 9 );
+
+  // the translation columns are unit vectors
+  for( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    imageJacobian[ 9 + dim ] = movingImageGradient[ dim ];
+  }
+
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Precompute Jacobian of Spatial Jacobian
 template< class TScalarType >
 void
@@ -295,7 +295,7 @@ AffineLogStackTransform< TElastix >
       centerOfRotationIndex[ k ] = ( fixedImageSize[ k ] - 1.0 ) / 2.0;
     }
     /** Convert from continuous index to physical point */
-    this->m_Registration->GetAsITKBaseType()->GetFixedImage()->
+    this->GetElastix()->GetFixedImage()->
       TransformContinuousIndexToPhysicalPoint( centerOfRotationIndex, TransformedCenterOfRotation );
 
     for( unsigned int k = 0; k < ReducedSpaceDimension; k++ )
@@ -313,7 +313,7 @@ AffineLogStackTransform< TElastix >
   }
   if( centerGivenAsIndex )
   {
-    this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+    this->GetElastix()->GetFixedImage()
       ->TransformContinuousIndexToPhysicalPoint(
       centerOfRotationIndex, TransformedCenterOfRotation );
     for( unsigned int k = 0; k < ReducedSpaceDimension; k++ )
@@ -196,8 +196,7 @@ AffineLogTransformElastix< TElastix >
   bool CORPointInImage = true;
   if( centerGivenAsIndex )
   {
-    CORIndexInImage =  this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->GetLargestPossibleRegion().IsInside(
+    CORIndexInImage =  this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().IsInside(
       centerOfRotationIndex );
   }
 
@@ -205,8 +204,7 @@ AffineLogTransformElastix< TElastix >
   {
     typedef itk::ContinuousIndex< double, SpaceDimension > ContinuousIndexType;
     ContinuousIndexType cindex;
-    CORPointInImage = this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
+    CORPointInImage = this->GetElastix()->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
       centerOfRotationPoint, cindex );
   }
 
@@ -252,7 +250,7 @@ AffineLogTransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetTransform( this->m_AffineLogTransform );
@@ -286,7 +284,7 @@ AffineLogTransformElastix< TElastix >
     if( centerGivenAsIndex )
     {
       /** Convert from index-value to physical-point-value. */
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+      this->GetElastix()->GetFixedImage()
       ->TransformIndexToPhysicalPoint(
         centerOfRotationIndex, centerOfRotationPoint );
     }
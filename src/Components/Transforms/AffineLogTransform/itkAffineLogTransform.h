@@ -81,6 +81,8 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
 
   typedef FixedArray< ScalarType > ScalarArrayType;
 
@@ -94,6 +96,15 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly, without constructing the Jacobian.
+   */
+  virtual void EvaluateJacobianWithImageGradientProduct(
+    const InputPointType & ipp,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   virtual void SetIdentity( void );
 
 protected:
@@ -111,6 +122,11 @@ protected:
   /** Update the m_JacobianOfSpatialJacobian.  */
   virtual void PrecomputeJacobianOfSpatialJacobian( void );
 
+  /** Compute the exponential of m_MatrixLogDomain, and store its derivatives
+   * with respect to the parameters in m_JacobianOfSpatialJacobian.
+   */
+  void ComputeExponentialAndDerivatives( MatrixType & exponentMatrix );
+
 private:
 
   AffineLogTransform( const Self & ); // purposely not implemented
@@ -18,10 +18,12 @@
 #ifndef __itkAffineLogTransform_hxx
 #define __itkAffineLogTransform_hxx
 
-#include "vnl/vnl_matrix_exp.h"
 #include "itkMath.h"
 #include "itkAffineLogTransform.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -87,9 +89,10 @@ AffineLogTransform< TScalarType, Dimension >
     }
   }
 
-  exponentMatrix = vnl_matrix_exp( this->m_MatrixLogDomain.GetVnlMatrix() );
-
-  this->PrecomputeJacobianOfSpatialJacobian();
+  /** The exponential and its derivatives are computed together, so that
+   * GetJacobian() and friends only read the precomputed derivatives.
+   */
+  this->ComputeExponentialAndDerivatives( exponentMatrix );
 
   this->SetVarMatrix( exponentMatrix );
 
@@ -185,80 +188,193 @@ AffineLogTransform< TScalarType, Dimension >::GetJacobian( const InputPointType
 }
 
 
+//Get Jacobian multiplied by the moving image gradient
+template< class TScalarType, unsigned int Dimension >
+void
+AffineLogTransform< TScalarType, Dimension >::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType & p,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  /** Compute g^T * dA/dmu * (p-c) */
+  const InputVectorType pp = p - this->GetCenter();
+  this->EvaluateMatrixJacobianWithImageGradientProduct(
+    pp, movingImageGradient, imageJacobian, 0, Dimension * Dimension );
+
+  // compute derivatives for the translation part
+  for( unsigned int dim = 0; dim < Dimension; dim++ )
+  {
+    imageJacobian[ Dimension * Dimension + dim ] = movingImageGradient[ dim ];
+  }
+
+  nzji = this->m_NonZeroJacobianIndices;
+}
+
+
 // Precompute Jacobian of Spatial Jacobian
 template< class TScalarType, unsigned int Dimension >
 void
 AffineLogTransform< TScalarType, Dimension >
 ::PrecomputeJacobianOfSpatialJacobian( void )
 {
-  unsigned int d = Dimension;
+  MatrixType exponentMatrix;
+  this->ComputeExponentialAndDerivatives( exponentMatrix );
+}
 
-  /** The Jacobian of spatial Jacobian is constant over inputspace, so is precomputed */
-  JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
 
-  jsj.resize( ParametersDimension );
+// Compute the exponential and its derivatives
+template< class TScalarType, unsigned int Dimension >
+void
+AffineLogTransform< TScalarType, Dimension >
+::ComputeExponentialAndDerivatives( MatrixType & exponentMatrix )
+{
+  /** The exponential is approximated with a [6/6] Pade approximant of the
+   * log-domain matrix A, scaled by 2^s such that its norm is at most 1/2,
+   * followed by s squarings (Moler and Van Loan). The derivative in the
+   * direction E, i.e. the Frechet derivative L(A,E), is obtained by
+   * differentiating every step of that computation, and is exactly the
+   * top-right block of exp([A E; 0 A]) that was computed before.
+   * The directions are the unit matrices E_ij of the d*d parameters.
+   */
+  typedef vnl_matrix_fixed< double, Dimension, Dimension > FixedMatrixType;
+  const unsigned int q = 6;
+
+  FixedMatrixType A;
+  double          norm = 0.0;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    double rowSum = 0.0;
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      A( i, j ) = this->m_MatrixLogDomain( i, j );
+      rowSum   += vcl_abs( A( i, j ) );
+    }
+    norm = std::max( norm, rowSum );
+  }
 
-  vnl_matrix< ScalarType > dA( d, d );
+  unsigned int squarings = 0;
+  if( norm > 0.5 )
+  {
+    squarings = static_cast< unsigned int >( vcl_ceil( vcl_log( norm / 0.5 ) / vcl_log( 2.0 ) ) );
+  }
+  const double scale = std::ldexp( 1.0, -static_cast< int >( squarings ) );
+
+  /** Powers of the scaled matrix, and the Pade numerator P and denominator Q. */
+  FixedMatrixType identity;
+  identity.set_identity();
+  FixedMatrixType powers[ q + 1 ];
+  powers[ 0 ] = identity;
+  powers[ 1 ] = A * scale;
+  for( unsigned int k = 2; k <= q; ++k )
+  {
+    powers[ k ] = powers[ k - 1 ] * powers[ 1 ];
+  }
 
-  vnl_matrix< ScalarType > dummymatrix( d, d );
+  double coefficients[ q + 1 ];
+  coefficients[ 0 ] = 1.0;
+  for( unsigned int k = 1; k <= q; ++k )
+  {
+    coefficients[ k ] = coefficients[ k - 1 ] * ( q - k + 1 ) / ( k * ( 2 * q - k + 1 ) );
+  }
 
-  vnl_matrix< ScalarType > A_bar( 2 * d, 2 * d );
+  FixedMatrixType P = identity;
+  FixedMatrixType Q = identity;
+  for( unsigned int k = 1; k <= q; ++k )
+  {
+    const double sign = ( k % 2 == 0 ) ? 1.0 : -1.0;
+    P += powers[ k ] * coefficients[ k ];
+    Q += powers[ k ] * ( sign * coefficients[ k ] );
+  }
 
-  vnl_matrix< ScalarType > B_bar( 2 * d, 2 * d );
+  /** Invert Q by Gauss-Jordan elimination with partial pivoting. Q is well
+   * conditioned, because the norm of the scaled matrix is at most 1/2.
+   */
+  FixedMatrixType Qinv = identity;
+  for( unsigned int c = 0; c < Dimension; ++c )
+  {
+    unsigned int pivot = c;
+    for( unsigned int r = c + 1; r < Dimension; ++r )
+    {
+      if( vcl_abs( Q( r, c ) ) > vcl_abs( Q( pivot, c ) ) ) { pivot = r; }
+    }
+    for( unsigned int k = 0; k < Dimension; ++k )
+    {
+      std::swap( Q( c, k ), Q( pivot, k ) );
+      std::swap( Qinv( c, k ), Qinv( pivot, k ) );
+    }
+    const double factor = 1.0 / Q( c, c );
+    Q.scale_row( c, factor );
+    Qinv.scale_row( c, factor );
+    for( unsigned int r = 0; r < Dimension; ++r )
+    {
+      const double f = Q( r, c );
+      if( r == c || f == 0.0 ) { continue; }
+      for( unsigned int k = 0; k < Dimension; ++k )
+      {
+        Q( r, k )    -= f * Q( c, k );
+        Qinv( r, k ) -= f * Qinv( c, k );
+      }
+    }
+  }
 
-  dA.fill( itk::NumericTraits< ScalarType >::Zero );
-  dummymatrix.fill( itk::NumericTraits< ScalarType >::Zero );
-  A_bar.fill( itk::NumericTraits< ScalarType >::Zero );
+  FixedMatrixType R = Qinv * P;
 
-  // Fill A_bar top left and bottom right with A
-  for( unsigned int k = 0; k < d; k++ )
+  /** The derivatives of the approximant: with M_k = L(X^k, E), which follows
+   * from M_k = M_{k-1} X + X^{k-1} E, we have L(P) = sum c_k M_k, and
+   * L(Q^-1 P) = Q^-1 ( L(P) - L(Q) Q^-1 P ).
+   */
+  FixedMatrixType derivatives[ Dimension * Dimension ];
+  for( unsigned int par = 0; par < Dimension * Dimension; ++par )
   {
-    for( unsigned int l = 0; l < d; l++ )
+    FixedMatrixType E( 0.0 );
+    E( par / Dimension, par % Dimension ) = scale;
+
+    FixedMatrixType M  = E;
+    FixedMatrixType LP = M * coefficients[ 1 ];
+    FixedMatrixType LQ = M * ( -coefficients[ 1 ] );
+    for( unsigned int k = 2; k <= q; ++k )
     {
-      A_bar( k, l ) = this->m_MatrixLogDomain( k, l );
+      const double sign = ( k % 2 == 0 ) ? 1.0 : -1.0;
+      M   = M * powers[ 1 ] + powers[ k - 1 ] * E;
+      LP += M * coefficients[ k ];
+      LQ += M * ( sign * coefficients[ k ] );
     }
+    derivatives[ par ] = Qinv * ( LP - LQ * R );
   }
-  for( unsigned int k = d; k < 2 * d; k++ )
+
+  /** Undo the scaling: L(R^2) = R L(R) + L(R) R. */
+  for( unsigned int s = 0; s < squarings; ++s )
   {
-    for( unsigned int l = d; l < 2 * d; l++ )
+    for( unsigned int par = 0; par < Dimension * Dimension; ++par )
     {
-      A_bar( k, l ) = this->m_MatrixLogDomain( k - d, l - d );
+      derivatives[ par ] = R * derivatives[ par ] + derivatives[ par ] * R;
     }
+    R = R * R;
   }
 
-  unsigned int m = 0; //Dummy loop index
-
-  //Non-translation derivatives
-  for( unsigned int i = 0; i < d; i++ )
+  /** Store the results. The translation parameters do not change the matrix. */
+  JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
+  jsj.resize( ParametersDimension );
+  for( unsigned int par = 0; par < ParametersDimension; ++par )
   {
-    for( unsigned int j = 0; j < d; j++ )
+    jsj[ par ].Fill( itk::NumericTraits< ScalarType >::Zero );
+    if( par >= Dimension * Dimension ) { continue; }
+    for( unsigned int i = 0; i < Dimension; ++i )
     {
-      dA( i, j ) = 1;
-      for( unsigned int k = 0; k < d; k++ )
-      {
-        for( unsigned int l = d; l < 2 * d; l++ )
-        {
-          A_bar( k, l ) = dA( k, ( l - d ) );
-        }
-      }
-      B_bar = vnl_matrix_exp( A_bar );
-      for( unsigned int k = 0; k < d; k++ )
+      for( unsigned int j = 0; j < Dimension; ++j )
       {
-        for( unsigned int l = d; l < 2 * d; l++ )
-        {
-          dummymatrix( k, ( l - d ) ) = B_bar( k, l );
-        }
+        jsj[ par ]( i, j ) = static_cast< ScalarType >( derivatives[ par ]( i, j ) );
       }
-      jsj[ m ] = dummymatrix;
-      dA.fill( itk::NumericTraits< ScalarType >::Zero );
-      m += 1;
     }
   }
 
-  /** Translation parameters: */
-  for( unsigned int par = d * d; par < ParametersDimension; ++par )
+  for( unsigned int i = 0; i < Dimension; ++i )
   {
-    jsj[ par ].Fill( itk::NumericTraits< ScalarType >::Zero );
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      exponentMatrix( i, j ) = static_cast< ScalarType >( R( i, j ) );
+    }
   }
 
 }
@@ -411,6 +411,21 @@ private:
    */
   BSplineTransformPointer m_BSplineTransform;
 
+  /** The data for computing the deformation field in parallel. */
+  struct DeformationFieldStruct
+  {
+    const Self *     m_Transform;
+    DummyImageType * m_DummyImage;
+    VectorType *     m_DeformationField;
+  };
+
+  /** Thread pool range function that computes the deformation field
+   * over the pixels [begin, end).
+   */
+  static void DeformationFieldRangeFunction( void * userData,
+    itk::ThreadIdType participantId,
+    itk::SizeValueType begin, itk::SizeValueType end );
+
 };
 
 } // end namespace elastix
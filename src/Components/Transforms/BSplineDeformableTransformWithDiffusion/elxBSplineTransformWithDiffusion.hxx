@@ -620,7 +620,7 @@ BSplineTransformWithDiffusion< TElastix >
   /** Get the fixed image. */
   typename FixedImageType::Pointer fixedimage;
   fixedimage = const_cast< FixedImageType * >(
-    this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+    this->GetElastix()->GetFixedImage() );
 
   /** Get the size etc. of this image. */
 
@@ -716,7 +716,7 @@ BSplineTransformWithDiffusion< TElastix >
   /** Get the fixed image. */
   typename FixedImageType::Pointer fixedimage;
   fixedimage = const_cast< FixedImageType * >(
-    this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+    this->GetElastix()->GetFixedImage() );
 
   /** Set start values for computing the new grid size. */
   RegionType  gridregionHigh  = fixedimage->GetLargestPossibleRegion();
@@ -1146,35 +1146,17 @@ BSplineTransformWithDiffusion< TElastix >
   dummyImage->SetOrigin( this->m_DeformationOrigin );
   dummyImage->SetSpacing( this->m_DeformationSpacing );
 
-  /** Setup an iterator over dummyImage and outputImage. */
-  DummyIteratorType       iter( dummyImage, this->m_DeformationRegion );
-  VectorImageIteratorType iterout( this->m_DeformationField, this->m_DeformationRegion );
-
-  /** Declare stuff. */
-  InputPointType  inputPoint;
-  OutputPointType outputPoint;
-  VectorType      diff_point;
-  IndexType       inputIndex;
-
-  /** Calculate the TransformPoint of all voxels of the image. */
-  iter.GoToBegin();
-  iterout.GoToBegin();
-  while( !iter.IsAtEnd() )
-  {
-    inputIndex = iter.GetIndex();
-    /** Transform the points to physical space. */
-    dummyImage->TransformIndexToPhysicalPoint( inputIndex, inputPoint );
-    /** Call TransformPoint. */
-    outputPoint = this->TransformPoint( inputPoint );
-    /** Calculate the difference. */
-    for( unsigned int i = 0; i < this->FixedImageDimension; i++ )
-    {
-      diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
-    }
-    iterout.Set( diff_point );
-    ++iter;
-    ++iterout;
-  }
+  /** Calculate the TransformPoint of all voxels of the image, in parallel.
+   * The deformation field is allocated with m_DeformationRegion, so its
+   * buffer is indexed like the dummy image.
+   */
+  DeformationFieldStruct deformationFieldStruct;
+  deformationFieldStruct.m_Transform        = this;
+  deformationFieldStruct.m_DummyImage       = dummyImage.GetPointer();
+  deformationFieldStruct.m_DeformationField = this->m_DeformationField->GetBufferPointer();
+  itk::PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_DeformationRegion.GetNumberOfPixels(), 0,
+    DeformationFieldRangeFunction, &deformationFieldStruct );
 
   /** ------------- 2: Update the intermediary deformationFieldTransform. ------------- */
 
@@ -1444,6 +1426,44 @@ BSplineTransformWithDiffusion< TElastix >
 } // end DiffuseDeformationField()
 
 
+/**
+ * ************* DeformationFieldRangeFunction ***************
+ */
+
+template< class TElastix >
+void
+BSplineTransformWithDiffusion< TElastix >
+::DeformationFieldRangeFunction( void * userData,
+  itk::ThreadIdType itkNotUsed( participantId ),
+  itk::SizeValueType begin, itk::SizeValueType end )
+{
+  const DeformationFieldStruct & data
+    = *static_cast< const DeformationFieldStruct * >( userData );
+
+  /** Declare stuff. */
+  InputPointType  inputPoint;
+  OutputPointType outputPoint;
+  VectorType      diff_point;
+  IndexType       inputIndex;
+
+  for( itk::SizeValueType p = begin; p < end; ++p )
+  {
+    /** Transform the points to physical space. */
+    inputIndex = data.m_DummyImage->ComputeIndex( static_cast< itk::OffsetValueType >( p ) );
+    data.m_DummyImage->TransformIndexToPhysicalPoint( inputIndex, inputPoint );
+    /** Call TransformPoint. */
+    outputPoint = data.m_Transform->TransformPoint( inputPoint );
+    /** Calculate the difference. */
+    for( unsigned int i = 0; i < SpaceDimension; i++ )
+    {
+      diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
+    }
+    data.m_DeformationField[ p ] = diff_point;
+  }
+
+} // end DeformationFieldRangeFunction()
+
+
 /**
  * ******************* TransformPoint ******************
  */
@@ -25,6 +25,9 @@
 #include "itkNumericTraits.h"
 
 #include "itkRescaleIntensityImageFilter.h"
+#include "itkPersistentThreadPool.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -37,6 +40,15 @@ namespace itk
  *
  * A mean filter is one of the family of linear filters.
  *
+ * The weighted mean over the box shaped neighbourhood, SUM_i{ c_i * x_i } /
+ * SUM_i{ c_i }, is computed as the ratio of two separable box sums. Both are
+ * computed with running sums, one dimension after the other, so the cost per
+ * pixel does not depend on the radius. The box sum of the stiffness coefficients
+ * does not change during the iterations, and is therefore computed only once.
+ * The passes are distributed over the threads of the PersistentThreadPool.
+ * Outside the image the nearest pixel value is used, like with the
+ * ZeroFluxNeumannBoundaryCondition.
+ *
  * \sa Image
  * \sa Neighborhood
  * \sa NeighborhoodOperator
@@ -127,16 +139,8 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
-  /** MeanImageFilter can be implemented as a multithreaded filter.
-   * Therefore, this implementation provides a ThreadedGenerateData()
-   * routine which is called for each processing thread. The output
-   * image data is allocated automatically by the superclass prior to
-   * calling ThreadedGenerateData().  ThreadedGenerateData can only
-   * write to the portion of the output image specified by the
-   * parameter "outputRegionForThread"
-   *
-   * \sa ImageToImageFilter::ThreadedGenerateData(),
-   *     ImageToImageFilter::GenerateData().
+  /** Performs all iterations. Every iteration needs the complete result of
+   * the previous one, so multi-threading is done within the iterations.
    */
   void GenerateData( void );
 
@@ -158,6 +162,47 @@ private:
   /** For calculating a feature image from the input m_GrayValueImage. */
   void FilterGrayValueImage( void );
 
+  /** The data of a box sum pass along one dimension. The buffer contains
+   * m_NumberOfComponents interleaved values per pixel, and is summed in place.
+   */
+  struct BoxSumPassType
+  {
+    /** The number of neighbouring lines processed together. */
+    enum { StripWidth = 16 };
+
+    double *      m_Data;
+    SizeValueType m_NumberOfComponents;
+    SizeValueType m_LineLength;
+    SizeValueType m_InnerSize;
+    SizeValueType m_NumberOfStrips;
+    SizeValueType m_Radius;
+  };
+
+  /** The data of the pixel wise steps of an iteration. */
+  struct IterationType
+  {
+    const double *   m_Cx;
+    const double *   m_SumCx;
+    double *         m_Work;
+    InputPixelType * m_Output;
+  };
+
+  /** Replace every value in the buffer by its box sum over all dimensions. */
+  void ComputeBoxSums( double * data, const SizeValueType numberOfComponents,
+    const InputSizeType & size ) const;
+
+  /** Thread pool range functions. The box sum function processes strips of
+   * lines, the others pixels.
+   */
+  static void BoxSumRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  static void WeightRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  static void UpdateRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
 };
 
 } // end namespace itk
@@ -21,11 +21,10 @@
 
 #include "itkVectorMeanDiffusionImageFilter.h"
 
-#include "itkNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
-#include "itkZeroFluxNeumannBoundaryCondition.h"
-#include "itkProgressReporter.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -115,30 +114,12 @@ void
 VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
 ::GenerateData( void )
 {
-  // \todo to avoid all the copying we can create a vector of
-  // outputs of size this->GetNumberOfIterations(). The last
-  // output should point to this->GetOutput(). In order to avoid
-  // a big memory footprint, at some iteration k, memory of the
-  // former iteration should be released: output[ k - 1 ] = 0,
-  // and memory of the current iteration should only now be created:
-  // output[ k ] = InputImageType::New(); ...; output[ k ]->Allocate().
-  // Only for the last iteration: output[ k ]( this->GetOutput() ).
-
   /** Create feature image. */
   this->FilterGrayValueImage();
 
-  /** Declare things. */
-  unsigned int                                        i, j;
-  ZeroFluxNeumannBoundaryCondition< InputImageType >  nbc;
-  ZeroFluxNeumannBoundaryCondition< DoubleImageType > nbc2;
-  NeighborhoodIterator< InputImageType >              nit;
-  NeighborhoodIterator< DoubleImageType >             nit2;
-  VectorRealType                                      sum;
-
   /** Allocate output. */
   typename InputImageType::ConstPointer input( this->GetInput() );
   typename InputImageType::Pointer      output( this->GetOutput() );
-  typename InputImageType::Pointer outputtmp = InputImageType::New();
   output->SetRegions( input->GetLargestPossibleRegion() );
 
   try
@@ -155,28 +136,6 @@ VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
     throw excp;
   }
 
-  /** Allocate a temporary output image. */
-  outputtmp->SetSpacing( input->GetSpacing() );
-  outputtmp->SetOrigin( input->GetOrigin() );
-  outputtmp->SetRegions( input->GetLargestPossibleRegion() );
-
-  try
-  {
-    outputtmp->Allocate();
-  }
-  catch( itk::ExceptionObject & excp )
-  {
-    /** Add information to the exception and throw again. */
-    excp.SetLocation( "VectorMeanDiffusionImageFilter - GenerateData()" );
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while allocating a temporary copy.\n";
-    excp.SetDescription( err_str );
-    throw excp;
-  }
-
-  // support progress methods/callbacks
-  //ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
-
   /** Copy input to output. */
   ImageRegionConstIterator< InputImageType > in_it(
   input, input->GetLargestPossibleRegion() );
@@ -191,115 +150,203 @@ VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
     ++out_it;
   }
 
-  /** Setup neighborhood iterator for the output deformation image. */
-  nit = NeighborhoodIterator< InputImageType >(
-    this->m_Radius, output, output->GetLargestPossibleRegion() );
-  unsigned int neighborhoodSize = nit.Size();
-  nit.OverrideBoundaryCondition( &nbc );
+  if( this->GetNumberOfIterations() == 0 ) { return; }
 
-  /** Setup neighborhood iterator for the "stiffness coefficient" image. */
-  nit2 = NeighborhoodIterator< DoubleImageType >(
-    this->m_Radius, this->m_Cx, this->m_Cx->GetLargestPossibleRegion() );
-  nit2.OverrideBoundaryCondition( &nbc2 );
+  /** The stiffness coefficients should cover the same grid. */
+  const InputImageRegionType & region = output->GetBufferedRegion();
+  if( this->m_Cx->GetBufferedRegion().GetSize() != region.GetSize() )
+  {
+    itkExceptionMacro( << "The grayValue image and the input image should have the same size." );
+  }
+  const InputSizeType size           = region.GetSize();
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
 
-  /** Setup iterator over outputtmp. */
-  ImageRegionIterator< InputImageType > oit(
-  outputtmp, input->GetLargestPossibleRegion() );
+  /** The box sums of the stiffness coefficients, SUM_i{ c_i }, are the same
+   * for all iterations.
+   */
+  const double *        cx = this->m_Cx->GetBufferPointer();
+  std::vector< double > sumCx( cx, cx + numberOfPixels );
+  this->ComputeBoxSums( &sumCx[ 0 ], 1, size );
 
-  /** Initialize c and ci. */
-  double c  = 0.0;
-  double ci = 0.0;
+  /** Setup the pixel wise steps. */
+  std::vector< double > work( numberOfPixels * InputImageDimension );
+  IterationType         iteration;
+  iteration.m_Cx     = cx;
+  iteration.m_SumCx  = &sumCx[ 0 ];
+  iteration.m_Work   = &work[ 0 ];
+  iteration.m_Output = output->GetBufferPointer();
+
+  PersistentThreadPool::Pointer threadPool = PersistentThreadPool::GetInstance();
 
   /** Loop over the number of iterations. */
   for( unsigned int k = 0; k < this->GetNumberOfIterations(); k++ )
   {
-    /** Reset the iterators. */
-    nit.GoToBegin();
-    nit2.GoToBegin();
-    oit.GoToBegin();
+    /** Compute c_i * x_i, and its box sums SUM_i{ c_i * x_i }. */
+    threadPool->ParallelFor( numberOfPixels, 0, WeightRangeFunction, &iteration );
+    this->ComputeBoxSums( &work[ 0 ], InputImageDimension, size );
+
+    /** Set 'y = (1 - c) * x + c * mean'. The box sums contain everything that
+     * is needed from the neighbours, so the output can be updated in place.
+     */
+    threadPool->ParallelFor( numberOfPixels, 0, UpdateRangeFunction, &iteration );
+
+  } // end for NumberOfIterations
+
+} // end GenerateData()
+
+
+/**
+ * ********************** ComputeBoxSums **************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::ComputeBoxSums( double * data, const SizeValueType numberOfComponents,
+  const InputSizeType & size ) const
+{
+  BoxSumPassType pass;
+  pass.m_Data               = data;
+  pass.m_NumberOfComponents = numberOfComponents;
+  pass.m_InnerSize          = 1;
+
+  SizeValueType numberOfPixels = 1;
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    numberOfPixels *= size[ d ];
+  }
+
+  for( unsigned int d = 0; d < InputImageDimension; ++d )
+  {
+    pass.m_LineLength     = size[ d ];
+    pass.m_Radius         = this->m_Radius[ d ];
+    pass.m_NumberOfStrips = ( pass.m_InnerSize + BoxSumPassType::StripWidth - 1 )
+      / BoxSumPassType::StripWidth;
+
+    const SizeValueType outerSize = numberOfPixels / ( pass.m_InnerSize * size[ d ] );
+    if( pass.m_Radius > 0 && size[ d ] > 0 )
+    {
+      PersistentThreadPool::GetInstance()->ParallelFor(
+        outerSize * pass.m_NumberOfStrips, 0, BoxSumRangeFunction, &pass );
+    }
+
+    pass.m_InnerSize *= size[ d ];
+  }
+
+} // end ComputeBoxSums()
+
+
+/**
+ * ********************** BoxSumRangeFunction **************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::BoxSumRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const BoxSumPassType & pass = *static_cast< const BoxSumPassType * >( userData );
 
-    /** The actual work. */
-    while( !nit.IsAtEnd() )
+  const SizeValueType   n          = pass.m_LineLength;
+  const SizeValueType   r          = pass.m_Radius;
+  const SizeValueType   rowStride  = pass.m_InnerSize * pass.m_NumberOfComponents;
+  const SizeValueType   maxWidth   = BoxSumPassType::StripWidth * pass.m_NumberOfComponents;
+  std::vector< double > prefix( ( n + 2 * r + 1 ) * maxWidth );
+
+  for( SizeValueType item = begin; item < end; ++item )
+  {
+    /** The strip consists of the lines [first, first + width) of a slab. */
+    const SizeValueType outer = item / pass.m_NumberOfStrips;
+    const SizeValueType first = ( item % pass.m_NumberOfStrips ) * BoxSumPassType::StripWidth;
+    const SizeValueType width = std::min( static_cast< SizeValueType >( BoxSumPassType::StripWidth ),
+      pass.m_InnerSize - first ) * pass.m_NumberOfComponents;
+    double * strip = pass.m_Data + outer * n * rowStride + first * pass.m_NumberOfComponents;
+
+    /** Compute the running sums of the rows, padded with the border rows. */
+    std::fill( prefix.begin(), prefix.begin() + width, 0.0 );
+    for( SizeValueType j = 0; j < n + 2 * r; ++j )
     {
-      /** Speed up: do not filter locations where c(x) = 0. */
-      if( nit2.GetCenterPixel() < 0.000001 )
+      const SizeValueType source = j < r ? 0 : std::min( j - r, n - 1 );
+      const double *      row    = strip + source * rowStride;
+      const double *      last   = &prefix[ j * width ];
+      double *            next   = &prefix[ ( j + 1 ) * width ];
+      for( SizeValueType b = 0; b < width; ++b )
       {
-        /** Just copy input to output. */
-        oit.Set( nit.GetCenterPixel() );
+        next[ b ] = last[ b ] + row[ b ];
       }
-      else
-      {
-        /** Initialize the sum to 0. */
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          sum[ j ] = NumericTraits< double >::Zero;
-        }
-
-        /** Initialize sumc. */
-        double sumc = 0.0;
-
-        /** Calculate the weighted mean over the neighborhood.
-         * mean = SUthis->m_i{ ci * x_i } / SUthis->m_i{ ci }
-         */
-        for( i = 0; i < neighborhoodSize; ++i )
-        {
-          /** Get current pixel in this neighborhood. */
-          InputPixelType pix = nit.GetPixel( i );
-
-          /** Get ci-value on current index. */
-          ci = nit2.GetPixel( i );
-
-          /** Calculate SUthis->m_i{ ci } and SUthis->m_i{ ci * x_i }. */
-          sumc += ci;
-          for( j = 0; j < InputImageDimension; j++ )
-          {
-            sum[ j ] += ci * static_cast< double >( pix[ j ] );
-          }
-        }
-
-        /** Get the mean value by dividing by sumc. */
-        InputPixelType mean;
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          if( sumc < 0.00001 ) { mean[ j ] = 0.0; }
-          else { mean[ j ] = static_cast< ValueType >( sum[ j ] / sumc ); }
-        }
-
-        /** Get c. */
-        c = nit2.GetCenterPixel();
-
-        /** Set 'y = (1 - c) * x + c * mean' to the temporary output. */
-        InputPixelType value = nit.GetCenterPixel() * ( 1.0 - c ) + mean * c;
-
-        /** Set it. */
-        oit.Set( value );
-
-      } // end if c < 0.000001
-
-      /** Increase all iterators. */
-      ++nit;
-      ++nit2;
-      ++oit;
-      //progress.CompletedPixel();
-
-    } // end while
-
-    /** Copy outputtmp to output. */
-    if( this->GetNumberOfIterations() > 0 )
+    }
+
+    /** The box sum at row i is the difference of two running sums. */
+    for( SizeValueType i = 0; i < n; ++i )
     {
-      out_it.GoToBegin();
-      oit.GoToBegin();
-      while( !out_it.IsAtEnd() )
+      const double * lower = &prefix[ i * width ];
+      const double * upper = &prefix[ ( i + 2 * r + 1 ) * width ];
+      double *       row   = strip + i * rowStride;
+      for( SizeValueType b = 0; b < width; ++b )
       {
-        out_it.Set( oit.Get() );
-        ++out_it;
-        ++oit;
+        row[ b ] = upper[ b ] - lower[ b ];
       }
-    } // end if GetNumberOfIterations() > 0
+    }
+  }
 
-  } // end for NumberOfIterations
+} // end BoxSumRangeFunction()
 
-} // end GenerateData()
+
+/**
+ * ********************** WeightRangeFunction **************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::WeightRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const IterationType & iteration = *static_cast< const IterationType * >( userData );
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    const double           ci  = iteration.m_Cx[ p ];
+    const InputPixelType & pix = iteration.m_Output[ p ];
+    double *               w   = iteration.m_Work + p * InputImageDimension;
+    for( unsigned int j = 0; j < InputImageDimension; j++ )
+    {
+      w[ j ] = ci * static_cast< double >( pix[ j ] );
+    }
+  }
+
+} // end WeightRangeFunction()
+
+
+/**
+ * ********************** UpdateRangeFunction **************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::UpdateRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const IterationType & iteration = *static_cast< const IterationType * >( userData );
+  for( SizeValueType p = begin; p < end; ++p )
+  {
+    /** Speed up: do not filter locations where c(x) = 0. */
+    const double c = iteration.m_Cx[ p ];
+    if( c < 0.000001 ) { continue; }
+
+    /** Get the mean value by dividing by sumc. */
+    const double     sumc = iteration.m_SumCx[ p ];
+    const double *   sum  = iteration.m_Work + p * InputImageDimension;
+    InputPixelType & pix  = iteration.m_Output[ p ];
+    for( unsigned int j = 0; j < InputImageDimension; j++ )
+    {
+      const double mean = sumc < 0.00001 ? 0.0 : sum[ j ] / sumc;
+      pix[ j ] = static_cast< ValueType >( pix[ j ] * ( 1.0 - c ) + mean * c );
+    }
+  }
+
+} // end UpdateRangeFunction()
 
 
 /**
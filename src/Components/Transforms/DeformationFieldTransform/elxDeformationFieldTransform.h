@@ -43,6 +43,20 @@ namespace elastix
  * \transformparameter DeformationFieldInterpolationOrder: The interpolation order used for interpolating the deformation field:\n
  *    example: <tt>(DeformationFieldInterpolationOrder 0)</tt>\n
  *    The default value is 0. Choose from the allowed values 0 or 1.
+ * \transformparameter DeformationFieldMemoryMapping: Map the deformation field into
+ *    memory instead of reading it. This makes loading almost instantaneous, and lets
+ *    processes that use the same field share its memory. It requires an uncompressed
+ *    MetaImage with float components in the byte order of the machine; .mhd/.raw files
+ *    are preferred, since the data of .mha files may not be aligned. The field is read
+ *    normally when it cannot be mapped.\n
+ *    example: <tt>(DeformationFieldMemoryMapping "true")</tt>\n
+ *    The default value is false.
+ * \transformparameter DeformationFieldPrecision: The precision in which the deformation
+ *    field is kept in memory, "float" or "half". Half precision halves the memory use,
+ *    at a relative precision of about 5e-4 (and a maximum of 65504) of the displacements.
+ *    It does not combine with memory mapping, since the field is converted.\n
+ *    example: <tt>(DeformationFieldPrecision "half")</tt>\n
+ *    The default value is "float".
  *
  *
  * \sa DeformationFieldInterpolatingTransform
@@ -27,6 +27,7 @@
 #include "itkVectorNearestNeighborInterpolateImageFunction.h"
 #include "itkVectorLinearInterpolateImageFunction.h"
 #include "itkChangeInformationImageFilter.h"
+#include "itkMemoryMappedMetaImageReader.h"
 
 namespace elastix
 {
@@ -86,13 +87,50 @@ DeformationFieldTransform< TElastix >::ReadFromFile( void )
     itkExceptionMacro( << "Error while reading transform parameter file!" );
   }
 
+  /** Store the field in half precision if desired. */
+  std::string precision = "float";
+  this->m_Configuration->ReadParameter( precision,
+    "DeformationFieldPrecision", 0, false );
+  if( precision != "float" && precision != "half" )
+  {
+    xl::xout[ "error" ] << "ERROR: DeformationFieldPrecision should be \"float\" or \"half\"." << std::endl;
+    itkExceptionMacro( << "Invalid deformation field precision selected!" );
+  }
+  this->m_DeformationFieldInterpolatingTransform->SetHalfPrecisionStorage( precision == "half" );
+
+  /** Try to map the deformation field into memory, if desired. The reader
+   * falls back to normal reading when the field cannot be mapped.
+   */
+  bool useMemoryMapping = false;
+  this->m_Configuration->ReadParameter( useMemoryMapping,
+    "DeformationFieldMemoryMapping", 0, false );
+
+  typedef itk::MemoryMappedMetaImageReader< DeformationFieldType > MappedReaderType;
+  typename MappedReaderType::Pointer mappedReader = MappedReaderType::New();
+  DeformationFieldType * deformationField = vectorReader->GetOutput();
+  if( useMemoryMapping )
+  {
+    mappedReader->SetFileName( fileName );
+    try
+    {
+      mappedReader->Update();
+      deformationField = mappedReader->GetOutput();
+      elxout << "  The deformation field is memory mapped." << std::endl;
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      elxout << "  The deformation field cannot be memory mapped, it is read instead:\n    "
+             << excp.GetDescription() << std::endl;
+    }
+  }
+
   /** Possibly overrule the direction cosines. */
   ChangeInfoFilterPointer infoChanger = ChangeInfoFilterType::New();
   DirectionType           direction;
   direction.SetIdentity();
   infoChanger->SetOutputDirection( direction );
   infoChanger->SetChangeDirection( !this->GetElastix()->GetUseDirectionCosines() );
-  infoChanger->SetInput( vectorReader->GetOutput() );
+  infoChanger->SetInput( deformationField );
 
   /** Read deformationFieldImage from file. */
   vectorReader->SetFileName( fileName.c_str() );
@@ -113,7 +151,7 @@ DeformationFieldTransform< TElastix >::ReadFromFile( void )
 
   /** Store the original direction for later use */
   this->m_OriginalDeformationFieldDirection
-    = vectorReader->GetOutput()->GetDirection();
+    = deformationField->GetDirection();
 
   /** Set the deformationFieldImage in the
    * itkDeformationFieldInterpolatingTransform.
@@ -209,11 +247,17 @@ DeformationFieldTransform< TElastix >
   xout[ "transpar" ] << "(DeformationFieldInterpolationOrder "
                      <<  interpolationOrder << ")" << std::endl;
 
+  /** Write the precision, if not the default. */
+  if( this->m_DeformationFieldInterpolatingTransform->GetHalfPrecisionStorage() )
+  {
+    xout[ "transpar" ] << "(DeformationFieldPrecision \"half\")" << std::endl;
+  }
+
   /** Possibly change the direction cosines to there original value */
   typename ChangeInfoFilterType::Pointer infoChanger = ChangeInfoFilterType::New();
   infoChanger->SetOutputDirection( this->m_OriginalDeformationFieldDirection );
   infoChanger->SetChangeDirection( !this->GetElastix()->GetUseDirectionCosines() );
-  infoChanger->SetInput( this->m_DeformationFieldInterpolatingTransform->GetDeformationField() );
+  infoChanger->SetInput( this->m_DeformationFieldInterpolatingTransform->GetDecodedDeformationField() );
 
   /** Write the deformation field image. */
   typedef itk::ImageFileWriter< DeformationFieldType > VectorWriterType;
@@ -255,8 +255,7 @@ EulerTransformElastix< TElastix >
   bool CORPointInImage = true;
   if( centerGivenAsIndex )
   {
-    CORIndexInImage =  this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->GetLargestPossibleRegion().IsInside(
+    CORIndexInImage =  this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().IsInside(
       centerOfRotationIndex );
   }
 
@@ -264,8 +263,7 @@ EulerTransformElastix< TElastix >
   {
     typedef itk::ContinuousIndex< double, SpaceDimension > ContinuousIndexType;
     ContinuousIndexType cindex;
-    CORPointInImage = this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
+    CORPointInImage = this->GetElastix()->GetFixedImage()->TransformPhysicalPointToContinuousIndex(
       centerOfRotationPoint, cindex );
   }
 
@@ -311,7 +309,7 @@ EulerTransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetTransform( this->m_EulerTransform );
@@ -345,7 +343,7 @@ EulerTransformElastix< TElastix >
     if( centerGivenAsIndex )
     {
       /** Convert from index-value to physical-point-value. */
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+      this->GetElastix()->GetFixedImage()
       ->TransformIndexToPhysicalPoint(
         centerOfRotationIndex, centerOfRotationPoint );
     }
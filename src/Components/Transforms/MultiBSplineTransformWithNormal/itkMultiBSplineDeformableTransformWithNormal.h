@@ -489,6 +489,8 @@ protected:
   ImageVectorPointer                             m_LabelsNormals;
   std::vector< typename TransformType::Pointer > m_Trans;
   std::vector< ParametersType >                  m_Para;
+  std::vector< typename TransformType::Pointer > m_SumTrans;
+  std::vector< ParametersType >                  m_SumPara;
   mutable int                                    m_LastJacobian;
   ImageBasePointer                               m_LocalBases;
 
@@ -501,6 +503,10 @@ private:
 
   void PointToLabel( const InputPointType & p, int & l ) const;
 
+  /** Compute the local bases of the grid points [begin, end). */
+  static void ComputeLocalBasesRangeFunction( void * userData,
+    ThreadIdType participantId, SizeValueType begin, SizeValueType end );
+
 };
 
 } // end namespace itk
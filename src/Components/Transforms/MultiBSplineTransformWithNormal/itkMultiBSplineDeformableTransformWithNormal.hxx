@@ -25,7 +25,7 @@
 #include "itkVectorCastImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
 #include "itkBinaryThresholdImageFilter.h"
-#include "itkAddImageFilter.h"
+#include "itkPersistentThreadPool.h"
 #include "itkMaskImageFilter.h"
 #include "itkConstantPadImageFilter.h"
 
@@ -168,9 +168,12 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     this->m_NbLabels = stat->GetMaximum() + 1;
     this->m_Trans.resize( this->m_NbLabels + 1 );
     this->m_Para.resize( this->m_NbLabels + 1 );
+    this->m_SumTrans.resize( this->m_NbLabels + 1 );
+    this->m_SumPara.resize( this->m_NbLabels + 1 );
     for( unsigned i = 0; i <= this->m_NbLabels; ++i )
     {
-      this->m_Trans[ i ] = TransformType::New();
+      this->m_Trans[ i ]    = TransformType::New();
+      this->m_SumTrans[ i ] = TransformType::New();
     }
     this->m_LabelsInterpolator = ImageLabelInterpolator::New();
     this->m_LabelsInterpolator->SetInputImage( this->m_Labels );
@@ -185,17 +188,15 @@ struct UpdateLocalBases_impl
 {
   typedef itk::Vector< TScalarType, NDimensions > VectorType;
   typedef itk::Vector< VectorType, NDimensions >  BaseType;
-  typedef itk::Image< VectorType, NDimensions >   ImageVectorType;
-  typedef typename ImageVectorType::Pointer       ImageVectorPointer;
-  typedef itk::Image< BaseType, NDimensions >     ImageBaseType;
-  typedef typename ImageBaseType::Pointer         ImageBasePointer;
 
-  static void Do( ImageBaseType *, ImageVectorType * )
+  static void CheckDimension( void )
   {
     itkGenericExceptionMacro( << "MultiBSplineDeformableTransformWithNormal only works with 3D image for the moment" );
   }
 
 
+  static void ComputeBase( const VectorType *, BaseType & ) {}
+
 };
 
 template< class TScalarType >
@@ -204,56 +205,28 @@ struct UpdateLocalBases_impl< TScalarType, 2 >
   static const unsigned NDimensions = 2;
   typedef itk::Vector< TScalarType, NDimensions > VectorType;
   typedef itk::Vector< VectorType, NDimensions >  BaseType;
-  typedef itk::Image< VectorType, NDimensions >   ImageVectorType;
-  typedef typename ImageVectorType::Pointer       ImageVectorPointer;
-  typedef itk::Image< BaseType, NDimensions >     ImageBaseType;
-  typedef typename ImageBaseType::Pointer         ImageBasePointer;
 
-  static void Do( ImageBaseType * bases, ImageVectorType * normals )
+  static void CheckDimension( void ) {}
+
+  /** Compute the local base of a normalized normal n, or the (x,y) base
+   * if n is NULL.
+   */
+  static void ComputeBase( const VectorType * n, BaseType & b )
   {
     const TScalarType base_x[] = { 1, 0 };
     const TScalarType base_y[] = { 0, 1 };
 
-    typedef itk::NearestNeighborInterpolateImageFunction< ImageVectorType, TScalarType > ImageVectorInterpolator;
-    typedef typename ImageVectorInterpolator::Pointer                                    ImageVectorInterpolatorPointer;
-    ImageVectorInterpolatorPointer vinterp = ImageVectorInterpolator::New();
-    vinterp->SetInputImage( normals );
-
-    typedef ImageRegionIterator< ImageBaseType > IteratorType;
-    IteratorType it( bases, bases->GetLargestPossibleRegion() );
-    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    if( n == 0 )
     {
-      BaseType b;
-      typename ImageBaseType::PointType p;
-      bases->TransformIndexToPhysicalPoint( it.GetIndex(), p );
-      typename ImageBaseType::IndexType idx;
-      vinterp->ConvertPointToNearestIndex( p, idx );
-      if( !vinterp->IsInsideBuffer( idx ) )
-      {
-        // far from an interface keep (x,y,z) base
-        b[ 0 ] = VectorType( base_x );
-        b[ 1 ] = VectorType( base_y );
-        it.Set( b );
-        continue;
-      }
-
-      VectorType n = vinterp->EvaluateAtIndex( idx );
-      n.Normalize();
-      if( n.GetNorm() < 0.1 )
-      {
-        std::cout << "Should never append" << std::endl;
-        // far from an interface keep (x,y,z) base
-        b[ 0 ] = VectorType( base_x );
-        b[ 1 ] = VectorType( base_y );
-        it.Set( b );
-        continue;
-      }
-
-      b[ 0 ]      = n;
-      b[ 1 ][ 0 ] = n[ 1 ];
-      b[ 1 ][ 1 ] = -n[ 0 ];
-      it.Set( b );
+      // far from an interface keep (x,y,z) base
+      b[ 0 ] = VectorType( base_x );
+      b[ 1 ] = VectorType( base_y );
+      return;
     }
+
+    b[ 0 ]      = *n;
+    b[ 1 ][ 0 ] = ( *n )[ 1 ];
+    b[ 1 ][ 1 ] = -( *n )[ 0 ];
   }
 
 
@@ -265,95 +238,115 @@ struct UpdateLocalBases_impl< TScalarType, 3 >
   static const unsigned NDimensions = 3;
   typedef itk::Vector< TScalarType, NDimensions > VectorType;
   typedef itk::Vector< VectorType, NDimensions >  BaseType;
-  typedef itk::Image< VectorType, NDimensions >   ImageVectorType;
-  typedef typename ImageVectorType::Pointer       ImageVectorPointer;
-  typedef itk::Image< BaseType, NDimensions >     ImageBaseType;
-  typedef typename ImageBaseType::Pointer         ImageBasePointer;
 
-  static void Do( ImageBaseType * bases, ImageVectorType * normals )
+  static void CheckDimension( void ) {}
+
+  /** Compute the local base of a normalized normal n, or the (x,y,z) base
+   * if n is NULL.
+   */
+  static void ComputeBase( const VectorType * n, BaseType & b )
   {
     const TScalarType base_x[] = { 1, 0, 0 };
     const TScalarType base_y[] = { 0, 1, 0 };
     const TScalarType base_z[] = { 0, 0, 1 };
 
-    typedef itk::NearestNeighborInterpolateImageFunction< ImageVectorType, TScalarType > ImageVectorInterpolator;
-    typedef typename ImageVectorInterpolator::Pointer                                    ImageVectorInterpolatorPointer;
-    ImageVectorInterpolatorPointer vinterp = ImageVectorInterpolator::New();
-    vinterp->SetInputImage( normals );
+    if( n == 0 )
+    {
+      // far from an interface keep (x,y,z) base
+      b[ 0 ] = VectorType( base_x );
+      b[ 1 ] = VectorType( base_y );
+      b[ 2 ] = VectorType( base_z );
+      return;
+    }
 
-    typedef ImageRegionIterator< ImageBaseType > IteratorType;
-    IteratorType it( bases, bases->GetLargestPossibleRegion() );
-    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    b[ 0 ] = *n;
+
+    // find the must non colinear to vector wrt n
+    VectorType tmp;
+    if( std::abs( ( *n )[ 0 ] ) < std::abs( ( *n )[ 1 ] ) )
     {
-      BaseType b;
-      typename ImageBaseType::PointType p;
-      bases->TransformIndexToPhysicalPoint( it.GetIndex(), p );
-      typename ImageBaseType::IndexType idx;
-      vinterp->ConvertPointToNearestIndex( p, idx );
-      if( !vinterp->IsInsideBuffer( idx ) )
+      if( std::abs( ( *n )[ 0 ] ) < std::abs( ( *n )[ 2 ] ) )
       {
-        // far from an interface keep (x,y,z) base
-        b[ 0 ] = VectorType( base_x );
-        b[ 1 ] = VectorType( base_y );
-        b[ 2 ] = VectorType( base_z );
-        it.Set( b );
-        continue;
+        tmp = base_x;
       }
-
-      VectorType n = vinterp->EvaluateAtIndex( idx );
-      n.Normalize();
-      if( n.GetNorm() < 0.1 )
+      else
       {
-        std::cout << "Should never append" << std::endl;
-        // far from an interface keep (x,y,z) base
-        b[ 0 ] = VectorType( base_x );
-        b[ 1 ] = VectorType( base_y );
-        b[ 2 ] = VectorType( base_z );
-        it.Set( b );
-        continue;
+        tmp = base_z;
       }
-
-      b[ 0 ] = n;
-
-      // find the must non colinear to vector wrt n
-      VectorType tmp;
-      if( std::abs( n[ 0 ] ) < std::abs( n[ 1 ] ) )
+    }
+    else
+    {
+      if( std::abs( ( *n )[ 1 ] ) < std::abs( ( *n )[ 2 ] ) )
       {
-        if( std::abs( n[ 0 ] ) < std::abs( n[ 2 ] ) )
-        {
-          tmp = base_x;
-        }
-        else
-        {
-          tmp = base_z;
-        }
+        tmp = base_y;
       }
       else
       {
-        if( std::abs( n[ 1 ] ) < std::abs( n[ 2 ] ) )
-        {
-          tmp = base_y;
-        }
-        else
-        {
-          tmp = base_z;
-        }
+        tmp = base_z;
       }
-
-      // find u and v in order to form a local orthonormal base with n
-      tmp = CrossProduct( n, tmp );
-      tmp.Normalize();
-      b[ 1 ] = tmp;
-      tmp    = CrossProduct( n, tmp );
-      tmp.Normalize();
-      b[ 2 ] = tmp;
-      it.Set( b );
     }
+
+    // find u and v in order to form a local orthonormal base with n
+    tmp = CrossProduct( *n, tmp );
+    tmp.Normalize();
+    b[ 1 ] = tmp;
+    tmp    = CrossProduct( *n, tmp );
+    tmp.Normalize();
+    b[ 2 ] = tmp;
   }
 
 
 };
 
+/**
+ * ********************* ComputeLocalBasesRangeFunction ****************************
+ */
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrder >
+::ComputeLocalBasesRangeFunction( void * userData,
+  ThreadIdType itkNotUsed( participantId ), SizeValueType begin, SizeValueType end )
+{
+  typedef UpdateLocalBases_impl< TScalarType, NDimensions > ImplType;
+  const Self & transform = *static_cast< const Self * >( userData );
+
+  ImageBaseType *         bases   = transform.m_LocalBases;
+  const ImageVectorType * normals = transform.m_LabelsNormals;
+  const RegionType        region  = normals->GetLargestPossibleRegion();
+  typename ImageBaseType::PointType p;
+  typename ImageVectorType::IndexType idx;
+  BaseType b;
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    /** Look up the nearest normal of the grid point. */
+    bases->TransformIndexToPhysicalPoint( bases->ComputeIndex( i ), p );
+    const bool isInside = normals->TransformPhysicalPointToIndex( p, idx )
+      && region.IsInside( idx );
+    if( !isInside )
+    {
+      ImplType::ComputeBase( 0, b );
+      bases->GetBufferPointer()[ i ] = b;
+      continue;
+    }
+
+    VectorType n = normals->GetPixel( idx );
+    n.Normalize();
+    if( n.GetNorm() < 0.1 )
+    {
+      // far from an interface keep (x,y,z) base
+      ImplType::ComputeBase( 0, b );
+    }
+    else
+    {
+      ImplType::ComputeBase( &n, b );
+    }
+    bases->GetBufferPointer()[ i ] = b;
+  }
+
+} // end ComputeLocalBasesRangeFunction()
+
+
 template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
 void
 MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrder >
@@ -366,12 +359,13 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   typedef itk::GradientImageFilter< ImageDoubleType, double, double >                             GradFilterType;
   typedef itk::VectorCastImageFilter< typename GradFilterType::OutputImageType, ImageVectorType > CastVectorType;
   typedef itk::BinaryThresholdImageFilter< ImageLabelType, ImageLabelType >                       LabelExtractorType;
-  typedef itk::AddImageFilter< ImageVectorType, ImageVectorType, ImageVectorType >                AddVectorImageType;
   typedef itk::MaskImageFilter< ImageVectorType, ImageLabelType, ImageVectorType >                MaskVectorImageType;
   typedef typename ImageLabelType::PointType                                                      PointType;
   typedef typename ImageLabelType::RegionType                                                     RegionType;
   typedef typename ImageLabelType::SpacingType                                                    SpacingType;
 
+  UpdateLocalBases_impl< TScalarType, NDimensions >::CheckDimension();
+
   PointType transOrig = GetGridOrigin();
   PointType transEnd;
   for( unsigned i = 0; i < NDimensions; ++i )
@@ -439,14 +433,21 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     if( l == 0 )
     {
       this->m_LabelsNormals = maskFilter->GetOutput();
+      this->m_LabelsNormals->DisconnectPipeline();
     }
     else
     {
-      typename AddVectorImageType::Pointer addFilter = AddVectorImageType::New();
-      addFilter->SetInput1( this->m_LabelsNormals );
-      addFilter->SetInput2( maskFilter->GetOutput() );
-      addFilter->Update();
-      this->m_LabelsNormals = addFilter->GetOutput();
+      /** The masks of the labels do not overlap, so the normals of this
+       * label are added in place, instead of by an extra filter and image.
+       */
+      const VectorType *  labelNormals = maskFilter->GetOutput()->GetBufferPointer();
+      VectorType *        normals      = this->m_LabelsNormals->GetBufferPointer();
+      const SizeValueType nrOfPixels
+        = this->m_LabelsNormals->GetBufferedRegion().GetNumberOfPixels();
+      for( SizeValueType i = 0; i < nrOfPixels; ++i )
+      {
+        normals[ i ] += labelNormals[ i ];
+      }
     }
   }
 
@@ -456,7 +457,11 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   m_LocalBases->SetOrigin( GetGridOrigin() );
   m_LocalBases->SetDirection( GetGridDirection() );
   m_LocalBases->Allocate();
-  UpdateLocalBases_impl< TScalarType, NDimensions >::Do( this->m_LocalBases, this->m_LabelsNormals );
+
+  /** Compute the local bases of the grid points in parallel. */
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_LocalBases->GetBufferedRegion().GetNumberOfPixels(), 0,
+    Self::ComputeLocalBasesRangeFunction, this );
 }
 
 
@@ -527,6 +532,22 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   {
     m_Trans[ i ]->SetParameters( m_Para[ i ] );
   }
+
+  /** All B-splines share one grid, so the sum of the normal B-spline and
+   * the B-spline of a label is a single B-spline, with the summed
+   * coefficients. A point is then transformed with one evaluation.
+   */
+  const ParametersType & fixedParameters = m_Trans[ 0 ]->GetFixedParameters();
+  for( unsigned l = 1; l <= m_NbLabels; ++l )
+  {
+    if( m_SumTrans[ l ]->GetFixedParameters() != fixedParameters )
+    {
+      m_SumTrans[ l ]->SetFixedParameters( fixedParameters );
+    }
+    m_SumPara[ l ] = m_Para[ 0 ];
+    m_SumPara[ l ] += m_Para[ l ];
+    m_SumTrans[ l ]->SetParameters( m_SumPara[ l ] );
+  }
 }
 
 
@@ -682,8 +703,8 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return point;
   }
 
-  OutputPointType res = m_Trans[ 0 ]->TransformPoint( point ) + ( m_Trans[ lidx ]->TransformPoint( point ) - point );
-  return res;
+  /** Equal to m_Trans[ 0 ]->TransformPoint( point ) + ( m_Trans[ lidx ]->TransformPoint( point ) - point ). */
+  return m_SumTrans[ lidx ]->TransformPoint( point );
 }
 
 
@@ -881,19 +902,8 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return;
   }
 
-  SpatialHessianType nsh, lsh;
-  m_Trans[ 0 ]->GetSpatialHessian( ipp, nsh );
-  m_Trans[ lidx ]->GetSpatialHessian( ipp, lsh );
-  for( unsigned i = 0; i < SpaceDimension; ++i )
-  {
-    for( unsigned j = 0; j < SpaceDimension; ++j )
-    {
-      for( unsigned k = 0; k < SpaceDimension; ++k )
-      {
-        sh[ i ][ j ][ k ] = lsh[ i ][ j ][ k ] + nsh[ i ][ j ][ k ];
-      }
-    }
-  }
+  /** The Hessian of the summed B-spline is the sum of the Hessians. */
+  m_SumTrans[ lidx ]->GetSpatialHessian( ipp, sh );
 }
 
 
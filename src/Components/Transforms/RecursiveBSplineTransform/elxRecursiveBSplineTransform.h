@@ -74,6 +74,13 @@ namespace elastix
  *   <em>Nonrigid registration of dynamic medical imaging data using nD+t B-splines and a
  *   groupwise optimization approach</em>, C.T. Metz, S. Klein, M. Schaap, T. van Walsum and
  *   W.J. Niessen, Medical Image Analysis, in press.
+ * \parameter BSplineCoefficientPrecision: the precision in which the B-spline coefficients
+ *   are read when the transform is evaluated, either "double" or "float". With "float" a
+ *   single precision copy of the coefficients is kept, which halves the memory traffic of
+ *   TransformPoint and the spatial derivatives, at the cost of a small loss of accuracy.
+ *   The optimiser and the transform parameter file still work in double precision. \n
+ *   example: <tt>(BSplineCoefficientPrecision "float")</tt> \n
+ *   The default is "double".
  *
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
@@ -97,6 +104,10 @@ namespace elastix
  *   <em>Nonrigid registration of dynamic medical imaging data using nD+t B-splines and a
  *   groupwise optimization approach</em>, C.T. Metz, S. Klein, M. Schaap, T. van Walsum and
  *   W.J. Niessen, Medical Image Analysis, in press.
+ * \transformparameter BSplineCoefficientPrecision: the precision in which the B-spline
+ *   coefficients are read when the transform is evaluated, "double" or "float". \n
+ *   example: <tt>(BSplineCoefficientPrecision "float")</tt> \n
+ *   Default value: "double".
  *
  * \todo It is unsure what happens when one of the image dimensions has length 1.
  *
@@ -312,6 +323,9 @@ private:
   /** Initialize the right B-spline transform based on the spline order and periodicity. */
   unsigned int InitializeBSplineTransform();
 
+  /** Read the BSplineCoefficientPrecision and pass it to the B-spline transform. */
+  void ReadCoefficientPrecision( void );
+
 };
 
 } // end namespace elastix
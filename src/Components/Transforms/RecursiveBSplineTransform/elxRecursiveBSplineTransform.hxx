@@ -177,6 +177,9 @@ RecursiveBSplineTransform< TElastix >
   /** Precompute the B-spline grid regions. */
   this->PreComputeGridInformation();
 
+  /** Set the precision of the coefficients used for the evaluation. */
+  this->ReadCoefficientPrecision();
+
 } // end BeforeRegistration()
 
 
@@ -536,6 +539,7 @@ RecursiveBSplineTransform< TElastix >
   this->m_BSplineTransform->SetGridSpacing( gridspacing );
   this->m_BSplineTransform->SetGridOrigin( gridorigin );
   this->m_BSplineTransform->SetGridDirection( griddirection );
+  this->ReadCoefficientPrecision();
 
   /** Call the ReadFromFile from the TransformBase.
    * This must be done after setting the Grid, because later the
@@ -626,6 +630,10 @@ RecursiveBSplineTransform< TElastix >
     m_CyclicString = "true";
   }
   xout[ "transpar" ] << "(UseCyclicTransform \"" << m_CyclicString << "\")" << std::endl;
+  if( this->m_BSplineTransform->GetUseFloatCoefficients() )
+  {
+    xout[ "transpar" ] << "(BSplineCoefficientPrecision \"float\")" << std::endl;
+  }
 
   /** Set the precision back to default value. */
   xout[ "transpar" ] << std::setprecision(
@@ -738,6 +746,14 @@ RecursiveBSplineTransform< TElastix >
   paramsMap->insert( make_pair( parameterName, parameterValues ) );
   parameterValues.clear();
 
+  if( this->m_BSplineTransform->GetUseFloatCoefficients() )
+  {
+    parameterName = "BSplineCoefficientPrecision";
+    parameterValues.push_back( "float" );
+    paramsMap->insert( make_pair( parameterName, parameterValues ) );
+    parameterValues.clear();
+  }
+
   /** Set the precision back to default value. */
 //  xout["transpar"] << std::setprecision(
 //  this->m_Elastix->GetDefaultOutputPrecision() );
@@ -835,6 +851,29 @@ RecursiveBSplineTransform< TElastix >
 } // end SetOptimizerScales()
 
 
+/**
+ * ******************* ReadCoefficientPrecision ***********************
+ */
+
+template< class TElastix >
+void
+RecursiveBSplineTransform< TElastix >
+::ReadCoefficientPrecision( void )
+{
+  std::string precision = "double";
+  this->GetConfiguration()->ReadParameter( precision,
+    "BSplineCoefficientPrecision", this->GetComponentLabel(), 0, 0 );
+  if( precision != "double" && precision != "float" )
+  {
+    itkExceptionMacro( << "ERROR: BSplineCoefficientPrecision should be "
+                       << "\"double\" or \"float\", but is \"" << precision << "\"." );
+  }
+
+  this->m_BSplineTransform->SetUseFloatCoefficients( precision == "float" );
+
+} // end ReadCoefficientPrecision()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxRecursiveBSplineTransform_hxx
@@ -184,15 +184,14 @@ SimilarityTransformElastix< TElastix >
   bool CORPointInImage = true;
   if( centerGivenAsIndex )
   {
-    CORIndexInImage =  this->m_Registration->GetAsITKBaseType()
-      ->GetFixedImage()->GetLargestPossibleRegion().IsInside(
+    CORIndexInImage =  this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().IsInside(
       centerOfRotationIndex );
   }
   if( centerGivenAsPoint )
   {
     typedef itk::ContinuousIndex< double, SpaceDimension > ContinuousIndexType;
     ContinuousIndexType cindex;
-    CORPointInImage = this->m_Registration->GetAsITKBaseType()->GetFixedImage()->
+    CORPointInImage = this->GetElastix()->GetFixedImage()->
       TransformPhysicalPointToContinuousIndex( centerOfRotationPoint, cindex );
   }
 
@@ -237,7 +236,7 @@ SimilarityTransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetTransform( this->m_SimilarityTransform );
@@ -271,7 +270,7 @@ SimilarityTransformElastix< TElastix >
     if( centerGivenAsIndex )
     {
       /** Convert from index-value to physical-point-value.*/
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage()
+      this->GetElastix()->GetFixedImage()
       ->TransformIndexToPhysicalPoint(
         centerOfRotationIndex, centerOfRotationPoint );
     }
@@ -70,6 +70,29 @@ namespace elastix
  * Default: 0.3. You cannot specify this parameter for each resolution differently.\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \parameter TPSMatrixInversionMethod: the method used to solve the spline
+ * system, one of { SVD, QR, Iterative }. SVD and QR store and invert the
+ * full matrix, which limits the number of landmarks to a few thousand.
+ * Iterative uses a conjugate gradient solver and a tree code for the kernel
+ * sums, and can handle much larger landmark sets. It is only available for
+ * the ThinPlateSpline and VolumeSpline (and in 2D), and does not provide the
+ * Jacobian required for registration, so it is meant for applying a
+ * transform, e.g. as initial transform or in transformix.\n
+ *   example: <tt>(TPSMatrixInversionMethod "Iterative")</tt>\n
+ * Default: SVD. This parameter is also written to the transform parameter file.
+ * \parameter TPSIterativeSolverTolerance: the relative residual at which the
+ * Iterative solver stops.\n
+ *   example: <tt>(TPSIterativeSolverTolerance 1e-6)</tt>\n
+ * Default: 1e-6.
+ * \parameter TPSIterativeSolverMaximumNumberOfIterations: the maximum number of
+ * iterations of the Iterative solver.\n
+ *   example: <tt>(TPSIterativeSolverMaximumNumberOfIterations 1000)</tt>\n
+ * Default: 1000.
+ * \parameter TPSTreeCodeOpeningAngle: the opening angle of the tree code of the
+ * Iterative method. Groups of landmarks that are further away than their size
+ * divided by this angle are approximated. Zero gives exact (but slow) sums.\n
+ *   example: <tt>(TPSTreeCodeOpeningAngle 0.3)</tt>\n
+ * Default: 0.3.
  *
  * \commandlinearg -fp: a file specifying a set of points that will serve
  * as fixed image landmarks.\n
@@ -104,6 +127,9 @@ namespace elastix
  *   example: <tt>(SplinePoissonRatio 0.3 )</tt>\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \transformparameter TPSMatrixInversionMethod: the method used to solve the
+ * spline system, see above. The settings of the Iterative method are written too.\n
+ *   example: <tt>(TPSMatrixInversionMethod "SVD")</tt>\n
  * \transformparameter FixedImageLandmarks: The landmark positions in the
  * fixed image, in world coordinates. Positions written as x1 y1 [z1] x2 y2 [z2] etc.\n
  *   example: <tt>(FixedImageLandmarks 10.0 11.0 12.0 4.0 4.0 4.0 6.0 6.0 6.0 )</tt>
@@ -225,6 +251,9 @@ protected:
    */
   virtual bool SetKernelType( const std::string & kernelType );
 
+  /** Read the matrix inversion method and the settings of the iterative method. */
+  virtual void ReadMatrixInversionSettings( void );
+
   /** Read source landmarks from fp file
    * \li Try reading -fp file
    */
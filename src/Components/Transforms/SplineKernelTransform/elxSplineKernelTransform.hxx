@@ -195,11 +195,8 @@ SplineKernelTransform< TElastix >
     this->m_KernelTransform->SetPoissonRatio( poissonRatio );
   }
 
-  /** Set the matrix inversion method (one of {SVD, QR}). */
-  std::string matrixInversionMethod = "SVD";
-  this->GetConfiguration()->ReadParameter(
-    matrixInversionMethod, "TPSMatrixInversionMethod", 0, true );
-  this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
+  /** Set the matrix inversion method and its settings. */
+  this->ReadMatrixInversionSettings();
 
   /** Load fixed image (source) landmark positions. */
   this->DetermineSourceLandmarks();
@@ -222,6 +219,43 @@ SplineKernelTransform< TElastix >
 } // end BeforeRegistration()
 
 
+/**
+ * ************************* ReadMatrixInversionSettings *********************
+ */
+
+template< class TElastix >
+void
+SplineKernelTransform< TElastix >
+::ReadMatrixInversionSettings( void )
+{
+  /** Set the matrix inversion method (one of {SVD, QR, Iterative}). */
+  std::string matrixInversionMethod = "SVD";
+  this->GetConfiguration()->ReadParameter(
+    matrixInversionMethod, "TPSMatrixInversionMethod", 0, true );
+  this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
+
+  if( matrixInversionMethod == "Iterative" )
+  {
+    double tolerance = this->m_KernelTransform->GetIterativeSolverTolerance();
+    this->GetConfiguration()->ReadParameter(
+      tolerance, "TPSIterativeSolverTolerance", 0, true );
+    this->m_KernelTransform->SetIterativeSolverTolerance( tolerance );
+
+    unsigned int maximumNumberOfIterations
+      = this->m_KernelTransform->GetIterativeSolverMaximumNumberOfIterations();
+    this->GetConfiguration()->ReadParameter( maximumNumberOfIterations,
+      "TPSIterativeSolverMaximumNumberOfIterations", 0, true );
+    this->m_KernelTransform->SetIterativeSolverMaximumNumberOfIterations( maximumNumberOfIterations );
+
+    double openingAngle = this->m_KernelTransform->GetTreeCodeOpeningAngle();
+    this->GetConfiguration()->ReadParameter(
+      openingAngle, "TPSTreeCodeOpeningAngle", 0, true );
+    this->m_KernelTransform->SetTreeCodeOpeningAngle( openingAngle );
+  }
+
+} // end ReadMatrixInversionSettings()
+
+
 /**
  * ************************* DetermineSourceLandmarks *********************
  */
@@ -432,6 +466,9 @@ SplineKernelTransform< TElastix >
     poissonRatio, "SplinePoissonRatio", this->GetComponentLabel(), 0, -1 );
   this->m_KernelTransform->SetPoissonRatio( poissonRatio );
 
+  /** Set the matrix inversion method before the fixed parameters are set. */
+  this->ReadMatrixInversionSettings();
+
   /** Read number of parameters. */
   unsigned int numberOfParameters = 0;
   this->GetConfiguration()->ReadParameter(
@@ -493,6 +530,21 @@ SplineKernelTransform< TElastix >
   xl::xout[ "transpar" ] << "(SplineRelaxationFactor "
                          << this->m_KernelTransform->GetStiffness() << ")" << std::endl;
 
+  /** Write the matrix inversion method, and the settings of the iterative method. */
+  const std::string & matrixInversionMethod = this->m_KernelTransform->GetMatrixInversionMethod();
+  xl::xout[ "transpar" ] << "(TPSMatrixInversionMethod \""
+                         << matrixInversionMethod << "\")" << std::endl;
+  if( matrixInversionMethod == "Iterative" )
+  {
+    xl::xout[ "transpar" ] << "(TPSIterativeSolverTolerance "
+                           << this->m_KernelTransform->GetIterativeSolverTolerance() << ")" << std::endl;
+    xl::xout[ "transpar" ] << "(TPSIterativeSolverMaximumNumberOfIterations "
+                           << this->m_KernelTransform->GetIterativeSolverMaximumNumberOfIterations()
+                           << ")" << std::endl;
+    xl::xout[ "transpar" ] << "(TPSTreeCodeOpeningAngle "
+                           << this->m_KernelTransform->GetTreeCodeOpeningAngle() << ")" << std::endl;
+  }
+
   /** Write the fixed image landmarks. */
   const ParametersType & fixedParams = this->m_KernelTransform->GetFixedParameters();
   xl::xout[ "transpar" ] << "(FixedImageLandmarks ";
@@ -48,6 +48,8 @@ PURPOSE.  See the above copyright notices for more information.
 #include "vnl/vnl_sample.h"
 #include "vnl/algo/vnl_svd.h"
 #include "vnl/algo/vnl_qr.h"
+#include "itkPersistentThreadPool.h"
+#include <vector>
 
 namespace itk
 {
@@ -86,6 +88,21 @@ namespace itk
  * - Support for matrix inversion by QR decomposition, instead of SVD.
  *   QR is much faster. Used in SetParameters() and SetFixedParameters().
  * - Much faster Jacobian computation for some of the derived kernel transforms.
+ * - An "Iterative" matrix inversion method for large numbers of landmarks, see below.
+ *
+ * With the "Iterative" matrix inversion method neither L nor its inverse
+ * is stored. The system is solved per dimension by a projected conjugate
+ * gradient method: the weights are restricted to the null space of P^T, in
+ * which the kernel matrix is definite, and the matrix-vector products are
+ * computed without storing K. The source landmarks are stored in a binary
+ * space partitioning tree. The kernel sums, both in the solver and in
+ * TransformPoint(), visit this tree Barnes-Hut style: the contribution of a
+ * cell that is far away compared to its size (radius < opening angle times
+ * distance) is approximated by a first order expansion around its
+ * center, using the summed weights and their first moments. An opening
+ * angle of zero gives exact sums. This method is only available for the
+ * kernels with G = g(r) I (the thin plate and volume splines), and does not
+ * support GetJacobian(), since that needs the inverse of L.
  *
  * \ingroup Transforms
  *
@@ -192,6 +209,12 @@ public:
   /** Compute the position of point in the new space */
   virtual OutputPointType TransformPoint( const InputPointType & thisPoint ) const;
 
+  /** Compute the positions of a set of points; multi-threaded. */
+  virtual void TransformPoints(
+    const SizeValueType numberOfPoints,
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints ) const;
+
   /** These vector transforms are not implemented for this transform. */
   virtual OutputVectorType TransformVector( const InputVectorType & ) const
   {
@@ -292,10 +315,29 @@ public:
   }
 
 
-  /** Matrix inversion by SVD or QR decomposition. */
-  itkSetMacro( MatrixInversionMethod, std::string );
+  /** Matrix inversion by SVD or QR decomposition, or by the iterative
+   * solver for large numbers of landmarks ("Iterative").
+   */
+  virtual void SetMatrixInversionMethod( const std::string & method );
   itkGetConstReferenceMacro( MatrixInversionMethod, std::string );
 
+  /** The relative residual at which the iterative solver stops. */
+  itkSetMacro( IterativeSolverTolerance, double );
+  itkGetConstMacro( IterativeSolverTolerance, double );
+
+  /** The maximum number of iterations of the iterative solver. */
+  itkSetMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+
+  /** The number of iterations used by the last iterative solve. */
+  itkGetConstMacro( IterativeSolverNumberOfIterations, unsigned int );
+
+  /** The opening angle of the tree code that approximates the kernel sums
+   * of the "Iterative" method. Zero gives exact sums; 0.3 is the default.
+   */
+  itkSetMacro( TreeCodeOpeningAngle, double );
+  itkGetConstMacro( TreeCodeOpeningAngle, double );
+
   /** Must be provided. */
   virtual void GetSpatialJacobian(
     const InputPointType & ipp, SpatialJacobianType & sj ) const
@@ -441,6 +483,23 @@ protected:
    */
   void ReorganizeW( void );
 
+  /** Build the landmark tree and the (P^T P)^-1 matrix of the iterative method. */
+  void ComputeLandmarkTree( void );
+
+  /** Compute D, A and B with the iterative method. */
+  void ComputeWMatrixIteratively( void );
+
+  /** Compute the weighted kernel sums at a point by traversing the tree.
+   * The weights and result are stored per landmark, NDimensions values each,
+   * and the moments are those computed by ComputeTreeMoments() for the weights.
+   */
+  void EvaluateTreeCode( const InputPointType & point, const ScalarType * weights,
+    const ScalarType * moments, ScalarType * result ) const;
+
+  /** Compute the summed weights and their first moments of all tree nodes. */
+  void ComputeTreeMoments( const ScalarType * weights,
+    std::vector< ScalarType > & moments ) const;
+
   /** Stiffness parameter. */
   double m_Stiffness;
 
@@ -529,8 +588,94 @@ private:
 
   TScalarType m_PoissonRatio;
 
-  /** Using SVD or QR decomposition. */
+  /** Using SVD or QR decomposition, or the iterative method. */
   std::string m_MatrixInversionMethod;
+  bool        m_UseIterativeSolver;
+
+  /** Settings and status of the iterative method. */
+  double       m_IterativeSolverTolerance;
+  unsigned int m_IterativeSolverMaximumNumberOfIterations;
+  unsigned int m_IterativeSolverNumberOfIterations;
+  double       m_TreeCodeOpeningAngle;
+
+  /** A node of the landmark tree. The landmarks of a node are stored
+   * contiguously in [m_Begin, m_End) of m_TreeLandmarks. The children of an
+   * internal node are m_FirstChild and m_FirstChild + 1; leaves have
+   * m_FirstChild == 0. Children are always stored after their parent.
+   */
+  struct TreeNodeType
+  {
+    InputPointType m_Center;
+    ScalarType     m_Radius;
+    unsigned long  m_Begin;
+    unsigned long  m_End;
+    unsigned long  m_FirstChild;
+  };
+
+  /** Orders landmark indices by one coordinate of their points. */
+  struct LandmarkComparatorType
+  {
+    const InputPointType * m_Points;
+    unsigned int           m_Dimension;
+    bool operator()( const unsigned long a, const unsigned long b ) const
+    {
+      return this->m_Points[ a ][ this->m_Dimension ] < this->m_Points[ b ][ this->m_Dimension ];
+    }
+  };
+
+  /** Recursively split the landmarks of a node. */
+  void SplitTreeNode( const unsigned long node,
+    const std::vector< InputPointType > & points );
+
+  /** Evaluate the radial kernel g(r) and its derivative. */
+  ScalarType EvaluateRadialKernel( const ScalarType r ) const;
+
+  ScalarType EvaluateRadialKernelDerivative( const ScalarType r ) const;
+
+  /** The data of a multi-threaded kernel sum at the source landmarks. */
+  struct KernelSumType
+  {
+    const Self *       m_Transform;
+    const ScalarType * m_Weights;
+    const ScalarType * m_Moments;
+    ScalarType *       m_Result;
+  };
+
+  /** The data of a multi-threaded TransformPoints() call. */
+  struct TransformPointsType
+  {
+    const Self *           m_Transform;
+    const InputPointType * m_InputPoints;
+    OutputPointType *      m_OutputPoints;
+  };
+
+  /** Range functions for the PersistentThreadPool. */
+  static void KernelSumRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  static void TransformPointsRangeFunction( void * userData, ThreadIdType participantId,
+    SizeValueType begin, SizeValueType end );
+
+  /** Compute K v at the source landmarks, for NDimensions vectors v at once. */
+  void ComputeKernelSums( const ScalarType * weights, ScalarType * result ) const;
+
+  /** Project NDimensions vectors onto the null space of P^T. */
+  void ProjectOntoNullSpace( ScalarType * vectors ) const;
+
+  /** Compute the coefficients (P^T P)^-1 P^T v of the polynomial part. */
+  void ComputePolynomialCoefficients( const ScalarType * vectors,
+    vnl_matrix< ScalarType > & coefficients ) const;
+
+  /** The landmark tree. */
+  std::vector< TreeNodeType >   m_TreeNodes;
+  std::vector< InputPointType > m_TreeLandmarks;
+  std::vector< unsigned long >  m_TreeLandmarkIndices;
+  std::vector< ScalarType >     m_TreeMoments;
+  std::vector< ScalarType >     m_TreeWeights;
+  bool                          m_LandmarkTreeComputed;
+
+  /** The inverse of P^T P, with P the polynomial part of one dimension. */
+  vnl_matrix< ScalarType > m_PTPInverse;
 
 };
 
@@ -36,6 +36,8 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "itkKernelTransform2.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -69,8 +71,15 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_PoissonRatio = 0.3;
 
   this->m_MatrixInversionMethod   = "SVD";
+  this->m_UseIterativeSolver      = false;
   this->m_FastComputationPossible = false;
 
+  this->m_IterativeSolverTolerance                 = 1e-6;
+  this->m_IterativeSolverMaximumNumberOfIterations = 1000;
+  this->m_IterativeSolverNumberOfIterations        = 0;
+  this->m_TreeCodeOpeningAngle                     = 0.3;
+  this->m_LandmarkTreeComputed                     = false;
+
   this->m_HasNonZeroSpatialHessian           = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
 
@@ -112,6 +121,7 @@ KernelTransform2< TScalarType, NDimensions >
     this->m_LMatrixComputed              = false;
     this->m_LInverseComputed             = false;
     this->m_LMatrixDecompositionComputed = false;
+    this->m_LandmarkTreeComputed         = false;
 
     // you must recompute L and Linv - this does not require the targ landmarks
     this->ComputeLInverse();
@@ -251,6 +261,13 @@ void
 KernelTransform2< TScalarType, NDimensions >
 ::ComputeWMatrix( void )
 {
+  /** The iterative method does not use L, Y and W at all. */
+  if( this->m_UseIterativeSolver )
+  {
+    this->ComputeWMatrixIteratively();
+    return;
+  }
+
   /** Compute L and Y. */
   if( !this->m_LMatrixComputed )
   {
@@ -311,6 +328,16 @@ void
 KernelTransform2< TScalarType, NDimensions >
 ::ComputeLInverse( void )
 {
+  /** The iterative method does not need the inverse; it is never computed
+   * for the large number of landmarks the method is meant for.
+   */
+  if( this->m_UseIterativeSolver )
+  {
+    this->ComputeLandmarkTree();
+    this->m_LInverseComputed = false;
+    return;
+  }
+
   if( !this->m_LMatrixComputed )
   {
     this->ComputeL();
@@ -527,6 +554,649 @@ KernelTransform2< TScalarType, NDimensions >
 } // end ReorganizeW()
 
 
+/**
+ * ******************* SetMatrixInversionMethod *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::SetMatrixInversionMethod( const std::string & method )
+{
+  if( this->m_MatrixInversionMethod != method )
+  {
+    this->m_MatrixInversionMethod        = method;
+    this->m_UseIterativeSolver           = ( method == "Iterative" );
+    this->m_WMatrixComputed              = false;
+    this->m_LInverseComputed             = false;
+    this->m_LMatrixDecompositionComputed = false;
+    this->Modified();
+  }
+
+} // end SetMatrixInversionMethod()
+
+
+/**
+ * ******************* ComputeLandmarkTree *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeLandmarkTree( void )
+{
+  if( !this->m_FastComputationPossible )
+  {
+    itkExceptionMacro( << "ERROR: the Iterative matrix inversion method is only "
+                       << "supported for kernels with G = g(r) I." );
+  }
+
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+
+  /** Copy the landmarks, and sort their indices into the tree. */
+  std::vector< InputPointType > points( numberOfLandmarks );
+  PointsIterator                sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for( unsigned long i = 0; i < numberOfLandmarks; ++i, ++sp )
+  {
+    points[ i ] = sp->Value();
+  }
+
+  this->m_TreeLandmarkIndices.resize( numberOfLandmarks );
+  for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+  {
+    this->m_TreeLandmarkIndices[ i ] = i;
+  }
+
+  this->m_TreeNodes.clear();
+  if( numberOfLandmarks > 0 )
+  {
+    TreeNodeType root;
+    root.m_Begin      = 0;
+    root.m_End        = numberOfLandmarks;
+    root.m_FirstChild = 0;
+    this->m_TreeNodes.push_back( root );
+    this->SplitTreeNode( 0, points );
+  }
+
+  /** Store the landmarks in tree order, and compute P^T P. */
+  vnl_matrix< ScalarType > PTP( NDimensions + 1, NDimensions + 1, 0.0 );
+  this->m_TreeLandmarks.resize( numberOfLandmarks );
+  for( unsigned long j = 0; j < numberOfLandmarks; ++j )
+  {
+    const InputPointType & p = points[ this->m_TreeLandmarkIndices[ j ] ];
+    this->m_TreeLandmarks[ j ] = p;
+    for( unsigned int k = 0; k <= NDimensions; ++k )
+    {
+      const ScalarType pk = k < NDimensions ? p[ k ] : 1.0;
+      for( unsigned int l = 0; l <= NDimensions; ++l )
+      {
+        PTP( k, l ) += pk * ( l < NDimensions ? p[ l ] : 1.0 );
+      }
+    }
+  }
+
+  /** SVD gives the pseudo-inverse for degenerate (e.g. coplanar) landmarks. */
+  this->m_PTPInverse = vnl_svd< ScalarType >( PTP ).inverse();
+
+  /** The previous solution no longer applies. */
+  this->m_TreeWeights.clear();
+  this->m_TreeMoments.clear();
+  this->m_LandmarkTreeComputed = true;
+
+} // end ComputeLandmarkTree()
+
+
+/**
+ * ******************* SplitTreeNode *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::SplitTreeNode( const unsigned long node, const std::vector< InputPointType > & points )
+{
+  const unsigned long leafSize = 16;
+  const unsigned long begin    = this->m_TreeNodes[ node ].m_Begin;
+  const unsigned long end      = this->m_TreeNodes[ node ].m_End;
+
+  /** Compute the bounding box, its center, and the radius of the node. */
+  InputPointType minimum = points[ this->m_TreeLandmarkIndices[ begin ] ];
+  InputPointType maximum = minimum;
+  for( unsigned long j = begin + 1; j < end; ++j )
+  {
+    const InputPointType & p = points[ this->m_TreeLandmarkIndices[ j ] ];
+    for( unsigned int k = 0; k < NDimensions; ++k )
+    {
+      minimum[ k ] = std::min( minimum[ k ], p[ k ] );
+      maximum[ k ] = std::max( maximum[ k ], p[ k ] );
+    }
+  }
+
+  InputPointType center;
+  unsigned int   splitDimension = 0;
+  for( unsigned int k = 0; k < NDimensions; ++k )
+  {
+    center[ k ] = 0.5 * ( minimum[ k ] + maximum[ k ] );
+    if( maximum[ k ] - minimum[ k ] > maximum[ splitDimension ] - minimum[ splitDimension ] )
+    {
+      splitDimension = k;
+    }
+  }
+
+  ScalarType radius = 0.0;
+  for( unsigned long j = begin; j < end; ++j )
+  {
+    radius = std::max( radius, static_cast< ScalarType >(
+      center.EuclideanDistanceTo( points[ this->m_TreeLandmarkIndices[ j ] ] ) ) );
+  }
+
+  this->m_TreeNodes[ node ].m_Center     = center;
+  this->m_TreeNodes[ node ].m_Radius     = radius;
+  this->m_TreeNodes[ node ].m_FirstChild = 0;
+
+  /** Small nodes and nodes of coinciding landmarks become leaves. */
+  if( end - begin <= leafSize || radius == 0.0 )
+  {
+    return;
+  }
+
+  /** Split at the median along the largest extent. */
+  const unsigned long    middle = begin + ( end - begin ) / 2;
+  LandmarkComparatorType comparator;
+  comparator.m_Points    = &points[ 0 ];
+  comparator.m_Dimension = splitDimension;
+  std::nth_element( this->m_TreeLandmarkIndices.begin() + begin,
+    this->m_TreeLandmarkIndices.begin() + middle,
+    this->m_TreeLandmarkIndices.begin() + end, comparator );
+
+  const unsigned long firstChild = this->m_TreeNodes.size();
+  TreeNodeType        child;
+  child.m_FirstChild = 0;
+  child.m_Begin      = begin;
+  child.m_End        = middle;
+  this->m_TreeNodes.push_back( child );
+  child.m_Begin = middle;
+  child.m_End   = end;
+  this->m_TreeNodes.push_back( child );
+  this->m_TreeNodes[ node ].m_FirstChild = firstChild;
+
+  this->SplitTreeNode( firstChild, points );
+  this->SplitTreeNode( firstChild + 1, points );
+
+} // end SplitTreeNode()
+
+
+/**
+ * ******************* ComputeTreeMoments *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeTreeMoments( const ScalarType * weights, std::vector< ScalarType > & moments ) const
+{
+  /** Per node and output dimension: the summed weight and the first moments. */
+  const unsigned int stride = NDimensions * ( NDimensions + 1 );
+  moments.assign( this->m_TreeNodes.size() * stride, 0.0 );
+
+  /** Children are stored after their parent, so process the nodes backwards. */
+  for( unsigned long node = this->m_TreeNodes.size(); node-- > 0; )
+  {
+    const TreeNodeType & treeNode = this->m_TreeNodes[ node ];
+    ScalarType *         m        = &moments[ node * stride ];
+    if( treeNode.m_FirstChild == 0 )
+    {
+      for( unsigned long j = treeNode.m_Begin; j < treeNode.m_End; ++j )
+      {
+        const InputVectorType delta = this->m_TreeLandmarks[ j ] - treeNode.m_Center;
+        const ScalarType *    w     = weights + this->m_TreeLandmarkIndices[ j ] * NDimensions;
+        for( unsigned int d = 0; d < NDimensions; ++d )
+        {
+          m[ d * ( NDimensions + 1 ) ] += w[ d ];
+          for( unsigned int k = 0; k < NDimensions; ++k )
+          {
+            m[ d * ( NDimensions + 1 ) + 1 + k ] += w[ d ] * delta[ k ];
+          }
+        }
+      }
+    }
+    else
+    {
+      for( unsigned long c = treeNode.m_FirstChild; c < treeNode.m_FirstChild + 2; ++c )
+      {
+        const InputVectorType delta = this->m_TreeNodes[ c ].m_Center - treeNode.m_Center;
+        const ScalarType *    cm    = &moments[ c * stride ];
+        for( unsigned int d = 0; d < NDimensions; ++d )
+        {
+          const ScalarType w = cm[ d * ( NDimensions + 1 ) ];
+          m[ d * ( NDimensions + 1 ) ] += w;
+          for( unsigned int k = 0; k < NDimensions; ++k )
+          {
+            m[ d * ( NDimensions + 1 ) + 1 + k ] += cm[ d * ( NDimensions + 1 ) + 1 + k ] + w * delta[ k ];
+          }
+        }
+      }
+    }
+  }
+
+} // end ComputeTreeMoments()
+
+
+/**
+ * ******************* EvaluateRadialKernel *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+typename KernelTransform2< TScalarType, NDimensions >::ScalarType
+KernelTransform2< TScalarType, NDimensions >
+::EvaluateRadialKernel( const ScalarType r ) const
+{
+  InputVectorType x;
+  x.Fill( 0.0 );
+  x[ 0 ] = r;
+  GMatrixType G;
+  this->ComputeG( x, G );
+  return G( 0, 0 );
+
+} // end EvaluateRadialKernel()
+
+
+/**
+ * ******************* EvaluateRadialKernelDerivative *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+typename KernelTransform2< TScalarType, NDimensions >::ScalarType
+KernelTransform2< TScalarType, NDimensions >
+::EvaluateRadialKernelDerivative( const ScalarType r ) const
+{
+  /** Central difference; only used far away from the landmarks, where g is smooth. */
+  const ScalarType h = 1e-4 * r;
+  return ( this->EvaluateRadialKernel( r + h ) - this->EvaluateRadialKernel( r - h ) ) / ( 2.0 * h );
+
+} // end EvaluateRadialKernelDerivative()
+
+
+/**
+ * ******************* EvaluateTreeCode *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::EvaluateTreeCode( const InputPointType & point, const ScalarType * weights,
+  const ScalarType * moments, ScalarType * result ) const
+{
+  std::fill( result, result + NDimensions, 0.0 );
+  if( this->m_TreeNodes.empty() )
+  {
+    return;
+  }
+
+  /** The tree is balanced, so its depth is bounded by the number of bits of the
+   * number of landmarks, and the stack always has room for both children.
+   */
+  const unsigned int stride = NDimensions * ( NDimensions + 1 );
+  unsigned long      stack[ 2 * sizeof( unsigned long ) * 8 + 2 ];
+  unsigned int       top = 0;
+  stack[ top++ ] = 0;
+  GMatrixType G;
+
+  while( top > 0 )
+  {
+    const unsigned long   node     = stack[ --top ];
+    const TreeNodeType &  treeNode = this->m_TreeNodes[ node ];
+    const InputVectorType diff     = point - treeNode.m_Center;
+    const ScalarType      distance = diff.GetNorm();
+
+    if( treeNode.m_Radius < this->m_TreeCodeOpeningAngle * distance )
+    {
+      /** Far field: g(|x - p|) ~= g(|x - c|) - g'(|x - c|) (x - c)^T (p - c) / |x - c|. */
+      const ScalarType   g  = this->EvaluateRadialKernel( distance );
+      const ScalarType   dg = this->EvaluateRadialKernelDerivative( distance ) / distance;
+      const ScalarType * m  = moments + node * stride;
+      for( unsigned int d = 0; d < NDimensions; ++d )
+      {
+        ScalarType dot = 0.0;
+        for( unsigned int k = 0; k < NDimensions; ++k )
+        {
+          dot += diff[ k ] * m[ d * ( NDimensions + 1 ) + 1 + k ];
+        }
+        result[ d ] += g * m[ d * ( NDimensions + 1 ) ] - dg * dot;
+      }
+    }
+    else if( treeNode.m_FirstChild == 0 )
+    {
+      /** Near field: exact sum over the landmarks of the leaf. */
+      for( unsigned long j = treeNode.m_Begin; j < treeNode.m_End; ++j )
+      {
+        this->ComputeG( point - this->m_TreeLandmarks[ j ], G );
+        const ScalarType   g = G( 0, 0 );
+        const ScalarType * w = weights + this->m_TreeLandmarkIndices[ j ] * NDimensions;
+        for( unsigned int d = 0; d < NDimensions; ++d )
+        {
+          result[ d ] += g * w[ d ];
+        }
+      }
+    }
+    else
+    {
+      stack[ top++ ] = treeNode.m_FirstChild;
+      stack[ top++ ] = treeNode.m_FirstChild + 1;
+    }
+  }
+
+} // end EvaluateTreeCode()
+
+
+/**
+ * ******************* ComputeKernelSums *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeKernelSums( const ScalarType * weights, ScalarType * result ) const
+{
+  std::vector< ScalarType > moments;
+  this->ComputeTreeMoments( weights, moments );
+
+  KernelSumType pass;
+  pass.m_Transform = this;
+  pass.m_Weights   = weights;
+  pass.m_Moments   = moments.empty() ? 0 : &moments[ 0 ];
+  pass.m_Result    = result;
+
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    this->m_TreeLandmarks.size(), 0, KernelSumRangeFunction, &pass );
+
+  /** The sums contain g(0) for the diagonal; replace it by the reflexive G. */
+  const ScalarType g0 = this->EvaluateRadialKernel( 0.0 );
+  GMatrixType      G;
+  PointsIterator   sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for( unsigned long i = 0; i < this->m_TreeLandmarks.size(); ++i, ++sp )
+  {
+    this->ComputeReflexiveG( sp, G );
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      result[ i * NDimensions + d ] += ( G( d, d ) - g0 ) * weights[ i * NDimensions + d ];
+    }
+  }
+
+} // end ComputeKernelSums()
+
+
+/**
+ * ******************* KernelSumRangeFunction *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::KernelSumRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const KernelSumType & pass      = *static_cast< const KernelSumType * >( userData );
+  const Self *          transform = pass.m_Transform;
+
+  /** Evaluate in tree order, so that neighbouring items visit the same nodes. */
+  for( SizeValueType j = begin; j < end; ++j )
+  {
+    transform->EvaluateTreeCode( transform->m_TreeLandmarks[ j ], pass.m_Weights, pass.m_Moments,
+      pass.m_Result + transform->m_TreeLandmarkIndices[ j ] * NDimensions );
+  }
+
+} // end KernelSumRangeFunction()
+
+
+/**
+ * ******************* ComputePolynomialCoefficients *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputePolynomialCoefficients( const ScalarType * vectors,
+  vnl_matrix< ScalarType > & coefficients ) const
+{
+  /** Compute P^T v for every dimension. */
+  vnl_matrix< ScalarType > PTv( NDimensions + 1, NDimensions, 0.0 );
+  for( unsigned long j = 0; j < this->m_TreeLandmarks.size(); ++j )
+  {
+    const InputPointType & p = this->m_TreeLandmarks[ j ];
+    const ScalarType *     v = vectors + this->m_TreeLandmarkIndices[ j ] * NDimensions;
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      for( unsigned int k = 0; k < NDimensions; ++k )
+      {
+        PTv( k, d ) += p[ k ] * v[ d ];
+      }
+      PTv( NDimensions, d ) += v[ d ];
+    }
+  }
+
+  /** Column d holds the coefficients of dimension d. */
+  coefficients = this->m_PTPInverse * PTv;
+
+} // end ComputePolynomialCoefficients()
+
+
+/**
+ * ******************* ProjectOntoNullSpace *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ProjectOntoNullSpace( ScalarType * vectors ) const
+{
+  /** v := v - P (P^T P)^-1 P^T v */
+  vnl_matrix< ScalarType > coefficients;
+  this->ComputePolynomialCoefficients( vectors, coefficients );
+
+  for( unsigned long j = 0; j < this->m_TreeLandmarks.size(); ++j )
+  {
+    const InputPointType & p = this->m_TreeLandmarks[ j ];
+    ScalarType *           v = vectors + this->m_TreeLandmarkIndices[ j ] * NDimensions;
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      ScalarType projection = coefficients( NDimensions, d );
+      for( unsigned int k = 0; k < NDimensions; ++k )
+      {
+        projection += coefficients( k, d ) * p[ k ];
+      }
+      v[ d ] -= projection;
+    }
+  }
+
+} // end ProjectOntoNullSpace()
+
+
+/**
+ * ******************* ComputeWMatrixIteratively *******************
+ *
+ * Solves K w + P a = y, P^T w = 0 for every dimension, with the
+ * conjugate gradient method on the null space of P^T: K is (conditionally)
+ * definite there for the thin plate and volume splines. All dimensions
+ * share the kernel sums of an iteration.
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeWMatrixIteratively( void )
+{
+  if( !this->m_LandmarkTreeComputed )
+  {
+    this->ComputeLandmarkTree();
+  }
+  this->ComputeD();
+
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+  const unsigned long n                 = numberOfLandmarks * NDimensions;
+
+  this->m_IterativeSolverNumberOfIterations = 0;
+  if( numberOfLandmarks == 0 )
+  {
+    this->m_DMatrix.set_size( NDimensions, 0 );
+    this->m_AMatrix.fill( 0.0 );
+    this->m_BVector.fill( 0.0 );
+    this->m_TreeWeights.clear();
+    this->m_TreeMoments.clear();
+    this->m_WMatrixComputed = true;
+    return;
+  }
+
+  std::vector< ScalarType >                y( n );
+  typename VectorSetType::ConstIterator displacement = this->m_Displacements->Begin();
+  for( unsigned long i = 0; i < numberOfLandmarks; ++i, ++displacement )
+  {
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      y[ i * NDimensions + d ] = displacement.Value()[ d ];
+    }
+  }
+
+  /** The norm of the projected right hand side sets the stopping criterion. */
+  std::vector< ScalarType > r( y );
+  this->ProjectOntoNullSpace( &r[ 0 ] );
+  ScalarType rhsNorm[ NDimensions ];
+  for( unsigned int d = 0; d < NDimensions; ++d )
+  {
+    rhsNorm[ d ] = 0.0;
+    for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+    {
+      rhsNorm[ d ] += r[ i * NDimensions + d ] * r[ i * NDimensions + d ];
+    }
+    rhsNorm[ d ] = vcl_sqrt( rhsNorm[ d ] );
+  }
+
+  /** Start from the previous solution, which is usually close during registration. */
+  std::vector< ScalarType > x( n, 0.0 );
+  std::vector< ScalarType > q( n );
+  if( this->m_TreeWeights.size() == n )
+  {
+    x = this->m_TreeWeights;
+    this->ProjectOntoNullSpace( &x[ 0 ] );
+    this->ComputeKernelSums( &x[ 0 ], &q[ 0 ] );
+    for( unsigned long i = 0; i < n; ++i )
+    {
+      r[ i ] = y[ i ] - q[ i ];
+    }
+    this->ProjectOntoNullSpace( &r[ 0 ] );
+  }
+
+  ScalarType rr[ NDimensions ];
+  bool       active[ NDimensions ];
+  bool       anyActive = false;
+  for( unsigned int d = 0; d < NDimensions; ++d )
+  {
+    rr[ d ] = 0.0;
+    for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+    {
+      rr[ d ] += r[ i * NDimensions + d ] * r[ i * NDimensions + d ];
+    }
+
+    /** A zero right hand side has the zero solution. */
+    if( rhsNorm[ d ] == 0.0 )
+    {
+      for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+      {
+        x[ i * NDimensions + d ] = 0.0;
+      }
+    }
+    active[ d ] = rhsNorm[ d ] > 0.0
+      && vcl_sqrt( rr[ d ] ) > this->m_IterativeSolverTolerance * rhsNorm[ d ];
+    anyActive |= active[ d ];
+  }
+
+  std::vector< ScalarType > p( r );
+  while( anyActive
+    && this->m_IterativeSolverNumberOfIterations < this->m_IterativeSolverMaximumNumberOfIterations )
+  {
+    this->ComputeKernelSums( &p[ 0 ], &q[ 0 ] );
+    this->ProjectOntoNullSpace( &q[ 0 ] );
+
+    anyActive = false;
+    for( unsigned int d = 0; d < NDimensions; ++d )
+    {
+      if( !active[ d ] ) { continue; }
+
+      ScalarType pq = 0.0;
+      for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+      {
+        pq += p[ i * NDimensions + d ] * q[ i * NDimensions + d ];
+      }
+      if( pq == 0.0 )
+      {
+        active[ d ] = false;
+        continue;
+      }
+
+      const ScalarType alpha = rr[ d ] / pq;
+      ScalarType       rrNew = 0.0;
+      for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+      {
+        const unsigned long id = i * NDimensions + d;
+        x[ id ] += alpha * p[ id ];
+        r[ id ] -= alpha * q[ id ];
+        rrNew   += r[ id ] * r[ id ];
+      }
+
+      const ScalarType beta = rrNew / rr[ d ];
+      for( unsigned long i = 0; i < numberOfLandmarks; ++i )
+      {
+        const unsigned long id = i * NDimensions + d;
+        p[ id ] = r[ id ] + beta * p[ id ];
+      }
+      rr[ d ] = rrNew;
+
+      active[ d ] = vcl_sqrt( rrNew ) > this->m_IterativeSolverTolerance * rhsNorm[ d ];
+      anyActive  |= active[ d ];
+    }
+    ++this->m_IterativeSolverNumberOfIterations;
+  }
+
+  if( anyActive )
+  {
+    itkWarningMacro( << "The iterative solver did not converge in "
+                     << this->m_IterativeSolverNumberOfIterations << " iterations." );
+  }
+
+  /** The residual y - K w lies in the range of P: it gives the affine part. */
+  this->ComputeKernelSums( &x[ 0 ], &q[ 0 ] );
+  for( unsigned long i = 0; i < n; ++i )
+  {
+    q[ i ] = y[ i ] - q[ i ];
+  }
+  vnl_matrix< ScalarType > coefficients;
+  this->ComputePolynomialCoefficients( &q[ 0 ], coefficients );
+
+  for( unsigned int i = 0; i < NDimensions; ++i )
+  {
+    for( unsigned int j = 0; j < NDimensions; ++j )
+    {
+      this->m_AMatrix( i, j ) = coefficients( j, i );
+    }
+    this->m_BVector( i ) = coefficients( NDimensions, i );
+  }
+
+  this->m_DMatrix.set_size( NDimensions, numberOfLandmarks );
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    for( unsigned int dim = 0; dim < NDimensions; ++dim )
+    {
+      this->m_DMatrix( dim, lnd ) = x[ lnd * NDimensions + dim ];
+    }
+  }
+
+  this->m_TreeWeights.swap( x );
+  this->ComputeTreeMoments( &this->m_TreeWeights[ 0 ], this->m_TreeMoments );
+  this->m_WMatrixComputed = true;
+
+} // end ComputeWMatrixIteratively()
+
+
 /**
  * ******************* TransformPoint *******************
  */
@@ -538,7 +1208,23 @@ KernelTransform2< TScalarType, NDimensions >
 {
   OutputPointType opp;
   opp.Fill( NumericTraits< typename OutputPointType::ValueType >::ZeroValue() );
-  this->ComputeDeformationContribution( thisPoint, opp );
+  if( this->m_UseIterativeSolver )
+  {
+    if( !this->m_TreeWeights.empty() )
+    {
+      ScalarType deformation[ NDimensions ];
+      this->EvaluateTreeCode( thisPoint, &this->m_TreeWeights[ 0 ],
+        &this->m_TreeMoments[ 0 ], deformation );
+      for( unsigned int k = 0; k < NDimensions; k++ )
+      {
+        opp[ k ] = deformation[ k ];
+      }
+    }
+  }
+  else
+  {
+    this->ComputeDeformationContribution( thisPoint, opp );
+  }
 
   // Add the rotational part of the Affine component
   for( unsigned int j = 0; j < NDimensions; j++ )
@@ -560,6 +1246,46 @@ KernelTransform2< TScalarType, NDimensions >
 } // end TransformPoint()
 
 
+/**
+ * ******************* TransformPoints *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::TransformPoints( const SizeValueType numberOfPoints,
+  const InputPointType * inputPoints, OutputPointType * outputPoints ) const
+{
+  TransformPointsType pass;
+  pass.m_Transform    = this;
+  pass.m_InputPoints  = inputPoints;
+  pass.m_OutputPoints = outputPoints;
+
+  PersistentThreadPool::GetInstance()->ParallelFor(
+    numberOfPoints, 0, TransformPointsRangeFunction, &pass );
+
+} // end TransformPoints()
+
+
+/**
+ * ******************* TransformPointsRangeFunction *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::TransformPointsRangeFunction( void * userData, ThreadIdType itkNotUsed( participantId ),
+  SizeValueType begin, SizeValueType end )
+{
+  const TransformPointsType & pass = *static_cast< const TransformPointsType * >( userData );
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    pass.m_OutputPoints[ i ] = pass.m_Transform->TransformPoint( pass.m_InputPoints[ i ] );
+  }
+
+} // end TransformPointsRangeFunction()
+
+
 /**
  * ******************* SetIdentity *******************
  *
@@ -665,6 +1391,7 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_LMatrixComputed              = false;
   this->m_LInverseComputed             = false;
   this->m_LMatrixDecompositionComputed = false;
+  this->m_LandmarkTreeComputed         = false;
 
   // you must recompute L and Linv - this does not require the targ lms
   this->ComputeLInverse();
@@ -754,6 +1481,12 @@ KernelTransform2< TScalarType, NDimensions >
 ::GetJacobian( const InputPointType & p, JacobianType & jac,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
+  if( this->m_UseIterativeSolver )
+  {
+    itkExceptionMacro( << "GetJacobian() requires the inverse of the L matrix, "
+                       << "which is not computed by the Iterative matrix inversion method." );
+  }
+
   const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
   jac.SetSize( NDimensions, numberOfLandmarks * NDimensions );
   jac.Fill( 0.0 );
@@ -923,6 +1656,16 @@ KernelTransform2< TScalarType, NDimensions >
      << this->m_PoissonRatio << std::endl;
   os << indent << "MatrixInversionMethod: "
      << this->m_MatrixInversionMethod << std::endl;
+  os << indent << "IterativeSolverTolerance: "
+     << this->m_IterativeSolverTolerance << std::endl;
+  os << indent << "IterativeSolverMaximumNumberOfIterations: "
+     << this->m_IterativeSolverMaximumNumberOfIterations << std::endl;
+  os << indent << "IterativeSolverNumberOfIterations: "
+     << this->m_IterativeSolverNumberOfIterations << std::endl;
+  os << indent << "TreeCodeOpeningAngle: "
+     << this->m_TreeCodeOpeningAngle << std::endl;
+  os << indent << "NumberOfTreeNodes: "
+     << this->m_TreeNodes.size() << std::endl;
 
   /** Just print the sizes of these matrices, not their contents. */
   os << indent << "LMatrix: " << this->m_LMatrix.rows()
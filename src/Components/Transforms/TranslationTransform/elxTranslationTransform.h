@@ -42,6 +42,11 @@ namespace elastix
  *    transform. Should be one of {GeometricalCenter, CenterOfGravity}.\n
  *    example: <tt>(AutomaticTransformInitializationMethod "CenterOfGravity")</tt> \n
  *    By default "GeometricalCenter" is assumed.\n
+ * \parameter NumberOfSamplesForCenterOfGravityCalculation: the maximum number of
+ *    voxels per image used by the CenterOfGravity method. The images are then
+ *    sampled on a regular grid. 0 means all voxels.\n
+ *    example: <tt>(NumberOfSamplesForCenterOfGravityCalculation 100000)</tt> \n
+ *    By default 0 is assumed.\n
  *
  * \ingroup Transforms
  */
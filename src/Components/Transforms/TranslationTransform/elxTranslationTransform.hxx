@@ -82,7 +82,7 @@ TranslationTransformElastix< TElastix >
     TransformInitializerPointer transformInitializer
       = TransformInitializerType::New();
     transformInitializer->SetFixedImage(
-      this->m_Registration->GetAsITKBaseType()->GetFixedImage() );
+      this->GetElastix()->GetFixedImage() );
     transformInitializer->SetMovingImage(
       this->m_Registration->GetAsITKBaseType()->GetMovingImage() );
     transformInitializer->SetFixedMask( this->GetElastix()->GetFixedMask() );
@@ -97,6 +97,11 @@ TranslationTransformElastix< TElastix >
     if( method == "CenterOfGravity" )
     {
       transformInitializer->MomentsOn();
+
+      unsigned long numberOfSamples = 0;
+      this->m_Configuration->ReadParameter( numberOfSamples,
+        "NumberOfSamplesForCenterOfGravityCalculation", 0 );
+      transformInitializer->SetNumberOfSamplesForCenterOfGravity( numberOfSamples );
     }
 
     transformInitializer->InitializeTransform();
@@ -21,7 +21,7 @@
 
 #include "itkObject.h"
 #include "itkObjectFactory.h"
-#include "itkImageMomentsCalculator.h"
+#include "itkImageCenterOfGravityCalculator.h"
 
 #include <iostream>
 
@@ -48,7 +48,10 @@ namespace itk
  * centers.
  *
  * In the second mode, the moments of gray level values are computed
- * for both images. The vector between the two centers of
+ * for both images, within the masks if they are set. As in
+ * CenteredTransformInitializer2, a threaded ImageCenterOfGravityCalculator
+ * computes them from at most NumberOfSamplesForCenterOfGravity voxels
+ * (0, the default, uses all voxels). The vector between the two centers of
  * mass is passes as the initial translation to the transform. This
  * second approach assumes that the moments of the anatomical objects
  * are similar for both images and hence the best initial guess for
@@ -96,8 +99,8 @@ public:
   typedef typename MovingMaskType::ConstPointer        MovingMaskPointer;
 
   /** Moment calculators */
-  typedef ImageMomentsCalculator< FixedImageType >  FixedImageCalculatorType;
-  typedef ImageMomentsCalculator< MovingImageType > MovingImageCalculatorType;
+  typedef ImageCenterOfGravityCalculator< FixedImageType >  FixedImageCalculatorType;
+  typedef ImageCenterOfGravityCalculator< MovingImageType > MovingImageCalculatorType;
 
   typedef typename FixedImageCalculatorType::Pointer  FixedImageCalculatorPointer;
   typedef typename MovingImageCalculatorType::Pointer MovingImageCalculatorPointer;
@@ -131,6 +134,12 @@ public:
   void GeometryOn() { m_UseMoments = false; }
   void MomentsOn()  { m_UseMoments = true; }
 
+  /** Set/Get the maximum number of voxels per image used for the center of
+   * gravity. The default, 0, uses all voxels.
+   */
+  itkSetMacro( NumberOfSamplesForCenterOfGravity, SizeValueType );
+  itkGetConstMacro( NumberOfSamplesForCenterOfGravity, SizeValueType );
+
   /** Get() access to the moments calculators */
   itkGetConstObjectMacro( FixedCalculator,  FixedImageCalculatorType  );
   itkGetConstObjectMacro( MovingCalculator, MovingImageCalculatorType );
@@ -153,6 +162,7 @@ private:
   FixedMaskPointer   m_FixedMask;
   MovingMaskPointer  m_MovingMask;
   bool               m_UseMoments;
+  SizeValueType      m_NumberOfSamplesForCenterOfGravity;
 
   FixedImageCalculatorPointer  m_FixedCalculator;
   MovingImageCalculatorPointer m_MovingCalculator;
@@ -35,6 +35,8 @@ TranslationTransformInitializer< TTransform, TFixedImage, TMovingImage >
 {
   this->m_FixedCalculator  = FixedImageCalculatorType::New();
   this->m_MovingCalculator = MovingImageCalculatorType::New();
+  this->m_UseMoments       = false;
+  this->m_NumberOfSamplesForCenterOfGravity = 0;
 }
 
 
@@ -81,28 +83,17 @@ TranslationTransformInitializer< TTransform, TFixedImage, TMovingImage >
 
   if( this->m_UseMoments )
   {
-    // Convert the masks to spatial objects
-    typename FixedMaskSpatialObjectType::Pointer fixedMaskAsSpatialObject = 0;
-    if( this->m_FixedMask )
-    {
-      fixedMaskAsSpatialObject = FixedMaskSpatialObjectType::New();
-      fixedMaskAsSpatialObject->SetImage( this->m_FixedMask );
-    }
-
-    typename MovingMaskSpatialObjectType::Pointer movingMaskAsSpatialObject = 0;
-    if( this->m_MovingMask )
-    {
-      movingMaskAsSpatialObject = MovingMaskSpatialObjectType::New();
-      movingMaskAsSpatialObject->SetImage( this->m_MovingMask );
-    }
-
     // Compute the image moments
     this->m_FixedCalculator->SetImage( this->m_FixedImage );
-    this->m_FixedCalculator->SetSpatialObjectMask( fixedMaskAsSpatialObject );
+    this->m_FixedCalculator->SetMask( this->m_FixedMask );
+    this->m_FixedCalculator->SetMaximumNumberOfSamples(
+      this->m_NumberOfSamplesForCenterOfGravity );
     this->m_FixedCalculator->Compute();
 
     this->m_MovingCalculator->SetImage( this->m_MovingImage );
-    this->m_MovingCalculator->SetSpatialObjectMask( movingMaskAsSpatialObject );
+    this->m_MovingCalculator->SetMask( this->m_MovingMask );
+    this->m_MovingCalculator->SetMaximumNumberOfSamples(
+      this->m_NumberOfSamplesForCenterOfGravity );
     this->m_MovingCalculator->Compute();
 
     // Get the center of gravities
@@ -43,6 +43,10 @@ namespace elastix
  * You can also use this class to average transformations found by previous
  * elastix runs.
  *
+ * The sub-transforms do not change during the registration. With a Grid or
+ * Full sampler and (UseFixedSampleFeatureCache "true") their outputs are
+ * computed once per sample, so that the metric only evaluates weighted sums.
+ *
  * The parameters used in this class are:
  * \parameter Transform: Select this transform as follows:\n
  *    <tt>(%Transform "WeightedCombinationTransform")</tt>
@@ -134,6 +134,40 @@ public:
     JacobianType & jac,
     NonZeroJacobianIndicesType & nzji ) const;
 
+  /** Typedefs for the fixed sample features. */
+  typedef typename Superclass::MovingImageGradientType MovingImageGradientType;
+  typedef typename Superclass::DerivativeType          DerivativeType;
+
+  /** The fixed sample features are the outputs T_i(x) of the sub-transforms,
+   * which do not depend on the weights. With them, a point is transformed by
+   * a weighted sum, without evaluating the sub-transforms.
+   */
+  virtual unsigned int GetNumberOfFixedSampleFeatures( void ) const
+  {
+    return this->m_TransformContainer.size() * OutputSpaceDimension;
+  }
+
+
+  /** Compute the fixed sample features and the nonzero Jacobian indices. */
+  virtual void ComputeFixedSampleFeatures(
+    const InputPointType & ipp,
+    double * features,
+    NonZeroJacobianIndicesType & nzji ) const;
+
+  /** Transform a point, using its fixed sample features. */
+  virtual OutputPointType TransformPointUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features ) const;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * using the fixed sample features.
+   */
+  virtual void EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+    const InputPointType & ipp,
+    const double * features,
+    const MovingImageGradientType & movingImageGradient,
+    DerivativeType & imageJacobian ) const;
+
   /** Set the parameters. Computes the sum of weights (which is
    * the normalization term). And checks if the number of parameters
    * is correct */
@@ -191,6 +191,139 @@ WeightedCombinationTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end GetJacobian()
 
 
+/**
+ * ********************* ComputeFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+WeightedCombinationTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::ComputeFixedSampleFeatures(
+  const InputPointType & ipp,
+  double * features,
+  NonZeroJacobianIndicesType & nzji ) const
+{
+  const TransformContainerType & tc = this->m_TransformContainer;
+  const unsigned int             N  = tc.size();
+
+  /** Store T_i(x), which does not depend on the weights. */
+  OutputPointType tempopp;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    tempopp = tc[ i ]->TransformPoint( ipp );
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      features[ i * OutputSpaceDimension + d ] = tempopp[ d ];
+    }
+  }
+
+  /** This transform has only nonzero jacobians. */
+  nzji = this->m_NonZeroJacobianIndices;
+
+} // end ComputeFixedSampleFeatures()
+
+
+/**
+ * ********************* TransformPointUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+typename WeightedCombinationTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::OutputPointType
+WeightedCombinationTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPointUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features ) const
+{
+  OutputPointType opp;
+  opp.Fill( 0.0 );
+  const unsigned int     N     = this->m_TransformContainer.size();
+  const ParametersType & param = this->m_Parameters;
+
+  /** Calculate sum_i w_i T_i(x), with the cached T_i(x) */
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    const double   w       = param[ i ];
+    const double * tempopp = features + i * OutputSpaceDimension;
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      opp[ d ] += w * tempopp[ d ];
+    }
+  }
+
+  if( this->m_NormalizeWeights )
+  {
+    /** T(x) = \sum_i w_i T_i(x) / sum_i w_i */
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      opp[ d ] /= this->m_SumOfWeights;
+    }
+  }
+  else
+  {
+    /** T(x) = (1 - \sum_i w_i ) x + \sum_i w_i T_i(x) */
+    const double factor = 1.0 - this->m_SumOfWeights;
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      opp[ d ] += factor * ipp[ d ];
+    }
+  }
+  return opp;
+
+} // end TransformPointUsingFixedSampleFeatures()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+WeightedCombinationTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures(
+  const InputPointType & ipp,
+  const double * features,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType & imageJacobian ) const
+{
+  const unsigned int N = this->m_TransformContainer.size();
+  imageJacobian.SetSize( N );
+
+  /** The reference point that is subtracted from the cached T_i(x):
+   * T(x) when normalizing, and x otherwise.
+   */
+  OutputPointType reference;
+  double          factor = 1.0;
+  if( this->m_NormalizeWeights )
+  {
+    /** dT/dmu_i = ( T_i(x) - T(x) ) / ( \sum_i w_i ) */
+    reference = this->TransformPointUsingFixedSampleFeatures( ipp, features );
+    factor    = 1.0 / this->m_SumOfWeights;
+  }
+  else
+  {
+    /** dT/dmu_i = T_i(x) - x */
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      reference[ d ] = ipp[ d ];
+    }
+  }
+
+  /** Compute the inner product of the gradient with each column. */
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    const double * tempopp = features + i * OutputSpaceDimension;
+    double         sum     = 0.0;
+    for( unsigned int d = 0; d < OutputSpaceDimension; ++d )
+    {
+      sum += movingImageGradient[ d ] * ( tempopp[ d ] - reference[ d ] );
+    }
+    imageJacobian[ i ] = factor * sum;
+  }
+
+} // end EvaluateJacobianWithImageGradientProductUsingFixedSampleFeatures()
+
+
 } // end namespace itk
 
 #endif
@@ -24,6 +24,7 @@
 #include "elxBaseComponentSE.h"
 #include "itkObject.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
+#include "itkFixedImagePreprocessingCache.h"
 
 namespace elastix
 {
@@ -50,6 +51,10 @@ namespace elastix
  *    example: <tt>(WritePyramidImagesAfterEachResolution "true")</tt>\n
  *    default "false".
  *
+ * When the itk::FixedImagePreprocessingCache is enabled, the pyramids that
+ * support it take their levels from the cache, if they were computed before
+ * for the same fixed image and settings, see GraftPyramidFromCache().
+ *
  * \ingroup ImagePyramids
  * \ingroup ComponentBaseClasses
  */
@@ -116,6 +121,25 @@ public:
   virtual void WritePyramidImage( const std::string & filename,
     const unsigned int & level ); // const;
 
+protected:
+
+  /** Grafts the levels of the pyramid that were computed before for the same
+   * input image and settings from the itk::FixedImagePreprocessingCache onto
+   * the outputs. Returns false if they are not available. To be called by the
+   * GenerateData() of the pyramids, which then call StorePyramidInCache()
+   * after computing the levels themselves.
+   */
+  virtual bool GraftPyramidFromCache( void );
+
+  /** Stores the levels of the pyramid in the cache. */
+  virtual void StorePyramidInCache( void );
+
+  /** The description of the settings of the pyramid that are part of the
+   * cache key. By default the class name and the schedule; pyramids with
+   * more settings extend it.
+   */
+  virtual std::string GetPyramidCacheKey( void ) const;
+
 protected:
 
   /** The constructor. */
@@ -21,6 +21,8 @@
 #include "elxFixedImagePyramidBase.h"
 #include "itkImageFileCastWriter.h"
 
+#include <sstream>
+
 namespace elastix
 {
 
@@ -208,6 +210,103 @@ FixedImagePyramidBase< TElastix >
 } // end WritePyramidImage()
 
 
+/**
+ * ******************* GetPyramidCacheKey *******************
+ */
+
+template< class TElastix >
+std::string
+FixedImagePyramidBase< TElastix >
+::GetPyramidCacheKey( void ) const
+{
+  const ITKBaseType * pyramid = this->GetAsITKBaseType();
+
+  std::ostringstream key( "" );
+  key << "FixedImagePyramid " << this->elxGetClassName()
+      << " schedule " << pyramid->GetSchedule();
+  return key.str();
+
+} // end GetPyramidCacheKey()
+
+
+/**
+ * ******************* GraftPyramidFromCache *******************
+ */
+
+template< class TElastix >
+bool
+FixedImagePyramidBase< TElastix >
+::GraftPyramidFromCache( void )
+{
+  itk::FixedImagePreprocessingCache::Pointer cache
+    = itk::FixedImagePreprocessingCache::GetInstance();
+  ITKBaseType * pyramid = this->GetAsITKBaseType();
+  if( !cache->GetEnabled() || pyramid->GetInput() == 0 )
+  {
+    return false;
+  }
+
+  /** All levels must be available. */
+  const std::string                   key            = this->GetPyramidCacheKey();
+  const unsigned int                  numberOfLevels = pyramid->GetNumberOfLevels();
+  std::vector< itk::Object::Pointer > levels( numberOfLevels );
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    std::ostringstream levelKey( "" );
+    levelKey << key << " level " << level;
+    levels[ level ] = cache->Find( pyramid->GetInput(), levelKey.str() );
+    if( dynamic_cast< OutputImageType * >( levels[ level ].GetPointer() ) == 0 )
+    {
+      return false;
+    }
+  }
+
+  /** Graft them, so the outputs share the cached pixel containers. */
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    pyramid->GraftNthOutput( level, static_cast< OutputImageType * >( levels[ level ].GetPointer() ) );
+  }
+
+  elxout << "  The fixed image pyramid is taken from the cache." << std::endl;
+  return true;
+
+} // end GraftPyramidFromCache()
+
+
+/**
+ * ******************* StorePyramidInCache *******************
+ */
+
+template< class TElastix >
+void
+FixedImagePyramidBase< TElastix >
+::StorePyramidInCache( void )
+{
+  itk::FixedImagePreprocessingCache::Pointer cache
+    = itk::FixedImagePreprocessingCache::GetInstance();
+  ITKBaseType * pyramid = this->GetAsITKBaseType();
+  if( !cache->GetEnabled() || pyramid->GetInput() == 0 )
+  {
+    return;
+  }
+
+  /** Store a graft of every level, which does not copy the pixels, and is
+   * not affected by later pipeline updates of this pyramid.
+   */
+  const std::string key = this->GetPyramidCacheKey();
+  for( unsigned int level = 0; level < pyramid->GetNumberOfLevels(); ++level )
+  {
+    typename OutputImageType::Pointer levelImage = OutputImageType::New();
+    levelImage->Graft( pyramid->GetOutput( level ) );
+
+    std::ostringstream levelKey( "" );
+    levelKey << key << " level " << level;
+    cache->Store( pyramid->GetInput(), levelKey.str(), levelImage );
+  }
+
+} // end StorePyramidInCache()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxFixedImagePyramidBase_hxx
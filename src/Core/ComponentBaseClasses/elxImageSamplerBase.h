@@ -36,6 +36,14 @@ namespace elastix
  *
  * This class contains all the common functionality for ImageSamplers.
  *
+ * The parameters used in this class are:
+ * \parameter UseImplicitSampling: Defines whether the metric may generate the samples of a
+ *    Grid or Full sampler on the fly, instead of storing them all in memory. Only used by
+ *    metrics that support it, currently the multi-threaded AdvancedMeanSquares; other
+ *    samplers and metrics ignore it.\n
+ *    example: <tt>(UseImplicitSampling "true")</tt>\n
+ *    Default value: false. The parameter can be specified for each resolution.
+ *
  * \ingroup ImageSamplers
  * \ingroup ComponentBaseClasses
  */
@@ -64,6 +64,12 @@ ImageSamplerBase< TElastix >
   }
   else { this->GetAsITKBaseType()->SetUseMultiThread( false ); }
 
+  /** Allow the metric to generate the samples on the fly. */
+  bool useImplicitSampling = false;
+  this->m_Configuration->ReadParameter( useImplicitSampling,
+    "UseImplicitSampling", this->GetComponentLabel(), level, 0 );
+  this->GetAsITKBaseType()->SetUseImplicitSampling( useImplicitSampling );
+
 } // end BeforeEachResolutionBase()
 
 
@@ -63,6 +63,60 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter UseFixedSampleFeatureCache: Whether the metric stores the B-spline
+ *    weights and nonzero Jacobian indices of all samples, and reuses them in
+ *    every iteration. Only has effect for samplers that do not select new samples
+ *    (Grid, Full), for metrics that support it (AdvancedMeanSquares) and for
+ *    B-spline transforms and the WeightedCombinationTransform, for which the
+ *    outputs of all sub-transforms are stored. Uses more memory. Can be given for each resolution. \n
+ *    example: <tt>(UseFixedSampleFeatureCache "true")</tt> \n
+ *    The default is false.
+ * \parameter UsePrecomputedMovingImageGradient: Whether the metric computes
+ *    the moving image gradient once per resolution, and linearly interpolates
+ *    it together with the moving image value. The interpolated value is only
+ *    used with the LinearInterpolator and float or small integer images; other
+ *    interpolators still give the value. Has no effect for the B-spline
+ *    interpolators. Uses more memory. Can be given for each resolution. \n
+ *    example: <tt>(UsePrecomputedMovingImageGradient "true")</tt> \n
+ *    The default is false.
+ * \parameter UseSparseDerivativeAccumulation: Whether the threads of the metric
+ *    add their derivative contributions to one shared derivative, instead of
+ *    each filling a derivative of the full length. Saves memory and time for
+ *    transforms with many parameters, like fine B-spline grids. Only has effect
+ *    for metrics that support it (AdvancedMeanSquares, AdvancedNormalizedCorrelation).
+ *    Can be given for each resolution. \n
+ *    example: <tt>(UseSparseDerivativeAccumulation "true")</tt> \n
+ *    The default is false.
+ * \parameter UseDeterministicReduction: Whether the multi-threaded metrics
+ *    divide the samples in a fixed number of blocks, and combine the partial
+ *    values and derivatives of the blocks in a fixed order. The result then
+ *    does not depend on the number of threads or their scheduling, provided
+ *    that the sampler is deterministic too. Disables UseSparseDerivativeAccumulation.
+ *    Can be given for each resolution. \n
+ *    example: <tt>(UseDeterministicReduction "true")</tt> \n
+ *    The default is false.
+ * \parameter NumberOfDeterministicBlocks: The number of blocks used by
+ *    UseDeterministicReduction. Can be given for each resolution. \n
+ *    example: <tt>(NumberOfDeterministicBlocks 32)</tt> \n
+ *    The default is 16.
+ * \parameter UseDistributedComputation: Whether the samples are divided over the
+ *    processes, when elastix is built with ELASTIX_USE_MPI and started with mpirun.
+ *    Each process evaluates its part of the samples, the partial sums are added over
+ *    the processes, and the transform parameters of the first process are used by
+ *    all. Supported by the multi-threaded AdvancedMeanSquares metric. Can be given
+ *    for each resolution. \n
+ *    example: <tt>(UseDistributedComputation "false")</tt> \n
+ *    The default is "true"; it has no effect with a single process.
+ * \parameter UseMovingImageBoundsCheck: Whether the metric rejects the samples
+ *    that are certainly mapped outside the moving image, or outside the bounding
+ *    box of the moving mask, before the transform is evaluated. The check bounds
+ *    the displacement of the B-spline transform by its largest coefficient, so it
+ *    only rejects samples that would be rejected later on. Saves time when most
+ *    samples fall outside a small moving mask or a partial field of view. Only has
+ *    effect for B-spline transforms. The number of rejected samples is printed
+ *    after each resolution. Can be given for each resolution. \n
+ *    example: <tt>(UseMovingImageBoundsCheck "true")</tt> \n
+ *    The default is false.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
@@ -155,6 +209,11 @@ public:
    */
   virtual void AfterEachIterationBase( void );
 
+  /** Execute stuff after each resolution:
+   * \li Print the number of samples rejected by the moving image bounds check.
+   */
+  virtual void AfterEachResolutionBase( void );
+
   /** Force the metric to base its computation on a new subset of image samples.
    * Not every metric may have implemented this.
    */
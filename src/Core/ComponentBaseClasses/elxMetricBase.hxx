@@ -179,6 +179,46 @@ MetricBase< TElastix >
       }
     }
 
+    /** Should the metric store the fixed sample features of the transform? */
+    bool useFixedSampleFeatureCache = false;
+    this->GetConfiguration()->ReadParameter( useFixedSampleFeatureCache,
+      "UseFixedSampleFeatureCache", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseFixedSampleFeatureCache( useFixedSampleFeatureCache );
+
+    /** Should the metric precompute the moving image gradient? */
+    bool usePrecomputedMovingImageGradient = false;
+    this->GetConfiguration()->ReadParameter( usePrecomputedMovingImageGradient,
+      "UsePrecomputedMovingImageGradient", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUsePrecomputedMovingImageGradient( usePrecomputedMovingImageGradient );
+
+    /** Should the metric accumulate the derivative sparsely? */
+    bool useSparseDerivativeAccumulation = false;
+    this->GetConfiguration()->ReadParameter( useSparseDerivativeAccumulation,
+      "UseSparseDerivativeAccumulation", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseSparseDerivativeAccumulation( useSparseDerivativeAccumulation );
+
+    /** Should the reduction be independent of the number of threads? */
+    bool useDeterministicReduction = false;
+    this->GetConfiguration()->ReadParameter( useDeterministicReduction,
+      "UseDeterministicReduction", this->GetComponentLabel(), level, 0 );
+    unsigned int numberOfDeterministicBlocks = 16;
+    this->GetConfiguration()->ReadParameter( numberOfDeterministicBlocks,
+      "NumberOfDeterministicBlocks", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetNumberOfDeterministicBlocks( numberOfDeterministicBlocks );
+    thisAsAdvanced->SetUseDeterministicReduction( useDeterministicReduction );
+
+    /** Should the samples be divided over the MPI processes? */
+    bool useDistributedComputation = true;
+    this->GetConfiguration()->ReadParameter( useDistributedComputation,
+      "UseDistributedComputation", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseDistributedComputation( useDistributedComputation );
+
+    /** Should the metric reject samples outside the moving image early? */
+    bool useMovingImageBoundsCheck = false;
+    this->GetConfiguration()->ReadParameter( useMovingImageBoundsCheck,
+      "UseMovingImageBoundsCheck", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseMovingImageBoundsCheck( useMovingImageBoundsCheck );
+
   } // end advanced metric
 
 } // end BeforeEachResolutionBase()
@@ -214,6 +254,28 @@ MetricBase< TElastix >
 } // end AfterEachIterationBase()
 
 
+/**
+ * ******************* AfterEachResolutionBase ******************
+ */
+
+template< class TElastix >
+void
+MetricBase< TElastix >
+::AfterEachResolutionBase( void )
+{
+  /** Print the number of samples rejected by the moving image bounds check. */
+  const AdvancedMetricType * thisAsAdvanced
+    = dynamic_cast< const AdvancedMetricType * >( this );
+  if( thisAsAdvanced != 0 && thisAsAdvanced->GetUseMovingImageBoundsCheck() )
+  {
+    elxout << "  Samples rejected by the moving image bounds check ("
+           << this->GetComponentLabel() << "): "
+           << thisAsAdvanced->GetNumberOfBoundsCheckRejections() << std::endl;
+  }
+
+} // end AfterEachResolutionBase()
+
+
 /**
  * ********************* SelectNewSamples ************************
  */
@@ -24,6 +24,10 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkOptimizer.h"
+#include "itkPhaseTimer.h"
+#include "itkRegistrationCheckpoint.h"
+
+#include <limits>
 
 namespace elastix
 {
@@ -44,6 +48,22 @@ namespace elastix
  *    Choose one from {"true", "false"} for every resolution.\n
  *    example: <tt>(NewSamplesEveryIteration "true" "true" "true")</tt> \n
  *    Default is "false" for every resolution.\n
+ * \parameter TotalIterationBudget: the total number of iterations, i.e. metric evaluations
+ *    of the optimization loop, for all resolutions together. The remaining budget is
+ *    distributed over the remaining resolutions before each resolution, in proportion to
+ *    their MaximumNumberOfIterations. Iterations that a resolution does not use, e.g.
+ *    because it converged early, go to the following resolutions. Only used by optimizers
+ *    that support it, see DistributeComputeBudget(). \n
+ *    example: <tt>(TotalIterationBudget 2000)</tt> \n
+ *    Default is 0, i.e. no budget.
+ * \parameter TotalTimeBudget: the total optimization time in seconds, for all resolutions
+ *    together. The remaining time is distributed over the remaining resolutions, in
+ *    proportion to their MaximumNumberOfIterations times NumberOfSpatialSamples. A
+ *    resolution stops when its time is used up. If the time per iteration and sample
+ *    observed in the previous resolution predicts that a resolution does not fit in its
+ *    time, both its number of iterations and its number of samples are reduced. \n
+ *    example: <tt>(TotalTimeBudget 60.0)</tt> \n
+ *    Default is 0, i.e. no budget.
  *
  * \ingroup Optimizers
  * \ingroup ComponentBaseClasses
@@ -68,6 +88,7 @@ public:
   typedef typename Superclass::ConfigurationPointer ConfigurationPointer;
   typedef typename Superclass::RegistrationType     RegistrationType;
   typedef typename Superclass::RegistrationPointer  RegistrationPointer;
+  typedef itk::SizeValueType                        SizeValueType;
 
   /** ITKBaseType. */
   typedef itk::Optimizer ITKBaseType;
@@ -92,16 +113,48 @@ public:
   /** Add empty SetCurrentPositionPublic, so this function is known in every inherited class. */
   virtual void SetCurrentPositionPublic( const ParametersType & param );
 
+  /** The metric value of the current iteration, for the progress report.
+   * Returns NaN, unless overridden by an optimizer that knows it.
+   */
+  virtual double GetCurrentMetricValue( void ) const
+  {
+    return std::numeric_limits< double >::quiet_NaN();
+  }
+
+  /** Execute stuff before the registration:
+   * \li Read the compute budget.
+   */
+  virtual void BeforeRegistrationBase( void ) ITK_OVERRIDE;
+
   /** Execute stuff before each new pyramid resolution:
    * \li Find out if new samples are used every new iteration in this resolution.
+   * \li Start the clock of the compute budget of this resolution.
    */
   virtual void BeforeEachResolutionBase() ITK_OVERRIDE;
 
+  /** Execute stuff after each resolution:
+   * \li Subtract the iterations and the time used from the compute budget.
+   */
+  virtual void AfterEachResolutionBase( void ) ITK_OVERRIDE;
+
+  /** Execute stuff after each iteration:
+   * \li Count the iterations for the compute budget.
+   */
+  virtual void AfterEachIterationBase( void ) ITK_OVERRIDE;
+
   /** Execute stuff after registration:
    * \li Compute and print MD5 hash of the transform parameters.
    */
   virtual void AfterRegistrationBase( void ) ITK_OVERRIDE;
 
+  /** Save and restore the state of the optimization, if the optimizer is an
+   * itk::ScaledSingleValuedNonLinearOptimizer. The restored state is used by
+   * the next StartOptimization().
+   */
+  virtual void WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const ITK_OVERRIDE;
+
+  virtual void ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint ) ITK_OVERRIDE;
+
   /** Method that sets the scales defined by a sinus
    * scale[i] = amplitude^( sin(i/nrofparam*2pi*frequency) )
    */
@@ -123,6 +176,21 @@ protected:
   /** Check whether the user asked to select new samples every iteration. */
   virtual bool GetNewSamplesEveryIteration( void ) const;
 
+  /** Distribute the remaining compute budget over the remaining resolutions,
+   * see the TotalIterationBudget and TotalTimeBudget parameters. Returns the
+   * number of iterations for the current resolution, given the number
+   * \a numberOfIterations from the parameter file, which is returned as is
+   * if no budget is set. May reduce the number of samples of the random
+   * image samplers, so call it from BeforeEachResolution(), which is
+   * called after that of the samplers.
+   */
+  virtual SizeValueType DistributeComputeBudget( const SizeValueType numberOfIterations );
+
+  /** Check whether the time budget of the current resolution is used up.
+   * Optimizers that support the budget call it after each iteration.
+   */
+  virtual bool ComputeBudgetIsExhausted( void ) const;
+
 private:
 
   /** The private constructor. */
@@ -135,6 +203,19 @@ private:
    */
   bool m_NewSamplesEveryIteration;
 
+  /** The compute budget: the totals, the remainders for the remaining
+   * resolutions, and the share and usage of the current resolution.
+   */
+  SizeValueType m_TotalIterationBudget;
+  SizeValueType m_RemainingIterationBudget;
+  SizeValueType m_NumberOfIterationsInResolution;
+  SizeValueType m_NumberOfSamplesInResolution;
+  double        m_TotalTimeBudget;
+  double        m_RemainingTimeBudget;
+  double        m_ResolutionTimeBudget;
+  double        m_ResolutionStartTime;
+  double        m_SecondsPerSampleIteration;
+
 };
 
 } // end namespace elastix
@@ -21,7 +21,10 @@
 #include "elxOptimizerBase.h"
 
 #include "itkSingleValuedNonLinearOptimizer.h"
+#include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkImageRandomSamplerBase.h"
 #include "itk_zlib.h"
+#include <algorithm>
 
 namespace elastix
 {
@@ -36,6 +39,16 @@ OptimizerBase< TElastix >
 {
   this->m_NewSamplesEveryIteration = false;
 
+  this->m_TotalIterationBudget           = 0;
+  this->m_RemainingIterationBudget       = 0;
+  this->m_NumberOfIterationsInResolution = 0;
+  this->m_NumberOfSamplesInResolution    = 0;
+  this->m_TotalTimeBudget                = 0.0;
+  this->m_RemainingTimeBudget            = 0.0;
+  this->m_ResolutionTimeBudget           = 0.0;
+  this->m_ResolutionStartTime            = 0.0;
+  this->m_SecondsPerSampleIteration      = 0.0;
+
 } // end Constructor
 
 
@@ -61,6 +74,30 @@ OptimizerBase< TElastix >
 } // end SetCurrentPositionPublic()
 
 
+/**
+ * ****************** BeforeRegistrationBase **********************
+ */
+
+template< class TElastix >
+void
+OptimizerBase< TElastix >
+::BeforeRegistrationBase( void )
+{
+  /** Read the compute budget for all resolutions together. */
+  this->m_TotalIterationBudget = 0;
+  this->GetConfiguration()->ReadParameter( this->m_TotalIterationBudget,
+    "TotalIterationBudget", this->GetComponentLabel(), 0, -1 );
+  this->m_TotalTimeBudget = 0.0;
+  this->GetConfiguration()->ReadParameter( this->m_TotalTimeBudget,
+    "TotalTimeBudget", this->GetComponentLabel(), 0, -1 );
+
+  this->m_RemainingIterationBudget  = this->m_TotalIterationBudget;
+  this->m_RemainingTimeBudget       = this->m_TotalTimeBudget;
+  this->m_SecondsPerSampleIteration = 0.0;
+
+} // end BeforeRegistrationBase()
+
+
 /**
  * ****************** BeforeEachResolutionBase **********************
  */
@@ -79,9 +116,56 @@ OptimizerBase< TElastix >
   this->GetConfiguration()->ReadParameter( this->m_NewSamplesEveryIteration,
     "NewSamplesEveryIteration", this->GetComponentLabel(), level, 0 );
 
+  /** Start the clock of the compute budget of this resolution. */
+  this->m_NumberOfIterationsInResolution = 0;
+  this->m_NumberOfSamplesInResolution    = 0;
+  this->m_ResolutionTimeBudget           = 0.0;
+  this->m_ResolutionStartTime            = itk::PhaseTimerRegistry::GetTime();
+
 } // end BeforeEachResolutionBase()
 
 
+/**
+ * ****************** AfterEachResolutionBase **********************
+ */
+
+template< class TElastix >
+void
+OptimizerBase< TElastix >
+::AfterEachResolutionBase( void )
+{
+  /** Subtract what this resolution used from the compute budget. */
+  const SizeValueType usedIterations = this->m_NumberOfIterationsInResolution;
+  this->m_RemainingIterationBudget -= std::min( usedIterations, this->m_RemainingIterationBudget );
+
+  const double usedTime = itk::PhaseTimerRegistry::GetTime() - this->m_ResolutionStartTime;
+  this->m_RemainingTimeBudget = std::max( this->m_RemainingTimeBudget - usedTime, 0.0 );
+
+  /** Remember the observed cost, to predict that of the next resolution. */
+  if( usedIterations > 0 && this->m_NumberOfSamplesInResolution > 0 )
+  {
+    this->m_SecondsPerSampleIteration = usedTime
+      / ( static_cast< double >( usedIterations )
+      * static_cast< double >( this->m_NumberOfSamplesInResolution ) );
+  }
+
+} // end AfterEachResolutionBase()
+
+
+/**
+ * ****************** AfterEachIterationBase **********************
+ */
+
+template< class TElastix >
+void
+OptimizerBase< TElastix >
+::AfterEachIterationBase( void )
+{
+  ++this->m_NumberOfIterationsInResolution;
+
+} // end AfterEachIterationBase()
+
+
 /**
  * ****************** AfterRegistrationBase **********************
  */
@@ -116,6 +200,55 @@ OptimizerBase< TElastix >
 } // end AfterRegistrationBase()
 
 
+/**
+ * ****************** WriteCheckpoint ****************************
+ */
+
+template< class TElastix >
+void
+OptimizerBase< TElastix >
+::WriteCheckpoint( itk::RegistrationCheckpoint & checkpoint ) const
+{
+  typedef itk::ScaledSingleValuedNonLinearOptimizer ScaledOptimizerType;
+  const ScaledOptimizerType * optimizer
+    = dynamic_cast< const ScaledOptimizerType * >( this->GetAsITKBaseType() );
+  if( optimizer == 0 )
+  {
+    return;
+  }
+
+  ScaledOptimizerType::OptimizationStateType state;
+  optimizer->GetOptimizationState( state );
+  if( !state.empty() )
+  {
+    checkpoint.SetEntry( std::string( this->GetComponentLabel() ) + ".OptimizationState", state );
+  }
+
+} // end WriteCheckpoint()
+
+
+/**
+ * ****************** ReadCheckpoint ****************************
+ */
+
+template< class TElastix >
+void
+OptimizerBase< TElastix >
+::ReadCheckpoint( const itk::RegistrationCheckpoint & checkpoint )
+{
+  typedef itk::ScaledSingleValuedNonLinearOptimizer ScaledOptimizerType;
+  ScaledOptimizerType * optimizer
+    = dynamic_cast< ScaledOptimizerType * >( this->GetAsITKBaseType() );
+  ScaledOptimizerType::OptimizationStateType state;
+  if( optimizer != 0
+    && checkpoint.GetEntry( std::string( this->GetComponentLabel() ) + ".OptimizationState", state ) )
+  {
+    optimizer->SetOptimizationState( state );
+  }
+
+} // end ReadCheckpoint()
+
+
 /**
  * ****************** SelectNewSamples ****************************
  */
@@ -125,6 +258,8 @@ void
 OptimizerBase< TElastix >
 ::SelectNewSamples( void )
 {
+  itkPhaseTimerMacro( "SelectNewSamples" );
+
   /** Force the metric to base its computation on a new subset of image samples.
    * Not every metric may have implemented this.
    */
@@ -133,6 +268,15 @@ OptimizerBase< TElastix >
     this->GetElastix()->GetElxMetricBase( i )->SelectNewSamples();
   }
 
+  /** Values cached for the previous samples are not valid anymore. */
+  const itk::ScaledSingleValuedNonLinearOptimizer * scaledOptimizer
+    = dynamic_cast< const itk::ScaledSingleValuedNonLinearOptimizer * >(
+    this->GetAsITKBaseType() );
+  if( scaledOptimizer != 0 && scaledOptimizer->GetScaledCostFunction() != 0 )
+  {
+    scaledOptimizer->GetScaledCostFunction()->InvalidateCache();
+  }
+
 } // end SelectNewSamples()
 
 
@@ -151,6 +295,131 @@ OptimizerBase< TElastix >
 } // end GetNewSamplesEveryIteration()
 
 
+/**
+ * ****************** DistributeComputeBudget ********************
+ */
+
+template< class TElastix >
+typename OptimizerBase< TElastix >::SizeValueType
+OptimizerBase< TElastix >
+::DistributeComputeBudget( const SizeValueType numberOfIterations )
+{
+  typedef typename ElastixType::FixedImageType          FixedImageType;
+  typedef itk::ImageRandomSamplerBase< FixedImageType > RandomSamplerType;
+
+  /** The random sampler, whose number of samples may be reduced. */
+  RandomSamplerType * sampler = 0;
+  if( this->GetElastix()->GetNumberOfImageSamplers() > 0 )
+  {
+    sampler = dynamic_cast< RandomSamplerType * >(
+      this->GetElastix()->GetElxImageSamplerBase()->GetAsITKBaseType() );
+  }
+  if( sampler != 0 )
+  {
+    this->m_NumberOfSamplesInResolution = sampler->GetNumberOfSamples();
+  }
+
+  if( this->m_TotalIterationBudget == 0 && this->m_TotalTimeBudget <= 0.0 )
+  {
+    return numberOfIterations;
+  }
+
+  /** The planned iterations and costs of the remaining resolutions, from the
+   * parameter file. Only their ratios matter.
+   */
+  const unsigned int level = this->GetRegistration()->GetAsITKBaseType()->GetCurrentLevel();
+  const unsigned int numberOfLevels
+    = this->GetRegistration()->GetAsITKBaseType()->GetNumberOfLevels();
+  std::string samplerLabel = "";
+  if( this->GetElastix()->GetNumberOfImageSamplers() > 0 )
+  {
+    samplerLabel = this->GetElastix()->GetElxImageSamplerBase()->GetComponentLabel();
+  }
+  double plannedIterations = 0.0;
+  double plannedCost       = 0.0;
+  for( unsigned int l = level; l < numberOfLevels; ++l )
+  {
+    double iterations = static_cast< double >( numberOfIterations );
+    this->GetConfiguration()->ReadParameter( iterations,
+      "MaximumNumberOfIterations", this->GetComponentLabel(), l, 0, false );
+    double samples = 5000.0;
+    this->GetConfiguration()->ReadParameter( samples,
+      "NumberOfSpatialSamples", samplerLabel, l, 0, false );
+    plannedIterations += iterations;
+    plannedCost       += iterations * samples;
+  }
+  const double iterationsShare = static_cast< double >( numberOfIterations ) / plannedIterations;
+  double       samples         = 5000.0;
+  this->GetConfiguration()->ReadParameter( samples,
+    "NumberOfSpatialSamples", samplerLabel, level, 0, false );
+  const double costShare = static_cast< double >( numberOfIterations ) * samples / plannedCost;
+
+  SizeValueType iterations = numberOfIterations;
+  if( this->m_TotalIterationBudget > 0 )
+  {
+    iterations = std::max( static_cast< SizeValueType >(
+      iterationsShare * static_cast< double >( this->m_RemainingIterationBudget ) + 0.5 ),
+      static_cast< SizeValueType >( 1 ) );
+  }
+
+  if( this->m_TotalTimeBudget > 0.0 )
+  {
+    this->m_ResolutionTimeBudget = costShare * this->m_RemainingTimeBudget;
+
+    /** If the cost observed in the previous resolution predicts that this
+     * resolution does not fit in its time, reduce the number of iterations
+     * and of samples by the same factor.
+     */
+    if( this->m_SecondsPerSampleIteration > 0.0 && this->m_NumberOfSamplesInResolution > 0 )
+    {
+      const double predictedTime = this->m_SecondsPerSampleIteration
+        * static_cast< double >( iterations )
+        * static_cast< double >( this->m_NumberOfSamplesInResolution );
+      if( predictedTime > this->m_ResolutionTimeBudget )
+      {
+        const double factor = vcl_sqrt( this->m_ResolutionTimeBudget / predictedTime );
+        iterations = std::max( static_cast< SizeValueType >(
+          factor * static_cast< double >( iterations ) ), static_cast< SizeValueType >( 1 ) );
+        if( sampler != 0 )
+        {
+          this->m_NumberOfSamplesInResolution = std::max( static_cast< SizeValueType >(
+            factor * static_cast< double >( this->m_NumberOfSamplesInResolution ) ),
+            static_cast< SizeValueType >( 1 ) );
+          sampler->SetNumberOfSamples( this->m_NumberOfSamplesInResolution );
+        }
+      }
+    }
+  }
+
+  elxout << "  Compute budget of this resolution: " << iterations << " iterations";
+  if( this->m_TotalTimeBudget > 0.0 )
+  {
+    elxout << ", " << this->m_ResolutionTimeBudget << " s, "
+           << this->m_NumberOfSamplesInResolution << " samples";
+  }
+  elxout << "." << std::endl;
+
+  return iterations;
+
+} // end DistributeComputeBudget()
+
+
+/**
+ * ****************** ComputeBudgetIsExhausted ********************
+ */
+
+template< class TElastix >
+bool
+OptimizerBase< TElastix >
+::ComputeBudgetIsExhausted( void ) const
+{
+  return this->m_TotalTimeBudget > 0.0
+         && itk::PhaseTimerRegistry::GetTime() - this->m_ResolutionStartTime
+         > this->m_ResolutionTimeBudget;
+
+} // end ComputeBudgetIsExhausted()
+
+
 /**
  * ****************** SetSinusScales ********************
  */
@@ -27,6 +27,11 @@
 /** Mask support. */
 #include "itkImageMaskSpatialObject2.h"
 #include "itkErodeMaskImageFilter.h"
+#include "itkFixedImagePreprocessingCache.h"
+#include "itkExtractImageFilter.h"
+
+/** Block decomposition support. */
+#include "itkBSplineBlockStitcher.h"
 
 namespace elastix
 {
@@ -66,6 +71,48 @@ namespace elastix
  *    from one resolution level to another. Choose from {"true", "false"} \n
  *    example: <tt>(ErodeMovingMask2 "true" "false")</tt>
  *    This setting overrules ErodeMask and ErodeMovingMask.\n
+ * \parameter ErodeMaskAtLevelResolution: a flag to determine if the eroded masks are
+ *    computed on the grid of the resolution level, i.e. the mask image shrunk by the
+ *    pyramid schedule, instead of on the grid of the full resolution mask.
+ *    Choose from {"true", "false"} \n
+ *    example: <tt>(ErodeMaskAtLevelResolution "true")</tt> \n
+ *    The default is "false". The mask of a coarse level is then much smaller, so it is
+ *    faster to erode and takes less memory. A voxel of the shrunk mask is only inside
+ *    when its whole block of the original mask is inside, so the mask is slightly more
+ *    eroded at the edges. The parameter may be specified for each resolution.\n
+ * \parameter CropFixedImageToMask: a flag to determine if the fixed image is cropped
+ *    to the bounding box of the fixed mask (plus a margin), before the fixed image
+ *    pyramid is computed. This saves time and memory when the mask is small compared
+ *    to the image. Choose from {"true", "false"} \n
+ *    example: <tt>(CropFixedImageToMask "true")</tt> \n
+ *    The default is "false". The crop is aligned to the largest default shrink factor,
+ *    2^(NumberOfResolutions-1), so that the pyramid images are defined on the same grid
+ *    as without cropping. The transforms still base their grids, centers of rotation
+ *    and initializations on the full fixed image.\n
+ * \parameter CropFixedImageToMaskMargin: the margin (in voxels of the fixed image)
+ *    that is added around the bounding box of the fixed mask, for each dimension. \n
+ *    example: <tt>(CropFixedImageToMaskMargin 16 16 8)</tt> \n
+ *    The default is 2^(NumberOfResolutions+1), which covers the support of the
+ *    smoothing in the default pyramid schedules, so that the pyramid images inside the
+ *    mask are (almost) the same as without cropping. The margin is also added around
+ *    the block, when the fixed image is decomposed into blocks.\n
+ * \parameter NumberOfBlocks: the number of blocks into which the domain of the fixed
+ *    image is divided along each dimension, to register one block per run. \n
+ *    example: <tt>(NumberOfBlocks 2 2 4)</tt> \n
+ *    The default is 1, so no decomposition. One value sets all dimensions. The block
+ *    (extended by the overlap) is the fixed image region that is sampled, and the
+ *    fixed image is cropped to it, plus the CropFixedImageToMaskMargin, before the
+ *    pyramid is computed. The B-spline grid is still based on the full fixed image,
+ *    so the runs of the blocks can be stitched with itk::BSplineBlockStitcher.\n
+ * \parameter BlockIndex: the block that is registered, numbered in raster order with
+ *    the first dimension running fastest. \n
+ *    example: <tt>(BlockIndex 5)</tt> \n
+ *    The default is 0.\n
+ * \parameter BlockOverlap: the number of voxels of the fixed image by which the block
+ *    is extended on each side, for each dimension. \n
+ *    example: <tt>(BlockOverlap 32 32 16)</tt> \n
+ *    The default is 0. One value sets all dimensions. Use a few B-spline grid spacings,
+ *    so that the control points in the blended zone are determined by both blocks.\n
  *
  * \ingroup Registrations
  * \ingroup ComponentBaseClasses
@@ -210,6 +257,44 @@ protected:
     const MovingMaskImageType * maskImage, bool useMaskErosion,
     const MovingImagePyramidType * pyramid, unsigned int level ) const;
 
+  /** Typedef's for cropping the fixed image. */
+  typedef itk::ExtractImageFilter< FixedImageType, FixedImageType > FixedImageCropFilterType;
+  typedef typename FixedImageCropFilterType::Pointer                FixedImageCropFilterPointer;
+
+  /** Crop the fixed image to the bounding box of the mask, plus a margin,
+   * if the parameter CropFixedImageToMask is "true":
+   * \li the fixed image;
+   * \li the fixed mask (may be 0).
+   * Output:
+   * \li the cropped fixed image, or the fixed image itself when no cropping is
+   * wanted, or possible.
+   *
+   * The cropped image keeps the index of the crop region, so that the physical
+   * coordinates of its voxels are the same as in the fixed image.
+   * This function is used by the registration components, to set the input of
+   * the fixed image pyramid.
+   */
+  const FixedImageType * GenerateCroppedFixedImage(
+    FixedImageType * fixedImage, FixedMaskImageType * maskImage );
+
+  /** Restrict a region of the fixed image to the block that is registered, if
+   * the domain of the fixed image is decomposed into NumberOfBlocks blocks:
+   * \li the fixed image, before cropping, which defines the domain;
+   * \li the region.
+   * Output:
+   * \li the intersection of the region and the block, extended by the
+   * BlockOverlap, or the region itself without decomposition.
+   *
+   * This function is used by the registration components, to set the fixed
+   * image region.
+   */
+  typename FixedImageType::RegionType GenerateFixedImageBlockRegion(
+    const FixedImageType * fixedImage,
+    const typename FixedImageType::RegionType & region ) const;
+
+  /** The crop filters, which keep the cropped fixed images alive. */
+  std::vector< FixedImageCropFilterPointer > m_FixedImageCropFilters;
+
 private:
 
   /** The private constructor. */
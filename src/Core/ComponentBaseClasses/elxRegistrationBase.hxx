@@ -20,6 +20,8 @@
 
 #include "elxRegistrationBase.h"
 
+#include <sstream>
+
 namespace elastix
 {
 
@@ -118,12 +120,34 @@ RegistrationBase< TElastix >
     return fixedMaskSpatialObject;
   }
 
+  /** Check whether the mask should be eroded on the grid of the level. */
+  bool useLevelResolution = false;
+  this->GetConfiguration()->ReadParameter( useLevelResolution,
+    "ErodeMaskAtLevelResolution", "", level, 0, false );
+
+  /** Take the eroded mask from the fixed image preprocessing cache, if it
+   * was computed before for the same mask and schedule.
+   */
+  itk::FixedImagePreprocessingCache::Pointer cache
+    = itk::FixedImagePreprocessingCache::GetInstance();
+  std::ostringstream cacheKey( "" );
+  cacheKey << "ErodedFixedMask schedule " << pyramid->GetSchedule() << " level " << level
+           << " levelresolution " << useLevelResolution;
+  itk::Object::Pointer cachedObject = cache->Find( maskImage, cacheKey.str() );
+  FixedMaskImageType * cachedMask   = dynamic_cast< FixedMaskImageType * >( cachedObject.GetPointer() );
+  if( cachedMask )
+  {
+    fixedMaskSpatialObject->SetImage( cachedMask );
+    return fixedMaskSpatialObject;
+  }
+
   /** Erode, and convert to spatial object. */
   FixedMaskErodeFilterPointer erosion = FixedMaskErodeFilterType::New();
   erosion->SetInput( maskImage );
   erosion->SetSchedule( pyramid->GetSchedule() );
   erosion->SetIsMovingMask( false );
   erosion->SetResolutionLevel( level );
+  erosion->SetUseLevelResolution( useLevelResolution );
 
   /** Set output of the erosion to fixedImageMaskAsImage. */
   FixedMaskImagePointer erodedFixedMaskAsImage = erosion->GetOutput();
@@ -146,6 +170,7 @@ RegistrationBase< TElastix >
 
   /** Release some memory. */
   erodedFixedMaskAsImage->DisconnectPipeline();
+  cache->Store( maskImage, cacheKey.str(), erodedFixedMaskAsImage );
 
   fixedMaskSpatialObject->SetImage( erodedFixedMaskAsImage );
   return fixedMaskSpatialObject;
@@ -178,12 +203,18 @@ RegistrationBase< TElastix >
     return movingMaskSpatialObject;
   }
 
+  /** Check whether the mask should be eroded on the grid of the level. */
+  bool useLevelResolution = false;
+  this->GetConfiguration()->ReadParameter( useLevelResolution,
+    "ErodeMaskAtLevelResolution", "", level, 0, false );
+
   /** Erode, and convert to spatial object. */
   MovingMaskErodeFilterPointer erosion = MovingMaskErodeFilterType::New();
   erosion->SetInput( maskImage );
   erosion->SetSchedule( pyramid->GetSchedule() );
   erosion->SetIsMovingMask( true );
   erosion->SetResolutionLevel( level );
+  erosion->SetUseLevelResolution( useLevelResolution );
 
   /** Set output of the erosion to movingImageMaskAsImage. */
   MovingMaskImagePointer erodedMovingMaskAsImage = erosion->GetOutput();
@@ -213,6 +244,224 @@ RegistrationBase< TElastix >
 } // end GenerateMovingMaskSpatialObject()
 
 
+/**
+ * ******************* GenerateCroppedFixedImage **********************
+ */
+
+template< class TElastix >
+const typename RegistrationBase< TElastix >::FixedImageType *
+RegistrationBase< TElastix >
+::GenerateCroppedFixedImage(
+  FixedImageType * fixedImage, FixedMaskImageType * maskImage )
+{
+  typedef typename FixedImageType::RegionType          FixedImageRegionType;
+  typedef typename FixedImageType::IndexType           FixedImageIndexType;
+  typedef typename FixedImageType::SizeType            FixedImageSizeType;
+  typedef typename FixedImageType::PointType           FixedImagePointType;
+  typedef typename FixedMaskImageType::RegionType      MaskRegionType;
+  typedef typename FixedMaskImageType::IndexType       MaskIndexType;
+  typedef itk::ContinuousIndex< double, FixedImageDimension > ContinuousIndexType;
+
+  /** Check if cropping is wanted, and possible. The fixed image is also cropped
+   * to the block that is registered, if its domain is decomposed into blocks.
+   */
+  bool cropFixedImageToMask = false;
+  this->m_Configuration->ReadParameter( cropFixedImageToMask,
+    "CropFixedImageToMask", 0, false );
+  cropFixedImageToMask &= ( maskImage != 0 );
+  if( !fixedImage )
+  {
+    return fixedImage;
+  }
+  fixedImage->UpdateOutputInformation();
+  const FixedImageRegionType & domain = fixedImage->GetLargestPossibleRegion();
+  const FixedImageRegionType   blockRegion
+    = this->GenerateFixedImageBlockRegion( fixedImage, domain );
+  const bool useBlocks = blockRegion != domain;
+  if( !cropFixedImageToMask && !useBlocks )
+  {
+    return fixedImage;
+  }
+
+  /** Make sure the fixed image and the mask are up to date. */
+  fixedImage->Update();
+  const FixedImageRegionType & bufferedRegion = fixedImage->GetBufferedRegion();
+
+  /** Start with the bounds of the buffered region, in the index space of the
+   * fixed image. */
+  double lower[ FixedImageDimension ];
+  double upper[ FixedImageDimension ];
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    lower[ d ] = static_cast< double >( bufferedRegion.GetIndex()[ d ] );
+    upper[ d ] = lower[ d ] + static_cast< double >( bufferedRegion.GetSize()[ d ] ) - 1.0;
+  }
+
+  if( cropFixedImageToMask )
+  {
+    maskImage->Update();
+
+    /** Get the bounding box of the mask, in the index space of the mask. */
+    FixedMaskSpatialObjectPointer maskSpatialObject = FixedMaskSpatialObjectType::New();
+    maskSpatialObject->SetImage( maskImage );
+    const MaskRegionType maskBox = maskSpatialObject->GetAxisAlignedBoundingBoxRegion();
+    if( maskBox.GetNumberOfPixels() == 0 && !useBlocks )
+    {
+      return fixedImage;
+    }
+
+    /** Map the corners of the box to the index space of the fixed image. */
+    if( maskBox.GetNumberOfPixels() > 0 )
+    {
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        lower[ d ] = itk::NumericTraits< double >::max();
+        upper[ d ] = itk::NumericTraits< double >::NonpositiveMin();
+      }
+      for( unsigned int corner = 0; corner < ( 1u << FixedImageDimension ); ++corner )
+      {
+        MaskIndexType cornerIndex = maskBox.GetIndex();
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
+        {
+          if( ( corner >> d ) & 1 )
+          {
+            cornerIndex[ d ] += maskBox.GetSize()[ d ] - 1;
+          }
+        }
+        FixedImagePointType point;
+        ContinuousIndexType cindex;
+        maskImage->TransformIndexToPhysicalPoint( cornerIndex, point );
+        fixedImage->TransformPhysicalPointToContinuousIndex( point, cindex );
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
+        {
+          lower[ d ] = vnl_math_min( lower[ d ], cindex[ d ] );
+          upper[ d ] = vnl_math_max( upper[ d ], cindex[ d ] );
+        }
+      }
+    }
+  }
+
+  /** Restrict the bounds to the block. */
+  if( useBlocks )
+  {
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      const double blockLower = static_cast< double >( blockRegion.GetIndex()[ d ] );
+      lower[ d ] = vnl_math_max( lower[ d ], blockLower );
+      upper[ d ] = vnl_math_min( upper[ d ],
+        blockLower + static_cast< double >( blockRegion.GetSize()[ d ] ) - 1.0 );
+    }
+  }
+
+  /** Read the margin, and determine the alignment of the crop region. */
+  unsigned int numberOfResolutions = 3;
+  this->m_Configuration->ReadParameter( numberOfResolutions, "NumberOfResolutions", 0, false );
+  numberOfResolutions = vnl_math_max( numberOfResolutions, 1u );
+  const long alignment = 1L << ( numberOfResolutions - 1 );
+
+  /** Add the margin, align the start to the shrink factor, and crop to the buffered region. */
+  FixedImageIndexType cropIndex;
+  FixedImageSizeType  cropSize;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    long margin = 2L << numberOfResolutions;
+    this->m_Configuration->ReadParameter( margin, "CropFixedImageToMaskMargin", d, false );
+
+    const long bufferedStart = bufferedRegion.GetIndex()[ d ];
+    const long bufferedEnd   = bufferedStart + static_cast< long >( bufferedRegion.GetSize()[ d ] ) - 1;
+
+    long start = vnl_math_max( static_cast< long >( vcl_floor( lower[ d ] ) ) - margin, bufferedStart );
+    start = bufferedStart + ( ( start - bufferedStart ) / alignment ) * alignment;
+    const long end = vnl_math_min( static_cast< long >( vcl_ceil( upper[ d ] ) ) + margin, bufferedEnd );
+    if( end < start )
+    {
+      return fixedImage;
+    }
+
+    cropIndex[ d ] = start;
+    cropSize[ d ]  = static_cast< typename FixedImageSizeType::SizeValueType >( end - start + 1 );
+  }
+  FixedImageRegionType cropRegion( cropIndex, cropSize );
+
+  /** Crop the fixed image. */
+  FixedImageCropFilterPointer cropFilter = FixedImageCropFilterType::New();
+  cropFilter->SetInput( fixedImage );
+  cropFilter->SetExtractionRegion( cropRegion );
+  cropFilter->SetDirectionCollapseToSubmatrix();
+  try
+  {
+    cropFilter->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "RegistrationBase - GenerateCroppedFixedImage()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError while cropping the fixed image to the fixed mask.\n";
+    excp.SetDescription( err_str );
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+  this->m_FixedImageCropFilters.push_back( cropFilter );
+
+  elxout << "The fixed image is cropped to the region " << cropIndex
+         << " with size " << cropSize << " (was " << bufferedRegion.GetSize()
+         << ")." << std::endl;
+
+  return cropFilter->GetOutput();
+
+} // end GenerateCroppedFixedImage()
+
+
+/**
+ * ******************* GenerateFixedImageBlockRegion **********************
+ */
+
+template< class TElastix >
+typename RegistrationBase< TElastix >::FixedImageType::RegionType
+RegistrationBase< TElastix >
+::GenerateFixedImageBlockRegion(
+  const FixedImageType * fixedImage,
+  const typename FixedImageType::RegionType & region ) const
+{
+  typedef typename FixedImageType::RegionType FixedImageRegionType;
+  typedef itk::BSplineBlockStitcher< double, FixedImageDimension > BlockStitcherType;
+  typedef typename BlockStitcherType::SizeType                     BlockSizeType;
+
+  /** Read the decomposition; a single value holds for all dimensions. */
+  BlockSizeType numberOfBlocks;
+  BlockSizeType overlap;
+  numberOfBlocks.Fill( 1 );
+  overlap.Fill( 0 );
+  this->m_Configuration->ReadParameter( numberOfBlocks[ 0 ], "NumberOfBlocks", 0, false );
+  this->m_Configuration->ReadParameter( overlap[ 0 ], "BlockOverlap", 0, false );
+  for( unsigned int d = 1; d < FixedImageDimension; ++d )
+  {
+    numberOfBlocks[ d ] = numberOfBlocks[ 0 ];
+    overlap[ d ]        = overlap[ 0 ];
+    this->m_Configuration->ReadParameter( numberOfBlocks[ d ], "NumberOfBlocks", d, false );
+    this->m_Configuration->ReadParameter( overlap[ d ], "BlockOverlap", d, false );
+  }
+  if( BlockStitcherType::GetTotalNumberOfBlocks( numberOfBlocks ) < 2 )
+  {
+    return region;
+  }
+  itk::SizeValueType blockIndex = 0;
+  this->m_Configuration->ReadParameter( blockIndex, "BlockIndex", 0, false );
+
+  /** Intersect the region with the block. */
+  FixedImageRegionType blockRegion = BlockStitcherType::ComputeBlockRegion(
+    fixedImage->GetLargestPossibleRegion(), numberOfBlocks, blockIndex, overlap );
+  if( !blockRegion.Crop( region ) )
+  {
+    itkExceptionMacro( << "ERROR: block " << blockIndex
+                       << " does not overlap the fixed image region " << region << "." );
+  }
+  return blockRegion;
+
+} // end GenerateFixedImageBlockRegion()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxRegistrationBase_hxx
@@ -24,6 +24,8 @@
 #include "elxBaseComponentSE.h"
 #include "itkResampleImageFilter.h"
 #include "elxProgressCommand.h"
+#include "itkPhaseTimer.h"
+#include "itkMappedCoordinateField.h"
 
 namespace elastix
 {
@@ -64,6 +66,58 @@ namespace elastix
  *    of the written image is desired.\n
  *    example: <tt>(CompressResultImage "true")</tt> \n
  *    The default is "false".
+ * \parameter ParallelResultImageCompression: parameter to compress a result
+ *    image in the MetaImage format (mhd or mha) in blocks, on all threads. The
+ *    file is a standard compressed MetaImage.\n
+ *    example: <tt>(ParallelResultImageCompression "true")</tt> \n
+ *    The default is "false".
+ * \parameter ResultImageCompressionLevel: the zlib level of the parallel
+ *    compression, from 1 (fastest) to 9 (smallest).\n
+ *    example: <tt>(ResultImageCompressionLevel 1)</tt> \n
+ *    The default is 6.
+ * \parameter BakeTransformIntoDeformationField: parameter to evaluate the complete
+ *    transform, including all initial transforms, once on the output grid. The
+ *    resulting deformation field is then used for the resampling, which is
+ *    cheaper when the transform is a chain of several B-splines, and when
+ *    the same transform is used for several resamplings.\n
+ *    example: <tt>(BakeTransformIntoDeformationField "true")</tt> \n
+ *    The default is "false".
+ * \parameter BakedDeformationFieldComponentType: the component type of the baked
+ *    deformation field. Choose from {"float", "double"}.\n
+ *    example: <tt>(BakedDeformationFieldComponentType "double")</tt> \n
+ *    The default is "float".
+ * \parameter NumberOfResultImageSlabs: parameter to resample and write the result
+ *    image in slabs along the last dimension, for output images that do not fit
+ *    in memory. For each slab only the part of the moving image that it maps to
+ *    is used, so the B-spline coefficients of the FinalBSplineInterpolator are
+ *    computed per slab too. The slabs are pasted into the file, which requires a
+ *    ResultImageFormat that supports streamed writing, such as mhd or nrrd, and
+ *    disables CompressResultImage. Otherwise the image is written in one piece.
+ *    Note that BakeTransformIntoDeformationField still needs a deformation field
+ *    of the full output size.\n
+ *    example: <tt>(NumberOfResultImageSlabs 16)</tt> \n
+ *    The default is 1, i.e. no slabs.
+ * \parameter ResultImageSlabPadding: the number of voxels by which the part of the
+ *    moving image of a slab is extended, for the support of the interpolator and
+ *    the boundary effects of the B-spline coefficients.\n
+ *    example: <tt>(ResultImageSlabPadding 12)</tt> \n
+ *    The default is 8.
+ * \parameter CacheMappedCoordinates: parameter to compute, for every voxel of the
+ *    output grid, the position in the moving image that the transform maps it to
+ *    only once, and keep it for the next resamplings of images with the same
+ *    geometry through the same transform, e.g. the jobs of a transformix batch.
+ *    These then only interpolate. The positions of the last resampling are kept
+ *    in the process until other positions replace them. Not used with the
+ *    RayCastResampleInterpolator, or when NumberOfResultImageSlabs is larger
+ *    than 1; BakeTransformIntoDeformationField is then not needed.\n
+ *    example: <tt>(CacheMappedCoordinates "true")</tt> \n
+ *    The default is "false".
+ * \parameter MappedCoordinatesStorage: the storage of the cached positions, both
+ *    in 4 bytes per dimension per voxel. Choose from "float", with a relative
+ *    precision, and "IntegerAndFraction", with a fixed precision of 1/65536
+ *    voxel, which requires a moving image of at most 32767 voxels per dimension.\n
+ *    example: <tt>(MappedCoordinatesStorage "IntegerAndFraction")</tt> \n
+ *    The default is "float".
  *
  * \ingroup Resamplers
  * \ingroup ComponentBaseClasses
@@ -102,6 +156,7 @@ public:
 
   /** Typedef's from ResampleImageFiler. */
   typedef typename ITKBaseType::TransformType    TransformType;
+  typedef typename TransformType::Pointer        TransformPointer;
   typedef typename ITKBaseType::InterpolatorType InterpolatorType;
   typedef typename ITKBaseType::SizeType         SizeType;
   typedef typename ITKBaseType::IndexType        IndexType;
@@ -116,6 +171,11 @@ public:
   /** Typedef for the ProgressCommand. */
   typedef elx::ProgressCommand ProgressCommandType;
 
+  /** Typedef for the cached mapped coordinates. */
+  typedef itk::MappedCoordinateField<
+    OutputImageType::ImageDimension, CoordRepType >   MappedCoordinateFieldType;
+  typedef typename MappedCoordinateFieldType::Pointer MappedCoordinateFieldPointer;
+
   /** Get the ImageDimension. */
   itkStaticConstMacro( ImageDimension, unsigned int,
     OutputImageType::ImageDimension );
@@ -174,6 +234,10 @@ public:
   /** Function to perform resample and write the result output image to a file. */
   virtual void ResampleAndWriteResultImage( const char * filename, const bool & showProgress = true );
 
+  /** Function to resample and write the result output image in slabs. */
+  virtual void ResampleAndWriteResultImageInSlabs( const char * filename,
+    const unsigned int numberOfSlabs, const bool & showProgress = true );
+
   /** Function to write the result output image to a file. */
   virtual void WriteResultImage( OutputImageType * imageimage,
     const char * filename, const bool & showProgress = true );
@@ -191,6 +255,17 @@ protected:
   /** Method that sets the transform, the interpolator and the inputImage. */
   virtual void SetComponents( void );
 
+  /** If requested, replace the transform of the resampler by a deformation
+   * field, that is computed once on the output grid.
+   */
+  virtual void BakeTransformIntoDeformationField( void );
+
+  /** If requested, resample the moving image into \a output via the cached
+   * mapped coordinates, see the parameter CacheMappedCoordinates. Returns
+   * false if they are not used.
+   */
+  virtual bool ResampleWithMappedCoordinates( typename OutputImageType::Pointer & output );
+
   /** Variable that defines to print the progress or not. */
   bool m_ShowProgress;
 
@@ -204,6 +279,31 @@ private:
   /** Release memory. */
   void ReleaseMemory( void );
 
+  /** Compute the region of the moving image that the output region \a slab
+   * maps to, padded by \a padding voxels. Returns false if it lies outside.
+   * The region is an index region of \a movingImage, which should be the
+   * complete moving image, not the part that the resampler got for the
+   * previous slab.
+   */
+  bool ComputeInputRegionOfSlab( const InputImageType * movingImage,
+    const typename OutputImageType::RegionType & slab,
+    const unsigned int padding, typename InputImageType::RegionType & inputRegion );
+
+  /** Compute a deformation field transform with component type TComponent. */
+  template< class TComponent >
+  TransformPointer BakeTransform( const TransformType * transform ) const;
+
+  /** Returns the mapped coordinate field of the transform, from the output grid
+   * to the moving image; the field of the previous call is reused if it is valid.
+   */
+  MappedCoordinateFieldPointer GetMappedCoordinateField( const TransformType * transform,
+    const OutputImageType * outputGrid, const InputImageType * movingImage,
+    const typename MappedCoordinateFieldType::StorageType storage ) const;
+
+  /** The baked transform, and the modification time of the transform it was computed from. */
+  TransformPointer m_BakedTransform;
+  unsigned long    m_BakedTransformMTime;
+
 };
 
 } // end namespace elastix
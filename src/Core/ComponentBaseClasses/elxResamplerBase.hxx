@@ -21,9 +21,21 @@
 #include "elxResamplerBase.h"
 
 #include "itkImageFileCastWriter.h"
+#include "itkCastImageFilter.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkDeformationFieldInterpolatingTransform.h"
+#include "itkTransformToDisplacementFieldFilter.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkBackgroundWriter.h"
+#include "itkImageIOFactory.h"
+#include "itkImageIORegion.h"
 #include "itkTimeProbe.h"
+#include "itkSimpleFastMutexLock.h"
+#include <itksys/SystemTools.hxx>
+#include <algorithm>
+#include <cmath>
 
 namespace elastix
 {
@@ -36,7 +48,8 @@ template< class TElastix >
 ResamplerBase< TElastix >
 ::ResamplerBase()
 {
-  this->m_ShowProgress = true;
+  this->m_ShowProgress        = true;
+  this->m_BakedTransformMTime = 0;
 } // end Constructor
 
 
@@ -314,6 +327,261 @@ ResamplerBase< TElastix >
 } // end SetComponents()
 
 
+/**
+ * ******************* BakeTransformIntoDeformationField ********************
+ */
+
+template< class TElastix >
+void
+ResamplerBase< TElastix >
+::BakeTransformIntoDeformationField( void )
+{
+  bool bakeTransform = false;
+  this->m_Configuration->ReadParameter( bakeTransform,
+    "BakeTransformIntoDeformationField", 0, false );
+  if( !bakeTransform ) { return; }
+
+  /** The RayCastResampleInterpolator uses the transform itself. */
+  typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType,
+    CoordRepType > RayCastInterpolatorType;
+  if( dynamic_cast< const RayCastInterpolatorType * >(
+    this->GetAsITKBaseType()->GetInterpolator() ) )
+  {
+    return;
+  }
+
+  const TransformType * transform = dynamic_cast< const TransformType * >(
+    this->m_Elastix->GetElxTransformBase() );
+  if( !transform ) { return; }
+
+  /** Only recompute the deformation field when the transform changed. */
+  const unsigned long mtime = transform->GetMTime();
+  if( this->m_BakedTransform.IsNull() || this->m_BakedTransformMTime != mtime )
+  {
+    std::string componentType = "float";
+    this->m_Configuration->ReadParameter( componentType,
+      "BakedDeformationFieldComponentType", 0, false );
+
+    elxout << "  Baking the transform into a deformation field ..." << std::endl;
+    itk::TimeProbe timer;
+    timer.Start();
+    if( componentType == "double" )
+    {
+      this->m_BakedTransform = this->BakeTransform< double >( transform );
+    }
+    else
+    {
+      this->m_BakedTransform = this->BakeTransform< float >( transform );
+    }
+    timer.Stop();
+    elxout << "  Baking the transform took: "
+           << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+
+    this->m_BakedTransformMTime = mtime;
+  }
+
+  this->GetAsITKBaseType()->SetTransform( this->m_BakedTransform );
+
+} // end BakeTransformIntoDeformationField()
+
+
+/**
+ * ******************* BakeTransform ********************
+ */
+
+template< class TElastix >
+template< class TComponent >
+typename ResamplerBase< TElastix >::TransformPointer
+ResamplerBase< TElastix >
+::BakeTransform( const TransformType * transform ) const
+{
+  typedef itk::DeformationFieldInterpolatingTransform<
+    CoordRepType, itkGetStaticConstMacro( ImageDimension ),
+    TComponent >                                      BakedTransformType;
+  typedef typename BakedTransformType::DeformationFieldType DeformationFieldType;
+  typedef itk::TransformToDisplacementFieldFilter<
+    DeformationFieldType, CoordRepType >              DeformationFieldGeneratorType;
+
+  /** Evaluate the transform on the output grid of the resampler. */
+  const ITKBaseType * resampler = this->GetAsITKBaseType();
+  typename DeformationFieldGeneratorType::Pointer generator
+    = DeformationFieldGeneratorType::New();
+  generator->SetSize( resampler->GetSize() );
+  generator->SetOutputSpacing( resampler->GetOutputSpacing() );
+  generator->SetOutputOrigin( resampler->GetOutputOrigin() );
+  generator->SetOutputStartIndex( resampler->GetOutputStartIndex() );
+  generator->SetOutputDirection( resampler->GetOutputDirection() );
+  generator->SetTransform( transform );
+  generator->Update();
+
+  /** The field is sampled at the output voxels, so that the (default)
+   * nearest neighbour interpolation returns the exact displacements.
+   */
+  typename BakedTransformType::Pointer bakedTransform = BakedTransformType::New();
+  bakedTransform->SetDeformationField( generator->GetOutput() );
+
+  return bakedTransform.GetPointer();
+
+} // end BakeTransform()
+
+
+/**
+ * ******************* ResampleWithMappedCoordinates ********************
+ */
+
+template< class TElastix >
+bool
+ResamplerBase< TElastix >
+::ResampleWithMappedCoordinates( typename OutputImageType::Pointer & output )
+{
+  bool cacheMappedCoordinates = false;
+  this->m_Configuration->ReadParameter( cacheMappedCoordinates,
+    "CacheMappedCoordinates", 0, false );
+  if( !cacheMappedCoordinates ) { return false; }
+
+  /** Slabs are resampled from a part of the moving image. */
+  unsigned int numberOfSlabs = 1;
+  this->m_Configuration->ReadParameter( numberOfSlabs,
+    "NumberOfResultImageSlabs", 0, false );
+  if( numberOfSlabs > 1 ) { return false; }
+
+  /** The RayCastResampleInterpolator uses the transform itself. */
+  typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType,
+    CoordRepType > RayCastInterpolatorType;
+  InterpolatorType * interpolator = dynamic_cast< InterpolatorType * >(
+    this->m_Elastix->GetElxResampleInterpolatorBase() );
+  const TransformType * transform = dynamic_cast< const TransformType * >(
+    this->m_Elastix->GetElxTransformBase() );
+  const InputImageType * movingImage = this->GetAsITKBaseType()->GetInput();
+  if( !interpolator || !transform || !movingImage
+    || dynamic_cast< const RayCastInterpolatorType * >( interpolator ) )
+  {
+    return false;
+  }
+
+  std::string storageName = "float";
+  this->m_Configuration->ReadParameter( storageName,
+    "MappedCoordinatesStorage", 0, false );
+  typename MappedCoordinateFieldType::StorageType storage
+    = MappedCoordinateFieldType::FloatStorage;
+  if( storageName == "IntegerAndFraction" )
+  {
+    storage = MappedCoordinateFieldType::IntegerAndFractionStorage;
+  }
+  else if( storageName != "float" )
+  {
+    itkExceptionMacro( << "MappedCoordinatesStorage must be \"float\" or "
+                       << "\"IntegerAndFraction\", but was \"" << storageName << "\"." );
+  }
+
+  /** The output grid of the resampler. */
+  const ITKBaseType * resampler = this->GetAsITKBaseType();
+  output = OutputImageType::New();
+  output->SetRegions( typename OutputImageType::RegionType(
+    resampler->GetOutputStartIndex(), resampler->GetSize() ) );
+  output->SetOrigin( resampler->GetOutputOrigin() );
+  output->SetSpacing( resampler->GetOutputSpacing() );
+  output->SetDirection( resampler->GetOutputDirection() );
+
+  try
+  {
+    MappedCoordinateFieldPointer field = this->GetMappedCoordinateField(
+      transform, output, movingImage, storage );
+
+    /** Only interpolate. Nearest neighbour interpolation, e.g. of label
+     * images, copies the pixels without the interpolator.
+     */
+    typedef itk::NearestNeighborInterpolateImageFunction<
+      InputImageType, CoordRepType >                  NearestNeighborInterpolatorType;
+    itk::TimeProbe timer;
+    timer.Start();
+    output->Allocate();
+    if( dynamic_cast< const NearestNeighborInterpolatorType * >( interpolator ) )
+    {
+      field->ResampleNearestNeighbor( movingImage,
+        resampler->GetDefaultPixelValue(), output.GetPointer() );
+    }
+    else
+    {
+      interpolator->SetInputImage( movingImage );
+      field->Resample( interpolator, resampler->GetDefaultPixelValue(), output.GetPointer() );
+    }
+    timer.Stop();
+    elxout << "  Resampling via the mapped coordinates took: "
+           << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "ResamplerBase - ResampleWithMappedCoordinates()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while resampling the image.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+
+  return true;
+
+} // end ResampleWithMappedCoordinates()
+
+
+/**
+ * ******************* GetMappedCoordinateField ********************
+ */
+
+template< class TElastix >
+typename ResamplerBase< TElastix >::MappedCoordinateFieldPointer
+ResamplerBase< TElastix >
+::GetMappedCoordinateField( const TransformType * transform,
+  const OutputImageType * outputGrid, const InputImageType * movingImage,
+  const typename MappedCoordinateFieldType::StorageType storage ) const
+{
+  /** The field is shared by the resamplers of the process, so that the next
+   * runs of a transformix batch find it. A field is not modified once it has
+   * been computed, so it may be used by several resamplers at once.
+   */
+  static itk::SimpleFastMutexLock     sharedFieldLock;
+  static MappedCoordinateFieldPointer sharedField;
+
+  sharedFieldLock.Lock();
+  MappedCoordinateFieldPointer field = sharedField;
+  sharedFieldLock.Unlock();
+
+  if( field.IsNotNull() && field->GetStorage() == storage
+    && field->IsValidFor( transform, outputGrid, movingImage ) )
+  {
+    elxout << "  The mapped coordinates of the previous resampling are reused." << std::endl;
+    return field;
+  }
+
+  /** Release the previous field before the new one is computed. */
+  field = 0;
+  sharedFieldLock.Lock();
+  sharedField = 0;
+  sharedFieldLock.Unlock();
+
+  elxout << "  Computing the mapped coordinates ..." << std::endl;
+  itk::TimeProbe timer;
+  timer.Start();
+  field = MappedCoordinateFieldType::New();
+  field->SetStorage( storage );
+  field->Compute( transform, outputGrid, movingImage );
+  timer.Stop();
+  elxout << "  Computing the mapped coordinates took: "
+         << this->ConvertSecondsToDHMS( timer.GetMean(), 2 )
+         << ", they use " << field->GetNumberOfBytes() / 1048576 << " MB." << std::endl;
+
+  sharedFieldLock.Lock();
+  sharedField = field;
+  sharedFieldLock.Unlock();
+
+  return field;
+
+} // end GetMappedCoordinateField()
+
+
 /**
  * ******************* ResampleAndWriteResultImage ********************
  */
@@ -323,6 +591,34 @@ void
 ResamplerBase< TElastix >
 ::ResampleAndWriteResultImage( const char * filename, const bool & showProgress )
 {
+  itkPhaseTimerMacro( "ResampleAndWriteResultImage" );
+
+  /** Possibly resample via the cached mapped coordinates. */
+  typename OutputImageType::Pointer resampledImage;
+  if( this->ResampleWithMappedCoordinates( resampledImage ) )
+  {
+    this->WriteResultImage( resampledImage, filename, showProgress );
+    return;
+  }
+
+  /** Possibly replace the transform by a deformation field. */
+  this->BakeTransformIntoDeformationField();
+
+  /** Possibly resample and write the image in slabs. The RayCastResampleInterpolator
+   * replaces the transform of the resampler, so it is always done in one piece.
+   */
+  typedef itk::AdvancedRayCastInterpolateImageFunction<  InputImageType,
+    CoordRepType > RayCastInterpolatorType;
+  unsigned int numberOfSlabs = 1;
+  this->m_Configuration->ReadParameter( numberOfSlabs,
+    "NumberOfResultImageSlabs", 0, false );
+  if( numberOfSlabs > 1 && !dynamic_cast< const RayCastInterpolatorType * >(
+    this->GetAsITKBaseType()->GetInterpolator() ) )
+  {
+    this->ResampleAndWriteResultImageInSlabs( filename, numberOfSlabs, showProgress );
+    return;
+  }
+
   /** Make sure the resampler is updated. */
   this->GetAsITKBaseType()->Modified();
 
@@ -368,6 +664,242 @@ ResamplerBase< TElastix >
 } // end ResampleAndWriteResultImage()
 
 
+/**
+ * ******************* ResampleAndWriteResultImageInSlabs ********************
+ */
+
+template< class TElastix >
+void
+ResamplerBase< TElastix >
+::ResampleAndWriteResultImageInSlabs( const char * filename,
+  const unsigned int numberOfSlabs, const bool & showProgress )
+{
+  typedef typename InputImageType::RegionType  InputRegionType;
+  typedef typename OutputImageType::RegionType OutputRegionType;
+
+  /** Read the same settings as WriteResultImage(). */
+  std::string resultImagePixelType = "short";
+  this->m_Configuration->ReadParameter( resultImagePixelType,
+    "ResultImagePixelType", 0, false );
+  std::basic_string< char >::size_type       pos  = resultImagePixelType.find( " " );
+  const std::basic_string< char >::size_type npos = std::basic_string< char >::npos;
+  if( pos != npos ) { resultImagePixelType.replace( pos, 1, "_" ); }
+
+  unsigned int padding = 8;
+  this->m_Configuration->ReadParameter( padding,
+    "ResultImageSlabPadding", 0, false );
+
+  /** The slabs are pasted into the file, which the image IO must support.
+   * Compressed files can not be written in pieces.
+   */
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+    filename, itk::ImageIOFactory::WriteMode );
+  if( imageIO.IsNull() || !imageIO->CanStreamWrite() )
+  {
+    xl::xout[ "warning" ] << "WARNING: the format of " << filename
+                          << " does not support writing in slabs.\n"
+                          << "  The result image is resampled in one piece." << std::endl;
+
+    this->GetAsITKBaseType()->Modified();
+    this->GetAsITKBaseType()->Update();
+    this->WriteResultImage( this->GetAsITKBaseType()->GetOutput(), filename, showProgress );
+    return;
+  }
+  bool doCompression = false;
+  this->m_Configuration->ReadParameter(
+    doCompression, "CompressResultImage", 0, false );
+  if( doCompression )
+  {
+    xl::xout[ "warning" ] << "WARNING: CompressResultImage is ignored when the result "
+                          << "image is written in slabs." << std::endl;
+  }
+
+  /** The output geometry, and the slabs along the last dimension. */
+  ITKBaseType * resampler = this->GetAsITKBaseType();
+  resampler->UpdateOutputInformation();
+  const OutputRegionType   outputRegion = resampler->GetOutput()->GetLargestPossibleRegion();
+  const unsigned int       lastDim      = ImageDimension - 1;
+  const itk::SizeValueType lastSize     = outputRegion.GetSize( lastDim );
+  const itk::SizeValueType slabs        = std::min< itk::SizeValueType >( numberOfSlabs, lastSize );
+
+  /** Setup the writer as in WriteResultImage(). */
+  typedef itk::ImageFileCastWriter< OutputImageType > WriterType;
+  typedef itk::ChangeInformationImageFilter<
+    OutputImageType >                                 ChangeInfoFilterType;
+  typedef itk::RegionOfInterestImageFilter<
+    InputImageType, InputImageType >                  RegionOfInterestFilterType;
+
+  typename ChangeInfoFilterType::Pointer infoChanger = ChangeInfoFilterType::New();
+  DirectionType originalDirection;
+  bool          retdc = this->GetElastix()->GetOriginalFixedImageDirection( originalDirection );
+  infoChanger->SetOutputDirection( originalDirection );
+  infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
+  infoChanger->SetInput( resampler->GetOutput() );
+
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( infoChanger->GetOutput() );
+  writer->SetFileName( filename );
+  writer->SetImageIO( imageIO );
+  writer->SetOutputComponentType( resultImagePixelType.c_str() );
+  writer->SetUseCompression( false );
+
+  /** A previous file would be pasted into. */
+  itksys::SystemTools::RemoveFile( filename );
+
+  /** Resample and write the slabs. The resampler only sees the part of the
+   * moving image that a slab maps to, so that the interpolator, e.g. the
+   * B-spline coefficients, only covers that part.
+   */
+  typename InputImageType::ConstPointer movingImage = resampler->GetInput();
+  typename RegionOfInterestFilterType::Pointer roiFilter = RegionOfInterestFilterType::New();
+  roiFilter->SetInput( movingImage );
+  if( showProgress )
+  {
+    xl::xout[ "coutonly" ] << "  Resampling and writing " << slabs << " slabs ..." << std::endl;
+  }
+  try
+  {
+    for( itk::SizeValueType s = 0; s < slabs; ++s )
+    {
+      OutputRegionType         slab      = outputRegion;
+      const itk::SizeValueType slabBegin = lastSize * s / slabs;
+      const itk::SizeValueType slabEnd   = lastSize * ( s + 1 ) / slabs;
+      slab.SetIndex( lastDim, outputRegion.GetIndex( lastDim ) + slabBegin );
+      slab.SetSize( lastDim, slabEnd - slabBegin );
+
+      /** If the slab maps outside the moving image, a single voxel suffices,
+       * since all samples get the default pixel value.
+       */
+      InputRegionType inputRegion;
+      if( !this->ComputeInputRegionOfSlab( movingImage, slab, padding, inputRegion ) )
+      {
+        inputRegion = movingImage->GetLargestPossibleRegion();
+        inputRegion.SetSize( InputRegionType::SizeType::Filled( 1 ) );
+      }
+      roiFilter->SetRegionOfInterest( inputRegion );
+      roiFilter->Update();
+      resampler->SetInput( roiFilter->GetOutput() );
+
+      itk::ImageIORegion ioRegion( ImageDimension );
+      itk::ImageIORegionAdaptor< ImageDimension >::Convert(
+        slab, ioRegion, outputRegion.GetIndex() );
+      writer->SetIORegion( ioRegion );
+      writer->Update();
+
+      /** Release the part of the moving image, before the next is extracted. */
+      roiFilter->GetOutput()->ReleaseData();
+
+      if( showProgress )
+      {
+        xl::xout[ "coutonly" ] << "\r  Progress: "
+                               << static_cast< unsigned int >( 100 * ( s + 1 ) / slabs ) << "%"
+                               << std::flush;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    resampler->SetInput( movingImage );
+
+    /** Add information to the exception. */
+    excp.SetLocation( "ResamplerBase - ResampleAndWriteResultImageInSlabs()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while resampling and writing the image in slabs.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+  if( showProgress )
+  {
+    xl::xout[ "coutonly" ] << std::endl;
+  }
+
+  /** Reconnect the complete moving image. */
+  resampler->SetInput( movingImage );
+
+} // end ResampleAndWriteResultImageInSlabs()
+
+
+/**
+ * ******************* ComputeInputRegionOfSlab ********************
+ */
+
+template< class TElastix >
+bool
+ResamplerBase< TElastix >
+::ComputeInputRegionOfSlab( const InputImageType * movingImage,
+  const typename OutputImageType::RegionType & slab,
+  const unsigned int padding, typename InputImageType::RegionType & inputRegion )
+{
+  typedef typename OutputImageType::RegionType                 OutputRegionType;
+  typedef typename TransformType::InputPointType               InputPointType;
+  typedef typename TransformType::OutputPointType              OutputPointType;
+  typedef itk::ContinuousIndex< CoordRepType, ImageDimension > ContinuousIndexType;
+
+  const ITKBaseType *     resampler = this->GetAsITKBaseType();
+  const OutputImageType * output    = resampler->GetOutput();
+  const TransformType *   transform = resampler->GetTransform();
+
+  /** The transform is continuous and invertible, so the slab maps into the
+   * bounding box of the mapping of its faces. Only the faces are transformed.
+   */
+  double minimum[ ImageDimension ];
+  double maximum[ ImageDimension ];
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    minimum[ i ] = itk::NumericTraits< double >::max();
+    maximum[ i ] = itk::NumericTraits< double >::NonpositiveMin();
+  }
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    for( unsigned int side = 0; side < 2; ++side )
+    {
+      OutputRegionType face = slab;
+      face.SetIndex( d, slab.GetIndex( d ) + side * ( slab.GetSize( d ) - 1 ) );
+      face.SetSize( d, 1 );
+
+      const itk::SizeValueType numberOfPoints = face.GetNumberOfPixels();
+      for( itk::SizeValueType p = 0; p < numberOfPoints; ++p )
+      {
+        IndexType          index;
+        itk::SizeValueType remainder = p;
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          index[ i ]  = face.GetIndex( i ) + static_cast< itk::IndexValueType >( remainder % face.GetSize( i ) );
+          remainder  /= face.GetSize( i );
+        }
+
+        InputPointType point;
+        output->TransformIndexToPhysicalPoint( index, point );
+        const OutputPointType mappedPoint = transform->TransformPoint( point );
+        ContinuousIndexType   cindex;
+        movingImage->TransformPhysicalPointToContinuousIndex( mappedPoint, cindex );
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+          minimum[ i ] = std::min( minimum[ i ], static_cast< double >( cindex[ i ] ) );
+          maximum[ i ] = std::max( maximum[ i ], static_cast< double >( cindex[ i ] ) );
+        }
+      }
+    }
+  }
+
+  /** Pad the bounding box, and crop it to the moving image. */
+  typename InputImageType::IndexType first;
+  typename InputImageType::SizeType  size;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    first[ i ] = static_cast< itk::IndexValueType >( std::floor( minimum[ i ] ) )
+      - static_cast< itk::IndexValueType >( padding );
+    size[ i ] = static_cast< itk::SizeValueType >( std::ceil( maximum[ i ] ) - first[ i ] ) + padding + 1;
+  }
+  inputRegion.SetIndex( first );
+  inputRegion.SetSize( size );
+  return inputRegion.Crop( movingImage->GetLargestPossibleRegion() );
+
+} // end ComputeInputRegionOfSlab()
+
+
 /**
  * ******************* WriteResultImage ********************
  */
@@ -433,6 +965,46 @@ ResamplerBase< TElastix >
   writer->SetOutputComponentType( resultImagePixelType.c_str() );
   writer->SetUseCompression( doCompression );
 
+  /** Compress in parallel blocks, if desired. */
+  bool parallelCompression = false;
+  int  compressionLevel    = 6;
+  this->m_Configuration->ReadParameter( parallelCompression,
+    "ParallelResultImageCompression", 0, false );
+  this->m_Configuration->ReadParameter( compressionLevel,
+    "ResultImageCompressionLevel", 0, false );
+  writer->SetUseParallelCompression( parallelCompression );
+  writer->SetCompressionLevel( compressionLevel );
+
+  /** Cast and write the image in pieces of about 16M voxels, so that no full
+   * size copy is made. Image IOs that can not write in pieces ignore this.
+   */
+  const itk::SizeValueType numberOfPixels
+    = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  writer->SetNumberOfStreamDivisions(
+    static_cast< unsigned int >( numberOfPixels / ( 1 << 24 ) + 1 ) );
+
+  /** Possibly hand the image to the background writer. The image is taken
+   * from the resampler, which then allocates a new output for the next
+   * resampling, and the writer only depends on the image.
+   */
+  itk::BackgroundWriter::Pointer backgroundWriter = itk::BackgroundWriter::GetInstance();
+  if( backgroundWriter->GetEnabled() )
+  {
+    infoChanger->Update();
+    typename OutputImageType::Pointer changedImage = infoChanger->GetOutput();
+    changedImage->DisconnectPipeline();
+    image->DisconnectPipeline();
+    writer->SetInput( changedImage );
+
+    if( showProgress )
+    {
+      xl::xout[ "coutonly" ] << std::flush;
+      xl::xout[ "coutonly" ] << "\n  Writing image in the background ..." << std::endl;
+    }
+    backgroundWriter->SubmitWriter( writer, filename );
+    return;
+  }
+
   /** Do the writing. */
   if( showProgress )
   {
@@ -469,32 +1041,46 @@ ResamplerBase< TElastix >
 {
   itk::DataObject::Pointer resultImage;
 
-  /** Make sure the resampler is updated. */
-  this->GetAsITKBaseType()->Modified();
+  /** Possibly resample via the cached mapped coordinates. */
+  typename OutputImageType::Pointer resampledImage;
+  const bool usedMappedCoordinates = this->ResampleWithMappedCoordinates( resampledImage );
 
 #ifndef _ELASTIX_BUILD_LIBRARY
   /** Add a progress observer to the resampler. */
   typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
-  progressObserver->ConnectObserver( this->GetAsITKBaseType() );
-  progressObserver->SetStartString( "  Progress: " );
-  progressObserver->SetEndString( "%" );
-#endif
-
-  /** Do the resampling. */
-  try
+  if( !usedMappedCoordinates )
   {
-    this->GetAsITKBaseType()->Update();
+    progressObserver->ConnectObserver( this->GetAsITKBaseType() );
+    progressObserver->SetStartString( "  Progress: " );
+    progressObserver->SetEndString( "%" );
   }
-  catch( itk::ExceptionObject & excp )
+#endif
+
+  if( !usedMappedCoordinates )
   {
-    /** Add information to the exception. */
-    excp.SetLocation( "ResamplerBase - WriteResultImage()" );
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while resampling the image.\n";
-    excp.SetDescription( err_str );
+    /** Possibly replace the transform by a deformation field. */
+    this->BakeTransformIntoDeformationField();
 
-    /** Pass the exception to an higher level. */
-    throw excp;
+    /** Make sure the resampler is updated. */
+    this->GetAsITKBaseType()->Modified();
+
+    /** Do the resampling. */
+    try
+    {
+      this->GetAsITKBaseType()->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      /** Add information to the exception. */
+      excp.SetLocation( "ResamplerBase - WriteResultImage()" );
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while resampling the image.\n";
+      excp.SetDescription( err_str );
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+    resampledImage = this->GetAsITKBaseType()->GetOutput();
   }
 
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator */
@@ -531,7 +1117,7 @@ ResamplerBase< TElastix >
   bool          retdc = this->GetElastix()->GetOriginalFixedImageDirection( originalDirection );
   infoChanger->SetOutputDirection( originalDirection );
   infoChanger->SetChangeDirection( retdc & !this->GetElastix()->GetUseDirectionCosines() );
-  infoChanger->SetInput( this->GetAsITKBaseType()->GetOutput() );
+  infoChanger->SetInput( resampledImage );
 
   typedef itk::CastImageFilter< InputImageType,
     itk::Image< char, InputImageType::ImageDimension > >            CastFilterChar;
@@ -639,7 +1225,10 @@ ResamplerBase< TElastix >
 
 #ifndef _ELASTIX_BUILD_LIBRARY
   /** Disconnect from the resampler. */
-  progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
+  if( !usedMappedCoordinates )
+  {
+    progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
+  }
 #endif
 } // end CreateItkResultImage()
 
@@ -51,6 +51,40 @@ namespace elastix
  *   "Compose" by composition: \f$T(x) = T_1 ( T_0(x) )\f$.\n
  *   example: <tt>(HowToCombineTransforms "Add")</tt>\n
  *   Default: "Add".
+ * \parameter SpatialJacobianMemoryLimit: The maximum size in megabytes of the parts
+ *   in which the output of the "-def all", "-jac" and "-jacmat" options is computed
+ *   and written.
+ *   The images are then streamed to disk, so that their memory use no longer depends
+ *   on the image size. Streaming requires a file format that supports it, such as
+ *   uncompressed mhd; otherwise the image is written in one piece. A value of 0
+ *   disables streaming.\n
+ *   example: <tt>(SpatialJacobianMemoryLimit 1024)</tt>\n
+ *   Default: 256.
+ * \parameter OutputPointsDerivedColumns: Whether transformix writes, besides the
+ *   input and output points, the input index, the output indices and the deformation
+ *   of every point to outputpoints.txt. Not writing them saves time and disk space
+ *   for large point sets.\n
+ *   example: <tt>(OutputPointsDerivedColumns "false")</tt>\n
+ *   Default: "true".
+ * \parameter OutputPointsFormat: The format of the output points of transformix,
+ *   "text" or "binary". Binary output points are written to outputpoints.bin, in the
+ *   binary point file format of the TransformixInputPointFileReader, as 32 bit floats;
+ *   the other columns are then not written. For VTK input, "binary" writes a binary
+ *   VTK file. The input point file may be binary as well, see
+ *   TransformixInputPointFileReader.\n
+ *   example: <tt>(OutputPointsFormat "binary")</tt>\n
+ *   Default: "text".
+ * \parameter WriteTransformParametersBinary: Whether the TransformParameters are written
+ *   to a binary file next to the transform parameter file, instead of as text. For
+ *   transforms with millions of parameters this is much faster to write and to read,
+ *   and much smaller. The binary file has the name of the transform parameter file,
+ *   with the extension ".bin", and is referenced by TransformParametersBinaryFileName.\n
+ *   example: <tt>(WriteTransformParametersBinary "true")</tt>\n
+ *   Default: "false".
+ * \parameter TransformParametersBinaryType: The type of the values in the binary file,
+ *   "double" or "float". "float" halves the size, at the cost of precision.\n
+ *   example: <tt>(TransformParametersBinaryType "float")</tt>\n
+ *   Default: "double".
  *
  * \transformparameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
@@ -99,6 +133,15 @@ namespace elastix
  * The number of entries is stored the NumberOfParameters entry.
  * \transformparameter NumberOfParameters: the length of the transform parameter vector.\n
  * example <tt>(NumberOfParameters 722)</tt>\n
+ * \transformparameter TransformParametersBinaryFileName: the file that contains the
+ * transform parameter vector, instead of the TransformParameters entry. The values are stored
+ * as little endian, without header. A relative name is relative to the directory of the
+ * transform parameter file.\n
+ * example <tt>(TransformParametersBinaryFileName "TransformParameters.0.bin")</tt>\n
+ * \transformparameter TransformParametersBinaryType: the type of the values in the
+ * TransformParametersBinaryFileName, "double" or "float".\n
+ * example <tt>(TransformParametersBinaryType "double")</tt>\n
+ * Default: "double".
  * \transformparameter InitialTransformParametersFileName: The location/name of an initial
  * transform that will be loaded when loading the current transform parameter file. Note
  * that transform parameter file can also contain an initial transform. Recursively all
@@ -118,7 +161,9 @@ namespace elastix
  *    The inputPoints.txt file should be structured: first line should be "index" or
  *    "point", depending if the user supplies voxel indices or real world coordinates.
  *    The second line should be the number of points that should be transformed. The
- *    third and following lines give the indices or points.\n
+ *    third and following lines give the indices or points. The points are read,
+ *    transformed in parallel, and written in chunks, so that point sets of any
+ *    size can be transformed.\n
  *    It is also possible to deform all points, thereby generating a deformation field
  *    image. This is done by:\n
  *    example: <tt>-def all</tt> \n
@@ -196,6 +241,7 @@ public:
   typedef typename RegistrationType::ITKBaseType      ITKRegistrationType;
   typedef typename ITKRegistrationType::OptimizerType OptimizerType;
   typedef typename OptimizerType::ScalesType          ScalesType;
+  typedef typename FixedImageType::RegionType         FixedImageRegionType;
 
   /** Typedef that is used in the elastix dll version. */
   typedef typename ElastixType::ParameterMapType ParameterMapType;
@@ -316,8 +362,11 @@ protected:
   /** Estimate a scales vector
    * AutomaticScalesEstimation works like this:
    * \li N=10000 points are sampled on a uniform grid on the fixed image.
-   * \li Jacobians dT/dmu are computed
+   * \li Jacobians dT/dmu are computed, in parallel, with GetJacobians()
    * \li Scales_i = 1/N sum_x || dT / dmu_i ||^2
+   * The scales are reused as long as the fixed image, its region and the
+   * fixed parameters of the transform are unchanged; a change of only the
+   * transform parameters does not trigger a new estimation.
    */
   void AutomaticScalesEstimation( ScalesType & scales ) const;
 
@@ -331,6 +380,31 @@ protected:
   void AutomaticScalesEstimationStackTransform(
     const unsigned int & numSubTransforms, ScalesType & scales ) const;
 
+  /** Compute the mean squared Jacobians of the parameters on a grid over the
+   * given fixed image region, or reuse the previous result.
+   */
+  void ComputeMeanSquaredJacobians( const FixedImageRegionType & region,
+    ScalesType & scales ) const;
+
+  /** Get the number of parts in which an output image on the grid of the
+   * resampler is streamed to disk, given the size of a pixel in bytes.
+   * It is based on the parameter SpatialJacobianMemoryLimit.
+   */
+  unsigned int GetNumberOfStreamDivisions( const std::size_t pixelSize ) const;
+
+  /** Write the parameters to the binary file next to the transform parameter
+   * file, with values of the given type, "double" or "float". Returns the name
+   * of the binary file, relative to the transform parameter file.
+   */
+  std::string WriteTransformParametersBinary( const ParametersType & param,
+    const std::string & type ) const;
+
+  /** Read the parameters from a binary file, of which a relative name is
+   * relative to the directory of the transform parameter file.
+   */
+  void ReadTransformParametersBinary( const std::string & fileName,
+    const std::string & type, ParametersType & param ) const;
+
   /** Member variables. */
   ParametersType * m_TransformParametersPointer;
   std::string      m_TransformParametersFileName;
@@ -345,7 +419,69 @@ private:
 
   /** Boolean to decide whether or not the transform parameters are written. */
   bool m_ReadWriteTransformParameters;
+
+  /** The geometry for which the automatic scales were estimated. */
+  struct AutomaticScalesGeometryType
+  {
+    const FixedImageType * m_FixedImage;
+    unsigned long          m_FixedImageMTime;
+    FixedImageRegionType   m_Region;
+    unsigned long          m_NumberOfParameters;
+    ParametersType         m_FixedParameters;
+
+    bool operator==( const AutomaticScalesGeometryType & other ) const
+    {
+      return this->m_FixedImage == other.m_FixedImage
+             && this->m_FixedImageMTime == other.m_FixedImageMTime
+             && this->m_Region == other.m_Region
+             && this->m_NumberOfParameters == other.m_NumberOfParameters
+             && this->m_FixedParameters == other.m_FixedParameters;
+    }
+  };
+
+  /** The last automatically estimated scales and their geometry. */
+  mutable ScalesType                  m_AutomaticScales;
+  mutable AutomaticScalesGeometryType m_AutomaticScalesGeometry;
   
+  /** The number of points that TransformPointsSomePoints() transforms and
+   * formats as one block.
+   */
+  itkStaticConstMacro( TransformPointsBlockSize, itk::SizeValueType, 1024 );
+
+  /** The data of the parallel transformation of a chunk of input points, in
+   * TransformPointsSomePoints(). The text of every block of points is stored
+   * in st_Text, or, for binary output, the output points in st_BinaryPoints.
+   */
+  struct TransformPointsParameterType
+  {
+    const Self *                  st_Self;
+    const FixedImageType *        st_FixedGrid;
+    const MovingImageType *       st_MovingImage;
+    bool                          st_PointsAreIndices;
+    bool                          st_DerivedColumns;
+    bool                          st_Binary;
+    itk::SizeValueType            st_FirstPoint;
+    std::vector< InputPointType > st_Points;
+    std::vector< std::string >    st_Text;
+    std::vector< float >          st_BinaryPoints;
+  };
+
+  /** Transforms and formats the blocks [begin, end) of a chunk. */
+  static void TransformPointsRangeFunction( void * userData, itk::ThreadIdType participantId,
+    itk::SizeValueType begin, itk::SizeValueType end );
+
+  /** The data of the parallel transformation of the points of a mesh. */
+  struct TransformPointArraysParameterType
+  {
+    const ITKBaseType *    st_Transform;
+    const InputPointType * st_InputPoints;
+    OutputPointType *      st_OutputPoints;
+  };
+
+  /** Transforms the points [begin, end) of the mesh. */
+  static void TransformPointArraysRangeFunction( void * userData, itk::ThreadIdType participantId,
+    itk::SizeValueType begin, itk::SizeValueType end );
+
   std::string GetInitialTransformParametersFileName() const
   {
     if (!this->GetInitialTransform())
@@ -23,20 +23,27 @@
 #include "itkPointSet.h"
 #include "itkDefaultStaticMeshTraits.h"
 #include "itkTransformixInputPointFileReader.h"
+#include "itkMemoryMappedFile.h"
+#include "itkByteSwapper.h"
 #include "vnl/vnl_math.h"
 #include <itksys/SystemTools.hxx>
 #include "itkVector.h"
-#include "itkTransformToDisplacementFieldFilter.h"
+#include "itkTransformToDisplacementFieldSource.h"
 #include "itkTransformToDeterminantOfSpatialJacobianSource.h"
 #include "itkTransformToSpatialJacobianSource.h"
 #include "itkImageFileWriter.h"
-#include "itkImageGridSampler.h"
+#include "itkComputeJacobianTerms.h"
 #include "itkContinuousIndex.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkMesh.h"
 #include "itkMeshFileReader.h"
 #include "itkMeshFileWriter.h"
-#include "itkTransformMeshFilter.h"
+#include "itkPersistentThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
 
 namespace itk
 {
@@ -112,6 +119,7 @@ TransformBase< TElastix >
   /** Initialize. */
   this->m_TransformParametersPointer   = 0;
   this->m_ReadWriteTransformParameters = true;
+  this->m_AutomaticScalesGeometry.m_FixedImage = 0;
 
 } // end Constructor()
 
@@ -403,49 +411,64 @@ TransformBase< TElastix >
     }
     this->m_TransformParametersPointer = new ParametersType( numberOfParameters );
 
-    /** Read the TransformParameters. */
-    std::vector< ValueType > vecPar( numberOfParameters,
-      itk::NumericTraits< ValueType >::ZeroValue() );
-    this->m_Configuration->ReadParameter( vecPar, "TransformParameters",
-      0, numberOfParameters - 1, true );
-
-    /** Sanity check. Are the number of found parameters the same as
-     * the number of specified parameters?
-     * Do not rely on vecPar.size(), since it is unchanged by ReadParameter(),
-     * so we cannot use: numberOfParametersFound = vecPar.size().
-     */
-    const std::size_t numberOfParametersFound
-      = this->m_Configuration->CountNumberOfParameterEntries( "TransformParameters" );
-
-    if( numberOfParametersFound != numberOfParameters )
+    /** Read the TransformParameters from a binary file, if they were written so. */
+    std::string binaryFileName = "";
+    this->m_Configuration->ReadParameter( binaryFileName,
+      "TransformParametersBinaryFileName", 0, false );
+    if( !binaryFileName.empty() )
     {
-      std::ostringstream makeMessage( "" );
-      makeMessage << "\nERROR: Invalid transform parameter file!\n"
-                  << "The number of parameters in \"TransformParameters\" is "
-                  << numberOfParametersFound
-                  << ", which does not match the number specified in \"NumberOfParameters\" ("
-                  << numberOfParameters << ").\n"
-                  << "The transform parameters should be specified as:\n"
-                  << "  (TransformParameters num num ... num)\n"
-                  << "with " << numberOfParameters << " parameters." << std::endl;
-      itkExceptionMacro( << makeMessage.str().c_str() );
-
-      /** Historical note:
-       * The old way of specifying parameters was
-       *  - for less than 20 parameters:
-       *      (TransformParameters num num ... num)
-       *  - Otherwise:
-       *      // (TransformParameters)
-       *      // num num ... num
-       *
-       * This behavior was deprecated since elastix 4.2, and removed in elastix 4.5.
-       */
+      std::string binaryType = "double";
+      this->m_Configuration->ReadParameter( binaryType,
+        "TransformParametersBinaryType", 0, false );
+      this->ReadTransformParametersBinary( binaryFileName, binaryType,
+        *( this->m_TransformParametersPointer ) );
     }
-
-    /** Copy to m_TransformParametersPointer. */
-    for( unsigned int i = 0; i < numberOfParameters; i++ )
+    else
     {
-      ( *( this->m_TransformParametersPointer ) )[ i ] = vecPar[ i ];
+      /** Read the TransformParameters. */
+      std::vector< ValueType > vecPar( numberOfParameters,
+        itk::NumericTraits< ValueType >::ZeroValue() );
+      this->m_Configuration->ReadParameter( vecPar, "TransformParameters",
+        0, numberOfParameters - 1, true );
+
+      /** Sanity check. Are the number of found parameters the same as
+       * the number of specified parameters?
+       * Do not rely on vecPar.size(), since it is unchanged by ReadParameter(),
+       * so we cannot use: numberOfParametersFound = vecPar.size().
+       */
+      const std::size_t numberOfParametersFound
+        = this->m_Configuration->CountNumberOfParameterEntries( "TransformParameters" );
+
+      if( numberOfParametersFound != numberOfParameters )
+      {
+        std::ostringstream makeMessage( "" );
+        makeMessage << "\nERROR: Invalid transform parameter file!\n"
+                    << "The number of parameters in \"TransformParameters\" is "
+                    << numberOfParametersFound
+                    << ", which does not match the number specified in \"NumberOfParameters\" ("
+                    << numberOfParameters << ").\n"
+                    << "The transform parameters should be specified as:\n"
+                    << "  (TransformParameters num num ... num)\n"
+                    << "with " << numberOfParameters << " parameters." << std::endl;
+        itkExceptionMacro( << makeMessage.str().c_str() );
+
+        /** Historical note:
+         * The old way of specifying parameters was
+         *  - for less than 20 parameters:
+         *      (TransformParameters num num ... num)
+         *  - Otherwise:
+         *      // (TransformParameters)
+         *      // num num ... num
+         *
+         * This behavior was deprecated since elastix 4.2, and removed in elastix 4.5.
+         */
+      }
+
+      /** Copy to m_TransformParametersPointer. */
+      for( unsigned int i = 0; i < numberOfParameters; i++ )
+      {
+        ( *( this->m_TransformParametersPointer ) )[ i ] = vecPar[ i ];
+      }
     }
 
     /** Set the parameters into this transform. */
@@ -675,8 +698,24 @@ TransformBase< TElastix >
   xout[ "transpar" ] << "(NumberOfParameters "
                      << nrP << ")" << std::endl;
 
-  /** Write the parameters of this transform. */
-  if( this->m_ReadWriteTransformParameters )
+  /** Write the parameters of this transform to a binary file, if desired. */
+  bool writeBinary = false;
+  this->m_Configuration->ReadParameter( writeBinary,
+    "WriteTransformParametersBinary", 0, false );
+  if( this->m_ReadWriteTransformParameters && writeBinary && nrP > 0
+    && !this->m_TransformParametersFileName.empty() )
+  {
+    std::string binaryType = "double";
+    this->m_Configuration->ReadParameter( binaryType,
+      "TransformParametersBinaryType", 0, false );
+    const std::string binaryFileName
+      = this->WriteTransformParametersBinary( param, binaryType );
+    xout[ "transpar" ] << "(TransformParametersBinaryFileName \""
+                       << binaryFileName << "\")" << std::endl;
+    xout[ "transpar" ] << "(TransformParametersBinaryType \""
+                       << binaryType << "\")" << std::endl;
+  }
+  else if( this->m_ReadWriteTransformParameters )
   {
     /** In this case, write in a normal way to the parameter file. */
     xout[ "transpar" ] << "(TransformParameters ";
@@ -815,6 +854,124 @@ TransformBase< TElastix >
 } // end WriteToFile()
 
 
+/**
+ * ******************* WriteTransformParametersBinary ***********************
+ */
+
+template< class TElastix >
+std::string
+TransformBase< TElastix >
+::WriteTransformParametersBinary( const ParametersType & param,
+  const std::string & type ) const
+{
+  if( type != "double" && type != "float" )
+  {
+    itkExceptionMacro( << "ERROR: TransformParametersBinaryType should be "
+                       << "\"double\" or \"float\", not \"" << type << "\"." );
+  }
+
+  /** The binary file is stored next to the transform parameter file. */
+  const std::string path = itksys::SystemTools::GetFilenamePath(
+    this->m_TransformParametersFileName );
+  const std::string binaryFileName = itksys::SystemTools::GetFilenameWithoutLastExtension(
+    this->m_TransformParametersFileName ) + ".bin";
+  const std::string fullFileName = path.empty() ? binaryFileName : path + "/" + binaryFileName;
+
+  std::ofstream file( fullFileName.c_str(), std::ios::out | std::ios::binary );
+  if( !file.is_open() )
+  {
+    itkExceptionMacro( << "ERROR: File \"" << fullFileName << "\" could not be opened!" );
+  }
+
+  /** Write the values in little endian order, in a single write. */
+  const std::size_t nrP = param.GetSize();
+  if( type == "double" )
+  {
+    std::vector< double > values( param.begin(), param.end() );
+    itk::ByteSwapper< double >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+    file.write( reinterpret_cast< const char * >( &values[ 0 ] ), nrP * sizeof( double ) );
+  }
+  else
+  {
+    std::vector< float > values( param.begin(), param.end() );
+    itk::ByteSwapper< float >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+    file.write( reinterpret_cast< const char * >( &values[ 0 ] ), nrP * sizeof( float ) );
+  }
+  if( !file.good() )
+  {
+    itkExceptionMacro( << "ERROR: Writing the transform parameters to \""
+                       << fullFileName << "\" failed!" );
+  }
+
+  return binaryFileName;
+
+} // end WriteTransformParametersBinary()
+
+
+/**
+ * ******************* ReadTransformParametersBinary ***********************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::ReadTransformParametersBinary( const std::string & fileName,
+  const std::string & type, ParametersType & param ) const
+{
+  if( type != "double" && type != "float" )
+  {
+    itkExceptionMacro( << "ERROR: TransformParametersBinaryType should be "
+                       << "\"double\" or \"float\", not \"" << type << "\"." );
+  }
+
+  /** A relative name is relative to the transform parameter file. */
+  std::string fullFileName = fileName;
+  if( !itksys::SystemTools::FileIsFullPath( fileName.c_str() ) )
+  {
+    const std::string path = itksys::SystemTools::GetFilenamePath(
+      this->m_Configuration->GetParameterFileName() );
+    fullFileName = path.empty() ? fileName : path + "/" + fileName;
+  }
+
+  /** Map the file, and check its size against NumberOfParameters. */
+  itk::MemoryMappedFile::Pointer file = itk::MemoryMappedFile::New();
+  file->Open( fullFileName );
+  const std::size_t nrP       = param.GetSize();
+  const std::size_t valueSize = type == "double" ? sizeof( double ) : sizeof( float );
+  if( file->GetSize() != nrP * valueSize )
+  {
+    itkExceptionMacro( << "\nERROR: Invalid transform parameter file!\n"
+                       << "The size of \"" << fullFileName << "\" is " << file->GetSize()
+                       << " bytes, which does not match the number specified in "
+                       << "\"NumberOfParameters\" (" << nrP << ") of type "
+                       << type << "." );
+  }
+
+  /** Copy the values, and swap the copies on big endian systems. The mapped
+   * file itself is not modified.
+   */
+  if( nrP == 0 )
+  {
+    return;
+  }
+  if( type == "double" )
+  {
+    std::vector< double > values( nrP );
+    std::memcpy( &values[ 0 ], file->GetData(), nrP * sizeof( double ) );
+    itk::ByteSwapper< double >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+    std::copy( values.begin(), values.end(), param.begin() );
+  }
+  else
+  {
+    std::vector< float > values( nrP );
+    std::memcpy( &values[ 0 ], file->GetData(), nrP * sizeof( float ) );
+    itk::ByteSwapper< float >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+    std::copy( values.begin(), values.end(), param.begin() );
+  }
+
+} // end ReadTransformParametersBinary()
+
+
 /**
  * ******************* CreateTransformParametersMap ******************************
  */
@@ -1097,17 +1254,9 @@ TransformBase< TElastix >
 ::TransformPointsSomePoints( const std::string filename ) const
 {
   /** Typedef's. */
-  typedef typename FixedImageType::RegionType           FixedImageRegionType;
-  typedef typename FixedImageType::PointType            FixedImageOriginType;
-  typedef typename FixedImageType::SpacingType          FixedImageSpacingType;
-  typedef typename FixedImageType::IndexType            FixedImageIndexType;
-  typedef typename FixedImageIndexType::IndexValueType  FixedImageIndexValueType;
-  typedef typename MovingImageType::IndexType           MovingImageIndexType;
-  typedef typename MovingImageIndexType::IndexValueType MovingImageIndexValueType;
-  typedef
-    itk::ContinuousIndex< double, FixedImageDimension >   FixedImageContinuousIndexType;
-  typedef
-    itk::ContinuousIndex< double, MovingImageDimension >  MovingImageContinuousIndexType;
+  typedef typename FixedImageType::RegionType    FixedImageRegionType;
+  typedef typename FixedImageType::PointType     FixedImageOriginType;
+  typedef typename FixedImageType::SpacingType   FixedImageSpacingType;
   typedef typename FixedImageType::DirectionType FixedImageDirectionType;
 
   typedef bool DummyIPPPixelType;
@@ -1118,9 +1267,11 @@ TransformBase< TElastix >
     FixedImageDimension, MeshTraitsType >                PointSetType;
   typedef itk::TransformixInputPointFileReader<
     PointSetType >                                      IPPReaderType;
-  typedef itk::Vector< float, FixedImageDimension > DeformationVectorType;
+  typedef typename IPPReaderType::PointType IPPPointType;
 
-  /** Construct an ipp-file reader. */
+  /** Construct an ipp-file reader. Only the header is read here; the points
+   * are read, transformed and written in chunks below.
+   */
   typename IPPReaderType::Pointer ippReader = IPPReaderType::New();
   ippReader->SetFileName( filename.c_str() );
 
@@ -1128,12 +1279,13 @@ TransformBase< TElastix >
   elxout << "  Reading input point file: " << filename << std::endl;
   try
   {
-    ippReader->Update();
+    ippReader->UpdateOutputInformation();
   }
   catch( itk::ExceptionObject & err )
   {
     xl::xout[ "error" ] << "  Error while opening input point file." << std::endl;
     xl::xout[ "error" ] << err << std::endl;
+    return;
   }
 
   /** Some user-feedback. */
@@ -1145,20 +1297,9 @@ TransformBase< TElastix >
   {
     elxout << "  Input points are specified in world coordinates." << std::endl;
   }
-  unsigned int nrofpoints = ippReader->GetNumberOfPoints();
+  const unsigned long nrofpoints = ippReader->GetNumberOfPoints();
   elxout << "  Number of specified input points: " << nrofpoints << std::endl;
 
-  /** Get the set of input points. */
-  typename PointSetType::Pointer inputPointSet = ippReader->GetOutput();
-
-  /** Create the storage classes. */
-  std::vector< FixedImageIndexType >   inputindexvec(  nrofpoints );
-  std::vector< InputPointType >        inputpointvec(  nrofpoints );
-  std::vector< OutputPointType >       outputpointvec( nrofpoints );
-  std::vector< FixedImageIndexType >   outputindexfixedvec( nrofpoints );
-  std::vector< MovingImageIndexType >  outputindexmovingvec( nrofpoints );
-  std::vector< DeformationVectorType > deformationvec( nrofpoints );
-
   /** Make a temporary image with the right region info,
    * which we can use to convert between points and indices.
    * By taking the image from the resampler output, the UseDirectionCosines
@@ -1181,149 +1322,280 @@ TransformBase< TElastix >
   dummyImage->SetSpacing( spacing );
   dummyImage->SetDirection( direction );
 
-  /** Temp vars */
-  FixedImageContinuousIndexType  fixedcindex;
-  MovingImageContinuousIndexType movingcindex;
+  /** Check whether the input index, the output indices and the deformation
+   * should be written too.
+   */
+  bool derivedColumns = true;
+  this->m_Configuration->ReadParameter( derivedColumns,
+    "OutputPointsDerivedColumns", 0, false );
+
+  /** Check whether the output points are written as text or binary. */
+  std::string outputPointsFormat = "text";
+  this->m_Configuration->ReadParameter( outputPointsFormat,
+    "OutputPointsFormat", 0, false );
+  if( outputPointsFormat != "text" && outputPointsFormat != "binary" )
+  {
+    xl::xout[ "error" ] << "  ERROR: OutputPointsFormat should be \"text\" or \"binary\", not \""
+                        << outputPointsFormat << "\"." << std::endl;
+    return;
+  }
+  const bool binary = outputPointsFormat == "binary";
 
-  /** Also output moving image indices if a moving image was supplied. */
-  bool alsoMovingIndices = false;
-  typename MovingImageType::Pointer movingImage = this->GetElastix()->GetMovingImage();
-  if( movingImage.IsNotNull() )
+  /** Create filename and file stream. A binary file starts with the header
+   * of the binary point files of the TransformixInputPointFileReader.
+   */
+  std::string outputPointsFileName = this->m_Configuration
+    ->GetCommandLineArgument( "-out" );
+  outputPointsFileName += binary ? "outputpoints.bin" : "outputpoints.txt";
+  std::ofstream outputPointsFile( outputPointsFileName.c_str(),
+    binary ? std::ios::out | std::ios::binary : std::ios::out );
+  elxout << "  The transformed points are saved in: "
+         <<  outputPointsFileName << std::endl;
+  if( binary )
   {
-    alsoMovingIndices = true;
+    outputPointsFile << IPPReaderType::CreateBinaryHeader( false, nrofpoints );
   }
 
-  /** Read the input points, as index or as point. */
-  if( !( ippReader->GetPointsAreIndices() ) )
+  /** Also output moving image indices if a moving image was supplied. */
+  TransformPointsParameterType pass;
+  pass.st_Self             = this;
+  pass.st_FixedGrid        = dummyImage.GetPointer();
+  pass.st_MovingImage      = this->GetElastix()->GetMovingImage();
+  pass.st_PointsAreIndices = ippReader->GetPointsAreIndices();
+  pass.st_DerivedColumns   = derivedColumns;
+  pass.st_Binary           = binary;
+  pass.st_FirstPoint       = 0;
+
+  /** Read, transform and write the points in chunks, so that the memory use
+   * does not depend on the number of points. The points of a chunk are
+   * transformed in blocks, in parallel, with the batched TransformPoints(),
+   * and each block is formatted to its own text.
+   */
+  elxout << "  The input points are transformed." << std::endl;
+  const itk::SizeValueType           chunkSize  = 1 << 16;
+  std::vector< IPPPointType >        readPoints;
+  itk::PersistentThreadPool::Pointer threadPool = itk::PersistentThreadPool::GetInstance();
+  for(;; )
   {
-    for( unsigned int j = 0; j < nrofpoints; j++ )
+    try
     {
-      /** Compute index of nearest voxel in fixed image. */
-      InputPointType point; point.Fill( 0.0f );
-      inputPointSet->GetPoint( j, &point );
-      inputpointvec[ j ] = point;
-      dummyImage->TransformPhysicalPointToContinuousIndex(
-        point, fixedcindex );
-      for( unsigned int i = 0; i < FixedImageDimension; i++ )
-      {
-        inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
-          itk::Math::Round< double >( fixedcindex[ i ] ) );
-      }
+      ippReader->ReadPoints( chunkSize, readPoints );
     }
-  }
-  else //so: inputasindex
-  {
-    for( unsigned int j = 0; j < nrofpoints; j++ )
+    catch( itk::ExceptionObject & err )
     {
-      /** The read point from the inutPointSet is actually an index
-       * Cast to the proper type.
-       */
-      InputPointType point; point.Fill( 0.0f );
-      inputPointSet->GetPoint( j, &point );
-      for( unsigned int i = 0; i < FixedImageDimension; i++ )
-      {
-        inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
-          itk::Math::Round< double >( point[ i ] ) );
-      }
-      /** Compute the input point in physical coordinates. */
-      dummyImage->TransformIndexToPhysicalPoint(
-        inputindexvec[ j ], inputpointvec[ j ] );
+      xl::xout[ "error" ] << "  Error while reading input point file." << std::endl;
+      xl::xout[ "error" ] << err << std::endl;
+      return;
     }
-  }
-
-  /** Apply the transform. */
-  elxout << "  The input points are transformed." << std::endl;
-  for( unsigned int j = 0; j < nrofpoints; j++ )
-  {
-    /** Call TransformPoint. */
-    outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
-
-    /** Transform back to index in fixed image domain. */
-    dummyImage->TransformPhysicalPointToContinuousIndex(
-      outputpointvec[ j ], fixedcindex );
-    for( unsigned int i = 0; i < FixedImageDimension; i++ )
+    if( readPoints.empty() )
     {
-      outputindexfixedvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
-        itk::Math::Round< double >( fixedcindex[ i ] ) );
+      break;
     }
 
-    if( alsoMovingIndices )
+    pass.st_Points.resize( readPoints.size() );
+    for( std::size_t j = 0; j < readPoints.size(); ++j )
     {
-      /** Transform back to index in moving image domain. */
-      movingImage->TransformPhysicalPointToContinuousIndex(
-        outputpointvec[ j ], movingcindex );
-      for( unsigned int i = 0; i < MovingImageDimension; i++ )
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
       {
-        outputindexmovingvec[ j ][ i ] = static_cast< MovingImageIndexValueType >(
-          itk::Math::Round< double >( movingcindex[ i ] ) );
+        pass.st_Points[ j ][ i ] = readPoints[ j ][ i ];
       }
     }
 
-    /** Compute displacement. */
-    deformationvec[ j ].CastFrom( outputpointvec[ j ] - inputpointvec[ j ] );
-  }
+    const itk::SizeValueType numberOfBlocks
+      = ( readPoints.size() + TransformPointsBlockSize - 1 ) / TransformPointsBlockSize;
+    pass.st_Text.assign( binary ? 0 : numberOfBlocks, std::string() );
+    pass.st_BinaryPoints.resize( binary ? readPoints.size() * MovingImageDimension : 0 );
+    threadPool->ParallelFor( numberOfBlocks, 1, TransformPointsRangeFunction, &pass );
 
-  /** Create filename and file stream. */
-  std::string outputPointsFileName = this->m_Configuration
-    ->GetCommandLineArgument( "-out" );
-  outputPointsFileName += "outputpoints.txt";
-  std::ofstream outputPointsFile( outputPointsFileName.c_str() );
-  outputPointsFile << std::showpoint << std::fixed;
-  elxout << "  The transformed points are saved in: "
-         <<  outputPointsFileName << std::endl;
-
-  /** Print the results. */
-  for( unsigned int j = 0; j < nrofpoints; j++ )
-  {
-    /** The input index. */
-    outputPointsFile << "Point\t" << j << "\t; InputIndex = [ ";
-    for( unsigned int i = 0; i < FixedImageDimension; i++ )
+    if( binary )
     {
-      outputPointsFile << inputindexvec[ j ][ i ] << " ";
+      outputPointsFile.write( reinterpret_cast< const char * >( &pass.st_BinaryPoints[ 0 ] ),
+        pass.st_BinaryPoints.size() * sizeof( float ) );
     }
-
-    /** The input point. */
-    outputPointsFile << "]\t; InputPoint = [ ";
-    for( unsigned int i = 0; i < FixedImageDimension; i++ )
+    for( std::size_t b = 0; b < pass.st_Text.size(); ++b )
     {
-      outputPointsFile << inputpointvec[ j ][ i ] << " ";
+      outputPointsFile << pass.st_Text[ b ];
     }
+    pass.st_FirstPoint += readPoints.size();
+  }
 
-    /** The output index in fixed image. */
-    outputPointsFile << "]\t; OutputIndexFixed = [ ";
-    for( unsigned int i = 0; i < FixedImageDimension; i++ )
-    {
-      outputPointsFile << outputindexfixedvec[ j ][ i ] << " ";
-    }
+} // end TransformPointsSomePoints()
+
+
+/**
+ * ************** TransformPointsRangeFunction *********************
+ *
+ * Transforms the blocks [begin, end) of the points of a chunk, and
+ * formats each block to its text, see TransformPointsSomePoints().
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::TransformPointsRangeFunction( void * userData, itk::ThreadIdType itkNotUsed( participantId ),
+  itk::SizeValueType begin, itk::SizeValueType end )
+{
+  /** Typedef's. */
+  typedef typename FixedImageType::IndexType            FixedImageIndexType;
+  typedef typename FixedImageIndexType::IndexValueType  FixedImageIndexValueType;
+  typedef typename MovingImageType::IndexType           MovingImageIndexType;
+  typedef typename MovingImageIndexType::IndexValueType MovingImageIndexValueType;
+  typedef
+    itk::ContinuousIndex< double, FixedImageDimension >   FixedImageContinuousIndexType;
+  typedef
+    itk::ContinuousIndex< double, MovingImageDimension >  MovingImageContinuousIndexType;
+  typedef itk::Vector< float, FixedImageDimension > DeformationVectorType;
+
+  TransformPointsParameterType * pass = static_cast< TransformPointsParameterType * >( userData );
 
-    /** The output point. */
-    outputPointsFile << "]\t; OutputPoint = [ ";
-    for( unsigned int i = 0; i < FixedImageDimension; i++ )
+  /** Temp vars */
+  FixedImageContinuousIndexType  fixedcindex;
+  MovingImageContinuousIndexType movingcindex;
+  FixedImageIndexType            inputindex;
+  FixedImageIndexType            outputindexfixed;
+  MovingImageIndexType           outputindexmoving;
+  DeformationVectorType          deformation;
+
+  std::vector< FixedImageIndexType > inputindexvec;
+  std::vector< InputPointType >      inputpointvec;
+  std::vector< OutputPointType >     outputpointvec;
+
+  for( itk::SizeValueType b = begin; b < end; ++b )
+  {
+    const itk::SizeValueType first = b * TransformPointsBlockSize;
+    const itk::SizeValueType last  = std::min( first + TransformPointsBlockSize,
+      static_cast< itk::SizeValueType >( pass->st_Points.size() ) );
+    const itk::SizeValueType nrofpoints = last - first;
+    inputindexvec.resize( nrofpoints );
+    inputpointvec.resize( nrofpoints );
+    outputpointvec.resize( nrofpoints );
+
+    /** Read the input points, as index or as point. */
+    for( itk::SizeValueType j = 0; j < nrofpoints; ++j )
     {
-      outputPointsFile << outputpointvec[ j ][ i ] << " ";
+      const InputPointType & point = pass->st_Points[ first + j ];
+      if( !pass->st_PointsAreIndices )
+      {
+        /** Compute index of nearest voxel in fixed image. */
+        inputpointvec[ j ] = point;
+        pass->st_FixedGrid->TransformPhysicalPointToContinuousIndex( point, fixedcindex );
+        for( unsigned int i = 0; i < FixedImageDimension; i++ )
+        {
+          inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
+            itk::Math::Round< double >( fixedcindex[ i ] ) );
+        }
+      }
+      else
+      {
+        /** The read point is actually an index. Cast to the proper type,
+         * and compute the input point in physical coordinates.
+         */
+        for( unsigned int i = 0; i < FixedImageDimension; i++ )
+        {
+          inputindexvec[ j ][ i ] = static_cast< FixedImageIndexValueType >(
+            itk::Math::Round< double >( point[ i ] ) );
+        }
+        pass->st_FixedGrid->TransformIndexToPhysicalPoint(
+          inputindexvec[ j ], inputpointvec[ j ] );
+      }
     }
 
-    /** The output point minus the input point. */
-    outputPointsFile << "]\t; Deformation = [ ";
-    for( unsigned int i = 0; i < MovingImageDimension; i++ )
+    /** Apply the transform, to all points of the block at once. */
+    pass->st_Self->GetAsITKBaseType()->TransformPoints(
+      nrofpoints, &inputpointvec[ 0 ], &outputpointvec[ 0 ] );
+
+    /** Store the output points only, as little endian floats. */
+    if( pass->st_Binary )
     {
-      outputPointsFile << deformationvec[ j ][ i ] << " ";
+      float * binaryPoint = &pass->st_BinaryPoints[ first * MovingImageDimension ];
+      for( itk::SizeValueType j = 0; j < nrofpoints; ++j )
+      {
+        for( unsigned int i = 0; i < MovingImageDimension; i++ )
+        {
+          binaryPoint[ i ] = static_cast< float >( outputpointvec[ j ][ i ] );
+        }
+        itk::ByteSwapper< float >::SwapRangeFromSystemToLittleEndian(
+          binaryPoint, MovingImageDimension );
+        binaryPoint += MovingImageDimension;
+      }
+      continue;
     }
 
-    if( alsoMovingIndices )
+    /** Print the results. */
+    std::ostringstream text;
+    text << std::showpoint << std::fixed;
+    for( itk::SizeValueType j = 0; j < nrofpoints; ++j )
     {
-      /** The output index in moving image. */
-      outputPointsFile << "]\t; OutputIndexMoving = [ ";
-      for( unsigned int i = 0; i < MovingImageDimension; i++ )
+      text << "Point\t" << pass->st_FirstPoint + first + j;
+
+      /** The input index. */
+      if( pass->st_DerivedColumns )
       {
-        outputPointsFile << outputindexmovingvec[ j ][ i ] << " ";
+        text << "\t; InputIndex = [ ";
+        for( unsigned int i = 0; i < FixedImageDimension; i++ )
+        {
+          text << inputindexvec[ j ][ i ] << " ";
+        }
+        text << "]";
       }
-    }
 
-    outputPointsFile << "]" << std::endl;
-  } // end for nrofpoints
+      /** The input point. */
+      text << "\t; InputPoint = [ ";
+      for( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        text << inputpointvec[ j ][ i ] << " ";
+      }
 
-} // end TransformPointsSomePoints()
+      /** The output index in fixed image. */
+      if( pass->st_DerivedColumns )
+      {
+        pass->st_FixedGrid->TransformPhysicalPointToContinuousIndex(
+          outputpointvec[ j ], fixedcindex );
+        text << "]\t; OutputIndexFixed = [ ";
+        for( unsigned int i = 0; i < FixedImageDimension; i++ )
+        {
+          text << static_cast< FixedImageIndexValueType >(
+            itk::Math::Round< double >( fixedcindex[ i ] ) ) << " ";
+        }
+      }
+
+      /** The output point. */
+      text << "]\t; OutputPoint = [ ";
+      for( unsigned int i = 0; i < FixedImageDimension; i++ )
+      {
+        text << outputpointvec[ j ][ i ] << " ";
+      }
+
+      if( pass->st_DerivedColumns )
+      {
+        /** The output point minus the input point. */
+        deformation.CastFrom( outputpointvec[ j ] - inputpointvec[ j ] );
+        text << "]\t; Deformation = [ ";
+        for( unsigned int i = 0; i < MovingImageDimension; i++ )
+        {
+          text << deformation[ i ] << " ";
+        }
+
+        if( pass->st_MovingImage )
+        {
+          /** The output index in moving image. */
+          pass->st_MovingImage->TransformPhysicalPointToContinuousIndex(
+            outputpointvec[ j ], movingcindex );
+          text << "]\t; OutputIndexMoving = [ ";
+          for( unsigned int i = 0; i < MovingImageDimension; i++ )
+          {
+            text << static_cast< MovingImageIndexValueType >(
+              itk::Math::Round< double >( movingcindex[ i ] ) ) << " ";
+          }
+        }
+      }
+
+      text << "]\n";
+    }
+    pass->st_Text[ b ] = text.str();
+  }
+
+} // end TransformPointsRangeFunction()
 
 
 /**
@@ -1351,8 +1623,6 @@ TransformBase< TElastix >
     DummyIPPPixelType, FixedImageDimension, MeshTraitsType > MeshType;
   typedef itk::MeshFileReader< MeshType > MeshReaderType;
   typedef itk::MeshFileWriter< MeshType > MeshWriterType;
-  typedef itk::TransformMeshFilter<
-    MeshType, MeshType, CombinationTransformType >       TransformMeshFilterType;
 
   /** Read the input points. */
   typename MeshReaderType::Pointer meshReader = MeshReaderType::New();
@@ -1373,21 +1643,25 @@ TransformBase< TElastix >
   unsigned long nrofpoints = meshReader->GetOutput()->GetNumberOfPoints();
   elxout << "  Number of specified input points: " << nrofpoints << std::endl;
 
-  /** Apply the transform. */
+  /** Apply the transform, in parallel, with the batched TransformPoints().
+   * The transformed points replace the points of the read mesh, which keeps
+   * its cells and data.
+   */
   elxout << "  The input points are transformed." << std::endl;
-  typename TransformMeshFilterType::Pointer meshTransformer = TransformMeshFilterType::New();
-  meshTransformer->SetTransform(
-    const_cast< CombinationTransformType * >( this->GetAsCombinationTransform() ) );
-  meshTransformer->SetInput( meshReader->GetOutput() );
-  try
-  {
-    meshTransformer->Update();
-  }
-  catch( itk::ExceptionObject & err )
+  typename MeshType::Pointer mesh = meshReader->GetOutput();
+  mesh->DisconnectPipeline();
+  typename MeshType::PointsContainerPointer outputPoints = MeshType::PointsContainer::New();
+  outputPoints->Reserve( nrofpoints );
+  if( nrofpoints > 0 )
   {
-    xl::xout[ "error" ] << "  Error while transforming points." << std::endl;
-    xl::xout[ "error" ] << err << std::endl;
+    TransformPointArraysParameterType pass;
+    pass.st_Transform    = this->GetAsITKBaseType();
+    pass.st_InputPoints  = &mesh->GetPoints()->CastToSTLContainer()[ 0 ];
+    pass.st_OutputPoints = &outputPoints->CastToSTLContainer()[ 0 ];
+    itk::PersistentThreadPool::GetInstance()->ParallelFor(
+      nrofpoints, TransformPointsBlockSize, TransformPointArraysRangeFunction, &pass );
   }
+  mesh->SetPoints( outputPoints );
 
   /** Create filename and file stream. */
   std::string outputPointsFileName = this->m_Configuration
@@ -1397,7 +1671,16 @@ TransformBase< TElastix >
          <<  outputPointsFileName << std::endl;
   typename MeshWriterType::Pointer meshWriter = MeshWriterType::New();
   meshWriter->SetFileName( outputPointsFileName.c_str() );
-  meshWriter->SetInput( meshTransformer->GetOutput() );
+  meshWriter->SetInput( mesh );
+
+  /** Binary VTK files are much faster to write and to read. */
+  std::string outputPointsFormat = "text";
+  this->m_Configuration->ReadParameter( outputPointsFormat,
+    "OutputPointsFormat", 0, false );
+  if( outputPointsFormat == "binary" )
+  {
+    meshWriter->SetFileTypeAsBINARY();
+  }
 
   try
   {
@@ -1412,12 +1695,32 @@ TransformBase< TElastix >
 } // end TransformPointsSomePointsVTK()
 
 
+/**
+ * ************** TransformPointArraysRangeFunction *********************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::TransformPointArraysRangeFunction( void * userData, itk::ThreadIdType itkNotUsed( participantId ),
+  itk::SizeValueType begin, itk::SizeValueType end )
+{
+  const TransformPointArraysParameterType * pass
+    = static_cast< const TransformPointArraysParameterType * >( userData );
+  pass->st_Transform->TransformPoints( end - begin,
+    pass->st_InputPoints + begin, pass->st_OutputPoints + begin );
+
+} // end TransformPointArraysRangeFunction()
+
+
 /**
  * ************** TransformPointsAllPoints **********************
  *
  * This function transforms all indexes to a physical point.
  * The difference vector (= the deformation at that index) is
- * stored in an image of vectors (of floats).
+ * stored in an image of vectors (of floats). The points are
+ * transformed in batches of a scanline, multi-threaded, and the
+ * image is computed and written in parts.
  */
 
 template< class TElastix >
@@ -1431,7 +1734,7 @@ TransformBase< TElastix >
     float, FixedImageDimension >                      VectorPixelType;
   typedef itk::Image<
     VectorPixelType, FixedImageDimension >            DeformationFieldImageType;
-  typedef itk::TransformToDisplacementFieldFilter<
+  typedef itk::TransformToDisplacementFieldSource<
     DeformationFieldImageType, CoordRepType >         DeformationFieldGeneratorType;
   typedef itk::ChangeInformationImageFilter<
     DeformationFieldImageType >                       ChangeInfoFilterType;
@@ -1441,14 +1744,16 @@ TransformBase< TElastix >
   /** Create an setup deformation field generator. */
   typename DeformationFieldGeneratorType::Pointer defGenerator
     = DeformationFieldGeneratorType::New();
-  defGenerator->SetSize(
+  typename DeformationFieldImageType::RegionType outputRegion;
+  outputRegion.SetSize(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetSize() );
+  outputRegion.SetIndex(
+    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputStartIndex() );
+  defGenerator->SetOutputRegion( outputRegion );
   defGenerator->SetOutputSpacing(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputSpacing() );
   defGenerator->SetOutputOrigin(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputOrigin() );
-  defGenerator->SetOutputStartIndex(
-    this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputStartIndex() );
   defGenerator->SetOutputDirection(
     this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputDirection() );
   defGenerator->SetTransform( const_cast< const ITKBaseType * >( this->GetAsITKBaseType() ) );
@@ -1484,6 +1789,10 @@ TransformBase< TElastix >
   defWriter->SetInput( infoChanger->GetOutput() );
   defWriter->SetFileName( makeFileName.str().c_str() );
 
+  /** Compute and write the image in parts, to limit the memory use. */
+  defWriter->SetNumberOfStreamDivisions(
+    this->GetNumberOfStreamDivisions( sizeof( VectorPixelType ) ) );
+
   /** Do the writing. */
   elxout << "  Computing and writing the deformation field ..." << std::endl;
   try
@@ -1587,6 +1896,10 @@ TransformBase< TElastix >
   jacWriter->SetInput( infoChanger->GetOutput() );
   jacWriter->SetFileName( makeFileName.str().c_str() );
 
+  /** Compute and write the image in parts, to limit the memory use. */
+  jacWriter->SetNumberOfStreamDivisions(
+    this->GetNumberOfStreamDivisions( sizeof( typename JacobianImageType::PixelType ) ) );
+
   /** Do the writing. */
   elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
   try
@@ -1608,6 +1921,38 @@ TransformBase< TElastix >
 } // end ComputeDeterminantOfSpatialJacobian()
 
 
+/**
+ * ************** GetNumberOfStreamDivisions **********************
+ */
+
+template< class TElastix >
+unsigned int
+TransformBase< TElastix >
+::GetNumberOfStreamDivisions( const std::size_t pixelSize ) const
+{
+  /** Read the memory limit in megabytes; 0 means no streaming. */
+  double memoryLimit = 256.0;
+  this->m_Configuration->ReadParameter( memoryLimit,
+    "SpatialJacobianMemoryLimit", 0, false );
+  if( memoryLimit <= 0.0 ) { return 1; }
+
+  /** The size of the output, in megabytes. */
+  const typename FixedImageType::SizeType size
+    = this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetSize();
+  double imageSize = static_cast< double >( pixelSize ) / ( 1024.0 * 1024.0 );
+  for( unsigned int i = 0; i < FixedImageDimension; i++ )
+  {
+    imageSize *= static_cast< double >( size[ i ] );
+  }
+
+  /** The writer can not make more parts than there are slices. */
+  const double divisions = std::ceil( imageSize / memoryLimit );
+  return static_cast< unsigned int >( std::max( 1.0,
+    std::min( divisions, static_cast< double >( size[ FixedImageDimension - 1 ] ) ) ) );
+
+} // end GetNumberOfStreamDivisions()
+
+
 /**
  * ************** ComputeSpatialJacobian **********************
  */
@@ -1697,6 +2042,10 @@ TransformBase< TElastix >
     jacWriter->AddObserver( itk::StartEvent(), jacStartWriteCommand );
   }
 
+  /** Compute and write the image in parts, to limit the memory use. */
+  jacWriter->SetNumberOfStreamDivisions(
+    this->GetNumberOfStreamDivisions( sizeof( typename JacobianImageType::PixelType ) ) );
+
   /** Do the writing. */
   elxout << "  Computing and writing the spatial Jacobian..." << std::endl;
   try
@@ -1775,66 +2124,8 @@ void
 TransformBase< TElastix >
 ::AutomaticScalesEstimation( ScalesType & scales ) const
 {
-  typedef itk::ImageGridSampler< FixedImageType > ImageSamplerType;
-  typedef typename ImageSamplerType::Pointer      ImageSamplerPointer;
-  typedef typename
-    ImageSamplerType::ImageSampleContainerType ImageSampleContainerType;
-  typedef typename ImageSampleContainerType::Pointer       ImageSampleContainerPointer;
-  typedef typename ITKBaseType::JacobianType               JacobianType;
-  typedef typename ITKBaseType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
-
-  const ITKBaseType * const thisITK = this->GetAsITKBaseType();
-  const unsigned int        outdim  = MovingImageDimension;
-  const unsigned int        N       = thisITK->GetNumberOfParameters();
-  scales = ScalesType( N );
-
-  /** Set up grid sampler. */
-  ImageSamplerPointer sampler = ImageSamplerType::New();
-  sampler->SetInput(
-    this->GetRegistration()->GetAsITKBaseType()->GetFixedImage() );
-  sampler->SetInputImageRegion(
-    this->GetRegistration()->GetAsITKBaseType()->GetFixedImageRegion() );
-
-  /** Compute the grid spacing. */
-  unsigned long nrofsamples = 10000;
-  sampler->SetNumberOfSamples( nrofsamples );
-
-  /** Get samples and check the actually obtained number of samples. */
-  sampler->Update();
-  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
-  nrofsamples = sampleContainer->Size();
-  if( nrofsamples == 0 )
-  {
-    /** \todo: should we demand a minimum number (~100) of voxels? */
-    itkExceptionMacro( << "No valid voxels found to estimate the scales." );
-  }
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-
-  /** initialize */
-  scales.Fill( 0.0 );
-
-  /** Read fixed coordinates and get Jacobian. */
-  for( iter = begin; iter != end; ++iter )
-  {
-    const InputPointType & point = ( *iter ).Value().m_ImageCoordinates;
-    //const JacobianType & jacobian = thisITK->GetJacobian( point );
-    JacobianType jacobian; NonZeroJacobianIndicesType nzji;
-    thisITK->GetJacobian( point, jacobian, nzji );
-
-    /** Square each element of the Jacobian and add each row
-     * to the newscales.
-     */
-    for( unsigned int d = 0; d < outdim; ++d )
-    {
-      ScalesType jacd( jacobian[ d ], N, false );
-      scales += element_product( jacd, jacd );
-    }
-  }
-  scales /= static_cast< double >( nrofsamples );
+  this->ComputeMeanSquaredJacobians(
+    this->GetRegistration()->GetAsITKBaseType()->GetFixedImageRegion(), scales );
 
 } // end AutomaticScalesEstimation()
 
@@ -1849,25 +2140,10 @@ TransformBase< TElastix >
 ::AutomaticScalesEstimationStackTransform(
   const unsigned int & numberOfSubTransforms, ScalesType & scales ) const
 {
-  typedef typename FixedImageType::RegionType FixedImageRegionType;
   typedef typename FixedImageType::IndexType  FixedImageIndexType;
   typedef typename FixedImageType::SizeType   SizeType;
 
-  typedef itk::ImageGridSampler< FixedImageType > ImageSamplerType;
-  typedef typename ImageSamplerType::Pointer      ImageSamplerPointer;
-  typedef typename
-    ImageSamplerType::ImageSampleContainerType ImageSampleContainerType;
-  typedef typename ImageSampleContainerType::Pointer       ImageSampleContainerPointer;
-  typedef typename ITKBaseType::JacobianType               JacobianType;
-  typedef typename ITKBaseType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
-
-  const ITKBaseType * const thisITK = this->GetAsITKBaseType();
-  const unsigned int        outdim  = FixedImageDimension;
-  const unsigned int        N       = thisITK->GetNumberOfParameters();
-
-  /** initialize */
-  scales = ScalesType( N );
-  scales.Fill( 0.0 );
+  const unsigned int N = this->GetAsITKBaseType()->GetNumberOfParameters();
 
   /** Get fixed image region from registration. */
   const FixedImageRegionType & inputRegion = this->GetRegistration()->GetAsITKBaseType()->GetFixedImageRegion();
@@ -1887,47 +2163,7 @@ TransformBase< TElastix >
   desiredRegion.SetSize( size );
   desiredRegion.SetIndex( start );
 
-  /** Set up the grid sampler. */
-  ImageSamplerPointer sampler = ImageSamplerType::New();
-  sampler->SetInput( this->GetRegistration()->GetAsITKBaseType()->GetFixedImage() );
-  sampler->SetInputImageRegion( desiredRegion );
-
-  /** Compute the grid spacing. */
-  unsigned long nrofsamples = 10000;
-  sampler->SetNumberOfSamples( nrofsamples );
-
-  /** Get samples and check the actually obtained number of samples. */
-  sampler->Update();
-  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
-  nrofsamples = sampleContainer->Size();
-  if( nrofsamples == 0 )
-  {
-    /** \todo: should we demand a minimum number (~100) of voxels? */
-    itkExceptionMacro( << "No valid voxels found to estimate the scales." );
-  }
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-
-  /** Read fixed coordinates and get Jacobian. */
-  JacobianType               jacobian;
-  NonZeroJacobianIndicesType nzji;
-  for( iter = begin; iter != end; ++iter )
-  {
-    const InputPointType & point = ( *iter ).Value().m_ImageCoordinates;
-    //const JacobianType & jacobian = thisITK->GetJacobian( point );
-    thisITK->GetJacobian( point, jacobian, nzji );
-
-    /** Square each element of the Jacobian and add each row to the new scales. */
-    for( unsigned int d = 0; d < outdim; ++d )
-    {
-      ScalesType jacd( jacobian[ d ], N, false );
-      scales += element_product( jacd, jacd );
-    }
-  }
-  scales /= static_cast< double >( nrofsamples );
+  this->ComputeMeanSquaredJacobians( desiredRegion, scales );
 
   const unsigned int numberOfScalesSubTransform = N / numberOfSubTransforms; //(FixedImageDimension)*(FixedImageDimension - 1);
 
@@ -1942,6 +2178,62 @@ TransformBase< TElastix >
 } // end AutomaticScalesEstimationStackTransform()
 
 
+/**
+ * ************** ComputeMeanSquaredJacobians ***************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::ComputeMeanSquaredJacobians( const FixedImageRegionType & region,
+  ScalesType & scales ) const
+{
+  typedef itk::ComputeJacobianTerms< FixedImageType, ITKBaseType > ComputeJacobianTermsType;
+
+  const ITKBaseType * const thisITK = this->GetAsITKBaseType();
+  const FixedImageType *    fixedImage
+    = this->GetRegistration()->GetAsITKBaseType()->GetFixedImage();
+
+  /** Reuse the previous estimate if only the parameters changed. */
+  AutomaticScalesGeometryType geometry;
+  geometry.m_FixedImage         = fixedImage;
+  geometry.m_FixedImageMTime    = fixedImage->GetMTime();
+  geometry.m_Region             = region;
+  geometry.m_NumberOfParameters = thisITK->GetNumberOfParameters();
+  geometry.m_FixedParameters    = thisITK->GetFixedParameters();
+  if( this->m_AutomaticScales.GetSize() > 0
+    && this->m_AutomaticScalesGeometry == geometry )
+  {
+    elxout << "  Reusing the previously estimated scales." << std::endl;
+    scales = this->m_AutomaticScales;
+    return;
+  }
+
+  /** Compute the mean squared Jacobian of each parameter, on a grid of
+   * 10000 points, in parallel.
+   */
+  typename ComputeJacobianTermsType::Pointer computeJacobianTerms
+    = ComputeJacobianTermsType::New();
+  computeJacobianTerms->SetFixedImage( fixedImage );
+  computeJacobianTerms->SetFixedImageRegion( region );
+  computeJacobianTerms->SetTransform( const_cast< ITKBaseType * >( thisITK ) );
+  computeJacobianTerms->SetNumberOfJacobianMeasurements( 10000 );
+  try
+  {
+    computeJacobianTerms->ComputeDiagonalOfCovariance( scales );
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** \todo: should we demand a minimum number (~100) of voxels? */
+    itkExceptionMacro( << "Could not estimate the scales: " << excp.GetDescription() );
+  }
+
+  this->m_AutomaticScales         = scales;
+  this->m_AutomaticScalesGeometry = geometry;
+
+} // end ComputeMeanSquaredJacobians()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxTransformBase_hxx
@@ -200,6 +200,16 @@ Configuration
   /** Store the command line arguments. */
   this->m_CommandLineArgumentMap = _arg;
 
+  /** Remember the parameter file the map was read from, if given, so that
+   * it can still be printed to the log file by BeforeAll().
+   */
+  const std::string p = this->GetCommandLineArgument( "-p" );
+  if( p != "" )
+  {
+    this->SetParameterFileName( p.c_str() );
+    this->m_ParameterFileParser->SetParameterFileName( this->m_ParameterFileName );
+  }
+
   this->m_ParameterMapInterface->SetParameterMap( inputMap );
 
   /** Silently check in the parameter file if error messages should be printed. */
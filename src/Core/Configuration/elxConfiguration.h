@@ -215,6 +215,27 @@ public:
   }
 
 
+  /** A handle to a parameter, for components that read it repeatedly.
+   * See itk::ParameterMapInterface::GetParameterHandle().
+   */
+  typedef ParameterMapInterfaceType::ParameterHandle ParameterHandle;
+
+  ParameterHandle GetParameterHandle( const std::string & parameterName ) const
+  {
+    return this->m_ParameterMapInterface->GetParameterHandle( parameterName );
+  }
+
+
+  /** Read a parameter by its handle; no warning is printed. */
+  template< class T >
+  bool ReadParameter( T & parameterValue, const ParameterHandle handle,
+    const unsigned int entry_nr ) const
+  {
+    return this->m_ParameterMapInterface->ReadParameter(
+      parameterValue, handle, entry_nr );
+  }
+
+
   /** Read a range of parameters from the parameter file. */
   template< class T >
   bool ReadParameter( std::vector< T > & parameterValues,
@@ -42,6 +42,11 @@
 
 #include "itkMacro.h" // itkTypeMacroNoParent
 
+namespace itk
+{
+class RegistrationCheckpoint;
+}
+
 /** The current elastix version. */
 #define __ELASTIX_VERSION 4.801
 
@@ -101,6 +106,16 @@ public:
   virtual void AfterEachIteration( void ) {}
   virtual void AfterRegistration( void ) {}
 
+  /**
+   * Methods to save the internal state of a component to a checkpoint, and
+   * to restore it when a registration is resumed from that checkpoint. They
+   * are called after AfterEachIteration() and after BeforeEachResolution(),
+   * respectively. The default saves and restores nothing. The names of the
+   * entries should start with the component label.
+   */
+  virtual void WriteCheckpoint( itk::RegistrationCheckpoint & ) const {}
+  virtual void ReadCheckpoint( const itk::RegistrationCheckpoint & ) {}
+
   /**
    * The name of the component in the ComponentDatabase.
    * Override this function not directly, but with the
@@ -55,6 +55,29 @@ ComponentDatabase::GetIndexMap( void )
 }   // end GetIndexMap
 
 
+/**
+ * ********************** SetInstaller **************************
+ */
+
+int
+ComponentDatabase::SetInstaller(
+  const ComponentDescriptionType & name,
+  PtrToInstaller installer )
+{
+  /** Check if a component with this name has been registered already.
+   * If not, insert the name + installer in the map.
+   */
+  if( !this->InstallerMap.insert( InstallerMapEntryType( name, installer ) ).second )
+  {
+    xout[ "error" ] << "Error: " << std::endl;
+    xout[ "error" ] << name << " - This component has already been installed!" << std::endl;
+    return 1;
+  }
+  return 0;
+
+}   // end SetInstaller
+
+
 /**
  * *********************** SetCreator ***************************
  */
@@ -136,26 +159,41 @@ ComponentDatabase::GetCreator(
   const ComponentDescriptionType & name,
   IndexType i )
 {
-  /** Get the map */
-  CreatorMapType map = GetCreatorMap();
-
   /** Make a key with the input arguments */
   CreatorMapKeyType key( name, i );
 
-  /** Check if this key has been defined. If yes, return the 'creator'
-   * that is linked to it.
+  this->CreatorMapLock.Lock();
+
+  /** Check if this key has been defined. If not, let the installer of the
+   * component install it now. If yes, return the 'creator' that is linked
+   * to it.
    */
-  if( map.count( key ) == 0 )    // of gewoon !map.count( key ) als boven??
+  CreatorMapType::const_iterator it = this->CreatorMap.find( key );
+  if( it == this->CreatorMap.end() )
   {
-    xout[ "error" ] << "Error: " << std::endl;
-    xout[ "error" ] << name << "(index " << i << ") - This component is not installed!" << std::endl;
-    return 0;
+    InstallerMapType::const_iterator installer = this->InstallerMap.find( name );
+    if( installer != this->InstallerMap.end()
+      && installer->second( this, i ) == 0 )
+    {
+      it = this->CreatorMap.find( key );
+    }
   }
-  else
+
+  PtrToCreator creator = 0;
+  if( it != this->CreatorMap.end() )
   {
-    return map[ key ];
+    creator = it->second;
   }
 
+  this->CreatorMapLock.Unlock();
+
+  if( creator == 0 )
+  {
+    xout[ "error" ] << "Error: " << std::endl;
+    xout[ "error" ] << name << "(index " << i << ") - This component is not installed!" << std::endl;
+  }
+  return creator;
+
 }   // end GetCreator
 
 
@@ -170,9 +208,6 @@ ComponentDatabase::GetIndex(
   const PixelTypeDescriptionType & movingPixelType,
   ImageDimensionType movingDimension )
 {
-  /** Get the map */
-  IndexMapType map = GetIndexMap();
-
   /** Make a key with the input arguments */
   ImageTypeDescriptionType fixedImage( fixedPixelType, fixedDimension );
   ImageTypeDescriptionType movingImage( movingPixelType, movingDimension );
@@ -181,7 +216,8 @@ ComponentDatabase::GetIndex(
   /** Check if this key has been defined. If yes, return the 'index'
    * that is linked to it.
    */
-  if( map.count( key ) == 0 )
+  IndexMapType::const_iterator it = this->IndexMap.find( key );
+  if( it == this->IndexMap.end() )
   {
     xout[ "error" ] << "ERROR:\n"
                     << "  FixedImageType:  " << fixedDimension << "D " << fixedPixelType << std::endl
@@ -196,7 +232,7 @@ ComponentDatabase::GetIndex(
   }
   else
   {
-    return map[ key ];
+    return it->second;
   }
 
 }   // end GetIndex
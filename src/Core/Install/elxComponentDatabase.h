@@ -21,6 +21,7 @@
 
 #include "itkObject.h"
 #include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
 #include <iostream>
 #include <string>
 #include <utility>
@@ -45,6 +46,12 @@ namespace elastix
  * known" by calling the elxInstallMacro, which is defined in
  * elxMacro.h .
  *
+ * The components are installed lazily: at start-up every component only
+ * registers an installer function, with SetInstaller(). The creator of a
+ * component for a specific pixeltype/dimension is installed by its
+ * installer the first time it is requested via GetCreator(). The CreatorMap
+ * therefore only contains the creators that have been requested so far.
+ *
  * \sa elxInstallFunctions
  * \ingroup Install
  */
@@ -84,6 +91,15 @@ public:
     CreatorMapValueType >              CreatorMapType;
   typedef CreatorMapType::value_type CreatorMapEntryType;
 
+  /** PtrToInstaller is a pointer to a function that installs the creator
+   * of one component for index i in the database. Returns 0 on success.
+   */
+  typedef int (* PtrToInstaller)( ComponentDatabase *, IndexType );
+  typedef std::map<
+    ComponentDescriptionType,
+    PtrToInstaller >                   InstallerMapType;
+  typedef InstallerMapType::value_type InstallerMapEntryType;
+
   /** Typedefs for the IndexMap.*/
 
   /** The ImageTypeDescription contains the pixeltype (as a string)
@@ -112,7 +128,13 @@ public:
 
   IndexMapType & GetIndexMap( void );
 
-  /** Functions to set an entry in a map.*/
+  /** Functions to set an entry in a map. SetCreator is called by the
+   * installers, and is not thread safe.
+   */
+  int SetInstaller(
+    const ComponentDescriptionType & name,
+    PtrToInstaller installer );
+
   int SetCreator(
     const ComponentDescriptionType & name,
     IndexType i,
@@ -125,7 +147,9 @@ public:
     ImageDimensionType movingDimension,
     IndexType i );
 
-  /** Functions to get an entry in a map */
+  /** Functions to get an entry in a map. GetCreator installs the creator
+   * first, if that has not been done yet. It is thread safe.
+   */
   PtrToCreator GetCreator(
     const ComponentDescriptionType & name,
     IndexType i );
@@ -141,8 +165,12 @@ protected:
   ComponentDatabase(){}
   virtual ~ComponentDatabase(){}
 
-  CreatorMapType CreatorMap;
-  IndexMapType   IndexMap;
+  CreatorMapType   CreatorMap;
+  IndexMapType     IndexMap;
+  InstallerMapType InstallerMap;
+
+  /** Guards the lazy installation in GetCreator. */
+  itk::SimpleFastMutexLock CreatorMapLock;
 
 private:
 
@@ -156,7 +156,9 @@ ComponentLoader::LoadComponents( const char * /** argv0 */ )
 
   elxout << "Installing all components." << std::endl;
 
-  /** Fill the component database */
+  /** Fill the component database. This only registers the installers of
+   * the components; a component is installed for an image type when it is
+   * first requested, see ComponentDatabase::GetCreator(). */
   installReturnCode = InstallAllComponents( this->m_ComponentDatabase );
 
   if( installReturnCode )
@@ -84,9 +84,12 @@
  *
  * Details: a function "int _classname##InstallComponent( _cdb )" is defined.
  * In this function a template is defined, _classname##_install<VIndex>.
- * It contains the ElastixTypedef<VIndex>, and recursive function DO(cdb).
- * DO installs the component for all defined ElastixTypedefs (so for all
- * supported image types).
+ * It contains the ElastixTypedef<VIndex>, and recursive function DO(cdb,i).
+ * DO installs the component for the supported image type with index i.
+ * InstallComponent only registers DO in the component database; the
+ * component is installed for an image type when the database is first asked
+ * for it (see ComponentDatabase::GetCreator()). This keeps the start-up of
+ * elastix and transformix cheap.
  *
  */
 #define elxInstallMacro( _classname ) \
@@ -96,28 +99,34 @@
 public: \
     typedef typename::elx::ElastixTypedef< VIndex >::ElastixType ElastixType; \
     typedef::elx::ComponentDatabase::ComponentDescriptionType    ComponentDescriptionType; \
-    static int DO( ::elx::ComponentDatabase * cdb ) \
+    typedef::elx::ComponentDatabase::IndexType                   IndexType; \
+    static int DO( ::elx::ComponentDatabase * cdb, IndexType i ) \
     { \
-      ComponentDescriptionType name  = ::elx::_classname< ElastixType >::elxGetClassNameStatic(); \
-      int                      dummy = ::elx::InstallFunctions< ::elx::_classname< ElastixType > >::InstallComponent( name, VIndex, cdb ); \
+      if( i == VIndex ) \
+      { \
+        ComponentDescriptionType name = ::elx::_classname< ElastixType >::elxGetClassNameStatic(); \
+        return ::elx::InstallFunctions< ::elx::_classname< ElastixType > >::InstallComponent( name, VIndex, cdb ); \
+      } \
       if( ::elx::ElastixTypedef< VIndex + 1 >::Defined() ) \
-      { return _classname##_install< VIndex + 1 >::DO( cdb ); } \
-      return dummy;  \
+      { return _classname##_install< VIndex + 1 >::DO( cdb, i ); } \
+      return 1;  \
     } \
   }; \
   template< > \
   class _classname##_install< ::elx::NrOfSupportedImageTypes + 1 > \
   { \
 public: \
-    typedef::elx::ComponentDatabase::ComponentDescriptionType ComponentDescriptionType; \
-    static int DO( ::elx::ComponentDatabase * /** cdb */ ) \
-    { return 0; } \
+    typedef::elx::ComponentDatabase::IndexType IndexType; \
+    static int DO( ::elx::ComponentDatabase * /** cdb */, IndexType /** i */ ) \
+    { return 1; } \
   }; \
   extern "C" int _classname##InstallComponent( \
   ::elx::ComponentDatabase * _cdb ) \
   { \
-    int _InstallDummy##_classname = _classname##_install< 1 >::DO( _cdb  ); \
-    return _InstallDummy##_classname; \
+    typedef::elx::ElastixTypedef< 1 >::ElastixType ElastixType; \
+    return _cdb->SetInstaller( \
+      ::elx::_classname< ElastixType >::elxGetClassNameStatic(), \
+      _classname##_install< 1 >::DO ); \
   } //ignore semicolon
 
 /**
@@ -64,6 +64,7 @@ ElastixBase::ElastixBase()
   /** Initialize initialTransform and final transform. */
   this->m_InitialTransform = 0;
   this->m_FinalTransform   = 0;
+  this->m_UseLiveTransform = false;
 
   /** From Elastix 4.3 to 4.7: Ignore direction cosines by default, for
    * backward compatability. From Elastix 4.8: set it to true by default.*/
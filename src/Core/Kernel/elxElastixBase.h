@@ -38,6 +38,8 @@
 #include "itkVectorContainer.h"
 #include "itkImageFileReader.h"
 #include "itkChangeInformationImageFilter.h"
+#include "itkMemoryMappedMetaImageReader.h"
+#include <itksys/SystemTools.hxx>
 
 #include <fstream>
 #include <iomanip>
@@ -305,6 +307,23 @@ public:
   elxSetObjectMacro( FinalTransform, ObjectType );
   elxGetObjectMacro( FinalTransform, ObjectType );
 
+  /** Set/Get whether the transform component is a live transform of an
+   * earlier registration, see TransformixMain::SetTransform(). Its
+   * parameters and initial transforms are then not read from the
+   * transform parameter map by ApplyTransform().
+   */
+  virtual void SetUseLiveTransform( const bool _arg )
+  {
+    this->m_UseLiveTransform = _arg;
+  }
+
+
+  virtual bool GetUseLiveTransform( void ) const
+  {
+    return this->m_UseLiveTransform;
+  }
+
+
   /** Empty Run()-function to be overridden. */
   virtual int Run( void ) = 0;
 
@@ -394,16 +413,32 @@ public:
     typedef typename ImageType::DirectionType              DirectionType;
     typedef itk::ChangeInformationImageFilter< ImageType > ChangeInfoFilterType;
     typedef typename ChangeInfoFilterType::Pointer         ChangeInfoFilterPointer;
-
+    typedef itk::MemoryMappedMetaImageReader< ImageType >  MappedReaderType;
+    typedef typename MappedReaderType::Pointer             MappedReaderPointer;
+
+    /** Reads the images in the file names. If useMemoryMapping is true, the
+     * uncompressed MetaImages are mapped into memory, see
+     * MemoryMappedMetaImageReader, and the pixels of another type are cast
+     * directly from the mapped file. The other images, and the MetaImages
+     * that cannot be mapped, are read by the ImageFileReader.
+     */
     static DataObjectContainerPointer GenerateImageContainer(
       FileNameContainerType * fileNameContainer, const std::string & imageDescription,
-      bool useDirectionCosines, DirectionType * originalDirectionCosines = NULL )
+      bool useDirectionCosines, DirectionType * originalDirectionCosines = NULL,
+      bool useMemoryMapping = false )
     {
       DataObjectContainerPointer imageContainer = DataObjectContainerType::New();
 
       /** Loop over all image filenames. */
       for( unsigned int i = 0; i < fileNameContainer->Size(); ++i )
       {
+        /** Try the memory mapped reader first, if desired. */
+        ImagePointer mappedImage;
+        if( useMemoryMapping )
+        {
+          mappedImage = ReadMappedImage( fileNameContainer->ElementAt( i ) );
+        }
+
         /** Setup reader. */
         ImageReaderPointer imageReader = ImageReaderType::New();
         imageReader->SetFileName( fileNameContainer->ElementAt( i ).c_str() );
@@ -412,7 +447,14 @@ public:
         direction.SetIdentity();
         infoChanger->SetOutputDirection( direction );
         infoChanger->SetChangeDirection( !useDirectionCosines );
-        infoChanger->SetInput( imageReader->GetOutput() );
+        if( mappedImage.IsNotNull() )
+        {
+          infoChanger->SetInput( mappedImage );
+        }
+        else
+        {
+          infoChanger->SetInput( imageReader->GetOutput() );
+        }
 
         /** Do the reading. */
         try
@@ -437,7 +479,8 @@ public:
         /** Store the original direction cosines */
         if( originalDirectionCosines )
         {
-          *originalDirectionCosines = imageReader->GetOutput()->GetDirection();
+          *originalDirectionCosines = mappedImage.IsNotNull()
+            ? mappedImage->GetDirection() : imageReader->GetOutput()->GetDirection();
         }
 
       } // end for i
@@ -447,6 +490,38 @@ public:
     } // end static method GenerateImageContainer
 
 
+    /** Reads an uncompressed MetaImage via a memory mapping. Returns a null
+     * pointer if the file is not a MetaImage, or cannot be mapped.
+     */
+    static ImagePointer ReadMappedImage( const std::string & fileName )
+    {
+      const std::string extension
+        = itksys::SystemTools::LowerCase( itksys::SystemTools::GetFilenameLastExtension( fileName ) );
+      if( extension != ".mha" && extension != ".mhd" )
+      {
+        return NULL;
+      }
+
+      MappedReaderPointer mappedReader = MappedReaderType::New();
+      mappedReader->SetFileName( fileName );
+      mappedReader->CastToPixelTypeOn();
+      try
+      {
+        mappedReader->Update();
+      }
+      catch( itk::ExceptionObject & )
+      {
+        /** The ImageFileReader reads the file instead. */
+        return NULL;
+      }
+
+      ImagePointer image = mappedReader->GetOutput();
+      image->DisconnectPipeline();
+      return image;
+
+    } // end static method ReadMappedImage
+
+
     /** Static method overloaded GenerateImageContainer. */
     static DataObjectContainerPointer GenerateImageContainer( DataObjectPointer image )
     {
@@ -534,6 +609,7 @@ private:
   /** The initial and final transform. */
   ObjectPointer m_InitialTransform;
   ObjectPointer m_FinalTransform;
+  bool          m_UseLiveTransform;
 
   /** Use or ignore direction cosines. */
   bool m_UseDirectionCosines;
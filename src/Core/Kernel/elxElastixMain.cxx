@@ -28,9 +28,15 @@
 
 #include "elxMacro.h"
 #include "itkMultiThreader.h"
+#include "itkAsynchronousOutputFileStream.h"
+#include "itkBackgroundWriter.h"
+#include "itkPersistentThreadPool.h"
+#include "itkAlignedBufferArena.h"
+#include "itkArenaImportImageContainerFactory.h"
 
 #ifdef ELASTIX_USE_OPENCL
 #include "itkOpenCLSetup.h"
+#include <sstream>
 #endif
 
 namespace elastix
@@ -47,14 +53,34 @@ using namespace xl;
 
 /** \todo move to ElastixMain class, as static vars? */
 
+/** An xout cell that writes the buffered output of all asynchronous
+ * file streams after every message, so that errors reach the log file
+ * even if elastix does not exit normally.
+ */
+class xoutsynchronized_type : public xoutsimple_type
+{
+public:
+
+  xoutsynchronized_type() { this->m_Call = true; }
+
+protected:
+
+  virtual void Callback( void ) ITK_OVERRIDE
+  {
+    itk::AsynchronousOutputFileStream::SynchronizeAll();
+  }
+
+
+};
+
 /** xout TargetCells. */
-xoutbase_type   g_xout;
-xoutsimple_type g_WarningXout;
-xoutsimple_type g_ErrorXout;
-xoutsimple_type g_StandardXout;
-xoutsimple_type g_CoutOnlyXout;
-xoutsimple_type g_LogOnlyXout;
-std::ofstream   g_LogFileStream;
+xoutbase_type                     g_xout;
+xoutsimple_type                   g_WarningXout;
+xoutsynchronized_type             g_ErrorXout;
+xoutsimple_type                   g_StandardXout;
+xoutsimple_type                   g_CoutOnlyXout;
+xoutsimple_type                   g_LogOnlyXout;
+itk::AsynchronousOutputFileStream g_LogFileStream;
 
 /**
  * ********************* xoutSetup ******************************
@@ -154,6 +180,8 @@ ElastixMain::ElastixMain()
   this->m_InitialTransform = 0;
   this->m_TransformParametersMap.clear();
 
+  this->m_RegistrationProgress = 0;
+
 } // end Constructor
 
 
@@ -267,6 +295,7 @@ ElastixMain::Run( void )
   /** Set process properties. */
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
+  this->SetBufferArena();
 
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
@@ -300,9 +329,21 @@ ElastixMain::Run( void )
   this->m_Configuration->ReadParameter( userSuppliedOpenCLDeviceID,
     "OpenCLDeviceID", 0, false );
 
+  /** Check if user wants to use all devices of the platform. */
+  bool userSuppliedOpenCLUseMultipleDevices = false;
+  this->m_Configuration->ReadParameter( userSuppliedOpenCLUseMultipleDevices,
+    "OpenCLUseMultipleDevices", 0, false );
+
+  /** Check if user wants to profile the OpenCL kernels and transfers. */
+  bool userSuppliedOpenCLProfiling = false;
+  this->m_Configuration->ReadParameter( userSuppliedOpenCLProfiling,
+    "OpenCLProfiling", 0, false );
+  itk::SetOpenCLProfilingEnabled( userSuppliedOpenCLProfiling );
+
   std::string errorMessage              = "";
   const bool  creatingContextSuccessful = itk::CreateOpenCLContext(
-    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID );
+    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID,
+    userSuppliedOpenCLUseMultipleDevices );
   if( !creatingContextSuccessful )
   {
     /** Report and disable the GPU by releasing the context. */
@@ -315,6 +356,12 @@ ElastixMain::Run( void )
 
   /** Create a log file. */
   itk::CreateOpenCLLogger( "elastix", this->m_Configuration->GetCommandLineArgument( "-out" ) );
+
+  /** Cache the OpenCL program binaries between runs, if requested. */
+  std::string openCLProgramCacheDirectory = "";
+  this->m_Configuration->ReadParameter( openCLProgramCacheDirectory,
+    "OpenCLProgramCacheDirectory", 0, false );
+  itk::SetOpenCLProgramCacheDirectory( openCLProgramCacheDirectory );
 #endif
 
   /** Set some information in the ElastixBase. */
@@ -388,7 +435,10 @@ ElastixMain::Run( void )
   this->GetElastixBase()->SetOriginalFixedImageDirectionFlat(
     this->GetOriginalFixedImageDirectionFlat() );
 
-  /** Run elastix! */
+  /** Run elastix! The loops in Common poll the current progress object
+   * for a cancellation request.
+   */
+  itk::RegistrationProgress::SetCurrent( this->m_RegistrationProgress );
   try
   {
     errorCode = this->GetElastixBase()->Run();
@@ -413,6 +463,15 @@ ElastixMain::Run( void )
     errorCode = 1;
   }
 
+  itk::RegistrationProgress::SetCurrent( 0 );
+
+  /** Report the OpenCL kernel timings and transfers, if requested. */
+#ifdef ELASTIX_USE_OPENCL
+  std::ostringstream openCLProfiling;
+  itk::PrintOpenCLProfiling( openCLProfiling );
+  elxout << openCLProfiling.str();
+#endif
+
   /** Return the final transform. */
   this->m_FinalTransform = this->GetElastixBase()->GetFinalTransform();
 
@@ -767,6 +826,15 @@ ElastixMain::LoadComponents( void )
 void
 ElastixMain::UnloadComponents( void )
 {
+  /** The background writes use the code of the components; wait for them. */
+  const std::vector< std::string > writeErrors
+    = itk::BackgroundWriter::GetInstance()->WaitForAll();
+  for( std::size_t i = 0; i < writeErrors.size(); ++i )
+  {
+    xout[ "error" ] << "ERROR: " << writeErrors[ i ] << std::endl;
+  }
+  itk::BackgroundWriter::GetInstance()->SetEnabled( false );
+
   s_CDB = 0;
   s_ComponentLoader->SetComponentDatabase( 0 );
 
@@ -983,9 +1051,47 @@ ElastixMain::SetMaximumNumberOfThreads( void ) const
     itk::MultiThreader::SetGlobalMaximumNumberOfThreads(
       maximumNumberOfThreads );
   }
+
+  /** Let the persistent thread pool follow the (possibly reduced) default. */
+  itk::PersistentThreadPool::GetInstance()->SetNumberOfThreads(
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads() );
+
+  /** Optionally pin the threads of the pool to the processors. */
+  const std::string threadPlacement
+    = this->m_Configuration->GetCommandLineArgument( "-threadplacement" );
+  if( threadPlacement != ""
+    && !itk::PersistentThreadPool::GetInstance()->SetThreadPlacement( threadPlacement ) )
+  {
+    xl::xout[ "warning" ]
+      << "Unsupported -threadplacement value. Specify one of <none, compact, scatter>." << std::endl;
+  }
+
 } // end SetMaximumNumberOfThreads()
 
 
+/**
+ * *********************** SetBufferArena *************************
+ */
+
+void
+ElastixMain::SetBufferArena( void ) const
+{
+  /** Allocate the image buffers from the arena. */
+  itk::ArenaImportImageContainerFactory::RegisterOneFactory();
+
+  /** Optionally back the large buffers by huge pages. */
+  const std::string hugePages
+    = this->m_Configuration->GetCommandLineArgument( "-hugepages" );
+  if( hugePages != ""
+    && !itk::AlignedBufferArena::GetInstance()->SetHugePages( hugePages ) )
+  {
+    xl::xout[ "warning" ]
+      << "Unsupported -hugepages value. Specify one of <off, transparent, explicit>." << std::endl;
+  }
+
+} // end SetBufferArena()
+
+
 /**
  * ******************** SetOriginalFixedImageDirectionFlat ********************
  */
@@ -23,6 +23,7 @@
 
 #include "elxElastixBase.h"
 #include "itkObject.h"
+#include "itkRegistrationProgress.h"
 
 #include <iostream>
 #include <fstream>
@@ -212,6 +213,13 @@ public:
   itkSetObjectMacro( InitialTransform, ObjectType );
   itkGetObjectMacro( InitialTransform, ObjectType );
 
+  /** Set/Get the object that receives the progress of the registration,
+   * and through which it can be cancelled. Run() makes it the current
+   * itk::RegistrationProgress while it runs. Default: 0, none.
+   */
+  itkSetObjectMacro( RegistrationProgress, itk::RegistrationProgress );
+  itkGetObjectMacro( RegistrationProgress, itk::RegistrationProgress );
+
   /** Set/Get the original fixed image direction as a flat array
    * (d11 d21 d31 d21 d22 etc ) */
   virtual void SetOriginalFixedImageDirectionFlat(
@@ -266,12 +274,22 @@ public:
    */
   virtual void SetProcessPriority( void ) const;
 
-  /** Set maximum number of threads, which is read from the command line arguments.
+  /** Set maximum number of threads, which is read from the command line arguments,
+   * and the placement of the threads of the persistent thread pool.
    * Syntax:
    * -threads \<int\>
+   * -threadplacement \<none|compact|scatter\>
    */
   virtual void SetMaximumNumberOfThreads( void ) const;
 
+  /** Let the images of scalar pixels, the sample arrays and the derivatives
+   * of the metrics get their buffers from the aligned buffer arena, and set
+   * its huge page backing, which is read from the command line arguments.
+   * Syntax:
+   * -hugepages \<off|transparent|explicit\>
+   */
+  virtual void SetBufferArena( void ) const;
+
   /** Functions to get/set the ComponentDatabase. */
   static ComponentDatabase * GetComponentDatabase( void )
   {
@@ -329,6 +347,9 @@ protected:
 
   /** The initial transform. */
   ObjectPointer m_InitialTransform;
+
+  /** The progress callback and cancellation request. */
+  itk::RegistrationProgress::Pointer m_RegistrationProgress;
   /** Transformation parameters map containing parameters that is the
    *  result of registration.
    */
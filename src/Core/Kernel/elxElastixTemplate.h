@@ -39,6 +39,13 @@
 #include "elxTransformBase.h"
 
 #include "itkTimeProbe.h"
+#include "itkAsynchronousOutputFileStream.h"
+#include "itkBackgroundWriter.h"
+#include "itkRegistrationCheckpoint.h"
+#include "itkRegistrationProgress.h"
+#include "itkPhaseTimer.h"
+#include "itkMemoryAccounting.h"
+#include "itkScaledSingleValuedNonLinearOptimizer.h"
 
 #include <sstream>
 #include <fstream>
@@ -94,6 +101,83 @@ namespace elastix
  *    example: <tt>(WriteTransformParametersEachResolution "true")</tt>\n
  *    This parameter can not be specified for each resolution separately.
  *    Default value: "false".
+ * \parameter AsynchronousLogging: Controls whether the elastix.log and the
+ *    IterationInfo files are written by a background thread during the
+ *    registration. The output is then buffered in memory and written to disk
+ *    in blocks, at the end of every resolution, and directly after an error.
+ *    This saves many small writes, which can be slow on network file systems.\n
+ *    example: <tt>(AsynchronousLogging "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
+ * \parameter AsynchronousResultWriting: Controls whether the result images and
+ *    the transform parameter files are written by a background thread, including
+ *    the compression of the images, while the registration continues with the
+ *    next resolution or the next image pair. elastix waits for the writes when
+ *    it exits. At most two writes wait at a time. Result images that are written
+ *    in slabs, see NumberOfResultImageSlabs, are always written directly.\n
+ *    example: <tt>(AsynchronousResultWriting "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
+ * \parameter CheckpointInterval: The number of iterations between two
+ *    checkpoints of the registration, which are written to
+ *    Checkpoint.<level>.bin in the output directory, in the background if
+ *    AsynchronousResultWriting is "true". A checkpoint holds the resolution,
+ *    the iteration, the transform parameters, and the internal state of the
+ *    components that support it: the optimization state of the adaptive
+ *    stochastic gradient descent, quasi-Newton LBFGS and CMA evolution
+ *    strategy optimizers, and the state of the counter-based random
+ *    generator of the random coordinate samplers. The file is replaced
+ *    atomically, so it survives an interruption while it is written. Zero
+ *    disables the checkpoints.\n
+ *    example: <tt>(CheckpointInterval 50)</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: 0.
+ * \parameter ResumeFromCheckpoint: Controls whether the registration
+ *    continues from the Checkpoint.<level>.bin in the output directory, if it
+ *    exists, e.g. after the job was preempted. The resolutions before that of
+ *    the checkpoint are skipped, apart from the set up of the components, and
+ *    the optimization continues at the iteration after the checkpoint. The
+ *    registration must be started with the same parameters and images. If no
+ *    checkpoint exists, the registration starts from the beginning.\n
+ *    example: <tt>(ResumeFromCheckpoint "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
+ * \parameter IterationInfoFormat: The format of the IterationInfo files,
+ *    "text" or "binary". The text files, IterationInfo.<level>.R<r>.txt,
+ *    contain the table that is also printed to the screen. The binary files,
+ *    IterationInfo.<level>.R<r>.bin, contain the column names followed by a
+ *    32 bit float per column per iteration, see xoutlibrary::xoutbinary.
+ *    Both are written through the AsynchronousLogging path.\n
+ *    example: <tt>(IterationInfoFormat "binary")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "text".
+ * \parameter WritePhaseTrace: Controls whether a timeline of the per-thread
+ *    work of the metrics and samplers is written to PhaseTrace.<level>.json,
+ *    in the Chrome trace event format. Only available if elastix is built
+ *    with ELASTIX_USE_PHASE_TIMERS.\n
+ *    example: <tt>(WritePhaseTrace "true")</tt>\n
+ *    Default value: "false".
+ * \parameter MaximumNumberOfPhaseTraceEvents: The maximum number of spans on
+ *    that timeline, which bounds its memory use.\n
+ *    example: <tt>(MaximumNumberOfPhaseTraceEvents 1000000)</tt>\n
+ *    Default value: 100000.
+ * \parameter MemoryBudget: The maximum memory usage in megabytes. The memory
+ *    usage is reported after the first iteration of each resolution, and after
+ *    the registration. If the bytes held by the components, or the peak
+ *    resident set size of the process, exceed the budget, elastix stops with
+ *    an error. Zero means no budget.\n
+ *    example: <tt>(MemoryBudget 16000)</tt>\n
+ *    Default value: 0.
+ * \parameter MemoryMapInputImages: Controls whether the fixed and moving
+ *    images that are stored as uncompressed MetaImages (.mha, .mhd) are mapped
+ *    into memory instead of read. Images with the internal pixel type are then
+ *    used directly from the page cache; the pixels of other images are cast in
+ *    parallel from the mapped file, without the intermediate buffer of the
+ *    file type. Other images are read as before. Also used by transformix for
+ *    the input image.\n
+ *    example: <tt>(MemoryMapInputImages "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
  * \parameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
  * Voxel spacing and image origin are always taken into account, regardless
@@ -351,6 +435,13 @@ protected:
   /** Count the number of iterations. */
   unsigned int m_IterationCounter;
 
+  /** The number of iterations between two checkpoints, 0 for none, and the
+   * checkpoint to resume from, which is released once it is restored.
+   */
+  unsigned long                        m_CheckpointInterval;
+  itk::RegistrationCheckpoint::Pointer m_ResumeCheckpoint;
+  unsigned long                        m_ResumeLevel;
+
   /** CreateTransformParameterFile. */
   virtual void CreateTransformParameterFile( const std::string FileName,
     const bool ToLog );
@@ -364,10 +455,33 @@ protected:
   /** Stores transformation parameters map. */
   ParameterMapType m_TransformParametersMap;
 
-  /** Open the IterationInfoFile, where the table with iteration info is written to. */
-  virtual void OpenIterationInfoFile( void );
+  /** Open the IterationInfoFile, where the table with iteration info is
+   * written to. With \a append, the table of a resumed resolution is
+   * continued.
+   */
+  virtual void OpenIterationInfoFile( bool append = false );
+
+  /** Write a checkpoint of the current iteration to Checkpoint.<level>.bin. */
+  virtual void WriteRegistrationCheckpoint( void );
+
+  /** Restore the checkpoint to resume from in the components, at the start
+   * of the resolution of the checkpoint.
+   */
+  virtual void ReadRegistrationCheckpoint( void );
+
+  /** Get the name of the checkpoint file of this elastix level. */
+  std::string GetCheckpointFileName( void ) const;
 
-  std::ofstream m_IterationInfoFile;
+  /** Print the bytes held by the pyramids, the transform parameters, the
+   * samples, the metric work memory, the optimizer vectors and the result
+   * image, and the peak resident set size of the process, to elastix.log and
+   * the phase timings. \a when describes the moment, e.g. "in resolution 0".
+   * Throws an exception if the MemoryBudget is exceeded.
+   */
+  virtual void ReportMemoryUsage( const std::string & when );
+
+  itk::AsynchronousOutputFileStream m_IterationInfoFile;
+  xl::xoutbinary_type               m_IterationInfoBinary;
 
   /** Used by the callback functions, BeforeEachResolution() etc.).
    * This method calls a function in each component, in the following order:
@@ -386,6 +500,9 @@ protected:
 
   int CallInEachComponentInt( PtrToMemberFunction2 func );
 
+  /** Get all components, in the order of CallInEachComponent(). */
+  void GetAllComponents( std::vector< BaseComponentType * > & components );
+
   /** Call in each component SetElastix(This) and set its ComponentLabel
    * (for example "Metric1"). This makes sure that the component knows its
    * own function in the registration process.
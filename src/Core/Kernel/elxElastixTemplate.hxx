@@ -60,6 +60,11 @@ ElastixTemplate< TFixedImage, TMovingImage >
   /** Initialize the this->m_IterationCounter. */
   this->m_IterationCounter = 0;
 
+  /** No checkpoints by default. */
+  this->m_CheckpointInterval = 0;
+  this->m_ResumeCheckpoint   = 0;
+  this->m_ResumeLevel        = 0;
+
   /** Initialize CurrentTransformParameterFileName. */
   this->m_CurrentTransformParameterFileName = "";
   this->m_TransformParametersMap.clear();
@@ -217,18 +222,25 @@ ElastixTemplate< TFixedImage, TMovingImage >
   this->GetElxOptimizerBase()->GetAsITKBaseType()->AddObserver(
     itk::EndEvent(), this->m_AfterEachResolutionCommand );
 
+#ifdef ELASTIX_USE_PHASE_TIMERS
+  /** Start timing the phases of this registration. */
+  itk::PhaseTimerRegistry::GetInstance()->Reset();
+#endif
+
   /** Start the timer for reading images. */
   this->m_Timer0.Start();
   elxout << "\nReading images..." << std::endl;
 
   /** Read images and masks, if not set already. */
   const bool              useDirCos = this->GetUseDirectionCosines();
+  bool                    memoryMap = false;
+  this->GetConfiguration()->ReadParameter( memoryMap, "MemoryMapInputImages", 0, false );
   FixedImageDirectionType fixDirCos;
   if( this->GetFixedImage() == 0 )
   {
     this->SetFixedImageContainer(
       FixedImageLoaderType::GenerateImageContainer(
-      this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, &fixDirCos ) );
+      this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, &fixDirCos, memoryMap ) );
     this->SetOriginalFixedImageDirection( fixDirCos );
   }
   else
@@ -248,7 +260,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
   {
     this->SetMovingImageContainer(
       MovingImageLoaderType::GenerateImageContainer(
-      this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos ) );
+      this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos, NULL, memoryMap ) );
   }
   if( this->GetFixedMask() == 0 )
   {
@@ -267,6 +279,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
   this->m_Timer0.Stop();
   elxout << "Reading images took " << static_cast< unsigned long >(
     this->m_Timer0.GetMean() * 1000 ) << " ms.\n" << std::endl;
+  itkPhaseTimeMacro( "ReadImages", this->m_Timer0.GetMean() );
 
   /** Give all components the opportunity to do some initialization. */
   this->BeforeRegistration();
@@ -356,11 +369,13 @@ ElastixTemplate< TFixedImage, TMovingImage >
 
     /** Load the image from disk, if it wasn't set already by the user. */
     const bool useDirCos = this->GetUseDirectionCosines();
+    bool       memoryMap = false;
+    this->GetConfiguration()->ReadParameter( memoryMap, "MemoryMapInputImages", 0, false );
     if( this->GetMovingImage() == 0 )
     {
       this->SetMovingImageContainer(
         MovingImageLoaderType::GenerateImageContainer(
-        this->GetMovingImageFileNameContainer(), "Input Image", useDirCos ) );
+        this->GetMovingImageFileNameContainer(), "Input Image", useDirCos, NULL, memoryMap ) );
     } // end if !moving image
 
     /** Tell the user. */
@@ -377,7 +392,15 @@ ElastixTemplate< TFixedImage, TMovingImage >
   elxout << "Calling all ReadFromFile()'s ..." << std::endl;
   this->GetElxResampleInterpolatorBase()->ReadFromFile();
   this->GetElxResamplerBase()->ReadFromFile();
-  this->GetElxTransformBase()->ReadFromFile();
+  if( this->GetUseLiveTransform() )
+  {
+    elxout << "  The live transform of the registration is used; "
+           << "its parameters are not read." << std::endl;
+  }
+  else
+  {
+    this->GetElxTransformBase()->ReadFromFile();
+  }
 
   /** Tell the user. */
   timer.Stop();
@@ -476,6 +499,19 @@ ElastixTemplate< TFixedImage, TMovingImage >
            << this->ConvertSecondsToDHMS( timer.GetMean(), 2 ) << std::endl;
   }
 
+  /** Store the transform, so that a batch of transformix runs can use it
+   * as live transform for the next runs.
+   */
+  this->SetFinalTransform( this->GetTransformContainer()->ElementAt( 0 ) );
+
+  /** Release the live transform from this ElastixTemplate, which it
+   * otherwise keeps alive after transformix has finished.
+   */
+  if( this->GetUseLiveTransform() )
+  {
+    this->GetElxTransformBase()->SetElastix( 0 );
+  }
+
   /** Return a value. */
   return 0;
 
@@ -558,6 +594,69 @@ ElastixTemplate< TFixedImage, TMovingImage >
   this->m_Timer0.Reset();
   this->m_Timer0.Start();
 
+  /** Write the log and the iteration info in the background, if desired. */
+  bool asynchronousLogging = false;
+  this->GetConfiguration()->ReadParameter( asynchronousLogging,
+    "AsynchronousLogging", 0, false );
+  itk::AsynchronousOutputFileStream::SetAsynchronous( asynchronousLogging );
+
+  /** Write the result images and transform parameter files in the background, if desired. */
+  bool asynchronousResultWriting = false;
+  this->GetConfiguration()->ReadParameter( asynchronousResultWriting,
+    "AsynchronousResultWriting", 0, false );
+  itk::BackgroundWriter::GetInstance()->SetEnabled( asynchronousResultWriting );
+
+  /** Write checkpoints, and resume from a checkpoint, if desired. */
+  this->m_CheckpointInterval = 0;
+  this->GetConfiguration()->ReadParameter( this->m_CheckpointInterval,
+    "CheckpointInterval", 0, false );
+  bool resumeFromCheckpoint = false;
+  this->GetConfiguration()->ReadParameter( resumeFromCheckpoint,
+    "ResumeFromCheckpoint", 0, false );
+  this->m_ResumeCheckpoint = 0;
+  this->m_ResumeLevel      = 0;
+  if( resumeFromCheckpoint )
+  {
+    const std::string fileName = this->GetCheckpointFileName();
+    if( !std::ifstream( fileName.c_str() ).is_open() )
+    {
+      elxout << "No checkpoint \"" << fileName << "\" found; the registration starts from the beginning.\n";
+    }
+    else
+    {
+      this->m_ResumeCheckpoint = itk::RegistrationCheckpoint::New();
+      this->m_ResumeCheckpoint->ReadFile( fileName );
+      double resolution          = 0.0;
+      double numberOfResolutions = 0.0;
+      const unsigned long numberOfLevels
+        = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetNumberOfLevels();
+      if( !this->m_ResumeCheckpoint->GetEntry( "Resolution", resolution )
+        || !this->m_ResumeCheckpoint->GetEntry( "NumberOfResolutions", numberOfResolutions )
+        || static_cast< unsigned long >( numberOfResolutions ) != numberOfLevels )
+      {
+        itkExceptionMacro( << "ERROR: the checkpoint \"" << fileName
+                           << "\" does not belong to this registration." );
+      }
+      this->m_ResumeLevel = static_cast< unsigned long >( resolution );
+      elxout << "Resuming the registration from \"" << fileName << "\", at resolution "
+             << this->m_ResumeLevel << ".\n";
+    }
+  }
+  this->GetElxRegistrationBase()->GetAsITKBaseType()->SetFirstLevel( this->m_ResumeLevel );
+
+#ifdef ELASTIX_USE_PHASE_TIMERS
+  /** Record a timeline of the multi-threaded work, if desired. */
+  bool               writePhaseTrace = false;
+  itk::SizeValueType maximumNumberOfPhaseTraceEvents = 100000;
+  this->GetConfiguration()->ReadParameter( writePhaseTrace,
+    "WritePhaseTrace", 0, false );
+  this->GetConfiguration()->ReadParameter( maximumNumberOfPhaseTraceEvents,
+    "MaximumNumberOfPhaseTraceEvents", 0, false );
+  itk::PhaseTimerRegistry::GetInstance()->SetTraceEnabled( writePhaseTrace );
+  itk::PhaseTimerRegistry::GetInstance()->SetMaximumNumberOfTraceEvents(
+    maximumNumberOfPhaseTraceEvents );
+#endif
+
   /** Call all the BeforeRegistration() functions. */
   this->BeforeRegistrationBase();
   CallInEachComponent( &BaseComponentType::BeforeRegistrationBase );
@@ -575,6 +674,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
   elxout << "Initialization of all components (before registration) took: "
          << static_cast< unsigned long >( this->m_Timer0.GetMean() * 1000 )
          << " ms.\n";
+  itkPhaseTimeMacro( "BeforeRegistration", this->m_Timer0.GetMean() );
 
   /** Start Timer0 here, to make it possible to measure the time needed for
    * preparation of the first resolution.
@@ -594,6 +694,9 @@ void
 ElastixTemplate< TFixedImage, TMovingImage >
 ::BeforeEachResolution( void )
 {
+  /** Stop here if the registration was cancelled. */
+  itk::RegistrationProgress::ThrowIfCurrentCancelRequested();
+
   /** Get current resolution level. */
   unsigned long level
     = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
@@ -608,19 +711,33 @@ ElastixTemplate< TFixedImage, TMovingImage >
     this->m_Timer0.Start();
   }
 
+  /** Aggregate the phase times of this resolution separately. */
+  std::ostringstream section( "" );
+  section << "Resolution " << level;
+  itkPhaseTimerSectionMacro( section.str() );
+
   /** Reset the this->m_IterationCounter. */
   this->m_IterationCounter = 0;
 
   /** Print the current resolution. */
-  elxout << "\nResolution: " << level << std::endl;
+  const bool resuming = this->m_ResumeCheckpoint.IsNotNull();
+  elxout << "\nResolution: " << level;
+  if( resuming && level < this->m_ResumeLevel )
+  {
+    elxout << " (skipped, resuming from a checkpoint)";
+  }
+  elxout << std::endl;
 
-  /** Create a TransformParameter-file for the current resolution. */
+  /** Create a TransformParameter-file for the current resolution. The
+   * files of skipped resolutions are kept, and that of the resumed
+   * resolution is continued.
+   */
   bool writeIterationInfo = true;
   this->GetConfiguration()->ReadParameter( writeIterationInfo,
     "WriteIterationInfo", 0, false );
-  if( writeIterationInfo )
+  if( writeIterationInfo && !( resuming && level < this->m_ResumeLevel ) )
   {
-    this->OpenIterationInfoFile();
+    this->OpenIterationInfoFile( resuming );
   }
 
   /** Call all the BeforeEachResolution() functions. */
@@ -628,6 +745,12 @@ ElastixTemplate< TFixedImage, TMovingImage >
   CallInEachComponent( &BaseComponentType::BeforeEachResolutionBase );
   CallInEachComponent( &BaseComponentType::BeforeEachResolution );
 
+  /** Continue from the checkpoint, in its resolution. */
+  if( resuming && level == this->m_ResumeLevel )
+  {
+    this->ReadRegistrationCheckpoint();
+  }
+
   /** Print the extra preparation time needed for this resolution. */
   this->m_Timer0.Stop();
   elxout << "Elastix initialization of all components (for this resolution) took: "
@@ -670,6 +793,9 @@ ElastixTemplate< TFixedImage, TMovingImage >
     << " s.\n";
   elxout << std::setprecision( this->GetDefaultOutputPrecision() );
 
+  /** Write the output that is buffered for asynchronous logging. */
+  itk::AsynchronousOutputFileStream::SynchronizeAll();
+
   /** Call all the AfterEachResolution() functions. */
   this->AfterEachResolutionBase();
   CallInEachComponent( &BaseComponentType::AfterEachResolutionBase );
@@ -713,9 +839,16 @@ void
 ElastixTemplate< TFixedImage, TMovingImage >
 ::AfterEachIteration( void )
 {
-  /** Write the headers of the columns that are printed each iteration. */
+  /** Write the headers of the columns that are printed each iteration,
+   * preceded by the memory usage, which is complete after the first iteration.
+   */
   if( this->m_IterationCounter == 0 )
   {
+    std::ostringstream when( "" );
+    when << "in resolution "
+         << this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
+    this->ReportMemoryUsage( when.str() );
+
     xout[ "iteration" ][ "WriteHeaders" ];
   }
 
@@ -779,6 +912,28 @@ ElastixTemplate< TFixedImage, TMovingImage >
   /** Count the number of iterations. */
   this->m_IterationCounter++;
 
+  /** Write a checkpoint, if desired. */
+  if( this->m_CheckpointInterval > 0
+    && this->m_IterationCounter % this->m_CheckpointInterval == 0 )
+  {
+    this->WriteRegistrationCheckpoint();
+  }
+
+  /** Report the progress, and stop if the registration was cancelled. */
+  itk::RegistrationProgress * progress = itk::RegistrationProgress::GetCurrent();
+  if( progress )
+  {
+    itk::RegistrationProgress::ReportType report;
+    report.Resolution
+      = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
+    report.NumberOfResolutions
+      = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetNumberOfLevels();
+    report.Iteration   = this->m_IterationCounter - 1;
+    report.MetricValue = this->GetElxOptimizerBase()->GetCurrentMetricValue();
+    progress->Report( report );
+    itk::RegistrationProgress::ThrowIfCurrentCancelRequested();
+  }
+
   /** Start timer for next iteration. */
   this->m_IterationTimer.Reset();
   this->m_IterationTimer.Start();
@@ -795,6 +950,8 @@ void
 ElastixTemplate< TFixedImage, TMovingImage >
 ::AfterRegistration( void )
 {
+  itkPhaseTimerSectionMacro( "Finalization" );
+
   itk::TimeProbe timer;
   timer.Start();
 
@@ -837,9 +994,198 @@ ElastixTemplate< TFixedImage, TMovingImage >
   elxout << "Time spent on saving the results, applying the final transform etc.: "
          << static_cast< unsigned long >( this->m_Timer0.GetMean() * 1000 ) << " ms.\n";
 
+  this->ReportMemoryUsage( "after the registration" );
+
+#ifdef ELASTIX_USE_PHASE_TIMERS
+  /** Write the times spent in the phases of the registration, next to
+   * the log, in PhaseTimings.<ElastixLevel>.json, and the timeline, if
+   * recorded, in PhaseTrace.<ElastixLevel>.json. */
+  itk::PhaseTimerRegistry::Pointer phaseTimers = itk::PhaseTimerRegistry::GetInstance();
+  const std::string                outputDirectory
+    = this->GetConfiguration()->GetCommandLineArgument( "-out" );
+  if( !outputDirectory.empty() )
+  {
+    std::ostringstream makeFileName( "" );
+    makeFileName << outputDirectory << "PhaseTimings."
+                 << this->GetConfiguration()->GetElastixLevel() << ".json";
+    std::ofstream phaseTimingsFile( makeFileName.str().c_str() );
+    if( phaseTimingsFile.is_open() )
+    {
+      phaseTimers->WriteJSON( phaseTimingsFile );
+    }
+    else
+    {
+      xout[ "warning" ] << "WARNING: the file " << makeFileName.str()
+                        << " could not be opened." << std::endl;
+    }
+
+    if( phaseTimers->GetTraceEnabled() )
+    {
+      std::ostringstream makeTraceFileName( "" );
+      makeTraceFileName << outputDirectory << "PhaseTrace."
+                        << this->GetConfiguration()->GetElastixLevel() << ".json";
+      std::ofstream phaseTraceFile( makeTraceFileName.str().c_str() );
+      if( phaseTraceFile.is_open() )
+      {
+        phaseTimers->WriteTrace( phaseTraceFile );
+      }
+      else
+      {
+        xout[ "warning" ] << "WARNING: the file " << makeTraceFileName.str()
+                          << " could not be opened." << std::endl;
+      }
+      if( phaseTimers->GetNumberOfDroppedTraceEvents() > 0 )
+      {
+        xout[ "warning" ] << "WARNING: " << phaseTimers->GetNumberOfDroppedTraceEvents()
+                          << " spans did not fit on the timeline; increase "
+                          << "MaximumNumberOfPhaseTraceEvents to record them." << std::endl;
+      }
+    }
+  }
+  phaseTimers->SetTraceEnabled( false );
+#endif
+
+  /** Stop the asynchronous logging, which writes all buffered output. */
+  itk::AsynchronousOutputFileStream::SetAsynchronous( false );
+
 } // end AfterRegistration()
 
 
+/**
+ * ************** ReportMemoryUsage ******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ElastixTemplate< TFixedImage, TMovingImage >
+::ReportMemoryUsage( const std::string & when )
+{
+  typedef std::pair< std::string, itk::SizeValueType > ComponentMemoryType;
+  std::vector< ComponentMemoryType > components;
+
+  /** The pyramids hold the images of all levels. */
+  itk::SizeValueType bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i )
+  {
+    typename FixedImagePyramidBaseType::ITKBaseType * pyramid
+      = this->GetElxFixedImagePyramidBase( i )->GetAsITKBaseType();
+    for( unsigned int level = 0; level < pyramid->GetNumberOfOutputs(); ++level )
+    {
+      bytes += itk::MemoryAccounting::GetImageBufferSize( pyramid->GetOutput( level ) );
+    }
+  }
+  components.push_back( ComponentMemoryType( "FixedImagePyramid", bytes ) );
+
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i )
+  {
+    typename MovingImagePyramidBaseType::ITKBaseType * pyramid
+      = this->GetElxMovingImagePyramidBase( i )->GetAsITKBaseType();
+    for( unsigned int level = 0; level < pyramid->GetNumberOfOutputs(); ++level )
+    {
+      bytes += itk::MemoryAccounting::GetImageBufferSize( pyramid->GetOutput( level ) );
+    }
+  }
+  components.push_back( ComponentMemoryType( "MovingImagePyramid", bytes ) );
+
+  /** The transform parameters, which are also the B-spline coefficients. */
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfTransforms(); ++i )
+  {
+    bytes += this->GetElxTransformBase( i )->GetAsITKBaseType()->GetNumberOfParameters()
+      * sizeof( double );
+  }
+  components.push_back( ComponentMemoryType( "TransformParameters", bytes ) );
+
+  /** The sample containers. */
+  typedef typename ImageSamplerBaseType::ITKBaseType ImageSamplerType;
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfImageSamplers(); ++i )
+  {
+    bytes += this->GetElxImageSamplerBase( i )->GetAsITKBaseType()->GetOutput()->Size()
+      * sizeof( typename ImageSamplerType::ImageSampleType );
+  }
+  components.push_back( ComponentMemoryType( "ImageSampler", bytes ) );
+
+  /** The work memory of the metrics, like the per thread derivatives. */
+  typedef typename MetricBaseType::AdvancedMetricType AdvancedMetricType;
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfMetrics(); ++i )
+  {
+    const AdvancedMetricType * metric = dynamic_cast< const AdvancedMetricType * >(
+      this->GetElxMetricBase( i )->GetAsITKBaseType() );
+    if( metric )
+    {
+      bytes += metric->GetWorkMemorySize();
+    }
+  }
+  components.push_back( ComponentMemoryType( "Metric", bytes ) );
+
+  /** The parameter vectors of the optimizer. */
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfOptimizers(); ++i )
+  {
+    const itk::Optimizer * optimizer = this->GetElxOptimizerBase( i )->GetAsITKBaseType();
+    const itk::ScaledSingleValuedNonLinearOptimizer * scaledOptimizer
+      = dynamic_cast< const itk::ScaledSingleValuedNonLinearOptimizer * >( optimizer );
+    bytes += scaledOptimizer ? scaledOptimizer->GetWorkMemorySize()
+      : optimizer->GetCurrentPosition().Size() * sizeof( double );
+  }
+  components.push_back( ComponentMemoryType( "Optimizer", bytes ) );
+
+  /** The output of the resampler. */
+  bytes = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfResamplers(); ++i )
+  {
+    bytes += itk::MemoryAccounting::GetImageBufferSize(
+      this->GetElxResamplerBase( i )->GetAsITKBaseType()->GetOutput() );
+  }
+  components.push_back( ComponentMemoryType( "ResultImage", bytes ) );
+
+  /** Print the figures, and add them to the phase timings. */
+  itk::PhaseTimerRegistry::Pointer registry = itk::PhaseTimerRegistry::GetInstance();
+  itk::SizeValueType               total    = 0;
+  elxout << "Memory usage " << when << ":\n";
+  for( std::size_t c = 0; c < components.size(); ++c )
+  {
+    elxout << "  " << components[ c ].first << ": "
+           << itk::MemoryAccounting::ToMegabytes( components[ c ].second ) << " MB\n";
+    registry->SetMemoryUsage( components[ c ].first, components[ c ].second );
+    total += components[ c ].second;
+  }
+  const itk::SizeValueType peak = itk::MemoryAccounting::GetPeakResidentSetSize();
+  registry->SetMemoryUsage( "Total", total );
+  registry->SetMemoryUsage( "PeakResidentSetSize", peak );
+  elxout << "  Total: " << itk::MemoryAccounting::ToMegabytes( total ) << " MB\n"
+         << "  Peak resident set size of the process: ";
+  if( peak > 0 )
+  {
+    elxout << itk::MemoryAccounting::ToMegabytes( peak ) << " MB\n" << std::endl;
+  }
+  else
+  {
+    elxout << "unknown\n" << std::endl;
+  }
+
+  /** Stop before running out of memory, if a budget is given. */
+  double memoryBudget = 0.0;
+  this->GetConfiguration()->ReadParameter( memoryBudget, "MemoryBudget", 0, false );
+  const double budgetBytes = memoryBudget * 1024.0 * 1024.0;
+  if( memoryBudget > 0.0
+    && ( static_cast< double >( total ) > budgetBytes
+    || static_cast< double >( peak ) > budgetBytes ) )
+  {
+    itkExceptionMacro( << "ERROR: the memory usage " << when
+                       << " exceeds the MemoryBudget of " << memoryBudget << " MB.\n"
+                       << "The components hold " << itk::MemoryAccounting::ToMegabytes( total )
+                       << " MB, and the peak resident set size of the process is "
+                       << itk::MemoryAccounting::ToMegabytes( peak ) << " MB.\n"
+                       << "See elastix.log for the memory usage per component." );
+  }
+
+} // end ReportMemoryUsage()
+
+
 /**
  * ************** CreateTransformParameterFile ******************
  *
@@ -854,12 +1200,18 @@ ElastixTemplate< TFixedImage, TMovingImage >
 {
   using namespace xl;
 
+  itkPhaseTimerMacro( "WriteTransformParameterFile" );
+
   /** Store CurrentTransformParameterFileName. */
   this->m_CurrentTransformParameterFileName = fileName;
 
-  /** Create transformParameterFile and xout["transpar"]. */
-  xoutsimple_type transformationParameterInfo;
-  std::ofstream   transformParameterFile;
+  /** Create transformParameterFile and xout["transpar"]. When writing in the
+   * background, the file is collected in memory and handed to the writer.
+   */
+  xoutsimple_type    transformationParameterInfo;
+  std::ofstream      transformParameterFile;
+  std::ostringstream transformParameterText;
+  const bool         writeInBackground = itk::BackgroundWriter::GetInstance()->GetEnabled();
 
   /** Set up the "TransformationParameters" writing field. */
   transformationParameterInfo.SetOutputs( xout.GetCOutputs() );
@@ -871,15 +1223,25 @@ ElastixTemplate< TFixedImage, TMovingImage >
   this->GetElxTransformBase()->SetTransformParametersFileName( fileName.c_str() );
 
   /** Open the TransformParameter file. */
-  transformParameterFile.open( fileName.c_str() );
-  if( !transformParameterFile.is_open() )
+  if( !writeInBackground )
   {
-    xout[ "error" ] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
+    transformParameterFile.open( fileName.c_str() );
+    if( !transformParameterFile.is_open() )
+    {
+      xout[ "error" ] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
+    }
   }
 
   /** This xout["transpar"] writes to the log and to the TransformParameter file. */
   transformationParameterInfo.RemoveOutput( "cout" );
-  transformationParameterInfo.AddOutput( "tpf", &transformParameterFile );
+  if( writeInBackground )
+  {
+    transformationParameterInfo.AddOutput( "tpf", &transformParameterText );
+  }
+  else
+  {
+    transformationParameterInfo.AddOutput( "tpf", &transformParameterFile );
+  }
   if( !toLog )
   {
     transformationParameterInfo.RemoveOutput( "log" );
@@ -916,6 +1278,12 @@ ElastixTemplate< TFixedImage, TMovingImage >
   /** Remove the "transpar" writing field. */
   xout.RemoveTargetCell( "transpar" );
 
+  /** Hand the file to the background writer. */
+  if( writeInBackground )
+  {
+    itk::BackgroundWriter::GetInstance()->SubmitTextFile( fileName, transformParameterText.str() );
+  }
+
 } // end CreateTransformParameterFile()
 
 
@@ -1009,6 +1377,61 @@ ElastixTemplate< TFixedImage, TMovingImage >
 } // end CallInEachComponent()
 
 
+/**
+ * ****************** GetAllComponents ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ElastixTemplate< TFixedImage, TMovingImage >
+::GetAllComponents( std::vector< BaseComponentType * > & components )
+{
+  components.clear();
+  components.push_back( this->GetConfiguration() );
+  for( unsigned int i = 0; i < this->GetNumberOfRegistrations(); ++i )
+  {
+    components.push_back( this->GetElxRegistrationBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfTransforms(); ++i )
+  {
+    components.push_back( this->GetElxTransformBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfImageSamplers(); ++i )
+  {
+    components.push_back( this->GetElxImageSamplerBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfMetrics(); ++i )
+  {
+    components.push_back( this->GetElxMetricBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfInterpolators(); ++i )
+  {
+    components.push_back( this->GetElxInterpolatorBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfOptimizers(); ++i )
+  {
+    components.push_back( this->GetElxOptimizerBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i )
+  {
+    components.push_back( this->GetElxFixedImagePyramidBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i )
+  {
+    components.push_back( this->GetElxMovingImagePyramidBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfResampleInterpolators(); ++i )
+  {
+    components.push_back( this->GetElxResampleInterpolatorBase( i ) );
+  }
+  for( unsigned int i = 0; i < this->GetNumberOfResamplers(); ++i )
+  {
+    components.push_back( this->GetElxResamplerBase( i ) );
+  }
+
+} // end GetAllComponents()
+
+
 /**
  * ****************** CallInEachComponentInt ********************
  */
@@ -1145,7 +1568,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
 template< class TFixedImage, class TMovingImage >
 void
 ElastixTemplate< TFixedImage, TMovingImage >
-::OpenIterationInfoFile( void )
+::OpenIterationInfoFile( bool append )
 {
   using namespace xl;
 
@@ -1157,21 +1580,42 @@ ElastixTemplate< TFixedImage, TMovingImage >
     this->m_IterationInfoFile.close();
   }
 
+  /** Check the format of the IterationInfo file. */
+  std::string format = "text";
+  this->GetConfiguration()->ReadParameter( format, "IterationInfoFormat", 0, false );
+  const bool binary = ( format == "binary" );
+  if( !binary && format != "text" )
+  {
+    xout[ "warning" ] << "WARNING: IterationInfoFormat \"" << format
+                      << "\" is not supported; \"text\" is used instead." << std::endl;
+  }
+
   /** Create the IterationInfo filename for this resolution. */
   std::ostringstream makeFileName( "" );
   makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
                << "IterationInfo."
                << this->m_Configuration->GetElastixLevel()
                << ".R" << this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel()
-               << ".txt";
+               << ( binary ? ".bin" : ".txt" );
   std::string fileName = makeFileName.str();
 
   /** Open the IterationInfoFile. */
-  this->m_IterationInfoFile.open( fileName.c_str() );
+  std::ios_base::openmode mode = binary ? std::ios_base::binary : std::ios_base::out;
+  if( append )
+  {
+    mode |= std::ios_base::app;
+  }
+  this->m_IterationInfoFile.open( fileName.c_str(), mode );
   if( !( this->m_IterationInfoFile.is_open() ) )
   {
     xout[ "error" ] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
   }
+  else if( binary )
+  {
+    /** Add the binary writer of this file to the outputs of xout["iteration"]. */
+    this->m_IterationInfoBinary.SetOutputStream( &( this->m_IterationInfoFile ) );
+    xout[ "iteration" ].AddOutput( "IterationInfoFile", &( this->m_IterationInfoBinary ) );
+  }
   else
   {
     /** Add this file to the list of outputs of xout["iteration"]. */
@@ -1181,6 +1625,107 @@ ElastixTemplate< TFixedImage, TMovingImage >
 } // end OpenIterationInfoFile()
 
 
+/**
+ * ************** GetCheckpointFileName *********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+std::string
+ElastixTemplate< TFixedImage, TMovingImage >
+::GetCheckpointFileName( void ) const
+{
+  std::ostringstream makeFileName( "" );
+  makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
+               << "Checkpoint."
+               << this->m_Configuration->GetElastixLevel()
+               << ".bin";
+  return makeFileName.str();
+
+} // end GetCheckpointFileName()
+
+
+/**
+ * ************** WriteRegistrationCheckpoint *********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ElastixTemplate< TFixedImage, TMovingImage >
+::WriteRegistrationCheckpoint( void )
+{
+  itkPhaseTimerMacro( "WriteRegistrationCheckpoint" );
+
+  itk::RegistrationCheckpoint::Pointer checkpoint = itk::RegistrationCheckpoint::New();
+  checkpoint->SetEntry( "NumberOfResolutions", static_cast< double >(
+    this->GetElxRegistrationBase()->GetAsITKBaseType()->GetNumberOfLevels() ) );
+  checkpoint->SetEntry( "Resolution", static_cast< double >(
+    this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel() ) );
+  checkpoint->SetEntry( "Iteration", static_cast< double >( this->m_IterationCounter ) );
+
+  const itk::Optimizer::ParametersType & position
+    = this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition();
+  checkpoint->SetEntry( "TransformParameters",
+    itk::RegistrationCheckpoint::EntryType( position.begin(), position.end() ) );
+
+  /** The state of the components. */
+  std::vector< BaseComponentType * > components;
+  this->GetAllComponents( components );
+  for( std::size_t i = 0; i < components.size(); ++i )
+  {
+    components[ i ]->WriteCheckpoint( *checkpoint );
+  }
+
+  itk::BackgroundWriter::GetInstance()->SubmitBinaryFile(
+    this->GetCheckpointFileName(), checkpoint->Serialize() );
+
+} // end WriteRegistrationCheckpoint()
+
+
+/**
+ * ************** ReadRegistrationCheckpoint *********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ElastixTemplate< TFixedImage, TMovingImage >
+::ReadRegistrationCheckpoint( void )
+{
+  typedef typename RegistrationBaseType::ITKBaseType ITKRegistrationType;
+  ITKRegistrationType * registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+
+  /** Continue from the transform parameters of the checkpoint. */
+  itk::RegistrationCheckpoint::EntryType parameters;
+  double                                 iteration = 0.0;
+  if( !this->m_ResumeCheckpoint->GetEntry( "TransformParameters", parameters )
+    || !this->m_ResumeCheckpoint->GetEntry( "Iteration", iteration )
+    || parameters.size() != registration->GetTransform()->GetNumberOfParameters() )
+  {
+    itkExceptionMacro( << "ERROR: the transform parameters of the checkpoint do not match the transform." );
+  }
+  typename ITKRegistrationType::ParametersType initialParameters( parameters.size() );
+  std::copy( parameters.begin(), parameters.end(), initialParameters.begin() );
+  registration->SetInitialTransformParametersOfNextLevel( initialParameters );
+
+  /** The multi-start of the first resolution is done already. */
+  registration->SetMultiStartCandidates( typename ITKRegistrationType::ParametersContainerType() );
+
+  this->m_IterationCounter = static_cast< unsigned int >( iteration );
+
+  /** The state of the components. */
+  std::vector< BaseComponentType * > components;
+  this->GetAllComponents( components );
+  for( std::size_t i = 0; i < components.size(); ++i )
+  {
+    components[ i ]->ReadCheckpoint( *this->m_ResumeCheckpoint );
+  }
+
+  elxout << "Resumed the registration at iteration " << this->m_IterationCounter
+         << " of resolution " << this->m_ResumeLevel << ".\n";
+  this->m_ResumeCheckpoint = 0;
+
+} // end ReadRegistrationCheckpoint()
+
+
 /**
  * ************** GetOriginalFixedImageDirection *********************
  * Determine the original fixed image direction (it might have been
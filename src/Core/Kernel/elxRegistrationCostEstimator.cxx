@@ -0,0 +1,731 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "elxRegistrationCostEstimator.h"
+
+#include "itkGridScheduleComputer.h"
+#include "itkImageIOFactory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+RegistrationCostEstimator
+::RegistrationCostEstimator()
+{
+  this->m_NumberOfThreads = 1;
+  this->m_MaskVoxels      = 0;
+
+  /** The defaults of the cost model. */
+  this->m_RuntimeScale                 = 1.0;
+  this->m_MemoryScale                  = 1.0;
+  this->m_BaseMemoryMB                 = 20.0;
+  this->m_NanosecondsPerSample         = 100.0;
+  this->m_NanosecondsPerJacobianEntry  = 2.0;
+  this->m_NanosecondsPerParameter      = 5.0;
+  this->m_NanosecondsPerPyramidVoxel   = 20.0;
+  this->m_NanosecondsPerResampledVoxel = 50.0;
+  this->m_ParallelEfficiency           = 0.8;
+
+  this->m_PeakMemory = 0.0;
+  this->m_Seconds    = 0.0;
+
+} // end Constructor
+
+
+/**
+ * ******************* AddParameterMap *******************
+ */
+
+void
+RegistrationCostEstimator
+::AddParameterMap( const ParameterMapType & parameterMap, const std::string & name )
+{
+  this->m_ParameterMaps.push_back( parameterMap );
+  this->m_ParameterMapNames.push_back( name );
+  this->Modified();
+
+} // end AddParameterMap()
+
+
+/**
+ * ******************* ReadParameter *******************
+ */
+
+template< class T >
+bool
+RegistrationCostEstimator
+::ReadParameter( const ParameterMapInterfaceType * config,
+  T & parameterValue, const std::string & parameterName, unsigned int entry_nr )
+{
+  std::string dummyErrorMessage = "";
+  return config->ReadParameter( parameterValue, parameterName, "",
+    entry_nr, 0, false, dummyErrorMessage );
+
+} // end ReadParameter()
+
+
+/**
+ * ******************* SetCalibration *******************
+ */
+
+void
+RegistrationCostEstimator
+::SetCalibration( const ParameterMapType & calibration )
+{
+  ParameterMapInterfaceType::Pointer config = ParameterMapInterfaceType::New();
+  config->SetParameterMap( calibration );
+  config->SetPrintErrorMessages( false );
+
+  Self::ReadParameter( config.GetPointer(), this->m_RuntimeScale, "RuntimeScale", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_MemoryScale, "MemoryScale", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_BaseMemoryMB, "BaseMemoryMB", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_NanosecondsPerSample, "NanosecondsPerSample", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_NanosecondsPerJacobianEntry, "NanosecondsPerJacobianEntry", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_NanosecondsPerParameter, "NanosecondsPerParameter", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_NanosecondsPerPyramidVoxel, "NanosecondsPerPyramidVoxel", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_NanosecondsPerResampledVoxel, "NanosecondsPerResampledVoxel", 0 );
+  Self::ReadParameter( config.GetPointer(), this->m_ParallelEfficiency, "ParallelEfficiency", 0 );
+  this->Modified();
+
+} // end SetCalibration()
+
+
+/**
+ * ******************* Estimate *******************
+ */
+
+void
+RegistrationCostEstimator
+::Estimate( void )
+{
+  if( this->m_FixedImageFileName.empty() )
+  {
+    itkExceptionMacro( << "ERROR: no fixed image is given." );
+  }
+
+  /** Read the image headers. */
+  Self::ReadImageInformation( this->m_FixedImageFileName, this->m_FixedImageInformation );
+  if( this->m_MovingImageFileName.empty() )
+  {
+    this->m_MovingImageInformation = this->m_FixedImageInformation;
+  }
+  else
+  {
+    Self::ReadImageInformation( this->m_MovingImageFileName, this->m_MovingImageInformation );
+  }
+
+  /** The masks are stored as one byte per voxel. */
+  this->m_MaskVoxels = 0;
+  ImageInformationType maskInformation;
+  if( !this->m_FixedMaskFileName.empty() )
+  {
+    Self::ReadImageInformation( this->m_FixedMaskFileName, maskInformation );
+    this->m_MaskVoxels += maskInformation.m_NumberOfVoxels;
+  }
+  if( !this->m_MovingMaskFileName.empty() )
+  {
+    Self::ReadImageInformation( this->m_MovingMaskFileName, maskInformation );
+    this->m_MaskVoxels += maskInformation.m_NumberOfVoxels;
+  }
+
+  /** The parameter maps are run one after the other. */
+  this->m_ParameterMapEstimates.resize( this->m_ParameterMaps.size() );
+  this->m_PeakMemory = 0.0;
+  this->m_Seconds    = 0.0;
+  for( std::size_t i = 0; i < this->m_ParameterMaps.size(); ++i )
+  {
+    ParameterMapEstimateType & estimate = this->m_ParameterMapEstimates[ i ];
+    estimate.m_Name = this->m_ParameterMapNames[ i ];
+    this->EstimateParameterMap( this->m_ParameterMaps[ i ], estimate );
+    this->m_PeakMemory = std::max( this->m_PeakMemory, estimate.m_PeakMemory );
+    this->m_Seconds   += estimate.m_Seconds;
+  }
+
+} // end Estimate()
+
+
+/**
+ * ******************* EstimateParameterMap *******************
+ */
+
+void
+RegistrationCostEstimator
+::EstimateParameterMap( const ParameterMapType & parameterMap,
+  ParameterMapEstimateType & estimate ) const
+{
+  ParameterMapInterfaceType::Pointer configPointer = ParameterMapInterfaceType::New();
+  configPointer->SetParameterMap( parameterMap );
+  configPointer->SetPrintErrorMessages( false );
+  const ParameterMapInterfaceType * config = configPointer.GetPointer();
+
+  const ImageInformationType & fixedInfo  = this->m_FixedImageInformation;
+  const ImageInformationType & movingInfo = this->m_MovingImageInformation;
+  const unsigned int           dimension  = fixedInfo.m_Dimension;
+  const double                 threads    = std::max( 1u, this->m_NumberOfThreads );
+  const double                 effectiveThreads
+    = 1.0 + this->m_ParallelEfficiency * ( threads - 1.0 );
+
+  unsigned int numberOfResolutions = 3;
+  Self::ReadParameter( config, numberOfResolutions, "NumberOfResolutions", 0 );
+  numberOfResolutions = std::max( 1u, numberOfResolutions );
+
+  std::string fixedPixelType  = "float";
+  std::string movingPixelType = "float";
+  Self::ReadParameter( config, fixedPixelType, "FixedInternalImagePixelType", 0 );
+  Self::ReadParameter( config, movingPixelType, "MovingInternalImagePixelType", 0 );
+  const double fixedPixelSize  = Self::GetPixelTypeSize( fixedPixelType );
+  const double movingPixelSize = Self::GetPixelTypeSize( movingPixelType );
+
+  /** The pyramids. All levels are kept, unless they are computed per
+   * resolution.
+   */
+  std::vector< SizeValueType > fixedVoxels;
+  std::vector< SizeValueType > movingVoxels;
+  Self::ComputePyramidSizes( config, "Fixed", fixedInfo, numberOfResolutions, fixedVoxels );
+  Self::ComputePyramidSizes( config, "Moving", movingInfo, numberOfResolutions, movingVoxels );
+  bool computePerResolution = false;
+  Self::ReadParameter( config, computePerResolution, "ComputePyramidImagesPerResolution", 0 );
+  double pyramidMemory = 0.0;
+  for( unsigned int level = 0; level < numberOfResolutions; ++level )
+  {
+    const double levelMemory = fixedVoxels[ level ] * fixedPixelSize
+      + movingVoxels[ level ] * movingPixelSize;
+    pyramidMemory = computePerResolution
+      ? std::max( pyramidMemory, levelMemory ) : pyramidMemory + levelMemory;
+  }
+
+  /** The transform: the number of parameters and of nonzero Jacobian
+   * entries per sample.
+   */
+  estimate.m_Transform        = "";
+  estimate.m_TransformIsKnown = true;
+  Self::ReadParameter( config, estimate.m_Transform, "Transform", 0 );
+  const std::string & transform = estimate.m_Transform;
+  std::vector< SizeValueType > numberOfParameters( numberOfResolutions, 0 );
+  std::vector< SizeValueType > numberOfNonZeroJacobianIndices( numberOfResolutions, 0 );
+  if( transform.find( "BSpline" ) != std::string::npos
+    && transform.find( "Stack" ) == std::string::npos
+    && dimension >= 2 && dimension <= 4 )
+  {
+    unsigned int splineOrder = 3;
+    Self::ReadParameter( config, splineOrder, "BSplineTransformSplineOrder", 0 );
+    std::vector< SizeValueType > numberOfGridPoints;
+    if( dimension == 2 )
+    {
+      Self::ComputeBSplineGridSizes< 2 >( config, fixedInfo, numberOfResolutions, splineOrder, numberOfGridPoints );
+    }
+    else if( dimension == 3 )
+    {
+      Self::ComputeBSplineGridSizes< 3 >( config, fixedInfo, numberOfResolutions, splineOrder, numberOfGridPoints );
+    }
+    else
+    {
+      Self::ComputeBSplineGridSizes< 4 >( config, fixedInfo, numberOfResolutions, splineOrder, numberOfGridPoints );
+    }
+    const SizeValueType support = static_cast< SizeValueType >(
+      std::pow( static_cast< double >( splineOrder + 1 ), static_cast< double >( dimension ) ) );
+    for( unsigned int level = 0; level < numberOfResolutions; ++level )
+    {
+      numberOfParameters[ level ]             = dimension * numberOfGridPoints[ level ];
+      numberOfNonZeroJacobianIndices[ level ] = dimension * support;
+    }
+  }
+  else
+  {
+    /** The rigid transforms: a rotation of D( D - 1 ) / 2 angles and a
+     * translation; the similarity transform adds a scale.
+     */
+    SizeValueType parameters = 0;
+    if( transform == "TranslationTransform" )
+    {
+      parameters = dimension;
+    }
+    else if( transform == "EulerTransform" )
+    {
+      parameters = dimension * ( dimension + 1 ) / 2;
+    }
+    else if( transform == "SimilarityTransform" )
+    {
+      parameters = dimension * ( dimension + 1 ) / 2 + 1;
+    }
+    else if( transform == "AffineTransform" || transform == "AffineDTITransform"
+      || transform == "AffineLogTransform" )
+    {
+      parameters = dimension * ( dimension + 1 );
+    }
+    else
+    {
+      estimate.m_TransformIsKnown = false;
+    }
+    std::fill( numberOfParameters.begin(), numberOfParameters.end(), parameters );
+    std::fill( numberOfNonZeroJacobianIndices.begin(), numberOfNonZeroJacobianIndices.end(), parameters );
+  }
+
+  /** The components that determine the work per resolution. */
+  std::string sampler      = "Random";
+  std::string interpolator = "BSplineInterpolator";
+  Self::ReadParameter( config, sampler, "ImageSampler", 0 );
+  Self::ReadParameter( config, interpolator, "Interpolator", 0 );
+  const unsigned int numberOfMetrics = std::max< unsigned int >( 1,
+    static_cast< unsigned int >( config->CountNumberOfParameterEntries( "Metric" ) ) );
+
+  /** The interpolator keeps B-spline coefficients of the moving image, in
+   * double or float, or else the metric keeps its gradient image.
+   */
+  double interpolatorBytesPerVoxel = 0.0;
+  if( interpolator.find( "BSplineInterpolatorFloat" ) != std::string::npos )
+  {
+    interpolatorBytesPerVoxel = sizeof( float );
+  }
+  else if( interpolator.find( "BSpline" ) != std::string::npos )
+  {
+    interpolatorBytesPerVoxel = sizeof( double );
+  }
+  else if( interpolator != "LinearInterpolator" )
+  {
+    interpolatorBytesPerVoxel = dimension * sizeof( double );
+  }
+
+  estimate.m_Resolutions.resize( numberOfResolutions );
+  double maximumWorkMemory = 0.0;
+  estimate.m_Seconds = 0.0;
+  for( unsigned int level = 0; level < numberOfResolutions; ++level )
+  {
+    ResolutionEstimateType & resolution = estimate.m_Resolutions[ level ];
+    resolution.m_FixedImageVoxels               = fixedVoxels[ level ];
+    resolution.m_MovingImageVoxels              = movingVoxels[ level ];
+    resolution.m_NumberOfParameters             = numberOfParameters[ level ];
+    resolution.m_NumberOfNonZeroJacobianIndices = numberOfNonZeroJacobianIndices[ level ];
+
+    /** The number of samples. */
+    if( sampler == "Full" )
+    {
+      resolution.m_NumberOfSamples = fixedVoxels[ level ];
+    }
+    else if( sampler == "Grid" )
+    {
+      double gridPoints = static_cast< double >( fixedVoxels[ level ] );
+      for( unsigned int d = 0; d < dimension; ++d )
+      {
+        double gridSpacing = 2.0;
+        std::string dummyErrorMessage = "";
+        config->ReadParameter( gridSpacing, "SampleGridSpacing",
+          level * dimension + d, false, dummyErrorMessage );
+        gridPoints /= std::max( 1.0, gridSpacing );
+      }
+      resolution.m_NumberOfSamples = static_cast< SizeValueType >( std::ceil( gridPoints ) );
+    }
+    else
+    {
+      resolution.m_NumberOfSamples = 5000;
+      Self::ReadParameter( config, resolution.m_NumberOfSamples, "NumberOfSpatialSamples", level );
+    }
+
+    resolution.m_NumberOfEvaluations = 500;
+    Self::ReadParameter( config, resolution.m_NumberOfEvaluations, "MaximumNumberOfIterations", level );
+
+    const double P   = static_cast< double >( resolution.m_NumberOfParameters );
+    const double nnz = static_cast< double >( resolution.m_NumberOfNonZeroJacobianIndices );
+    const double S   = static_cast< double >( resolution.m_NumberOfSamples );
+
+    /** The histograms of the mutual information metrics, per thread, and
+     * the explicit joint PDF derivatives of the slow version.
+     */
+    double histogramMemory = 0.0;
+    for( unsigned int m = 0; m < numberOfMetrics; ++m )
+    {
+      std::string metric = "";
+      std::string dummyErrorMessage = "";
+      config->ReadParameter( metric, "Metric", m, false, dummyErrorMessage );
+      if( metric.find( "MutualInformation" ) == std::string::npos )
+      {
+        continue;
+      }
+      unsigned int bins = 32;
+      Self::ReadParameter( config, bins, "NumberOfHistogramBins", level );
+      unsigned int fixedBins  = bins;
+      unsigned int movingBins = bins;
+      Self::ReadParameter( config, fixedBins, "NumberOfFixedHistogramBins", level );
+      Self::ReadParameter( config, movingBins, "NumberOfMovingHistogramBins", level );
+      bool useFastAndLowMemoryVersion = true;
+      bool useExplicitPDFDerivatives  = true;
+      Self::ReadParameter( config, useFastAndLowMemoryVersion, "UseFastAndLowMemoryVersion", level );
+      Self::ReadParameter( config, useExplicitPDFDerivatives, "UseExplicitPDFDerivatives", level );
+      const double pdfBytes = static_cast< double >( fixedBins ) * movingBins * sizeof( double );
+      histogramMemory += threads * pdfBytes;
+      if( !useFastAndLowMemoryVersion && useExplicitPDFDerivatives )
+      {
+        histogramMemory += pdfBytes * P;
+      }
+    }
+
+    /** The work memory: the samples (point, value and weight), the vectors of
+     * the transform and the optimizer, the per-thread derivatives and
+     * Jacobians, the histograms and the interpolator coefficients.
+     */
+    resolution.m_WorkMemory
+      = S * ( dimension + 2 ) * sizeof( double )
+      + P * 6 * sizeof( double )
+      + threads * ( P + 2 * nnz + dimension * nnz ) * sizeof( double )
+      + histogramMemory
+      + movingVoxels[ level ] * interpolatorBytesPerVoxel;
+    maximumWorkMemory = std::max( maximumWorkMemory, resolution.m_WorkMemory );
+
+    /** The run time: every evaluation visits the samples of every metric in
+     * parallel, and updates the parameters; every level smooths the full
+     * images once.
+     */
+    const double nanosecondsPerEvaluation
+      = numberOfMetrics * S * ( this->m_NanosecondsPerSample
+      + this->m_NanosecondsPerJacobianEntry * nnz ) / effectiveThreads
+      + P * this->m_NanosecondsPerParameter;
+    const double nanosecondsPyramid = this->m_NanosecondsPerPyramidVoxel
+      * static_cast< double >( fixedInfo.m_NumberOfVoxels + movingInfo.m_NumberOfVoxels )
+      / effectiveThreads;
+    resolution.m_Seconds = this->m_RuntimeScale * 1e-9
+      * ( resolution.m_NumberOfEvaluations * nanosecondsPerEvaluation + nanosecondsPyramid );
+    estimate.m_Seconds += resolution.m_Seconds;
+  }
+
+  /** The final resampling of the moving image onto the fixed image. */
+  bool writeResultImage = true;
+  Self::ReadParameter( config, writeResultImage, "WriteResultImage", 0 );
+  double resampleMemory = 0.0;
+  if( writeResultImage )
+  {
+    std::string resultPixelType      = "short";
+    std::string resampleInterpolator = "FinalBSplineInterpolator";
+    Self::ReadParameter( config, resultPixelType, "ResultImagePixelType", 0 );
+    Self::ReadParameter( config, resampleInterpolator, "ResampleInterpolator", 0 );
+    resampleMemory = static_cast< double >( fixedInfo.m_NumberOfVoxels )
+      * ( movingPixelSize + Self::GetPixelTypeSize( resultPixelType ) );
+    if( resampleInterpolator.find( "BSpline" ) != std::string::npos )
+    {
+      resampleMemory += static_cast< double >( movingInfo.m_NumberOfVoxels ) * sizeof( double );
+    }
+    estimate.m_Seconds += this->m_RuntimeScale * 1e-9 * this->m_NanosecondsPerResampledVoxel
+      * static_cast< double >( fixedInfo.m_NumberOfVoxels ) / effectiveThreads;
+  }
+  resampleMemory += numberOfParameters.back() * sizeof( double );
+
+  /** The images and masks stay in memory all the time. */
+  const double imageMemory = this->m_BaseMemoryMB * 1024.0 * 1024.0
+    + static_cast< double >( fixedInfo.m_NumberOfVoxels ) * fixedPixelSize
+    + static_cast< double >( movingInfo.m_NumberOfVoxels ) * movingPixelSize
+    + static_cast< double >( this->m_MaskVoxels );
+  estimate.m_PeakMemory = this->m_MemoryScale * ( imageMemory
+    + std::max( pyramidMemory + maximumWorkMemory, resampleMemory ) );
+
+} // end EstimateParameterMap()
+
+
+/**
+ * ******************* ComputePyramidSizes *******************
+ */
+
+void
+RegistrationCostEstimator
+::ComputePyramidSizes( const ParameterMapInterfaceType * config,
+  const std::string & prefix, const ImageInformationType & info,
+  unsigned int numberOfResolutions, std::vector< SizeValueType > & numberOfVoxels )
+{
+  /** The smoothing pyramid keeps the full size; the others shrink by the
+   * (rescale) schedule, which halves the size per level by default.
+   */
+  std::string pyramid = prefix + "SmoothingImagePyramid";
+  Self::ReadParameter( config, pyramid, prefix + "ImagePyramid", 0 );
+  const bool shrinks = pyramid.find( "Smoothing" ) == std::string::npos;
+  const bool generic = pyramid.find( "Generic" ) != std::string::npos;
+
+  numberOfVoxels.assign( numberOfResolutions, 1 );
+  for( unsigned int level = 0; level < numberOfResolutions; ++level )
+  {
+    for( unsigned int d = 0; d < info.m_Dimension; ++d )
+    {
+      double factor = std::pow( 2.0, static_cast< double >( numberOfResolutions - 1 - level ) );
+      if( shrinks )
+      {
+        const unsigned int entry_nr = level * info.m_Dimension + d;
+        std::string dummyErrorMessage = "";
+        config->ReadParameter( factor, "ImagePyramidSchedule", entry_nr, false, dummyErrorMessage );
+        config->ReadParameter( factor, prefix + "ImagePyramidSchedule", entry_nr, false, dummyErrorMessage );
+        if( generic )
+        {
+          config->ReadParameter( factor, "ImagePyramidRescaleSchedule", entry_nr, false, dummyErrorMessage );
+          config->ReadParameter( factor, prefix + "ImagePyramidRescaleSchedule", entry_nr, false, dummyErrorMessage );
+        }
+      }
+      const SizeValueType size = shrinks
+        ? std::max< SizeValueType >( 1, static_cast< SizeValueType >(
+          std::floor( info.m_Size[ d ] / std::max( 1.0, factor ) ) ) )
+        : info.m_Size[ d ];
+      numberOfVoxels[ level ] *= size;
+    }
+  }
+
+} // end ComputePyramidSizes()
+
+
+/**
+ * ******************* ComputeBSplineGridSizes *******************
+ */
+
+template< unsigned int VDimension >
+void
+RegistrationCostEstimator
+::ComputeBSplineGridSizes( const ParameterMapInterfaceType * config,
+  const ImageInformationType & info, unsigned int numberOfResolutions,
+  unsigned int splineOrder, std::vector< SizeValueType > & numberOfGridPoints )
+{
+  typedef itk::GridScheduleComputer< double, VDimension >                GridScheduleComputerType;
+  typedef typename GridScheduleComputerType::OriginType                  OriginType;
+  typedef typename GridScheduleComputerType::SpacingType                 SpacingType;
+  typedef typename GridScheduleComputerType::DirectionType               DirectionType;
+  typedef typename GridScheduleComputerType::RegionType                  RegionType;
+  typedef typename GridScheduleComputerType::SizeType                    SizeType;
+  typedef typename GridScheduleComputerType::VectorGridSpacingFactorType GridScheduleType;
+
+  /** Set up the grid schedule computer with the image information, as
+   * AdvancedBSplineTransform::PreComputeGridInformation() does.
+   */
+  OriginType    origin;
+  SpacingType   spacing;
+  DirectionType direction;
+  SizeType      size;
+  for( unsigned int r = 0; r < VDimension; ++r )
+  {
+    origin[ r ]  = info.m_Origin[ r ];
+    spacing[ r ] = info.m_Spacing[ r ];
+    size[ r ]    = info.m_Size[ r ];
+    for( unsigned int c = 0; c < VDimension; ++c )
+    {
+      direction[ r ][ c ] = info.m_Direction[ r * VDimension + c ];
+    }
+  }
+  RegionType region;
+  region.SetSize( size );
+
+  typename GridScheduleComputerType::Pointer computer = GridScheduleComputerType::New();
+  computer->SetImageOrigin( origin );
+  computer->SetImageSpacing( spacing );
+  computer->SetImageDirection( direction );
+  computer->SetImageRegion( region );
+  computer->SetBSplineOrder( splineOrder );
+
+  /** The final grid spacing, in voxels or in physical units. */
+  SpacingType finalGridSpacing;
+  finalGridSpacing.Fill( 8.0 );
+  const bool inVoxels = config->CountNumberOfParameterEntries( "FinalGridSpacingInVoxels" ) > 0;
+  for( unsigned int d = 0; d < VDimension; ++d )
+  {
+    if( inVoxels )
+    {
+      double spacingInVoxels = 16.0;
+      Self::ReadParameter( config, spacingInVoxels, "FinalGridSpacingInVoxels", d );
+      finalGridSpacing[ d ] = spacingInVoxels * spacing[ d ];
+    }
+    else
+    {
+      Self::ReadParameter( config, finalGridSpacing[ d ], "FinalGridSpacingInPhysicalUnits", d );
+    }
+  }
+
+  /** The grid spacing schedule, per resolution, or per resolution and
+   * dimension.
+   */
+  computer->SetDefaultSchedule( numberOfResolutions, 2.0 );
+  GridScheduleType gridSchedule;
+  computer->GetSchedule( gridSchedule );
+  const std::size_t count = config->CountNumberOfParameterEntries( "GridSpacingSchedule" );
+  for( unsigned int res = 0; res < numberOfResolutions; ++res )
+  {
+    for( unsigned int d = 0; d < VDimension; ++d )
+    {
+      if( count == numberOfResolutions )
+      {
+        Self::ReadParameter( config, gridSchedule[ res ][ d ], "GridSpacingSchedule", res );
+      }
+      else if( count == numberOfResolutions * VDimension )
+      {
+        Self::ReadParameter( config, gridSchedule[ res ][ d ], "GridSpacingSchedule", res * VDimension + d );
+      }
+    }
+  }
+
+  computer->SetFinalGridSpacing( finalGridSpacing );
+  computer->SetSchedule( gridSchedule );
+  computer->ComputeBSplineGrid();
+
+  numberOfGridPoints.resize( numberOfResolutions );
+  for( unsigned int level = 0; level < numberOfResolutions; ++level )
+  {
+    RegionType    gridRegion;
+    SpacingType   gridSpacing;
+    OriginType    gridOrigin;
+    DirectionType gridDirection;
+    computer->GetBSplineGrid( level, gridRegion, gridSpacing, gridOrigin, gridDirection );
+    numberOfGridPoints[ level ] = gridRegion.GetNumberOfPixels();
+  }
+
+} // end ComputeBSplineGridSizes()
+
+
+/**
+ * ******************* ReadImageInformation *******************
+ */
+
+void
+RegistrationCostEstimator
+::ReadImageInformation( const std::string & fileName, ImageInformationType & info )
+{
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+    fileName.c_str(), itk::ImageIOFactory::ReadMode );
+  if( imageIO.IsNull() )
+  {
+    itkGenericExceptionMacro( << "ERROR: could not read the header of \"" << fileName << "\"." );
+  }
+  imageIO->SetFileName( fileName );
+  imageIO->ReadImageInformation();
+
+  const unsigned int dimension = imageIO->GetNumberOfDimensions();
+  info.m_Dimension      = dimension;
+  info.m_NumberOfVoxels = 1;
+  info.m_Size.resize( dimension );
+  info.m_Spacing.resize( dimension );
+  info.m_Origin.resize( dimension );
+  info.m_Direction.resize( dimension * dimension );
+  for( unsigned int d = 0; d < dimension; ++d )
+  {
+    info.m_Size[ d ]       = imageIO->GetDimensions( d );
+    info.m_Spacing[ d ]    = imageIO->GetSpacing( d );
+    info.m_Origin[ d ]     = imageIO->GetOrigin( d );
+    info.m_NumberOfVoxels *= info.m_Size[ d ];
+
+    /** The ImageIO gives the direction column wise. */
+    const std::vector< double > column = imageIO->GetDirection( d );
+    for( unsigned int r = 0; r < dimension; ++r )
+    {
+      info.m_Direction[ r * dimension + d ] = column[ r ];
+    }
+  }
+
+} // end ReadImageInformation()
+
+
+/**
+ * ******************* GetPixelTypeSize *******************
+ */
+
+unsigned int
+RegistrationCostEstimator
+::GetPixelTypeSize( const std::string & pixelType )
+{
+  if( pixelType == "char" || pixelType == "unsigned char" )
+  {
+    return 1;
+  }
+  else if( pixelType == "short" || pixelType == "unsigned short" )
+  {
+    return 2;
+  }
+  else if( pixelType == "long" || pixelType == "unsigned long" || pixelType == "double" )
+  {
+    return 8;
+  }
+  return 4;
+
+} // end GetPixelTypeSize()
+
+
+/**
+ * ******************* WriteReport *******************
+ */
+
+void
+RegistrationCostEstimator
+::WriteReport( std::ostream & os ) const
+{
+  const double megabyte = 1024.0 * 1024.0;
+
+  os << std::fixed << std::setprecision( 1 );
+  os << "// elastix registration cost estimate\n";
+  os << "(PeakMemoryMB " << this->m_PeakMemory / megabyte << ")\n";
+  os << "(EstimatedSeconds " << this->m_Seconds << ")\n";
+  os << "(NumberOfThreads " << this->m_NumberOfThreads << ")\n";
+  os << "(NumberOfParameterMaps " << this->m_ParameterMapEstimates.size() << ")\n";
+
+  for( std::size_t i = 0; i < this->m_ParameterMapEstimates.size(); ++i )
+  {
+    const ParameterMapEstimateType & estimate = this->m_ParameterMapEstimates[ i ];
+    os << "\n// Parameter map " << i << ": \"" << estimate.m_Name
+       << "\", transform \"" << estimate.m_Transform << "\"";
+    if( !estimate.m_TransformIsKnown )
+    {
+      os << " (unknown, its parameters are not counted)";
+    }
+    os << "\n//   peak memory " << estimate.m_PeakMemory / megabyte << " MB, "
+       << estimate.m_Seconds << " s\n";
+    os << "//   resolution  fixed voxels  moving voxels  parameters  samples  evaluations  work MB  seconds\n";
+    for( std::size_t r = 0; r < estimate.m_Resolutions.size(); ++r )
+    {
+      const ResolutionEstimateType & resolution = estimate.m_Resolutions[ r ];
+      os << "//   " << std::setw( 10 ) << r
+         << "  " << std::setw( 12 ) << resolution.m_FixedImageVoxels
+         << "  " << std::setw( 13 ) << resolution.m_MovingImageVoxels
+         << "  " << std::setw( 10 ) << resolution.m_NumberOfParameters
+         << "  " << std::setw( 7 ) << resolution.m_NumberOfSamples
+         << "  " << std::setw( 11 ) << resolution.m_NumberOfEvaluations
+         << "  " << std::setw( 7 ) << resolution.m_WorkMemory / megabyte
+         << "  " << std::setw( 7 ) << resolution.m_Seconds << "\n";
+    }
+  }
+  os << std::flush;
+
+} // end WriteReport()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+void
+RegistrationCostEstimator
+::PrintSelf( std::ostream & os, itk::Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "FixedImageFileName: " << this->m_FixedImageFileName << std::endl;
+  os << indent << "MovingImageFileName: " << this->m_MovingImageFileName << std::endl;
+  os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+  os << indent << "NumberOfParameterMaps: " << this->m_ParameterMaps.size() << std::endl;
+  os << indent << "RuntimeScale: " << this->m_RuntimeScale << std::endl;
+  os << indent << "MemoryScale: " << this->m_MemoryScale << std::endl;
+  os << indent << "PeakMemory: " << this->m_PeakMemory << std::endl;
+  os << indent << "Seconds: " << this->m_Seconds << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace elastix
@@ -0,0 +1,240 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __elxRegistrationCostEstimator_h
+#define __elxRegistrationCostEstimator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkParameterFileParser.h"
+#include "itkParameterMapInterface.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace elastix
+{
+
+/**
+ * \class RegistrationCostEstimator
+ * \brief Predicts the peak memory and the run time of a registration,
+ * without running it.
+ *
+ * Only the headers of the images are read. From the parameter maps the
+ * estimator derives, for every resolution, the sizes of the pyramid images,
+ * the B-spline grid (with the GridScheduleComputer, as the B-spline
+ * transforms do), the number of parameters and of nonzero Jacobian entries,
+ * the number of samples and the number of metric evaluations. These give
+ * the buffers of the registration: the images, the pyramids and masks, the
+ * interpolator coefficients, the samples, the optimizer vectors, the
+ * per-thread derivatives and Jacobians, and the histograms of the mutual
+ * information metrics. The peak memory is the largest of the registration
+ * and the final resampling, over all parameter maps, which are run one
+ * after the other.
+ *
+ * The run time is modelled as a cost per sample and nonzero Jacobian entry,
+ * per parameter, and per pyramid and resampled voxel, divided over the
+ * threads. The costs, and an overall RuntimeScale and MemoryScale, can be
+ * set by a calibration parameter map, with the entries:
+ * (RuntimeScale), (MemoryScale), (BaseMemoryMB), (NanosecondsPerSample),
+ * (NanosecondsPerJacobianEntry), (NanosecondsPerParameter),
+ * (NanosecondsPerPyramidVoxel), (NanosecondsPerResampledVoxel) and
+ * (ParallelEfficiency). The benchmark script elx_benchmark.py writes such
+ * a map from its measurements.
+ *
+ * Parameters that are not given get the defaults of the components. The
+ * estimate is a model: masks are assumed to cover the image, and
+ * stopping criteria other than the maximum number of iterations are not
+ * taken into account.
+ *
+ * \ingroup Kernel
+ */
+
+class RegistrationCostEstimator : public itk::Object
+{
+public:
+
+  /** Standard itk. */
+  typedef RegistrationCostEstimator       Self;
+  typedef itk::Object                     Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( RegistrationCostEstimator, itk::Object );
+
+  /** Typedefs. */
+  typedef itk::ParameterFileParser::ParameterMapType ParameterMapType;
+  typedef itk::ParameterMapInterface                 ParameterMapInterfaceType;
+  typedef itk::SizeValueType                         SizeValueType;
+
+  /** The estimate of one resolution. */
+  struct ResolutionEstimateType
+  {
+    SizeValueType m_FixedImageVoxels;
+    SizeValueType m_MovingImageVoxels;
+    SizeValueType m_NumberOfParameters;
+    SizeValueType m_NumberOfNonZeroJacobianIndices;
+    SizeValueType m_NumberOfSamples;
+    SizeValueType m_NumberOfEvaluations;
+    double        m_WorkMemory;
+    double        m_Seconds;
+  };
+
+  /** The estimate of one parameter map. */
+  struct ParameterMapEstimateType
+  {
+    std::string                           m_Name;
+    std::string                           m_Transform;
+    bool                                  m_TransformIsKnown;
+    std::vector< ResolutionEstimateType > m_Resolutions;
+    double                                m_PeakMemory;
+    double                                m_Seconds;
+  };
+
+  /** Set/Get the image file names. Only their headers are read. The moving
+   * image defaults to the fixed image; the masks are optional.
+   */
+  itkSetStringMacro( FixedImageFileName );
+  itkGetStringMacro( FixedImageFileName );
+  itkSetStringMacro( MovingImageFileName );
+  itkGetStringMacro( MovingImageFileName );
+  itkSetStringMacro( FixedMaskFileName );
+  itkGetStringMacro( FixedMaskFileName );
+  itkSetStringMacro( MovingMaskFileName );
+  itkGetStringMacro( MovingMaskFileName );
+
+  /** Set/Get the number of threads of the registration. */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
+  /** Add a parameter map, with a name for the report. */
+  void AddParameterMap( const ParameterMapType & parameterMap, const std::string & name );
+
+  /** Set the calibration of the cost model. Entries that are not given keep
+   * their defaults.
+   */
+  void SetCalibration( const ParameterMapType & calibration );
+
+  /** Compute the estimate. Throws if an image header can not be read. */
+  void Estimate( void );
+
+  /** Get the predicted peak memory in bytes, and run time in seconds. */
+  itkGetConstMacro( PeakMemory, double );
+  itkGetConstMacro( Seconds, double );
+
+  /** Get the estimates of the parameter maps. */
+  const std::vector< ParameterMapEstimateType > & GetParameterMapEstimates( void ) const
+  {
+    return this->m_ParameterMapEstimates;
+  }
+
+
+  /** Write the estimate in the parameter file format: the totals as entries,
+   * which a scheduler can read, and the resolutions as comments.
+   */
+  void WriteReport( std::ostream & os ) const;
+
+protected:
+
+  RegistrationCostEstimator();
+  virtual ~RegistrationCostEstimator() {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, itk::Indent indent ) const ITK_OVERRIDE;
+
+private:
+
+  RegistrationCostEstimator( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  /** The header of an image. */
+  struct ImageInformationType
+  {
+    unsigned int                 m_Dimension;
+    std::vector< SizeValueType > m_Size;
+    std::vector< double >        m_Spacing;
+    std::vector< double >        m_Origin;
+    std::vector< double >        m_Direction;
+    SizeValueType                m_NumberOfVoxels;
+  };
+
+  /** Read the header of an image. */
+  static void ReadImageInformation( const std::string & fileName, ImageInformationType & info );
+
+  /** Read a parameter silently, at entry entry_nr or else entry 0. */
+  template< class T >
+  static bool ReadParameter( const ParameterMapInterfaceType * config,
+    T & parameterValue, const std::string & parameterName, unsigned int entry_nr );
+
+  /** Estimate one parameter map. */
+  void EstimateParameterMap( const ParameterMapType & parameterMap,
+    ParameterMapEstimateType & estimate ) const;
+
+  /** Compute the sizes of the pyramid images of every resolution. */
+  static void ComputePyramidSizes( const ParameterMapInterfaceType * config,
+    const std::string & prefix, const ImageInformationType & info,
+    unsigned int numberOfResolutions, std::vector< SizeValueType > & numberOfVoxels );
+
+  /** Compute the number of B-spline grid points of every resolution. */
+  template< unsigned int VDimension >
+  static void ComputeBSplineGridSizes( const ParameterMapInterfaceType * config,
+    const ImageInformationType & info, unsigned int numberOfResolutions,
+    unsigned int splineOrder, std::vector< SizeValueType > & numberOfGridPoints );
+
+  /** Get the size of a pixel type, such as "float". */
+  static unsigned int GetPixelTypeSize( const std::string & pixelType );
+
+  std::string  m_FixedImageFileName;
+  std::string  m_MovingImageFileName;
+  std::string  m_FixedMaskFileName;
+  std::string  m_MovingMaskFileName;
+  unsigned int m_NumberOfThreads;
+
+  std::vector< ParameterMapType > m_ParameterMaps;
+  std::vector< std::string >      m_ParameterMapNames;
+
+  /** The images, read by Estimate(). */
+  ImageInformationType m_FixedImageInformation;
+  ImageInformationType m_MovingImageInformation;
+  SizeValueType        m_MaskVoxels;
+
+  /** The calibration. */
+  double m_RuntimeScale;
+  double m_MemoryScale;
+  double m_BaseMemoryMB;
+  double m_NanosecondsPerSample;
+  double m_NanosecondsPerJacobianEntry;
+  double m_NanosecondsPerParameter;
+  double m_NanosecondsPerPyramidVoxel;
+  double m_NanosecondsPerResampledVoxel;
+  double m_ParallelEfficiency;
+
+  /** The results. */
+  std::vector< ParameterMapEstimateType > m_ParameterMapEstimates;
+  double                                  m_PeakMemory;
+  double                                  m_Seconds;
+
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxRegistrationCostEstimator_h
@@ -30,6 +30,7 @@
 
 #ifdef ELASTIX_USE_OPENCL
 #include "itkOpenCLSetup.h"
+#include <sstream>
 #endif
 
 namespace elastix
@@ -48,6 +49,7 @@ TransformixMain::Run( void )
   /** Set process properties. */
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
+  this->SetBufferArena();
 
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
@@ -81,9 +83,21 @@ TransformixMain::Run( void )
   this->m_Configuration->ReadParameter( userSuppliedOpenCLDeviceID,
     "OpenCLDeviceID", 0, false );
 
+  /** Check if user wants to use all devices of the platform. */
+  bool userSuppliedOpenCLUseMultipleDevices = false;
+  this->m_Configuration->ReadParameter( userSuppliedOpenCLUseMultipleDevices,
+    "OpenCLUseMultipleDevices", 0, false );
+
+  /** Check if user wants to profile the OpenCL kernels and transfers. */
+  bool userSuppliedOpenCLProfiling = false;
+  this->m_Configuration->ReadParameter( userSuppliedOpenCLProfiling,
+    "OpenCLProfiling", 0, false );
+  itk::SetOpenCLProfilingEnabled( userSuppliedOpenCLProfiling );
+
   std::string errorMessage              = "";
   const bool  creatingContextSuccessful = itk::CreateOpenCLContext(
-    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID );
+    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID,
+    userSuppliedOpenCLUseMultipleDevices );
   if( !creatingContextSuccessful )
   {
     /** Report and disable the GPU by releasing the context. */
@@ -96,6 +110,12 @@ TransformixMain::Run( void )
 
   /** Create a log file. */
   itk::CreateOpenCLLogger( "transformix", this->m_Configuration->GetCommandLineArgument( "-out" ) );
+
+  /** Cache the OpenCL program binaries between runs, if requested. */
+  std::string openCLProgramCacheDirectory = "";
+  this->m_Configuration->ReadParameter( openCLProgramCacheDirectory,
+    "OpenCLProgramCacheDirectory", 0, false );
+  itk::SetOpenCLProgramCacheDirectory( openCLProgramCacheDirectory );
 #endif
 
 #ifdef _ELASTIX_BUILD_LIBRARY
@@ -115,8 +135,19 @@ TransformixMain::Run( void )
   this->GetElastixBase()->SetResamplerContainer(
     this->CreateComponents( "Resampler", "DefaultResampler", errorCode ) );
 
-  this->GetElastixBase()->SetTransformContainer(
-    this->CreateComponents( "Transform", "", errorCode ) );
+  /** Use the live transform, if any, instead of creating one. */
+  if( this->m_Transform.IsNotNull() )
+  {
+    ObjectContainerPointer transformContainer = ObjectContainerType::New();
+    transformContainer->CreateElementAt( 0 ) = this->m_Transform;
+    this->GetElastixBase()->SetTransformContainer( transformContainer );
+    this->GetElastixBase()->SetUseLiveTransform( true );
+  }
+  else
+  {
+    this->GetElastixBase()->SetTransformContainer(
+      this->CreateComponents( "Transform", "", errorCode ) );
+  }
 
   /** Check if all components could be created. */
   if( errorCode != 0 )
@@ -152,6 +183,16 @@ TransformixMain::Run( void )
     errorCode = 1;
   }
 
+  /** Report the OpenCL kernel timings and transfers, if requested. */
+#ifdef ELASTIX_USE_OPENCL
+  std::ostringstream openCLProfiling;
+  itk::PrintOpenCLProfiling( openCLProfiling );
+  elxout << openCLProfiling.str();
+#endif
+
+  /** Return the transform, see ElastixMain::GetFinalTransform(). */
+  this->m_FinalTransform = this->GetElastixBase()->GetFinalTransform();
+
   /** Save the image container. */
   this->SetMovingImageContainer(
     this->GetElastixBase()->GetMovingImageContainer() );
@@ -102,11 +102,29 @@ public:
   virtual void SetInputImageContainer(
     DataObjectContainerType * inputImageContainer );
 
+  /** Set/Get a live transform, the final transform of an earlier elastix
+   * run in the same process, see ElastixMain::GetFinalTransform(). When set,
+   * it is used as the transform component, instead of a transform that is
+   * created and read from the transform parameter map. So its parameters,
+   * including B-spline coefficients, and its initial transforms are used
+   * as they are, without a round trip through strings. The transform must
+   * have been created for the same image types as the transform parameter
+   * map specifies. It is reconfigured by Run(), so it should not be shared
+   * by concurrent runs. After Run(), GetFinalTransform() returns the transform
+   * that was used, so that it can be passed to the next TransformixMain, as
+   * transformix does for the jobs of a batch.
+   */
+  itkSetObjectMacro( Transform, ObjectType );
+  itkGetObjectMacro( Transform, ObjectType );
+
 protected:
 
   TransformixMain(){}
   virtual ~TransformixMain();
 
+  /** The live transform, see SetTransform(). */
+  ObjectPointer m_Transform;
+
   /** InitDBIndex sets m_DBIndex to the value obtained
    * from the ComponentDatabase.
    */
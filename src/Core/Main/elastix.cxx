@@ -18,6 +18,31 @@
 
 #include "elastix.h"
 #include "elxElastixMain.h"
+#include "elxRegistrationCostEstimator.h"
+#include "itkFixedImagePreprocessingCache.h"
+#include "itkDistributedComputation.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkExtractImageFilter.h"
+#include "itkMultiThreader.h"
+
+/** The fixed image and mask that the requests of an elastix server share,
+ * as long as the requests use the same fixed image, mask and fixed image type.
+ */
+struct ResidentFixedImageType
+{
+  std::string                                  Key;
+  elx::ElastixMain::DataObjectContainerPointer ImageContainer;
+  elx::ElastixMain::DataObjectContainerPointer MaskContainer;
+  elx::ElastixMain::FlatDirectionCosinesType   OriginalDirection;
+};
+
+/** Runs elastix with the command line arguments, of which the first one is
+ * the name of the executable. The fixed image is taken from and kept in
+ * \a resident if it is not null; the component database, the preprocessing
+ * cache and the resident image are then not released.
+ */
+int RunElastix( const std::vector< std::string > & arguments, ResidentFixedImageType * resident );
 
 int
 main( int argc, char ** argv )
@@ -52,6 +77,56 @@ main( int argc, char ** argv )
     }
   }
 
+  /** Support Mevis Dicom Tiff (if selected in cmake) */
+  RegisterMevisDicomTiff();
+
+  std::vector< std::string > arguments( argv, argv + argc );
+
+  /** Serve the requests of a request file, or run once. */
+  if( arguments[ 1 ] == "-server" )
+  {
+    if( argc != 3 && !( argc == 5 && arguments[ 3 ] == "-reply" ) )
+    {
+      std::cerr << "ERROR: use \"elastix -server <requests> [-reply <replies>]\"." << std::endl;
+      return 1;
+    }
+    return RunServer( arguments[ 2 ], argc == 5 ? arguments[ 4 ] : "", arguments[ 0 ] );
+  }
+
+  /** When started as several MPI processes, all processes run the same
+   * registration, and share the evaluation of the metric. The first process
+   * writes to the output folder, the others to a subfolder rank<r> of it.
+   */
+  itk::DistributedComputation::Initialize( &argc, &argv );
+  const unsigned int rank = itk::DistributedComputation::GetInstance()->GetRank();
+  if( rank > 0 )
+  {
+    for( std::size_t i = 1; i + 1 < arguments.size(); i += 2 )
+    {
+      if( arguments[ i ] == "-out" )
+      {
+        std::ostringstream rankFolder( "" );
+        rankFolder << MakeOutputFolderName( arguments[ i + 1 ] ) << "rank" << rank;
+        itksys::SystemTools::MakeDirectory( rankFolder.str().c_str() );
+        arguments[ i + 1 ] = rankFolder.str();
+      }
+    }
+  }
+
+  const int returnValue = RunElastix( arguments, 0 );
+  itk::DistributedComputation::Finalize();
+  return returnValue;
+
+} // end main
+
+
+/**
+ * *********************** RunElastix ****************************
+ */
+
+int
+RunElastix( const std::vector< std::string > & arguments, ResidentFixedImageType * resident )
+{
   /** Some typedef's. */
   typedef elx::ElastixMain                            ElastixMainType;
   typedef ElastixMainType::Pointer                    ElastixMainPointer;
@@ -59,16 +134,13 @@ main( int argc, char ** argv )
   typedef ElastixMainType::ObjectPointer              ObjectPointer;
   typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
   typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
+  typedef ElastixMainType::ParameterMapType           ParameterMapType;
 
   typedef ElastixMainType::ArgumentMapType ArgumentMapType;
   typedef ArgumentMapType::value_type      ArgumentMapEntryType;
 
-  typedef std::pair< std::string, std::string > ArgPairType;
-  typedef std::queue< ArgPairType >             ParameterFileListType;
-  typedef ParameterFileListType::value_type     ParameterFileListEntryType;
-
-  /** Support Mevis Dicom Tiff (if selected in cmake) */
-  RegisterMevisDicomTiff();
+  typedef std::vector< std::string >      ParameterFileListType;
+  typedef std::vector< ParameterMapType > ParameterMapListType;
 
   /** Some declarations and initializations. */
   ElastixMainVectorType elastices;
@@ -83,22 +155,24 @@ main( int argc, char ** argv )
   unsigned long              nrOfParameterFiles = 0;
   ArgumentMapType            argMap;
   ParameterFileListType      parameterFileList;
+  ParameterMapListType       parameterMapList;
+  BatchManifestType          batch;
+  std::vector< double >      slicePositions;
   bool                       outFolderPresent = false;
   std::string                outFolder        = "";
   std::string                logFileName      = "";
 
   /** Put command line parameters into parameterFileList. */
-  for( unsigned int i = 1; static_cast< long >( i ) < ( argc - 1 ); i += 2 )
+  for( std::size_t i = 1; i + 1 < arguments.size(); i += 2 )
   {
-    std::string key( argv[ i ] );
-    std::string value( argv[ i + 1 ] );
+    std::string key( arguments[ i ] );
+    std::string value( arguments[ i + 1 ] );
 
     if( key == "-p" )
     {
       /** Queue the ParameterFileNames. */
       nrOfParameterFiles++;
-      parameterFileList.push(
-        ParameterFileListEntryType( key.c_str(), value.c_str() ) );
+      parameterFileList.push_back( value );
       /** The different '-p' are stored in the argMap, with
        * keys p(1), p(2), etc. */
       std::ostringstream tempPname( "" );
@@ -111,19 +185,7 @@ main( int argc, char ** argv )
       if( key == "-out" )
       {
         /** Make sure that last character of the output folder equals a '/' or '\'. */
-        const char last = value[ value.size() - 1 ];
-        if( last != '/' && last != '\\' ) { value.append( "/" ); }
-        value = itksys::SystemTools::ConvertToOutputPath( value.c_str() );
-
-        /** Note that on Windows, in case the output folder contains a space,
-         * the path name is double quoted by ConvertToOutputPath, which is undesirable.
-         * So, we remove these quotes again.
-         */
-        if( itksys::SystemTools::StringStartsWith( value.c_str(), "\"" )
-          && itksys::SystemTools::StringEndsWith(   value.c_str(), "\"" ) )
-        {
-          value = value.substr( 1, value.length() - 2 );
-        }
+        value = MakeOutputFolderName( value );
 
         /** Save this information. */
         outFolderPresent = true;
@@ -149,7 +211,7 @@ main( int argc, char ** argv )
   } // end for loop
 
   /** The argv0 argument, required for finding the component.dll/so's. */
-  argMap.insert( ArgumentMapEntryType( "-argv0", argv[ 0 ] ) );
+  argMap.insert( ArgumentMapEntryType( "-argv0", arguments[ 0 ] ) );
 
   /** Check if at least once the option "-p" is given. */
   if( nrOfParameterFiles == 0 )
@@ -158,6 +220,49 @@ main( int argc, char ** argv )
     returndummy |= -1;
   }
 
+  /** Only estimate the cost of the registration, if asked for. */
+  if( argMap.count( "-estimate" ) )
+  {
+    return returndummy ? returndummy : EstimateRegistrationCost( argMap, parameterFileList );
+  }
+
+  /** Read the batch manifest, or register the single pair that is given by
+   * "-m", "-mMask" and "-out".
+   */
+  if( argMap.count( "-batch" ) )
+  {
+    if( argMap.count( "-m" ) || argMap.count( "-mMask" ) || argMap.count( "-slicewise" ) )
+    {
+      std::cerr << "ERROR: \"-m\", \"-mMask\" and \"-slicewise\" can not be combined with \"-batch\"." << std::endl;
+      returndummy |= -1;
+    }
+    else if( !ReadBatchManifest( argMap[ "-batch" ], batch ) )
+    {
+      returndummy |= -1;
+    }
+  }
+  else if( argMap.count( "-slicewise" ) )
+  {
+    if( argMap.count( "-fMask" ) || argMap.count( "-mMask" ) || !argMap.count( "-f" ) || !outFolderPresent )
+    {
+      std::cerr << "ERROR: \"-slicewise\" needs \"-f\" and \"-out\", and does not support masks." << std::endl;
+      returndummy |= -1;
+    }
+    else if( !PrepareSlicewiseBatch( argMap[ "-slicewise" ], argMap[ "-f" ],
+      argMap.count( "-m" ) ? argMap[ "-m" ] : "", outFolder, batch, slicePositions ) )
+    {
+      returndummy |= -1;
+    }
+  }
+  else
+  {
+    BatchEntryType entry;
+    entry.MovingImageFileName = argMap.count( "-m" ) ? argMap[ "-m" ] : "";
+    entry.MovingMaskFileName  = argMap.count( "-mMask" ) ? argMap[ "-mMask" ] : "";
+    entry.OutputFolder        = outFolder;
+    batch.push_back( entry );
+  }
+
   /** Check if the -out option is given. */
   if( outFolderPresent )
   {
@@ -187,6 +292,18 @@ main( int argc, char ** argv )
     std::cerr << "ERROR: No CommandLine option \"-out\" given!" << std::endl;
   }
 
+  /** Check that the output directories of the batch exist. */
+  for( std::size_t b = 0; b < batch.size(); ++b )
+  {
+    if( !batch[ b ].OutputFolder.empty()
+      && !itksys::SystemTools::FileIsDirectory( batch[ b ].OutputFolder.c_str() ) )
+    {
+      std::cerr << "ERROR: the output directory \"" << batch[ b ].OutputFolder
+                << "\" does not exist." << std::endl;
+      returndummy |= -2;
+    }
+  }
+
   /** Stop if some fatal errors occurred. */
   if( returndummy )
   {
@@ -201,7 +318,7 @@ main( int argc, char ** argv )
   elxout << "elastix is started at " << GetCurrentDateAndTime() << ".\n" << std::endl;
 
   /** Print where elastix was run. */
-  elxout << "which elastix:   " << argv[ 0 ] << std::endl;
+  elxout << "which elastix:   " << arguments[ 0 ] << std::endl;
   itksys::SystemInformation info;
   info.RunCPUCheck();
   info.RunOSCheck();
@@ -215,89 +332,232 @@ main( int argc, char ** argv )
          << static_cast< unsigned int >( info.GetProcessorClockFrequency() )
          << " MHz." << std::endl;
 
+  /** Read the parameter files once, they are shared by all image pairs. */
+  for( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+  {
+    itk::ParameterFileParser::Pointer parser = itk::ParameterFileParser::New();
+    parser->SetParameterFileName( parameterFileList[ i ] );
+    try
+    {
+      elxout << "Reading the elastix parameters from file \""
+             << parameterFileList[ i ] << "\" ..." << std::endl;
+      parser->ReadParameterFile();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      xl::xout[ "error" ] << "ERROR: when reading the parameter file:\n"
+                          << excp << std::endl;
+      return 1;
+    }
+    parameterMapList.push_back( parser->GetParameterMap() );
+  }
+  elxout << std::endl;
+
   /**
    * ********************* START REGISTRATION *********************
    *
-   * Do the (possibly multiple) registration(s).
+   * Do the (possibly multiple) registration(s), for every image pair.
+   * The fixed image and mask are read by the first pair, and shared
+   * by the other pairs. The component database is loaded only once.
    */
 
-  for( unsigned int i = 0; i < nrOfParameterFiles; i++ )
-  {
-    /** Create another instance of ElastixMain. */
-    elastices.push_back( ElastixMainType::New() );
+  DataObjectContainerPointer batchFixedImageContainer = 0;
+  DataObjectContainerPointer batchFixedMaskContainer  = 0;
+  FlatDirectionCosinesType   batchFixedImageOriginalDirection;
+  int                        batchReturn = 0;
 
-    /** Set stuff we get from a former registration. */
-    elastices[ i ]->SetInitialTransform( transform );
-    elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
-    elastices[ i ]->SetMovingImageContainer( movingImageContainer );
-    elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
-    elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
-    elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+  /** The pairs share the fixed image pyramids, eroded fixed masks and
+   * fixed image extrema via the preprocessing cache. */
+  itk::FixedImagePreprocessingCache::Pointer preprocessingCache
+    = itk::FixedImagePreprocessingCache::GetInstance();
+  preprocessingCache->SetEnabled( ( batch.size() > 1 && !argMap.count( "-slicewise" ) ) || resident != 0 );
 
-    /** Set the current elastix-level. */
-    elastices[ i ]->SetElastixLevel( i );
-    elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
+  /** A server keeps the fixed image of the previous request, if it is
+   * still the same file, with the same mask and fixed image type. */
+  if( resident != 0 )
+  {
+    const std::string fixedImageFileName = argMap.count( "-f" ) ? argMap[ "-f" ] : "";
+    const std::string fixedMaskFileName  = argMap.count( "-fMask" ) ? argMap[ "-fMask" ] : "";
+    ParameterMapType & parameterMap = parameterMapList[ 0 ];
+    std::ostringstream key( "" );
+    key << fixedImageFileName << "|"
+        << itksys::SystemTools::ModifiedTime( fixedImageFileName.c_str() ) << "|"
+        << fixedMaskFileName << "|"
+        << itksys::SystemTools::ModifiedTime( fixedMaskFileName.c_str() );
+    const char * typeParameters[] = { "FixedInternalImagePixelType", "FixedImageDimension" };
+    for( unsigned int p = 0; p < 2; ++p )
+    {
+      key << "|";
+      if( parameterMap.count( typeParameters[ p ] ) && !parameterMap[ typeParameters[ p ] ].empty() )
+      {
+        key << parameterMap[ typeParameters[ p ] ][ 0 ];
+      }
+    }
 
-    /** Delete the previous ParameterFileName. */
-    if( argMap.count( "-p" ) )
+    if( key.str() == resident->Key )
+    {
+      batchFixedImageContainer         = resident->ImageContainer;
+      batchFixedMaskContainer          = resident->MaskContainer;
+      batchFixedImageOriginalDirection = resident->OriginalDirection;
+      elxout << "The fixed image of the previous request is reused.\n" << std::endl;
+    }
+    else
     {
-      argMap.erase( "-p" );
+      resident->Key            = key.str();
+      resident->ImageContainer = 0;
+      resident->MaskContainer  = 0;
+      preprocessingCache->Clear();
     }
+  }
 
-    /** Read the first parameterFileName in the queue. */
-    ArgPairType argPair = parameterFileList.front();
-    parameterFileList.pop();
+  for( std::size_t b = 0; b < batch.size(); ++b )
+  {
+    /** Set the moving image, mask and output folder of this pair. */
+    if( argMap.count( "-batch" ) || argMap.count( "-slicewise" ) )
+    {
+      /** A slice has its own fixed image. */
+      if( !batch[ b ].FixedImageFileName.empty() )
+      {
+        argMap[ "-f" ]                   = batch[ b ].FixedImageFileName;
+        batchFixedImageContainer         = 0;
+        batchFixedMaskContainer          = 0;
+        batchFixedImageOriginalDirection = FlatDirectionCosinesType();
+      }
+      argMap[ "-m" ]   = batch[ b ].MovingImageFileName;
+      argMap[ "-out" ] = batch[ b ].OutputFolder;
+      argMap.erase( "-mMask" );
+      if( !batch[ b ].MovingMaskFileName.empty() )
+      {
+        argMap[ "-mMask" ] = batch[ b ].MovingMaskFileName;
+      }
 
-    /** Put it in the ArgumentMap. */
-    argMap.insert( ArgumentMapEntryType( argPair.first, argPair.second ) );
+      elxout << "=========================================================================" << "\n" << std::endl;
+      elxout << "Registering image pair " << b << " of the batch: \""
+             << batch[ b ].MovingImageFileName << "\", output to \""
+             << batch[ b ].OutputFolder << "\".\n" << std::endl;
+    }
 
-    /** Print a start message. */
-    elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
-    elxout << "Running elastix with parameter file " << i
-           << ": \"" << argMap[ "-p" ] << "\".\n" << std::endl;
+    /** Start from the shared fixed image and mask, and no transform. */
+    transform                   = 0;
+    fixedImageContainer         = batchFixedImageContainer;
+    fixedMaskContainer          = batchFixedMaskContainer;
+    fixedImageOriginalDirection = batchFixedImageOriginalDirection;
+    movingImageContainer        = 0;
+    movingMaskContainer         = 0;
+    elastices.clear();
 
-    /** Declare a timer, start it and print the start time. */
-    itk::TimeProbe timer;
-    timer.Start();
-    elxout << "Current time: " << GetCurrentDateAndTime() << "." << std::endl;
+    for( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+    {
+      /** Create another instance of ElastixMain. */
+      elastices.push_back( ElastixMainType::New() );
+
+      /** Set stuff we get from a former registration. */
+      elastices[ i ]->SetInitialTransform( transform );
+      elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
+      elastices[ i ]->SetMovingImageContainer( movingImageContainer );
+      elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
+      elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
+      elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+
+      /** Set the current elastix-level. */
+      elastices[ i ]->SetElastixLevel( i );
+      elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
+
+      /** Put the current ParameterFileName in the ArgumentMap. */
+      argMap[ "-p" ] = parameterFileList[ i ];
+
+      /** Print a start message. */
+      elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
+      elxout << "Running elastix with parameter file " << i
+             << ": \"" << argMap[ "-p" ] << "\".\n" << std::endl;
+
+      /** Declare a timer, start it and print the start time. */
+      itk::TimeProbe timer;
+      timer.Start();
+      elxout << "Current time: " << GetCurrentDateAndTime() << "." << std::endl;
+
+      /** Start registration. */
+      returndummy = elastices[ i ]->Run( argMap, parameterMapList[ i ] );
+
+      /** Check for errors. */
+      if( returndummy != 0 )
+      {
+        xl::xout[ "error" ] << "Errors occurred!" << std::endl;
+        break;
+      }
 
-    /** Start registration. */
-    returndummy = elastices[ i ]->Run( argMap );
+      /** Get the transform, the fixedImage and the movingImage
+       * in order to put it in the (possibly) next registration.
+       */
+      transform                   = elastices[ i ]->GetFinalTransform();
+      fixedImageContainer         = elastices[ i ]->GetFixedImageContainer();
+      movingImageContainer        = elastices[ i ]->GetMovingImageContainer();
+      fixedMaskContainer          = elastices[ i ]->GetFixedMaskContainer();
+      movingMaskContainer         = elastices[ i ]->GetMovingMaskContainer();
+      fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
+
+      /** Keep the fixed image and mask for the next pairs. */
+      if( batchFixedImageContainer.IsNull() )
+      {
+        batchFixedImageContainer         = fixedImageContainer;
+        batchFixedMaskContainer          = fixedMaskContainer;
+        batchFixedImageOriginalDirection = fixedImageOriginalDirection;
+      }
 
-    /** Check for errors. */
-    if( returndummy != 0 )
-    {
-      xl::xout[ "error" ] << "Errors occurred!" << std::endl;
-      return returndummy;
-    }
+      /** Print a finish message. */
+      elxout << "Running elastix with parameter file " << i
+             << ": \"" << argMap[ "-p" ] << "\", has finished.\n" << std::endl;
 
-    /** Get the transform, the fixedImage and the movingImage
-     * in order to put it in the (possibly) next registration.
-     */
-    transform                   = elastices[ i ]->GetFinalTransform();
-    fixedImageContainer         = elastices[ i ]->GetFixedImageContainer();
-    movingImageContainer        = elastices[ i ]->GetMovingImageContainer();
-    fixedMaskContainer          = elastices[ i ]->GetFixedMaskContainer();
-    movingMaskContainer         = elastices[ i ]->GetMovingMaskContainer();
-    fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
+      /** Stop timer and print it. */
+      timer.Stop();
+      elxout << "\nCurrent time: " << GetCurrentDateAndTime() << "." << std::endl;
+      elxout << "Time used for running elastix with this parameter file:\n  "
+             << ConvertSecondsToDHMS( timer.GetMean(), 1 ) << ".\n" << std::endl;
 
-    /** Print a finish message. */
-    elxout << "Running elastix with parameter file " << i
-           << ": \"" << argMap[ "-p" ] << "\", has finished.\n" << std::endl;
+      /** Try to release some memory. */
+      elastices[ i ] = 0;
 
-    /** Stop timer and print it. */
-    timer.Stop();
-    elxout << "\nCurrent time: " << GetCurrentDateAndTime() << "." << std::endl;
-    elxout << "Time used for running elastix with this parameter file:\n  "
-           << ConvertSecondsToDHMS( timer.GetMean(), 1 ) << ".\n" << std::endl;
+    } // end loop over registrations
 
-    /** Try to release some memory. */
-    elastices[ i ] = 0;
+    /** A failing pair does not stop the other pairs of a batch. */
+    if( returndummy != 0 )
+    {
+      if( !argMap.count( "-batch" ) && !argMap.count( "-slicewise" ) )
+      {
+        return returndummy;
+      }
+      xl::xout[ "error" ] << "Registering image pair " << b << " of the batch failed." << std::endl;
+      batchReturn = returndummy;
+    }
 
-  } // end loop over registrations
+  } // end loop over image pairs
 
   elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
 
+  /** List the final transform of every slice, which together form the
+   * transform of the stack. */
+  if( argMap.count( "-slicewise" ) )
+  {
+    const std::string sliceListFileName = outFolder + "SliceTransforms.txt";
+    std::ofstream     sliceList( sliceListFileName.c_str() );
+    sliceList << "// slice fixedSlicePosition transformParameterFile" << std::endl;
+    for( std::size_t b = 0; b < batch.size(); ++b )
+    {
+      sliceList << b << " " << slicePositions[ b ] << " \"" << batch[ b ].OutputFolder
+                << "TransformParameters." << nrOfParameterFiles - 1 << ".txt\"" << std::endl;
+    }
+    elxout << "The transforms of the slices are listed in \"" << sliceListFileName
+           << "\".\n" << std::endl;
+  }
+
+  /** Keep the fixed image for the next request of the server. */
+  if( resident != 0 )
+  {
+    resident->ImageContainer    = batchFixedImageContainer;
+    resident->MaskContainer     = batchFixedMaskContainer;
+    resident->OriginalDirection = batchFixedImageOriginalDirection;
+  }
+
   /** Stop totaltimer and print it. */
   totaltimer.Stop();
   elxout << "Total time elapsed: "
@@ -308,24 +568,198 @@ main( int argc, char ** argv )
    * are deleted before the modules are closed.
    */
 
-  for( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+  elastices.clear();
+
+  transform                = 0;
+  fixedImageContainer      = 0;
+  movingImageContainer     = 0;
+  fixedMaskContainer       = 0;
+  movingMaskContainer      = 0;
+  batchFixedImageContainer = 0;
+  batchFixedMaskContainer  = 0;
+
+  /** A server keeps the modules and the caches for the next request. */
+  if( resident == 0 )
   {
-    elastices[ i ] = 0;
+    preprocessingCache->Clear();
+    preprocessingCache->SetEnabled( false );
+
+    /** Close the modules. */
+    ElastixMainType::UnloadComponents();
   }
 
-  transform            = 0;
-  fixedImageContainer  = 0;
-  movingImageContainer = 0;
-  fixedMaskContainer   = 0;
-  movingMaskContainer  = 0;
+  /** Exit and return the error code. */
+  return batchReturn;
 
-  /** Close the modules. */
-  ElastixMainType::UnloadComponents();
+} // end RunElastix()
 
-  /** Exit and return the error code. */
-  return returndummy;
 
-} // end main
+/**
+ * *********************** RunServer ****************************
+ */
+
+int
+RunServer( const std::string & requestFileName, const std::string & replyFileName,
+  const std::string & argv0 )
+{
+  std::ifstream requests( requestFileName.c_str() );
+  if( !requests.is_open() )
+  {
+    std::cerr << "ERROR: the request file \"" << requestFileName << "\" could not be opened." << std::endl;
+    return 1;
+  }
+
+  std::ofstream replies;
+  if( !replyFileName.empty() )
+  {
+    replies.open( replyFileName.c_str(), std::ios_base::out | std::ios_base::app );
+    if( !replies.is_open() )
+    {
+      std::cerr << "ERROR: the reply file \"" << replyFileName << "\" could not be opened." << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "elastix serves the requests of \"" << requestFileName << "\"." << std::endl;
+
+  /** Read the requests as they are appended to the file, or written to
+   * the pipe, until a "quit" request. A line without end of line is not
+   * complete yet, so it is kept until the rest has arrived.
+   */
+  ResidentFixedImageType resident;
+  std::string            pending;
+  unsigned long          requestNumber = 0;
+  int                    serverReturn  = 0;
+  while( true )
+  {
+    std::string line;
+    if( !std::getline( requests, line ) || requests.eof() )
+    {
+      /** Wait for more, keeping a line that was not terminated yet. */
+      pending += line;
+      requests.clear();
+      itksys::SystemTools::Delay( 10 );
+      continue;
+    }
+    line    = pending + line;
+    pending = "";
+
+    std::vector< std::string > arguments;
+    if( !SplitRequest( line, arguments ) )
+    {
+      continue;
+    }
+    if( arguments[ 0 ] == "quit" )
+    {
+      break;
+    }
+
+    /** Run the request, and reply with its number, return code and time. */
+    ++requestNumber;
+    arguments.insert( arguments.begin(), argv0 );
+    itk::TimeProbe timer;
+    timer.Start();
+    int requestReturn = 0;
+    try
+    {
+      requestReturn = RunElastix( arguments, &resident );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << "ERROR: request " << requestNumber << " failed:\n" << excp << std::endl;
+      requestReturn = 1;
+    }
+    timer.Stop();
+    serverReturn |= requestReturn;
+
+    std::ostringstream reply( "" );
+    reply << requestNumber << " " << requestReturn << " " << timer.GetMean();
+    std::cout << "request " << reply.str() << std::endl;
+    if( replies.is_open() )
+    {
+      replies << reply.str() << std::endl;
+    }
+  }
+
+  /** Release the fixed image and the modules. */
+  resident.ImageContainer = 0;
+  resident.MaskContainer  = 0;
+  itk::FixedImagePreprocessingCache::GetInstance()->Clear();
+  itk::FixedImagePreprocessingCache::GetInstance()->SetEnabled( false );
+  elx::ElastixMain::UnloadComponents();
+
+  return serverReturn;
+
+} // end RunServer()
+
+
+/**
+ * *********************** EstimateRegistrationCost ****************************
+ */
+
+int
+EstimateRegistrationCost( const std::map< std::string, std::string > & argMap,
+  const std::vector< std::string > & parameterFileList )
+{
+  typedef std::map< std::string, std::string >::const_iterator ArgumentIteratorType;
+  elx::RegistrationCostEstimator::Pointer estimator = elx::RegistrationCostEstimator::New();
+
+  ArgumentIteratorType it = argMap.find( "-f" );
+  if( it == argMap.end() )
+  {
+    std::cerr << "ERROR: \"-estimate\" needs a fixed image \"-f\"." << std::endl;
+    return 1;
+  }
+  estimator->SetFixedImageFileName( it->second );
+  if( ( it = argMap.find( "-m" ) ) != argMap.end() ) { estimator->SetMovingImageFileName( it->second ); }
+  if( ( it = argMap.find( "-fMask" ) ) != argMap.end() ) { estimator->SetFixedMaskFileName( it->second ); }
+  if( ( it = argMap.find( "-mMask" ) ) != argMap.end() ) { estimator->SetMovingMaskFileName( it->second ); }
+
+  /** The number of threads that elastix would use. */
+  unsigned int numberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  if( ( it = argMap.find( "-threads" ) ) != argMap.end() )
+  {
+    numberOfThreads = static_cast< unsigned int >( std::max( 1, atoi( it->second.c_str() ) ) );
+  }
+  estimator->SetNumberOfThreads( numberOfThreads );
+
+  try
+  {
+    for( std::size_t i = 0; i < parameterFileList.size(); ++i )
+    {
+      itk::ParameterFileParser::Pointer parser = itk::ParameterFileParser::New();
+      parser->SetParameterFileName( parameterFileList[ i ] );
+      parser->ReadParameterFile();
+      estimator->AddParameterMap( parser->GetParameterMap(), parameterFileList[ i ] );
+    }
+    if( ( it = argMap.find( "-calibration" ) ) != argMap.end() )
+    {
+      itk::ParameterFileParser::Pointer parser = itk::ParameterFileParser::New();
+      parser->SetParameterFileName( it->second );
+      parser->ReadParameterFile();
+      estimator->SetCalibration( parser->GetParameterMap() );
+    }
+    estimator->Estimate();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: when estimating the cost of the registration:\n" << excp << std::endl;
+    return 1;
+  }
+
+  const std::string reportFileName = argMap.find( "-estimate" )->second;
+  std::ofstream     report( reportFileName.c_str() );
+  if( !report.is_open() )
+  {
+    std::cerr << "ERROR: the estimate file \"" << reportFileName << "\" could not be opened." << std::endl;
+    return 1;
+  }
+  estimator->WriteReport( report );
+  estimator->WriteReport( std::cout );
+
+  return 0;
+
+} // end EstimateRegistrationCost()
 
 
 /**
@@ -362,7 +796,31 @@ PrintHelp( void )
   std::cout << "  -t0       parameter file for initial transform\n";
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
-  std::cout << "  -threads  set the maximum number of threads of elastix\n"
+  std::cout << "  -threads  set the maximum number of threads of elastix\n";
+  std::cout << "  -threadplacement  pin the threads to the processors: none (default), compact,\n"
+            << "            filling one NUMA node first, or scatter, spreading them over the nodes\n";
+  std::cout << "  -hugepages  back the large image buffers by huge pages: off (default),\n"
+            << "            transparent, or explicit, using the reserved huge pages (Linux only)\n";
+  std::cout << "  -batch    manifest file, to register many moving images to the fixed image,\n"
+            << "            instead of \"-m\"; every line holds a moving image, an output\n"
+            << "            directory and optionally a moving mask\n";
+  std::cout << "  -estimate  file to write the predicted peak memory and run time to, instead\n"
+            << "            of registering; only the image headers are read, and \"-out\" is\n"
+            << "            not needed. \"-calibration\" gives the constants of the cost model\n";
+  std::cout << "  -slicewise  register the 2D slices of 3D stacks independently, with 2D\n"
+            << "            parameter files: \"stacks\" registers the slices of \"-m\" to those of\n"
+            << "            \"-f\", \"adjacent\" every slice of \"-f\" to the previous one\n"
+            << std::endl;
+
+  /** Server mode.*/
+  std::cout << "Or run elastix as a server:\n";
+  std::cout << "  -server   request file, or named pipe; every line holds the arguments of\n"
+            << "            one elastix call, e.g. \"-f fixed.mhd -m moving.mhd -p par.txt\n"
+            << "            -out outdir\". Requests are run one after the other, as they are\n"
+            << "            appended, until a line \"quit\". The components stay loaded, and\n"
+            << "            the fixed image is kept while the requests use the same one\n";
+  std::cout << "  -reply    optional reply file, to which a line \"<request> <return code>\n"
+            << "            <seconds>\" is appended when a request has finished\n"
             << std::endl;
 
   /** The parameter file.*/
@@ -376,3 +834,174 @@ PrintHelp( void )
     "or mail elastix@bigr.nl." << std::endl;
 
 } // end PrintHelp()
+
+
+/**
+ * *********************** ReadBatchManifest ****************************
+ */
+
+bool
+ReadBatchManifest( const std::string & fileName, BatchManifestType & batch )
+{
+  std::ifstream manifest( fileName.c_str() );
+  if( !manifest.is_open() )
+  {
+    std::cerr << "ERROR: the batch manifest \"" << fileName << "\" could not be opened." << std::endl;
+    return false;
+  }
+
+  std::string  line;
+  unsigned int lineNumber = 0;
+  while( std::getline( manifest, line ) )
+  {
+    ++lineNumber;
+    std::istringstream fields( line );
+    BatchEntryType     entry;
+    if( !( fields >> entry.MovingImageFileName )
+      || entry.MovingImageFileName.compare( 0, 2, "//" ) == 0
+      || entry.MovingImageFileName[ 0 ] == '#' )
+    {
+      continue;
+    }
+
+    std::string extra;
+    if( !( fields >> entry.OutputFolder ) || ( fields >> entry.MovingMaskFileName && fields >> extra ) )
+    {
+      std::cerr << "ERROR: line " << lineNumber << " of the batch manifest \"" << fileName
+                << "\" should hold a moving image, an output directory and optionally a moving mask." << std::endl;
+      return false;
+    }
+    entry.OutputFolder = MakeOutputFolderName( entry.OutputFolder );
+    batch.push_back( entry );
+  }
+
+  if( batch.empty() )
+  {
+    std::cerr << "ERROR: the batch manifest \"" << fileName << "\" holds no image pairs." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end ReadBatchManifest()
+
+
+/**
+ * *********************** PrepareSlicewiseBatch ****************************
+ */
+
+bool
+PrepareSlicewiseBatch( const std::string & mode,
+  const std::string & fixedStackFileName, const std::string & movingStackFileName,
+  const std::string & outputFolder, BatchManifestType & batch,
+  std::vector< double > & slicePositions )
+{
+  typedef itk::Image< float, 3 >                            StackType;
+  typedef itk::Image< float, 2 >                            SliceType;
+  typedef itk::ImageFileReader< StackType >                 ReaderType;
+  typedef itk::ImageFileWriter< SliceType >                 WriterType;
+  typedef itk::ExtractImageFilter< StackType, SliceType >   ExtractorType;
+
+  const bool adjacent = mode == "adjacent";
+  if( !adjacent && mode != "stacks" )
+  {
+    std::cerr << "ERROR: \"-slicewise\" should be \"stacks\" or \"adjacent\", not \""
+              << mode << "\"." << std::endl;
+    return false;
+  }
+  if( !adjacent && movingStackFileName.empty() )
+  {
+    std::cerr << "ERROR: \"-slicewise stacks\" needs a moving stack \"-m\"." << std::endl;
+    return false;
+  }
+
+  /** Read the stacks. */
+  StackType::Pointer fixedStack;
+  StackType::Pointer movingStack;
+  try
+  {
+    ReaderType::Pointer fixedReader = ReaderType::New();
+    fixedReader->SetFileName( fixedStackFileName );
+    fixedReader->Update();
+    fixedStack  = fixedReader->GetOutput();
+    movingStack = fixedStack;
+    if( !adjacent )
+    {
+      ReaderType::Pointer movingReader = ReaderType::New();
+      movingReader->SetFileName( movingStackFileName );
+      movingReader->Update();
+      movingStack = movingReader->GetOutput();
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: when reading the stacks of \"-slicewise\":\n" << excp << std::endl;
+    return false;
+  }
+
+  const StackType::RegionType & fixedRegion  = fixedStack->GetLargestPossibleRegion();
+  const StackType::RegionType & movingRegion = movingStack->GetLargestPossibleRegion();
+  if( !adjacent && fixedRegion.GetSize()[ 2 ] != movingRegion.GetSize()[ 2 ] )
+  {
+    std::cerr << "ERROR: the fixed and moving stack of \"-slicewise stacks\" should have "
+              << "the same number of slices." << std::endl;
+    return false;
+  }
+
+  /** Write the slices of every pair, and queue the pair. */
+  const unsigned long numberOfPairs = adjacent
+    ? ( fixedRegion.GetSize()[ 2 ] > 0 ? fixedRegion.GetSize()[ 2 ] - 1 : 0 )
+    : fixedRegion.GetSize()[ 2 ];
+  if( numberOfPairs == 0 )
+  {
+    std::cerr << "ERROR: the stack of \"-slicewise adjacent\" should have at least 2 slices." << std::endl;
+    return false;
+  }
+  for( unsigned long z = 0; z < numberOfPairs; ++z )
+  {
+    std::ostringstream sliceFolder( "" );
+    sliceFolder << outputFolder << "slice" << std::setw( 4 ) << std::setfill( '0' ) << z;
+    BatchEntryType entry;
+    entry.OutputFolder        = MakeOutputFolderName( sliceFolder.str() );
+    entry.FixedImageFileName  = entry.OutputFolder + "fixed.mha";
+    entry.MovingImageFileName = entry.OutputFolder + "moving.mha";
+    itksys::SystemTools::MakeDirectory( entry.OutputFolder.c_str() );
+
+    for( unsigned int which = 0; which < 2; ++which )
+    {
+      const StackType *     stack  = which == 0 ? fixedStack.GetPointer() : movingStack.GetPointer();
+      StackType::RegionType region = stack->GetLargestPossibleRegion();
+      region.SetIndex( 2, region.GetIndex()[ 2 ] + static_cast< long >( z + ( which == 1 && adjacent ? 1 : 0 ) ) );
+      region.SetSize( 2, 0 );
+
+      ExtractorType::Pointer extractor = ExtractorType::New();
+      extractor->SetInput( stack );
+      extractor->SetExtractionRegion( region );
+      extractor->SetDirectionCollapseToSubmatrix();
+      WriterType::Pointer writer = WriterType::New();
+      writer->SetInput( extractor->GetOutput() );
+      writer->SetFileName( which == 0 ? entry.FixedImageFileName : entry.MovingImageFileName );
+      try
+      {
+        writer->Update();
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << "ERROR: when writing slice " << z << " of \"-slicewise\":\n" << excp << std::endl;
+        return false;
+      }
+    }
+
+    /** The position of the fixed slice along the stack. */
+    StackType::IndexType index = fixedRegion.GetIndex();
+    index[ 2 ] += static_cast< long >( z );
+    StackType::PointType point;
+    fixedStack->TransformIndexToPhysicalPoint( index, point );
+    slicePositions.push_back( point[ 2 ] );
+
+    batch.push_back( entry );
+  }
+
+  return true;
+
+} // end PrepareSlicewiseBatch()
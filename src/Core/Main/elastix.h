@@ -21,10 +21,15 @@
 #include "itkUseMevisDicomTiff.h"
 
 #include <iostream>
+#include <fstream>
 #include <iomanip>      // std::setprecision
 #include <string>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
 #include <queue>
+#include <sstream>
 #include "itkObject.h"
 #include "itkDataObject.h"
 #include <itksys/SystemTools.hxx>
@@ -44,6 +49,171 @@
  */
 void PrintHelp( void );
 
+/** One image pair of a batch: the moving image and mask, and the output
+ * folder. The fixed image, fixed mask and parameter files are shared, unless
+ * the entry has its own fixed image, as the slices of "-slicewise" have.
+ */
+struct BatchEntryType
+{
+  std::string FixedImageFileName;
+  std::string MovingImageFileName;
+  std::string MovingMaskFileName;
+  std::string OutputFolder;
+};
+
+typedef std::vector< BatchEntryType > BatchManifestType;
+
+/** Declare ReadBatchManifest function.
+ *
+ * \commandlinearg -batch: optional argument for elastix, instead of "-m", to
+ *    register many moving images to the same fixed image in one process. The
+ *    component database and the parameter files are then read only once, and
+ *    the fixed image and mask are shared by all pairs. Every line of the
+ *    manifest holds a moving image, an output directory and optionally a
+ *    moving mask, separated by white space. Empty lines and lines starting
+ *    with '//' or '#' are skipped. The elastix.log is written in the "-out"
+ *    directory. \n
+ *    example: <tt>-batch manifest.txt</tt> \n
+ *
+ * Returns false, after printing the reason, if the manifest is invalid.
+ */
+bool ReadBatchManifest( const std::string & fileName, BatchManifestType & batch );
+
+/** Declare PrepareSlicewiseBatch function.
+ *
+ * \commandlinearg -slicewise: optional argument for elastix, to register the
+ *    2D slices of 3D stacks as independent 2D problems in one process, with
+ *    the (2D) parameter files shared by all slices. The component database and
+ *    the parameter files are read only once. With "stacks", slice z of the
+ *    moving stack "-m" is registered to slice z of the fixed stack "-f". With
+ *    "adjacent", slice z + 1 of the stack "-f" is registered to slice z, as for
+ *    serial sections; "-m" is not used. The slices are written to the folders
+ *    "slice<z>" of the "-out" directory, which receive the results, and the
+ *    file SliceTransforms.txt lists the final transform parameter file of
+ *    every slice, with the position of its fixed slice. \n
+ *    example: <tt>-slicewise adjacent</tt> \n
+ *
+ * Returns false, after printing the reason, if the stacks can not be sliced.
+ */
+bool PrepareSlicewiseBatch( const std::string & mode,
+  const std::string & fixedStackFileName, const std::string & movingStackFileName,
+  const std::string & outputFolder, BatchManifestType & batch,
+  std::vector< double > & slicePositions );
+
+/** Declare RunServer function.
+ *
+ * \commandlinearg -server: optional argument for elastix, to keep elastix
+ *    running and serve many registration requests. The requests are read from
+ *    a file, or a named pipe, one request per line, as they are appended. A
+ *    request holds the command line arguments of one elastix call. The
+ *    component database stays loaded, and the fixed image and its
+ *    preprocessing are kept while consecutive requests use the same fixed
+ *    image. The server stops at a line "quit". \n
+ *    example: <tt>elastix -server requests.txt</tt> \n
+ * \commandlinearg -reply: optional argument for elastix, with "-server". After
+ *    every request a line with the request number, the return code and the
+ *    elapsed seconds is appended to this file. \n
+ *    example: <tt>elastix -server requests.txt -reply replies.txt</tt> \n
+ *
+ * Returns 0 if all requests succeeded.
+ */
+int RunServer( const std::string & requestFileName, const std::string & replyFileName,
+  const std::string & argv0 );
+
+/** Declare EstimateRegistrationCost function.
+ *
+ * \commandlinearg -estimate: optional argument for elastix, to predict the
+ *    peak memory and the run time of the registration, without running it.
+ *    Only the headers of "-f", "-m", "-fMask" and "-mMask" are read; "-out"
+ *    is not needed. The estimate is written to the given file in the
+ *    parameter file format, with the totals as the entries (PeakMemoryMB)
+ *    and (EstimatedSeconds), and the details per resolution as comments.
+ *    It is also printed. "-threads" sets the number of threads to estimate
+ *    for. \n
+ *    example: <tt>elastix -f fixed.mhd -m moving.mhd -p par.txt -estimate cost.txt</tt> \n
+ * \commandlinearg -calibration: optional argument for elastix, with
+ *    "-estimate": a parameter file with the constants of the cost model,
+ *    such as (RuntimeScale), as written by elx_benchmark.py --calibrate. \n
+ *    example: <tt>-calibration RuntimeCalibration.txt</tt> \n
+ *
+ * Returns 0 if the estimate was written.
+ */
+int EstimateRegistrationCost( const std::map< std::string, std::string > & argMap,
+  const std::vector< std::string > & parameterFileList );
+
+/** Splits a request of the server, or a line of a transformix batch manifest,
+ * into its arguments, at white space outside double quotes. Returns false for
+ * empty lines and lines starting with '//' or '#'.
+ */
+bool
+SplitRequest( const std::string & line, std::vector< std::string > & arguments )
+{
+  arguments.clear();
+  std::string argument;
+  bool        inArgument = false;
+  bool        quoted     = false;
+  for( std::string::const_iterator it = line.begin(); it != line.end(); ++it )
+  {
+    const char c = *it;
+    if( c == '"' )
+    {
+      quoted     = !quoted;
+      inArgument = true;
+    }
+    else if( !quoted && ( c == ' ' || c == '\t' || c == '\r' ) )
+    {
+      if( inArgument )
+      {
+        arguments.push_back( argument );
+        argument   = "";
+        inArgument = false;
+      }
+    }
+    else
+    {
+      argument  += c;
+      inArgument = true;
+    }
+  }
+  if( inArgument )
+  {
+    arguments.push_back( argument );
+  }
+
+  /** Skip empty and comment lines. */
+  return !arguments.empty()
+         && arguments[ 0 ].compare( 0, 2, "//" ) != 0
+         && arguments[ 0 ][ 0 ] != '#';
+
+} // end SplitRequest()
+
+
+/** Makes sure that the last character of the output folder equals
+ * a '/' or '\\', and converts it to an output path.
+ */
+std::string
+MakeOutputFolderName( const std::string & folder )
+{
+  std::string value = folder;
+  const char  last  = value[ value.size() - 1 ];
+  if( last != '/' && last != '\\' ) { value.append( "/" ); }
+  value = itksys::SystemTools::ConvertToOutputPath( value.c_str() );
+
+  /** Note that on Windows, in case the output folder contains a space,
+   * the path name is double quoted by ConvertToOutputPath, which is undesirable.
+   * So, we remove these quotes again.
+   */
+  if( itksys::SystemTools::StringStartsWith( value.c_str(), "\"" )
+    && itksys::SystemTools::StringEndsWith(   value.c_str(), "\"" ) )
+  {
+    value = value.substr( 1, value.length() - 2 );
+  }
+
+  return value;
+
+} // end MakeOutputFolderName()
+
+
 /** ConvertSecondsToDHMS
  *
  */
@@ -27,6 +27,7 @@
 #endif
 
 #include "elxElastixMain.h"
+#include "itkFixedImagePreprocessingCache.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -59,6 +60,8 @@ ELASTIX::~ELASTIX()
 {
   this->m_ResultImage = 0;
   this->m_TransformParametersList.clear();
+  this->m_ResultImages.clear();
+  this->m_TransformParametersLists.clear();
 } // end Destructor
 
 
@@ -73,6 +76,17 @@ ELASTIX::GetResultImage( void )
 } // end GetResultImage()
 
 
+/**
+ * ******************* GetResultImage ***********************
+ */
+
+ELASTIX::ImagePointer
+ELASTIX::GetResultImage( const unsigned int index )
+{
+  return this->m_ResultImages[ index ];
+} // end GetResultImage()
+
+
 /**
  * ******************* GetTransformParameterMap ***********************
  */
@@ -95,6 +109,17 @@ ELASTIX::GetTransformParameterMapList( void )
 } // end GetTransformParameterMapList()
 
 
+/**
+ * ******************* GetTransformParameterMapList ***********************
+ */
+
+ELASTIX::ParameterMapListType
+ELASTIX::GetTransformParameterMapList( const unsigned int index )
+{
+  return this->m_TransformParametersLists[ index ];
+} // end GetTransformParameterMapList()
+
+
 /**
  * ******************* RegisterImages ***********************
  */
@@ -136,6 +161,40 @@ ELASTIX::RegisterImages(
   bool performCout,
   ImagePointer fixedMask,
   ImagePointer movingMask )
+{
+  /** A single registration is a batch of one moving image. */
+  const int returndummy = this->RegisterImageBatch(
+    fixedImage, ImageListType( 1, movingImage ),
+    parameterMaps,
+    outputPath,
+    performLogging, performCout,
+    fixedMask, ImageListType( 1, movingMask ) );
+
+  if( !this->m_ResultImages.empty() )
+  {
+    this->m_ResultImage             = this->m_ResultImages[ 0 ];
+    this->m_TransformParametersList = this->m_TransformParametersLists[ 0 ];
+  }
+
+  return returndummy;
+
+} // end RegisterImages()
+
+
+/**
+ * ******************* RegisterImageBatch ***********************
+ */
+
+int
+ELASTIX::RegisterImageBatch(
+  ImagePointer fixedImage,
+  const ImageListType & movingImages,
+  std::vector< ParameterMapType > & parameterMaps,
+  std::string outputPath,
+  bool performLogging,
+  bool performCout,
+  ImagePointer fixedMask,
+  const ImageListType & movingMasks )
 {
   /** Some typedef's. */
   typedef elx::ElastixMain                            ElastixMainType;
@@ -153,8 +212,20 @@ ELASTIX::RegisterImages(
   typedef std::queue< ArgPairType >             ParameterFileListType;
   typedef ParameterFileListType::value_type     ParameterFileListEntryType;
 
-  // Clear output transform parameters
+  // Clear output images and transform parameters
+  this->m_ResultImage = 0;
   this->m_TransformParametersList.clear();
+  this->m_ResultImages.clear();
+  this->m_TransformParametersLists.clear();
+
+  if( !movingMasks.empty() && movingMasks.size() != movingImages.size() )
+  {
+    if( performCout )
+    {
+      std::cerr << "ERROR: the number of moving masks does not match the number of moving images." << std::endl;
+    }
+    return 1;
+  }
 
   /** Some declarations and initialisations. */
   ElastixMainVectorType elastices;
@@ -262,22 +333,16 @@ ELASTIX::RegisterImages(
    *                                              *
    ************************************************************************/
 
-  /* Allocate and store images in containers */
-  fixedImageContainer                        = DataObjectContainerType::New();
-  movingImageContainer                       = DataObjectContainerType::New();
-  fixedImageContainer->CreateElementAt( 0 )  = fixedImage;
-  movingImageContainer->CreateElementAt( 0 ) = movingImage;
-
-  /* Allocate and store masks in containers if available*/
+  /* Allocate and store the fixed image and mask in containers, which are
+   * shared by all moving images. */
+  DataObjectContainerPointer batchFixedImageContainer = DataObjectContainerType::New();
+  DataObjectContainerPointer batchFixedMaskContainer  = 0;
+  FlatDirectionCosinesType   batchFixedImageOriginalDirection;
+  batchFixedImageContainer->CreateElementAt( 0 ) = fixedImage;
   if( fixedMask )
   {
-    fixedMaskContainer                       = DataObjectContainerType::New();
-    fixedMaskContainer->CreateElementAt( 0 ) = fixedMask;
-  }
-  if( movingMask )
-  {
-    movingMaskContainer                       = DataObjectContainerType::New();
-    movingMaskContainer->CreateElementAt( 0 ) = movingMask;
+    batchFixedMaskContainer                       = DataObjectContainerType::New();
+    batchFixedMaskContainer->CreateElementAt( 0 ) = fixedMask;
   }
 
   //todo original direction cosin, problem is that Image type is unknown at this in elastixlib.cxx
@@ -290,82 +355,141 @@ ELASTIX::RegisterImages(
    *                                                  *
    ************************************************************************/
 
-  for( i = 0; i < nrOfParameterFiles; i++ )
+  int batchReturn = 0;
+
+  /** The pairs share the fixed image pyramids, eroded fixed masks and
+   * fixed image extrema via the preprocessing cache. */
+  itk::FixedImagePreprocessingCache::Pointer preprocessingCache
+    = itk::FixedImagePreprocessingCache::GetInstance();
+  preprocessingCache->SetEnabled( movingImages.size() > 1 );
+
+  for( std::size_t b = 0; b < movingImages.size(); ++b )
   {
-    /** Create another instance of ElastixMain. */
-    elastices.push_back( ElastixMainType::New() );
-
-    /** Set stuff we get from a former registration. */
-    elastices[ i ]->SetInitialTransform( transform );
-    elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
-    elastices[ i ]->SetMovingImageContainer( movingImageContainer );
-    elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
-    elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
-    elastices[ i ]->SetResultImageContainer( resultImageContainer );
-    elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
-
-    /** Set the current elastix-level. */
-    elastices[ i ]->SetElastixLevel( i );
-    elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
-
-    /** Delete the previous ParameterFileName. */
-    if( argMap.count( "-p" ) )
+    if( movingImages.size() > 1 )
     {
-      argMap.erase( "-p" );
+      elxout << "=========================================================================" << "\n" << std::endl;
+      elxout << "Registering moving image " << b << " of the batch.\n" << std::endl;
     }
 
-    /** Print a start message. */
-    elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
-    elxout << "Running elastix with parameter map " << i << std::endl;
+    /* Start from the shared fixed image and mask, and no transform. */
+    transform                   = 0;
+    fixedImageContainer         = batchFixedImageContainer;
+    fixedMaskContainer          = batchFixedMaskContainer;
+    fixedImageOriginalDirection = batchFixedImageOriginalDirection;
+    resultImageContainer        = 0;
+    elastices.clear();
+
+    /* Allocate and store the moving image and mask in containers */
+    movingImageContainer                       = DataObjectContainerType::New();
+    movingImageContainer->CreateElementAt( 0 ) = movingImages[ b ];
+    movingMaskContainer                        = 0;
+    if( !movingMasks.empty() && movingMasks[ b ] )
+    {
+      movingMaskContainer                       = DataObjectContainerType::New();
+      movingMaskContainer->CreateElementAt( 0 ) = movingMasks[ b ];
+    }
 
-    /** Declare a timer, start it and print the start time. */
-    itk::TimeProbe timer;
-    timer.Start();
-    elxout << "Current time: " << GetCurrentDateAndTime() << "." << std::endl;
+    ParameterMapListType transformParametersList;
+    for( i = 0; i < nrOfParameterFiles; i++ )
+    {
+      /** Create another instance of ElastixMain. */
+      elastices.push_back( ElastixMainType::New() );
+
+      /** Set stuff we get from a former registration. */
+      elastices[ i ]->SetInitialTransform( transform );
+      elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
+      elastices[ i ]->SetMovingImageContainer( movingImageContainer );
+      elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
+      elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
+      elastices[ i ]->SetResultImageContainer( resultImageContainer );
+      elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+
+      /** Set the current elastix-level. */
+      elastices[ i ]->SetElastixLevel( i );
+      elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
+
+      /** Delete the previous ParameterFileName. */
+      if( argMap.count( "-p" ) )
+      {
+        argMap.erase( "-p" );
+      }
 
-    /** Start registration. */
-    returndummy = elastices[ i ]->Run( argMap, parameterMaps[ i ] );
+      /** Print a start message. */
+      elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
+      elxout << "Running elastix with parameter map " << i << std::endl;
 
-    /** Check for errors. */
-    if( returndummy != 0 )
+      /** Declare a timer, start it and print the start time. */
+      itk::TimeProbe timer;
+      timer.Start();
+      elxout << "Current time: " << GetCurrentDateAndTime() << "." << std::endl;
+
+      /** Start registration. */
+      returndummy = elastices[ i ]->Run( argMap, parameterMaps[ i ] );
+
+      /** Check for errors. */
+      if( returndummy != 0 )
+      {
+        xl::xout[ "error" ] << "Errors occurred!" << std::endl;
+        batchReturn = returndummy;
+        break;
+      }
+
+      /** Get the transform, the fixedImage and the movingImage
+       * in order to put it in the (possibly) next registration.
+       */
+      transform                   = elastices[ i ]->GetFinalTransform();
+      fixedImageContainer         = elastices[ i ]->GetFixedImageContainer();
+      movingImageContainer        = elastices[ i ]->GetMovingImageContainer();
+      fixedMaskContainer          = elastices[ i ]->GetFixedMaskContainer();
+      movingMaskContainer         = elastices[ i ]->GetMovingMaskContainer();
+      resultImageContainer        = elastices[ i ]->GetResultImageContainer();
+      fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
+
+      /** Keep the fixed image direction for the next moving images. */
+      if( b == 0 && i == 0 )
+      {
+        batchFixedImageOriginalDirection = fixedImageOriginalDirection;
+      }
+
+      /** Stop timer and print it. */
+      timer.Stop();
+      elxout << "\nCurrent time: " << GetCurrentDateAndTime() << "." << std::endl;
+      elxout << "Time used for running elastix with this parameter file: "
+             << ConvertSecondsToDHMS( timer.GetMean(), 1 ) << ".\n" << std::endl;
+
+      /** Get the transformation parameter map. */
+      transformParametersList.push_back( elastices[ i ]->GetTransformParametersMap() );
+
+      /** Set initial transform to an index number instead of a parameter filename. */
+      if( i > 0 )
+      {
+        std::stringstream toString;
+        toString << ( i - 1 );
+        transformParametersList[ i ][ "InitialTransformParametersFileName" ][ 0 ]
+          = toString.str();
+      }
+
+      /** Try to release some memory. */
+      elastices[ i ] = 0;
+
+    } // end loop over registrations
+
+    /* Store the result image and the transform parameters, if successful. */
+    if( returndummy == 0 && resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 )
     {
-      xl::xout[ "error" ] << "Errors occurred!" << std::endl;
-      return returndummy;
+      this->m_ResultImages.push_back( resultImageContainer->ElementAt( 0 ) );
     }
-
-    /** Get the transform, the fixedImage and the movingImage
-     * in order to put it in the (possibly) next registration.
-     */
-    transform                   = elastices[ i ]->GetFinalTransform();
-    fixedImageContainer         = elastices[ i ]->GetFixedImageContainer();
-    movingImageContainer        = elastices[ i ]->GetMovingImageContainer();
-    fixedMaskContainer          = elastices[ i ]->GetFixedMaskContainer();
-    movingMaskContainer         = elastices[ i ]->GetMovingMaskContainer();
-    resultImageContainer        = elastices[ i ]->GetResultImageContainer();
-    fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
-
-    /** Stop timer and print it. */
-    timer.Stop();
-    elxout << "\nCurrent time: " << GetCurrentDateAndTime() << "." << std::endl;
-    elxout << "Time used for running elastix with this parameter file: "
-           << ConvertSecondsToDHMS( timer.GetMean(), 1 ) << ".\n" << std::endl;
-
-    /** Get the transformation parameter map. */
-    this->m_TransformParametersList.push_back( elastices[ i ]->GetTransformParametersMap() );
-
-    /** Set initial transform to an index number instead of a parameter filename. */
-    if( i > 0 )
+    else
     {
-      std::stringstream toString;
-      toString << ( i - 1 );
-      this->m_TransformParametersList[ i ][ "InitialTransformParametersFileName" ][ 0 ]
-        = toString.str();
+      this->m_ResultImages.push_back( 0 );
     }
+    if( returndummy != 0 )
+    {
+      transformParametersList.clear();
+    }
+    this->m_TransformParametersLists.push_back( transformParametersList );
 
-    /** Try to release some memory. */
-    elastices[ i ] = 0;
-
-  } // end loop over registrations
+  } // end loop over moving images
 
   elxout << "-------------------------------------------------------------------------"
          << "\n" << std::endl;
@@ -385,31 +509,27 @@ ELASTIX::RegisterImages(
    *  Make sure all the components that are defined in a Module (.DLL/.so)
    *  are deleted before the modules are closed.
    */
-  for( i = 0; i < nrOfParameterFiles; i++ )
-  {
-    elastices[ i ] = 0;
-  }
+  elastices.clear();
 
-  /* Set result image for output */
-  if( resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 )
-  {
-    this->m_ResultImage = resultImageContainer->ElementAt( 0 );
-  }
+  transform                = 0;
+  fixedImageContainer      = 0;
+  movingImageContainer     = 0;
+  fixedMaskContainer       = 0;
+  movingMaskContainer      = 0;
+  resultImageContainer     = 0;
+  batchFixedImageContainer = 0;
+  batchFixedMaskContainer  = 0;
 
-  transform            = 0;
-  fixedImageContainer  = 0;
-  movingImageContainer = 0;
-  fixedMaskContainer   = 0;
-  movingMaskContainer  = 0;
-  resultImageContainer = 0;
+  preprocessingCache->Clear();
+  preprocessingCache->SetEnabled( false );
 
   /** Close the modules. */
   ElastixMainType::UnloadComponents();
 
   /** Exit and return the error code. */
-  return 0;
+  return batchReturn;
 
-} // end RegisterImages()
+} // end RegisterImageBatch()
 
 
 /** ConvertSecondsToDHMS
@@ -39,8 +39,9 @@ class ELASTIXLIB_API ELASTIX
 public:
 
   //typedefs for images
-  typedef itk::DataObject Image;
-  typedef Image::Pointer  ImagePointer;
+  typedef itk::DataObject              Image;
+  typedef Image::Pointer               ImagePointer;
+  typedef std::vector< ImagePointer >  ImageListType;
 
   //typedefs for parameter map
   typedef itk::ParameterFileParser::ParameterValuesType             ParameterValuesType;
@@ -96,15 +97,43 @@ public:
     ImagePointer fixedMask = 0,
     ImagePointer movingMask = 0 );
 
+  /**
+   *  Register many moving images to the same fixed image in one call, for
+   *  example an atlas that is registered to many subjects. The components
+   *  are loaded only once, and the fixed image and mask are shared by all
+   *  registrations. The other arguments are as for RegisterImages();
+   *  movingMasks is either empty, or holds a (possibly 0) mask for every
+   *  moving image. Files written to the outputPath are overwritten by the
+   *  next registration. A failing registration does not stop the others;
+   *  its result image is then 0, and its list of transform parameters empty.
+   *  return value: 0 if all registrations succeeded, otherwise the error
+   *    code of the last failing registration, see RegisterImages().
+   */
+  int RegisterImageBatch( ImagePointer fixedImage,
+    const ImageListType & movingImages,
+    std::vector< ParameterMapType > & parameterMaps,
+    std::string outputPath,
+    bool performLogging,
+    bool performCout,
+    ImagePointer fixedMask = 0,
+    const ImageListType & movingMasks = ImageListType() );
+
   /** Getter for result image. */
   ImagePointer GetResultImage( void );
 
+  /** Getter for the result image of moving image index of the last batch. */
+  ImagePointer GetResultImage( const unsigned int index );
+
   /** Get transform parameters of last registration step. */
   ParameterMapType GetTransformParameterMap( void );
 
   /** Get transform parameters of all registration steps. */
   ParameterMapListType GetTransformParameterMapList( void );
 
+  /** Get transform parameters of all registration steps of moving image
+   * index of the last batch. */
+  ParameterMapListType GetTransformParameterMapList( const unsigned int index );
+
   std::string ConvertSecondsToDHMS( const double totalSeconds, const unsigned int precision = 0 );
 
   std::string GetCurrentDateAndTime( void );
@@ -117,6 +146,10 @@ private:
   /* Final transformation*/
   ParameterMapListType m_TransformParametersList;
 
+  /* The result images and final transformations of the last batch. */
+  ImageListType                       m_ResultImages;
+  std::vector< ParameterMapListType > m_TransformParametersLists;
+
 };
 
 // end class ELASTIX
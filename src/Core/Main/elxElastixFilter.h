@@ -23,6 +23,8 @@
 #include "elxElastixMain.h"
 #include "elxParameterObject.h"
 #include "elxPixelType.h"
+#include "itkFixedImagePreprocessingCache.h"
+#include "itkExternalImageBuffer.h"
 
 /**
  * \class ElastixFilter
@@ -80,6 +82,10 @@ public:
   itkStaticConstMacro( FixedImageDimension, unsigned int, TFixedImage::ImageDimension );
   itkStaticConstMacro( MovingImageDimension, unsigned int, TMovingImage::ImageDimension );
 
+  typedef itk::ExternalImageBuffer< TFixedImage >            FixedImageBufferType;
+  typedef itk::ExternalImageBuffer< TMovingImage >           MovingImageBufferType;
+  typedef typename FixedImageBufferType::ReleaseCallbackType ReleaseCallbackType;
+
   typedef itk::Image< unsigned char, FixedImageDimension >  FixedMaskType;
   typedef typename FixedMaskType::Pointer                   FixedMaskPointer;
   typedef typename FixedMaskType::Pointer                   FixedMaskConstPointer;
@@ -101,6 +107,34 @@ public:
   MovingImageConstPointer GetMovingImage( const unsigned int index ) const;
   unsigned int GetNumberOfMovingImages( void ) const;
 
+  /** Set the fixed/moving image to a pixel buffer owned by the caller,
+   * without copying it; see itk::ExternalImageBuffer. The release callback,
+   * if given, is called with the client data when neither the filter nor
+   * elastix uses the buffer anymore. For multiple images, pass the result
+   * of FixedImageBufferType::Import() to AddFixedImage().
+   */
+  void SetFixedImageBuffer( typename TFixedImage::PixelType * buffer,
+    const typename TFixedImage::SizeType & size,
+    const typename TFixedImage::SpacingType & spacing,
+    const typename TFixedImage::PointType & origin,
+    const typename TFixedImage::DirectionType & direction,
+    ReleaseCallbackType releaseCallback = 0, void * clientData = 0 )
+  {
+    this->SetFixedImage( FixedImageBufferType::Import( buffer, size,
+      spacing, origin, direction, releaseCallback, clientData ) );
+  }
+
+  void SetMovingImageBuffer( typename TMovingImage::PixelType * buffer,
+    const typename TMovingImage::SizeType & size,
+    const typename TMovingImage::SpacingType & spacing,
+    const typename TMovingImage::PointType & origin,
+    const typename TMovingImage::DirectionType & direction,
+    ReleaseCallbackType releaseCallback = 0, void * clientData = 0 )
+  {
+    this->SetMovingImage( MovingImageBufferType::Import( buffer, size,
+      spacing, origin, direction, releaseCallback, clientData ) );
+  }
+
   /** Set/Add/Get/Remove/NumberOf fixed masks. */
   virtual void AddFixedMask( FixedMaskType * fixedMask );
   virtual void SetFixedMask( FixedMaskType * fixedMask );
@@ -126,6 +160,12 @@ public:
   ParameterObjectType * GetTransformParameterObject( void );
   const ParameterObjectType * GetTransformParameterObject( void ) const;
 
+  /** Get the final transform of the last registration. It can be passed to
+   * TransformixFilter::SetTransform() to apply it without reading the
+   * transform parameter object. Only valid after Update().
+   */
+  itk::Object * GetFinalTransform( void ) const { return this->m_FinalTransform.GetPointer(); }
+
   /** Set/Get/Remove initial transform parameter filename. */
   itkSetMacro( InitialTransformParameterFileName, std::string );
   itkGetMacro( InitialTransformParameterFileName, std::string );
@@ -162,6 +202,31 @@ public:
   itkGetConstReferenceMacro( LogToFile, bool );
   itkBooleanMacro( LogToFile );
 
+  /** Share the fixed image pyramids, eroded fixed masks and fixed image
+   * extrema between the updates of this filter, and of other filters with
+   * the same fixed image, via the itk::FixedImagePreprocessingCache. Useful
+   * when one fixed image is registered to many moving images. Off by default.
+   */
+  itkSetMacro( UseFixedImagePreprocessingCache, bool );
+  itkGetConstReferenceMacro( UseFixedImagePreprocessingCache, bool );
+  itkBooleanMacro( UseFixedImagePreprocessingCache );
+
+  /** Set/Get the object that receives the resolution, iteration and metric
+   * value after every iteration, and through which the registration can be
+   * cancelled from another thread. A cancelled Update() throws an
+   * itk::ProcessAborted exception. Default: 0, none.
+   */
+  itkSetObjectMacro( RegistrationProgress, itk::RegistrationProgress );
+  itkGetObjectMacro( RegistrationProgress, itk::RegistrationProgress );
+
+  /** Releases the cached fixed image preprocessing results, and the fixed
+   * images they belong to. */
+  static void ClearFixedImagePreprocessingCache( void )
+  {
+    itk::FixedImagePreprocessingCache::GetInstance()->Clear();
+  }
+
+
 protected:
 
   ElastixFilter( void );
@@ -198,6 +263,12 @@ private:
   bool m_LogToConsole;
   bool m_LogToFile;
 
+  bool m_UseFixedImagePreprocessingCache;
+
+  itk::RegistrationProgress::Pointer m_RegistrationProgress;
+
+  ElastixMainObjectPointer m_FinalTransform;
+
   unsigned int m_InputUID;
 
 };
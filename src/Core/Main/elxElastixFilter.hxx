@@ -46,6 +46,12 @@ ElastixFilter< TFixedImage, TMovingImage >
   this->m_LogToConsole = false;
   this->m_LogToFile    = false;
 
+  this->m_UseFixedImagePreprocessingCache = false;
+
+  this->m_RegistrationProgress = 0;
+
+  this->m_FinalTransform = 0;
+
   ParameterObjectPointer defaultParameterObject = ParameterObject::New();
   defaultParameterObject->AddParameterMap( ParameterObject::GetDefaultParameterMap( "translation" ) );
   defaultParameterObject->AddParameterMap( ParameterObject::GetDefaultParameterMap( "affine" ) );
@@ -159,6 +165,16 @@ ElastixFilter< TFixedImage, TMovingImage >
 
     // There must be an "-out" as this is checked later in the code
     argumentMap.insert( ArgumentMapEntryType( "-out", "output_path_not_set" ) );
+
+    // Without an output directory the transform parameters are only kept in
+    // memory, unless the user explicitly asks for the files
+    for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
+    {
+      if( parameterMapVector[ i ].count( "WriteFinalTransformParameters" ) == 0 )
+      {
+        parameterMapVector[ i ][ "WriteFinalTransformParameters" ] = ParameterValueVectorType( 1, "false" );
+      }
+    }
   }
   else
   {
@@ -196,6 +212,10 @@ ElastixFilter< TFixedImage, TMovingImage >
     itkExceptionMacro( "Error while setting up xout" );
   }
 
+  // Share the fixed image preprocessing with previous updates, if requested
+  itk::FixedImagePreprocessingCache::GetInstance()->SetEnabled(
+    this->GetUseFixedImagePreprocessingCache() );
+
   // Run the (possibly multiple) registration(s)
   for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
   {
@@ -223,6 +243,7 @@ ElastixFilter< TFixedImage, TMovingImage >
     elastix->SetMovingMaskContainer( movingMaskContainer );
     elastix->SetResultImageContainer( resultImageContainer );
     elastix->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+    elastix->SetRegistrationProgress( this->m_RegistrationProgress );
 
     // Start registration
     unsigned int isError = 0;
@@ -235,6 +256,14 @@ ElastixFilter< TFixedImage, TMovingImage >
       itkExceptionMacro( << "Errors occurred during registration: " << e.what() );
     }
 
+    // Report a cancellation as such, rather than as an error
+    if( this->m_RegistrationProgress && this->m_RegistrationProgress->GetCancelRequested() )
+    {
+      itk::ProcessAborted e( __FILE__, __LINE__ );
+      e.SetDescription( "The registration was cancelled." );
+      throw e;
+    }
+
     if( isError != 0 )
     {
       itkExceptionMacro( << "Internal elastix error: See elastix log (use LogToConsoleOn() or LogToFileOn())." );
@@ -274,9 +303,12 @@ ElastixFilter< TFixedImage, TMovingImage >
     itkExceptionMacro( "Errors occured during registration: Could not read result image." );
   }
 
-  // Save parameter map
+  // Keep the live transform, so that it can be passed to the TransformixFilter
+  this->m_FinalTransform = transform;
+
+  // Save parameter map, without copying it
   ParameterObject::Pointer transformParameterObject = ParameterObject::New();
-  transformParameterObject->SetParameterMap( transformParameterMapVector );
+  transformParameterObject->TakeParameterMap( transformParameterMapVector );
   this->SetOutput( "TransformParameterObject", transformParameterObject );
 }
 
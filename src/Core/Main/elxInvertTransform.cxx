@@ -0,0 +1,786 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkCommandLineArgumentParser.h"
+#include "itkParameterFileParser.h"
+#include "itkParameterMapInterface.h"
+
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkVector.h"
+
+// Supported transforms:
+#include "itkTransform.h"
+#include "itkEulerTransform.h"
+//#include "itkEuler3DTransform.h"
+#include "itkAffineTransform.h"
+
+// Supported forward transforms of the iterative inversion:
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedEuler3DTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkDeformationFieldInterpolatingTransform.h"
+#include "itkVectorNearestNeighborInterpolateImageFunction.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+#include "itkTransformToInverseDisplacementFieldSource.h"
+
+#include <iostream>
+#include <iomanip>
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "elxInvertTransform" << std::endl
+     << "  -tp    transform parameters file to be inverted\n"
+     << "  -out   output inverted transform parameters filename\n"
+     << "  -m     moving image file name\n"
+     << "  [-df]  output inverse deformation field, default deformationFieldInverse.mhd\n"
+     << "         in the directory of the output transform parameters file\n"
+     << "  [-levels]      number of resolution levels of the inversion, default 3\n"
+     << "  [-iterations]  maximum number of fixed point iterations, default 20\n"
+     << "  [-tolerance]   maximum residual in physical units, default 1e-3\n"
+     << "Currently only 3D is supported. A single {Euler, Affine} transform is\n"
+     << "inverted analytically. Other transforms, i.e. {BSpline, RecursiveBSpline,\n"
+     << "DeformationField} and concatenations with {Euler, Affine}, are inverted\n"
+     << "numerically on the grid of the moving image, resulting in a\n"
+     << "DeformationFieldTransform.";
+  return ss.str();
+
+} // end GetHelpString()
+
+
+/** Typedef's for the iterative inversion. */
+const unsigned int Dimension = 3;
+typedef itk::AdvancedTransform< double, Dimension, Dimension > ForwardTransformType;
+typedef ForwardTransformType::Pointer                         ForwardTransformPointer;
+
+
+/**
+ * ******************* WriteImageSpecific *******************
+ *
+ * Writes the image specific part of the inverted transform parameters file,
+ * i.e. the domain of the moving image.
+ * The following is a modified copy of part of elx::TransformBase::WriteToFile().
+ */
+
+void
+WriteImageSpecific( std::ofstream & outputTPFile,
+  const itk::ParameterMapInterface * config,
+  const itk::ImageIOBase * imageIOBase )
+{
+  std::string dummyErrorMessage = "";
+
+  unsigned int FixDim = Dimension;
+  config->ReadParameter( FixDim, "FixedImageDimension", 0, dummyErrorMessage );
+  unsigned int MovDim = Dimension;
+  config->ReadParameter( MovDim, "MovingImageDimension", 0, dummyErrorMessage );
+
+  std::string fixpix = "float";
+  config->ReadParameter( fixpix, "FixedInternalImagePixelType", 0, dummyErrorMessage );
+  std::string movpix = "float";
+  config->ReadParameter( movpix, "MovingInternalImagePixelType", 0, dummyErrorMessage );
+
+  std::string useDirectionCosines = "true";
+  config->ReadParameter( useDirectionCosines, "UseDirectionCosines", 0, dummyErrorMessage );
+
+  /** Write image specific things. */
+  outputTPFile << std::endl << "// Image specific" << std::endl;
+
+  /** Write image dimensions. */
+  outputTPFile << "(FixedImageDimension "
+               << FixDim << ")" << std::endl;
+  outputTPFile << "(MovingImageDimension "
+               << MovDim << ")" << std::endl;
+
+  /** Write image pixel types. */
+  outputTPFile << "(FixedInternalImagePixelType \""
+               << fixpix << "\")" << std::endl;
+  outputTPFile << "(MovingInternalImagePixelType \""
+               << movpix << "\")" << std::endl;
+
+  /** Get the Size, Spacing and Origin of the moving image. */
+
+  /** Write image Size. */
+  outputTPFile << "(Size ";
+  for( unsigned int i = 0; i < MovDim - 1; i++ )
+  {
+    outputTPFile << imageIOBase->GetDimensions( i ) << " ";
+  }
+  outputTPFile << imageIOBase->GetDimensions( MovDim - 1 ) << ")" << std::endl;
+
+  /** Write image Index. */
+  outputTPFile << "(Index";
+  for( unsigned int i = 0; i < MovDim; i++ )
+  {
+    outputTPFile << " 0";
+  }
+  outputTPFile << ")" << std::endl;
+
+  /** Set the precision of cout to 10, because Spacing and
+   * Origin must have at least one digit precision.
+   */
+  outputTPFile << std::setprecision( 10 );
+
+  /** Write image Spacing. */
+  outputTPFile << "(Spacing ";
+  for( unsigned int i = 0; i < MovDim - 1; i++ )
+  {
+    outputTPFile << imageIOBase->GetSpacing( i ) << " ";
+  }
+  outputTPFile << imageIOBase->GetSpacing( MovDim - 1 ) << ")" << std::endl;
+
+  /** Write image Origin. */
+  outputTPFile << "(Origin ";
+  for( unsigned int i = 0; i < MovDim - 1; i++ )
+  {
+    outputTPFile << imageIOBase->GetOrigin( i ) << " ";
+  }
+  outputTPFile << imageIOBase->GetOrigin( MovDim - 1 ) << ")" << std::endl;
+
+  /** Write direction cosines. */
+  outputTPFile << "(Direction";
+  for( unsigned int i = 0; i < MovDim; i++ )
+  {
+    for( unsigned int j = 0; j < MovDim; j++ )
+    {
+      outputTPFile << " " << imageIOBase->GetDirection( i )[ j ];
+    }
+  }
+  outputTPFile << ")" << std::endl;
+
+  /** Set the precision back to default value. */
+  outputTPFile << std::setprecision( 6 );
+
+  /** Write whether the direction cosines should be taken into account.
+   * This parameter is written from elastix 4.203.
+   */
+  outputTPFile << "(UseDirectionCosines \""
+               << useDirectionCosines << "\")" << std::endl;
+
+} // end WriteImageSpecific()
+
+
+/**
+ * ******************* WriteResamplerSpecific *******************
+ *
+ * Copies the resample interpolator and resampler settings of the input
+ * transform parameters file.
+ */
+
+void
+WriteResamplerSpecific( std::ofstream & outputTPFile,
+  const itk::ParameterMapInterface * config )
+{
+  std::string dummyErrorMessage = "";
+
+  std::string resampleInterpolator = "FinalBSplineInterpolator";
+  config->ReadParameter( resampleInterpolator, "ResampleInterpolator", 0, dummyErrorMessage );
+
+  unsigned int interpolationOrder = 3;
+  config->ReadParameter( interpolationOrder, "FinalBSplineInterpolationOrder", 0, dummyErrorMessage );
+
+  std::string resampler = "DefaultResampler";
+  config->ReadParameter( resampler, "DefaultResampler", 0, dummyErrorMessage );
+
+  float defaultPixelValue = 0.0;
+  config->ReadParameter( defaultPixelValue, "DefaultPixelValue", 0, dummyErrorMessage );
+
+  std::string resultImageFormat = "mhd";
+  config->ReadParameter( resultImageFormat, "ResultImageFormat", 0, dummyErrorMessage );
+
+  std::string resultImagePixelType = "short";
+  config->ReadParameter( resultImagePixelType, "ResultImagePixelType", 0, dummyErrorMessage );
+
+  std::string compressResultImage = "false";
+  config->ReadParameter( compressResultImage, "CompressResultImage", 0, dummyErrorMessage );
+
+  outputTPFile << "\n// ResampleInterpolator specific\n";
+  outputTPFile << "(ResampleInterpolator \"" << resampleInterpolator << "\")\n";
+  outputTPFile << "(FinalBSplineInterpolationOrder " << interpolationOrder << ")\n"; // assuming B-spline here
+
+  outputTPFile << "\n// Resampler specific\n";
+  outputTPFile << "(Resampler \"" << resampler << "\")\n";
+  outputTPFile << "(DefaultPixelValue " << defaultPixelValue << ")\n";
+  outputTPFile << "(ResultImageFormat \"" << resultImageFormat << "\")\n";
+  outputTPFile << "(ResultImagePixelType \"" << resultImagePixelType << "\")\n";
+  outputTPFile << "(CompressResultImage \"" << compressResultImage << "\")\n";
+
+} // end WriteResamplerSpecific()
+
+
+/**
+ * ******************* ReadForwardTransform *******************
+ *
+ * Reads a transform parameter file, and all its initial transforms,
+ * into a forward transform that can be evaluated in any point.
+ * Returns 0 when the transform is not supported.
+ */
+
+ForwardTransformPointer
+ReadForwardTransform( const std::string & fileName )
+{
+  typedef itk::ParameterFileParser   ParserType;
+  typedef itk::ParameterMapInterface InterfaceType;
+  typedef ForwardTransformType::ParametersType ParametersType;
+  ParserType::Pointer    parser = ParserType::New();
+  InterfaceType::Pointer config = InterfaceType::New();
+  parser->SetParameterFileName( fileName );
+  parser->ReadParameterFile();
+  config->SetParameterMap( parser->GetParameterMap() );
+  std::string dummyErrorMessage = "";
+
+  std::string transformType = "";
+  config->ReadParameter( transformType, "Transform", 0, dummyErrorMessage );
+
+  /** Read the TransformParameters. */
+  unsigned int numberOfParameters = 0;
+  config->ReadParameter( numberOfParameters, "NumberOfParameters", 0, dummyErrorMessage );
+  ParametersType transformParameters( numberOfParameters );
+  transformParameters.Fill( 0.0 );
+  if( numberOfParameters > 0 )
+  {
+    std::vector< double > vecPar( numberOfParameters, 0.0 );
+    config->ReadParameter( vecPar, "TransformParameters",
+      0, numberOfParameters - 1, true, dummyErrorMessage );
+    for( unsigned int i = 0; i < numberOfParameters; i++ )
+    {
+      transformParameters[ i ] = vecPar[ i ];
+    }
+  }
+
+  /** Read the center of rotation. */
+  itk::Point< double, Dimension > center;
+  center.Fill( 0.0 );
+  for( unsigned int i = 0; i < Dimension; i++ )
+  {
+    config->ReadParameter( center[ i ], "CenterOfRotationPoint", i, dummyErrorMessage );
+  }
+
+  ForwardTransformPointer current = 0;
+  if( transformType == "EulerTransform" )
+  {
+    typedef itk::AdvancedEuler3DTransform< double > EulerType;
+    EulerType::Pointer euler = EulerType::New();
+    std::string computeZYX = "false";
+    config->ReadParameter( computeZYX, "ComputeZYX", 0, dummyErrorMessage );
+    euler->SetComputeZYX( computeZYX == "true" );
+    euler->SetCenter( center );
+    euler->SetParametersByValue( transformParameters );
+    current = euler.GetPointer();
+  }
+  else if( transformType == "AffineTransform" )
+  {
+    typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension > AffineType;
+    AffineType::Pointer affine = AffineType::New();
+    affine->SetCenter( center );
+    affine->SetParametersByValue( transformParameters );
+    current = affine.GetPointer();
+  }
+  else if( transformType == "BSplineTransform" || transformType == "RecursiveBSplineTransform" )
+  {
+    unsigned int splineOrder = 3;
+    config->ReadParameter( splineOrder, "BSplineTransformSplineOrder", 0, dummyErrorMessage );
+    std::string cyclic = "false";
+    config->ReadParameter( cyclic, "UseCyclicTransform", 0, dummyErrorMessage );
+    if( cyclic == "true" )
+    {
+      std::cerr << "ERROR: cyclic B-spline transforms are not supported." << std::endl;
+      return 0;
+    }
+
+    typedef itk::AdvancedBSplineDeformableTransformBase< double, Dimension > BSplineBaseType;
+    BSplineBaseType::Pointer bspline = 0;
+    if( splineOrder == 1 )
+    {
+      bspline = itk::AdvancedBSplineDeformableTransform< double, Dimension, 1 >::New().GetPointer();
+    }
+    else if( splineOrder == 2 )
+    {
+      bspline = itk::AdvancedBSplineDeformableTransform< double, Dimension, 2 >::New().GetPointer();
+    }
+    else if( splineOrder == 3 )
+    {
+      bspline = itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >::New().GetPointer();
+    }
+    else
+    {
+      std::cerr << "ERROR: B-spline order " << splineOrder << " is not supported." << std::endl;
+      return 0;
+    }
+
+    /** Read and set the grid. */
+    BSplineBaseType::RegionType    gridregion;
+    BSplineBaseType::SizeType      gridsize;
+    BSplineBaseType::IndexType     gridindex;
+    BSplineBaseType::SpacingType   gridspacing;
+    BSplineBaseType::OriginType    gridorigin;
+    BSplineBaseType::DirectionType griddirection;
+    gridsize.Fill( 1 );
+    gridindex.Fill( 0 );
+    gridspacing.Fill( 1.0 );
+    gridorigin.Fill( 0.0 );
+    griddirection.SetIdentity();
+    for( unsigned int i = 0; i < Dimension; i++ )
+    {
+      config->ReadParameter( gridsize[ i ], "GridSize", i, dummyErrorMessage );
+      config->ReadParameter( gridindex[ i ], "GridIndex", i, dummyErrorMessage );
+      config->ReadParameter( gridspacing[ i ], "GridSpacing", i, dummyErrorMessage );
+      config->ReadParameter( gridorigin[ i ], "GridOrigin", i, dummyErrorMessage );
+      for( unsigned int j = 0; j < Dimension; j++ )
+      {
+        config->ReadParameter( griddirection( j, i ),
+          "GridDirection", i * Dimension + j, dummyErrorMessage );
+      }
+    }
+    gridregion.SetIndex( gridindex );
+    gridregion.SetSize( gridsize );
+    bspline->SetGridRegion( gridregion );
+    bspline->SetGridSpacing( gridspacing );
+    bspline->SetGridOrigin( gridorigin );
+    bspline->SetGridDirection( griddirection );
+    bspline->SetParametersByValue( transformParameters );
+    current = bspline.GetPointer();
+  }
+  else if( transformType == "DeformationFieldTransform" )
+  {
+    typedef itk::DeformationFieldInterpolatingTransform< double, Dimension, double > DFTransformType;
+    typedef DFTransformType::DeformationFieldType                                    DeformationFieldType;
+    typedef itk::ImageFileReader< DeformationFieldType >                             VectorReaderType;
+    typedef itk::VectorNearestNeighborInterpolateImageFunction<
+      DeformationFieldType, double >                                                 NNInterpolatorType;
+    typedef itk::VectorLinearInterpolateImageFunction<
+      DeformationFieldType, double >                                                 LinInterpolatorType;
+
+    std::string deformationFieldFileName = "";
+    config->ReadParameter( deformationFieldFileName, "DeformationFieldFileName", 0, dummyErrorMessage );
+    VectorReaderType::Pointer vectorReader = VectorReaderType::New();
+    vectorReader->SetFileName( deformationFieldFileName );
+    vectorReader->Update();
+
+    DFTransformType::Pointer dfTransform = DFTransformType::New();
+    dfTransform->SetDeformationField( vectorReader->GetOutput() );
+    unsigned int interpolationOrder = 0;
+    config->ReadParameter( interpolationOrder, "DeformationFieldInterpolationOrder", 0, dummyErrorMessage );
+    if( interpolationOrder == 0 )
+    {
+      dfTransform->SetDeformationFieldInterpolator( NNInterpolatorType::New() );
+    }
+    else
+    {
+      dfTransform->SetDeformationFieldInterpolator( LinInterpolatorType::New() );
+    }
+    current = dfTransform.GetPointer();
+  }
+  else
+  {
+    std::cerr << "ERROR: Transforms of the type "
+              << transformType
+              << " are not supported." << std::endl;
+    return 0;
+  }
+
+  /** Combine with the initial transform, if any. */
+  std::string initialTransform = "NoInitialTransform";
+  config->ReadParameter( initialTransform, "InitialTransformParametersFileName", 0, dummyErrorMessage );
+  if( initialTransform == "NoInitialTransform" )
+  {
+    return current;
+  }
+
+  ForwardTransformPointer initial = ReadForwardTransform( initialTransform );
+  if( initial.IsNull() )
+  {
+    return 0;
+  }
+
+  std::string combinationMethod = "Compose";
+  config->ReadParameter( combinationMethod, "HowToCombineTransforms", 0, dummyErrorMessage );
+
+  typedef itk::AdvancedCombinationTransform< double, Dimension > CombinationTransformType;
+  CombinationTransformType::Pointer combination = CombinationTransformType::New();
+  combination->SetCurrentTransform( current );
+  combination->SetInitialTransform( initial );
+  if( combinationMethod == "Compose" )
+  {
+    combination->SetUseComposition( true );
+  }
+  else
+  {
+    combination->SetUseAddition( true );
+  }
+  return combination.GetPointer();
+
+} // end ReadForwardTransform()
+
+
+/**
+ * ******************* InvertNumerically *******************
+ *
+ * Inverts the (concatenated) transform on the grid of the moving image,
+ * with a multi-resolution fixed point iteration. The inverse is written as
+ * a deformation field, together with a transform parameters file of a
+ * DeformationFieldTransform that refers to it.
+ */
+
+int
+InvertNumerically( const std::string & inputTransformParametersName,
+  const std::string & outputTransformParametersName,
+  const std::string & deformationFieldInverseName,
+  const itk::ParameterMapInterface * config,
+  const itk::ImageBase< Dimension > * movingImage,
+  const itk::ImageIOBase * imageIOBase,
+  const unsigned int numberOfLevels,
+  const unsigned int maximumNumberOfIterations,
+  const double tolerance )
+{
+  typedef itk::Vector< float, Dimension >             VectorPixelType;
+  typedef itk::Image< VectorPixelType, Dimension >    DeformationFieldType;
+  typedef itk::TransformToInverseDisplacementFieldSource<
+    DeformationFieldType, double >                    InverseSourceType;
+  typedef itk::ImageFileWriter< DeformationFieldType > WriterType;
+
+  std::string dummyErrorMessage = "";
+
+  /** Set up the forward transform and compute its inverse. */
+  InverseSourceType::Pointer inverseSource = InverseSourceType::New();
+  WriterType::Pointer        writer        = WriterType::New();
+  try
+  {
+    ForwardTransformPointer forwardTransform = ReadForwardTransform( inputTransformParametersName );
+    if( forwardTransform.IsNull() )
+    {
+      return EXIT_FAILURE;
+    }
+
+    inverseSource->SetTransform( forwardTransform );
+    inverseSource->SetOutputParametersFromImage( movingImage );
+    inverseSource->SetNumberOfLevels( numberOfLevels );
+    inverseSource->SetMaximumNumberOfIterations( maximumNumberOfIterations );
+    inverseSource->SetTolerance( tolerance );
+
+    writer->SetInput( inverseSource->GetOutput() );
+    writer->SetFileName( deformationFieldInverseName );
+    writer->Update();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "The inverse is computed with a maximum residual of "
+            << inverseSource->GetMaximumResidual() << std::endl;
+  if( inverseSource->GetNumberOfUnconvergedPoints() > 0 )
+  {
+    std::cout << "WARNING: the inversion did not converge in "
+              << inverseSource->GetNumberOfUnconvergedPoints()
+              << " points. Consider more iterations or a larger tolerance." << std::endl;
+  }
+
+  /** Write the inverted transform to file, in elastix style. */
+  std::ofstream outputTPFile( outputTransformParametersName.c_str() );
+  outputTPFile << "(Transform \"DeformationFieldTransform\")" << std::endl;
+  outputTPFile << "(NumberOfParameters 0)" << std::endl;
+  outputTPFile << "(InitialTransformParametersFileName \"NoInitialTransform\")" << std::endl;
+  outputTPFile << "(HowToCombineTransforms \"Compose\")" << std::endl;
+
+  /** Write image specific things. */
+  WriteImageSpecific( outputTPFile, config, imageIOBase );
+
+  outputTPFile << "\n// DeformationFieldTransform specific\n";
+  outputTPFile << "(DeformationFieldFileName \"" << deformationFieldInverseName << "\")\n";
+  outputTPFile << "(DeformationFieldInterpolationOrder 1)\n";
+
+  WriteResamplerSpecific( outputTPFile, config );
+
+  outputTPFile.close();
+
+  return EXIT_SUCCESS;
+
+} // end InvertNumerically()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Read the command line arguments. */
+  itk::CommandLineArgumentParser::Pointer clParser = itk::CommandLineArgumentParser::New();
+  clParser->SetCommandLineArguments( argc, argv );
+  clParser->SetProgramHelpText( GetHelpString() );
+
+  clParser->MarkArgumentAsRequired( "-tp", "The input transform parameter file." );
+  clParser->MarkArgumentAsRequired( "-out", "The output transform parameter file." );
+  clParser->MarkArgumentAsRequired( "-m", "The moving image." );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = clParser->CheckForRequiredArguments();
+
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  std::string inputTransformParametersName = "";
+  clParser->GetCommandLineArgument( "-tp", inputTransformParametersName );
+
+  std::string outputTransformParametersName = "";
+  clParser->GetCommandLineArgument( "-out", outputTransformParametersName );
+
+  std::string movingImageFileName;
+  clParser->GetCommandLineArgument( "-m", movingImageFileName );
+
+  std::string deformationFieldInverseName = "";
+  clParser->GetCommandLineArgument( "-df", deformationFieldInverseName );
+  if( deformationFieldInverseName == "" )
+  {
+    std::string::size_type slash = outputTransformParametersName.find_last_of( "/\\" );
+    deformationFieldInverseName = ( slash == std::string::npos )
+      ? std::string( "" ) : outputTransformParametersName.substr( 0, slash + 1 );
+    deformationFieldInverseName += "deformationFieldInverse.mhd";
+  }
+
+  unsigned int numberOfLevels = 3;
+  clParser->GetCommandLineArgument( "-levels", numberOfLevels );
+  unsigned int maximumNumberOfIterations = 20;
+  clParser->GetCommandLineArgument( "-iterations", maximumNumberOfIterations );
+  double tolerance = 1e-3;
+  clParser->GetCommandLineArgument( "-tolerance", tolerance );
+
+  /** Typedef's. */
+  //const unsigned int Dimension = 2;
+  typedef float PrecisionType;
+  std::string dummyErrorMessage = "";
+
+  typedef itk::Transform<
+    PrecisionType, Dimension, Dimension >                  BaseTransformType;
+  typedef itk::EulerTransform< PrecisionType, Dimension >  RigidTransformType;
+  typedef itk::AffineTransform< PrecisionType, Dimension > AffineTransformType;
+  typedef BaseTransformType::ParametersType                ParametersType;
+  typedef BaseTransformType::ScalarType                    ScalarType;
+  typedef RigidTransformType::CenterType                   CenterType;
+  //typedef BaseTransformType::OutputPointType               OutputPointType;
+
+  /** Interface to the original transform parameters file. */
+  typedef itk::ParameterFileParser   ParserType;
+  typedef itk::ParameterMapInterface InterfaceType;
+  ParserType::Pointer    parser = ParserType::New();
+  InterfaceType::Pointer config = InterfaceType::New();
+  parser->SetParameterFileName( inputTransformParametersName );
+  parser->ReadParameterFile();
+  config->SetParameterMap( parser->GetParameterMap() );
+
+  /** Check dimension. */
+  unsigned int dimF = 0;
+  config->ReadParameter( dimF, "FixedImageDimension", 0, dummyErrorMessage );
+  if( dimF != Dimension )
+  {
+    std::cerr << "ERROR: the program elxInvertTransform was compiled for images of dimension " << Dimension << ",\n"
+              << "  while the parameter \"FixedImageDimension\" reads " << dimF << ".\n"
+              << "  Recompile elxInvertTransform for Dimension = " << dimF << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /**
+   * *** TASK 1:
+   * *** Read the moving image to determine the inverted fixed image domain.
+   * *** Needed to determine the parameters Size, Index, Spacing, Direction in
+   * *** the output inverted transform parameter file.
+   */
+
+  /** Create a testReader. */
+  typedef itk::Image< short, Dimension >         DummyImageType;
+  typedef itk::ImageFileReader< DummyImageType > ReaderType;
+  ReaderType::Pointer testReader = ReaderType::New();
+  testReader->SetFileName( movingImageFileName.c_str() );
+
+  /** Generate all information. */
+  try
+  {
+    testReader->UpdateOutputInformation();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+  itk::ImageIOBase::Pointer imageIOBase = testReader->GetImageIO();
+
+  /** A single linear transform is inverted analytically, all other transforms
+   * and concatenations of transforms are inverted numerically.
+   */
+  std::string transformType = "";
+  config->ReadParameter( transformType, "Transform", 0, dummyErrorMessage );
+  std::string initialTransform = "";
+  config->ReadParameter( initialTransform, "InitialTransformParametersFileName", 0, dummyErrorMessage );
+  if( initialTransform != "NoInitialTransform"
+    || ( transformType != "EulerTransform" && transformType != "AffineTransform" ) )
+  {
+    return InvertNumerically( inputTransformParametersName,
+      outputTransformParametersName, deformationFieldInverseName,
+      config, testReader->GetOutput(), imageIOBase,
+      numberOfLevels, maximumNumberOfIterations, tolerance );
+  }
+
+  /**
+   * *** TASK 2:
+   * *** Read the original transform parameters to setup the original transform
+   * *** and invert the transform.
+   */
+
+  /** Get the number of TransformParameters. */
+  unsigned int numberOfParameters = 0;
+  config->ReadParameter( numberOfParameters, "NumberOfParameters", 0, dummyErrorMessage );
+
+  /** Read the TransformParameters as a vector. */
+  std::vector< ScalarType > vecPar( numberOfParameters,
+    itk::NumericTraits< ScalarType >::ZeroValue() );
+  config->ReadParameter( vecPar, "TransformParameters",
+    0, numberOfParameters - 1, true, dummyErrorMessage );
+
+  /** Convert to ParametersType. */
+  ParametersType transformParameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; i++ )
+  {
+    transformParameters[ i ] = vecPar[ i ];
+  }
+
+  /** Get center of rotation. */
+  CenterType centerOfRotation;
+  for( unsigned int i = 0; i < Dimension; i++ )
+  {
+    config->ReadParameter( centerOfRotation[ i ],
+      "CenterOfRotationPoint", i, dummyErrorMessage );
+  }
+
+  /** Set up the transform. */
+  ParametersType transformParametersInv( numberOfParameters );
+  CenterType     centerOfRotationInv;
+
+  try
+  {
+    if( transformType == "EulerTransform" )
+    {
+      RigidTransformType::Pointer rigidTransform = RigidTransformType::New();
+      rigidTransform->SetCenter( centerOfRotation );
+      rigidTransform->SetParametersByValue( transformParameters );
+
+      RigidTransformType::Pointer inverseRigidTransform = RigidTransformType::New();
+      rigidTransform->GetInverse( inverseRigidTransform );
+
+      transformParametersInv = inverseRigidTransform->GetParameters();
+      centerOfRotationInv    = inverseRigidTransform->GetCenter();
+    }
+    else if( transformType == "AffineTransform" )
+    {
+      AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+      affineTransform->SetCenter( centerOfRotation );
+      affineTransform->SetParametersByValue( transformParameters );
+
+      AffineTransformType::Pointer inverseAffineTransform = AffineTransformType::New();
+      affineTransform->GetInverse( inverseAffineTransform );
+
+      transformParametersInv = inverseAffineTransform->GetParameters();
+      centerOfRotationInv    = inverseAffineTransform->GetCenter();
+    }
+    else
+    {
+      std::cerr << "ERROR: Transforms of the type "
+                << transformType
+                << " are not supported." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /**
+   * *** TASK 3:
+   * *** Write the inverted transform to file, in elastix style.
+   */
+
+  /** Get some information from the input transform parameters file that needs to be copied. */
+  std::string combinationMethod = "Compose";
+  config->ReadParameter( combinationMethod, "HowToCombineTransforms", 0, dummyErrorMessage );
+
+  /** Open a file for writing. */
+  std::ofstream outputTPFile( outputTransformParametersName.c_str() );
+
+  /** The following is a modified copy of elx::TransformBase::WriteToFile(). */
+
+  /** Write the name of this transform. */
+  outputTPFile << "(Transform \""
+               << transformType << "\")" << std::endl;
+
+  /** Write the number of parameters of this transform. */
+  outputTPFile << "(NumberOfParameters "
+               << numberOfParameters << ")" << std::endl;
+
+  /** In this case, write in a normal way to the parameter file. */
+  outputTPFile << "(TransformParameters ";
+  for( unsigned int i = 0; i < numberOfParameters - 1; i++ )
+  {
+    outputTPFile << transformParametersInv[ i ] << " ";
+  }
+  outputTPFile << transformParametersInv[ numberOfParameters - 1 ] << ")" << std::endl;
+
+  /** Write the name of the parameters-file of the initial transform. */
+  outputTPFile << "(InitialTransformParametersFileName \"NoInitialTransform\")" << std::endl;
+
+  /** Write the way Transforms are combined. */
+  outputTPFile << "(HowToCombineTransforms \""
+               << combinationMethod << "\")" << std::endl;
+
+  /** Write image specific things. */
+  WriteImageSpecific( outputTPFile, config, imageIOBase );
+
+  /** Read from input transform parameter file. */
+  std::string computeZYX = "true";
+  config->ReadParameter( computeZYX, "ComputeZYX", 0, dummyErrorMessage );
+
+  /** Write to file. */
+  outputTPFile << "\n// " << transformType << " specific\n";
+  outputTPFile << "(CenterOfRotationPoint";
+  for( unsigned int i = 0; i < Dimension; i++ )
+  {
+    outputTPFile << " " << centerOfRotationInv[ i ];
+  }
+  outputTPFile << ")\n";
+  outputTPFile << "(ComputeZYX \"" << computeZYX << "\")\n";
+
+  WriteResamplerSpecific( outputTPFile, config );
+
+  // It would be better to copy everything else from the input
+
+  outputTPFile.close();
+
+  return EXIT_SUCCESS;
+
+} // end main()
@@ -27,6 +27,17 @@
 namespace elastix
 {
 
+/**
+ * ********************* Constructor *********************
+ */
+
+ParameterObject
+::ParameterObject()
+{
+  this->m_ParameterMapHolder = ParameterMapVectorHolder::New();
+}
+
+
 /**
  * ********************* SetParameterMap *********************
  */
@@ -48,14 +59,32 @@ void
 ParameterObject
 ::SetParameterMap( const ParameterMapVectorType & parameterMap )
 {
-  if( this->m_ParameterMap != parameterMap )
+  if( this->GetParameterMap() != parameterMap )
   {
-    this->m_ParameterMap = parameterMap;
+    /** Replace rather than modify the maps, which may be shared. */
+    ParameterMapVectorHolder::Pointer holder = ParameterMapVectorHolder::New();
+    holder->m_ParameterMap     = parameterMap;
+    this->m_ParameterMapHolder = holder;
     this->Modified();
   }
 }
 
 
+/**
+ * ********************* TakeParameterMap *********************
+ */
+
+void
+ParameterObject
+::TakeParameterMap( ParameterMapVectorType & parameterMap )
+{
+  ParameterMapVectorHolder::Pointer holder = ParameterMapVectorHolder::New();
+  holder->m_ParameterMap.swap( parameterMap );
+  this->m_ParameterMapHolder = holder;
+  this->Modified();
+}
+
+
 /**
  * ********************* AddParameterMap *********************
  */
@@ -64,7 +93,7 @@ void
 ParameterObject
 ::AddParameterMap( const ParameterMapType & parameterMap )
 {
-  this->m_ParameterMap.push_back( parameterMap );
+  this->GetModifiableParameterMap().push_back( parameterMap );
   this->Modified();
 }
 
@@ -77,7 +106,60 @@ const ParameterObject::ParameterMapType &
 ParameterObject
 ::GetParameterMap( const unsigned int index ) const
 {
-  return this->m_ParameterMap[ index ];
+  return this->GetParameterMap()[ index ];
+}
+
+
+/**
+ * ********************* GetParameterMap *********************
+ */
+
+const ParameterObject::ParameterMapVectorType &
+ParameterObject
+::GetParameterMap( void ) const
+{
+  return this->m_ParameterMapHolder->m_ParameterMap;
+}
+
+
+/**
+ * ********************* GetModifiableParameterMap *********************
+ */
+
+ParameterObject::ParameterMapVectorType &
+ParameterObject
+::GetModifiableParameterMap( void )
+{
+  /** Copy the maps if they are shared with another object. */
+  if( this->m_ParameterMapHolder->GetReferenceCount() > 1 )
+  {
+    ParameterMapVectorHolder::Pointer holder = ParameterMapVectorHolder::New();
+    holder->m_ParameterMap     = this->m_ParameterMapHolder->m_ParameterMap;
+    this->m_ParameterMapHolder = holder;
+  }
+  return this->m_ParameterMapHolder->m_ParameterMap;
+}
+
+
+/**
+ * ********************* Graft *********************
+ */
+
+void
+ParameterObject
+::Graft( const itk::DataObject * data )
+{
+  const Self * parameterObject = dynamic_cast< const Self * >( data );
+  if( parameterObject == ITK_NULLPTR )
+  {
+    itkExceptionMacro( "Graft: the data object is not a ParameterObject." );
+  }
+
+  if( parameterObject != this )
+  {
+    this->m_ParameterMapHolder = parameterObject->m_ParameterMapHolder;
+    this->Modified();
+  }
 }
 
 
@@ -109,7 +191,7 @@ ParameterObject
     itkExceptionMacro( "Parameter filename container is empty." );
   }
 
-  this->m_ParameterMap.clear();
+  this->m_ParameterMapHolder = ParameterMapVectorHolder::New();
 
   for( unsigned int i = 0; i < parameterFileNameVector.size(); ++i )
   {
@@ -134,7 +216,7 @@ ParameterObject
   ParameterFileParserPointer parameterFileParser = ParameterFileParserType::New();
   parameterFileParser->SetParameterFileName( parameterFileName );
   parameterFileParser->ReadParameterFile();
-  this->m_ParameterMap.push_back( parameterFileParser->GetParameterMap() );
+  this->GetModifiableParameterMap().push_back( parameterFileParser->GetParameterMap() );
 }
 
 
@@ -167,7 +249,7 @@ ParameterObject
     {
       parameterFile << "(" << parameterMapIterator->first;
 
-      ParameterValueVectorType parameterMapValueVector = parameterMapIterator->second;
+      const ParameterValueVectorType & parameterMapValueVector = parameterMapIterator->second;
       for( unsigned int i = 0; i < parameterMapValueVector.size(); ++i )
       {
         std::stringstream stream( parameterMapValueVector[ i ] );
@@ -211,20 +293,20 @@ void
 ParameterObject
 ::WriteParameterFile( const ParameterFileNameType & parameterFileName )
 {
-  if( this->m_ParameterMap.size() == 0 )
+  if( this->GetParameterMap().size() == 0 )
   {
     itkExceptionMacro( "Error writing parameter map to disk: The parameter object is empty." );
   }
 
-  if( this->m_ParameterMap.size() > 1 )
+  if( this->GetParameterMap().size() > 1 )
   {
     itkExceptionMacro(
       << "Error writing to disk: The number of parameter maps ("
-      << this->m_ParameterMap.size() << ")"
+      << this->GetParameterMap().size() << ")"
       << " does not match the number of provided filenames (1). Please provide a vector of filenames." );
   }
 
-  this->WriteParameterFile( this->m_ParameterMap[ 0 ], parameterFileName );
+  this->WriteParameterFile( this->GetParameterMap()[ 0 ], parameterFileName );
 }
 
 
@@ -236,19 +318,19 @@ void
 ParameterObject
 ::WriteParameterFile( const ParameterFileNameVectorType & parameterFileNameVector )
 {
-  if( this->m_ParameterMap.size() != parameterFileNameVector.size() )
+  if( this->GetParameterMap().size() != parameterFileNameVector.size() )
   {
     itkExceptionMacro(
       << "Error writing to disk: The number of parameter maps ("
-      << this->m_ParameterMap.size() << ")"
+      << this->GetParameterMap().size() << ")"
       << " does not match the number of provided filenames ("
       << parameterFileNameVector.size()
       << ")." );
   }
 
-  for( unsigned int i = 0; i < this->m_ParameterMap.size(); ++i )
+  for( unsigned int i = 0; i < this->GetParameterMap().size(); ++i )
   {
-    this->WriteParameterFile( this->m_ParameterMap[ i ], parameterFileNameVector[ i ] );
+    this->WriteParameterFile( this->GetParameterMap()[ i ], parameterFileNameVector[ i ] );
   }
 }
 
@@ -372,15 +454,15 @@ ParameterObject
 {
   Superclass::PrintSelf( os, indent );
 
-  for( unsigned int i = 0; i < this->m_ParameterMap.size(); ++i )
+  for( unsigned int i = 0; i < this->GetParameterMap().size(); ++i )
   {
     os << "ParameterMap " << i << ": " << std::endl;
-    ParameterMapConstIterator parameterMapIterator    = this->m_ParameterMap[ i ].begin();
-    ParameterMapConstIterator parameterMapIteratorEnd = this->m_ParameterMap[ i ].end();
+    ParameterMapConstIterator parameterMapIterator    = this->GetParameterMap()[ i ].begin();
+    ParameterMapConstIterator parameterMapIteratorEnd = this->GetParameterMap()[ i ].end();
     while( parameterMapIterator != parameterMapIteratorEnd )
     {
       os << "  (" << parameterMapIterator->first;
-      ParameterValueVectorType parameterMapValueVector = parameterMapIterator->second;
+      const ParameterValueVectorType & parameterMapValueVector = parameterMapIterator->second;
 
       for( unsigned int j = 0; j < parameterMapValueVector.size(); ++j )
       {
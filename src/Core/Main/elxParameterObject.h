@@ -66,7 +66,18 @@ public:
 
   const ParameterMapType & GetParameterMap( const unsigned int index ) const;
 
-  itkGetConstReferenceMacro( ParameterMap, ParameterMapVectorType );
+  const ParameterMapVectorType & GetParameterMap( void ) const;
+
+  /* Set the parameter maps to those of \a parameterMap, without copying
+   * them; \a parameterMap is left empty. */
+  void TakeParameterMap( ParameterMapVectorType & parameterMap );
+
+  /* Share the parameter maps of \a data, which must be a ParameterObject.
+   * The maps are copy-on-write: both objects use the same maps, until one of
+   * them is modified, which then copies them first. Grafting is therefore
+   * cheap, also for maps with large TransformParameters. Modifying an object
+   * while another thread grafts from it is not thread safe. */
+  virtual void Graft( const itk::DataObject * data ) ITK_OVERRIDE;
 
   /* Read/Write parameter file or multiple parameter files to/from disk. */
   void ReadParameterFile( const ParameterFileNameType & parameterFileName );
@@ -99,11 +110,39 @@ public:
 
 protected:
 
+  ParameterObject();
+  virtual ~ParameterObject() {}
+
   void PrintSelf( std::ostream & os, itk::Indent indent ) const ITK_OVERRIDE;
 
 private:
 
-  ParameterMapVectorType m_ParameterMap;
+  ParameterObject( const Self & ); // purposely not implemented
+  void operator=( const Self & );  // purposely not implemented
+
+  /* The reference counted parameter maps, which may be shared by objects. */
+  class ParameterMapVectorHolder : public itk::LightObject
+  {
+public:
+
+    typedef ParameterMapVectorHolder        Self;
+    typedef itk::LightObject                Superclass;
+    typedef itk::SmartPointer< Self >       Pointer;
+    itkNewMacro( Self );
+
+    ParameterMapVectorType m_ParameterMap;
+
+protected:
+
+    ParameterMapVectorHolder() {}
+    virtual ~ParameterMapVectorHolder() {}
+  };
+
+  /* Get the parameter maps for modification; copies them first if they are
+   * shared with another object. */
+  ParameterMapVectorType & GetModifiableParameterMap( void );
+
+  ParameterMapVectorHolder::Pointer m_ParameterMapHolder;
 
 };
 
@@ -103,6 +103,14 @@ public:
 
   const ParameterObjectType * GetTransformParameterObject( void ) const;
 
+  /** Set/Get the live transform, as given by ElastixFilter::GetFinalTransform().
+   * If set, it is applied instead of the transform described by the transform
+   * parameter object, of which only the resampling settings are then used.
+   * The transform must have been created for the same image types.
+   */
+  itkSetObjectMacro( Transform, itk::Object );
+  itkGetObjectMacro( Transform, itk::Object );
+
   /** Set/Get/Remove output directory. */
   itkSetMacro( OutputDirectory, std::string );
   itkGetConstMacro( OutputDirectory, std::string );
@@ -158,6 +166,8 @@ private:
   bool m_LogToConsole;
   bool m_LogToFile;
 
+  itk::Object::Pointer m_Transform;
+
 };
 
 } // namespace elx
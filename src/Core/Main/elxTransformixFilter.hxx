@@ -45,6 +45,8 @@ TransformixFilter< TMovingImage >
   this->m_LogToConsole = false;
   this->m_LogToFile    = false;
 
+  this->m_Transform = 0;
+
   // TransformixFilter must have an input image
   this->SetInput( "InputImage", TMovingImage::New() );
 } // end Constructor
@@ -174,6 +176,9 @@ TransformixFilter< TMovingImage >
     transformix->SetInputImageContainer( inputImageContainer );
   }
 
+  // Use the live transform of a registration if given
+  transformix->SetTransform( this->m_Transform );
+
   // Get ParameterMap
   ParameterObjectPointer transformParameterObject = itkDynamicCastInDebugMode< ParameterObject * >( this->GetInput( "TransformParameterObject" ) );
   ParameterMapVectorType transformParameterMapVector = transformParameterObject->GetParameterMap();
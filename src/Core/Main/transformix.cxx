@@ -19,6 +19,30 @@
 #include "elastix.h"
 #include "elxTransformixMain.h"
 
+/** The arguments of the jobs of a transformix batch. */
+typedef std::vector< elx::TransformixMain::ArgumentMapType > TransformixBatchType;
+
+/** Declare ReadTransformixBatchManifest function.
+ *
+ * \commandlinearg -batch: optional argument for transformix, instead of "-in",
+ *    "-def", "-jac" and "-jacmat", to apply the transform of "-tp" to many
+ *    images and point sets in one process. The component database and the
+ *    transform are then set up only once. Every line of the manifest holds
+ *    the "-in", "-def", "-jac", "-jacmat" and "-out" arguments of one job,
+ *    separated by white space; "-out" is required. Empty lines and lines
+ *    starting with '//' or '#' are skipped. The transformix.log is written
+ *    in the "-out" directory of the command line. With the parameter
+ *    (CacheMappedCoordinates "true") the jobs only interpolate the input images
+ *    that have the geometry of the previous one. \n
+ *    example: <tt>-batch manifest.txt</tt> \n
+ *
+ * The jobs are appended to \a batch, as copies of \a argMap with the
+ * arguments of the line. Returns false, after printing the reason, if the
+ * manifest is invalid.
+ */
+bool ReadTransformixBatchManifest( const std::string & fileName,
+  const elx::TransformixMain::ArgumentMapType & argMap, TransformixBatchType & batch );
+
 int
 main( int argc, char ** argv )
 {
@@ -79,19 +103,7 @@ main( int argc, char ** argv )
     if( key == "-out" )
     {
       /** Make sure that last character of the output folder equals a '/' or '\'. */
-      const char last = value[ value.size() - 1 ];
-      if( last != '/' && last != '\\' ) { value.append( "/" ); }
-      value = itksys::SystemTools::ConvertToOutputPath( value.c_str() );
-
-      /** Note that on Windows, in case the output folder contains a space,
-       * the path name is double quoted by ConvertToOutputPath, which is undesirable.
-       * So, we remove these quotes again.
-       */
-      if( itksys::SystemTools::StringStartsWith( value.c_str(), "\"" )
-        && itksys::SystemTools::StringEndsWith(   value.c_str(), "\"" ) )
-      {
-        value = value.substr( 1, value.length() - 2 );
-      }
+      value = MakeOutputFolderName( value );
 
       /** Save this information. */
       outFolderPresent = true;
@@ -129,13 +141,34 @@ main( int argc, char ** argv )
     && argMap.count( "-ipp" ) == 0
     && argMap.count( "-def" ) == 0
     && argMap.count( "-jac" ) == 0
-    && argMap.count( "-jacmat" ) == 0 )
+    && argMap.count( "-jacmat" ) == 0
+    && argMap.count( "-batch" ) == 0 )
   {
     std::cerr << "ERROR: At least one of the CommandLine options \"-in\", "
-              << "\"-def\", \"-jac\", or \"-jacmat\" should be given!" << std::endl;
+              << "\"-def\", \"-jac\", \"-jacmat\", or \"-batch\" should be given!" << std::endl;
     returndummy |= -1;
   }
 
+  /** Read the batch manifest, or run the single job of the command line. */
+  TransformixBatchType batch;
+  if( argMap.count( "-batch" ) )
+  {
+    if( argMap.count( "-in" ) || argMap.count( "-ipp" ) || argMap.count( "-def" )
+      || argMap.count( "-jac" ) || argMap.count( "-jacmat" ) )
+    {
+      std::cerr << "ERROR: \"-in\", \"-def\", \"-jac\" and \"-jacmat\" can not be combined with \"-batch\"." << std::endl;
+      returndummy |= -1;
+    }
+    else if( !ReadTransformixBatchManifest( argMap[ "-batch" ], argMap, batch ) )
+    {
+      returndummy |= -1;
+    }
+  }
+  else
+  {
+    batch.push_back( argMap );
+  }
+
   /** Check if the -out option is given and setup xout. */
   if( outFolderPresent )
   {
@@ -150,7 +183,7 @@ main( int argc, char ** argv )
     else
     {
       /** Setup xout. */
-      logFileName = argMap[ "-out" ] + "transformix.log";
+      logFileName = outFolder + "transformix.log";
       int returndummy2 = elx::xoutSetup( logFileName.c_str(), true, true );
       if( returndummy2 )
       {
@@ -197,22 +230,55 @@ main( int argc, char ** argv )
    * ********************* START TRANSFORMATION *******************
    */
 
-  /** Set transformix. */
-  transformix = TransformixMainType::New();
+  /** The transform of the first job is reused by the next jobs of a batch. */
+  TransformixMainType::ObjectPointer liveTransform;
+  int                                batchReturn = 0;
 
-  /** Print a start message. */
-  elxout << "Running transformix with parameter file \""
-         << argMap[ "-tp" ] << "\".\n" << std::endl;
+  for( std::size_t b = 0; b < batch.size(); ++b )
+  {
+    if( argMap.count( "-batch" ) )
+    {
+      elxout << "=========================================================================" << "\n" << std::endl;
+      elxout << "Running job " << b << " of the batch, output to \""
+             << batch[ b ][ "-out" ] << "\".\n" << std::endl;
+    }
 
-  /** Run transformix. */
-  returndummy = transformix->Run( argMap );
+    /** Set transformix. */
+    transformix = TransformixMainType::New();
+    if( liveTransform.IsNotNull() )
+    {
+      transformix->SetTransform( liveTransform );
+    }
 
-  /** Check if transformix run without errors. */
-  if( returndummy != 0 )
-  {
-    xl::xout[ "error" ] << "Errors occurred" << std::endl;
-    return returndummy;
-  }
+    /** Print a start message. */
+    elxout << "Running transformix with parameter file \""
+           << argMap[ "-tp" ] << "\".\n" << std::endl;
+
+    /** Run transformix. */
+    returndummy = transformix->Run( batch[ b ] );
+
+    /** Check if transformix run without errors. A failing job does not stop
+     * the other jobs of a batch.
+     */
+    if( returndummy != 0 )
+    {
+      xl::xout[ "error" ] << "Errors occurred" << std::endl;
+      if( !argMap.count( "-batch" ) )
+      {
+        return returndummy;
+      }
+      xl::xout[ "error" ] << "Job " << b << " of the batch failed." << std::endl;
+      batchReturn = returndummy;
+    }
+    else if( liveTransform.IsNull() )
+    {
+      liveTransform = transformix->GetFinalTransform();
+    }
+
+    /** Try to release some memory. */
+    transformix = 0;
+
+  } // end loop over jobs
 
   /** Stop timer and print it. */
   totaltimer.Stop();
@@ -221,11 +287,11 @@ main( int argc, char ** argv )
          << ConvertSecondsToDHMS( totaltimer.GetMean(), 1 ) << ".\n" << std::endl;
 
   /** Clean up. */
-  transformix = 0;
+  liveTransform = 0;
   TransformixMainType::UnloadComponents();
 
   /** Exit and return the error code. */
-  return returndummy;
+  return batchReturn;
 
 } // end main
 
@@ -269,8 +335,13 @@ PrintHelp( void )
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
   std::cout << "  -threads  set the maximum number of threads of transformix\n";
-  std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
-            << std::endl;
+  std::cout << "  -hugepages  back the large image buffers by huge pages: off (default),\n"
+            << "            transparent, or explicit, using the reserved huge pages (Linux only)\n";
+  std::cout << "  -batch    manifest file, to apply the transform to many images and point\n"
+            << "            sets, instead of \"-in\", \"-def\", \"-jac\" and \"-jacmat\"; every\n"
+            << "            line holds these arguments of one job, and its own \"-out\"\n";
+  std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", \"-jacmat\", or \"-batch\"\n"
+            << "should be given.\n" << std::endl;
 
   /** The parameter file. */
   std::cout << "The transform-parameter file must contain all the information "
@@ -282,3 +353,79 @@ PrintHelp( void )
     "Check the website http://elastix.isi.uu.nl, or mail elastix@bigr.nl." << std::endl;
 
 } // end PrintHelp()
+
+
+/**
+ * ******************* ReadTransformixBatchManifest *********************
+ */
+
+bool
+ReadTransformixBatchManifest( const std::string & fileName,
+  const elx::TransformixMain::ArgumentMapType & argMap, TransformixBatchType & batch )
+{
+  std::ifstream manifest( fileName.c_str() );
+  if( !manifest.is_open() )
+  {
+    std::cerr << "ERROR: the batch manifest \"" << fileName << "\" could not be opened." << std::endl;
+    return false;
+  }
+
+  std::string                line;
+  std::vector< std::string > arguments;
+  unsigned int               lineNumber = 0;
+  while( std::getline( manifest, line ) )
+  {
+    ++lineNumber;
+    if( !SplitRequest( line, arguments ) )
+    {
+      continue;
+    }
+
+    /** Start from the arguments of the command line, without its "-out". */
+    elx::TransformixMain::ArgumentMapType job = argMap;
+    job.erase( "-batch" );
+    job.erase( "-out" );
+
+    bool valid = arguments.size() % 2 == 0;
+    for( std::size_t i = 0; valid && i < arguments.size(); i += 2 )
+    {
+      const std::string & key = arguments[ i ];
+      valid = key == "-in" || key == "-def" || key == "-jac" || key == "-jacmat" || key == "-out";
+      if( key == "-out" )
+      {
+        job[ key ] = MakeOutputFolderName( arguments[ i + 1 ] );
+      }
+      else
+      {
+        job[ key ] = arguments[ i + 1 ];
+      }
+    }
+    if( !valid || job.count( "-out" ) == 0
+      || ( job.count( "-in" ) == 0 && job.count( "-def" ) == 0
+      && job.count( "-jac" ) == 0 && job.count( "-jacmat" ) == 0 ) )
+    {
+      std::cerr << "ERROR: line " << lineNumber << " of the batch manifest \"" << fileName
+                << "\" should hold pairs of \"-in\", \"-def\", \"-jac\", \"-jacmat\" and \"-out\""
+                << " and their values, with at least \"-out\" and one other." << std::endl;
+      return false;
+    }
+
+    /** Check if the output directory exists. */
+    if( !itksys::SystemTools::FileIsDirectory( job[ "-out" ].c_str() ) )
+    {
+      std::cerr << "ERROR: the output directory \"" << job[ "-out" ] << "\" of line " << lineNumber
+                << " of the batch manifest does not exist." << std::endl;
+      return false;
+    }
+    batch.push_back( job );
+  }
+
+  if( batch.empty() )
+  {
+    std::cerr << "ERROR: the batch manifest \"" << fileName << "\" holds no jobs." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end ReadTransformixBatchManifest()
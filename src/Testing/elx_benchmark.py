@@ -0,0 +1,419 @@
+import sys, subprocess
+import os
+import os.path
+import re
+import math
+import json
+import time
+import struct
+import zlib
+from optparse import OptionParser
+
+#-------------------------------------------------------------------------------
+# The benchmark corpus. Every scenario registers a fixed and a moving image with
+# a fixed parameter file, and yields one set of performance numbers:
+# - the total and per resolution wall time of elastix,
+# - the wall time of transformix, resampling the moving image,
+# - the peak memory, as reported by elastix,
+# - the final metric value,
+# - the mean landmark error, if corresponding landmarks are known,
+# - the run time and peak memory that elastix -estimate predicts.
+#
+# The synthetic moving images are created by transformix from the fixed image
+# and a known transform, so that the landmark error can be computed from it.
+#-------------------------------------------------------------------------------
+
+scenarios = [
+  { "name"       : "2D_brain.NC.affine",
+    "parameters" : "parameters.2D.NC.affine.ASGD.benchmark.txt",
+    "fixed"      : "2DMRI-T1_brain.mha",
+    "synthetic"  : "affine2D" },
+  { "name"       : "3D_lung.MI.euler",
+    "parameters" : "parameters.3D.MI.euler.ASGD.benchmark.txt",
+    "fixed"      : "3DCT_lung_baseline.mha",
+    "moving"     : "3DCT_lung_followup.mha",
+    "landmarks"  : [ "3DCT_lung_baseline.txt", "3DCT_lung_followup.txt" ] },
+  { "name"       : "3D_lung.MI.bspline.bendingenergy",
+    "parameters" : "parameters.3D.MI.bspline.BE.ASGD.benchmark.txt",
+    "fixed"      : "3DCT_lung_baseline.mha",
+    "moving"     : "3DCT_lung_followup.mha",
+    "landmarks"  : [ "3DCT_lung_baseline.txt", "3DCT_lung_followup.txt" ] },
+  { "name"       : "4D_lung.PCA.bspline.groupwise",
+    "parameters" : "parameters.4D.PCA.bspline.ASGD.benchmark.txt",
+    "fixed"      : "3DCT_lung_baseline_small.mha",
+    "synthetic"  : "timeseries4D" }
+]
+
+# The quantities that are compared to the baseline; a larger value is worse.
+comparedQuantities = [ "totalTime", "transformixTime", "peakMemory" ]
+
+#-------------------------------------------------------------------------------
+# MetaImage reading and writing, without dependencies.
+
+def readMetaImage( fileName ) :
+  f = open( fileName, 'rb' )
+  header = []
+  fields = {}
+  while True :
+    line = f.readline().decode( 'ascii' ).rstrip( '\r\n' )
+    header.append( line )
+    key, value = [ s.strip() for s in line.split( '=', 1 ) ]
+    fields[ key ] = value
+    if key == "ElementDataFile" : break
+  data = f.read()
+  f.close()
+  if fields.get( "CompressedData", "False" ) == "True" :
+    data = zlib.decompress( data )
+  return fields, data
+
+def writeMetaImage( fileName, fields, data ) :
+  f = open( fileName, 'wb' )
+  for key in [ "ObjectType", "NDims", "BinaryData", "BinaryDataByteOrderMSB",
+      "CompressedData", "TransformMatrix", "Offset", "CenterOfRotation",
+      "ElementSpacing", "DimSize", "ElementType", "ElementDataFile" ] :
+    f.write( ( key + " = " + fields[ key ] + "\n" ).encode( 'ascii' ) )
+  f.write( data )
+  f.close()
+
+def getFloats( fields, key ) :
+  return [ float( s ) for s in fields[ key ].split() ]
+
+#-------------------------------------------------------------------------------
+# Transform parameter files of the known transforms of the synthetic cases.
+
+def writeTransformParameterFile( fileName, transform, parameters, fields, extra = "" ) :
+  dimension = int( fields[ "NDims" ] )
+  direction = fields[ "TransformMatrix" ].split()
+  # MetaImage stores the direction column wise, elastix row wise.
+  direction = [ direction[ c * dimension + r ] for r in range( dimension ) for c in range( dimension ) ]
+  f = open( fileName, 'w' )
+  f.write( "(Transform \"" + transform + "\")\n" )
+  f.write( "(NumberOfParameters " + str( len( parameters ) ) + ")\n" )
+  f.write( "(TransformParameters " + " ".join( [ repr( p ) for p in parameters ] ) + ")\n" )
+  f.write( "(InitialTransformParametersFileName \"NoInitialTransform\")\n" )
+  f.write( "(HowToCombineTransforms \"Compose\")\n" )
+  f.write( "(FixedImageDimension " + str( dimension ) + ")\n" )
+  f.write( "(MovingImageDimension " + str( dimension ) + ")\n" )
+  f.write( "(FixedInternalImagePixelType \"float\")\n" )
+  f.write( "(MovingInternalImagePixelType \"float\")\n" )
+  f.write( "(Size " + fields[ "DimSize" ] + ")\n" )
+  f.write( "(Index " + " ".join( [ "0" ] * dimension ) + ")\n" )
+  f.write( "(Spacing " + fields[ "ElementSpacing" ] + ")\n" )
+  f.write( "(Origin " + fields[ "Offset" ] + ")\n" )
+  f.write( "(Direction " + " ".join( direction ) + ")\n" )
+  f.write( "(UseDirectionCosines \"true\")\n" )
+  f.write( "(ResampleInterpolator \"FinalBSplineInterpolator\")\n" )
+  f.write( "(FinalBSplineInterpolationOrder 3)\n" )
+  f.write( "(Resampler \"DefaultResampler\")\n" )
+  f.write( "(DefaultPixelValue 0)\n" )
+  f.write( "(ResultImageFormat \"mha\")\n" )
+  f.write( "(ResultImagePixelType \"short\")\n" )
+  f.write( "(CompressResultImage \"false\")\n" )
+  f.write( extra )
+  f.close()
+
+def getImageCenter( fields ) :
+  origin  = getFloats( fields, "Offset" )
+  spacing = getFloats( fields, "ElementSpacing" )
+  size    = getFloats( fields, "DimSize" )
+  return [ origin[ d ] + spacing[ d ] * ( size[ d ] - 1 ) / 2.0 for d in range( len( origin ) ) ]
+
+def runTransformix( args, outputDir ) :
+  if not os.path.exists( outputDir ) : os.makedirs( outputDir )
+  start = time.time()
+  returnCode = subprocess.call( [ "transformix" ] + args + [ "-out", outputDir ],
+    stdout=subprocess.PIPE, stderr=subprocess.PIPE )
+  if returnCode != 0 :
+    raise RuntimeError( "transformix failed, see " + os.path.join( outputDir, "transformix.log" ) )
+  return time.time() - start
+
+#-------------------------------------------------------------------------------
+# Creation of the synthetic cases.
+
+def createAffine2D( fixedFileName, outputDir ) :
+  """ Deforms the fixed image by a known affine transform. Returns the moving
+  image, the known transform and a grid of landmarks in the fixed image. """
+  fields, data = readMetaImage( fixedFileName )
+  center = getImageCenter( fields )
+  angle = 0.1
+  parameters = [ 1.05 * math.cos( angle ), -math.sin( angle ),
+    math.sin( angle ), 0.95 * math.cos( angle ), 4.0, -3.0 ]
+  tpFileName = os.path.join( outputDir, "TransformParameters.known.txt" )
+  writeTransformParameterFile( tpFileName, "AffineTransform", parameters, fields,
+    "(CenterOfRotationPoint " + " ".join( [ repr( c ) for c in center ] ) + ")\n" )
+  runTransformix( [ "-in", fixedFileName, "-tp", tpFileName ], os.path.join( outputDir, "known" ) )
+
+  # A grid of landmarks in the center part of the image.
+  origin  = getFloats( fields, "Offset" )
+  spacing = getFloats( fields, "ElementSpacing" )
+  size    = getFloats( fields, "DimSize" )
+  points = []
+  for i in range( 1, 8 ) :
+    for j in range( 1, 8 ) :
+      points.append( [ origin[ 0 ] + spacing[ 0 ] * size[ 0 ] * ( 0.2 + 0.6 * i / 8.0 ),
+        origin[ 1 ] + spacing[ 1 ] * size[ 1 ] * ( 0.2 + 0.6 * j / 8.0 ) ] )
+  landmarkFileName = os.path.join( outputDir, "landmarks_fixed.txt" )
+  writePointFile( landmarkFileName, points )
+  return os.path.join( outputDir, "known", "result.mha" ), tpFileName, landmarkFileName
+
+def createTimeSeries4D( fixedFileName, outputDir ) :
+  """ Stacks translated copies of the fixed image to a 3D+t image. """
+  fields, data = readMetaImage( fixedFileName )
+  frames = []
+  for t in range( 5 ) :
+    tpFileName = os.path.join( outputDir, "TransformParameters.known." + str( t ) + ".txt" )
+    writeTransformParameterFile( tpFileName, "TranslationTransform",
+      [ 1.5 * math.sin( t ), 1.0 * math.cos( t ) - 1.0, 2.0 * math.sin( 0.5 * t ) ], fields )
+    frameDir = os.path.join( outputDir, "frame" + str( t ) )
+    runTransformix( [ "-in", fixedFileName, "-tp", tpFileName ], frameDir )
+    frameFields, frameData = readMetaImage( os.path.join( frameDir, "result.mha" ) )
+    frames.append( frameData )
+
+  fields4D = dict( frameFields )
+  fields4D[ "NDims" ] = "4"
+  fields4D[ "CompressedData" ] = "False"
+  matrix = getFloats( frameFields, "TransformMatrix" )
+  matrix4D = []
+  for c in range( 4 ) :
+    for r in range( 4 ) :
+      if c < 3 and r < 3 : matrix4D.append( matrix[ c * 3 + r ] )
+      else : matrix4D.append( 1.0 if c == r else 0.0 )
+  fields4D[ "TransformMatrix" ] = " ".join( [ repr( m ) for m in matrix4D ] )
+  fields4D[ "Offset" ] = frameFields[ "Offset" ] + " 0"
+  fields4D[ "CenterOfRotation" ] = "0 0 0 0"
+  fields4D[ "ElementSpacing" ] = frameFields[ "ElementSpacing" ] + " 1"
+  fields4D[ "DimSize" ] = frameFields[ "DimSize" ] + " " + str( len( frames ) )
+  movingFileName = os.path.join( outputDir, "timeseries4D.mha" )
+  writeMetaImage( movingFileName, fields4D, b"".join( frames ) )
+  return movingFileName
+
+#-------------------------------------------------------------------------------
+# Landmarks.
+
+def writePointFile( fileName, points ) :
+  f = open( fileName, 'w' )
+  f.write( "point\n" + str( len( points ) ) + "\n" )
+  for p in points :
+    f.write( " ".join( [ repr( c ) for c in p ] ) + "\n" )
+  f.close()
+
+def readPointFile( fileName, imageFileName ) :
+  """ Reads a transformix input point file, and converts indices to points. """
+  lines = open( fileName ).read().split( '\n' )
+  points = [ [ float( s ) for s in line.split() ] for line in lines[ 2: ] if line.strip() ]
+  if lines[ 0 ].strip() == "index" :
+    fields, data = readMetaImage( imageFileName )
+    origin  = getFloats( fields, "Offset" )
+    spacing = getFloats( fields, "ElementSpacing" )
+    matrix  = getFloats( fields, "TransformMatrix" )
+    dimension = len( origin )
+    points = [ [ origin[ r ] + sum( [ matrix[ c * dimension + r ] * spacing[ c ] * p[ c ]
+      for c in range( dimension ) ] ) for r in range( dimension ) ] for p in points ]
+  return points
+
+def transformPoints( pointFileName, tpFileName, outputDir ) :
+  runTransformix( [ "-def", pointFileName, "-tp", tpFileName ], outputDir )
+  points = []
+  for line in open( os.path.join( outputDir, "outputpoints.txt" ) ) :
+    match = re.search( r"OutputPoint = \[ ([^\]]*) \]", line )
+    points.append( [ float( s ) for s in match.group( 1 ).split() ] )
+  return points
+
+def meanDistance( points1, points2 ) :
+  distances = [ math.sqrt( sum( [ ( a - b ) ** 2 for a, b in zip( p1, p2 ) ] ) )
+    for p1, p2 in zip( points1, points2 ) ]
+  return sum( distances ) / len( distances )
+
+#-------------------------------------------------------------------------------
+# Parsing of the elastix output.
+
+def getFinalMetricValue( directory ) :
+  """ Returns the metric value of the last iteration of the last resolution. """
+  latest = None
+  for fileName in os.listdir( directory ) :
+    match = re.match( r"IterationInfo\.(\d+)\.R(\d+)\.txt$", fileName )
+    if match :
+      key = ( int( match.group( 1 ) ), int( match.group( 2 ) ) )
+      if latest is None or key > latest[ 0 ] : latest = ( key, fileName )
+  if latest is None : return None
+  lines = [ line for line in open( os.path.join( directory, latest[ 1 ] ) ) if line.strip() ]
+  return float( lines[ -1 ].split()[ 1 ] )
+
+def parseElastixLog( fileName ) :
+  """ Returns the time per resolution in seconds, and the peak memory in MB. """
+  resolutionTimes = []
+  peakMemory = None
+  for line in open( fileName ) :
+    match = re.search( r"Time spent in resolution (\d+) .*: ([-+0-9.eE]+) s\.", line )
+    if match : resolutionTimes.append( float( match.group( 2 ) ) )
+    match = re.search( r"Peak resident set size of the process: ([0-9.]+) MB", line )
+    if match : peakMemory = max( peakMemory or 0.0, float( match.group( 1 ) ) )
+  return resolutionTimes, peakMemory
+
+def estimateCost( fixed, moving, parameterFileName, outputDir ) :
+  """ Returns the run time in seconds and the peak memory in MB, that
+  elastix -estimate predicts without calibration. """
+  if not os.path.exists( outputDir ) : os.makedirs( outputDir )
+  estimateFileName = os.path.join( outputDir, "estimate.txt" )
+  returnCode = subprocess.call( [ "elastix", "-f", fixed, "-m", moving,
+    "-p", parameterFileName, "-estimate", estimateFileName ],
+    stdout=subprocess.PIPE, stderr=subprocess.PIPE )
+  if returnCode != 0 : return None, None
+  estimatedTime = None
+  estimatedPeakMemory = None
+  for line in open( estimateFileName ) :
+    match = re.match( r"\(EstimatedSeconds ([-+0-9.eE]+)\)", line )
+    if match : estimatedTime = float( match.group( 1 ) )
+    match = re.match( r"\(PeakMemoryMB ([-+0-9.eE]+)\)", line )
+    if match : estimatedPeakMemory = float( match.group( 1 ) )
+  return estimatedTime, estimatedPeakMemory
+
+def writeCalibration( fileName, results ) :
+  """ Writes the calibration of elastix -estimate: the measured over the
+  estimated run time and peak memory, summed over the scenarios. """
+  def ratio( measured, estimated ) :
+    pairs = [ ( r[ measured ], r[ estimated ] ) for r in results
+      if r.get( measured ) is not None and r.get( estimated ) ]
+    if not pairs : return 1.0
+    return sum( [ p[ 0 ] for p in pairs ] ) / sum( [ p[ 1 ] for p in pairs ] )
+  f = open( fileName, 'w' )
+  f.write( "// Calibration of elastix -estimate, by elx_benchmark.py\n" )
+  f.write( "(RuntimeScale %.6g)\n" % ratio( "totalTime", "estimatedTime" ) )
+  f.write( "(MemoryScale %.6g)\n" % ratio( "peakMemory", "estimatedPeakMemory" ) )
+  f.close()
+
+#-------------------------------------------------------------------------------
+# Running a scenario.
+
+def runScenario( scenario, dataDir, outputDir ) :
+  if not os.path.exists( outputDir ) : os.makedirs( outputDir )
+  fixed = os.path.join( dataDir, scenario[ "fixed" ] )
+  knownTP = None
+  landmarks = None
+  if scenario.get( "synthetic" ) == "affine2D" :
+    moving, knownTP, landmarks = createAffine2D( fixed, os.path.join( outputDir, "synthetic" ) )
+  elif scenario.get( "synthetic" ) == "timeseries4D" :
+    # Groupwise: the time series is both the fixed and the moving image.
+    fixed = createTimeSeries4D( fixed, os.path.join( outputDir, "synthetic" ) )
+    moving = fixed
+  else :
+    moving = os.path.join( dataDir, scenario[ "moving" ] )
+
+  # Predict the cost, and run elastix.
+  estimatedTime, estimatedPeakMemory = estimateCost( fixed, moving,
+    os.path.join( dataDir, scenario[ "parameters" ] ), os.path.join( outputDir, "estimate" ) )
+  elastixDir = os.path.join( outputDir, "elastix" )
+  if not os.path.exists( elastixDir ) : os.makedirs( elastixDir )
+  start = time.time()
+  returnCode = subprocess.call( [ "elastix", "-f", fixed, "-m", moving,
+    "-p", os.path.join( dataDir, scenario[ "parameters" ] ), "-out", elastixDir ],
+    stdout=subprocess.PIPE, stderr=subprocess.PIPE )
+  totalTime = time.time() - start
+  if returnCode != 0 :
+    raise RuntimeError( "elastix failed, see " + os.path.join( elastixDir, "elastix.log" ) )
+
+  resolutionTimes, peakMemory = parseElastixLog( os.path.join( elastixDir, "elastix.log" ) )
+  resultTP = os.path.join( elastixDir, "TransformParameters.0.txt" )
+
+  # Run transformix, resampling the moving image.
+  transformixTime = runTransformix( [ "-in", moving, "-tp", resultTP ],
+    os.path.join( outputDir, "transformix" ) )
+
+  # The landmark error, in physical units.
+  landmarkError = None
+  if knownTP is not None :
+    # The registration should recover the inverse of the known transform.
+    registered = transformPoints( landmarks, resultTP, os.path.join( outputDir, "landmarks" ) )
+    registeredFileName = os.path.join( outputDir, "landmarks", "landmarks_registered.txt" )
+    writePointFile( registeredFileName, registered )
+    recovered = transformPoints( registeredFileName, knownTP, os.path.join( outputDir, "landmarks_known" ) )
+    landmarkError = meanDistance( recovered, readPointFile( landmarks, fixed ) )
+  elif "landmarks" in scenario :
+    fixedLandmarks  = os.path.join( dataDir, scenario[ "landmarks" ][ 0 ] )
+    movingLandmarks = os.path.join( dataDir, scenario[ "landmarks" ][ 1 ] )
+    registered = transformPoints( fixedLandmarks, resultTP, os.path.join( outputDir, "landmarks" ) )
+    landmarkError = meanDistance( registered, readPointFile( movingLandmarks, moving ) )
+
+  return {
+    "name"                : scenario[ "name" ],
+    "totalTime"           : totalTime,
+    "resolutionTimes"     : resolutionTimes,
+    "transformixTime"     : transformixTime,
+    "peakMemory"          : peakMemory,
+    "finalMetricValue"    : getFinalMetricValue( elastixDir ),
+    "landmarkError"       : landmarkError,
+    "estimatedTime"       : estimatedTime,
+    "estimatedPeakMemory" : estimatedPeakMemory }
+
+#-------------------------------------------------------------------------------
+# the main function
+def main():
+  # usage, parse parameters
+  usage = "usage: %prog [options] arg"
+  parser = OptionParser( usage )
+
+  # options to control files
+  parser.add_option( "-d", "--datadirectory", dest="datadirectory", help="directory with the images and parameter files" )
+  parser.add_option( "-o", "--outputdirectory", dest="outputdirectory", help="output directory" )
+  parser.add_option( "-e", "--elastixdirectory", dest="elastixdirectory", help="directory with the elastix and transformix executables" )
+  parser.add_option( "-s", "--scenario", dest="scenarios", action="append", help="run only this scenario; may be repeated" )
+  parser.add_option( "-b", "--baseline", dest="baseline", help="results of a previous run, to compare against" )
+  parser.add_option( "-t", "--tolerance", dest="tolerance", type="float", default=0.2,
+    help="allowed relative increase of the times and memory with respect to the baseline" )
+  parser.add_option( "-c", "--calibrate", dest="calibrate",
+    help="write the calibration of elastix -estimate, from the measured and estimated costs, to this file" )
+
+  (options, args) = parser.parse_args()
+
+  if options.datadirectory == None :
+    parser.error( "The option datadirectory (-d) should be given" )
+  if options.outputdirectory == None :
+    parser.error( "The option outputdirectory (-o) should be given" )
+
+  # Make sure the elastix of this build is found first.
+  if options.elastixdirectory != None :
+    os.environ[ 'PATH' ] = options.elastixdirectory + os.pathsep + os.getenv( 'PATH' )
+
+  # Run the scenarios.
+  results = []
+  for scenario in scenarios :
+    if options.scenarios and scenario[ "name" ] not in options.scenarios : continue
+    print( "Running scenario " + scenario[ "name" ] )
+    result = runScenario( scenario, options.datadirectory,
+      os.path.join( options.outputdirectory, scenario[ "name" ] ) )
+    print( "  total time: %.2f s, transformix time: %.2f s, peak memory: %s MB, "
+      "final metric value: %s, landmark error: %s" % ( result[ "totalTime" ],
+      result[ "transformixTime" ], result[ "peakMemory" ], result[ "finalMetricValue" ],
+      result[ "landmarkError" ] ) )
+    results.append( result )
+
+  resultFileName = os.path.join( options.outputdirectory, "BenchmarkResults.json" )
+  f = open( resultFileName, 'w' )
+  json.dump( { "scenarios" : results }, f, indent=2, sort_keys=True )
+  f.close()
+  print( "The results are written to " + resultFileName )
+
+  if options.calibrate != None :
+    writeCalibration( options.calibrate, results )
+    print( "The calibration is written to " + options.calibrate )
+
+  # Compare to the baseline.
+  numberOfRegressions = 0
+  if options.baseline != None :
+    baseline = dict( [ ( s[ "name" ], s ) for s in json.load( open( options.baseline ) )[ "scenarios" ] ] )
+    for result in results :
+      if result[ "name" ] not in baseline : continue
+      for quantity in comparedQuantities :
+        value = result[ quantity ]
+        baselineValue = baseline[ result[ "name" ] ].get( quantity )
+        if value is None or baselineValue is None : continue
+        if value > ( 1.0 + options.tolerance ) * baselineValue :
+          print( "REGRESSION: " + result[ "name" ] + " " + quantity + " is " + str( value )
+            + ", the baseline " + str( baselineValue ) )
+          numberOfRegressions += 1
+
+  return 1 if numberOfRegressions > 0 else 0
+
+#-------------------------------------------------------------------------------
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkBSplinePeriodicWeightTable.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test compares the weights of the itkBSplinePeriodicWeightTable with a
+// direct evaluation of the B-spline kernel functions, at the samples of
+// several grids that are aligned with the control point grid, for both
+// dimensions of a 2D table with spline order 3. Positions off the sample
+// grid, and steps that are not a ratio of small integers, should not be
+// found in the table.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int SplineOrder = 3;
+  const unsigned int SupportSize = SplineOrder + 1;
+  const double       distance    = 1e-9; // the allowable difference
+
+  typedef itk::BSplinePeriodicWeightTable< 2, SplineOrder >                TableType;
+  typedef itk::BSplineKernelFunction2< SplineOrder >                      KernelType;
+  typedef itk::BSplineDerivativeKernelFunction2< SplineOrder >            DerivativeKernelType;
+  typedef itk::BSplineSecondOrderDerivativeKernelFunction2< SplineOrder > SecondOrderDerivativeKernelType;
+
+  KernelType::Pointer                      kernel = KernelType::New();
+  DerivativeKernelType::Pointer            derivativeKernel = DerivativeKernelType::New();
+  SecondOrderDerivativeKernelType::Pointer secondOrderDerivativeKernel
+    = SecondOrderDerivativeKernelType::New();
+
+  /** The sample grids: offset, step and expected number of phases. */
+  const unsigned int numberOfGrids = 4;
+  const double       offsets[ numberOfGrids ] = { 0.0, 0.3, -7.125, 12.0 };
+  const double       steps[ numberOfGrids ]   = { 1.0, 0.25, 2.0 / 3.0, 1.0 / 16.0 };
+  const unsigned int phases[ numberOfGrids ]  = { 1, 4, 3, 16 };
+
+  TableType    table;
+  unsigned int numberOfLookups = 0;
+  for( unsigned int g = 0; g < numberOfGrids; ++g )
+  {
+    const unsigned int dim = g % 2;
+    if( !table.SetSampleGrid( dim, offsets[ g ], steps[ g ] ) )
+    {
+      std::cerr << "ERROR: the sample grid with step " << steps[ g ]
+                << " is not accepted." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( table.GetNumberOfPhases( dim ) != phases[ g ] )
+    {
+      std::cerr << "ERROR: the sample grid with step " << steps[ g ] << " has "
+                << table.GetNumberOfPhases( dim ) << " phases instead of "
+                << phases[ g ] << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    for( int k = -200; k <= 200; ++k )
+    {
+      const double cindex = offsets[ g ] + k * steps[ g ];
+
+      /** The start index as the weight functions compute it. */
+      const itk::IndexValueType startIndex = static_cast< itk::IndexValueType >(
+        vcl_floor( cindex - static_cast< double >( SplineOrder - 1 ) / 2.0 ) );
+
+      itk::IndexValueType tableStartIndex = 0;
+      const double *      weights = table.Lookup( dim, cindex, tableStartIndex, TableType::Weights );
+      const double *      derivativeWeights = table.LookupAtStartIndex(
+        dim, cindex, startIndex, TableType::DerivativeWeights );
+      const double * secondOrderDerivativeWeights = table.LookupAtStartIndex(
+        dim, cindex, startIndex, TableType::SecondOrderDerivativeWeights );
+      const double * supportDerivativeWeights = table.LookupAtStartIndex(
+        dim, cindex, startIndex, TableType::SupportDerivativeWeights );
+      if( weights == 0 || derivativeWeights == 0 || secondOrderDerivativeWeights == 0
+        || supportDerivativeWeights == 0 )
+      {
+        std::cerr << "ERROR: the continuous index " << cindex
+                  << " is not found in the table." << std::endl;
+        return EXIT_FAILURE;
+      }
+      if( tableStartIndex != startIndex )
+      {
+        std::cerr << "ERROR: the start index of " << cindex << " is "
+                  << tableStartIndex << " instead of " << startIndex << "." << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      /** Compare with the kernels, evaluated per support point, and for the
+       * whole support at once.
+       */
+      double supportWeights[ SupportSize ];
+      derivativeKernel->Evaluate( cindex - static_cast< double >( startIndex ), supportWeights );
+      for( unsigned int j = 0; j < SupportSize; ++j )
+      {
+        const double u = cindex - static_cast< double >( startIndex + j );
+        if( vcl_abs( weights[ j ] - kernel->Evaluate( u ) ) > distance
+          || vcl_abs( derivativeWeights[ j ] - derivativeKernel->Evaluate( u ) ) > distance
+          || vcl_abs( secondOrderDerivativeWeights[ j ]
+          - secondOrderDerivativeKernel->Evaluate( u ) ) > distance
+          || vcl_abs( supportDerivativeWeights[ j ] - supportWeights[ j ] ) > distance )
+        {
+          std::cerr << "ERROR: the weights of the continuous index " << cindex
+                    << " differ from the kernels at support index " << j << "." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+      ++numberOfLookups;
+
+      /** A position between the samples should not be found. */
+      if( table.Lookup( dim, cindex + 0.01 * steps[ g ], tableStartIndex, TableType::Weights ) != 0 )
+      {
+        std::cerr << "ERROR: the continuous index " << cindex + 0.01 * steps[ g ]
+                  << " is found in the table, but is not on the sample grid." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** A step that is not a ratio with a small denominator is rejected, and
+   * disables the table for that dimension only.
+   */
+  if( table.SetSampleGrid( 1, 0.0, 0.07 ) || table.GetNumberOfPhases( 1 ) != 0 )
+  {
+    std::cerr << "ERROR: the sample grid with step 0.07 is accepted." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if( !table.IsEnabled() )
+  {
+    std::cerr << "ERROR: the table is disabled for all dimensions." << std::endl;
+    return EXIT_FAILURE;
+  }
+  table.RemoveSampleGrid();
+  itk::IndexValueType dummy = 0;
+  if( table.IsEnabled() || table.Lookup( 0, 0.0, dummy, TableType::Weights ) != 0 )
+  {
+    std::cerr << "ERROR: the table is not disabled by RemoveSampleGrid()." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "Compared " << numberOfLookups << " table lookups with the kernels." << std::endl;
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
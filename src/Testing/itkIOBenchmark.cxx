@@ -0,0 +1,644 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Benchmarks the file input and output at the start and end of elastix and
+ * transformix runs:
+ * \li TransformParameters: writing and reading the TransformParameters of
+ *   growing B-spline grids, as text, and as a binary sidecar of doubles or
+ *   floats. This is done like TransformBase::WriteToFile and ReadFromFile:
+ *   the text is read with the ParameterFileParser and ParameterMapInterface,
+ *   the sidecar is read through a MemoryMappedFile.
+ * \li PointFile: reading large input point files with the
+ *   TransformixInputPointFileReader.
+ * \li ResultImage: writing the result image with the ImageFileCastWriter,
+ *   without compression, with compression, and with parallel compression
+ *   at the default and the fastest level.
+ * \li MevisDicomTiff: reading a MevisDicomTiff image, if elastix is built
+ *   with ELASTIX_USE_MEVISDICOMTIFF.
+ * \li Log: writing log lines that are flushed one by one, with the
+ *   AsynchronousOutputFileStream in synchronous and asynchronous mode.
+ *
+ * The results are written in JSON format, one result per line. Each result
+ * also holds its time relative to the first variant of the same benchmark
+ * and size, i.e. the text and synchronous variants.
+ */
+
+#include "itkCommandLineArgumentParser.h"
+
+#include "itkParameterFileParser.h"
+#include "itkParameterMapInterface.h"
+#include "itkMemoryMappedFile.h"
+#include "itkTransformixInputPointFileReader.h"
+#include "itkImageFileCastWriter.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkAsynchronousOutputFileStream.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkByteSwapper.h"
+#include "itkPointSet.h"
+#include "itkTimeProbe.h"
+#include "itkUseMevisDicomTiff.h"
+
+#include <itksys/SystemTools.hxx>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image< float, Dimension >                          ImageType;
+typedef itk::ImageFileCastWriter< ImageType >                   CastWriterType;
+typedef itk::DefaultStaticMeshTraits< bool, Dimension, Dimension, double >
+  MeshTraitsType;
+typedef itk::PointSet< bool, Dimension, MeshTraitsType >        PointSetType;
+typedef itk::TransformixInputPointFileReader< PointSetType >    PointReaderType;
+typedef itk::ParameterFileParser                                ParserType;
+typedef itk::ParameterMapInterface                              InterfaceType;
+
+/** The result of one measurement. */
+struct IOResult
+{
+  std::string        Benchmark;
+  std::string        Variant;
+  itk::SizeValueType Size;
+  itk::SizeValueType Bytes;
+  double             Seconds;
+  double             Relative;
+};
+
+/**
+ * ******************* GetFileSize *******************
+ */
+
+itk::SizeValueType
+GetFileSize( const std::string & fileName )
+{
+  return static_cast< itk::SizeValueType >(
+    itksys::SystemTools::FileLength( fileName.c_str() ) );
+
+} // end GetFileSize()
+
+
+/**
+ * ******************* CreateImage *******************
+ *
+ * Creates an image of smooth blobs with a little noise, so that the
+ * compression ratio is realistic.
+ */
+
+ImageType::Pointer
+CreateImage( const unsigned int sizePerDimension )
+{
+  ImageType::SizeType size;
+  size.Fill( sizePerDimension );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  unsigned int                                   seed = 1;
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 100.0 * vcl_sin( it.GetIndex()[ d ] * 0.1 );
+    }
+    seed = seed * 1103515245u + 12345u;
+    it.Set( static_cast< float >( value + ( seed >> 28 ) ) );
+  }
+  return image;
+
+} // end CreateImage()
+
+
+/**
+ * ******************* TimeTransformParameters *******************
+ *
+ * Writes and reads the TransformParameters of a 3D B-spline with
+ * \a gridSize control points per dimension, for each variant.
+ */
+
+void
+TimeTransformParameters( const std::string & directory, const unsigned int gridSize,
+  const unsigned int numberOfIterations, std::vector< IOResult > & results )
+{
+  const std::size_t     nrP = Dimension * gridSize * gridSize * gridSize;
+  std::vector< double > param( nrP );
+  for( std::size_t i = 0; i < nrP; ++i )
+  {
+    param[ i ] = 10.0 * vcl_sin( i * 0.001 ) + 1e-7 * i;
+  }
+
+  const std::string variants[] = { "text", "binaryDouble", "binaryFloat" };
+  for( unsigned int v = 0; v < 3; ++v )
+  {
+    const std::string parameterFileName = directory + "/IOBenchmark.TransformParameters.txt";
+    const std::string binaryFileName    = directory + "/IOBenchmark.TransformParameters.bin";
+    const bool        useFloat          = variants[ v ] == "binaryFloat";
+
+    /** Write, like TransformBase::WriteToFile. */
+    itk::TimeProbe writeTimer;
+    for( unsigned int it = 0; it < numberOfIterations; ++it )
+    {
+      writeTimer.Start();
+      std::ofstream file( parameterFileName.c_str() );
+      file << "(Transform \"RecursiveBSplineTransform\")\n"
+           << "(NumberOfParameters " << nrP << ")\n";
+      if( variants[ v ] == "text" )
+      {
+        file << std::setprecision( 6 ) << "(TransformParameters ";
+        for( std::size_t i = 0; i < nrP - 1; ++i )
+        {
+          file << param[ i ] << " ";
+        }
+        file << param[ nrP - 1 ] << ")\n";
+      }
+      else
+      {
+        std::ofstream binaryFile( binaryFileName.c_str(), std::ios::out | std::ios::binary );
+        if( useFloat )
+        {
+          std::vector< float > values( param.begin(), param.end() );
+          itk::ByteSwapper< float >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+          binaryFile.write( reinterpret_cast< const char * >( &values[ 0 ] ), nrP * sizeof( float ) );
+        }
+        else
+        {
+          std::vector< double > values( param );
+          itk::ByteSwapper< double >::SwapRangeFromSystemToLittleEndian( &values[ 0 ], nrP );
+          binaryFile.write( reinterpret_cast< const char * >( &values[ 0 ] ), nrP * sizeof( double ) );
+        }
+        file << "(TransformParametersBinaryFileName \"IOBenchmark.TransformParameters.bin\")\n"
+             << "(TransformParametersBinaryType \"" << ( useFloat ? "float" : "double" ) << "\")\n";
+      }
+      file.close();
+      writeTimer.Stop();
+    }
+
+    itk::SizeValueType bytes = GetFileSize( parameterFileName );
+    if( variants[ v ] != "text" )
+    {
+      bytes += GetFileSize( binaryFileName );
+    }
+
+    /** Read, like TransformBase::ReadFromFile. */
+    itk::TimeProbe readTimer;
+    for( unsigned int it = 0; it < numberOfIterations; ++it )
+    {
+      readTimer.Start();
+      ParserType::Pointer parser = ParserType::New();
+      parser->SetParameterFileName( parameterFileName );
+      parser->ReadParameterFile();
+      InterfaceType::Pointer configuration = InterfaceType::New();
+      configuration->SetParameterMap( parser->GetParameterMap() );
+
+      std::vector< double > readParam( nrP, 0.0 );
+      std::string           errorMessage = "";
+      if( variants[ v ] == "text" )
+      {
+        configuration->ReadParameter( readParam, "TransformParameters",
+          0, nrP - 1, true, errorMessage );
+      }
+      else
+      {
+        itk::MemoryMappedFile::Pointer binaryFile = itk::MemoryMappedFile::New();
+        binaryFile->Open( binaryFileName );
+        if( useFloat )
+        {
+          float * values = reinterpret_cast< float * >( binaryFile->GetData() );
+          itk::ByteSwapper< float >::SwapRangeFromSystemToLittleEndian( values, nrP );
+          std::copy( values, values + nrP, readParam.begin() );
+        }
+        else
+        {
+          double * values = reinterpret_cast< double * >( binaryFile->GetData() );
+          itk::ByteSwapper< double >::SwapRangeFromSystemToLittleEndian( values, nrP );
+          std::copy( values, values + nrP, readParam.begin() );
+        }
+      }
+      readTimer.Stop();
+      if( !errorMessage.empty() )
+      {
+        itkGenericExceptionMacro( << errorMessage );
+      }
+    }
+
+    IOResult result;
+    result.Benchmark = "TransformParametersWrite";
+    result.Variant   = variants[ v ];
+    result.Size      = nrP;
+    result.Bytes     = bytes;
+    result.Seconds   = writeTimer.GetMean();
+    results.push_back( result );
+    result.Benchmark = "TransformParametersRead";
+    result.Seconds   = readTimer.GetMean();
+    results.push_back( result );
+
+    itksys::SystemTools::RemoveFile( parameterFileName.c_str() );
+    itksys::SystemTools::RemoveFile( binaryFileName.c_str() );
+  }
+
+} // end TimeTransformParameters()
+
+
+/**
+ * ******************* TimePointFile *******************
+ *
+ * Reads an input point file of \a numberOfPoints points.
+ */
+
+void
+TimePointFile( const std::string & directory, const unsigned int numberOfPoints,
+  const unsigned int numberOfIterations, std::vector< IOResult > & results )
+{
+  const std::string fileName = directory + "/IOBenchmark.inputpoints.txt";
+  std::ofstream     file( fileName.c_str() );
+  file << "point\n" << numberOfPoints << "\n" << std::setprecision( 8 );
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    file << 0.37 * i << " " << 100.0 + 0.11 * i << " " << 0.5 * ( i % 1000 ) << "\n";
+  }
+  file.close();
+
+  itk::TimeProbe timer;
+  for( unsigned int it = 0; it < numberOfIterations; ++it )
+  {
+    PointReaderType::Pointer reader = PointReaderType::New();
+    reader->SetFileName( fileName.c_str() );
+    timer.Start();
+    reader->Update();
+    timer.Stop();
+    if( reader->GetNumberOfPoints() != numberOfPoints )
+    {
+      itkGenericExceptionMacro( << "Read " << reader->GetNumberOfPoints()
+                                << " points instead of " << numberOfPoints );
+    }
+  }
+
+  IOResult result;
+  result.Benchmark = "PointFileRead";
+  result.Variant   = "text";
+  result.Size      = numberOfPoints;
+  result.Bytes     = GetFileSize( fileName );
+  result.Seconds   = timer.GetMean();
+  results.push_back( result );
+
+  itksys::SystemTools::RemoveFile( fileName.c_str() );
+
+} // end TimePointFile()
+
+
+/**
+ * ******************* TimeResultImage *******************
+ *
+ * Writes the result image like elastix does, as shorts, without compression,
+ * with compression, and with parallel compression at levels 6 and 1.
+ */
+
+void
+TimeResultImage( const std::string & directory, const ImageType * image,
+  const unsigned int numberOfIterations, std::vector< IOResult > & results )
+{
+  const std::string fileName = directory + "/IOBenchmark.result.mha";
+  const char * variants[ 4 ] = { "uncompressed", "compressed", "parallel", "parallel-level1" };
+  for( unsigned int compression = 0; compression < 4; ++compression )
+  {
+    itk::TimeProbe timer;
+    for( unsigned int it = 0; it < numberOfIterations; ++it )
+    {
+      CastWriterType::Pointer writer = CastWriterType::New();
+      writer->SetInput( image );
+      writer->SetFileName( fileName.c_str() );
+      writer->SetOutputComponentType( "short" );
+      writer->SetUseCompression( compression >= 1 );
+      writer->SetUseParallelCompression( compression >= 2 );
+      writer->SetCompressionLevel( compression == 3 ? 1 : 6 );
+      timer.Start();
+      writer->Update();
+      timer.Stop();
+    }
+
+    IOResult result;
+    result.Benchmark = "ResultImageWrite";
+    result.Variant   = variants[ compression ];
+    result.Size      = image->GetLargestPossibleRegion().GetNumberOfPixels();
+    result.Bytes     = GetFileSize( fileName );
+    result.Seconds   = timer.GetMean();
+    results.push_back( result );
+  }
+  itksys::SystemTools::RemoveFile( fileName.c_str() );
+
+} // end TimeResultImage()
+
+
+#ifdef _ELASTIX_USE_MEVISDICOMTIFF
+/**
+ * ******************* TimeMevisDicomTiff *******************
+ *
+ * Reads a MevisDicomTiff image, i.e. a .dcm header and a .tif file.
+ */
+
+void
+TimeMevisDicomTiff( const std::string & directory, const ImageType * image,
+  const unsigned int numberOfIterations, std::vector< IOResult > & results )
+{
+  const std::string fileName = directory + "/IOBenchmark.result.tif";
+
+  typedef itk::Image< short, Dimension >         ShortImageType;
+  typedef itk::ImageFileReader< ShortImageType > ReaderType;
+
+  CastWriterType::Pointer writer = CastWriterType::New();
+  writer->SetInput( image );
+  writer->SetFileName( fileName.c_str() );
+  writer->SetOutputComponentType( "short" );
+  writer->Update();
+
+  itk::TimeProbe timer;
+  for( unsigned int it = 0; it < numberOfIterations; ++it )
+  {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( fileName.c_str() );
+    timer.Start();
+    reader->Update();
+    timer.Stop();
+  }
+
+  const std::string headerFileName
+    = itksys::SystemTools::GetFilenameWithoutLastExtension( fileName ) + ".dcm";
+  const std::string headerPath = directory + "/" + headerFileName;
+
+  IOResult result;
+  result.Benchmark = "MevisDicomTiffRead";
+  result.Variant   = "uncompressed";
+  result.Size      = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  result.Bytes     = GetFileSize( fileName ) + GetFileSize( headerPath );
+  result.Seconds   = timer.GetMean();
+  results.push_back( result );
+
+  itksys::SystemTools::RemoveFile( fileName.c_str() );
+  itksys::SystemTools::RemoveFile( headerPath.c_str() );
+
+} // end TimeMevisDicomTiff()
+
+
+#endif
+
+/**
+ * ******************* TimeLog *******************
+ *
+ * Writes \a numberOfLines lines that look like the iteration info, each
+ * followed by a flush, like xout does.
+ */
+
+void
+TimeLog( const std::string & directory, const unsigned int numberOfLines,
+  const unsigned int numberOfIterations, std::vector< IOResult > & results )
+{
+  const std::string fileName = directory + "/IOBenchmark.log.txt";
+  for( unsigned int asynchronous = 0; asynchronous < 2; ++asynchronous )
+  {
+    itk::AsynchronousOutputFileStream::SetAsynchronous( asynchronous == 1 );
+
+    itk::TimeProbe timer;
+    for( unsigned int it = 0; it < numberOfIterations; ++it )
+    {
+      timer.Start();
+      itk::AsynchronousOutputFileStream log;
+      log.open( fileName.c_str() );
+      for( unsigned int i = 0; i < numberOfLines; ++i )
+      {
+        log << i << "\t" << std::setprecision( 6 ) << -0.5 / ( i + 1 )
+            << "\t" << 0.25 << "\t" << 1.0 / ( i + 1 ) << "\t0.001" << std::endl;
+      }
+      log.close();
+      timer.Stop();
+    }
+
+    IOResult result;
+    result.Benchmark = "LogWrite";
+    result.Variant   = asynchronous == 1 ? "asynchronous" : "synchronous";
+    result.Size      = numberOfLines;
+    result.Bytes     = GetFileSize( fileName );
+    result.Seconds   = timer.GetMean();
+    results.push_back( result );
+  }
+  itk::AsynchronousOutputFileStream::SetAsynchronous( false );
+  itksys::SystemTools::RemoveFile( fileName.c_str() );
+
+} // end TimeLog()
+
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "itkIOBenchmark" << std::endl
+     << "  [-out]          output JSON file, default: only print to the screen\n"
+     << "  [-dir]          directory for the temporary files, default: the current directory\n"
+     << "  [-benchmark]    benchmarks, default: TransformParameters PointFile ResultImage\n"
+     << "                  MevisDicomTiff Log\n"
+     << "  [-grid]         B-spline grid sizes per dimension, default: 10 20 40 80\n"
+     << "  [-points]       numbers of points, default: 10000 100000 1000000\n"
+     << "  [-size]         image sizes per dimension, default: 128 256\n"
+     << "  [-lines]        numbers of log lines, default: 10000 100000\n"
+     << "  [-iterations]   repetitions per measurement, default: 3";
+  return ss.str();
+
+} // end GetHelpString()
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText( GetHelpString() );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  /** Support Mevis Dicom Tiff (if selected in cmake) */
+  RegisterMevisDicomTiff();
+
+  /** Get the arguments. */
+  std::vector< std::string > benchmarks;
+  benchmarks.push_back( "TransformParameters" );
+  benchmarks.push_back( "PointFile" );
+  benchmarks.push_back( "ResultImage" );
+#ifdef _ELASTIX_USE_MEVISDICOMTIFF
+  benchmarks.push_back( "MevisDicomTiff" );
+#endif
+  benchmarks.push_back( "Log" );
+  parser->GetCommandLineArgument( "-benchmark", benchmarks );
+
+  std::vector< unsigned int > gridSizes;
+  gridSizes.push_back( 10 );
+  gridSizes.push_back( 20 );
+  gridSizes.push_back( 40 );
+  gridSizes.push_back( 80 );
+  parser->GetCommandLineArgument( "-grid", gridSizes );
+
+  std::vector< unsigned int > numbersOfPoints;
+  numbersOfPoints.push_back( 10000 );
+  numbersOfPoints.push_back( 100000 );
+  numbersOfPoints.push_back( 1000000 );
+  parser->GetCommandLineArgument( "-points", numbersOfPoints );
+
+  std::vector< unsigned int > imageSizes;
+  imageSizes.push_back( 128 );
+  imageSizes.push_back( 256 );
+  parser->GetCommandLineArgument( "-size", imageSizes );
+
+  std::vector< unsigned int > numbersOfLines;
+  numbersOfLines.push_back( 10000 );
+  numbersOfLines.push_back( 100000 );
+  parser->GetCommandLineArgument( "-lines", numbersOfLines );
+
+  unsigned int numberOfIterations = 3;
+  parser->GetCommandLineArgument( "-iterations", numberOfIterations );
+
+  std::string directory = ".";
+  parser->GetCommandLineArgument( "-dir", directory );
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+
+  /** Run the benchmarks. */
+  std::vector< IOResult > results;
+  try
+  {
+    for( std::size_t b = 0; b < benchmarks.size(); ++b )
+    {
+      if( benchmarks[ b ] == "TransformParameters" )
+      {
+        for( std::size_t i = 0; i < gridSizes.size(); ++i )
+        {
+          TimeTransformParameters( directory, gridSizes[ i ], numberOfIterations, results );
+        }
+      }
+      else if( benchmarks[ b ] == "PointFile" )
+      {
+        for( std::size_t i = 0; i < numbersOfPoints.size(); ++i )
+        {
+          TimePointFile( directory, numbersOfPoints[ i ], numberOfIterations, results );
+        }
+      }
+      else if( benchmarks[ b ] == "ResultImage" || benchmarks[ b ] == "MevisDicomTiff" )
+      {
+        for( std::size_t i = 0; i < imageSizes.size(); ++i )
+        {
+          const ImageType::Pointer image = CreateImage( imageSizes[ i ] );
+          if( benchmarks[ b ] == "ResultImage" )
+          {
+            TimeResultImage( directory, image, numberOfIterations, results );
+          }
+          else
+          {
+#ifdef _ELASTIX_USE_MEVISDICOMTIFF
+            TimeMevisDicomTiff( directory, image, numberOfIterations, results );
+#else
+            std::cerr << "ERROR: MevisDicomTiff requires ELASTIX_USE_MEVISDICOMTIFF" << std::endl;
+            return EXIT_FAILURE;
+#endif
+          }
+        }
+      }
+      else if( benchmarks[ b ] == "Log" )
+      {
+        for( std::size_t i = 0; i < numbersOfLines.size(); ++i )
+        {
+          TimeLog( directory, numbersOfLines[ i ], numberOfIterations, results );
+        }
+      }
+      else
+      {
+        std::cerr << "ERROR: unknown benchmark " << benchmarks[ b ] << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: caught ITK exception: " << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The time relative to the first variant of the same benchmark and size. */
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    std::size_t j = 0;
+    while( results[ j ].Benchmark != results[ i ].Benchmark || results[ j ].Size != results[ i ].Size )
+    {
+      ++j;
+    }
+    results[ i ].Relative = results[ j ].Seconds > 0.0 ? results[ i ].Seconds / results[ j ].Seconds : 1.0;
+
+    std::cerr << std::left << std::setw( 26 ) << results[ i ].Benchmark
+              << std::setw( 14 ) << results[ i ].Variant
+              << std::right << std::setw( 10 ) << results[ i ].Size
+              << std::fixed << std::setprecision( 4 ) << std::setw( 12 ) << results[ i ].Seconds << " s"
+              << std::setprecision( 2 ) << std::setw( 8 ) << results[ i ].Relative << "x" << std::endl;
+  }
+
+  /** Write the results. */
+  std::ofstream outputFile;
+  if( !outputFileName.empty() )
+  {
+    outputFile.open( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream & os = outputFileName.empty() ? std::cout : outputFile;
+  os << "[";
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    const IOResult & result = results[ i ];
+    os << ( i == 0 ? "\n" : ",\n" )
+       << "  { \"benchmark\": \"" << result.Benchmark
+       << "\", \"variant\": \"" << result.Variant
+       << "\", \"size\": " << result.Size
+       << ", \"bytes\": " << result.Bytes
+       << ", \"seconds\": " << std::fixed << std::setprecision( 6 ) << result.Seconds
+       << ", \"relative\": " << std::setprecision( 3 ) << result.Relative << " }";
+  }
+  os << "\n]\n";
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,190 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkImageRandomSamplerSparseMask.h"
+#include "itkImageFullSampler.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test compares the ImageRandomSamplerSparseMask, which draws its samples
+// from an index of the runs of valid voxels, with the way it used to draw them:
+// a random element of the output of an ImageFullSampler over the same mask and
+// region. With the same random sequence both should give the same samples,
+// single- and multi-threaded, also after the mask has changed.
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image< float, Dimension >                     ImageType;
+typedef itk::Image< unsigned char, Dimension >             MaskImageType;
+typedef itk::ImageMaskSpatialObject2< Dimension >          MaskType;
+typedef itk::ImageRandomSamplerSparseMask< ImageType >     SparseMaskSamplerType;
+typedef itk::ImageFullSampler< ImageType >                 FullSamplerType;
+typedef SparseMaskSamplerType::ImageSampleContainerType     SampleContainerType;
+typedef SparseMaskSamplerType::RandomGeneratorType         RandomGeneratorType;
+
+/** Fills the mask with a ball, of which the voxels with
+ * ( x + 2y + 3z ) % modulus == 0 are left out, so that it has many runs.
+ */
+void
+FillMask( MaskImageType * maskImage, const unsigned int modulus )
+{
+  const MaskImageType::SizeType size = maskImage->GetLargestPossibleRegion().GetSize();
+  itk::ImageRegionIteratorWithIndex< MaskImageType > it( maskImage,
+    maskImage->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const MaskImageType::IndexType index = it.GetIndex();
+    double                         distance2 = 0.0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double r = ( index[ d ] - size[ d ] / 2.0 ) / ( size[ d ] / 2.0 );
+      distance2 += r * r;
+    }
+    const bool hole = ( index[ 0 ] + 2 * index[ 1 ] + 3 * index[ 2 ] ) % modulus == 0;
+    it.Set( distance2 < 0.8 && !hole ? 1 : 0 );
+  }
+  maskImage->Modified();
+
+} // end FillMask()
+
+
+/** Compares the samples of the sparse mask sampler with the samples
+ * that the old implementation would draw from the full sampler.
+ */
+bool
+CompareSamples( SparseMaskSamplerType * sparseSampler, FullSamplerType * fullSampler,
+  const unsigned int seed )
+{
+  fullSampler->Modified();
+  fullSampler->Update();
+  SampleContainerType::Pointer validVoxels = fullSampler->GetOutput();
+  const unsigned long          numberOfValidVoxels = validVoxels->Size();
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->Initialize( seed );
+  sparseSampler->Modified();
+  sparseSampler->Update();
+  SampleContainerType::Pointer samples = sparseSampler->GetOutput();
+
+  if( samples->Size() != sparseSampler->GetNumberOfSamples() )
+  {
+    std::cerr << "ERROR: got " << samples->Size() << " samples instead of "
+              << sparseSampler->GetNumberOfSamples() << "." << std::endl;
+    return false;
+  }
+
+  randomGenerator->Initialize( seed );
+  for( unsigned long i = 0; i < samples->Size(); ++i )
+  {
+    const unsigned long randomIndex
+      = randomGenerator->GetIntegerVariate( numberOfValidVoxels - 1 );
+    const SampleContainerType::Element & expected = validVoxels->ElementAt( randomIndex );
+    const SampleContainerType::Element & actual   = samples->ElementAt( i );
+    if( actual.m_ImageCoordinates != expected.m_ImageCoordinates
+      || actual.m_ImageValue != expected.m_ImageValue )
+    {
+      std::cerr << "ERROR: sample " << i << " is " << actual.m_ImageCoordinates
+                << " with value " << actual.m_ImageValue << ", but the full sampler gives "
+                << expected.m_ImageCoordinates << " with value "
+                << expected.m_ImageValue << "." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CompareSamples()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Create an anisotropic, non-trivially placed input image. */
+  ImageType::SizeType size;
+  size[ 0 ] = 21; size[ 1 ] = 18; size[ 2 ] = 16;
+  ImageType::SpacingType spacing;
+  spacing[ 0 ] = 1.0; spacing[ 1 ] = 1.5; spacing[ 2 ] = 2.0;
+  ImageType::PointType origin;
+  origin[ 0 ] = -10.0; origin[ 1 ] = 3.0; origin[ 2 ] = 0.5;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    it.Set( static_cast< float >( index[ 0 ] + 100 * index[ 1 ] + 10000 * index[ 2 ] ) );
+  }
+
+  /** Create the mask, on the same grid. */
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation( image );
+  maskImage->SetRegions( size );
+  maskImage->Allocate();
+  FillMask( maskImage, 5 );
+  MaskType::Pointer mask = MaskType::New();
+  mask->SetImage( maskImage );
+
+  /** A region that crops the ball, to test the offsets in the region. */
+  ImageType::RegionType region;
+  region.SetIndex( 0, 2 ); region.SetIndex( 1, 3 ); region.SetIndex( 2, 1 );
+  region.SetSize( 0, 15 ); region.SetSize( 1, 13 ); region.SetSize( 2, 12 );
+
+  /** Set up the samplers. */
+  FullSamplerType::Pointer fullSampler = FullSamplerType::New();
+  fullSampler->SetInput( image );
+  fullSampler->SetMask( mask );
+  fullSampler->SetInputImageRegion( region );
+
+  SparseMaskSamplerType::Pointer sparseSampler = SparseMaskSamplerType::New();
+  sparseSampler->SetInput( image );
+  sparseSampler->SetMask( mask );
+  sparseSampler->SetInputImageRegion( region );
+  sparseSampler->SetNumberOfSamples( 5000 );
+
+  /** Compare single- and multi-threaded. */
+  if( !CompareSamples( sparseSampler, fullSampler, 12345 ) )
+  {
+    return EXIT_FAILURE;
+  }
+  sparseSampler->SetUseMultiThread( true );
+  sparseSampler->SetNumberOfThreads( 4 );
+  if( !CompareSamples( sparseSampler, fullSampler, 67890 ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Change the mask, which should rebuild the index, and compare again. */
+  FillMask( maskImage, 3 );
+  mask->SetImage( maskImage );
+  mask->Modified();
+  sparseSampler->SetUseMultiThread( false );
+  if( !CompareSamples( sparseSampler, fullSampler, 24680 ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
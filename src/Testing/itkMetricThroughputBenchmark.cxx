@@ -0,0 +1,641 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Measures the throughput of GetValueAndDerivative() of the multi-threaded
+ * metrics, on synthetic 2D and 3D images, for several transforms, numbers of
+ * samples and numbers of threads. The results, in samples per second, and the
+ * scaling efficiency with respect to the smallest number of threads, are
+ * written in JSON format. Optionally, they are compared to a baseline file
+ * written by a previous run, and to a minimum scaling efficiency, to flag
+ * performance regressions.
+ */
+
+#include "itkCommandLineArgumentParser.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "NormalizedMutualInformation/itkParzenWindowNormalizedMutualInformationImageToImageMetric.h"
+#include "AdvancedKappaStatistic/itkAdvancedKappaStatisticImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkEulerTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include "itkImageRandomSampler.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreader.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** The settings of a benchmark run. */
+struct BenchmarkSettings
+{
+  std::vector< unsigned int >  Dimensions;
+  std::vector< unsigned long > NumberOfSamples;
+  std::vector< unsigned int >  NumberOfThreads;
+  std::vector< std::string >   Metrics;
+  std::vector< std::string >   Transforms;
+  unsigned int                 NumberOfIterations;
+};
+
+/** The result of a single benchmark. */
+struct BenchmarkResult
+{
+  std::string   Name;
+  std::string   Metric;
+  std::string   Transform;
+  unsigned int  Dimension;
+  unsigned long NumberOfSamples;
+  unsigned int  NumberOfThreads;
+  double        SamplesPerSecond;
+  double        ScalingEfficiency;
+};
+
+typedef std::vector< BenchmarkResult > BenchmarkResultContainer;
+
+/**
+ * ******************* Contains *******************
+ */
+
+bool
+Contains( const std::vector< std::string > & names, const std::string & name )
+{
+  return std::find( names.begin(), names.end(), name ) != names.end();
+
+} // end Contains()
+
+
+/**
+ * ******************* CreateImage *******************
+ *
+ * Creates an image of a few smooth blobs on a sinusoidal background, so
+ * that the gradient is nonzero almost everywhere. The blobs are shifted by
+ * \a shift voxels in every direction.
+ */
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const unsigned int sizePerDimension, const double shift )
+{
+  const unsigned int Dimension = TImage::ImageDimension;
+
+  typename TImage::SizeType size;
+  size.Fill( sizePerDimension );
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< TImage > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const typename TImage::IndexType index = it.GetIndex();
+    double                           value = 0.0;
+    for( unsigned int blob = 1; blob <= 3; ++blob )
+    {
+      double distance2 = 0.0;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        const double center = sizePerDimension * blob / 4.0 + shift;
+        distance2 += ( index[ d ] - center ) * ( index[ d ] - center );
+      }
+      value += 100.0 * vcl_exp( -distance2 / ( 2.0 * sizePerDimension * sizePerDimension / 64.0 ) );
+    }
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 10.0 * vcl_sin( ( index[ d ] + shift ) * 0.2 );
+    }
+    it.Set( static_cast< typename TImage::PixelType >( value ) );
+  }
+
+  return image;
+
+} // end CreateImage()
+
+
+/**
+ * ******************* SetBSplineGrid *******************
+ *
+ * Places a cubic B-spline grid with a control point every 8 voxels on the
+ * image, and gives the control points a small deterministic displacement.
+ */
+
+template< class TBSplineTransform, class TImage >
+void
+SetBSplineGrid( TBSplineTransform * transform, const TImage * image )
+{
+  const unsigned int Dimension          = TImage::ImageDimension;
+  const unsigned int GridSpacingInVoxels = 8;
+
+  typename TBSplineTransform::RegionType  gridRegion;
+  typename TBSplineTransform::SizeType    gridSize;
+  typename TBSplineTransform::SpacingType gridSpacing;
+  typename TBSplineTransform::OriginType  gridOrigin;
+  const typename TImage::SizeType imageSize = image->GetLargestPossibleRegion().GetSize();
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSize[ d ]    = imageSize[ d ] / GridSpacingInVoxels + TBSplineTransform::SplineOrder;
+    gridSpacing[ d ] = image->GetSpacing()[ d ] * GridSpacingInVoxels;
+    gridOrigin[ d ]  = image->GetOrigin()[ d ] - gridSpacing[ d ];
+  }
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( image->GetDirection() );
+
+  typename TBSplineTransform::ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 0.5 * vcl_sin( 0.1 * i );
+  }
+  transform->SetParametersByValue( parameters );
+
+} // end SetBSplineGrid()
+
+
+/**
+ * ******************* CreateTransform *******************
+ *
+ * Creates the transform \a name, wrapped in a combination transform,
+ * like elastix does.
+ */
+
+template< class TImage >
+typename itk::AdvancedCombinationTransform< double, TImage::ImageDimension >::Pointer
+CreateTransform( const std::string & name, const TImage * image )
+{
+  const unsigned int Dimension = TImage::ImageDimension;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >                 CombinationTransformType;
+  typedef itk::EulerTransform< double, Dimension >                               EulerTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension > AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >        BSplineTransformType;
+  typedef itk::RecursiveBSplineTransform< double, Dimension, 3 >                 RecursiveBSplineTransformType;
+
+  /** The center of rotation of the linear transforms. */
+  typename AffineTransformType::InputPointType center;
+  const typename TImage::SizeType              imageSize = image->GetLargestPossibleRegion().GetSize();
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    center[ d ] = image->GetOrigin()[ d ] + image->GetSpacing()[ d ] * ( imageSize[ d ] - 1 ) / 2.0;
+  }
+
+  typename CombinationTransformType::Pointer combinationTransform = CombinationTransformType::New();
+  if( name == "Euler" || name == "Affine" )
+  {
+    typename AffineTransformType::Pointer transform;
+    if( name == "Euler" )
+    {
+      transform = EulerTransformType::New().GetPointer();
+    }
+    else
+    {
+      transform = AffineTransformType::New();
+    }
+    transform->SetIdentity();
+    transform->SetCenter( center );
+
+    /** A small rotation or shear, and translation. */
+    typename AffineTransformType::ParametersType parameters = transform->GetParameters();
+    for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+    {
+      parameters[ i ] += 0.01 * ( i + 1 );
+    }
+    transform->SetParameters( parameters );
+    combinationTransform->SetCurrentTransform( transform );
+  }
+  else if( name == "BSpline" )
+  {
+    typename BSplineTransformType::Pointer transform = BSplineTransformType::New();
+    SetBSplineGrid( transform.GetPointer(), image );
+    combinationTransform->SetCurrentTransform( transform );
+  }
+  else if( name == "RecursiveBSpline" )
+  {
+    typename RecursiveBSplineTransformType::Pointer transform = RecursiveBSplineTransformType::New();
+    SetBSplineGrid( transform.GetPointer(), image );
+    combinationTransform->SetCurrentTransform( transform );
+  }
+  else
+  {
+    itkGenericExceptionMacro( << "Unknown transform: " << name );
+  }
+
+  return combinationTransform;
+
+} // end CreateTransform()
+
+
+/**
+ * ******************* ConfigureMetric *******************
+ *
+ * Metric specific settings; the histogram based metrics compute their
+ * derivative only if asked for.
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ConfigureMetric( itk::AdvancedImageToImageMetric< TFixedImage, TMovingImage > * )
+{}
+
+template< class TFixedImage, class TMovingImage >
+void
+ConfigureMetric( itk::ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage > * metric )
+{
+  metric->SetUseDerivative( true );
+}
+
+
+/**
+ * ******************* RunMetricBenchmarks *******************
+ *
+ * Runs GetValueAndDerivative() of the metric \a metricName for all
+ * transforms, numbers of samples and numbers of threads.
+ */
+
+template< class TMetric >
+void
+RunMetricBenchmarks( const std::string & metricName,
+  const typename TMetric::FixedImageType * fixedImage,
+  const typename TMetric::MovingImageType * movingImage,
+  const BenchmarkSettings & settings,
+  BenchmarkResultContainer & results )
+{
+  typedef typename TMetric::FixedImageType                     FixedImageType;
+  typedef typename TMetric::MovingImageType                    MovingImageType;
+  typedef itk::ImageRandomSampler< FixedImageType >            ImageSamplerType;
+  typedef itk::BSplineInterpolateImageFunction<
+    MovingImageType, double, double >                          InterpolatorType;
+  typedef typename TMetric::TransformParametersType            ParametersType;
+  typedef typename TMetric::DerivativeType                     DerivativeType;
+  typedef typename TMetric::MeasureType                        MeasureType;
+
+  const unsigned int Dimension = FixedImageType::ImageDimension;
+
+  if( !Contains( settings.Metrics, metricName ) )
+  {
+    return;
+  }
+
+  for( std::size_t t = 0; t < settings.Transforms.size(); ++t )
+  {
+    for( std::size_t s = 0; s < settings.NumberOfSamples.size(); ++s )
+    {
+      double       referenceSamplesPerSecond = 0.0;
+      unsigned int referenceNumberOfThreads  = 0;
+      for( std::size_t n = 0; n < settings.NumberOfThreads.size(); ++n )
+      {
+        const unsigned int numberOfThreads = settings.NumberOfThreads[ n ];
+
+        /** Set up the metric like elastix does. */
+        typename ImageSamplerType::Pointer sampler = ImageSamplerType::New();
+        sampler->SetInput( fixedImage );
+        sampler->SetInputImageRegion( fixedImage->GetBufferedRegion() );
+        sampler->SetNumberOfSamples( settings.NumberOfSamples[ s ] );
+
+        typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+        interpolator->SetSplineOrder( 1 );
+
+        typename TMetric::AdvancedTransformType::Pointer transform
+          = CreateTransform( settings.Transforms[ t ], fixedImage ).GetPointer();
+
+        typename TMetric::Pointer metric = TMetric::New();
+        ConfigureMetric( metric.GetPointer() );
+        metric->SetFixedImage( fixedImage );
+        metric->SetMovingImage( movingImage );
+        metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+        metric->SetTransform( transform );
+        metric->SetInterpolator( interpolator );
+        metric->SetImageSampler( sampler );
+        metric->SetUseMultiThread( true );
+        metric->SetNumberOfThreads( numberOfThreads );
+        metric->Initialize();
+
+        /** The first call updates the sampler and warms up the caches. */
+        const ParametersType parameters = transform->GetParameters();
+        MeasureType          value;
+        DerivativeType       derivative;
+        metric->GetValueAndDerivative( parameters, value, derivative );
+        const unsigned long numberOfSamples = sampler->GetOutput()->Size();
+
+        itk::TimeProbe timer;
+        timer.Start();
+        for( unsigned int i = 0; i < settings.NumberOfIterations; ++i )
+        {
+          metric->GetValueAndDerivative( parameters, value, derivative );
+        }
+        timer.Stop();
+
+        BenchmarkResult result;
+        result.Metric           = metricName;
+        result.Transform        = settings.Transforms[ t ];
+        result.Dimension        = Dimension;
+        result.NumberOfSamples  = numberOfSamples;
+        result.NumberOfThreads  = numberOfThreads;
+        result.SamplesPerSecond = static_cast< double >( numberOfSamples )
+          * settings.NumberOfIterations / std::max( timer.GetTotal(), 1e-9 );
+
+        /** The scaling efficiency, with respect to the first number of threads. */
+        if( n == 0 )
+        {
+          referenceSamplesPerSecond = result.SamplesPerSecond;
+          referenceNumberOfThreads  = numberOfThreads;
+        }
+        result.ScalingEfficiency = ( result.SamplesPerSecond / referenceSamplesPerSecond )
+          * referenceNumberOfThreads / numberOfThreads;
+
+        std::ostringstream name;
+        name << result.Metric << "/" << result.Transform << "/" << Dimension << "D/"
+             << settings.NumberOfSamples[ s ] << "/" << numberOfThreads;
+        result.Name = name.str();
+
+        std::cerr << std::left << std::setw( 64 ) << result.Name << std::right
+                  << std::setw( 14 ) << static_cast< unsigned long >( result.SamplesPerSecond )
+                  << " samples/s" << std::setw( 8 ) << std::fixed << std::setprecision( 2 )
+                  << result.ScalingEfficiency << std::endl;
+        results.push_back( result );
+      }
+    }
+  }
+
+} // end RunMetricBenchmarks()
+
+
+/**
+ * ******************* RunBenchmarks *******************
+ */
+
+template< unsigned int Dimension >
+void
+RunBenchmarks( const BenchmarkSettings & settings, BenchmarkResultContainer & results )
+{
+  typedef itk::Image< float, Dimension > ImageType;
+
+  /** Roughly the same number of voxels in 2D and 3D. */
+  const unsigned int               sizePerDimension = Dimension == 2 ? 512 : 64;
+  typename ImageType::Pointer      fixedImage       = CreateImage< ImageType >( sizePerDimension, 0.0 );
+  typename ImageType::Pointer      movingImage      = CreateImage< ImageType >( sizePerDimension, 2.0 );
+
+  RunMetricBenchmarks< itk::AdvancedMeanSquaresImageToImageMetric< ImageType, ImageType > >(
+    "AdvancedMeanSquares", fixedImage, movingImage, settings, results );
+  RunMetricBenchmarks< itk::AdvancedNormalizedCorrelationImageToImageMetric< ImageType, ImageType > >(
+    "AdvancedNormalizedCorrelation", fixedImage, movingImage, settings, results );
+  RunMetricBenchmarks< itk::ParzenWindowMutualInformationImageToImageMetric< ImageType, ImageType > >(
+    "AdvancedMattesMutualInformation", fixedImage, movingImage, settings, results );
+  RunMetricBenchmarks< itk::ParzenWindowNormalizedMutualInformationImageToImageMetric< ImageType, ImageType > >(
+    "NormalizedMutualInformation", fixedImage, movingImage, settings, results );
+  RunMetricBenchmarks< itk::AdvancedKappaStatisticImageToImageMetric< ImageType, ImageType > >(
+    "AdvancedKappaStatistic", fixedImage, movingImage, settings, results );
+
+} // end RunBenchmarks()
+
+
+/**
+ * ******************* WriteResults *******************
+ */
+
+void
+WriteResults( std::ostream & os, const BenchmarkResultContainer & results )
+{
+  /** One benchmark per line, which is what ReadBaseline() expects. */
+  os << "{\n  \"benchmarks\": [\n";
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    const BenchmarkResult & result = results[ i ];
+    os << "    { \"name\": \"" << result.Name
+       << "\", \"metric\": \"" << result.Metric
+       << "\", \"transform\": \"" << result.Transform
+       << "\", \"dimension\": " << result.Dimension
+       << ", \"samples\": " << result.NumberOfSamples
+       << ", \"threads\": " << result.NumberOfThreads
+       << ", \"samplesPerSecond\": " << std::fixed << std::setprecision( 1 ) << result.SamplesPerSecond
+       << ", \"scalingEfficiency\": " << std::setprecision( 4 ) << result.ScalingEfficiency
+       << " }" << ( i + 1 < results.size() ? ",\n" : "\n" );
+  }
+  os << "  ]\n}\n";
+
+} // end WriteResults()
+
+
+/**
+ * ******************* ReadBaseline *******************
+ *
+ * Reads the samples per second of each benchmark from a file written
+ * by WriteResults().
+ */
+
+bool
+ReadBaseline( const std::string & fileName, std::map< std::string, double > & baseline )
+{
+  std::ifstream file( fileName.c_str() );
+  if( !file.is_open() )
+  {
+    return false;
+  }
+
+  const std::string nameKey  = "\"name\": \"";
+  const std::string valueKey = "\"samplesPerSecond\": ";
+  std::string       line;
+  while( std::getline( file, line ) )
+  {
+    const std::string::size_type namePos  = line.find( nameKey );
+    const std::string::size_type valuePos = line.find( valueKey );
+    if( namePos == std::string::npos || valuePos == std::string::npos )
+    {
+      continue;
+    }
+    const std::string::size_type nameBegin = namePos + nameKey.size();
+    const std::string            name      = line.substr( nameBegin, line.find( '"', nameBegin ) - nameBegin );
+    std::istringstream           value( line.substr( valuePos + valueKey.size() ) );
+    value >> baseline[ name ];
+  }
+  return true;
+
+} // end ReadBaseline()
+
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "itkMetricThroughputBenchmark" << std::endl
+     << "  [-out]                 output JSON file, default: only print to the screen\n"
+     << "  [-dimension]           image dimensions, default: 2 3\n"
+     << "  [-samples]             numbers of samples, default: 2000 20000\n"
+     << "  [-threads]             numbers of threads, default: 1 2 4 ... up to the number of cores\n"
+     << "  [-metric]              metrics, default: all\n"
+     << "  [-transform]           transforms, default: Euler Affine BSpline RecursiveBSpline\n"
+     << "  [-iterations]          calls to GetValueAndDerivative per benchmark, default: 10\n"
+     << "  [-baseline]            JSON file of a previous run, to compare against\n"
+     << "  [-tolerance]           allowed relative slowdown with respect to the baseline, default 0.2\n"
+     << "  [-minimumEfficiency]   minimum scaling efficiency, default 0 (not checked)";
+  return ss.str();
+
+} // end GetHelpString()
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText( GetHelpString() );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  /** The default settings. */
+  BenchmarkSettings settings;
+  settings.Dimensions.push_back( 2 );
+  settings.Dimensions.push_back( 3 );
+  settings.NumberOfSamples.push_back( 2000 );
+  settings.NumberOfSamples.push_back( 20000 );
+  const unsigned int maximumNumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  for( unsigned int threads = 1; threads < maximumNumberOfThreads; threads *= 2 )
+  {
+    settings.NumberOfThreads.push_back( threads );
+  }
+  settings.NumberOfThreads.push_back( maximumNumberOfThreads );
+  settings.Metrics.push_back( "AdvancedMeanSquares" );
+  settings.Metrics.push_back( "AdvancedNormalizedCorrelation" );
+  settings.Metrics.push_back( "AdvancedMattesMutualInformation" );
+  settings.Metrics.push_back( "NormalizedMutualInformation" );
+  settings.Metrics.push_back( "AdvancedKappaStatistic" );
+  settings.Transforms.push_back( "Euler" );
+  settings.Transforms.push_back( "Affine" );
+  settings.Transforms.push_back( "BSpline" );
+  settings.Transforms.push_back( "RecursiveBSpline" );
+#ifndef NDEBUG
+  settings.NumberOfIterations = 2;
+#else
+  settings.NumberOfIterations = 10;
+#endif
+
+  parser->GetCommandLineArgument( "-dimension", settings.Dimensions );
+  parser->GetCommandLineArgument( "-samples", settings.NumberOfSamples );
+  parser->GetCommandLineArgument( "-threads", settings.NumberOfThreads );
+  parser->GetCommandLineArgument( "-metric", settings.Metrics );
+  parser->GetCommandLineArgument( "-transform", settings.Transforms );
+  parser->GetCommandLineArgument( "-iterations", settings.NumberOfIterations );
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+  std::string baselineFileName = "";
+  parser->GetCommandLineArgument( "-baseline", baselineFileName );
+  double tolerance = 0.2;
+  parser->GetCommandLineArgument( "-tolerance", tolerance );
+  double minimumEfficiency = 0.0;
+  parser->GetCommandLineArgument( "-minimumEfficiency", minimumEfficiency );
+
+  /** Run the benchmarks. */
+  BenchmarkResultContainer results;
+  try
+  {
+    for( std::size_t d = 0; d < settings.Dimensions.size(); ++d )
+    {
+      if( settings.Dimensions[ d ] == 2 )
+      {
+        RunBenchmarks< 2 >( settings, results );
+      }
+      else if( settings.Dimensions[ d ] == 3 )
+      {
+        RunBenchmarks< 3 >( settings, results );
+      }
+      else
+      {
+        std::cerr << "ERROR: only dimensions 2 and 3 are supported." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: caught ITK exception: " << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Write the results. */
+  if( !outputFileName.empty() )
+  {
+    std::ofstream outputFile( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    WriteResults( outputFile, results );
+  }
+  else
+  {
+    WriteResults( std::cout, results );
+  }
+
+  /** Flag regressions. */
+  unsigned int numberOfRegressions = 0;
+  std::map< std::string, double > baseline;
+  if( !baselineFileName.empty() && !ReadBaseline( baselineFileName, baseline ) )
+  {
+    std::cerr << "ERROR: could not read the baseline " << baselineFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    const BenchmarkResult &                               result = results[ i ];
+    const std::map< std::string, double >::const_iterator it     = baseline.find( result.Name );
+    if( it != baseline.end() && result.SamplesPerSecond < ( 1.0 - tolerance ) * it->second )
+    {
+      std::cerr << "REGRESSION: " << result.Name << " runs at "
+                << static_cast< unsigned long >( result.SamplesPerSecond ) << " samples/s, the baseline at "
+                << static_cast< unsigned long >( it->second ) << " samples/s." << std::endl;
+      ++numberOfRegressions;
+    }
+    if( result.ScalingEfficiency < minimumEfficiency )
+    {
+      std::cerr << "REGRESSION: " << result.Name << " has a scaling efficiency of "
+                << result.ScalingEfficiency << ", the minimum is " << minimumEfficiency << "." << std::endl;
+      ++numberOfRegressions;
+    }
+  }
+
+  return numberOfRegressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+} // end main
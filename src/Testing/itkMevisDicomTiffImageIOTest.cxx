@@ -195,6 +195,44 @@ testMevis( void )
     return 1;
   }
 
+  /** Read a part of the image only, which is streamed from the tiles. */
+  typename ImageType::RegionType subRegion;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    subRegion.SetIndex( i, 3 + i );
+    subRegion.SetSize( i, 7 );
+  }
+  typename ReaderType::Pointer regionReader = ReaderType::New();
+  regionReader->SetFileName( testfile );
+  try
+  {
+    regionReader->UpdateOutputInformation();
+    regionReader->GetOutput()->SetRequestedRegion( subRegion );
+    regionReader->Update();
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << "ERROR: Reading a region of mevis dicomtiff failed." << std::endl;
+    std::cerr << err << std::endl;
+    return 1;
+  }
+
+  if( regionReader->GetOutput()->GetBufferedRegion() != subRegion )
+  {
+    std::cerr << "ERROR: the region is not streamed" << std::endl;
+    return 1;
+  }
+  IteratorType regionIt( regionReader->GetOutput(), subRegion );
+  IteratorType validIt( inputImage, subRegion );
+  for( ; !regionIt.IsAtEnd(); ++regionIt, ++validIt )
+  {
+    if( regionIt.Get() != validIt.Get() )
+    {
+      std::cerr << "ERROR: the pixel values of the streamed region are not correct" << std::endl;
+      return 1;
+    }
+  }
+
   return 0;
 
 } // end templated function
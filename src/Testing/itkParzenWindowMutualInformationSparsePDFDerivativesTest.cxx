@@ -0,0 +1,208 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test compares the explicit joint PDF derivatives of the Mattes mutual
+// information in their dense storage and in the sparse block storage of
+// UseSparseExplicitPDFDerivatives. Both evaluate the same samples of a 3D
+// image pair, with a B-spline transform, whose Jacobian touches a few
+// parameter blocks per sample, and with an affine transform, whose Jacobian
+// touches all parameters. The values and derivatives should be equal.
+
+/** Three smooth blobs on a sinusoidal background, shifted by shift voxels. */
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const unsigned int sizePerDimension, const double shift )
+{
+  const unsigned int Dimension = TImage::ImageDimension;
+
+  typename TImage::SizeType size;
+  size.Fill( sizePerDimension );
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< TImage > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const typename TImage::IndexType index = it.GetIndex();
+    double                           value = 0.0;
+    for( unsigned int blob = 1; blob <= 3; ++blob )
+    {
+      double distance2 = 0.0;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        const double center = sizePerDimension * blob / 4.0 + shift;
+        distance2 += ( index[ d ] - center ) * ( index[ d ] - center );
+      }
+      value += 100.0 * vcl_exp( -distance2 / ( 2.0 * sizePerDimension * sizePerDimension / 64.0 ) );
+    }
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 10.0 * vcl_sin( ( index[ d ] + shift ) * 0.2 );
+    }
+    it.Set( static_cast< typename TImage::PixelType >( value ) );
+  }
+
+  return image;
+
+} // end CreateImage()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension = 3;
+  const double       distance  = 1e-6; // the allowable relative difference
+
+  typedef itk::Image< float, Dimension >                                         ImageType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                                       MetricType;
+  typedef MetricType::TransformParametersType                                    ParametersType;
+  typedef MetricType::DerivativeType                                             DerivativeType;
+  typedef MetricType::MeasureType                                                MeasureType;
+  typedef itk::ImageFullSampler< ImageType >                                     ImageSamplerType;
+  typedef itk::BSplineInterpolateImageFunction< ImageType, double, double >      InterpolatorType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >                 CombinationTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >        BSplineTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension > AffineTransformType;
+
+  const unsigned int sizePerDimension = 32;
+  ImageType::Pointer fixedImage       = CreateImage< ImageType >( sizePerDimension, 0.0 );
+  ImageType::Pointer movingImage      = CreateImage< ImageType >( sizePerDimension, 1.5 );
+
+  /** A B-spline grid with a control point every 8 voxels, with a small
+   * displacement, and an affine transform with a small shear.
+   */
+  BSplineTransformType::Pointer     bsplineTransform = BSplineTransformType::New();
+  BSplineTransformType::SizeType    gridSize;
+  BSplineTransformType::SpacingType gridSpacing;
+  BSplineTransformType::OriginType  gridOrigin;
+  gridSize.Fill( sizePerDimension / 8 + 3 );
+  gridSpacing.Fill( 8.0 );
+  gridOrigin.Fill( -8.0 );
+  bsplineTransform->SetGridRegion( BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridDirection( fixedImage->GetDirection() );
+  ParametersType bsplineParameters( bsplineTransform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < bsplineParameters.GetSize(); ++i )
+  {
+    bsplineParameters[ i ] = 0.5 * vcl_sin( 0.1 * i );
+  }
+  bsplineTransform->SetParametersByValue( bsplineParameters );
+
+  AffineTransformType::Pointer        affineTransform = AffineTransformType::New();
+  AffineTransformType::InputPointType center;
+  center.Fill( ( sizePerDimension - 1 ) / 2.0 );
+  affineTransform->SetIdentity();
+  affineTransform->SetCenter( center );
+  ParametersType affineParameters = affineTransform->GetParameters();
+  for( unsigned int i = 0; i < affineParameters.GetSize(); ++i )
+  {
+    affineParameters[ i ] += 0.01 * ( i + 1 );
+  }
+  affineTransform->SetParameters( affineParameters );
+
+  /** Evaluate the dense and the sparse storage, for both transforms. */
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    CombinationTransformType::Pointer transform = CombinationTransformType::New();
+    if( t == 0 )
+    {
+      transform->SetCurrentTransform( bsplineTransform );
+    }
+    else
+    {
+      transform->SetCurrentTransform( affineTransform );
+    }
+    const ParametersType parameters = transform->GetParameters();
+
+    MeasureType    values[ 2 ];
+    DerivativeType derivatives[ 2 ];
+    for( unsigned int sparse = 0; sparse < 2; ++sparse )
+    {
+      ImageSamplerType::Pointer sampler = ImageSamplerType::New();
+      sampler->SetInput( fixedImage );
+      sampler->SetInputImageRegion( fixedImage->GetBufferedRegion() );
+
+      InterpolatorType::Pointer interpolator = InterpolatorType::New();
+      interpolator->SetSplineOrder( 1 );
+
+      MetricType::Pointer metric = MetricType::New();
+      metric->SetFixedImage( fixedImage );
+      metric->SetMovingImage( movingImage );
+      metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+      metric->SetTransform( transform );
+      metric->SetInterpolator( interpolator );
+      metric->SetImageSampler( sampler );
+      metric->SetUseDerivative( true );
+      metric->SetUseExplicitPDFDerivatives( true );
+      metric->SetUseSparseExplicitPDFDerivatives( sparse == 1 );
+      try
+      {
+        metric->Initialize();
+        metric->GetValueAndDerivative( parameters, values[ sparse ], derivatives[ sparse ] );
+      }
+      catch( itk::ExceptionObject & excp )
+      {
+        std::cerr << excp << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    /** Compare, relative to the largest derivative. */
+    double maximumDerivative = 0.0;
+    double maximumDifference = 0.0;
+    for( unsigned int i = 0; i < derivatives[ 0 ].GetSize(); ++i )
+    {
+      maximumDerivative = std::max( maximumDerivative, vcl_abs( derivatives[ 0 ][ i ] ) );
+      maximumDifference = std::max( maximumDifference,
+        vcl_abs( derivatives[ 0 ][ i ] - derivatives[ 1 ][ i ] ) );
+    }
+
+    std::cerr << ( t == 0 ? "BSpline" : "Affine" ) << ": dense value " << values[ 0 ]
+              << ", sparse value " << values[ 1 ] << ", maximum derivative difference "
+              << maximumDifference << " of " << maximumDerivative << std::endl;
+
+    if( derivatives[ 0 ].GetSize() != derivatives[ 1 ].GetSize()
+      || maximumDerivative == 0.0
+      || vcl_abs( values[ 0 ] - values[ 1 ] ) > distance * vcl_abs( values[ 0 ] )
+      || maximumDifference > distance * maximumDerivative )
+    {
+      std::cerr << "ERROR: the sparse PDF derivatives give another result." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,91 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkPhiloxRandomNumberGenerator.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks the PhiloxRandomNumberGenerator against the known-answer
+// vectors of Philox4x32-10, as published with the Random123 library of
+// Salmon et al. A wrong multiplier, round constant or key schedule changes
+// every output word.
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::PhiloxRandomNumberGenerator GeneratorType;
+  typedef GeneratorType::WordType          WordType;
+
+  /** The known-answer vectors: key, counter, and expected result. */
+  const WordType vectors[ 3 ][ 10 ] = {
+    { 0x00000000u, 0x00000000u,
+      0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u,
+      0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u },
+    { 0xffffffffu, 0xffffffffu,
+      0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+      0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu },
+    { 0xa4093822u, 0x299f31d0u,
+      0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u,
+      0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u }
+  };
+
+  for( unsigned int v = 0; v < 3; ++v )
+  {
+    const GeneratorType generator( vectors[ v ][ 0 ], vectors[ v ][ 1 ] );
+    WordType            result[ 4 ];
+    generator.Generate( &vectors[ v ][ 2 ], result );
+    for( unsigned int i = 0; i < 4; ++i )
+    {
+      if( result[ i ] != vectors[ v ][ 6 + i ] )
+      {
+        std::cerr << "ERROR: word " << i << " of known-answer vector " << v
+                  << " is 0x" << std::hex << std::setw( 8 ) << std::setfill( '0' ) << result[ i ]
+                  << ", but should be 0x" << std::setw( 8 ) << vectors[ v ][ 6 + i ]
+                  << "." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** The uniform variates are the known-answer words, converted to [0, 1). */
+  const GeneratorType generator( vectors[ 2 ][ 0 ], vectors[ 2 ][ 1 ] );
+  const WordType      counter[ 4 ] = { 7, 0, 3, 0 };
+  WordType            block[ 4 ];
+  double              values[ 2 ];
+  generator.Generate( counter, block );
+  generator.GetUniformVariates( 7, 3, values, 2 );
+  if( values[ 0 ] != GeneratorType::ToUnitInterval( block[ 0 ], block[ 1 ] )
+    || values[ 1 ] != GeneratorType::ToUnitInterval( block[ 2 ], block[ 3 ] ) )
+  {
+    std::cerr << "ERROR: GetUniformVariates() does not use the counter ( index, subIndex )."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if( GeneratorType::ToUnitInterval( 0u, 0u ) != 0.0
+    || !( GeneratorType::ToUnitInterval( 0xffffffffu, 0xffffffffu ) < 1.0 ) )
+  {
+    std::cerr << "ERROR: ToUnitInterval() does not map to [0, 1)." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
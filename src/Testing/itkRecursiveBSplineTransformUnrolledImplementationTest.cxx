@@ -0,0 +1,183 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkRecursiveBSplineTransformUnrolledImplementation.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test compares the unrolled cubic kernels of the
+// RecursiveBSplineTransformUnrolledImplementation for 2D and 3D with the
+// recursive RecursiveBSplineTransformImplementation, on the same weights and
+// coefficients: TransformPoint, with double and float coefficients,
+// GetJacobian and EvaluateJacobianWithImageGradientProduct. The results
+// should be equal.
+
+/** Returns the largest absolute difference of two arrays, relative to the
+ * largest absolute value of the first.
+ */
+double
+RelativeDifference( const double * expected, const double * actual, const unsigned int n )
+{
+  double maximumValue      = 0.0;
+  double maximumDifference = 0.0;
+  for( unsigned int i = 0; i < n; ++i )
+  {
+    maximumValue      = std::max( maximumValue, vcl_abs( expected[ i ] ) );
+    maximumDifference = std::max( maximumDifference, vcl_abs( expected[ i ] - actual[ i ] ) );
+  }
+  return maximumValue > 0.0 ? maximumDifference / maximumValue : maximumDifference;
+
+} // end RelativeDifference()
+
+
+/** Compares the kernels in Dimension D at a number of support positions. */
+template< unsigned int Dimension >
+bool
+CompareKernels( void )
+{
+  const unsigned int SplineOrder = 3;
+  const unsigned int Order       = SplineOrder + 1;
+  const double       distance    = 1e-12; // the allowable relative difference
+
+  typedef itk::RecursiveBSplineTransformImplementation<
+    Dimension, Dimension, SplineOrder, double > RecursiveType;
+  typedef itk::RecursiveBSplineTransformUnrolledImplementation<
+    Dimension, Dimension, SplineOrder, double > UnrolledType;
+
+  /** A coefficient grid of 7 points along every dimension. */
+  const unsigned int   gridSize           = 7;
+  itk::OffsetValueType gridOffsetTable[ Dimension ];
+  unsigned int         numberOfGridPoints = 1;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridOffsetTable[ d ] = numberOfGridPoints;
+    numberOfGridPoints  *= gridSize;
+  }
+  std::vector< double > coefficients( Dimension * numberOfGridPoints );
+  std::vector< float >  floatCoefficients( Dimension * numberOfGridPoints );
+  for( unsigned int i = 0; i < coefficients.size(); ++i )
+  {
+    coefficients[ i ]      = 3.0 * vcl_sin( 0.37 * i ) + 0.01 * i;
+    floatCoefficients[ i ] = static_cast< float >( coefficients[ i ] );
+  }
+
+  unsigned int numberOfIndices = 1;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    numberOfIndices *= Order;
+  }
+
+  for( unsigned int position = 0; position < 20; ++position )
+  {
+    /** The 1D weights of every dimension, and the start of the support. */
+    double               weights1D[ Dimension * Order ];
+    itk::OffsetValueType supportOffset = 0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      for( unsigned int k = 0; k < Order; ++k )
+      {
+        weights1D[ d * Order + k ] = 0.25 + 0.2 * vcl_sin( 1.3 * position + 0.7 * d + 1.1 * k );
+      }
+      supportOffset += ( ( position + d ) % ( gridSize - Order + 1 ) ) * gridOffsetTable[ d ];
+    }
+
+    /** TransformPoint, with double and float coefficients. */
+    double * mu[ Dimension ];
+    float *  floatMu[ Dimension ];
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      mu[ j ]      = &coefficients[ j * numberOfGridPoints + supportOffset ];
+      floatMu[ j ] = &floatCoefficients[ j * numberOfGridPoints + supportOffset ];
+    }
+    double expectedPoint[ Dimension ];
+    double actualPoint[ Dimension ];
+    RecursiveType::TransformPoint( expectedPoint, mu, gridOffsetTable, weights1D );
+    UnrolledType::TransformPoint( actualPoint, mu, gridOffsetTable, weights1D );
+    if( RelativeDifference( expectedPoint, actualPoint, Dimension ) > distance )
+    {
+      std::cerr << "ERROR: TransformPoint differs in " << Dimension << "D." << std::endl;
+      return false;
+    }
+    RecursiveType::TransformPoint( expectedPoint, floatMu, gridOffsetTable, weights1D );
+    UnrolledType::TransformPoint( actualPoint, floatMu, gridOffsetTable, weights1D );
+    if( RelativeDifference( expectedPoint, actualPoint, Dimension ) > distance )
+    {
+      std::cerr << "ERROR: TransformPoint with float coefficients differs in "
+                << Dimension << "D." << std::endl;
+      return false;
+    }
+
+    /** GetJacobian, which fills the diagonal blocks of the Jacobian. */
+    const unsigned int    jacobianSize = Dimension * Dimension * numberOfIndices;
+    std::vector< double > expectedJacobian( jacobianSize, 0.0 );
+    std::vector< double > actualJacobian( jacobianSize, 0.0 );
+    double *              expectedPointer = &expectedJacobian[ 0 ];
+    double *              actualPointer   = &actualJacobian[ 0 ];
+    RecursiveType::GetJacobian( expectedPointer, weights1D, 1.0 );
+    UnrolledType::GetJacobian( actualPointer, weights1D, 1.0 );
+    if( RelativeDifference( &expectedJacobian[ 0 ], &actualJacobian[ 0 ], jacobianSize ) > distance
+      || expectedPointer - &expectedJacobian[ 0 ] != actualPointer - &actualJacobian[ 0 ] )
+    {
+      std::cerr << "ERROR: GetJacobian differs in " << Dimension << "D." << std::endl;
+      return false;
+    }
+
+    /** EvaluateJacobianWithImageGradientProduct. */
+    double movingImageGradient[ Dimension ];
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      movingImageGradient[ d ] = 10.0 * vcl_cos( 0.9 * position + d );
+    }
+    const unsigned int    imageJacobianSize = Dimension * numberOfIndices;
+    std::vector< double > expectedImageJacobian( imageJacobianSize, 0.0 );
+    std::vector< double > actualImageJacobian( imageJacobianSize, 0.0 );
+    expectedPointer = &expectedImageJacobian[ 0 ];
+    actualPointer   = &actualImageJacobian[ 0 ];
+    RecursiveType::EvaluateJacobianWithImageGradientProduct(
+      expectedPointer, movingImageGradient, weights1D, 1.0 );
+    UnrolledType::EvaluateJacobianWithImageGradientProduct(
+      actualPointer, movingImageGradient, weights1D, 1.0 );
+    if( RelativeDifference( &expectedImageJacobian[ 0 ], &actualImageJacobian[ 0 ],
+      imageJacobianSize ) > distance
+      || expectedPointer - &expectedImageJacobian[ 0 ] != actualPointer - &actualImageJacobian[ 0 ] )
+    {
+      std::cerr << "ERROR: EvaluateJacobianWithImageGradientProduct differs in "
+                << Dimension << "D." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CompareKernels()
+
+
+int
+main( int argc, char * argv[] )
+{
+  if( !CompareKernels< 2 >() || !CompareKernels< 3 >() )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
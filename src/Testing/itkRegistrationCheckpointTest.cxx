@@ -0,0 +1,239 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkRegistrationCheckpoint.h"
+#include "itkBackgroundWriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+//-------------------------------------------------------------------------------------
+// This test writes a registration checkpoint with the entries that elastix
+// stores, reads it back, and compares every entry bit for bit. The state of
+// the L-BFGS optimizer is laid out as by
+// QuasiNewtonLBFGSOptimizer::GetOptimizationState(), after more iterations
+// than its memory, so that the history has wrapped around. The file is
+// written twice through the BackgroundWriter, synchronously and in the
+// background, so that the second write replaces an existing checkpoint.
+// Corrupt data should be rejected.
+
+/** Compare the entries of two checkpoints bit for bit. */
+bool
+CompareCheckpoints( const itk::RegistrationCheckpoint * expected,
+  const itk::RegistrationCheckpoint * read )
+{
+  typedef itk::RegistrationCheckpoint::EntryMapType EntryMapType;
+  const EntryMapType & expectedEntries = expected->GetEntries();
+  const EntryMapType & readEntries     = read->GetEntries();
+  if( expectedEntries.size() != readEntries.size() )
+  {
+    std::cerr << "ERROR: " << readEntries.size() << " entries were read, while "
+              << expectedEntries.size() << " were written." << std::endl;
+    return false;
+  }
+
+  EntryMapType::const_iterator readIt = readEntries.begin();
+  for( EntryMapType::const_iterator it = expectedEntries.begin();
+    it != expectedEntries.end(); ++it, ++readIt )
+  {
+    if( it->first != readIt->first || it->second.size() != readIt->second.size() )
+    {
+      std::cerr << "ERROR: entry \"" << it->first << "\" with " << it->second.size()
+                << " values was read as \"" << readIt->first << "\" with "
+                << readIt->second.size() << " values." << std::endl;
+      return false;
+    }
+    if( !it->second.empty() && std::memcmp( &it->second[ 0 ], &readIt->second[ 0 ],
+      it->second.size() * sizeof( double ) ) != 0 )
+    {
+      std::cerr << "ERROR: the values of entry \"" << it->first << "\" differ." << std::endl;
+      return false;
+    }
+  }
+  return true;
+
+} // end CompareCheckpoints()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Check number of arguments. */
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the checkpoint file name." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string fileName = argv[ 1 ];
+
+  /** Some basic type definitions. */
+  typedef itk::RegistrationCheckpoint CheckpointType;
+  typedef CheckpointType::EntryType   EntryType;
+
+  CheckpointType::Pointer checkpoint = CheckpointType::New();
+
+  /** The entries of ElastixTemplate::WriteRegistrationCheckpoint(). */
+  const unsigned int numberOfParameters = 3 * 7 * 7 * 7;
+  checkpoint->SetEntry( "NumberOfResolutions", 4.0 );
+  checkpoint->SetEntry( "Resolution", 2.0 );
+  checkpoint->SetEntry( "Iteration", 11.0 );
+  EntryType parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = 0.1 * i - 1.0 / 3.0;
+  }
+
+  /** Values that a text format would not reproduce exactly. */
+  parameters[ 0 ] = -0.0;
+  parameters[ 1 ] = std::numeric_limits< double >::denorm_min();
+  parameters[ 2 ] = std::numeric_limits< double >::max();
+  parameters[ 3 ] = std::numeric_limits< double >::infinity();
+  parameters[ 4 ] = 9007199254740992.0; // 2^53
+  checkpoint->SetEntry( "TransformParameters", parameters );
+  checkpoint->SetEntry( "ImageSampler0.NumberOfUpdates", 123456789.0 );
+  checkpoint->SetEntry( "Empty", EntryType() );
+
+  /** The L-BFGS state after 11 iterations with a memory of 4: the slots
+   * hold the s and y of the iterations 8, 9, 10 and 7, in that order.
+   */
+  const unsigned int memory     = 4;
+  const unsigned int iterations = 11;
+  const unsigned int point      = ( iterations - 1 ) % memory;
+  EntryType          state;
+  state.push_back( static_cast< double >( iterations ) );
+  state.push_back( static_cast< double >( ( point + 1 ) % memory ) );
+  state.push_back( static_cast< double >( point ) );
+  state.push_back( static_cast< double >( memory ) );
+  state.push_back( static_cast< double >( memory ) );
+  state.push_back( 0.0 );
+  for( unsigned int slot = 0; slot < memory; ++slot )
+  {
+    state.push_back( 1.0 / ( 3.0 + slot ) ); // rho
+  }
+  for( unsigned int slot = 0; slot < memory; ++slot )
+  {
+    state.push_back( 7.0 / ( 5.0 + slot ) ); // yy
+  }
+  for( unsigned int slot = 0; slot < memory; ++slot )
+  {
+    const unsigned int iteration = slot <= point
+      ? iterations - 1 - point + slot : iterations - 1 - point - memory + slot;
+    state.push_back( static_cast< double >( numberOfParameters ) );
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      state.push_back( 1e-3 * iteration + 1e-7 * i ); // s
+    }
+    state.push_back( static_cast< double >( numberOfParameters ) );
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      state.push_back( -2e-3 * iteration + 3e-7 * i ); // y
+    }
+  }
+  checkpoint->SetEntry( "Optimizer0.OptimizationState", state );
+
+  /** Write synchronously, and then replace the file in the background. */
+  itk::BackgroundWriter::Pointer writer = itk::BackgroundWriter::GetInstance();
+  CheckpointType::Pointer        read   = CheckpointType::New();
+  for( unsigned int i = 0; i < 2; ++i )
+  {
+    writer->SetEnabled( i == 1 );
+    try
+    {
+      writer->SubmitBinaryFile( fileName, checkpoint->Serialize() );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+    const std::vector< std::string > errors = writer->WaitForAll();
+    if( !errors.empty() )
+    {
+      std::cerr << "ERROR: " << errors[ 0 ] << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( std::ifstream( ( fileName + ".tmp" ).c_str() ).is_open() )
+    {
+      std::cerr << "ERROR: the temporary file was not renamed." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Read and compare. */
+    try
+    {
+      read->Clear();
+      read->ReadFile( fileName );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( !CompareCheckpoints( checkpoint, read ) )
+    {
+      return EXIT_FAILURE;
+    }
+
+    /** The next write should not append to the previous one. */
+    checkpoint->SetEntry( "Iteration", 12.0 );
+  }
+
+  /** The single value getter. */
+  double iteration = 0.0;
+  if( !read->GetEntry( "Iteration", iteration ) || iteration != 12.0
+    || read->GetEntry( "TransformParameters", iteration ) )
+  {
+    std::cerr << "ERROR: GetEntry() of a single value failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Truncated data and data with another magic number should be rejected,
+   * without changing the entries.
+   */
+  const std::string data = checkpoint->Serialize();
+  std::string       corrupt[ 3 ];
+  corrupt[ 0 ] = data.substr( 0, data.size() - 1 );
+  corrupt[ 1 ] = data.substr( 0, 20 );
+  corrupt[ 2 ] = data;
+  corrupt[ 2 ][ 0 ] = 'X';
+  for( unsigned int i = 0; i < 3; ++i )
+  {
+    bool rejected = false;
+    try
+    {
+      read->Deserialize( corrupt[ i ] );
+    }
+    catch( itk::ExceptionObject & )
+    {
+      rejected = true;
+    }
+    if( !rejected || !CompareCheckpoints( checkpoint, read ) )
+    {
+      std::cerr << "ERROR: corrupt data " << i << " was not rejected." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::remove( fileName.c_str() );
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,603 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Benchmarks the image samplers and the image pyramids of elastix.
+ *
+ * \li Samplers: the number of samples generated per second by the Random,
+ *   RandomCoordinate, RandomSparseMask, Grid and Full samplers, for a number
+ *   of mask fill fractions and numbers of threads. The mask is a centered box
+ *   that covers the given fraction of the image.
+ * \li Pyramids: the time to build all levels of the Generic, Recursive,
+ *   Shrinking and Smoothing pyramids, the memory of the levels, and the peak
+ *   resident set size of the process after the build, for a number of image
+ *   sizes. When elastix is built with ELASTIX_USE_OPENCL, the OpenCLGeneric
+ *   and OpenCLRecursive pyramids are also timed; they run the same filters
+ *   with the GPU factories registered, like the OpenCL pyramid components.
+ *
+ * The results are written in JSON format, one result per line.
+ */
+
+#include "itkCommandLineArgumentParser.h"
+
+#include "itkImageRandomSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageRandomSamplerSparseMask.h"
+#include "itkImageGridSampler.h"
+#include "itkImageFullSampler.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkMultiResolutionGaussianSmoothingPyramidImageFilter.h"
+#include "itkMultiResolutionShrinkPyramidImageFilter.h"
+#include "itkRecursiveMultiResolutionPyramidImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMemoryAccounting.h"
+#include "itkTimeProbe.h"
+
+#ifdef ELASTIX_USE_OPENCL
+#include "itkTestHelper.h"
+#include "itkGPUImageFactory.h"
+#include "itkGPURecursiveGaussianImageFilterFactory.h"
+#include "itkGPUCastImageFilterFactory.h"
+#include "itkGPUShrinkImageFilterFactory.h"
+#include "itkGPUResampleImageFilterFactory.h"
+#include "itkGPUIdentityTransformFactory.h"
+#include "itkGPULinearInterpolateImageFunctionFactory.h"
+#endif
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image< float, Dimension >                         ImageType;
+typedef itk::Image< unsigned char, Dimension >                 MaskImageType;
+typedef itk::ImageMaskSpatialObject2< Dimension >              MaskType;
+typedef itk::ImageSamplerBase< ImageType >                     ImageSamplerBaseType;
+typedef itk::ImageRandomSampler< ImageType >                   RandomSamplerType;
+typedef itk::ImageRandomCoordinateSampler< ImageType >         RandomCoordinateSamplerType;
+typedef itk::ImageRandomSamplerSparseMask< ImageType >         RandomSparseMaskSamplerType;
+typedef itk::ImageGridSampler< ImageType >                     GridSamplerType;
+typedef itk::ImageFullSampler< ImageType >                     FullSamplerType;
+typedef itk::MultiResolutionPyramidImageFilter< ImageType, ImageType >
+  PyramidBaseType;
+typedef itk::GenericMultiResolutionPyramidImageFilter< ImageType, ImageType >
+  GenericPyramidType;
+typedef itk::RecursiveMultiResolutionPyramidImageFilter< ImageType, ImageType >
+  RecursivePyramidType;
+typedef itk::MultiResolutionShrinkPyramidImageFilter< ImageType, ImageType >
+  ShrinkingPyramidType;
+typedef itk::MultiResolutionGaussianSmoothingPyramidImageFilter< ImageType, ImageType >
+  SmoothingPyramidType;
+
+/** The result of one sampler measurement. */
+struct SamplerResult
+{
+  std::string  Sampler;
+  double       FillFraction;
+  unsigned int NumberOfThreads;
+  double       SamplesPerSecond;
+};
+
+/** The result of one pyramid measurement. */
+struct PyramidResult
+{
+  std::string        Pyramid;
+  unsigned int       ImageSize;
+  double             Seconds;
+  itk::SizeValueType OutputBytes;
+  itk::SizeValueType PeakResidentSetSize;
+};
+
+/**
+ * ******************* CreateImage *******************
+ *
+ * Creates an image of smooth blobs.
+ */
+
+ImageType::Pointer
+CreateImage( const unsigned int sizePerDimension )
+{
+  ImageType::SizeType size;
+  size.Fill( sizePerDimension );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 10.0 * vcl_sin( it.GetIndex()[ d ] * 0.1 );
+    }
+    it.Set( static_cast< float >( value ) );
+  }
+  return image;
+
+} // end CreateImage()
+
+
+/**
+ * ******************* CreateMask *******************
+ *
+ * Creates a mask of a centered box that covers \a fillFraction of the image,
+ * or 0 if the fraction is 1, so that the unmasked paths are timed.
+ */
+
+MaskType::Pointer
+CreateMask( const ImageType * image, const double fillFraction )
+{
+  if( fillFraction >= 1.0 )
+  {
+    return 0;
+  }
+
+  const ImageType::SizeType size      = image->GetLargestPossibleRegion().GetSize();
+  MaskImageType::Pointer    maskImage = MaskImageType::New();
+  maskImage->SetRegions( image->GetLargestPossibleRegion() );
+  maskImage->Allocate();
+  maskImage->FillBuffer( 0 );
+
+  /** The box has the same aspect ratio as the image. */
+  const double             sideFraction = vcl_pow( fillFraction, 1.0 / Dimension );
+  MaskImageType::IndexType boxIndex;
+  MaskImageType::SizeType  boxSize;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    boxSize[ d ]  = std::max< itk::SizeValueType >( 1,
+      static_cast< itk::SizeValueType >( sideFraction * size[ d ] + 0.5 ) );
+    boxIndex[ d ] = static_cast< itk::IndexValueType >( ( size[ d ] - boxSize[ d ] ) / 2 );
+  }
+  itk::ImageRegionIterator< MaskImageType > it( maskImage,
+    MaskImageType::RegionType( boxIndex, boxSize ) );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( 1 );
+  }
+
+  MaskType::Pointer mask = MaskType::New();
+  mask->SetImage( maskImage );
+  return mask;
+
+} // end CreateMask()
+
+
+/**
+ * ******************* CreateSampler *******************
+ */
+
+ImageSamplerBaseType::Pointer
+CreateSampler( const std::string & name )
+{
+  const unsigned long numberOfSamples = 100000;
+  if( name == "Random" )
+  {
+    RandomSamplerType::Pointer sampler = RandomSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    return sampler.GetPointer();
+  }
+  else if( name == "RandomCoordinate" )
+  {
+    RandomCoordinateSamplerType::Pointer sampler = RandomCoordinateSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    return sampler.GetPointer();
+  }
+  else if( name == "RandomSparseMask" )
+  {
+    RandomSparseMaskSamplerType::Pointer sampler = RandomSparseMaskSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    return sampler.GetPointer();
+  }
+  else if( name == "Grid" )
+  {
+    GridSamplerType::Pointer sampler = GridSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    return sampler.GetPointer();
+  }
+  else if( name == "Full" )
+  {
+    return FullSamplerType::New().GetPointer();
+  }
+  return 0;
+
+} // end CreateSampler()
+
+
+/**
+ * ******************* TimeSampler *******************
+ *
+ * Returns the number of samples generated per second.
+ */
+
+double
+TimeSampler( ImageSamplerBaseType * sampler, const ImageType * image,
+  const MaskType * mask, const unsigned int numberOfThreads,
+  const unsigned int numberOfIterations )
+{
+  sampler->SetInput( image );
+  sampler->SetInputImageRegion( image->GetBufferedRegion() );
+  sampler->SetMask( mask );
+  sampler->SetUseMultiThread( numberOfThreads > 1 );
+  sampler->SetNumberOfThreads( numberOfThreads );
+  sampler->Update();
+
+  double         numberOfSamples = 0.0;
+  itk::TimeProbe timer;
+  timer.Start();
+  for( unsigned int i = 0; i < numberOfIterations; ++i )
+  {
+    sampler->Modified();
+    sampler->Update();
+    numberOfSamples += sampler->GetOutput()->Size();
+  }
+  timer.Stop();
+  return numberOfSamples / timer.GetTotal();
+
+} // end TimeSampler()
+
+
+/**
+ * ******************* CreatePyramid *******************
+ *
+ * The OpenCL pyramids are the CPU filters that are replaced by the GPU
+ * factories, see RegisterOpenCLFactories().
+ */
+
+PyramidBaseType::Pointer
+CreatePyramid( const std::string & name )
+{
+  if( name == "Generic" || name == "OpenCLGeneric" )
+  {
+    return GenericPyramidType::New().GetPointer();
+  }
+  else if( name == "Recursive" || name == "OpenCLRecursive" )
+  {
+    return RecursivePyramidType::New().GetPointer();
+  }
+  else if( name == "Shrinking" )
+  {
+    return ShrinkingPyramidType::New().GetPointer();
+  }
+  else if( name == "Smoothing" )
+  {
+    return SmoothingPyramidType::New().GetPointer();
+  }
+  return 0;
+
+} // end CreatePyramid()
+
+
+/**
+ * ******************* TimePyramid *******************
+ *
+ * Builds all levels of the pyramid and measures the time and the memory.
+ */
+
+void
+TimePyramid( const std::string & name, const unsigned int imageSize,
+  const unsigned int numberOfLevels, const unsigned int numberOfIterations,
+  PyramidResult & result )
+{
+  /** Created here, so that it is a GPU image for the OpenCL pyramids. */
+  const ImageType::Pointer image = CreateImage( imageSize );
+
+  result.Pyramid   = name;
+  result.ImageSize = imageSize;
+  result.Seconds   = 0.0;
+  for( unsigned int i = 0; i < numberOfIterations; ++i )
+  {
+    PyramidBaseType::Pointer pyramid = CreatePyramid( name );
+    if( pyramid.IsNull() )
+    {
+      itkGenericExceptionMacro( << "Unknown pyramid " << name );
+    }
+    pyramid->SetNumberOfLevels( numberOfLevels );
+    pyramid->SetInput( image );
+
+    itk::TimeProbe timer;
+    timer.Start();
+    pyramid->Update();
+    timer.Stop();
+    result.Seconds += timer.GetTotal();
+
+    result.OutputBytes = 0;
+    for( unsigned int level = 0; level < numberOfLevels; ++level )
+    {
+      result.OutputBytes += itk::MemoryAccounting::GetImageBufferSize( pyramid->GetOutput( level ) );
+    }
+  }
+  result.Seconds            /= numberOfIterations;
+  result.PeakResidentSetSize = itk::MemoryAccounting::GetPeakResidentSetSize();
+
+} // end TimePyramid()
+
+
+#ifdef ELASTIX_USE_OPENCL
+/**
+ * ******************* RegisterOpenCLFactories *******************
+ *
+ * The same factories as the OpenCL pyramid components register. All filters
+ * and images that are created after this point run on the GPU.
+ */
+
+void
+RegisterOpenCLFactories( void )
+{
+  typedef typelist::MakeTypeList< float >::Type OCLImageTypes;
+  itk::GPUImageFactory2< OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPURecursiveGaussianImageFilterFactory2< OCLImageTypes, OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPUCastImageFilterFactory2< OCLImageTypes, OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPUShrinkImageFilterFactory2< OCLImageTypes, OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPUResampleImageFilterFactory2< OCLImageTypes, OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPUIdentityTransformFactory2< OCLImageDims >
+  ::RegisterOneFactory();
+  itk::GPULinearInterpolateImageFunctionFactory2< OCLImageTypes, OCLImageDims >
+  ::RegisterOneFactory();
+
+} // end RegisterOpenCLFactories()
+
+
+#endif
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "itkSamplerPyramidBenchmark" << std::endl
+     << "  [-out]          output JSON file, default: only print to the screen\n"
+     << "  [-sampler]      samplers, default: Random RandomCoordinate RandomSparseMask Grid Full\n"
+     << "  [-fill]         mask fill fractions, default: 1.0 0.5 0.1 0.01\n"
+     << "  [-threads]      numbers of threads, default: 1 and the number of cores\n"
+     << "  [-pyramid]      pyramids, default: Generic Recursive Shrinking Smoothing,\n"
+     << "                  and OpenCLGeneric OpenCLRecursive if built with OpenCL\n"
+     << "  [-size]         image sizes per dimension of the pyramids, default: 64 128 256\n"
+     << "  [-levels]       number of pyramid levels, default: 4\n"
+     << "  [-iterations]   repetitions per measurement, default: 5";
+  return ss.str();
+
+} // end GetHelpString()
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText( GetHelpString() );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  /** Get the arguments. */
+  std::vector< std::string > samplers;
+  samplers.push_back( "Random" );
+  samplers.push_back( "RandomCoordinate" );
+  samplers.push_back( "RandomSparseMask" );
+  samplers.push_back( "Grid" );
+  samplers.push_back( "Full" );
+  parser->GetCommandLineArgument( "-sampler", samplers );
+
+  std::vector< double > fillFractions;
+  fillFractions.push_back( 1.0 );
+  fillFractions.push_back( 0.5 );
+  fillFractions.push_back( 0.1 );
+  fillFractions.push_back( 0.01 );
+  parser->GetCommandLineArgument( "-fill", fillFractions );
+
+  std::vector< unsigned int > threads;
+  threads.push_back( 1 );
+  threads.push_back( itk::MultiThreader::GetGlobalDefaultNumberOfThreads() );
+  parser->GetCommandLineArgument( "-threads", threads );
+
+  std::vector< std::string > pyramids;
+  pyramids.push_back( "Generic" );
+  pyramids.push_back( "Recursive" );
+  pyramids.push_back( "Shrinking" );
+  pyramids.push_back( "Smoothing" );
+#ifdef ELASTIX_USE_OPENCL
+  pyramids.push_back( "OpenCLGeneric" );
+  pyramids.push_back( "OpenCLRecursive" );
+#endif
+  parser->GetCommandLineArgument( "-pyramid", pyramids );
+
+  std::vector< unsigned int > imageSizes;
+  imageSizes.push_back( 64 );
+  imageSizes.push_back( 128 );
+  imageSizes.push_back( 256 );
+  parser->GetCommandLineArgument( "-size", imageSizes );
+
+  unsigned int numberOfLevels = 4;
+  parser->GetCommandLineArgument( "-levels", numberOfLevels );
+
+  unsigned int numberOfIterations = 5;
+  parser->GetCommandLineArgument( "-iterations", numberOfIterations );
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+
+  /** The OpenCL pyramids run last, since the GPU factories replace the
+   * filters and images of all pyramids that are created after them.
+   */
+  std::vector< std::string > cpuPyramids;
+  std::vector< std::string > openCLPyramids;
+  for( std::size_t p = 0; p < pyramids.size(); ++p )
+  {
+    if( pyramids[ p ].compare( 0, 6, "OpenCL" ) == 0 )
+    {
+      openCLPyramids.push_back( pyramids[ p ] );
+    }
+    else
+    {
+      cpuPyramids.push_back( pyramids[ p ] );
+    }
+  }
+#ifndef ELASTIX_USE_OPENCL
+  if( !openCLPyramids.empty() )
+  {
+    std::cerr << "ERROR: the OpenCL pyramids require ELASTIX_USE_OPENCL" << std::endl;
+    return EXIT_FAILURE;
+  }
+#endif
+
+  /** Run the benchmarks. */
+  std::vector< SamplerResult > samplerResults;
+  std::vector< PyramidResult > pyramidResults;
+  try
+  {
+    const ImageType::Pointer image = CreateImage( 128 );
+    for( std::size_t s = 0; s < samplers.size(); ++s )
+    {
+      for( std::size_t f = 0; f < fillFractions.size(); ++f )
+      {
+        const MaskType::Pointer mask = CreateMask( image, fillFractions[ f ] );
+        for( std::size_t t = 0; t < threads.size(); ++t )
+        {
+          ImageSamplerBaseType::Pointer sampler = CreateSampler( samplers[ s ] );
+          if( sampler.IsNull() )
+          {
+            std::cerr << "ERROR: unknown sampler " << samplers[ s ] << std::endl;
+            return EXIT_FAILURE;
+          }
+
+          SamplerResult result;
+          result.Sampler          = samplers[ s ];
+          result.FillFraction     = fillFractions[ f ];
+          result.NumberOfThreads  = threads[ t ];
+          result.SamplesPerSecond = TimeSampler( sampler, image, mask, threads[ t ], numberOfIterations );
+          samplerResults.push_back( result );
+
+          std::cerr << std::left << std::setw( 18 ) << result.Sampler
+                    << std::right << std::fixed << std::setprecision( 2 )
+                    << std::setw( 6 ) << result.FillFraction << " fill"
+                    << std::setw( 5 ) << result.NumberOfThreads << " threads"
+                    << std::setprecision( 0 ) << std::setw( 14 ) << result.SamplesPerSecond
+                    << " samples/s" << std::endl;
+        }
+      }
+    }
+
+    for( unsigned int pass = 0; pass < 2; ++pass )
+    {
+      const std::vector< std::string > & names = pass == 0 ? cpuPyramids : openCLPyramids;
+      if( names.empty() )
+      {
+        continue;
+      }
+#ifdef ELASTIX_USE_OPENCL
+      if( pass == 1 )
+      {
+        if( !itk::CreateContext() )
+        {
+          return EXIT_FAILURE;
+        }
+        RegisterOpenCLFactories();
+      }
+#endif
+      for( std::size_t p = 0; p < names.size(); ++p )
+      {
+        for( std::size_t i = 0; i < imageSizes.size(); ++i )
+        {
+          PyramidResult result;
+          TimePyramid( names[ p ], imageSizes[ i ], numberOfLevels, numberOfIterations, result );
+          pyramidResults.push_back( result );
+
+          std::cerr << std::left << std::setw( 18 ) << result.Pyramid
+                    << std::right << std::setw( 6 ) << result.ImageSize << "^3"
+                    << std::fixed << std::setprecision( 4 ) << std::setw( 12 ) << result.Seconds << " s"
+                    << std::setprecision( 1 )
+                    << std::setw( 10 ) << itk::MemoryAccounting::ToMegabytes( result.OutputBytes ) << " MB"
+                    << std::setw( 10 ) << itk::MemoryAccounting::ToMegabytes( result.PeakResidentSetSize )
+                    << " MB peak" << std::endl;
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: caught ITK exception: " << excp << std::endl;
+#ifdef ELASTIX_USE_OPENCL
+    itk::ReleaseContext();
+#endif
+    return EXIT_FAILURE;
+  }
+#ifdef ELASTIX_USE_OPENCL
+  itk::ReleaseContext();
+#endif
+
+  /** Write the results. */
+  std::ofstream outputFile;
+  if( !outputFileName.empty() )
+  {
+    outputFile.open( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream & os = outputFileName.empty() ? std::cout : outputFile;
+  os << "{\n  \"samplers\": [";
+  for( std::size_t i = 0; i < samplerResults.size(); ++i )
+  {
+    const SamplerResult & result = samplerResults[ i ];
+    os << ( i == 0 ? "\n" : ",\n" )
+       << "    { \"sampler\": \"" << result.Sampler
+       << "\", \"fillFraction\": " << std::fixed << std::setprecision( 4 ) << result.FillFraction
+       << ", \"threads\": " << result.NumberOfThreads
+       << ", \"samplesPerSecond\": " << std::setprecision( 0 ) << result.SamplesPerSecond << " }";
+  }
+  os << "\n  ],\n  \"pyramids\": [";
+  for( std::size_t i = 0; i < pyramidResults.size(); ++i )
+  {
+    const PyramidResult & result = pyramidResults[ i ];
+    os << ( i == 0 ? "\n" : ",\n" )
+       << "    { \"pyramid\": \"" << result.Pyramid
+       << "\", \"imageSize\": " << result.ImageSize
+       << ", \"levels\": " << numberOfLevels
+       << ", \"seconds\": " << std::fixed << std::setprecision( 6 ) << result.Seconds
+       << ", \"outputBytes\": " << result.OutputBytes
+       << ", \"peakMemory\": " << result.PeakResidentSetSize << " }";
+  }
+  os << "\n  ]\n}\n";
+
+  return EXIT_SUCCESS;
+
+} // end main
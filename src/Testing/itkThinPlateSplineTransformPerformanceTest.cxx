@@ -22,6 +22,7 @@
 #include "itkTimeProbe.h"
 #include "itkTimeProbesCollectorBase.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 
@@ -363,6 +364,74 @@ main( int argc, char * argv[] )
       return 1;
     }
 
+    //
+    // Test the iterative method against the QR decomposition
+
+    /** Deform the landmarks smoothly to obtain target landmarks. */
+    PointsContainerPointer targetLandmarkPoints = PointsContainerType::New();
+    PointSetType::Pointer  targetLandmarks      = PointSetType::New();
+    for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+    {
+      PointType tmp = ( *usedLandmarkPoints )[ j ];
+      for( unsigned int d = 0; d < Dimension; d++ )
+      {
+        tmp[ d ] += 2.0 * vcl_sin( 0.05 * tmp[ ( d + 1 ) % Dimension ] );
+      }
+      targetLandmarkPoints->push_back( tmp );
+    }
+    targetLandmarks->SetPoints( targetLandmarkPoints );
+
+    TransformType::Pointer exactTransform = TransformType::New();
+    exactTransform->SetMatrixInversionMethod( "QR" );
+    exactTransform->SetSourceLandmarks( usedLandmarks );
+    exactTransform->SetTargetLandmarks( targetLandmarks );
+
+    TransformType::Pointer iterativeTransform = TransformType::New();
+    iterativeTransform->SetMatrixInversionMethod( "Iterative" );
+    iterativeTransform->SetIterativeSolverTolerance( 1e-10 );
+    iterativeTransform->SetTreeCodeOpeningAngle( 0.0 );
+    timeCollector.Start( "SetLandmarksIterative" );
+    iterativeTransform->SetSourceLandmarks( usedLandmarks );
+    iterativeTransform->SetTargetLandmarks( targetLandmarks );
+    timeCollector.Stop( "SetLandmarksIterative" );
+    std::cerr << "Iterations of the iterative method: "
+              << iterativeTransform->GetIterativeSolverNumberOfIterations() << std::endl;
+
+    double maxDiffIterative = 0.0;
+    for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+    {
+      PointType q = ( *usedLandmarkPoints )[ j ];
+      q[ 0 ] += 3.0;
+      maxDiffIterative = std::max( maxDiffIterative, static_cast< double >(
+        exactTransform->TransformPoint( q ).EuclideanDistanceTo( iterativeTransform->TransformPoint( q ) ) ) );
+    }
+    std::cerr << "Maximum difference of the iterative method with QR: "
+              << maxDiffIterative << std::endl;
+    if( maxDiffIterative > 1e-4 )
+    {
+      std::cerr << "ERROR: difference of the iterative method too big: "
+                << maxDiffIterative << std::endl;
+      return 1;
+    }
+
+    /** Time the approximating tree code. */
+    iterativeTransform->SetTreeCodeOpeningAngle( 0.3 );
+    iterativeTransform->SetIterativeSolverTolerance( 1e-6 );
+    timeCollector.Start( "SetParametersTreeCode" );
+    iterativeTransform->SetParameters( iterativeTransform->GetParameters() );
+    timeCollector.Stop( "SetParametersTreeCode" );
+
+    std::vector< PointType > inputPoints( numberOfLandmarks );
+    std::vector< PointType > outputPoints( numberOfLandmarks );
+    for( unsigned long j = 0; j < numberOfLandmarks; j++ )
+    {
+      inputPoints[ j ] = ( *usedLandmarkPoints )[ j ];
+      inputPoints[ j ][ 1 ] += 1.5;
+    }
+    timeCollector.Start( "TransformPointsTreeCode" );
+    iterativeTransform->TransformPoints( numberOfLandmarks, &inputPoints[ 0 ], &outputPoints[ 0 ] );
+    timeCollector.Stop( "TransformPointsTreeCode" );
+
     // Report timings
     timeCollector.Report();
     std::cout << std::endl;
@@ -0,0 +1,461 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Measures how the multi-threaded paths of elastix scale with the number of
+ * threads, for every thread placement of the PersistentThreadPool. Three paths
+ * are timed:
+ * \li Metric: GetValueAndDerivative() of the mean squares metric with a
+ *   B-spline transform, including the derivative accumulation.
+ * \li Sampler: the update of a random image sampler.
+ * \li Accumulation: the summation of per-thread derivative buffers, as done
+ *   by the metrics after every iteration. The buffers are first touched by the
+ *   threads that fill them, like the metric buffers.
+ *
+ * The speedup with respect to the smallest number of threads is written in
+ * JSON format, one curve per path and placement. On a machine with several
+ * NUMA nodes this shows where scaling stops, and which placement helps.
+ */
+
+#include "itkCommandLineArgumentParser.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkImageRandomSampler.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkPersistentThreadPool.h"
+#include "itkTimeProbe.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image< float, Dimension >                                     ImageType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric< ImageType, ImageType > MetricType;
+typedef itk::ImageRandomSampler< ImageType >                               ImageSamplerType;
+typedef itk::BSplineInterpolateImageFunction< ImageType, double, double >  InterpolatorType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >             CombinationTransformType;
+typedef itk::RecursiveBSplineTransform< double, Dimension, 3 >             BSplineTransformType;
+typedef itk::PersistentThreadPool                                          ThreadPoolType;
+
+/** A point of a speedup curve. */
+struct ScalingPoint
+{
+  unsigned int NumberOfThreads;
+  double       Seconds;
+  double       Speedup;
+};
+
+/** A speedup curve of one path and placement. */
+struct ScalingCurve
+{
+  std::string                 Path;
+  std::string                 Placement;
+  std::vector< ScalingPoint > Points;
+};
+
+/** The buffers of the accumulation benchmark. */
+struct AccumulationData
+{
+  std::vector< std::vector< double > > PerThreadBuffers;
+  std::vector< double >                Derivative;
+  std::size_t                          NumberOfParameters;
+};
+
+/**
+ * ******************* CreateImage *******************
+ *
+ * Creates an image of smooth blobs, shifted by \a shift voxels.
+ */
+
+ImageType::Pointer
+CreateImage( const unsigned int sizePerDimension, const double shift )
+{
+  ImageType::SizeType size;
+  size.Fill( sizePerDimension );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 10.0 * vcl_sin( ( it.GetIndex()[ d ] + shift ) * 0.1 );
+    }
+    it.Set( static_cast< float >( value ) );
+  }
+  return image;
+
+} // end CreateImage()
+
+
+/**
+ * ******************* CreateTransform *******************
+ *
+ * A B-spline with a control point every 4 voxels, so that the derivative,
+ * and thus the accumulation, is large.
+ */
+
+CombinationTransformType::Pointer
+CreateTransform( const ImageType * image )
+{
+  BSplineTransformType::Pointer     transform = BSplineTransformType::New();
+  BSplineTransformType::RegionType  gridRegion;
+  BSplineTransformType::SizeType    gridSize;
+  BSplineTransformType::SpacingType gridSpacing;
+  BSplineTransformType::OriginType  gridOrigin;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSize[ d ]    = image->GetLargestPossibleRegion().GetSize()[ d ] / 4 + 3;
+    gridSpacing[ d ] = 4.0;
+    gridOrigin[ d ]  = -4.0;
+  }
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( image->GetDirection() );
+
+  BSplineTransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters.Fill( 0.0 );
+  transform->SetParametersByValue( parameters );
+
+  CombinationTransformType::Pointer combinationTransform = CombinationTransformType::New();
+  combinationTransform->SetCurrentTransform( transform );
+  return combinationTransform;
+
+} // end CreateTransform()
+
+
+/**
+ * ******************* TimeMetric *******************
+ */
+
+double
+TimeMetric( const ImageType * fixedImage, const ImageType * movingImage,
+  const unsigned int numberOfThreads, const unsigned int numberOfIterations )
+{
+  ImageSamplerType::Pointer sampler = ImageSamplerType::New();
+  sampler->SetInput( fixedImage );
+  sampler->SetInputImageRegion( fixedImage->GetBufferedRegion() );
+  sampler->SetNumberOfSamples( 20000 );
+
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder( 1 );
+
+  CombinationTransformType::Pointer transform = CreateTransform( fixedImage );
+
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetImageSampler( sampler );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfThreads( numberOfThreads );
+  metric->Initialize();
+
+  /** The first call updates the sampler and touches the buffers. */
+  const MetricType::TransformParametersType parameters = transform->GetParameters();
+  MetricType::MeasureType                   value;
+  MetricType::DerivativeType                derivative;
+  metric->GetValueAndDerivative( parameters, value, derivative );
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for( unsigned int i = 0; i < numberOfIterations; ++i )
+  {
+    metric->GetValueAndDerivative( parameters, value, derivative );
+  }
+  timer.Stop();
+  return timer.GetTotal();
+
+} // end TimeMetric()
+
+
+/**
+ * ******************* TimeSampler *******************
+ */
+
+double
+TimeSampler( const ImageType * image,
+  const unsigned int numberOfThreads, const unsigned int numberOfIterations )
+{
+  ImageSamplerType::Pointer sampler = ImageSamplerType::New();
+  sampler->SetInput( image );
+  sampler->SetInputImageRegion( image->GetBufferedRegion() );
+  sampler->SetNumberOfSamples( 200000 );
+  sampler->SetUseMultiThread( true );
+  sampler->SetNumberOfThreads( numberOfThreads );
+  sampler->Update();
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for( unsigned int i = 0; i < numberOfIterations; ++i )
+  {
+    sampler->Modified();
+    sampler->Update();
+  }
+  timer.Stop();
+  return timer.GetTotal();
+
+} // end TimeSampler()
+
+
+/**
+ * ******************* AllocateBufferThreaderCallback *******************
+ *
+ * Every thread allocates and zeroes its own buffer: first touch.
+ */
+
+ITK_THREAD_RETURN_TYPE
+AllocateBufferThreaderCallback( void * arg )
+{
+  ThreadPoolType::ThreadInfoType * infoStruct = static_cast< ThreadPoolType::ThreadInfoType * >( arg );
+  AccumulationData *               data       = static_cast< AccumulationData * >( infoStruct->UserData );
+
+  data->PerThreadBuffers[ infoStruct->ThreadID ].assign( data->NumberOfParameters, 1.0 );
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end AllocateBufferThreaderCallback()
+
+
+/**
+ * ******************* AccumulateRangeFunction *******************
+ *
+ * Sums the per-thread buffers, and resets them, like the metrics do.
+ */
+
+void
+AccumulateRangeFunction( void * userData, itk::ThreadIdType,
+  itk::SizeValueType begin, itk::SizeValueType end )
+{
+  AccumulationData * data = static_cast< AccumulationData * >( userData );
+  for( itk::SizeValueType j = begin; j < end; ++j )
+  {
+    double sum = 0.0;
+    for( std::size_t t = 0; t < data->PerThreadBuffers.size(); ++t )
+    {
+      sum                             += data->PerThreadBuffers[ t ][ j ];
+      data->PerThreadBuffers[ t ][ j ] = 1.0;
+    }
+    data->Derivative[ j ] = sum;
+  }
+
+} // end AccumulateRangeFunction()
+
+
+/**
+ * ******************* TimeAccumulation *******************
+ */
+
+double
+TimeAccumulation( const unsigned int numberOfThreads, const unsigned int numberOfIterations )
+{
+  /** About the size of the derivative of a 3D B-spline with a 100^3 grid. */
+  AccumulationData data;
+  data.NumberOfParameters = 3000000;
+  data.PerThreadBuffers.resize( numberOfThreads );
+  data.Derivative.assign( data.NumberOfParameters, 0.0 );
+
+  ThreadPoolType::Pointer pool = ThreadPoolType::GetInstance();
+  pool->SingleMethodExecute( numberOfThreads, AllocateBufferThreaderCallback, &data );
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for( unsigned int i = 0; i < numberOfIterations; ++i )
+  {
+    pool->ParallelFor( data.NumberOfParameters, 0, AccumulateRangeFunction, &data );
+  }
+  timer.Stop();
+  return timer.GetTotal();
+
+} // end TimeAccumulation()
+
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "itkThreadScalingBenchmark" << std::endl
+     << "  [-out]          output JSON file, default: only print to the screen\n"
+     << "  [-threads]      numbers of threads, default: 1 2 4 ... up to the number of cores\n"
+     << "  [-placement]    thread placements, default: none compact scatter\n"
+     << "  [-path]         paths, default: Metric Sampler Accumulation\n"
+     << "  [-iterations]   repetitions per measurement, default: 10";
+  return ss.str();
+
+} // end GetHelpString()
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText( GetHelpString() );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  /** Get the arguments. */
+  const unsigned int          maximumNumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  std::vector< unsigned int > threads;
+  for( unsigned int n = 1; n < maximumNumberOfThreads; n *= 2 )
+  {
+    threads.push_back( n );
+  }
+  threads.push_back( maximumNumberOfThreads );
+  parser->GetCommandLineArgument( "-threads", threads );
+
+  std::vector< std::string > placements;
+  placements.push_back( "none" );
+  placements.push_back( "compact" );
+  placements.push_back( "scatter" );
+  parser->GetCommandLineArgument( "-placement", placements );
+
+  std::vector< std::string > paths;
+  paths.push_back( "Metric" );
+  paths.push_back( "Sampler" );
+  paths.push_back( "Accumulation" );
+  parser->GetCommandLineArgument( "-path", paths );
+
+  unsigned int numberOfIterations = 10;
+  parser->GetCommandLineArgument( "-iterations", numberOfIterations );
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+
+  /** Run the benchmarks. */
+  const std::size_t           numberOfNodes = ThreadPoolType::GetProcessorTopology().size();
+  ThreadPoolType::Pointer     pool          = ThreadPoolType::GetInstance();
+  std::vector< ScalingCurve > curves;
+  try
+  {
+    const ImageType::Pointer fixedImage  = CreateImage( 96, 0.0 );
+    const ImageType::Pointer movingImage = CreateImage( 96, 2.0 );
+
+    for( std::size_t p = 0; p < paths.size(); ++p )
+    {
+      for( std::size_t q = 0; q < placements.size(); ++q )
+      {
+        if( !pool->SetThreadPlacement( placements[ q ] ) )
+        {
+          std::cerr << "ERROR: unknown placement " << placements[ q ] << std::endl;
+          return EXIT_FAILURE;
+        }
+
+        ScalingCurve curve;
+        curve.Path      = paths[ p ];
+        curve.Placement = placements[ q ];
+        for( std::size_t t = 0; t < threads.size(); ++t )
+        {
+          pool->SetNumberOfThreads( threads[ t ] );
+
+          ScalingPoint point;
+          point.NumberOfThreads = threads[ t ];
+          if( paths[ p ] == "Metric" )
+          {
+            point.Seconds = TimeMetric( fixedImage, movingImage, threads[ t ], numberOfIterations );
+          }
+          else if( paths[ p ] == "Sampler" )
+          {
+            point.Seconds = TimeSampler( fixedImage, threads[ t ], numberOfIterations );
+          }
+          else if( paths[ p ] == "Accumulation" )
+          {
+            point.Seconds = TimeAccumulation( threads[ t ], numberOfIterations );
+          }
+          else
+          {
+            std::cerr << "ERROR: unknown path " << paths[ p ] << std::endl;
+            return EXIT_FAILURE;
+          }
+          point.Speedup = curve.Points.empty() ? 1.0 : curve.Points[ 0 ].Seconds / point.Seconds;
+          curve.Points.push_back( point );
+
+          std::cerr << std::left << std::setw( 14 ) << curve.Path << std::setw( 10 ) << curve.Placement
+                    << std::right << std::setw( 5 ) << point.NumberOfThreads << " threads"
+                    << std::fixed << std::setprecision( 4 ) << std::setw( 12 ) << point.Seconds << " s"
+                    << std::setprecision( 2 ) << std::setw( 8 ) << point.Speedup << "x" << std::endl;
+        }
+        curves.push_back( curve );
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: caught ITK exception: " << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Write the results. */
+  std::ofstream outputFile;
+  if( !outputFileName.empty() )
+  {
+    outputFile.open( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream & os = outputFileName.empty() ? std::cout : outputFile;
+  os << "{\n  \"numaNodes\": " << numberOfNodes << ",\n  \"curves\": [\n";
+  for( std::size_t c = 0; c < curves.size(); ++c )
+  {
+    os << "    { \"path\": \"" << curves[ c ].Path << "\", \"placement\": \""
+       << curves[ c ].Placement << "\", \"points\": [";
+    for( std::size_t i = 0; i < curves[ c ].Points.size(); ++i )
+    {
+      const ScalingPoint & point = curves[ c ].Points[ i ];
+      os << ( i == 0 ? "\n" : ",\n" )
+         << "      { \"threads\": " << point.NumberOfThreads
+         << ", \"seconds\": " << std::fixed << std::setprecision( 6 ) << point.Seconds
+         << ", \"speedup\": " << std::setprecision( 3 ) << point.Speedup << " }";
+    }
+    os << "\n    ] }" << ( c + 1 < curves.size() ? ",\n" : "\n" );
+  }
+  os << "  ]\n}\n";
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,615 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Measures the time per call of the methods of the advanced transforms that
+ * are evaluated per sample during a registration: TransformPoint(),
+ * GetJacobian(), EvaluateJacobianWithImageGradientProduct(),
+ * GetSpatialJacobian(), GetSpatialHessian() and
+ * GetJacobianOfSpatialHessian(). The transforms are benchmarked for a
+ * cache-resident point set, a few points in a small part of the domain that
+ * are visited over and over again, and a cache-cold point set, as many points
+ * as calls, spread randomly over the whole domain.
+ *
+ * The transforms, their parameters and the points are generated from a fixed
+ * key of a counter-based random generator, so the results of different
+ * commits and platforms are comparable. They are written in JSON format, in
+ * nanoseconds per call, and can be compared to the results of a previous run.
+ */
+
+#include "itkCommandLineArgumentParser.h"
+
+#include "itkAdvancedTranslationTransform.h"
+#include "itkEulerTransform.h"
+#include "itkAdvancedSimilarity3DTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkStackTransform.h"
+#include "SplineKernelTransform/itkThinPlateSplineKernelTransform2.h"
+
+#include "itkPhiloxRandomNumberGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 3;
+
+/** The physical extent of the domain, in every dimension. */
+const double DomainSize = 256.0;
+
+typedef itk::AdvancedTransform< double, Dimension, Dimension > TransformType;
+typedef TransformType::InputPointType                          PointType;
+typedef std::vector< PointType >                               PointContainerType;
+
+/** The methods that are benchmarked. */
+const char * MethodNames[] = {
+  "TransformPoint",
+  "GetJacobian",
+  "EvaluateJacobianWithImageGradientProduct",
+  "GetSpatialJacobian",
+  "GetSpatialHessian",
+  "GetJacobianOfSpatialHessian"
+};
+const unsigned int NumberOfMethods = 6;
+
+/** The result of a single benchmark. */
+struct BenchmarkResult
+{
+  std::string Name;
+  double      NanosecondsPerCall;
+};
+
+typedef std::vector< BenchmarkResult > BenchmarkResultContainer;
+
+/**
+ * ******************* Contains *******************
+ */
+
+bool
+Contains( const std::vector< std::string > & names, const std::string & name )
+{
+  return std::find( names.begin(), names.end(), name ) != names.end();
+
+} // end Contains()
+
+
+/**
+ * ******************* GetRandomValues *******************
+ *
+ * Returns n uniform random numbers in [minimum, maximum), that only depend
+ * on the stream number and n.
+ */
+
+std::vector< double >
+GetRandomValues( const unsigned int stream, const std::size_t n,
+  const double minimum, const double maximum )
+{
+  const itk::PhiloxRandomNumberGenerator generator( 20170101, stream );
+  std::vector< double >                  values( n );
+  for( std::size_t i = 0; i < n; ++i )
+  {
+    generator.GetUniformVariates( i, 0, &values[ i ], 1 );
+    values[ i ] = minimum + values[ i ] * ( maximum - minimum );
+  }
+  return values;
+
+} // end GetRandomValues()
+
+
+/**
+ * ******************* CreatePoints *******************
+ *
+ * Creates the point set of \a numberOfCalls points. A cache-resident set
+ * repeats 256 points inside a box of 1/16 of the domain size; a cache-cold
+ * set has a different point, anywhere in the domain, for every call.
+ */
+
+PointContainerType
+CreatePoints( const bool cacheResident, const std::size_t numberOfCalls )
+{
+  const std::size_t numberOfPoints = cacheResident ? 256 : numberOfCalls;
+  const double      extent         = cacheResident ? DomainSize / 16.0 : DomainSize;
+  const double      start          = ( DomainSize - extent ) / 2.0;
+
+  const std::vector< double > values
+    = GetRandomValues( cacheResident ? 1 : 2, numberOfPoints * Dimension, start, start + extent );
+
+  PointContainerType points( numberOfCalls );
+  for( std::size_t i = 0; i < numberOfCalls; ++i )
+  {
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      points[ i ][ d ] = values[ ( i % numberOfPoints ) * Dimension + d ];
+    }
+  }
+  return points;
+
+} // end CreatePoints()
+
+
+/**
+ * ******************* SetRandomParameters *******************
+ *
+ * Adds small random values to the current parameters of the transform.
+ */
+
+template< class TTransform >
+void
+SetRandomParameters( TTransform * transform, const unsigned int stream, const double amplitude )
+{
+  typename TTransform::ParametersType parameters = transform->GetParameters();
+  const std::vector< double >         values     = GetRandomValues(
+    stream, parameters.GetSize(), -amplitude, amplitude );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] += values[ i ];
+  }
+  transform->SetParametersByValue( parameters );
+
+} // end SetRandomParameters()
+
+
+/**
+ * ******************* CreateBSplineTransform *******************
+ *
+ * Creates a cubic B-spline transform with a control point every 4 mm on the
+ * domain, so that its coefficients do not fit in the cache.
+ */
+
+template< class TBSplineTransform >
+typename TBSplineTransform::Pointer
+CreateBSplineTransform( const unsigned int stream )
+{
+  const unsigned int SpaceDimension = TBSplineTransform::SpaceDimension;
+  const double       GridSpacing    = 4.0;
+
+  typename TBSplineTransform::Pointer       transform = TBSplineTransform::New();
+  typename TBSplineTransform::RegionType    gridRegion;
+  typename TBSplineTransform::SizeType      gridSize;
+  typename TBSplineTransform::SpacingType   gridSpacing;
+  typename TBSplineTransform::OriginType    gridOrigin;
+  typename TBSplineTransform::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+  for( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    gridSize[ d ]    = static_cast< unsigned int >( DomainSize / GridSpacing ) + 3;
+    gridSpacing[ d ] = GridSpacing;
+    gridOrigin[ d ]  = -GridSpacing;
+  }
+  gridRegion.SetSize( gridSize );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+
+  typename TBSplineTransform::ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters.Fill( 0.0 );
+  transform->SetParametersByValue( parameters );
+  SetRandomParameters( transform.GetPointer(), stream, 2.0 );
+
+  return transform;
+
+} // end CreateBSplineTransform()
+
+
+/**
+ * ******************* CreateTransform *******************
+ */
+
+TransformType::Pointer
+CreateTransform( const std::string & name )
+{
+  typedef itk::AdvancedTranslationTransform< double, Dimension >                 TranslationTransformType;
+  typedef itk::EulerTransform< double, Dimension >                               EulerTransformType;
+  typedef itk::AdvancedSimilarity3DTransform< double >                           SimilarityTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension > AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >        BSplineTransformType;
+  typedef itk::RecursiveBSplineTransform< double, Dimension, 3 >                 RecursiveBSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >                 CombinationTransformType;
+  typedef itk::StackTransform< double, Dimension, Dimension >                    StackTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension - 1, 3 >    SubTransformType;
+  typedef itk::ThinPlateSplineKernelTransform2< double, Dimension >              KernelTransformType;
+
+  /** The linear transforms rotate around the center of the domain. */
+  AffineTransformType::InputPointType center;
+  center.Fill( DomainSize / 2.0 );
+
+  if( name == "Translation" )
+  {
+    TranslationTransformType::Pointer transform = TranslationTransformType::New();
+    SetRandomParameters( transform.GetPointer(), 3, 1.0 );
+    return transform.GetPointer();
+  }
+  else if( name == "Euler" || name == "Similarity" || name == "Affine" )
+  {
+    AffineTransformType::Pointer transform;
+    if( name == "Euler" )
+    {
+      transform = EulerTransformType::New().GetPointer();
+    }
+    else if( name == "Similarity" )
+    {
+      transform = SimilarityTransformType::New().GetPointer();
+    }
+    else
+    {
+      transform = AffineTransformType::New();
+    }
+    transform->SetIdentity();
+    transform->SetCenter( center );
+    SetRandomParameters( transform.GetPointer(), 4, 0.01 );
+    return transform.GetPointer();
+  }
+  else if( name == "BSpline" )
+  {
+    return CreateBSplineTransform< BSplineTransformType >( 5 ).GetPointer();
+  }
+  else if( name == "RecursiveBSpline" )
+  {
+    return CreateBSplineTransform< RecursiveBSplineTransformType >( 5 ).GetPointer();
+  }
+  else if( name == "AffineBSplineCombination" )
+  {
+    /** An affine initial transform, composed with a B-spline, like a
+     * typical elastix parameter file sequence.
+     */
+    AffineTransformType::Pointer affine = AffineTransformType::New();
+    affine->SetIdentity();
+    affine->SetCenter( center );
+    SetRandomParameters( affine.GetPointer(), 4, 0.01 );
+
+    CombinationTransformType::Pointer initial = CombinationTransformType::New();
+    initial->SetCurrentTransform( affine );
+    CombinationTransformType::Pointer transform = CombinationTransformType::New();
+    transform->SetInitialTransform( initial );
+    transform->SetCurrentTransform( CreateBSplineTransform< RecursiveBSplineTransformType >( 5 ) );
+    transform->SetUseComposition( true );
+    return transform.GetPointer();
+  }
+  else if( name == "Stack" )
+  {
+    /** A stack of 2D B-splines along the last dimension. */
+    const unsigned int          numberOfSubTransforms = 16;
+    StackTransformType::Pointer transform             = StackTransformType::New();
+    transform->SetNumberOfSubTransforms( numberOfSubTransforms );
+    transform->SetStackOrigin( 0.0 );
+    transform->SetStackSpacing( DomainSize / numberOfSubTransforms );
+    for( unsigned int i = 0; i < numberOfSubTransforms; ++i )
+    {
+      transform->SetSubTransform( i, CreateBSplineTransform< SubTransformType >( 6 + i ) );
+    }
+    return transform.GetPointer();
+  }
+  else if( name == "ThinPlateSpline" )
+  {
+    /** 100 landmarks, the target landmarks are displaced a little. */
+    const unsigned int                         numberOfLandmarks = 100;
+    const std::vector< double >                values            = GetRandomValues(
+      30, numberOfLandmarks * Dimension, 0.0, DomainSize );
+    KernelTransformType::PointSetType::Pointer landmarks = KernelTransformType::PointSetType::New();
+    KernelTransformType::ParametersType        parameters( numberOfLandmarks * Dimension );
+    for( unsigned int i = 0; i < numberOfLandmarks; ++i )
+    {
+      PointType point;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        point[ d ]                      = values[ i * Dimension + d ];
+        parameters[ i * Dimension + d ] = point[ d ];
+      }
+      landmarks->SetPoint( i, point );
+    }
+    KernelTransformType::Pointer transform = KernelTransformType::New();
+    transform->SetStiffness( 0.0 );
+    transform->SetSourceLandmarks( landmarks );
+    transform->SetParameters( parameters );
+    SetRandomParameters( transform.GetPointer(), 31, 2.0 );
+    return transform.GetPointer();
+  }
+
+  itkGenericExceptionMacro( << "Unknown transform: " << name );
+
+} // end CreateTransform()
+
+
+/**
+ * ******************* TimeMethod *******************
+ *
+ * Calls method \a method for all points, and returns the time in seconds.
+ * A checksum of the outputs is accumulated, so that the calls can not be
+ * optimized away.
+ */
+
+double
+TimeMethod( const TransformType * transform, const unsigned int method,
+  const PointContainerType & points, double & checksum )
+{
+  const TransformType::NumberOfParametersType nnz = transform->GetNumberOfNonZeroJacobianIndices();
+
+  TransformType::JacobianType                 jacobian( Dimension, nnz );
+  TransformType::NonZeroJacobianIndicesType   nonZeroJacobianIndices( nnz );
+  TransformType::DerivativeType               imageJacobian( nnz );
+  TransformType::SpatialJacobianType          spatialJacobian;
+  TransformType::SpatialHessianType           spatialHessian;
+  TransformType::JacobianOfSpatialHessianType jacobianOfSpatialHessian( nnz );
+  TransformType::MovingImageGradientType      movingImageGradient;
+  movingImageGradient.Fill( 1.0 );
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for( std::size_t i = 0; i < points.size(); ++i )
+  {
+    const PointType & point = points[ i ];
+    switch( method )
+    {
+      case 0:
+        checksum += transform->TransformPoint( point )[ 0 ];
+        break;
+      case 1:
+        transform->GetJacobian( point, jacobian, nonZeroJacobianIndices );
+        checksum += jacobian( 0, 0 );
+        break;
+      case 2:
+        transform->EvaluateJacobianWithImageGradientProduct(
+          point, movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+        checksum += imageJacobian[ 0 ];
+        break;
+      case 3:
+        transform->GetSpatialJacobian( point, spatialJacobian );
+        checksum += spatialJacobian( 0, 0 );
+        break;
+      case 4:
+        transform->GetSpatialHessian( point, spatialHessian );
+        checksum += spatialHessian[ 0 ]( 0, 0 );
+        break;
+      case 5:
+        transform->GetJacobianOfSpatialHessian( point, jacobianOfSpatialHessian, nonZeroJacobianIndices );
+        checksum += jacobianOfSpatialHessian[ 0 ][ 0 ]( 0, 0 );
+        break;
+    }
+  }
+  timer.Stop();
+
+  return timer.GetTotal();
+
+} // end TimeMethod()
+
+
+/**
+ * ******************* WriteResults *******************
+ */
+
+void
+WriteResults( std::ostream & os, const BenchmarkResultContainer & results )
+{
+  /** One benchmark per line, which is what ReadBaseline() expects. */
+  os << "{\n  \"benchmarks\": [\n";
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    os << "    { \"name\": \"" << results[ i ].Name
+       << "\", \"nanosecondsPerCall\": " << std::fixed << std::setprecision( 2 )
+       << results[ i ].NanosecondsPerCall
+       << " }" << ( i + 1 < results.size() ? ",\n" : "\n" );
+  }
+  os << "  ]\n}\n";
+
+} // end WriteResults()
+
+
+/**
+ * ******************* ReadBaseline *******************
+ *
+ * Reads the nanoseconds per call of each benchmark from a file written
+ * by WriteResults().
+ */
+
+bool
+ReadBaseline( const std::string & fileName, std::map< std::string, double > & baseline )
+{
+  std::ifstream file( fileName.c_str() );
+  if( !file.is_open() )
+  {
+    return false;
+  }
+
+  const std::string nameKey  = "\"name\": \"";
+  const std::string valueKey = "\"nanosecondsPerCall\": ";
+  std::string       line;
+  while( std::getline( file, line ) )
+  {
+    const std::string::size_type namePos  = line.find( nameKey );
+    const std::string::size_type valuePos = line.find( valueKey );
+    if( namePos == std::string::npos || valuePos == std::string::npos )
+    {
+      continue;
+    }
+    const std::string::size_type nameBegin = namePos + nameKey.size();
+    const std::string            name      = line.substr( nameBegin, line.find( '"', nameBegin ) - nameBegin );
+    std::istringstream           value( line.substr( valuePos + valueKey.size() ) );
+    value >> baseline[ name ];
+  }
+  return true;
+
+} // end ReadBaseline()
+
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString( void )
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "itkTransformPerformanceBenchmark" << std::endl
+     << "  [-out]         output JSON file, default: only print to the screen\n"
+     << "  [-transform]   transforms, default: Translation Euler Similarity Affine BSpline\n"
+     << "                 RecursiveBSpline AffineBSplineCombination Stack ThinPlateSpline\n"
+     << "  [-method]      methods, default: all\n"
+     << "  [-calls]       calls per benchmark, default: 100000\n"
+     << "  [-baseline]    JSON file of a previous run, to compare against\n"
+     << "  [-tolerance]   allowed relative slowdown with respect to the baseline, default 0.2";
+  return ss.str();
+
+} // end GetHelpString()
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText( GetHelpString() );
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  /** Get the arguments. */
+  std::vector< std::string > transformNames;
+  transformNames.push_back( "Translation" );
+  transformNames.push_back( "Euler" );
+  transformNames.push_back( "Similarity" );
+  transformNames.push_back( "Affine" );
+  transformNames.push_back( "BSpline" );
+  transformNames.push_back( "RecursiveBSpline" );
+  transformNames.push_back( "AffineBSplineCombination" );
+  transformNames.push_back( "Stack" );
+  transformNames.push_back( "ThinPlateSpline" );
+  parser->GetCommandLineArgument( "-transform", transformNames );
+
+  std::vector< std::string > methodNames( MethodNames, MethodNames + NumberOfMethods );
+  parser->GetCommandLineArgument( "-method", methodNames );
+
+#ifndef NDEBUG
+  unsigned long numberOfCalls = 1000;
+#else
+  unsigned long numberOfCalls = 100000;
+#endif
+  parser->GetCommandLineArgument( "-calls", numberOfCalls );
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+  std::string baselineFileName = "";
+  parser->GetCommandLineArgument( "-baseline", baselineFileName );
+  double tolerance = 0.2;
+  parser->GetCommandLineArgument( "-tolerance", tolerance );
+
+  /** Run the benchmarks. */
+  BenchmarkResultContainer results;
+  double                   checksum = 0.0;
+  try
+  {
+    const PointContainerType residentPoints = CreatePoints( true, numberOfCalls );
+    const PointContainerType coldPoints     = CreatePoints( false, numberOfCalls );
+
+    for( std::size_t t = 0; t < transformNames.size(); ++t )
+    {
+      const TransformType::Pointer transform = CreateTransform( transformNames[ t ] );
+      for( unsigned int m = 0; m < NumberOfMethods; ++m )
+      {
+        if( !Contains( methodNames, MethodNames[ m ] ) )
+        {
+          continue;
+        }
+        for( unsigned int p = 0; p < 2; ++p )
+        {
+          const std::string          pointSetName = p == 0 ? "CacheResident" : "CacheCold";
+          const PointContainerType & points       = p == 0 ? residentPoints : coldPoints;
+
+          BenchmarkResult result;
+          result.Name = transformNames[ t ] + "/" + MethodNames[ m ] + "/" + pointSetName;
+          try
+          {
+            result.NanosecondsPerCall = 1e9 * TimeMethod( transform, m, points, checksum ) / points.size();
+          }
+          catch( itk::ExceptionObject & )
+          {
+            /** Not all transforms implement all methods. */
+            std::cerr << std::left << std::setw( 72 ) << result.Name << "not implemented" << std::endl;
+            continue;
+          }
+          std::cerr << std::left << std::setw( 72 ) << result.Name << std::right << std::fixed
+                    << std::setprecision( 2 ) << std::setw( 12 ) << result.NanosecondsPerCall
+                    << " ns" << std::endl;
+          results.push_back( result );
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: caught ITK exception: " << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << "Checksum: " << checksum << std::endl;
+
+  /** Write the results. */
+  if( !outputFileName.empty() )
+  {
+    std::ofstream outputFile( outputFileName.c_str() );
+    if( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    WriteResults( outputFile, results );
+  }
+  else
+  {
+    WriteResults( std::cout, results );
+  }
+
+  /** Flag regressions. */
+  std::map< std::string, double > baseline;
+  if( !baselineFileName.empty() && !ReadBaseline( baselineFileName, baseline ) )
+  {
+    std::cerr << "ERROR: could not read the baseline " << baselineFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  unsigned int numberOfRegressions = 0;
+  for( std::size_t i = 0; i < results.size(); ++i )
+  {
+    const std::map< std::string, double >::const_iterator it = baseline.find( results[ i ].Name );
+    if( it != baseline.end() && results[ i ].NanosecondsPerCall * ( 1.0 - tolerance ) > it->second )
+    {
+      std::cerr << "REGRESSION: " << results[ i ].Name << " takes "
+                << results[ i ].NanosecondsPerCall << " ns per call, the baseline "
+                << it->second << " ns." << std::endl;
+      ++numberOfRegressions;
+    }
+  }
+
+  return numberOfRegressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+} // end main
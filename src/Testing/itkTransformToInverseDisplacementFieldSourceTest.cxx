@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkTransformToInverseDisplacementFieldSource.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkVector.h"
+
+#include <algorithm>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test tests the numerical inversion of the
+// itkTransformToInverseDisplacementFieldSource, which elxInvertTransform uses
+// for nonlinear transforms. The forward transform is a smooth 3D B-spline
+// transform. For every point y of the output grid, the inverse displacement d
+// should give a point x = y + d with T(x) = y, within the tolerance. This is
+// checked independently of the residual that the source reports, with and
+// without the coarse-to-fine seeding.
+
+int
+main( int argc, char * argv[] )
+{
+  /** Some basic type definitions. */
+  const unsigned int Dimension   = 3;
+  const unsigned int SplineOrder = 3;
+  const double       tolerance   = 1e-3;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >                  TransformType;
+  typedef TransformType::ParametersType               ParametersType;
+  typedef TransformType::InputPointType               InputPointType;
+  typedef TransformType::OutputPointType              OutputPointType;
+  typedef TransformType::ImageType                    GridImageType;
+  typedef itk::Vector< float, Dimension >             VectorType;
+  typedef itk::Image< VectorType, Dimension >         DisplacementFieldType;
+  typedef itk::TransformToInverseDisplacementFieldSource<
+    DisplacementFieldType, double >                   InverseSourceType;
+  typedef itk::ImageRegionConstIteratorWithIndex<
+    DisplacementFieldType >                           IteratorType;
+
+  /** Create a B-spline grid of 9^3 control points with a spacing of 10 mm,
+   * which covers the output grid.
+   */
+  TransformType::Pointer       transform = TransformType::New();
+  GridImageType::SizeType      gridSize;
+  GridImageType::IndexType     gridIndex;
+  GridImageType::SpacingType   gridSpacing;
+  GridImageType::PointType     gridOrigin;
+  GridImageType::DirectionType gridDirection;
+  gridSize.Fill( 9 );
+  gridIndex.Fill( 0 );
+  gridSpacing.Fill( 10.0 );
+  gridOrigin.Fill( -20.0 );
+  gridDirection.SetIdentity();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( GridImageType::RegionType( gridIndex, gridSize ) );
+  transform->SetGridDirection( gridDirection );
+
+  /** Smooth coefficients of at most 3 mm. The spatial Jacobian of the
+   * displacement then has a norm well below one, so that the transform is
+   * invertible and the fixed point iteration converges.
+   */
+  const unsigned int numberOfNodes = gridSize[ 0 ] * gridSize[ 1 ] * gridSize[ 2 ];
+  ParametersType     parameters( transform->GetNumberOfParameters() );
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    for( unsigned int n = 0; n < numberOfNodes; ++n )
+    {
+      const double i = n % gridSize[ 0 ];
+      const double j = ( n / gridSize[ 0 ] ) % gridSize[ 1 ];
+      const double k = n / ( gridSize[ 0 ] * gridSize[ 1 ] );
+      parameters[ d * numberOfNodes + n ]
+        = 3.0 * vcl_sin( 0.7 * i + 0.4 * j + d ) * vcl_cos( 0.5 * k - 0.3 * d );
+    }
+  }
+  transform->SetParameters( parameters );
+
+  /** The output grid: 24^3 points with a spacing of 1.5 mm. */
+  DisplacementFieldType::SizeType    size;
+  DisplacementFieldType::IndexType   index;
+  DisplacementFieldType::SpacingType spacing;
+  DisplacementFieldType::PointType   origin;
+  size.Fill( 24 );
+  index.Fill( 0 );
+  spacing.Fill( 1.5 );
+  origin.Fill( 2.0 );
+
+  /** Invert with one level and with the default three levels. */
+  for( unsigned int levels = 1; levels <= 3; levels += 2 )
+  {
+    InverseSourceType::Pointer inverseSource = InverseSourceType::New();
+    inverseSource->SetTransform( transform );
+    inverseSource->SetOutputRegion( DisplacementFieldType::RegionType( index, size ) );
+    inverseSource->SetOutputSpacing( spacing );
+    inverseSource->SetOutputOrigin( origin );
+    inverseSource->SetNumberOfLevels( levels );
+    inverseSource->SetTolerance( tolerance );
+    inverseSource->SetMaximumNumberOfIterations( 50 );
+    try
+    {
+      inverseSource->Update();
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if( inverseSource->GetNumberOfUnconvergedPoints() != 0 )
+    {
+      std::cerr << "ERROR: " << inverseSource->GetNumberOfUnconvergedPoints()
+                << " points did not converge with " << levels << " level(s)." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** Check T( y + d( y ) ) = y at every output point. The displacements
+     * are stored as floats, which adds a small error.
+     */
+    DisplacementFieldType::Pointer field = inverseSource->GetOutput();
+    IteratorType                   it( field, field->GetLargestPossibleRegion() );
+    double                         maximumResidual     = 0.0;
+    double                         maximumDisplacement = 0.0;
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      InputPointType y;
+      field->TransformIndexToPhysicalPoint( it.GetIndex(), y );
+      InputPointType x;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        x[ d ] = y[ d ] + it.Get()[ d ];
+      }
+      const OutputPointType tx = transform->TransformPoint( x );
+      maximumResidual     = std::max( maximumResidual, tx.EuclideanDistanceTo( y ) );
+      maximumDisplacement = std::max( maximumDisplacement,
+        static_cast< double >( it.Get().GetNorm() ) );
+    }
+
+    std::cerr << levels << " level(s): maximum residual " << maximumResidual
+              << ", reported " << inverseSource->GetMaximumResidual()
+              << ", maximum inverse displacement " << maximumDisplacement << std::endl;
+
+    if( maximumResidual > 2.0 * tolerance )
+    {
+      std::cerr << "ERROR: the inverse is not accurate to the tolerance." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    /** The transform is not close to the identity, so a zero field would
+     * also fail the test above; check that it is really inverted.
+     */
+    if( maximumDisplacement < 0.5 )
+    {
+      std::cerr << "ERROR: the inverse displacements are unexpectedly small." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main